@@ -0,0 +1,141 @@
+#include <benchmark/benchmark.h>
+
+#include <Eigen/Core>
+
+#include <barrier/barrier.hpp>
+#include <utils/sinc.hpp>
+
+using namespace ipc;
+using namespace ipc::rigid;
+
+namespace {
+const double ACTIVATION_DISTANCE = 1e-3;
+
+/// @brief Distances spread over the active range of the barrier.
+Eigen::ArrayXd barrier_distances(int n)
+{
+    return ACTIVATION_DISTANCE
+        * (0.5 * (Eigen::ArrayXd::Random(n) + 1)).max(1e-8);
+}
+
+template <BarrierType barrier_type> void BM_barrier(benchmark::State& state)
+{
+    const Eigen::ArrayXd x = barrier_distances(state.range(0));
+    for (auto _ : state) {
+        for (int i = 0; i < x.size(); i++) {
+            benchmark::DoNotOptimize(
+                barrier<double>(x(i), ACTIVATION_DISTANCE, barrier_type));
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * x.size());
+}
+
+template <BarrierType barrier_type>
+void BM_barrier_gradient(benchmark::State& state)
+{
+    const Eigen::ArrayXd x = barrier_distances(state.range(0));
+    for (auto _ : state) {
+        for (int i = 0; i < x.size(); i++) {
+            benchmark::DoNotOptimize(
+                barrier_gradient(x(i), ACTIVATION_DISTANCE, barrier_type));
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * x.size());
+}
+
+template <BarrierType barrier_type>
+void BM_barrier_hessian(benchmark::State& state)
+{
+    const Eigen::ArrayXd x = barrier_distances(state.range(0));
+    for (auto _ : state) {
+        for (int i = 0; i < x.size(); i++) {
+            benchmark::DoNotOptimize(
+                barrier_hessian(x(i), ACTIVATION_DISTANCE, barrier_type));
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * x.size());
+}
+
+void BM_poly_log_barrier(benchmark::State& state)
+{
+    const Eigen::ArrayXd x = barrier_distances(state.range(0));
+    for (auto _ : state) {
+        for (int i = 0; i < x.size(); i++) {
+            benchmark::DoNotOptimize(
+                poly_log_barrier<double>(x(i), ACTIVATION_DISTANCE));
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * x.size());
+}
+
+void BM_spline_barrier(benchmark::State& state)
+{
+    const Eigen::ArrayXd x = barrier_distances(state.range(0));
+    for (auto _ : state) {
+        for (int i = 0; i < x.size(); i++) {
+            benchmark::DoNotOptimize(
+                spline_barrier<double>(x(i), ACTIVATION_DISTANCE));
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * x.size());
+}
+
+/// @brief Rotation vectors including some near zero (the series branch).
+std::vector<VectorMax3d> rotation_vectors(int n)
+{
+    std::vector<VectorMax3d> x(n);
+    for (int i = 0; i < n; i++) {
+        x[i] = Eigen::Vector3d::Random() * (i % 4 == 0 ? 1e-5 : 3.0);
+    }
+    return x;
+}
+
+void BM_sinc_normx(benchmark::State& state)
+{
+    const std::vector<VectorMax3d> x = rotation_vectors(state.range(0));
+    for (auto _ : state) {
+        for (const VectorMax3d& xi : x) {
+            benchmark::DoNotOptimize(sinc_normx<double>(xi));
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * x.size());
+}
+
+void BM_sinc_normx_grad(benchmark::State& state)
+{
+    const std::vector<VectorMax3d> x = rotation_vectors(state.range(0));
+    for (auto _ : state) {
+        for (const VectorMax3d& xi : x) {
+            benchmark::DoNotOptimize(sinc_normx_grad(xi));
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * x.size());
+}
+
+void BM_sinc_normx_hess(benchmark::State& state)
+{
+    const std::vector<VectorMax3d> x = rotation_vectors(state.range(0));
+    for (auto _ : state) {
+        for (const VectorMax3d& xi : x) {
+            benchmark::DoNotOptimize(sinc_normx_hess(xi));
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * x.size());
+}
+} // namespace
+
+BENCHMARK_TEMPLATE(BM_barrier, BarrierType::IPC)->Range(64, 1 << 16);
+BENCHMARK_TEMPLATE(BM_barrier, BarrierType::POLY_LOG)->Range(64, 1 << 16);
+BENCHMARK_TEMPLATE(BM_barrier, BarrierType::SPLINE)->Range(64, 1 << 16);
+BENCHMARK_TEMPLATE(BM_barrier_gradient, BarrierType::IPC)
+    ->Range(64, 1 << 16);
+BENCHMARK_TEMPLATE(BM_barrier_gradient, BarrierType::SPLINE)
+    ->Range(64, 1 << 16);
+BENCHMARK_TEMPLATE(BM_barrier_hessian, BarrierType::IPC)->Range(64, 1 << 16);
+BENCHMARK_TEMPLATE(BM_barrier_hessian, BarrierType::SPLINE)
+    ->Range(64, 1 << 16);
+BENCHMARK(BM_poly_log_barrier)->Range(64, 1 << 16);
+BENCHMARK(BM_spline_barrier)->Range(64, 1 << 16);
+BENCHMARK(BM_sinc_normx)->Range(64, 1 << 16);
+BENCHMARK(BM_sinc_normx_grad)->Range(64, 1 << 16);
+BENCHMARK(BM_sinc_normx_hess)->Range(64, 1 << 16);
@@ -0,0 +1,79 @@
+#include <benchmark/benchmark.h>
+
+#include <ccd/rigid/rigid_body_bvh.hpp>
+#include <ccd/rigid/rigid_body_hash_grid.hpp>
+
+#include "benchmark_utils.hpp"
+
+using namespace ipc;
+using namespace ipc::rigid;
+
+namespace {
+const double INFLATION_RADIUS = 1e-3;
+
+/// @brief Time of the poses: the whole step for intervals (as in the CCD
+/// broad phase) and the middle of the step otherwise.
+template <typename T> T step_time() { return T(0.5); }
+template <> Interval step_time<Interval>() { return Interval(0, 1); }
+
+/// @brief Two overlapping spheres with range(0) rings each.
+template <typename T>
+void BM_detect_body_pair_collision_candidates_bvh(benchmark::State& state)
+{
+    RigidBodyAssembler bodies;
+    sphere_lattice(/*num_bodies=*/2, state.range(0), bodies);
+
+    const PosesD poses_t0 = bodies.rb_poses_t1();
+    const PosesD poses_t1 = perturbed_poses(poses_t0, 0.01);
+    const Poses<T> poses =
+        interpolate(cast<T>(poses_t0), cast<T>(poses_t1), step_time<T>());
+    const std::vector<MatrixMax3<T>> rotations =
+        construct_rotation_matrices(poses);
+
+    Candidates candidates;
+    for (auto _ : state) {
+        candidates.clear();
+        detect_body_pair_collision_candidates_bvh(
+            bodies, poses, rotations, 0, 1,
+            CollisionType::EDGE_EDGE | CollisionType::FACE_VERTEX, candidates,
+            INFLATION_RADIUS);
+        benchmark::DoNotOptimize(candidates);
+    }
+    state.counters["candidates"] = candidates.size();
+    state.counters["vertices"] = bodies.num_vertices();
+}
+
+/// @brief Lattice of range(0) spheres moving over a step.
+void BM_rigid_body_hash_grid_add_bodies(benchmark::State& state)
+{
+    RigidBodyAssembler bodies;
+    sphere_lattice(state.range(0), /*resolution=*/8, bodies);
+
+    const PosesD poses_t0 = bodies.rb_poses_t1();
+    const PosesD poses_t1 = perturbed_poses(poses_t0, 0.05);
+    const std::vector<std::pair<int, int>> body_pairs =
+        bodies.close_bodies_brute_force(poses_t0, poses_t1, INFLATION_RADIUS);
+
+    RigidBodyHashGrid hashgrid;
+    for (auto _ : state) {
+        hashgrid.resize(
+            bodies, poses_t0, poses_t1, body_pairs, INFLATION_RADIUS);
+        hashgrid.addBodies(
+            bodies, poses_t0, poses_t1, body_pairs, INFLATION_RADIUS);
+        benchmark::ClobberMemory();
+    }
+    state.counters["body_pairs"] = body_pairs.size();
+    state.counters["vertices"] = bodies.num_vertices();
+}
+} // namespace
+
+BENCHMARK_TEMPLATE(BM_detect_body_pair_collision_candidates_bvh, double)
+    ->RangeMultiplier(2)
+    ->Range(4, 128);
+BENCHMARK_TEMPLATE(BM_detect_body_pair_collision_candidates_bvh, Interval)
+    ->RangeMultiplier(2)
+    ->Range(4, 128);
+BENCHMARK(BM_rigid_body_hash_grid_add_bodies)
+    ->RangeMultiplier(4)
+    ->Range(2, 512)
+    ->Unit(benchmark::kMillisecond);
@@ -0,0 +1,150 @@
+#include <benchmark/benchmark.h>
+
+#include <igl/PI.h>
+#include <igl/edges.h>
+
+#include <ccd/rigid/time_of_impact.hpp>
+#include <interval/interval_root_finder.hpp>
+
+#include "benchmark_utils.hpp"
+
+using namespace ipc;
+using namespace ipc::rigid;
+
+// The size of the time-of-impact queries is the rotation of the moving body
+// over the step in quarter turns (larger rotations need more subdivisions).
+
+namespace {
+double rotation_angle(const benchmark::State& state)
+{
+    return igl::PI / 2 * state.range(0);
+}
+
+void BM_compute_edge_vertex_time_of_impact(benchmark::State& state)
+{
+    Eigen::MatrixXd VA(2, 2), VB(2, 2);
+    VA << -1, 0, 1, 0;
+    VB << -2, 0, 2, 0;
+    Eigen::MatrixXi E(1, 2);
+    E << 0, 1;
+    const RigidBody bodyA =
+        create_body(VA, E, Eigen::MatrixXi(), PoseD::Zero(2), 0);
+    const RigidBody bodyB =
+        create_body(VB, E, Eigen::MatrixXi(), PoseD::Zero(2), 1);
+
+    // The vertex spins while falling onto the edge
+    PoseD poseA_t0 = PoseD::Zero(2), poseA_t1 = PoseD::Zero(2);
+    poseA_t0.position.y() = 0.5;
+    poseA_t1.position.y() = -0.5;
+    poseA_t1.rotation(0) = rotation_angle(state);
+    const PoseD poseB = PoseD::Zero(2);
+
+    for (auto _ : state) {
+        double toi;
+        benchmark::DoNotOptimize(compute_edge_vertex_time_of_impact(
+            bodyA, poseA_t0, poseA_t1, /*vertex_id=*/0, bodyB, poseB, poseB,
+            /*edge_id=*/0, toi));
+        benchmark::DoNotOptimize(toi);
+    }
+}
+
+void BM_compute_edge_edge_time_of_impact(benchmark::State& state)
+{
+    Eigen::MatrixXd VA(2, 3), VB(2, 3);
+    VA << -1, 0, 0, 1, 0, 0;
+    VB << 0, 0, -1, 0, 0, 1;
+    Eigen::MatrixXi E(1, 2);
+    E << 0, 1;
+    const RigidBody bodyA =
+        create_body(VA, E, Eigen::MatrixXi(), PoseD::Zero(3), 0);
+    const RigidBody bodyB =
+        create_body(VB, E, Eigen::MatrixXi(), PoseD::Zero(3), 1);
+
+    // Edge A spins around y while crossing edge B
+    PoseD poseA_t0 = PoseD::Zero(3), poseA_t1 = PoseD::Zero(3);
+    poseA_t0.position.y() = 1;
+    poseA_t1.position.y() = -1;
+    poseA_t1.rotation.y() = rotation_angle(state);
+    const PoseD poseB = PoseD::Zero(3);
+
+    for (auto _ : state) {
+        double toi;
+        benchmark::DoNotOptimize(compute_edge_edge_time_of_impact(
+            bodyA, poseA_t0, poseA_t1, /*edgeA_id=*/0, bodyB, poseB, poseB,
+            /*edgeB_id=*/0, toi));
+        benchmark::DoNotOptimize(toi);
+    }
+}
+
+void BM_compute_face_vertex_time_of_impact(benchmark::State& state)
+{
+    // Vertex 0 of a small triangle against a large triangle
+    Eigen::MatrixXd VA(3, 3), VB(3, 3);
+    VA << 0.1, 0.1, 0, 0.2, 0.1, 0.1, 0.1, 0.2, 0.1;
+    VB << -1, -1, 0, 2, -1, 0, -1, 2, 0;
+    Eigen::MatrixXi F(1, 3);
+    F << 0, 1, 2;
+    Eigen::MatrixXi E;
+    igl::edges(F, E);
+    const RigidBody bodyA = create_body(VA, E, F, PoseD::Zero(3), 0);
+    const RigidBody bodyB = create_body(VB, E, F, PoseD::Zero(3), 1);
+
+    // The vertex orbits the body origin while falling through the face
+    PoseD poseA_t0 = PoseD::Zero(3), poseA_t1 = PoseD::Zero(3);
+    poseA_t0.position.z() = 1;
+    poseA_t1.position.z() = -1;
+    poseA_t1.rotation.z() = rotation_angle(state);
+    const PoseD poseB = PoseD::Zero(3);
+
+    for (auto _ : state) {
+        double toi;
+        benchmark::DoNotOptimize(compute_face_vertex_time_of_impact(
+            bodyA, poseA_t0, poseA_t1, /*vertex_id=*/0, bodyB, poseB, poseB,
+            /*face_id=*/0, toi));
+        benchmark::DoNotOptimize(toi);
+    }
+}
+
+/// @brief First root of cos(2πkx) on [0, 1] for k = range(0).
+void BM_interval_root_finder(benchmark::State& state)
+{
+    const double k = state.range(0);
+    const auto f = [&](const Interval& x) {
+        return cos(2 * igl::PI * k * x);
+    };
+    for (auto _ : state) {
+        Interval root;
+        benchmark::DoNotOptimize(interval_root_finder(
+            f, Interval(0, 1), Constants::INTERVAL_ROOT_FINDER_TOL, root));
+        benchmark::DoNotOptimize(root);
+    }
+}
+
+/// @brief Root of f: I² ↦ I² whose first coordinate has range(0) roots.
+void BM_interval_root_finder_2d(benchmark::State& state)
+{
+    const double k = state.range(0);
+    const auto f = [&](const VectorMax3I& x) {
+        VectorMax3I y(2);
+        y(0) = cos(2 * igl::PI * k * x(0));
+        y(1) = x(1) - 0.5 * x(0);
+        return y;
+    };
+    VectorMax3I x0(2);
+    x0(0) = Interval(0, 1);
+    x0(1) = Interval(0, 1);
+    const VectorMax3d tol =
+        VectorMax3d::Constant(2, Constants::INTERVAL_ROOT_FINDER_TOL);
+    for (auto _ : state) {
+        VectorMax3I root;
+        benchmark::DoNotOptimize(interval_root_finder(f, x0, tol, root));
+        benchmark::DoNotOptimize(root);
+    }
+}
+} // namespace
+
+BENCHMARK(BM_compute_edge_vertex_time_of_impact)->DenseRange(0, 8, 2);
+BENCHMARK(BM_compute_edge_edge_time_of_impact)->DenseRange(0, 8, 2);
+BENCHMARK(BM_compute_face_vertex_time_of_impact)->DenseRange(0, 8, 2);
+BENCHMARK(BM_interval_root_finder)->RangeMultiplier(4)->Range(1, 256);
+BENCHMARK(BM_interval_root_finder_2d)->RangeMultiplier(4)->Range(1, 256);
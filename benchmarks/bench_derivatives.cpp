@@ -0,0 +1,105 @@
+#include <benchmark/benchmark.h>
+
+#include <array>
+#include <cstdlib>
+
+#include <physics/world_vertices_diff.hpp>
+
+#include "benchmark_utils.hpp"
+
+using namespace ipc;
+using namespace ipc::rigid;
+
+namespace {
+/// @brief Rotation derivatives of a lattice of range(0) spheres.
+void BM_world_vertices_diff_compute(benchmark::State& state)
+{
+    RigidBodyAssembler bodies;
+    sphere_lattice(state.range(0), /*resolution=*/4, bodies);
+    const PosesD poses = bodies.rb_poses_t1();
+    const bool compute_hess = state.range(1);
+
+    WorldVerticesDiff V_diff;
+    for (auto _ : state) {
+        V_diff.compute(bodies, poses, compute_hess);
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * bodies.num_bodies());
+}
+
+/// @brief Jacobians of every vertex of a lattice of range(0) spheres.
+void BM_world_vertices_diff_vertex_jacobian(benchmark::State& state)
+{
+    RigidBodyAssembler bodies;
+    sphere_lattice(state.range(0), /*resolution=*/4, bodies);
+    WorldVerticesDiff V_diff;
+    V_diff.compute(bodies, bodies.rb_poses_t1(), /*compute_hess=*/false);
+
+    for (auto _ : state) {
+        for (long vi = 0; vi < bodies.num_vertices(); vi++) {
+            benchmark::DoNotOptimize(V_diff.vertex_jacobian<3>(vi));
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * bodies.num_vertices());
+}
+
+/// @brief Local gradient and Hessian of range(0) edge-edge potentials
+/// between two bodies, as assembled by the chain rule of the barrier
+/// problem: Jᵀ∇f and Jᵀ∇²fJ + ∑ᵢ ∇²(∇fᵢᵀVᵢ).
+void BM_apply_chain_rule(benchmark::State& state)
+{
+    constexpr int dim = 3;
+    constexpr int rb_ndof = PoseD::dim_to_ndof(dim);
+    constexpr int num_vertices = 4;
+    typedef Eigen::Matrix<double, num_vertices * dim, 1> VertexGradient;
+    typedef Eigen::Matrix<double, num_vertices * dim, num_vertices * dim>
+        VertexHessian;
+    typedef Eigen::Matrix<double, num_vertices * dim, 2 * rb_ndof>
+        LocalJacobian;
+    typedef Eigen::Matrix<double, 2 * rb_ndof, 2 * rb_ndof> LocalHessian;
+
+    RigidBodyAssembler bodies;
+    sphere_lattice(/*num_bodies=*/2, /*resolution=*/8, bodies);
+    WorldVerticesDiff V_diff;
+    V_diff.compute(bodies, bodies.rb_poses_t1(), /*compute_hess=*/true);
+
+    // Random pairs of an edge of body 0 and an edge of body 1
+    const int num_constraints = state.range(0);
+    const long num_body_vertices = bodies.m_body_vertex_id[1];
+    std::vector<std::array<long, num_vertices>> constraints(num_constraints);
+    for (auto& vertex_ids : constraints) {
+        for (int i = 0; i < num_vertices; i++) {
+            vertex_ids[i] = (i / 2) * num_body_vertices
+                + std::rand() % num_body_vertices;
+        }
+    }
+    const VertexGradient grad_f = VertexGradient::Random();
+    const VertexHessian hess_f = VertexHessian::Random();
+
+    for (auto _ : state) {
+        for (const auto& vertex_ids : constraints) {
+            LocalJacobian jac = LocalJacobian::Zero();
+            for (int i = 0; i < num_vertices; i++) {
+                jac.block<dim, rb_ndof>(i * dim, (i / 2) * rb_ndof) =
+                    V_diff.vertex_jacobian<dim>(vertex_ids[i]);
+            }
+            benchmark::DoNotOptimize((jac.transpose() * grad_f).eval());
+
+            LocalHessian hess = jac.transpose() * hess_f * jac;
+            for (int i = 0; i < num_vertices; i++) {
+                hess.block<rb_ndof, rb_ndof>(
+                    (i / 2) * rb_ndof, (i / 2) * rb_ndof) +=
+                    V_diff.vertex_hessian<dim>(
+                        vertex_ids[i], grad_f.segment<dim>(i * dim));
+            }
+            benchmark::DoNotOptimize(hess);
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * num_constraints);
+}
+} // namespace
+
+BENCHMARK(BM_world_vertices_diff_compute)
+    ->ArgsProduct({ benchmark::CreateRange(8, 4096, 8), { 0, 1 } });
+BENCHMARK(BM_world_vertices_diff_vertex_jacobian)->Range(8, 512);
+BENCHMARK(BM_apply_chain_rule)->Range(64, 1 << 14);
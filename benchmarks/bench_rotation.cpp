@@ -0,0 +1,64 @@
+#include <benchmark/benchmark.h>
+
+#include <interval/interval.hpp>
+#include <physics/pose.hpp>
+
+using namespace ipc;
+using namespace ipc::rigid;
+
+namespace {
+template <typename T> std::vector<VectorMax3<T>> rotations(int n, int dim)
+{
+    std::vector<VectorMax3<T>> r(n);
+    for (int i = 0; i < n; i++) {
+        const VectorMax3d ri =
+            3.0 * VectorMax3d::Random(PoseD::dim_to_rot_ndof(dim));
+        r[i] = ri.cast<T>();
+    }
+    return r;
+}
+
+template <typename T, int dim>
+void BM_construct_rotation_matrix(benchmark::State& state)
+{
+    const std::vector<VectorMax3<T>> r = rotations<T>(state.range(0), dim);
+    for (auto _ : state) {
+        for (const VectorMax3<T>& ri : r) {
+            benchmark::DoNotOptimize(construct_rotation_matrix<T>(ri));
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * r.size());
+}
+
+/// @brief Interval rotations over a time step (as in CCD and the broad phase)
+void BM_construct_rotation_matrix_interval_trajectory(benchmark::State& state)
+{
+    std::vector<VectorMax3I> r(state.range(0));
+    for (VectorMax3I& ri : r) {
+        const VectorMax3d r0 = Eigen::Vector3d::Random();
+        const VectorMax3d r1 =
+            r0 + 0.1 * VectorMax3d(Eigen::Vector3d::Random());
+        ri.resize(3);
+        for (int k = 0; k < 3; k++) {
+            ri(k) = Interval(std::min(r0(k), r1(k)), std::max(r0(k), r1(k)));
+        }
+    }
+    for (auto _ : state) {
+        for (const VectorMax3I& ri : r) {
+            benchmark::DoNotOptimize(construct_rotation_matrix<Interval>(ri));
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * r.size());
+}
+} // namespace
+
+BENCHMARK_TEMPLATE(BM_construct_rotation_matrix, double, 2)
+    ->Range(64, 1 << 14);
+BENCHMARK_TEMPLATE(BM_construct_rotation_matrix, double, 3)
+    ->Range(64, 1 << 14);
+BENCHMARK_TEMPLATE(BM_construct_rotation_matrix, Interval, 2)
+    ->Range(64, 1 << 14);
+BENCHMARK_TEMPLATE(BM_construct_rotation_matrix, Interval, 3)
+    ->Range(64, 1 << 14);
+BENCHMARK(BM_construct_rotation_matrix_interval_trajectory)
+    ->Range(64, 1 << 14);
@@ -0,0 +1,117 @@
+#include "benchmark_utils.hpp"
+
+#include <cmath>
+
+#include <igl/PI.h>
+#include <igl/edges.h>
+
+namespace ipc::rigid {
+
+void sphere_mesh(
+    int resolution,
+    Eigen::MatrixXd& vertices,
+    Eigen::MatrixXi& edges,
+    Eigen::MatrixXi& faces)
+{
+    const int num_rings = std::max(resolution, 1);
+    const int ring_size = 2 * std::max(resolution, 2);
+
+    // Rings of vertices between the south (0) and north (last) poles
+    vertices.resize(num_rings * ring_size + 2, 3);
+    vertices.row(0) << 0, 0, -1;
+    for (int i = 0; i < num_rings; i++) {
+        const double phi = igl::PI * (i + 1) / (num_rings + 1) - igl::PI / 2;
+        for (int j = 0; j < ring_size; j++) {
+            const double theta = 2 * igl::PI * j / ring_size;
+            vertices.row(1 + i * ring_size + j) << cos(phi) * cos(theta),
+                cos(phi) * sin(theta), sin(phi);
+        }
+    }
+    vertices.row(vertices.rows() - 1) << 0, 0, 1;
+
+    const auto ring_vertex = [&](int i, int j) {
+        return 1 + i * ring_size + (j % ring_size);
+    };
+    const int north_pole = vertices.rows() - 1;
+    faces.resize(2 * ring_size * num_rings, 3);
+    int fi = 0;
+    for (int j = 0; j < ring_size; j++) {
+        faces.row(fi++) << 0, ring_vertex(0, j + 1), ring_vertex(0, j);
+        faces.row(fi++) << north_pole, ring_vertex(num_rings - 1, j),
+            ring_vertex(num_rings - 1, j + 1);
+    }
+    for (int i = 0; i + 1 < num_rings; i++) {
+        for (int j = 0; j < ring_size; j++) {
+            faces.row(fi++) << ring_vertex(i, j), ring_vertex(i, j + 1),
+                ring_vertex(i + 1, j + 1);
+            faces.row(fi++) << ring_vertex(i, j), ring_vertex(i + 1, j + 1),
+                ring_vertex(i + 1, j);
+        }
+    }
+    assert(fi == faces.rows());
+    igl::edges(faces, edges);
+}
+
+void polygon_mesh(
+    int num_vertices, Eigen::MatrixXd& vertices, Eigen::MatrixXi& edges)
+{
+    num_vertices = std::max(num_vertices, 3);
+    vertices.resize(num_vertices, 2);
+    edges.resize(num_vertices, 2);
+    for (int i = 0; i < num_vertices; i++) {
+        const double theta = 2 * igl::PI * i / num_vertices;
+        vertices.row(i) << cos(theta), sin(theta);
+        edges.row(i) << i, (i + 1) % num_vertices;
+    }
+}
+
+RigidBody create_body(
+    const Eigen::MatrixXd& vertices,
+    const Eigen::MatrixXi& edges,
+    const Eigen::MatrixXi& faces,
+    const PoseD& pose,
+    int group_id)
+{
+    RigidBody rb(
+        vertices, edges, faces, pose,
+        /*velocity=*/PoseD::Zero(pose.dim()),
+        /*force=*/PoseD::Zero(pose.dim()),
+        /*density=*/1.0,
+        /*is_dof_fixed=*/VectorMax6b::Zero(pose.ndof()),
+        /*oriented=*/false, group_id);
+    rb.vertices = vertices; // Cancel out the inertial rotation
+    rb.pose = pose;
+    return rb;
+}
+
+void sphere_lattice(
+    int num_bodies, int resolution, RigidBodyAssembler& bodies)
+{
+    Eigen::MatrixXd V;
+    Eigen::MatrixXi E, F;
+    sphere_mesh(resolution, V, E, F);
+
+    const int n = std::max(int(std::ceil(std::cbrt(num_bodies))), 1);
+    std::vector<RigidBody> rbs;
+    for (int i = 0; i < num_bodies; i++) {
+        PoseD pose = PoseD::Zero(3);
+        // Unit spheres spaced by slightly less than their diameter
+        pose.position << i % n, (i / n) % n, i / (n * n);
+        pose.position *= 1.99;
+        pose.rotation.setConstant(0.1 * i);
+        rbs.push_back(create_body(V, E, F, pose, i));
+    }
+    bodies.init(rbs);
+}
+
+PosesD perturbed_poses(const PosesD& poses, double scale)
+{
+    PosesD perturbed = poses;
+    for (PoseD& pose : perturbed) {
+        pose.position += scale * VectorMax3d::Random(pose.pos_ndof());
+        pose.rotation += scale * VectorMax3d::Random(pose.rot_ndof());
+    }
+    return perturbed;
+}
+
+} // namespace ipc::rigid
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <vector>
+
+#include <Eigen/Core>
+
+#include <physics/rigid_body.hpp>
+#include <physics/rigid_body_assembler.hpp>
+
+namespace ipc::rigid {
+
+/// @brief Triangulated unit sphere with resolution rings of 2 * resolution
+/// vertices (plus the poles).
+void sphere_mesh(
+    int resolution,
+    Eigen::MatrixXd& vertices,
+    Eigen::MatrixXi& edges,
+    Eigen::MatrixXi& faces);
+
+/// @brief Regular polygon with the given number of vertices.
+void polygon_mesh(
+    int num_vertices, Eigen::MatrixXd& vertices, Eigen::MatrixXi& edges);
+
+/// @brief Dynamic body with unit density whose body space is the input
+/// space (i.e., the inertial frame is not applied).
+RigidBody create_body(
+    const Eigen::MatrixXd& vertices,
+    const Eigen::MatrixXi& edges,
+    const Eigen::MatrixXi& faces,
+    const PoseD& pose,
+    int group_id);
+
+/// @brief Cubic lattice of num_bodies spheres spaced to barely overlap.
+void sphere_lattice(
+    int num_bodies, int resolution, RigidBodyAssembler& bodies);
+
+/// @brief Poses of the bodies moved along a random rigid trajectory.
+PosesD perturbed_poses(const PosesD& poses, double scale);
+
+} // namespace ipc::rigid
@@ -0,0 +1,116 @@
+#pragma once
+
+/// @file
+/// @brief C API of rigid IPC simulations.
+///
+/// A simulation is an opaque handle. Poses and velocities are copied into and
+/// out of caller provided buffers, so stepping and querying a loaded
+/// simulation do not build any JSON. Every function returning a ripc_status
+/// stores a message retrievable with ripc_last_error() on failure.
+///
+/// Positions have dim values and rotations (and angular velocities) have one
+/// value in 2D (an angle) and three values in 3D (a rotation vector). The
+/// poses of all bodies are packed body after body as [position, rotation].
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define RIGID_IPC_C_API_VERSION 1
+
+typedef enum ripc_status {
+    RIPC_OK = 0,
+    RIPC_ERROR_INVALID_HANDLE,
+    RIPC_ERROR_INVALID_ARGUMENT,
+    RIPC_ERROR_LOAD_FAILED,
+    RIPC_ERROR_SAVE_FAILED,
+    RIPC_ERROR_NOT_LOADED,
+    RIPC_ERROR_EXCEPTION,
+} ripc_status;
+
+typedef struct ripc_simulation ripc_simulation;
+
+/// @brief Statistics of the last step.
+typedef struct ripc_step_stats {
+    int num_steps;          ///< Steps taken since the scene was loaded
+    int num_substeps;       ///< Substeps of the last (adaptive) step
+    int solver_iterations;  ///< Solver iterations of the last step
+    int num_contacts;       ///< Active contacts at the end of the last step
+    int had_collision;      ///< Did the last step have a collision?
+    int has_intersections;  ///< Did the last step end intersecting?
+    double step_time;       ///< Time in seconds of the last step
+} ripc_step_stats;
+
+/// @brief Version of this API (RIGID_IPC_C_API_VERSION of the library).
+int ripc_api_version(void);
+
+/// @brief Message of the last failed call on this thread (never NULL).
+const char* ripc_last_error(void);
+
+/// @brief Create an empty simulation (NULL on failure).
+ripc_simulation* ripc_create(void);
+/// @brief Destroy a simulation (NULL is ignored).
+void ripc_destroy(ripc_simulation* sim);
+
+/// @brief Load a scene file, optionally patched with a JSON string.
+/// @param patch JSON merge patch of the scene (NULL or "" for none).
+ripc_status ripc_load_scene(
+    ripc_simulation* sim, const char* filename, const char* patch);
+/// @brief Save the simulation results as a JSON file.
+ripc_status ripc_save_simulation(ripc_simulation* sim, const char* filename);
+
+/// @brief Dimension of the scene (2 or 3, 0 if nothing is loaded).
+int ripc_dim(const ripc_simulation* sim);
+/// @brief Number of bodies (0 if nothing is loaded).
+int ripc_num_bodies(const ripc_simulation* sim);
+/// @brief Values of a pose of one body (3 in 2D and 6 in 3D).
+int ripc_pose_size(const ripc_simulation* sim);
+
+ripc_status ripc_get_timestep(const ripc_simulation* sim, double* timestep);
+ripc_status ripc_set_timestep(ripc_simulation* sim, double timestep);
+/// @brief Threads of the simulation's arena (-1 uses the caller's arena).
+ripc_status ripc_set_num_threads(ripc_simulation* sim, int num_threads);
+
+/// @brief Copy the poses of all bodies.
+/// @param poses Buffer of size num_bodies * pose_size.
+ripc_status
+ripc_get_poses(const ripc_simulation* sim, double* poses, int size);
+/// @brief Copy the velocities of all bodies (packed like the poses).
+ripc_status
+ripc_get_velocities(const ripc_simulation* sim, double* velocities, int size);
+
+/// @brief Copy the pose of a body.
+/// @param position Buffer of dim values (NULL to skip).
+/// @param rotation Buffer of 1 (2D) or 3 (3D) values (NULL to skip).
+ripc_status ripc_get_body_pose(
+    const ripc_simulation* sim, int body, double* position, double* rotation);
+/// @brief Move a body (a sleeping body is woken up).
+/// @param position dim values (NULL to keep the position).
+/// @param rotation 1 (2D) or 3 (3D) values (NULL to keep the rotation).
+ripc_status ripc_set_body_pose(
+    ripc_simulation* sim,
+    int body,
+    const double* position,
+    const double* rotation);
+ripc_status ripc_get_body_velocity(
+    const ripc_simulation* sim,
+    int body,
+    double* linear_velocity,
+    double* angular_velocity);
+/// @brief Set the velocity of a body (a sleeping body is woken up).
+ripc_status ripc_set_body_velocity(
+    ripc_simulation* sim,
+    int body,
+    const double* linear_velocity,
+    const double* angular_velocity);
+
+/// @brief Take num_steps steps (without recording them for saving).
+ripc_status ripc_step(ripc_simulation* sim, int num_steps);
+/// @brief Take one step and record it (like the headless simulation).
+ripc_status ripc_step_and_record(ripc_simulation* sim);
+ripc_status ripc_get_step_stats(
+    const ripc_simulation* sim, ripc_step_stats* stats);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
@@ -0,0 +1,354 @@
+#include <rigid_ipc.h>
+
+#include <exception>
+#include <string>
+
+#include <SimState.hpp>
+#include <physics/rigid_body_problem.hpp>
+#include <utils/eigen_ext.hpp>
+
+using namespace ipc;
+using namespace ipc::rigid;
+
+struct ripc_simulation {
+    SimState state;
+    /// @brief Problem of the loaded scene (null if nothing is loaded).
+    std::shared_ptr<RigidBodyProblem> problem;
+};
+
+namespace {
+thread_local std::string last_error;
+
+ripc_status fail(ripc_status status, const std::string& message)
+{
+    last_error = message;
+    return status;
+}
+
+ripc_status check_loaded(const ripc_simulation* sim)
+{
+    if (sim == nullptr) {
+        return fail(RIPC_ERROR_INVALID_HANDLE, "null simulation handle");
+    }
+    if (sim->problem == nullptr) {
+        return fail(RIPC_ERROR_NOT_LOADED, "no scene is loaded");
+    }
+    return RIPC_OK;
+}
+
+ripc_status check_body(const ripc_simulation* sim, int body)
+{
+    ripc_status status = check_loaded(sim);
+    if (status == RIPC_OK
+        && (body < 0 || body >= int(sim->problem->num_bodies()))) {
+        return fail(
+            RIPC_ERROR_INVALID_ARGUMENT,
+            "body index " + std::to_string(body) + " is out of range");
+    }
+    return status;
+}
+
+/// @brief Call func converting any exception to an error status.
+template <typename Func> ripc_status guard(const Func& func)
+{
+    try {
+        return func();
+    } catch (const std::exception& e) {
+        return fail(RIPC_ERROR_EXCEPTION, e.what());
+    } catch (...) {
+        return fail(RIPC_ERROR_EXCEPTION, "unknown exception");
+    }
+}
+
+/// @brief Copy a pose-like quantity of every body into a packed buffer.
+ripc_status get_packed(
+    const ripc_simulation* sim,
+    PoseD RigidBody::*field,
+    double* values,
+    int size)
+{
+    ripc_status status = check_loaded(sim);
+    if (status != RIPC_OK) {
+        return status;
+    }
+    const RigidBodyAssembler& bodies = sim->problem->m_assembler;
+    const int ndof = PoseD::dim_to_ndof(bodies.dim());
+    if (values == nullptr || size < 0
+        || size_t(size) < bodies.num_bodies() * ndof) {
+        return fail(
+            RIPC_ERROR_INVALID_ARGUMENT,
+            "buffer must hold num_bodies * pose_size values");
+    }
+    for (size_t i = 0; i < bodies.num_bodies(); i++) {
+        const PoseD& pose = bodies[i].*field;
+        Eigen::Map<Eigen::VectorXd>(values + i * ndof, pose.pos_ndof()) =
+            pose.position;
+        Eigen::Map<Eigen::VectorXd>(
+            values + i * ndof + pose.pos_ndof(), pose.rot_ndof()) =
+            pose.rotation;
+    }
+    return RIPC_OK;
+}
+
+/// @brief Copy the position and rotation parts of a pose-like quantity.
+void get_pose(const PoseD& pose, double* position, double* rotation)
+{
+    if (position != nullptr) {
+        Eigen::Map<Eigen::VectorXd>(position, pose.pos_ndof()) = pose.position;
+    }
+    if (rotation != nullptr) {
+        Eigen::Map<Eigen::VectorXd>(rotation, pose.rot_ndof()) = pose.rotation;
+    }
+}
+
+void set_pose(PoseD& pose, const double* position, const double* rotation)
+{
+    if (position != nullptr) {
+        pose.position =
+            Eigen::Map<const Eigen::VectorXd>(position, pose.pos_ndof());
+    }
+    if (rotation != nullptr) {
+        pose.rotation =
+            Eigen::Map<const Eigen::VectorXd>(rotation, pose.rot_ndof());
+    }
+}
+
+/// @brief Wake up a modified body and keep its rotation matrix velocity
+/// consistent with its pose and angular velocity.
+void update_body(RigidBody& body)
+{
+    if (body.is_sleeping) {
+        body.wake_up();
+    }
+    if (body.dim() == 3) {
+        body.Qdot = body.pose.construct_rotation_matrix()
+            * Hat(Eigen::Vector3d(body.velocity.rotation));
+    }
+}
+} // namespace
+
+extern "C" {
+
+int ripc_api_version(void) { return RIGID_IPC_C_API_VERSION; }
+
+const char* ripc_last_error(void) { return last_error.c_str(); }
+
+ripc_simulation* ripc_create(void)
+{
+    try {
+        return new ripc_simulation();
+    } catch (const std::exception& e) {
+        fail(RIPC_ERROR_EXCEPTION, e.what());
+        return nullptr;
+    }
+}
+
+void ripc_destroy(ripc_simulation* sim) { delete sim; }
+
+ripc_status
+ripc_load_scene(ripc_simulation* sim, const char* filename, const char* patch)
+{
+    if (sim == nullptr) {
+        return fail(RIPC_ERROR_INVALID_HANDLE, "null simulation handle");
+    }
+    if (filename == nullptr) {
+        return fail(RIPC_ERROR_INVALID_ARGUMENT, "null filename");
+    }
+    return guard([&] {
+        sim->problem = nullptr;
+        if (!sim->state.load_scene(filename, patch ? patch : "")) {
+            return fail(
+                RIPC_ERROR_LOAD_FAILED,
+                std::string("unable to load scene ") + filename);
+        }
+        sim->problem =
+            std::dynamic_pointer_cast<RigidBodyProblem>(sim->state.problem_ptr);
+        if (sim->problem == nullptr) {
+            return fail(
+                RIPC_ERROR_LOAD_FAILED,
+                std::string("scene is not a rigid body problem ") + filename);
+        }
+        return RIPC_OK;
+    });
+}
+
+ripc_status ripc_save_simulation(ripc_simulation* sim, const char* filename)
+{
+    ripc_status status = check_loaded(sim);
+    if (status != RIPC_OK) {
+        return status;
+    }
+    if (filename == nullptr) {
+        return fail(RIPC_ERROR_INVALID_ARGUMENT, "null filename");
+    }
+    return guard([&] {
+        return sim->state.save_simulation(filename)
+            ? RIPC_OK
+            : fail(
+                RIPC_ERROR_SAVE_FAILED,
+                std::string("unable to save simulation ") + filename);
+    });
+}
+
+int ripc_dim(const ripc_simulation* sim)
+{
+    return sim && sim->problem ? sim->problem->dim() : 0;
+}
+
+int ripc_num_bodies(const ripc_simulation* sim)
+{
+    return sim && sim->problem ? sim->problem->num_bodies() : 0;
+}
+
+int ripc_pose_size(const ripc_simulation* sim)
+{
+    return sim && sim->problem ? PoseD::dim_to_ndof(sim->problem->dim()) : 0;
+}
+
+ripc_status ripc_get_timestep(const ripc_simulation* sim, double* timestep)
+{
+    ripc_status status = check_loaded(sim);
+    if (status == RIPC_OK && timestep != nullptr) {
+        *timestep = sim->problem->timestep();
+    }
+    return status;
+}
+
+ripc_status ripc_set_timestep(ripc_simulation* sim, double timestep)
+{
+    ripc_status status = check_loaded(sim);
+    if (status != RIPC_OK) {
+        return status;
+    }
+    if (!(timestep > 0)) {
+        return fail(RIPC_ERROR_INVALID_ARGUMENT, "timestep must be positive");
+    }
+    sim->problem->timestep(timestep);
+    return RIPC_OK;
+}
+
+ripc_status ripc_set_num_threads(ripc_simulation* sim, int num_threads)
+{
+    if (sim == nullptr) {
+        return fail(RIPC_ERROR_INVALID_HANDLE, "null simulation handle");
+    }
+    return guard([&] {
+        sim->state.set_num_threads(num_threads);
+        return RIPC_OK;
+    });
+}
+
+ripc_status ripc_get_poses(const ripc_simulation* sim, double* poses, int size)
+{
+    return get_packed(sim, &RigidBody::pose, poses, size);
+}
+
+ripc_status
+ripc_get_velocities(const ripc_simulation* sim, double* velocities, int size)
+{
+    return get_packed(sim, &RigidBody::velocity, velocities, size);
+}
+
+ripc_status ripc_get_body_pose(
+    const ripc_simulation* sim, int body, double* position, double* rotation)
+{
+    ripc_status status = check_body(sim, body);
+    if (status == RIPC_OK) {
+        get_pose(sim->problem->m_assembler[body].pose, position, rotation);
+    }
+    return status;
+}
+
+ripc_status ripc_set_body_pose(
+    ripc_simulation* sim,
+    int body,
+    const double* position,
+    const double* rotation)
+{
+    ripc_status status = check_body(sim, body);
+    if (status == RIPC_OK) {
+        RigidBody& rb = sim->problem->m_assembler[body];
+        set_pose(rb.pose, position, rotation);
+        update_body(rb);
+    }
+    return status;
+}
+
+ripc_status ripc_get_body_velocity(
+    const ripc_simulation* sim,
+    int body,
+    double* linear_velocity,
+    double* angular_velocity)
+{
+    ripc_status status = check_body(sim, body);
+    if (status == RIPC_OK) {
+        get_pose(
+            sim->problem->m_assembler[body].velocity, linear_velocity,
+            angular_velocity);
+    }
+    return status;
+}
+
+ripc_status ripc_set_body_velocity(
+    ripc_simulation* sim,
+    int body,
+    const double* linear_velocity,
+    const double* angular_velocity)
+{
+    ripc_status status = check_body(sim, body);
+    if (status == RIPC_OK) {
+        RigidBody& rb = sim->problem->m_assembler[body];
+        set_pose(rb.velocity, linear_velocity, angular_velocity);
+        update_body(rb);
+    }
+    return status;
+}
+
+ripc_status ripc_step(ripc_simulation* sim, int num_steps)
+{
+    ripc_status status = check_loaded(sim);
+    if (status != RIPC_OK) {
+        return status;
+    }
+    return guard([&] {
+        for (int i = 0; i < num_steps; i++) {
+            sim->state.simulation_step();
+        }
+        return RIPC_OK;
+    });
+}
+
+ripc_status ripc_step_and_record(ripc_simulation* sim)
+{
+    ripc_status status = check_loaded(sim);
+    if (status != RIPC_OK) {
+        return status;
+    }
+    return guard([&] {
+        sim->state.simulation_step();
+        sim->state.save_simulation_step();
+        return RIPC_OK;
+    });
+}
+
+ripc_status ripc_get_step_stats(
+    const ripc_simulation* sim, ripc_step_stats* stats)
+{
+    ripc_status status = check_loaded(sim);
+    if (status != RIPC_OK) {
+        return status;
+    }
+    if (stats == nullptr) {
+        return fail(RIPC_ERROR_INVALID_ARGUMENT, "null stats");
+    }
+    stats->num_steps = sim->state.m_num_simulation_steps;
+    stats->num_substeps = sim->state.step_num_substeps();
+    stats->solver_iterations = sim->state.step_solver_iterations();
+    stats->num_contacts = sim->problem->num_contacts();
+    stats->had_collision = sim->state.m_step_had_collision;
+    stats->has_intersections = sim->state.m_step_has_intersections;
+    stats->step_time = sim->state.step_time();
+    return RIPC_OK;
+}
+
+} // extern "C"
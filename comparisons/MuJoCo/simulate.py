@@ -0,0 +1,87 @@
+# Script to run an MJCF scene (converted with json_to_mjcf) headless in MuJoCo
+# and save the mesh geometries of every frame as OBJ files
+
+import argparse
+import pathlib
+
+import numpy
+import tqdm
+import mujoco
+
+
+def save_mesh(model, data, out_path, index):
+    Vs = []
+    Fs = []
+    offset = 0
+
+    for geom_id in range(model.ngeom):
+        if model.geom_type[geom_id] != mujoco.mjtGeom.mjGEOM_MESH:
+            continue
+        mesh_id = model.geom_dataid[geom_id]
+        vert_start = model.mesh_vertadr[mesh_id]
+        face_start = model.mesh_faceadr[mesh_id]
+        V = model.mesh_vert[
+            vert_start:vert_start + model.mesh_vertnum[mesh_id]]
+        F = model.mesh_face[
+            face_start:face_start + model.mesh_facenum[mesh_id]].copy()
+
+        R = data.geom_xmat[geom_id].reshape(3, 3)
+        V = V @ R.T + data.geom_xpos[geom_id]
+
+        F += offset
+        offset += V.shape[0]
+
+        Vs.append(V)
+        Fs.append(F)
+
+    with open(out_path / f"m_{index:04d}.obj", "w") as f:
+        for v in numpy.concatenate(Vs):
+            f.write("v {:.17g} {:.17g} {:.17g}\n".format(*v))
+        for face in numpy.concatenate(Fs):
+            f.write("f {:d} {:d} {:d}\n".format(*(face + 1)))
+
+
+def run_simulation(mjcf_path, out_path, timestep, max_time, frame_time=1e-2):
+    model = mujoco.MjModel.from_xml_path(str(mjcf_path))
+    if timestep is not None:
+        model.opt.timestep = timestep
+    data = mujoco.MjData(model)
+    mujoco.mj_forward(model, data)
+
+    max_steps = int(numpy.ceil(max_time / model.opt.timestep))
+    skip_frames = max(int(round(frame_time / model.opt.timestep)), 1)
+
+    index = 0
+    save_mesh(model, data, out_path, index)
+    for i in tqdm.tqdm(range(1, max_steps + 1)):
+        mujoco.mj_step(model, data)
+        if i % skip_frames == 0:
+            index += 1
+            save_mesh(model, data, out_path, index)
+
+
+def parse_args():
+    parser = argparse.ArgumentParser(
+        description="Run an MJCF scene headless in MuJoCo")
+    parser.add_argument(
+        "-i", "--input", metavar="path/to/input_mjc.xml", type=pathlib.Path,
+        dest="input", required=True, help="path to input MJCF")
+    parser.add_argument(
+        "-o", "--output", metavar="path/to/output", type=pathlib.Path,
+        dest="output", required=True, help="directory for the OBJ frames")
+    parser.add_argument(
+        "--dt", "--timestep", type=float, default=None, dest="timestep",
+        help="timestep (the MJCF's if not given)")
+    parser.add_argument(
+        "--max-time", type=float, default=5, help="simulated time")
+    return parser.parse_args()
+
+
+def main():
+    args = parse_args()
+    args.output.mkdir(exist_ok=True, parents=True)
+    run_simulation(args.input, args.output, args.timestep, args.max_time)
+
+
+if __name__ == "__main__":
+    main()
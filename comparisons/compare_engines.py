@@ -0,0 +1,436 @@
+# Script to run the same fixtures in Rigid IPC and the comparison engines
+# under one thread budget and report the results in a common schema
+
+import sys
+import os
+import csv
+import json
+import shutil
+import pathlib
+import argparse
+import subprocess
+import threading
+import time
+import importlib.util
+import math
+
+sys.path.append(str(pathlib.Path(__file__).resolve().parents[1] / "tools"))  # noqa
+from benchmark import get_git_hash, get_machine_info, get_time_stamp  # noqa
+
+comparisons_dir = pathlib.Path(__file__).resolve().parent
+root_dir = comparisons_dir.parent
+fixtures_dir = root_dir / "fixtures"
+meshes_dir = root_dir / "meshes"
+
+columns = [
+    "scene", "engine", "dim", "status", "wall_time", "num_steps",
+    "steps_per_second", "peak_memory", "num_frames",
+    "num_intersecting_frames", "first_intersecting_frame",
+    "intersection_free", "num_threads", "machine", "git_hash"]
+
+
+def find_build_file(*names):
+    for build_dir in (pathlib.Path("."), root_dir / "build"):
+        for sub_dir in "", "release", "debug":
+            for name in names:
+                path = build_dir / sub_dir / name
+                if path.is_file():
+                    return path.resolve()
+    return None
+
+
+def has_module(name):
+    return importlib.util.find_spec(name) is not None
+
+
+def fixture_num_steps(fixture):
+    return int(math.ceil(
+        fixture.get("max_time", 5) / fixture.get("timestep", 1e-2)))
+
+
+def find_obj_frames(out_dir):
+    """Directory of the first OBJ frame written by a driver."""
+    first_frames = sorted(out_dir.glob("**/m_0000.obj"))
+    return first_frames[0].parent if first_frames else None
+
+
+class Engine:
+    """Driver of a simulator run in its own process."""
+    name = ""
+    dims = (3,)
+
+    def missing(self, args):
+        """Reason the engine cannot run (None if it can)."""
+        return None
+
+    def convert(self, fixture_path, fixture, convert_dir, args):
+        """Convert the fixture to the engine's input (once per fixture)."""
+        return fixture_path
+
+    def command(self, engine_input, fixture, out_dir, args):
+        raise NotImplementedError()
+
+    def frames(self, out_dir):
+        """Simulation results or directory of OBJ frames to check."""
+        return find_obj_frames(out_dir)
+
+    def num_steps(self, fixture, out_dir):
+        return fixture_num_steps(fixture)
+
+
+class RigidIPC(Engine):
+    name = "rigid_ipc"
+    dims = (2, 3)
+
+    def missing(self, args):
+        return None if args.rigid_exe else "rigid_ipc_sim not found"
+
+    def command(self, engine_input, fixture, out_dir, args):
+        return [str(args.rigid_exe), "--ngui", str(engine_input),
+                str(out_dir), "--loglevel", str(args.loglevel),
+                "--nthreads", str(args.num_threads)]
+
+    def frames(self, out_dir):
+        return out_dir / "sim.json"
+
+    def num_steps(self, fixture, out_dir):
+        with open(out_dir / "sim.json") as sim:
+            return len(json.load(sim)["stats"]["step_timings"])
+
+
+class Box2D(Engine):
+    name = "box2d"
+    dims = (2,)
+
+    def missing(self, args):
+        return None if args.box2d_exe else "Box2D_comparison not found"
+
+    def command(self, engine_input, fixture, out_dir, args):
+        return [str(args.box2d_exe), str(engine_input), str(out_dir)]
+
+    def frames(self, out_dir):
+        return out_dir / "sim.json"
+
+
+class Bullet(Engine):
+    name = "bullet"
+
+    def missing(self, args):
+        return None if has_module("pybullet") else "pybullet not installed"
+
+    def command(self, engine_input, fixture, out_dir, args):
+        # Writes the frames to output/ in the working directory
+        return [sys.executable, str(comparisons_dir / "Bullet" / "benchmark.py"),
+                "-i", str(engine_input), "--no-video"]
+
+
+class Chrono(Engine):
+    name = "chrono"
+
+    def missing(self, args):
+        return None if has_module("pychrono") else "pychrono not installed"
+
+    def command(self, engine_input, fixture, out_dir, args):
+        # Writes the frames to output/ in the working directory
+        return ([sys.executable, str(comparisons_dir / "Chrono" / "compare.py"),
+                 "-i", str(engine_input), "--no-video"]
+                + (["--chrono-data", args.chrono_data]
+                   if args.chrono_data else []))
+
+
+class MuJoCo(Engine):
+    name = "mujoco"
+
+    def missing(self, args):
+        if not has_module("mujoco"):
+            return "mujoco not installed"
+        if not has_module("igl"):
+            return "igl not installed"
+        return None if args.json_to_mjcf else "json_to_mjcf not found"
+
+    def convert(self, fixture_path, fixture, convert_dir, args):
+        import igl
+        mjcf = convert_dir / f"{fixture_path.stem}_mjc.xml"
+        if mjcf.exists() and not args.reconvert:
+            return mjcf
+        # The MJCF is written next to the fixture and references STL meshes
+        fixture_copy = convert_dir / fixture_path.name
+        shutil.copyfile(fixture_path, fixture_copy)
+        subprocess.run([str(args.json_to_mjcf), str(fixture_copy), "1"],
+                       check=True)
+        for body in fixture["rigid_body_problem"]["rigid_bodies"]:
+            stl = (convert_dir / body["mesh"]).with_suffix(".stl")
+            if not stl.exists():
+                stl.parent.mkdir(parents=True, exist_ok=True)
+                V, F = igl.read_triangle_mesh(str(meshes_dir / body["mesh"]))
+                igl.write_triangle_mesh(str(stl), V, F)
+        return mjcf
+
+    def command(self, engine_input, fixture, out_dir, args):
+        return [sys.executable, str(comparisons_dir / "MuJoCo" / "simulate.py"),
+                "-i", str(engine_input), "-o", str(out_dir / "frames"),
+                "--dt", str(fixture.get("timestep", 1e-2)),
+                "--max-time", str(fixture.get("max_time", 5))]
+
+
+class IPC(Engine):
+    name = "ipc"
+
+    def missing(self, args):
+        if not has_module("pymesh"):
+            return "pymesh not installed"
+        return None if args.ipc_exe else "IPC executable not given"
+
+    def convert(self, fixture_path, fixture, convert_dir, args):
+        # Same location as fixture_to_ipc_script.py
+        try:
+            script = (comparisons_dir / "IPC" / "scripts"
+                      / fixture_path.relative_to(fixtures_dir)
+                      ).with_suffix(".txt")
+        except ValueError:
+            script = fixture_path.with_suffix(".txt")
+        if not script.exists() or args.reconvert:
+            subprocess.run(
+                [sys.executable,
+                 str(comparisons_dir / "IPC" / "fixture_to_ipc_script.py"),
+                 "-i", str(fixture_path)], check=True)
+        return script
+
+    def command(self, engine_input, fixture, out_dir, args):
+        return [str(args.ipc_exe), "100", str(engine_input),
+                "-o", str(out_dir / "frames"), "--logLevel",
+                str(args.loglevel)]
+
+    def frames(self, out_dir):
+        return out_dir / "frames"
+
+
+engines = {engine.name: engine for engine in (
+    RigidIPC(), Box2D(), Bullet(), Chrono(), MuJoCo(), IPC())}
+
+
+def restrict_threads(num_threads):
+    """Environment and CPU affinity giving a process num_threads threads."""
+    env = dict(os.environ)
+    for var in ("OMP_NUM_THREADS", "MKL_NUM_THREADS", "OPENBLAS_NUM_THREADS",
+                "TBB_NUM_THREADS"):
+        env[var] = str(num_threads)
+
+    def preexec():
+        # TBB and OpenMP size their pools from the affinity mask
+        if hasattr(os, "sched_setaffinity"):
+            cpus = sorted(os.sched_getaffinity(0))[:num_threads]
+            os.sched_setaffinity(0, cpus)
+    return env, preexec
+
+
+def run_measured(command, cwd, log_path, num_threads, timeout):
+    """Run a command and measure its wall time and peak memory (in MB)."""
+    env, preexec = restrict_threads(num_threads)
+    with open(log_path, "w") as log:
+        start = time.perf_counter()
+        process = subprocess.Popen(
+            command, cwd=cwd, env=env, stdout=log, stderr=subprocess.STDOUT,
+            preexec_fn=preexec if os.name == "posix" else None)
+        timer = threading.Timer(timeout, process.kill) if timeout else None
+        if timer is not None:
+            timer.start()
+        if hasattr(os, "wait4"):
+            _, status, usage = os.wait4(process.pid, 0)
+            exit_code = (os.WEXITSTATUS(status) if os.WIFEXITED(status)
+                         else -os.WTERMSIG(status))
+            process.returncode = exit_code
+            # ru_maxrss is in bytes on macOS and in KB elsewhere
+            peak_memory = usage.ru_maxrss / (
+                1024**2 if sys.platform == "darwin" else 1024)
+        else:
+            exit_code = process.wait()
+            peak_memory = None
+        wall_time = time.perf_counter() - start
+        timed_out = timer is not None and not timer.is_alive()
+        if timer is not None:
+            timer.cancel()
+    return exit_code, wall_time, peak_memory, timed_out
+
+
+def check_intersections(frames, out_dir, args):
+    """Report of tools/check_intersections on the frames."""
+    if args.check_intersections is None or frames is None:
+        return None
+    report_path = out_dir / "intersections.json"
+    r = subprocess.run([str(args.check_intersections), str(frames),
+                        str(report_path)])
+    if r.returncode != 0 or not report_path.exists():
+        return None
+    with open(report_path) as report:
+        return json.load(report)
+
+
+def run_engine(engine, scene, fixture_path, fixture, args, machine, git_hash):
+    dim = fixture.get("rigid_body_problem", {}).get("dim", None)
+    if dim is None:
+        dim = 2 if "2D" in fixture_path.parts else 3
+    row = {column: None for column in columns}
+    row.update({
+        "scene": scene, "engine": engine.name, "dim": dim,
+        "num_threads": args.num_threads, "machine": machine,
+        "git_hash": git_hash})
+
+    if dim not in engine.dims:
+        row["status"] = "unsupported"
+        return row
+    missing = engine.missing(args)
+    if missing is not None:
+        row["status"] = f"missing ({missing})"
+        return row
+
+    out_dir = (args.work_dir / "output" / engine.name / scene).resolve()
+    if out_dir.exists():
+        shutil.rmtree(out_dir)
+    out_dir.mkdir(parents=True)
+    convert_dir = (args.work_dir / "converted" / engine.name / scene).resolve()
+    convert_dir.mkdir(parents=True, exist_ok=True)
+    try:
+        engine_input = engine.convert(fixture_path, fixture, convert_dir, args)
+    except (subprocess.CalledProcessError, OSError) as err:
+        row["status"] = f"conversion failed ({err})"
+        return row
+
+    print(f"Running {scene} in {engine.name}")
+    exit_code, wall_time, peak_memory, timed_out = run_measured(
+        engine.command(engine_input, fixture, out_dir, args), out_dir,
+        out_dir / "log.txt", args.num_threads, args.timeout)
+    row["wall_time"] = wall_time
+    row["peak_memory"] = peak_memory
+    if timed_out:
+        row["status"] = "timeout"
+        return row
+    if exit_code != 0:
+        row["status"] = f"failed (exit code {exit_code})"
+        return row
+    row["status"] = "ok"
+
+    try:
+        row["num_steps"] = engine.num_steps(fixture, out_dir)
+        row["steps_per_second"] = (
+            row["num_steps"] / wall_time if wall_time > 0 else None)
+    except (OSError, KeyError, ValueError):
+        pass
+
+    report = check_intersections(engine.frames(out_dir), out_dir, args)
+    if report is not None:
+        intersecting_frames = report["intersecting_frames"]
+        row["num_frames"] = report["num_frames"]
+        row["num_intersecting_frames"] = len(intersecting_frames)
+        row["first_intersecting_frame"] = (
+            intersecting_frames[0] if intersecting_frames else None)
+        row["intersection_free"] = report["is_intersection_free"]
+    return row
+
+
+def create_parser():
+    parser = argparse.ArgumentParser(
+        description=("Run the fixtures in every engine under the same thread "
+                     "budget and save the results in a common schema."))
+    parser.add_argument(
+        "-i", "--input", metavar="path/to/input", type=pathlib.Path,
+        dest="input", default=None, help="path to input json(s)", nargs="+")
+    parser.add_argument(
+        "-o", "--output", metavar="path/to/output.csv", type=pathlib.Path,
+        default=pathlib.Path("compare-engines.csv"),
+        help="path to output CSV (a JSON with the same rows is saved too)")
+    parser.add_argument(
+        "--engines", nargs="+", choices=list(engines), default=list(engines),
+        help="engines to run")
+    parser.add_argument(
+        "--num-threads", "--nthreads", type=int, default=16,
+        help="threads (and CPUs) available to every engine")
+    parser.add_argument(
+        "--timeout", type=float, default=None,
+        help="seconds before a run is stopped")
+    parser.add_argument(
+        "--work-dir", type=pathlib.Path, default=pathlib.Path("."),
+        help="directory for the converted inputs and the outputs")
+    parser.add_argument(
+        "--reconvert", action="store_true", default=False,
+        help="convert the fixtures even if converted before")
+    parser.add_argument(
+        "--rigid-exe", type=pathlib.Path,
+        default=find_build_file("rigid_ipc_sim"),
+        help="path to rigid_ipc_sim")
+    parser.add_argument(
+        "--box2d-exe", type=pathlib.Path,
+        default=find_build_file(
+            "Box2D_comparison", "comparisons/Box2D/Box2D_comparison"),
+        help="path to Box2D_comparison")
+    parser.add_argument(
+        "--ipc-exe", type=pathlib.Path, default=None,
+        help="path to the IPC executable")
+    parser.add_argument(
+        "--json-to-mjcf", type=pathlib.Path,
+        default=find_build_file("tools/json_to_mjcf"),
+        help="path to json_to_mjcf")
+    parser.add_argument(
+        "--check-intersections", type=pathlib.Path,
+        default=find_build_file("tools/check_intersections"),
+        help="path to check_intersections")
+    parser.add_argument(
+        "--chrono-data", default=None, help="path to the Chrono data")
+    parser.add_argument(
+        "--loglevel", default=3, type=int, choices=range(7),
+        help="set log level 0=trace, 1=debug, 2=info, 3=warn, 4=error, 5=critical, 6=off")
+    return parser
+
+
+def parse_arguments():
+    parser = create_parser()
+    args = parser.parse_args()
+    if args.input is None:
+        args.input = [fixtures_dir / "3D" / "simple"]
+    input_jsons = []
+    for input_file in args.input:
+        if input_file.is_file() and input_file.suffix == ".json":
+            input_jsons.append(input_file.resolve())
+        elif input_file.is_dir():
+            input_jsons.extend(sorted(input_file.resolve().glob('**/*.json')))
+    args.input = input_jsons
+    if args.check_intersections is None:
+        print("Unable to find check_intersections! "
+              "Intersections will not be checked")
+    return args
+
+
+def main():
+    args = parse_arguments()
+    machine = get_machine_info()
+    git_hash = get_git_hash()
+
+    rows = []
+    for fixture_path in args.input:
+        try:
+            scene = fixture_path.relative_to(fixtures_dir).with_suffix("")
+        except ValueError:
+            scene = pathlib.Path(fixture_path.stem)
+        with open(fixture_path) as f:
+            fixture = json.load(f)
+
+        for name in args.engines:
+            rows.append(run_engine(
+                engines[name], str(scene), fixture_path, fixture, args,
+                machine, git_hash))
+            print(", ".join(f"{key}={rows[-1][key]}" for key in (
+                "engine", "status", "wall_time", "intersection_free")))
+
+            # Save after every run so a crash keeps the finished ones
+            with open(args.output, "w", newline="") as output:
+                writer = csv.DictWriter(output, fieldnames=columns)
+                writer.writeheader()
+                writer.writerows(rows)
+            with open(args.output.with_suffix(".json"), "w") as output:
+                json.dump({"time_stamp": get_time_stamp(), "results": rows},
+                          output, indent=4)
+    print(f"Results written to {args.output}")
+
+
+if __name__ == "__main__":
+    main()
@@ -30,3 +30,25 @@ sim.run(str(output_path / "sim.json"))
 
 for body in sim.bodies():
     print(f"{body.name}: pose={body.pose}, group_id={body.group_id}, type={body.type}")
+
+# Zero-copy views of the body state (writable between steps)
+positions = sim.bodies().positions
+print(f"positions=\n{positions}")
+poses = numpy.empty((len(sim.bodies()), 6))
+sim.bodies().get_poses(out=poses)
+print(f"mean step time={sim.step_timings.mean():g}s")
+
+# Take a batch of steps natively, observing the poses after each one
+sim.step(10, lambda step, positions, rotations: print(
+    f"step={step} mean_height={positions[:, 1].mean():g}"))
+
+# Build a scene in code from instances of one mesh (no JSON scene file)
+cube = rigidipc.RigidBody("cube.obj")
+positions = numpy.array([[0, 1.1 * i, 0] for i in range(10)], dtype=float)
+cubes = cube.instances(positions, numpy.zeros((10, 3)))
+settings = rigidipc.SimSettings()
+settings.gravity = numpy.array([0, -9.8, 0])
+stack = rigidipc.Simulation()
+stack.init(cubes, settings)
+stack.step(10)
+print(f"top cube height={stack.bodies().positions[-1, 1]:g}")
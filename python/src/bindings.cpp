@@ -5,17 +5,25 @@
 #include <pybind11/stl.h>
 #include <pybind11/iostream.h>
 #include <pybind11/operators.h>
+#include <pybind11/numpy.h>
 // clang-format on
 
 #include <boost/filesystem.hpp>
 #include <tbb/global_control.h>
 #include <tbb/task_scheduler_init.h>
+#include <optional>
 #include <thread>
 
+#include <BatchSimState.hpp>
 #include <SimState.hpp>
+#include <physics/kinematic_source.hpp>
 #include <physics/rigid_body.hpp>
 #include <physics/rigid_body_problem.hpp>
+#include <physics/scene_queries.hpp>
+#include <problems/distance_barrier_rb_problem.hpp>
 #include <io/read_rb_scene.hpp>
+#include <utils/memory_usage.hpp>
+#include <utils/step_metrics.hpp>
 #include <logger.hpp>
 #include <profiler.hpp>
 
@@ -23,9 +31,61 @@ namespace py = pybind11;
 using namespace ipc;
 using namespace ipc::rigid;
 
-// static tbb::global_control thread_limiter = tbb::global_control(
-//     tbb::global_control::max_allowed_parallelism,
-//     tbb::task_scheduler_init::default_num_threads());
+namespace {
+/// @brief Zero-copy (n × size) view of a vector member of every body.
+///
+/// The bodies are stored contiguously, so the rows are strided by the size
+/// of a RigidBody. The view is writable and stays valid as long as the
+/// owner (which keeps the bodies alive) and the bodies are not rebuilt.
+template <typename Field>
+py::array
+body_field_view(RigidBodyAssembler& bodies, Field field, py::handle owner)
+{
+    if (bodies.num_bodies() == 0) {
+        return py::array_t<double>(std::vector<py::ssize_t> { 0, 0 });
+    }
+    VectorMax3d& first = field(bodies[0]);
+    assert(
+        reinterpret_cast<char*>(field(bodies[bodies.num_bodies() - 1]).data())
+            - reinterpret_cast<char*>(first.data())
+        == (bodies.num_bodies() - 1) * sizeof(RigidBody));
+    return py::array_t<double>(
+        { py::ssize_t(bodies.num_bodies()), py::ssize_t(first.size()) },
+        { py::ssize_t(sizeof(RigidBody)), py::ssize_t(sizeof(double)) },
+        first.data(), owner);
+}
+
+/// @brief Copy of a per-step statistic.
+///
+/// The statistics grow (and reallocate) every step, so a view could dangle.
+template <typename T> py::array_t<T> step_stat(const std::vector<T>& values)
+{
+    py::array_t<T> array(values.size());
+    std::copy(values.begin(), values.end(), array.mutable_data());
+    array.attr("flags").attr("writeable") = false;
+    return array;
+}
+
+/// @brief Copy of the ith of the num_metrics values of every step.
+template <typename T>
+py::array_t<T>
+step_metric(const std::vector<T>& values, int num_metrics, int i)
+{
+    const size_t num_steps = values.size() / num_metrics;
+    py::array_t<T> array(num_steps);
+    for (size_t step = 0; step < num_steps; step++) {
+        array.mutable_at(step) = values[step * num_metrics + i];
+    }
+    array.attr("flags").attr("writeable") = false;
+    return array;
+}
+
+/// @brief Python object of a JSON value (through the json module).
+py::object json_to_python(const nlohmann::json& json)
+{
+    return py::module::import("json").attr("loads")(json.dump());
+}
+} // namespace
 
 PYBIND11_MODULE(rigidipc, m)
 {
@@ -48,24 +108,27 @@ PYBIND11_MODULE(rigidipc, m)
         },
         "Set log level", py::arg("level"));
 
-    // m.def(
-    //     "set_num_threads",
-    //     [](int nthreads) {
-    //         if (nthreads <= 0) {
-    //             nthreads = tbb::task_scheduler_init::default_num_threads();
-    //         } else if (
-    //             nthreads > tbb::task_scheduler_init::default_num_threads()) {
-    //             spdlog::warn(
-    //                 "Attempting to use more threads than available ({:d} > "
-    //                 "{:d})!",
-    //                 nthreads,
-    //                 tbb::task_scheduler_init::default_num_threads());
-    //             nthreads = tbb::task_scheduler_init::default_num_threads();
-    //         }
-    //         thread_limiter = tbb::global_control(
-    //             tbb::global_control::max_allowed_parallelism, nthreads);
-    //     },
-    //     "maximum number of threads to use", py::arg("nthreads"));
+    m.def(
+        "set_num_threads",
+        [](int nthreads) {
+            const int max_threads =
+                tbb::task_scheduler_init::default_num_threads();
+            if (nthreads <= 0) {
+                nthreads = max_threads;
+            } else if (nthreads > max_threads) {
+                spdlog::warn(
+                    "Attempting to use more threads than available ({:d} > "
+                    "{:d})!",
+                    nthreads, max_threads);
+                nthreads = max_threads;
+            }
+            // Only the most recent control limits the parallelism
+            static std::unique_ptr<tbb::global_control> thread_limiter;
+            thread_limiter.reset();
+            thread_limiter = std::make_unique<tbb::global_control>(
+                tbb::global_control::max_allowed_parallelism, nthreads);
+        },
+        "maximum number of threads to use", py::arg("nthreads"));
 
     m.def(
         "set_profiler_output_directory",
@@ -73,6 +136,41 @@ PYBIND11_MODULE(rigidipc, m)
         "Set the output directory for the profiler (if enabled through CMake)",
         py::arg("out_dir"));
 
+    m.def(
+        "profiler_summary",
+        []() {
+            py::list summary;
+#ifdef RIGID_IPC_PROFILE_FUNCTIONS
+            const profiler::Profiler& profiler =
+                profiler::Profiler::instance();
+            std::vector<std::shared_ptr<profiler::ProfilerPoint>> points =
+                profiler.profile_points();
+            if (profiler.main_point() != nullptr) {
+                points.insert(points.begin(), profiler.main_point());
+            }
+            for (const auto& point : points) {
+                py::dict section;
+                section["name"] = point->name();
+                section["total_time"] = point->total_time();
+                section["num_calls"] = point->num_evaluations();
+                section["max_peak_rss_change"] = point->max_peak_rss_change();
+                summary.append(section);
+            }
+#endif
+            return summary;
+        },
+        "Total time (in seconds), calls and largest peak RSS change (in "
+        "bytes) of every profiled section, starting with the whole run "
+        "(empty unless the profiler is enabled through CMake)");
+
+    m.def(
+        "clear_profiler", []() { PROFILER_CLEAR(); },
+        "Reset the profiled sections (if enabled through CMake)");
+
+    m.def(
+        "memory_usage", []() { return json_to_python(MemoryUsage::to_json()); },
+        "Bytes used by the tracked data structures");
+
     py::class_<PoseD>(m, "Pose")
         .def(py::init<>())
         .def(
@@ -100,6 +198,85 @@ PYBIND11_MODULE(rigidipc, m)
             },
             py::return_value_policy::reference);
 
+    py::class_<KinematicSource, std::shared_ptr<KinematicSource>>(
+        m, "KinematicSource")
+        .def(
+            "pose",
+            [](const KinematicSource& self,
+               double t) -> std::optional<PoseD> {
+                PoseD pose;
+                if (!self.pose(t, pose)) {
+                    return std::nullopt;
+                }
+                return pose;
+            },
+            "Pose at time t (None once the motion is over)", py::arg("t"));
+
+    py::class_<
+        CallbackKinematicSource, KinematicSource,
+        std::shared_ptr<CallbackKinematicSource>>(
+        m, "CallbackKinematicSource")
+        .def(
+            py::init([](const py::function& callback) {
+                // The simulation runs without the GIL, so the callable is
+                // called and released with it
+                std::shared_ptr<py::function> f(
+                    new py::function(callback), [](py::function* f) {
+                        py::gil_scoped_acquire acquire;
+                        delete f;
+                    });
+                return std::make_shared<CallbackKinematicSource>(
+                    [f](double t, PoseD& pose) {
+                        py::gil_scoped_acquire acquire;
+                        py::object result = (*f)(t);
+                        if (result.is_none()) {
+                            return false;
+                        }
+                        pose = result.cast<PoseD>();
+                        return true;
+                    });
+            }),
+            "Poses computed on demand by callback(t) (None once the motion "
+            "is over)",
+            py::arg("callback"));
+
+    py::class_<
+        BinaryKinematicSource, KinematicSource,
+        std::shared_ptr<BinaryKinematicSource>>(m, "BinaryKinematicSource")
+        .def(
+            py::init([](const std::string& filename, int dim, double period) {
+                auto source = std::make_shared<BinaryKinematicSource>(
+                    filename, dim, period);
+                if (!source->is_open()) {
+                    throw py::value_error(
+                        fmt::format("unable to read {}", filename));
+                }
+                return source;
+            }),
+            "Poses sampled every period seconds streamed from a binary file",
+            py::arg("filename"), py::arg("dim"), py::arg("period"))
+        .def_property_readonly(
+            "num_samples", &BinaryKinematicSource::num_samples)
+        .def_static(
+            "write", &BinaryKinematicSource::write,
+            "Write poses sampled at a fixed period in the source's format",
+            py::arg("filename"), py::arg("poses"));
+
+    py::class_<
+        SplineKinematicSource, KinematicSource,
+        std::shared_ptr<SplineKinematicSource>>(m, "SplineKinematicSource")
+        .def(
+            py::init([](const std::vector<double>& times,
+                        const PosesD& poses) {
+                if (times.empty() || times.size() != poses.size()) {
+                    throw py::value_error(
+                        "expected as many times as poses (and at least one)");
+                }
+                return std::make_shared<SplineKinematicSource>(times, poses);
+            }),
+            "Poses interpolated by a cubic spline through key poses",
+            py::arg("times"), py::arg("poses"));
+
     py::enum_<RigidBodyType>(m, "RigidBodyType")
         .value("STATIC", RigidBodyType::STATIC)
         .value("KINEMATIC", RigidBodyType::KINEMATIC)
@@ -130,9 +307,175 @@ PYBIND11_MODULE(rigidipc, m)
         .def_readonly("edges", &RigidBody::edges)
         .def_readonly("faces", &RigidBody::faces)
         .def_readwrite("pose", &RigidBody::pose)
-        .def_readwrite("kinematic_poses", &RigidBody::kinematic_poses);
+        .def_readwrite("kinematic_poses", &RigidBody::kinematic_poses)
+        .def_property(
+            "kinematic_source",
+            [](const RigidBody& self) {
+                return std::const_pointer_cast<KinematicSource>(
+                    self.kinematic_source);
+            },
+            [](RigidBody& self,
+               const std::shared_ptr<KinematicSource>& source) {
+                self.kinematic_source = source;
+            },
+            "Streamed scripted motion used once kinematic_poses run out")
+        .def(
+            "instances",
+            [](const RigidBody& self, const Eigen::MatrixXd& positions,
+               const Eigen::MatrixXd& rotations) {
+                if (positions.cols() != self.pose.position.size()
+                    || rotations.cols() != self.pose.rotation.size()
+                    || rotations.rows() != positions.rows()) {
+                    throw py::value_error(fmt::format(
+                        "positions and rotations must have shapes (n, {:d}) "
+                        "and (n, {:d})",
+                        self.pose.position.size(), self.pose.rotation.size()));
+                }
+                // Copies share the geometry (BVH and mass properties)
+                std::vector<RigidBody> rbs(positions.rows(), self);
+                for (size_t i = 0; i < rbs.size(); i++) {
+                    rbs[i].pose = PoseD(
+                        positions.row(i).transpose(),
+                        rotations.row(i).transpose());
+                    rbs[i].pose_prev = rbs[i].pose;
+                }
+                return rbs;
+            },
+            "Copies of this body sharing its geometry, with the poses (of "
+            "the center of mass and principal frame) given as rows of the "
+            "(n × dim) positions and (n × angular dim) rotations",
+            py::arg("positions"), py::arg("rotations"));
 
     py::class_<RigidBodyAssembler>(m, "RigidBodyAssembler")
+        .def_property_readonly(
+            "positions",
+            [](py::object self) {
+                return body_field_view(
+                    self.cast<RigidBodyAssembler&>(),
+                    [](RigidBody& rb) -> VectorMax3d& {
+                        return rb.pose.position;
+                    },
+                    self);
+            },
+            "Writable view of the position of every body (n × dim)")
+        .def_property_readonly(
+            "rotations",
+            [](py::object self) {
+                return body_field_view(
+                    self.cast<RigidBodyAssembler&>(),
+                    [](RigidBody& rb) -> VectorMax3d& {
+                        return rb.pose.rotation;
+                    },
+                    self);
+            },
+            "Writable view of the rotation vector of every body (n × "
+            "angular dim)")
+        .def_property_readonly(
+            "linear_velocities",
+            [](py::object self) {
+                return body_field_view(
+                    self.cast<RigidBodyAssembler&>(),
+                    [](RigidBody& rb) -> VectorMax3d& {
+                        return rb.velocity.position;
+                    },
+                    self);
+            },
+            "Writable view of the linear velocity of every body (n × dim)")
+        .def_property_readonly(
+            "angular_velocities",
+            [](py::object self) {
+                return body_field_view(
+                    self.cast<RigidBodyAssembler&>(),
+                    [](RigidBody& rb) -> VectorMax3d& {
+                        return rb.velocity.rotation;
+                    },
+                    self);
+            },
+            "Writable view of the angular velocity of every body (n × "
+            "angular dim)")
+        .def(
+            "get_poses",
+            [](const RigidBodyAssembler& self, py::object out) {
+                const int ndof = PoseD::dim_to_ndof(self.dim());
+                if (!out.is_none()
+                    && !py::isinstance<py::array_t<double>>(out)) {
+                    throw py::type_error("out must be a float64 array");
+                }
+                py::array_t<double> poses = out.is_none()
+                    ? py::array_t<double>({ py::ssize_t(self.num_bodies()),
+                                            py::ssize_t(ndof) })
+                    : out.cast<py::array_t<double>>();
+                if (poses.ndim() != 2 || poses.shape(0) != self.num_bodies()
+                    || poses.shape(1) != ndof) {
+                    throw py::value_error(fmt::format(
+                        "out must have shape ({:d}, {:d})", self.num_bodies(),
+                        ndof));
+                }
+                auto dofs = poses.mutable_unchecked<2>();
+                const int pos_ndof = self.dim();
+                for (size_t i = 0; i < self.num_bodies(); i++) {
+                    const PoseD& pose = self[i].pose;
+                    for (int j = 0; j < pos_ndof; j++) {
+                        dofs(i, j) = pose.position(j);
+                    }
+                    for (int j = 0; j < ndof - pos_ndof; j++) {
+                        dofs(i, pos_ndof + j) = pose.rotation(j);
+                    }
+                }
+                return poses;
+            },
+            "Fill an (n × ndof) float64 array with the position and rotation "
+            "of every body (allocated if out is None)",
+            py::arg("out") = py::none())
+        .def(
+            "raycast",
+            [](const RigidBodyAssembler& self, const Eigen::MatrixXd& origins,
+               const Eigen::MatrixXd& directions, double max_distance) {
+                RayHits hits;
+                {
+                    py::gil_scoped_release release;
+                    hits = raycast(
+                        self, self.rb_poses_t1(), origins, directions,
+                        max_distance);
+                }
+                return py::make_tuple(
+                    hits.distances, hits.body_ids, hits.primitive_ids,
+                    hits.normals);
+            },
+            "Cast (n × dim) rays against the bodies at their current poses, "
+            "returning the distances, body ids, face (3D) or edge (2D) ids, "
+            "and normals of the first hits (inf/-1/0 for misses)",
+            py::arg("origins"), py::arg("directions"),
+            py::arg("max_distance") = std::numeric_limits<double>::infinity())
+        .def(
+            "closest_points",
+            [](const RigidBodyAssembler& self, const Eigen::MatrixXd& points,
+               double max_distance) {
+                ClosestPoints closest;
+                {
+                    py::gil_scoped_release release;
+                    closest = closest_points(
+                        self, self.rb_poses_t1(), points, max_distance);
+                }
+                return py::make_tuple(
+                    closest.distances, closest.body_ids, closest.points);
+            },
+            "Find the closest points on the bodies at their current poses to "
+            "(n × dim) points, returning the distances, body ids, and points "
+            "(inf/-1 if none is within max_distance)",
+            py::arg("points"),
+            py::arg("max_distance") = std::numeric_limits<double>::infinity())
+        .def(
+            "overlapping_bodies",
+            [](const RigidBodyAssembler& self, const Eigen::MatrixXd& box_min,
+               const Eigen::MatrixXd& box_max) {
+                py::gil_scoped_release release;
+                return overlapping_bodies(
+                    self, self.rb_poses_t1(), box_min, box_max);
+            },
+            "Find the sorted ids of the bodies at their current poses "
+            "overlapping each of (n × dim) boxes",
+            py::arg("box_min"), py::arg("box_max"))
         .def(
             "__getitem__",
             [](RigidBodyAssembler& self, size_t i) -> RigidBody& {
@@ -150,8 +493,52 @@ PYBIND11_MODULE(rigidipc, m)
             // Essential: keep object alive while iterator exists
             py::keep_alive<0, 1>(), py::return_value_policy::reference);
 
+    py::class_<SimSettings>(m, "SimSettings")
+        .def(py::init<>())
+        .def_readwrite("scene_type", &SimSettings::scene_type)
+        .def_readwrite("solver", &SimSettings::solver)
+        .def_readwrite("timestep", &SimSettings::timestep)
+        .def_readwrite("max_iterations", &SimSettings::max_iterations)
+        .def_readwrite("max_time", &SimSettings::max_time)
+        .def_readwrite("num_threads", &SimSettings::num_threads)
+        .def_readwrite("gravity", &SimSettings::gravity)
+        .def_readwrite(
+            "coefficient_friction", &SimSettings::coefficient_friction)
+        .def_readwrite(
+            "coefficient_restitution", &SimSettings::coefficient_restitution);
+
+    // The members are zero-copy views valid until the next step
+    py::class_<ContactForces>(m, "ContactForces")
+        .def("__len__", &ContactForces::size)
+        .def_readonly(
+            "body_ids", &ContactForces::body_ids,
+            "Indices in bodies() of the two bodies of each contact")
+        .def_readonly("points", &ContactForces::points)
+        .def_readonly(
+            "normals", &ContactForces::normals,
+            "Unit directions of the normal forces on the first bodies")
+        .def_readonly("normal_forces", &ContactForces::normal_forces)
+        .def_readonly(
+            "friction_forces", &ContactForces::friction_forces,
+            "Friction forces on the first bodies");
+
     py::class_<SimState>(m, "Simulation")
         .def(py::init<>())
+        .def(
+            "init",
+            [](SimState& self, std::vector<RigidBody> bodies,
+               const SimSettings& settings, const std::string& patch) {
+                nlohmann::json args = settings.to_json();
+                if (!patch.empty()) {
+                    args.merge_patch(nlohmann::json::parse(patch));
+                }
+                return self.init(args, std::move(bodies));
+            },
+            "Initialize a scene from bodies built in code (without a JSON "
+            "scene).\n"
+            "Optionally provide a JSON to patch the settings' args.",
+            py::arg("bodies"), py::arg("settings") = SimSettings(),
+            py::arg("patch") = "", py::call_guard<py::gil_scoped_release>())
         .def(
             "load_scene", &SimState::load_scene,
             "Load a simulation scene from a file (JSON).\n"
@@ -164,21 +551,133 @@ PYBIND11_MODULE(rigidipc, m)
                            sim.problem_ptr)
                     ->m_assembler;
             },
-            py::return_value_policy::reference)
-        .def("step", &SimState::simulation_step, "Take a single step")
+            // Keep the simulation alive while the bodies (or their views)
+            // exist
+            py::return_value_policy::reference_internal)
+        .def(
+            "contact_forces",
+            [](const SimState& sim) -> const ContactForces& {
+                const auto problem =
+                    std::dynamic_pointer_cast<DistanceBarrierRBProblem>(
+                        sim.problem_ptr);
+                if (problem == nullptr) {
+                    throw py::type_error(
+                        "contact forces require a distance barrier problem");
+                }
+                return problem->contact_forces();
+            },
+            "Contacts of the last step (empty unless the rigid_body_problem "
+            "setting record_contact_forces is true)",
+            py::return_value_policy::reference_internal)
+        .def(
+            "step",
+            [](py::object self, int num_steps, py::object callback) {
+                SimState& sim = self.cast<SimState&>();
+                if (callback.is_none()) {
+                    // Other Python threads run while the steps are taken
+                    py::gil_scoped_release release;
+                    for (int i = 0; i < num_steps; i++) {
+                        sim.simulation_step();
+                        sim.save_simulation_step();
+                    }
+                    return num_steps;
+                }
+
+                // The views alias the bodies, so they are created once
+                py::object bodies = self.attr("bodies")();
+                py::object positions = bodies.attr("positions");
+                py::object rotations = bodies.attr("rotations");
+                for (int i = 0; i < num_steps; i++) {
+                    {
+                        py::gil_scoped_release release;
+                        sim.simulation_step();
+                        sim.save_simulation_step();
+                    }
+                    py::object result = callback(
+                        sim.m_num_simulation_steps, positions, rotations);
+                    if (!result.is_none() && !result.cast<bool>()) {
+                        return i + 1; // The callback stopped the run
+                    }
+                }
+                return num_steps;
+            },
+            "Take and save num_steps steps with the GIL released.\n"
+            "If given, callback(step, positions, rotations) is called after "
+            "every step with zero-copy views of the body poses (that must "
+            "not be accessed by other threads while stepping). Returning "
+            "False from it stops stepping.\n"
+            "Returns the number of steps taken.",
+            py::arg("num_steps") = 1, py::arg("callback") = py::none())
         .def(
             "run", &SimState::run_simulation, "Run the entire simulation",
-            py::arg("fout"))
+            py::arg("fout"), py::call_guard<py::gil_scoped_release>())
         .def(
             "save_obj_sequence", &SimState::save_obj_sequence,
             "Save the simulation as a sequence of OBJ files",
             py::arg("dir_name"))
         .def(
-            "save_gltf", &SimState::save_gltf,
-            "Save the simulation as a GLTF animation file", py::arg("filename"))
+            "save_gltf",
+            [](SimState& self, const std::string& filename, double frame_rate,
+               bool instancing, bool quantize) {
+                GltfSettings settings;
+                settings.instance_shared_geometry = instancing;
+                settings.deduplicate_identical_geometry = instancing;
+                settings.quantize_vertices = quantize;
+                return self.save_gltf(filename, frame_rate, settings);
+            },
+            "Save the simulation as a GLTF animation file (sharing the "
+            "meshes of identical bodies if instancing)",
+            py::arg("filename"), py::arg("frame_rate") = -1,
+            py::arg("instancing") = true, py::arg("quantize") = false)
         .def(
             "save_simulation", &SimState::save_simulation,
             "Save the simulation as a JSON file", py::arg("filename"))
+        .def_property_readonly(
+            "step_timings",
+            [](const SimState& self) { return step_stat(self.step_timings); },
+            "Time in seconds of every step")
+        .def_property_readonly(
+            "solver_iterations",
+            [](const SimState& self) {
+                return step_stat(self.solver_iterations);
+            },
+            "Solver iterations of every step")
+        .def_property_readonly(
+            "num_contacts",
+            [](const SimState& self) { return step_stat(self.num_contacts); },
+            "Number of contacts of every step")
+        .def_property_readonly(
+            "step_minimum_distances",
+            [](const SimState& self) {
+                return step_stat(self.step_minimum_distances);
+            },
+            "Minimum distance between bodies at the end of every step")
+        .def_property_readonly(
+            "step_metrics",
+            [](const SimState& self) {
+                py::dict metrics;
+                for (int i = 0; i < StepMetrics::NUM_TIMERS; i++) {
+                    metrics[StepMetrics::name(StepMetrics::Timer(i))] =
+                        step_metric(
+                            self.step_metric_times, StepMetrics::NUM_TIMERS,
+                            i);
+                }
+                for (int i = 0; i < StepMetrics::NUM_COUNTERS; i++) {
+                    metrics[StepMetrics::name(StepMetrics::Counter(i))] =
+                        step_metric(
+                            self.step_metric_counts,
+                            StepMetrics::NUM_COUNTERS, i);
+                }
+                return metrics;
+            },
+            "Phase times (in seconds) and counters of every step taken since "
+            "the scene was loaded, by metric name")
+        .def_property_readonly(
+            "solver_stats",
+            [](const SimState& self) {
+                return json_to_python(self.problem_ptr->solver().stats());
+            },
+            "Statistics of the solver over all steps")
         .def_readwrite(
             "max_simulation_steps", &SimState::m_max_simulation_steps)
         .def_readwrite(
@@ -189,5 +688,68 @@ PYBIND11_MODULE(rigidipc, m)
             [](const SimState& self, double timestep) {
                 self.problem_ptr->timestep(timestep);
             },
-            "Time step size");
+            "Time step size")
+        .def_property(
+            "num_threads", &SimState::num_threads, &SimState::set_num_threads,
+            "Threads of the arena every parallel loop of this simulation "
+            "runs in (-1 uses the arena of the calling thread)");
+
+    py::class_<BatchSimState>(m, "BatchSimulation")
+        .def(py::init<>())
+        .def(
+            "load_scenes", &BatchSimState::load_scenes,
+            "Load independent simulation scenes (JSON) in parallel.\n"
+            "Optionally provide a JSON to patch every file.",
+            py::arg("filenames"), py::arg("patch") = "",
+            py::call_guard<py::gil_scoped_release>())
+        .def(
+            "step", &BatchSimState::step,
+            "Take num_steps steps of every scene concurrently (with the GIL "
+            "released)",
+            py::arg("num_steps") = 1, py::call_guard<py::gil_scoped_release>())
+        .def("__len__", &BatchSimState::num_scenes)
+        .def(
+            "__getitem__",
+            [](BatchSimState& self, size_t i) -> SimState& {
+                if (i >= self.num_scenes()) {
+                    throw py::index_error();
+                }
+                return self[i];
+            },
+            py::return_value_policy::reference_internal)
+        .def_property_readonly(
+            "body_offsets", &BatchSimState::body_offsets,
+            "Row of the first body of every scene in the stacked poses (and "
+            "the total number of bodies)")
+        .def(
+            "get_poses",
+            [](const BatchSimState& self, py::object out) {
+                const int ndof = PoseD::dim_to_ndof(self.dim());
+                if (!out.is_none()
+                    && !py::isinstance<py::array_t<double>>(out)) {
+                    throw py::type_error("out must be a float64 array");
+                }
+                py::array_t<double> poses = out.is_none()
+                    ? py::array_t<double>({ py::ssize_t(self.num_bodies()),
+                                            py::ssize_t(ndof) })
+                    : out.cast<py::array_t<double>>();
+                if (poses.ndim() != 2 || poses.shape(0) != self.num_bodies()
+                    || poses.shape(1) != ndof || !poses.writeable()) {
+                    throw py::value_error(fmt::format(
+                        "out must be a writable array of shape ({:d}, {:d})",
+                        self.num_bodies(), ndof));
+                }
+                // Fill the array in place, whatever its strides
+                typedef Eigen::Stride<Eigen::Dynamic, Eigen::Dynamic> Strides;
+                Eigen::Map<Eigen::MatrixXd, 0, Strides> dofs(
+                    poses.mutable_data(), poses.shape(0), poses.shape(1),
+                    Strides(
+                        poses.strides(1) / sizeof(double),
+                        poses.strides(0) / sizeof(double)));
+                self.poses(dofs);
+                return poses;
+            },
+            "Fill a (total bodies × ndof) float64 array with the stacked "
+            "poses of every scene (allocated if out is None)",
+            py::arg("out") = py::none());
 }
@@ -0,0 +1,138 @@
+#include "BatchSimState.hpp"
+
+#include <algorithm>
+#include <atomic>
+
+#include <tbb/parallel_for.h>
+#include <tbb/task_arena.h>
+
+#include <logger.hpp>
+#include <physics/rigid_body_problem.hpp>
+
+namespace ipc::rigid {
+
+namespace {
+    const RigidBodyAssembler& scene_bodies(const SimState& scene)
+    {
+        return std::dynamic_pointer_cast<RigidBodyProblem>(scene.problem_ptr)
+            ->m_assembler;
+    }
+} // namespace
+
+bool BatchSimState::load_scenes(
+    const std::vector<std::string>& filenames, const std::string& patch)
+{
+    return load(
+        filenames, std::vector<std::string>(filenames.size(), patch),
+        /*num_serial_loads=*/0);
+}
+
+bool BatchSimState::load_variants(
+    const std::string& filename, const std::vector<std::string>& patches)
+{
+    return load(
+        std::vector<std::string>(patches.size(), filename), patches,
+        /*num_serial_loads=*/1);
+}
+
+bool BatchSimState::load(
+    const std::vector<std::string>& filenames,
+    const std::vector<std::string>& patches,
+    size_t num_serial_loads)
+{
+    assert(filenames.size() == patches.size());
+    m_scenes.clear();
+    m_body_offsets.assign(1, 0);
+    m_scenes.resize(filenames.size());
+
+    std::atomic<bool> success(true);
+    const auto load_scene = [&](size_t i) {
+        m_scenes[i] = std::make_unique<SimState>();
+        if (!m_scenes[i]->load_scene(filenames[i], patches[i])
+            || !std::dynamic_pointer_cast<RigidBodyProblem>(
+                m_scenes[i]->problem_ptr)) {
+            spdlog::error(
+                "unable to load scene filename={} patch={}", filenames[i],
+                patches[i]);
+            success = false;
+        }
+    };
+    num_serial_loads = std::min(num_serial_loads, filenames.size());
+    for (size_t i = 0; i < num_serial_loads; i++) {
+        load_scene(i);
+    }
+    tbb::parallel_for(num_serial_loads, filenames.size(), load_scene);
+    if (!success) {
+        m_scenes.clear();
+        return false;
+    }
+
+    for (const auto& scene : m_scenes) {
+        const RigidBodyAssembler& bodies = scene_bodies(*scene);
+        if (bodies.dim() != scene_bodies(*m_scenes[0]).dim()) {
+            spdlog::error(
+                "scenes of a batch must have the same dimension dim={} "
+                "expected_dim={}",
+                bodies.dim(), scene_bodies(*m_scenes[0]).dim());
+            m_scenes.clear();
+            m_body_offsets.assign(1, 0);
+            return false;
+        }
+        m_body_offsets.push_back(m_body_offsets.back() + bodies.num_bodies());
+    }
+    return true;
+}
+
+void BatchSimState::step(int num_steps)
+{
+    tbb::parallel_for(size_t(0), m_scenes.size(), [&](size_t i) {
+        // A thread waiting on this scene's parallel loops must not start
+        // the step of another scene.
+        tbb::this_task_arena::isolate([&]() {
+            for (int j = 0; j < num_steps; j++) {
+                m_scenes[i]->simulation_step();
+            }
+        });
+    });
+}
+
+void BatchSimState::run_simulations(
+    const std::vector<std::string>& filenames)
+{
+    assert(filenames.size() == m_scenes.size());
+    tbb::parallel_for(size_t(0), m_scenes.size(), [&](size_t i) {
+        tbb::this_task_arena::isolate(
+            [&]() { m_scenes[i]->run_simulation(filenames[i]); });
+    });
+}
+
+int BatchSimState::dim() const
+{
+    return m_scenes.empty() ? 0 : scene_bodies(*m_scenes[0]).dim();
+}
+
+void BatchSimState::poses(PoseMatrixRef dofs) const
+{
+    assert(dofs.rows() == num_bodies());
+    assert(dofs.cols() == PoseD::dim_to_ndof(dim()));
+    const int pos_ndof = dim();
+    tbb::parallel_for(size_t(0), m_scenes.size(), [&](size_t i) {
+        const RigidBodyAssembler& bodies = scene_bodies(*m_scenes[i]);
+        for (size_t j = 0; j < bodies.num_bodies(); j++) {
+            const PoseD& pose = bodies[j].pose;
+            const size_t row = m_body_offsets[i] + j;
+            dofs.row(row).head(pos_ndof) = pose.position.transpose();
+            dofs.row(row).tail(dofs.cols() - pos_ndof) =
+                pose.rotation.transpose();
+        }
+    });
+}
+
+Eigen::MatrixXd BatchSimState::poses() const
+{
+    Eigen::MatrixXd dofs(num_bodies(), PoseD::dim_to_ndof(dim()));
+    poses(dofs);
+    return dofs;
+}
+
+} // namespace ipc::rigid
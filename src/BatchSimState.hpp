@@ -0,0 +1,75 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <Eigen/Core>
+
+#include "SimState.hpp"
+
+namespace ipc::rigid {
+
+/// @brief Independent simulations stepped concurrently.
+///
+/// All scenes share the process' TBB arena: every scene is a task whose own
+/// parallel loops are isolated, so the threads are never oversubscribed.
+/// The step metrics are process-wide, so they mix the scenes, but each
+/// scene keeps its own settings (e.g., whether it is deterministic).
+class BatchSimState {
+public:
+    /// @brief Writable matrix of any strides (e.g., a NumPy array).
+    typedef Eigen::Ref<
+        Eigen::MatrixXd,
+        0,
+        Eigen::Stride<Eigen::Dynamic, Eigen::Dynamic>>
+        PoseMatrixRef;
+
+    /// @brief Load the scenes (in parallel), applying the same patch to
+    /// each.
+    /// @returns False if any scene fails to load or the scenes' dimensions
+    /// differ.
+    bool load_scenes(
+        const std::vector<std::string>& filenames,
+        const std::string& patch = "");
+
+    /// @brief Load one scene per patch of the same scene file.
+    ///
+    /// The first variant is loaded alone, so the others reuse its meshes'
+    /// geometry (BVH and mass properties) instead of rebuilding it.
+    bool load_variants(
+        const std::string& filename, const std::vector<std::string>& patches);
+
+    /// @brief Take num_steps steps of every scene.
+    void step(int num_steps = 1);
+
+    /// @brief Run every scene to its end concurrently, saving scene i to
+    /// filenames[i].
+    void run_simulations(const std::vector<std::string>& filenames);
+
+    size_t num_scenes() const { return m_scenes.size(); }
+    SimState& operator[](size_t i) { return *m_scenes[i]; }
+    const SimState& operator[](size_t i) const { return *m_scenes[i]; }
+
+    int dim() const;
+    /// @brief Total number of bodies of all scenes.
+    size_t num_bodies() const { return m_body_offsets.back(); }
+    /// @brief Index of the first body of every scene in the stacked poses
+    /// (with the total number of bodies at the end).
+    const std::vector<size_t>& body_offsets() const { return m_body_offsets; }
+
+    /// @brief Stacked pose dof (one row per body) of every scene.
+    void poses(PoseMatrixRef dofs) const;
+    Eigen::MatrixXd poses() const;
+
+protected:
+    bool load(
+        const std::vector<std::string>& filenames,
+        const std::vector<std::string>& patches,
+        size_t num_serial_loads);
+
+    std::vector<std::unique_ptr<SimState>> m_scenes;
+    std::vector<size_t> m_body_offsets = { 0 };
+};
+
+} // namespace ipc::rigid
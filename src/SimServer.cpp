@@ -0,0 +1,313 @@
+#include "SimServer.hpp"
+
+#include <string>
+
+#ifndef _WIN32
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+#include <ghc/fs_std.hpp> // filesystem
+
+#include <io/read_json.hpp>
+#include <io/serialize_json.hpp>
+#include <logger.hpp>
+#include <physics/rigid_body_problem.hpp>
+
+namespace ipc::rigid {
+
+namespace {
+    nlohmann::json error_response(const std::string& message)
+    {
+        return { { "ok", false }, { "error", message } };
+    }
+} // namespace
+
+bool SimServer::handle(
+    const nlohmann::json& request, const ResponseWriter& respond)
+{
+    // Echo the request's id in all of its responses
+    const nlohmann::json id = request.value("id", nlohmann::json());
+    const ResponseWriter respond_with_id = [&](const nlohmann::json& r) {
+        nlohmann::json response = r;
+        if (!id.is_null()) {
+            response["id"] = id;
+        }
+        respond(response);
+    };
+
+    const std::string command = request.value("command", "");
+    RIGID_IPC_LOG_DEBUG("sim_server action=handle command={}", command);
+    try {
+        if (command == "quit") {
+            respond_with_id({ { "ok", true } });
+            return false;
+        } else if (command == "load") {
+            respond_with_id(load(request));
+        } else if (command == "patch") {
+            respond_with_id(patch(request));
+        } else if (m_sim == nullptr) {
+            respond_with_id(error_response("no scene is loaded"));
+        } else if (command == "step") {
+            step(request, respond_with_id);
+        } else if (command == "state") {
+            respond_with_id(
+                { { "ok", true }, { "state", m_sim->problem_ptr->state() } });
+        } else if (command == "save") {
+            const std::string filename = request.value("filename", "");
+            respond_with_id(
+                !filename.empty() && m_sim->save_simulation(filename)
+                    ? nlohmann::json { { "ok", true } }
+                    : error_response("unable to save the simulation"));
+        } else {
+            respond_with_id(
+                error_response(fmt::format("unknown command={}", command)));
+        }
+    } catch (const std::exception& e) {
+        // Bad requests (e.g., of the wrong types) must not stop the server
+        spdlog::error("sim_server command={} error={}", command, e.what());
+        respond_with_id(error_response(e.what()));
+    }
+    return true;
+}
+
+bool SimServer::handle_line(
+    const std::string& line, const ResponseWriter& respond)
+{
+    if (line.find_first_not_of(" \t\r") == std::string::npos) {
+        return true; // Skip empty lines
+    }
+    const nlohmann::json request = nlohmann::json::parse(line, nullptr, false);
+    if (!request.is_object()) {
+        respond(error_response("requests must be JSON objects"));
+        return true;
+    }
+    return handle(request, respond);
+}
+
+void SimServer::serve(std::istream& in, std::ostream& out)
+{
+    const ResponseWriter respond = [&](const nlohmann::json& response) {
+        out << response.dump() << std::endl;
+    };
+    std::string line;
+    while (std::getline(in, line) && handle_line(line, respond)) { }
+}
+
+bool SimServer::serve_socket(const std::string& path)
+{
+#ifndef _WIN32
+    sockaddr_un address = {};
+    address.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(address.sun_path)) {
+        spdlog::error("socket path is too long path={}", path);
+        return false;
+    }
+    path.copy(address.sun_path, path.size());
+
+    const int server = socket(AF_UNIX, SOCK_STREAM, 0);
+    unlink(path.c_str()); // Remove the socket of a previous server
+    if (server < 0
+        || bind(server, reinterpret_cast<sockaddr*>(&address), sizeof(address))
+            != 0
+        || listen(server, 1) != 0) {
+        spdlog::error("unable to create socket path={}", path);
+        if (server >= 0) {
+            close(server);
+        }
+        return false;
+    }
+    spdlog::info("sim_server action=listen path={}", path);
+
+    bool is_serving = true;
+    while (is_serving) {
+        const int client = accept(server, nullptr, nullptr);
+        if (client < 0) {
+            continue;
+        }
+        const ResponseWriter respond = [&](const nlohmann::json& response) {
+            const std::string line = response.dump() + "\n";
+            for (size_t i = 0; i < line.size();) {
+                const ssize_t n =
+                    write(client, line.data() + i, line.size() - i);
+                if (n <= 0) {
+                    break; // The client is gone
+                }
+                i += n;
+            }
+        };
+
+        // Handle every complete line of the received data
+        std::string pending;
+        char buffer[4096];
+        ssize_t n;
+        while (is_serving && (n = read(client, buffer, sizeof(buffer))) > 0) {
+            pending.append(buffer, n);
+            size_t start = 0, end;
+            while (is_serving
+                   && (end = pending.find('\n', start)) != std::string::npos) {
+                is_serving =
+                    handle_line(pending.substr(start, end - start), respond);
+                start = end + 1;
+            }
+            pending.erase(0, start);
+        }
+        if (is_serving && !pending.empty()) {
+            is_serving = handle_line(pending, respond);
+        }
+        close(client);
+    }
+    close(server);
+    unlink(path.c_str());
+    return true;
+#else
+    spdlog::error("Unix domain sockets are not supported path={}", path);
+    return false;
+#endif
+}
+
+const nlohmann::json* SimServer::cached_scene(const std::string& filename)
+{
+    std::error_code error;
+    const int64_t modified_time =
+        fs::last_write_time(filename, error).time_since_epoch().count();
+    if (error) {
+        return nullptr;
+    }
+    auto it = m_scene_cache.find(filename);
+    if (it == m_scene_cache.end()
+        || it->second.modified_time != modified_time) {
+        nlohmann::json scene;
+        if (!read_json_file(filename, scene) || !scene.is_object()) {
+            m_scene_cache.erase(filename);
+            return nullptr;
+        }
+        it = m_scene_cache
+                 .insert_or_assign(
+                     filename, CachedScene { modified_time, std::move(scene) })
+                 .first;
+    }
+    return &it->second.scene;
+}
+
+bool SimServer::replace_sim(const std::function<bool(SimState&)>& init)
+{
+    // The current scene keeps its geometry alive until the next one is loaded
+    auto sim = std::make_unique<SimState>();
+    if (!init(*sim)) {
+        return false;
+    }
+    m_sim = std::move(sim);
+    return true;
+}
+
+nlohmann::json SimServer::load(const nlohmann::json& request)
+{
+    const std::string filename = request.value("scene", "");
+    const nlohmann::json patch =
+        request.value("patch", nlohmann::json::object());
+
+    const std::string ext = fs::path(filename).extension().string();
+    const nlohmann::json* scene =
+        ext == ".json" ? cached_scene(filename) : nullptr;
+    bool success;
+    if (scene != nullptr && !scene->contains("args")) {
+        success = replace_sim([&](SimState& sim) {
+            nlohmann::json patched_scene = *scene;
+            patched_scene.merge_patch(patch);
+            sim.scene_file = filename;
+            return sim.init(patched_scene);
+        });
+    } else {
+        // Saved simulations and compiled scenes
+        success = replace_sim([&](SimState& sim) {
+            return sim.load_scene(filename, patch.empty() ? "" : patch.dump());
+        });
+    }
+    if (!success) {
+        return error_response(
+            fmt::format("unable to load scene filename={}", filename));
+    }
+    return { { "ok", true },
+             { "dim", m_sim->problem_ptr->dim() },
+             { "num_bodies", m_sim->problem_ptr->num_bodies() },
+             { "timestep", m_sim->args["timestep"] } };
+}
+
+nlohmann::json SimServer::patch(const nlohmann::json& request)
+{
+    if (m_sim == nullptr) {
+        return error_response("no scene is loaded");
+    }
+    // Patches apply to the args of the current scene, so they accumulate
+    nlohmann::json args = m_sim->args;
+    args.merge_patch(request.value("patch", nlohmann::json::object()));
+    const std::string scene_file = m_sim->scene_file;
+    if (!replace_sim([&](SimState& sim) {
+            sim.scene_file = scene_file;
+            return sim.init(args);
+        })) {
+        return error_response("unable to initialize the patched scene");
+    }
+    return { { "ok", true },
+             { "num_bodies", m_sim->problem_ptr->num_bodies() } };
+}
+
+void SimServer::step(
+    const nlohmann::json& request, const ResponseWriter& respond)
+{
+    const int num_steps = request.value("num_steps", 1);
+    const std::string output = request.value("output", "poses");
+    const bool is_streaming = request.value("stream", false);
+    if (output != "poses" && output != "state" && output != "none") {
+        respond(error_response(fmt::format("unknown output={}", output)));
+        return;
+    }
+
+    for (int i = 0; i < num_steps; i++) {
+        m_sim->simulation_step();
+        m_sim->save_simulation_step();
+        if (is_streaming && i + 1 < num_steps) {
+            nlohmann::json response = step_output(output);
+            response["ok"] = true;
+            response["is_last"] = false;
+            respond(response);
+        }
+    }
+    nlohmann::json response = step_output(output);
+    response["ok"] = true;
+    if (is_streaming) {
+        response["is_last"] = true;
+    }
+    respond(response);
+}
+
+nlohmann::json SimServer::step_output(const std::string& output) const
+{
+    nlohmann::json json;
+    json["step"] = m_sim->m_num_simulation_steps;
+    json["time"] =
+        m_sim->m_num_simulation_steps * m_sim->args["timestep"].get<double>();
+    json["has_intersections"] = m_sim->m_step_has_intersections;
+    if (output == "state") {
+        json["state"] = m_sim->problem_ptr->state();
+    } else if (output == "poses") {
+        // One row of pose dof per body in the scene's order
+        const auto rbp =
+            std::dynamic_pointer_cast<RigidBodyProblem>(m_sim->problem_ptr);
+        if (rbp != nullptr) {
+            const PosesD poses =
+                rbp->external_poses(rbp->m_assembler.rb_poses_t1());
+            Eigen::MatrixXd dofs(poses.size(), PoseD::dim_to_ndof(rbp->dim()));
+            for (size_t i = 0; i < poses.size(); i++) {
+                dofs.row(i) << poses[i].position.transpose(),
+                    poses[i].rotation.transpose();
+            }
+            json["poses"] = to_json(dofs);
+        }
+    }
+    return json;
+}
+
+} // namespace ipc::rigid
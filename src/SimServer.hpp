@@ -0,0 +1,78 @@
+#pragma once
+
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+#include <nlohmann/json.hpp>
+
+#include "SimState.hpp"
+
+namespace ipc::rigid {
+
+/// @brief Long-running simulation process serving JSON-lines requests.
+///
+/// Each request is one JSON object per line with a "command" and an
+/// optional "id" that is echoed in its responses:
+///   - load:  {"scene": path, "patch": {...}} loads a scene (parsed scene
+///            files are cached until they are modified)
+///   - patch: {"patch": {...}} re-initializes the scene with patched args
+///   - step:  {"num_steps": n, "output": "poses"|"state"|"none",
+///             "stream": bool} steps the scene, responding after every step
+///            if streaming
+///   - state: responds with the full state of the scene
+///   - save:  {"filename": path} saves the simulation
+///   - quit:  stops serving
+/// Responses have "ok" set, and an "error" message if it is false.
+///
+/// The scene being replaced stays alive while the next one loads, so bodies
+/// with the same meshes share their geometry (BVH and mass properties), and
+/// the TBB threads stay warm between requests.
+class SimServer {
+public:
+    typedef std::function<void(const nlohmann::json&)> ResponseWriter;
+
+    /// @brief Handle a request, writing one or more responses.
+    /// @returns False if the request asks to stop serving.
+    bool handle(const nlohmann::json& request, const ResponseWriter& respond);
+
+    /// @brief Serve the requests of a stream until its end or a quit request.
+    void serve(std::istream& in, std::ostream& out);
+
+    /// @brief Serve the requests of the clients of a Unix domain socket, one
+    /// client at a time, until a quit request.
+    /// @returns False if the socket cannot be created.
+    bool serve_socket(const std::string& path);
+
+    /// @brief Scene being simulated (null before the first load).
+    const std::unique_ptr<SimState>& sim() const { return m_sim; }
+
+protected:
+    /// @brief Handle a line of a stream (responding to invalid JSON).
+    bool handle_line(const std::string& line, const ResponseWriter& respond);
+
+    nlohmann::json load(const nlohmann::json& request);
+    nlohmann::json patch(const nlohmann::json& request);
+    void step(const nlohmann::json& request, const ResponseWriter& respond);
+    /// @brief Step, time, and requested output of the current step.
+    nlohmann::json step_output(const std::string& output) const;
+
+    /// @brief Parsed JSON scene file, re-read if it was modified.
+    /// @returns Null if the file cannot be read.
+    const nlohmann::json* cached_scene(const std::string& filename);
+
+    /// @brief Replace the scene by one initialized by the function.
+    bool replace_sim(const std::function<bool(SimState&)>& init);
+
+    std::unique_ptr<SimState> m_sim;
+
+    struct CachedScene {
+        int64_t modified_time;
+        nlohmann::json scene;
+    };
+    std::unordered_map<std::string, CachedScene> m_scene_cache;
+};
+
+} // namespace ipc::rigid
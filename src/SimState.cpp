@@ -1,7 +1,9 @@
 #include "SimState.hpp"
 
 #include <algorithm>
+#include <atomic>
 #include <cctype>
+#include <cmath>
 #include <fstream>
 #include <iostream>
 #include <string>
@@ -10,19 +12,31 @@
 #include <igl/Timer.h>
 #include <igl/write_triangle_mesh.h>
 #include <nlohmann/json.hpp>
+#include <tbb/parallel_for.h>
 
+#include <ccd/ccd_query_stats.hpp>
 #include <constants.hpp>
+#include <io/metrics_exporter.hpp>
+#include <io/read_json.hpp>
 #include <io/read_rb_scene.hpp>
+#include <io/scene_bundle.hpp>
 #include <io/serialize_json.hpp>
+#include <io/step_metrics_file.hpp>
 #include <io/write_gltf.hpp>
 #include <io/write_obj.hpp>
 #include <physics/rigid_body_problem.hpp>
+#include <problems/barrier_problem.hpp>
 #include <problems/problem_factory.hpp>
+#include <utils/async_task_queue.hpp>
 #include <utils/get_rss.hpp>
+#include <utils/memory_usage.hpp>
+#include <utils/parallel_loop_tuner.hpp>
 #include <utils/regular_2d_grid.hpp>
+#include <utils/step_metrics.hpp>
 
 #include <logger.hpp>
 #include <profiler.hpp>
+#include <tracer.hpp>
 
 namespace ipc::rigid {
 
@@ -39,6 +53,21 @@ SimState::SimState()
     initial_rss = getCurrentRSS();
 }
 
+void SimState::set_num_threads(int num_threads)
+{
+    if (num_threads == m_num_threads) {
+        return;
+    }
+    m_num_threads = num_threads;
+    if (num_threads > 0) {
+        m_arena = std::make_unique<tbb::task_arena>(num_threads);
+    } else {
+        m_arena.reset(); // Use the arena of the calling thread
+    }
+    RIGID_IPC_LOG_DEBUG(
+        "sim_state action=set_num_threads num_threads={:d}", m_num_threads);
+}
+
 void to_lower(std::string& s)
 {
     std::transform(s.begin(), s.end(), s.begin(), [](unsigned char c) {
@@ -49,28 +78,42 @@ void to_lower(std::string& s)
 bool SimState::load_scene(const std::string& filename, const std::string& patch)
 {
     PROFILER_CLEAR();
+    MemoryUsage::reset();
     initial_rss = getCurrentRSS();
 
     std::string ext = fs::path(filename).extension().string();
     to_lower(ext); // modifies ext
 
     nlohmann::json scene;
+    // Frames of saved simulations are moved out of the DOM while parsing
+    std::vector<nlohmann::json> states;
     if (ext == ".mjcf") {
         // TODO: Add converter from MCJF to JSON
         // scene = ...
         spdlog::error("MuJoCo file format not supported yet", ext);
         return false;
     } else if (ext == ".json") {
-        std::ifstream input(filename);
-        if (input.good()) {
-            scene = nlohmann::json::parse(input, nullptr, false);
-            if (patch.size()) {
-                scene.merge_patch(nlohmann::json::parse(patch));
-            }
-        } else {
+        if (!fs::exists(filename)) {
             spdlog::error("Unable to open json file: {}", filename);
             return false;
         }
+        read_json_file(
+            filename, scene, "/animation/state_sequence",
+            [&](nlohmann::json&& state) {
+                states.push_back(std::move(state));
+            });
+        if (!scene.is_discarded() && patch.size()) {
+            scene.merge_patch(nlohmann::json::parse(patch));
+        }
+    } else if (ext == ".rbscene") {
+        // Compiled scene with precomputed geometry (see compile_scene)
+        if (!read_scene_bundle_args(filename, scene)) {
+            return false;
+        }
+        if (patch.size()) {
+            scene.merge_patch(nlohmann::json::parse(patch));
+        }
+        scene["rigid_body_problem"]["scene_bundle"] = filename;
     } else {
         spdlog::error("Unknown scene file format: {}", ext);
         return false;
@@ -84,7 +127,7 @@ bool SimState::load_scene(const std::string& filename, const std::string& patch)
 
     // Check if this is a saved simulation file
     if (scene.find("args") != scene.end()) {
-        return load_simulation(scene);
+        return load_simulation(scene, std::move(states));
     } else {
         return init(scene);
     }
@@ -94,6 +137,14 @@ bool SimState::load_scene(const std::string& filename, const std::string& patch)
 bool SimState::reload_scene() { return load_scene(scene_file); }
 
 bool SimState::load_simulation(const nlohmann::json& input_args)
+{
+    return load_simulation(
+        input_args, input_args["animation"]["state_sequence"]
+                        .get<std::vector<nlohmann::json>>());
+}
+
+bool SimState::load_simulation(
+    const nlohmann::json& input_args, std::vector<nlohmann::json>&& states)
 {
     // load original setup
     bool success = init(input_args["args"]);
@@ -102,8 +153,9 @@ bool SimState::load_simulation(const nlohmann::json& input_args)
     }
 
     // now reload simulation history
-    state_sequence = input_args["animation"]["state_sequence"]
-                         .get<std::vector<nlohmann::json>>();
+    state_sequence.clear();
+    append_json_states(states);
+    states.clear();
     if (input_args.find("stats") != input_args.end()) {
         const auto& stats = input_args["stats"];
         step_timings = stats["step_timings"].get<std::vector<double>>();
@@ -113,11 +165,134 @@ bool SimState::load_simulation(const nlohmann::json& input_args)
             stats["step_minimum_distances"].get<std::vector<double>>();
     }
     m_num_simulation_steps = int(state_sequence.size()) - 1;
-    problem_ptr->state(state_sequence.back());
+    const auto& animation = input_args["animation"];
+    if (animation.find("trajectory_file") != animation.end()) {
+        // Only the last state is stored in the JSON file
+        trajectory_file = animation["trajectory_file"].get<std::string>();
+        m_num_simulation_steps = animation["num_steps"].get<int>();
+    }
+    problem_ptr->state_from(state_sequence.back());
+    return true;
+}
+
+template <typename States> void SimState::append_json_states(States&& states)
+{
+    for (const nlohmann::json& state : states) {
+        problem_ptr->state(state);
+        state_sequence.emplace_back();
+        problem_ptr->state_into(state_sequence.back());
+    }
+}
+
+/// @brief Append the elements of a JSON array to a vector.
+template <typename T>
+void append_json_array(const nlohmann::json& json, std::vector<T>& vector)
+{
+    for (const auto& value : json) {
+        vector.push_back(value.get<T>());
+    }
+}
+
+bool SimState::resume_simulation(const std::string& filename)
+{
+    PROFILER_CLEAR();
+    MemoryUsage::reset();
+    initial_rss = getCurrentRSS();
+
+    // Follow the incremental checkpoints back to the first one
+    std::vector<nlohmann::json> checkpoints;
+    fs::path path(filename);
+    while (true) {
+        std::ifstream input(path.string());
+        if (!input.good()) {
+            spdlog::error(
+                "unable to open checkpoint filename={}", path.string());
+            return false;
+        }
+        checkpoints.push_back(nlohmann::json::parse(input, nullptr, false));
+        if (checkpoints.back().is_discarded()
+            || !checkpoints.back().contains("checkpoint")) {
+            spdlog::error("invalid checkpoint filename={}", path.string());
+            return false;
+        }
+        const std::string previous =
+            checkpoints.back()["checkpoint"]["previous"].get<std::string>();
+        if (previous.empty()) {
+            break;
+        }
+        path = path.parent_path() / previous;
+    }
+    const nlohmann::json& latest = checkpoints.front();
+
+    if (!init(latest["args"])) {
+        return false;
+    }
+    scene_file = filename;
+
+    // Rebuild the saved history without re-simulating it
+    state_sequence.clear();
+    for (auto it = checkpoints.rbegin(); it != checkpoints.rend(); ++it) {
+        append_json_states((*it)["animation"]["state_sequence"]);
+        const auto& stats = (*it)["stats"];
+        append_json_array(stats["step_timings"], step_timings);
+        append_json_array(stats["solver_iterations"], solver_iterations);
+        append_json_array(stats["num_contacts"], num_contacts);
+        append_json_array(
+            stats["step_minimum_distances"], step_minimum_distances);
+    }
+
+    problem_ptr->restart_state(latest["restart_state"]);
+    m_num_simulation_steps = latest["checkpoint"]["num_steps"].get<int>();
+    if (latest["animation"].contains("trajectory_file")) {
+        trajectory_file =
+            latest["animation"]["trajectory_file"].get<std::string>();
+        state_sequence.resize(1);
+        problem_ptr->state_into(state_sequence.back());
+    }
+    m_num_checkpointed_states = state_sequence.size();
+    m_num_checkpointed_steps = step_timings.size();
+    m_last_checkpoint_file = filename;
+    m_is_resuming = true;
+
+    spdlog::info(
+        "resumed simulation filename={} sim_step={}", filename,
+        m_num_simulation_steps);
     return true;
 }
 
+nlohmann::json SimSettings::to_json() const
+{
+    nlohmann::json args;
+    args["scene_type"] = scene_type;
+    args["solver"] = solver;
+    args["timestep"] = timestep;
+    args["max_iterations"] = max_iterations;
+    args["max_time"] = max_time;
+    args["num_threads"] = num_threads;
+    args["deterministic"] = deterministic;
+    args["rigid_body_problem"]["gravity"] = ipc::rigid::to_json(gravity);
+    args["rigid_body_problem"]["coefficient_friction"] = coefficient_friction;
+    args["rigid_body_problem"]["coefficient_restitution"] =
+        coefficient_restitution;
+    return args;
+}
+
 bool SimState::init(const nlohmann::json& args_in)
+{
+    return init(args_in, /*rbs=*/nullptr);
+}
+
+bool SimState::init(const nlohmann::json& args_in, std::vector<RigidBody> rbs)
+{
+    return init(args_in, &rbs);
+}
+
+bool SimState::init(const SimSettings& settings, std::vector<RigidBody> rbs)
+{
+    return init(settings.to_json(), &rbs);
+}
+
+bool SimState::init(const nlohmann::json& args_in, std::vector<RigidBody>* rbs)
 {
     using namespace nlohmann;
 
@@ -126,16 +301,58 @@ bool SimState::init(const nlohmann::json& args_in)
         "max_iterations": -1,
         "max_time": -1,
         "timestep": 0.01,
+        "num_threads": -1,
+        "deterministic": false,
+        "parallel_loop_tuning": false,
         "scene_type": "distance_barrier_rb_problem",
         "solver": "ipc_solver",
+        "trajectory_format": "json",
+        "metrics_format": "none",
+        "metrics_exporter": {
+            "type": "none",
+            "host": "",
+            "port": null,
+            "prefix": "rigid_ipc"
+        },
+        "ccd_query_stats": false,
+        "adaptive_timestep": {
+            "enabled": false,
+            "min_timestep": 1e-5,
+            "grow_factor": 2.0,
+            "shrink_factor": 0.5,
+            "max_iterations_to_grow": 5,
+            "min_toi_to_grow": 1.0,
+            "max_toi_to_shrink": 0.1
+        },
         "rigid_body_problem": {
             "rigid_bodies": [],
+            "scene_bundle": "",
             "coefficient_restitution": 0.0,
             "coefficient_friction": 0.0,
             "gravity": [0.0, 0.0, 0.0],
             "collision_eps": 0.0,
             "time_stepper": "default",
-            "do_intersection_check": false
+            "do_intersection_check": false,
+            "intersection_check_interval": 1,
+            "warm_start_order": 0,
+            "lazy_psd_projection": false,
+            "lower_triangular_hessian": false,
+            "gpu_hessian_assembly": false,
+            "colored_hessian_assembly": false,
+            "prescribe_kinematic_bodies": false,
+            "multirate_displacement_threshold": 0.0,
+            "multirate_max_substeps": 8,
+            "record_contact_forces": false,
+            "sleep_energy_threshold": 0.0,
+            "sleep_steps": 10,
+            "do_body_reordering": false,
+            "body_reordering_interval": 0,
+            "state_output": {
+                "bodies": [],
+                "group_ids": [],
+                "region": null,
+                "fields": []
+            }
         },
         "homotopy_solver": {
             "inner_solver": "DEPRECATED",
@@ -152,17 +369,28 @@ bool SimState::init(const nlohmann::json& args_in)
             "velocity_conv_tol": null,
             "is_velocity_conv_tol_abs": false,
             "line_search_lower_bound": null,
+            "line_search_batch_size": 1,
+            "max_line_search_iterations": -1,
+            "line_search_interpolation": false,
+            "time_budget": 0,
+            "hessian_approximation": "exact",
+            "max_lagged_iterations": 3,
+            "lbfgs_history_size": 10,
+            "speculative_broad_phase_inflation": 0,
+            "inexact_newton": false,
             "linear_solver": {
                 "name": "Eigen::SimplicialLDLT",
                 "max_iter": 1000,
                 "tolerance": 1e-10,
                 "pre_max_iter": 1,
-                "mtype": 2
+                "mtype": 2,
+                "solve_islands": false
             }
         },
         "ipc_solver": {
             "dhat_epsilon": 1e-9,
-            "min_barrier_stiffness_scale": null
+            "min_barrier_stiffness_scale": null,
+            "barrier_stiffness_warm_start_tolerance": null
         },
         "ncp_solver": {
             "max_iterations": 1000,
@@ -177,11 +405,17 @@ bool SimState::init(const nlohmann::json& args_in)
             "trajectory_type": "piecewise_linear",
             "initial_barrier_activation_distance": 1e-3,
             "minimum_separation_distance": 0,
-            "barrier_type": "ipc"
+            "barrier_type": "ipc",
+            "contact_manifold_reduction": false,
+            "ccd_relative_toi_tolerance": null,
+            "stream_ccd_candidates": false,
+            "per_body_activation_distance": false
         },
         "friction_constraints": {
             "static_friction_speed_bound": 1e-3,
-            "iterations": 1
+            "iterations": 1,
+            "relinearization_tolerance": 0,
+            "normal_force_threshold": 0
         },
         "volume_constraint": {
             "detection_method": "hash_grid",
@@ -204,6 +438,10 @@ bool SimState::init(const nlohmann::json& args_in)
         Constants::DEFAULT_LINE_SEARCH_LOWER_BOUND;
     args["ipc_solver"]["min_barrier_stiffness_scale"] =
         Constants::DEFAULT_MIN_BARRIER_STIFFNESS_SCALE;
+    args["ipc_solver"]["barrier_stiffness_warm_start_tolerance"] =
+        Constants::DEFAULT_BARRIER_STIFFNESS_WARM_START_TOLERANCE;
+    args["distance_barrier_constraint"]["ccd_relative_toi_tolerance"] =
+        Constants::DEFAULT_CCD_RELATIVE_TOI_TOLERANCE;
 
     // Share the newton solver settings with IPC
     json newton_settings = args["newton_solver"];    // make a copy of newton
@@ -241,7 +479,26 @@ bool SimState::init(const nlohmann::json& args_in)
     }
     problem_ptr = tmp_problem_ptr;
 
-    bool success = problem_ptr->settings(args);
+    m_has_built_bodies = rbs != nullptr;
+    if (m_has_built_bodies) {
+        std::shared_ptr<RigidBodyProblem> rbp =
+            std::dynamic_pointer_cast<RigidBodyProblem>(problem_ptr);
+        if (rbp == nullptr) {
+            spdlog::error(
+                "scene_type={} does not take rigid bodies", problem_name);
+            return false;
+        }
+        args["rigid_body_problem"]["rigid_bodies"] = json::array();
+        rbp->scene_bodies(std::move(*rbs));
+    }
+
+    set_num_threads(args["num_threads"].get<int>());
+    // Partitioners and grain sizes of the hot loops chosen by their cost
+    ParallelLoopTuner::set_enabled(args["parallel_loop_tuning"].get<bool>());
+
+    // Building the bodies (e.g., their BVHs) runs in parallel
+    bool success;
+    execute([&] { success = problem_ptr->settings(args); });
     if (!success) {
         return false;
     }
@@ -254,15 +511,38 @@ bool SimState::init(const nlohmann::json& args_in)
         m_max_simulation_steps = int(ceil(max_time / problem_ptr->timestep()));
     }
 
+    // The time-step is the output frame period when it is adapted
+    m_frame_timestep = m_adaptive_timestep = problem_ptr->timestep();
+    m_timestep_controller.settings(args["adaptive_timestep"]);
+    if (m_timestep_controller.is_enabled && has_scripted_poses()) {
+        spdlog::warn(
+            "scripted kinematic poses require a fixed time-step; disabling "
+            "adaptive_timestep");
+        m_timestep_controller.is_enabled = false;
+    }
+
     m_num_simulation_steps = 0;
     m_dirty_constraints = true;
 
-    state_sequence.clear();
-    state_sequence.push_back(problem_ptr->state());
+    state_sequence.resize(1);
+    problem_ptr->state_into(state_sequence.back());
+    trajectory_file.clear();
+    m_trajectory_writer.close();
+    m_is_streaming_trajectory = false;
+    m_metrics_writer.close();
+    m_metrics_exporter.close();
+    m_is_writing_metrics = false;
+    m_ccd_query_stats = CCDQueryStats::Summary();
+    m_num_checkpointed_states = 0;
+    m_num_checkpointed_steps = 0;
+    m_last_checkpoint_file.clear();
+    m_is_resuming = false;
     step_timings.clear();
     solver_iterations.clear();
     num_contacts.clear();
     step_minimum_distances.clear();
+    step_metric_times.clear();
+    step_metric_counts.clear();
 
     return true;
 }
@@ -271,6 +551,7 @@ nlohmann::json SimState::get_active_config()
 {
     nlohmann::json active_args;
     active_args["timestep"] = problem_ptr->timestep();
+    active_args["adaptive_timestep"] = m_timestep_controller.settings();
     active_args["scene_type"] = problem_ptr->name();
 
     active_args[problem_ptr->name()] = problem_ptr->settings();
@@ -329,12 +610,65 @@ void SimState::run_simulation(const std::string& fout)
     spdlog::info("Starting simulation {}", scene_file);
     spdlog::info("Running {} iterations", m_max_simulation_steps);
 
+    // Write outputs on a background thread so they do not stall stepping
+    m_io_queue =
+        std::make_unique<AsyncTaskQueue>(Constants::ASYNC_IO_QUEUE_CAPACITY);
+
+    // Stream the states to a binary file instead of keeping them in memory
+    if (args["trajectory_format"].get<std::string>() == "binary") {
+        std::shared_ptr<RigidBodyProblem> rbp =
+            std::dynamic_pointer_cast<RigidBodyProblem>(problem_ptr);
+        fs::path traj_path(fout_path);
+        traj_path.replace_extension(".traj");
+        bool is_open;
+        if (m_is_resuming && !trajectory_file.empty()) {
+            // Drop any frames written after the checkpoint
+            traj_path = trajectory_file;
+            is_open = rbp != nullptr
+                && m_trajectory_writer.resume(
+                    trajectory_file, m_num_simulation_steps + 1);
+        } else {
+            is_open = rbp != nullptr
+                && m_trajectory_writer.open(
+                    traj_path.string(), problem_ptr->dim(),
+                    problem_ptr->num_bodies(), problem_ptr->timestep())
+                && write_trajectory_frame();
+        }
+        if (is_open) {
+            trajectory_file = traj_path.string();
+            m_is_streaming_trajectory = true;
+            state_sequence.erase(
+                state_sequence.begin(), state_sequence.end() - 1);
+        } else {
+            spdlog::error(
+                "unable to stream trajectory filename={} fallback=json",
+                traj_path.string());
+            m_trajectory_writer.close();
+        }
+    }
+
+    // Write the metrics of every step as they are computed
+    const std::string metrics_format = args["metrics_format"];
+    if (metrics_format == "jsonl" || metrics_format == "csv") {
+        std::string metrics_fout =
+            fmt::format("{}-metrics.{}", chkpt_base, metrics_format);
+        m_is_writing_metrics =
+            m_metrics_writer.open(metrics_fout, /*append=*/m_is_resuming);
+    } else if (metrics_format != "none") {
+        spdlog::warn("unknown metrics_format={} fallback=none", metrics_format);
+    }
+    // Publish the metrics of every step for live monitoring
+    m_metrics_exporter.open(args["metrics_exporter"]);
+    CCDQueryStats::set_enabled(args["ccd_query_stats"].get<bool>());
+
     igl::Timer timer;
     timer.start();
 
     m_solve_collisions = true;
-    print_progress_bar(0, m_max_simulation_steps, 0);
-    for (int i = 0; i < m_max_simulation_steps; ++i) {
+    const int first_step = m_is_resuming ? m_num_simulation_steps : 0;
+    m_is_resuming = false;
+    print_progress_bar(first_step, m_max_simulation_steps, 0);
+    for (int i = first_step; i < m_max_simulation_steps; ++i) {
         simulation_step();
         save_simulation_step();
         spdlog::info(
@@ -343,10 +677,16 @@ void SimState::run_simulation(const std::string& fout)
         // Checkpoint the simulation every m_checkpoint_frequency time-steps
         if ((i + 1) % m_checkpoint_frequency == 0
             && (i + 1) < m_max_simulation_steps) {
+            TRACE_SCOPE("io");
             std::string chkpt_fout = fmt::format(
                 "{}-chkpt{:05d}.json", chkpt_base, m_num_simulation_steps);
-            save_simulation(chkpt_fout);
-            spdlog::info("Simulation checkpoint saved to {}", chkpt_fout);
+            m_io_queue->push([chkpt_fout,
+                              results = checkpoint_results(chkpt_fout)] {
+                if (write_json(chkpt_fout, results)) {
+                    spdlog::info(
+                        "Simulation checkpoint saved to {}", chkpt_fout);
+                }
+            });
         }
         print_progress_bar(
             i + 1, m_max_simulation_steps, timer.getElapsedTime());
@@ -356,14 +696,26 @@ void SimState::run_simulation(const std::string& fout)
     fmt::print(
         "Simulation finished (total_runtime={:g}s average_fps={:g})\n",
         timer.getElapsedTime(),
-        m_max_simulation_steps / timer.getElapsedTime());
+        (m_max_simulation_steps - first_step) / timer.getElapsedTime());
 
-    save_simulation(fout);
-    spdlog::info("Simulation results saved to {}", fout);
+    // The trajectory has to be complete before the glTF export reads it
+    m_io_queue->wait();
+    m_trajectory_writer.close();
+    m_metrics_writer.close();
+    m_metrics_exporter.close();
+    m_is_streaming_trajectory = false;
+    m_is_writing_metrics = false;
+
+    m_io_queue->push([fout, results = simulation_results()] {
+        if (write_json(fout, results)) {
+            spdlog::info("Simulation results saved to {}", fout);
+        }
+    });
     fs::path gltf_filename(fout);
     gltf_filename.replace_extension(".glb");
     save_gltf(gltf_filename.string());
     spdlog::info("Animation saved to {}", gltf_filename.string());
+    m_io_queue.reset(); // Finish writing the results
 
     PROFILE_END();
     LOG_PROFILER(scene_file);
@@ -375,13 +727,28 @@ void SimState::simulation_step()
     m_step_has_collision = false;
     m_step_has_intersections = false;
 
+    TRACE_SCOPE("simulation_step");
+    StepMetrics::reset();
+    CCDQueryStats::reset();
     step_timer.start();
-    problem_ptr->simulation_step(
-        m_step_had_collision, m_step_has_intersections, m_solve_collisions);
+    execute([&] {
+        if (m_timestep_controller.is_enabled) {
+            adaptive_simulation_step();
+        } else {
+            problem_ptr->simulation_step(
+                m_step_had_collision, m_step_has_intersections,
+                m_solve_collisions);
+            m_step_num_substeps = 1;
+            m_step_solver_iterations = problem_ptr->opt_result.num_iterations;
+            m_step_line_search_failures =
+                problem_ptr->opt_result.num_line_search_failures;
+        }
+    });
     step_timer.stop();
 
     if (m_step_had_collision) {
-        spdlog::debug("sim_state action=simulation_step status=had_collision");
+        RIGID_IPC_LOG_DEBUG(
+            "sim_state action=simulation_step status=had_collision");
     }
 
     if (m_step_has_intersections) {
@@ -390,7 +757,7 @@ void SimState::simulation_step()
             "status=has_intersections",
             m_num_simulation_steps);
     } else {
-        spdlog::debug(
+        RIGID_IPC_LOG_DEBUG(
             "sim_state action=simulation_step sim_it={} "
             "status=no_intersections",
             m_num_simulation_steps);
@@ -403,29 +770,246 @@ void SimState::simulation_step()
     //                          : "collisions_solved");
 }
 
+void SimState::adaptive_simulation_step()
+{
+    m_step_had_collision = false;
+    m_step_has_intersections = false;
+    m_step_num_substeps = 0;
+    m_step_solver_iterations = 0;
+    m_step_line_search_failures = 0;
+
+    // Substeps always end on the frame, so outputs keep a fixed frame rate
+    double remaining_time = m_frame_timestep;
+    while (remaining_time > 0) {
+        // Split the rest of the frame evenly instead of leaving a sliver
+        const int num_substeps = std::max(
+            int(std::ceil(remaining_time / m_adaptive_timestep - 1e-9)), 1);
+        const double dt =
+            num_substeps == 1 ? remaining_time : remaining_time / num_substeps;
+        remaining_time = num_substeps == 1 ? 0 : remaining_time - dt;
+
+        bool had_collision = false, has_intersections = false;
+        problem_ptr->timestep(dt);
+        problem_ptr->simulation_step(
+            had_collision, has_intersections, m_solve_collisions);
+        m_step_had_collision |= had_collision;
+        m_step_has_intersections |= has_intersections;
+        m_step_num_substeps++;
+        m_step_solver_iterations += problem_ptr->opt_result.num_iterations;
+        m_step_line_search_failures +=
+            problem_ptr->opt_result.num_line_search_failures;
+
+        m_adaptive_timestep = m_timestep_controller.next_timestep(
+            m_adaptive_timestep, problem_ptr->opt_result, m_frame_timestep);
+        RIGID_IPC_LOG_DEBUG(
+            "sim_state action=substep dt={:g} iterations={:d} "
+            "earliest_toi={:g} next_dt={:g}",
+            dt, problem_ptr->opt_result.num_iterations,
+            problem_ptr->opt_result.earliest_toi, m_adaptive_timestep);
+    }
+    problem_ptr->timestep(m_frame_timestep);
+}
+
+bool SimState::has_scripted_poses() const
+{
+    std::shared_ptr<RigidBodyProblem> rbp =
+        std::dynamic_pointer_cast<RigidBodyProblem>(problem_ptr);
+    if (rbp == nullptr) {
+        return false;
+    }
+    for (size_t i = 0; i < rbp->num_bodies(); i++) {
+        if (rbp->m_assembler[i].kinematic_poses.size()) {
+            return true;
+        }
+    }
+    return false;
+}
+
 void SimState::save_simulation_step()
 {
     PROFILE_POINT("SimState::save_simulation_step");
     PROFILE_START();
 
-    state_sequence.push_back(problem_ptr->state());
+    // Exclude the queries done below to compute the minimum distance
+    nlohmann::json metrics;
+    const bool has_metrics_output =
+        m_is_writing_metrics || m_metrics_exporter.is_open();
+    if (has_metrics_output) {
+        metrics = StepMetrics::to_json();
+    }
+    for (int i = 0; i < StepMetrics::NUM_TIMERS; i++) {
+        step_metric_times.push_back(StepMetrics::time(StepMetrics::Timer(i)));
+    }
+    for (int i = 0; i < StepMetrics::NUM_COUNTERS; i++) {
+        step_metric_counts.push_back(
+            StepMetrics::count(StepMetrics::Counter(i)));
+    }
+    if (CCDQueryStats::is_enabled()) {
+        const CCDQueryStats::Summary ccd_query_stats =
+            CCDQueryStats::collect();
+        m_ccd_query_stats += ccd_query_stats;
+        if (has_metrics_output) {
+            metrics["ccd_queries"] = ccd_query_stats.to_json();
+        }
+    }
+
+    if (m_is_streaming_trajectory) {
+        write_trajectory_frame();
+        // Keep only the latest
+        problem_ptr->state_into(state_sequence.back());
+    } else {
+        state_sequence.emplace_back();
+        problem_ptr->state_into(state_sequence.back());
+    }
+    // The states of a scene have the same size, so only one is measured
+    MemoryUsage::set_bytes(
+        MemoryUsage::STATE_HISTORY,
+        state_sequence.size()
+            * (sizeof(std::vector<double>)
+               + state_sequence.back().capacity() * sizeof(double)));
     step_timings.push_back(step_timer.getElapsedTime());
-    solver_iterations.push_back(problem_ptr->opt_result.num_iterations);
+    solver_iterations.push_back(m_step_solver_iterations);
     num_contacts.push_back(problem_ptr->num_contacts());
-    step_minimum_distances.push_back(problem_ptr->compute_min_distance());
+    execute([&] {
+        step_minimum_distances.push_back(problem_ptr->compute_min_distance());
+    });
+
+    if (has_metrics_output) {
+        write_step_metrics(std::move(metrics));
+    }
 
     PROFILE_END();
 }
 
+void SimState::write_step_metrics(nlohmann::json record)
+{
+    TRACE_SCOPE("io");
+    record["step"] = m_num_simulation_steps;
+    record["step_time"] = step_timings.back();
+    record["solver_iterations"] = solver_iterations.back();
+    record["steps_per_second"] =
+        step_timings.back() > 0 ? 1 / step_timings.back() : 0.0;
+    record["num_substeps"] = m_step_num_substeps;
+    record["line_search_failures"] = m_step_line_search_failures;
+    record["num_contacts"] = num_contacts.back();
+    record["minimum_distance"] = step_minimum_distances.back();
+    std::shared_ptr<BarrierProblem> barrier_problem =
+        std::dynamic_pointer_cast<BarrierProblem>(problem_ptr);
+    if (barrier_problem != nullptr) {
+        record["barrier_stiffness"] = barrier_problem->barrier_stiffness();
+    }
+    record["rss"] = getCurrentRSS();
+    record["peak_rss"] = getPeakRSS();
+    record["memory_usage"] = MemoryUsage::to_json();
+
+    m_metrics_exporter.publish(record);
+    if (!m_is_writing_metrics) {
+        return;
+    }
+    if (m_io_queue != nullptr) {
+        m_io_queue->push([this, record = std::move(record)] {
+            m_metrics_writer.write(record);
+        });
+    } else {
+        m_metrics_writer.write(record);
+    }
+}
+
+bool SimState::write_trajectory_frame()
+{
+    TRACE_SCOPE("io");
+    std::shared_ptr<RigidBodyProblem> rbp =
+        std::dynamic_pointer_cast<RigidBodyProblem>(problem_ptr);
+    assert(rbp != nullptr);
+    const RigidBodyAssembler& bodies = rbp->m_assembler;
+
+    // Frames are in the scene's order, so they do not depend on reordering
+    PosesD poses = rbp->external_poses(bodies.rb_poses());
+    PosesD velocities(bodies.num_bodies());
+    for (size_t i = 0; i < bodies.num_bodies(); i++) {
+        velocities[i] = bodies[i].velocity;
+    }
+    velocities = rbp->external_poses(velocities);
+
+    if (m_io_queue != nullptr) {
+        m_io_queue->push([this, poses = std::move(poses),
+                          velocities = std::move(velocities)] {
+            m_trajectory_writer.write_frame(poses, velocities);
+        });
+        return true;
+    }
+    return m_trajectory_writer.write_frame(poses, velocities);
+}
+
+bool SimState::write_json(
+    const std::string& filename, const nlohmann::json& results)
+{
+    // Not profiled because this runs on the I/O thread
+    std::ofstream file(filename);
+    if (!file) {
+        spdlog::error("unable to open output filename={}", filename);
+        return false;
+    }
+    file << results.dump();
+    return true;
+}
+
 bool SimState::save_simulation(const std::string& filename)
 {
-    PROFILE_POINT("SimState::save_simulation");
+    return write_json(filename, simulation_results());
+}
+
+nlohmann::json SimState::saved_args() const
+{
+    nlohmann::json saved_args = args;
+    // Meshes read by read_json_file() are saved as regular arrays
+    unpack_json_matrices(saved_args);
+    std::shared_ptr<RigidBodyProblem> rbp =
+        std::dynamic_pointer_cast<RigidBodyProblem>(problem_ptr);
+    if (!m_has_built_bodies || rbp == nullptr) {
+        return saved_args;
+    }
+
+    // Bodies built in code are saved in the scene's order with their input
+    // meshes, and their poses are restored from the saved states.
+    nlohmann::json& jrbs = saved_args["rigid_body_problem"]["rigid_bodies"];
+    jrbs = nlohmann::json::array();
+    const std::vector<size_t> internal_ids = rbp->body_internal_ids();
+    for (size_t id = 0; id < rbp->num_bodies(); id++) {
+        const RigidBody& rb = rbp->m_assembler[internal_ids[id]];
+        nlohmann::json jrb;
+        jrb["name"] = rb.name;
+        jrb["vertices"] = to_json(rb.geometry->input_vertices);
+        jrb["edges"] = to_json(rb.edges);
+        jrb["faces"] = to_json(rb.faces);
+        jrb["density"] = rb.mass / rb.geometry->volume;
+        // Sleeping bodies are saved as the dynamic bodies they are
+        jrb["type"] = rb.is_sleeping ? RigidBodyType::DYNAMIC : rb.type;
+        jrb["is_dof_fixed"] =
+            to_json(rb.is_sleeping ? rb.awake_is_dof_fixed : rb.is_dof_fixed);
+        jrb["oriented"] = rb.is_oriented;
+        jrb["convex"] = rb.is_convex;
+        jrb["group_id"] = rb.group_id;
+        jrb["position"] = to_json(VectorMax3d::Zero(rb.dim()));
+        jrb["rotation"] = to_json(VectorMax3d::Zero(rb.pose.rotation.size()));
+        jrbs.push_back(std::move(jrb));
+    }
+    return saved_args;
+}
+
+nlohmann::json SimState::simulation_results() const
+{
+    PROFILE_POINT("SimState::simulation_results");
     PROFILE_START();
 
     nlohmann::json results;
-    results["args"] = args;
+    results["args"] = saved_args();
     results["animation"] = nlohmann::json();
-    results["animation"]["state_sequence"] = state_sequence;
+    results["animation"]["state_sequence"] = json_states(0);
+    if (!trajectory_file.empty()) {
+        results["animation"]["trajectory_file"] = trajectory_file;
+        results["animation"]["num_steps"] = m_num_simulation_steps;
+    }
 
     nlohmann::json stats;
     stats["dim"] = problem_ptr->dim();
@@ -435,67 +1019,250 @@ bool SimState::save_simulation(const std::string& filename)
     stats["num_faces"] = problem_ptr->num_faces();
     stats["num_timesteps"] = m_max_simulation_steps;
     stats["memory"] = getPeakRSS() - initial_rss;
+    stats["memory_usage"] = MemoryUsage::to_json();
     stats["step_timings"] = step_timings;
     stats["solver_iterations"] = solver_iterations;
     stats["num_contacts"] = num_contacts;
     stats["step_minimum_distances"] = step_minimum_distances;
     stats["solve_stats"] = problem_ptr->solver().stats();
+    if (args["ccd_query_stats"].get<bool>()) {
+        stats["ccd_queries"] = m_ccd_query_stats.to_json();
+    }
     results["stats"] = stats;
 
-    std::ofstream file(filename);
-    if (!file) {
-        PROFILE_END();
-        return false;
+    PROFILE_END();
+    return results;
+}
+
+nlohmann::json SimState::json_states(size_t start) const
+{
+    // States are only converted to JSON when saved
+    nlohmann::json states = nlohmann::json::array();
+    for (size_t i = start; i < state_sequence.size(); i++) {
+        states.push_back(problem_ptr->state_to_json(state_sequence[i]));
     }
+    return states;
+}
 
-    file << results.dump();
+nlohmann::json SimState::checkpoint_results(const std::string& filename)
+{
+    PROFILE_POINT("SimState::checkpoint_results");
+    PROFILE_START();
+
+    nlohmann::json results;
+    results["args"] = saved_args();
+    results["checkpoint"]["num_steps"] = m_num_simulation_steps;
+    results["checkpoint"]["previous"] = m_last_checkpoint_file.empty()
+        ? ""
+        : fs::path(m_last_checkpoint_file).filename().string();
+    results["restart_state"] = problem_ptr->restart_state();
+
+    // Only store the history since the previous checkpoint
+    results["animation"]["state_sequence"] = json_states(
+        std::min(m_num_checkpointed_states, state_sequence.size()));
+    if (!trajectory_file.empty()) {
+        // The frames are in the trajectory file
+        results["animation"]["state_sequence"] = nlohmann::json::array();
+        results["animation"]["trajectory_file"] = trajectory_file;
+    }
+
+    auto since_checkpoint = [&](const auto& values) {
+        using T = typename std::decay_t<decltype(values)>::value_type;
+        return std::vector<T>(
+            values.begin() + m_num_checkpointed_steps, values.end());
+    };
+    nlohmann::json stats;
+    stats["step_timings"] = since_checkpoint(step_timings);
+    stats["solver_iterations"] = since_checkpoint(solver_iterations);
+    stats["num_contacts"] = since_checkpoint(num_contacts);
+    stats["step_minimum_distances"] = since_checkpoint(step_minimum_distances);
+    results["stats"] = stats;
+
+    m_num_checkpointed_states = state_sequence.size();
+    m_num_checkpointed_steps = step_timings.size();
+    m_last_checkpoint_file = filename;
 
     PROFILE_END();
-    return true;
+    return results;
 }
 
-bool SimState::save_obj_sequence(const std::string& dir_name)
+bool SimState::save_obj_sequence(
+    const std::string& dir_name, double frame_rate)
 {
     // Create the output directory if it does not exist
     fs::path dir_path(dir_name);
     fs::create_directories(dir_path);
 
-    bool success = true;
-    for (int i = 0; i < state_sequence.size(); i++) {
-        const auto& state = state_sequence[i];
-        problem_ptr->state(state);
-        write_obj(
-            (dir_path / fmt::format("{:05d}.obj", i)).string(), *problem_ptr,
-            false);
+    std::shared_ptr<RigidBodyProblem> rbp =
+        std::dynamic_pointer_cast<RigidBodyProblem>(problem_ptr);
+    PoseFrameReader read_frame;
+    const size_t num_saved_frames = saved_frames(read_frame);
+    if (rbp == nullptr || num_saved_frames == 0) {
+        return false;
     }
+    const size_t stride = frame_stride(problem_ptr->timestep(), frame_rate);
+    const size_t num_frames = (num_saved_frames - 1) / stride + 1;
 
-    problem_ptr->state(state_sequence.back());
-
+    // Read the poses of a batch of frames and write their files in parallel
+    // without modifying the problem.
+    std::atomic<bool> success(true);
+    std::vector<PosesD> frames;
+    for (size_t start = 0; start < num_frames && success;
+         start += Constants::OBJ_EXPORT_BATCH_SIZE) {
+        const size_t end =
+            std::min(num_frames, start + Constants::OBJ_EXPORT_BATCH_SIZE);
+        frames.resize(end - start);
+        for (size_t i = start; i < end; i++) {
+            PosesD& poses = frames[i - start];
+            if (!read_frame(i * stride, poses)) {
+                return false;
+            }
+            poses = rbp->internal_poses(poses);
+        }
+        execute([&] {
+            tbb::parallel_for(start, end, [&](size_t i) {
+                const std::string filename =
+                    (dir_path / fmt::format("{:05d}.obj", i)).string();
+                if (!write_obj(filename, rbp->m_assembler, frames[i - start])) {
+                    success = false;
+                }
+            });
+        });
+    }
     return success;
 }
 
-bool SimState::save_gltf(const std::string& filename)
+size_t SimState::saved_frames(PoseFrameReader& read_frame) const
 {
-    std::vector<PosesD> poses(state_sequence.size());
+    if (!trajectory_file.empty()) {
+        auto reader = std::make_shared<TrajectoryReader>();
+        if (!reader->open(trajectory_file)) {
+            return 0;
+        }
+        read_frame = [reader](size_t i, PosesD& poses) {
+            PosesD velocities;
+            return reader->read_frame(i, poses, velocities);
+        };
+        return reader->num_frames();
+    }
 
-    bool success = true;
-    for (int i = 0; i < state_sequence.size(); i++) {
-        const auto& state = state_sequence[i];
-        std::vector<nlohmann::json> jrbs = state["rigid_bodies"];
-        for (int j = 0; j < jrbs.size(); j++) {
-            VectorMax3d position;
-            VectorMax3d rotation;
-            from_json(jrbs[j]["position"], position);
-            from_json(jrbs[j]["rotation"], rotation);
-            poses[i].emplace_back(position, rotation);
+    // Filtered states only hold some of the bodies (with their scene index)
+    // and fields, so the others keep their last saved (or current) pose.
+    std::shared_ptr<RigidBodyProblem> rbp =
+        std::dynamic_pointer_cast<RigidBodyProblem>(problem_ptr);
+    auto last_poses = std::make_shared<PosesD>();
+    if (rbp != nullptr) {
+        *last_poses = rbp->external_poses(rbp->m_assembler.rb_poses_t1());
+    }
+    read_frame = [this, last_poses](size_t i, PosesD& poses) {
+        if (i >= state_sequence.size()) {
+            return false;
+        }
+        const nlohmann::json state =
+            problem_ptr->state_to_json(state_sequence[i]);
+        const auto& rbs = state["rigid_bodies"];
+        last_poses->resize(std::max(last_poses->size(), rbs.size()));
+        for (size_t k = 0; k < rbs.size(); k++) {
+            const auto& jrb = rbs[k];
+            PoseD& pose = (*last_poses)[jrb.value("id", k)];
+            if (jrb.contains("position")) {
+                from_json(jrb["position"], pose.position);
+            }
+            if (jrb.contains("rotation")) {
+                from_json(jrb["rotation"], pose.rotation);
+            }
+        }
+        poses = *last_poses;
+        return true;
+    };
+    return state_sequence.size();
+}
+
+bool SimState::save_gltf(
+    const std::string& filename,
+    double frame_rate,
+    const GltfSettings& settings)
+{
+    std::shared_ptr<RigidBodyProblem> rbp =
+        std::dynamic_pointer_cast<RigidBodyProblem>(problem_ptr);
+    PoseFrameReader read_frame;
+    const size_t num_saved_frames = saved_frames(read_frame);
+    if (rbp == nullptr || num_saved_frames == 0) {
+        return false;
+    }
+    const size_t stride = frame_stride(problem_ptr->timestep(), frame_rate);
+    const size_t num_frames = (num_saved_frames - 1) / stride + 1;
+
+    // Stream the frames so only one set of poses is in memory at a time.
+    // The saved poses are in the scene's order.
+    GltfStreamWriter writer;
+    PosesD poses;
+    if (!read_frame(0, poses)
+        || !writer.open(
+            filename, rbp->m_assembler, rbp->internal_poses(poses), num_frames,
+            stride * problem_ptr->timestep(), settings)) {
+        return false;
+    }
+    for (size_t i = 0; i < num_frames; i++) {
+        if (!read_frame(i * stride, poses)
+            || !writer.write_frame(rbp->internal_poses(poses))) {
+            break;
         }
     }
+    return writer.close();
+}
 
+size_t SimState::intersecting_frames(
+    std::vector<size_t>& frames, double frame_rate)
+{
+    frames.clear();
     std::shared_ptr<RigidBodyProblem> rbp =
         std::dynamic_pointer_cast<RigidBodyProblem>(problem_ptr);
+    PoseFrameReader read_frame;
+    const size_t num_saved_frames = saved_frames(read_frame);
+    if (rbp == nullptr || num_saved_frames == 0) {
+        return 0;
+    }
+    const size_t stride = frame_stride(problem_ptr->timestep(), frame_rate);
+    const size_t num_frames = (num_saved_frames - 1) / stride + 1;
 
-    return write_gltf(
-        filename, rbp->m_assembler, poses, problem_ptr->timestep());
+    PosesD poses;
+    for (size_t i = 0; i < num_frames; i++) {
+        if (!read_frame(i * stride, poses)) {
+            return i;
+        }
+        bool is_intersecting;
+        execute([&] {
+            is_intersecting =
+                rbp->detect_intersections(rbp->internal_poses(poses));
+        });
+        if (is_intersecting) {
+            frames.push_back(i);
+        }
+    }
+    return num_frames;
+}
+
+bool SimState::save_keyframes(
+    const std::string& filename, const KeyframeSettings& settings)
+{
+    PoseFrameReader read_frame;
+    const size_t num_saved_frames = saved_frames(read_frame);
+    KeyframeSequence keyframes;
+    if (num_saved_frames == 0
+        || !keyframes.compress(
+            problem_ptr->dim(), problem_ptr->num_bodies(), num_saved_frames,
+            problem_ptr->timestep(), read_frame, settings)
+        || !keyframes.write(filename)) {
+        spdlog::error("unable to save keyframes filename={}", filename);
+        return false;
+    }
+    spdlog::info(
+        "saved keyframes filename={} num_frames={:d} num_keyframes={:d} "
+        "num_poses={:d}",
+        filename, keyframes.num_frames(), keyframes.num_keyframes(),
+        keyframes.num_frames() * keyframes.num_bodies());
+    return true;
 }
 
 } // namespace ipc::rigid
@@ -5,11 +5,41 @@
 
 #include <memory> // shared_ptr
 
+#include <tbb/task_arena.h>
+
+#include <ccd/ccd_query_stats.hpp>
+#include <io/keyframe_file.hpp>
+#include <io/metrics_exporter.hpp>
+#include <io/step_metrics_file.hpp>
+#include <io/trajectory_file.hpp>
+#include <io/write_gltf.hpp>
+#include <physics/rigid_body.hpp>
 #include <physics/simulation_problem.hpp>
 #include <solvers/optimization_solver.hpp>
+#include <time_stepper/timestep_controller.hpp>
+#include <utils/async_task_queue.hpp>
 
 namespace ipc::rigid {
 
+/// @brief Common settings of a scene built in code (see SimState::init()).
+struct SimSettings {
+    std::string scene_type = "distance_barrier_rb_problem";
+    std::string solver = "ipc_solver";
+    double timestep = 0.01;
+    /// @brief Maximum number of time-steps (or the time if max_time >= 0).
+    int max_iterations = -1;
+    double max_time = -1;
+    int num_threads = -1;
+    /// @brief Make the parallel reductions independent of the scheduling.
+    bool deterministic = false;
+    Eigen::Vector3d gravity = Eigen::Vector3d::Zero();
+    double coefficient_friction = 0;
+    double coefficient_restitution = 0;
+
+    /// @brief Args of SimState::init() with these settings.
+    nlohmann::json to_json() const;
+};
+
 class SimState {
 public:
     SimState();
@@ -17,18 +47,64 @@ public:
     bool load_scene(const std::string& filename, const std::string& patch = "");
     bool reload_scene();
     bool load_simulation(const nlohmann::json& args);
+    /// @brief Load a saved simulation whose states were read separately.
+    bool load_simulation(
+        const nlohmann::json& args, std::vector<nlohmann::json>&& states);
+    /// @brief Restore a simulation from its latest incremental checkpoint.
+    bool resume_simulation(const std::string& filename);
     bool init(const nlohmann::json& args);
-
+    /// @brief Initialize a scene from bodies built in code (in the scene's
+    /// order), so they are never serialized to JSON and parsed back.
+    ///
+    /// The rigid bodies of the args are ignored. Saved results (and
+    /// checkpoints) include the bodies' meshes so they can be reloaded.
+    bool init(const nlohmann::json& args, std::vector<RigidBody> rbs);
+    bool init(const SimSettings& settings, std::vector<RigidBody> rbs);
+
+    /// @brief Advance one output frame (in substeps if the time-step is
+    /// adaptive).
     void simulation_step();
 
     bool save_simulation(const std::string& filename);
+    /// @brief Snapshot of the args, animation, and stats to save.
+    nlohmann::json simulation_results() const;
+    static bool
+    write_json(const std::string& filename, const nlohmann::json& results);
+    /// @brief Snapshot of the history since the last checkpoint and the
+    /// state needed to restart from this one.
+    nlohmann::json checkpoint_results(const std::string& filename);
     void save_simulation_step();
 
-    bool save_obj_sequence(const std::string& dir_name);
-    bool save_gltf(const std::string& filename);
+    /// @brief Save the saved states (decimated to frame_rate if positive).
+    bool save_obj_sequence(const std::string& dir_name, double frame_rate = -1);
+    bool save_gltf(
+        const std::string& filename,
+        double frame_rate = -1,
+        const GltfSettings& settings = GltfSettings());
+    /// @brief Find the saved states (decimated to frame_rate if positive) in
+    /// which bodies intersect.
+    /// @param[out] frames Indices of the intersecting frames.
+    /// @returns The number of checked frames.
+    size_t
+    intersecting_frames(std::vector<size_t>& frames, double frame_rate = -1);
+    /// @brief Save the poses of the saved states as compressed keyframes.
+    bool save_keyframes(
+        const std::string& filename,
+        const KeyframeSettings& settings = KeyframeSettings());
 
     void run_simulation(const std::string& fout);
 
+    /// @brief Substeps and solver iterations of the last step.
+    int step_num_substeps() const { return m_step_num_substeps; }
+    int step_solver_iterations() const { return m_step_solver_iterations; }
+    /// @brief Time in seconds of the last step.
+    double step_time() const { return step_timer.getElapsedTime(); }
+
+    /// @brief Run every parallel loop of this simulation in an arena of
+    /// num_threads threads (-1 uses the arena of the calling thread).
+    void set_num_threads(int num_threads);
+    int num_threads() const { return m_num_threads; }
+
     const nlohmann::json& get_config() { return args; }
     nlohmann::json get_active_config();
 
@@ -47,17 +123,100 @@ public:
 
     nlohmann::json args;
 
-    std::vector<nlohmann::json> state_sequence;
+    /// @brief Binary states of the saved steps (see
+    /// SimulationProblem::state_into()).
+    std::vector<std::vector<double>> state_sequence;
     std::vector<double> step_timings;
     std::vector<int> solver_iterations;
     std::vector<int> num_contacts;
     std::vector<double> step_minimum_distances;
+    /// @brief StepMetrics of the steps saved since the scene was loaded:
+    /// StepMetrics::NUM_TIMERS times and StepMetrics::NUM_COUNTERS counts
+    /// per step.
+    std::vector<double> step_metric_times;
+    std::vector<uint64_t> step_metric_counts;
+
+    /// @brief Binary trajectory of the simulation (empty if stored in JSON).
+    std::string trajectory_file;
 
 protected:
-    igl::Timer step_timer;
+    bool init(const nlohmann::json& args, std::vector<RigidBody>* rbs);
+
+    /// @brief Args to save with the results (with the meshes of bodies built
+    /// in code).
+    nlohmann::json saved_args() const;
+
+    /// @brief Append JSON states to the binary state sequence (this sets them
+    /// as the state of the problem one after the other).
+    template <typename States> void append_json_states(States&& states);
+    /// @brief JSON of the saved states from the given one on.
+    nlohmann::json json_states(size_t start) const;
+
+    /// @brief Reader of the poses (in the scene's order) of the saved
+    /// frames, from the trajectory file or the saved states.
+    /// @returns The number of saved frames (zero if they cannot be read).
+    size_t saved_frames(PoseFrameReader& read_frame) const;
+
+    /// @brief Advance one frame in substeps sized by the controller.
+    void adaptive_simulation_step();
+    /// @brief Does any body follow scripted poses (one per time-step)?
+    bool has_scripted_poses() const;
+
+    TimestepController m_timestep_controller;
+    /// @brief Output frame period and the controller's current step size.
+    double m_frame_timestep = 0;
+    double m_adaptive_timestep = 0;
+    /// @brief Substeps and solver iterations of the last frame.
+    int m_step_num_substeps = 1;
+    int m_step_solver_iterations = 0;
+    int m_step_line_search_failures = 0;
+
+    /// @brief Append the current poses and velocities to the trajectory.
+    bool write_trajectory_frame();
+
+    TrajectoryWriter m_trajectory_writer;
+    /// @brief Whether each step is appended to the trajectory file.
+    bool m_is_streaming_trajectory = false;
+    /// @brief Append the record of the last step to the metrics file and
+    /// publish it to the metrics exporter.
+    void write_step_metrics(nlohmann::json record);
+    /// @brief Per-step metrics as JSON lines or CSV.
+    StepMetricsWriter m_metrics_writer;
+    bool m_is_writing_metrics = false;
+    /// @brief Live per-step metrics for monitoring (Prometheus or StatsD).
+    MetricsExporter m_metrics_exporter;
+    /// @brief Narrow-phase CCD statistics summed over the steps.
+    CCDQueryStats::Summary m_ccd_query_stats;
+
+    /// @brief Run the function in this simulation's arena (if it has one).
+    template <typename Func> void execute(const Func& func)
+    {
+        if (m_arena != nullptr) {
+            m_arena->execute(func);
+        } else {
+            func();
+        }
+    }
+
+    int m_num_threads = -1;
+    std::unique_ptr<tbb::task_arena> m_arena;
+
+    /// @brief Background writer used while running headless simulations.
+    std::unique_ptr<AsyncTaskQueue> m_io_queue;
+
+    /// @brief Number of states and steps already saved in checkpoints.
+    size_t m_num_checkpointed_states = 0;
+    size_t m_num_checkpointed_steps = 0;
+    std::string m_last_checkpoint_file;
+    /// @brief Continue from m_num_simulation_steps in run_simulation.
+    bool m_is_resuming = false;
+    /// @brief Mutable because igl::Timer reads the elapsed time non-const.
+    mutable igl::Timer step_timer;
     size_t initial_rss;
 
     bool m_dirty_constraints;
+    /// @brief Were the bodies built in code instead of read from the args?
+    bool m_has_built_bodies = false;
 };
 
 } // namespace ipc::rigid
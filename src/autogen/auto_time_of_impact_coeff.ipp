@@ -32,5 +32,32 @@ namespace autogen {
             - Vj[0] * Vk[1] + Vj[1] * Vk[0];
     }
 
+    inline void time_of_impact_coeffs(
+        const Eigen::ArrayX2d& Vi,
+        const Eigen::ArrayX2d& Vj,
+        const Eigen::ArrayX2d& Vk,
+        const Eigen::ArrayX2d& Ui,
+        const Eigen::ArrayX2d& Uj,
+        const Eigen::ArrayX2d& Uk,
+        Eigen::ArrayXd& a,
+        Eigen::ArrayXd& b,
+        Eigen::ArrayXd& c)
+    {
+        // DO NOT MODIFY THIS FILE. See src/autogen/.tpp for originals.
+
+        a = -Ui.col(0) * Uj.col(1) + Ui.col(0) * Uk.col(1)
+            + Ui.col(1) * Uj.col(0) - Ui.col(1) * Uk.col(0)
+            - Uj.col(0) * Uk.col(1) + Uj.col(1) * Uk.col(0);
+        b = -Ui.col(0) * Vj.col(1) + Ui.col(0) * Vk.col(1)
+            + Ui.col(1) * Vj.col(0) - Ui.col(1) * Vk.col(0)
+            + Uj.col(0) * Vi.col(1) - Uj.col(0) * Vk.col(1)
+            - Uj.col(1) * Vi.col(0) + Uj.col(1) * Vk.col(0)
+            - Uk.col(0) * Vi.col(1) + Uk.col(0) * Vj.col(1)
+            + Uk.col(1) * Vi.col(0) - Uk.col(1) * Vj.col(0);
+        c = -Vi.col(0) * Vj.col(1) + Vi.col(0) * Vk.col(1)
+            + Vi.col(1) * Vj.col(0) - Vi.col(1) * Vk.col(0)
+            - Vj.col(0) * Vk.col(1) + Vj.col(1) * Vk.col(0);
+    }
+
 } // namespace autogen
 } // namespace ipc::rigid
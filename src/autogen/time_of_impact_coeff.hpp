@@ -20,6 +20,23 @@ namespace autogen {
         T& b,
         T& c);
 
+    /// @brief Coefficients of many candidates at once.
+    ///
+    /// The inputs are structure-of-arrays (one row per candidate, one column
+    /// per coordinate), so every coefficient is a coefficient-wise array
+    /// expression that Eigen vectorizes. Unlike the scalar double version the
+    /// coefficients are not normalized.
+    inline void time_of_impact_coeffs(
+        const Eigen::ArrayX2d& Vi,
+        const Eigen::ArrayX2d& Vj,
+        const Eigen::ArrayX2d& Vk,
+        const Eigen::ArrayX2d& Ui,
+        const Eigen::ArrayX2d& Uj,
+        const Eigen::ArrayX2d& Uk,
+        Eigen::ArrayXd& a,
+        Eigen::ArrayXd& b,
+        Eigen::ArrayXd& c);
+
     template <>
     inline void time_of_impact_coeff<double>(
         const Eigen::Vector2d& Vi,
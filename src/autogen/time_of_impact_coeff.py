@@ -72,10 +72,23 @@ def autogen_function():
     V, V_vec = vec2_symbols(prefix_pos)
     U, U_vec = vec2_symbols(prefix_vel)
 
-    toi_abc_code = [short_message] + toi_formula(V_vec, U_vec)
-    toi_abc_code = '\n'.join(toi_abc_code)
-
-    return dict(toi_abc_ccode=toi_abc_code)
+    toi_abc_lines = toi_formula(V_vec, U_vec)
+    toi_abc_code = '\n'.join([short_message] + toi_abc_lines)
+    toi_abc_batch_code = '\n'.join(
+        [short_message] + [soa_line(line) for line in toi_abc_lines])
+
+    return dict(toi_abc_ccode=toi_abc_code,
+                toi_abc_batch_ccode=toi_abc_batch_code)
+
+
+def soa_line(line):
+    """
+    Rewrite a scalar line for structure-of-arrays inputs (one row per
+    candidate), so X[d] becomes the column X.col(d) and the products are
+    evaluated coefficient-wise by Eigen.
+    """
+    line = line.replace("const auto", "const Eigen::ArrayXd")
+    return re.sub(r"\b([VU][i-l])\[(\d)\]", r"\1.col(\2)", line)
 
 
 def main(args=None):
@@ -24,5 +24,19 @@ namespace autogen {
         // {{toi_abc_ccode}}
     }
 
+    inline void time_of_impact_coeffs(
+        const Eigen::ArrayX2d& Vi,
+        const Eigen::ArrayX2d& Vj,
+        const Eigen::ArrayX2d& Vk,
+        const Eigen::ArrayX2d& Ui,
+        const Eigen::ArrayX2d& Uj,
+        const Eigen::ArrayX2d& Uk,
+        Eigen::ArrayXd& a,
+        Eigen::ArrayXd& b,
+        Eigen::ArrayXd& c)
+    {
+        // {{toi_abc_batch_ccode}}
+    }
+
 } // namespace autogen
 } // namespace ipc::rigid
@@ -1,19 +1,29 @@
 #include "ccd.hpp"
 
-#include <mutex>
+#include <algorithm>
+#include <numeric>
+#include <tuple>
 
+#include <tbb/blocked_range.h>
+#include <tbb/enumerable_thread_specific.h>
 #include <tbb/parallel_for.h>
-#include <tbb/parallel_for_each.h>
-#include <tbb/parallel_invoke.h>
+#include <tbb/parallel_sort.h>
 
 #include <ipc/ccd/ccd.hpp>
+#include <ipc/distance/edge_edge.hpp>
+#include <ipc/distance/point_edge.hpp>
+#include <ipc/distance/point_triangle.hpp>
 #include <ipc/friction/closest_point.hpp>
 
+#include <ccd/ccd_query_log.hpp>
+#include <ccd/ccd_query_stats.hpp>
+#include <ccd/conservative_advancement/time_of_impact.hpp>
 #include <ccd/linear/broad_phase.hpp>
 #include <ccd/linear/edge_vertex_ccd.hpp>
 #include <ccd/piecewise_linear/time_of_impact.hpp>
 #include <ccd/redon/time_of_impact.hpp>
 #include <ccd/rigid/broad_phase.hpp>
+#include <ccd/rigid/rigid_trajectory_aabb.hpp>
 #include <ccd/rigid/time_of_impact.hpp>
 
 // #define SAVE_CCD_QUERIES
@@ -22,6 +32,10 @@
 #endif
 
 #include <profiler.hpp>
+#include <tracer.hpp>
+#include <utils/memory_usage.hpp>
+#include <utils/parallel_loop_tuner.hpp>
+#include <utils/step_metrics.hpp>
 
 namespace ipc::rigid {
 
@@ -32,20 +46,23 @@ void detect_collisions(
     const int collision_types,
     Impacts& impacts,
     DetectionMethod method,
-    TrajectoryType trajectory)
+    TrajectoryType trajectory,
+    bool deterministic)
 {
     assert(bodies.num_bodies() == poses_t0.size());
     assert(poses_t0.size() == poses_t1.size());
 
     // Do the broad phase by detecting candidate impacts
-    Candidates candidates;
+    const auto candidates = acquire_candidates();
     detect_collision_candidates(
-        bodies, poses_t0, poses_t1, collision_types, candidates, method,
-        trajectory);
+        bodies, poses_t0, poses_t1, collision_types, *candidates, method,
+        trajectory, /*inflation_radius=*/0.0, /*separation_cache=*/nullptr,
+        /*hash_grid=*/nullptr, deterministic);
 
     // Do the narrow phase by detecting actual impacts from the candidate set
     detect_collisions_from_candidates(
-        bodies, poses_t0, poses_t1, candidates, impacts, trajectory);
+        bodies, poses_t0, poses_t1, *candidates, impacts, trajectory,
+        deterministic);
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -60,12 +77,21 @@ void detect_collision_candidates(
     Candidates& candidates,
     DetectionMethod method,
     TrajectoryType trajectory,
-    const double inflation_radius)
+    const double inflation_radius,
+    BodyPairSeparationCache* separation_cache,
+    RigidBodyHashGrid* hash_grid,
+    bool deterministic)
 {
     if (bodies.m_rbs.size() <= 1) {
         return;
     }
 
+    TRACE_SCOPE("broad_phase");
+    StepMetrics::ScopedTimer timer(StepMetrics::BROAD_PHASE);
+    const size_t num_ev = candidates.ev_candidates.size();
+    const size_t num_ee = candidates.ee_candidates.size();
+    const size_t num_fv = candidates.fv_candidates.size();
+
     switch (trajectory) {
     case TrajectoryType::LINEAR:
         detect_collision_candidates_linear(
@@ -75,83 +101,376 @@ void detect_collision_candidates(
     case TrajectoryType::PIECEWISE_LINEAR:
     case TrajectoryType::RIGID:
     case TrajectoryType::REDON:
-        detect_collision_candidates_rigid(
-            bodies, poses_t0, poses_t1, collision_types, candidates, method,
-            inflation_radius);
+    case TrajectoryType::CONSERVATIVE_ADVANCEMENT:
+        if (method == DetectionMethod::BVH && separation_cache != nullptr) {
+            detect_collision_candidates_rigid_bvh(
+                bodies, poses_t0, poses_t1, collision_types, candidates,
+                *separation_cache, inflation_radius);
+        } else if (
+            method == DetectionMethod::HASH_GRID && hash_grid != nullptr) {
+            detect_collision_candidates_rigid_hash_grid(
+                bodies, poses_t0, poses_t1, collision_types, candidates,
+                *hash_grid, inflation_radius);
+        } else {
+            detect_collision_candidates_rigid(
+                bodies, poses_t0, poses_t1, collision_types, candidates,
+                method, inflation_radius);
+        }
         break;
     }
+    remove_distance_field_separated_candidates(
+        bodies, poses_t0, poses_t1, candidates, inflation_radius);
+    if (deterministic) {
+        // Order the candidates by their primitives instead of their threads
+        sort_candidates(candidates);
+    }
+
+    StepMetrics::add_count(
+        StepMetrics::EV_CANDIDATES, candidates.ev_candidates.size() - num_ev);
+    StepMetrics::add_count(
+        StepMetrics::EE_CANDIDATES, candidates.ee_candidates.size() - num_ee);
+    StepMetrics::add_count(
+        StepMetrics::FV_CANDIDATES, candidates.fv_candidates.size() - num_fv);
+    MemoryUsage::set_bytes(
+        MemoryUsage::CANDIDATES,
+        MemoryUsage::bytes_of(candidates.ev_candidates)
+            + MemoryUsage::bytes_of(candidates.ee_candidates)
+            + MemoryUsage::bytes_of(candidates.fv_candidates));
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 // Broad-Phase CCD
 ///////////////////////////////////////////////////////////////////////////////
 
+namespace {
+    /// @brief Concatenate the thread-local impacts in parallel, each copied
+    /// to the offset given by the prefix sum of the sizes before it.
+    template <typename Impact>
+    void concatenate_impacts(
+        const std::vector<const std::vector<Impact>*>& local_impacts,
+        std::vector<Impact>& impacts)
+    {
+        std::vector<size_t> offsets(local_impacts.size() + 1, 0);
+        for (size_t i = 0; i < local_impacts.size(); i++) {
+            offsets[i + 1] = offsets[i] + local_impacts[i]->size();
+        }
+        if (offsets.back() == 0) {
+            return;
+        }
+
+        // Impacts are not default constructible, so fill with any impact
+        const auto nonempty = std::find_if(
+            local_impacts.begin(), local_impacts.end(),
+            [](const std::vector<Impact>* v) { return !v->empty(); });
+        impacts.resize(offsets.back(), (*nonempty)->front());
+
+        tbb::parallel_for(size_t(0), local_impacts.size(), [&](size_t i) {
+            std::copy(
+                local_impacts[i]->begin(), local_impacts[i]->end(),
+                impacts.begin() + offsets[i]);
+        });
+    }
+} // namespace
+
+namespace {
+    /// @brief Indices of the candidates (indexed as [ev, ee, fv]) sorted by
+    /// their unordered body pair, so the queries of a pair are consecutive.
+    std::vector<size_t> group_candidates_by_body_pair(
+        const RigidBodyAssembler& bodies, const Candidates& candidates)
+    {
+        const size_t num_ev = candidates.ev_candidates.size();
+        const size_t num_ee = candidates.ee_candidates.size();
+        std::vector<std::pair<long, long>> body_pairs(
+            num_ev + num_ee + candidates.fv_candidates.size());
+        tbb::parallel_for(size_t(0), body_pairs.size(), [&](size_t i) {
+            long bodyA_id, bodyB_id, local_id;
+            if (i < num_ev) {
+                const EdgeVertexCandidate& c = candidates.ev_candidates[i];
+                bodies.global_to_local_vertex(
+                    c.vertex_index, bodyA_id, local_id);
+                bodies.global_to_local_edge(c.edge_index, bodyB_id, local_id);
+            } else if (i - num_ev < num_ee) {
+                const EdgeEdgeCandidate& c =
+                    candidates.ee_candidates[i - num_ev];
+                bodies.global_to_local_edge(c.edge0_index, bodyA_id, local_id);
+                bodies.global_to_local_edge(c.edge1_index, bodyB_id, local_id);
+            } else {
+                const FaceVertexCandidate& c =
+                    candidates.fv_candidates[i - num_ev - num_ee];
+                bodies.global_to_local_vertex(
+                    c.vertex_index, bodyA_id, local_id);
+                bodies.global_to_local_face(c.face_index, bodyB_id, local_id);
+            }
+            body_pairs[i] = std::minmax(bodyA_id, bodyB_id);
+        });
+
+        std::vector<size_t> order(body_pairs.size());
+        std::iota(order.begin(), order.end(), 0);
+        tbb::parallel_sort(order.begin(), order.end(), [&](size_t i, size_t j) {
+            return std::tie(body_pairs[i], i) < std::tie(body_pairs[j], j);
+        });
+        return order;
+    }
+} // namespace
+
 void detect_collisions_from_candidates(
     const RigidBodyAssembler& bodies,
     const PosesD& poses_t0,
     const PosesD& poses_t1,
     const Candidates& candidates,
     Impacts& impacts,
-    TrajectoryType trajectory)
+    TrajectoryType trajectory,
+    bool deterministic)
 {
     PROFILE_POINT("collisions_detection__narrow_phase");
     PROFILE_START();
-
-    std::mutex ev_impacts_mutex, ee_impacts_mutex, fv_impacts_mutex;
-
-    auto ev_impact = [&](const EdgeVertexCandidate& ev_candidate) {
+    TRACE_SCOPE("narrow_phase");
+    StepMetrics::ScopedTimer timer(StepMetrics::NARROW_PHASE);
+
+    // Each thread appends to its own impacts, so the kernels never lock.
+    tbb::enumerable_thread_specific<Impacts> storages;
+
+    const std::vector<EdgeVertexCandidate>& ev = candidates.ev_candidates;
+    auto ev_impact = [&](size_t i, BodyTrajectoryCaches& trajectories) {
+        TRACE_SCOPE("narrow_phase::ev");
+        const EdgeVertexCandidate& ev_candidate = ev[i];
+        long bodyA_id, vertex_id, bodyB_id, edge_id;
+        bodies.global_to_local_vertex(
+            ev_candidate.vertex_index, bodyA_id, vertex_id);
+        bodies.global_to_local_edge(ev_candidate.edge_index, bodyB_id, edge_id);
         double toi;
         bool is_colliding = edge_vertex_ccd(
-            bodies, poses_t0, poses_t1, ev_candidate, toi, trajectory);
+            bodies, poses_t0, poses_t1, bodyA_id, vertex_id, bodyB_id, edge_id,
+            toi, trajectory, /*earliest_toi=*/1,
+            /*minimum_separation_distance=*/0, &trajectories);
         if (is_colliding) {
             double alpha = edge_vertex_closest_point(
                 bodies, poses_t0, poses_t1, ev_candidate, toi, trajectory);
-            std::scoped_lock lock(ev_impacts_mutex);
-            impacts.ev_impacts.emplace_back(
+            storages.local().ev_impacts.emplace_back(
                 toi, ev_candidate.edge_index, alpha, ev_candidate.vertex_index);
         }
     };
 
-    auto ee_impact = [&](const EdgeEdgeCandidate& ee_candidate) {
+    // Linear edge-vertex queries of a range are solved together over a
+    // structure-of-arrays copy of their end points (the query log records
+    // the queries one at a time, so it keeps the scalar path).
+    const bool is_ev_batched =
+        trajectory == TrajectoryType::LINEAR && !CCDQueryLog::is_enabled();
+    auto ev_impacts_linear = [&](size_t begin, size_t end) {
+        TRACE_SCOPE("narrow_phase::ev_batch");
+        const long n = end - begin;
+        Eigen::ArrayX2d Vi(n, 2), Vj(n, 2), Vk(n, 2);
+        Eigen::ArrayX2d Ui(n, 2), Uj(n, 2), Uk(n, 2);
+        const auto set_trajectory = [&](long body_id, long vertex_id,
+                                        Eigen::ArrayX2d& V, Eigen::ArrayX2d& U,
+                                        long k) {
+            const RigidBody& body = bodies[body_id];
+            const VectorMax3d v_t0 =
+                body.world_vertex(poses_t0[body_id], vertex_id);
+            const VectorMax3d v_t1 =
+                body.world_vertex(poses_t1[body_id], vertex_id);
+            V.row(k) = v_t0.transpose().array();
+            U.row(k) = (v_t1 - v_t0).transpose().array();
+        };
+        for (long k = 0; k < n; k++) {
+            const EdgeVertexCandidate& ev_candidate = ev[begin + k];
+            long bodyA_id, vertex_id, bodyB_id, edge_id;
+            bodies.global_to_local_vertex(
+                ev_candidate.vertex_index, bodyA_id, vertex_id);
+            bodies.global_to_local_edge(
+                ev_candidate.edge_index, bodyB_id, edge_id);
+            const RigidBody& bodyB = bodies[bodyB_id];
+            set_trajectory(bodyB_id, bodyB.edges(edge_id, 0), Vi, Ui, k);
+            set_trajectory(bodyB_id, bodyB.edges(edge_id, 1), Vj, Uj, k);
+            set_trajectory(bodyA_id, vertex_id, Vk, Uk, k);
+        }
+        StepMetrics::add_count(StepMetrics::NARROW_PHASE_QUERIES, n);
+
+        Eigen::ArrayXd toi, alpha;
+        ArrayXb is_impacting;
+        compute_edge_vertex_time_of_impacts(
+            Vi, Vj, Vk, Ui, Uj, Uk, toi, alpha, is_impacting);
+
+        for (long k = 0; k < n; k++) {
+            if (!is_impacting(k)) {
+                continue;
+            }
+            const EdgeVertexCandidate& ev_candidate = ev[begin + k];
+            // Same closest point as the scalar path
+            double closest_alpha = edge_vertex_closest_point(
+                bodies, poses_t0, poses_t1, ev_candidate, toi(k), trajectory);
+            storages.local().ev_impacts.emplace_back(
+                toi(k), ev_candidate.edge_index, closest_alpha,
+                ev_candidate.vertex_index);
+        }
+    };
+
+    const std::vector<EdgeEdgeCandidate>& ee = candidates.ee_candidates;
+    auto ee_impact = [&](size_t i, BodyTrajectoryCaches& trajectories) {
+        TRACE_SCOPE("narrow_phase::ee");
+        const EdgeEdgeCandidate& ee_candidate = ee[i];
+        long bodyA_id, edgeA_id, bodyB_id, edgeB_id;
+        bodies.global_to_local_edge(
+            ee_candidate.edge0_index, bodyA_id, edgeA_id);
+        bodies.global_to_local_edge(
+            ee_candidate.edge1_index, bodyB_id, edgeB_id);
         double toi;
         bool is_colliding = edge_edge_ccd(
-            bodies, poses_t0, poses_t1, ee_candidate, toi, trajectory);
+            bodies, poses_t0, poses_t1, bodyA_id, edgeA_id, bodyB_id, edgeB_id,
+            toi, trajectory, /*earliest_toi=*/1,
+            /*minimum_separation_distance=*/0, &trajectories,
+            /*find_any_root=*/false, /*relative_toi_tolerance=*/0,
+            deterministic);
         if (is_colliding) {
             double alpha, beta;
             edge_edge_closest_point(
                 bodies, poses_t0, poses_t1, ee_candidate, toi, alpha, beta,
                 trajectory);
-            std::scoped_lock lock(ee_impacts_mutex);
-            impacts.ee_impacts.emplace_back(
+            storages.local().ee_impacts.emplace_back(
                 toi, ee_candidate.edge0_index, alpha, ee_candidate.edge1_index,
                 beta);
         }
     };
 
-    auto fv_impact = [&](const FaceVertexCandidate& fv_candidate) {
+    const std::vector<FaceVertexCandidate>& fv = candidates.fv_candidates;
+    auto fv_impact = [&](size_t i, BodyTrajectoryCaches& trajectories) {
+        TRACE_SCOPE("narrow_phase::fv");
+        const FaceVertexCandidate& fv_candidate = fv[i];
+        long bodyA_id, vertex_id, bodyB_id, face_id;
+        bodies.global_to_local_vertex(
+            fv_candidate.vertex_index, bodyA_id, vertex_id);
+        bodies.global_to_local_face(fv_candidate.face_index, bodyB_id, face_id);
         double toi;
         bool is_colliding = face_vertex_ccd(
-            bodies, poses_t0, poses_t1, fv_candidate, toi, trajectory);
+            bodies, poses_t0, poses_t1, bodyA_id, vertex_id, bodyB_id, face_id,
+            toi, trajectory, /*earliest_toi=*/1,
+            /*minimum_separation_distance=*/0, &trajectories,
+            /*find_any_root=*/false, /*relative_toi_tolerance=*/0,
+            deterministic);
         if (is_colliding) {
             double u, v;
             face_vertex_closest_point(
                 bodies, poses_t0, poses_t1, fv_candidate, toi, u, v,
                 trajectory);
-            std::scoped_lock lock(fv_impacts_mutex);
-            impacts.fv_impacts.emplace_back(
+            storages.local().fv_impacts.emplace_back(
                 toi, fv_candidate.face_index, u, v, fv_candidate.vertex_index);
         }
     };
 
+    // Rigid queries of a body pair share the interval trajectories of the
+    // two bodies, so they are visited grouped by body pair.
+    const bool is_grouped = trajectory == TrajectoryType::RIGID;
+    const std::vector<size_t> order = is_grouped
+        ? group_candidates_by_body_pair(bodies, candidates)
+        : std::vector<size_t>();
+
+    // Do a single block range over all three candidate arrays, so the
+    // scheduler balances the work across candidate types.
+    // Larger chunks share more trajectories, so the grain size is tuned.
+    static ParallelLoopTuner narrow_phase_loop;
+    const size_t num_ev = ev.size(), num_ee = ee.size();
+    narrow_phase_loop.parallel_for(
+        num_ev + num_ee + fv.size(), [&](const tbb::blocked_range<size_t>& r) {
+            BodyTrajectoryCaches trajectories(bodies, poses_t0, poses_t1);
+            size_t k = r.begin();
+            if (is_ev_batched && k < num_ev) {
+                k = std::min(r.end(), num_ev);
+                ev_impacts_linear(r.begin(), k);
+            }
+            for (; k < r.end(); k++) {
+                const size_t i = is_grouped ? order[k] : k;
+                if (i < num_ev) {
+                    ev_impact(i, trajectories);
+                } else if (i - num_ev < num_ee) {
+                    ee_impact(i - num_ev, trajectories);
+                } else {
+                    fv_impact(i - num_ev - num_ee, trajectories);
+                }
+            }
+        });
+
     impacts.clear();
-    tbb::parallel_invoke(
-        [&] { tbb::parallel_for_each(candidates.ev_candidates, ev_impact); },
-        [&] { tbb::parallel_for_each(candidates.ee_candidates, ee_impact); },
-        [&] { tbb::parallel_for_each(candidates.fv_candidates, fv_impact); });
+    std::vector<const std::vector<EdgeVertexImpact>*> local_ev_impacts;
+    std::vector<const std::vector<EdgeEdgeImpact>*> local_ee_impacts;
+    std::vector<const std::vector<FaceVertexImpact>*> local_fv_impacts;
+    for (const Impacts& local_impacts : storages) {
+        local_ev_impacts.push_back(&local_impacts.ev_impacts);
+        local_ee_impacts.push_back(&local_impacts.ee_impacts);
+        local_fv_impacts.push_back(&local_impacts.fv_impacts);
+    }
+    concatenate_impacts(local_ev_impacts, impacts.ev_impacts);
+    concatenate_impacts(local_ee_impacts, impacts.ee_impacts);
+    concatenate_impacts(local_fv_impacts, impacts.fv_impacts);
+    if (deterministic) {
+        // Order the impacts by their primitives instead of their threads
+        tbb::parallel_sort(
+            impacts.ev_impacts.begin(), impacts.ev_impacts.end(),
+            [](const EdgeVertexImpact& a, const EdgeVertexImpact& b) {
+                return std::tie(a.edge_index, a.vertex_index, a.time)
+                    < std::tie(b.edge_index, b.vertex_index, b.time);
+            });
+        tbb::parallel_sort(
+            impacts.ee_impacts.begin(), impacts.ee_impacts.end(),
+            [](const EdgeEdgeImpact& a, const EdgeEdgeImpact& b) {
+                return std::tie(
+                           a.impacted_edge_index, a.impacting_edge_index,
+                           a.time)
+                    < std::tie(
+                           b.impacted_edge_index, b.impacting_edge_index,
+                           b.time);
+            });
+        tbb::parallel_sort(
+            impacts.fv_impacts.begin(), impacts.fv_impacts.end(),
+            [](const FaceVertexImpact& a, const FaceVertexImpact& b) {
+                return std::tie(a.face_index, a.vertex_index, a.time)
+                    < std::tie(b.face_index, b.vertex_index, b.time);
+            });
+    }
 
     PROFILE_END();
 }
 
+double max_trajectory_displacement(
+    const PoseD& pose_t0, const PoseD& pose_t1, double r_max)
+{
+    // The rotation vector is interpolated linearly and the exponential map
+    // is 1-Lipschitz, so R(t) v moves at most ‖r₁ - r₀‖ ‖v‖.
+    return (pose_t1.position - pose_t0.position).norm()
+        + (pose_t1.rotation - pose_t0.rotation).norm() * r_max;
+}
+
+namespace {
+    /// @brief Check if two primitives at distance_t0 provably stay farther
+    /// than the minimum separation distance over the step.
+    /// Only rigid (and piecewise linear) trajectories are filtered, because
+    /// their exact CCD is expensive.
+    bool is_separated_over_step(
+        double distance_t0,
+        const RigidBody& bodyA,
+        const PoseD& poseA_t0,
+        const PoseD& poseA_t1,
+        const RigidBody& bodyB,
+        const PoseD& poseB_t0,
+        const PoseD& poseB_t1,
+        double minimum_separation_distance)
+    {
+        const bool is_separated = distance_t0
+            > max_trajectory_displacement(poseA_t0, poseA_t1, bodyA.r_max)
+                + max_trajectory_displacement(poseB_t0, poseB_t1, bodyB.r_max)
+                + minimum_separation_distance;
+        if (is_separated) {
+            StepMetrics::add_count(StepMetrics::CCD_PREFILTER_REJECTIONS);
+        }
+        return is_separated;
+    }
+
+    bool is_prefiltered(TrajectoryType trajectory)
+    {
+        return trajectory == TrajectoryType::RIGID
+            || trajectory == TrajectoryType::PIECEWISE_LINEAR;
+    }
+} // namespace
+
 // Determine if a single edge-vertext pair intersects.
 bool edge_vertex_ccd(
     const RigidBodyAssembler& bodies,
@@ -161,10 +480,10 @@ bool edge_vertex_ccd(
     double& toi,
     TrajectoryType trajectory,
     double earliest_toi,
-    double minimum_separation_distance)
+    double minimum_separation_distance,
+    bool find_any_root,
+    double relative_toi_tolerance)
 {
-    assert(bodies.dim() == 2);
-
 #ifdef SAVE_CCD_QUERIES
     save_ccd_candidate(bodies, poses_t0, poses_t1, candidate);
 #endif
@@ -172,6 +491,32 @@ bool edge_vertex_ccd(
     long bodyA_id, vertex_id, bodyB_id, edge_id;
     bodies.global_to_local_vertex(candidate.vertex_index, bodyA_id, vertex_id);
     bodies.global_to_local_edge(candidate.edge_index, bodyB_id, edge_id);
+
+    return edge_vertex_ccd(
+        bodies, poses_t0, poses_t1, bodyA_id, vertex_id, bodyB_id, edge_id,
+        toi, trajectory, earliest_toi, minimum_separation_distance,
+        /*trajectories=*/nullptr, find_any_root, relative_toi_tolerance);
+}
+
+// Compute the time of impact of an edge-vertex query.
+bool edge_vertex_toi(
+    const RigidBodyAssembler& bodies,
+    const PosesD& poses_t0,
+    const PosesD& poses_t1,
+    long bodyA_id,
+    long vertex_id,
+    long bodyB_id,
+    long edge_id,
+    double& toi,
+    TrajectoryType trajectory,
+    double earliest_toi,
+    double minimum_separation_distance,
+    BodyTrajectoryCaches* trajectories,
+    bool find_any_root,
+    double relative_toi_tolerance)
+{
+    assert(bodies.dim() == 2);
+
     const RigidBody& bodyA = bodies[bodyA_id];
     const RigidBody& bodyB = bodies[bodyB_id];
     const PoseD& poseA_t0 = poses_t0[bodyA_id];
@@ -181,6 +526,19 @@ bool edge_vertex_ccd(
     long e0_id = bodyB.edges(edge_id, 0);
     long e1_id = bodyB.edges(edge_id, 1);
 
+    if (is_prefiltered(trajectory)) {
+        double distance_t0 = sqrt(point_edge_distance(
+            bodyA.world_vertex(poseA_t0, vertex_id),
+            bodyB.world_vertex(poseB_t0, e0_id),
+            bodyB.world_vertex(poseB_t0, e1_id)));
+        if (is_separated_over_step(
+                distance_t0, bodyA, poseA_t0, poseA_t1, bodyB, poseB_t0,
+                poseB_t1, minimum_separation_distance)) {
+            toi = std::numeric_limits<double>::infinity();
+            return false;
+        }
+    }
+
     switch (trajectory) {
     case TrajectoryType::LINEAR: {
         Eigen::Vector2d v_t0 = bodyA.world_vertex(poseA_t0, vertex_id);
@@ -206,18 +564,56 @@ bool edge_vertex_ccd(
     case TrajectoryType::RIGID:
         return compute_edge_vertex_time_of_impact(
             bodyA, poseA_t0, poseA_t1, vertex_id, bodyB, poseB_t0, poseB_t1,
-            edge_id, toi, earliest_toi);
+            edge_id, toi, earliest_toi, Constants::RIGID_CCD_TOI_TOL,
+            trajectories ? &trajectories->poses(bodyA_id) : nullptr,
+            trajectories ? &trajectories->poses(bodyB_id) : nullptr,
+            find_any_root, relative_toi_tolerance);
 
     case TrajectoryType::REDON:
         return compute_edge_vertex_time_of_impact_redon(
             bodyA, poseA_t0, poseA_t1, vertex_id, bodyB, poseB_t0, poseB_t1,
             edge_id, toi, earliest_toi);
 
+    case TrajectoryType::CONSERVATIVE_ADVANCEMENT:
+        return compute_conservative_advancement_edge_vertex_time_of_impact(
+            bodyA, poseA_t0, poseA_t1, vertex_id, bodyB, poseB_t0, poseB_t1,
+            edge_id, toi, earliest_toi, minimum_separation_distance);
+
     default:
         throw "Invalid trajectory type";
     }
 }
 
+bool edge_vertex_ccd(
+    const RigidBodyAssembler& bodies,
+    const PosesD& poses_t0,
+    const PosesD& poses_t1,
+    long bodyA_id,
+    long vertex_id,
+    long bodyB_id,
+    long edge_id,
+    double& toi,
+    TrajectoryType trajectory,
+    double earliest_toi,
+    double minimum_separation_distance,
+    BodyTrajectoryCaches* trajectories,
+    bool find_any_root,
+    double relative_toi_tolerance)
+{
+    StepMetrics::add_count(StepMetrics::NARROW_PHASE_QUERIES);
+    if (CCDQueryLog::is_enabled()) {
+        CCDQueryLog::record_edge_vertex(
+            bodies, poses_t0, poses_t1, bodyA_id, vertex_id, bodyB_id, edge_id,
+            earliest_toi, minimum_separation_distance);
+    }
+
+    CCDQueryStats::ScopedQuery query(CCDQueryType::EDGE_VERTEX, toi);
+    return query.finish(edge_vertex_toi(
+        bodies, poses_t0, poses_t1, bodyA_id, vertex_id, bodyB_id, edge_id, toi,
+        trajectory, earliest_toi, minimum_separation_distance, trajectories,
+        find_any_root, relative_toi_tolerance));
+}
+
 bool edge_edge_ccd(
     const RigidBodyAssembler& bodies,
     const PosesD& poses_t0,
@@ -226,7 +622,10 @@ bool edge_edge_ccd(
     double& toi,
     TrajectoryType trajectory,
     double earliest_toi,
-    double minimum_separation_distance)
+    double minimum_separation_distance,
+    bool find_any_root,
+    double relative_toi_tolerance,
+    bool deterministic)
 {
 #ifdef SAVE_CCD_QUERIES
     save_ccd_candidate(bodies, poses_t0, poses_t1, candidate);
@@ -235,6 +634,32 @@ bool edge_edge_ccd(
     long bodyA_id, edgeA_id, bodyB_id, edgeB_id;
     bodies.global_to_local_edge(candidate.edge0_index, bodyA_id, edgeA_id);
     bodies.global_to_local_edge(candidate.edge1_index, bodyB_id, edgeB_id);
+
+    return edge_edge_ccd(
+        bodies, poses_t0, poses_t1, bodyA_id, edgeA_id, bodyB_id, edgeB_id,
+        toi, trajectory, earliest_toi, minimum_separation_distance,
+        /*trajectories=*/nullptr, find_any_root, relative_toi_tolerance,
+        deterministic);
+}
+
+// Compute the time of impact of an edge-edge query.
+bool edge_edge_toi(
+    const RigidBodyAssembler& bodies,
+    const PosesD& poses_t0,
+    const PosesD& poses_t1,
+    long bodyA_id,
+    long edgeA_id,
+    long bodyB_id,
+    long edgeB_id,
+    double& toi,
+    TrajectoryType trajectory,
+    double earliest_toi,
+    double minimum_separation_distance,
+    BodyTrajectoryCaches* trajectories,
+    bool find_any_root,
+    double relative_toi_tolerance,
+    bool deterministic)
+{
     const RigidBody& bodyA = bodies[bodyA_id];
     const RigidBody& bodyB = bodies[bodyB_id];
     const PoseD& poseA_t0 = poses_t0[bodyA_id];
@@ -246,6 +671,20 @@ bool edge_edge_ccd(
     long eb0_id = bodyB.edges(edgeB_id, 0);
     long eb1_id = bodyB.edges(edgeB_id, 1);
 
+    if (is_prefiltered(trajectory)) {
+        double distance_t0 = sqrt(edge_edge_distance(
+            bodyA.world_vertex(poseA_t0, ea0_id),
+            bodyA.world_vertex(poseA_t0, ea1_id),
+            bodyB.world_vertex(poseB_t0, eb0_id),
+            bodyB.world_vertex(poseB_t0, eb1_id)));
+        if (is_separated_over_step(
+                distance_t0, bodyA, poseA_t0, poseA_t1, bodyB, poseB_t0,
+                poseB_t1, minimum_separation_distance)) {
+            toi = std::numeric_limits<double>::infinity();
+            return false;
+        }
+    }
+
     switch (trajectory) {
     case TrajectoryType::LINEAR: {
         Eigen::Vector3d ea0_t0 = bodyA.world_vertex(poseA_t0, ea0_id);
@@ -276,18 +715,60 @@ bool edge_edge_ccd(
     case TrajectoryType::RIGID:
         return compute_edge_edge_time_of_impact(
             bodyA, poseA_t0, poseA_t1, edgeA_id, bodyB, poseB_t0, poseB_t1,
-            edgeB_id, toi, earliest_toi);
+            edgeB_id, toi, earliest_toi, Constants::RIGID_CCD_TOI_TOL,
+            trajectories ? &trajectories->poses(bodyA_id) : nullptr,
+            trajectories ? &trajectories->poses(bodyB_id) : nullptr,
+            find_any_root, relative_toi_tolerance,
+            /*search_in_parallel=*/!deterministic);
 
     case TrajectoryType::REDON:
         return compute_edge_edge_time_of_impact_redon(
             bodyA, poseA_t0, poseA_t1, edgeA_id, bodyB, poseB_t0, poseB_t1,
             edgeB_id, toi, earliest_toi);
 
+    case TrajectoryType::CONSERVATIVE_ADVANCEMENT:
+        return compute_conservative_advancement_edge_edge_time_of_impact(
+            bodyA, poseA_t0, poseA_t1, edgeA_id, bodyB, poseB_t0, poseB_t1,
+            edgeB_id, toi, earliest_toi, minimum_separation_distance,
+            Constants::RIGID_CCD_TOI_TOL,
+            /*search_in_parallel=*/!deterministic);
+
     default:
         throw "Invalid trajectory type";
     }
 }
 
+bool edge_edge_ccd(
+    const RigidBodyAssembler& bodies,
+    const PosesD& poses_t0,
+    const PosesD& poses_t1,
+    long bodyA_id,
+    long edgeA_id,
+    long bodyB_id,
+    long edgeB_id,
+    double& toi,
+    TrajectoryType trajectory,
+    double earliest_toi,
+    double minimum_separation_distance,
+    BodyTrajectoryCaches* trajectories,
+    bool find_any_root,
+    double relative_toi_tolerance,
+    bool deterministic)
+{
+    StepMetrics::add_count(StepMetrics::NARROW_PHASE_QUERIES);
+    if (CCDQueryLog::is_enabled()) {
+        CCDQueryLog::record_edge_edge(
+            bodies, poses_t0, poses_t1, bodyA_id, edgeA_id, bodyB_id, edgeB_id,
+            earliest_toi, minimum_separation_distance);
+    }
+
+    CCDQueryStats::ScopedQuery query(CCDQueryType::EDGE_EDGE, toi);
+    return query.finish(edge_edge_toi(
+        bodies, poses_t0, poses_t1, bodyA_id, edgeA_id, bodyB_id, edgeB_id, toi,
+        trajectory, earliest_toi, minimum_separation_distance, trajectories,
+        find_any_root, relative_toi_tolerance, deterministic));
+}
+
 bool face_vertex_ccd(
     const RigidBodyAssembler& bodies,
     const PosesD& poses_t0,
@@ -296,7 +777,10 @@ bool face_vertex_ccd(
     double& toi,
     TrajectoryType trajectory,
     double earliest_toi,
-    double minimum_separation_distance)
+    double minimum_separation_distance,
+    bool find_any_root,
+    double relative_toi_tolerance,
+    bool deterministic)
 {
 #ifdef SAVE_CCD_QUERIES
     save_ccd_candidate(bodies, poses_t0, poses_t1, candidate);
@@ -305,6 +789,32 @@ bool face_vertex_ccd(
     long bodyA_id, vertex_id, bodyB_id, face_id;
     bodies.global_to_local_vertex(candidate.vertex_index, bodyA_id, vertex_id);
     bodies.global_to_local_face(candidate.face_index, bodyB_id, face_id);
+
+    return face_vertex_ccd(
+        bodies, poses_t0, poses_t1, bodyA_id, vertex_id, bodyB_id, face_id,
+        toi, trajectory, earliest_toi, minimum_separation_distance,
+        /*trajectories=*/nullptr, find_any_root, relative_toi_tolerance,
+        deterministic);
+}
+
+// Compute the time of impact of a face-vertex query.
+bool face_vertex_toi(
+    const RigidBodyAssembler& bodies,
+    const PosesD& poses_t0,
+    const PosesD& poses_t1,
+    long bodyA_id,
+    long vertex_id,
+    long bodyB_id,
+    long face_id,
+    double& toi,
+    TrajectoryType trajectory,
+    double earliest_toi,
+    double minimum_separation_distance,
+    BodyTrajectoryCaches* trajectories,
+    bool find_any_root,
+    double relative_toi_tolerance,
+    bool deterministic)
+{
     const RigidBody& bodyA = bodies[bodyA_id];
     const RigidBody& bodyB = bodies[bodyB_id];
     const PoseD& poseA_t0 = poses_t0[bodyA_id];
@@ -315,6 +825,20 @@ bool face_vertex_ccd(
     long f1_id = bodyB.faces(face_id, 1);
     long f2_id = bodyB.faces(face_id, 2);
 
+    if (is_prefiltered(trajectory)) {
+        double distance_t0 = sqrt(point_triangle_distance(
+            bodyA.world_vertex(poseA_t0, vertex_id),
+            bodyB.world_vertex(poseB_t0, f0_id),
+            bodyB.world_vertex(poseB_t0, f1_id),
+            bodyB.world_vertex(poseB_t0, f2_id)));
+        if (is_separated_over_step(
+                distance_t0, bodyA, poseA_t0, poseA_t1, bodyB, poseB_t0,
+                poseB_t1, minimum_separation_distance)) {
+            toi = std::numeric_limits<double>::infinity();
+            return false;
+        }
+    }
+
     switch (trajectory) {
     case TrajectoryType::LINEAR: {
         Eigen::Vector3d v_t0 = bodyA.world_vertex(poseA_t0, vertex_id);
@@ -344,18 +868,60 @@ bool face_vertex_ccd(
     case TrajectoryType::RIGID:
         return compute_face_vertex_time_of_impact(
             bodyA, poseA_t0, poseA_t1, vertex_id, bodyB, poseB_t0, poseB_t1,
-            face_id, toi, earliest_toi);
+            face_id, toi, earliest_toi, Constants::RIGID_CCD_TOI_TOL,
+            trajectories ? &trajectories->poses(bodyA_id) : nullptr,
+            trajectories ? &trajectories->poses(bodyB_id) : nullptr,
+            find_any_root, relative_toi_tolerance,
+            /*search_in_parallel=*/!deterministic);
 
     case TrajectoryType::REDON:
         return compute_face_vertex_time_of_impact_redon(
             bodyA, poseA_t0, poseA_t1, vertex_id, bodyB, poseB_t0, poseB_t1,
             face_id, toi, earliest_toi);
 
+    case TrajectoryType::CONSERVATIVE_ADVANCEMENT:
+        return compute_conservative_advancement_face_vertex_time_of_impact(
+            bodyA, poseA_t0, poseA_t1, vertex_id, bodyB, poseB_t0, poseB_t1,
+            face_id, toi, earliest_toi, minimum_separation_distance,
+            Constants::RIGID_CCD_TOI_TOL,
+            /*search_in_parallel=*/!deterministic);
+
     default:
         throw "Invalid trajectory type";
     }
 }
 
+bool face_vertex_ccd(
+    const RigidBodyAssembler& bodies,
+    const PosesD& poses_t0,
+    const PosesD& poses_t1,
+    long bodyA_id,
+    long vertex_id,
+    long bodyB_id,
+    long face_id,
+    double& toi,
+    TrajectoryType trajectory,
+    double earliest_toi,
+    double minimum_separation_distance,
+    BodyTrajectoryCaches* trajectories,
+    bool find_any_root,
+    double relative_toi_tolerance,
+    bool deterministic)
+{
+    StepMetrics::add_count(StepMetrics::NARROW_PHASE_QUERIES);
+    if (CCDQueryLog::is_enabled()) {
+        CCDQueryLog::record_face_vertex(
+            bodies, poses_t0, poses_t1, bodyA_id, vertex_id, bodyB_id, face_id,
+            earliest_toi, minimum_separation_distance);
+    }
+
+    CCDQueryStats::ScopedQuery query(CCDQueryType::FACE_VERTEX, toi);
+    return query.finish(face_vertex_toi(
+        bodies, poses_t0, poses_t1, bodyA_id, vertex_id, bodyB_id, face_id, toi,
+        trajectory, earliest_toi, minimum_separation_distance, trajectories,
+        find_any_root, relative_toi_tolerance, deterministic));
+}
+
 double edge_vertex_closest_point(
     const RigidBodyAssembler& bodies,
     const PosesD& poses_t0,
@@ -396,7 +962,8 @@ double edge_vertex_closest_point(
 
     case TrajectoryType::PIECEWISE_LINEAR:
     case TrajectoryType::RIGID:
-    case TrajectoryType::REDON: {
+    case TrajectoryType::REDON:
+    case TrajectoryType::CONSERVATIVE_ADVANCEMENT: {
         // Compute the poses at time toi
         PoseD poseA_toi = PoseD::interpolate(poseA_t0, poseA_t1, toi);
         PoseD poseB_toi = PoseD::interpolate(poseB_t0, poseB_t1, toi);
@@ -457,7 +1024,8 @@ void edge_edge_closest_point(
 
     case TrajectoryType::PIECEWISE_LINEAR:
     case TrajectoryType::RIGID:
-    case TrajectoryType::REDON: {
+    case TrajectoryType::REDON:
+    case TrajectoryType::CONSERVATIVE_ADVANCEMENT: {
         // Compute the poses at time toi
         PoseD poseA_toi = PoseD::interpolate(poseA_t0, poseA_t1, toi);
         PoseD poseB_toi = PoseD::interpolate(poseB_t0, poseB_t1, toi);
@@ -522,7 +1090,8 @@ void face_vertex_closest_point(
 
     case TrajectoryType::PIECEWISE_LINEAR:
     case TrajectoryType::RIGID:
-    case TrajectoryType::REDON: {
+    case TrajectoryType::REDON:
+    case TrajectoryType::CONSERVATIVE_ADVANCEMENT: {
         // Compute the poses at time toi
         PoseD poseA_toi = PoseD::interpolate(poseA_t0, poseA_t1, toi);
         PoseD poseB_toi = PoseD::interpolate(poseB_t0, poseB_t1, toi);
@@ -11,18 +11,28 @@
 
 namespace ipc::rigid {
 
+class BodyTrajectoryCaches;
+
 /// @brief Possible methods for detecting all edge vertex collisions.
 enum DetectionMethod {
     BRUTE_FORCE, ///< @brief Use brute-force to detect all collisions
     HASH_GRID, ///< @brief Use a spatial data structure to detect all collisions
     BVH,       ///< @brief Use a BVH to detect all collisions
+    /// @brief Use an incremental sweep and prune to detect all collisions
+    SWEEP_AND_PRUNE,
+    /// @brief Use the hash grid or the BVH, whichever was measured cheaper
+    /// in the last time-steps (resolved by the collision constraints and
+    /// the hash grid elsewhere)
+    AUTO,
 };
 
 NLOHMANN_JSON_SERIALIZE_ENUM(
     DetectionMethod,
     { { HASH_GRID, "hash_grid" },
       { BRUTE_FORCE, "brute_force" },
-      { BVH, "bvh" } });
+      { BVH, "bvh" },
+      { SWEEP_AND_PRUNE, "sweep_and_prune" },
+      { AUTO, "auto" } });
 
 /// @brief Possible trajectories of vertices in a rigid body.
 enum TrajectoryType {
@@ -37,7 +47,11 @@ enum TrajectoryType {
     RIGID,
     /// @brief Same trajectory as RIGID, but the time of impact is computed
     /// using Redon et al. [2002].
-    REDON
+    REDON,
+    /// @brief Same trajectory as RIGID, but the time of impact is advanced
+    /// by bounds on the distance and refined by interval root finding only
+    /// close to contact.
+    CONSERVATIVE_ADVANCEMENT
 };
 
 NLOHMANN_JSON_SERIALIZE_ENUM(
@@ -45,7 +59,8 @@ NLOHMANN_JSON_SERIALIZE_ENUM(
     { { LINEAR, "linear" },
       { PIECEWISE_LINEAR, "piecewise_linear" },
       { RIGID, "rigid" },
-      { REDON, "redon" } });
+      { REDON, "redon" },
+      { CONSERVATIVE_ADVANCEMENT, "conservative_advancement" } });
 
 namespace CollisionType {
     static const int EDGE_VERTEX = 1;
@@ -58,6 +73,9 @@ namespace CollisionType {
 ///////////////////////////////////////////////////////////////////////////////
 
 /// @brief Find all collisions in one time step.
+///
+/// If deterministic is true, the impacts and their times do not depend on the
+/// thread scheduling.
 void detect_collisions(
     const RigidBodyAssembler& bodies,
     const PosesD& poses_t0,
@@ -65,13 +83,23 @@ void detect_collisions(
     const int collision_types,
     Impacts& impacts,
     DetectionMethod method,
-    TrajectoryType trajectory);
+    TrajectoryType trajectory,
+    bool deterministic = false);
 
 ///////////////////////////////////////////////////////////////////////////////
 // Broad-Phase
 ///////////////////////////////////////////////////////////////////////////////
 
+class BodyPairSeparationCache;
+class RigidBodyHashGrid;
+
 /// @brief Use broad-phase method to create a set of candidate collisions.
+/// @param separation_cache Optional cache of body pair separations used by the
+///                         BVH of rigid trajectories.
+/// @param hash_grid Optional grid whose storage is reused by the hash grid of
+///                  rigid trajectories.
+/// @param deterministic Sort the candidates by their primitive ids instead
+///                      of leaving them in the order the threads found them.
 void detect_collision_candidates(
     const RigidBodyAssembler& bodies,
     const PosesD& poses_t0,
@@ -80,21 +108,37 @@ void detect_collision_candidates(
     Candidates& candidates,
     DetectionMethod method,
     TrajectoryType trajectory,
-    const double inflation_radius = 0.0);
+    const double inflation_radius = 0.0,
+    BodyPairSeparationCache* separation_cache = nullptr,
+    RigidBodyHashGrid* hash_grid = nullptr,
+    bool deterministic = false);
 
 ///////////////////////////////////////////////////////////////////////////////
 // Narrow-Phase
 ///////////////////////////////////////////////////////////////////////////////
 
+/// @brief Find the impacts of the candidates (sorted by their primitive ids
+/// if deterministic is true).
 void detect_collisions_from_candidates(
     const RigidBodyAssembler& bodies,
     const PosesD& poses_t0,
     const PosesD& poses_t1,
     const Candidates& candidates,
     Impacts& impacts,
-    TrajectoryType trajectory);
+    TrajectoryType trajectory,
+    bool deterministic = false);
+
+/// @brief Bound the distance any point of a body moves along the rigid
+/// trajectory from pose_t0 to pose_t1 (‖Δp‖ + ‖Δr‖ r_max).
+double max_trajectory_displacement(
+    const PoseD& pose_t0, const PoseD& pose_t1, double r_max);
 
 /// @brief Determine if a single edge-vertext pair intersects.
+///
+/// With find_any_root, rigid trajectories stop at the first time of impact
+/// found (so toi is not the earliest), which is enough for yes/no queries.
+/// With a positive relative_toi_tolerance, they resolve a time of impact t
+/// only to within that fraction of t (still a conservative bound).
 bool edge_vertex_ccd(
     const RigidBodyAssembler& bodies,
     const PosesD& poses_t0,
@@ -103,8 +147,31 @@ bool edge_vertex_ccd(
     double& toi,
     TrajectoryType trajectory,
     double earliest_toi = 1,
-    double minimum_separation_distance = 0);
+    double minimum_separation_distance = 0,
+    bool find_any_root = false,
+    double relative_toi_tolerance = 0);
+
+/// @brief Determine if a vertex of bodyA and an edge of bodyB intersect.
+bool edge_vertex_ccd(
+    const RigidBodyAssembler& bodies,
+    const PosesD& poses_t0,
+    const PosesD& poses_t1,
+    long bodyA_id,
+    long vertex_id,
+    long bodyB_id,
+    long edge_id,
+    double& toi,
+    TrajectoryType trajectory,
+    double earliest_toi = 1,
+    double minimum_separation_distance = 0,
+    BodyTrajectoryCaches* trajectories = nullptr,
+    bool find_any_root = false,
+    double relative_toi_tolerance = 0);
 
+/// @brief Determine if a single edge-edge pair intersects.
+///
+/// With deterministic, long rigid searches are not split between threads, so
+/// the time of impact does not depend on the scheduling.
 bool edge_edge_ccd(
     const RigidBodyAssembler& bodies,
     const PosesD& poses_t0,
@@ -113,7 +180,28 @@ bool edge_edge_ccd(
     double& toi,
     TrajectoryType trajectory,
     double earliest_toi = 1,
-    double minimum_separation_distance = 0);
+    double minimum_separation_distance = 0,
+    bool find_any_root = false,
+    double relative_toi_tolerance = 0,
+    bool deterministic = false);
+
+/// @brief Determine if an edge of bodyA and an edge of bodyB intersect.
+bool edge_edge_ccd(
+    const RigidBodyAssembler& bodies,
+    const PosesD& poses_t0,
+    const PosesD& poses_t1,
+    long bodyA_id,
+    long edgeA_id,
+    long bodyB_id,
+    long edgeB_id,
+    double& toi,
+    TrajectoryType trajectory,
+    double earliest_toi = 1,
+    double minimum_separation_distance = 0,
+    BodyTrajectoryCaches* trajectories = nullptr,
+    bool find_any_root = false,
+    double relative_toi_tolerance = 0,
+    bool deterministic = false);
 
 bool face_vertex_ccd(
     const RigidBodyAssembler& bodies,
@@ -123,7 +211,28 @@ bool face_vertex_ccd(
     double& toi,
     TrajectoryType trajectory,
     double earliest_toi = 1,
-    double minimum_separation_distance = 0);
+    double minimum_separation_distance = 0,
+    bool find_any_root = false,
+    double relative_toi_tolerance = 0,
+    bool deterministic = false);
+
+/// @brief Determine if a vertex of bodyA and a face of bodyB intersect.
+bool face_vertex_ccd(
+    const RigidBodyAssembler& bodies,
+    const PosesD& poses_t0,
+    const PosesD& poses_t1,
+    long bodyA_id,
+    long vertex_id,
+    long bodyB_id,
+    long face_id,
+    double& toi,
+    TrajectoryType trajectory,
+    double earliest_toi = 1,
+    double minimum_separation_distance = 0,
+    BodyTrajectoryCaches* trajectories = nullptr,
+    bool find_any_root = false,
+    double relative_toi_tolerance = 0,
+    bool deterministic = false);
 
 double edge_vertex_closest_point(
     const RigidBodyAssembler& bodies,
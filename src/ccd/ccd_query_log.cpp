@@ -0,0 +1,288 @@
+#include "ccd_query_log.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <memory>
+#include <mutex>
+
+#include <constants.hpp>
+#include <logger.hpp>
+
+namespace ipc::rigid {
+
+std::atomic<bool> CCDQueryLog::s_is_enabled(false);
+
+namespace {
+    const uint32_t LOG_MAGIC = 0x51434352; // "RCCQ"
+    const uint32_t LOG_VERSION = 1;
+
+    struct LogHeader {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t record_size;
+    };
+
+    /// @brief Records of a thread not yet written to the file.
+    struct ThreadBuffer {
+        std::vector<CCDQueryRecord> records;
+    };
+
+    /// @brief Guards the file and the list of buffers.
+    std::mutex log_mutex;
+    std::ofstream log_file;
+    std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+    std::atomic<uint64_t> num_queries(0);
+    uint64_t log_sample_stride = 1;
+
+    ThreadBuffer& local_buffer()
+    {
+        thread_local std::shared_ptr<ThreadBuffer> buffer = [] {
+            std::lock_guard<std::mutex> lock(log_mutex);
+            buffers.push_back(std::make_shared<ThreadBuffer>());
+            return buffers.back();
+        }();
+        return *buffer;
+    }
+
+    /// @brief Write and clear a buffer (requires the log lock).
+    void write_buffer(ThreadBuffer& buffer)
+    {
+        if (log_file.is_open() && !buffer.records.empty()) {
+            log_file.write(
+                reinterpret_cast<const char*>(buffer.records.data()),
+                buffer.records.size() * sizeof(CCDQueryRecord));
+        }
+        buffer.records.clear();
+    }
+
+    bool is_sampled()
+    {
+        return num_queries.fetch_add(1, std::memory_order_relaxed)
+            % log_sample_stride
+            == 0;
+    }
+
+    CCDQueryRecord& new_record(
+        CCDQueryType type,
+        const RigidBodyAssembler& bodies,
+        const PosesD& poses_t0,
+        const PosesD& poses_t1,
+        long bodyA_id,
+        long bodyB_id,
+        double earliest_toi,
+        double minimum_separation_distance)
+    {
+        ThreadBuffer& buffer = local_buffer();
+        buffer.records.emplace_back(); // Zero initialized
+        CCDQueryRecord& record = buffer.records.back();
+        record.type = type;
+        record.dim = bodies.dim();
+        record.earliest_toi = earliest_toi;
+        record.minimum_separation_distance = minimum_separation_distance;
+
+        const std::array<long, 2> body_ids = { { bodyA_id, bodyB_id } };
+        for (int i = 0; i < 2; i++) {
+            record.r_max[i] = bodies[body_ids[i]].r_max;
+            const std::array<const PoseD*, 2> poses = {
+                { &poses_t0[body_ids[i]], &poses_t1[body_ids[i]] }
+            };
+            for (int t = 0; t < 2; t++) {
+                const PoseD& pose = *poses[t];
+                for (int j = 0; j < pose.pos_ndof(); j++) {
+                    record.poses[i][t][j] = pose.position(j);
+                }
+                for (int j = 0; j < pose.rot_ndof(); j++) {
+                    record.poses[i][t][pose.pos_ndof() + j] =
+                        pose.rotation(j);
+                }
+            }
+        }
+        return record;
+    }
+
+    void set_vertex(
+        CCDQueryRecord& record,
+        int body,
+        int i,
+        const RigidBody& rb,
+        long vertex_id)
+    {
+        for (int j = 0; j < rb.vertices.cols(); j++) {
+            record.vertices[body][i][j] = rb.vertices(vertex_id, j);
+        }
+    }
+
+    void submit_record()
+    {
+        ThreadBuffer& buffer = local_buffer();
+        if (buffer.records.size() >= Constants::CCD_QUERY_LOG_BUFFER_SIZE) {
+            std::lock_guard<std::mutex> lock(log_mutex);
+            write_buffer(buffer);
+        }
+    }
+} // namespace
+
+int CCDQueryRecord::num_vertices(int body) const
+{
+    switch (type) {
+    case CCDQueryType::EDGE_VERTEX:
+        return body == 0 ? 1 : 2;
+    case CCDQueryType::EDGE_EDGE:
+        return 2;
+    case CCDQueryType::FACE_VERTEX:
+        return body == 0 ? 1 : 3;
+    }
+    return 0;
+}
+
+PoseD CCDQueryRecord::pose(int body, int t) const
+{
+    PoseD pose = PoseD::Zero(dim);
+    for (int j = 0; j < pose.pos_ndof(); j++) {
+        pose.position(j) = poses[body][t][j];
+    }
+    for (int j = 0; j < pose.rot_ndof(); j++) {
+        pose.rotation(j) = poses[body][t][pose.pos_ndof() + j];
+    }
+    return pose;
+}
+
+bool CCDQueryLog::enable(const std::string& filename, int sample_stride)
+{
+    disable();
+
+    std::lock_guard<std::mutex> lock(log_mutex);
+    log_file.open(filename, std::ios::binary | std::ios::trunc);
+    if (!log_file) {
+        spdlog::error("Unable to open CCD query log {}", filename);
+        return false;
+    }
+    const LogHeader header = { LOG_MAGIC, LOG_VERSION,
+                               uint32_t(sizeof(CCDQueryRecord)) };
+    log_file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+    for (auto& buffer : buffers) {
+        buffer->records.clear();
+    }
+    num_queries = 0;
+    log_sample_stride = std::max(sample_stride, 1);
+    s_is_enabled = true;
+    return true;
+}
+
+void CCDQueryLog::disable()
+{
+    s_is_enabled = false;
+
+    std::lock_guard<std::mutex> lock(log_mutex);
+    if (!log_file.is_open()) {
+        return;
+    }
+    // Logging should not overlap with this, so the buffers are idle
+    for (auto& buffer : buffers) {
+        write_buffer(*buffer);
+    }
+    log_file.close();
+    spdlog::info(
+        "CCD query log saved num_queries={:d} sample_stride={:d}",
+        num_queries.load(), log_sample_stride);
+}
+
+void CCDQueryLog::record_edge_vertex(
+    const RigidBodyAssembler& bodies,
+    const PosesD& poses_t0,
+    const PosesD& poses_t1,
+    long bodyA_id,
+    long vertex_id,
+    long bodyB_id,
+    long edge_id,
+    double earliest_toi,
+    double minimum_separation_distance)
+{
+    if (!is_sampled()) {
+        return;
+    }
+    CCDQueryRecord& record = new_record(
+        CCDQueryType::EDGE_VERTEX, bodies, poses_t0, poses_t1, bodyA_id,
+        bodyB_id, earliest_toi, minimum_separation_distance);
+    set_vertex(record, 0, 0, bodies[bodyA_id], vertex_id);
+    for (int i = 0; i < 2; i++) {
+        set_vertex(
+            record, 1, i, bodies[bodyB_id], bodies[bodyB_id].edges(edge_id, i));
+    }
+    submit_record();
+}
+
+void CCDQueryLog::record_edge_edge(
+    const RigidBodyAssembler& bodies,
+    const PosesD& poses_t0,
+    const PosesD& poses_t1,
+    long bodyA_id,
+    long edgeA_id,
+    long bodyB_id,
+    long edgeB_id,
+    double earliest_toi,
+    double minimum_separation_distance)
+{
+    if (!is_sampled()) {
+        return;
+    }
+    CCDQueryRecord& record = new_record(
+        CCDQueryType::EDGE_EDGE, bodies, poses_t0, poses_t1, bodyA_id,
+        bodyB_id, earliest_toi, minimum_separation_distance);
+    for (int i = 0; i < 2; i++) {
+        set_vertex(
+            record, 0, i, bodies[bodyA_id],
+            bodies[bodyA_id].edges(edgeA_id, i));
+        set_vertex(
+            record, 1, i, bodies[bodyB_id],
+            bodies[bodyB_id].edges(edgeB_id, i));
+    }
+    submit_record();
+}
+
+void CCDQueryLog::record_face_vertex(
+    const RigidBodyAssembler& bodies,
+    const PosesD& poses_t0,
+    const PosesD& poses_t1,
+    long bodyA_id,
+    long vertex_id,
+    long bodyB_id,
+    long face_id,
+    double earliest_toi,
+    double minimum_separation_distance)
+{
+    if (!is_sampled()) {
+        return;
+    }
+    CCDQueryRecord& record = new_record(
+        CCDQueryType::FACE_VERTEX, bodies, poses_t0, poses_t1, bodyA_id,
+        bodyB_id, earliest_toi, minimum_separation_distance);
+    set_vertex(record, 0, 0, bodies[bodyA_id], vertex_id);
+    for (int i = 0; i < 3; i++) {
+        set_vertex(
+            record, 1, i, bodies[bodyB_id], bodies[bodyB_id].faces(face_id, i));
+    }
+    submit_record();
+}
+
+bool read_ccd_query_log(
+    const std::string& filename, std::vector<CCDQueryRecord>& records)
+{
+    records.clear();
+    std::ifstream file(filename, std::ios::binary);
+    LogHeader header;
+    if (!file.read(reinterpret_cast<char*>(&header), sizeof(header))
+        || header.magic != LOG_MAGIC || header.version != LOG_VERSION
+        || header.record_size != sizeof(CCDQueryRecord)) {
+        spdlog::error("Invalid CCD query log {}", filename);
+        return false;
+    }
+    CCDQueryRecord record;
+    while (file.read(reinterpret_cast<char*>(&record), sizeof(record))) {
+        records.push_back(record);
+    }
+    return true;
+}
+
+} // namespace ipc::rigid
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include <physics/pose.hpp>
+#include <physics/rigid_body_assembler.hpp>
+
+namespace ipc::rigid {
+
+enum class CCDQueryType : uint8_t { EDGE_VERTEX, EDGE_EDGE, FACE_VERTEX };
+
+/// @brief Fixed-size binary record of a narrow-phase CCD query.
+///
+/// Body 0 owns the vertex (EV and FV) or the first edge (EE) and body 1 owns
+/// the edge, second edge, or face. Vertices are in body space and poses are
+/// stored as position followed by rotation. Unused entries are zero.
+struct CCDQueryRecord {
+    CCDQueryType type;
+    uint8_t dim;
+    double earliest_toi;
+    double minimum_separation_distance;
+    /// @brief Bounding radius of each body.
+    std::array<double, 2> r_max;
+    /// @brief [body][vertex][coordinate] of the primitives.
+    std::array<std::array<std::array<double, 3>, 3>, 2> vertices;
+    /// @brief [body][t0 or t1][dof] of the poses.
+    std::array<std::array<std::array<double, 6>, 2>, 2> poses;
+
+    /// @brief Number of primitive vertices of a body.
+    int num_vertices(int body) const;
+
+    /// @brief Pose of a body at the start (t=0) or end (t=1) of the step.
+    PoseD pose(int body, int t) const;
+};
+static_assert(
+    std::is_trivially_copyable<CCDQueryRecord>::value,
+    "CCD query records are written as raw bytes");
+
+/// @brief Sampled binary log of narrow-phase CCD queries for replay.
+///
+/// Every thread buffers its records and writes them in batches, so the
+/// narrow phase only takes the file lock once per batch. While disabled a
+/// query costs a single relaxed load.
+class CCDQueryLog {
+public:
+    static bool is_enabled()
+    {
+        return s_is_enabled.load(std::memory_order_relaxed);
+    }
+
+    /// @brief Start logging every sample_stride-th query to a file.
+    /// @returns False if the file could not be opened.
+    static bool enable(const std::string& filename, int sample_stride = 1);
+
+    /// @brief Stop logging and write the buffered records.
+    static void disable();
+
+    /// @brief Record an edge-vertex query (if sampled).
+    static void record_edge_vertex(
+        const RigidBodyAssembler& bodies,
+        const PosesD& poses_t0,
+        const PosesD& poses_t1,
+        long bodyA_id,
+        long vertex_id,
+        long bodyB_id,
+        long edge_id,
+        double earliest_toi,
+        double minimum_separation_distance);
+
+    /// @brief Record an edge-edge query (if sampled).
+    static void record_edge_edge(
+        const RigidBodyAssembler& bodies,
+        const PosesD& poses_t0,
+        const PosesD& poses_t1,
+        long bodyA_id,
+        long edgeA_id,
+        long bodyB_id,
+        long edgeB_id,
+        double earliest_toi,
+        double minimum_separation_distance);
+
+    /// @brief Record a face-vertex query (if sampled).
+    static void record_face_vertex(
+        const RigidBodyAssembler& bodies,
+        const PosesD& poses_t0,
+        const PosesD& poses_t1,
+        long bodyA_id,
+        long vertex_id,
+        long bodyB_id,
+        long face_id,
+        double earliest_toi,
+        double minimum_separation_distance);
+
+protected:
+    static std::atomic<bool> s_is_enabled;
+};
+
+/// @brief Read the records of a CCD query log.
+/// @returns False if the file is not a compatible query log.
+bool read_ccd_query_log(
+    const std::string& filename, std::vector<CCDQueryRecord>& records);
+
+} // namespace ipc::rigid
@@ -0,0 +1,203 @@
+#include "ccd_query_stats.hpp"
+
+#include <algorithm>
+
+#include <tbb/enumerable_thread_specific.h>
+
+namespace ipc::rigid {
+
+std::atomic<bool> CCDQueryStats::s_is_enabled(false);
+
+namespace {
+    typedef std::array<std::atomic<uint64_t>, CCDQueryStats::NUM_BUCKETS>
+        AtomicHistogram;
+
+    /// @brief Statistics of a query type updated by a single thread.
+    ///
+    /// The values are atomics so they can be read by collect(), but only
+    /// their thread writes them.
+    struct ThreadQueryTypeStats {
+        std::atomic<uint64_t> num_queries { 0 };
+        std::atomic<uint64_t> num_hits { 0 };
+        std::atomic<uint64_t> num_toi_zero { 0 };
+        std::atomic<uint64_t> nanoseconds { 0 };
+        std::atomic<uint64_t> num_root_finder_calls { 0 };
+        std::atomic<uint64_t> num_root_finder_boxes { 0 };
+        AtomicHistogram time_histogram = {};
+        AtomicHistogram box_histogram = {};
+    };
+
+    typedef std::array<ThreadQueryTypeStats, CCDQueryStats::NUM_QUERY_TYPES>
+        ThreadStats;
+
+    tbb::enumerable_thread_specific<ThreadStats> thread_stats;
+
+    /// @brief Increment a value written only by the calling thread.
+    inline void add(std::atomic<uint64_t>& value, uint64_t n = 1)
+    {
+        value.store(
+            value.load(std::memory_order_relaxed) + n,
+            std::memory_order_relaxed);
+    }
+
+    inline uint64_t load(const std::atomic<uint64_t>& value)
+    {
+        return value.load(std::memory_order_relaxed);
+    }
+
+    inline void clear(std::atomic<uint64_t>& value)
+    {
+        value.store(0, std::memory_order_relaxed);
+    }
+
+    /// @brief Histogram without its trailing empty buckets.
+    nlohmann::json trimmed(const CCDQueryStats::Histogram& histogram)
+    {
+        auto end = histogram.end();
+        while (end != histogram.begin() && *(end - 1) == 0) {
+            --end;
+        }
+        return std::vector<uint64_t>(histogram.begin(), end);
+    }
+} // namespace
+
+CCDQueryStats::QueryTypeStats&
+CCDQueryStats::QueryTypeStats::operator+=(const QueryTypeStats& other)
+{
+    num_queries += other.num_queries;
+    num_hits += other.num_hits;
+    num_toi_zero += other.num_toi_zero;
+    nanoseconds += other.nanoseconds;
+    num_root_finder_calls += other.num_root_finder_calls;
+    num_root_finder_boxes += other.num_root_finder_boxes;
+    for (int b = 0; b < NUM_BUCKETS; b++) {
+        time_histogram[b] += other.time_histogram[b];
+        box_histogram[b] += other.box_histogram[b];
+    }
+    return *this;
+}
+
+nlohmann::json CCDQueryStats::QueryTypeStats::to_json() const
+{
+    nlohmann::json stats;
+    stats["queries"] = num_queries;
+    stats["hits"] = num_hits;
+    stats["misses"] = num_queries - num_hits;
+    stats["toi_zero"] = num_toi_zero;
+    stats["time"] = nanoseconds * 1e-9;
+    stats["root_finder_calls"] = num_root_finder_calls;
+    stats["root_finder_boxes"] = num_root_finder_boxes;
+    stats["time_histogram"] = trimmed(time_histogram);
+    stats["box_histogram"] = trimmed(box_histogram);
+    return stats;
+}
+
+CCDQueryStats::Summary&
+CCDQueryStats::Summary::operator+=(const Summary& other)
+{
+    for (int i = 0; i < NUM_QUERY_TYPES; i++) {
+        query_types[i] += other.query_types[i];
+    }
+    return *this;
+}
+
+nlohmann::json CCDQueryStats::Summary::to_json() const
+{
+    nlohmann::json stats;
+    for (int i = 0; i < NUM_QUERY_TYPES; i++) {
+        stats[type_name(CCDQueryType(i))] = query_types[i].to_json();
+    }
+    return stats;
+}
+
+void CCDQueryStats::record_query(
+    CCDQueryType type,
+    std::chrono::nanoseconds duration,
+    bool is_hit,
+    bool is_toi_zero)
+{
+    ThreadQueryTypeStats& stats = thread_stats.local()[int(type)];
+    const uint64_t nanoseconds = std::max<int64_t>(duration.count(), 0);
+    add(stats.num_queries);
+    add(stats.num_hits, is_hit);
+    add(stats.num_toi_zero, is_toi_zero);
+    add(stats.nanoseconds, nanoseconds);
+    add(stats.time_histogram[bucket(nanoseconds)]);
+}
+
+void CCDQueryStats::record_root_finder(CCDQueryType type, int num_boxes)
+{
+    if (!is_enabled()) {
+        return;
+    }
+    ThreadQueryTypeStats& stats = thread_stats.local()[int(type)];
+    const uint64_t boxes = std::max(num_boxes, 0);
+    add(stats.num_root_finder_calls);
+    add(stats.num_root_finder_boxes, boxes);
+    add(stats.box_histogram[bucket(boxes)]);
+}
+
+int CCDQueryStats::bucket(uint64_t value)
+{
+    int num_bits = 0;
+    for (; value != 0; value >>= 1) {
+        num_bits++;
+    }
+    return std::min(num_bits, NUM_BUCKETS - 1);
+}
+
+CCDQueryStats::Summary CCDQueryStats::collect()
+{
+    Summary summary;
+    for (const ThreadStats& stats : thread_stats) {
+        for (int i = 0; i < NUM_QUERY_TYPES; i++) {
+            const ThreadQueryTypeStats& from = stats[i];
+            QueryTypeStats& to = summary.query_types[i];
+            to.num_queries += load(from.num_queries);
+            to.num_hits += load(from.num_hits);
+            to.num_toi_zero += load(from.num_toi_zero);
+            to.nanoseconds += load(from.nanoseconds);
+            to.num_root_finder_calls += load(from.num_root_finder_calls);
+            to.num_root_finder_boxes += load(from.num_root_finder_boxes);
+            for (int b = 0; b < NUM_BUCKETS; b++) {
+                to.time_histogram[b] += load(from.time_histogram[b]);
+                to.box_histogram[b] += load(from.box_histogram[b]);
+            }
+        }
+    }
+    return summary;
+}
+
+void CCDQueryStats::reset()
+{
+    for (ThreadStats& stats : thread_stats) {
+        for (ThreadQueryTypeStats& type_stats : stats) {
+            clear(type_stats.num_queries);
+            clear(type_stats.num_hits);
+            clear(type_stats.num_toi_zero);
+            clear(type_stats.nanoseconds);
+            clear(type_stats.num_root_finder_calls);
+            clear(type_stats.num_root_finder_boxes);
+            for (int b = 0; b < NUM_BUCKETS; b++) {
+                clear(type_stats.time_histogram[b]);
+                clear(type_stats.box_histogram[b]);
+            }
+        }
+    }
+}
+
+const char* CCDQueryStats::type_name(CCDQueryType type)
+{
+    switch (type) {
+    case CCDQueryType::EDGE_VERTEX:
+        return "edge_vertex";
+    case CCDQueryType::EDGE_EDGE:
+        return "edge_edge";
+    case CCDQueryType::FACE_VERTEX:
+        return "face_vertex";
+    default:
+        return "unknown";
+    }
+}
+
+} // namespace ipc::rigid
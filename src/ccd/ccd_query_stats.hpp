@@ -0,0 +1,120 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+#include <nlohmann/json.hpp>
+
+#include <ccd/ccd_query_log.hpp>
+
+namespace ipc::rigid {
+
+/// @brief Opt-in counters and log-scale histograms of the narrow-phase CCD
+/// queries of each query type.
+///
+/// Every thread only updates its own counters, so recording takes no lock
+/// and no read-modify-write. The threads are merged by collect(), which (like
+/// reset()) must not run concurrently with the narrow phase. While disabled a
+/// query costs a single relaxed load.
+class CCDQueryStats {
+public:
+    static const int NUM_QUERY_TYPES = 3;
+    /// @brief Bucket b counts the values with b significant bits, i.e. in
+    /// [2^(b-1), 2^b), and the last bucket also counts all larger values.
+    static const int NUM_BUCKETS = 32;
+
+    typedef std::array<uint64_t, NUM_BUCKETS> Histogram;
+
+    /// @brief Merged statistics of one query type.
+    struct QueryTypeStats {
+        uint64_t num_queries = 0;
+        uint64_t num_hits = 0;
+        /// @brief Impacts at the start of the step.
+        uint64_t num_toi_zero = 0;
+        uint64_t nanoseconds = 0;
+        /// @brief Interval root finder calls and the boxes they examined.
+        uint64_t num_root_finder_calls = 0;
+        uint64_t num_root_finder_boxes = 0;
+        /// @brief Latencies of the queries in nanoseconds.
+        Histogram time_histogram = {};
+        /// @brief Boxes examined per root finder call.
+        Histogram box_histogram = {};
+
+        QueryTypeStats& operator+=(const QueryTypeStats& other);
+        nlohmann::json to_json() const;
+    };
+
+    /// @brief Merged statistics of all query types.
+    struct Summary {
+        std::array<QueryTypeStats, NUM_QUERY_TYPES> query_types;
+
+        Summary& operator+=(const Summary& other);
+        /// @brief Statistics keyed by query type name (times in seconds).
+        nlohmann::json to_json() const;
+    };
+
+    /// @brief Time a query and record its result.
+    class ScopedQuery {
+    public:
+        ScopedQuery(CCDQueryType type, const double& toi)
+            : m_type(type)
+            , m_toi(toi)
+        {
+            if (is_enabled()) {
+                m_start = std::chrono::steady_clock::now();
+            }
+        }
+        ScopedQuery(const ScopedQuery&) = delete;
+        ScopedQuery& operator=(const ScopedQuery&) = delete;
+
+        /// @brief Record the query (if enabled).
+        /// @returns The result of the query.
+        bool finish(bool is_colliding)
+        {
+            if (is_enabled()) {
+                record_query(
+                    m_type, std::chrono::steady_clock::now() - m_start,
+                    is_colliding, is_colliding && m_toi == 0);
+            }
+            return is_colliding;
+        }
+
+    protected:
+        CCDQueryType m_type;
+        const double& m_toi;
+        std::chrono::steady_clock::time_point m_start;
+    };
+
+    static bool is_enabled()
+    {
+        return s_is_enabled.load(std::memory_order_relaxed);
+    }
+    static void set_enabled(bool is_enabled) { s_is_enabled = is_enabled; }
+
+    static void record_query(
+        CCDQueryType type,
+        std::chrono::nanoseconds duration,
+        bool is_hit,
+        bool is_toi_zero);
+
+    static void record_root_finder(CCDQueryType type, int num_boxes);
+
+    /// @brief Bucket of a value in a histogram.
+    static int bucket(uint64_t value);
+
+    /// @brief Merge the statistics of all threads.
+    static Summary collect();
+
+    /// @brief Zero the statistics of all threads.
+    static void reset();
+
+    /// @brief Name of a query type in the statistics.
+    static const char* type_name(CCDQueryType type);
+
+protected:
+    static std::atomic<bool> s_is_enabled;
+};
+
+} // namespace ipc::rigid
@@ -0,0 +1,218 @@
+// Time-of-impact computation for rigid bodies by conservative advancement.
+#include "time_of_impact.hpp"
+
+#include <ipc/distance/edge_edge.hpp>
+#include <ipc/distance/point_edge.hpp>
+#include <ipc/distance/point_triangle.hpp>
+
+#include <ccd/ccd.hpp>
+#include <ccd/rigid/time_of_impact.hpp>
+#include <logger.hpp>
+
+namespace ipc::rigid {
+
+namespace {
+/// Advance t by the distance over a bound on the approach speed until the
+/// primitives are close, then finish with the interval root finder on [t, 1].
+///
+/// @param distance   Distance of the primitives given the poses of the bodies.
+/// @param exact_toi  Interval CCD given the poses at t0 and t1, the earliest
+///                   toi, the minimum separation distance, and the output toi.
+template <typename Distance, typename ExactTOI>
+bool conservative_advancement_time_of_impact(
+    const RigidBody& bodyA,
+    const PoseD& poseA_t0,
+    const PoseD& poseA_t1,
+    const RigidBody& bodyB,
+    const PoseD& poseB_t0,
+    const PoseD& poseB_t1,
+    const Distance& distance,
+    const ExactTOI& exact_toi,
+    double& toi,
+    double earliest_toi,
+    double minimum_separation_distance)
+{
+    assert(minimum_separation_distance >= 0);
+    toi = std::numeric_limits<double>::infinity();
+
+    // The distance shrinks at most this much over the whole step
+    const double max_approach =
+        max_trajectory_displacement(poseA_t0, poseA_t1, bodyA.r_max)
+        + max_trajectory_displacement(poseB_t0, poseB_t1, bodyB.r_max);
+
+    double t = 0;
+    PoseD poseA_t = poseA_t0, poseB_t = poseB_t0;
+    for (int i = 0; i < Constants::CONSERVATIVE_ADVANCEMENT_MAX_ITERATIONS;
+         i++) {
+        const double gap =
+            distance(poseA_t, poseB_t) - minimum_separation_distance;
+        if (gap <= 0) {
+            if (t == 0) {
+                spdlog::warn(
+                    "initial distance in conservative advancement CCD is "
+                    "less than MS={:g}!",
+                    minimum_separation_distance);
+            }
+            toi = t;
+            return true;
+        }
+        if (max_approach == 0) {
+            return false; // The primitives do not move relative to each other
+        }
+
+        // The gap stays positive for any step shorter than gap / max_approach
+        const double dt = Constants::CONSERVATIVE_ADVANCEMENT_STEP_SCALE * gap
+            / max_approach;
+        if (t + dt >= earliest_toi) {
+            return false;
+        }
+        if (dt < Constants::CONSERVATIVE_ADVANCEMENT_MIN_STEP) {
+            break; // Close to contact
+        }
+
+        t += dt;
+        poseA_t = PoseD::interpolate(poseA_t0, poseA_t1, t);
+        poseB_t = PoseD::interpolate(poseB_t0, poseB_t1, t);
+    }
+
+    // The distance is at least the minimum separation on [0, t], and being
+    // close is no impact (e.g., resting or sliding contact), so the rest of
+    // the step is checked exactly. The trajectory from the poses at t
+    // reparameterizes [t, 1] to [0, 1].
+    double local_toi;
+    bool is_impacting = exact_toi(
+        poseA_t, poseB_t, (earliest_toi - t) / (1 - t),
+        minimum_separation_distance, local_toi);
+    if (is_impacting) {
+        toi = t + local_toi * (1 - t);
+    }
+    return is_impacting;
+}
+} // namespace
+
+bool compute_conservative_advancement_edge_vertex_time_of_impact(
+    const RigidBody& bodyA,
+    const PoseD& poseA_t0,
+    const PoseD& poseA_t1,
+    size_t vertex_id,
+    const RigidBody& bodyB,
+    const PoseD& poseB_t0,
+    const PoseD& poseB_t1,
+    size_t edge_id,
+    double& toi,
+    double earliest_toi,
+    double minimum_separation_distance,
+    double toi_tolerance)
+{
+    assert(bodyA.dim() == 2 && bodyB.dim() == 2);
+
+    const long e0i = bodyB.edges(edge_id, 0);
+    const long e1i = bodyB.edges(edge_id, 1);
+    const auto distance = [&](const PoseD& poseA, const PoseD& poseB) {
+        return sqrt(point_edge_distance(
+            bodyA.world_vertex(poseA, vertex_id),
+            bodyB.world_vertex(poseB, e0i), bodyB.world_vertex(poseB, e1i)));
+    };
+    const auto exact_toi = [&](const PoseD& poseA, const PoseD& poseB,
+                               double local_earliest_toi,
+                               double local_separation_distance,
+                               double& local_toi) {
+        return compute_edge_vertex_time_of_impact(
+            bodyA, poseA, poseA_t1, vertex_id, bodyB, poseB, poseB_t1, edge_id,
+            local_toi, local_earliest_toi, toi_tolerance,
+            /*posesA=*/nullptr, /*posesB=*/nullptr, /*find_any_root=*/false,
+            /*relative_toi_tolerance=*/0, local_separation_distance);
+    };
+
+    return conservative_advancement_time_of_impact(
+        bodyA, poseA_t0, poseA_t1, bodyB, poseB_t0, poseB_t1, distance,
+        exact_toi, toi, earliest_toi, minimum_separation_distance);
+}
+
+bool compute_conservative_advancement_edge_edge_time_of_impact(
+    const RigidBody& bodyA,
+    const PoseD& poseA_t0,
+    const PoseD& poseA_t1,
+    size_t edgeA_id,
+    const RigidBody& bodyB,
+    const PoseD& poseB_t0,
+    const PoseD& poseB_t1,
+    size_t edgeB_id,
+    double& toi,
+    double earliest_toi,
+    double minimum_separation_distance,
+    double toi_tolerance,
+    bool search_in_parallel)
+{
+    assert(bodyA.dim() == 3 && bodyB.dim() == 3);
+
+    const long ea0i = bodyA.edges(edgeA_id, 0);
+    const long ea1i = bodyA.edges(edgeA_id, 1);
+    const long eb0i = bodyB.edges(edgeB_id, 0);
+    const long eb1i = bodyB.edges(edgeB_id, 1);
+    const auto distance = [&](const PoseD& poseA, const PoseD& poseB) {
+        return sqrt(edge_edge_distance(
+            bodyA.world_vertex(poseA, ea0i), bodyA.world_vertex(poseA, ea1i),
+            bodyB.world_vertex(poseB, eb0i), bodyB.world_vertex(poseB, eb1i)));
+    };
+    const auto exact_toi = [&](const PoseD& poseA, const PoseD& poseB,
+                               double local_earliest_toi,
+                               double local_separation_distance,
+                               double& local_toi) {
+        return compute_edge_edge_time_of_impact(
+            bodyA, poseA, poseA_t1, edgeA_id, bodyB, poseB, poseB_t1, edgeB_id,
+            local_toi, local_earliest_toi, toi_tolerance,
+            /*posesA=*/nullptr, /*posesB=*/nullptr, /*find_any_root=*/false,
+            /*relative_toi_tolerance=*/0, search_in_parallel,
+            local_separation_distance);
+    };
+
+    return conservative_advancement_time_of_impact(
+        bodyA, poseA_t0, poseA_t1, bodyB, poseB_t0, poseB_t1, distance,
+        exact_toi, toi, earliest_toi, minimum_separation_distance);
+}
+
+bool compute_conservative_advancement_face_vertex_time_of_impact(
+    const RigidBody& bodyA,
+    const PoseD& poseA_t0,
+    const PoseD& poseA_t1,
+    size_t vertex_id,
+    const RigidBody& bodyB,
+    const PoseD& poseB_t0,
+    const PoseD& poseB_t1,
+    size_t face_id,
+    double& toi,
+    double earliest_toi,
+    double minimum_separation_distance,
+    double toi_tolerance,
+    bool search_in_parallel)
+{
+    assert(bodyA.dim() == 3 && bodyB.dim() == 3);
+
+    const long f0i = bodyB.faces(face_id, 0);
+    const long f1i = bodyB.faces(face_id, 1);
+    const long f2i = bodyB.faces(face_id, 2);
+    const auto distance = [&](const PoseD& poseA, const PoseD& poseB) {
+        return sqrt(point_triangle_distance(
+            bodyA.world_vertex(poseA, vertex_id),
+            bodyB.world_vertex(poseB, f0i), bodyB.world_vertex(poseB, f1i),
+            bodyB.world_vertex(poseB, f2i)));
+    };
+    const auto exact_toi = [&](const PoseD& poseA, const PoseD& poseB,
+                               double local_earliest_toi,
+                               double local_separation_distance,
+                               double& local_toi) {
+        return compute_face_vertex_time_of_impact(
+            bodyA, poseA, poseA_t1, vertex_id, bodyB, poseB, poseB_t1, face_id,
+            local_toi, local_earliest_toi, toi_tolerance,
+            /*posesA=*/nullptr, /*posesB=*/nullptr, /*find_any_root=*/false,
+            /*relative_toi_tolerance=*/0, search_in_parallel,
+            local_separation_distance);
+    };
+
+    return conservative_advancement_time_of_impact(
+        bodyA, poseA_t0, poseA_t1, bodyB, poseB_t0, poseB_t1, distance,
+        exact_toi, toi, earliest_toi, minimum_separation_distance);
+}
+
+} // namespace ipc::rigid
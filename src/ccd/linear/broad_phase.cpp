@@ -8,6 +8,7 @@
 
 #include <ccd/rigid/broad_phase.hpp>
 #include <ccd/rigid/rigid_body_bvh.hpp>
+#include <ccd/sweep_and_prune.hpp>
 #include <logger.hpp>
 #include <profiler.hpp>
 
@@ -35,12 +36,29 @@ void detect_collision_candidates_linear(
 
     switch (method) {
     case BRUTE_FORCE:
-    case HASH_GRID: {
+    case HASH_GRID:
+    case AUTO: {
         Eigen::MatrixXd V_t0 = bodies.world_vertices(poses_t0);
         Eigen::MatrixXd V_t1 = bodies.world_vertices(poses_t1);
         detect_collision_candidates(
             V_t0, V_t1, bodies.m_edges, bodies.m_faces, bodies.group_ids(),
-            collision_types, candidates, method, inflation_radius);
+            collision_types, candidates, method == AUTO ? HASH_GRID : method,
+            inflation_radius);
+        break;
+    }
+    case SWEEP_AND_PRUNE: {
+        Eigen::MatrixXd V_t0 = bodies.world_vertices(poses_t0);
+        Eigen::MatrixXd V_t1 = bodies.world_vertices(poses_t1);
+        std::vector<AABB> vertex_boxes(V_t0.rows());
+        for (size_t vi = 0; vi < V_t0.rows(); vi++) {
+            vertex_boxes[vi] = vertex_aabb(V_t0, V_t1, vi, inflation_radius);
+        }
+        // The sweep order is kept per thread across calls to exploit
+        // coherence.
+        static thread_local SweepAndPrune sap;
+        detect_collision_candidates_sweep_and_prune(
+            vertex_boxes, bodies.m_edges, bodies.m_faces, bodies.group_ids(),
+            collision_types, candidates, sap);
         break;
     }
     case BVH:
@@ -294,7 +312,7 @@ void detect_collision_candidates_linear_bvh(
                      + (pA_t1 - pB_t1).transpose())
                     * RB_t1;
 
-                std::vector<AABB> VA_aabbs;
+                std::vector<BroadPhaseAABB> VA_aabbs;
                 VA_aabbs.reserve(bodyA.num_vertices());
                 for (int i = 0; i < bodyA.num_vertices(); i++) {
                     const auto& v_t0 = VA_t0.row(i);
@@ -0,0 +1,129 @@
+#include "edge_vertex_ccd.hpp"
+
+#include <autogen/time_of_impact_coeff.hpp>
+#include <constants.hpp>
+
+namespace ipc::rigid {
+
+void solve_time_of_impact_quadratics(
+    const Eigen::ArrayXd& a,
+    const Eigen::ArrayXd& b,
+    const Eigen::ArrayXd& c,
+    Eigen::ArrayXd& x1,
+    Eigen::ArrayXd& x2,
+    ArrayXb& is_degenerate)
+{
+    const long n = a.size();
+    assert(b.size() == n && c.size() == n);
+    const Eigen::ArrayXd invalid = Eigen::ArrayXd::Constant(n, -1);
+
+    const ArrayXb a_not_zero = a.abs() > Constants::TOI_COEFF_EPSILON;
+    const ArrayXb b_not_zero = b.abs() > Constants::TOI_COEFF_EPSILON;
+    const ArrayXb c_not_zero = c.abs() > Constants::TOI_COEFF_EPSILON;
+
+    // Every lane evaluates both formulas and keeps the one of its branch
+    const Eigen::ArrayXd radicand = b * b - 4 * a * c;
+    const Eigen::ArrayXd sqrt_rad = radicand.max(0).sqrt();
+    const ArrayXb b_positive = b > 0;
+    // (1) (-b -/+ sqrt(b^2 - 4ac)) / 2a and (2) -/+2c / (b +/- sqrt(...))
+    const Eigen::ArrayXd x_quadratic =
+        b_positive.select(-b - sqrt_rad, -b + sqrt_rad) / (2 * a);
+    const Eigen::ArrayXd x_stable = b_positive.select(
+        -2 * c / (b + sqrt_rad), 2 * c / (-b + sqrt_rad));
+    const Eigen::ArrayXd x_double = -b / (2 * a);
+
+    const ArrayXb has_two_roots = radicand > 0;
+    const ArrayXb has_double_root = radicand == 0 && a_not_zero;
+    x1 = has_two_roots.select(
+        b_positive.select(x_stable, x_quadratic),
+        has_double_root.select(x_double, invalid));
+    x2 = has_two_roots.select(
+        b_positive.select(x_quadratic, x_stable), invalid);
+
+    is_degenerate = !has_two_roots && !has_double_root && !a_not_zero
+        && !b_not_zero && !c_not_zero;
+}
+
+namespace {
+    /// @brief Batched temporal_parameterization_to_spatial() checking that
+    /// both the time and the position along the edge are in [0, 1].
+    ArrayXb check_solutions(
+        const Eigen::ArrayX2d& Vi,
+        const Eigen::ArrayX2d& Vj,
+        const Eigen::ArrayX2d& Vk,
+        const Eigen::ArrayX2d& Ui,
+        const Eigen::ArrayX2d& Uj,
+        const Eigen::ArrayX2d& Uk,
+        const Eigen::ArrayXd& t,
+        Eigen::ArrayXd& alpha)
+    {
+        const Eigen::ArrayX2d numerator = Vk - Vi + (Uk - Ui).colwise() * t;
+        const Eigen::ArrayX2d denominator = Vj - Vi + (Uj - Ui).colwise() * t;
+
+        const ArrayXb use_x =
+            denominator.col(0).abs() > Constants::ALPHA_DIVISION_EPSILON;
+        const ArrayXb use_y =
+            denominator.col(1).abs() > Constants::ALPHA_DIVISION_EPSILON;
+        alpha = use_x.select(
+            numerator.col(0) / denominator.col(0),
+            use_y.select(
+                numerator.col(1) / denominator.col(1),
+                Eigen::ArrayXd::Constant(t.size(), -1)));
+
+        return t >= 0 && t <= 1 && (use_x || use_y) && alpha >= 0
+            && alpha <= 1;
+    }
+} // namespace
+
+void compute_edge_vertex_time_of_impacts(
+    const Eigen::ArrayX2d& Vi,
+    const Eigen::ArrayX2d& Vj,
+    const Eigen::ArrayX2d& Vk,
+    const Eigen::ArrayX2d& Ui,
+    const Eigen::ArrayX2d& Uj,
+    const Eigen::ArrayX2d& Uk,
+    Eigen::ArrayXd& toi,
+    Eigen::ArrayXd& alpha,
+    ArrayXb& is_impacting)
+{
+    Eigen::ArrayXd a, b, c;
+    autogen::time_of_impact_coeffs(Vi, Vj, Vk, Ui, Uj, Uk, a, b, c);
+
+    // Same normalization as the scalar coefficients
+    const Eigen::ArrayXd max_coeff = a.max(b.max(c));
+    a /= max_coeff;
+    b /= max_coeff;
+    c /= max_coeff;
+
+    Eigen::ArrayXd x1, x2;
+    ArrayXb is_degenerate;
+    solve_time_of_impact_quadratics(a, b, c, x1, x2, is_degenerate);
+
+    Eigen::ArrayXd alpha1, alpha2;
+    const ArrayXb x1_valid =
+        check_solutions(Vi, Vj, Vk, Ui, Uj, Uk, x1, alpha1);
+    const ArrayXb x2_valid =
+        check_solutions(Vi, Vj, Vk, Ui, Uj, Uk, x2, alpha2);
+
+    const ArrayXb use_x1 = x1_valid && (!x2_valid || !(x2 < x1));
+    toi = use_x1.select(x1, x2);
+    alpha = (use_x1 && (!x2_valid || x1 < x2)).select(alpha1, alpha2);
+    is_impacting = x1_valid || x2_valid;
+
+    // The rare coincident point and edge fall back to their approximation
+    for (long i = 0; i < is_degenerate.size(); i++) {
+        if (is_degenerate(i)) {
+            const auto row = [i](const Eigen::ArrayX2d& X) {
+                return Eigen::Vector2d(X.row(i).transpose().matrix());
+            };
+            double toi_i, alpha_i;
+            is_impacting(i) = compute_edge_vertex_time_of_impact<double>(
+                row(Vi), row(Vj), row(Vk), row(Ui), row(Uj), row(Uk), toi_i,
+                alpha_i);
+            toi(i) = toi_i;
+            alpha(i) = alpha_i;
+        }
+    }
+}
+
+} // namespace ipc::rigid
@@ -72,6 +72,45 @@ bool compute_edge_vertex_time_of_impact(
         Vi, Vj, Vk, Ui, Uj, Uk, toi, alpha);
 }
 
+/// @brief Boolean mask with one entry per candidate.
+typedef Eigen::Array<bool, Eigen::Dynamic, 1> ArrayXb;
+
+/**
+ * @brief Robust roots of many quadratics \f$at^2 + bt + c = 0\f$ at once.
+ *
+ * Uses the same cancellation-free formulas as
+ * compute_edge_vertex_time_of_impact() on every lane. Missing roots are -1.
+ *
+ *   @param[out]  is_degenerate   : lanes with \f$a = b = c = 0\f$ whose
+ * roots are left to the caller
+ */
+void solve_time_of_impact_quadratics(
+    const Eigen::ArrayXd& a,
+    const Eigen::ArrayXd& b,
+    const Eigen::ArrayXd& c,
+    Eigen::ArrayXd& x1,
+    Eigen::ArrayXd& x2,
+    ArrayXb& is_degenerate);
+
+/**
+ * @brief Batched compute_edge_vertex_time_of_impact() of double candidates.
+ *
+ * Each input holds one candidate per row, so the coefficients and roots are
+ * evaluated on whole columns with the branches of the scalar version.
+ *
+ *   @param[out]  is_impacting    : whether each candidate impacts in [0, 1]
+ */
+void compute_edge_vertex_time_of_impacts(
+    const Eigen::ArrayX2d& Vi,
+    const Eigen::ArrayX2d& Vj,
+    const Eigen::ArrayX2d& Vk,
+    const Eigen::ArrayX2d& Ui,
+    const Eigen::ArrayX2d& Uj,
+    const Eigen::ArrayX2d& Uk,
+    Eigen::ArrayXd& toi,
+    Eigen::ArrayXd& alpha,
+    ArrayXb& is_impacting);
+
 } // namespace ipc::rigid
 
 #include "edge_vertex_ccd.tpp"
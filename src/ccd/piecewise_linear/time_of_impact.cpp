@@ -1,6 +1,7 @@
 // Time-of-impact computation for rigid bodies with angular trajectories.
 #include "time_of_impact.hpp"
 
+#include <array>
 #include <stack>
 
 #include <tight_inclusion/inclusion_ccd.hpp>
@@ -52,6 +53,20 @@ static const int TIGHT_INCLUSION_CCD_TYPE = 1;
 // outer CCD algorithmn will perform the refinement in a smarter way.
 static const bool TIGHT_INCLUSION_NO_ZERO_TOI = false;
 
+/// World positions of some vertices of a body. The rotation is built once,
+/// and the sub-steps share their end points, so each is only computed once.
+template <size_t N>
+std::array<VectorMax3d, N> world_vertices(
+    const RigidBody& body, const PoseD& pose, const std::array<long, N>& ids)
+{
+    const MatrixMax3d R = pose.construct_rotation_matrix();
+    std::array<VectorMax3d, N> vertices;
+    for (size_t i = 0; i < N; i++) {
+        vertices[i] = body.world_vertex<double>(R, pose.position, ids[i]);
+    }
+    return vertices;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 // Edge-Vertex
 
@@ -125,9 +140,15 @@ bool compute_piecewise_linear_edge_vertex_time_of_impact(
     const long e0i = bodyB.edges(edge_id, 0);
     const long e1i = bodyB.edges(edge_id, 1);
 
+    std::array<VectorMax3d, 1> vA_ti0 =
+        world_vertices<1>(bodyA, poseA_t0, { { vi } });
+    std::array<VectorMax3d, 2> vB_ti0 =
+        world_vertices<2>(bodyB, poseB_t0, { { e0i, e1i } });
+    std::array<VectorMax3d, 1> vA_ti1;
+    std::array<VectorMax3d, 2> vB_ti1;
+
     double distance_t0 = sqrt(point_edge_distance(
-        bodyA.world_vertex(poseA_t0, vi), //
-        bodyB.world_vertex(poseB_t0, e0i), bodyB.world_vertex(poseB_t0, e1i)));
+        vA_ti0[0], vB_ti0[0], vB_ti0[1]));
     if (distance_t0 <= minimum_separation_distance) {
         spdlog::warn(
             "initial distance in edge-vertex CCD is less than MS={:g}!",
@@ -157,11 +178,11 @@ bool compute_piecewise_linear_edge_vertex_time_of_impact(
 
         PoseD poseA_ti1 = PoseD::interpolate(poseA_t0, poseA_t1, ti1);
         PoseD poseB_ti1 = PoseD::interpolate(poseB_t0, poseB_t1, ti1);
+        vA_ti1 = world_vertices<1>(bodyA, poseA_ti1, { { vi } });
+        vB_ti1 = world_vertices<2>(bodyB, poseB_ti1, { { e0i, e1i } });
 
         double distance_ti0 = sqrt(point_edge_distance(
-            bodyA.world_vertex(poseA_ti1, vi),
-            bodyB.world_vertex(poseB_ti1, e0i),
-            bodyB.world_vertex(poseB_ti1, e1i)));
+            vA_ti1[0], vB_ti1[0], vB_ti1[1]));
 
 #ifdef USE_DECREASING_DISTANCE_CHECK
         if ((distance_ti0 < DECREASING_DISTANCE_FACTOR * distance_t0)
@@ -186,23 +207,23 @@ bool compute_piecewise_linear_edge_vertex_time_of_impact(
         MatrixMax3I RA = poseIA.construct_rotation_matrix();
         MatrixMax3I RB = poseIB.construct_rotation_matrix();
 
-        Vector2I v_ti0 = bodyA.world_vertex(poseA_ti0, vi).cast<Interval>();
-        Vector2I v_ti1 = bodyA.world_vertex(poseA_ti1, vi).cast<Interval>();
+        Vector2I v_ti0 = vA_ti0[0].cast<Interval>();
+        Vector2I v_ti1 = vA_ti1[0].cast<Interval>();
         Vector2I v = bodyA.world_vertex(RA, poseIA.position, vi);
         Interval d = (v - ((v_ti1 - v_ti0) * ti + v_ti0)).norm();
         assert(abs(d.lower()) < 1e-12); // The endpoints are part of both curves
         double v_min_distance = d.upper();
 
         double e_min_distance = 0;
-        Vector2I e0_ti0 = bodyB.world_vertex(poseB_ti0, e0i).cast<Interval>();
-        Vector2I e0_ti1 = bodyB.world_vertex(poseB_ti1, e0i).cast<Interval>();
+        Vector2I e0_ti0 = vB_ti0[0].cast<Interval>();
+        Vector2I e0_ti1 = vB_ti1[0].cast<Interval>();
         Vector2I e0 = bodyB.world_vertex(RB, poseIB.position, e0i);
         d = (e0 - ((e0_ti1 - e0_ti0) * ti + e0_ti0)).norm();
         assert(abs(d.lower()) < 1e-12); // The endpoints are part of both curves
         e_min_distance = std::max(e_min_distance, d.upper());
 
-        Vector2I e1_ti0 = bodyB.world_vertex(poseB_ti0, e1i).cast<Interval>();
-        Vector2I e1_ti1 = bodyB.world_vertex(poseB_ti1, e1i).cast<Interval>();
+        Vector2I e1_ti0 = vB_ti0[1].cast<Interval>();
+        Vector2I e1_ti1 = vB_ti1[1].cast<Interval>();
         Vector2I e1 = bodyB.world_vertex(RB, poseIB.position, e1i);
         d = (e1 - ((e1_ti1 - e1_ti0) * ti + e1_ti0)).norm();
         assert(abs(d.lower()) < 1e-12); // The endpoints are part of both curves
@@ -221,12 +242,8 @@ bool compute_piecewise_linear_edge_vertex_time_of_impact(
 
         double output_tolerance;
         is_impacting = tight_inclusion_point_edge_ccd(
-            bodyA.world_vertex(poseA_ti0, vi),
-            bodyB.world_vertex(poseB_ti0, e0i),
-            bodyB.world_vertex(poseB_ti0, e1i),
-            bodyA.world_vertex(poseA_ti1, vi),
-            bodyB.world_vertex(poseB_ti1, e0i),
-            bodyB.world_vertex(poseB_ti1, e1i),
+            vA_ti0[0], vB_ti0[0], vB_ti0[1], //
+            vA_ti1[0], vB_ti1[0], vB_ti1[1], //
             { { -1, -1, -1 } },        // rounding error
             min_distance,              // minimum separation distance
             toi,                       // time of impact
@@ -257,6 +274,8 @@ bool compute_piecewise_linear_edge_vertex_time_of_impact(
         ti0 = ti1;
         poseA_ti0 = poseA_ti1;
         poseB_ti0 = poseB_ti1;
+        vA_ti0 = vA_ti1;
+        vB_ti0 = vB_ti1;
     }
 
     // This time of impact is very dangerous for convergence
@@ -292,10 +311,15 @@ bool compute_piecewise_linear_edge_edge_time_of_impact(
     const long eb0i = bodyB.edges(edgeB_id, 0);
     const long eb1i = bodyB.edges(edgeB_id, 1);
 
+    std::array<VectorMax3d, 2> vA_ti0 =
+        world_vertices<2>(bodyA, poseA_t0, { { ea0i, ea1i } });
+    std::array<VectorMax3d, 2> vB_ti0 =
+        world_vertices<2>(bodyB, poseB_t0, { { eb0i, eb1i } });
+    std::array<VectorMax3d, 2> vA_ti1;
+    std::array<VectorMax3d, 2> vB_ti1;
+
     double distance_t0 = sqrt(edge_edge_distance(
-        bodyA.world_vertex(poseA_t0, ea0i), bodyA.world_vertex(poseA_t0, ea1i),
-        bodyB.world_vertex(poseB_t0, eb0i),
-        bodyB.world_vertex(poseB_t0, eb1i)));
+        vA_ti0[0], vA_ti0[1], vB_ti0[0], vB_ti0[1]));
     if (distance_t0 <= minimum_separation_distance) {
         spdlog::warn(
             "initial distance in edge-edge CCD is less than MS={:g}!",
@@ -331,12 +355,11 @@ bool compute_piecewise_linear_edge_edge_time_of_impact(
 
         PoseD poseA_ti1 = PoseD::interpolate(poseA_t0, poseA_t1, ti1);
         PoseD poseB_ti1 = PoseD::interpolate(poseB_t0, poseB_t1, ti1);
+        vA_ti1 = world_vertices<2>(bodyA, poseA_ti1, { { ea0i, ea1i } });
+        vB_ti1 = world_vertices<2>(bodyB, poseB_ti1, { { eb0i, eb1i } });
 
         double distance_ti0 = sqrt(edge_edge_distance(
-            bodyA.world_vertex(poseA_ti0, bodyA.edges(edgeA_id, 0)),
-            bodyA.world_vertex(poseA_ti0, bodyA.edges(edgeA_id, 1)),
-            bodyB.world_vertex(poseB_ti0, bodyB.edges(edgeB_id, 0)),
-            bodyB.world_vertex(poseB_ti0, bodyB.edges(edgeB_id, 1))));
+            vA_ti0[0], vA_ti0[1], vB_ti0[0], vB_ti0[1]));
 
 #ifdef USE_DECREASING_DISTANCE_CHECK
         if (distance_ti0 < DECREASING_DISTANCE_FACTOR * distance_t0
@@ -363,30 +386,30 @@ bool compute_piecewise_linear_edge_edge_time_of_impact(
         MatrixMax3I RB = poseIB.construct_rotation_matrix();
 
         double min_ea_distance = 0;
-        Vector3I ea0_ti0 = bodyA.world_vertex(poseA_ti0, ea0i).cast<Interval>();
-        Vector3I ea0_ti1 = bodyA.world_vertex(poseA_ti1, ea0i).cast<Interval>();
+        Vector3I ea0_ti0 = vA_ti0[0].cast<Interval>();
+        Vector3I ea0_ti1 = vA_ti1[0].cast<Interval>();
         Vector3I ea0 = bodyA.world_vertex(RA, poseIA.position, ea0i);
         Interval d = (ea0 - ((ea0_ti1 - ea0_ti0) * ti + ea0_ti0)).norm();
         assert(abs(d.lower()) < 1e-12); // The endpoints are part of both curves
         min_ea_distance = std::max(min_ea_distance, d.upper());
 
-        Vector3I ea1_ti0 = bodyA.world_vertex(poseA_ti0, ea1i).cast<Interval>();
-        Vector3I ea1_ti1 = bodyA.world_vertex(poseA_ti1, ea1i).cast<Interval>();
+        Vector3I ea1_ti0 = vA_ti0[1].cast<Interval>();
+        Vector3I ea1_ti1 = vA_ti1[1].cast<Interval>();
         Vector3I ea1 = bodyA.world_vertex(RA, poseIA.position, ea1i);
         d = (ea1 - ((ea1_ti1 - ea1_ti0) * ti + ea1_ti0)).norm();
         assert(abs(d.lower()) < 1e-12); // The endpoints are part of both curves
         min_ea_distance = std::max(min_ea_distance, d.upper());
 
         double min_eb_distance = 0;
-        Vector3I eb0_ti0 = bodyB.world_vertex(poseB_ti0, eb0i).cast<Interval>();
-        Vector3I eb0_ti1 = bodyB.world_vertex(poseB_ti1, eb0i).cast<Interval>();
+        Vector3I eb0_ti0 = vB_ti0[0].cast<Interval>();
+        Vector3I eb0_ti1 = vB_ti1[0].cast<Interval>();
         Vector3I eb0 = bodyB.world_vertex(RB, poseIB.position, eb0i);
         d = (eb0 - ((eb0_ti1 - eb0_ti0) * ti + eb0_ti0)).norm();
         assert(abs(d.lower()) < 1e-12); // The endpoints are part of both curves
         min_eb_distance = std::max(min_eb_distance, d.upper());
 
-        Vector3I eb1_ti0 = bodyB.world_vertex(poseB_ti0, eb1i).cast<Interval>();
-        Vector3I eb1_ti1 = bodyB.world_vertex(poseB_ti1, eb1i).cast<Interval>();
+        Vector3I eb1_ti0 = vB_ti0[1].cast<Interval>();
+        Vector3I eb1_ti1 = vB_ti1[1].cast<Interval>();
         Vector3I eb1 = bodyB.world_vertex(RB, poseIB.position, eb1i);
         d = (eb1 - ((eb1_ti1 - eb1_ti0) * ti + eb1_ti0)).norm();
         assert(abs(d.lower()) < 1e-12); // The endpoints are part of both curves
@@ -409,14 +432,8 @@ bool compute_piecewise_linear_edge_edge_time_of_impact(
         // 1: ccd with max_itr and t=[0, t_max]
         const int CCD_TYPE = 1;
         is_impacting = inclusion_ccd::edgeEdgeCCD_double(
-            bodyA.world_vertex(poseA_ti0, bodyA.edges(edgeA_id, 0)),
-            bodyA.world_vertex(poseA_ti0, bodyA.edges(edgeA_id, 1)),
-            bodyB.world_vertex(poseB_ti0, bodyB.edges(edgeB_id, 0)),
-            bodyB.world_vertex(poseB_ti0, bodyB.edges(edgeB_id, 1)),
-            bodyA.world_vertex(poseA_ti1, bodyA.edges(edgeA_id, 0)),
-            bodyA.world_vertex(poseA_ti1, bodyA.edges(edgeA_id, 1)),
-            bodyB.world_vertex(poseB_ti1, bodyB.edges(edgeB_id, 0)),
-            bodyB.world_vertex(poseB_ti1, bodyB.edges(edgeB_id, 1)),
+            vA_ti0[0], vA_ti0[1], vB_ti0[0], vB_ti0[1], //
+            vA_ti1[0], vA_ti1[1], vB_ti1[0], vB_ti1[1], //
             { { -1, -1, -1 } },        // rounding error
             min_distance,              // minimum separation distance
             toi,                       // time of impact
@@ -447,6 +464,8 @@ bool compute_piecewise_linear_edge_edge_time_of_impact(
         ti0 = ti1;
         poseA_ti0 = poseA_ti1;
         poseB_ti0 = poseB_ti1;
+        vA_ti0 = vA_ti1;
+        vB_ti0 = vB_ti1;
     }
     // spdlog::trace("ee_ccd_num_subdivision={:d}", num_subdivisions);
 
@@ -488,9 +507,15 @@ bool compute_piecewise_linear_face_vertex_time_of_impact(
     const long f1i = bodyB.faces(face_id, 1);
     const long f2i = bodyB.faces(face_id, 2);
 
+    std::array<VectorMax3d, 1> vA_ti0 =
+        world_vertices<1>(bodyA, poseA_t0, { { vi } });
+    std::array<VectorMax3d, 3> vB_ti0 =
+        world_vertices<3>(bodyB, poseB_t0, { { f0i, f1i, f2i } });
+    std::array<VectorMax3d, 1> vA_ti1;
+    std::array<VectorMax3d, 3> vB_ti1;
+
     double distance_t0 = sqrt(point_triangle_distance(
-        bodyA.world_vertex(poseA_t0, vi), bodyB.world_vertex(poseB_t0, f0i),
-        bodyB.world_vertex(poseB_t0, f1i), bodyB.world_vertex(poseB_t0, f2i)));
+        vA_ti0[0], vB_ti0[0], vB_ti0[1], vB_ti0[2]));
     if (distance_t0 <= minimum_separation_distance) {
         spdlog::warn(
             "initial distance in faces-vertex CCD is less than MS={:g}!",
@@ -525,12 +550,11 @@ bool compute_piecewise_linear_face_vertex_time_of_impact(
 
         PoseD poseA_ti1 = PoseD::interpolate(poseA_t0, poseA_t1, ti1);
         PoseD poseB_ti1 = PoseD::interpolate(poseB_t0, poseB_t1, ti1);
+        vA_ti1 = world_vertices<1>(bodyA, poseA_ti1, { { vi } });
+        vB_ti1 = world_vertices<3>(bodyB, poseB_ti1, { { f0i, f1i, f2i } });
 
         double distance_ti0 = sqrt(point_triangle_distance(
-            bodyA.world_vertex(poseA_ti0, vi),
-            bodyB.world_vertex(poseB_ti0, f0i),
-            bodyB.world_vertex(poseB_ti0, f1i),
-            bodyB.world_vertex(poseB_ti0, f2i)));
+            vA_ti0[0], vB_ti0[0], vB_ti0[1], vB_ti0[2]));
 
 #ifdef USE_DECREASING_DISTANCE_CHECK
         if ((distance_ti0 < DECREASING_DISTANCE_FACTOR * distance_t0)
@@ -555,30 +579,30 @@ bool compute_piecewise_linear_face_vertex_time_of_impact(
         MatrixMax3I RA = poseIA.construct_rotation_matrix();
         MatrixMax3I RB = poseIB.construct_rotation_matrix();
 
-        Vector3I v_ti0 = bodyA.world_vertex(poseA_ti0, vi).cast<Interval>();
-        Vector3I v_ti1 = bodyA.world_vertex(poseA_ti1, vi).cast<Interval>();
+        Vector3I v_ti0 = vA_ti0[0].cast<Interval>();
+        Vector3I v_ti1 = vA_ti1[0].cast<Interval>();
         Vector3I v = bodyA.world_vertex(RA, poseIA.position, vi);
         Interval d = (v - ((v_ti1 - v_ti0) * ti + v_ti0)).norm();
         assert(abs(d.lower()) < 1e-12); // The endpoints are part of both curves
         double v_min_distance = d.upper();
 
         double f_min_distance = 0;
-        Vector3I f0_ti0 = bodyB.world_vertex(poseB_ti0, f0i).cast<Interval>();
-        Vector3I f0_ti1 = bodyB.world_vertex(poseB_ti1, f0i).cast<Interval>();
+        Vector3I f0_ti0 = vB_ti0[0].cast<Interval>();
+        Vector3I f0_ti1 = vB_ti1[0].cast<Interval>();
         Vector3I f0 = bodyB.world_vertex(RB, poseIB.position, f0i);
         d = (f0 - ((f0_ti1 - f0_ti0) * ti + f0_ti0)).norm();
         assert(abs(d.lower()) < 1e-12); // The endpoints are part of both curves
         f_min_distance = std::max(f_min_distance, d.upper());
 
-        Vector3I f1_ti0 = bodyB.world_vertex(poseB_ti0, f1i).cast<Interval>();
-        Vector3I f1_ti1 = bodyB.world_vertex(poseB_ti1, f1i).cast<Interval>();
+        Vector3I f1_ti0 = vB_ti0[1].cast<Interval>();
+        Vector3I f1_ti1 = vB_ti1[1].cast<Interval>();
         Vector3I f1 = bodyB.world_vertex(RB, poseIB.position, f1i);
         d = (f1 - ((f1_ti1 - f1_ti0) * ti + f1_ti0)).norm();
         assert(abs(d.lower()) < 1e-12); // The endpoints are part of both curves
         f_min_distance = std::max(f_min_distance, d.upper());
 
-        Vector3I f2_ti0 = bodyB.world_vertex(poseB_ti0, f2i).cast<Interval>();
-        Vector3I f2_ti1 = bodyB.world_vertex(poseB_ti1, f2i).cast<Interval>();
+        Vector3I f2_ti0 = vB_ti0[2].cast<Interval>();
+        Vector3I f2_ti1 = vB_ti1[2].cast<Interval>();
         Vector3I f2 = bodyB.world_vertex(RB, poseIB.position, f2i);
         d = (f2 - ((f2_ti1 - f2_ti0) * ti + f2_ti0)).norm();
         assert(abs(d.lower()) < 1e-12); // The endpoints are part of both curves
@@ -597,14 +621,8 @@ bool compute_piecewise_linear_face_vertex_time_of_impact(
 
         double output_tolerance;
         is_impacting = inclusion_ccd::vertexFaceCCD_double(
-            bodyA.world_vertex(poseA_ti0, vi),
-            bodyB.world_vertex(poseB_ti0, f0i),
-            bodyB.world_vertex(poseB_ti0, f1i),
-            bodyB.world_vertex(poseB_ti0, f2i),
-            bodyA.world_vertex(poseA_ti1, vi),
-            bodyB.world_vertex(poseB_ti1, f0i),
-            bodyB.world_vertex(poseB_ti1, f1i),
-            bodyB.world_vertex(poseB_ti1, f2i),
+            vA_ti0[0], vB_ti0[0], vB_ti0[1], vB_ti0[2], //
+            vA_ti1[0], vB_ti1[0], vB_ti1[1], vB_ti1[2], //
             { { -1, -1, -1 } },        // rounding error
             min_distance,              // minimum separation distance
             toi,                       // time of impact
@@ -635,6 +653,8 @@ bool compute_piecewise_linear_face_vertex_time_of_impact(
         ti0 = ti1;
         poseA_ti0 = poseA_ti1;
         poseB_ti0 = poseB_ti1;
+        vA_ti0 = vA_ti1;
+        vB_ti0 = vB_ti1;
     }
     // spdlog::trace("vf_ccd_num_subdivision={:d}", num_subdivisions);
 
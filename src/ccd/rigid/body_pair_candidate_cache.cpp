@@ -0,0 +1,80 @@
+#include "body_pair_candidate_cache.hpp"
+
+#include <ccd/rigid/rigid_body_bvh.hpp>
+
+namespace ipc::rigid {
+
+void BodyPairCandidateCache::detect_body_pair_collision_candidates(
+    const RigidBodyAssembler& bodies,
+    const Poses<Interval>& poses,
+    const std::vector<MatrixMax3I>& rotations,
+    int bodyA_id,
+    int bodyB_id,
+    const int collision_types,
+    Candidates& candidates,
+    const double inflation_radius)
+{
+    sort_body_pair(bodies, bodyA_id, bodyB_id);
+
+    // Compute the smaller body's vertices in the larger body's local
+    // coordinates.
+    const MatrixMax3I& RA = rotations[bodyA_id];
+    const MatrixMax3I& RB = rotations[bodyB_id];
+    const auto& pA = poses[bodyA_id].position;
+    const auto& pB = poses[bodyB_id].position;
+    const MatrixXI VA =
+        ((bodies[bodyA_id].vertices * RA.transpose()).rowwise()
+         + (pA - pB).transpose())
+        * RB;
+
+    // Each pair is only ever touched by a single thread, so the entry can be
+    // modified without locking.
+    Entry& entry =
+        m_entries[long(bodyA_id) * bodies.num_bodies() + long(bodyB_id)];
+
+    static thread_local std::vector<BroadPhaseAABB> bodyA_vertex_aabbs;
+    vertex_aabbs(VA, bodyA_vertex_aabbs, inflation_radius);
+
+    if (entry.collision_types != collision_types
+        || entry.inflation_radius != inflation_radius
+        || !is_inside(bodyA_vertex_aabbs, entry.bodyA_vertex_aabbs)) {
+        entry.collision_types = collision_types;
+        entry.inflation_radius = inflation_radius;
+        // Refit the cached boxes in place
+        vertex_aabbs(
+            VA, entry.bodyA_vertex_aabbs,
+            inflation_radius + margin_scale * inflation_radius);
+        entry.candidates.clear();
+        detect_body_pair_collision_candidates_from_aabbs(
+            bodies, entry.bodyA_vertex_aabbs, bodyA_id, bodyB_id,
+            collision_types, entry.candidates, inflation_radius);
+    }
+
+    candidates.ev_candidates.insert(
+        candidates.ev_candidates.end(), entry.candidates.ev_candidates.begin(),
+        entry.candidates.ev_candidates.end());
+    candidates.ee_candidates.insert(
+        candidates.ee_candidates.end(), entry.candidates.ee_candidates.begin(),
+        entry.candidates.ee_candidates.end());
+    candidates.fv_candidates.insert(
+        candidates.fv_candidates.end(), entry.candidates.fv_candidates.begin(),
+        entry.candidates.fv_candidates.end());
+}
+
+bool BodyPairCandidateCache::is_inside(
+    const std::vector<BroadPhaseAABB>& inner,
+    const std::vector<BroadPhaseAABB>& outer)
+{
+    if (inner.size() != outer.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < inner.size(); i++) {
+        if ((inner[i].getMin() < outer[i].getMin()).any()
+            || (inner[i].getMax() > outer[i].getMax()).any()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace ipc::rigid
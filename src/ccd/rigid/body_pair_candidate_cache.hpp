@@ -0,0 +1,70 @@
+#pragma once
+
+#include <tbb/concurrent_unordered_map.h>
+
+#include <Eigen/Core>
+
+#include <ipc/broad_phase/collision_candidate.hpp>
+#include <ipc/broad_phase/hash_grid.hpp>
+
+#include <ccd/rigid/float_aabb.hpp>
+#include <interval/interval.hpp>
+#include <physics/rigid_body_assembler.hpp>
+
+namespace ipc::rigid {
+
+/// @brief Cache of the BVH candidates of body pairs.
+///
+/// The candidates of a pair are computed with body A's vertex boxes grown by
+/// an extra margin. While the new vertex boxes stay inside the cached ones,
+/// the cached candidates are a superset of the new candidates and the
+/// traversal of body B's BVH can be skipped.
+class BodyPairCandidateCache {
+public:
+    /// @param margin_scale Extra margin as a multiple of the inflation radius.
+    BodyPairCandidateCache(const double margin_scale = 1.0)
+        : margin_scale(margin_scale)
+    {
+    }
+
+    /// @brief Append the candidates of a body pair, reusing the cached ones
+    /// if body A's vertex boxes did not leave the cached boxes.
+    /// @param rotations Rotation matrices of the poses.
+    void detect_body_pair_collision_candidates(
+        const RigidBodyAssembler& bodies,
+        const Poses<Interval>& poses,
+        const std::vector<MatrixMax3I>& rotations,
+        int bodyA_id,
+        int bodyB_id,
+        const int collision_types,
+        Candidates& candidates,
+        const double inflation_radius = 0.0);
+
+    /// @brief Remove all cached body pairs.
+    void clear() { m_entries.clear(); }
+
+    /// @brief Number of cached body pairs.
+    size_t size() const { return m_entries.size(); }
+
+    /// @brief Extra margin as a multiple of the inflation radius.
+    double margin_scale;
+
+protected:
+    struct Entry {
+        /// @brief Body A's grown vertex boxes in body B's local frame.
+        std::vector<BroadPhaseAABB> bodyA_vertex_aabbs;
+        /// @brief Candidates found using bodyA_vertex_aabbs.
+        Candidates candidates;
+        int collision_types = 0;
+        double inflation_radius = -1;
+    };
+
+    static bool is_inside(
+        const std::vector<BroadPhaseAABB>& inner,
+        const std::vector<BroadPhaseAABB>& outer);
+
+    /// @brief Cached entries keyed on bodyA_id * num_bodies + bodyB_id.
+    tbb::concurrent_unordered_map<long, Entry> m_entries;
+};
+
+} // namespace ipc::rigid
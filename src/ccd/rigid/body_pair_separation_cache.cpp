@@ -0,0 +1,130 @@
+#include "body_pair_separation_cache.hpp"
+
+#include <algorithm>
+#include <limits>
+
+#include <ccd/ccd.hpp>
+#include <ccd/rigid/rigid_body_bvh.hpp>
+#include <utils/step_metrics.hpp>
+
+namespace ipc::rigid {
+
+bool BodyPairSeparationCache::is_separated(
+    const RigidBodyAssembler& bodies,
+    const PosesD& poses_t0,
+    const PosesD& poses_t1,
+    int bodyA_id,
+    int bodyB_id,
+    const int collision_types,
+    const double inflation_radius) const
+{
+    const auto it = m_entries.find(key(bodies, bodyA_id, bodyB_id));
+    if (it == m_entries.end() || it->second.separation < 0
+        || it->second.collision_types != collision_types) {
+        return false;
+    }
+    const Entry& entry = it->second;
+    const RigidBody& bodyA = bodies[bodyA_id];
+    const RigidBody& bodyB = bodies[bodyB_id];
+
+    // The separation holds between the bodies at the same time, so both are
+    // measured from the same end of the cached trajectory.
+    double displacement = std::numeric_limits<double>::infinity();
+    for (int i = 0; i < 2; i++) {
+        displacement = std::min(
+            displacement,
+            max_trajectory_displacement(
+                entry.poseA[i], poses_t0[bodyA_id], bodyA.r_max)
+                + max_trajectory_displacement(
+                    entry.poseB[i], poses_t0[bodyB_id], bodyB.r_max));
+    }
+    displacement += max_trajectory_displacement(
+        poses_t0[bodyA_id], poses_t1[bodyA_id], bodyA.r_max);
+    displacement += max_trajectory_displacement(
+        poses_t0[bodyB_id], poses_t1[bodyB_id], bodyB.r_max);
+
+    return entry.separation - displacement > 2 * inflation_radius;
+}
+
+void BodyPairSeparationCache::detect_body_pair_collision_candidates(
+    const RigidBodyAssembler& bodies,
+    const PosesD& poses_t0,
+    const PosesD& poses_t1,
+    const Poses<Interval>& poses,
+    const std::vector<MatrixMax3I>& rotations,
+    int bodyA_id,
+    int bodyB_id,
+    const int collision_types,
+    Candidates& candidates,
+    const double inflation_radius)
+{
+    sort_body_pair(bodies, bodyA_id, bodyB_id);
+
+    if (is_separated(
+            bodies, poses_t0, poses_t1, bodyA_id, bodyB_id, collision_types,
+            inflation_radius)) {
+        StepMetrics::add_count(StepMetrics::SEPARATION_CACHE_REJECTIONS);
+        return;
+    }
+
+    // Compute the smaller body's vertices in the larger body's local
+    // coordinates.
+    const MatrixMax3I& RA = rotations[bodyA_id];
+    const MatrixMax3I& RB = rotations[bodyB_id];
+    const auto& pA = poses[bodyA_id].position;
+    const auto& pB = poses[bodyB_id].position;
+    static thread_local MatrixXI VA;
+    VA.noalias() = ((bodies[bodyA_id].vertices * RA.transpose()).rowwise()
+                    + (pA - pB).transpose())
+        * RB;
+
+    // Each pair is only ever touched by a single thread, so the entry can be
+    // modified without locking.
+    Entry& entry = m_entries[key(bodies, bodyA_id, bodyB_id)];
+    const auto save_separation = [&](double separation) {
+        entry.poseA = { { poses_t0[bodyA_id], poses_t1[bodyA_id] } };
+        entry.poseB = { { poses_t0[bodyB_id], poses_t1[bodyB_id] } };
+        entry.separation = separation;
+    };
+
+    static thread_local std::vector<BroadPhaseAABB> bodyA_vertex_aabbs;
+
+    // Pairs that were in contact are not grown, so they are only traversed
+    // once until they separate.
+    if (entry.separation >= 0 || entry.collision_types != collision_types) {
+        entry.collision_types = collision_types;
+        const double margin = margin_scale
+            * (max_trajectory_displacement(
+                   poses_t0[bodyA_id], poses_t1[bodyA_id],
+                   bodies[bodyA_id].r_max)
+               + max_trajectory_displacement(
+                   poses_t0[bodyB_id], poses_t1[bodyB_id],
+                   bodies[bodyB_id].r_max)
+               + inflation_radius);
+        vertex_aabbs(VA, bodyA_vertex_aabbs, inflation_radius + margin);
+
+        static thread_local Candidates grown_candidates;
+        grown_candidates.clear();
+        detect_body_pair_collision_candidates_from_aabbs(
+            bodies, bodyA_vertex_aabbs, bodyA_id, bodyB_id, collision_types,
+            grown_candidates, inflation_radius);
+        if (grown_candidates.size() == 0) {
+            // Disjoint boxes are farther apart than the sum of their radii
+            save_separation(2 * inflation_radius + margin);
+            return;
+        }
+    }
+
+    const size_t num_candidates = candidates.size();
+    vertex_aabbs(VA, bodyA_vertex_aabbs, inflation_radius);
+    detect_body_pair_collision_candidates_from_aabbs(
+        bodies, bodyA_vertex_aabbs, bodyA_id, bodyB_id, collision_types,
+        candidates, inflation_radius);
+    if (candidates.size() == num_candidates) {
+        save_separation(2 * inflation_radius);
+    } else {
+        entry.separation = -1;
+    }
+}
+
+} // namespace ipc::rigid
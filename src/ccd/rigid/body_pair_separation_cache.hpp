@@ -0,0 +1,86 @@
+#pragma once
+
+#include <array>
+
+#include <tbb/concurrent_unordered_map.h>
+
+#include <ipc/broad_phase/collision_candidate.hpp>
+
+#include <interval/interval.hpp>
+#include <physics/rigid_body_assembler.hpp>
+
+namespace ipc::rigid {
+
+/// @brief Cache of certified separations of body pairs across CCD calls.
+///
+/// When the BVH traversal of a pair with its boxes grown by a margin finds no
+/// candidates, the bodies are farther apart than the grown radius over the
+/// whole trajectory. A later trajectory of the pair is skipped while this
+/// separation exceeds the bodies' displacement bound from the cached poses
+/// (see max_trajectory_displacement()) plus the inflation radius.
+class BodyPairSeparationCache {
+public:
+    /// @param margin_scale Margin as a multiple of the pair's displacement
+    /// bound plus the inflation radius.
+    BodyPairSeparationCache(const double margin_scale = 1.0)
+        : margin_scale(margin_scale)
+    {
+    }
+
+    /// @brief Append the candidates of a body pair over the trajectory from
+    /// poses_t0 to poses_t1, or none if the pair is certified separated.
+    /// @param poses     Interval poses over the trajectory.
+    /// @param rotations Rotation matrices of the interval poses.
+    void detect_body_pair_collision_candidates(
+        const RigidBodyAssembler& bodies,
+        const PosesD& poses_t0,
+        const PosesD& poses_t1,
+        const Poses<Interval>& poses,
+        const std::vector<MatrixMax3I>& rotations,
+        int bodyA_id,
+        int bodyB_id,
+        const int collision_types,
+        Candidates& candidates,
+        const double inflation_radius = 0.0);
+
+    /// @brief Is the pair certified to stay farther apart than twice the
+    /// inflation radius over the trajectory?
+    bool is_separated(
+        const RigidBodyAssembler& bodies,
+        const PosesD& poses_t0,
+        const PosesD& poses_t1,
+        int bodyA_id,
+        int bodyB_id,
+        const int collision_types,
+        const double inflation_radius) const;
+
+    /// @brief Remove all cached body pairs.
+    void clear() { m_entries.clear(); }
+
+    /// @brief Number of cached body pairs.
+    size_t size() const { return m_entries.size(); }
+
+    /// @brief Margin as a multiple of the pair's displacement bound plus the
+    /// inflation radius.
+    double margin_scale;
+
+protected:
+    struct Entry {
+        /// @brief Poses of the pair at the ends of the separated trajectory.
+        std::array<PoseD, 2> poseA, poseB;
+        /// @brief Lower bound of the distance over the trajectory (negative
+        /// if the last traversal found candidates).
+        double separation = -1;
+        int collision_types = 0;
+    };
+
+    long key(const RigidBodyAssembler& bodies, int bodyA_id, int bodyB_id) const
+    {
+        return long(bodyA_id) * bodies.num_bodies() + long(bodyB_id);
+    }
+
+    /// @brief Cached entries keyed on bodyA_id * num_bodies + bodyB_id.
+    tbb::concurrent_unordered_map<long, Entry> m_entries;
+};
+
+} // namespace ipc::rigid
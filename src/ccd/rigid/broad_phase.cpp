@@ -1,16 +1,91 @@
 #include "broad_phase.hpp"
 
+#include <algorithm>
+#include <array>
+#include <tuple>
+
 #include <tbb/parallel_for.h>
+#include <tbb/parallel_sort.h>
 
 #include <ccd/linear/broad_phase.hpp>
 #include <ccd/rigid/rigid_body_bvh.hpp>
 #include <ccd/rigid/rigid_body_hash_grid.hpp>
+#include <ccd/sweep_and_prune.hpp>
 #include <logger.hpp>
 #include <profiler.hpp>
+#include <tracer.hpp>
+#include <utils/memory_usage.hpp>
+#include <utils/step_metrics.hpp>
 #include <utils/type_name.hpp>
 
 namespace ipc::rigid {
 
+namespace {
+    /// @brief Per-thread candidates of a previous call, cleared but keeping
+    /// their capacity.
+    TransientPool<ThreadSpecificCandidates>::Handle acquire_local_candidates()
+    {
+        static TransientPool<ThreadSpecificCandidates> pool;
+        TransientPool<ThreadSpecificCandidates>::Handle storages =
+            pool.acquire();
+        for (Candidates& local_candidates : *storages) {
+            local_candidates.clear();
+        }
+        return storages;
+    }
+
+    /// @brief Find the candidates of the body pairs and of the dynamic bodies
+    /// against the merged static world (if any) in one parallel loop.
+    /// @param detect_body_pair Called with the ids of a pair of bodies and
+    /// the candidates to append to.
+    template <typename T, typename DetectBodyPair>
+    void detect_body_pair_and_static_world_candidates(
+        const RigidBodyAssembler& bodies,
+        const std::vector<std::pair<int, int>>& body_pairs,
+        const Poses<T>& poses,
+        const std::vector<MatrixMax3<T>>& rotations,
+        const int collision_types,
+        Candidates& candidates,
+        const double inflation_radius,
+        const DetectBodyPair& detect_body_pair)
+    {
+        // Scripted and sleeping bodies never collide with the static ones
+        std::vector<int> world_body_ids;
+        if (!bodies.m_static_world.empty()) {
+            for (int i = 0; i < bodies.num_bodies(); i++) {
+                if (bodies[i].type == RigidBodyType::DYNAMIC) {
+                    world_body_ids.push_back(i);
+                }
+            }
+        }
+
+        const auto storages = acquire_local_candidates();
+        tbb::parallel_for(
+            tbb::blocked_range<size_t>(
+                size_t(0), body_pairs.size() + world_body_ids.size()),
+            [&](const tbb::blocked_range<size_t>& range) {
+                TRACE_SCOPE("broad_phase::body_pairs");
+                ThreadSpecificCandidates::reference local_storage_candidates =
+                    storages->local();
+                for (size_t i = range.begin(); i != range.end(); ++i) {
+                    if (i < body_pairs.size()) {
+                        detect_body_pair(
+                            body_pairs[i].first, body_pairs[i].second,
+                            local_storage_candidates);
+                    } else {
+                        detect_static_world_collision_candidates_bvh(
+                            bodies, poses, rotations,
+                            world_body_ids[i - body_pairs.size()],
+                            collision_types, local_storage_candidates,
+                            inflation_radius);
+                    }
+                }
+            });
+
+        merge_local_candidates(*storages, candidates);
+    }
+} // namespace
+
 ///////////////////////////////////////////////////////////////////////////////
 // Broad-Phase Discrete Collision Detection
 // NOTE: Yes, this is inside the CCD directory.
@@ -38,6 +113,7 @@ void detect_collision_candidates_rigid(
             bodies.group_ids(), collision_types, candidates);
         break;
     case HASH_GRID:
+    case AUTO:
         detect_collision_candidates_rigid_hash_grid(
             bodies, poses, collision_types, candidates, inflation_radius);
         break;
@@ -45,6 +121,10 @@ void detect_collision_candidates_rigid(
         detect_collision_candidates_rigid_bvh(
             bodies, poses, collision_types, candidates, inflation_radius);
         break;
+    case SWEEP_AND_PRUNE:
+        detect_collision_candidates_rigid_sweep_and_prune(
+            bodies, poses, collision_types, candidates, inflation_radius);
+        break;
     }
 
     PROFILE_END();
@@ -58,6 +138,20 @@ void detect_collision_candidates_rigid_hash_grid(
     const int collision_types,
     Candidates& candidates,
     const double inflation_radius)
+{
+    RigidBodyHashGrid hashgrid;
+    detect_collision_candidates_rigid_hash_grid(
+        bodies, poses, collision_types, candidates, hashgrid,
+        inflation_radius);
+}
+
+void detect_collision_candidates_rigid_hash_grid(
+    const RigidBodyAssembler& bodies,
+    const PosesD& poses,
+    const int collision_types,
+    Candidates& candidates,
+    RigidBodyHashGrid& hashgrid,
+    const double inflation_radius)
 {
     std::vector<std::pair<int, int>> body_pairs =
         bodies.close_bodies(poses, poses, inflation_radius);
@@ -66,9 +160,9 @@ void detect_collision_candidates_rigid_hash_grid(
         return;
     }
 
-    RigidBodyHashGrid hashgrid;
     hashgrid.resize(bodies, poses, body_pairs, inflation_radius);
     hashgrid.addBodies(bodies, poses, body_pairs, inflation_radius);
+    MemoryUsage::set_bytes(MemoryUsage::HASH_GRID, hashgrid.memory_bytes());
 
     const Eigen::VectorXi& group_ids = bodies.group_ids();
     auto can_vertices_collide = [&group_ids](size_t vi, size_t vj) {
@@ -97,27 +191,66 @@ void detect_collision_candidates_rigid_bvh(
     Candidates& candidates,
     const double inflation_radius)
 {
-    std::vector<std::pair<int, int>> body_pairs =
-        bodies.close_bodies(poses, poses, inflation_radius);
+    std::vector<std::pair<int, int>> body_pairs = bodies.close_bodies(
+        poses, poses, inflation_radius, /*include_static_world=*/false);
 
     // Use interval arithmetic to conservativly capture all distance candidates
     auto posesI = cast<Interval>(poses);
+    const auto rotationsI = construct_rotation_matrices(posesI);
+
+    detect_body_pair_and_static_world_candidates(
+        bodies, body_pairs, posesI, rotationsI, collision_types, candidates,
+        inflation_radius,
+        [&](int bodyA_id, int bodyB_id, Candidates& local_candidates) {
+            detect_body_pair_collision_candidates_bvh(
+                bodies, posesI, rotationsI, bodyA_id, bodyB_id,
+                collision_types, local_candidates, inflation_radius);
+        });
+}
 
-    ThreadSpecificCandidates storages;
-    tbb::parallel_for(
-        tbb::blocked_range<size_t>(size_t(0), body_pairs.size()),
-        [&](const tbb::blocked_range<size_t>& range) {
-            ThreadSpecificCandidates::reference local_storage_candidates =
-                storages.local();
-            for (long i = range.begin(); i != range.end(); ++i) {
-                detect_body_pair_collision_candidates_bvh(
-                    bodies, posesI, body_pairs[i].first, body_pairs[i].second,
-                    collision_types, local_storage_candidates,
-                    inflation_radius);
-            }
+// Use a BVH to create a set of all candidate collisions, reusing the cached
+// candidates of body pairs that have barely moved.
+void detect_collision_candidates_rigid_bvh(
+    const RigidBodyAssembler& bodies,
+    const PosesD& poses,
+    const int collision_types,
+    Candidates& candidates,
+    BodyPairCandidateCache& cache,
+    const double inflation_radius)
+{
+    std::vector<std::pair<int, int>> body_pairs = bodies.close_bodies(
+        poses, poses, inflation_radius, /*include_static_world=*/false);
+
+    // Use interval arithmetic to conservativly capture all distance candidates
+    auto posesI = cast<Interval>(poses);
+    const auto rotationsI = construct_rotation_matrices(posesI);
+
+    detect_body_pair_and_static_world_candidates(
+        bodies, body_pairs, posesI, rotationsI, collision_types, candidates,
+        inflation_radius,
+        [&](int bodyA_id, int bodyB_id, Candidates& local_candidates) {
+            cache.detect_body_pair_collision_candidates(
+                bodies, posesI, rotationsI, bodyA_id, bodyB_id,
+                collision_types, local_candidates, inflation_radius);
         });
+}
 
-    merge_local_candidates(storages, candidates);
+// Use an incremental sweep and prune over the world space vertex boxes.
+void detect_collision_candidates_rigid_sweep_and_prune(
+    const RigidBodyAssembler& bodies,
+    const PosesD& poses,
+    const int collision_types,
+    Candidates& candidates,
+    const double inflation_radius)
+{
+    static thread_local std::vector<AABB> vertex_boxes;
+    vertex_aabbs(bodies.world_vertices(poses), vertex_boxes, inflation_radius);
+
+    // The sweep order is kept per thread across calls to exploit coherence.
+    static thread_local SweepAndPrune sap;
+    detect_collision_candidates_sweep_and_prune(
+        vertex_boxes, bodies.m_edges, bodies.m_faces, bodies.group_ids(),
+        collision_types, candidates, sap);
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -147,6 +280,7 @@ void detect_collision_candidates_rigid(
             bodies.group_ids(), collision_types, candidates);
         break;
     case HASH_GRID:
+    case AUTO:
         detect_collision_candidates_rigid_hash_grid(
             bodies, poses_t0, poses_t1, collision_types, candidates,
             inflation_radius);
@@ -156,6 +290,11 @@ void detect_collision_candidates_rigid(
             bodies, poses_t0, poses_t1, collision_types, candidates,
             inflation_radius);
         break;
+    case SWEEP_AND_PRUNE:
+        detect_collision_candidates_rigid_sweep_and_prune(
+            bodies, poses_t0, poses_t1, collision_types, candidates,
+            inflation_radius);
+        break;
     }
 
     PROFILE_END();
@@ -170,6 +309,21 @@ void detect_collision_candidates_rigid_hash_grid(
     const int collision_types,
     Candidates& candidates,
     const double inflation_radius)
+{
+    RigidBodyHashGrid hashgrid;
+    detect_collision_candidates_rigid_hash_grid(
+        bodies, poses_t0, poses_t1, collision_types, candidates, hashgrid,
+        inflation_radius);
+}
+
+void detect_collision_candidates_rigid_hash_grid(
+    const RigidBodyAssembler& bodies,
+    const PosesD& poses_t0,
+    const PosesD& poses_t1,
+    const int collision_types,
+    Candidates& candidates,
+    RigidBodyHashGrid& hashgrid,
+    const double inflation_radius)
 {
     std::vector<std::pair<int, int>> body_pairs =
         bodies.close_bodies(poses_t0, poses_t1, inflation_radius);
@@ -178,10 +332,10 @@ void detect_collision_candidates_rigid_hash_grid(
         return;
     }
 
-    RigidBodyHashGrid hashgrid;
     hashgrid.resize(bodies, poses_t0, poses_t1, body_pairs, inflation_radius);
     hashgrid.addBodies(
         bodies, poses_t0, poses_t1, body_pairs, inflation_radius);
+    MemoryUsage::set_bytes(MemoryUsage::HASH_GRID, hashgrid.memory_bytes());
 
     const Eigen::VectorXi& group_ids = bodies.group_ids();
     auto can_vertices_collide = [&group_ids](size_t vi, size_t vj) {
@@ -211,27 +365,264 @@ void detect_collision_candidates_rigid_bvh(
     Candidates& candidates,
     const double inflation_radius)
 {
-    std::vector<std::pair<int, int>> body_pairs =
-        bodies.close_bodies(poses_t0, poses_t1, inflation_radius);
+    std::vector<std::pair<int, int>> body_pairs = bodies.close_bodies(
+        poses_t0, poses_t1, inflation_radius, /*include_static_world=*/false);
+
+    Poses<Interval> poses = interpolate(
+        cast<Interval>(poses_t0), cast<Interval>(poses_t1), Interval(0, 1));
+    const auto rotations = construct_rotation_matrices(poses);
+
+    detect_body_pair_and_static_world_candidates(
+        bodies, body_pairs, poses, rotations, collision_types, candidates,
+        inflation_radius,
+        [&](int bodyA_id, int bodyB_id, Candidates& local_candidates) {
+            detect_body_pair_collision_candidates_bvh(
+                bodies, poses, rotations, bodyA_id, bodyB_id, collision_types,
+                local_candidates, inflation_radius);
+        });
+}
+
+// Use a BVH to create a set of all candidate collisions, skipping the body
+// pairs whose cached separation exceeds their motion.
+void detect_collision_candidates_rigid_bvh(
+    const RigidBodyAssembler& bodies,
+    const PosesD& poses_t0,
+    const PosesD& poses_t1,
+    const int collision_types,
+    Candidates& candidates,
+    BodyPairSeparationCache& cache,
+    const double inflation_radius)
+{
+    std::vector<std::pair<int, int>> body_pairs = bodies.close_bodies(
+        poses_t0, poses_t1, inflation_radius, /*include_static_world=*/false);
 
     Poses<Interval> poses = interpolate(
         cast<Interval>(poses_t0), cast<Interval>(poses_t1), Interval(0, 1));
+    const auto rotations = construct_rotation_matrices(poses);
+
+    detect_body_pair_and_static_world_candidates(
+        bodies, body_pairs, poses, rotations, collision_types, candidates,
+        inflation_radius,
+        [&](int bodyA_id, int bodyB_id, Candidates& local_candidates) {
+            cache.detect_body_pair_collision_candidates(
+                bodies, poses_t0, poses_t1, poses, rotations, bodyA_id,
+                bodyB_id, collision_types, local_candidates, inflation_radius);
+        });
+}
+
+// Use a BVH to stream the candidates of each body pair to the consumer,
+// traversing the pairs over the sub-interval of the current bound.
+void stream_collision_candidates_rigid_bvh(
+    const RigidBodyAssembler& bodies,
+    const PosesD& poses_t0,
+    const PosesD& poses_t1,
+    const int collision_types,
+    const std::function<double()>& max_toi,
+    const std::function<void(const Candidates&)>& consume,
+    const double inflation_radius)
+{
+    PROFILE_POINT("stream_collision_candidates_rigid_bvh");
+    PROFILE_START();
+
+    std::vector<std::pair<int, int>> body_pairs = bodies.close_bodies(
+        poses_t0, poses_t1, inflation_radius, /*include_static_world=*/false);
+
+    // Scripted and sleeping bodies never collide with the static ones
+    std::vector<int> world_body_ids;
+    if (!bodies.m_static_world.empty()) {
+        for (int i = 0; i < bodies.num_bodies(); i++) {
+            if (bodies[i].type == RigidBodyType::DYNAMIC) {
+                world_body_ids.push_back(i);
+            }
+        }
+    }
+
+    const Poses<Interval> poses_t0_I = cast<Interval>(poses_t0);
+    const Poses<Interval> poses_t1_I = cast<Interval>(poses_t1);
+    const Poses<Interval> poses =
+        interpolate(poses_t0_I, poses_t1_I, Interval(0, 1));
+    const std::vector<MatrixMax3I> rotations =
+        construct_rotation_matrices(poses);
+
+    // Per-thread poses whose pair entries are narrowed to the sub-interval
+    struct LocalStorage {
+        Poses<Interval> poses;
+        std::vector<MatrixMax3I> rotations;
+        Candidates candidates;
+    };
+    tbb::enumerable_thread_specific<LocalStorage> storages(
+        LocalStorage { poses, rotations, Candidates() });
 
-    ThreadSpecificCandidates storages;
     tbb::parallel_for(
-        tbb::blocked_range<size_t>(size_t(0), body_pairs.size()),
+        tbb::blocked_range<size_t>(
+            size_t(0), body_pairs.size() + world_body_ids.size(), 1),
         [&](const tbb::blocked_range<size_t>& range) {
-            ThreadSpecificCandidates::reference local_storage_candidates =
-                storages.local();
-            for (long i = range.begin(); i != range.end(); ++i) {
-                detect_body_pair_collision_candidates_bvh(
-                    bodies, poses, body_pairs[i].first, body_pairs[i].second,
-                    collision_types, local_storage_candidates,
-                    inflation_radius);
+            TRACE_SCOPE("broad_phase::stream_body_pairs");
+            LocalStorage& local = storages.local();
+            for (size_t i = range.begin(); i != range.end(); ++i) {
+                const double t = std::min(max_toi(), 1.0);
+                if (t <= 0) {
+                    return;
+                }
+
+                const bool is_body_pair = i < body_pairs.size();
+                const std::array<int, 2> ids = is_body_pair
+                    ? std::array<int, 2> { { body_pairs[i].first,
+                                             body_pairs[i].second } }
+                    : std::array<int, 2> {
+                          { world_body_ids[i - body_pairs.size()], -1 }
+                      };
+                const bool is_narrowed = t < 1;
+                for (int id : ids) {
+                    if (id >= 0 && is_narrowed) {
+                        local.poses[id] = Pose<Interval>::interpolate(
+                            poses_t0_I[id], poses_t1_I[id], Interval(0, t));
+                        local.rotations[id] =
+                            local.poses[id].construct_rotation_matrix();
+                    }
+                }
+                const Poses<Interval>& pair_poses =
+                    is_narrowed ? local.poses : poses;
+                const std::vector<MatrixMax3I>& pair_rotations =
+                    is_narrowed ? local.rotations : rotations;
+
+                local.candidates.clear();
+                if (is_body_pair) {
+                    detect_body_pair_collision_candidates_bvh(
+                        bodies, pair_poses, pair_rotations, ids[0], ids[1],
+                        collision_types, local.candidates, inflation_radius);
+                } else {
+                    detect_static_world_collision_candidates_bvh(
+                        bodies, pair_poses, pair_rotations, ids[0],
+                        collision_types, local.candidates, inflation_radius);
+                }
+                if (local.candidates.size()) {
+                    consume(local.candidates);
+                }
             }
-        });
+        },
+        tbb::simple_partitioner());
+
+    PROFILE_END();
+}
+
+// Use an incremental sweep and prune over the world space boxes of the
+// vertices' rigid trajectories.
+void detect_collision_candidates_rigid_sweep_and_prune(
+    const RigidBodyAssembler& bodies,
+    const PosesD& poses_t0,
+    const PosesD& poses_t1,
+    const int collision_types,
+    Candidates& candidates,
+    const double inflation_radius)
+{
+    // Use interval arithmetic to conservativly bound the trajectories
+    Poses<Interval> poses = interpolate(
+        cast<Interval>(poses_t0), cast<Interval>(poses_t1), Interval(0, 1));
 
-    merge_local_candidates(storages, candidates);
+    static thread_local std::vector<AABB> vertex_boxes;
+    vertex_aabbs(bodies.world_vertices(poses), vertex_boxes, inflation_radius);
+
+    // The sweep order is kept per thread across calls to exploit coherence.
+    static thread_local SweepAndPrune sap;
+    detect_collision_candidates_sweep_and_prune(
+        vertex_boxes, bodies.m_edges, bodies.m_faces, bodies.group_ids(),
+        collision_types, candidates, sap);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Distance Field Culling
+///////////////////////////////////////////////////////////////////////////////
+
+void remove_distance_field_separated_candidates(
+    const RigidBodyAssembler& bodies,
+    const PosesD& poses_t0,
+    const PosesD& poses_t1,
+    Candidates& candidates,
+    const double inflation_radius)
+{
+    bool has_distance_fields = false;
+    for (const RigidBody& body : bodies.m_rbs) {
+        has_distance_fields |= body.distance_field != nullptr;
+    }
+    if (!has_distance_fields) {
+        return;
+    }
+
+    std::vector<MatrixMax3d> rotations(bodies.num_bodies());
+    std::vector<double> displacements(bodies.num_bodies());
+    for (size_t i = 0; i < bodies.num_bodies(); i++) {
+        rotations[i] = poses_t0[i].construct_rotation_matrix();
+        displacements[i] = max_trajectory_displacement(
+            poses_t0[i], poses_t1[i], bodies[i].r_max);
+    }
+
+    // Bound the primitive by a sphere in the field's body space at t0 and
+    // grow the bound by how far either body can move.
+    const auto is_separated = [&](const std::array<long, 3>& vertex_ids,
+                                  int num_vertices, long field_body_id) {
+        const RigidBody& field_body = bodies[field_body_id];
+        if (field_body.distance_field == nullptr) {
+            return false;
+        }
+        const long body_id = bodies.vertex_id_to_body_id(vertex_ids[0]);
+        const PoseD& pose = poses_t0[field_body_id];
+        std::array<VectorMax3d, 3> points;
+        VectorMax3d center = VectorMax3d::Zero(bodies.dim());
+        for (int i = 0; i < num_vertices; i++) {
+            points[i] = rotations[field_body_id].transpose()
+                * (bodies.world_vertex(poses_t0, vertex_ids[i])
+                   - pose.position);
+            center += points[i] / num_vertices;
+        }
+        double radius = 0;
+        for (int i = 0; i < num_vertices; i++) {
+            radius = std::max(radius, (points[i] - center).norm());
+        }
+        return field_body.distance_field->distance_lower_bound(center) - radius
+            - displacements[body_id] - displacements[field_body_id]
+            > 2 * inflation_radius;
+    };
+    const auto edge_vertex_ids = [&](long ei) -> std::array<long, 3> {
+        return { { bodies.m_edges(ei, 0), bodies.m_edges(ei, 1), -1 } };
+    };
+    const auto face_vertex_ids = [&](long fi) -> std::array<long, 3> {
+        return { { bodies.m_faces(fi, 0), bodies.m_faces(fi, 1),
+                   bodies.m_faces(fi, 2) } };
+    };
+    const auto vertex_ids = [&](long vi) -> std::array<long, 3> {
+        return { { vi, -1, -1 } };
+    };
+
+    const auto remove_separated = [&](auto& pairs, const auto& predicate) {
+        const size_t num_pairs = pairs.size();
+        pairs.erase(
+            std::remove_if(pairs.begin(), pairs.end(), predicate),
+            pairs.end());
+        StepMetrics::add_count(
+            StepMetrics::DISTANCE_FIELD_REJECTIONS, num_pairs - pairs.size());
+    };
+    remove_separated(
+        candidates.ev_candidates, [&](const EdgeVertexCandidate& c) {
+            const auto e = edge_vertex_ids(c.edge_index);
+            const auto v = vertex_ids(c.vertex_index);
+            return is_separated(e, 2, bodies.vertex_id_to_body_id(v[0]))
+                || is_separated(v, 1, bodies.vertex_id_to_body_id(e[0]));
+        });
+    remove_separated(
+        candidates.ee_candidates, [&](const EdgeEdgeCandidate& c) {
+            const auto e0 = edge_vertex_ids(c.edge0_index);
+            const auto e1 = edge_vertex_ids(c.edge1_index);
+            return is_separated(e0, 2, bodies.vertex_id_to_body_id(e1[0]))
+                || is_separated(e1, 2, bodies.vertex_id_to_body_id(e0[0]));
+        });
+    remove_separated(
+        candidates.fv_candidates, [&](const FaceVertexCandidate& c) {
+            const auto f = face_vertex_ids(c.face_index);
+            const auto v = vertex_ids(c.vertex_index);
+            return is_separated(f, 3, bodies.vertex_id_to_body_id(v[0]))
+                || is_separated(v, 1, bodies.vertex_id_to_body_id(f[0]));
+        });
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -241,6 +632,20 @@ void detect_collision_candidates_rigid_bvh(
 typedef tbb::enumerable_thread_specific<std::vector<EdgeFaceCandidate>>
     ThreadSpecificEFCandidates;
 
+namespace {
+    TransientPool<ThreadSpecificEFCandidates>::Handle
+    acquire_local_ef_candidates()
+    {
+        static TransientPool<ThreadSpecificEFCandidates> pool;
+        TransientPool<ThreadSpecificEFCandidates>::Handle storages =
+            pool.acquire();
+        for (std::vector<EdgeFaceCandidate>& local_candidates : *storages) {
+            local_candidates.clear();
+        }
+        return storages;
+    }
+} // namespace
+
 void merge_local_candidates(
     const ThreadSpecificEFCandidates& storages,
     std::vector<EdgeFaceCandidate>& ef_candidates)
@@ -272,20 +677,22 @@ void detect_intersection_candidates_rigid_bvh(
         bodies.close_bodies(poses, poses, /*inflation_radius=*/0);
 
     auto posesI = cast<Interval>(poses);
+    const auto rotations = construct_rotation_matrices(poses);
 
-    ThreadSpecificEFCandidates storages;
+    const auto storages = acquire_local_ef_candidates();
     tbb::parallel_for(
         tbb::blocked_range<size_t>(size_t(0), body_pairs.size()),
         [&](const tbb::blocked_range<size_t>& range) {
+            TRACE_SCOPE("broad_phase::body_pairs");
             ThreadSpecificEFCandidates::reference local_storage_candidates =
-                storages.local();
+                storages->local();
             for (long i = range.begin(); i != range.end(); ++i) {
                 int bodyA_id = body_pairs[i].first;
                 int bodyB_id = body_pairs[i].second;
                 sort_body_pair(bodies, bodyA_id, bodyB_id);
 
-                const auto RA = poses[bodyA_id].construct_rotation_matrix();
-                const auto RB = poses[bodyB_id].construct_rotation_matrix();
+                const MatrixMax3d& RA = rotations[bodyA_id];
+                const MatrixMax3d& RB = rotations[bodyB_id];
                 const auto& pA = poses[bodyA_id].position;
                 const auto& pB = poses[bodyB_id].position;
                 const MatrixXI VA =
@@ -293,7 +700,8 @@ void detect_intersection_candidates_rigid_bvh(
                      + (pA - pB).transpose())
                     * RB;
 
-                std::vector<AABB> aabbs = vertex_aabbs(VA);
+                static thread_local std::vector<BroadPhaseAABB> aabbs;
+                vertex_aabbs(VA, aabbs);
 
                 detect_body_pair_intersection_candidates_from_aabbs(
                     bodies, aabbs, bodyA_id, bodyB_id,
@@ -301,7 +709,7 @@ void detect_intersection_candidates_rigid_bvh(
             }
         });
 
-    merge_local_candidates(storages, ef_candidates);
+    merge_local_candidates(*storages, ef_candidates);
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -341,4 +749,34 @@ void merge_local_candidates(
     PROFILE_END();
 }
 
+void sort_candidates(Candidates& candidates)
+{
+    tbb::parallel_sort(
+        candidates.ev_candidates.begin(), candidates.ev_candidates.end(),
+        [](const EdgeVertexCandidate& a, const EdgeVertexCandidate& b) {
+            return std::tie(a.edge_index, a.vertex_index)
+                < std::tie(b.edge_index, b.vertex_index);
+        });
+    tbb::parallel_sort(
+        candidates.ee_candidates.begin(), candidates.ee_candidates.end(),
+        [](const EdgeEdgeCandidate& a, const EdgeEdgeCandidate& b) {
+            return std::tie(a.edge0_index, a.edge1_index)
+                < std::tie(b.edge0_index, b.edge1_index);
+        });
+    tbb::parallel_sort(
+        candidates.fv_candidates.begin(), candidates.fv_candidates.end(),
+        [](const FaceVertexCandidate& a, const FaceVertexCandidate& b) {
+            return std::tie(a.face_index, a.vertex_index)
+                < std::tie(b.face_index, b.vertex_index);
+        });
+}
+
+TransientPool<Candidates>::Handle acquire_candidates()
+{
+    static TransientPool<Candidates> pool;
+    TransientPool<Candidates>::Handle candidates = pool.acquire();
+    candidates->clear();
+    return candidates;
+}
+
 } // namespace ipc::rigid
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <functional>
+
 #include <tbb/enumerable_thread_specific.h>
 
 #include <Eigen/Core>
@@ -9,8 +11,12 @@
 
 #include <ccd/ccd.hpp>
 #include <ccd/impact.hpp>
+#include <ccd/rigid/body_pair_candidate_cache.hpp>
+#include <ccd/rigid/body_pair_separation_cache.hpp>
+#include <ccd/rigid/rigid_body_hash_grid.hpp>
 #include <interval/interval.hpp>
 #include <physics/rigid_body_assembler.hpp>
+#include <utils/transient_pool.hpp>
 
 namespace ipc::rigid {
 
@@ -36,6 +42,16 @@ void detect_collision_candidates_rigid_hash_grid(
     Candidates& candidates,
     const double inflation_radius = 0.0);
 
+/// @brief Use a hash grid method to create a set of all candidate collisions,
+/// reusing the storage and dimensions of a grid from a previous call.
+void detect_collision_candidates_rigid_hash_grid(
+    const RigidBodyAssembler& bodies,
+    const PosesD& poses,
+    const int collision_types,
+    Candidates& candidates,
+    RigidBodyHashGrid& hashgrid,
+    const double inflation_radius = 0.0);
+
 /// @brief Use a BVH to create a set of all candidate collisions.
 void detect_collision_candidates_rigid_bvh(
     const RigidBodyAssembler& bodies,
@@ -44,6 +60,25 @@ void detect_collision_candidates_rigid_bvh(
     Candidates& candidates,
     const double inflation_radius = 0.0);
 
+/// @brief Use a BVH to create a set of all candidate collisions, reusing the
+/// cached candidates of body pairs that have barely moved.
+void detect_collision_candidates_rigid_bvh(
+    const RigidBodyAssembler& bodies,
+    const PosesD& poses,
+    const int collision_types,
+    Candidates& candidates,
+    BodyPairCandidateCache& cache,
+    const double inflation_radius = 0.0);
+
+/// @brief Use an incremental sweep and prune to create a set of all candidate
+/// collisions.
+void detect_collision_candidates_rigid_sweep_and_prune(
+    const RigidBodyAssembler& bodies,
+    const PosesD& poses,
+    const int collision_types,
+    Candidates& candidates,
+    const double inflation_radius = 0.0);
+
 ///////////////////////////////////////////////////////////////////////////////
 // Broad-Phase Continous Collision Detection
 ///////////////////////////////////////////////////////////////////////////////
@@ -67,6 +102,17 @@ void detect_collision_candidates_rigid_hash_grid(
     Candidates& candidates,
     const double inflation_radius = 0.0);
 
+/// @brief Use a hash grid method to create a set of all candidate collisions,
+/// reusing the storage and dimensions of a grid from a previous call.
+void detect_collision_candidates_rigid_hash_grid(
+    const RigidBodyAssembler& bodies,
+    const PosesD& poses_t0,
+    const PosesD& poses_t1,
+    const int collision_types,
+    Candidates& candidates,
+    RigidBodyHashGrid& hashgrid,
+    const double inflation_radius = 0.0);
+
 /// @brief Use a BVH to create a set of all candidate collisions.
 void detect_collision_candidates_rigid_bvh(
     const RigidBodyAssembler& bodies,
@@ -76,6 +122,48 @@ void detect_collision_candidates_rigid_bvh(
     Candidates& candidates,
     const double inflation_radius = 0.0);
 
+/// @brief Use a BVH to create a set of all candidate collisions, skipping the
+/// body pairs whose cached separation exceeds their motion.
+void detect_collision_candidates_rigid_bvh(
+    const RigidBodyAssembler& bodies,
+    const PosesD& poses_t0,
+    const PosesD& poses_t1,
+    const int collision_types,
+    Candidates& candidates,
+    BodyPairSeparationCache& cache,
+    const double inflation_radius = 0.0);
+
+/// @brief Use a BVH to stream the candidate collisions to a consumer one body
+/// pair at a time instead of collecting them all.
+///
+/// Each pair's candidates are passed to the consumer as soon as the pair is
+/// traversed, so the consumer runs while other pairs are still traversed.
+/// The pairs are traversed only up to the current time-of-impact bound.
+///
+/// @param max_toi  Called before each body pair for the time of impact
+///                 beyond which no candidates are needed. Nothing more is
+///                 traversed once it is zero.
+/// @param consume  Called concurrently with the (nonempty) candidates of a
+///                 body pair, whose storage is reused after it returns.
+void stream_collision_candidates_rigid_bvh(
+    const RigidBodyAssembler& bodies,
+    const PosesD& poses_t0,
+    const PosesD& poses_t1,
+    const int collision_types,
+    const std::function<double()>& max_toi,
+    const std::function<void(const Candidates&)>& consume,
+    const double inflation_radius = 0.0);
+
+/// @brief Use an incremental sweep and prune over the vertices' swept boxes
+/// to create a set of all candidate collisions.
+void detect_collision_candidates_rigid_sweep_and_prune(
+    const RigidBodyAssembler& bodies,
+    const PosesD& poses_t0,
+    const PosesD& poses_t1,
+    const int collision_types,
+    Candidates& candidates,
+    const double inflation_radius = 0.0);
+
 ///////////////////////////////////////////////////////////////////////////////
 // Broad-Phase Intersection Detection
 ///////////////////////////////////////////////////////////////////////////////
@@ -86,6 +174,20 @@ void detect_intersection_candidates_rigid_bvh(
     const PosesD& poses,
     std::vector<EdgeFaceCandidate>& ef_candidates);
 
+///////////////////////////////////////////////////////////////////////////////
+// Distance Field Culling
+///////////////////////////////////////////////////////////////////////////////
+
+/// @brief Remove the candidates with a primitive certified by the distance
+/// field of the other primitive's body to stay farther than twice the
+/// inflation radius from that body over the trajectory.
+void remove_distance_field_separated_candidates(
+    const RigidBodyAssembler& bodies,
+    const PosesD& poses_t0,
+    const PosesD& poses_t1,
+    Candidates& candidates,
+    const double inflation_radius = 0.0);
+
 ///////////////////////////////////////////////////////////////////////////////
 // Helper functions
 ///////////////////////////////////////////////////////////////////////////////
@@ -93,7 +195,14 @@ void detect_intersection_candidates_rigid_bvh(
 typedef tbb::enumerable_thread_specific<Candidates>
     ThreadSpecificCandidates;
 
+/// @brief Concatenate the thread-local candidates.
 void merge_local_candidates(
     const ThreadSpecificCandidates& storages, Candidates& candidates);
 
+/// @brief Sort each type of candidates by their primitive ids.
+void sort_candidates(Candidates& candidates);
+
+/// @brief Empty candidates keeping the capacity of a previous call.
+TransientPool<Candidates>::Handle acquire_candidates();
+
 } // namespace ipc::rigid
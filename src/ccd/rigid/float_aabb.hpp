@@ -0,0 +1,85 @@
+#pragma once
+
+#include <cassert>
+#include <cmath>
+
+#include <Eigen/Core>
+
+#include <ipc/broad_phase/hash_grid.hpp>
+
+namespace ipc::rigid {
+
+/// @brief Single-precision axis-aligned bounding box.
+///
+/// The bounds are rounded outward (min down, max up) to the nearest floats,
+/// so the box contains the double-precision one and overlap tests stay
+/// conservative. Unused coordinates of 2D boxes are zero and always overlap.
+class FloatAABB {
+public:
+    FloatAABB() = default;
+
+    FloatAABB(const ArrayMax3d& min, const ArrayMax3d& max)
+        : m_min(Eigen::Array3f::Zero())
+        , m_max(Eigen::Array3f::Zero())
+        , m_dim(min.size())
+    {
+        assert(min.size() == max.size() && min.size() <= 3);
+        for (int i = 0; i < m_dim; i++) {
+            m_min(i) = round_down(min(i));
+            m_max(i) = round_up(max(i));
+        }
+    }
+
+    FloatAABB(const AABB& aabb) : FloatAABB(aabb.getMin(), aabb.getMax()) { }
+
+    /// @brief Smallest box containing both boxes.
+    FloatAABB(const FloatAABB& a, const FloatAABB& b)
+        : m_min(a.m_min.min(b.m_min))
+        , m_max(a.m_max.max(b.m_max))
+        , m_dim(a.m_dim)
+    {
+        assert(a.m_dim == b.m_dim);
+    }
+
+    /// @brief Smallest box containing the three boxes.
+    FloatAABB(const FloatAABB& a, const FloatAABB& b, const FloatAABB& c)
+        : FloatAABB(FloatAABB(a, b), c)
+    {
+    }
+
+    static bool are_overlapping(const FloatAABB& a, const FloatAABB& b)
+    {
+        return (a.m_min <= b.m_max).all() && (b.m_min <= a.m_max).all();
+    }
+
+    ArrayMax3d getMin() const { return m_min.head(m_dim).cast<double>(); }
+    ArrayMax3d getMax() const { return m_max.head(m_dim).cast<double>(); }
+
+protected:
+    /// @brief Largest float not greater than x.
+    static float round_down(double x)
+    {
+        const float f = float(x);
+        return double(f) > x ? std::nextafter(f, -INFINITY) : f;
+    }
+
+    /// @brief Smallest float not less than x.
+    static float round_up(double x)
+    {
+        const float f = float(x);
+        return double(f) < x ? std::nextafter(f, INFINITY) : f;
+    }
+
+    Eigen::Array3f m_min;
+    Eigen::Array3f m_max;
+    int m_dim = 0;
+};
+
+/// @brief Box of the per-body-pair overlap tests of the rigid broad phase.
+#ifdef RIGID_IPC_WITH_FLOAT_BROAD_PHASE
+typedef FloatAABB BroadPhaseAABB;
+#else
+typedef AABB BroadPhaseAABB;
+#endif
+
+} // namespace ipc::rigid
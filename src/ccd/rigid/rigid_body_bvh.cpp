@@ -1,12 +1,117 @@
 #include "rigid_body_bvh.hpp"
 
+#include <geometry/primitive_bvh.hpp>
+
 namespace ipc::rigid {
 
-void detect_body_pair_collision_candidates_from_aabbs(
+namespace {
+    /// @brief Visit the primitives of body A and body B (as ids of body B's
+    /// BVH: codim vertices, codim edges, then faces) with overlapping boxes
+    /// by traversing both hierarchies together, with body A's refit in body
+    /// B's frame.
+    template <typename VisitVertex, typename VisitEdge, typename VisitFace>
+    void traverse_body_pair(
+        const RigidBody& bodyA,
+        const std::vector<BroadPhaseAABB>& bodyA_vertex_aabbs,
+        const RigidBodyGeometry& geometryB,
+        const VisitVertex& visit_codim_vertex,
+        const VisitEdge& visit_codim_edge,
+        const VisitFace& visit_face)
+    {
+        const Eigen::MatrixXi &EA = bodyA.edges, &FA = bodyA.faces;
+        const auto& selectorA = bodyA.mesh_selector();
+        const long num_codim_vertices = bodyA.num_codim_vertices();
+        const long num_codim_edges = bodyA.num_codim_edges();
+
+        static thread_local std::vector<BroadPhaseAABB> bodyA_node_aabbs;
+        bodyA.primitive_bvh().refit(
+            [&](long id) -> BroadPhaseAABB {
+                if (id < num_codim_vertices) {
+                    return bodyA_vertex_aabbs
+                        [selectorA.codim_vertices_to_vertices(id)];
+                }
+                id -= num_codim_vertices;
+                if (id < num_codim_edges) {
+                    const long ei = selectorA.codim_edges_to_edges(id);
+                    return BroadPhaseAABB(
+                        bodyA_vertex_aabbs[EA(ei, 0)],
+                        bodyA_vertex_aabbs[EA(ei, 1)]);
+                }
+                const long fi = id - num_codim_edges;
+                return BroadPhaseAABB(
+                    bodyA_vertex_aabbs[FA(fi, 0)],
+                    bodyA_vertex_aabbs[FA(fi, 1)],
+                    bodyA_vertex_aabbs[FA(fi, 2)]);
+            },
+            bodyA_node_aabbs);
+
+        PrimitiveBVH::traverse(
+            bodyA.primitive_bvh(), bodyA_node_aabbs, geometryB.primitive_bvh,
+            geometryB.bvh_node_aabbs, [&](long ida, size_t id) {
+                if (ida < num_codim_vertices) {
+                    visit_codim_vertex(
+                        selectorA.codim_vertices_to_vertices(ida), id);
+                    return;
+                }
+                ida -= num_codim_vertices;
+                if (ida < num_codim_edges) {
+                    visit_codim_edge(selectorA.codim_edges_to_edges(ida), id);
+                } else {
+                    visit_face(ida - num_codim_edges, id);
+                }
+            });
+    }
+
+    /// @brief Global ids of the primitives of body B in a body pair.
+    struct BodyPrimitiveIds {
+        const RigidBodyAssembler& bodies;
+        const int body_id;
+
+        long vertex(size_t i) const
+        {
+            return bodies.m_body_vertex_id[body_id] + i;
+        }
+        long edge(size_t i) const { return bodies.m_body_edge_id[body_id] + i; }
+        long face(size_t i) const { return bodies.m_body_face_id[body_id] + i; }
+    };
+
+    /// @brief Global ids of the primitives of the static world, or -1 for the
+    /// ones of bodies that cannot collide with body A.
+    struct StaticWorldPrimitiveIds {
+        const RigidBodyAssembler& bodies;
+        const int bodyA_id;
+
+        long vertex(size_t i) const
+        {
+            const long vi = bodies.m_static_world.vertex_ids[i];
+            return can_collide(bodies.vertex_id_to_body_id(vi)) ? vi : -1;
+        }
+        long edge(size_t i) const
+        {
+            const long ei = bodies.m_static_world.edge_ids[i];
+            return can_collide(bodies.edge_id_to_body_id(ei)) ? ei : -1;
+        }
+        long face(size_t i) const
+        {
+            const long fi = bodies.m_static_world.face_ids[i];
+            return can_collide(bodies.face_id_to_body_id(fi)) ? fi : -1;
+        }
+        bool can_collide(long body_id) const
+        {
+            return bodies.can_bodies_collide(bodyA_id, body_id);
+        }
+    };
+} // namespace
+
+/// @brief Find the candidates between body A and a body B given by its
+/// geometry and the global ids of its primitives (negative ids are skipped).
+template <typename PrimitiveIdsB>
+void detect_collision_candidates_from_aabbs(
     const RigidBodyAssembler& bodies,
-    const std::vector<AABB>& bodyA_vertex_aabbs,
+    const std::vector<BroadPhaseAABB>& bodyA_inflated_vertex_aabbs,
     const int bodyA_id,
-    const int bodyB_id,
+    const RigidBodyGeometry& geometryB,
+    const PrimitiveIdsB& idsB,
     const int collision_types,
     Candidates& candidates,
     const double inflation_radius)
@@ -15,306 +120,304 @@ void detect_body_pair_collision_candidates_from_aabbs(
     bool build_ee = collision_types & CollisionType::EDGE_EDGE;
     bool build_fv = collision_types & CollisionType::FACE_VERTEX;
     auto add_ev = [&](size_t eai, size_t vbi) {
-        if (build_ev) {
+        const long vb = idsB.vertex(vbi);
+        if (build_ev && vb >= 0) {
             candidates.ev_candidates.emplace_back(
-                bodies.m_body_edge_id[bodyA_id] + eai,
-                bodies.m_body_vertex_id[bodyB_id] + vbi);
+                bodies.m_body_edge_id[bodyA_id] + eai, vb);
         }
     };
     auto add_ve = [&](size_t vai, size_t ebi) {
-        if (build_ev) {
+        const long eb = idsB.edge(ebi);
+        if (build_ev && eb >= 0) {
             candidates.ev_candidates.emplace_back(
-                bodies.m_body_edge_id[bodyB_id] + ebi,
-                bodies.m_body_vertex_id[bodyA_id] + vai);
+                eb, bodies.m_body_vertex_id[bodyA_id] + vai);
         }
     };
     auto add_ee = [&](size_t eai, size_t ebi) {
-        if (build_ee) {
+        const long eb = idsB.edge(ebi);
+        if (build_ee && eb >= 0) {
             candidates.ee_candidates.emplace_back(
-                bodies.m_body_edge_id[bodyA_id] + eai,
-                bodies.m_body_edge_id[bodyB_id] + ebi);
+                bodies.m_body_edge_id[bodyA_id] + eai, eb);
         }
     };
     auto add_fv = [&](size_t fai, size_t vbi) {
-        if (build_fv) {
+        const long vb = idsB.vertex(vbi);
+        if (build_fv && vb >= 0) {
             candidates.fv_candidates.emplace_back(
-                bodies.m_body_face_id[bodyA_id] + fai,
-                bodies.m_body_vertex_id[bodyB_id] + vbi);
+                bodies.m_body_face_id[bodyA_id] + fai, vb);
         }
     };
     auto add_vf = [&](size_t vai, size_t fbi) {
-        if (build_fv) {
+        const long fb = idsB.face(fbi);
+        if (build_fv && fb >= 0) {
             candidates.fv_candidates.emplace_back(
-                bodies.m_body_face_id[bodyB_id] + fbi,
-                bodies.m_body_vertex_id[bodyA_id] + vai);
+                fb, bodies.m_body_vertex_id[bodyA_id] + vai);
         }
     };
 
     const RigidBody& bodyA = bodies[bodyA_id];
-    const RigidBody& bodyB = bodies[bodyB_id];
 
-    const std::vector<AABB> bodyB_vertex_aabbs =
-        vertex_aabbs(bodyB.vertices, inflation_radius);
-    const Eigen::MatrixXi &EA = bodyA.edges, &EB = bodyB.edges,
-                          &FA = bodyA.faces, &FB = bodyB.faces;
-
-    const auto& selectorA = bodyA.mesh_selector;
-    const auto& selectorB = bodyB.mesh_selector;
+    // Body B's boxes are constant in its local frame, so they are cached
+    // uninflated and body A's boxes are grown a second time instead.
+    static thread_local std::vector<BroadPhaseAABB> bodyA_grown_aabbs;
+    const std::vector<BroadPhaseAABB>& bodyA_vertex_aabbs = inflate_aabbs(
+        bodyA_inflated_vertex_aabbs, inflation_radius, bodyA_grown_aabbs);
+    const std::vector<BroadPhaseAABB>& bodyB_vertex_aabbs =
+        geometryB.vertex_aabbs;
+    const Eigen::MatrixXi &EA = bodyA.edges, &EB = geometryB.edges,
+                          &FA = bodyA.faces, &FB = geometryB.faces;
+
+    const auto& selectorA = bodyA.mesh_selector();
+    const auto& selectorB = geometryB.mesh_selector;
+    const size_t num_codim_verticesB = selectorB.num_codim_vertices();
+    const size_t num_codim_edgesB = selectorB.num_codim_edges();
 
     auto bodyA_edge_aabb = [&](size_t ei) {
-        return AABB(
+        return BroadPhaseAABB(
             bodyA_vertex_aabbs[EA(ei, 0)], bodyA_vertex_aabbs[EA(ei, 1)]);
     };
-    auto bodyB_edge_aabb = [&](size_t ei) {
-        return AABB(
-            bodyB_vertex_aabbs[EB(ei, 0)], bodyB_vertex_aabbs[EB(ei, 1)]);
-    };
+    auto bodyB_edge_aabb = [&](size_t ei) { return geometryB.edge_aabbs[ei]; };
     auto bodyA_face_aabb = [&](size_t fi) {
-        return AABB(
+        return BroadPhaseAABB(
             bodyA_vertex_aabbs[FA(fi, 0)], bodyA_vertex_aabbs[FA(fi, 1)],
             bodyA_vertex_aabbs[FA(fi, 2)]);
     };
-    auto bodyB_face_aabb = [&](size_t fi) {
-        return AABB(
-            bodyB_vertex_aabbs[FB(fi, 0)], bodyB_vertex_aabbs[FB(fi, 1)],
-            bodyB_vertex_aabbs[FB(fi, 2)]);
-    };
+    auto bodyB_face_aabb = [&](size_t fi) { return geometryB.face_aabbs[fi]; };
 
-    ///////////////////////////////////////////////////////////////////////////
-    // query (f, *)
-    for (size_t fa_id = 0; fa_id < FA.rows(); fa_id++) {
+    // Pairs of a primitive of body A and one of body B (as an id of body B's
+    // BVH: codim vertices, codim edges, then faces) with overlapping boxes
+    auto visit_face = [&](size_t fa_id, size_t id) {
         // all (f_e, *v) and (f_v, *e) are not needed because faces are only 3D
         assert(!build_ev);
 
         // Construct a bbox of bodyA's face
-        AABB fa_aabb = bodyA_face_aabb(fa_id);
+        BroadPhaseAABB fa_aabb = bodyA_face_aabb(fa_id);
 
-        std::vector<unsigned int> ids;
-        bodyB.bvh.intersect_box(
-            // Grow the box by inflation_radius because the BVH is not grown
-            fa_aabb.getMin().array() - inflation_radius,
-            fa_aabb.getMax().array() + inflation_radius, //
-            ids);
+        if (id < num_codim_verticesB) {
 
-        for (const auto& id : ids) {
-            if (id < bodyB.num_codim_vertices()) {
+            // (f, cv) - no need to do a BroadPhaseAABB check
+            add_fv(fa_id, selectorB.codim_vertices_to_vertices(id));
+            // ignore (f_e, cv) and (f_v, cv)
 
-                // (f, cv) - no need to do a AABB check
-                add_fv(fa_id, selectorB.codim_vertices_to_vertices(id));
-                // ignore (f_e, cv) and (f_v, cv)
+        } else if (id < num_codim_verticesB + num_codim_edgesB) {
+            size_t eb_id = selectorB.codim_edges_to_edges(
+                id - num_codim_verticesB);
 
-            } else if (
-                id < bodyB.num_codim_vertices() + bodyB.num_codim_edges()) {
-
-                size_t eb_id = selectorB.codim_edges_to_edges(
-                    id - bodyB.num_codim_vertices());
-
-                // (f, ce_v)
-                for (int vi = 0; vi < EB.cols(); vi++) {
-                    size_t vb_id = EB(eb_id, vi);
-                    if (selectorB.vertex_to_edge(vb_id) == eb_id
-                        && AABB::are_overlapping(
-                               fa_aabb, bodyB_vertex_aabbs[vb_id])) {
-                        add_fv(fa_id, vb_id);
-                    }
+            // (f, ce_v)
+            for (int vi = 0; vi < EB.cols(); vi++) {
+                size_t vb_id = EB(eb_id, vi);
+                if (selectorB.vertex_to_edge(vb_id) == eb_id
+                    && BroadPhaseAABB::are_overlapping(
+                           fa_aabb, bodyB_vertex_aabbs[vb_id])) {
+                    add_fv(fa_id, vb_id);
                 }
+            }
 
-                // (f_e, ce)
-                AABB eb_aabb = bodyB_edge_aabb(eb_id);
-                for (int ei = 0; ei < FA.cols(); ei++) {
-                    size_t ea_id = selectorA.face_to_edge(fa_id, ei);
-                    if (selectorA.edge_to_face(ea_id) == fa_id) {
-                        AABB ea_aabb = bodyA_edge_aabb(ea_id);
-                        if (AABB::are_overlapping(ea_aabb, eb_aabb)) {
-                            add_ee(ea_id, eb_id);
-                        }
+            // (f_e, ce)
+            BroadPhaseAABB eb_aabb = bodyB_edge_aabb(eb_id);
+            for (int ei = 0; ei < FA.cols(); ei++) {
+                size_t ea_id = selectorA.face_to_edge(fa_id, ei);
+                if (selectorA.edge_to_face(ea_id) == fa_id) {
+                    BroadPhaseAABB ea_aabb = bodyA_edge_aabb(ea_id);
+                    if (BroadPhaseAABB::are_overlapping(ea_aabb, eb_aabb)) {
+                        add_ee(ea_id, eb_id);
                     }
                 }
+            }
 
-                // ignore (f, ce), (f_v, ce), (f_v, ce_v), and (f_e, ce_v)
+            // ignore (f, ce), (f_v, ce), (f_v, ce_v), and (f_e, ce_v)
 
-            } else {
+        } else {
 
-                size_t fb_id =
-                    id - bodyB.num_codim_vertices() - bodyB.num_codim_edges();
+            size_t fb_id =
+                id - num_codim_verticesB - num_codim_edgesB;
 
-                AABB fb_aabb = bodyB_face_aabb(fb_id);
-                for (int f_vi = 0; f_vi < FA.cols(); f_vi++) {
-                    // (f_v, f)
-                    long va_id = FA(fa_id, f_vi);
-                    if (selectorA.vertex_to_face(va_id) == fa_id) {
-                        if (AABB::are_overlapping(
-                                bodyA_vertex_aabbs[va_id], fb_aabb)) {
-                            // Convert the local ids to the global ones
-                            add_vf(va_id, fb_id);
-                        }
+            BroadPhaseAABB fb_aabb = bodyB_face_aabb(fb_id);
+            for (int f_vi = 0; f_vi < FA.cols(); f_vi++) {
+                // (f_v, f)
+                long va_id = FA(fa_id, f_vi);
+                if (selectorA.vertex_to_face(va_id) == fa_id) {
+                    if (BroadPhaseAABB::are_overlapping(
+                            bodyA_vertex_aabbs[va_id], fb_aabb)) {
+                        // Convert the local ids to the global ones
+                        add_vf(va_id, fb_id);
                     }
+                }
 
-                    // (f, f_v)
-                    long vb_id = FB(fb_id, f_vi);
-                    if (selectorB.vertex_to_face(vb_id) == fb_id) {
-                        if (AABB::are_overlapping(
-                                fa_aabb, bodyB_vertex_aabbs[vb_id])) {
-                            // Convert the local ids to the global ones
-                            add_fv(fa_id, vb_id);
-                        }
+                // (f, f_v)
+                long vb_id = FB(fb_id, f_vi);
+                if (selectorB.vertex_to_face(vb_id) == fb_id) {
+                    if (BroadPhaseAABB::are_overlapping(
+                            fa_aabb, bodyB_vertex_aabbs[vb_id])) {
+                        // Convert the local ids to the global ones
+                        add_fv(fa_id, vb_id);
                     }
                 }
+            }
 
-                for (int fa_ei = 0; fa_ei < FA.cols(); fa_ei++) {
-                    long ea_id = selectorA.face_to_edge(fa_id, fa_ei);
+            for (int fa_ei = 0; fa_ei < FA.cols(); fa_ei++) {
+                long ea_id = selectorA.face_to_edge(fa_id, fa_ei);
 
-                    if (selectorA.edge_to_face(ea_id) != fa_id) {
-                        continue;
-                    }
+                if (selectorA.edge_to_face(ea_id) != fa_id) {
+                    continue;
+                }
 
-                    AABB ea_aabb = bodyA_edge_aabb(ea_id);
+                BroadPhaseAABB ea_aabb = bodyA_edge_aabb(ea_id);
 
-                    for (int fb_ei = 0; fb_ei < FB.cols(); fb_ei++) {
-                        long eb_id = selectorB.face_to_edge(fb_id, fb_ei);
+                for (int fb_ei = 0; fb_ei < FB.cols(); fb_ei++) {
+                    long eb_id = selectorB.face_to_edge(fb_id, fb_ei);
 
-                        if (selectorB.edge_to_face(eb_id) != fb_id) {
-                            continue;
-                        }
+                    if (selectorB.edge_to_face(eb_id) != fb_id) {
+                        continue;
+                    }
 
-                        AABB eb_aabb = bodyB_edge_aabb(eb_id);
+                    BroadPhaseAABB eb_aabb = bodyB_edge_aabb(eb_id);
 
-                        if (AABB::are_overlapping(ea_aabb, eb_aabb)) {
-                            // Convert the local ids to the global ones
-                            add_ee(ea_id, eb_id);
-                        }
+                    if (BroadPhaseAABB::are_overlapping(ea_aabb, eb_aabb)) {
+                        // Convert the local ids to the global ones
+                        add_ee(ea_id, eb_id);
                     }
                 }
-
-                // ignore (f, f), (f, f_e), (f_v, f_v), (f_v, f_e), (f_e, f),
-                // (f_e, f_v)
             }
-        }
-    }
 
-    // query (ce, *)
-    for (long co_ea_id = 0; co_ea_id < bodyA.num_codim_edges(); co_ea_id++) {
-        size_t ea_id = selectorA.codim_edges_to_edges(co_ea_id);
-
-        AABB ea_aabb = bodyA_edge_aabb(ea_id);
-
-        std::vector<unsigned int> ids;
-        bodyB.bvh.intersect_box(
-            // Grow the box by inflation_radius because the BVH is not grown
-            ea_aabb.getMin().array() - inflation_radius,
-            ea_aabb.getMax().array() + inflation_radius, //
-            ids);
+            // ignore (f, f), (f, f_e), (f_v, f_v), (f_v, f_e), (f_e, f),
+            // (f_e, f_v)
+        }
+    };
 
-        for (const auto& id : ids) {
-            if (id < bodyB.num_codim_vertices()) {
-                size_t vb_id = selectorB.codim_vertices_to_vertices(id);
+    auto visit_codim_edge = [&](size_t ea_id, size_t id) {
+        if (id < num_codim_verticesB) {
+            size_t vb_id = selectorB.codim_vertices_to_vertices(id);
 
-                // (ce, cv)
-                add_ev(ea_id, vb_id);
+            // (ce, cv)
+            add_ev(ea_id, vb_id);
 
-            } else if (
-                id < bodyB.num_codim_edges() + bodyB.num_codim_vertices()) {
-                size_t eb_id = selectorB.codim_edges_to_edges(id);
+        } else if (id < num_codim_edgesB + num_codim_verticesB) {
+            size_t eb_id = selectorB.codim_edges_to_edges(
+                id - num_codim_verticesB);
 
-                // (ce, ce)
-                add_ee(ea_id, eb_id);
+            // (ce, ce)
+            add_ee(ea_id, eb_id);
 
+            // Rod endpoints are only paired with the other segment if their
+            // boxes overlap it (not just the segment they end).
+            if (build_ev) {
+                const BroadPhaseAABB ea_aabb = bodyA_edge_aabb(ea_id);
+                const BroadPhaseAABB eb_aabb = bodyB_edge_aabb(eb_id);
                 for (int vi = 0; vi < EB.cols(); vi++) {
                     // (ce, ce_v)
                     size_t vb_id = EB(eb_id, vi);
-                    if (selectorB.vertex_to_edge(vb_id) == eb_id) {
+                    if (selectorB.vertex_to_edge(vb_id) == eb_id
+                        && BroadPhaseAABB::are_overlapping(
+                            ea_aabb, bodyB_vertex_aabbs[vb_id])) {
                         add_ev(ea_id, vb_id);
                     }
 
                     // (ce_v, ce)
                     size_t va_id = EA(ea_id, vi);
-                    if (selectorA.vertex_to_edge(va_id) == ea_id) {
+                    if (selectorA.vertex_to_edge(va_id) == ea_id
+                        && BroadPhaseAABB::are_overlapping(
+                            bodyA_vertex_aabbs[va_id], eb_aabb)) {
                         add_ve(va_id, eb_id);
                     }
                 }
+            }
 
-                // (ce_v, ce_v) is not needed
+            // (ce_v, ce_v) is not needed
 
-            } else {
-                // (ce, f*)
-                size_t fb_id =
-                    id - bodyB.num_codim_vertices() - bodyB.num_codim_edges();
+        } else {
+            // (ce, f*)
+            size_t fb_id =
+                id - num_codim_verticesB - num_codim_edgesB;
 
-                // (ce_v, f_v) is not needed
-                // (ce_v, f_e) is not needed because in 3D
-                // (ce, f_v) is not needed because in 3D
-                assert(!build_ev);
+            // (ce_v, f_v) is not needed
+            // (ce_v, f_e) is not needed because in 3D
+            // (ce, f_v) is not needed because in 3D
+            assert(!build_ev);
 
-                // (ce_v, f)
-                for (int vi = 0; vi < EA.cols(); vi++) {
-                    size_t va_id = EA(ea_id, vi);
-                    if (selectorA.vertex_to_edge(va_id) == ea_id) {
-                        add_vf(va_id, fb_id);
-                    }
+            // (ce_v, f)
+            for (int vi = 0; vi < EA.cols(); vi++) {
+                size_t va_id = EA(ea_id, vi);
+                if (selectorA.vertex_to_edge(va_id) == ea_id) {
+                    add_vf(va_id, fb_id);
                 }
+            }
 
-                // (ce, f_e)
-                for (int ei = 0; ei < FB.cols(); ei++) {
-                    size_t eb_id = selectorB.face_to_edge(fb_id, ei);
-                    if (selectorB.edge_to_face(eb_id) == fb_id) {
-                        add_ee(ea_id, eb_id);
-                    }
+            // (ce, f_e)
+            for (int ei = 0; ei < FB.cols(); ei++) {
+                size_t eb_id = selectorB.face_to_edge(fb_id, ei);
+                if (selectorB.edge_to_face(eb_id) == fb_id) {
+                    add_ee(ea_id, eb_id);
                 }
-
-                // (ce, f) is not needed
             }
-        }
-    }
 
-    // query (cv, *)
-    for (long co_va_id = 0; co_va_id < bodyA.num_codim_vertices(); co_va_id++) {
-        size_t va_id = selectorA.codim_vertices_to_vertices(co_va_id);
+            // (ce, f) is not needed
+        }
+    };
 
-        AABB va_aabb = bodyA_vertex_aabbs[va_id];
+    auto visit_codim_vertex = [&](size_t va_id, size_t id) {
+        if (id < num_codim_verticesB) {
+            // (cv, cv) is not needed
+        } else if (id < num_codim_verticesB + num_codim_edgesB) {
+            size_t eb_id = selectorB.codim_edges_to_edges(
+                id - num_codim_verticesB);
 
-        std::vector<unsigned int> ids;
-        bodyB.bvh.intersect_box(
-            // Grow the box by inflation_radius because the BVH is not grown
-            va_aabb.getMin().array() - inflation_radius,
-            va_aabb.getMax().array() + inflation_radius, //
-            ids);
+            // (cv, ce)
+            add_ev(eb_id, va_id);
 
-        for (const auto& id : ids) {
-            if (id < bodyB.num_codim_vertices()) {
-                // (cv, cv) is not needed
-            } else if (
-                id < bodyB.num_codim_vertices() + bodyB.num_codim_edges()) {
+            // (cv, ce_v) is not needed
+        } else {
+            // (cv, f)
+            size_t fb_id =
+                id - num_codim_verticesB - num_codim_edgesB;
+            add_vf(va_id, fb_id);
 
-                size_t eb_id = selectorB.codim_edges_to_edges(
-                    id - bodyB.num_codim_vertices());
+            // (cv, f_e) is not needed because in 3D
+            assert(!build_ev);
 
-                // (cv, ce)
-                add_ev(eb_id, va_id);
+            // (cv, f_v) is not needed
+        }
+    };
 
-                // (cv, ce_v) is not needed
-            } else {
-                // (cv, f)
-                size_t fb_id =
-                    id - bodyB.num_codim_vertices() - bodyB.num_codim_edges();
-                add_vf(va_id, fb_id);
+    traverse_body_pair(
+        bodyA, bodyA_vertex_aabbs, geometryB, visit_codim_vertex,
+        visit_codim_edge, visit_face);
+}
 
-                // (cv, f_e) is not needed because in 3D
-                assert(!build_ev);
+void detect_body_pair_collision_candidates_from_aabbs(
+    const RigidBodyAssembler& bodies,
+    const std::vector<BroadPhaseAABB>& bodyA_inflated_vertex_aabbs,
+    const int bodyA_id,
+    const int bodyB_id,
+    const int collision_types,
+    Candidates& candidates,
+    const double inflation_radius)
+{
+    detect_collision_candidates_from_aabbs(
+        bodies, bodyA_inflated_vertex_aabbs, bodyA_id,
+        *bodies[bodyB_id].geometry, BodyPrimitiveIds { bodies, bodyB_id },
+        collision_types, candidates, inflation_radius);
+}
 
-                // (cv, f_v) is not needed
-            }
-        }
-        // for (int fb_id = 0; fb_id < FB.rows(); fb_id++) {
-        //     if (AABB::are_overlapping(va_aabb, bodyB_face_aabb(fb_id))) {
-        //         add_vf(va_id, fb_id);
-        //     }
-        // }
-    }
+void detect_static_world_collision_candidates_from_aabbs(
+    const RigidBodyAssembler& bodies,
+    const std::vector<BroadPhaseAABB>& body_inflated_vertex_aabbs,
+    const int body_id,
+    const int collision_types,
+    Candidates& candidates,
+    const double inflation_radius)
+{
+    assert(!bodies.m_static_world.empty());
+    detect_collision_candidates_from_aabbs(
+        bodies, body_inflated_vertex_aabbs, body_id,
+        *bodies.m_static_world.geometry,
+        StaticWorldPrimitiveIds { bodies, body_id }, collision_types,
+        candidates, inflation_radius);
 }
 
 void detect_body_pair_intersection_candidates_from_aabbs(
     const RigidBodyAssembler& bodies,
-    const std::vector<AABB>& bodyA_vertex_aabbs,
+    const std::vector<BroadPhaseAABB>& bodyA_inflated_vertex_aabbs,
     const int bodyA_id,
     const int bodyB_id,
     std::vector<EdgeFaceCandidate>& ef_candidates,
@@ -334,113 +437,81 @@ void detect_body_pair_intersection_candidates_from_aabbs(
     const RigidBody& bodyA = bodies[bodyA_id];
     const RigidBody& bodyB = bodies[bodyB_id];
 
-    const std::vector<AABB> bodyB_vertex_aabbs =
-        vertex_aabbs(bodyB.vertices, inflation_radius);
-    const Eigen::MatrixXi &EA = bodyA.edges, &EB = bodyB.edges,
-                          &FA = bodyA.faces, &FB = bodyB.faces;
+    // Body B's boxes are constant in its local frame, so they are cached
+    // uninflated and body A's boxes are grown a second time instead.
+    static thread_local std::vector<BroadPhaseAABB> bodyA_grown_aabbs;
+    const std::vector<BroadPhaseAABB>& bodyA_vertex_aabbs = inflate_aabbs(
+        bodyA_inflated_vertex_aabbs, inflation_radius, bodyA_grown_aabbs);
+    const RigidBodyGeometry& geometryB = *bodyB.geometry;
+    const Eigen::MatrixXi &EA = bodyA.edges, &FA = bodyA.faces;
 
-    const auto& selectorA = bodyA.mesh_selector;
-    const auto& selectorB = bodyB.mesh_selector;
+    const auto& selectorA = bodyA.mesh_selector();
+    const auto& selectorB = bodyB.mesh_selector();
 
     auto bodyA_edge_aabb = [&](size_t ei) {
-        return AABB(
+        return BroadPhaseAABB(
             bodyA_vertex_aabbs[EA(ei, 0)], bodyA_vertex_aabbs[EA(ei, 1)]);
     };
-    auto bodyB_edge_aabb = [&](size_t ei) {
-        return AABB(
-            bodyB_vertex_aabbs[EB(ei, 0)], bodyB_vertex_aabbs[EB(ei, 1)]);
-    };
+    auto bodyB_edge_aabb = [&](size_t ei) { return geometryB.edge_aabbs[ei]; };
     auto bodyA_face_aabb = [&](size_t fi) {
-        return AABB(
+        return BroadPhaseAABB(
             bodyA_vertex_aabbs[FA(fi, 0)], bodyA_vertex_aabbs[FA(fi, 1)],
             bodyA_vertex_aabbs[FA(fi, 2)]);
     };
-    auto bodyB_face_aabb = [&](size_t fi) {
-        return AABB(
-            bodyB_vertex_aabbs[FB(fi, 0)], bodyB_vertex_aabbs[FB(fi, 1)],
-            bodyB_vertex_aabbs[FB(fi, 2)]);
-    };
-
-    ///////////////////////////////////////////////////////////////////////////
-    // query (f, *)
-    for (size_t fa_id = 0; fa_id < FA.rows(); fa_id++) {
-        // Construct a bbox of bodyA's face
-        AABB fa_aabb = bodyA_face_aabb(fa_id);
-
-        std::vector<unsigned int> ids;
-        bodyB.bvh.intersect_box(
-            // Grow the box by inflation_radius because the BVH is not grown
-            fa_aabb.getMin().array() - inflation_radius,
-            fa_aabb.getMax().array() + inflation_radius, //
-            ids);
-
-        for (const auto& id : ids) {
-            if (id < bodyB.num_codim_vertices()) {
-                // ignore (f, cv)
-            } else if (
-                id < bodyB.num_codim_edges() + bodyB.num_codim_vertices()) {
-
-                // (f, ce)
-                size_t eb_id = selectorB.codim_edges_to_edges(
-                    id - bodyB.num_codim_vertices());
-                add_fe(fa_id, eb_id);
-
-            } else {
-                size_t fb_id =
-                    id - bodyB.num_codim_vertices() - bodyB.num_codim_edges();
-
-                AABB fb_aabb = bodyB_face_aabb(fb_id);
-
-                for (int ei = 0; ei < FA.cols(); ei++) {
-                    long ea_id = bodyA.mesh_selector.face_to_edge(fa_id, ei);
-                    if (selectorA.edge_to_face(ea_id) == fa_id) {
-                        AABB ea_aabb = bodyA_edge_aabb(ea_id);
-                        if (AABB::are_overlapping(ea_aabb, fb_aabb)) {
-                            add_ef(ea_id, fb_id);
-                        }
+    auto bodyB_face_aabb = [&](size_t fi) { return geometryB.face_aabbs[fi]; };
+
+    auto visit_face = [&](size_t fa_id, size_t id) {
+        if (id < bodyB.num_codim_vertices()) {
+            // ignore (f, cv)
+        } else if (id < bodyB.num_codim_edges() + bodyB.num_codim_vertices()) {
+
+            // (f, ce)
+            size_t eb_id = selectorB.codim_edges_to_edges(
+                id - bodyB.num_codim_vertices());
+            add_fe(fa_id, eb_id);
+
+        } else {
+            size_t fb_id =
+                id - bodyB.num_codim_vertices() - bodyB.num_codim_edges();
+
+            // Construct a bbox of bodyA's face
+            BroadPhaseAABB fa_aabb = bodyA_face_aabb(fa_id);
+            BroadPhaseAABB fb_aabb = bodyB_face_aabb(fb_id);
+
+            for (int ei = 0; ei < FA.cols(); ei++) {
+                long ea_id = selectorA.face_to_edge(fa_id, ei);
+                if (selectorA.edge_to_face(ea_id) == fa_id) {
+                    BroadPhaseAABB ea_aabb = bodyA_edge_aabb(ea_id);
+                    if (BroadPhaseAABB::are_overlapping(ea_aabb, fb_aabb)) {
+                        add_ef(ea_id, fb_id);
                     }
+                }
 
-                    long eb_id = bodyB.mesh_selector.face_to_edge(fb_id, ei);
-                    if (bodyB.mesh_selector.edge_to_face(eb_id) == fb_id) {
-                        AABB eb_aabb = bodyB_edge_aabb(eb_id);
-                        if (AABB::are_overlapping(fa_aabb, eb_aabb)) {
-                            add_fe(fa_id, eb_id);
-                        }
+                long eb_id = selectorB.face_to_edge(fb_id, ei);
+                if (selectorB.edge_to_face(eb_id) == fb_id) {
+                    BroadPhaseAABB eb_aabb = bodyB_edge_aabb(eb_id);
+                    if (BroadPhaseAABB::are_overlapping(fa_aabb, eb_aabb)) {
+                        add_fe(fa_id, eb_id);
                     }
                 }
             }
         }
-    }
+    };
 
-    // query (ce, *)
-    for (long co_ea_id = 0; co_ea_id < bodyA.num_codim_edges(); co_ea_id++) {
-        size_t ea_id = selectorA.codim_edges_to_edges(co_ea_id);
-
-        AABB ea_aabb = bodyA_edge_aabb(ea_id);
-
-        std::vector<unsigned int> ids;
-        bodyB.bvh.intersect_box(
-            // Grow the box by inflation_radius because the BVH is not grown
-            ea_aabb.getMin().array() - inflation_radius,
-            ea_aabb.getMax().array() + inflation_radius, //
-            ids);
-
-        for (const auto& id : ids) {
-            if (id < bodyB.num_codim_vertices()) {
-                // ignore (ce, cv)
-            } else if (
-                id < bodyB.num_codim_edges() + bodyB.num_codim_vertices()) {
-                // ignore (ce, cv)
-            } else {
-                size_t fb_id =
-                    id - bodyB.num_codim_vertices() - bodyB.num_codim_edges();
-                // (ce, f)
-                add_ef(ea_id, fb_id);
-            }
+    auto visit_codim_edge = [&](size_t ea_id, size_t id) {
+        if (id >= bodyB.num_codim_vertices() + bodyB.num_codim_edges()) {
+            size_t fb_id =
+                id - bodyB.num_codim_vertices() - bodyB.num_codim_edges();
+            // (ce, f)
+            add_ef(ea_id, fb_id);
         }
-    }
+        // ignore (ce, cv) and (ce, ce)
+    };
 
-    // no need to query (cv, *)
+    // no need to visit (cv, *)
+    traverse_body_pair(
+        bodyA, bodyA_vertex_aabbs, geometryB, [](size_t, size_t) {},
+        visit_codim_edge, visit_face);
 }
 
 } // namespace ipc::rigid
@@ -6,6 +6,7 @@
 #include <ipc/broad_phase/hash_grid.hpp>
 
 #include <ccd/ccd.hpp>
+#include <ccd/rigid/float_aabb.hpp>
 #include <interval/interval.hpp>
 #include <physics/rigid_body_assembler.hpp>
 
@@ -39,31 +40,64 @@ inline AABB vertex_aabb(const VectorMax3I& v, double inflation_radius = 0)
     return AABB(min, max);
 }
 
+/// @brief Refit the vertex boxes in place.
+/// The storage of aabbs is reused, so no allocation happens once it is large
+/// enough.
+template <typename T, typename Box>
+inline void vertex_aabbs(
+    const MatrixX<T>& V, std::vector<Box>& aabbs, double inflation_radius = 0)
+{
+    aabbs.resize(V.rows());
+    for (size_t i = 0; i < V.rows(); i++) {
+        aabbs[i] = Box(vertex_aabb(VectorMax3<T>(V.row(i)), inflation_radius));
+    }
+}
+
 template <typename T>
 inline std::vector<AABB>
 vertex_aabbs(const MatrixX<T>& V, double inflation_radius = 0)
 {
     std::vector<AABB> aabbs;
-    aabbs.reserve(V.rows());
-    for (size_t i = 0; i < V.rows(); i++) {
-        aabbs.push_back(vertex_aabb(VectorMax3<T>(V.row(i)), inflation_radius));
-    }
+    vertex_aabbs(V, aabbs, inflation_radius);
     return aabbs;
 }
 
+/// @brief Boxes grown by a radius (or the boxes themselves if it is zero).
+/// The storage of inflated is reused.
+inline const std::vector<BroadPhaseAABB>& inflate_aabbs(
+    const std::vector<BroadPhaseAABB>& aabbs,
+    double radius,
+    std::vector<BroadPhaseAABB>& inflated)
+{
+    if (radius == 0) {
+        return aabbs;
+    }
+    inflated.resize(aabbs.size());
+    for (size_t i = 0; i < aabbs.size(); i++) {
+        inflated[i] = BroadPhaseAABB(
+            aabbs[i].getMin() - radius, aabbs[i].getMax() + radius);
+    }
+    return inflated;
+}
+
+/// @param bodyA_vertex_aabbs Boxes of body A's vertices in body B's frame
+/// grown by the inflation radius.
 void detect_body_pair_collision_candidates_from_aabbs(
     const RigidBodyAssembler& bodies,
-    const std::vector<AABB>& bodyA_vertex_aabbs,
+    const std::vector<BroadPhaseAABB>& bodyA_vertex_aabbs,
     const int bodyA_id,
     const int bodyB_id,
     const int collision_types,
     Candidates& candidates,
     const double inflation_radius = 0.0);
 
+/// @param rotations Rotation matrices of the poses (see
+/// construct_rotation_matrices()).
 template <typename T>
 inline void detect_body_pair_collision_candidates_bvh(
     const RigidBodyAssembler& bodies,
     const Poses<T>& poses,
+    const std::vector<MatrixMax3<T>>& rotations,
     int bodyA_id,
     int bodyB_id,
     const int collision_types,
@@ -78,24 +112,67 @@ inline void detect_body_pair_collision_candidates_bvh(
     //     "detect_body_pair_collision_candidates_bvh<{}>:compute_vertices",
     //     get_type_name<T>()));
     // PROFILE_START();
-    const auto RA = poses[bodyA_id].construct_rotation_matrix();
-    const auto RB = poses[bodyB_id].construct_rotation_matrix();
+    const MatrixMax3<T>& RA = rotations[bodyA_id];
+    const MatrixMax3<T>& RB = rotations[bodyB_id];
     const auto& pA = poses[bodyA_id].position;
     const auto& pB = poses[bodyB_id].position;
-    const MatrixX<T> VA =
-        ((bodies[bodyA_id].vertices * RA.transpose()).rowwise()
-         + (pA - pB).transpose())
+    // Reuse the per-thread storage across pairs and calls
+    static thread_local MatrixX<T> VA;
+    VA.noalias() = ((bodies[bodyA_id].vertices * RA.transpose()).rowwise()
+                    + (pA - pB).transpose())
         * RB;
     // PROFILE_END();
 
+    static thread_local std::vector<BroadPhaseAABB> bodyA_vertex_aabbs;
+    vertex_aabbs(VA, bodyA_vertex_aabbs, inflation_radius);
+
     detect_body_pair_collision_candidates_from_aabbs(
-        bodies, vertex_aabbs(VA, inflation_radius), bodyA_id, bodyB_id,
-        collision_types, candidates, inflation_radius);
+        bodies, bodyA_vertex_aabbs, bodyA_id, bodyB_id, collision_types,
+        candidates, inflation_radius);
+}
+
+/// @brief Candidates between a body and the static bodies merged in
+/// bodies.m_static_world.
+/// @param body_vertex_aabbs Boxes of the body's vertices in world space grown
+/// by the inflation radius.
+void detect_static_world_collision_candidates_from_aabbs(
+    const RigidBodyAssembler& bodies,
+    const std::vector<BroadPhaseAABB>& body_vertex_aabbs,
+    const int body_id,
+    const int collision_types,
+    Candidates& candidates,
+    const double inflation_radius = 0.0);
+
+/// @brief Candidates between a body and the static bodies merged in
+/// bodies.m_static_world, found with one traversal of the world's hierarchy.
+/// @param rotations Rotation matrices of the poses (see
+/// construct_rotation_matrices()).
+template <typename T>
+inline void detect_static_world_collision_candidates_bvh(
+    const RigidBodyAssembler& bodies,
+    const Poses<T>& poses,
+    const std::vector<MatrixMax3<T>>& rotations,
+    int body_id,
+    const int collision_types,
+    Candidates& candidates,
+    const double inflation_radius = 0.0)
+{
+    // The merged mesh is in world space
+    static thread_local MatrixX<T> V;
+    V.noalias() = bodies[body_id].vertices * rotations[body_id].transpose();
+    V.rowwise() += poses[body_id].position.transpose();
+
+    static thread_local std::vector<BroadPhaseAABB> body_vertex_aabbs;
+    vertex_aabbs(V, body_vertex_aabbs, inflation_radius);
+
+    detect_static_world_collision_candidates_from_aabbs(
+        bodies, body_vertex_aabbs, body_id, collision_types, candidates,
+        inflation_radius);
 }
 
 void detect_body_pair_intersection_candidates_from_aabbs(
     const RigidBodyAssembler& bodies,
-    const std::vector<AABB>& bodyA_vertex_aabbs,
+    const std::vector<BroadPhaseAABB>& bodyA_vertex_aabbs,
     const int bodyA_id,
     const int bodyB_id,
     std::vector<EdgeFaceCandidate>& candidates,
@@ -1,13 +1,20 @@
 // A spatial hash grid for rigid bodies with angular trajectories.
 #include "rigid_body_hash_grid.hpp"
 
+#include <algorithm>
 #include <cmath>
 #include <iostream>
 
 #include <tbb/parallel_invoke.h>
+#include <tbb/parallel_reduce.h>
+#include <tbb/parallel_sort.h>
 
+#include <constants.hpp>
 #include <interval/interval.hpp>
 #include <logger.hpp>
+#include <utils/memory_usage.hpp>
+#include <utils/radix_sort.hpp>
+#include <utils/transient_pool.hpp>
 
 #include <io/serialize_json.hpp>
 #include <nlohmann/json.hpp>
@@ -58,7 +65,7 @@ void RigidBodyHashGrid::resize(
     // TODO: this may not be well scaled depending on the body_ids
     double cell_size = bodies.average_edge_length;
 
-    HashGrid::resizeFromBox(min, max, cell_size);
+    fit(min, max, cell_size);
 }
 
 void compute_scene_conservative_bbox(
@@ -115,7 +122,121 @@ void RigidBodyHashGrid::resize(
     double cell_size =
         std::max(average_displacement_length, average_edge_length);
 
-    HashGrid::resizeFromBox(min, max, cell_size);
+    fit(min, max, cell_size);
+}
+
+void RigidBodyHashGrid::fit(
+    const VectorMax3d& min, const VectorMax3d& max, double cell_size)
+{
+    // Clearing keeps the capacity of the items
+    m_vertex_items.clear();
+    m_edge_items.clear();
+    m_face_items.clear();
+
+    const bool is_inside_domain = m_domain_min.size() == min.size()
+        && (min.array() >= m_domain_min.array()).all()
+        && (max.array() <= m_domain_max.array()).all();
+    const bool is_cell_size_close = std::abs(cell_size - m_cell_size)
+        <= Constants::RIGID_HASH_GRID_CELL_SIZE_TOLERANCE * m_cell_size;
+    if (is_inside_domain && is_cell_size_close) {
+        return;
+    }
+
+    const VectorMax3d margin =
+        Constants::RIGID_HASH_GRID_DOMAIN_MARGIN * (max - min);
+    m_domain_min = min - margin;
+    m_domain_max = max + margin;
+    m_cell_size = cell_size;
+    HashGrid::resizeFromBox(m_domain_min, m_domain_max, m_cell_size);
+}
+
+void RigidBodyHashGrid::sort_items()
+{
+    const auto key = [](const LevelItem& item) {
+        return (uint64_t(item.key) << 32) | uint32_t(item.id);
+    };
+    tbb::parallel_invoke(
+        [&]() { parallel_radix_sort(m_vertex_items, key); },
+        [&]() { parallel_radix_sort(m_edge_items, key); },
+        [&]() { parallel_radix_sort(m_face_items, key); });
+}
+
+int RigidBodyHashGrid::level(const AABB& aabb) const
+{
+    const double extent = (aabb.getMax() - aabb.getMin()).maxCoeff();
+    if (!(extent > m_cell_size)) {
+        return 0;
+    }
+    return std::min(
+        int(std::ceil(std::log2(extent / m_cell_size))),
+        Constants::RIGID_HASH_GRID_NUM_LEVELS - 1);
+}
+
+void RigidBodyHashGrid::add_element(
+    const AABB& aabb,
+    int id,
+    int level,
+    bool is_ghost,
+    std::vector<LevelItem>& items) const
+{
+    const double cell_size = std::ldexp(m_cell_size, level);
+    const int dim = aabb.getMin().size();
+    Eigen::Array3i min_cell = Eigen::Array3i::Zero(),
+                   max_cell = Eigen::Array3i::Zero();
+    for (int i = 0; i < dim; i++) {
+        min_cell(i) = int(
+            std::floor((aabb.getMin()(i) - m_domain_min(i)) / cell_size));
+        max_cell(i) = int(
+            std::floor((aabb.getMax()(i) - m_domain_min(i)) / cell_size));
+    }
+
+    // Hash of Teschner et al. [2003] (collisions only add candidates)
+    for (int x = min_cell.x(); x <= max_cell.x(); x++) {
+        for (int y = min_cell.y(); y <= max_cell.y(); y++) {
+            for (int z = min_cell.z(); z <= max_cell.z(); z++) {
+                const uint32_t key = (uint32_t(x) * 73856093u)
+                    ^ (uint32_t(y) * 19349663u) ^ (uint32_t(z) * 83492791u)
+                    ^ (uint32_t(level) * 50331653u);
+                items.push_back({ key, id, is_ghost });
+            }
+        }
+    }
+}
+
+void RigidBodyHashGrid::insert_primitives(
+    const std::vector<PrimitiveBox>& vertex_boxes,
+    const std::vector<PrimitiveBox>& edge_boxes,
+    const std::vector<PrimitiveBox>& face_boxes)
+{
+    // Ghosts are only needed up to the coarsest level used
+    int max_level = 0;
+    for (const auto* boxes : { &vertex_boxes, &edge_boxes, &face_boxes }) {
+        max_level = tbb::parallel_reduce(
+            tbb::blocked_range<size_t>(0, boxes->size()), max_level,
+            [&](const tbb::blocked_range<size_t>& r, int max_level) {
+                for (size_t i = r.begin(); i != r.end(); i++) {
+                    max_level = std::max(max_level, level((*boxes)[i].aabb));
+                }
+                return max_level;
+            },
+            [](int a, int b) { return std::max(a, b); });
+    }
+
+    const auto insert = [&](const std::vector<PrimitiveBox>& boxes,
+                            std::vector<LevelItem>& items) {
+        items.clear();
+        for (const PrimitiveBox& box : boxes) {
+            const int box_level = level(box.aabb);
+            for (int l = box_level; l <= max_level; l++) {
+                add_element(box.aabb, box.id, l, l != box_level, items);
+            }
+        }
+    };
+    tbb::parallel_invoke(
+        [&]() { insert(vertex_boxes, m_vertex_items); },
+        [&]() { insert(edge_boxes, m_edge_items); },
+        [&]() { insert(face_boxes, m_face_items); });
+    sort_items();
 }
 
 /// Add dynamic bodies
@@ -128,37 +249,37 @@ void RigidBodyHashGrid::addBodies(
     std::vector<int> body_ids =
         body_pairs_to_body_ids(body_pairs, bodies.num_bodies());
 
+    std::vector<PrimitiveBox> vertex_boxes, edge_boxes, face_boxes;
     for (int id : body_ids) {
-        Eigen::MatrixXd V = bodies[id].world_vertices(poses[id]);
-        tbb::parallel_invoke(
-            [&]() {
-                long v0i = bodies.m_body_vertex_id[id];
-                for (int i = 0; i < V.rows(); i++) {
-                    this->addVertex(
-                        V.row(i), V.row(i), v0i + i, inflation_radius);
-                }
-            },
-            [&]() {
-                const Eigen::MatrixXi& E = bodies[id].edges;
-                long e0i = bodies.m_body_edge_id[id];
-                for (int i = 0; i < E.rows(); i++) {
-                    this->addEdge(
-                        V.row(E(i, 0)), V.row(E(i, 1)), //
-                        V.row(E(i, 0)), V.row(E(i, 1)), //
-                        e0i + i, inflation_radius);
-                }
-            },
-            [&]() {
-                const Eigen::MatrixXi& F = bodies[id].faces;
-                long f0i = bodies.m_body_face_id[id];
-                for (int i = 0; i < F.rows(); i++) {
-                    this->addFace(
-                        V.row(F(i, 0)), V.row(F(i, 1)), V.row(F(i, 2)), //
-                        V.row(F(i, 0)), V.row(F(i, 1)), V.row(F(i, 2)), //
-                        f0i + i, inflation_radius);
-                }
-            });
+        const Eigen::MatrixXd V = bodies[id].world_vertices(poses[id]);
+        std::vector<AABB> vertices_aabb(V.rows());
+        const long v0i = bodies.m_body_vertex_id[id];
+        for (int i = 0; i < V.rows(); i++) {
+            const ArrayMax3d v = V.row(i).transpose().array();
+            vertices_aabb[i] =
+                AABB(v - inflation_radius, v + inflation_radius);
+            vertex_boxes.push_back({ v0i + i, vertices_aabb[i] });
+        }
+
+        const Eigen::MatrixXi& E = bodies[id].edges;
+        const long e0i = bodies.m_body_edge_id[id];
+        for (int i = 0; i < E.rows(); i++) {
+            edge_boxes.push_back(
+                { e0i + i,
+                  AABB(vertices_aabb[E(i, 0)], vertices_aabb[E(i, 1)]) });
+        }
+
+        const Eigen::MatrixXi& F = bodies[id].faces;
+        const long f0i = bodies.m_body_face_id[id];
+        for (int i = 0; i < F.rows(); i++) {
+            face_boxes.push_back(
+                { f0i + i,
+                  AABB(
+                      AABB(vertices_aabb[F(i, 0)], vertices_aabb[F(i, 1)]),
+                      vertices_aabb[F(i, 2)]) });
+        }
     }
+    insert_primitives(vertex_boxes, edge_boxes, face_boxes);
 }
 
 void RigidBodyHashGrid::compute_vertices_intervals(
@@ -167,22 +288,43 @@ void RigidBodyHashGrid::compute_vertices_intervals(
     const Poses<Interval>& poses_t1,
     const std::vector<int>& body_ids,
     MatrixXI& vertices,
-    double inflation_radius) const
+    double inflation_radius)
 {
     vertices.setConstant(
         bodies.num_vertices(), bodies.dim(), Interval::empty());
+    m_body_subdivision_depths.assign(bodies.num_bodies(), 0);
     for (int i : body_ids) {
         MatrixXI V;
         int n_subs = compute_vertices_intervals(
             bodies[i], poses_t0[i], poses_t1[i], V, inflation_radius,
-            Interval(0, 1), 1);
+            Interval(0, 1), /*force_subdivision=*/0,
+            Constants::RIGID_HASH_GRID_MAX_SUBDIVISION);
         if (n_subs) {
-            spdlog::trace("nsubs={:d}", n_subs);
+            RIGID_IPC_LOG_TRACE("body_id={:d} nsubs={:d}", i, n_subs);
         }
+        m_body_subdivision_depths[i] = n_subs;
         vertices.middleRows(bodies.m_body_vertex_id[i], V.rows()) = V;
     }
 }
 
+bool RigidBodyHashGrid::are_vertices_intervals_loose(
+    const RigidBody& body, const Pose<Interval>& pose, const MatrixXI& vertices)
+{
+    // Subdividing cannot tighten the part of the boxes due to translation.
+    const double translation_diagonal = diagonal_width(pose.position);
+
+    const Eigen::RowVectorXd static_extent =
+        body.vertices.colwise().maxCoeff() - body.vertices.colwise().minCoeff();
+
+    double max_diagonal = 0;
+    for (int i = 0; i < vertices.rows(); i++) {
+        max_diagonal = std::max(max_diagonal, diagonal_width(vertices.row(i)));
+    }
+
+    return max_diagonal > translation_diagonal
+        + Constants::RIGID_HASH_GRID_SUBDIVISION_RATIO * static_extent.norm();
+}
+
 typedef Pose<Interval> PoseI;
 
 int RigidBodyHashGrid::compute_vertices_intervals(
@@ -192,7 +334,8 @@ int RigidBodyHashGrid::compute_vertices_intervals(
     MatrixX<Interval>& vertices,
     double inflation_radius, // Only used for fit check
     const Interval& t,
-    int force_subdivision) const
+    int force_subdivision,
+    int max_subdivision) const
 {
     if (force_subdivision <= 0) {
         PoseI pose = PoseI::interpolate(pose_t0, pose_t1, t);
@@ -210,7 +353,9 @@ int RigidBodyHashGrid::compute_vertices_intervals(
             }
         }
 
-        if (fits) {
+        if (fits
+            && (max_subdivision <= 0
+                || !are_vertices_intervals_loose(body, pose, vertices))) {
             return 0;
         }
     } else {
@@ -218,6 +363,7 @@ int RigidBodyHashGrid::compute_vertices_intervals(
     }
 
     force_subdivision--;
+    max_subdivision--;
 
     // If the vertices' intervals are outside the scene bbox, then split t in
     // hopes that a smaller interval will be more accurate.
@@ -225,10 +371,10 @@ int RigidBodyHashGrid::compute_vertices_intervals(
     MatrixXI V_first, V_second;
     int n_subs0 = compute_vertices_intervals(
         body, pose_t0, pose_t1, V_first, inflation_radius, t_halves.first,
-        force_subdivision);
+        force_subdivision, max_subdivision);
     int n_subs1 = compute_vertices_intervals(
         body, pose_t0, pose_t1, V_second, inflation_radius, t_halves.second,
-        force_subdivision);
+        force_subdivision, max_subdivision);
     assert(vertices.rows() == V_first.rows());
     assert(vertices.rows() == V_second.rows());
     assert(vertices.cols() == V_first.cols());
@@ -281,7 +427,9 @@ void RigidBodyHashGrid::addBodies(
         vertices, inflation_radius);
 
     // Create a bounding box for all vertices
-    std::vector<AABB> vertices_aabb;
+    static TransientPool<std::vector<AABB>> aabbs_pool;
+    const auto vertices_aabb_buffer = aabbs_pool.acquire();
+    std::vector<AABB>& vertices_aabb = *vertices_aabb_buffer;
     vertices_aabb.resize(vertices.rows());
     std::vector<bool> is_vertex_included;
     is_vertex_included.resize(vertices.rows(), true);
@@ -304,42 +452,174 @@ void RigidBodyHashGrid::addBodies(
             && is_vertex_included[bodies.m_faces(fi, 2)];
     };
 
+    static TransientPool<std::vector<PrimitiveBox>> boxes_pool;
+    const auto vertex_boxes = boxes_pool.acquire();
+    const auto edge_boxes = boxes_pool.acquire();
+    const auto face_boxes = boxes_pool.acquire();
+    vertex_boxes->clear();
+    edge_boxes->clear();
+    face_boxes->clear();
     tbb::parallel_invoke(
-        // Add all vertices of the bodies
+        // Boxes of all vertices of the bodies
         [&]() {
             for (long i = 0; i < vertices.rows(); i++) {
                 if (is_vertex_included[i]) {
-                    this->addElement(vertices_aabb[i], i, this->m_vertexItems);
+                    vertex_boxes->push_back({ i, vertices_aabb[i] });
                 }
             }
         },
 
-        // Add all edge of the bodies
+        // Boxes of all edge of the bodies
         [&]() {
             for (long i = 0; i < bodies.m_edges.rows(); i++) {
                 if (is_edge_include(i)) {
-                    this->addElement(
-                        AABB(
-                            vertices_aabb[bodies.m_edges(i, 0)],
-                            vertices_aabb[bodies.m_edges(i, 1)]),
-                        i, this->m_edgeItems);
+                    edge_boxes->push_back(
+                        { i,
+                          AABB(
+                              vertices_aabb[bodies.m_edges(i, 0)],
+                              vertices_aabb[bodies.m_edges(i, 1)]) });
                 }
             }
         },
 
-        // Add all faces of the bodies
+        // Boxes of all faces of the bodies
         [&]() {
             for (long i = 0; i < bodies.m_faces.rows(); i++) {
                 if (is_face_include(i)) {
-                    this->addElement(
-                        AABB(
-                            AABB(
-                                vertices_aabb[bodies.m_faces(i, 0)],
-                                vertices_aabb[bodies.m_faces(i, 1)]),
-                            vertices_aabb[bodies.m_faces(i, 2)]),
-                        i, this->m_faceItems);
+                    face_boxes->push_back(
+                        { i,
+                          AABB(
+                              AABB(
+                                  vertices_aabb[bodies.m_faces(i, 0)],
+                                  vertices_aabb[bodies.m_faces(i, 1)]),
+                              vertices_aabb[bodies.m_faces(i, 2)]) });
+                }
+            }
+        });
+    insert_primitives(*vertex_boxes, *edge_boxes, *face_boxes);
+}
+
+size_t RigidBodyHashGrid::memory_bytes() const
+{
+    return MemoryUsage::bytes_of(m_vertex_items)
+        + MemoryUsage::bytes_of(m_edge_items)
+        + MemoryUsage::bytes_of(m_face_items)
+        + MemoryUsage::bytes_of(m_body_subdivision_depths);
+}
+
+namespace {
+    /// Pair the items of two lists (sorted by key) in the same cell, except
+    /// for two ghosts that meet at a finer level (or never overlap).
+    template <typename Candidate, typename Item, typename AddPair>
+    void get_pairs(
+        const std::vector<Item>& items0,
+        const std::vector<Item>& items1,
+        std::vector<Candidate>& candidates,
+        const AddPair& add_pair)
+    {
+        const size_t num_candidates = candidates.size();
+        const bool is_same_list = &items0 == &items1;
+        size_t i = 0, j = 0;
+        while (i < items0.size() && j < items1.size()) {
+            const uint32_t key = items0[i].key;
+            if (key < items1[j].key) {
+                i++;
+                continue;
+            }
+            if (items1[j].key < key) {
+                j++;
+                continue;
+            }
+
+            size_t i_end = i, j_end = j;
+            while (i_end < items0.size() && items0[i_end].key == key) {
+                i_end++;
+            }
+            while (j_end < items1.size() && items1[j_end].key == key) {
+                j_end++;
+            }
+            for (size_t a = i; a < i_end; a++) {
+                for (size_t b = is_same_list ? a + 1 : j; b < j_end; b++) {
+                    if (!items0[a].is_ghost || !items1[b].is_ghost) {
+                        add_pair(items0[a].id, items1[b].id, candidates);
+                    }
                 }
             }
+            i = i_end;
+            j = j_end;
+        }
+
+        // Pairs may share several cells
+        tbb::parallel_sort(
+            candidates.begin() + num_candidates, candidates.end());
+        candidates.erase(
+            std::unique(candidates.begin() + num_candidates, candidates.end()),
+            candidates.end());
+    }
+} // namespace
+
+void RigidBodyHashGrid::getVertexEdgePairs(
+    const Eigen::MatrixXi& edges,
+    std::vector<EdgeVertexCandidate>& ev_candidates,
+    const std::function<bool(size_t, size_t)>& can_collide) const
+{
+    get_pairs(
+        m_edge_items, m_vertex_items, ev_candidates,
+        [&](int ei, int vi, std::vector<EdgeVertexCandidate>& candidates) {
+            if (vi != edges(ei, 0) && vi != edges(ei, 1)
+                && (can_collide(vi, edges(ei, 0))
+                    || can_collide(vi, edges(ei, 1)))) {
+                candidates.emplace_back(ei, vi);
+            }
+        });
+}
+
+void RigidBodyHashGrid::getEdgeEdgePairs(
+    const Eigen::MatrixXi& edges,
+    std::vector<EdgeEdgeCandidate>& ee_candidates,
+    const std::function<bool(size_t, size_t)>& can_collide) const
+{
+    get_pairs(
+        m_edge_items, m_edge_items, ee_candidates,
+        [&](int eai, int ebi, std::vector<EdgeEdgeCandidate>& candidates) {
+            if (eai == ebi) {
+                return;
+            }
+            bool can_edges_collide = false;
+            for (int i = 0; i < 2; i++) {
+                for (int j = 0; j < 2; j++) {
+                    if (edges(eai, i) == edges(ebi, j)) {
+                        return; // Adjacent edges
+                    }
+                    can_edges_collide |=
+                        can_collide(edges(eai, i), edges(ebi, j));
+                }
+            }
+            if (can_edges_collide) {
+                candidates.emplace_back(
+                    std::min(eai, ebi), std::max(eai, ebi));
+            }
+        });
+}
+
+void RigidBodyHashGrid::getFaceVertexPairs(
+    const Eigen::MatrixXi& faces,
+    std::vector<FaceVertexCandidate>& fv_candidates,
+    const std::function<bool(size_t, size_t)>& can_collide) const
+{
+    get_pairs(
+        m_face_items, m_vertex_items, fv_candidates,
+        [&](int fi, int vi, std::vector<FaceVertexCandidate>& candidates) {
+            bool can_face_collide = false;
+            for (int i = 0; i < 3; i++) {
+                if (vi == faces(fi, i)) {
+                    return; // Vertex of the face
+                }
+                can_face_collide |= can_collide(vi, faces(fi, i));
+            }
+            if (can_face_collide) {
+                candidates.emplace_back(fi, vi);
+            }
         });
 }
 
@@ -1,6 +1,11 @@
 // A spatial hash grid for rigid bodies with angular trajectories.
 #pragma once
 
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include <ipc/broad_phase/collision_candidate.hpp>
 #include <ipc/broad_phase/hash_grid.hpp>
 
 #include <physics/rigid_body_assembler.hpp>
@@ -8,6 +13,12 @@
 namespace ipc::rigid {
 
 /// A spatial hash grid for rigid bodies with angular trajectories.
+///
+/// The grid has levels whose cells double in size. Every primitive is hashed
+/// into the cells of the level of its box's size, so large primitives cover
+/// a few cells and small ones do not share cells with many others. It is
+/// also hashed into the coarser levels as a ghost that is only paired with
+/// the primitives of that level.
 class RigidBodyHashGrid : public HashGrid {
 public:
     /// Resize to fit a static scene
@@ -40,15 +51,87 @@ public:
         const std::vector<std::pair<int, int>>& body_pairs,
         const double inflation_radius = 0.0);
 
+    /// Temporal subdivision depth of each body in the last addBodies
+    /// (0 for bodies that were not added or not subdivided).
+    const std::vector<int>& body_subdivision_depths() const
+    {
+        return m_body_subdivision_depths;
+    }
+
+    /// Bytes reserved by the items of the grid
+    size_t memory_bytes() const;
+
+    /// Find the edge-vertex pairs sharing a cell.
+    void getVertexEdgePairs(
+        const Eigen::MatrixXi& edges,
+        std::vector<EdgeVertexCandidate>& ev_candidates,
+        const std::function<bool(size_t, size_t)>& can_collide) const;
+
+    /// Find the edge-edge pairs sharing a cell.
+    void getEdgeEdgePairs(
+        const Eigen::MatrixXi& edges,
+        std::vector<EdgeEdgeCandidate>& ee_candidates,
+        const std::function<bool(size_t, size_t)>& can_collide) const;
+
+    /// Find the face-vertex pairs sharing a cell.
+    void getFaceVertexPairs(
+        const Eigen::MatrixXi& faces,
+        std::vector<FaceVertexCandidate>& fv_candidates,
+        const std::function<bool(size_t, size_t)>& can_collide) const;
+
+    /// Level (with cells 2^level times the finest ones) of a box.
+    int level(const AABB& aabb) const;
+
 protected:
+    /// Primitive in a cell of a level
+    struct LevelItem {
+        uint32_t key; ///< Hash of the level and the cell
+        int id;       ///< Primitive id
+        /// Is the primitive of a finer level?
+        bool is_ghost;
+    };
+
+    /// Box of a primitive
+    struct PrimitiveBox {
+        long id;
+        AABB aabb;
+    };
+
+    /// Replace the items by the primitives, each in its level and as a ghost
+    /// in the coarser levels up to the level of the largest primitive.
+    void insert_primitives(
+        const std::vector<PrimitiveBox>& vertex_boxes,
+        const std::vector<PrimitiveBox>& edge_boxes,
+        const std::vector<PrimitiveBox>& face_boxes);
+
+    /// Add a primitive to the cells of a level.
+    void add_element(
+        const AABB& aabb,
+        int id,
+        int level,
+        bool is_ghost,
+        std::vector<LevelItem>& items) const;
+
+    /// Remove all items and fit the grid to a box, keeping the current
+    /// dimensions if the box is inside the domain and the cell size is close.
+    void fit(
+        const VectorMax3d& min, const VectorMax3d& max, double cell_size);
+
+    /// Sort the items by cell and element with a radix sort.
+    void sort_items();
+
     void compute_vertices_intervals(
         const RigidBodyAssembler& bodies,
         const Poses<Interval>& poses_t0,
         const Poses<Interval>& poses_t1,
         const std::vector<int>& body_ids,
         MatrixXI& vertices,
-        double inflation_radius = 0.0) const;
+        double inflation_radius = 0.0);
 
+    /// Compute the vertices' intervals over t, bisecting t if they do not
+    /// fit the grid or (up to max_subdivision times) if the swept boxes are
+    /// too loose compared to the body's static box.
+    /// @return The depth of the subdivision.
     int compute_vertices_intervals(
         const RigidBody& body,
         const Pose<Interval>& pose_t0,
@@ -56,7 +139,23 @@ protected:
         MatrixXI& vertices,
         double inflation_radius = 0.0,
         const Interval& t = Interval(0, 1),
-        int force_subdivision = 0) const;
+        int force_subdivision = 0,
+        int max_subdivision = 0) const;
+
+    /// Are the swept vertex boxes loose enough to benefit from subdividing?
+    static bool are_vertices_intervals_loose(
+        const RigidBody& body,
+        const Pose<Interval>& pose,
+        const MatrixXI& vertices);
+
+    std::vector<int> m_body_subdivision_depths;
+
+    /// Items sorted by key
+    std::vector<LevelItem> m_vertex_items, m_edge_items, m_face_items;
+
+    /// Domain and cell size of the last re-dimensioning
+    VectorMax3d m_domain_min, m_domain_max;
+    double m_cell_size = 0;
 };
 
 } // namespace ipc::rigid
@@ -1,9 +1,57 @@
 #include "rigid_trajectory_aabb.hpp"
 
+#include <algorithm>
+
 namespace ipc::rigid {
 
 typedef Pose<Interval> PoseI;
 
+const TrajectoryPoseCache::Entry&
+TrajectoryPoseCache::entry(const Interval& t)
+{
+    const std::pair<double, double> key(t.lower(), t.upper());
+    auto it = m_entries.find(key);
+    if (it != m_entries.end()) {
+        return it->second;
+    }
+    if (m_entries.size() >= MAX_ENTRIES) {
+        m_entries.clear();
+    }
+    PoseI pose = PoseI::interpolate(m_pose_t0, m_pose_t1, t);
+    Entry& e = m_entries[key];
+    e.R = pose.construct_rotation_matrix();
+    e.p = pose.position;
+    return e;
+}
+
+VectorMax3I
+TrajectoryPoseCache::world_vertex(size_t vertex_id, const Interval& t)
+{
+    const Entry& e = entry(t);
+    return m_body.world_vertex(e.R, e.p, vertex_id);
+}
+
+TrajectoryPoseCache& BodyTrajectoryCaches::poses(long body_id)
+{
+    auto it = std::find_if(
+        m_caches.begin(), m_caches.end(),
+        [&](const auto& cache) { return cache.first == body_id; });
+    if (it != m_caches.end()) {
+        // Move it to the back, so the other body of the query survives
+        std::rotate(it, it + 1, m_caches.end());
+        return *m_caches.back().second;
+    }
+    if (m_caches.size() >= MAX_BODIES) {
+        m_caches.erase(m_caches.begin());
+    }
+    m_caches.emplace_back(
+        body_id,
+        std::make_unique<TrajectoryPoseCache>(
+            m_bodies[body_id], m_poses_t0[body_id].cast<Interval>(),
+            m_poses_t1[body_id].cast<Interval>()));
+    return *m_caches.back().second;
+}
+
 VectorMax3I vertex_trajectory_aabb(
     const RigidBody& body,
     const PoseI& pose_t0, // Pose of body at t=0
@@ -27,9 +75,11 @@ VectorMax3I edge_trajectory_aabb(
 {
     // Compute the pose at time t
     PoseI pose = PoseI::interpolate(pose_t0, pose_t1, t);
+    const MatrixMax3I R = pose.construct_rotation_matrix();
+    const VectorMax3I& p = pose.position;
     // Get the world vertex of the edges at time t
-    VectorMax3I e0 = body.world_vertex(pose, body.edges(edge_id, 0));
-    VectorMax3I e1 = body.world_vertex(pose, body.edges(edge_id, 1));
+    VectorMax3I e0 = body.world_vertex(R, p, body.edges(edge_id, 0));
+    VectorMax3I e1 = body.world_vertex(R, p, body.edges(edge_id, 1));
     return (e1 - e0) * alpha + e0;
 }
 
@@ -44,10 +94,12 @@ VectorMax3I face_trajectory_aabb(
 {
     // Compute the pose at time t
     PoseI pose = PoseI::interpolate(pose_t0, pose_t1, t);
+    const MatrixMax3I R = pose.construct_rotation_matrix();
+    const VectorMax3I& p = pose.position;
     // Get the world vertex of the edges at time t
-    VectorMax3I f0 = body.world_vertex(pose, body.faces(face_id, 0));
-    VectorMax3I f1 = body.world_vertex(pose, body.faces(face_id, 1));
-    VectorMax3I f2 = body.world_vertex(pose, body.faces(face_id, 2));
+    VectorMax3I f0 = body.world_vertex(R, p, body.faces(face_id, 0));
+    VectorMax3I f1 = body.world_vertex(R, p, body.faces(face_id, 1));
+    VectorMax3I f2 = body.world_vertex(R, p, body.faces(face_id, 2));
     return (f1 - f0) * u + (f2 - f0) * v + f0;
 }
 
@@ -101,4 +153,53 @@ VectorMax3I face_vertex_aabb(
         - face_trajectory_aabb(bodyB, poseB_t0, poseB_t1, face_id, t, u, v);
 }
 
+VectorMax3I edge_vertex_aabb(
+    TrajectoryPoseCache& posesA,
+    size_t vertex_id,
+    TrajectoryPoseCache& posesB,
+    size_t edge_id,
+    const Interval& t,
+    const Interval& alpha)
+{
+    const Eigen::MatrixXi& EB = posesB.body().edges;
+    VectorMax3I e0 = posesB.world_vertex(EB(edge_id, 0), t);
+    VectorMax3I e1 = posesB.world_vertex(EB(edge_id, 1), t);
+    return posesA.world_vertex(vertex_id, t) - ((e1 - e0) * alpha + e0);
+}
+
+VectorMax3I edge_edge_aabb(
+    TrajectoryPoseCache& posesA,
+    size_t edgeA_id,
+    TrajectoryPoseCache& posesB,
+    size_t edgeB_id,
+    const Interval& t,
+    const Interval& alpha,
+    const Interval& beta)
+{
+    const Eigen::MatrixXi& EA = posesA.body().edges;
+    const Eigen::MatrixXi& EB = posesB.body().edges;
+    VectorMax3I ea0 = posesA.world_vertex(EA(edgeA_id, 0), t);
+    VectorMax3I ea1 = posesA.world_vertex(EA(edgeA_id, 1), t);
+    VectorMax3I eb0 = posesB.world_vertex(EB(edgeB_id, 0), t);
+    VectorMax3I eb1 = posesB.world_vertex(EB(edgeB_id, 1), t);
+    return ((ea1 - ea0) * alpha + ea0) - ((eb1 - eb0) * beta + eb0);
+}
+
+VectorMax3I face_vertex_aabb(
+    TrajectoryPoseCache& posesA,
+    size_t vertex_id,
+    TrajectoryPoseCache& posesB,
+    size_t face_id,
+    const Interval& t,
+    const Interval& u,
+    const Interval& v)
+{
+    const Eigen::MatrixXi& FB = posesB.body().faces;
+    VectorMax3I f0 = posesB.world_vertex(FB(face_id, 0), t);
+    VectorMax3I f1 = posesB.world_vertex(FB(face_id, 1), t);
+    VectorMax3I f2 = posesB.world_vertex(FB(face_id, 2), t);
+    return posesA.world_vertex(vertex_id, t)
+        - ((f1 - f0) * u + (f2 - f0) * v + f0);
+}
+
 } // namespace ipc::rigid
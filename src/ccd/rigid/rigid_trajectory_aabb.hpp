@@ -1,10 +1,93 @@
 #pragma once
 
+#include <map>
+#include <memory>
+#include <utility>
+#include <vector>
+
 #include <interval/interval.hpp>
 #include <physics/rigid_body.hpp>
+#include <physics/rigid_body_assembler.hpp>
 
 namespace ipc::rigid {
 
+/// @brief Interval poses of a body's trajectory over time intervals.
+///
+/// The interval root finder revisits the same time interval while it bisects
+/// the other parameters of a query, so the interval rotation (and its
+/// trigonometry) is evaluated once per time interval instead of once per
+/// vertex of every primitive. This is not thread safe.
+class TrajectoryPoseCache {
+public:
+    TrajectoryPoseCache(
+        const RigidBody& body,
+        const Pose<Interval>& pose_t0,
+        const Pose<Interval>& pose_t1)
+        : m_body(body)
+        , m_pose_t0(pose_t0)
+        , m_pose_t1(pose_t1)
+    {
+    }
+
+    /// @brief World position of a vertex over the time interval t.
+    VectorMax3I world_vertex(size_t vertex_id, const Interval& t);
+
+    const RigidBody& body() const { return m_body; }
+    size_t size() const { return m_entries.size(); }
+
+    /// @brief Drop all entries once there are this many.
+    static constexpr size_t MAX_ENTRIES = 1024;
+
+protected:
+    struct Entry {
+        MatrixMax3I R; ///< @brief Rotation over the time interval
+        VectorMax3I p; ///< @brief Position over the time interval
+    };
+
+    const Entry& entry(const Interval& t);
+
+    const RigidBody& m_body;
+    Pose<Interval> m_pose_t0, m_pose_t1;
+    /// @brief Entries keyed on the bounds of the time interval.
+    std::map<std::pair<double, double>, Entry> m_entries;
+};
+
+/// @brief Trajectory pose caches of the bodies of one narrow phase.
+///
+/// Every primitive query of a body pair starts bisecting from the same time
+/// interval, so sharing the caches of the two bodies between the queries of
+/// a pair evaluates the interval rotation of each time interval once per
+/// pair instead of once per query. Only the most recently used bodies are
+/// kept, so the queries should be grouped by body pair. This is not thread
+/// safe.
+class BodyTrajectoryCaches {
+public:
+    BodyTrajectoryCaches(
+        const RigidBodyAssembler& bodies,
+        const PosesD& poses_t0,
+        const PosesD& poses_t1)
+        : m_bodies(bodies)
+        , m_poses_t0(poses_t0)
+        , m_poses_t1(poses_t1)
+    {
+    }
+
+    /// @brief Cache of a body's trajectory (valid until MAX_BODIES - 1 other
+    /// bodies are requested).
+    TrajectoryPoseCache& poses(long body_id);
+
+    /// @brief Number of bodies whose caches are kept.
+    static constexpr size_t MAX_BODIES = 4;
+
+protected:
+    const RigidBodyAssembler& m_bodies;
+    const PosesD& m_poses_t0;
+    const PosesD& m_poses_t1;
+    /// @brief Caches by body id from the least to the most recently used.
+    std::vector<std::pair<long, std::unique_ptr<TrajectoryPoseCache>>>
+        m_caches;
+};
+
 VectorMax3I vertex_trajectory_aabb(
     const RigidBody& body,
     const Pose<Interval>& pose_t0, // Pose of body at t=0
@@ -67,4 +150,32 @@ VectorMax3I face_vertex_aabb(
     const Interval& u = Interval(0, 1),
     const Interval& v = Interval(0, 1));
 
+// Same as above but reusing the cached poses of each body.
+
+VectorMax3I edge_vertex_aabb(
+    TrajectoryPoseCache& posesA, // Poses of the vertex's body
+    size_t vertex_id,            // In bodyA
+    TrajectoryPoseCache& posesB, // Poses of the edge's body
+    size_t edge_id,              // In bodyB
+    const Interval& t = Interval(0, 1),
+    const Interval& alpha = Interval(0, 1));
+
+VectorMax3I edge_edge_aabb(
+    TrajectoryPoseCache& posesA, // Poses of the first edge's body
+    size_t edgeA_id,             // In bodyA
+    TrajectoryPoseCache& posesB, // Poses of the second edge's body
+    size_t edgeB_id,             // In bodyB
+    const Interval& t = Interval(0, 1),
+    const Interval& alpha = Interval(0, 1),
+    const Interval& beta = Interval(0, 1));
+
+VectorMax3I face_vertex_aabb(
+    TrajectoryPoseCache& posesA, // Poses of the vertex's body
+    size_t vertex_id,            // In bodyA
+    TrajectoryPoseCache& posesB, // Poses of the triangle's body
+    size_t face_id,              // In bodyB
+    const Interval& t = Interval(0, 1),
+    const Interval& u = Interval(0, 1),
+    const Interval& v = Interval(0, 1));
+
 } // namespace ipc::rigid
@@ -0,0 +1,69 @@
+#include "speculative_ccd_candidates.hpp"
+
+#include <algorithm>
+#include <cassert>
+
+namespace ipc::rigid {
+
+void SpeculativeCCDCandidates::detect(
+    const RigidBodyAssembler& bodies,
+    const PosesD& poses,
+    const int collision_types,
+    const double inflation_radius,
+    const double max_displacement,
+    const DetectCandidates& detect_candidates)
+{
+    m_candidates.clear();
+    detect_candidates(inflation_radius + max_displacement, m_candidates);
+    m_dofs = PoseD::poses_to_dofs(poses);
+    m_collision_types = collision_types;
+    m_inflation_radius = inflation_radius;
+    m_max_displacement = max_displacement;
+}
+
+bool SpeculativeCCDCandidates::covers(
+    const RigidBodyAssembler& bodies,
+    const PosesD& poses_t0,
+    const PosesD& poses_t1,
+    const int collision_types,
+    const double inflation_radius) const
+{
+    if (m_max_displacement < 0 || m_collision_types != collision_types
+        || m_inflation_radius != inflation_radius
+        || poses_t0.size() != bodies.num_bodies()) {
+        return false;
+    }
+    // Only the trajectories from the detected poses are covered
+    const Eigen::VectorXd dofs_t0 = PoseD::poses_to_dofs(poses_t0);
+    if (m_dofs.size() != dofs_t0.size() || m_dofs != dofs_t0) {
+        return false;
+    }
+    return max_vertex_displacement(bodies, poses_t0, poses_t1)
+        <= m_max_displacement;
+}
+
+void SpeculativeCCDCandidates::clear()
+{
+    m_candidates.clear();
+    m_dofs.resize(0);
+    m_max_displacement = -1;
+}
+
+double SpeculativeCCDCandidates::max_vertex_displacement(
+    const RigidBodyAssembler& bodies,
+    const PosesD& poses_t0,
+    const PosesD& poses_t1)
+{
+    assert(poses_t0.size() == poses_t1.size());
+    double displacement = 0;
+    for (size_t i = 0; i < poses_t0.size(); i++) {
+        displacement = std::max(
+            displacement,
+            (poses_t1[i].position - poses_t0[i].position).norm()
+                + (poses_t1[i].rotation - poses_t0[i].rotation).norm()
+                    * bodies[i].r_max);
+    }
+    return displacement;
+}
+
+} // namespace ipc::rigid
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <functional>
+#include <vector>
+
+#include <Eigen/Core>
+
+#include <ipc/broad_phase/collision_candidate.hpp>
+
+#include <physics/pose.hpp>
+#include <physics/rigid_body_assembler.hpp>
+
+namespace ipc::rigid {
+
+/// @brief CCD candidates of every trajectory from a set of poses that moves
+/// no vertex further than a bound, detected before the trajectory is known.
+///
+/// The candidates are the pairs within the inflation radius grown by the
+/// bound at the start poses. A primitive that moves at most the bound stays
+/// inside its start box grown by the bound, so the candidates are a superset
+/// of the ones of any such trajectory. This lets the broad phase of the line
+/// search run while the linear solver computes the direction.
+class SpeculativeCCDCandidates {
+public:
+    /// @brief Detect candidates given the inflation radius.
+    typedef std::function<void(double, Candidates&)> DetectCandidates;
+
+    /// @brief Detect the candidates of the trajectories from poses that move
+    /// no vertex further than max_displacement.
+    void detect(
+        const RigidBodyAssembler& bodies,
+        const PosesD& poses,
+        const int collision_types,
+        const double inflation_radius,
+        const double max_displacement,
+        const DetectCandidates& detect_candidates);
+
+    /// @brief Are the candidates a superset of the ones of the trajectory?
+    bool covers(
+        const RigidBodyAssembler& bodies,
+        const PosesD& poses_t0,
+        const PosesD& poses_t1,
+        const int collision_types,
+        const double inflation_radius) const;
+
+    /// @brief Remove the candidates, so no trajectory is covered.
+    void clear();
+
+    const Candidates& candidates() const { return m_candidates; }
+
+    /// @brief Bound on the distance a vertex moves between two poses of a
+    /// body (‖Δp‖ + ‖Δθ‖ r_max, which also bounds the intermediate poses).
+    static double max_vertex_displacement(
+        const RigidBodyAssembler& bodies,
+        const PosesD& poses_t0,
+        const PosesD& poses_t1);
+
+protected:
+    Candidates m_candidates;
+    Eigen::VectorXd m_dofs;
+    int m_collision_types = 0;
+    double m_inflation_radius = -1;
+    double m_max_displacement = -1;
+};
+
+} // namespace ipc::rigid
@@ -1,11 +1,17 @@
 // Time-of-impact computation for rigid bodies with angular trajectories.
 #include "time_of_impact.hpp"
 
+#include <algorithm>
+#include <optional>
+#include <thread>
+#include <vector>
+
 // #define TIME_CCD_QUERIES
 #ifdef TIME_CCD_QUERIES
 #include <igl/Timer.h>
 #endif
 
+#include <ccd/ccd_query_stats.hpp>
 #include <ccd/rigid/rigid_trajectory_aabb.hpp>
 #include <geometry/distance.hpp>
 #include <geometry/intersection.hpp>
@@ -13,11 +19,87 @@
 #include <logger.hpp>
 #include <utils/eigen_ext.hpp>
 #include <utils/not_implemented_error.hpp>
+#include <utils/step_metrics.hpp>
 
 namespace ipc::rigid {
 
 typedef Pose<Interval> PoseI;
 
+/// Record the boxes a root finder examined and warn when it ran out of
+/// iterations and returned a conservative toi.
+inline void log_root_finder_budget(
+    CCDQueryType query_type, int num_iterations, bool is_budget_exceeded)
+{
+    CCDQueryStats::record_root_finder(query_type, num_iterations);
+    StepMetrics::add_count(
+        StepMetrics::ROOT_FINDER_BOXES, std::max(num_iterations, 0));
+    if (is_budget_exceeded) {
+        StepMetrics::add_count(StepMetrics::ROOT_FINDER_BUDGET_EXCEEDED);
+        spdlog::warn(
+            "query={} num_iterations={:d} failure=\"interval root finder "
+            "exceeded max_iterations\" failsafe=\"conservative toi\"",
+            CCDQueryStats::type_name(query_type), num_iterations);
+    }
+}
+
+/// Use the shared trajectory of a body or cache its own for this query.
+inline TrajectoryPoseCache& trajectory_poses(
+    TrajectoryPoseCache* shared_poses,
+    std::optional<TrajectoryPoseCache>& local_poses,
+    const RigidBody& body,
+    const Pose<double>& pose_t0,
+    const Pose<double>& pose_t1)
+{
+    if (shared_poses != nullptr) {
+        assert(&shared_poses->body() == &body);
+        return *shared_poses;
+    }
+    return local_poses.emplace(
+        body, pose_t0.cast<Interval>(), pose_t1.cast<Interval>());
+}
+
+/// Distance function whose roots are the parameters at which the primitives
+/// are at most minimum_separation_distance apart. With a positive separation,
+/// the box of the difference vector is replaced by the interval of its
+/// squared norm minus the squared separation, extended up to zero so any box
+/// reaching within the separation contains a root.
+template <typename Distance>
+inline auto separation_distance(
+    const Distance& distance, double minimum_separation_distance)
+{
+    return [&distance, minimum_separation_distance](
+               const VectorMax3I& params) -> VectorMax3I {
+        VectorMax3I d = distance(params);
+        if (minimum_separation_distance <= 0) {
+            return d;
+        }
+        Interval sqr_distance(0);
+        for (int i = 0; i < d.size(); i++) {
+            sqr_distance += boost::numeric::square(d(i));
+        }
+        const Interval gap = sqr_distance
+            - boost::numeric::square(Interval(minimum_separation_distance));
+        VectorMax3I y(1);
+        y(0) = Interval(gap.lower(), std::max(gap.upper(), 0.0));
+        return y;
+    };
+}
+
+#ifdef RIGID_IPC_WITH_BATCHED_ROOT_FINDER
+/// Evaluate a distance function on a batch of boxes.
+template <typename Distance> inline auto batch_distance(const Distance& distance)
+{
+    return [&distance](
+               const std::vector<VectorMax3I>& xs,
+               std::vector<VectorMax3I>& ys) {
+        ys.resize(xs.size());
+        for (size_t i = 0; i < xs.size(); i++) {
+            ys[i] = distance(xs[i]);
+        }
+    };
+}
+#endif
+
 ////////////////////////////////////////////////////////////////////////////////
 // Edge-Vertex
 
@@ -53,6 +135,147 @@ Eigen::Vector2d compute_edge_vertex_tolerance(
         Constants::RIGID_CCD_LENGTH_TOL / bodyB.edge_length(edge_id));
 }
 
+// Isolate the roots of the 2D edge-vertex distance in t with interval Newton
+// instead of bisecting (t, α) with the generic interval root finder
+#define USE_INTERVAL_NEWTON_EDGE_VERTEX_CCD
+
+#ifdef USE_INTERVAL_NEWTON_EDGE_VERTEX_CCD
+/// 2D cross product of interval vectors.
+inline Interval cross2(const VectorMax3I& a, const VectorMax3I& b)
+{
+    return a(0) * b(1) - a(1) * b(0);
+}
+
+/// Rotate a 2D interval vector by 90°, so that dR(θ)x/dθ = perp(R(θ)x).
+inline VectorMax3I perp(const VectorMax3I& a)
+{
+    VectorMax3I r(2);
+    r << -a(1), a(0);
+    return r;
+}
+
+/// @brief Earliest time of impact of a 2D rigid edge-vertex trajectory.
+///
+/// The vertex p is on the line of the edge [e₀, e₁] where
+/// f(t) = (e₁ - e₀) × (p - e₀) vanishes. The bodies translate and rotate at
+/// constant velocities, so f is a 1D trigonometric function of t with a
+/// closed-form derivative. Its roots are isolated by interval Newton steps in
+/// t alone (bisecting where f is not monotone), and a root is an impact if
+/// the vertex is also within the edge. The time intervals are searched
+/// earliest first, so the first impact found is the earliest one.
+///
+/// @param[out] toi_interval  Enclosure of the earliest time of impact.
+/// @returns True if there is an impact in [0, earliest_toi].
+bool edge_vertex_interval_newton(
+    TrajectoryPoseCache& posesA,  // Poses of the vertex's body
+    const Pose<double>& poseA_t0, // Pose of bodyA at t=0
+    const Pose<double>& poseA_t1, // Pose of bodyA at t=1
+    size_t vertex_id,             // In bodyA
+    TrajectoryPoseCache& posesB,  // Poses of the edge's body
+    const Pose<double>& poseB_t0, // Pose of bodyB at t=0
+    const Pose<double>& poseB_t1, // Pose of bodyB at t=1
+    size_t edge_id,               // In bodyB
+    double earliest_toi,
+    double toi_tolerance,
+    double relative_toi_tolerance,
+    Interval& toi_interval,
+    int& num_iterations,
+    bool& is_budget_exceeded)
+{
+    const long e0_id = posesB.body().edges(edge_id, 0);
+    const long e1_id = posesB.body().edges(edge_id, 1);
+
+    // Constant velocities of the trajectories (enclosing their rounding)
+    const VectorMax3I cA0 = poseA_t0.position.cast<Interval>();
+    const VectorMax3I cB0 = poseB_t0.position.cast<Interval>();
+    const VectorMax3I vA = poseA_t1.position.cast<Interval>() - cA0;
+    const VectorMax3I vB = poseB_t1.position.cast<Interval>() - cB0;
+    const Interval omegaA =
+        Interval(poseA_t1.rotation(0)) - Interval(poseA_t0.rotation(0));
+    const Interval omegaB =
+        Interval(poseB_t1.rotation(0)) - Interval(poseB_t0.rotation(0));
+
+    // Is the vertex possibly on the edge over t? If so, computes f'(t).
+    const auto is_root_possible = [&](const Interval& t, Interval* df) {
+        const VectorMax3I p = posesA.world_vertex(vertex_id, t);
+        const VectorMax3I e0 = posesB.world_vertex(e0_id, t);
+        const VectorMax3I d = posesB.world_vertex(e1_id, t) - e0;
+        const VectorMax3I q = p - e0;
+        const Interval alpha_numerator = q(0) * d(0) + q(1) * d(1);
+        if (!boost::numeric::zero_in(cross2(d, q))
+            || alpha_numerator.upper() < 0
+            || (alpha_numerator - d(0) * d(0) - d(1) * d(1)).lower() > 0) {
+            return false;
+        }
+        if (df != nullptr) {
+            const VectorMax3I dp = perp(p - cA0 - vA * t) * omegaA + vA;
+            const VectorMax3I de0 = perp(e0 - cB0 - vB * t) * omegaB + vB;
+            *df = cross2(perp(d) * omegaB, q) + cross2(d, dp - de0);
+        }
+        return true;
+    };
+    const auto f = [&](const Interval& t) {
+        const VectorMax3I e0 = posesB.world_vertex(e0_id, t);
+        return cross2(
+            posesB.world_vertex(e1_id, t) - e0,
+            posesA.world_vertex(vertex_id, t) - e0);
+    };
+
+    // Starting in contact needs a finer resolution of the time of impact
+    if (is_root_possible(Interval(0, toi_tolerance), nullptr)) {
+        toi_tolerance /= 1e2;
+    }
+
+    is_budget_exceeded = false;
+    std::vector<Interval> ts = { Interval(0, earliest_toi) };
+    for (num_iterations = 0; !ts.empty(); num_iterations++) {
+        if (num_iterations >= Constants::INTERVAL_ROOT_FINDER_MAX_ITERATIONS) {
+            is_budget_exceeded = true;
+            // Conservative time of impact of the remaining intervals
+            toi_interval = *std::min_element(
+                ts.begin(), ts.end(), [](const auto& a, const auto& b) {
+                    return a.lower() < b.lower();
+                });
+            return true;
+        }
+
+        Interval t = ts.back();
+        ts.pop_back();
+
+        Interval df;
+        if (!is_root_possible(t, &df)) {
+            continue;
+        }
+        if (width(t)
+            <= std::max(toi_tolerance, relative_toi_tolerance * t.lower())) {
+            toi_interval = t;
+            return true;
+        }
+
+        if (!boost::numeric::zero_in(df)) {
+            // f is monotone over t, so contract t to its only root
+            const Interval t_mid(boost::numeric::median(t));
+            const Interval newton = t_mid - f(t_mid) / df;
+            if (newton.lower() > t.upper() || newton.upper() < t.lower()) {
+                continue;
+            }
+            const Interval contracted = boost::numeric::intersect(t, newton);
+            if (width(contracted) <= 0.5 * width(t)) {
+                ts.push_back(contracted);
+                continue;
+            }
+            t = contracted;
+        }
+
+        // Search the earlier half first
+        const std::pair<Interval, Interval> halves = bisect(t);
+        ts.push_back(halves.second);
+        ts.push_back(halves.first);
+    }
+    return false;
+}
+#endif
+
 /// Find time-of-impact between two rigid bodies
 bool compute_edge_vertex_time_of_impact(
     const RigidBody& bodyA,       // Body of the vertex
@@ -65,24 +288,50 @@ bool compute_edge_vertex_time_of_impact(
     size_t edge_id,               // In bodyB
     double& toi,
     double earliest_toi, // Only search for collision in [0, earliest_toi]
-    double toi_tolerance)
+    double toi_tolerance,
+    TrajectoryPoseCache* shared_posesA,
+    TrajectoryPoseCache* shared_posesB,
+    bool find_any_root,
+    double relative_toi_tolerance,
+    double minimum_separation_distance)
 {
     int dim = bodyA.dim();
     assert(bodyB.dim() == dim);
     assert(dim == 2);
 
-    const PoseI poseIA_t0 = poseA_t0.cast<Interval>();
-    const PoseI poseIA_t1 = poseA_t1.cast<Interval>();
-
-    const PoseI poseIB_t0 = poseB_t0.cast<Interval>();
-    const PoseI poseIB_t1 = poseB_t1.cast<Interval>();
+    std::optional<TrajectoryPoseCache> local_posesA, local_posesB;
+    TrajectoryPoseCache& posesA = trajectory_poses(
+        shared_posesA, local_posesA, bodyA, poseA_t0, poseA_t1);
+    TrajectoryPoseCache& posesB = trajectory_poses(
+        shared_posesB, local_posesB, bodyB, poseB_t0, poseB_t1);
+
+#ifdef USE_INTERVAL_NEWTON_EDGE_VERTEX_CCD
+    if (minimum_separation_distance <= 0) {
+        // The earliest impact is the first one found, as is any impact
+        Interval toi_interval;
+        int num_iterations = 0;
+        bool is_budget_exceeded = false;
+        bool is_impacting = edge_vertex_interval_newton(
+            posesA, poseA_t0, poseA_t1, vertex_id, posesB, poseB_t0, poseB_t1,
+            edge_id, earliest_toi, toi_tolerance, relative_toi_tolerance,
+            toi_interval, num_iterations, is_budget_exceeded);
+        log_root_finder_budget(
+            CCDQueryType::EDGE_VERTEX, num_iterations, is_budget_exceeded);
+        toi = is_impacting ? toi_interval.lower()
+                           : std::numeric_limits<double>::infinity();
+        return is_impacting;
+    }
+#endif
 
-    const auto distance = [&](const VectorMax3I& params) {
+    // Separated impacts are only found by the generic root finder
+    const auto contact_distance = [&](const VectorMax3I& params) {
         assert(params.size() == 2);
         return edge_vertex_aabb(
-            bodyA, poseIA_t0, poseIA_t1, vertex_id, bodyB, poseIB_t0, poseIB_t1,
-            edge_id, /*t=*/params(0), /*alpha=*/params(1));
+            posesA, vertex_id, posesB, edge_id, /*t=*/params(0),
+            /*alpha=*/params(1));
     };
+    const auto distance =
+        separation_distance(contact_distance, minimum_separation_distance);
 
     Eigen::Vector2d tol = compute_edge_vertex_tolerance(
         bodyA, poseA_t0, poseA_t1, vertex_id, bodyB, poseB_t0, poseB_t1,
@@ -91,7 +340,22 @@ bool compute_edge_vertex_time_of_impact(
 
     VectorMax3I x0 = Vector2I(Interval(0, earliest_toi), Interval(0, 1));
     VectorMax3I toi_interval;
-    bool is_impacting = interval_root_finder(distance, x0, tol, toi_interval);
+    int num_iterations = 0;
+    bool is_budget_exceeded = false;
+#ifdef RIGID_IPC_WITH_BATCHED_ROOT_FINDER
+    bool is_impacting = interval_root_finder_batched(
+        batch_distance(distance), x0, tol, toi_interval,
+        Constants::INTERVAL_ROOT_FINDER_MAX_ITERATIONS, &num_iterations,
+        find_any_root, relative_toi_tolerance, &is_budget_exceeded);
+#else
+    bool is_impacting = interval_root_finder(
+        distance, x0, tol, toi_interval,
+        Constants::INTERVAL_ROOT_FINDER_MAX_ITERATIONS, &num_iterations,
+        find_any_root, /*search_in_parallel=*/false, relative_toi_tolerance,
+        &is_budget_exceeded);
+#endif
+    log_root_finder_budget(
+        CCDQueryType::EDGE_VERTEX, num_iterations, is_budget_exceeded);
 
     // Return a conservative time-of-impact
     toi = is_impacting ? toi_interval(0).lower()
@@ -166,20 +430,41 @@ bool compute_edge_edge_time_of_impact(
     size_t edgeB_id,              // In bodyB
     double& toi,
     double earliest_toi, // Only search for collision in [0, earliest_toi]
-    double toi_tolerance)
+    double toi_tolerance,
+    TrajectoryPoseCache* shared_posesA,
+    TrajectoryPoseCache* shared_posesB,
+    bool find_any_root,
+    double relative_toi_tolerance,
+    bool search_in_parallel,
+    double minimum_separation_distance)
 {
     assert(bodyA.dim() == 3 && bodyB.dim() == bodyA.dim());
 
-    const PoseI poseIA_t0 = poseA_t0.cast<Interval>();
-    const PoseI poseIA_t1 = poseA_t1.cast<Interval>();
-    const PoseI poseIB_t0 = poseB_t0.cast<Interval>();
-    const PoseI poseIB_t1 = poseB_t1.cast<Interval>();
-    const auto distance = [&](const VectorMax3I& params) {
+    std::optional<TrajectoryPoseCache> local_posesA, local_posesB;
+    TrajectoryPoseCache& posesA = trajectory_poses(
+        shared_posesA, local_posesA, bodyA, poseA_t0, poseA_t1);
+    TrajectoryPoseCache& posesB = trajectory_poses(
+        shared_posesB, local_posesB, bodyB, poseB_t0, poseB_t1);
+    const std::thread::id query_thread = std::this_thread::get_id();
+    const Pose<Interval> poseA_t0_I = poseA_t0.cast<Interval>();
+    const Pose<Interval> poseA_t1_I = poseA_t1.cast<Interval>();
+    const Pose<Interval> poseB_t0_I = poseB_t0.cast<Interval>();
+    const Pose<Interval> poseB_t1_I = poseB_t1.cast<Interval>();
+    const auto contact_distance = [&](const VectorMax3I& params) {
         assert(params.size() == 3);
+        if (std::this_thread::get_id() != query_thread) {
+            // The pose caches are only used by the thread of the query
+            return edge_edge_aabb(
+                bodyA, poseA_t0_I, poseA_t1_I, edgeA_id, //
+                bodyB, poseB_t0_I, poseB_t1_I, edgeB_id, //
+                /*t=*/params(0), /*alpha=*/params(1), /*beta=*/params(2));
+        }
         return edge_edge_aabb(
-            bodyA, poseIA_t0, poseIA_t1, edgeA_id, bodyB, poseIB_t0, poseIB_t1,
-            edgeB_id, /*t=*/params(0), /*alpha=*/params(1), /*beta=*/params(2));
+            posesA, edgeA_id, posesB, edgeB_id, /*t=*/params(0),
+            /*alpha=*/params(1), /*beta=*/params(2));
     };
+    const auto distance =
+        separation_distance(contact_distance, minimum_separation_distance);
 
     Eigen::Vector3d tol = compute_edge_edge_tolerance(
         bodyA, poseA_t0, poseA_t1, edgeA_id, //
@@ -194,7 +479,22 @@ bool compute_edge_edge_time_of_impact(
     VectorMax3I toi_interval;
     VectorMax3I x0 =
         Vector3I(Interval(0, earliest_toi), Interval(0, 1), Interval(0, 1));
-    bool is_impacting = interval_root_finder(distance, x0, tol, toi_interval);
+    int num_iterations = 0;
+    bool is_budget_exceeded = false;
+#ifdef RIGID_IPC_WITH_BATCHED_ROOT_FINDER
+    bool is_impacting = interval_root_finder_batched(
+        batch_distance(distance), x0, tol, toi_interval,
+        Constants::INTERVAL_ROOT_FINDER_MAX_ITERATIONS, &num_iterations,
+        find_any_root, relative_toi_tolerance, &is_budget_exceeded);
+#else
+    bool is_impacting = interval_root_finder(
+        distance, x0, tol, toi_interval,
+        Constants::INTERVAL_ROOT_FINDER_MAX_ITERATIONS, &num_iterations,
+        find_any_root, search_in_parallel, relative_toi_tolerance,
+        &is_budget_exceeded);
+#endif
+    log_root_finder_budget(
+        CCDQueryType::EDGE_EDGE, num_iterations, is_budget_exceeded);
 
 #ifdef TIME_CCD_QUERIES
     timer.stop();
@@ -234,8 +534,8 @@ Eigen::Vector3d compute_face_vertex_tolerance(
 
     // (f1 - f0) * u + (f2 - f0) * v + f0
     // u interpolates edge (f0, f1) and v interpolates edge (f1, f2)
-    size_t edge0_id = bodyB.mesh_selector.face_to_edge(face_id, 0);
-    size_t edge1_id = bodyB.mesh_selector.face_to_edge(face_id, 1);
+    size_t edge0_id = bodyB.mesh_selector().face_to_edge(face_id, 0);
+    size_t edge1_id = bodyB.mesh_selector().face_to_edge(face_id, 1);
 
     return Eigen::Vector3d(
         // Constants::RIGID_CCD_TOI_TOL / dl,
@@ -256,22 +556,41 @@ bool compute_face_vertex_time_of_impact(
     size_t face_id,               // In bodyB
     double& toi,
     double earliest_toi, // Only search for collision in [0, earliest_toi]
-    double toi_tolerance)
+    double toi_tolerance,
+    TrajectoryPoseCache* shared_posesA,
+    TrajectoryPoseCache* shared_posesB,
+    bool find_any_root,
+    double relative_toi_tolerance,
+    bool search_in_parallel,
+    double minimum_separation_distance)
 {
     assert(bodyA.dim() == 3 && bodyA.dim() == bodyB.dim());
 
-    const PoseI poseIA_t0 = poseA_t0.cast<Interval>();
-    const PoseI poseIA_t1 = poseA_t1.cast<Interval>();
-    const PoseI poseIB_t0 = poseB_t0.cast<Interval>();
-    const PoseI poseIB_t1 = poseB_t1.cast<Interval>();
-
-    const auto distance = [&](const VectorMax3I& params) {
+    std::optional<TrajectoryPoseCache> local_posesA, local_posesB;
+    TrajectoryPoseCache& posesA = trajectory_poses(
+        shared_posesA, local_posesA, bodyA, poseA_t0, poseA_t1);
+    TrajectoryPoseCache& posesB = trajectory_poses(
+        shared_posesB, local_posesB, bodyB, poseB_t0, poseB_t1);
+    const std::thread::id query_thread = std::this_thread::get_id();
+    const Pose<Interval> poseA_t0_I = poseA_t0.cast<Interval>();
+    const Pose<Interval> poseA_t1_I = poseA_t1.cast<Interval>();
+    const Pose<Interval> poseB_t0_I = poseB_t0.cast<Interval>();
+    const Pose<Interval> poseB_t1_I = poseB_t1.cast<Interval>();
+    const auto contact_distance = [&](const VectorMax3I& params) {
         assert(params.size() == 3);
+        if (std::this_thread::get_id() != query_thread) {
+            // The pose caches are only used by the thread of the query
+            return face_vertex_aabb(
+                bodyA, poseA_t0_I, poseA_t1_I, vertex_id, //
+                bodyB, poseB_t0_I, poseB_t1_I, face_id,   //
+                /*t=*/params(0), /*u=*/params(1), /*v=*/params(2));
+        }
         return face_vertex_aabb(
-            bodyA, poseIA_t0, poseIA_t1, vertex_id, //
-            bodyB, poseIB_t0, poseIB_t1, face_id,   //
+            posesA, vertex_id, posesB, face_id, //
             /*t=*/params(0), /*u=*/params(1), /*v=*/params(2));
     };
+    const auto distance =
+        separation_distance(contact_distance, minimum_separation_distance);
 
     const auto is_domain_valid = [&](const VectorMax3I& params) {
         const Interval &t = params[0], &u = params[1], &v = params[2];
@@ -292,8 +611,22 @@ bool compute_face_vertex_time_of_impact(
     VectorMax3I toi_interval;
     VectorMax3I x0 =
         Vector3I(Interval(0, earliest_toi), Interval(0, 1), Interval(0, 1));
-    bool is_impacting =
-        interval_root_finder(distance, is_domain_valid, x0, tol, toi_interval);
+    int num_iterations = 0;
+    bool is_budget_exceeded = false;
+#ifdef RIGID_IPC_WITH_BATCHED_ROOT_FINDER
+    bool is_impacting = interval_root_finder_batched(
+        batch_distance(distance), is_domain_valid, x0, tol, toi_interval,
+        Constants::INTERVAL_ROOT_FINDER_MAX_ITERATIONS, &num_iterations,
+        find_any_root, relative_toi_tolerance, &is_budget_exceeded);
+#else
+    bool is_impacting = interval_root_finder(
+        distance, is_domain_valid, x0, tol, toi_interval,
+        Constants::INTERVAL_ROOT_FINDER_MAX_ITERATIONS, &num_iterations,
+        find_any_root, search_in_parallel, relative_toi_tolerance,
+        &is_budget_exceeded);
+#endif
+    log_root_finder_budget(
+        CCDQueryType::FACE_VERTEX, num_iterations, is_budget_exceeded);
 
 #ifdef TIME_CCD_QUERIES
     timer.stop();
@@ -10,6 +10,8 @@
  */
 namespace ipc::rigid {
 
+class TrajectoryPoseCache;
+
 /// Find time-of-impact between two rigid bodies
 bool compute_edge_vertex_time_of_impact(
     const RigidBody& bodyA,
@@ -22,7 +24,16 @@ bool compute_edge_vertex_time_of_impact(
     size_t edge_id,                        // In bodyB
     double& toi,
     double earliest_toi = 1, // Only search for collision in [0, earliest_toi]
-    double toi_tolerance = Constants::RIGID_CCD_TOI_TOL);
+    double toi_tolerance = Constants::RIGID_CCD_TOI_TOL,
+    // Trajectories shared with other queries of the same bodies
+    TrajectoryPoseCache* posesA = nullptr,
+    TrajectoryPoseCache* posesB = nullptr,
+    // Any time of impact is returned instead of the earliest (yes/no queries)
+    bool find_any_root = false,
+    // A time of impact t only needs to be within this fraction of t
+    double relative_toi_tolerance = 0,
+    // Distance under which the primitives are impacting
+    double minimum_separation_distance = 0);
 
 /// Find time-of-impact between two rigid bodies
 bool compute_edge_edge_time_of_impact(
@@ -36,7 +47,19 @@ bool compute_edge_edge_time_of_impact(
     size_t edgeB_id,                       // In bodyB
     double& toi,
     double earliest_toi = 1, // Only search for collision in [0, earliest_toi]
-    double toi_tolerance = Constants::RIGID_CCD_TOI_TOL);
+    double toi_tolerance = Constants::RIGID_CCD_TOI_TOL,
+    // Trajectories shared with other queries of the same bodies
+    TrajectoryPoseCache* posesA = nullptr,
+    TrajectoryPoseCache* posesB = nullptr,
+    // Any time of impact is returned instead of the earliest (yes/no queries)
+    bool find_any_root = false,
+    // A time of impact t only needs to be within this fraction of t
+    double relative_toi_tolerance = 0,
+    // Long searches are split between threads (the root then depends on the
+    // scheduling)
+    bool search_in_parallel = true,
+    // Distance under which the primitives are impacting
+    double minimum_separation_distance = 0);
 
 /// Find time-of-impact between two rigid bodies
 bool compute_face_vertex_time_of_impact(
@@ -50,6 +73,18 @@ bool compute_face_vertex_time_of_impact(
     size_t face_id,                        // In bodyB
     double& toi,
     double earliest_toi = 1, // Only search for collision in [0, earliest_toi]
-    double toi_tolerance = Constants::RIGID_CCD_TOI_TOL);
+    double toi_tolerance = Constants::RIGID_CCD_TOI_TOL,
+    // Trajectories shared with other queries of the same bodies
+    TrajectoryPoseCache* posesA = nullptr,
+    TrajectoryPoseCache* posesB = nullptr,
+    // Any time of impact is returned instead of the earliest (yes/no queries)
+    bool find_any_root = false,
+    // A time of impact t only needs to be within this fraction of t
+    double relative_toi_tolerance = 0,
+    // Long searches are split between threads (the root then depends on the
+    // scheduling)
+    bool search_in_parallel = true,
+    // Distance under which the primitives are impacting
+    double minimum_separation_distance = 0);
 
 } // namespace ipc::rigid
@@ -0,0 +1,82 @@
+#include "toi_bound_cache.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#include <constants.hpp>
+
+namespace ipc::rigid {
+
+bool TOIBoundCache::map_to_subinterval(
+    const PosesD& poses_t0,
+    const PosesD& poses_t1,
+    const int collision_types,
+    const double minimum_separation_distance)
+{
+    if (m_dofs_t0.size() == 0 || collision_types != m_collision_types
+        || minimum_separation_distance != m_minimum_separation_distance) {
+        return false;
+    }
+    const Eigen::VectorXd dofs_t0 = PoseD::poses_to_dofs(poses_t0);
+    const Eigen::VectorXd dofs_t1 = PoseD::poses_to_dofs(poses_t1);
+    if (dofs_t0.size() != m_dofs_t0.size()) {
+        return false;
+    }
+
+    // Times (a, b) of the cached trajectory at the end poses of the query
+    const Eigen::VectorXd d = m_dofs_t1 - m_dofs_t0;
+    const double d_sqr_norm = d.squaredNorm();
+    double a = 0, b = 1;
+    if (d_sqr_norm > 0) {
+        a = (dofs_t0 - m_dofs_t0).dot(d) / d_sqr_norm;
+        b = (dofs_t1 - m_dofs_t0).dot(d) / d_sqr_norm;
+    }
+    if (!(0 <= a && a < b && b <= 1)) {
+        return false;
+    }
+    const double tol = Constants::TOI_BOUND_CACHE_LINE_TOL
+        * std::max(m_dofs_t0.lpNorm<Eigen::Infinity>(),
+                   m_dofs_t1.lpNorm<Eigen::Infinity>());
+    if ((dofs_t0 - (m_dofs_t0 + a * d)).lpNorm<Eigen::Infinity>() > tol
+        || (dofs_t1 - (m_dofs_t0 + b * d)).lpNorm<Eigen::Infinity>() > tol) {
+        return false;
+    }
+
+    for (TOIBound& bound : m_bounds) {
+        if (bound.toi <= a) {
+            bound = TOIBound(); // Unknown from a on
+            continue;
+        }
+        bound.toi = (bound.toi - a) / (b - a);
+        // An impact after the query is only a bound on [0, 1]
+        bound.is_impact &= bound.toi <= 1;
+    }
+    m_dofs_t0 = dofs_t0;
+    m_dofs_t1 = dofs_t1;
+    return true;
+}
+
+void TOIBoundCache::reset(
+    const PosesD& poses_t0,
+    const PosesD& poses_t1,
+    const int collision_types,
+    const double minimum_separation_distance,
+    const Candidates& candidates)
+{
+    m_dofs_t0 = PoseD::poses_to_dofs(poses_t0);
+    m_dofs_t1 = PoseD::poses_to_dofs(poses_t1);
+    m_collision_types = collision_types;
+    m_minimum_separation_distance = minimum_separation_distance;
+    m_candidates = candidates;
+    m_bounds.assign(candidates.size(), TOIBound());
+}
+
+void TOIBoundCache::clear()
+{
+    m_dofs_t0.resize(0);
+    m_dofs_t1.resize(0);
+    m_candidates.clear();
+    m_bounds.clear();
+}
+
+} // namespace ipc::rigid
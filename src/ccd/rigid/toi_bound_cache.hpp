@@ -0,0 +1,67 @@
+#pragma once
+
+#include <vector>
+
+#include <Eigen/Core>
+
+#include <ipc/broad_phase/collision_candidate.hpp>
+
+#include <physics/pose.hpp>
+
+namespace ipc::rigid {
+
+/// @brief What is known of the time of impact of a candidate.
+struct TOIBound {
+    /// @brief The candidate has no impact before this time.
+    double toi = 0;
+    /// @brief Is there an impact at toi (otherwise toi is only a bound)?
+    bool is_impact = false;
+
+    /// @brief Is the result of the query on [0, 1] known?
+    bool is_settled() const { return is_impact || toi >= 1; }
+};
+
+/// @brief Candidates and time-of-impact bounds of the last CCD query, reused
+/// by queries along a sub-interval of its trajectory.
+///
+/// Rigid trajectories interpolate the poses linearly, so when the end poses
+/// of a query lie on the cached trajectory its candidates are a subset of the
+/// cached ones and a candidate without an impact before a time of the cached
+/// trajectory has none before the same pose of the query.
+class TOIBoundCache {
+public:
+    /// @brief Map the bounds onto the trajectory from poses_t0 to poses_t1
+    /// if it is a sub-interval of the cached one.
+    /// @returns True if the cache now holds the given trajectory.
+    bool map_to_subinterval(
+        const PosesD& poses_t0,
+        const PosesD& poses_t1,
+        const int collision_types,
+        const double minimum_separation_distance);
+
+    /// @brief Cache the trajectory with its candidates and unknown bounds.
+    void reset(
+        const PosesD& poses_t0,
+        const PosesD& poses_t1,
+        const int collision_types,
+        const double minimum_separation_distance,
+        const Candidates& candidates);
+
+    /// @brief Remove the cached trajectory.
+    void clear();
+
+    const Candidates& candidates() const { return m_candidates; }
+
+    /// @brief Bounds of the candidates (indexed as [ev, ee, fv]).
+    std::vector<TOIBound>& bounds() { return m_bounds; }
+    const std::vector<TOIBound>& bounds() const { return m_bounds; }
+
+protected:
+    Eigen::VectorXd m_dofs_t0, m_dofs_t1;
+    int m_collision_types = 0;
+    double m_minimum_separation_distance = 0;
+    Candidates m_candidates;
+    std::vector<TOIBound> m_bounds;
+};
+
+} // namespace ipc::rigid
@@ -0,0 +1,75 @@
+#include "verlet_candidate_list.hpp"
+
+#include <profiler.hpp>
+
+namespace ipc::rigid {
+
+const Candidates& VerletCandidateList::update(
+    const RigidBodyAssembler& bodies,
+    const PosesD& poses,
+    const int collision_types,
+    const double inflation_radius,
+    const DetectCandidates& detect_candidates)
+{
+    if (!needs_rebuild(bodies, poses, collision_types, inflation_radius)) {
+        return m_candidates;
+    }
+
+    PROFILE_POINT("VerletCandidateList::update");
+    PROFILE_START();
+
+    m_slack = slack_scale * inflation_radius;
+    m_candidates.clear();
+    detect_candidates(inflation_radius + m_slack, m_candidates);
+
+    m_poses = poses;
+    m_rotations.resize(poses.size());
+    for (size_t i = 0; i < poses.size(); i++) {
+        m_rotations[i] = poses[i].construct_rotation_matrix();
+    }
+    m_collision_types = collision_types;
+    m_inflation_radius = inflation_radius;
+    m_num_rebuilds++;
+
+    PROFILE_END();
+
+    return m_candidates;
+}
+
+bool VerletCandidateList::needs_rebuild(
+    const RigidBodyAssembler& bodies,
+    const PosesD& poses,
+    const int collision_types,
+    const double inflation_radius) const
+{
+    if (m_poses.size() != bodies.num_bodies()
+        || m_poses.size() != poses.size()
+        || m_collision_types != collision_types
+        || m_inflation_radius != inflation_radius) {
+        return true;
+    }
+
+    // Two primitives farther than 2 (r + s) apart can only get within 2 r of
+    // each other if one of them moved more than the slack s. A vertex x =
+    // R v + p moved at most ‖p - p₀‖ + ‖R - R₀‖ r_max.
+    for (size_t i = 0; i < poses.size(); i++) {
+        const double displacement =
+            (poses[i].position - m_poses[i].position).norm()
+            + (poses[i].construct_rotation_matrix() - m_rotations[i]).norm()
+                * bodies[i].r_max;
+        if (displacement > m_slack) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void VerletCandidateList::clear()
+{
+    m_candidates.clear();
+    m_poses.clear();
+    m_rotations.clear();
+    m_inflation_radius = -1;
+}
+
+} // namespace ipc::rigid
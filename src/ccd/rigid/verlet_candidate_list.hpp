@@ -0,0 +1,73 @@
+#pragma once
+
+#include <functional>
+#include <vector>
+
+#include <Eigen/Core>
+
+#include <ipc/broad_phase/collision_candidate.hpp>
+
+#include <physics/pose.hpp>
+#include <physics/rigid_body_assembler.hpp>
+
+namespace ipc::rigid {
+
+/// @brief Superset of the collision candidates within an inflation radius
+/// (i.e., a Verlet list).
+///
+/// The candidates are detected with the radius grown by a slack. While no
+/// vertex moved more than the slack since, every pair of primitives within
+/// the inflation radius is in the superset and the broad phase can be
+/// skipped.
+class VerletCandidateList {
+public:
+    /// @param slack_scale Slack as a multiple of the inflation radius.
+    VerletCandidateList(const double slack_scale = 1.0)
+        : slack_scale(slack_scale)
+    {
+    }
+
+    /// @brief Detect candidates given the inflation radius.
+    typedef std::function<void(double, Candidates&)> DetectCandidates;
+
+    /// @brief Get the superset of the candidates at the poses, rebuilding it
+    /// only if a body moved too far.
+    const Candidates& update(
+        const RigidBodyAssembler& bodies,
+        const PosesD& poses,
+        const int collision_types,
+        const double inflation_radius,
+        const DetectCandidates& detect_candidates);
+
+    /// @brief Does the list have to be rebuilt for the poses?
+    bool needs_rebuild(
+        const RigidBodyAssembler& bodies,
+        const PosesD& poses,
+        const int collision_types,
+        const double inflation_radius) const;
+
+    /// @brief Remove the candidates, so the next update rebuilds the list.
+    void clear();
+
+    const Candidates& candidates() const { return m_candidates; }
+
+    /// @brief Number of times the broad phase was run.
+    size_t num_rebuilds() const { return m_num_rebuilds; }
+
+    /// @brief Slack as a multiple of the inflation radius.
+    double slack_scale;
+
+protected:
+    /// @brief Candidates within inflation_radius + slack of the poses.
+    Candidates m_candidates;
+    /// @brief Poses and rotations of the bodies when the list was built.
+    PosesD m_poses;
+    std::vector<MatrixMax3d> m_rotations;
+    int m_collision_types = 0;
+    double m_inflation_radius = -1;
+    /// @brief Maximum displacement of a vertex before a rebuild.
+    double m_slack = 0;
+    size_t m_num_rebuilds = 0;
+};
+
+} // namespace ipc::rigid
@@ -0,0 +1,204 @@
+#include "sweep_and_prune.hpp"
+
+#include <algorithm>
+#include <numeric>
+
+#include <tbb/enumerable_thread_specific.h>
+#include <tbb/parallel_for.h>
+#include <tbb/parallel_sort.h>
+
+#include <ccd/ccd.hpp>
+#include <profiler.hpp>
+
+namespace ipc::rigid {
+
+void SweepAndPrune::update(const std::vector<AABB>& boxes)
+{
+    const bool is_new = boxes.size() != m_boxes.size();
+    m_boxes = boxes; // Reuses the storage
+    m_num_swaps = 0;
+
+    if (is_new) {
+        choose_axis();
+        m_order.resize(m_boxes.size());
+        std::iota(m_order.begin(), m_order.end(), 0);
+        std::sort(m_order.begin(), m_order.end(), [&](int a, int b) {
+            return sweep_min(a) < sweep_min(b);
+        });
+        return;
+    }
+
+    // Insertion sort exploits the coherence of the order between updates.
+    const size_t max_swaps = MAX_SWAPS_PER_BOX * m_order.size();
+    for (size_t i = 1; i < m_order.size(); i++) {
+        const int id = m_order[i];
+        const double key = sweep_min(id);
+        size_t j = i;
+        for (; j > 0 && sweep_min(m_order[j - 1]) > key; j--) {
+            m_order[j] = m_order[j - 1];
+        }
+        m_order[j] = id;
+        m_num_swaps += i - j;
+
+        if (m_num_swaps > max_swaps) {
+            // The boxes moved too much, so it is faster to sort from scratch.
+            std::sort(m_order.begin(), m_order.end(), [&](int a, int b) {
+                return sweep_min(a) < sweep_min(b);
+            });
+            break;
+        }
+    }
+}
+
+void SweepAndPrune::find_overlapping_pairs(
+    const std::function<bool(int, int)>& can_collide,
+    std::vector<std::pair<int, int>>& pairs) const
+{
+    tbb::enumerable_thread_specific<std::vector<std::pair<int, int>>>
+        storages;
+
+    tbb::parallel_for(
+        tbb::blocked_range<size_t>(size_t(0), m_order.size()),
+        [&](const tbb::blocked_range<size_t>& range) {
+            auto& local_pairs = storages.local();
+            for (size_t k = range.begin(); k != range.end(); k++) {
+                const int i = m_order[k];
+                const double max_i = sweep_max(i);
+                for (size_t l = k + 1;
+                     l < m_order.size() && sweep_min(m_order[l]) <= max_i;
+                     l++) {
+                    const int j = m_order[l];
+                    if (!AABB::are_overlapping(m_boxes[i], m_boxes[j])) {
+                        continue;
+                    }
+                    const int a = std::min(i, j), b = std::max(i, j);
+                    if (can_collide(a, b)) {
+                        local_pairs.emplace_back(a, b);
+                    }
+                }
+            }
+        });
+
+    pairs.clear();
+    for (const auto& local_pairs : storages) {
+        pairs.insert(pairs.end(), local_pairs.begin(), local_pairs.end());
+    }
+    // Keep the order independent of the thread scheduling
+    tbb::parallel_sort(pairs.begin(), pairs.end());
+}
+
+void SweepAndPrune::clear()
+{
+    m_boxes.clear();
+    m_order.clear();
+    m_axis = 0;
+    m_num_swaps = 0;
+}
+
+void SweepAndPrune::choose_axis()
+{
+    m_axis = 0;
+    if (m_boxes.empty()) {
+        return;
+    }
+
+    const int dim = m_boxes[0].getMin().size();
+    Eigen::ArrayXd sum = Eigen::ArrayXd::Zero(dim);
+    Eigen::ArrayXd sum_squared = Eigen::ArrayXd::Zero(dim);
+    for (const AABB& box : m_boxes) {
+        Eigen::ArrayXd center = (box.getMin() + box.getMax()) / 2;
+        sum += center;
+        sum_squared += center.square();
+    }
+    const double n = m_boxes.size();
+    Eigen::ArrayXd variance = sum_squared / n - (sum / n).square();
+    variance.maxCoeff(&m_axis);
+}
+
+void detect_collision_candidates_sweep_and_prune(
+    const std::vector<AABB>& vertex_aabbs,
+    const Eigen::MatrixXi& edges,
+    const Eigen::MatrixXi& faces,
+    const Eigen::VectorXi& group_ids,
+    const int collision_types,
+    Candidates& candidates,
+    SweepAndPrune& sap)
+{
+    PROFILE_POINT("detect_collision_candidates_sweep_and_prune");
+    PROFILE_START();
+
+    const int num_vertices = vertex_aabbs.size();
+    const int num_edges = edges.rows();
+    const int num_faces = faces.rows();
+
+    // Boxes are ordered as vertices, then edges, then faces.
+    static thread_local std::vector<AABB> boxes;
+    boxes.resize(num_vertices + num_edges + num_faces);
+    std::copy(vertex_aabbs.begin(), vertex_aabbs.end(), boxes.begin());
+    for (int ei = 0; ei < num_edges; ei++) {
+        boxes[num_vertices + ei] =
+            AABB(vertex_aabbs[edges(ei, 0)], vertex_aabbs[edges(ei, 1)]);
+    }
+    for (int fi = 0; fi < num_faces; fi++) {
+        boxes[num_vertices + num_edges + fi] = AABB(
+            vertex_aabbs[faces(fi, 0)], vertex_aabbs[faces(fi, 1)],
+            vertex_aabbs[faces(fi, 2)]);
+    }
+
+    sap.update(boxes);
+
+    const bool build_ev = collision_types & CollisionType::EDGE_VERTEX;
+    const bool build_ee = collision_types & CollisionType::EDGE_EDGE;
+    const bool build_fv = collision_types & CollisionType::FACE_VERTEX;
+    const bool check_group = group_ids.size() > 0;
+    auto same_group = [&](int vi, int vj) {
+        return check_group && group_ids(vi) == group_ids(vj);
+    };
+
+    // a < b so the types are sorted as vertex, edge, face.
+    auto can_collide = [&](int a, int b) {
+        if (a < num_vertices) {
+            if (b < num_vertices) {
+                return false;
+            } else if (b < num_vertices + num_edges) {
+                const int ei = b - num_vertices;
+                return build_ev && a != edges(ei, 0) && a != edges(ei, 1)
+                    && !same_group(a, edges(ei, 0));
+            } else {
+                const int fi = b - num_vertices - num_edges;
+                return build_fv && a != faces(fi, 0) && a != faces(fi, 1)
+                    && a != faces(fi, 2) && !same_group(a, faces(fi, 0));
+            }
+        } else if (a < num_vertices + num_edges) {
+            if (b >= num_vertices + num_edges || !build_ee) {
+                return false;
+            }
+            const int ea = a - num_vertices, eb = b - num_vertices;
+            return edges(ea, 0) != edges(eb, 0) && edges(ea, 0) != edges(eb, 1)
+                && edges(ea, 1) != edges(eb, 0) && edges(ea, 1) != edges(eb, 1)
+                && !same_group(edges(ea, 0), edges(eb, 0));
+        }
+        return false;
+    };
+
+    static thread_local std::vector<std::pair<int, int>> pairs;
+    sap.find_overlapping_pairs(can_collide, pairs);
+
+    for (const auto& [a, b] : pairs) {
+        if (b < num_vertices + num_edges) {
+            if (a < num_vertices) {
+                candidates.ev_candidates.emplace_back(b - num_vertices, a);
+            } else {
+                candidates.ee_candidates.emplace_back(
+                    a - num_vertices, b - num_vertices);
+            }
+        } else {
+            candidates.fv_candidates.emplace_back(
+                b - num_vertices - num_edges, a);
+        }
+    }
+
+    PROFILE_END();
+}
+
+} // namespace ipc::rigid
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <functional>
+#include <utility>
+#include <vector>
+
+#include <Eigen/Core>
+
+#include <ipc/broad_phase/collision_candidate.hpp>
+#include <ipc/broad_phase/hash_grid.hpp>
+
+namespace ipc::rigid {
+
+/// @brief Incremental sort-and-sweep over axis-aligned bounding boxes.
+///
+/// The order of the boxes along the sweep axis is kept between updates and
+/// restored with an insertion sort. Coherent motion therefore costs close to
+/// linear time and needs no allocation once the storage has grown.
+class SweepAndPrune {
+public:
+    /// @brief Replace the boxes and restore the sorted order.
+    void update(const std::vector<AABB>& boxes);
+
+    /// @brief Find all pairs (i < j) of overlapping boxes.
+    void find_overlapping_pairs(
+        const std::function<bool(int, int)>& can_collide,
+        std::vector<std::pair<int, int>>& pairs) const;
+
+    /// @brief Forget the boxes and their order.
+    void clear();
+
+    size_t size() const { return m_boxes.size(); }
+    int axis() const { return m_axis; }
+    /// @brief Number of swaps done by the last update.
+    size_t num_swaps() const { return m_num_swaps; }
+
+    /// @brief Re-sort from scratch if the insertion sort needs more than this
+    /// many swaps per box.
+    static constexpr size_t MAX_SWAPS_PER_BOX = 32;
+
+protected:
+    double sweep_min(int i) const { return m_boxes[i].getMin()[m_axis]; }
+    double sweep_max(int i) const { return m_boxes[i].getMax()[m_axis]; }
+
+    /// @brief Choose the axis with the largest spread of box centers.
+    void choose_axis();
+
+    std::vector<AABB> m_boxes;
+    /// @brief Box ids sorted by their minimum along the sweep axis.
+    std::vector<int> m_order;
+    int m_axis = 0;
+    size_t m_num_swaps = 0;
+};
+
+/**
+ * @brief Use sweep and prune to create a set of all candidate collisions.
+ *
+ * @param[in] vertex_aabbs     World space (swept) box of each vertex.
+ * @param[in] edges            Edges as pairs of vertex indices.
+ * @param[in] faces            Faces as triplets of vertex indices.
+ * @param[in] group_ids        If two vertices share a group they are not
+ *                             considered possible collisions.
+ * @param[in] collision_types  Types of candidates to build.
+ * @param[out] candidates      Candidates to build.
+ * @param[in,out] sap          Persistent sweep state reused between calls.
+ */
+void detect_collision_candidates_sweep_and_prune(
+    const std::vector<AABB>& vertex_aabbs,
+    const Eigen::MatrixXi& edges,
+    const Eigen::MatrixXi& faces,
+    const Eigen::VectorXi& group_ids,
+    const int collision_types,
+    Candidates& candidates,
+    SweepAndPrune& sap);
+
+} // namespace ipc::rigid
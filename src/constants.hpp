@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstddef>
 #include <limits>
 
 namespace ipc::rigid {
@@ -31,6 +32,28 @@ namespace Constants {
     /// \brief Tolerance of the length of the rigid trajectory in CCD.
     static const double RIGID_CCD_TOI_TOL = 1e-4;
     static const double RIGID_CCD_LENGTH_TOL = 1e-4;
+    /// \brief Default fraction of itself to which the earliest time of impact
+    /// of a line search is resolved.
+    static const double DEFAULT_CCD_RELATIVE_TOI_TOLERANCE = 1e-2;
+
+    /// \brief Number of bins of the surface area heuristic of the body BVHs.
+    static const int BVH_SAH_NUM_BINS = 16;
+
+    /// \brief Weight of a new measurement in the running average cost of an
+    /// adaptively selected strategy (e.g., the AUTO detection method).
+    static const double STRATEGY_COST_SMOOTHING = 0.25;
+    /// \brief Number of selections between probes of the other strategies.
+    static const int STRATEGY_PROBE_PERIOD = 32;
+    /// \brief Largest number of bodies whose close pairs are ever found by
+    /// brute force.
+    static const int CLOSE_BODIES_MAX_BRUTE_FORCE_BODIES = 1000;
+    /// \brief Fewest static bodies merged into one world space hierarchy
+    /// (fewer are paired with the dynamic bodies like any other body).
+    static const int STATIC_WORLD_MIN_BODIES = 8;
+
+    /// \brief Relative distance of the end poses of a CCD query from the
+    /// cached trajectory below which it reuses the cached bounds.
+    static const double TOI_BOUND_CACHE_LINE_TOL = 1e-12;
 
     /// \brief Tolerance on the size of the range of the interval-based CCD.
     static const double INTERVAL_ROOT_FINDER_RANGE_TOL = 1e-8;
@@ -40,12 +63,172 @@ namespace Constants {
 
     /// \brief Default tolerance used for interval root finding.
     static const int INTERVAL_ROOT_FINDER_MAX_ITERATIONS = 10000;
+    /// \brief Number of boxes an interval root finder examines on its own
+    /// before splitting the rest of the search between threads.
+    static const int INTERVAL_ROOT_FINDER_PARALLEL_ITERATIONS = 1000;
+    /// \brief Number of boxes a task of the parallel interval root finder
+    /// bisects between giving a half to another thread.
+    static const int INTERVAL_ROOT_FINDER_PARALLEL_GRAIN = 64;
+    /// \brief Maximum number of boxes the batched interval root finder
+    /// evaluates in one call.
+    static const int INTERVAL_ROOT_FINDER_MAX_BATCH_SIZE = 256;
+
+    /// \brief Subdivide a body's time interval in the rigid hash grid when a
+    /// vertex's swept box is larger than this multiple of the body's static
+    /// box (beyond the box of the translation).
+    static const double RIGID_HASH_GRID_SUBDIVISION_RATIO = 0.5;
+    /// \brief Maximum adaptive subdivision depth of the rigid hash grid.
+    static const int RIGID_HASH_GRID_MAX_SUBDIVISION = 4;
+    /// \brief Number of levels of the rigid hash grid, each with cells twice
+    /// the size of the previous one.
+    static const int RIGID_HASH_GRID_NUM_LEVELS = 8;
+    /// \brief A reused rigid hash grid keeps its dimensions while the scene
+    /// fits its domain and the cell size changes by less than this fraction.
+    static const double RIGID_HASH_GRID_CELL_SIZE_TOLERANCE = 0.25;
+    /// \brief Fraction of the scene's extent added on every side of a
+    /// re-dimensioned rigid hash grid, so it fits the next time-steps.
+    static const double RIGID_HASH_GRID_DOMAIN_MARGIN = 0.25;
+
+    /// \brief Fraction of the provably safe step taken by conservative
+    /// advancement.
+    static const double CONSERVATIVE_ADVANCEMENT_STEP_SCALE = 0.9;
+    /// \brief Conservative advancement falls back to the interval root
+    /// finder once its steps are shorter than this (in time).
+    static const double CONSERVATIVE_ADVANCEMENT_MIN_STEP = 1e-2;
+    static const int CONSERVATIVE_ADVANCEMENT_MAX_ITERATIONS = 100;
+
+    /// \brief Maximum number of GJK iterations of convex body distances.
+    static const int GJK_MAX_ITERATIONS = 64;
+
+    /// \brief Default distance field band width in cells of the field.
+    static const double DISTANCE_FIELD_BAND_CELLS = 4.0;
 
     /// \brief Scaling of κ_min to better condition the system
     static const double DEFAULT_MIN_BARRIER_STIFFNESS_SCALE = 1e11;
 
+    /// \brief Smallest scale of d̂ of a body relative to the coarsest body
+    /// (see DistanceBarrierConstraint::per_body_activation_distance).
+    static const double MIN_ACTIVATION_DISTANCE_SCALE = 1e-2;
+
+    /// \brief Flat contact manifolds with more constraints than this are
+    /// reduced to representatives (see reduce_contact_manifolds()).
+    static const size_t CONTACT_MANIFOLD_MAX_SIZE = 8;
+    /// \brief Resolution of the unit normals grouping co-planar contacts.
+    static const double CONTACT_MANIFOLD_NORMAL_TOLERANCE = 1e-2;
+    /// \brief Number of in-plane directions whose support points are kept.
+    static const int CONTACT_MANIFOLD_SUPPORT_DIRECTIONS = 8;
+
+    /// \brief Slack in seconds of the end of a streamed kinematic motion
+    /// (the accumulated time-steps are inexact).
+    static const double KINEMATIC_SOURCE_TIME_TOLERANCE = 1e-9;
+
+    /// \brief κ is carried over between time-steps while the number of
+    /// active barriers changes by at most this fraction.
+    static const double DEFAULT_BARRIER_STIFFNESS_WARM_START_TOLERANCE = 0.5;
+
     // static const int MAXIMUM_FRICTION_ITERATIONS = 100;
 
+    /// \brief Number of recent objective values cached by the line search.
+    static const int LINE_SEARCH_OBJECTIVE_CACHE_SIZE = 8;
+
+    /// \brief Fraction of the earliest time of impact taken as the initial
+    /// step of an interpolating line search.
+    static const double LINE_SEARCH_TOI_SAFETY_FACTOR = 0.9;
+    /// \brief Interpolated step lengths are kept in [lo, hi] times the
+    /// previous trial step length.
+    static const double LINE_SEARCH_INTERPOLATION_MIN_SCALE = 0.1;
+    static const double LINE_SEARCH_INTERPOLATION_MAX_SCALE = 0.5;
+
+    /// \brief Armijo coefficient of the decrease required to keep reusing a
+    /// lagged Hessian factorization.
+    static const double LAGGED_HESSIAN_SUFFICIENT_DECREASE = 1e-4;
+    /// \brief Most colors of the constraints scattered in parallel into the
+    /// hessian (the constraints left over are scattered serially).
+    static const int HESSIAN_ASSEMBLY_MAX_COLORS = 64;
+
+    /// \brief Largest (and first) relative residual of an inexact Newton
+    /// direction.
+    static const double INEXACT_NEWTON_MAX_FORCING_TERM = 0.5;
+    /// \brief Scale γ and exponent α of the Eisenstat–Walker forcing terms
+    /// ηₖ = γ (‖∇fₖ‖ / ‖∇fₖ₋₁‖)^α.
+    static const double INEXACT_NEWTON_FORCING_SCALE = 0.9;
+    static const double INEXACT_NEWTON_FORCING_EXPONENT = 1.618033988749895;
+
+    /// \brief Maximum iterative refinement steps of a single-precision
+    /// factorization before falling back to double precision.
+    static const int MIXED_PRECISION_MAX_REFINEMENTS = 10;
+    /// \brief Relative residual at which the refinement stops.
+    static const double MIXED_PRECISION_REFINEMENT_TOL = 1e-12;
+    /// \brief Residual reduction under which the refinement has stalled.
+    static const double MIXED_PRECISION_STALL_RATIO = 0.5;
+
+    /// \brief Fraction of the TOI taken when a warm start would collide.
+    static const double WARM_START_TOI_SCALE = 0.8;
+
+    /// \brief Number of pending outputs before the simulation waits on I/O.
+    static const int ASYNC_IO_QUEUE_CAPACITY = 4;
+
+    /// \brief Number of trace events kept per thread (older ones are
+    /// overwritten).
+    static const size_t TRACE_BUFFER_CAPACITY = 1 << 16;
+
+    /// \brief Minimum predicted speedup from 16 to 32 threads of a phase that
+    /// still scales.
+    static const double SCALING_MIN_SPEEDUP_GAIN = 1.25;
+
+    /// \brief Number of bodies per parallel task of the time steppers.
+    static const size_t TIME_STEPPER_GRAIN_SIZE = 64;
+
+    /// \brief Estimated cost, relative to a linear query, above which a
+    /// narrow-phase query is scheduled before the cheap ones.
+    static const double NARROW_PHASE_EXPENSIVE_COST = 10;
+
+    /// \brief Number of CCD query records buffered per thread before they
+    /// are written to the query log.
+    static const size_t CCD_QUERY_LOG_BUFFER_SIZE = 4096;
+
+    /// \brief Number of frames whose poses are read before their OBJ files
+    /// are written in parallel.
+    static const size_t OBJ_EXPORT_BATCH_SIZE = 256;
+
+    /// \brief Largest subrange of a reduction of a deterministic simulation.
+    static const size_t DETERMINISTIC_GRAIN_SIZE = 64;
+
+    /// \brief Time of a chunk of a tuned parallel loop with the simple
+    /// partitioner (in seconds).
+    static const double PARALLEL_LOOP_TARGET_CHUNK_SECONDS = 50e-6;
+    /// \brief Fewest chunks per thread of a tuned parallel loop with the
+    /// simple partitioner.
+    static const size_t PARALLEL_LOOP_MIN_CHUNKS_PER_THREAD = 4;
+
+    /// \brief Number of narrow-phase queries sharing a time-of-impact bound
+    /// in a deterministic simulation.
+    static const size_t DETERMINISTIC_NARROW_PHASE_BATCH_SIZE = 256;
+
+    /// \brief Smallest buffer first touched in parallel (in bytes).
+    static const size_t FIRST_TOUCH_MIN_BYTES = 1 << 20;
+
+    /// \brief Size of a base page, the unit of NUMA placement (in bytes).
+    static const size_t FIRST_TOUCH_PAGE_BYTES = 4096;
+
+    /// \brief Size of a transparent huge page (in bytes).
+    static const size_t HUGE_PAGE_BYTES = 2 << 20;
+
+    /// \brief Number of recorded viewer frames waiting to be encoded after
+    /// which new frames are dropped.
+    static const size_t RECORDING_MAX_QUEUED_FRAMES = 64;
+
+    /// \brief Fewest faces (edges in 2D) of a body simplified for the viewer,
+    /// and the size of its coarsest proxy.
+    static const long VIEWER_LOD_MIN_PRIMITIVES = 256;
+
+    /// \brief Number of faces above which the viewer draws levels of detail
+    /// by default.
+    static const long VIEWER_LOD_SCENE_PRIMITIVES = 1 << 20;
+
+    /// \brief Screen area (in pixels) a face of a level of detail may cover.
+    static const double VIEWER_LOD_PIXELS_PER_PRIMITIVE = 16;
+
     // ------------------------------------------------------------------------
     // Debugging
     // ------------------------------------------------------------------------
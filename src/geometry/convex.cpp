@@ -0,0 +1,201 @@
+#include "convex.hpp"
+
+#include <algorithm>
+#include <map>
+#include <vector>
+
+#include <Eigen/Geometry>
+#include <Eigen/LU>
+
+#include <constants.hpp>
+
+namespace ipc::rigid {
+
+namespace {
+    /// @brief Is every vertex on one side of the hyperplane?
+    bool is_supporting_plane(
+        const Eigen::MatrixXd& vertices,
+        const Eigen::VectorXd& point,
+        const Eigen::VectorXd& normal,
+        double tolerance)
+    {
+        const Eigen::VectorXd signed_distances =
+            (vertices.rowwise() - point.transpose()) * normal;
+        return signed_distances.maxCoeff() <= tolerance
+            || signed_distances.minCoeff() >= -tolerance;
+    }
+} // namespace
+
+bool is_convex_mesh(
+    const Eigen::MatrixXd& vertices,
+    const Eigen::MatrixXi& edges,
+    const Eigen::MatrixXi& faces,
+    double relative_tolerance)
+{
+    const int dim = vertices.cols();
+    if (vertices.rows() < dim + 1) {
+        return false; // Lower dimensional (e.g., a single edge or triangle)
+    }
+    const double tolerance = relative_tolerance
+        * (vertices.colwise().maxCoeff() - vertices.colwise().minCoeff())
+              .norm();
+
+    if (dim == 2) {
+        std::vector<int> vertex_degrees(vertices.rows(), 0);
+        for (int i = 0; i < edges.rows(); i++) {
+            vertex_degrees[edges(i, 0)]++;
+            vertex_degrees[edges(i, 1)]++;
+        }
+        for (int degree : vertex_degrees) {
+            if (degree != 2) {
+                return false;
+            }
+        }
+        for (int i = 0; i < edges.rows(); i++) {
+            const Eigen::Vector2d e =
+                vertices.row(edges(i, 1)) - vertices.row(edges(i, 0));
+            if (e.norm() == 0) {
+                continue;
+            }
+            const Eigen::Vector2d normal = Eigen::Vector2d(-e.y(), e.x());
+            if (!is_supporting_plane(
+                    vertices, vertices.row(edges(i, 0)).transpose(),
+                    normal.normalized(), tolerance)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Every edge of a closed mesh is shared by exactly two faces and every
+    // vertex and edge is part of a face.
+    std::map<std::pair<int, int>, int> edge_face_counts;
+    std::vector<bool> is_face_vertex(vertices.rows(), false);
+    for (int i = 0; i < faces.rows(); i++) {
+        for (int j = 0; j < 3; j++) {
+            int a = faces(i, j), b = faces(i, (j + 1) % 3);
+            edge_face_counts[std::minmax(a, b)]++;
+            is_face_vertex[a] = true;
+        }
+    }
+    if (edge_face_counts.size() != edges.rows()
+        || std::find(is_face_vertex.begin(), is_face_vertex.end(), false)
+            != is_face_vertex.end()) {
+        return false;
+    }
+    for (const auto& el : edge_face_counts) {
+        if (el.second != 2) {
+            return false;
+        }
+    }
+
+    for (int i = 0; i < faces.rows(); i++) {
+        const Eigen::Vector3d v0 = vertices.row(faces(i, 0));
+        const Eigen::Vector3d normal =
+            (Eigen::Vector3d(vertices.row(faces(i, 1))) - v0)
+                .cross(Eigen::Vector3d(vertices.row(faces(i, 2))) - v0);
+        if (normal.norm() == 0) {
+            continue; // Degenerate faces do not define a plane
+        }
+        if (!is_supporting_plane(
+                vertices, v0, normal.normalized(), tolerance)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+namespace {
+    /// @brief Replace the simplex with its smallest subset containing the
+    /// closest point to the origin.
+    /// @returns The closest point of the simplex to the origin.
+    Eigen::Vector3d
+    reduce_to_closest_simplex(std::vector<Eigen::Vector3d>& simplex)
+    {
+        const int n = simplex.size();
+        Eigen::Vector3d closest_point = simplex[0];
+        int closest_subset = 1;
+
+        // The closest point is the affine projection of the origin onto the
+        // relative interior of one of the (at most 15) faces.
+        for (int subset = 1; subset < (1 << n); subset++) {
+            std::vector<Eigen::Vector3d> Q;
+            for (int i = 0; i < n; i++) {
+                if (subset & (1 << i)) {
+                    Q.push_back(simplex[i]);
+                }
+            }
+            const int k = Q.size() - 1;
+            Eigen::Vector3d point = Q[0];
+            if (k > 0) {
+                Eigen::MatrixXd G(k, k);
+                Eigen::VectorXd b(k);
+                for (int i = 0; i < k; i++) {
+                    for (int j = 0; j < k; j++) {
+                        G(i, j) = (Q[i + 1] - Q[0]).dot(Q[j + 1] - Q[0]);
+                    }
+                    b(i) = -(Q[i + 1] - Q[0]).dot(Q[0]);
+                }
+                Eigen::FullPivLU<Eigen::MatrixXd> lu(G);
+                if (lu.rank() < k) {
+                    continue; // Degenerate face
+                }
+                const Eigen::VectorXd alpha = lu.solve(b);
+                if ((alpha.array() <= 0).any() || alpha.sum() >= 1) {
+                    continue; // Not in the relative interior
+                }
+                for (int i = 0; i < k; i++) {
+                    point += alpha(i) * (Q[i + 1] - Q[0]);
+                }
+            }
+            if (point.squaredNorm() < closest_point.squaredNorm()) {
+                closest_point = point;
+                closest_subset = subset;
+            }
+        }
+
+        std::vector<Eigen::Vector3d> reduced_simplex;
+        for (int i = 0; i < n; i++) {
+            if (closest_subset & (1 << i)) {
+                reduced_simplex.push_back(simplex[i]);
+            }
+        }
+        simplex = reduced_simplex;
+        return closest_point;
+    }
+} // namespace
+
+double convex_distance_lower_bound(
+    const SupportFunction& support_a,
+    const SupportFunction& support_b,
+    double tolerance)
+{
+    // Minimize over the Minkowski difference A - B
+    const auto support = [&](const Eigen::Vector3d& d) -> Eigen::Vector3d {
+        return support_a(d) - support_b(-d);
+    };
+
+    Eigen::Vector3d v = support(Eigen::Vector3d::UnitX());
+    std::vector<Eigen::Vector3d> simplex = { v };
+    double lower_bound = 0;
+    for (int i = 0; i < Constants::GJK_MAX_ITERATIONS; i++) {
+        const double v_norm = v.norm();
+        if (v_norm <= tolerance) {
+            return 0;
+        }
+        // Every point of A - B is at least as far along v as w.
+        const Eigen::Vector3d w = support(-v);
+        lower_bound = std::max(lower_bound, v.dot(w) / v_norm);
+        if (v_norm - lower_bound <= tolerance) {
+            break;
+        }
+        simplex.push_back(w);
+        v = reduce_to_closest_simplex(simplex);
+        if (simplex.size() == 4) {
+            return 0; // The origin is inside the tetrahedron
+        }
+    }
+    return lower_bound;
+}
+
+} // namespace ipc::rigid
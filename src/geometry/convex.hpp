@@ -0,0 +1,36 @@
+#pragma once
+
+#include <functional>
+
+#include <Eigen/Core>
+
+namespace ipc::rigid {
+
+/// @brief Is the mesh the closed boundary of a convex polygon (2D) or
+/// polyhedron (3D)?
+///
+/// The mesh must be closed (every vertex of two edges in 2D, every edge of two
+/// faces in 3D) and the line or plane of every edge or face must have all
+/// vertices on one side (up to a tolerance relative to the mesh's size).
+bool is_convex_mesh(
+    const Eigen::MatrixXd& vertices,
+    const Eigen::MatrixXi& edges,
+    const Eigen::MatrixXi& faces,
+    double relative_tolerance = 1e-8);
+
+/// @brief Farthest point of a convex set in a direction (2D sets have z = 0).
+typedef std::function<Eigen::Vector3d(const Eigen::Vector3d&)>
+    SupportFunction;
+
+/// @brief Lower bound of the distance between two convex sets (GJK).
+///
+/// The bound is the gap between the sets along the best direction found, so
+/// it never exceeds the distance and is within the tolerance of it when GJK
+/// converges.
+/// @returns Zero if the sets intersect.
+double convex_distance_lower_bound(
+    const SupportFunction& support_a,
+    const SupportFunction& support_b,
+    double tolerance = 1e-8);
+
+} // namespace ipc::rigid
@@ -1,9 +1,14 @@
 #include "intersection.hpp"
 
+#include <cmath>
+#include <limits>
+
 #include <Eigen/Geometry>
 
 #include <igl/predicates/predicates.h>
+#include <igl/predicates/segment_segment_intersect.h>
 #include <ipc/friction/closest_point.hpp>
+#include <ipc/utils/intersection.hpp>
 
 #include <utils/is_zero.hpp>
 
@@ -65,4 +70,103 @@ bool is_point_inside_triangle(
                point, triangle_vertex2, triangle_vertex0, triangle_vertex1);
 }
 
+namespace {
+    // Error bounds of the orientation determinants relative to their
+    // permanents (Shewchuk, 1997), where epsilon = 2^-53.
+    const double EPSILON = 0.5 * std::numeric_limits<double>::epsilon();
+    const double ORIENT2D_ERROR_BOUND = (3.0 + 16.0 * EPSILON) * EPSILON;
+    const double ORIENT3D_ERROR_BOUND = (7.0 + 56.0 * EPSILON) * EPSILON;
+
+    int certified_sign(double det, double error_bound)
+    {
+        return det > error_bound ? 1 : (-det > error_bound ? -1 : 0);
+    }
+} // namespace
+
+int filtered_orient2d(
+    const Eigen::Vector2d& a,
+    const Eigen::Vector2d& b,
+    const Eigen::Vector2d& c)
+{
+    const double det_left = (a.x() - c.x()) * (b.y() - c.y());
+    const double det_right = (a.y() - c.y()) * (b.x() - c.x());
+    return certified_sign(
+        det_left - det_right,
+        ORIENT2D_ERROR_BOUND * (std::abs(det_left) + std::abs(det_right)));
+}
+
+int filtered_orient3d(
+    const Eigen::Vector3d& a,
+    const Eigen::Vector3d& b,
+    const Eigen::Vector3d& c,
+    const Eigen::Vector3d& d)
+{
+    const Eigen::Vector3d ad = a - d, bd = b - d, cd = c - d;
+
+    const double bdx_cdy = bd.x() * cd.y(), cdx_bdy = cd.x() * bd.y();
+    const double cdx_ady = cd.x() * ad.y(), adx_cdy = ad.x() * cd.y();
+    const double adx_bdy = ad.x() * bd.y(), bdx_ady = bd.x() * ad.y();
+
+    const double det = ad.z() * (bdx_cdy - cdx_bdy)
+        + bd.z() * (cdx_ady - adx_cdy) + cd.z() * (adx_bdy - bdx_ady);
+    const double permanent =
+        (std::abs(bdx_cdy) + std::abs(cdx_bdy)) * std::abs(ad.z())
+        + (std::abs(cdx_ady) + std::abs(adx_cdy)) * std::abs(bd.z())
+        + (std::abs(adx_bdy) + std::abs(bdx_ady)) * std::abs(cd.z());
+    return certified_sign(det, ORIENT3D_ERROR_BOUND * permanent);
+}
+
+bool are_segments_intersecting(
+    const Eigen::Vector2d& ea0,
+    const Eigen::Vector2d& ea1,
+    const Eigen::Vector2d& eb0,
+    const Eigen::Vector2d& eb1)
+{
+    const int o0 = filtered_orient2d(ea0, ea1, eb0);
+    const int o1 = filtered_orient2d(ea0, ea1, eb1);
+    // Edge b is strictly on one side of edge a's line
+    if (o0 != 0 && o0 == o1) {
+        return false;
+    }
+    const int o2 = filtered_orient2d(eb0, eb1, ea0);
+    const int o3 = filtered_orient2d(eb0, eb1, ea1);
+    if (o2 != 0 && o2 == o3) {
+        return false;
+    }
+    // Both edges strictly cross each other's lines
+    if (o0 * o1 < 0 && o2 * o3 < 0) {
+        return true;
+    }
+    return igl::predicates::segment_segment_intersect(ea0, ea1, eb0, eb1);
+}
+
+bool is_segment_intersecting_triangle(
+    const Eigen::Vector3d& e0,
+    const Eigen::Vector3d& e1,
+    const Eigen::Vector3d& t0,
+    const Eigen::Vector3d& t1,
+    const Eigen::Vector3d& t2)
+{
+    const int o0 = filtered_orient3d(t0, t1, t2, e0);
+    const int o1 = filtered_orient3d(t0, t1, t2, e1);
+    // The edge is strictly on one side of the triangle's plane
+    if (o0 != 0 && o0 == o1) {
+        return false;
+    }
+    // The edge strictly crosses the plane inside the triangle when it passes
+    // on the same side of the three triangle edges.
+    if (o0 * o1 < 0) {
+        const int s0 = filtered_orient3d(e0, e1, t0, t1);
+        const int s1 = filtered_orient3d(e0, e1, t1, t2);
+        const int s2 = filtered_orient3d(e0, e1, t2, t0);
+        if (s0 != 0 && s0 == s1 && s1 == s2) {
+            return true;
+        }
+        if (s0 * s1 < 0 || s1 * s2 < 0 || s2 * s0 < 0) {
+            return false;
+        }
+    }
+    return is_edge_intersecting_triangle(e0, e1, t0, t1, t2);
+}
+
 } // namespace ipc::rigid
@@ -26,4 +26,42 @@ bool is_point_inside_triangle(
     const Vector3I& t1,
     const Vector3I& t2);
 
+/// @brief Sign of igl::predicates::orient2d() certified by a floating-point
+/// filter with a static relative error bound.
+/// @returns +1 or -1 if certified, otherwise 0 (the sign is uncertain).
+int filtered_orient2d(
+    const Eigen::Vector2d& a,
+    const Eigen::Vector2d& b,
+    const Eigen::Vector2d& c);
+
+/// @brief Sign of igl::predicates::orient3d() certified by a floating-point
+/// filter with a static relative error bound.
+/// @returns +1 or -1 if certified, otherwise 0 (the sign is uncertain).
+int filtered_orient3d(
+    const Eigen::Vector3d& a,
+    const Eigen::Vector3d& b,
+    const Eigen::Vector3d& c,
+    const Eigen::Vector3d& d);
+
+/// @brief Exact 2D segment-segment intersection test.
+///
+/// Same result as igl::predicates::segment_segment_intersect(), but the exact
+/// predicates only run when the filtered ones cannot decide.
+bool are_segments_intersecting(
+    const Eigen::Vector2d& ea0,
+    const Eigen::Vector2d& ea1,
+    const Eigen::Vector2d& eb0,
+    const Eigen::Vector2d& eb1);
+
+/// @brief Exact 3D segment-triangle intersection test.
+///
+/// Same result as ipc::is_edge_intersecting_triangle(), but the exact
+/// predicates only run when the filtered ones cannot decide.
+bool is_segment_intersecting_triangle(
+    const Eigen::Vector3d& e0,
+    const Eigen::Vector3d& e1,
+    const Eigen::Vector3d& t0,
+    const Eigen::Vector3d& t1,
+    const Eigen::Vector3d& t2);
+
 } // namespace ipc::rigid
@@ -0,0 +1,124 @@
+#include "mesh_lod.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <map>
+#include <set>
+
+namespace ipc::rigid {
+
+namespace {
+    /// @brief Remap the rows of a simplex matrix, dropping the collapsed and
+    /// repeated simplices (the first of the repeated ones is kept).
+    Eigen::MatrixXi remap_simplices(
+        const Eigen::MatrixXi& simplices, const std::vector<int>& vertex_map)
+    {
+        Eigen::MatrixXi remapped(simplices.rows(), simplices.cols());
+        std::set<std::vector<int>> kept;
+        int num_kept = 0;
+        for (int i = 0; i < simplices.rows(); i++) {
+            std::vector<int> simplex(simplices.cols());
+            for (int j = 0; j < simplices.cols(); j++) {
+                simplex[j] = vertex_map[simplices(i, j)];
+            }
+            std::vector<int> key = simplex;
+            std::sort(key.begin(), key.end());
+            if (std::adjacent_find(key.begin(), key.end()) != key.end()
+                || !kept.insert(key).second) {
+                continue;
+            }
+            for (int j = 0; j < simplices.cols(); j++) {
+                remapped(num_kept, j) = simplex[j];
+            }
+            num_kept++;
+        }
+        remapped.conservativeResize(num_kept, simplices.cols());
+        return remapped;
+    }
+} // namespace
+
+MeshLOD simplify_mesh(
+    const Eigen::MatrixXd& vertices,
+    const Eigen::MatrixXi& edges,
+    const Eigen::MatrixXi& faces,
+    int resolution)
+{
+    MeshLOD lod;
+    if (vertices.rows() == 0) {
+        lod.vertices = vertices;
+        lod.edges = edges;
+        lod.faces = faces;
+        return lod;
+    }
+
+    const Eigen::RowVectorXd min = vertices.colwise().minCoeff();
+    const double longest = (vertices.colwise().maxCoeff() - min).maxCoeff();
+    resolution = std::max(resolution, 1);
+    const double cell_size = longest > 0 ? longest / resolution : 1;
+
+    std::map<std::array<long, 3>, int> cells;
+    std::vector<int> vertex_map(vertices.rows());
+    Eigen::MatrixXd sums(vertices.rows(), vertices.cols());
+    std::vector<int> counts;
+    for (int i = 0; i < vertices.rows(); i++) {
+        std::array<long, 3> cell = { { 0, 0, 0 } };
+        for (int j = 0; j < vertices.cols(); j++) {
+            cell[j] = std::min<long>(
+                long(std::floor((vertices(i, j) - min(j)) / cell_size)),
+                resolution - 1);
+        }
+        auto inserted = cells.emplace(cell, int(counts.size()));
+        const int cluster = inserted.first->second;
+        if (inserted.second) {
+            sums.row(cluster).setZero();
+            counts.push_back(0);
+        }
+        sums.row(cluster) += vertices.row(i);
+        counts[cluster]++;
+        vertex_map[i] = cluster;
+    }
+
+    lod.vertices.resize(counts.size(), vertices.cols());
+    for (int i = 0; i < lod.vertices.rows(); i++) {
+        lod.vertices.row(i) = sums.row(i) / counts[i];
+    }
+    lod.edges = remap_simplices(edges, vertex_map);
+    lod.faces = remap_simplices(faces, vertex_map);
+    return lod;
+}
+
+std::vector<MeshLOD> build_mesh_lods(
+    const Eigen::MatrixXd& vertices,
+    const Eigen::MatrixXi& edges,
+    const Eigen::MatrixXi& faces,
+    long min_primitives)
+{
+    const bool is_surface = faces.rows() > 0;
+    long num_primitives = is_surface ? faces.rows() : edges.rows();
+
+    // A grid of r×r cells over a surface leaves about 2r² faces and one of
+    // r cells over a curve about r edges, so halving r halves the edges and
+    // quarters the faces.
+    int resolution = is_surface ? int(std::sqrt(num_primitives / 2.0))
+                                : int(num_primitives);
+
+    std::vector<MeshLOD> lods;
+    while (num_primitives >= min_primitives && resolution >= 1) {
+        MeshLOD lod = simplify_mesh(vertices, edges, faces, resolution);
+        resolution /= 2;
+        const long lod_primitives = lod.num_primitives();
+        if (lod_primitives == 0) {
+            break;
+        }
+        // Skip grids too fine to simplify the previous level enough
+        if (2 * lod_primitives > num_primitives) {
+            continue;
+        }
+        num_primitives = lod_primitives;
+        lods.push_back(std::move(lod));
+    }
+    return lods;
+}
+
+} // namespace ipc::rigid
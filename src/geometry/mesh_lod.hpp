@@ -0,0 +1,47 @@
+#pragma once
+
+#include <vector>
+
+#include <Eigen/Core>
+
+namespace ipc::rigid {
+
+/// @brief A simplified proxy of a mesh used for drawing.
+struct MeshLOD {
+    Eigen::MatrixXd vertices;
+    Eigen::MatrixXi edges, faces;
+
+    /// @brief Number of primitives drawn (faces or, in 2D, edges).
+    long num_primitives() const
+    {
+        return faces.rows() ? faces.rows() : edges.rows();
+    }
+};
+
+/// @brief Simplify a mesh by merging the vertices in every cell of a grid.
+///
+/// Each merged vertex is the mean of its cell's vertices, and the edges and
+/// faces that collapse or repeat are removed. Works on any mesh (even
+/// non-manifold or disconnected ones).
+///
+/// @param resolution  Number of cells along the longest side of the mesh's
+///                    bounding box.
+MeshLOD simplify_mesh(
+    const Eigen::MatrixXd& vertices,
+    const Eigen::MatrixXi& edges,
+    const Eigen::MatrixXi& faces,
+    int resolution);
+
+/// @brief Proxies of a mesh, each with at most half of the primitives of the
+/// previous one (about a quarter of the faces in 3D).
+///
+/// The full mesh is not included. Meshes with fewer than min_primitives
+/// primitives have no proxies, and the last proxy is the first one under
+/// min_primitives.
+std::vector<MeshLOD> build_mesh_lods(
+    const Eigen::MatrixXd& vertices,
+    const Eigen::MatrixXi& edges,
+    const Eigen::MatrixXi& faces,
+    long min_primitives);
+
+} // namespace ipc::rigid
@@ -0,0 +1,159 @@
+#include "primitive_bvh.hpp"
+
+#include <algorithm>
+#include <limits>
+#include <numeric>
+
+#include <constants.hpp>
+
+namespace ipc::rigid {
+
+namespace {
+    /// @brief Surface area of a box (twice its area in 2D).
+    double surface_area(const Eigen::Vector3d& min, const Eigen::Vector3d& max)
+    {
+        const Eigen::Vector3d d = (max - min).cwiseMax(0);
+        return 2 * (d.x() * d.y() + d.y() * d.z() + d.z() * d.x());
+    }
+
+    struct Bin {
+        Eigen::Vector3d min = Eigen::Vector3d::Constant(INFINITY);
+        Eigen::Vector3d max = Eigen::Vector3d::Constant(-INFINITY);
+        int count = 0;
+
+        void extend(const std::array<Eigen::Vector3d, 2>& box)
+        {
+            min = min.cwiseMin(box[0]);
+            max = max.cwiseMax(box[1]);
+        }
+        void extend(const Bin& bin)
+        {
+            min = min.cwiseMin(bin.min);
+            max = max.cwiseMax(bin.max);
+            count += bin.count;
+        }
+    };
+} // namespace
+
+void PrimitiveBVH::init(
+    const std::vector<std::array<Eigen::Vector3d, 2>>& boxes)
+{
+    std::vector<Eigen::Vector3d> centers(boxes.size());
+    for (size_t i = 0; i < boxes.size(); i++) {
+        centers[i] = (boxes[i][0] + boxes[i][1]) / 2;
+    }
+
+    m_primitive_ids.resize(boxes.size());
+    std::iota(m_primitive_ids.begin(), m_primitive_ids.end(), 0);
+    m_nodes.clear();
+    if (!boxes.empty()) {
+        m_nodes.reserve(2 * boxes.size() - 1);
+        build(boxes, centers, 0, boxes.size());
+    }
+}
+
+int PrimitiveBVH::split(
+    const std::vector<std::array<Eigen::Vector3d, 2>>& boxes,
+    const std::vector<Eigen::Vector3d>& centers,
+    int begin,
+    int end)
+{
+    const int num_bins = Constants::BVH_SAH_NUM_BINS;
+    const auto first = m_primitive_ids.begin() + begin;
+    const auto last = m_primitive_ids.begin() + end;
+
+    Eigen::Vector3d min = centers[*first], max = min;
+    for (auto it = first; it != last; ++it) {
+        min = min.cwiseMin(centers[*it]);
+        max = max.cwiseMax(centers[*it]);
+    }
+
+    // Bin the centers along every axis and keep the split of lowest surface
+    // area heuristic cost.
+    double best_cost = std::numeric_limits<double>::infinity();
+    int best_axis = -1;
+    double best_position = 0;
+    for (int axis = 0; axis < 3; axis++) {
+        const double extent = max[axis] - min[axis];
+        if (!(extent > 0)) {
+            continue;
+        }
+        std::vector<Bin> bins(num_bins);
+        for (auto it = first; it != last; ++it) {
+            const int b = std::min(
+                int(num_bins * (centers[*it][axis] - min[axis]) / extent),
+                num_bins - 1);
+            bins[b].extend(boxes[*it]);
+            bins[b].count++;
+        }
+
+        // Cost of the left side of each split from a sweep
+        std::vector<double> left_costs(num_bins - 1);
+        Bin left;
+        for (int b = 0; b < num_bins - 1; b++) {
+            left.extend(bins[b]);
+            left_costs[b] = left.count == 0
+                ? 0
+                : left.count * surface_area(left.min, left.max);
+        }
+        Bin right;
+        for (int b = num_bins - 1; b > 0; b--) {
+            right.extend(bins[b]);
+            if (right.count == 0 || right.count == end - begin) {
+                continue;
+            }
+            const double cost = left_costs[b - 1]
+                + right.count * surface_area(right.min, right.max);
+            if (cost < best_cost) {
+                best_cost = cost;
+                best_axis = axis;
+                best_position = min[axis] + extent * b / num_bins;
+            }
+        }
+    }
+
+    int mid;
+    if (best_axis >= 0) {
+        mid = std::partition(
+                  first, last,
+                  [&](int i) {
+                      return centers[i][best_axis] < best_position;
+                  })
+            - m_primitive_ids.begin();
+    } else {
+        mid = begin; // Coincident centers
+    }
+
+    if (mid == begin || mid == end) {
+        // Split at the median of the longest axis
+        int axis;
+        (max - min).maxCoeff(&axis);
+        mid = (begin + end) / 2;
+        std::nth_element(
+            first, m_primitive_ids.begin() + mid, last, [&](int i, int j) {
+                return centers[i][axis] < centers[j][axis];
+            });
+    }
+    return mid;
+}
+
+int PrimitiveBVH::build(
+    const std::vector<std::array<Eigen::Vector3d, 2>>& boxes,
+    const std::vector<Eigen::Vector3d>& centers,
+    int begin,
+    int end)
+{
+    const int node_id = m_nodes.size();
+    m_nodes.push_back(Node { begin, end });
+    if (end - begin == 1) {
+        return node_id;
+    }
+
+    const int mid = split(boxes, centers, begin, end);
+    build(boxes, centers, begin, mid);
+    const int right = build(boxes, centers, mid, end);
+    m_nodes[node_id].right = right;
+    return node_id;
+}
+
+} // namespace ipc::rigid
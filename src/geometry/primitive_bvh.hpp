@@ -0,0 +1,86 @@
+#pragma once
+
+#include <array>
+#include <vector>
+
+#include <Eigen/Core>
+
+namespace ipc::rigid {
+
+/// @brief Binary bounding volume hierarchy over the primitives of a mesh
+/// whose boxes are refit for every query.
+///
+/// Only the topology is stored. It is built once from the body space boxes,
+/// and the boxes of the nodes are refit from the primitive boxes in the frame
+/// of a query, so the hierarchies of two bodies can be traversed together
+/// (see traverse()) once one is refit in the frame of the other.
+class PrimitiveBVH {
+public:
+    /// @brief Build the topology from the boxes (min, max) of the primitives
+    /// with binned surface area heuristic splits.
+    void init(const std::vector<std::array<Eigen::Vector3d, 2>>& boxes);
+
+    size_t num_primitives() const { return m_primitive_ids.size(); }
+    size_t num_nodes() const { return m_nodes.size(); }
+
+    /// @brief Refit the boxes of all nodes in place.
+    /// @param primitive_box Box of a primitive given its id.
+    /// @param node_boxes    Boxes of the nodes (storage reused).
+    template <typename Box, typename PrimitiveBox>
+    void refit(
+        const PrimitiveBox& primitive_box, std::vector<Box>& node_boxes) const;
+
+    /// @brief Visit the pairs of primitives of a and b whose boxes overlap,
+    /// pruning the pairs of nodes whose boxes do not.
+    /// @param visit Called with the ids of the primitives of a and b.
+    template <typename Box, typename Visit>
+    static void traverse(
+        const PrimitiveBVH& a,
+        const std::vector<Box>& a_boxes,
+        const PrimitiveBVH& b,
+        const std::vector<Box>& b_boxes,
+        const Visit& visit);
+
+    /// @brief Visit the primitives whose boxes pass a test, pruning the nodes
+    /// whose boxes do not.
+    /// @param boxes Boxes of the nodes (see refit()).
+    /// @param test  Called with the box of a node; false prunes the node.
+    /// @param visit Called with the id of a primitive.
+    template <typename Box, typename Test, typename Visit>
+    void query(
+        const std::vector<Box>& boxes,
+        const Test& test,
+        const Visit& visit) const;
+
+protected:
+    /// @brief Node of the primitives [begin, end) in preorder, so the left
+    /// child of an internal node directly follows it.
+    struct Node {
+        int begin, end;
+        int right = -1;
+
+        bool is_leaf() const { return end - begin == 1; }
+    };
+
+    int build(
+        const std::vector<std::array<Eigen::Vector3d, 2>>& boxes,
+        const std::vector<Eigen::Vector3d>& centers,
+        int begin,
+        int end);
+
+    /// @brief Reorder the primitives [begin, end) into the two children.
+    /// @returns The first primitive of the right child.
+    int split(
+        const std::vector<std::array<Eigen::Vector3d, 2>>& boxes,
+        const std::vector<Eigen::Vector3d>& centers,
+        int begin,
+        int end);
+
+    std::vector<Node> m_nodes;
+    /// @brief Ids of the primitives in the order of the leaves
+    std::vector<int> m_primitive_ids;
+};
+
+} // namespace ipc::rigid
+
+#include "primitive_bvh.tpp"
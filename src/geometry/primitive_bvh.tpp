@@ -0,0 +1,96 @@
+#pragma once
+
+#include "primitive_bvh.hpp"
+
+#include <cassert>
+
+namespace ipc::rigid {
+
+template <typename Box, typename PrimitiveBox>
+void PrimitiveBVH::refit(
+    const PrimitiveBox& primitive_box, std::vector<Box>& node_boxes) const
+{
+    node_boxes.resize(m_nodes.size());
+    // Children follow their parents, so visit the nodes backwards
+    for (int i = int(m_nodes.size()) - 1; i >= 0; i--) {
+        const Node& node = m_nodes[i];
+        node_boxes[i] = node.is_leaf()
+            ? Box(primitive_box(m_primitive_ids[node.begin]))
+            : Box(node_boxes[i + 1], node_boxes[node.right]);
+    }
+}
+
+template <typename Box, typename Visit>
+void PrimitiveBVH::traverse(
+    const PrimitiveBVH& a,
+    const std::vector<Box>& a_boxes,
+    const PrimitiveBVH& b,
+    const std::vector<Box>& b_boxes,
+    const Visit& visit)
+{
+    assert(a_boxes.size() == a.m_nodes.size());
+    assert(b_boxes.size() == b.m_nodes.size());
+    if (a.m_nodes.empty() || b.m_nodes.empty()) {
+        return;
+    }
+
+    static thread_local std::vector<std::array<int, 2>> stack;
+    stack.clear();
+    stack.push_back({ { 0, 0 } });
+    while (!stack.empty()) {
+        const auto [ai, bi] = stack.back();
+        stack.pop_back();
+        if (!Box::are_overlapping(a_boxes[ai], b_boxes[bi])) {
+            continue;
+        }
+
+        const Node& a_node = a.m_nodes[ai];
+        const Node& b_node = b.m_nodes[bi];
+        if (a_node.is_leaf() && b_node.is_leaf()) {
+            visit(
+                a.m_primitive_ids[a_node.begin],
+                b.m_primitive_ids[b_node.begin]);
+        } else if (
+            b_node.is_leaf()
+            || (!a_node.is_leaf()
+                && a_node.end - a_node.begin > b_node.end - b_node.begin)) {
+            // Descend the node with more primitives
+            stack.push_back({ { a_node.right, bi } });
+            stack.push_back({ { ai + 1, bi } });
+        } else {
+            stack.push_back({ { ai, b_node.right } });
+            stack.push_back({ { ai, bi + 1 } });
+        }
+    }
+}
+
+template <typename Box, typename Test, typename Visit>
+void PrimitiveBVH::query(
+    const std::vector<Box>& boxes, const Test& test, const Visit& visit) const
+{
+    assert(boxes.size() == m_nodes.size());
+    if (m_nodes.empty()) {
+        return;
+    }
+
+    static thread_local std::vector<int> stack;
+    stack.clear();
+    stack.push_back(0);
+    while (!stack.empty()) {
+        const int i = stack.back();
+        stack.pop_back();
+        if (!test(boxes[i])) {
+            continue;
+        }
+
+        const Node& node = m_nodes[i];
+        if (node.is_leaf()) {
+            visit(m_primitive_ids[node.begin]);
+        } else {
+            stack.push_back(node.right);
+            stack.push_back(i + 1);
+        }
+    }
+}
+
+} // namespace ipc::rigid
@@ -0,0 +1,242 @@
+#include "sparse_distance_field.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <istream>
+#include <ostream>
+#include <set>
+#include <vector>
+
+#include <tbb/enumerable_thread_specific.h>
+#include <tbb/parallel_for.h>
+
+#include <ipc/distance/point_edge.hpp>
+#include <ipc/distance/point_triangle.hpp>
+
+namespace ipc::rigid {
+
+namespace {
+    const int64_t NODE_INDEX_BITS = 21;
+    const int64_t NODE_INDEX_OFFSET = int64_t(1) << (NODE_INDEX_BITS - 1);
+} // namespace
+
+SparseDistanceField::SparseDistanceField(
+    const Eigen::MatrixXd& vertices,
+    const Eigen::MatrixXi& edges,
+    const Eigen::MatrixXi& faces,
+    double cell_size,
+    double band_width)
+    : m_dim(vertices.cols())
+    , m_cell_size(cell_size)
+    , m_band_width(band_width)
+{
+    assert(cell_size > 0 && band_width >= 0);
+
+    // Primitives as lists of vertex ids (faces, then the edges not on a face,
+    // then the vertices not on an edge).
+    std::vector<std::array<int, 3>> primitives;
+    std::vector<int> primitive_sizes;
+    std::set<std::pair<int, int>> face_edges;
+    std::vector<bool> is_edge_vertex(vertices.rows(), false);
+    for (int i = 0; i < faces.rows(); i++) {
+        primitives.push_back({ { faces(i, 0), faces(i, 1), faces(i, 2) } });
+        primitive_sizes.push_back(3);
+        for (int j = 0; j < 3; j++) {
+            face_edges.insert(std::minmax(faces(i, j), faces(i, (j + 1) % 3)));
+        }
+    }
+    for (int i = 0; i < edges.rows(); i++) {
+        is_edge_vertex[edges(i, 0)] = is_edge_vertex[edges(i, 1)] = true;
+        if (face_edges.count(std::minmax(edges(i, 0), edges(i, 1))) == 0) {
+            primitives.push_back({ { edges(i, 0), edges(i, 1), -1 } });
+            primitive_sizes.push_back(2);
+        }
+    }
+    for (int i = 0; i < vertices.rows(); i++) {
+        if (!is_edge_vertex[i]) {
+            primitives.push_back({ { i, -1, -1 } });
+            primitive_sizes.push_back(1);
+        }
+    }
+
+    const auto distance = [&](size_t pi, const VectorMax3d& x) -> double {
+        const std::array<int, 3>& p = primitives[pi];
+        switch (primitive_sizes[pi]) {
+        case 3:
+            return sqrt(point_triangle_distance(
+                Eigen::Vector3d(x), Eigen::Vector3d(vertices.row(p[0])),
+                Eigen::Vector3d(vertices.row(p[1])),
+                Eigen::Vector3d(vertices.row(p[2]))));
+        case 2:
+            return sqrt(point_edge_distance(
+                x, VectorMax3d(vertices.row(p[0])),
+                VectorMax3d(vertices.row(p[1]))));
+        default:
+            return (x - vertices.row(p[0]).transpose()).norm();
+        }
+    };
+
+    // Every node within the band of a primitive is inside its box grown by
+    // the band width, so nodes never visited are farther than the band.
+    typedef std::unordered_map<int64_t, double> NodeDistances;
+    tbb::enumerable_thread_specific<NodeDistances> storages;
+    tbb::parallel_for(size_t(0), primitives.size(), [&](size_t pi) {
+        NodeDistances& local_distances = storages.local();
+        NodeIndex min_index(m_dim), max_index(m_dim);
+        for (int k = 0; k < m_dim; k++) {
+            double min_x = INFINITY, max_x = -INFINITY;
+            for (int j = 0; j < primitive_sizes[pi]; j++) {
+                min_x = std::min(min_x, vertices(primitives[pi][j], k));
+                max_x = std::max(max_x, vertices(primitives[pi][j], k));
+            }
+            min_index(k) = int64_t(std::ceil((min_x - band_width) / cell_size));
+            max_index(k) =
+                int64_t(std::floor((max_x + band_width) / cell_size));
+        }
+
+        if ((min_index.array() > max_index.array()).any()) {
+            return; // No node in the grown box
+        }
+
+        NodeIndex index = min_index;
+        while (true) {
+            const double d = distance(pi, cell_size * index.cast<double>());
+            if (d < band_width) {
+                auto inserted = local_distances.emplace(key(index), d);
+                if (!inserted.second && d < inserted.first->second) {
+                    inserted.first->second = d;
+                }
+            }
+            // Odometer increment over the box of node indices
+            int k = 0;
+            while (k < m_dim && index(k) == max_index(k)) {
+                index(k) = min_index(k);
+                k++;
+            }
+            if (k == m_dim) {
+                break;
+            }
+            index(k)++;
+        }
+    });
+
+    for (const NodeDistances& local_distances : storages) {
+        for (const auto& node : local_distances) {
+            auto inserted = m_distances.insert(node);
+            if (!inserted.second && node.second < inserted.first->second) {
+                inserted.first->second = node.second;
+            }
+        }
+    }
+}
+
+int64_t SparseDistanceField::key(const NodeIndex& index)
+{
+    int64_t key = 0;
+    for (int k = 0; k < index.size(); k++) {
+        assert(std::abs(index(k)) < NODE_INDEX_OFFSET);
+        key = (key << NODE_INDEX_BITS) | (index(k) + NODE_INDEX_OFFSET);
+    }
+    return key;
+}
+
+double SparseDistanceField::node_distance(const NodeIndex& index) const
+{
+    const auto it = m_distances.find(key(index));
+    return it == m_distances.end() ? m_band_width : it->second;
+}
+
+double SparseDistanceField::distance_lower_bound(const VectorMax3d& point) const
+{
+    assert(point.size() == m_dim);
+    const NodeIndex base =
+        (point / m_cell_size).array().floor().cast<int64_t>();
+
+    // The distance at x is at least the distance at a node minus |x - node|
+    double lower_bound = 0;
+    for (int corner = 0; corner < (1 << m_dim); corner++) {
+        NodeIndex index = base;
+        for (int k = 0; k < m_dim; k++) {
+            index(k) += (corner >> k) & 1;
+        }
+        lower_bound = std::max(
+            lower_bound,
+            node_distance(index)
+                - (point - m_cell_size * index.cast<double>()).norm());
+    }
+    return lower_bound;
+}
+
+double SparseDistanceField::distance(
+    const VectorMax3d& point, VectorMax3d& gradient) const
+{
+    assert(point.size() == m_dim);
+    const VectorMax3d x = point / m_cell_size;
+    const NodeIndex base = x.array().floor().cast<int64_t>();
+    const VectorMax3d t = x - base.cast<double>();
+
+    // Multilinear interpolation of the corners of the cell
+    double distance = 0;
+    gradient.setZero(m_dim);
+    for (int corner = 0; corner < (1 << m_dim); corner++) {
+        NodeIndex index = base;
+        double weight = 1;
+        VectorMax3d weight_gradient = VectorMax3d::Ones(m_dim);
+        for (int k = 0; k < m_dim; k++) {
+            const bool is_upper = (corner >> k) & 1;
+            index(k) += is_upper;
+            const double w = is_upper ? t(k) : 1 - t(k);
+            for (int l = 0; l < m_dim; l++) {
+                weight_gradient(l) *= l == k ? (is_upper ? 1 : -1) : w;
+            }
+            weight *= w;
+        }
+        const double d = node_distance(index);
+        distance += weight * d;
+        gradient += d * weight_gradient;
+    }
+    gradient /= m_cell_size;
+    return distance;
+}
+
+bool SparseDistanceField::write(std::ostream& out) const
+{
+    const int32_t dim = m_dim;
+    const uint64_t num_nodes = m_distances.size();
+    out.write(reinterpret_cast<const char*>(&dim), sizeof(dim));
+    out.write(reinterpret_cast<const char*>(&m_cell_size), sizeof(double));
+    out.write(reinterpret_cast<const char*>(&m_band_width), sizeof(double));
+    out.write(reinterpret_cast<const char*>(&num_nodes), sizeof(num_nodes));
+    for (const auto& node : m_distances) {
+        out.write(reinterpret_cast<const char*>(&node.first), sizeof(int64_t));
+        out.write(reinterpret_cast<const char*>(&node.second), sizeof(double));
+    }
+    return bool(out);
+}
+
+bool SparseDistanceField::read(std::istream& in)
+{
+    int32_t dim;
+    uint64_t num_nodes;
+    in.read(reinterpret_cast<char*>(&dim), sizeof(dim));
+    in.read(reinterpret_cast<char*>(&m_cell_size), sizeof(double));
+    in.read(reinterpret_cast<char*>(&m_band_width), sizeof(double));
+    in.read(reinterpret_cast<char*>(&num_nodes), sizeof(num_nodes));
+    if (!in || (dim != 2 && dim != 3) || !(m_cell_size > 0)) {
+        return false;
+    }
+    m_dim = dim;
+    m_distances.clear();
+    m_distances.reserve(num_nodes);
+    for (uint64_t i = 0; i < num_nodes && in; i++) {
+        int64_t node_key;
+        double distance;
+        in.read(reinterpret_cast<char*>(&node_key), sizeof(node_key));
+        in.read(reinterpret_cast<char*>(&distance), sizeof(distance));
+        m_distances.emplace(node_key, distance);
+    }
+    return bool(in);
+}
+
+} // namespace ipc::rigid
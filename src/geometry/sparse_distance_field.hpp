@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstdint>
+#include <iosfwd>
+#include <unordered_map>
+
+#include <Eigen/Core>
+
+#include <utils/eigen_ext.hpp>
+
+namespace ipc::rigid {
+
+/// @brief Narrow-band unsigned distance field of a mesh sampled on the nodes
+/// of a sparse regular grid (2D or 3D).
+///
+/// Only nodes closer than the band width to the mesh are stored; every other
+/// node is at least the band width away. Distances are exact at the nodes,
+/// so the 1-Lipschitz continuity of the distance gives a conservative lower
+/// bound anywhere in space.
+class SparseDistanceField {
+public:
+    SparseDistanceField() {}
+
+    /// @brief Sample the distance to the faces, the edges not on a face, and
+    /// the vertices not on an edge.
+    /// @param cell_size   Spacing of the grid nodes.
+    /// @param band_width  Largest stored distance.
+    SparseDistanceField(
+        const Eigen::MatrixXd& vertices,
+        const Eigen::MatrixXi& edges,
+        const Eigen::MatrixXi& faces,
+        double cell_size,
+        double band_width);
+
+    /// @brief Lower bound of the distance from a point to the mesh.
+    double distance_lower_bound(const VectorMax3d& point) const;
+
+    /// @brief Interpolated distance (clamped to the band width) and its
+    /// gradient at a point.
+    double distance(const VectorMax3d& point, VectorMax3d& gradient) const;
+
+    int dim() const { return m_dim; }
+    double cell_size() const { return m_cell_size; }
+    double band_width() const { return m_band_width; }
+    /// @brief Number of nodes in the band.
+    size_t num_nodes() const { return m_distances.size(); }
+
+    /// @brief Write the field in a binary format.
+    bool write(std::ostream& out) const;
+    /// @brief Read a field written by write().
+    bool read(std::istream& in);
+
+protected:
+    typedef Eigen::Matrix<int64_t, Eigen::Dynamic, 1, Eigen::ColMajor, 3, 1>
+        NodeIndex;
+
+    /// @brief Key of a node packing 21 bits of each index.
+    static int64_t key(const NodeIndex& index);
+
+    /// @brief Distance at a node (the band width if it is not stored).
+    double node_distance(const NodeIndex& index) const;
+
+    int m_dim = 0;
+    double m_cell_size = 1;
+    double m_band_width = 0;
+    /// @brief Distances of the nodes in the band keyed on key().
+    std::unordered_map<int64_t, double> m_distances;
+};
+
+} // namespace ipc::rigid
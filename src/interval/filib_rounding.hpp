@@ -1,5 +1,8 @@
 #pragma once
 
+#include <cmath>
+#include <limits>
+
 #include <boost/numeric/interval.hpp>
 
 namespace ipc::rigid {
@@ -70,4 +73,36 @@ struct FILibRounding : boost::numeric::interval_lib::rounding_control<double> {
     }
 };
 
+/// @brief FILib rounding that never changes the hardware rounding mode.
+///
+/// FILib rounds by stepping to the neighbouring floating-point number, but
+/// the conversions, the median, and the rounding to integers (e.g., of the
+/// argument reduction of cos and sin) set the rounding mode. These are
+/// replaced with ones exact or conservative in round-to-nearest, which makes
+/// it safe to use without saving and restoring the rounding mode on every
+/// operation.
+struct FILibFixedRounding : FILibRounding {
+    /// @brief Midpoint of two numbers (only needs to lie between them).
+    double median(double x, double y) { return (x + y) / 2; }
+
+    /// @brief Round to an integer (exact in any rounding mode).
+    double int_down(double x) { return std::floor(x); }
+    double int_up(double x) { return std::ceil(x); }
+
+    template <typename T> double conv_down(const T& x)
+    {
+        double r = static_cast<double>(x);
+        return T(r) == x
+            ? r
+            : std::nextafter(r, -std::numeric_limits<double>::infinity());
+    }
+    template <typename T> double conv_up(const T& x)
+    {
+        double r = static_cast<double>(x);
+        return T(r) == x
+            ? r
+            : std::nextafter(r, std::numeric_limits<double>::infinity());
+    }
+};
+
 } // namespace ipc::rigid
@@ -5,8 +5,17 @@
 
 #include <boost/numeric/interval.hpp>
 
+// The backend is selected with RIGID_IPC_INTERVAL_BACKEND in CMake. Without
+// it, use filib rounding.
+#if !defined(RIGID_IPC_INTERVAL_BACKEND_FILIB)                                 \
+    && !defined(RIGID_IPC_INTERVAL_BACKEND_FILIB_FIXED)                        \
+    && !defined(RIGID_IPC_INTERVAL_BACKEND_BOOST)
+#define RIGID_IPC_INTERVAL_BACKEND_FILIB
+#endif
+
+#if defined(RIGID_IPC_INTERVAL_BACKEND_FILIB)                                  \
+    || defined(RIGID_IPC_INTERVAL_BACKEND_FILIB_FIXED)
 #define USE_FILIB_INTERVALS
-#ifdef USE_FILIB_INTERVALS
 #include <interval/filib_rounding.hpp>
 #endif
 
@@ -17,43 +26,50 @@ namespace ipc::rigid {
 namespace interval_options {
     typedef boost::numeric::interval_lib::checking_catch_nan<double>
         CheckingPolicy;
-} // namespace interval_options
 
 #ifdef USE_FILIB_INTERVALS
+    /// @brief Filib rounding arithmetic.
+    typedef boost::numeric::interval_lib::save_state<FILibRounding>
+        FILibRoundingPolicy;
+
+    /// @brief Filib rounding arithmetic without saving and restoring the
+    /// rounding mode around every operation (the mode is never changed).
+    typedef boost::numeric::interval_lib::save_state_nothing<
+        FILibFixedRounding>
+        FILibFixedRoundingPolicy;
+#endif
 
-// Use filib rounding arithmetic
-typedef boost::numeric::interval<
+    /// @brief Proper rounding arithmetic of the standard library.
+    typedef boost::numeric::interval_lib::save_state<
+        boost::numeric::interval_lib::rounded_transc_std<double>>
+        BoostRoundingPolicy;
+
+    /// @brief Exact rounding of the transcendental functions (macOS).
+    typedef boost::numeric::interval_lib::save_state<
+        boost::numeric::interval_lib::rounded_transc_exact<double>>
+        BoostExactRoundingPolicy;
+} // namespace interval_options
+
+/// @brief Interval of doubles with the given rounding policy.
+template <typename RoundingPolicy>
+using IntervalWith = boost::numeric::interval<
     double,
     boost::numeric::interval_lib::policies<
-        boost::numeric::interval_lib::save_state<FILibRounding>,
-        interval_options::CheckingPolicy>>
-    Interval;
+        RoundingPolicy,
+        interval_options::CheckingPolicy>>;
 
+#if defined(RIGID_IPC_INTERVAL_BACKEND_FILIB_FIXED)
+typedef IntervalWith<interval_options::FILibFixedRoundingPolicy> Interval;
+#elif defined(RIGID_IPC_INTERVAL_BACKEND_FILIB)
+typedef IntervalWith<interval_options::FILibRoundingPolicy> Interval;
 #elif defined(__APPLE__)
-
 // clang-format off
 #warning "Rounding modes seem to be broken with trigonometric functions on macOS, unable to compute exact interval arithmetic!"
 // clang-format on
-typedef boost::numeric::interval<
-    double,
-    boost::numeric::interval_lib::policies<
-        boost::numeric::interval_lib::save_state<
-            boost::numeric::interval_lib::rounded_transc_exact<double>>,
-        interval_options::CheckingPolicy>>
-    Interval;
-
+typedef IntervalWith<interval_options::BoostExactRoundingPolicy> Interval;
 #else
-
-// Use proper rounding arithmetic
-typedef boost::numeric::interval<
-    double,
-    boost::numeric::interval_lib::policies<
-        boost::numeric::interval_lib::save_state<
-            boost::numeric::interval_lib::rounded_transc_std<double>>,
-        interval_options::CheckingPolicy>>
-    Interval;
-
-#endif // USE_FILIB_INTERVALS
+typedef IntervalWith<interval_options::BoostRoundingPolicy> Interval;
+#endif
 
 template <typename Derived>
 inline Eigen::VectorXd width(const Eigen::MatrixBase<Derived>& x)
@@ -1,8 +1,14 @@
 // A root finder using interval arithmetic.
 #include "interval_root_finder.hpp"
 
+#include <algorithm>
+#include <atomic>
+#include <mutex>
 #include <stack>
 
+#include <tbb/task_arena.h>
+#include <tbb/task_group.h>
+
 #include <logger.hpp>
 
 namespace ipc::rigid {
@@ -51,10 +57,17 @@ bool interval_root_finder(
     const VectorMax3I& x0,
     VectorMax3d tol,
     VectorMax3I& x,
-    int max_iterations)
+    int max_iterations,
+    int* num_iterations,
+    bool find_any_root,
+    bool search_in_parallel,
+    double relative_toi_tol,
+    bool* is_budget_exceeded)
 {
     return interval_root_finder(
-        f, [](const VectorMax3I&) { return true; }, x0, tol, x, max_iterations);
+        f, [](const VectorMax3I&) { return true; }, x0, tol, x, max_iterations,
+        num_iterations, find_any_root, search_in_parallel, relative_toi_tol,
+        is_budget_exceeded);
 }
 
 bool interval_root_finder(
@@ -63,11 +76,17 @@ bool interval_root_finder(
     const VectorMax3I& x0,
     VectorMax3d tol,
     VectorMax3I& x,
-    int max_iterations)
+    int max_iterations,
+    int* num_iterations,
+    bool find_any_root,
+    bool search_in_parallel,
+    double relative_toi_tol,
+    bool* is_budget_exceeded)
 {
     return interval_root_finder(
         f, [](const VectorMax3I&) { return true; }, is_domain_valid, x0, tol, x,
-        max_iterations);
+        max_iterations, num_iterations, find_any_root, search_in_parallel,
+        relative_toi_tol, is_budget_exceeded);
 }
 
 void log_octree(
@@ -94,48 +113,28 @@ void log_octree(
     }
 }
 
-bool interval_root_finder(
-    const std::function<VectorMax3I(const VectorMax3I&)>& f,
-    const std::function<bool(const VectorMax3I&)>& constraint_predicate,
-    const std::function<bool(const VectorMax3I&)>& is_domain_valid,
-    const VectorMax3I& x0,
-    VectorMax3d tol,
-    VectorMax3I& x,
-    int max_iterations)
-{
-    // log_octree(f, x0);
-
-    // Keep searching for earlier roots (assumes time is first coordinate)
-    VectorMax3I earliest_root = VectorMax3I::Constant(
-        x0.size(), Interval(std::numeric_limits<double>::infinity()));
-    bool found_root = false;
-
-    // Stack of intervals and the last split dimension
-    std::stack<VectorMax3I> xs;
-    xs.push(x0);
-
-    // If the start is a root then we are in trouble, so we should reduce the
-    // tolerance.
-    VectorMax3I x_tol(tol.size());
-    for (int i = 0; i < x_tol.size(); i++) {
-        x_tol(i) = Interval(0, tol(i));
-    }
-    if (zero_in(f(x_tol))) {
-        tol(0) /= 1e2;
-    }
-
-    // TODO: Enable max_iterations
-    for (size_t iter = 0; !xs.empty(); iter++) {
-        x = xs.top();
-        xs.pop();
+namespace {
+    enum class BoxState { DISCARDED, ROOT, BISECTED };
 
+    /// @brief Examine a box of the search: discard it, accept it as a root,
+    /// or bisect it into two halves (first then second in search order).
+    BoxState examine_box(
+        const std::function<VectorMax3I(const VectorMax3I&)>& f,
+        const std::function<bool(const VectorMax3I&)>& constraint_predicate,
+        const std::function<bool(const VectorMax3I&)>& is_domain_valid,
+        VectorMax3d tol,
+        double relative_toi_tol,
+        double earliest_root_lower,
+        VectorMax3I& x,
+        VectorMax3I& second_half)
+    {
         // Skip any interval that is not before the earliest root
-        if (x[0].lower() >= earliest_root[0].lower()) {
-            continue;
+        if (x[0].lower() >= earliest_root_lower) {
+            return BoxState::DISCARDED;
         }
 
         if (!is_domain_valid(x)) {
-            continue;
+            return BoxState::DISCARDED;
         }
 
         VectorMax3I y = f(x);
@@ -145,18 +144,18 @@ bool interval_root_finder(
         //     fmt_eigen_intervals(y));
 
         if (!zero_in(y)) {
-            continue;
+            return BoxState::DISCARDED;
         }
 
+        // A root at t only has to be found to within a fraction of t
+        tol(0) = std::max(tol(0), relative_toi_tol * x[0].lower());
+
         VectorMax3d widths = width(x);
         bool all_tol_sat = (widths.array() <= tol.array()).all();
         bool all_widths_zero = (widths.array() <= 1e-10).all();
         if ((x[0].lower() > 0 || all_widths_zero) && all_tol_sat) {
-            if (constraint_predicate(x)) {
-                earliest_root = x;
-                found_root = true;
-            }
-            continue;
+            return constraint_predicate(x) ? BoxState::ROOT
+                                           : BoxState::DISCARDED;
         }
 
         // Check the diagonal of the range box
@@ -179,25 +178,177 @@ bool interval_root_finder(
         assert(split_i >= 0 && split_i <= x.size());
 
         std::pair<Interval, Interval> halves = bisect(x(split_i));
-        // Push the second half on first so it is examined after the first half
-        x(split_i) = halves.second;
-        xs.push(x);
+        second_half = x;
+        second_half(split_i) = halves.second;
         x(split_i) = halves.first;
-        xs.push(x);
+        return BoxState::BISECTED;
     }
-    // TODO: This is needs to be updated when max_iterations is renabled
-    // if (!xs.empty()) {
-    //     // Return the earliest possible time of impact
-    //     x = xs.top().first;
-    //     xs.pop();
-    //     while (!xs.empty()) {
-    //         if (xs.top().first[0].lower() < x[0].lower()) {
-    //             x = xs.top().first;
-    //         }
-    //         xs.pop();
-    //     }
-    //     return true; // A conservative answer
-    // }
+} // namespace
+
+bool interval_root_finder(
+    const std::function<VectorMax3I(const VectorMax3I&)>& f,
+    const std::function<bool(const VectorMax3I&)>& constraint_predicate,
+    const std::function<bool(const VectorMax3I&)>& is_domain_valid,
+    const VectorMax3I& x0,
+    VectorMax3d tol,
+    VectorMax3I& x,
+    int max_iterations,
+    int* num_iterations,
+    bool find_any_root,
+    bool search_in_parallel,
+    double relative_toi_tol,
+    bool* is_budget_exceeded)
+{
+    // log_octree(f, x0);
+
+    // Keep searching for earlier roots (assumes time is first coordinate)
+    VectorMax3I earliest_root = VectorMax3I::Constant(
+        x0.size(), Interval(std::numeric_limits<double>::infinity()));
+    bool found_root = false;
+
+    // Stack of intervals and the last split dimension
+    std::stack<VectorMax3I> xs;
+    xs.push(x0);
+
+    // If the start is a root then we are in trouble, so we should reduce the
+    // tolerance.
+    VectorMax3I x_tol(tol.size());
+    for (int i = 0; i < x_tol.size(); i++) {
+        x_tol(i) = Interval(0, tol(i));
+    }
+    if (zero_in(f(x_tol))) {
+        tol(0) /= 1e2;
+    }
+
+    // Only queries that are still going after this many boxes are split
+    // between threads
+    int sequential_iterations = max_iterations;
+    if (search_in_parallel && tbb::this_task_arena::max_concurrency() > 1) {
+        sequential_iterations = std::min(
+            max_iterations,
+            Constants::INTERVAL_ROOT_FINDER_PARALLEL_ITERATIONS);
+    }
+
+    int iter;
+    for (iter = 0; !xs.empty() && iter < sequential_iterations; iter++) {
+        x = xs.top();
+        xs.pop();
+
+        VectorMax3I second_half;
+        BoxState state = examine_box(
+            f, constraint_predicate, is_domain_valid, tol, relative_toi_tol,
+            earliest_root[0].lower(), x, second_half);
+        if (state == BoxState::ROOT) {
+            earliest_root = x;
+            found_root = true;
+            if (find_any_root) {
+                iter++;
+                break;
+            }
+        } else if (state == BoxState::BISECTED) {
+            // Push the second half on first so it is examined after the first
+            xs.push(second_half);
+            xs.push(x);
+        }
+    }
+
+    if (!xs.empty() && iter < max_iterations
+        && !(find_any_root && found_root)) {
+        // Search the remaining boxes with tasks that share the earliest root
+        // and split their boxes between idle threads
+        std::atomic<int> shared_iter(iter);
+        std::atomic<double> earliest_root_lower(earliest_root[0].lower());
+        std::atomic<bool> is_done(false);
+        std::mutex mutex; // Guards earliest_root, found_root, and xs
+        tbb::task_group tasks;
+
+        std::function<void(VectorMax3I)> search = [&](VectorMax3I box) {
+            std::stack<VectorMax3I> local_xs;
+            local_xs.push(box);
+            int num_examined = 0;
+            while (!local_xs.empty() && !is_done) {
+                if (shared_iter++ >= max_iterations) {
+                    is_done = true;
+                    break;
+                }
+                box = local_xs.top();
+                local_xs.pop();
+
+                VectorMax3I second_half;
+                BoxState state = examine_box(
+                    f, constraint_predicate, is_domain_valid, tol,
+                    relative_toi_tol, earliest_root_lower, box, second_half);
+                if (state == BoxState::ROOT) {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    if (box[0].lower() < earliest_root[0].lower()) {
+                        earliest_root = box;
+                        earliest_root_lower = box[0].lower();
+                        found_root = true;
+                    }
+                    if (find_any_root) {
+                        is_done = true;
+                    }
+                } else if (state == BoxState::BISECTED) {
+                    if (++num_examined
+                        >= Constants::INTERVAL_ROOT_FINDER_PARALLEL_GRAIN) {
+                        // Give the later half to another thread
+                        num_examined = 0;
+                        tasks.run([&search, second_half] {
+                            search(second_half);
+                        });
+                    } else {
+                        local_xs.push(second_half);
+                    }
+                    local_xs.push(box);
+                }
+            }
+
+            // Keep the unexamined boxes for a conservative answer
+            if (!local_xs.empty()) {
+                std::lock_guard<std::mutex> lock(mutex);
+                for (; !local_xs.empty(); local_xs.pop()) {
+                    xs.push(local_xs.top());
+                }
+            }
+        };
+
+        std::vector<VectorMax3I> boxes;
+        for (; !xs.empty(); xs.pop()) {
+            boxes.push_back(xs.top());
+        }
+        // Do not pick up outer tasks while waiting on the query's boxes
+        tbb::this_task_arena::isolate([&] {
+            for (const VectorMax3I& box : boxes) {
+                tasks.run([&search, box] { search(box); });
+            }
+            tasks.wait();
+        });
+        iter = std::min(int(shared_iter), max_iterations);
+    }
+
+    if (num_iterations != nullptr) {
+        *num_iterations = iter;
+    }
+
+    // Boxes are only left unexamined when the search ran out of iterations
+    const bool is_out_of_iterations =
+        !xs.empty() && !(find_any_root && found_root);
+    if (is_budget_exceeded != nullptr) {
+        *is_budget_exceeded = is_out_of_iterations;
+    }
+
+    if (is_out_of_iterations) {
+        // Out of iterations: return the earliest box still alive
+        x = earliest_root;
+        while (!xs.empty()) {
+            if (xs.top()[0].lower() < x[0].lower()) {
+                x = xs.top();
+            }
+            xs.pop();
+        }
+        return true; // A conservative answer
+    }
+
     x = earliest_root;
     return found_root;
 }
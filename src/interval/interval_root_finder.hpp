@@ -31,7 +31,12 @@ bool interval_root_finder(
     const VectorMax3I& x0,
     VectorMax3d tol,
     VectorMax3I& x,
-    int max_iterations = Constants::INTERVAL_ROOT_FINDER_MAX_ITERATIONS);
+    int max_iterations = Constants::INTERVAL_ROOT_FINDER_MAX_ITERATIONS,
+    int* num_iterations = nullptr,
+    bool find_any_root = false,
+    bool search_in_parallel = false,
+    double relative_toi_tol = 0,
+    bool* is_budget_exceeded = nullptr);
 
 /// Find if the origin is in the range of a function f: Iⁿ ↦ Iⁿ
 bool interval_root_finder(
@@ -40,9 +45,34 @@ bool interval_root_finder(
     const VectorMax3I& x0,
     VectorMax3d tol,
     VectorMax3I& x,
-    int max_iterations = Constants::INTERVAL_ROOT_FINDER_MAX_ITERATIONS);
+    int max_iterations = Constants::INTERVAL_ROOT_FINDER_MAX_ITERATIONS,
+    int* num_iterations = nullptr,
+    bool find_any_root = false,
+    bool search_in_parallel = false,
+    double relative_toi_tol = 0,
+    bool* is_budget_exceeded = nullptr);
 
 /// Find if the origin is in the range of a function f: Iⁿ ↦ Iⁿ
+///
+/// If max_iterations boxes are examined before the search ends, the earliest
+/// box still alive is returned as a conservative root. The number of boxes
+/// examined is written to num_iterations if it is not null, and whether the
+/// search ran out of iterations (a search finishing with its last box is not)
+/// to is_budget_exceeded if it is not null.
+///
+/// If find_any_root is true, the search stops at the first root found instead
+/// of the earliest (for yes/no queries, which get the same answer).
+///
+/// If search_in_parallel is true, a search still going after
+/// Constants::INTERVAL_ROOT_FINDER_PARALLEL_ITERATIONS boxes continues with
+/// TBB tasks that share the earliest root found and hand their later halves
+/// to idle threads, so f and the predicates must be thread safe (and the
+/// root found may depend on the scheduling).
+///
+/// A box is accurate enough in time once its width is below
+/// max(tol(0), relative_toi_tol * t), where t is its earliest time, so a
+/// positive relative_toi_tol resolves later roots more coarsely. The lower
+/// bound of the root box stays a conservative time of impact.
 bool interval_root_finder(
     const std::function<VectorMax3I(const VectorMax3I&)>& f,
     const std::function<bool(const VectorMax3I&)>& constraint_predicate,
@@ -50,6 +80,79 @@ bool interval_root_finder(
     const VectorMax3I& x0,
     VectorMax3d tol,
     VectorMax3I& x,
-    int max_iterations = Constants::INTERVAL_ROOT_FINDER_MAX_ITERATIONS);
+    int max_iterations = Constants::INTERVAL_ROOT_FINDER_MAX_ITERATIONS,
+    int* num_iterations = nullptr,
+    bool find_any_root = false,
+    bool search_in_parallel = false,
+    double relative_toi_tol = 0,
+    bool* is_budget_exceeded = nullptr);
+
+/// @brief Find if the origin is in the range of a function f: Iⁿ ↦ Iⁿ.
+///
+/// The boxes are bisected breadth-first and evaluated in batches with a
+/// single call f(xs, ys), where xs and ys are std::vector<VectorMax3I>. A
+/// batch holds the earliest boxes of the frontier, at most
+/// Constants::INTERVAL_ROOT_FINDER_MAX_BATCH_SIZE of them. If max_iterations
+/// boxes are evaluated before the search ends, the earliest box still alive
+/// is returned as a conservative root.
+///
+/// See interval_root_finder() for the other parameters.
+template <
+    typename BatchFunction,
+    typename ConstraintPredicate,
+    typename DomainPredicate>
+bool interval_root_finder_batched(
+    const BatchFunction& f,
+    const ConstraintPredicate& constraint_predicate,
+    const DomainPredicate& is_domain_valid,
+    const VectorMax3I& x0,
+    VectorMax3d tol,
+    VectorMax3I& x,
+    int max_iterations = Constants::INTERVAL_ROOT_FINDER_MAX_ITERATIONS,
+    int* num_iterations = nullptr,
+    bool find_any_root = false,
+    double relative_toi_tol = 0,
+    bool* is_budget_exceeded = nullptr);
+
+/// @brief Find if the origin is in the range of a function f: Iⁿ ↦ Iⁿ.
+template <typename BatchFunction, typename DomainPredicate>
+bool interval_root_finder_batched(
+    const BatchFunction& f,
+    const DomainPredicate& is_domain_valid,
+    const VectorMax3I& x0,
+    VectorMax3d tol,
+    VectorMax3I& x,
+    int max_iterations = Constants::INTERVAL_ROOT_FINDER_MAX_ITERATIONS,
+    int* num_iterations = nullptr,
+    bool find_any_root = false,
+    double relative_toi_tol = 0,
+    bool* is_budget_exceeded = nullptr)
+{
+    return interval_root_finder_batched(
+        f, [](const VectorMax3I&) { return true; }, is_domain_valid, x0, tol, x,
+        max_iterations, num_iterations, find_any_root, relative_toi_tol,
+        is_budget_exceeded);
+}
+
+/// @brief Find if the origin is in the range of a function f: Iⁿ ↦ Iⁿ.
+template <typename BatchFunction>
+bool interval_root_finder_batched(
+    const BatchFunction& f,
+    const VectorMax3I& x0,
+    VectorMax3d tol,
+    VectorMax3I& x,
+    int max_iterations = Constants::INTERVAL_ROOT_FINDER_MAX_ITERATIONS,
+    int* num_iterations = nullptr,
+    bool find_any_root = false,
+    double relative_toi_tol = 0,
+    bool* is_budget_exceeded = nullptr)
+{
+    return interval_root_finder_batched(
+        f, [](const VectorMax3I&) { return true; }, x0, tol, x,
+        max_iterations, num_iterations, find_any_root, relative_toi_tol,
+        is_budget_exceeded);
+}
 
 } // namespace ipc::rigid
+
+#include "interval_root_finder.tpp"
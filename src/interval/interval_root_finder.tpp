@@ -0,0 +1,160 @@
+// A breadth-first root finder using interval arithmetic.
+#pragma once
+#include "interval_root_finder.hpp"
+
+#include <algorithm>
+#include <vector>
+
+namespace ipc::rigid {
+
+template <
+    typename BatchFunction,
+    typename ConstraintPredicate,
+    typename DomainPredicate>
+bool interval_root_finder_batched(
+    const BatchFunction& f,
+    const ConstraintPredicate& constraint_predicate,
+    const DomainPredicate& is_domain_valid,
+    const VectorMax3I& x0,
+    VectorMax3d tol,
+    VectorMax3I& x,
+    int max_iterations,
+    int* num_iterations,
+    bool find_any_root,
+    double relative_toi_tol,
+    bool* is_budget_exceeded)
+{
+    // Keep searching for earlier roots (assumes time is first coordinate)
+    VectorMax3I earliest_root = VectorMax3I::Constant(
+        x0.size(), Interval(std::numeric_limits<double>::infinity()));
+    bool found_root = false;
+
+    std::vector<VectorMax3I> xs, ys;
+
+    // If the start is a root then we are in trouble, so we should reduce the
+    // tolerance.
+    VectorMax3I x_tol(tol.size());
+    for (int i = 0; i < x_tol.size(); i++) {
+        x_tol(i) = Interval(0, tol(i));
+    }
+    xs.push_back(x_tol);
+    f(xs, ys);
+    if (zero_in(ys[0])) {
+        tol(0) /= 1e2;
+    }
+
+    xs.clear();
+    if (is_domain_valid(x0)) {
+        xs.push_back(x0);
+    }
+
+    const auto is_earlier = [](const VectorMax3I& a, const VectorMax3I& b) {
+        return a[0].lower() < b[0].lower();
+    };
+
+    std::vector<VectorMax3I> batch;
+    int iter = 0;
+    while (!xs.empty() && iter < max_iterations) {
+        // Evaluate the earliest boxes of the frontier at once, never more
+        // than the batch size or the remaining budget
+        const size_t batch_size = std::min(
+            { xs.size(), size_t(max_iterations - iter),
+              size_t(Constants::INTERVAL_ROOT_FINDER_MAX_BATCH_SIZE) });
+        if (batch_size < xs.size()) {
+            std::nth_element(
+                xs.begin(), xs.begin() + batch_size, xs.end(), is_earlier);
+        }
+        batch.assign(xs.begin(), xs.begin() + batch_size);
+        xs.erase(xs.begin(), xs.begin() + batch_size);
+        iter += batch_size;
+
+        ys.clear();
+        f(batch, ys);
+        assert(ys.size() == batch.size());
+
+        for (size_t i = 0; i < batch.size(); i++) {
+            const VectorMax3I& xi = batch[i];
+
+            // Skip any interval that is not before the earliest root
+            if (xi[0].lower() >= earliest_root[0].lower()
+                || !zero_in(ys[i])) {
+                continue;
+            }
+
+            // A root at t only has to be found to within a fraction of t
+            VectorMax3d xi_tol = tol;
+            xi_tol(0) = std::max(tol(0), relative_toi_tol * xi[0].lower());
+
+            VectorMax3d widths = width(xi);
+            bool all_tol_sat = (widths.array() <= xi_tol.array()).all();
+            bool all_widths_zero = (widths.array() <= 1e-10).all();
+            if ((xi[0].lower() > 0 || all_widths_zero) && all_tol_sat) {
+                if (constraint_predicate(xi)) {
+                    earliest_root = xi;
+                    found_root = true;
+                }
+                continue;
+            }
+
+            // Bisect the largest dimension divided by its tolerance
+            int split_i = -1;
+            for (int j = 0; j < xi.size(); j++) {
+                if ((all_tol_sat || widths(j) > xi_tol(j))
+                    && (split_i == -1
+                        || widths(j) * xi_tol(split_i)
+                            > widths(split_i) * xi_tol(j))) {
+                    split_i = j;
+                }
+            }
+            assert(split_i >= 0 && split_i <= xi.size());
+
+            std::pair<Interval, Interval> halves = bisect(xi(split_i));
+            for (const Interval& half : { halves.first, halves.second }) {
+                VectorMax3I x_half = xi;
+                x_half(split_i) = half;
+                if (is_domain_valid(x_half)) {
+                    xs.push_back(x_half);
+                }
+            }
+        }
+
+        if (find_any_root && found_root) {
+            break;
+        }
+        // Drop the boxes that start after a root found in this batch
+        xs.erase(
+            std::remove_if(
+                xs.begin(), xs.end(),
+                [&](const VectorMax3I& xi) {
+                    return xi[0].lower() >= earliest_root[0].lower();
+                }),
+            xs.end());
+    }
+
+    if (num_iterations != nullptr) {
+        *num_iterations = iter;
+    }
+
+    // Boxes are only left unevaluated when the search ran out of iterations
+    const bool is_out_of_iterations =
+        !xs.empty() && !(find_any_root && found_root);
+    if (is_budget_exceeded != nullptr) {
+        *is_budget_exceeded = is_out_of_iterations;
+    }
+
+    if (is_out_of_iterations) {
+        // Out of iterations: return the earliest box still alive
+        x = earliest_root;
+        for (const VectorMax3I& xi : xs) {
+            if (xi[0].lower() < x[0].lower()) {
+                x = xi;
+            }
+        }
+        return true; // A conservative answer
+    }
+
+    x = earliest_root;
+    return found_root;
+}
+
+} // namespace ipc::rigid
@@ -0,0 +1,339 @@
+#include "keyframe_file.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <limits>
+
+#include <logger.hpp>
+
+namespace ipc::rigid {
+
+namespace {
+    /// @brief Largest quantized value of a quaternion component.
+    const uint64_t ROTATION_MAX = (uint64_t(1) << 20) - 1;
+    /// @brief Largest quantized value of a position coordinate.
+    const double POSITION_MAX = std::numeric_limits<uint16_t>::max();
+
+    /// @brief Pose of a body with its rotation as a quaternion.
+    struct Sample {
+        Eigen::Vector3d position;
+        Eigen::Quaterniond rotation;
+    };
+
+    Sample to_sample(const PoseD& pose)
+    {
+        Sample sample;
+        sample.position.setZero();
+        sample.position.head(pose.position.size()) = pose.position;
+        if (pose.dim() == 2) {
+            sample.rotation = Eigen::AngleAxisd(
+                pose.rotation(0), Eigen::Vector3d::UnitZ());
+        } else {
+            sample.rotation = pose.construct_quaternion();
+        }
+        return sample;
+    }
+
+    PoseD to_pose(
+        int dim,
+        const Eigen::Vector3d& position,
+        const Eigen::Quaterniond& rotation)
+    {
+        PoseD pose = PoseD::Zero(dim);
+        pose.position = position.head(dim);
+        if (dim == 2) {
+            pose.rotation(0) = 2 * std::atan2(rotation.z(), rotation.w());
+        } else {
+            const Eigen::AngleAxisd angle_axis(rotation);
+            pose.rotation = angle_axis.angle() * angle_axis.axis();
+        }
+        return pose;
+    }
+} // namespace
+
+size_t frame_stride(double timestep, double frame_rate)
+{
+    if (frame_rate <= 0 || timestep <= 0) {
+        return 1;
+    }
+    return std::max(1L, std::lround(1 / (frame_rate * timestep)));
+}
+
+uint64_t quantize_rotation(const Eigen::Quaterniond& q)
+{
+    Eigen::Vector4d coeffs = q.normalized().coeffs();
+    int largest;
+    coeffs.cwiseAbs().maxCoeff(&largest);
+    if (coeffs(largest) < 0) {
+        coeffs = -coeffs; // q and -q are the same rotation
+    }
+
+    // The other components are in [-1/√2, 1/√2]
+    uint64_t bits = uint64_t(largest);
+    int shift = 2;
+    for (int i = 0; i < 4; i++) {
+        if (i != largest) {
+            const double t =
+                std::clamp(0.5 * (coeffs(i) * M_SQRT2 + 1), 0.0, 1.0);
+            bits |= uint64_t(std::llround(t * ROTATION_MAX)) << shift;
+            shift += 20;
+        }
+    }
+    return bits;
+}
+
+Eigen::Quaterniond dequantize_rotation(uint64_t bits)
+{
+    const int largest = int(bits & 3);
+    Eigen::Vector4d coeffs;
+    int shift = 2;
+    double squared_norm = 0;
+    for (int i = 0; i < 4; i++) {
+        if (i != largest) {
+            const double t = double((bits >> shift) & ROTATION_MAX);
+            coeffs(i) = (2 * t / ROTATION_MAX - 1) * M_SQRT1_2;
+            squared_norm += coeffs(i) * coeffs(i);
+            shift += 20;
+        }
+    }
+    coeffs(largest) = std::sqrt(std::max(0.0, 1 - squared_norm));
+
+    Eigen::Quaterniond q;
+    q.coeffs() = coeffs.normalized();
+    return q;
+}
+
+bool KeyframeHeader::is_valid() const
+{
+    const KeyframeHeader expected;
+    return std::memcmp(magic, expected.magic, sizeof(magic)) == 0
+        && version == expected.version && (dim == 2 || dim == 3);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Compression
+
+bool KeyframeSequence::compress(
+    int dim,
+    size_t num_bodies,
+    size_t num_frames,
+    double timestep,
+    const PoseFrameReader& read_frame,
+    const KeyframeSettings& settings)
+{
+    const size_t stride = frame_stride(timestep, settings.frame_rate);
+    m_header = KeyframeHeader();
+    m_header.dim = dim;
+    m_header.num_bodies = num_bodies;
+    m_header.num_frames = num_frames == 0 ? 0 : (num_frames - 1) / stride + 1;
+    m_header.timestep = timestep * stride;
+    m_keyframes.assign(num_bodies, {});
+
+    // Bounding box of the positions
+    PosesD poses;
+    Eigen::Array3d min = Eigen::Array3d::Constant(INFINITY);
+    Eigen::Array3d max = Eigen::Array3d::Constant(-INFINITY);
+    for (size_t i = 0; i < m_header.num_frames; i++) {
+        if (!read_frame(i * stride, poses) || poses.size() != num_bodies) {
+            return false;
+        }
+        for (const PoseD& pose : poses) {
+            const Eigen::Array3d p = to_sample(pose).position;
+            min = min.min(p);
+            max = max.max(p);
+        }
+    }
+    if (m_header.num_frames == 0 || num_bodies == 0) {
+        min.setZero();
+        max.setZero();
+    }
+    std::copy_n(min.data(), 3, m_header.min);
+    std::copy_n(max.data(), 3, m_header.max);
+    const double position_tolerance =
+        settings.position_tolerance * (max - min).matrix().norm();
+
+    // Samples after the last keyframe of each body and the keyframe of the
+    // latest one, which becomes a keyframe once interpolating fails.
+    std::vector<std::vector<Sample>> pending(num_bodies);
+    std::vector<Keyframe> candidates(num_bodies);
+    for (size_t i = 0; i < m_header.num_frames; i++) {
+        if (!read_frame(i * stride, poses) || poses.size() != num_bodies) {
+            return false;
+        }
+        for (size_t j = 0; j < num_bodies; j++) {
+            const Sample sample = to_sample(poses[j]);
+            const Keyframe keyframe { uint32_t(i),
+                                      quantize_position(sample.position),
+                                      quantize_rotation(sample.rotation) };
+            std::vector<Keyframe>& keyframes = m_keyframes[j];
+            if (keyframes.empty()) {
+                keyframes.push_back(keyframe);
+                continue;
+            }
+
+            bool is_predictable =
+                i - keyframes.back().frame <= settings.max_keyframe_interval;
+            for (size_t k = 0; is_predictable && k < pending[j].size(); k++) {
+                Eigen::Vector3d position;
+                Eigen::Quaterniond rotation;
+                interpolate(
+                    keyframes.back(), keyframe, keyframes.back().frame + k + 1,
+                    position, rotation);
+                is_predictable =
+                    (position - pending[j][k].position).norm()
+                        <= position_tolerance
+                    && rotation.angularDistance(pending[j][k].rotation)
+                        <= settings.rotation_tolerance;
+            }
+            if (!is_predictable) {
+                keyframes.push_back(candidates[j]);
+                pending[j].clear();
+            }
+            pending[j].push_back(sample);
+            candidates[j] = keyframe;
+        }
+    }
+    for (size_t j = 0; j < num_bodies; j++) {
+        if (!pending[j].empty()) {
+            m_keyframes[j].push_back(candidates[j]); // Last frame
+        }
+    }
+    return true;
+}
+
+std::array<uint16_t, 3>
+KeyframeSequence::quantize_position(const Eigen::Vector3d& p) const
+{
+    std::array<uint16_t, 3> q = { { 0, 0, 0 } };
+    for (int i = 0; i < 3; i++) {
+        const double extent = m_header.max[i] - m_header.min[i];
+        if (extent > 0) {
+            const double t =
+                std::clamp((p(i) - m_header.min[i]) / extent, 0.0, 1.0);
+            q[i] = uint16_t(std::lround(t * POSITION_MAX));
+        }
+    }
+    return q;
+}
+
+Eigen::Vector3d
+KeyframeSequence::dequantize_position(const std::array<uint16_t, 3>& q) const
+{
+    Eigen::Vector3d p;
+    for (int i = 0; i < 3; i++) {
+        p(i) = m_header.min[i]
+            + (m_header.max[i] - m_header.min[i]) * (q[i] / POSITION_MAX);
+    }
+    return p;
+}
+
+void KeyframeSequence::interpolate(
+    const Keyframe& k0,
+    const Keyframe& k1,
+    size_t i,
+    Eigen::Vector3d& position,
+    Eigen::Quaterniond& rotation) const
+{
+    assert(k0.frame <= i && i <= k1.frame);
+    const double t =
+        k1.frame == k0.frame ? 0 : double(i - k0.frame) / (k1.frame - k0.frame);
+    const Eigen::Vector3d p0 = dequantize_position(k0.position);
+    position = p0 + t * (dequantize_position(k1.position) - p0);
+    rotation = dequantize_rotation(k0.rotation)
+                   .slerp(t, dequantize_rotation(k1.rotation));
+}
+
+void KeyframeSequence::frame(size_t i, PosesD& poses) const
+{
+    assert(i < num_frames());
+    poses.resize(num_bodies());
+    for (size_t j = 0; j < num_bodies(); j++) {
+        const std::vector<Keyframe>& keyframes = m_keyframes[j];
+        assert(!keyframes.empty());
+        auto it = std::upper_bound(
+            keyframes.begin(), keyframes.end(), i,
+            [](size_t frame, const Keyframe& k) { return frame < k.frame; });
+        const Keyframe& k0 = *(it == keyframes.begin() ? it : it - 1);
+        const Keyframe& k1 = it == keyframes.end() ? k0 : *it;
+
+        Eigen::Vector3d position;
+        Eigen::Quaterniond rotation;
+        interpolate(k0, k1, std::clamp<size_t>(i, k0.frame, k1.frame),
+                    position, rotation);
+        poses[j] = to_pose(dim(), position, rotation);
+    }
+}
+
+size_t KeyframeSequence::num_keyframes() const
+{
+    size_t num_keyframes = 0;
+    for (const std::vector<Keyframe>& keyframes : m_keyframes) {
+        num_keyframes += keyframes.size();
+    }
+    return num_keyframes;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// File I/O
+
+bool KeyframeSequence::write(const std::string& filename) const
+{
+    std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+    if (!file) {
+        spdlog::error(
+            "failed to open keyframe file for writing filename={}", filename);
+        return false;
+    }
+    file.write(reinterpret_cast<const char*>(&m_header), sizeof(m_header));
+    for (const std::vector<Keyframe>& keyframes : m_keyframes) {
+        const uint64_t num_keyframes = keyframes.size();
+        file.write(
+            reinterpret_cast<const char*>(&num_keyframes),
+            sizeof(num_keyframes));
+        // Written field by field to skip the padding
+        for (const Keyframe& k : keyframes) {
+            file.write(reinterpret_cast<const char*>(&k.frame), 4);
+            file.write(reinterpret_cast<const char*>(k.position.data()), 6);
+            file.write(reinterpret_cast<const char*>(&k.rotation), 8);
+        }
+    }
+    return bool(file);
+}
+
+bool KeyframeSequence::read(const std::string& filename)
+{
+    m_keyframes.clear();
+    std::ifstream file(filename, std::ios::binary);
+    file.read(reinterpret_cast<char*>(&m_header), sizeof(m_header));
+    if (!file || !m_header.is_valid()) {
+        spdlog::error("invalid keyframe file filename={}", filename);
+        return false;
+    }
+    m_keyframes.resize(m_header.num_bodies);
+    for (std::vector<Keyframe>& keyframes : m_keyframes) {
+        uint64_t num_keyframes = 0;
+        file.read(
+            reinterpret_cast<char*>(&num_keyframes), sizeof(num_keyframes));
+        if (!file || num_keyframes == 0 || num_keyframes > num_frames()) {
+            spdlog::error("invalid keyframe file filename={}", filename);
+            m_keyframes.clear();
+            return false;
+        }
+        keyframes.resize(num_keyframes);
+        for (Keyframe& k : keyframes) {
+            file.read(reinterpret_cast<char*>(&k.frame), 4);
+            file.read(reinterpret_cast<char*>(k.position.data()), 6);
+            file.read(reinterpret_cast<char*>(&k.rotation), 8);
+        }
+    }
+    if (!file) {
+        spdlog::error("truncated keyframe file filename={}", filename);
+        m_keyframes.clear();
+        return false;
+    }
+    return true;
+}
+
+} // namespace ipc::rigid
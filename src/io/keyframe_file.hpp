@@ -0,0 +1,117 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include <Eigen/Geometry>
+
+#include <physics/pose.hpp>
+
+namespace ipc::rigid {
+
+/// @brief Reader of the poses of the ith frame of a sequence.
+typedef std::function<bool(size_t, PosesD&)> PoseFrameReader;
+
+/// @brief Settings of the keyframe compression of pose sequences.
+struct KeyframeSettings {
+    /// @brief Output frame rate (all frames are kept if not positive).
+    double frame_rate = -1;
+    /// @brief Maximum position error relative to the bounding box diagonal.
+    double position_tolerance = 1e-4;
+    /// @brief Maximum rotation error in radians.
+    double rotation_tolerance = 1e-3;
+    /// @brief Maximum number of frames between two keyframes of a body.
+    size_t max_keyframe_interval = 256;
+};
+
+/// @brief Number of simulation steps per output frame (at least one).
+size_t frame_stride(double timestep, double frame_rate);
+
+/// @brief Quantize a rotation as its three smallest quaternion components
+/// (20 bits each) and the index of the largest one.
+uint64_t quantize_rotation(const Eigen::Quaterniond& q);
+Eigen::Quaterniond dequantize_rotation(uint64_t bits);
+
+/// @brief Pose of a body at a frame, quantized in the bounding box of the
+/// sequence.
+struct Keyframe {
+    uint32_t frame;
+    std::array<uint16_t, 3> position;
+    uint64_t rotation;
+};
+
+/// @brief Header of a keyframe file.
+///
+/// The header is followed, for each body, by its number of keyframes as a
+/// uint64 and its keyframes.
+struct KeyframeHeader {
+    char magic[8] = { 'R', 'I', 'P', 'C', 'K', 'E', 'Y', 'F' };
+    uint32_t version = 1;
+    uint32_t dim = 0;
+    uint64_t num_bodies = 0;
+    uint64_t num_frames = 0;
+    /// @brief Time between two output frames.
+    double timestep = 0;
+    /// @brief Bounding box of the positions of all bodies.
+    double min[3] = { 0, 0, 0 };
+    double max[3] = { 0, 0, 0 };
+
+    bool is_valid() const;
+};
+
+/// @brief Pose sequence compressed to per-body keyframes.
+///
+/// The sequence is decimated to the output frame rate, positions are
+/// quantized to 16 bits in the bounding box of the sequence, and rotations
+/// use the smallest-three encoding. A keyframe is only kept when linearly
+/// interpolating (slerp for rotations) the neighbouring ones exceeds the
+/// tolerances, so resting or sleeping bodies and bodies in free flight
+/// without rotation only need a few keyframes.
+class KeyframeSequence {
+public:
+    /// @brief Compress the frames of a sequence (read twice, in order).
+    bool compress(
+        int dim,
+        size_t num_bodies,
+        size_t num_frames,
+        double timestep,
+        const PoseFrameReader& read_frame,
+        const KeyframeSettings& settings = KeyframeSettings());
+
+    /// @brief Poses of the ith output frame.
+    void frame(size_t i, PosesD& poses) const;
+
+    int dim() const { return m_header.dim; }
+    size_t num_bodies() const { return m_keyframes.size(); }
+    size_t num_frames() const { return m_header.num_frames; }
+    double timestep() const { return m_header.timestep; }
+    /// @brief Total number of keyframes of all bodies.
+    size_t num_keyframes() const;
+    const std::vector<Keyframe>& keyframes(size_t body) const
+    {
+        return m_keyframes[body];
+    }
+
+    bool write(const std::string& filename) const;
+    bool read(const std::string& filename);
+
+protected:
+    std::array<uint16_t, 3> quantize_position(const Eigen::Vector3d& p) const;
+    Eigen::Vector3d dequantize_position(const std::array<uint16_t, 3>& q) const;
+    /// @brief Position and rotation of a body at frame i between two of its
+    /// keyframes.
+    void interpolate(
+        const Keyframe& k0,
+        const Keyframe& k1,
+        size_t i,
+        Eigen::Vector3d& position,
+        Eigen::Quaterniond& rotation) const;
+
+    KeyframeHeader m_header;
+    std::vector<std::vector<Keyframe>> m_keyframes;
+};
+
+} // namespace ipc::rigid
@@ -0,0 +1,47 @@
+#include "mapped_file.hpp"
+
+#if defined(__unix__) || defined(__APPLE__)
+#define RIGID_IPC_HAS_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace ipc::rigid {
+
+bool MappedFile::open(const std::string& filename)
+{
+    close();
+
+#ifdef RIGID_IPC_HAS_MMAP
+    int fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) == 0 && st.st_size > 0) {
+        void* data = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+        if (data != MAP_FAILED) {
+            m_data = static_cast<const char*>(data);
+            m_size = st.st_size;
+        }
+    }
+    ::close(fd); // The mapping stays valid after closing
+#endif
+
+    return is_open();
+}
+
+void MappedFile::close()
+{
+#ifdef RIGID_IPC_HAS_MMAP
+    if (m_data != nullptr) {
+        munmap(const_cast<char*>(m_data), m_size);
+    }
+#endif
+    m_data = nullptr;
+    m_size = 0;
+}
+
+} // namespace ipc::rigid
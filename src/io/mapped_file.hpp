@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+namespace ipc::rigid {
+
+/// @brief Read-only memory mapping of a whole file.
+///
+/// Only available on POSIX systems; elsewhere open() always fails and the
+/// callers fall back to regular file streams.
+class MappedFile {
+public:
+    MappedFile() = default;
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    ~MappedFile() { close(); }
+
+    /// @brief Map the file (returns false if it cannot be mapped).
+    bool open(const std::string& filename);
+    void close();
+
+    bool is_open() const { return m_data != nullptr; }
+    const char* data() const { return m_data; }
+    size_t size() const { return m_size; }
+
+protected:
+    const char* m_data = nullptr;
+    size_t m_size = 0;
+};
+
+} // namespace ipc::rigid
@@ -0,0 +1,385 @@
+#include "mesh_cache.hpp"
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <random>
+
+#include <fmt/format.h>
+#include <ghc/fs_std.hpp> // filesystem
+#include <igl/edges.h>
+#include <igl/read_triangle_mesh.h>
+
+#include <io/read_obj.hpp>
+#include <logger.hpp>
+
+namespace ipc::rigid {
+
+namespace {
+    const char MESH_CACHE_MAGIC[8] = { 'R', 'I', 'P', 'C', 'M', 'E', 'S', 'H' };
+    /// @brief Bump when the parsing or the layout of the cache changes.
+    const uint32_t MESH_CACHE_VERSION = 1;
+    const char DISTANCE_FIELD_CACHE_MAGIC[8] = { 'R', 'I', 'P', 'C',
+                                                 'S', 'D', 'F', '\0' };
+    /// @brief Bump when the sampling or the layout of the fields changes.
+    const uint32_t DISTANCE_FIELD_CACHE_VERSION = 1;
+    const char LOD_CACHE_MAGIC[8] = { 'R', 'I', 'P', 'C', 'L', 'O', 'D', '\0' };
+    /// @brief Bump when the simplification or the layout of the levels
+    /// changes.
+    const uint32_t LOD_CACHE_VERSION = 1;
+
+    /// @brief 64-bit FNV-1a hash.
+    uint64_t hash_bytes(const std::string& bytes)
+    {
+        uint64_t hash = 0xcbf29ce484222325ULL;
+        for (const char c : bytes) {
+            hash ^= uint8_t(c);
+            hash *= 0x100000001b3ULL;
+        }
+        return hash;
+    }
+
+    template <typename Matrix>
+    void append_bytes(std::string& bytes, const Matrix& M)
+    {
+        const int64_t size[2] = { M.rows(), M.cols() };
+        bytes.append(reinterpret_cast<const char*>(size), sizeof(size));
+        bytes.append(
+            reinterpret_cast<const char*>(M.data()),
+            M.size() * sizeof(typename Matrix::Scalar));
+    }
+
+    template <typename Matrix>
+    void write_matrix(std::ofstream& file, const Matrix& M)
+    {
+        const int64_t size[2] = { M.rows(), M.cols() };
+        file.write(reinterpret_cast<const char*>(size), sizeof(size));
+        file.write(
+            reinterpret_cast<const char*>(M.data()),
+            M.size() * sizeof(typename Matrix::Scalar));
+    }
+
+    template <typename Matrix> bool read_matrix(std::ifstream& file, Matrix& M)
+    {
+        int64_t size[2];
+        if (!file.read(reinterpret_cast<char*>(size), sizeof(size))
+            || size[0] < 0 || size[1] < 0) {
+            return false;
+        }
+        M.resize(size[0], size[1]);
+        file.read(
+            reinterpret_cast<char*>(M.data()),
+            M.size() * sizeof(typename Matrix::Scalar));
+        return bool(file);
+    }
+
+    bool read_mesh(
+        const std::string& filename,
+        Eigen::MatrixXd& V,
+        Eigen::MatrixXi& E,
+        Eigen::MatrixXi& F)
+    {
+        if (fs::path(filename).extension() == ".obj") {
+            return read_obj(filename, V, E, F);
+        }
+        bool success = igl::read_triangle_mesh(filename, V, F);
+        // Initialize edges
+        if (F.size()) {
+            igl::edges(F, E);
+        }
+        return success;
+    }
+
+    bool read_cache(
+        const std::string& filename,
+        uint64_t hash,
+        Eigen::MatrixXd& V,
+        Eigen::MatrixXi& E,
+        Eigen::MatrixXi& F)
+    {
+        std::ifstream file(filename, std::ios::binary);
+        if (!file) {
+            return false;
+        }
+        char magic[sizeof(MESH_CACHE_MAGIC)];
+        uint32_t version;
+        uint64_t file_hash;
+        file.read(magic, sizeof(magic));
+        file.read(reinterpret_cast<char*>(&version), sizeof(version));
+        file.read(reinterpret_cast<char*>(&file_hash), sizeof(file_hash));
+        return file && std::memcmp(magic, MESH_CACHE_MAGIC, sizeof(magic)) == 0
+            && version == MESH_CACHE_VERSION && file_hash == hash
+            && read_matrix(file, V) && read_matrix(file, E)
+            && read_matrix(file, F);
+    }
+
+    /// @brief Write to a temporary file first so concurrent runs never see
+    /// partial data.
+    template <typename Write>
+    void write_atomically(const std::string& filename, Write write)
+    {
+        const std::string tmp_filename =
+            fmt::format("{}.{:08x}.tmp", filename, std::random_device()());
+        {
+            std::ofstream file(tmp_filename, std::ios::binary);
+            if (!file) {
+                return;
+            }
+            write(file);
+        }
+        std::error_code ec;
+        fs::rename(tmp_filename, filename, ec);
+        if (ec) {
+            fs::remove(tmp_filename, ec);
+        }
+    }
+
+    void write_cache(
+        const std::string& filename,
+        uint64_t hash,
+        const Eigen::MatrixXd& V,
+        const Eigen::MatrixXi& E,
+        const Eigen::MatrixXi& F)
+    {
+        write_atomically(filename, [&](std::ofstream& file) {
+            file.write(MESH_CACHE_MAGIC, sizeof(MESH_CACHE_MAGIC));
+            file.write(
+                reinterpret_cast<const char*>(&MESH_CACHE_VERSION),
+                sizeof(MESH_CACHE_VERSION));
+            file.write(reinterpret_cast<const char*>(&hash), sizeof(hash));
+            write_matrix(file, V);
+            write_matrix(file, E);
+            write_matrix(file, F);
+        });
+    }
+
+    bool read_distance_field_cache(
+        const std::string& filename,
+        uint64_t hash,
+        SparseDistanceField& field)
+    {
+        std::ifstream file(filename, std::ios::binary);
+        if (!file) {
+            return false;
+        }
+        char magic[sizeof(DISTANCE_FIELD_CACHE_MAGIC)];
+        uint32_t version;
+        uint64_t file_hash;
+        file.read(magic, sizeof(magic));
+        file.read(reinterpret_cast<char*>(&version), sizeof(version));
+        file.read(reinterpret_cast<char*>(&file_hash), sizeof(file_hash));
+        return file
+            && std::memcmp(magic, DISTANCE_FIELD_CACHE_MAGIC, sizeof(magic))
+            == 0
+            && version == DISTANCE_FIELD_CACHE_VERSION && file_hash == hash
+            && field.read(file);
+    }
+
+    void write_distance_field_cache(
+        const std::string& filename,
+        uint64_t hash,
+        const SparseDistanceField& field)
+    {
+        write_atomically(filename, [&](std::ofstream& file) {
+            file.write(
+                DISTANCE_FIELD_CACHE_MAGIC, sizeof(DISTANCE_FIELD_CACHE_MAGIC));
+            file.write(
+                reinterpret_cast<const char*>(&DISTANCE_FIELD_CACHE_VERSION),
+                sizeof(DISTANCE_FIELD_CACHE_VERSION));
+            file.write(reinterpret_cast<const char*>(&hash), sizeof(hash));
+            field.write(file);
+        });
+    }
+
+    bool read_lod_cache(
+        const std::string& filename, uint64_t hash, std::vector<MeshLOD>& lods)
+    {
+        std::ifstream file(filename, std::ios::binary);
+        if (!file) {
+            return false;
+        }
+        char magic[sizeof(LOD_CACHE_MAGIC)];
+        uint32_t version;
+        uint64_t file_hash, num_lods;
+        file.read(magic, sizeof(magic));
+        file.read(reinterpret_cast<char*>(&version), sizeof(version));
+        file.read(reinterpret_cast<char*>(&file_hash), sizeof(file_hash));
+        file.read(reinterpret_cast<char*>(&num_lods), sizeof(num_lods));
+        if (!file || std::memcmp(magic, LOD_CACHE_MAGIC, sizeof(magic)) != 0
+            || version != LOD_CACHE_VERSION || file_hash != hash) {
+            return false;
+        }
+        lods.resize(num_lods);
+        for (MeshLOD& lod : lods) {
+            if (!read_matrix(file, lod.vertices)
+                || !read_matrix(file, lod.edges)
+                || !read_matrix(file, lod.faces)) {
+                lods.clear();
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void write_lod_cache(
+        const std::string& filename,
+        uint64_t hash,
+        const std::vector<MeshLOD>& lods)
+    {
+        write_atomically(filename, [&](std::ofstream& file) {
+            file.write(LOD_CACHE_MAGIC, sizeof(LOD_CACHE_MAGIC));
+            file.write(
+                reinterpret_cast<const char*>(&LOD_CACHE_VERSION),
+                sizeof(LOD_CACHE_VERSION));
+            file.write(reinterpret_cast<const char*>(&hash), sizeof(hash));
+            const uint64_t num_lods = lods.size();
+            file.write(
+                reinterpret_cast<const char*>(&num_lods), sizeof(num_lods));
+            for (const MeshLOD& lod : lods) {
+                write_matrix(file, lod.vertices);
+                write_matrix(file, lod.edges);
+                write_matrix(file, lod.faces);
+            }
+        });
+    }
+} // namespace
+
+std::string mesh_cache_directory()
+{
+    const char* dir = std::getenv("RIGID_IPC_MESH_CACHE_DIR");
+    if (dir != nullptr) {
+        return dir;
+    }
+    std::error_code ec;
+    fs::path tmp_dir = fs::temp_directory_path(ec);
+    return ec ? "" : (tmp_dir / "rigid-ipc-mesh-cache").string();
+}
+
+bool read_mesh_cached(
+    const std::string& filename,
+    Eigen::MatrixXd& V,
+    Eigen::MatrixXi& E,
+    Eigen::MatrixXi& F)
+{
+    const std::string cache_dir = mesh_cache_directory();
+    if (cache_dir.empty()) {
+        return read_mesh(filename, V, E, F);
+    }
+
+    std::ifstream file(filename, std::ios::binary | std::ios::ate);
+    if (!file) {
+        spdlog::error("unable to open mesh filename={}", filename);
+        return false;
+    }
+    std::string contents(size_t(file.tellg()), '\0');
+    file.seekg(0);
+    file.read(&contents[0], contents.size());
+    file.close();
+
+    // The extension selects the parser, so it is part of the key
+    contents += fs::path(filename).extension().string();
+    const uint64_t hash = hash_bytes(contents);
+    const std::string cache_filename =
+        (fs::path(cache_dir) / fmt::format("{:016x}.mesh", hash)).string();
+
+    if (read_cache(cache_filename, hash, V, E, F)) {
+        RIGID_IPC_LOG_DEBUG(
+            "mesh_cache status=hit filename={} cache={}", filename,
+            cache_filename);
+        return true;
+    }
+
+    if (!read_mesh(filename, V, E, F)) {
+        return false;
+    }
+    std::error_code ec;
+    fs::create_directories(cache_dir, ec);
+    write_cache(cache_filename, hash, V, E, F);
+    RIGID_IPC_LOG_DEBUG(
+        "mesh_cache status=miss filename={} cache={}", filename,
+        cache_filename);
+    return true;
+}
+
+std::shared_ptr<const SparseDistanceField> build_distance_field_cached(
+    const Eigen::MatrixXd& V,
+    const Eigen::MatrixXi& E,
+    const Eigen::MatrixXi& F,
+    double cell_size,
+    double band_width)
+{
+    const std::string cache_dir = mesh_cache_directory();
+    if (cache_dir.empty()) {
+        return std::make_shared<const SparseDistanceField>(
+            V, E, F, cell_size, band_width);
+    }
+
+    std::string bytes;
+    append_bytes(bytes, V);
+    append_bytes(bytes, E);
+    append_bytes(bytes, F);
+    bytes.append(reinterpret_cast<const char*>(&cell_size), sizeof(double));
+    bytes.append(reinterpret_cast<const char*>(&band_width), sizeof(double));
+    const uint64_t hash = hash_bytes(bytes);
+    const std::string cache_filename =
+        (fs::path(cache_dir) / fmt::format("{:016x}.sdf", hash)).string();
+
+    auto field = std::make_shared<SparseDistanceField>();
+    if (read_distance_field_cache(cache_filename, hash, *field)) {
+        RIGID_IPC_LOG_DEBUG(
+            "distance_field_cache status=hit num_nodes={:d} cache={}",
+            field->num_nodes(), cache_filename);
+        return field;
+    }
+
+    *field = SparseDistanceField(V, E, F, cell_size, band_width);
+    std::error_code ec;
+    fs::create_directories(cache_dir, ec);
+    write_distance_field_cache(cache_filename, hash, *field);
+    RIGID_IPC_LOG_DEBUG(
+        "distance_field_cache status=miss num_nodes={:d} cache={}",
+        field->num_nodes(), cache_filename);
+    return field;
+}
+
+std::vector<MeshLOD> build_mesh_lods_cached(
+    const Eigen::MatrixXd& V,
+    const Eigen::MatrixXi& E,
+    const Eigen::MatrixXi& F,
+    long min_primitives)
+{
+    const std::string cache_dir = mesh_cache_directory();
+    if (cache_dir.empty()) {
+        return build_mesh_lods(V, E, F, min_primitives);
+    }
+
+    std::string bytes;
+    append_bytes(bytes, V);
+    append_bytes(bytes, E);
+    append_bytes(bytes, F);
+    bytes.append(
+        reinterpret_cast<const char*>(&min_primitives), sizeof(long));
+    const uint64_t hash = hash_bytes(bytes);
+    const std::string cache_filename =
+        (fs::path(cache_dir) / fmt::format("{:016x}.lod", hash)).string();
+
+    std::vector<MeshLOD> lods;
+    if (read_lod_cache(cache_filename, hash, lods)) {
+        RIGID_IPC_LOG_DEBUG(
+            "lod_cache status=hit num_lods={:d} cache={}", lods.size(),
+            cache_filename);
+        return lods;
+    }
+
+    lods = build_mesh_lods(V, E, F, min_primitives);
+    std::error_code ec;
+    fs::create_directories(cache_dir, ec);
+    write_lod_cache(cache_filename, hash, lods);
+    RIGID_IPC_LOG_DEBUG(
+        "lod_cache status=miss num_lods={:d} cache={}", lods.size(),
+        cache_filename);
+    return lods;
+}
+
+} // namespace ipc::rigid
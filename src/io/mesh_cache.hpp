@@ -0,0 +1,58 @@
+#pragma once
+
+#include <memory>
+#include <string>
+
+#include <Eigen/Core>
+
+#include <geometry/mesh_lod.hpp>
+#include <geometry/sparse_distance_field.hpp>
+
+namespace ipc::rigid {
+
+/// @brief Read a mesh file (obj or any format libigl reads) with its edges.
+///
+/// A binary copy of the parsed mesh is kept in mesh_cache_directory(), keyed
+/// on a hash of the file contents, so later runs skip parsing the file.
+///
+/// @param[in] filename  Path to the mesh file.
+/// @param[out] V        Vertex positions.
+/// @param[out] E        Edges (polylines followed by the edges of the faces).
+/// @param[out] F        Faces.
+/// @returns true on success, false on errors
+bool read_mesh_cached(
+    const std::string& filename,
+    Eigen::MatrixXd& V,
+    Eigen::MatrixXi& E,
+    Eigen::MatrixXi& F);
+
+/// @brief Build the distance field of a mesh, reusing a copy kept in
+/// mesh_cache_directory() keyed on a hash of the mesh and field parameters.
+///
+/// @param[in] V           Vertex positions (in the frame of the field).
+/// @param[in] E           Edges.
+/// @param[in] F           Faces.
+/// @param[in] cell_size   Spacing of the grid nodes.
+/// @param[in] band_width  Largest stored distance.
+std::shared_ptr<const SparseDistanceField> build_distance_field_cached(
+    const Eigen::MatrixXd& V,
+    const Eigen::MatrixXi& E,
+    const Eigen::MatrixXi& F,
+    double cell_size,
+    double band_width);
+
+/// @brief Build the levels of detail of a mesh (see build_mesh_lods), reusing
+/// a copy kept in mesh_cache_directory() keyed on a hash of the mesh.
+std::vector<MeshLOD> build_mesh_lods_cached(
+    const Eigen::MatrixXd& V,
+    const Eigen::MatrixXi& E,
+    const Eigen::MatrixXi& F,
+    long min_primitives);
+
+/// @brief Directory of the binary mesh cache.
+///
+/// Set by the RIGID_IPC_MESH_CACHE_DIR environment variable (an empty value
+/// disables the cache), otherwise a directory in the system temporary path.
+std::string mesh_cache_directory();
+
+} // namespace ipc::rigid
@@ -0,0 +1,284 @@
+#include "metrics_exporter.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+
+#ifndef _WIN32
+#include <netdb.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+#include <logger.hpp>
+
+namespace ipc::rigid {
+
+namespace {
+    /// @brief Largest StatsD datagram that avoids IP fragmentation.
+    const size_t MAX_DATAGRAM_BYTES = 1432;
+
+    void flatten_into(
+        const nlohmann::json& value,
+        const std::string& name,
+        MetricsExporter::Gauges& gauges)
+    {
+        if (value.is_object()) {
+            for (const auto& [key, child] : value.items()) {
+                flatten_into(
+                    child, name.empty() ? key : name + "_" + key, gauges);
+            }
+        } else if (value.is_array()) {
+            for (size_t i = 0; i < value.size(); i++) {
+                flatten_into(
+                    value[i], fmt::format("{}_{:d}", name, i), gauges);
+            }
+        } else if (value.is_number() || value.is_boolean()) {
+            const double x = value.is_boolean() ? double(value.get<bool>())
+                                                : value.get<double>();
+            if (std::isfinite(x)) {
+                gauges.emplace_back(name, x);
+            }
+        }
+    }
+
+    /// @brief Keep only the characters valid in Prometheus names.
+    std::string sanitize(const std::string& name)
+    {
+        std::string sanitized = name;
+        for (char& c : sanitized) {
+            if (!std::isalnum(static_cast<unsigned char>(c))) {
+                c = '_';
+            }
+        }
+        return sanitized;
+    }
+
+#ifndef _WIN32
+    /// @brief Open a socket bound (server) or connected (client) to the
+    /// first usable address of the host and port.
+    int open_socket(
+        const std::string& host, int port, int socket_type, bool is_server)
+    {
+        addrinfo hints = {};
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = socket_type;
+        hints.ai_flags = is_server ? AI_PASSIVE : 0;
+        addrinfo* addresses = nullptr;
+        const std::string service = std::to_string(port);
+        if (getaddrinfo(
+                host.empty() ? nullptr : host.c_str(), service.c_str(), &hints,
+                &addresses)
+            != 0) {
+            return -1;
+        }
+        int fd = -1;
+        for (addrinfo* a = addresses; a != nullptr && fd < 0; a = a->ai_next) {
+            fd = socket(a->ai_family, a->ai_socktype, a->ai_protocol);
+            if (fd < 0) {
+                continue;
+            }
+            bool is_ready;
+            if (is_server) {
+                const int reuse = 1;
+                setsockopt(
+                    fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+                is_ready = bind(fd, a->ai_addr, a->ai_addrlen) == 0
+                    && listen(fd, 4) == 0;
+            } else {
+                is_ready = connect(fd, a->ai_addr, a->ai_addrlen) == 0;
+            }
+            if (!is_ready) {
+                ::close(fd);
+                fd = -1;
+            }
+        }
+        freeaddrinfo(addresses);
+        return fd;
+    }
+
+    void write_all(int fd, const std::string& data)
+    {
+        for (size_t i = 0; i < data.size();) {
+            const ssize_t n = write(fd, data.data() + i, data.size() - i);
+            if (n <= 0) {
+                break; // The client is gone
+            }
+            i += n;
+        }
+    }
+#endif
+} // namespace
+
+bool MetricsExporter::open(const nlohmann::json& settings)
+{
+    close();
+    const std::string type = settings.value("type", "none");
+    if (type == "none") {
+        return true;
+    } else if (type == "prometheus") {
+        m_type = Type::PROMETHEUS;
+    } else if (type == "statsd") {
+        m_type = Type::STATSD;
+    } else {
+        spdlog::warn("unknown metrics_exporter type={} fallback=none", type);
+        return false;
+    }
+    m_prefix = sanitize(settings.value("prefix", "rigid_ipc"));
+    // An empty host serves on all addresses or pushes to the loopback
+    const std::string host = settings.value("host", "");
+    const nlohmann::json jport = settings.value("port", nlohmann::json());
+    const int port = jport.is_number()
+        ? jport.get<int>()
+        : (m_type == Type::PROMETHEUS ? 9464 : 8125);
+
+#ifndef _WIN32
+    m_socket = open_socket(
+        host, port, m_type == Type::PROMETHEUS ? SOCK_STREAM : SOCK_DGRAM,
+        /*is_server=*/m_type == Type::PROMETHEUS);
+#endif
+    if (m_socket < 0) {
+        spdlog::error(
+            "unable to open metrics_exporter type={} host={} port={:d}", type,
+            host, port);
+        m_type = Type::NONE;
+        return false;
+    }
+    spdlog::info(
+        "metrics_exporter action=open type={} host={} port={:d}", type, host,
+        port);
+    if (m_type == Type::PROMETHEUS) {
+        m_is_stopping = false;
+        m_server = std::thread(&MetricsExporter::serve, this);
+    }
+    return true;
+}
+
+void MetricsExporter::publish(const nlohmann::json& record)
+{
+    if (!is_open()) {
+        return;
+    }
+    const Gauges gauges = flatten(record);
+    if (m_type == Type::PROMETHEUS) {
+        std::string exposition = prometheus_text(m_prefix, gauges);
+        std::lock_guard<std::mutex> lock(m_exposition_mutex);
+        m_exposition.swap(exposition);
+    } else {
+        push(statsd_text(m_prefix, gauges));
+    }
+}
+
+void MetricsExporter::close()
+{
+    m_is_stopping = true;
+    if (m_server.joinable()) {
+        m_server.join();
+    }
+#ifndef _WIN32
+    if (m_socket >= 0) {
+        ::close(m_socket);
+    }
+#endif
+    m_socket = -1;
+    m_type = Type::NONE;
+    std::lock_guard<std::mutex> lock(m_exposition_mutex);
+    m_exposition.clear();
+}
+
+MetricsExporter::Gauges MetricsExporter::flatten(const nlohmann::json& record)
+{
+    Gauges gauges;
+    flatten_into(record, "", gauges);
+    for (auto& [name, value] : gauges) {
+        name = sanitize(name);
+    }
+    return gauges;
+}
+
+std::string MetricsExporter::prometheus_text(
+    const std::string& prefix, const Gauges& gauges)
+{
+    std::string text;
+    for (const auto& [name, value] : gauges) {
+        const std::string metric = prefix + "_" + name;
+        text += fmt::format(
+            "# TYPE {} gauge\n{} {:.17g}\n", metric, metric, value);
+    }
+    return text;
+}
+
+std::string
+MetricsExporter::statsd_text(const std::string& prefix, const Gauges& gauges)
+{
+    std::string text;
+    for (const auto& [name, value] : gauges) {
+        text += fmt::format("{}.{}:{:.17g}|g\n", prefix, name, value);
+    }
+    return text;
+}
+
+void MetricsExporter::serve()
+{
+#ifndef _WIN32
+    while (!m_is_stopping) {
+        // Wake up regularly to check if the exporter is closing
+        pollfd server = { m_socket, POLLIN, 0 };
+        if (poll(&server, 1, /*timeout=*/200) <= 0) {
+            continue;
+        }
+        const int client = accept(m_socket, nullptr, nullptr);
+        if (client < 0) {
+            continue;
+        }
+        // Only the request line matters (the rest of the request is ignored)
+        char request[1024];
+        pollfd readable = { client, POLLIN, 0 };
+        ssize_t n = 0;
+        if (poll(&readable, 1, /*timeout=*/1000) > 0) {
+            n = read(client, request, sizeof(request) - 1);
+        }
+        const std::string request_line(request, std::max<ssize_t>(n, 0));
+        std::string body, status = "200 OK";
+        if (request_line.rfind("GET /metrics", 0) == 0
+            || request_line.rfind("GET / ", 0) == 0) {
+            std::lock_guard<std::mutex> lock(m_exposition_mutex);
+            body = m_exposition;
+        } else {
+            status = "404 Not Found";
+        }
+        write_all(
+            client,
+            fmt::format(
+                "HTTP/1.0 {}\r\nContent-Type: text/plain; version=0.0.4\r\n"
+                "Content-Length: {:d}\r\nConnection: close\r\n\r\n{}",
+                status, body.size(), body));
+        ::close(client);
+    }
+#endif
+}
+
+void MetricsExporter::push(const std::string& text)
+{
+#ifndef _WIN32
+    // Split the lines into datagrams without cutting a line
+    size_t begin = 0;
+    while (begin < text.size()) {
+        size_t end = begin;
+        while (end < text.size()) {
+            size_t next = text.find('\n', end);
+            next = next == std::string::npos ? text.size() : next + 1;
+            if (next - begin > MAX_DATAGRAM_BYTES && end > begin) {
+                break;
+            }
+            end = next;
+        }
+        // A failed send only drops this step's gauges
+        send(m_socket, text.data() + begin, end - begin, 0);
+        begin = end;
+    }
+#endif
+}
+
+} // namespace ipc::rigid
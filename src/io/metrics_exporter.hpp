@@ -0,0 +1,79 @@
+#pragma once
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <nlohmann/json.hpp>
+
+namespace ipc::rigid {
+
+/// @brief Publisher of the metrics of the latest time-step to a monitoring
+/// system, either served in the Prometheus text format over HTTP or pushed to
+/// StatsD as gauges over UDP.
+///
+/// Records are flattened to numeric gauges (nested objects join their keys
+/// with underscores, array elements append their index, and non-numeric
+/// values are skipped) named prefix_key for Prometheus and prefix.key for
+/// StatsD.
+/// Only POSIX sockets are supported.
+class MetricsExporter {
+public:
+    enum class Type { NONE, PROMETHEUS, STATSD };
+
+    MetricsExporter() = default;
+    MetricsExporter(const MetricsExporter&) = delete;
+    MetricsExporter& operator=(const MetricsExporter&) = delete;
+    ~MetricsExporter() { close(); }
+
+    /// @brief Start serving or open the socket to push to.
+    /// @param settings Object with the "type" ("none", "prometheus", or
+    /// "statsd"), "host", "port" (null for the type's default), and
+    /// "prefix" of the metric names.
+    /// @returns False if the type is unknown or the socket cannot be opened.
+    bool open(const nlohmann::json& settings);
+
+    /// @brief Publish the record of the latest time-step.
+    void publish(const nlohmann::json& record);
+
+    /// @brief Stop serving and close the socket.
+    void close();
+
+    bool is_open() const { return m_socket >= 0; }
+    Type type() const { return m_type; }
+
+    typedef std::vector<std::pair<std::string, double>> Gauges;
+
+    /// @brief Numeric values of a record keyed by their sanitized names.
+    static Gauges flatten(const nlohmann::json& record);
+
+    /// @brief Prometheus text exposition of the gauges.
+    static std::string
+    prometheus_text(const std::string& prefix, const Gauges& gauges);
+
+    /// @brief StatsD gauge lines of the gauges.
+    static std::string
+    statsd_text(const std::string& prefix, const Gauges& gauges);
+
+protected:
+    /// @brief Answer scrapes until close() is called.
+    void serve();
+
+    /// @brief Send the text in datagrams of whole lines.
+    void push(const std::string& text);
+
+    Type m_type = Type::NONE;
+    std::string m_prefix = "rigid_ipc";
+    int m_socket = -1;
+
+    /// @brief Prometheus exposition of the latest record.
+    std::string m_exposition;
+    std::mutex m_exposition_mutex;
+    std::atomic<bool> m_is_stopping { false };
+    std::thread m_server;
+};
+
+} // namespace ipc::rigid
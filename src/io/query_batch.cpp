@@ -0,0 +1,143 @@
+#include "query_batch.hpp"
+
+#include <fstream>
+#include <stdexcept>
+
+#include <tbb/pipeline.h>
+#include <tbb/task_scheduler_init.h>
+
+#include <io/read_rb_scene.hpp>
+#include <io/serialize_json.hpp>
+#include <logger.hpp>
+
+namespace ipc::rigid {
+
+size_t run_query_batch(
+    std::istream& input,
+    std::ostream& output,
+    const std::function<nlohmann::json(const nlohmann::json&)>& evaluate,
+    size_t max_queries_in_flight)
+{
+    using nlohmann::json;
+
+    struct Query {
+        size_t index;
+        std::string line;
+        json result;
+    };
+    typedef std::shared_ptr<Query> QueryPtr;
+
+    if (max_queries_in_flight == 0) {
+        max_queries_in_flight =
+            2 * tbb::task_scheduler_init::default_num_threads();
+    }
+
+    size_t num_queries = 0, num_failed = 0;
+    tbb::parallel_pipeline(
+        max_queries_in_flight,
+        tbb::make_filter<void, QueryPtr>(
+            tbb::filter::serial_in_order,
+            [&](tbb::flow_control& control) -> QueryPtr {
+                auto query = std::make_shared<Query>();
+                do {
+                    if (!std::getline(input, query->line)) {
+                        control.stop();
+                        return nullptr;
+                    }
+                } while (query->line.find_first_not_of(" \t\r")
+                         == std::string::npos);
+                query->index = num_queries++;
+                return query;
+            })
+            & tbb::make_filter<QueryPtr, QueryPtr>(
+                tbb::filter::parallel,
+                [&](const QueryPtr& query) {
+                    json jquery = json::parse(query->line, nullptr, false);
+                    if (jquery.is_discarded() || !jquery.is_object()) {
+                        query->result["error"] = "invalid query";
+                    } else {
+                        try {
+                            query->result = evaluate(jquery);
+                        } catch (const std::exception& e) {
+                            query->result = json::object();
+                            query->result["error"] = e.what();
+                        }
+                    }
+                    query->result["index"] = query->index;
+                    return query;
+                })
+            & tbb::make_filter<QueryPtr, void>(
+                tbb::filter::serial_in_order,
+                [&](const QueryPtr& query) {
+                    if (query->result.contains("error")) {
+                        num_failed++;
+                    }
+                    output << query->result.dump() << '\n';
+                }));
+    output.flush();
+
+    spdlog::info(
+        "batch_queries={:d} failed_queries={:d}", num_queries, num_failed);
+    return num_failed;
+}
+
+PosesD QueryScene::poses(const nlohmann::json& rigid_bodies) const
+{
+    if (!rigid_bodies.is_array()
+        || rigid_bodies.size() != bodies.num_bodies()) {
+        throw std::invalid_argument(fmt::format(
+            "expected the poses of {:d} bodies", bodies.num_bodies()));
+    }
+    PosesD poses(bodies.num_bodies());
+    for (size_t i = 0; i < poses.size(); i++) {
+        from_json(rigid_bodies[i]["position"], poses[i].position);
+        from_json(rigid_bodies[i]["rotation"], poses[i].rotation);
+    }
+    return poses;
+}
+
+PosesD QueryScene::state_poses(size_t i) const
+{
+    if (i >= state_sequence.size()) {
+        throw std::out_of_range(fmt::format(
+            "state {:d} is not one of the {:d} states", i,
+            state_sequence.size()));
+    }
+    return poses(state_sequence[i]["rigid_bodies"]);
+}
+
+std::shared_ptr<const QueryScene>
+QuerySceneCache::get(const std::string& filename)
+{
+    // Queries of a scene being loaded wait for it instead of loading it again
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_scenes.find(filename);
+    if (it != m_scenes.end()) {
+        return it->second;
+    }
+
+    std::ifstream input(filename);
+    nlohmann::json jscene = nlohmann::json::parse(input, nullptr, false);
+    if (jscene.is_discarded()) {
+        throw std::invalid_argument("invalid scene " + filename);
+    }
+
+    auto scene = std::make_shared<QueryScene>();
+    std::vector<RigidBody> rbs;
+    if (!read_rb_scene(jscene["args"]["rigid_body_problem"], rbs)) {
+        throw std::invalid_argument("invalid bodies in scene " + filename);
+    }
+    scene->bodies.init(rbs);
+    if (jscene["animation"]["state_sequence"].is_array()) {
+        scene->state_sequence = jscene["animation"]["state_sequence"]
+                                    .get<std::vector<nlohmann::json>>();
+    }
+    spdlog::info(
+        "loaded_scene={} bodies={:d} states={:d}", filename,
+        scene->bodies.num_bodies(), scene->state_sequence.size());
+
+    m_scenes.emplace(filename, scene);
+    return scene;
+}
+
+} // namespace ipc::rigid
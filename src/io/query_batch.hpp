@@ -0,0 +1,58 @@
+#pragma once
+
+#include <functional>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <nlohmann/json.hpp>
+
+#include <physics/rigid_body_assembler.hpp>
+
+namespace ipc::rigid {
+
+/// @brief Evaluate a stream of JSON lines queries in parallel.
+///
+/// Each non-empty input line is a JSON object passed to evaluate(). The
+/// result objects are written one per line in input order with the query's
+/// "index" (its number among the non-empty lines) added. A query that is
+/// not valid JSON or whose evaluation throws is answered with an "error".
+///
+/// @param input                  Stream of queries.
+/// @param output                 Stream for the results.
+/// @param evaluate               Computes the result of a query.
+/// @param max_queries_in_flight  Bound on the buffered queries (twice the
+///                               number of threads if zero).
+/// @returns the number of failed queries
+size_t run_query_batch(
+    std::istream& input,
+    std::ostream& output,
+    const std::function<nlohmann::json(const nlohmann::json&)>& evaluate,
+    size_t max_queries_in_flight = 0);
+
+/// @brief Bodies and saved states of a simulation queried in a batch.
+struct QueryScene {
+    RigidBodyAssembler bodies;
+    std::vector<nlohmann::json> state_sequence;
+
+    /// @brief Poses from a list of {"position", "rotation"} objects.
+    PosesD poses(const nlohmann::json& rigid_bodies) const;
+    /// @brief Poses of the i-th saved state.
+    PosesD state_poses(size_t i) const;
+};
+
+/// @brief Simulations shared by the queries of a batch, loaded on first use.
+class QuerySceneCache {
+public:
+    /// @brief Scene of a simulation JSON file (throws if it is invalid).
+    std::shared_ptr<const QueryScene> get(const std::string& filename);
+
+protected:
+    std::mutex m_mutex;
+    std::map<std::string, std::shared_ptr<const QueryScene>> m_scenes;
+};
+
+} // namespace ipc::rigid
@@ -0,0 +1,243 @@
+#include "read_json.hpp"
+
+#include <fstream>
+#include <iterator>
+#include <vector>
+
+#include <io/mapped_file.hpp>
+#include <io/serialize_json.hpp>
+#include <logger.hpp>
+
+namespace ipc::rigid {
+
+namespace {
+
+    /// @brief Reference tokens of a JSON pointer (e.g., "/a/b" -> {a, b}).
+    std::vector<std::string> split_json_pointer(const std::string& pointer)
+    {
+        std::vector<std::string> tokens;
+        for (size_t i = 0; i < pointer.size();) {
+            assert(pointer[i] == '/');
+            size_t end = pointer.find('/', i + 1);
+            if (end == std::string::npos) {
+                end = pointer.size();
+            }
+            std::string token;
+            for (size_t j = i + 1; j < end; j++) {
+                if (pointer[j] == '~' && j + 1 < end) {
+                    token += pointer[++j] == '1' ? '/' : '~';
+                } else {
+                    token += pointer[j];
+                }
+            }
+            tokens.push_back(token);
+            i = end;
+        }
+        return tokens;
+    }
+
+    /// @brief SAX handler building a DOM with packed meshes and a streamed
+    /// array.
+    class JsonReader {
+    public:
+        using json = nlohmann::json;
+
+        JsonReader(
+            json& root,
+            const std::string& streamed_pointer,
+            const JsonElementCallback& element_callback)
+            : m_root(root)
+            , m_streamed_tokens(split_json_pointer(streamed_pointer))
+            , m_element_callback(element_callback)
+        {
+        }
+
+        bool null() { return add_value(nullptr); }
+        bool boolean(bool value) { return add_value(value); }
+        bool number_integer(json::number_integer_t value)
+        {
+            return add_value(value);
+        }
+        bool number_unsigned(json::number_unsigned_t value)
+        {
+            return add_value(value);
+        }
+        bool number_float(json::number_float_t value, const json::string_t&)
+        {
+            return add_value(value);
+        }
+        bool string(json::string_t& value) { return add_value(value); }
+        bool binary(json::binary_t& value)
+        {
+            return add_value(json::binary(std::move(value)));
+        }
+
+        bool start_object(size_t) { return start_container(json::object()); }
+        bool start_array(size_t) { return start_container(json::array()); }
+        bool end_object() { return end_container(); }
+        bool end_array() { return end_container(); }
+
+        bool key(json::string_t& key)
+        {
+            m_key = key;
+            return true;
+        }
+
+        bool parse_error(
+            size_t position,
+            const std::string&,
+            const nlohmann::detail::exception& e)
+        {
+            spdlog::error(
+                "unable to parse json position={:d} error=\"{}\"", position,
+                e.what());
+            return false;
+        }
+
+    protected:
+        /// @brief Open container of the DOM.
+        struct Frame {
+            json* value;
+            /// @brief Key of the container in its parent object.
+            std::string key;
+            /// @brief Number of streamed pointer tokens matched by the path
+            /// (-1 if the path left the pointer).
+            int num_matched_tokens;
+            bool is_in_rigid_bodies;
+        };
+
+        /// @brief Insert a value in the open container.
+        template <typename T> json* insert(T&& value)
+        {
+            if (m_frames.empty()) {
+                m_root = json(std::forward<T>(value));
+                return &m_root;
+            }
+            json& parent = *m_frames.back().value;
+            if (parent.is_array()) {
+                parent.emplace_back(std::forward<T>(value));
+                return &parent.back();
+            }
+            json& element = parent[m_key];
+            element = json(std::forward<T>(value));
+            return &element;
+        }
+
+        bool is_streaming(const Frame& frame) const
+        {
+            return m_element_callback && !m_streamed_tokens.empty()
+                && frame.value->is_array()
+                && frame.num_matched_tokens == int(m_streamed_tokens.size());
+        }
+
+        /// @brief Hand over the last element of a streamed array.
+        void stream_last_element()
+        {
+            if (!m_frames.empty() && is_streaming(m_frames.back())) {
+                json& array = *m_frames.back().value;
+                m_element_callback(std::move(array.back()));
+                array.erase(array.size() - 1);
+            }
+        }
+
+        template <typename T> bool add_value(T&& value)
+        {
+            insert(std::forward<T>(value));
+            stream_last_element();
+            return true;
+        }
+
+        bool start_container(json&& container)
+        {
+            Frame frame { nullptr, "", -1, false };
+            if (m_frames.empty()) {
+                frame.num_matched_tokens = 0;
+            } else {
+                const Frame& parent = m_frames.back();
+                if (parent.value->is_object()) {
+                    frame.key = m_key;
+                } else {
+                    frame.key = std::to_string(parent.value->size());
+                }
+                const int i = parent.num_matched_tokens;
+                if (i >= 0 && i < int(m_streamed_tokens.size())
+                    && m_streamed_tokens[i] == frame.key) {
+                    frame.num_matched_tokens = i + 1;
+                }
+                frame.is_in_rigid_bodies = parent.is_in_rigid_bodies
+                    || (parent.value->is_object() && m_key == "rigid_bodies");
+                if (parent.value->is_array()) {
+                    frame.key.clear(); // Only object keys select meshes
+                }
+            }
+            frame.value = insert(std::move(container));
+            m_frames.push_back(std::move(frame));
+            return true;
+        }
+
+        bool end_container()
+        {
+            assert(!m_frames.empty());
+            const Frame& frame = m_frames.back();
+            if (frame.is_in_rigid_bodies && frame.value->is_array()
+                && (frame.key == "vertices" || frame.key == "edges"
+                    || frame.key == "faces")) {
+                pack_json_matrix(*frame.value);
+            }
+            m_frames.pop_back();
+            stream_last_element();
+            return true;
+        }
+
+        json& m_root;
+        std::vector<std::string> m_streamed_tokens;
+        const JsonElementCallback& m_element_callback;
+        std::vector<Frame> m_frames;
+        std::string m_key;
+    };
+
+} // namespace
+
+bool read_json_string(
+    const char* begin,
+    const char* end,
+    nlohmann::json& json,
+    const std::string& streamed_pointer,
+    const JsonElementCallback& element_callback)
+{
+    json = nlohmann::json();
+    JsonReader reader(json, streamed_pointer, element_callback);
+    if (!nlohmann::json::sax_parse(begin, end, &reader)) {
+        json = nlohmann::json(nlohmann::json::value_t::discarded);
+        return false;
+    }
+    return true;
+}
+
+bool read_json_file(
+    const std::string& filename,
+    nlohmann::json& json,
+    const std::string& streamed_pointer,
+    const JsonElementCallback& element_callback)
+{
+    MappedFile mapping;
+    if (mapping.open(filename)) {
+        return read_json_string(
+            mapping.data(), mapping.data() + mapping.size(), json,
+            streamed_pointer, element_callback);
+    }
+
+    std::ifstream input(filename, std::ios::binary);
+    if (!input) {
+        spdlog::error("unable to open json filename={}", filename);
+        return false;
+    }
+    const std::string text(
+        (std::istreambuf_iterator<char>(input)),
+        std::istreambuf_iterator<char>());
+    return read_json_string(
+        text.data(), text.data() + text.size(), json, streamed_pointer,
+        element_callback);
+}
+
+} // namespace ipc::rigid
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <functional>
+#include <string>
+
+#include <nlohmann/json.hpp>
+
+namespace ipc::rigid {
+
+/// @brief Callback receiving the elements of a streamed array in order.
+typedef std::function<void(nlohmann::json&&)> JsonElementCallback;
+
+/// @brief Read a scene or simulation JSON file with a SAX parser.
+///
+/// The vertices, edges, and faces of the rigid bodies are packed into binary
+/// matrices as they are parsed (see pack_json_matrix()), so large meshes
+/// never exist as per-number DOM nodes. The elements of the array at
+/// streamed_pointer (e.g., "/animation/state_sequence") are handed to
+/// element_callback as soon as they are complete and the array is left
+/// empty, so at most one of them is held by the parser.
+///
+/// @returns False if the file cannot be read or is not valid JSON.
+bool read_json_file(
+    const std::string& filename,
+    nlohmann::json& json,
+    const std::string& streamed_pointer = "",
+    const JsonElementCallback& element_callback = nullptr);
+
+/// @brief Same as read_json_file() for JSON text in memory.
+bool read_json_string(
+    const char* begin,
+    const char* end,
+    nlohmann::json& json,
+    const std::string& streamed_pointer = "",
+    const JsonElementCallback& element_callback = nullptr);
+
+} // namespace ipc::rigid
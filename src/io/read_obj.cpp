@@ -9,14 +9,18 @@
 
 #include "read_obj.hpp"
 
+#include <algorithm>
 #include <cstdio>
+#include <cstring>
 #include <fstream>
 #include <iostream>
 #include <iterator>
 #include <sstream>
+#include <string_view>
 
 #include <igl/edges.h>
 #include <igl/list_to_matrix.h>
+#include <tbb/parallel_for.h>
 
 #include <logger.hpp>
 
@@ -259,6 +263,10 @@ bool read_obj(
     Eigen::MatrixXi& E,
     Eigen::MatrixXi& F)
 {
+    if (read_obj_fast(str, V, E, F)) {
+        return true;
+    }
+
     std::vector<std::vector<double>> vV, vTC, vN;
     std::vector<std::vector<int>> vF, vFTC, vFN, vL;
     bool success = read_obj(str, vV, vTC, vN, vF, vFTC, vFN, vL);
@@ -298,4 +306,225 @@ bool read_obj(
     return true;
 }
 
+///////////////////////////////////////////////////////////////////////////////
+// Parallel parser
+
+namespace {
+    /// @brief Counts and layout of the elements in a chunk of lines.
+    struct ObjChunk {
+        const char* begin;
+        const char* end;
+        long num_vertices = 0;
+        long num_faces = 0;
+        long num_polyline_edges = 0;
+        int vertex_dim = -1; ///< Coordinates per vertex (-1 if no vertex)
+        int face_degree = -1;
+        bool is_supported = true;
+        // Offsets of the chunk's elements in the whole file
+        long vertex_offset = 0, face_offset = 0, edge_offset = 0;
+    };
+
+    inline bool is_blank(char c) { return c == ' ' || c == '\t' || c == '\r'; }
+
+    inline const char* skip_blanks(const char* c, const char* line_end)
+    {
+        while (c < line_end && is_blank(*c)) {
+            c++;
+        }
+        return c;
+    }
+
+    inline const char* skip_word(const char* c, const char* line_end)
+    {
+        while (c < line_end && !is_blank(*c)) {
+            c++;
+        }
+        return c;
+    }
+
+    /// @brief Call f(type, rest_of_line, line_end) for every line in a chunk.
+    template <typename Func>
+    void for_each_line(const char* begin, const char* end, Func f)
+    {
+        while (begin < end) {
+            const char* line_end =
+                static_cast<const char*>(memchr(begin, '\n', end - begin));
+            if (line_end == nullptr) {
+                line_end = end;
+            }
+            const char* c = skip_blanks(begin, line_end);
+            const char* type_end = skip_word(c, line_end);
+            f(std::string_view(c, type_end - c), type_end, line_end);
+            begin = line_end + 1;
+        }
+    }
+
+    /// @brief Count the numbers on a line.
+    inline int count_words(const char* c, const char* line_end)
+    {
+        int count = 0;
+        while ((c = skip_blanks(c, line_end)) < line_end) {
+            c = skip_word(c, line_end);
+            count++;
+        }
+        return count;
+    }
+
+    /// @brief Convert a one-based or negative obj index to a zero-based one.
+    inline int obj_index(long i, long num_vertices)
+    {
+        return i < 0 ? i + num_vertices : i - 1;
+    }
+} // namespace
+
+bool read_obj_fast(
+    const std::string& obj_file_name,
+    Eigen::MatrixXd& V,
+    Eigen::MatrixXi& E,
+    Eigen::MatrixXi& F)
+{
+    std::ifstream file(obj_file_name, std::ios::binary | std::ios::ate);
+    if (!file) {
+        return false;
+    }
+    std::string buffer(size_t(file.tellg()), '\0');
+    file.seekg(0);
+    file.read(&buffer[0], buffer.size());
+    if (!file) {
+        return false;
+    }
+
+    // Split the file into chunks of whole lines
+    const size_t CHUNK_SIZE = 1 << 20;
+    std::vector<ObjChunk> chunks;
+    const char* data = buffer.data();
+    const char* data_end = data + buffer.size();
+    for (const char* begin = data; begin < data_end;) {
+        const char* end =
+            begin + std::min(CHUNK_SIZE, size_t(data_end - begin));
+        if (end < data_end) {
+            const char* newline =
+                static_cast<const char*>(memchr(end, '\n', data_end - end));
+            end = newline == nullptr ? data_end : newline + 1;
+        }
+        chunks.push_back({ begin, end });
+        begin = end;
+    }
+
+    // First pass: count the elements of each chunk
+    tbb::parallel_for(size_t(0), chunks.size(), [&](size_t ci) {
+        ObjChunk& chunk = chunks[ci];
+        for_each_line(
+            chunk.begin, chunk.end,
+            [&](std::string_view type, const char* c, const char* line_end) {
+                if (type == "v") {
+                    const int dim = count_words(c, line_end);
+                    if (chunk.vertex_dim >= 0 && chunk.vertex_dim != dim) {
+                        chunk.is_supported = false;
+                    }
+                    chunk.vertex_dim = dim;
+                    chunk.num_vertices++;
+                } else if (type == "f") {
+                    const int degree = count_words(c, line_end);
+                    if (chunk.face_degree >= 0 && chunk.face_degree != degree) {
+                        chunk.is_supported = false;
+                    }
+                    chunk.face_degree = degree;
+                    chunk.num_faces++;
+                } else if (type == "l") {
+                    const int num_vertices = count_words(c, line_end);
+                    if (num_vertices < 2) {
+                        chunk.is_supported = false;
+                    }
+                    chunk.num_polyline_edges += num_vertices - 1;
+                }
+            });
+    });
+
+    // Combine the counts of the chunks
+    int vertex_dim = -1, face_degree = -1;
+    long num_vertices = 0, num_faces = 0, num_polyline_edges = 0;
+    for (ObjChunk& chunk : chunks) {
+        if (!chunk.is_supported
+            || (chunk.vertex_dim >= 0 && vertex_dim >= 0
+                && chunk.vertex_dim != vertex_dim)
+            || (chunk.face_degree >= 0 && face_degree >= 0
+                && chunk.face_degree != face_degree)) {
+            return false;
+        }
+        if (chunk.vertex_dim >= 0) {
+            vertex_dim = chunk.vertex_dim;
+        }
+        if (chunk.face_degree >= 0) {
+            face_degree = chunk.face_degree;
+        }
+        chunk.vertex_offset = num_vertices;
+        chunk.face_offset = num_faces;
+        chunk.edge_offset = num_polyline_edges;
+        num_vertices += chunk.num_vertices;
+        num_faces += chunk.num_faces;
+        num_polyline_edges += chunk.num_polyline_edges;
+    }
+
+    V.resize(num_vertices, std::max(vertex_dim, 0));
+    F.resize(num_faces, std::max(face_degree, 0));
+    E.resize(num_polyline_edges, 2);
+
+    // Second pass: parse the elements in place
+    std::vector<char> is_valid(chunks.size(), true);
+    tbb::parallel_for(size_t(0), chunks.size(), [&](size_t ci) {
+        const ObjChunk& chunk = chunks[ci];
+        long vi = chunk.vertex_offset, fi = chunk.face_offset;
+        long ei = chunk.edge_offset;
+        for_each_line(
+            chunk.begin, chunk.end,
+            [&](std::string_view type, const char* c, const char* line_end) {
+                if (type == "v") {
+                    for (int j = 0; j < vertex_dim; j++) {
+                        char* number_end;
+                        c = skip_blanks(c, line_end);
+                        V(vi, j) = strtod(c, &number_end);
+                        is_valid[ci] &= number_end > c;
+                        c = number_end;
+                    }
+                    vi++;
+                } else if (type == "f" || type == "l") {
+                    // Only the vertex index of "v/vt/vn" is needed
+                    int prev_index = -1;
+                    for (int j = 0; c < line_end; j++) {
+                        c = skip_blanks(c, line_end);
+                        if (c == line_end) {
+                            break;
+                        }
+                        char* number_end;
+                        const int index =
+                            obj_index(strtol(c, &number_end, 10), vi);
+                        is_valid[ci] &= number_end > c && index >= 0
+                            && index < num_vertices;
+                        c = skip_word(number_end, line_end);
+                        if (type == "f") {
+                            F(fi, j) = index;
+                        } else if (j > 0) {
+                            E(ei, 0) = prev_index;
+                            E(ei++, 1) = index;
+                        }
+                        prev_index = index;
+                    }
+                    fi += type == "f";
+                }
+            });
+    });
+    if (std::find(is_valid.begin(), is_valid.end(), false) != is_valid.end()) {
+        return false;
+    }
+
+    if (F.size()) {
+        Eigen::MatrixXi faceE;
+        igl::edges(F, faceE);
+        E.conservativeResize(E.rows() + faceE.rows(), 2);
+        E.bottomRows(faceE.rows()) = faceE;
+    }
+    return true;
+}
+
 } // namespace ipc::rigid
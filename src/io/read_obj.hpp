@@ -61,6 +61,16 @@ bool read_obj(
     std::vector<std::vector<int>>& F,
     std::vector<std::vector<int>>& L);
 
+/// @brief Parse the vertices, polylines, and faces of an obj file in
+/// parallel chunks, directly into Eigen matrices.
+/// @returns false if the file could not be read or uses features the fast
+///          parser does not support (e.g., faces of mixed degree).
+bool read_obj_fast(
+    const std::string& obj_file_name,
+    Eigen::MatrixXd& V,
+    Eigen::MatrixXi& E,
+    Eigen::MatrixXi& F);
+
 /// @brief Eigen Wrappers of read_obj.
 /// @retruns These will return true only if the data is perfectly
 ///          "rectangular": All faces are the same degree, all have the same
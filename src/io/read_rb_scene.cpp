@@ -1,5 +1,7 @@
 #include "read_rb_scene.hpp"
 
+#include <iterator>
+#include <optional>
 #include <unordered_set>
 
 #include <Eigen/Geometry>
@@ -7,11 +9,13 @@
 #include <igl/edges.h>
 #include <igl/facet_components.h>
 #include <igl/PI.h>
-#include <igl/read_triangle_mesh.h>
 #include <igl/remove_unreferenced.h>
+#include <tbb/parallel_for.h>
 #include <tbb/parallel_sort.h>
 
-#include <io/read_obj.hpp>
+#include <constants.hpp>
+#include <io/mesh_cache.hpp>
+#include <io/scene_bundle.hpp>
 #include <io/serialize_json.hpp>
 #include <logger.hpp>
 #include <utils/not_implemented_error.hpp>
@@ -53,13 +57,89 @@ VectorMax3d read_angular_field(const nlohmann::json& field, int dim)
     return v;
 }
 
+namespace {
+    /// @brief Split a body into one body per connected component.
+    void split_components(
+        const RigidBodySpec& spec, std::vector<RigidBodySpec>& components)
+    {
+        // TODO: Handle codimensional edges too
+        const Eigen::MatrixXi& faces = spec.faces;
+        assert(faces.cols() == 3);
+        Eigen::VectorXi C;
+        igl::facet_components(faces, C);
+        int num_components = C.maxCoeff();
+        std::vector<std::vector<int>> CFs(num_components + 1);
+        for (int j = 0; j < faces.cols(); j++) {
+            for (int i = 0; i < faces.rows(); i++) {
+                CFs[C[i]].push_back(faces(i, j));
+            }
+        }
+
+        for (int ci = 0; ci < CFs.size(); ci++) {
+            Eigen::MatrixXi F = Eigen::Map<Eigen::MatrixXi>(
+                CFs[ci].data(), CFs[ci].size() / 3, 3);
+            RigidBodySpec component = spec;
+            Eigen::VectorXi I;
+            igl::remove_unreferenced(
+                spec.vertices, F, component.vertices, component.faces, I);
+            igl::edges(component.faces, component.edges);
+            // WARNING: angular velocity and torque will be around the
+            // components center of mass not the entire meshes.
+            component.name = fmt::format("{}-part{:03d}", spec.name, ci);
+            components.push_back(std::move(component));
+        }
+    }
+
+    /// @brief Build (or read from the cache) the body space distance field.
+    void build_distance_field(const RigidBodySpec& spec, RigidBody& rb)
+    {
+        if (rb.type != RigidBodyType::STATIC) {
+            spdlog::warn(
+                "ignoring distance field of a non-static body body={}",
+                rb.name);
+            return;
+        }
+        const double cell_size = spec.distance_field_cell_size > 0
+            ? spec.distance_field_cell_size
+            : rb.average_edge_length;
+        const double band_width = spec.distance_field_band_width > 0
+            ? spec.distance_field_band_width
+            : Constants::DISTANCE_FIELD_BAND_CELLS * cell_size;
+        rb.distance_field = build_distance_field_cached(
+            rb.vertices, rb.edges, rb.faces, cell_size, band_width);
+        spdlog::info(
+            "distance_field body={} num_nodes={:d} cell_size={:g} "
+            "band_width={:g}",
+            rb.name, rb.distance_field->num_nodes(), cell_size, band_width);
+    }
+} // namespace
+
 bool read_rb_scene(const nlohmann::json& scene, std::vector<RigidBody>& rbs)
+{
+    std::vector<RigidBodySpec> specs;
+    const std::string bundle = scene.value("scene_bundle", "");
+    bool success = bundle.empty()
+        ? read_rb_scene_specs(scene, specs)
+        : read_scene_bundle(bundle, specs);
+    if (!success) {
+        return false;
+    }
+    build_rigid_bodies(specs, rbs);
+    return true;
+}
+
+bool read_rb_scene_specs(
+    const nlohmann::json& scene, std::vector<RigidBodySpec>& specs)
 {
     using namespace nlohmann;
     int dim = -1, ndof, angular_dim;
 
     std::unordered_map<std::string, int> rb_name_to_count;
 
+    // Parse the bodies serially and split them in parallel below.
+    std::vector<RigidBodySpec> parsed_specs;
+    std::vector<bool> is_split;
+
     for (auto& jrb : scene["rigid_bodies"]) {
         // NOTE:
         // All units by default are expressed in standard SI units
@@ -72,6 +152,7 @@ bool read_rb_scene(const nlohmann::json& scene, std::vector<RigidBody>& rbs)
         // force: applied to center of mass
         // torque: world coordinates in degrees
         json args = R"({
+                "name": "",
                 "mesh": "",
                 "vertices": [],
                 "edges": [],
@@ -79,6 +160,10 @@ bool read_rb_scene(const nlohmann::json& scene, std::vector<RigidBody>& rbs)
                 "density": 1000.0,
                 "is_dof_fixed": [false, false, false, false, false, false],
                 "oriented": false,
+                "convex": "auto",
+                "distance_field": false,
+                "distance_field_cell_size": -1,
+                "distance_field_band_width": -1,
                 "group_id": -1,
                 "position": [0.0, 0.0, 0.0],
                 "rotation": [0.0, 0.0, 0.0],
@@ -91,6 +176,7 @@ bool read_rb_scene(const nlohmann::json& scene, std::vector<RigidBody>& rbs)
                 "type": "dynamic",
                 "kinematic_max_time": -1,
                 "kinematic_poses": [],
+                "kinematic_source": null,
                 "split_components": false
             })"_json;
         args.merge_patch(jrb);
@@ -115,17 +201,8 @@ bool read_rb_scene(const nlohmann::json& scene, std::vector<RigidBody>& rbs)
                 mesh_path = fs::path(RIGID_IPC_MESHES_DIR) / mesh_path;
             }
             spdlog::info("loading mesh: {:s}", mesh_path.string());
-            bool success;
-            if (mesh_path.extension() == ".obj") {
-                success = read_obj(mesh_path.string(), vertices, edges, faces);
-            } else {
-                success = igl::read_triangle_mesh(
-                    mesh_path.string(), vertices, faces);
-                // Initialize edges
-                if (faces.size()) {
-                    igl::edges(faces, edges);
-                }
-            }
+            bool success =
+                read_mesh_cached(mesh_path.string(), vertices, edges, faces);
             assert(faces.size() == 0 || faces.cols() == 3);
             if (!success) {
                 return false;
@@ -139,6 +216,9 @@ bool read_rb_scene(const nlohmann::json& scene, std::vector<RigidBody>& rbs)
             from_json(args["faces"], faces);
             rb_name = "RigidBody";
         }
+        if (args["name"] != "") {
+            rb_name = args["name"].get<std::string>();
+        }
 
         if (dim == -1) {
             if (vertices.cols() != 0) { // Why would we have an empty body?
@@ -222,16 +302,28 @@ bool read_rb_scene(const nlohmann::json& scene, std::vector<RigidBody>& rbs)
             is_dof_fixed.conservativeResize(ndof);
         }
 
-        double density = args["density"];
-        bool is_oriented = args["oriented"];
-
-        int group_id = args["group_id"];
-
-        RigidBodyType rb_type = args["type"];
-        double kinematic_max_time = args["kinematic_max_time"];
+        RigidBodySpec spec;
+        spec.vertices = std::move(vertices);
+        spec.edges = std::move(edges);
+        spec.faces = std::move(faces);
+        spec.name = rb_name;
+        spec.pose = PoseD(position, VectorMax3d::Zero(angular_dim));
+        spec.velocity = PoseD(linear_velocity, angular_velocity);
+        spec.force = PoseD(force, torque);
+        spec.density = args["density"];
+        spec.is_dof_fixed = is_dof_fixed;
+        spec.is_oriented = args["oriented"];
+        if (args["convex"].is_boolean()) {
+            spec.is_convex = args["convex"].get<bool>();
+        }
+        spec.has_distance_field = args["distance_field"];
+        spec.distance_field_cell_size = args["distance_field_cell_size"];
+        spec.distance_field_band_width = args["distance_field_band_width"];
+        spec.group_id = args["group_id"];
+        spec.type = args["type"].get<RigidBodyType>();
+        spec.kinematic_max_time = args["kinematic_max_time"];
 
         std::vector<json> json_kinematic_poses = args["kinematic_poses"];
-        std::deque<PoseD> kinematic_poses;
         for (const auto& json_pose : json_kinematic_poses) {
             PoseD pose = PoseD::Zero(dim);
             if (json_pose.contains("position")) {
@@ -240,49 +332,69 @@ bool read_rb_scene(const nlohmann::json& scene, std::vector<RigidBody>& rbs)
             if (json_pose.contains("rotation")) {
                 from_json(json_pose["rotation"], pose.rotation);
             }
-            kinematic_poses.push_back(pose);
+            spec.kinematic_poses.push_back(pose);
         }
-
-        if (args["split_components"].get<bool>()) {
-            // TODO: Handle codimensional edges too
-            assert(faces.cols() == 3);
-            Eigen::VectorXi C;
-            igl::facet_components(faces, C);
-            int num_components = C.maxCoeff();
-            std::vector<std::vector<int>> CFs(num_components + 1);
-            for (int j = 0; j < faces.cols(); j++) {
-                for (int i = 0; i < faces.rows(); i++) {
-                    CFs[C[i]].push_back(faces(i, j));
-                }
+        spec.kinematic_source_settings = args["kinematic_source"];
+        if (!args["kinematic_source"].is_null()) {
+            spec.kinematic_source =
+                KinematicSource::from_json(args["kinematic_source"], dim);
+            if (spec.kinematic_source == nullptr) {
+                return false;
             }
+        }
 
-            for (int ci = 0; ci < CFs.size(); ci++) {
-                Eigen::MatrixXi F = Eigen::Map<Eigen::MatrixXi>(
-                    CFs[ci].data(), CFs[ci].size() / 3, 3);
-                Eigen::MatrixXd CV;
-                Eigen::MatrixXi CF;
-                Eigen::VectorXi I;
-                igl::remove_unreferenced(vertices, F, CV, CF, I);
-                Eigen::MatrixXi CE;
-                igl::edges(CF, CE);
-                // WARNING: angular velocity and torque will be around the
-                // components center of mass not the entire meshes.
-                rbs.emplace_back(
-                    CV, CE, CF, PoseD(position, VectorMax3d::Zero(angular_dim)),
-                    PoseD(linear_velocity, angular_velocity),
-                    PoseD(force, torque), density, is_dof_fixed, is_oriented,
-                    group_id, rb_type, kinematic_max_time, kinematic_poses);
-                rbs.back().name = fmt::format("{}-part{:03d}", rb_name, ci);
-            }
+        parsed_specs.push_back(std::move(spec));
+        is_split.push_back(args["split_components"].get<bool>());
+    }
+
+    std::vector<std::vector<RigidBodySpec>> parts(parsed_specs.size());
+    tbb::parallel_for(size_t(0), parsed_specs.size(), [&](size_t i) {
+        if (is_split[i]) {
+            split_components(parsed_specs[i], parts[i]);
+        } else {
+            parts[i].push_back(std::move(parsed_specs[i]));
+        }
+    });
+
+    for (auto& part : parts) {
+        std::move(part.begin(), part.end(), std::back_inserter(specs));
+    }
+    return true;
+}
+
+void build_rigid_bodies(
+    const std::vector<RigidBodySpec>& specs, std::vector<RigidBody>& rbs)
+{
+    // Mass properties and BVHs are computed in the body constructors.
+    std::vector<std::optional<RigidBody>> new_rbs(specs.size());
+    tbb::parallel_for(size_t(0), specs.size(), [&](size_t i) {
+        const RigidBodySpec& spec = specs[i];
+        if (spec.geometry != nullptr) {
+            new_rbs[i].emplace(
+                spec.geometry, spec.pose, spec.velocity, spec.force,
+                spec.density, spec.is_dof_fixed, spec.is_oriented,
+                spec.group_id, spec.type, spec.kinematic_max_time,
+                spec.kinematic_poses);
         } else {
-            rbs.emplace_back(
-                vertices, edges, faces,
-                PoseD(position, VectorMax3d::Zero(angular_dim)),
-                PoseD(linear_velocity, angular_velocity), PoseD(force, torque),
-                density, is_dof_fixed, is_oriented, group_id, rb_type,
-                kinematic_max_time, kinematic_poses);
-            rbs.back().name = rb_name;
+            new_rbs[i].emplace(
+                spec.vertices, spec.edges, spec.faces, spec.pose,
+                spec.velocity, spec.force, spec.density, spec.is_dof_fixed,
+                spec.is_oriented, spec.group_id, spec.type,
+                spec.kinematic_max_time, spec.kinematic_poses);
         }
+        new_rbs[i]->name = spec.name;
+        new_rbs[i]->kinematic_source = spec.kinematic_source;
+        if (spec.is_convex) {
+            new_rbs[i]->is_convex = *spec.is_convex;
+        }
+        if (spec.has_distance_field) {
+            build_distance_field(spec, *new_rbs[i]);
+        }
+    });
+
+    rbs.reserve(rbs.size() + new_rbs.size());
+    for (auto& rb : new_rbs) {
+        rbs.push_back(std::move(*rb));
     }
 
     // Adjust the group ids, so the default ones are unique.
@@ -332,8 +444,6 @@ bool read_rb_scene(const nlohmann::json& scene, std::vector<RigidBody>& rbs)
             static_group_id = rb.group_id;
         }
     }
-
-    return true;
 }
 
 } // namespace ipc::rigid
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <optional>
+
 #include <Eigen/Dense>
 #include <nlohmann/json.hpp>
 
@@ -7,6 +9,42 @@
 
 namespace ipc::rigid {
 
+/// @brief Input arguments of a single rigid body before it is constructed.
+struct RigidBodySpec {
+    /// @brief Vertices in the input frame (already scaled and rotated).
+    Eigen::MatrixXd vertices;
+    Eigen::MatrixXi edges, faces;
+    /// @brief Precomputed geometry (if set, used instead of the mesh above).
+    std::shared_ptr<const RigidBodyGeometry> geometry;
+    std::string name;
+    PoseD pose, velocity, force;
+    double density;
+    VectorMax6b is_dof_fixed;
+    bool is_oriented;
+    /// @brief Override of the detected convexity (unset to detect it).
+    std::optional<bool> is_convex;
+    /// @brief Build a distance field of the (static) body.
+    bool has_distance_field = false;
+    /// @brief Grid spacing and band of the field (defaults if not positive).
+    double distance_field_cell_size = -1, distance_field_band_width = -1;
+    int group_id;
+    RigidBodyType type;
+    double kinematic_max_time;
+    std::deque<PoseD> kinematic_poses;
+    std::shared_ptr<const KinematicSource> kinematic_source;
+    /// @brief Settings the source was created from (null if none).
+    nlohmann::json kinematic_source_settings;
+};
+
+/// @brief Parse the bodies of a scene (splitting their components if
+/// requested) without constructing them.
+bool read_rb_scene_specs(
+    const nlohmann::json& scene, std::vector<RigidBodySpec>& specs);
+
+/// @brief Construct the bodies in parallel and assign unique group ids.
+void build_rigid_bodies(
+    const std::vector<RigidBodySpec>& specs, std::vector<RigidBody>& rbs);
+
 bool read_rb_scene_from_str(
     const std::string str, std::vector<RigidBody>& rbs);
 
@@ -0,0 +1,330 @@
+#include "scene_bundle.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <unordered_map>
+
+#include <tbb/parallel_for.h>
+
+#include <io/mapped_file.hpp>
+#include <io/serialize_json.hpp>
+#include <logger.hpp>
+
+namespace ipc::rigid {
+
+bool SceneBundleHeader::is_valid() const
+{
+    const SceneBundleHeader expected;
+    return std::memcmp(magic, expected.magic, sizeof(magic)) == 0
+        && version == expected.version;
+}
+
+namespace {
+    const size_t ALIGNMENT = 8;
+
+    void pad(std::string& buffer)
+    {
+        buffer.resize((buffer.size() + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT);
+    }
+
+    /// @brief Append a matrix to the buffer and return its shape and offset.
+    template <typename Matrix> nlohmann::json append(
+        std::string& buffer, const Matrix& matrix)
+    {
+        nlohmann::json array = { { "rows", matrix.rows() },
+                                 { "cols", matrix.cols() },
+                                 { "offset", buffer.size() } };
+        buffer.append(
+            reinterpret_cast<const char*>(matrix.data()),
+            matrix.size() * sizeof(typename Matrix::Scalar));
+        pad(buffer);
+        return array;
+    }
+
+    /// @brief Copy a matrix out of the binary section.
+    template <typename Matrix>
+    bool extract(
+        const char* data,
+        size_t size,
+        const nlohmann::json& array,
+        Matrix& matrix)
+    {
+        const size_t rows = array["rows"], cols = array["cols"];
+        const size_t offset = array["offset"];
+        const size_t num_bytes =
+            rows * cols * sizeof(typename Matrix::Scalar);
+        if (offset > size || num_bytes > size - offset) {
+            return false;
+        }
+        matrix.resize(rows, cols);
+        // The data is not necessarily aligned if it was not mapped
+        std::memcpy(matrix.data(), data + offset, num_bytes);
+        return true;
+    }
+
+    nlohmann::json pose_to_json(const PoseD& pose)
+    {
+        return to_json(pose.dof());
+    }
+
+    PoseD pose_from_json(const nlohmann::json& json)
+    {
+        VectorMax6d dof;
+        from_json(json, dof);
+        return PoseD(dof);
+    }
+
+    /// @brief Bundle file contents (mapped if possible).
+    class SceneBundle {
+    public:
+        bool open(const std::string& filename)
+        {
+            const char* file_data;
+            size_t file_size;
+            if (m_mapping.open(filename)) {
+                file_data = m_mapping.data();
+                file_size = m_mapping.size();
+            } else {
+                std::ifstream file(filename, std::ios::binary | std::ios::ate);
+                if (!file) {
+                    spdlog::error(
+                        "failed to open scene bundle filename={}", filename);
+                    return false;
+                }
+                m_buffer.resize(size_t(file.tellg()));
+                file.seekg(0);
+                file.read(m_buffer.data(), m_buffer.size());
+                file_data = m_buffer.data();
+                file_size = file ? m_buffer.size() : 0;
+            }
+
+            SceneBundleHeader header;
+            if (file_size >= sizeof(header)) {
+                std::memcpy(&header, file_data, sizeof(header));
+            }
+            const size_t json_end = sizeof(header) + header.json_size;
+            const size_t data_start =
+                (json_end + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+            if (file_size < sizeof(header) || !header.is_valid()
+                || header.json_size > file_size - sizeof(header)) {
+                spdlog::error("invalid scene bundle filename={}", filename);
+                return false;
+            }
+
+            contents = nlohmann::json::parse(
+                file_data + sizeof(header), file_data + json_end, nullptr,
+                false);
+            if (contents.is_discarded()) {
+                spdlog::error(
+                    "invalid scene bundle description filename={}", filename);
+                return false;
+            }
+            data = file_data + std::min(data_start, file_size);
+            data_size = file_size - std::min(data_start, file_size);
+            return true;
+        }
+
+        nlohmann::json contents;
+        const char* data = nullptr;
+        size_t data_size = 0;
+
+    protected:
+        MappedFile m_mapping;
+        std::vector<char> m_buffer;
+    };
+} // namespace
+
+bool write_scene_bundle(
+    const std::string& filename,
+    const nlohmann::json& args,
+    const std::vector<RigidBodySpec>& specs)
+{
+    using namespace nlohmann;
+
+    json contents = { { "args", args },
+                      { "geometries", json::array() },
+                      { "bodies", json::array() } };
+    std::string data;
+
+    std::unordered_map<const RigidBodyGeometry*, size_t> geometry_ids;
+    for (const RigidBodySpec& spec : specs) {
+        const RigidBodyGeometry* geometry = spec.geometry.get();
+        if (geometry == nullptr) {
+            spdlog::error(
+                "missing precomputed geometry of body name={}", spec.name);
+            return false;
+        }
+
+        auto [it, is_new] =
+            geometry_ids.emplace(geometry, contents["geometries"].size());
+        if (is_new) {
+            contents["geometries"].push_back({
+                { "input_vertices", append(data, geometry->input_vertices) },
+                { "vertices", append(data, geometry->vertices) },
+                { "edges", append(data, geometry->edges) },
+                { "faces", append(data, geometry->faces) },
+                { "num_rot_dof_fixed", geometry->num_rot_dof_fixed },
+                { "center_of_mass", to_json(geometry->center_of_mass) },
+                { "volume", geometry->volume },
+                { "moment_of_inertia", to_json(geometry->moment_of_inertia) },
+                { "R0", append(data, geometry->R0) },
+            });
+        }
+
+        json kinematic_poses = json::array();
+        for (const PoseD& pose : spec.kinematic_poses) {
+            kinematic_poses.push_back(pose_to_json(pose));
+        }
+        std::vector<bool> is_dof_fixed(
+            spec.is_dof_fixed.data(),
+            spec.is_dof_fixed.data() + spec.is_dof_fixed.size());
+
+        contents["bodies"].push_back({
+            { "name", spec.name },
+            { "geometry", it->second },
+            { "pose", pose_to_json(spec.pose) },
+            { "velocity", pose_to_json(spec.velocity) },
+            { "force", pose_to_json(spec.force) },
+            { "density", spec.density },
+            { "is_dof_fixed", is_dof_fixed },
+            { "oriented", spec.is_oriented },
+            { "group_id", spec.group_id },
+            { "type", spec.type },
+            // Infinity is not representable in JSON (stored as null)
+            { "kinematic_max_time", spec.kinematic_max_time },
+            { "kinematic_poses", kinematic_poses },
+            { "kinematic_source", spec.kinematic_source_settings },
+            { "distance_field", spec.has_distance_field },
+            { "distance_field_cell_size", spec.distance_field_cell_size },
+            { "distance_field_band_width", spec.distance_field_band_width },
+        });
+    }
+
+    const std::string description = contents.dump();
+    SceneBundleHeader header;
+    header.json_size = description.size();
+
+    std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+    if (!file) {
+        spdlog::error(
+            "failed to open scene bundle for writing filename={}", filename);
+        return false;
+    }
+    std::string prefix(reinterpret_cast<const char*>(&header), sizeof(header));
+    prefix += description;
+    pad(prefix);
+    file.write(prefix.data(), prefix.size());
+    file.write(data.data(), data.size());
+    return bool(file);
+}
+
+bool read_scene_bundle(
+    const std::string& filename, std::vector<RigidBodySpec>& specs)
+{
+    SceneBundle bundle;
+    if (!bundle.open(filename)) {
+        return false;
+    }
+
+    const nlohmann::json& jgeometries = bundle.contents["geometries"];
+    std::vector<std::shared_ptr<const RigidBodyGeometry>> geometries(
+        jgeometries.size());
+    std::vector<char> is_valid(jgeometries.size(), true);
+    // Only the BVHs and mesh selectors are rebuilt
+    tbb::parallel_for(size_t(0), geometries.size(), [&](size_t i) {
+        const nlohmann::json& jgeometry = jgeometries[i];
+        const auto extract_array = [&](const char* name, auto& matrix) {
+            return extract(
+                bundle.data, bundle.data_size, jgeometry[name], matrix);
+        };
+
+        Eigen::MatrixXd input_vertices, vertices, R0;
+        Eigen::MatrixXi edges, faces;
+        if (!extract_array("input_vertices", input_vertices)
+            || !extract_array("vertices", vertices)
+            || !extract_array("edges", edges)
+            || !extract_array("faces", faces) || !extract_array("R0", R0)) {
+            is_valid[i] = false;
+            return;
+        }
+
+        VectorMax3d center_of_mass, moment_of_inertia;
+        from_json(jgeometry["center_of_mass"], center_of_mass);
+        from_json(jgeometry["moment_of_inertia"], moment_of_inertia);
+
+        geometries[i] = std::make_shared<const RigidBodyGeometry>(
+            input_vertices, vertices, edges, faces,
+            jgeometry["num_rot_dof_fixed"].get<int>(), center_of_mass,
+            jgeometry["volume"].get<double>(), moment_of_inertia, R0);
+    });
+    for (size_t i = 0; i < geometries.size(); i++) {
+        if (!is_valid[i]) {
+            spdlog::error(
+                "invalid scene bundle geometry filename={} geometry={}",
+                filename, i);
+            return false;
+        }
+    }
+
+    for (const nlohmann::json& jbody : bundle.contents["bodies"]) {
+        RigidBodySpec spec;
+        const size_t geometry_id = jbody["geometry"];
+        if (geometry_id >= geometries.size()) {
+            spdlog::error(
+                "invalid scene bundle body filename={} geometry={}", filename,
+                geometry_id);
+            return false;
+        }
+        spec.geometry = geometries[geometry_id];
+        spec.name = jbody["name"].get<std::string>();
+        spec.pose = pose_from_json(jbody["pose"]);
+        spec.velocity = pose_from_json(jbody["velocity"]);
+        spec.force = pose_from_json(jbody["force"]);
+        spec.density = jbody["density"];
+        const std::vector<bool> is_dof_fixed = jbody["is_dof_fixed"];
+        spec.is_dof_fixed.resize(is_dof_fixed.size());
+        for (size_t i = 0; i < is_dof_fixed.size(); i++) {
+            spec.is_dof_fixed(i) = is_dof_fixed[i];
+        }
+        spec.is_oriented = jbody["oriented"];
+        spec.group_id = jbody["group_id"];
+        spec.type = jbody["type"].get<RigidBodyType>();
+        spec.kinematic_max_time = jbody["kinematic_max_time"].is_null()
+            ? std::numeric_limits<double>::infinity()
+            : jbody["kinematic_max_time"].get<double>();
+        for (const nlohmann::json& jpose : jbody["kinematic_poses"]) {
+            spec.kinematic_poses.push_back(pose_from_json(jpose));
+        }
+        spec.kinematic_source_settings =
+            jbody.value("kinematic_source", nlohmann::json());
+        if (!spec.kinematic_source_settings.is_null()) {
+            spec.kinematic_source = KinematicSource::from_json(
+                spec.kinematic_source_settings, spec.pose.dim());
+            if (spec.kinematic_source == nullptr) {
+                return false;
+            }
+        }
+        // Fields are built when the bundle is loaded (or read from the cache)
+        spec.has_distance_field = jbody.value("distance_field", false);
+        spec.distance_field_cell_size =
+            jbody.value("distance_field_cell_size", -1.0);
+        spec.distance_field_band_width =
+            jbody.value("distance_field_band_width", -1.0);
+        specs.push_back(std::move(spec));
+    }
+    return true;
+}
+
+bool read_scene_bundle_args(const std::string& filename, nlohmann::json& args)
+{
+    SceneBundle bundle;
+    if (!bundle.open(filename)) {
+        return false;
+    }
+    args = bundle.contents["args"];
+    return true;
+}
+
+} // namespace ipc::rigid
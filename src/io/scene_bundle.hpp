@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <nlohmann/json.hpp>
+
+#include <io/read_rb_scene.hpp>
+
+namespace ipc::rigid {
+
+/// @brief Header of a binary scene bundle.
+///
+/// The header is followed by a JSON description of the scene (settings,
+/// bodies, and geometry mass properties) and, aligned to 8 bytes, the raw
+/// column-major geometry arrays (float64 vertices and int32 indices).
+struct SceneBundleHeader {
+    char magic[8] = { 'R', 'I', 'P', 'C', 'S', 'C', 'N', 'B' };
+    uint32_t version = 1;
+    uint32_t reserved = 0;
+    uint64_t json_size = 0;
+
+    bool is_valid() const;
+};
+
+/// @brief Write a bundle of the scene settings and bodies.
+///
+/// Every spec must have a precomputed geometry. Bodies sharing a geometry
+/// store it once.
+bool write_scene_bundle(
+    const std::string& filename,
+    const nlohmann::json& args,
+    const std::vector<RigidBodySpec>& specs);
+
+/// @brief Read the bodies of a bundle with their precomputed geometry.
+bool read_scene_bundle(
+    const std::string& filename, std::vector<RigidBodySpec>& specs);
+
+/// @brief Read the simulation settings stored in a bundle.
+bool read_scene_bundle_args(
+    const std::string& filename, nlohmann::json& args);
+
+} // namespace ipc::rigid
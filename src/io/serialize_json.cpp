@@ -1,5 +1,8 @@
 #include "serialize_json.hpp"
 
+#include <cstdint>
+#include <cstring>
+
 #include <logger.hpp>
 #include <utils/eigen_ext.hpp>
 
@@ -34,4 +37,113 @@ to_json_string(const Eigen::MatrixXd& matrix, const std::string& format)
     return nlohmann::json(vec);
 }
 
+namespace {
+    /// @brief Binary subtype of packed matrices.
+    const std::uint8_t PACKED_MATRIX_SUBTYPE = 0x52;
+
+    /// @brief Header of a packed matrix (followed by row-major doubles).
+    struct PackedMatrixHeader {
+        std::uint64_t rows;
+        std::uint64_t cols; ///< @brief Zero for arrays of numbers
+    };
+} // namespace
+
+bool is_packed_json_matrix(const nlohmann::json& json)
+{
+    return json.is_binary() && json.get_binary().has_subtype()
+        && json.get_binary().subtype() == PACKED_MATRIX_SUBTYPE;
+}
+
+bool pack_json_matrix(nlohmann::json& json)
+{
+    if (!json.is_array() || json.empty()) {
+        return false;
+    }
+    PackedMatrixHeader header { json.size(), 0 };
+    if (json.front().is_array()) {
+        header.cols = json.front().size();
+        for (const nlohmann::json& row : json) {
+            if (!row.is_array() || row.size() != header.cols) {
+                return false;
+            }
+            for (const nlohmann::json& value : row) {
+                if (!value.is_number()) {
+                    return false;
+                }
+            }
+        }
+    } else {
+        for (const nlohmann::json& value : json) {
+            if (!value.is_number()) {
+                return false;
+            }
+        }
+    }
+
+    const size_t num_values = header.rows * std::max<size_t>(header.cols, 1);
+    std::vector<std::uint8_t> bytes(
+        sizeof(PackedMatrixHeader) + num_values * sizeof(double));
+    std::memcpy(bytes.data(), &header, sizeof(PackedMatrixHeader));
+    double* values =
+        reinterpret_cast<double*>(bytes.data() + sizeof(PackedMatrixHeader));
+    for (const nlohmann::json& element : json) {
+        if (header.cols == 0) {
+            *values++ = element.get<double>();
+        } else {
+            for (const nlohmann::json& value : element) {
+                *values++ = value.get<double>();
+            }
+        }
+    }
+    json = nlohmann::json::binary(std::move(bytes), PACKED_MATRIX_SUBTYPE);
+    return true;
+}
+
+void unpack_json_matrix(const nlohmann::json& json, Eigen::MatrixXd& matrix)
+{
+    assert(is_packed_json_matrix(json));
+    const std::vector<std::uint8_t>& bytes = json.get_binary();
+    PackedMatrixHeader header;
+    std::memcpy(&header, bytes.data(), sizeof(PackedMatrixHeader));
+    const long cols = std::max<long>(header.cols, 1);
+    assert(
+        bytes.size()
+        == sizeof(PackedMatrixHeader) + header.rows * cols * sizeof(double));
+
+    typedef Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic,
+                          Eigen::RowMajor>
+        RowMajorMatrix;
+    RowMajorMatrix row_major(header.rows, cols);
+    std::memcpy(
+        row_major.data(), bytes.data() + sizeof(PackedMatrixHeader),
+        row_major.size() * sizeof(double));
+    matrix = row_major;
+}
+
+void unpack_json_matrices(nlohmann::json& json)
+{
+    if (is_packed_json_matrix(json)) {
+        const std::vector<std::uint8_t>& bytes = json.get_binary();
+        PackedMatrixHeader header;
+        std::memcpy(&header, bytes.data(), sizeof(PackedMatrixHeader));
+        Eigen::MatrixXd matrix;
+        unpack_json_matrix(json, matrix);
+        if (header.cols == 0) {
+            json = to_json(Eigen::VectorXd(matrix.col(0)));
+            return;
+        }
+        // Integer matrices (e.g., faces) are written back as integers
+        if ((matrix.array() == matrix.array().round()).all()
+            && (matrix.array().abs() < (1 << 30)).all()) {
+            json = to_json(Eigen::MatrixXi(matrix.cast<int>()));
+        } else {
+            json = to_json(matrix);
+        }
+    } else if (json.is_structured()) {
+        for (nlohmann::json& value : json) {
+            unpack_json_matrices(value);
+        }
+    }
+}
+
 } // namespace ipc::rigid
@@ -27,6 +27,20 @@ nlohmann::json to_json(const Eigen::MatrixBase<Derived>& matrix);
 nlohmann::json to_json_string(
     const Eigen::MatrixXd& matrix, const std::string& format = ".16e");
 
+/// @brief Is the value a numeric array packed by pack_json_matrix()?
+bool is_packed_json_matrix(const nlohmann::json& json);
+
+/// @brief Pack an array of numbers, or of equal-length arrays of numbers,
+/// into a single binary value of doubles in place.
+/// @returns False (leaving the value unchanged) if it is not such an array.
+bool pack_json_matrix(nlohmann::json& json);
+
+/// @brief Matrix of a packed value (a column for packed arrays of numbers).
+void unpack_json_matrix(const nlohmann::json& json, Eigen::MatrixXd& matrix);
+
+/// @brief Replace every packed matrix with regular arrays (e.g., to dump).
+void unpack_json_matrices(nlohmann::json& json);
+
 } // namespace ipc::rigid
 
 #include "serialize_json.tpp"
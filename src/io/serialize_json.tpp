@@ -10,6 +10,13 @@ void from_json(
     Eigen::Matrix<T, dim, 1, Eigen::ColMajor, max_dim, 1>& vector)
 {
     typedef Eigen::Matrix<T, dim, 1, Eigen::ColMajor, max_dim, 1> Vector;
+    if (is_packed_json_matrix(json)) {
+        Eigen::MatrixXd matrix;
+        unpack_json_matrix(json, matrix);
+        vector = Eigen::Map<const Eigen::VectorXd>(matrix.data(), matrix.size())
+                     .cast<T>();
+        return;
+    }
     typedef std::vector<T> L;
     L list = json.template get<L>();
     vector = Eigen::Map<Vector>(list.data(), long(list.size()));
@@ -18,6 +25,14 @@ void from_json(
 template <typename T>
 void from_json(const nlohmann::json& json, MatrixX<T>& matrix)
 {
+    if (is_packed_json_matrix(json)) {
+        Eigen::MatrixXd packed;
+        unpack_json_matrix(json, packed);
+        if (packed.size() != 0) {
+            matrix = packed.cast<T>();
+        }
+        return;
+    }
     typedef std::vector<std::vector<T>> L;
     L list = json.get<L>();
 
@@ -0,0 +1,75 @@
+#include "step_metrics_file.hpp"
+
+#include <ghc/fs_std.hpp> // filesystem
+
+#include <logger.hpp>
+
+namespace ipc::rigid {
+
+bool StepMetricsWriter::open(const std::string& filename, bool append)
+{
+    close();
+    m_is_csv = fs::path(filename).extension() == ".csv";
+    m_columns.clear();
+
+    if (m_is_csv && append) {
+        // Reuse the columns of the existing header
+        std::ifstream existing(filename);
+        std::string header;
+        if (std::getline(existing, header) && !header.empty()) {
+            size_t start = 0, end;
+            do {
+                end = header.find(',', start);
+                m_columns.push_back(header.substr(start, end - start));
+                start = end + 1;
+            } while (end != std::string::npos);
+        }
+    }
+
+    m_file.open(filename, append ? std::ios::app : std::ios::trunc);
+    if (!m_file) {
+        spdlog::error(
+            "failed to open step metrics file for writing filename={}",
+            filename);
+        return false;
+    }
+    return true;
+}
+
+bool StepMetricsWriter::write(const nlohmann::json& record)
+{
+    assert(is_open());
+    assert(record.is_object());
+
+    if (!m_is_csv) {
+        m_file << record.dump() << '\n';
+    } else {
+        if (m_columns.empty()) {
+            for (const auto& el : record.items()) {
+                m_file << (m_columns.empty() ? "" : ",") << el.key();
+                m_columns.push_back(el.key());
+            }
+            m_file << '\n';
+        }
+        for (size_t i = 0; i < m_columns.size(); i++) {
+            if (i > 0) {
+                m_file << ',';
+            }
+            if (record.contains(m_columns[i])) {
+                m_file << record[m_columns[i]].dump();
+            }
+        }
+        m_file << '\n';
+    }
+    m_file.flush();
+    return bool(m_file);
+}
+
+void StepMetricsWriter::close()
+{
+    if (m_file.is_open()) {
+        m_file.close();
+    }
+}
+
+} // namespace ipc::rigid
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <nlohmann/json.hpp>
+
+namespace ipc::rigid {
+
+/// @brief Line-buffered writer of one metrics record per time-step.
+///
+/// Records are written as JSON lines or, if the filename ends in ".csv", as
+/// CSV rows with the columns of the first record.
+class StepMetricsWriter {
+public:
+    ~StepMetricsWriter() { close(); }
+
+    /// @brief Open the file, appending to it if requested.
+    bool open(const std::string& filename, bool append = false);
+
+    /// @brief Write a flat record and flush it to disk.
+    bool write(const nlohmann::json& record);
+
+    void close();
+    bool is_open() const { return m_file.is_open(); }
+    bool is_csv() const { return m_is_csv; }
+
+protected:
+    std::ofstream m_file;
+    bool m_is_csv = false;
+    /// @brief Columns of the CSV file (empty until the header is written).
+    std::vector<std::string> m_columns;
+};
+
+} // namespace ipc::rigid
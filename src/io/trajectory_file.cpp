@@ -0,0 +1,192 @@
+#include "trajectory_file.hpp"
+
+#include <cstring>
+#include <vector>
+
+#include <ghc/fs_std.hpp> // filesystem
+
+#include <logger.hpp>
+
+namespace ipc::rigid {
+
+bool TrajectoryHeader::is_valid() const
+{
+    const TrajectoryHeader expected;
+    return std::memcmp(magic, expected.magic, sizeof(magic)) == 0
+        && version == expected.version && (dim == 2 || dim == 3);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Writer
+
+bool TrajectoryWriter::open(
+    const std::string& filename, int dim, size_t num_bodies, double timestep)
+{
+    close();
+    m_file.open(filename, std::ios::binary | std::ios::trunc);
+    if (!m_file) {
+        spdlog::error(
+            "failed to open trajectory file for writing filename={}",
+            filename);
+        return false;
+    }
+    m_header = TrajectoryHeader();
+    m_header.dim = dim;
+    m_header.num_bodies = num_bodies;
+    m_header.timestep = timestep;
+    m_file.write(reinterpret_cast<const char*>(&m_header), sizeof(m_header));
+    m_num_frames = 0;
+    return bool(m_file);
+}
+
+bool TrajectoryWriter::resume(const std::string& filename, size_t num_frames)
+{
+    close();
+    TrajectoryReader reader;
+    if (!reader.open(filename) || reader.num_frames() < num_frames) {
+        spdlog::error(
+            "unable to resume trajectory filename={} num_frames={}", filename,
+            num_frames);
+        return false;
+    }
+    m_header = reader.header();
+    reader.close();
+
+    std::error_code ec;
+    fs::resize_file(
+        filename,
+        sizeof(m_header) + num_frames * m_header.frame_size() * sizeof(double),
+        ec);
+    if (ec) {
+        return false;
+    }
+    m_file.open(filename, std::ios::binary | std::ios::app);
+    m_num_frames = num_frames;
+    return bool(m_file);
+}
+
+bool TrajectoryWriter::write_frame(
+    const PosesD& poses, const PosesD& velocities)
+{
+    assert(is_open());
+    assert(poses.size() == m_header.num_bodies);
+    assert(velocities.size() == m_header.num_bodies);
+
+    // Reuse the buffer between frames
+    static thread_local std::vector<double> frame;
+    frame.clear();
+    frame.reserve(m_header.frame_size());
+    for (const PosesD* ps : { &poses, &velocities }) {
+        for (const PoseD& pose : *ps) {
+            const VectorMax6d dof = pose.dof();
+            frame.insert(frame.end(), dof.data(), dof.data() + dof.size());
+        }
+    }
+    assert(frame.size() == m_header.frame_size());
+
+    m_file.write(
+        reinterpret_cast<const char*>(frame.data()),
+        frame.size() * sizeof(double));
+    m_file.flush();
+    m_num_frames++;
+    return bool(m_file);
+}
+
+void TrajectoryWriter::close()
+{
+    if (m_file.is_open()) {
+        m_file.close();
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Reader
+
+bool TrajectoryReader::open(const std::string& filename)
+{
+    close();
+
+    // Fall back to reading the file if it cannot be mapped
+    m_mapping.open(filename);
+
+    size_t file_size;
+    if (m_mapping.size() >= sizeof(m_header)) {
+        std::memcpy(&m_header, m_mapping.data(), sizeof(m_header));
+        file_size = m_mapping.size();
+    } else {
+        m_mapping.close();
+        m_file.open(filename, std::ios::binary | std::ios::ate);
+        if (!m_file) {
+            spdlog::error(
+                "failed to open trajectory file for reading filename={}",
+                filename);
+            return false;
+        }
+        file_size = m_file.tellg();
+        m_file.seekg(0);
+        m_file.read(reinterpret_cast<char*>(&m_header), sizeof(m_header));
+        if (!m_file) {
+            file_size = 0;
+        }
+    }
+
+    if (file_size < sizeof(m_header) || !m_header.is_valid()) {
+        spdlog::error("invalid trajectory file filename={}", filename);
+        close();
+        return false;
+    }
+
+    // Ignore a partially written trailing frame
+    m_num_frames = (file_size - sizeof(m_header))
+        / (m_header.frame_size() * sizeof(double));
+    return true;
+}
+
+void TrajectoryReader::close()
+{
+    m_mapping.close();
+    if (m_file.is_open()) {
+        m_file.close();
+    }
+    m_num_frames = 0;
+}
+
+bool TrajectoryReader::read_frame(
+    size_t i, PosesD& poses, PosesD& velocities)
+{
+    if (i >= m_num_frames) {
+        return false;
+    }
+
+    const size_t frame_size = m_header.frame_size();
+    const size_t offset = sizeof(m_header) + i * frame_size * sizeof(double);
+
+    static thread_local std::vector<double> frame;
+    frame.resize(frame_size);
+    if (m_mapping.is_open()) {
+        std::memcpy(
+            frame.data(), m_mapping.data() + offset,
+            frame_size * sizeof(double));
+    } else {
+        m_file.seekg(offset);
+        m_file.read(
+            reinterpret_cast<char*>(frame.data()),
+            frame_size * sizeof(double));
+        if (!m_file) {
+            return false;
+        }
+    }
+
+    const int ndof = PoseD::dim_to_ndof(m_header.dim);
+    poses.resize(m_header.num_bodies);
+    velocities.resize(m_header.num_bodies);
+    for (size_t j = 0; j < m_header.num_bodies; j++) {
+        poses[j] = PoseD(Eigen::Map<const Eigen::VectorXd>(
+            frame.data() + j * ndof, ndof));
+        velocities[j] = PoseD(Eigen::Map<const Eigen::VectorXd>(
+            frame.data() + (m_header.num_bodies + j) * ndof, ndof));
+    }
+    return true;
+}
+
+} // namespace ipc::rigid
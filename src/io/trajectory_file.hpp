@@ -0,0 +1,90 @@
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+
+#include <io/mapped_file.hpp>
+#include <physics/pose.hpp>
+
+namespace ipc::rigid {
+
+/// @brief Header of a binary trajectory file.
+///
+/// The header is followed by one fixed-stride frame per time-step. Each frame
+/// stores the pose dof of every body followed by the velocity dof of every
+/// body as float64.
+struct TrajectoryHeader {
+    char magic[8] = { 'R', 'I', 'P', 'C', 'T', 'R', 'A', 'J' };
+    uint32_t version = 1;
+    uint32_t dim = 0;
+    uint64_t num_bodies = 0;
+    double timestep = 0;
+
+    /// @brief Number of float64 values per frame.
+    size_t frame_size() const
+    {
+        return 2 * num_bodies * PoseD::dim_to_ndof(dim);
+    }
+    bool is_valid() const;
+};
+
+/// @brief Append-only writer of binary trajectories.
+class TrajectoryWriter {
+public:
+    ~TrajectoryWriter() { close(); }
+
+    /// @brief Create the file and write its header.
+    bool open(
+        const std::string& filename,
+        int dim,
+        size_t num_bodies,
+        double timestep);
+
+    /// @brief Reopen an existing file, keeping only its first frames.
+    bool resume(const std::string& filename, size_t num_frames);
+
+    /// @brief Append a frame and flush it to disk.
+    bool write_frame(const PosesD& poses, const PosesD& velocities);
+
+    void close();
+    bool is_open() const { return m_file.is_open(); }
+    size_t num_frames() const { return m_num_frames; }
+
+protected:
+    std::ofstream m_file;
+    TrajectoryHeader m_header;
+    size_t m_num_frames = 0;
+};
+
+/// @brief Random access reader of binary trajectories.
+///
+/// The file is memory-mapped where supported, so frames are only paged in
+/// when read.
+class TrajectoryReader {
+public:
+    TrajectoryReader() = default;
+    TrajectoryReader(const TrajectoryReader&) = delete;
+    TrajectoryReader& operator=(const TrajectoryReader&) = delete;
+    ~TrajectoryReader() { close(); }
+
+    bool open(const std::string& filename);
+    void close();
+
+    const TrajectoryHeader& header() const { return m_header; }
+    size_t num_frames() const { return m_num_frames; }
+
+    /// @brief Read the poses and velocities of the ith frame.
+    bool read_frame(size_t i, PosesD& poses, PosesD& velocities);
+
+protected:
+    TrajectoryHeader m_header;
+    size_t m_num_frames = 0;
+
+    /// @brief Mapped contents of the file (closed if not mapped).
+    MappedFile m_mapping;
+    /// @brief Fallback used if the file cannot be mapped.
+    std::ifstream m_file;
+};
+
+} // namespace ipc::rigid
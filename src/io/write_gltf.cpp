@@ -1,5 +1,8 @@
 #include "write_gltf.hpp"
 
+#include <string_view>
+#include <unordered_map>
+
 #define TINYGLTF_IMPLEMENTATION
 #define TINYGLTF_NO_INCLUDE_JSON
 #define TINYGLTF_NO_STB_IMAGE
@@ -7,8 +10,70 @@
 #include <nlohmann/json.hpp>
 #include <tiny_gltf.h>
 
+#include <logger.hpp>
+
 namespace ipc::rigid {
 
+namespace {
+    /// @brief Hash of the coefficients of a matrix.
+    template <typename Matrix> size_t hash_bytes(const Matrix& M)
+    {
+        return std::hash<std::string_view>()(std::string_view(
+            reinterpret_cast<const char*>(M.data()),
+            sizeof(typename Matrix::Scalar) * M.size()));
+    }
+} // namespace
+
+void gltf_mesh_instances(
+    const RigidBodyAssembler& bodies,
+    const GltfSettings& settings,
+    std::vector<size_t>& mesh_ids,
+    std::vector<size_t>& mesh_bodies)
+{
+    mesh_ids.resize(bodies.num_bodies());
+    mesh_bodies.clear();
+    std::unordered_map<const RigidBodyGeometry*, size_t> geometry_meshes;
+    // Meshes by a hash of their vertices and faces (checked for equality)
+    std::unordered_multimap<size_t, size_t> hash_meshes;
+    for (size_t i = 0; i < bodies.num_bodies(); i++) {
+        const RigidBody& body = bodies[i];
+        if (settings.instance_shared_geometry && body.geometry != nullptr) {
+            const auto it = geometry_meshes.find(body.geometry.get());
+            if (it != geometry_meshes.end()) {
+                mesh_ids[i] = it->second;
+                continue;
+            }
+        }
+
+        size_t mesh_id = mesh_bodies.size();
+        if (settings.deduplicate_identical_geometry) {
+            const size_t hash =
+                hash_bytes(body.vertices) ^ (hash_bytes(body.faces) * 31);
+            const auto range = hash_meshes.equal_range(hash);
+            for (auto it = range.first; it != range.second; ++it) {
+                const RigidBody& other = bodies[mesh_bodies[it->second]];
+                if (other.vertices.rows() == body.vertices.rows()
+                    && other.faces.rows() == body.faces.rows()
+                    && other.vertices == body.vertices
+                    && other.faces == body.faces) {
+                    mesh_id = it->second;
+                    break;
+                }
+            }
+            if (mesh_id == mesh_bodies.size()) {
+                hash_meshes.emplace(hash, mesh_id);
+            }
+        }
+        if (mesh_id == mesh_bodies.size()) {
+            mesh_bodies.push_back(i);
+        }
+        mesh_ids[i] = mesh_id;
+        if (settings.instance_shared_geometry && body.geometry != nullptr) {
+            geometry_meshes.emplace(body.geometry.get(), mesh_id);
+        }
+    }
+}
+
 bool write_gltf(
     const std::string& filename,
     const RigidBodyAssembler& bodies,
@@ -34,6 +99,10 @@ bool write_gltf(
     assert(poses.size() > 0);
     size_t num_steps = poses.size();
 
+    std::vector<size_t> mesh_ids, mesh_bodies;
+    gltf_mesh_instances(bodies, GltfSettings(), mesh_ids, mesh_bodies);
+    const size_t num_meshes = mesh_bodies.size();
+
     Model model;
     model.defaultScene = 0;
 
@@ -51,13 +120,14 @@ bool write_gltf(
     animation.name = "Simulation";
     animation.channels.resize(2 * num_bodies);
     animation.samplers.resize(2 * num_bodies);
-    model.meshes.resize(num_bodies);
-    // Four accessors per bidy: vertices, faces, translations, and rotations
-    model.accessors.resize(4 * num_bodies + 1);
+    model.meshes.resize(num_meshes);
+    // Two accessors per mesh (vertices and faces) and per body (translations
+    // and rotations)
+    model.accessors.resize(2 * num_meshes + 2 * num_bodies + 1);
     {
-        Accessor& accessor = model.accessors[2 * num_bodies];
+        Accessor& accessor = model.accessors[2 * num_meshes];
         accessor.name = "Times";
-        accessor.bufferView = 2 * num_bodies;
+        accessor.bufferView = 2 * num_meshes;
         accessor.componentType = float_component_type;
         accessor.count = num_steps;
         accessor.minValues.push_back(timestep);
@@ -67,7 +137,7 @@ bool write_gltf(
 
     for (int i = 0; i < num_bodies; i++) {
         Node& node = model.nodes[i];
-        node.mesh = i;
+        node.mesh = mesh_ids[i];
         node.name = bodies[i].name;
         node.translation = { { poses[0][i].position.x(),
                                poses[0][i].position.y(),
@@ -82,74 +152,76 @@ bool write_gltf(
         animation.channels[2 * i + 1].target_node = i;
         animation.channels[2 * i + 1].target_path = "rotation";
 
-        animation.samplers[2 * i + 0].input = 2 * num_bodies;
-        animation.samplers[2 * i + 0].output = 2 * num_bodies + 2 * i + 1;
+        animation.samplers[2 * i + 0].input = 2 * num_meshes;
+        animation.samplers[2 * i + 0].output = 2 * num_meshes + 2 * i + 1;
         animation.samplers[2 * i + 0].interpolation = "LINEAR";
-        animation.samplers[2 * i + 1].input = 2 * num_bodies;
-        animation.samplers[2 * i + 1].output = 2 * num_bodies + 2 * i + 2;
+        animation.samplers[2 * i + 1].input = 2 * num_meshes;
+        animation.samplers[2 * i + 1].output = 2 * num_meshes + 2 * i + 2;
         animation.samplers[2 * i + 1].interpolation = "LINEAR";
 
-        Mesh& mesh = model.meshes[i];
-        mesh.name = bodies[i].name;
-        Primitive& primitive = mesh.primitives.emplace_back();
-        primitive.attributes["POSITION"] = 2 * i;
-        primitive.indices = 2 * i + 1;
-        primitive.mode = TINYGLTF_MODE_TRIANGLES;
-
-        Accessor* accessor = &model.accessors[2 * i];
-        accessor->name = bodies[i].name + "Vertices";
-        accessor->bufferView = 2 * i;
-        accessor->componentType = float_component_type;
-        accessor->count = bodies[i].num_vertices();
-        // accessor->max = ...;
-        // accessor->min = ...;
-        accessor->type = TINYGLTF_TYPE_VEC3;
-
-        accessor = &model.accessors[2 * i + 1];
-        accessor->name = bodies[i].name + "Faces";
-        accessor->bufferView = 2 * i + 1;
-        accessor->componentType = TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT;
-        accessor->count = 3 * bodies[i].num_faces();
-        accessor->type = TINYGLTF_TYPE_SCALAR;
-
-        accessor = &model.accessors[2 * num_bodies + 2 * i + 1];
+        Accessor* accessor = &model.accessors[2 * num_meshes + 2 * i + 1];
         accessor->name = bodies[i].name + "Translations";
-        accessor->bufferView = 2 * num_bodies + 2 * i + 1;
+        accessor->bufferView = 2 * num_meshes + 2 * i + 1;
         accessor->componentType = float_component_type;
         accessor->count = num_steps;
         accessor->type = TINYGLTF_TYPE_VEC3;
 
-        accessor = &model.accessors[2 * num_bodies + 2 * i + 2];
+        accessor = &model.accessors[2 * num_meshes + 2 * i + 2];
         accessor->name = bodies[i].name + "Rotations";
-        accessor->bufferView = 2 * num_bodies + 2 * i + 2;
+        accessor->bufferView = 2 * num_meshes + 2 * i + 2;
         accessor->componentType = float_component_type;
         accessor->count = num_steps;
         accessor->type = TINYGLTF_TYPE_VEC4;
+    }
+
+    for (int m = 0; m < num_meshes; m++) {
+        const RigidBody& body = bodies[mesh_bodies[m]];
+        Mesh& mesh = model.meshes[m];
+        mesh.name = body.name;
+        Primitive& primitive = mesh.primitives.emplace_back();
+        primitive.attributes["POSITION"] = 2 * m;
+        primitive.indices = 2 * m + 1;
+        primitive.mode = TINYGLTF_MODE_TRIANGLES;
+
+        Accessor* accessor = &model.accessors[2 * m];
+        accessor->name = body.name + "Vertices";
+        accessor->bufferView = 2 * m;
+        accessor->componentType = float_component_type;
+        accessor->count = body.num_vertices();
+        // accessor->max = ...;
+        // accessor->min = ...;
+        accessor->type = TINYGLTF_TYPE_VEC3;
 
-        BufferView& buffer_view = model.bufferViews[2 * i];
+        accessor = &model.accessors[2 * m + 1];
+        accessor->name = body.name + "Faces";
+        accessor->bufferView = 2 * m + 1;
+        accessor->componentType = TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT;
+        accessor->count = 3 * body.num_faces();
+        accessor->type = TINYGLTF_TYPE_SCALAR;
     }
 
     ///////////////////////////////////////////////////////////////////////////
 
-    model.bufferViews.resize(4 * num_bodies + 1);
+    model.bufferViews.resize(2 * num_meshes + 2 * num_bodies + 1);
     size_t byte_offset = 0;
-    for (int i = 0; i < num_bodies; i++) {
-        BufferView* buffer_view = &model.bufferViews[2 * i];
-        buffer_view->name = bodies[i].name + "Vertices";
+    for (int m = 0; m < num_meshes; m++) {
+        const RigidBody& body = bodies[mesh_bodies[m]];
+        BufferView* buffer_view = &model.bufferViews[2 * m];
+        buffer_view->name = body.name + "Vertices";
         buffer_view->buffer = 0;
-        buffer_view->byteLength = sizeof(Float) * bodies[i].vertices.size();
+        buffer_view->byteLength = sizeof(Float) * body.vertices.size();
         buffer_view->byteOffset = byte_offset;
         byte_offset += buffer_view->byteLength;
 
-        buffer_view = &model.bufferViews[2 * i + 1];
-        buffer_view->name = bodies[i].name + "Faces";
+        buffer_view = &model.bufferViews[2 * m + 1];
+        buffer_view->name = body.name + "Faces";
         buffer_view->buffer = 0;
-        buffer_view->byteLength = sizeof(unsigned int) * bodies[i].faces.size();
+        buffer_view->byteLength = sizeof(unsigned int) * body.faces.size();
         buffer_view->byteOffset = byte_offset;
         byte_offset += buffer_view->byteLength;
     }
     {
-        BufferView& buffer_view = model.bufferViews[2 * num_bodies];
+        BufferView& buffer_view = model.bufferViews[2 * num_meshes];
         buffer_view.name = "Times";
         buffer_view.buffer = 0;
         buffer_view.byteLength = num_steps * sizeof(Float);
@@ -158,14 +230,14 @@ bool write_gltf(
     }
     for (int i = 0; i < num_bodies; i++) {
         BufferView* buffer_view =
-            &model.bufferViews[2 * num_bodies + 2 * i + 1];
+            &model.bufferViews[2 * num_meshes + 2 * i + 1];
         buffer_view->name = bodies[i].name + "Translations";
         buffer_view->buffer = 0;
         buffer_view->byteLength = 3 * sizeof(Float) * num_steps;
         buffer_view->byteOffset = byte_offset;
         byte_offset += buffer_view->byteLength;
 
-        buffer_view = &model.bufferViews[2 * num_bodies + 2 * i + 2];
+        buffer_view = &model.bufferViews[2 * num_meshes + 2 * i + 2];
         buffer_view->name = bodies[i].name + "Rotations";
         buffer_view->buffer = 0;
         buffer_view->byteLength = 4 * sizeof(Float) * num_steps;
@@ -177,8 +249,9 @@ bool write_gltf(
 
     std::vector<unsigned char> byte_data(byte_offset);
     size_t byte_i = 0;
-    for (int i = 0; i < num_bodies; i++) {
-        Eigen::MatrixXd V = bodies[i].vertices;
+    for (int m = 0; m < num_meshes; m++) {
+        const RigidBody& body = bodies[mesh_bodies[m]];
+        Eigen::MatrixXd V = body.vertices;
         for (int r = 0; r < V.rows(); r++) {
             for (int c = 0; c < V.cols(); c++) {
                 Float v = V(r, c);
@@ -187,7 +260,7 @@ bool write_gltf(
             }
         }
 
-        Eigen::MatrixXi F = bodies[i].faces;
+        Eigen::MatrixXi F = body.faces;
         for (int r = 0; r < F.rows(); r++) {
             for (int c = 0; c < F.cols(); c++) {
                 unsigned int fij = F(r, c);
@@ -229,4 +302,382 @@ bool write_gltf(
         /*embedImages=*/true, embed_buffers, prettyPrint, write_binary);
 }
 
+///////////////////////////////////////////////////////////////////////////////
+
+namespace {
+    const uint32_t GLB_MAGIC = 0x46546C67;      // "glTF"
+    const uint32_t GLB_JSON_CHUNK = 0x4E4F534A; // "JSON"
+    const uint32_t GLB_BIN_CHUNK = 0x004E4942;  // "BIN"
+
+    void write_uint32(std::ofstream& file, uint32_t value)
+    {
+        file.write(reinterpret_cast<const char*>(&value), sizeof(value));
+    }
+
+    nlohmann::json buffer_view_json(size_t byte_offset, size_t byte_length)
+    {
+        return { { "buffer", 0 },
+                 { "byteOffset", byte_offset },
+                 { "byteLength", byte_length } };
+    }
+} // namespace
+
+bool GltfStreamWriter::open(
+    const std::string& filename,
+    const RigidBodyAssembler& bodies,
+    const PosesD& initial_poses,
+    size_t num_frames,
+    double timestep,
+    const GltfSettings& settings)
+{
+    using json = nlohmann::json;
+    close();
+
+    assert(bodies.dim() == 3);
+    assert(num_frames > 0);
+    assert(initial_poses.size() == bodies.num_bodies());
+    m_num_bodies = bodies.num_bodies();
+    m_num_frames = num_frames;
+    m_num_frames_written = 0;
+    m_first_buffered_frame = 0;
+
+    // Same layout as write_gltf(): the shared meshes, the times, and then
+    // the translations and rotations of each body.
+    json gltf;
+    gltf["asset"] = { { "version", "2.0" }, { "generator", "RigidIPC" } };
+    gltf["scene"] = 0;
+    gltf["scenes"] = json::array();
+    gltf["scenes"].push_back({ { "name", "RigidIPCSimulation" },
+                               { "nodes", json::array() } });
+    json& nodes = gltf["nodes"] = json::array();
+    json& meshes = gltf["meshes"] = json::array();
+    json& accessors = gltf["accessors"] = json::array();
+    json& buffer_views = gltf["bufferViews"] = json::array();
+    json channels = json::array(), samplers = json::array();
+
+    std::vector<size_t> mesh_ids, mesh_bodies;
+    gltf_mesh_instances(bodies, settings, mesh_ids, mesh_bodies);
+    const size_t num_meshes = mesh_bodies.size();
+    const bool is_quantized = settings.quantize_vertices;
+    if (is_quantized) {
+        gltf["extensionsUsed"] = { "KHR_mesh_quantization" };
+        gltf["extensionsRequired"] = { "KHR_mesh_quantization" };
+    }
+
+    // Quantized vertices are in [-1, 1]³ and mapped back to the body frame by
+    // a child node of the animated node of the body.
+    std::vector<Eigen::Vector3d> mesh_centers(num_meshes),
+        mesh_scales(num_meshes);
+    const auto quantize = [&](const Eigen::Vector3d& v, size_t m) {
+        const Eigen::Array3d u =
+            (v - mesh_centers[m]).array() / mesh_scales[m].array();
+        return (u.max(-1).min(1) * INT16_MAX).round().cast<int16_t>().eval();
+    };
+    // 65535 is the primitive restart index
+    const auto has_short_indices = [&](const RigidBody& body) {
+        return is_quantized && body.num_vertices() < UINT16_MAX;
+    };
+
+    for (size_t i = 0; i < m_num_bodies; i++) {
+        gltf["scenes"][0]["nodes"].push_back(i);
+        const Eigen::Vector3d& p = initial_poses[i].position;
+        Eigen::Quaternion<double> q = initial_poses[i].construct_quaternion();
+        json node = { { "name", bodies[i].name },
+                      { "translation", { p.x(), p.y(), p.z() } },
+                      { "rotation", { q.x(), q.y(), q.z(), q.w() } } };
+        if (is_quantized) {
+            node["children"] = json::array({ m_num_bodies + i });
+        } else {
+            node["mesh"] = mesh_ids[i];
+        }
+        nodes.push_back(node);
+    }
+
+    size_t byte_offset = 0;
+    for (size_t m = 0; m < num_meshes; m++) {
+        const RigidBody& body = bodies[mesh_bodies[m]];
+        json primitive = { { "attributes", { { "POSITION", 2 * m } } },
+                           { "indices", 2 * m + 1 },
+                           { "mode", TINYGLTF_MODE_TRIANGLES } };
+        meshes.push_back({ { "name", body.name },
+                           { "primitives", json::array({ primitive }) } });
+
+        const Eigen::Vector3d V_min = body.vertices.colwise().minCoeff();
+        const Eigen::Vector3d V_max = body.vertices.colwise().maxCoeff();
+        json vertices = { { "name", body.name + "Vertices" },
+                          { "bufferView", 2 * m },
+                          { "count", body.num_vertices() },
+                          { "type", "VEC3" } };
+        size_t vertex_bytes;
+        if (is_quantized) {
+            mesh_centers[m] = (V_min + V_max) / 2;
+            mesh_scales[m] = ((V_max - V_min) / 2).unaryExpr([](double s) {
+                return s > 0 ? s : 1.0;
+            });
+            const Eigen::Vector3d q_min =
+                quantize(V_min, m).cast<double>() / INT16_MAX;
+            const Eigen::Vector3d q_max =
+                quantize(V_max, m).cast<double>() / INT16_MAX;
+            vertices["componentType"] = TINYGLTF_COMPONENT_TYPE_SHORT;
+            vertices["normalized"] = true;
+            vertices["min"] = { q_min.x(), q_min.y(), q_min.z() };
+            vertices["max"] = { q_max.x(), q_max.y(), q_max.z() };
+            // Vertex attributes are aligned to four bytes
+            vertex_bytes = 4 * sizeof(int16_t) * body.num_vertices();
+        } else {
+            vertices["componentType"] = TINYGLTF_COMPONENT_TYPE_FLOAT;
+            vertices["min"] = { V_min.x(), V_min.y(), V_min.z() };
+            vertices["max"] = { V_max.x(), V_max.y(), V_max.z() };
+            vertex_bytes = sizeof(float) * body.vertices.size();
+        }
+        accessors.push_back(vertices);
+        accessors.push_back(
+            { { "name", body.name + "Faces" },
+              { "bufferView", 2 * m + 1 },
+              { "componentType",
+                has_short_indices(body)
+                    ? TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT
+                    : TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT },
+              { "count", 3 * body.num_faces() },
+              { "type", "SCALAR" } });
+
+        buffer_views.push_back(buffer_view_json(byte_offset, vertex_bytes));
+        if (is_quantized) {
+            buffer_views.back()["byteStride"] = 4 * sizeof(int16_t);
+        }
+        byte_offset += vertex_bytes;
+        // Padded so the following views stay aligned to four bytes
+        const size_t index_bytes = has_short_indices(body)
+            ? (sizeof(uint16_t) * body.faces.size() + 3) / 4 * 4
+            : sizeof(uint32_t) * body.faces.size();
+        buffer_views.push_back(buffer_view_json(byte_offset, index_bytes));
+        byte_offset += index_bytes;
+    }
+
+    if (is_quantized) {
+        for (size_t i = 0; i < m_num_bodies; i++) {
+            const Eigen::Vector3d& c = mesh_centers[mesh_ids[i]];
+            const Eigen::Vector3d& s = mesh_scales[mesh_ids[i]];
+            nodes.push_back({ { "name", bodies[i].name + "Mesh" },
+                              { "mesh", mesh_ids[i] },
+                              { "translation", { c.x(), c.y(), c.z() } },
+                              { "scale", { s.x(), s.y(), s.z() } } });
+        }
+    }
+
+    const size_t times_id = 2 * num_meshes;
+    accessors.push_back(
+        { { "name", "Times" },
+          { "bufferView", times_id },
+          { "componentType", TINYGLTF_COMPONENT_TYPE_FLOAT },
+          { "count", num_frames },
+          { "min", json::array({ 0.0 }) },
+          { "max", json::array({ float((num_frames - 1) * timestep) }) },
+          { "type", "SCALAR" } });
+    buffer_views.push_back(
+        buffer_view_json(byte_offset, sizeof(float) * num_frames));
+    byte_offset += sizeof(float) * num_frames;
+
+    m_translation_offsets.resize(m_num_bodies);
+    m_rotation_offsets.resize(m_num_bodies);
+    for (size_t i = 0; i < m_num_bodies; i++) {
+        const std::string& name = bodies[i].name;
+        const size_t translations_id = times_id + 2 * i + 1;
+        const size_t rotations_id = times_id + 2 * i + 2;
+
+        accessors.push_back(
+            { { "name", name + "Translations" },
+              { "bufferView", translations_id },
+              { "componentType", TINYGLTF_COMPONENT_TYPE_FLOAT },
+              { "count", num_frames },
+              { "type", "VEC3" } });
+        accessors.push_back(
+            { { "name", name + "Rotations" },
+              { "bufferView", rotations_id },
+              { "componentType", TINYGLTF_COMPONENT_TYPE_FLOAT },
+              { "count", num_frames },
+              { "type", "VEC4" } });
+
+        m_translation_offsets[i] = byte_offset;
+        buffer_views.push_back(
+            buffer_view_json(byte_offset, 3 * sizeof(float) * num_frames));
+        byte_offset += 3 * sizeof(float) * num_frames;
+        m_rotation_offsets[i] = byte_offset;
+        buffer_views.push_back(
+            buffer_view_json(byte_offset, 4 * sizeof(float) * num_frames));
+        byte_offset += 4 * sizeof(float) * num_frames;
+
+        samplers.push_back({ { "input", times_id },
+                             { "output", translations_id },
+                             { "interpolation", "LINEAR" } });
+        samplers.push_back({ { "input", times_id },
+                             { "output", rotations_id },
+                             { "interpolation", "LINEAR" } });
+        channels.push_back(
+            { { "sampler", 2 * i },
+              { "target", { { "node", i }, { "path", "translation" } } } });
+        channels.push_back(
+            { { "sampler", 2 * i + 1 },
+              { "target", { { "node", i }, { "path", "rotation" } } } });
+    }
+    gltf["animations"] = json::array();
+    gltf["animations"].push_back({ { "name", "Simulation" },
+                                   { "channels", channels },
+                                   { "samplers", samplers } });
+    gltf["buffers"] = json::array();
+    gltf["buffers"].push_back({ { "byteLength", byte_offset } });
+
+    // Every sample is four bytes, so only the JSON chunk needs padding.
+    std::string json_chunk = gltf.dump();
+    json_chunk.resize((json_chunk.size() + 3) / 4 * 4, ' ');
+    const size_t bin_start = 12 + 8 + json_chunk.size() + 8;
+    for (size_t i = 0; i < m_num_bodies; i++) {
+        m_translation_offsets[i] += bin_start;
+        m_rotation_offsets[i] += bin_start;
+    }
+
+    m_file.open(filename, std::ios::binary | std::ios::trunc);
+    if (!m_file) {
+        spdlog::error("unable to open glTF file filename={}", filename);
+        return false;
+    }
+    write_uint32(m_file, GLB_MAGIC);
+    write_uint32(m_file, 2);
+    write_uint32(m_file, bin_start + byte_offset);
+    write_uint32(m_file, json_chunk.size());
+    write_uint32(m_file, GLB_JSON_CHUNK);
+    m_file.write(json_chunk.data(), json_chunk.size());
+    write_uint32(m_file, byte_offset);
+    write_uint32(m_file, GLB_BIN_CHUNK);
+
+    // The meshes and times are small, so write them right away.
+    for (size_t m = 0; m < num_meshes; m++) {
+        const RigidBody& body = bodies[mesh_bodies[m]];
+        // Eigen is column major, but glTF expects one vertex/face at a time.
+        if (is_quantized) {
+            Eigen::Matrix<int16_t, 4, Eigen::Dynamic> VT =
+                Eigen::Matrix<int16_t, 4, Eigen::Dynamic>::Zero(
+                    4, body.num_vertices());
+            for (int vi = 0; vi < body.num_vertices(); vi++) {
+                VT.col(vi).head<3>() =
+                    quantize(body.vertices.row(vi).transpose(), m);
+            }
+            m_file.write(
+                reinterpret_cast<const char*>(VT.data()),
+                sizeof(int16_t) * VT.size());
+        } else {
+            const Eigen::MatrixXf VT =
+                body.vertices.transpose().cast<float>();
+            m_file.write(
+                reinterpret_cast<const char*>(VT.data()),
+                sizeof(float) * VT.size());
+        }
+        if (has_short_indices(body)) {
+            std::vector<uint16_t> FT(body.faces.size());
+            for (int fi = 0; fi < body.num_faces(); fi++) {
+                for (int j = 0; j < 3; j++) {
+                    FT[3 * fi + j] = body.faces(fi, j);
+                }
+            }
+            FT.resize((FT.size() + 1) / 2 * 2, 0);
+            m_file.write(
+                reinterpret_cast<const char*>(FT.data()),
+                sizeof(uint16_t) * FT.size());
+        } else {
+            const Eigen::Matrix<uint32_t, Eigen::Dynamic, Eigen::Dynamic> FT =
+                body.faces.transpose().cast<uint32_t>();
+            m_file.write(
+                reinterpret_cast<const char*>(FT.data()),
+                sizeof(uint32_t) * FT.size());
+        }
+    }
+    for (size_t i = 0; i < num_frames; i++) {
+        const float t = i * timestep;
+        m_file.write(reinterpret_cast<const char*>(&t), sizeof(float));
+    }
+
+    // Samples of body i start at i * FRAMES_PER_FLUSH
+    m_translations.resize(3 * FRAMES_PER_FLUSH * m_num_bodies);
+    m_rotations.resize(4 * FRAMES_PER_FLUSH * m_num_bodies);
+    m_last_poses = initial_poses;
+    return bool(m_file);
+}
+
+bool GltfStreamWriter::write_frame(const PosesD& poses)
+{
+    assert(is_open());
+    assert(poses.size() == m_num_bodies);
+    if (m_num_frames_written >= m_num_frames) {
+        spdlog::error(
+            "too many glTF frames num_frames={} expected={}",
+            m_num_frames_written + 1, m_num_frames);
+        return false;
+    }
+
+    const size_t num_buffered = m_num_frames_written - m_first_buffered_frame;
+    for (size_t i = 0; i < m_num_bodies; i++) {
+        float* t = &m_translations[3 * (i * FRAMES_PER_FLUSH + num_buffered)];
+        float* r = &m_rotations[4 * (i * FRAMES_PER_FLUSH + num_buffered)];
+        const Eigen::Quaternion<double> q = poses[i].construct_quaternion();
+        for (int d = 0; d < 3; d++) {
+            t[d] = poses[i].position[d];
+        }
+        r[0] = q.x();
+        r[1] = q.y();
+        r[2] = q.z();
+        r[3] = q.w();
+    }
+    m_num_frames_written++;
+    m_last_poses = poses;
+
+    if (m_num_frames_written - m_first_buffered_frame == FRAMES_PER_FLUSH) {
+        flush_samples();
+    }
+    return bool(m_file);
+}
+
+void GltfStreamWriter::flush_samples()
+{
+    const size_t num_buffered = m_num_frames_written - m_first_buffered_frame;
+    if (num_buffered == 0) {
+        return;
+    }
+    for (size_t i = 0; i < m_num_bodies; i++) {
+        m_file.seekp(
+            m_translation_offsets[i]
+            + 3 * sizeof(float) * m_first_buffered_frame);
+        m_file.write(
+            reinterpret_cast<const char*>(
+                &m_translations[3 * i * FRAMES_PER_FLUSH]),
+            3 * sizeof(float) * num_buffered);
+        m_file.seekp(
+            m_rotation_offsets[i] + 4 * sizeof(float) * m_first_buffered_frame);
+        m_file.write(
+            reinterpret_cast<const char*>(
+                &m_rotations[4 * i * FRAMES_PER_FLUSH]),
+            4 * sizeof(float) * num_buffered);
+    }
+    m_first_buffered_frame = m_num_frames_written;
+}
+
+bool GltfStreamWriter::close()
+{
+    if (!is_open()) {
+        return false;
+    }
+    if (m_num_frames_written < m_num_frames) {
+        spdlog::warn(
+            "missing glTF frames num_frames={} expected={}",
+            m_num_frames_written, m_num_frames);
+        const PosesD last_poses = m_last_poses;
+        while (m_num_frames_written < m_num_frames) {
+            write_frame(last_poses);
+        }
+    }
+    flush_samples();
+    const bool success = bool(m_file);
+    m_file.close();
+    return success;
+}
+
 } // namespace ipc::rigid
@@ -1,11 +1,36 @@
 #pragma once
 
+#include <fstream>
 #include <string>
+#include <vector>
 
 #include <physics/rigid_body_assembler.hpp>
 
 namespace ipc::rigid {
 
+/// @brief Mesh layout of the exported glTF files.
+struct GltfSettings {
+    /// @brief Share one mesh between bodies with the same geometry (e.g.,
+    /// instances of one asset).
+    bool instance_shared_geometry = true;
+    /// @brief Also share one mesh between bodies with identical vertices
+    /// and faces.
+    bool deduplicate_identical_geometry = true;
+    /// @brief Store vertices as normalized 16-bit integers in the bounding
+    /// box of each mesh (KHR_mesh_quantization) and small index buffers as
+    /// 16-bit integers.
+    bool quantize_vertices = false;
+};
+
+/// @brief Index of the glTF mesh of each body.
+/// @param[out] mesh_ids    Mesh of each body.
+/// @param[out] mesh_bodies First body using each mesh.
+void gltf_mesh_instances(
+    const RigidBodyAssembler& bodies,
+    const GltfSettings& settings,
+    std::vector<size_t>& mesh_ids,
+    std::vector<size_t>& mesh_bodies);
+
 bool write_gltf(
     const std::string& filename,
     const RigidBodyAssembler& bodies,
@@ -15,4 +40,52 @@ bool write_gltf(
     bool write_binary = true,
     bool prettyPrint = true);
 
+/// @brief Write a GLB animation one frame at a time.
+///
+/// The layout of the binary chunk is fixed by the number of frames, so the
+/// samples are written in place and only a few frames per body are buffered.
+class GltfStreamWriter {
+public:
+    ~GltfStreamWriter() { close(); }
+
+    /// @brief Write the meshes and the layout of the animation.
+    /// @param initial_poses Poses of the bodies in the glTF scene.
+    bool open(
+        const std::string& filename,
+        const RigidBodyAssembler& bodies,
+        const PosesD& initial_poses,
+        size_t num_frames,
+        double timestep,
+        const GltfSettings& settings = GltfSettings());
+
+    /// @brief Append the poses of the next frame.
+    bool write_frame(const PosesD& poses);
+
+    /// @brief Flush the buffered samples and finish the file.
+    /// Missing frames repeat the last written poses.
+    bool close();
+
+    bool is_open() const { return m_file.is_open(); }
+    size_t num_frames_written() const { return m_num_frames_written; }
+
+    /// @brief Number of frames buffered per body before writing them.
+    static constexpr size_t FRAMES_PER_FLUSH = 64;
+
+protected:
+    void flush_samples();
+
+    std::ofstream m_file;
+    size_t m_num_bodies = 0;
+    size_t m_num_frames = 0;
+    size_t m_num_frames_written = 0;
+    /// @brief First frame of the buffered samples.
+    size_t m_first_buffered_frame = 0;
+
+    /// @brief File offsets of the translation and rotation samples per body.
+    std::vector<size_t> m_translation_offsets, m_rotation_offsets;
+    /// @brief Buffered samples ordered by body, then frame.
+    std::vector<float> m_translations, m_rotations;
+    PosesD m_last_poses;
+};
+
 } // namespace ipc::rigid
@@ -13,6 +13,7 @@
 #include <fstream>
 #include <iomanip>
 #include <iostream>
+#include <iterator>
 #include <limits>
 
 #include <ghc/fs_std.hpp> // filesystem
@@ -117,4 +118,76 @@ bool write_obj(
     return true;
 }
 
+namespace {
+    void format_vertices(fmt::memory_buffer& out, const Eigen::MatrixXd& V)
+    {
+        for (int i = 0; i < V.rows(); i++) {
+            out.push_back('v');
+            for (int j = 0; j < V.cols(); j++) {
+                // Shortest representation that reads back exactly
+                fmt::format_to(std::back_inserter(out), " {}", V(i, j));
+            }
+            out.push_back('\n');
+        }
+    }
+
+    bool
+    write_buffer(const std::string& filename, const fmt::memory_buffer& out)
+    {
+        std::FILE* file = std::fopen(filename.c_str(), "wb");
+        if (file == nullptr) {
+            spdlog::error("IOError: write_obj() could not open {}", filename);
+            return false;
+        }
+        const bool success = std::fwrite(out.data(), 1, out.size(), file)
+            == out.size();
+        return std::fclose(file) == 0 && success;
+    }
+} // namespace
+
+bool write_obj(
+    const std::string& filename,
+    const RigidBodyAssembler& bodies,
+    const PosesD& poses)
+{
+    assert(poses.size() == bodies.num_bodies());
+    fmt::memory_buffer s, ps;
+    auto out = std::back_inserter(s);
+    fmt::format_to(out, "mtllib mat.mtl\n");
+    fmt::format_to(std::back_inserter(ps), "mtllib mat.mtl\n");
+
+    size_t start_vi = 1;
+    for (size_t i = 0; i < bodies.num_bodies(); i++) {
+        const RigidBody& body = bodies[i];
+        const Eigen::MatrixXd V = body.world_vertices(poses[i]);
+        const Eigen::MatrixXi& F = body.faces;
+        const Eigen::MatrixXi& E = body.edges;
+        if (F.rows() == 0 && E.rows() == 0) {
+            fmt::format_to(
+                std::back_inserter(ps), "o body{0:04d}\nusemtl body{0:04d}\n",
+                i);
+            format_vertices(ps, V);
+            continue;
+        }
+        fmt::format_to(out, "o body{0:04d}\nusemtl body{0:04d}\n", i);
+        format_vertices(s, V);
+        for (int fi = 0; fi < F.rows(); fi++) {
+            fmt::format_to(
+                out, "f {:d} {:d} {:d}\n", F(fi, 0) + start_vi,
+                F(fi, 1) + start_vi, F(fi, 2) + start_vi);
+        }
+        for (const size_t& ei : body.mesh_selector().codim_edges_to_edges()) {
+            fmt::format_to(
+                out, "l {:d} {:d}\n", E(ei, 0) + start_vi, E(ei, 1) + start_vi);
+        }
+        start_vi += V.rows();
+    }
+
+    const fs::path p(filename);
+    return write_buffer(filename, s)
+        && write_buffer(
+               (p.parent_path() / ("points-" + p.filename().string())).string(),
+               ps);
+}
+
 } // namespace ipc::rigid
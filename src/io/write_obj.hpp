@@ -14,6 +14,7 @@
 
 #include <Eigen/Core>
 
+#include <physics/rigid_body_assembler.hpp>
 #include <physics/simulation_problem.hpp>
 
 namespace ipc::rigid {
@@ -30,4 +31,14 @@ bool write_obj(
     const SimulationProblem& problem,
     bool write_mtl);
 
+/// @brief Write the bodies at the given poses (one per body in the
+/// assembler's order) like write_obj() of a problem.
+///
+/// The bodies are not modified, so frames can be written concurrently. The
+/// text is formatted into one buffer that is written at once.
+bool write_obj(
+    const std::string& filename,
+    const RigidBodyAssembler& bodies,
+    const PosesD& poses);
+
 } // namespace ipc::rigid
@@ -13,6 +13,47 @@
 
 #include <ipc/broad_phase/collision_candidate.hpp>
 
+/// @brief Lowest level of the logging macros below that is compiled in
+/// (SPDLOG_LEVEL_TRACE, …, SPDLOG_LEVEL_OFF).
+#ifndef RIGID_IPC_LOG_ACTIVE_LEVEL
+#define RIGID_IPC_LOG_ACTIVE_LEVEL SPDLOG_LEVEL_TRACE
+#endif
+
+/// @brief Log with the default logger only evaluating (and formatting) the
+/// arguments if the level is enabled at runtime.
+#define RIGID_IPC_LOG(level, ...)                                              \
+    do {                                                                       \
+        if (spdlog::default_logger_raw()->should_log(level)) {                 \
+            spdlog::default_logger_raw()->log(level, __VA_ARGS__);             \
+        }                                                                      \
+    } while (0)
+
+/// @brief Logging macros removed at compile time below the active level.
+#if RIGID_IPC_LOG_ACTIVE_LEVEL <= SPDLOG_LEVEL_TRACE
+#define RIGID_IPC_LOG_TRACE(...)                                               \
+    RIGID_IPC_LOG(spdlog::level::trace, __VA_ARGS__)
+#else
+#define RIGID_IPC_LOG_TRACE(...) (void)0
+#endif
+#if RIGID_IPC_LOG_ACTIVE_LEVEL <= SPDLOG_LEVEL_DEBUG
+#define RIGID_IPC_LOG_DEBUG(...)                                               \
+    RIGID_IPC_LOG(spdlog::level::debug, __VA_ARGS__)
+#else
+#define RIGID_IPC_LOG_DEBUG(...) (void)0
+#endif
+#if RIGID_IPC_LOG_ACTIVE_LEVEL <= SPDLOG_LEVEL_INFO
+#define RIGID_IPC_LOG_INFO(...)                                                \
+    RIGID_IPC_LOG(spdlog::level::info, __VA_ARGS__)
+#else
+#define RIGID_IPC_LOG_INFO(...) (void)0
+#endif
+#if RIGID_IPC_LOG_ACTIVE_LEVEL <= SPDLOG_LEVEL_WARN
+#define RIGID_IPC_LOG_WARN(...)                                                \
+    RIGID_IPC_LOG(spdlog::level::warn, __VA_ARGS__)
+#else
+#define RIGID_IPC_LOG_WARN(...) (void)0
+#endif
+
 namespace ipc::rigid {
 
 /// @brief Format an eigen MatrixXd
@@ -4,16 +4,24 @@
 
 #include <tbb/global_control.h>
 #include <tbb/task_scheduler_init.h>
+#include <fstream>
+#include <memory>
 #include <thread>
 
 #include <ghc/fs_std.hpp> // filesystem
+#include <spdlog/sinks/stdout_color_sinks.h>
 
+#include <BatchSimState.hpp>
+#include <SimServer.hpp>
 #include <SimState.hpp>
 #ifdef RIGID_IPC_WITH_OPENGL
 #include <viewer/UISimState.hpp>
 #endif
+#include <ccd/ccd_query_log.hpp>
+#include <utils/numa.hpp>
 #include <logger.hpp>
 #include <profiler.hpp>
+#include <tracer.hpp>
 
 int main(int argc, char* argv[])
 {
@@ -65,10 +73,61 @@ int main(int argc, char* argv[])
     app.add_option("--nthreads", nthreads, "maximum number of threads to use")
         ->default_val(nthreads);
 
+    bool pin_threads = false;
+    app.add_flag(
+        "--pin-threads", pin_threads,
+        "pin each thread to its own CPU (Linux only)");
+
+    bool huge_pages = false;
+    app.add_flag(
+        "--huge-pages", huge_pages,
+        "back large buffers with transparent huge pages (Linux only)");
+
+    std::string resume_path = "";
+    app.add_option(
+        "--resume", resume_path, "checkpoint to resume from (ngui only)");
+
+    std::string trace_path = "";
+    app.add_option(
+        "--trace", trace_path,
+        "write a Chrome/Perfetto trace of the run (ngui only)");
+
+    std::string scaling_report_path = "";
+    app.add_option(
+        "--scaling-report", scaling_report_path,
+        "write an Amdahl analysis of the parallel phases (ngui only)");
+
+    std::string ccd_query_log_path = "";
+    app.add_option(
+        "--ccd-query-log", ccd_query_log_path,
+        "write a binary log of the narrow-phase CCD queries (ngui only)");
+
+    int ccd_query_sample = 1;
+    app.add_option(
+           "--ccd-query-sample", ccd_query_sample,
+           "log every n-th narrow-phase CCD query")
+        ->default_val(ccd_query_sample);
+
     std::string patch = "";
     app.add_option("--patch", patch, "patch to input file (ngui only)")
         ->default_val(patch);
 
+    std::string batch_path = "";
+    app.add_option(
+        "--batch", batch_path,
+        "JSON array of patches to run as variants of the scene (ngui only)");
+
+    bool serve = false;
+    app.add_flag(
+        "--serve", serve,
+        "serve JSON-lines requests from stdin, keeping the process and its "
+        "assets loaded between jobs (ngui only)");
+
+    std::string serve_socket_path = "";
+    app.add_option(
+        "--serve-socket", serve_socket_path,
+        "serve JSON-lines requests from a Unix domain socket (ngui only)");
+
     CLI11_PARSE(app, argc, argv);
 
     set_logger_level(loglevel);
@@ -86,6 +145,25 @@ int main(int argc, char* argv[])
     tbb::global_control thread_limiter(
         tbb::global_control::max_allowed_parallelism, nthreads);
 
+    // Keep the threads on the NUMA node of the pages they first touched
+    std::unique_ptr<ThreadPinningObserver> thread_pinning;
+    if (pin_threads) {
+        thread_pinning = std::make_unique<ThreadPinningObserver>();
+    }
+    NumaPlacement::set_use_huge_pages(huge_pages);
+
+    if (serve || !serve_socket_path.empty()) {
+        SimServer server;
+        if (!serve_socket_path.empty()) {
+            return server.serve_socket(serve_socket_path) ? 0 : 1;
+        }
+        // Responses are written to stdout, so log to stderr
+        spdlog::set_default_logger(spdlog::stderr_color_mt("rigid_ipc_sim"));
+        set_logger_level(loglevel);
+        server.serve(std::cin, std::cout);
+        return 0;
+    }
+
     if (with_viewer) {
 #ifdef RIGID_IPC_WITH_OPENGL
         UISimState ui;
@@ -96,7 +174,7 @@ int main(int argc, char* argv[])
             "Unable to use GUI mode because OpenGL is disable in CMake!")));
 #endif
     } else {
-        if (scene_path.empty()) {
+        if (scene_path.empty() && resume_path.empty()) {
             exit(app.exit(CLI::Error(
                 "scene_path", "Must provide a scene path in ngui mode!")));
         }
@@ -112,9 +190,48 @@ int main(int argc, char* argv[])
         PROFILER_OUTDIR(output_dir);
         std::string fout = fmt::format("{}/{}", output_dir, output_name);
 
+        if (!batch_path.empty()) {
+            std::ifstream batch_file(batch_path);
+            const nlohmann::json patches =
+                nlohmann::json::parse(batch_file, nullptr, false);
+            if (!patches.is_array()) {
+                spdlog::error(
+                    "batch must be a JSON array of patches filename={}",
+                    batch_path);
+                return 1;
+            }
+            std::vector<std::string> patch_strings, fouts;
+            for (size_t i = 0; i < patches.size(); i++) {
+                nlohmann::json variant_patch = patch.empty()
+                    ? nlohmann::json::object()
+                    : nlohmann::json::parse(patch);
+                variant_patch.merge_patch(patches[i]);
+                patch_strings.push_back(variant_patch.dump());
+                fouts.push_back(fmt::format(
+                    "{}/variant_{:04d}/{}", output_dir, i, output_name));
+            }
+
+            BatchSimState batch;
+            if (!batch.load_variants(scene_path, patch_strings)) {
+                return 1;
+            }
+            for (size_t i = 0; i < batch.num_scenes(); i++) {
+                if (num_steps > 0) {
+                    batch[i].m_max_simulation_steps = num_steps;
+                }
+                if (checkpoint_freq > 0) {
+                    batch[i].m_checkpoint_frequency = checkpoint_freq;
+                }
+            }
+            batch.run_simulations(fouts);
+            return 0;
+        }
+
         SimState sim;
 
-        bool success = sim.load_scene(scene_path, patch);
+        bool success = resume_path.empty()
+            ? sim.load_scene(scene_path, patch)
+            : sim.resume_simulation(resume_path);
         if (!success) {
             return 1;
         }
@@ -127,6 +244,62 @@ int main(int argc, char* argv[])
             sim.m_checkpoint_frequency = checkpoint_freq;
         }
 
+        const bool is_tracing =
+            !trace_path.empty() || !scaling_report_path.empty();
+        if (is_tracing) {
+            tracer::Tracer::enable();
+        }
+        if (!ccd_query_log_path.empty()) {
+            if (!CCDQueryLog::enable(ccd_query_log_path, ccd_query_sample)) {
+                return 1;
+            }
+        }
+
         sim.run_simulation(fout);
+
+        if (!ccd_query_log_path.empty()) {
+            CCDQueryLog::disable();
+        }
+
+        if (is_tracing) {
+            tracer::Tracer::disable();
+        }
+        if (!trace_path.empty()) {
+            const nlohmann::json summary = tracer::Tracer::summary();
+            for (const auto& el : summary.items()) {
+                spdlog::info(
+                    "trace scope={} calls={} total_time={:g}s max_time={:g}s",
+                    el.key(), el.value()["calls"].get<size_t>(),
+                    el.value()["total_time"].get<double>(),
+                    el.value()["max_time"].get<double>());
+            }
+            if (tracer::Tracer::write_chrome_trace(trace_path)) {
+                spdlog::info("Trace saved to {}", trace_path);
+            }
+        }
+        if (!scaling_report_path.empty()) {
+            const nlohmann::json report = tracer::Tracer::scaling_report();
+            for (const auto& el : report["phases"].items()) {
+                const nlohmann::json& phase = el.value();
+                spdlog::info(
+                    "scaling phase={} wall_time={:g}s serial_fraction={:.3f} "
+                    "load_imbalance={:.3f} speedup_16={:.2f} "
+                    "speedup_128={:.2f} scales_beyond_16={}",
+                    el.key(), phase["wall_time"].get<double>(),
+                    phase["serial_fraction"].get<double>(),
+                    phase["load_imbalance"].get<double>(),
+                    phase["amdahl_speedup"]["16"].get<double>(),
+                    phase["amdahl_speedup"]["128"].get<double>(),
+                    phase["scales_beyond_16"].get<bool>());
+            }
+            std::ofstream file(scaling_report_path);
+            if (file << report.dump(4) << std::endl) {
+                spdlog::info("Scaling report saved to {}", scaling_report_path);
+            } else {
+                spdlog::error(
+                    "unable to write scaling report filename={}",
+                    scaling_report_path);
+            }
+        }
     }
 }
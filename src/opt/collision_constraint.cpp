@@ -1,10 +1,13 @@
 #include "collision_constraint.hpp"
 
+#include <utils/step_metrics.hpp>
+
 namespace ipc::rigid {
 
 CollisionConstraint::CollisionConstraint(const std::string& name)
     : detection_method(DetectionMethod::HASH_GRID)
     , trajectory_type(TrajectoryType::RIGID)
+    , deterministic(false)
     , m_name(name)
 {
 }
@@ -29,9 +32,26 @@ void CollisionConstraint::construct_collision_set(
     const PosesD poses_t1,
     Impacts& impacts) const
 {
-    detect_collisions(
-        bodies, poses_t0, poses_t1, dim_to_collision_type(bodies.dim()),
-        impacts, detection_method, trajectory_type);
+    detect_with_method([&](DetectionMethod method) {
+        // The measured time already holds the narrow phase
+        detect_collisions(
+            bodies, poses_t0, poses_t1, dim_to_collision_type(bodies.dim()),
+            impacts, method, trajectory_type, deterministic);
+        return size_t(0);
+    });
+}
+
+void CollisionConstraint::record_detection_cost(
+    int strategy, double seconds, size_t num_candidates) const
+{
+    // Every candidate costs the average narrow-phase query of the step
+    const uint64_t num_queries =
+        StepMetrics::count(StepMetrics::NARROW_PHASE_QUERIES);
+    const double query_seconds = num_queries > 0
+        ? StepMetrics::time(StepMetrics::NARROW_PHASE) / num_queries
+        : 0.0;
+    m_detection_method_selector.record(
+        strategy, seconds + num_candidates * query_seconds);
 }
 
 } // namespace ipc::rigid
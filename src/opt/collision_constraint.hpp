@@ -1,9 +1,13 @@
 #pragma once
 
+#include <array>
+#include <chrono>
+
 #include <nlohmann/json.hpp>
 
 #include <ccd/ccd.hpp>
 #include <physics/rigid_body_assembler.hpp>
+#include <utils/cost_based_selector.hpp>
 
 namespace ipc::rigid {
 
@@ -17,7 +21,11 @@ public:
 
     inline const std::string& name() const { return m_name; }
 
-    virtual void initialize() {};
+    virtual void initialize() { m_detection_method_selector.reset(); };
+
+    /// @brief Forget what is cached about the bodies across time steps
+    /// (after they were replaced, added, removed, or reordered).
+    virtual void invalidate_body_caches() {}
 
     void construct_collision_set(
         const RigidBodyAssembler& bodies,
@@ -29,8 +37,48 @@ public:
     // ----------
     DetectionMethod detection_method;
     TrajectoryType trajectory_type;
+    /// @brief Make the detection and the reductions of this simulation
+    /// independent of the thread scheduling and count (set from the
+    /// "deterministic" argument of the simulation, not from the constraint
+    /// settings).
+    bool deterministic;
 
 protected:
+    /// @brief Call detect(method) with the detection method, resolving AUTO
+    /// to the method of least measured cost (or the BVH if deterministic,
+    /// since the measured costs vary between runs).
+    /// @param detect Returns the number of candidates it leaves to a narrow
+    /// phase (whose queries are part of the method's cost).
+    template <typename Detect>
+    void detect_with_method(const Detect& detect) const
+    {
+        if (detection_method != DetectionMethod::AUTO) {
+            detect(detection_method);
+            return;
+        }
+        if (deterministic) {
+            detect(DetectionMethod::BVH);
+            return;
+        }
+        const int strategy = m_detection_method_selector.select();
+        const auto start = std::chrono::steady_clock::now();
+        const size_t num_candidates = detect(AUTO_DETECTION_METHODS[strategy]);
+        record_detection_cost(
+            strategy,
+            std::chrono::duration<double>(
+                std::chrono::steady_clock::now() - start)
+                .count(),
+            num_candidates);
+    }
+
+    void record_detection_cost(
+        int strategy, double seconds, size_t num_candidates) const;
+
+    /// @brief Methods between which AUTO selects.
+    static constexpr std::array<DetectionMethod, 2> AUTO_DETECTION_METHODS = {
+        { DetectionMethod::HASH_GRID, DetectionMethod::BVH }
+    };
+
     inline static int dim_to_collision_type(int dim)
     {
         return dim == 2
@@ -39,6 +87,11 @@ protected:
     }
 
     std::string m_name;
+
+    /// @brief Measured costs of the methods of AUTO detection.
+    mutable CostBasedSelector m_detection_method_selector {
+        int(AUTO_DETECTION_METHODS.size())
+    };
 };
 
 } // namespace ipc::rigid
@@ -0,0 +1,262 @@
+#include "contact_manifold_reduction.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+
+#include <Eigen/Geometry>
+
+#include <constants.hpp>
+#include <logger.hpp>
+#include <profiler.hpp>
+
+namespace ipc::rigid {
+
+namespace {
+    struct ManifoldContact {
+        size_t index;          ///< Index of the constraint ([vv, ev, ee, fv])
+        Eigen::Vector3d point; ///< Point of contact
+        double distance;       ///< Squared distance of the constraint
+    };
+
+    struct Manifold {
+        Eigen::Vector3d normal;
+        std::vector<ManifoldContact> contacts;
+    };
+
+    /// @brief Body pair, quantized normal, and quantized plane offset.
+    typedef std::array<long, 6> ManifoldKey;
+
+    /// @brief Midpoint of the closest points of two segments.
+    Eigen::Vector3d closest_midpoint(
+        const Eigen::Vector3d& p0,
+        const Eigen::Vector3d& p1,
+        const Eigen::Vector3d& q0,
+        const Eigen::Vector3d& q1)
+    {
+        const Eigen::Vector3d d0 = p1 - p0, d1 = q1 - q0, r = p0 - q0;
+        const double a = d0.squaredNorm(), b = d0.dot(d1), c = d0.dot(r);
+        const double e = d1.squaredNorm(), f = d1.dot(r);
+        const double denominator = a * e - b * b;
+        double s = denominator > 0
+            ? std::clamp((b * f - c * e) / denominator, 0.0, 1.0)
+            : 0.0;
+        const double t = e > 0 ? std::clamp((b * s + f) / e, 0.0, 1.0) : 0.0;
+        s = a > 0 ? std::clamp((b * t - c) / a, 0.0, 1.0) : 0.0;
+        return 0.5 * (p0 + s * d0 + q0 + t * d1);
+    }
+} // namespace
+
+std::vector<double> reduce_contact_manifolds(
+    const RigidBodyAssembler& bodies,
+    const Eigen::MatrixXd& V,
+    double dhat,
+    Constraints& constraints)
+{
+    return apply_contact_manifold_selection(
+        select_contact_manifolds(bodies, V, dhat, constraints), constraints);
+}
+
+ContactManifoldSelection select_contact_manifolds(
+    const RigidBodyAssembler& bodies,
+    const Eigen::MatrixXd& V,
+    double dhat,
+    const Constraints& constraints)
+{
+    ContactManifoldSelection selection;
+    if (bodies.dim() != 3 || dhat <= 0
+        || constraints.size() <= Constants::CONTACT_MANIFOLD_MAX_SIZE) {
+        return selection;
+    }
+
+    PROFILE_POINT("select_contact_manifolds");
+    PROFILE_START();
+
+    const Eigen::MatrixXi &E = bodies.m_edges, &F = bodies.m_faces;
+    const size_t ee_offset =
+        constraints.vv_constraints.size() + constraints.ev_constraints.size();
+    const size_t fv_offset = ee_offset + constraints.ee_constraints.size();
+
+    std::map<ManifoldKey, Manifold> manifolds;
+    const auto add_contact = [&](size_t ci, long vi, long vj,
+                                 Eigen::Vector3d normal,
+                                 const Eigen::Vector3d& point,
+                                 double distance, double scale) {
+        const long body0 = bodies.vertex_id_to_body_id(vi);
+        const long body1 = bodies.vertex_id_to_body_id(vj);
+        // Skip degenerate normals (e.g., parallel edges)
+        const double norm = normal.norm();
+        if (body0 == body1 || !(norm > 1e-8 * scale)) {
+            return;
+        }
+        normal /= norm;
+        // Orient the normal the same way from both sides of the contact
+        int axis;
+        normal.cwiseAbs().maxCoeff(&axis);
+        if (normal(axis) < 0) {
+            normal = -normal;
+        }
+        const double resolution = Constants::CONTACT_MANIFOLD_NORMAL_TOLERANCE;
+        const ManifoldKey key = { {
+            std::min(body0, body1),
+            std::max(body0, body1),
+            std::lround(normal.x() / resolution),
+            std::lround(normal.y() / resolution),
+            std::lround(normal.z() / resolution),
+            // Both sides of a contact are within d̂ of its plane
+            long(std::floor(normal.dot(point) / (2 * dhat))),
+        } };
+        Manifold& manifold = manifolds[key];
+        if (manifold.contacts.empty()) {
+            manifold.normal = normal;
+        }
+        manifold.contacts.push_back({ ci, point, distance });
+    };
+
+    for (size_t i = 0; i < constraints.ee_constraints.size(); i++) {
+        const EdgeEdgeConstraint& c = constraints.ee_constraints[i];
+        const Eigen::Vector3d p0 = V.row(E(c.edge0_index, 0)).transpose();
+        const Eigen::Vector3d p1 = V.row(E(c.edge0_index, 1)).transpose();
+        const Eigen::Vector3d q0 = V.row(E(c.edge1_index, 0)).transpose();
+        const Eigen::Vector3d q1 = V.row(E(c.edge1_index, 1)).transpose();
+        add_contact(
+            ee_offset + i, E(c.edge0_index, 0), E(c.edge1_index, 0),
+            (p1 - p0).cross(q1 - q0), closest_midpoint(p0, p1, q0, q1),
+            c.compute_distance(V, E, F), (p1 - p0).norm() * (q1 - q0).norm());
+    }
+    for (size_t i = 0; i < constraints.fv_constraints.size(); i++) {
+        const FaceVertexConstraint& c = constraints.fv_constraints[i];
+        const Eigen::Vector3d f0 = V.row(F(c.face_index, 0)).transpose();
+        const Eigen::Vector3d e0 = V.row(F(c.face_index, 1)).transpose() - f0;
+        const Eigen::Vector3d e1 = V.row(F(c.face_index, 2)).transpose() - f0;
+        add_contact(
+            fv_offset + i, c.vertex_index, F(c.face_index, 0), e0.cross(e1),
+            V.row(c.vertex_index).transpose(), c.compute_distance(V, E, F),
+            e0.norm() * e1.norm());
+    }
+
+    // Weight of a constraint by its primitives
+    const auto set_weight = [&](size_t ci, double weight) {
+        if (ci < fv_offset) {
+            const EdgeEdgeConstraint& c =
+                constraints.ee_constraints[ci - ee_offset];
+            selection.ee_weights[{ c.edge0_index, c.edge1_index }] = weight;
+        } else {
+            const FaceVertexConstraint& c =
+                constraints.fv_constraints[ci - fv_offset];
+            selection.fv_weights[{ c.vertex_index, c.face_index }] = weight;
+        }
+    };
+
+    size_t num_dropped = 0;
+    for (const auto& [key, manifold] : manifolds) {
+        const std::vector<ManifoldContact>& contacts = manifold.contacts;
+        if (contacts.size() <= Constants::CONTACT_MANIFOLD_MAX_SIZE) {
+            continue;
+        }
+
+        // Closest contact and the support points of directions in the plane
+        std::vector<size_t> kept;
+        kept.push_back(
+            std::min_element(
+                contacts.begin(), contacts.end(),
+                [](const auto& a, const auto& b) {
+                    return a.distance < b.distance;
+                })
+            - contacts.begin());
+        const Eigen::Vector3d u = manifold.normal.unitOrthogonal();
+        const Eigen::Vector3d v = manifold.normal.cross(u);
+        for (int k = 0; k < Constants::CONTACT_MANIFOLD_SUPPORT_DIRECTIONS;
+             k++) {
+            const double angle =
+                2 * M_PI * k / Constants::CONTACT_MANIFOLD_SUPPORT_DIRECTIONS;
+            const Eigen::Vector3d dir =
+                std::cos(angle) * u + std::sin(angle) * v;
+            kept.push_back(
+                std::max_element(
+                    contacts.begin(), contacts.end(),
+                    [&](const auto& a, const auto& b) {
+                        return dir.dot(a.point) < dir.dot(b.point);
+                    })
+                - contacts.begin());
+        }
+        std::sort(kept.begin(), kept.end());
+        kept.erase(std::unique(kept.begin(), kept.end()), kept.end());
+
+        for (const ManifoldContact& contact : contacts) {
+            set_weight(contact.index, 0);
+        }
+        const double weight = double(contacts.size()) / kept.size();
+        for (size_t i : kept) {
+            set_weight(contacts[i].index, weight);
+        }
+        num_dropped += contacts.size() - kept.size();
+    }
+
+    RIGID_IPC_LOG_TRACE(
+        "select_contact_manifolds num_manifolds={:d} num_dropped={:d}",
+        manifolds.size(), num_dropped);
+
+    PROFILE_END();
+
+    return selection;
+}
+
+std::vector<double> apply_contact_manifold_selection(
+    const ContactManifoldSelection& selection, Constraints& constraints)
+{
+    std::vector<double> weights(constraints.size(), 1.0);
+    if (selection.empty()) {
+        return weights;
+    }
+
+    const size_t ee_offset =
+        constraints.vv_constraints.size() + constraints.ev_constraints.size();
+    const size_t fv_offset = ee_offset + constraints.ee_constraints.size();
+
+    std::vector<bool> is_kept(constraints.size(), true);
+    const auto apply_weight = [&](size_t ci, const auto& type_weights,
+                                  long id0, long id1) {
+        const auto it = type_weights.find(std::make_pair(id0, id1));
+        if (it == type_weights.end()) {
+            return;
+        }
+        is_kept[ci] = it->second > 0;
+        weights[ci] = it->second;
+    };
+    for (size_t i = 0; i < constraints.ee_constraints.size(); i++) {
+        const EdgeEdgeConstraint& c = constraints.ee_constraints[i];
+        apply_weight(
+            ee_offset + i, selection.ee_weights, c.edge0_index, c.edge1_index);
+    }
+    for (size_t i = 0; i < constraints.fv_constraints.size(); i++) {
+        const FaceVertexConstraint& c = constraints.fv_constraints[i];
+        apply_weight(
+            fv_offset + i, selection.fv_weights, c.vertex_index, c.face_index);
+    }
+
+    // Compact the constraints and their weights
+    const auto compact = [&](auto& type_constraints, size_t offset) {
+        size_t n = 0;
+        for (size_t i = 0; i < type_constraints.size(); i++) {
+            if (is_kept[offset + i]) {
+                type_constraints[n++] = type_constraints[i];
+            }
+        }
+        type_constraints.erase(
+            type_constraints.begin() + n, type_constraints.end());
+    };
+    compact(constraints.ee_constraints, ee_offset);
+    compact(constraints.fv_constraints, fv_offset);
+    size_t n = 0;
+    for (size_t ci = 0; ci < weights.size(); ci++) {
+        if (is_kept[ci]) {
+            weights[n++] = weights[ci];
+        }
+    }
+    weights.resize(n);
+
+    return weights;
+}
+
+} // namespace ipc::rigid
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <map>
+#include <utility>
+#include <vector>
+
+#include <Eigen/Core>
+
+#include <ipc/collision_constraint.hpp>
+
+#include <physics/rigid_body_assembler.hpp>
+
+namespace ipc::rigid {
+
+/// @brief Representatives of the reduced contact manifolds: the weights of
+/// their edge-edge and face-vertex constraints by primitive ids (zero for the
+/// dropped constraints).
+struct ContactManifoldSelection {
+    /// @brief Weights by (edge0, edge1) of the edge-edge constraints.
+    std::map<std::pair<long, long>, double> ee_weights;
+    /// @brief Weights by (vertex, face) of the face-vertex constraints.
+    std::map<std::pair<long, long>, double> fv_weights;
+
+    bool empty() const { return ee_weights.empty() && fv_weights.empty(); }
+};
+
+/// @brief Reduce the flat contacts between pairs of bodies to a few
+/// representatives.
+///
+/// The edge-edge and face-vertex constraints of a body pair that share a
+/// contact plane form a manifold. Manifolds larger than
+/// Constants::CONTACT_MANIFOLD_MAX_SIZE keep their closest constraint and the
+/// extremes of their support polygon, which share the weight of the whole
+/// manifold so the sum of the barriers is preserved. The dropped constraints
+/// are at least as far as the closest one, and the CCD of the line search
+/// still checks all primitives, so the trajectories stay intersection-free.
+///
+/// @param[in] bodies       Bodies of the constraints (3D).
+/// @param[in] V            World vertices of the bodies.
+/// @param[in] dhat         Barrier activation distance.
+/// @param[in,out] constraints  Constraints to reduce.
+/// @returns The weights of the remaining constraints, indexed as
+///          [vv, ev, ee, fv] (all one if nothing was reduced).
+std::vector<double> reduce_contact_manifolds(
+    const RigidBodyAssembler& bodies,
+    const Eigen::MatrixXd& V,
+    double dhat,
+    Constraints& constraints);
+
+/// @brief Select the representatives of the manifolds of the constraints
+/// (see reduce_contact_manifolds()) without reducing them.
+ContactManifoldSelection select_contact_manifolds(
+    const RigidBodyAssembler& bodies,
+    const Eigen::MatrixXd& V,
+    double dhat,
+    const Constraints& constraints);
+
+/// @brief Reduce the constraints with a selection made at another
+/// configuration, so the weights do not jump as contacts cross the bins of
+/// the manifolds. Constraints unknown to the selection keep a weight of one.
+/// @returns The weights of the remaining constraints, indexed as
+///          [vv, ev, ee, fv].
+std::vector<double> apply_contact_manifold_selection(
+    const ContactManifoldSelection& selection, Constraints& constraints);
+
+} // namespace ipc::rigid
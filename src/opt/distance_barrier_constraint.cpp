@@ -1,7 +1,16 @@
 #include "distance_barrier_constraint.hpp"
 
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cmath>
 #include <mutex>
+#include <numeric>
+
+#include <tbb/parallel_for.h>
 #include <tbb/parallel_for_each.h>
+#include <tbb/parallel_sort.h>
+#include <tbb/task_group.h>
 
 #include <igl/slice_mask.h>
 #include <ipc/ipc.hpp>
@@ -9,10 +18,12 @@
 #include <ccd/rigid/broad_phase.hpp>
 #include <ccd/rigid/rigid_body_hash_grid.hpp>
 #include <ccd/save_queries.hpp>
+#include <constants.hpp>
 #include <geometry/distance.hpp>
 #include <io/serialize_json.hpp>
 #include <logger.hpp>
 #include <profiler.hpp>
+#include <utils/step_metrics.hpp>
 
 namespace ipc::rigid {
 
@@ -27,6 +38,10 @@ DistanceBarrierConstraint::DistanceBarrierConstraint(const std::string& name)
     , initial_barrier_activation_distance(1e-3)
     , barrier_type(BarrierType::IPC)
     , minimum_separation_distance(0.0)
+    , contact_manifold_reduction(false)
+    , ccd_relative_toi_tolerance(0)
+    , stream_ccd_candidates(false)
+    , per_body_activation_distance(false)
     , m_barrier_activation_distance(0.0)
 {
 }
@@ -38,6 +53,10 @@ void DistanceBarrierConstraint::settings(const nlohmann::json& json)
         json["initial_barrier_activation_distance"];
     minimum_separation_distance = json["minimum_separation_distance"];
     barrier_type = json["barrier_type"];
+    contact_manifold_reduction = json["contact_manifold_reduction"];
+    ccd_relative_toi_tolerance = json["ccd_relative_toi_tolerance"];
+    stream_ccd_candidates = json["stream_ccd_candidates"];
+    per_body_activation_distance = json["per_body_activation_distance"];
 }
 
 nlohmann::json DistanceBarrierConstraint::settings() const
@@ -47,12 +66,22 @@ nlohmann::json DistanceBarrierConstraint::settings() const
         initial_barrier_activation_distance;
     json["minimum_separation_distance"] = minimum_separation_distance;
     json["barrier_type"] = barrier_type;
+    json["contact_manifold_reduction"] = contact_manifold_reduction;
+    json["ccd_relative_toi_tolerance"] = ccd_relative_toi_tolerance;
+    json["stream_ccd_candidates"] = stream_ccd_candidates;
+    json["per_body_activation_distance"] = per_body_activation_distance;
     return json;
 }
 
 void DistanceBarrierConstraint::initialize()
 {
     m_barrier_activation_distance = initial_barrier_activation_distance;
+    m_candidate_cache.clear();
+    m_verlet_candidates.clear();
+    // The separations outlive the step, they are only invalidated with the
+    // bodies (see invalidate_body_caches())
+    m_toi_bound_cache.clear();
+    m_speculative_candidates.clear();
     CollisionConstraint::initialize();
 }
 
@@ -68,15 +97,21 @@ bool DistanceBarrierConstraint::has_active_collisions(
 
     PROFILE_START();
     // This function will profile itself
-    Candidates candidates;
-    detect_collision_candidates(
-        bodies, poses_t0, poses_t1, dim_to_collision_type(bodies.dim()),
-        candidates, detection_method, trajectory_type,
-        /*inflation_radius=*/minimum_separation_distance / 2.0);
+    const auto candidates = acquire_candidates();
+    const auto hash_grid = m_hash_grids.acquire();
+    detect_with_method([&](DetectionMethod method) {
+        detect_collision_candidates(
+            bodies, poses_t0, poses_t1, dim_to_collision_type(bodies.dim()),
+            *candidates, method, trajectory_type,
+            /*inflation_radius=*/minimum_separation_distance / 2.0,
+            use_candidate_cache ? &m_separation_cache : nullptr,
+            hash_grid.get());
+        return candidates->size();
+    });
 
     PROFILE_START(NARROW_PHASE)
     bool has_collisions = has_active_collisions_narrow_phase(
-        bodies, poses_t0, poses_t1, candidates);
+        bodies, poses_t0, poses_t1, *candidates);
     PROFILE_END(NARROW_PHASE)
     PROFILE_END();
 
@@ -89,42 +124,61 @@ bool DistanceBarrierConstraint::has_active_collisions_narrow_phase(
     const PosesD& poses_t1,
     const Candidates& candidates) const
 {
+    StepMetrics::ScopedTimer timer(StepMetrics::NARROW_PHASE);
+
     TrajectoryType overloaded_trajectory =
         trajectory_type == TrajectoryType::PIECEWISE_LINEAR
         ? TrajectoryType::RIGID
         : trajectory_type;
 
-    for (const auto& ev_candidate : candidates.ev_candidates) {
-        double toi;
-        bool are_colliding = edge_vertex_ccd(
-            bodies, poses_t0, poses_t1, ev_candidate, toi,
-            overloaded_trajectory);
-        if (are_colliding) {
-            // save_ccd_candidate(bodies, poses_t0, poses_t1, ev_candidate);
-            return true;
-        }
-    }
-    for (const auto& fv_candidate : candidates.fv_candidates) {
-        double toi;
-        bool are_colliding = face_vertex_ccd(
-            bodies, poses_t0, poses_t1, fv_candidate, toi,
-            overloaded_trajectory);
-        if (are_colliding) {
-            // save_ccd_candidate(bodies, poses_t0, poses_t1, fv_candidate);
-            return true;
-        }
-    }
-    for (const auto& ee_candidate : candidates.ee_candidates) {
-        double toi;
-        bool are_colliding = edge_edge_ccd(
-            bodies, poses_t0, poses_t1, ee_candidate, toi,
-            overloaded_trajectory);
-        if (are_colliding) {
-            // save_ccd_candidate(bodies, poses_t0, poses_t1, ee_candidate);
-            return true;
-        }
-    }
-    return false;
+    const size_t num_ev = candidates.ev_candidates.size();
+    const size_t num_fv = candidates.fv_candidates.size();
+
+    // Any impact answers the query, so the queries stop at their first root
+    // and the first thread to find one cancels the queries of the others.
+    std::atomic<bool> has_collisions(false);
+    tbb::task_group_context context;
+    tbb::parallel_for(
+        tbb::blocked_range<size_t>(0, candidates.size()),
+        [&](const tbb::blocked_range<size_t>& r) {
+            for (size_t i = r.begin(); i < r.end(); i++) {
+                if (context.is_group_execution_cancelled()) {
+                    return;
+                }
+                double toi;
+                bool are_colliding;
+                if (i < num_ev) {
+                    are_colliding = edge_vertex_ccd(
+                        bodies, poses_t0, poses_t1, candidates.ev_candidates[i],
+                        toi, overloaded_trajectory, /*earliest_toi=*/1,
+                        /*minimum_separation_distance=*/0,
+                        /*find_any_root=*/true);
+                } else if (i - num_ev < num_fv) {
+                    are_colliding = face_vertex_ccd(
+                        bodies, poses_t0, poses_t1,
+                        candidates.fv_candidates[i - num_ev], toi,
+                        overloaded_trajectory, /*earliest_toi=*/1,
+                        /*minimum_separation_distance=*/0,
+                        /*find_any_root=*/true, /*relative_toi_tolerance=*/0,
+                        deterministic);
+                } else {
+                    are_colliding = edge_edge_ccd(
+                        bodies, poses_t0, poses_t1,
+                        candidates.ee_candidates[i - num_ev - num_fv], toi,
+                        overloaded_trajectory, /*earliest_toi=*/1,
+                        /*minimum_separation_distance=*/0,
+                        /*find_any_root=*/true, /*relative_toi_tolerance=*/0,
+                        deterministic);
+                }
+                if (are_colliding) {
+                    has_collisions = true;
+                    context.cancel_group_execution();
+                    return;
+                }
+            }
+        },
+        context);
+    return has_collisions;
 }
 
 double DistanceBarrierConstraint::compute_earliest_toi(
@@ -134,116 +188,415 @@ double DistanceBarrierConstraint::compute_earliest_toi(
 {
     PROFILE_POINT("DistanceBarrierConstraint::compute_earliest_toi");
     PROFILE_START();
-    // This function will profile itself
-    Candidates candidates;
-    detect_collision_candidates(
-        bodies, poses_t0, poses_t1, dim_to_collision_type(bodies.dim()),
-        candidates, detection_method, trajectory_type,
-        /*inflation_radius=*/minimum_separation_distance / 2.0);
+    const int collision_types = dim_to_collision_type(bodies.dim());
+
+    // Linearized trajectories depend on their end poses, so only the rigid
+    // ones contain the trajectories of their sub-intervals.
+    const bool is_rigid_trajectory = trajectory_type != TrajectoryType::LINEAR
+        && trajectory_type != TrajectoryType::PIECEWISE_LINEAR;
+    // Streamed queries narrow each other in the order they are found
+    if (stream_ccd_candidates && is_rigid_trajectory && !deterministic) {
+        double earliest_toi =
+            compute_earliest_toi_streamed(bodies, poses_t0, poses_t1);
+        PROFILE_END();
+        return earliest_toi;
+    }
+
+    const bool use_toi_bound_cache = use_candidate_cache && is_rigid_trajectory;
+    if (use_toi_bound_cache
+        && m_toi_bound_cache.map_to_subinterval(
+            poses_t0, poses_t1, collision_types,
+            minimum_separation_distance)) {
+        double earliest_toi = compute_earliest_toi_narrow_phase(
+            bodies, poses_t0, poses_t1, m_toi_bound_cache.candidates(),
+            &m_toi_bound_cache.bounds());
+        PROFILE_END();
+        return earliest_toi;
+    }
 
-    double earliest_toi = compute_earliest_toi_narrow_phase(
-        bodies, poses_t0, poses_t1, candidates);
+    // The prefetched candidates are a superset of the detected ones
+    const auto local_candidates = acquire_candidates();
+    const Candidates* candidates = local_candidates.get();
+    if (use_candidate_cache
+        && m_speculative_candidates.covers(
+            bodies, poses_t0, poses_t1, collision_types,
+            minimum_separation_distance / 2.0)) {
+        candidates = &m_speculative_candidates.candidates();
+    } else {
+        // This function will profile itself
+        const auto hash_grid = m_hash_grids.acquire();
+        detect_with_method([&](DetectionMethod method) {
+            detect_collision_candidates(
+                bodies, poses_t0, poses_t1, collision_types,
+                *local_candidates, method, trajectory_type,
+                /*inflation_radius=*/minimum_separation_distance / 2.0,
+                use_candidate_cache ? &m_separation_cache : nullptr,
+                hash_grid.get(), deterministic);
+            return local_candidates->size();
+        });
+    }
+
+    double earliest_toi;
+    if (use_toi_bound_cache) {
+        m_toi_bound_cache.reset(
+            poses_t0, poses_t1, collision_types, minimum_separation_distance,
+            *candidates);
+        earliest_toi = compute_earliest_toi_narrow_phase(
+            bodies, poses_t0, poses_t1, m_toi_bound_cache.candidates(),
+            &m_toi_bound_cache.bounds());
+    } else {
+        earliest_toi = compute_earliest_toi_narrow_phase(
+            bodies, poses_t0, poses_t1, *candidates);
+    }
+    // The next trajectory starts elsewhere
+    m_speculative_candidates.clear();
     PROFILE_END();
 
     return earliest_toi;
 }
 
-double DistanceBarrierConstraint::compute_earliest_toi_narrow_phase(
+void DistanceBarrierConstraint::prefetch_ccd_candidates(
+    const RigidBodyAssembler& bodies,
+    const PosesD& poses,
+    const double max_displacement) const
+{
+    const int collision_types = dim_to_collision_type(bodies.dim());
+    // AUTO times its methods (not thread safe) and the incremental sweep and
+    // prune would lose its coherence on a differently inflated query
+    const DetectionMethod method = detection_method == DetectionMethod::AUTO
+            || detection_method == DetectionMethod::SWEEP_AND_PRUNE
+        ? DetectionMethod::BVH
+        : detection_method;
+    m_speculative_candidates.detect(
+        bodies, poses, collision_types,
+        /*inflation_radius=*/minimum_separation_distance / 2.0,
+        max_displacement, [&](double radius, Candidates& candidates) {
+            detect_collision_candidates_rigid(
+                bodies, poses, collision_types, candidates, method, radius);
+        });
+}
+
+// Order the candidates (indexed as [ev, ee, fv]) to schedule the narrow
+// phase. The expensive queries go first (most expensive first) so they do not
+// straggle at the end of the phase, then the cheap ones by a cheap estimate of
+// their time of impact along the linearized vertex trajectories so the bound
+// tightens quickly.
+std::vector<size_t> schedule_narrow_phase_candidates(
     const RigidBodyAssembler& bodies,
     const PosesD& poses_t0,
     const PosesD& poses_t1,
-    const Candidates& candidates) const
+    const Candidates& candidates,
+    TrajectoryType trajectory_type)
 {
-    NAMED_PROFILE_POINT(
-        "DistanceBarrierConstraint::compute_earliest_toi_narrow_phase",
-        NARROW_PHASE);
-    // NOTE: These are disabled because they are not thread safe
-    // NAMED_PROFILE_POINT(
-    //     "DistanceBarrierConstraint::compute_earliest_toi_narrow_phase:"
-    //     "edge_edge",
-    //     FV_NARROW_PHASE);
-    // NAMED_PROFILE_POINT(
-    //     "DistanceBarrierConstraint::compute_earliest_toi_narrow_phase:"
-    //     "face_vertex",
-    //     EE_NARROW_PHASE);
-    // NAMED_PROFILE_POINT(
-    //     "DistanceBarrierConstraint::compute_earliest_toi_narrow_phase:"
-    //     "edge_vertex",
-    //     EV_NARROW_PHASE);
+    const Eigen::MatrixXd V0 = bodies.world_vertices(poses_t0);
+    const Eigen::MatrixXd U = bodies.world_vertices(poses_t1) - V0;
+    const Eigen::MatrixXi &E = bodies.m_edges, &F = bodies.m_faces;
+
+    // Angle swept by each body
+    Eigen::VectorXd body_angles(bodies.num_bodies());
+    for (int i = 0; i < bodies.num_bodies(); i++) {
+        body_angles(i) = (poses_t1[i].rotation - poses_t0[i].rotation).norm();
+    }
 
-    PROFILE_START(NARROW_PHASE);
+    // Distance of the rotating vertices from the linear trajectories (the
+    // sagitta of their arcs), which the interval CCD has to subdivide away.
+    auto nonlinear_deviation = [&](const std::array<long, 3>& p, int np) {
+        if (trajectory_type == TrajectoryType::LINEAR) {
+            return 0.0;
+        }
+        const long body_id = bodies.vertex_id_to_body_id(p[0]);
+        const double angle = body_angles(body_id);
+        double radius = 0;
+        for (int i = 0; i < np; i++) {
+            radius = std::max(
+                radius,
+                (V0.row(p[i]).transpose() - poses_t0[body_id].position)
+                    .norm());
+        }
+        return radius * std::min(angle * angle / 8, 2.0);
+    };
+
+    // Gap between the t=0 boxes of the two primitives divided by the
+    // largest linear displacement of their vertices, and the cost of the
+    // query relative to a linear one.
+    auto estimate = [&](const std::array<long, 3>& a, int na,
+                        const std::array<long, 3>& b, int nb, double& toi,
+                        double& cost) {
+        Eigen::ArrayXd a_min = V0.row(a[0]).transpose().array(), a_max = a_min;
+        Eigen::ArrayXd b_min = V0.row(b[0]).transpose().array(), b_max = b_min;
+        double a_disp = 0, b_disp = 0;
+        for (int i = 0; i < na; i++) {
+            a_min = a_min.min(V0.row(a[i]).transpose().array());
+            a_max = a_max.max(V0.row(a[i]).transpose().array());
+            a_disp = std::max(a_disp, U.row(a[i]).norm());
+        }
+        for (int i = 0; i < nb; i++) {
+            b_min = b_min.min(V0.row(b[i]).transpose().array());
+            b_max = b_max.max(V0.row(b[i]).transpose().array());
+            b_disp = std::max(b_disp, U.row(b[i]).norm());
+        }
+        double gap = (a_min - b_max).max(b_min - a_max).max(0.0).matrix().norm();
+        double disp = a_disp + b_disp;
+        toi = disp > 0 ? gap / disp : std::numeric_limits<double>::infinity();
 
-    int collision_count = 0;
-    double earliest_toi = 1;
-    std::mutex earliest_toi_mutex;
+        const double deviation =
+            nonlinear_deviation(a, na) + nonlinear_deviation(b, nb);
+        cost = deviation > 0 ? 1 + deviation / std::max(gap, 1e-3 * deviation)
+                             : 1;
+    };
 
     const size_t num_ev = candidates.ev_candidates.size();
     const size_t num_ee = candidates.ee_candidates.size();
-    const size_t num_fv = candidates.fv_candidates.size();
 
-    // Do a single block range over all three candidate vectors
-    tbb::parallel_for(
-        tbb::blocked_range<int>(0, candidates.size()),
-        [&](tbb::blocked_range<int> r) {
-            for (int i = r.begin(); i < r.end(); i++) {
-                double toi = std::numeric_limits<double>::infinity();
-                bool are_colliding;
+    std::vector<double> estimates(candidates.size());
+    std::vector<double> costs(candidates.size());
+    tbb::parallel_for(size_t(0), candidates.size(), [&](size_t i) {
+        if (i < num_ev) {
+            const auto& c = candidates.ev_candidates[i];
+            estimate(
+                { { E(c.edge_index, 0), E(c.edge_index, 1) } }, 2,
+                { { c.vertex_index } }, 1, estimates[i], costs[i]);
+        } else if (i - num_ev < num_ee) {
+            const auto& c = candidates.ee_candidates[i - num_ev];
+            estimate(
+                { { E(c.edge0_index, 0), E(c.edge0_index, 1) } }, 2,
+                { { E(c.edge1_index, 0), E(c.edge1_index, 1) } }, 2,
+                estimates[i], costs[i]);
+            // The distance between nearly parallel edges is flat along the
+            // edges, which makes the root finding subdivide more.
+            const Eigen::RowVectorXd e0 =
+                V0.row(E(c.edge0_index, 1)) - V0.row(E(c.edge0_index, 0));
+            const Eigen::RowVectorXd e1 =
+                V0.row(E(c.edge1_index, 1)) - V0.row(E(c.edge1_index, 0));
+            const double cos_angle =
+                std::abs(e0.dot(e1)) / (e0.norm() * e1.norm());
+            if (trajectory_type != TrajectoryType::LINEAR
+                && std::isfinite(cos_angle)) {
+                costs[i] /= std::max(
+                    std::sqrt(std::max(1 - cos_angle * cos_angle, 0.0)),
+                    1 / Constants::NARROW_PHASE_EXPENSIVE_COST);
+            }
+        } else {
+            const auto& c = candidates.fv_candidates[i - num_ev - num_ee];
+            estimate(
+                { { F(c.face_index, 0), F(c.face_index, 1),
+                    F(c.face_index, 2) } },
+                3, { { c.vertex_index } }, 1, estimates[i], costs[i]);
+        }
+    });
+
+    std::vector<size_t> order(candidates.size());
+    std::iota(order.begin(), order.end(), 0);
+    tbb::parallel_sort(order.begin(), order.end(), [&](size_t i, size_t j) {
+        const bool is_i_expensive =
+            costs[i] > Constants::NARROW_PHASE_EXPENSIVE_COST;
+        const bool is_j_expensive =
+            costs[j] > Constants::NARROW_PHASE_EXPENSIVE_COST;
+        if (is_i_expensive != is_j_expensive) {
+            return is_i_expensive;
+        }
+        return is_i_expensive ? costs[i] > costs[j]
+                              : estimates[i] < estimates[j];
+    });
+    return order;
+}
 
-                if (i < num_ev) {
-                    // PROFILE_START(EV_NARROW_PHASE);
-                    are_colliding = edge_vertex_ccd(
-                        bodies, poses_t0, poses_t1, candidates.ev_candidates[i],
-                        toi, trajectory_type, earliest_toi,
-                        minimum_separation_distance);
-                    // PROFILE_END(EV_NARROW_PHASE);
-                } else if (i - num_ev < num_ee) {
-                    // PROFILE_START(EE_NARROW_PHASE);
-                    are_colliding = edge_edge_ccd(
-                        bodies, poses_t0, poses_t1,
-                        candidates.ee_candidates[i - num_ev], toi,
-                        trajectory_type, earliest_toi,
-                        minimum_separation_distance);
-                    // PROFILE_END(EE_NARROW_PHASE);
-                } else {
-                    assert(i - num_ev - num_ee < num_fv);
-                    // PROFILE_START(FV_NARROW_PHASE);
-                    are_colliding = face_vertex_ccd(
-                        bodies, poses_t0, poses_t1,
-                        candidates.fv_candidates[i - num_ev - num_ee], toi,
-                        trajectory_type, earliest_toi,
-                        minimum_separation_distance);
-                    // PROFILE_END(FV_NARROW_PHASE);
-                }
+bool DistanceBarrierConstraint::candidate_ccd(
+    const RigidBodyAssembler& bodies,
+    const PosesD& poses_t0,
+    const PosesD& poses_t1,
+    const Candidates& candidates,
+    size_t i,
+    double max_toi,
+    double& toi) const
+{
+    const size_t num_ev = candidates.ev_candidates.size();
+    const size_t num_ee = candidates.ee_candidates.size();
 
-                if (are_colliding && toi == 0) {
-                    if (i < num_ev) {
-                        spdlog::error("Edge-vertex CCD resulted in toi=0!");
-                        save_ccd_candidate(
-                            bodies, poses_t0, poses_t1,
-                            candidates.ev_candidates[i]);
-                    } else if (i - num_ev < num_ee) {
-                        spdlog::error("Edge-edge CCD resulted in toi=0!");
-                        save_ccd_candidate(
-                            bodies, poses_t0, poses_t1,
-                            candidates.ee_candidates[i - num_ev]);
-                    } else {
-                        assert(i - num_ev - num_ee < num_fv);
-                        spdlog::error("Face-vertex CCD resulted in toi=0!");
-                        save_ccd_candidate(
-                            bodies, poses_t0, poses_t1,
-                            candidates.fv_candidates[i - num_ev - num_ee]);
-                    }
-                }
+    toi = std::numeric_limits<double>::infinity();
+    bool are_colliding;
+    if (i < num_ev) {
+        are_colliding = edge_vertex_ccd(
+            bodies, poses_t0, poses_t1, candidates.ev_candidates[i], toi,
+            trajectory_type, max_toi, minimum_separation_distance,
+            /*find_any_root=*/false, ccd_relative_toi_tolerance);
+    } else if (i - num_ev < num_ee) {
+        are_colliding = edge_edge_ccd(
+            bodies, poses_t0, poses_t1, candidates.ee_candidates[i - num_ev],
+            toi, trajectory_type, max_toi, minimum_separation_distance,
+            /*find_any_root=*/false, ccd_relative_toi_tolerance,
+            deterministic);
+    } else {
+        assert(i - num_ev - num_ee < candidates.fv_candidates.size());
+        are_colliding = face_vertex_ccd(
+            bodies, poses_t0, poses_t1,
+            candidates.fv_candidates[i - num_ev - num_ee], toi,
+            trajectory_type, max_toi, minimum_separation_distance,
+            /*find_any_root=*/false, ccd_relative_toi_tolerance,
+            deterministic);
+    }
 
-                if (are_colliding) {
-                    std::scoped_lock lock(earliest_toi_mutex);
-                    collision_count++;
-                    if (toi < earliest_toi) {
-                        earliest_toi = toi;
-                    }
+    if (are_colliding && toi == 0) {
+        if (i < num_ev) {
+            spdlog::error("Edge-vertex CCD resulted in toi=0!");
+            save_ccd_candidate(
+                bodies, poses_t0, poses_t1, candidates.ev_candidates[i]);
+        } else if (i - num_ev < num_ee) {
+            spdlog::error("Edge-edge CCD resulted in toi=0!");
+            save_ccd_candidate(
+                bodies, poses_t0, poses_t1,
+                candidates.ee_candidates[i - num_ev]);
+        } else {
+            spdlog::error("Face-vertex CCD resulted in toi=0!");
+            save_ccd_candidate(
+                bodies, poses_t0, poses_t1,
+                candidates.fv_candidates[i - num_ev - num_ee]);
+        }
+    }
+    return are_colliding;
+}
+
+double DistanceBarrierConstraint::compute_earliest_toi_streamed(
+    const RigidBodyAssembler& bodies,
+    const PosesD& poses_t0,
+    const PosesD& poses_t1) const
+{
+    NAMED_PROFILE_POINT(
+        "DistanceBarrierConstraint::compute_earliest_toi_streamed",
+        STREAMED_CCD);
+    PROFILE_START(STREAMED_CCD);
+
+    std::atomic<int> collision_count(0);
+    std::atomic<size_t> num_candidates(0);
+    std::atomic<double> earliest_toi(1);
+
+    // The narrow phase of each body pair starts as soon as it is traversed,
+    // and the bound it finds shortens the traversal of the later pairs.
+    stream_collision_candidates_rigid_bvh(
+        bodies, poses_t0, poses_t1, dim_to_collision_type(bodies.dim()),
+        [&]() { return earliest_toi.load(); },
+        [&](const Candidates& candidates) {
+            // Serial, because a nested parallel loop could steal another
+            // pair's task and overwrite the thread's candidates
+            num_candidates += candidates.size();
+            for (size_t i = 0; i < candidates.size(); i++) {
+                double toi;
+                if (!candidate_ccd(
+                        bodies, poses_t0, poses_t1, candidates, i,
+                        earliest_toi.load(), toi)) {
+                    continue;
+                }
+                collision_count++;
+                double current_toi = earliest_toi.load();
+                while (toi < current_toi
+                       && !earliest_toi.compare_exchange_weak(
+                           current_toi, toi)) {
                 }
             }
-        });
+        },
+        /*inflation_radius=*/minimum_separation_distance / 2.0);
+
+    RIGID_IPC_LOG_DEBUG(
+        "streamed_ccd num_candidates={:d} num_collisions={:d}",
+        num_candidates.load(), collision_count.load());
+
+    PROFILE_END(STREAMED_CCD);
+
+    return collision_count ? earliest_toi.load()
+                           : std::numeric_limits<double>::infinity();
+}
+
+double DistanceBarrierConstraint::compute_earliest_toi_narrow_phase(
+    const RigidBodyAssembler& bodies,
+    const PosesD& poses_t0,
+    const PosesD& poses_t1,
+    const Candidates& candidates,
+    std::vector<TOIBound>* bounds) const
+{
+    NAMED_PROFILE_POINT(
+        "DistanceBarrierConstraint::compute_earliest_toi_narrow_phase",
+        NARROW_PHASE);
+    // PROFILE_POINTs are not thread safe, so the queries of each type are
+    // timed by CCDQueryStats instead.
+
+    PROFILE_START(NARROW_PHASE);
+    StepMetrics::ScopedTimer timer(StepMetrics::NARROW_PHASE);
+
+    // Shared by all threads so a root found by one thread narrows the search
+    // interval of every later query.
+    std::atomic<int> collision_count(0);
+    std::atomic<double> earliest_toi(1);
+
+    std::vector<size_t> order = schedule_narrow_phase_candidates(
+        bodies, poses_t0, poses_t1, candidates, trajectory_type);
+
+    // The settled candidates need no query
+    if (bounds != nullptr) {
+        assert(bounds->size() == candidates.size());
+        for (const TOIBound& bound : *bounds) {
+            if (bound.is_impact) {
+                collision_count++;
+                earliest_toi = std::min(earliest_toi.load(), bound.toi);
+            }
+        }
+        const size_t num_queries = order.size();
+        order.erase(
+            std::remove_if(
+                order.begin(), order.end(),
+                [&](size_t i) { return (*bounds)[i].is_settled(); }),
+            order.end());
+        StepMetrics::add_count(
+            StepMetrics::TOI_BOUND_CACHE_REJECTIONS,
+            num_queries - order.size());
+    }
+
+    const auto query = [&](size_t i, double max_toi) {
+        double toi;
+        const bool are_colliding = candidate_ccd(
+            bodies, poses_t0, poses_t1, candidates, i, max_toi, toi);
+
+        if (bounds != nullptr) {
+            // Without an impact, there is none before the bound the query
+            // searched up to.
+            (*bounds)[i] = are_colliding ? TOIBound { toi, true }
+                                         : TOIBound { max_toi, false };
+        }
+
+        if (are_colliding) {
+            collision_count++;
+            double current_toi = earliest_toi.load();
+            while (toi < current_toi
+                   && !earliest_toi.compare_exchange_weak(current_toi, toi)) {
+            }
+        }
+    };
+
+    if (deterministic) {
+        // The queries of a batch share the bound at its start, so the roots
+        // do not depend on which query finished first.
+        const size_t batch_size =
+            Constants::DETERMINISTIC_NARROW_PHASE_BATCH_SIZE;
+        for (size_t begin = 0; begin < order.size(); begin += batch_size) {
+            const double max_toi = earliest_toi.load();
+            tbb::parallel_for(
+                begin, std::min(begin + batch_size, order.size()),
+                [&](size_t k) { query(order[k], max_toi); });
+        }
+    } else {
+        // Do a single block range over all three candidate vectors. The
+        // range is split down to single queries for the work stealing, and
+        // the queries are taken from the shared counter so they start in the
+        // scheduled order whichever subrange a thread picks up.
+        std::atomic<size_t> next_query(0);
+        tbb::parallel_for(
+            tbb::blocked_range<size_t>(0, order.size(), 1),
+            [&](tbb::blocked_range<size_t> r) {
+                for (size_t k = r.begin(); k < r.end(); k++) {
+                    query(order[next_query++], earliest_toi.load());
+                }
+            },
+            tbb::simple_partitioner());
+    }
 
     double percent_correct = candidates.size() == 0
         ? 100
@@ -251,33 +604,85 @@ double DistanceBarrierConstraint::compute_earliest_toi_narrow_phase(
     PROFILE_MESSAGE(
         NARROW_PHASE, "num_candidates,num_collisions,percentage",
         fmt::format(
-            "{:d},{:d},{:g}%", candidates.size(), collision_count,
+            "{:d},{:d},{:g}%", candidates.size(), collision_count.load(),
             percent_correct));
 
-    spdlog::debug(
+    RIGID_IPC_LOG_DEBUG(
         "num_candidates={:d} num_collisions={:d} percentage={:g}%",
-        candidates.size(), collision_count, percent_correct);
+        candidates.size(), collision_count.load(), percent_correct);
 
     PROFILE_END(NARROW_PHASE);
 
-    return collision_count ? earliest_toi
+    return collision_count ? earliest_toi.load()
                            : std::numeric_limits<double>::infinity();
 }
 
 void DistanceBarrierConstraint::construct_constraint_set(
     const RigidBodyAssembler& bodies,
     const PosesD& poses,
-    Constraints& constraint_set) const
+    Constraints& constraint_set,
+    std::vector<double>* weights) const
 {
-    static PosesD cached_poses;
-    static Constraints cached_constraint_set;
-
+    if (weights != nullptr) {
+        weights->clear();
+    }
     if (bodies.num_bodies() <= 1) {
         return;
     }
+    build_constraint_set(bodies, poses, constraint_set);
+    if (contact_manifold_reduction && weights != nullptr) {
+        if (m_are_manifolds_frozen) {
+            // Only the distances change with the poses
+            *weights = apply_contact_manifold_selection(
+                m_frozen_manifolds, constraint_set);
+        } else {
+            *weights = reduce_contact_manifolds(
+                bodies, bodies.world_vertices(poses),
+                m_barrier_activation_distance, constraint_set);
+        }
+    }
+}
+
+bool DistanceBarrierConstraint::freeze_contact_manifolds(
+    const RigidBodyAssembler& bodies, const PosesD& poses)
+{
+    if (!contact_manifold_reduction) {
+        return false;
+    }
+    Constraints constraint_set;
+    if (bodies.num_bodies() > 1) {
+        build_constraint_set(bodies, poses, constraint_set);
+    }
+    m_frozen_manifolds = select_contact_manifolds(
+        bodies, bodies.world_vertices(poses), m_barrier_activation_distance,
+        constraint_set);
+    m_are_manifolds_frozen = true;
+    return true;
+}
+
+bool DistanceBarrierConstraint::unfreeze_contact_manifolds()
+{
+    if (!m_are_manifolds_frozen) {
+        return false;
+    }
+    m_frozen_manifolds = ContactManifoldSelection();
+    m_are_manifolds_frozen = false;
+    return true;
+}
 
-    if (poses == cached_poses) {
-        constraint_set = cached_constraint_set;
+void DistanceBarrierConstraint::build_constraint_set(
+    const RigidBodyAssembler& bodies,
+    const PosesD& poses,
+    Constraints& constraint_set) const
+{
+    // One cache per thread so constraint sets can be built concurrently
+    ConstraintSetCache& cache = m_constraint_set_caches.local();
+    // The active set also depends on d̂ and dmin
+    if (poses == cache.poses && cache.dhat == m_barrier_activation_distance
+        && cache.dmin == minimum_separation_distance
+        && cache.per_body_activation_distance
+            == per_body_activation_distance) {
+        constraint_set = cache.constraint_set;
         return;
     }
 
@@ -288,21 +693,95 @@ void DistanceBarrierConstraint::construct_constraint_set(
     const double& dmin = minimum_separation_distance;
     const double inflation_radius = (dhat + dmin) / 2.0;
 
-    Candidates candidates;
-    detect_collision_candidates_rigid(
-        bodies, poses, dim_to_collision_type(bodies.dim()), candidates,
-        detection_method, inflation_radius);
+    const int collision_types = dim_to_collision_type(bodies.dim());
+    const auto detect_candidates = [&](double radius, Candidates& candidates) {
+        detect_with_method([&](DetectionMethod method) {
+            if (method == DetectionMethod::BVH && use_candidate_cache) {
+                detect_collision_candidates_rigid_bvh(
+                    bodies, poses, collision_types, candidates,
+                    m_candidate_cache, radius);
+            } else if (method == DetectionMethod::HASH_GRID) {
+                const auto hash_grid = m_hash_grids.acquire();
+                detect_collision_candidates_rigid_hash_grid(
+                    bodies, poses, collision_types, candidates, *hash_grid,
+                    radius);
+            } else {
+                detect_collision_candidates_rigid(
+                    bodies, poses, collision_types, candidates, method,
+                    radius);
+            }
+            remove_distance_field_separated_candidates(
+                bodies, poses, poses, candidates, radius);
+            if (deterministic) {
+                sort_candidates(candidates);
+            }
+            return candidates.size();
+        });
+    };
+
+    // The superset is only filtered by the exact distances below
+    const auto local_candidates = acquire_candidates();
+    const Candidates* candidates = local_candidates.get();
+    if (use_candidate_cache) {
+        candidates = &m_verlet_candidates.update(
+            bodies, poses, collision_types, inflation_radius,
+            detect_candidates);
+    } else {
+        detect_candidates(inflation_radius, *local_candidates);
+    }
 
     Eigen::MatrixXd V = bodies.world_vertices(poses);
     ipc::construct_constraint_set(
-        candidates, /*V_rest=*/V, V, bodies.m_edges, bodies.m_faces,
+        *candidates, /*V_rest=*/V, V, bodies.m_edges, bodies.m_faces,
         /*dhat=*/dhat, constraint_set, bodies.m_faces_to_edges,
         /*dmin=*/dmin);
 
+    if (per_body_activation_distance) {
+        // d̂ bounds the d̂ of every pair, so only drop the constraints
+        // farther than the d̂ of their pair
+        const auto remove_inactive = [&](auto& constraints, auto body_ids) {
+            constraints.erase(
+                std::remove_if(
+                    constraints.begin(), constraints.end(),
+                    [&](const auto& c) {
+                        const auto [body0, body1] = body_ids(c);
+                        const double pair_dhat =
+                            pair_activation_distance(bodies, body0, body1);
+                        return c.compute_distance(
+                                   V, bodies.m_edges, bodies.m_faces)
+                            >= (pair_dhat + dmin) * (pair_dhat + dmin);
+                    }),
+                constraints.end());
+        };
+        remove_inactive(constraint_set.vv_constraints, [&](const auto& c) {
+            return std::make_pair(
+                bodies.vertex_id_to_body_id(c.vertex0_index),
+                bodies.vertex_id_to_body_id(c.vertex1_index));
+        });
+        remove_inactive(constraint_set.ev_constraints, [&](const auto& c) {
+            return std::make_pair(
+                bodies.edge_id_to_body_id(c.edge_index),
+                bodies.vertex_id_to_body_id(c.vertex_index));
+        });
+        remove_inactive(constraint_set.ee_constraints, [&](const auto& c) {
+            return std::make_pair(
+                bodies.edge_id_to_body_id(c.edge0_index),
+                bodies.edge_id_to_body_id(c.edge1_index));
+        });
+        remove_inactive(constraint_set.fv_constraints, [&](const auto& c) {
+            return std::make_pair(
+                bodies.face_id_to_body_id(c.face_index),
+                bodies.vertex_id_to_body_id(c.vertex_index));
+        });
+    }
+
     PROFILE_END();
 
-    cached_poses = poses;
-    cached_constraint_set = constraint_set;
+    cache.poses = poses;
+    cache.constraint_set = constraint_set;
+    cache.dhat = m_barrier_activation_distance;
+    cache.dmin = minimum_separation_distance;
+    cache.per_body_activation_distance = per_body_activation_distance;
 }
 
 double DistanceBarrierConstraint::compute_minimum_distance(
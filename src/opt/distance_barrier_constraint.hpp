@@ -1,6 +1,7 @@
 #pragma once
 
 #include <Eigen/Core>
+#include <tbb/enumerable_thread_specific.h>
 
 #include <ipc/collision_constraint.hpp>
 
@@ -9,8 +10,16 @@
 #include <autodiff/autodiff_types.hpp>
 #include <barrier/barrier.hpp>
 #include <ccd/ccd.hpp>
+#include <ccd/rigid/body_pair_candidate_cache.hpp>
+#include <ccd/rigid/body_pair_separation_cache.hpp>
+#include <ccd/rigid/rigid_body_hash_grid.hpp>
+#include <ccd/rigid/speculative_ccd_candidates.hpp>
+#include <ccd/rigid/toi_bound_cache.hpp>
+#include <ccd/rigid/verlet_candidate_list.hpp>
 #include <ipc/broad_phase/hash_grid.hpp>
+#include <opt/contact_manifold_reduction.hpp>
 #include <utils/eigen_ext.hpp>
+#include <utils/transient_pool.hpp>
 
 namespace ipc::rigid {
 
@@ -33,6 +42,26 @@ public:
         m_barrier_activation_distance = dhat;
     }
 
+    /// @brief d̂ of a pair of bodies (at most barrier_activation_distance(),
+    /// see per_body_activation_distance).
+    double pair_activation_distance(
+        const RigidBodyAssembler& bodies, long body0, long body1) const
+    {
+        return per_body_activation_distance
+            ? m_barrier_activation_distance
+                * bodies.activation_distance_scale(body0, body1)
+            : m_barrier_activation_distance;
+    }
+
+    /// @brief Smallest d̂ of any pair of bodies.
+    double min_pair_activation_distance(const RigidBodyAssembler& bodies) const
+    {
+        return per_body_activation_distance
+            ? m_barrier_activation_distance
+                * bodies.min_activation_distance_scale()
+            : m_barrier_activation_distance;
+    }
+
     bool has_active_collisions(
         const RigidBodyAssembler& bodies,
         const PosesD& poses_t0,
@@ -43,15 +72,38 @@ public:
         const PosesD& poses_t0,
         const PosesD& poses_t1) const;
 
+    /// @brief Detect the candidates of compute_earliest_toi() for the
+    /// trajectories from poses that move no vertex further than
+    /// max_displacement, before the end poses are known. It only touches
+    /// its own candidates, so it can run concurrently with the linear solve
+    /// (but not with CCD).
+    void prefetch_ccd_candidates(
+        const RigidBodyAssembler& bodies,
+        const PosesD& poses,
+        const double max_displacement) const;
+
     void compute_constraints(
         const RigidBodyAssembler& bodies,
         const PosesD& poses,
         Eigen::VectorXd& barriers);
 
+    /// @param[out] weights  Weights of the barriers of the constraints (see
+    /// contact_manifold_reduction). If nullptr, the constraints are not
+    /// reduced.
     void construct_constraint_set(
         const RigidBodyAssembler& bodies,
         const PosesD& poses,
-        Constraints& constraint_set) const;
+        Constraints& constraint_set,
+        std::vector<double>* weights = nullptr) const;
+
+    /// @brief Reduce the contact manifolds of the constraint sets with the
+    /// representatives selected at poses until unfreeze_contact_manifolds(),
+    /// so the barrier is continuous within a Newton iteration.
+    /// @returns False if contact_manifold_reduction is disabled.
+    bool freeze_contact_manifolds(
+        const RigidBodyAssembler& bodies, const PosesD& poses);
+    /// @returns False if the manifolds were not frozen.
+    bool unfreeze_contact_manifolds();
 
     template <typename T>
     T distance_barrier(const T& distance, const double dhat) const;
@@ -83,21 +135,132 @@ public:
 
     double minimum_separation_distance;
 
+    /// @brief Reduce flat contact manifolds to weighted representatives
+    /// (see reduce_contact_manifolds()) for the callers that use weights.
+    bool contact_manifold_reduction;
+
+    /// @brief Fraction of itself to which compute_earliest_toi() resolves a
+    /// rigid time of impact. It only limits a step, so it does not need the
+    /// fixed precision of Constants::RIGID_CCD_TOI_TOL.
+    double ccd_relative_toi_tolerance;
+
+    /// @brief Stream the BVH candidates of each body pair into the narrow
+    /// phase of compute_earliest_toi() instead of collecting them first, so
+    /// the phases overlap and the bound prunes the traversal. It bypasses
+    /// the candidate caches of the rigid trajectories (and is ignored if
+    /// deterministic).
+    bool stream_ccd_candidates;
+
+    /// @brief Scale d̂ of each body pair by the local feature size of its
+    /// bodies (see RigidBodyAssembler::activation_distance_scale()), so
+    /// finely meshed bodies get a thinner barrier and fewer active
+    /// constraints. d̂ itself applies to the coarsest bodies and bounds the
+    /// broad phase.
+    bool per_body_activation_distance;
+
+    /// @brief Reuse BVH candidates and the candidate superset between
+    /// constraint sets, and body pair separations and time-of-impact bounds
+    /// between CCD calls. Disable this while constraint sets are built or
+    /// CCD is run concurrently.
+    bool use_candidate_cache = true;
+
+    void invalidate_body_caches() override
+    {
+        m_separation_cache.clear();
+        m_constraint_set_caches.clear();
+        unfreeze_contact_manifolds(); // The primitive ids may change
+    }
+
+    /// @brief Separations of the body pairs certified so far.
+    const BodyPairSeparationCache& separation_cache() const
+    {
+        return m_separation_cache;
+    }
+
 protected:
+    /// @brief Last constraint set built by a thread and what it depends on.
+    struct ConstraintSetCache {
+        PosesD poses;
+        Constraints constraint_set;
+        double dhat = -1;
+        double dmin = -1;
+        bool per_body_activation_distance = false;
+    };
+
+    /// @brief Build the full constraint set (cached per thread).
+    void build_constraint_set(
+        const RigidBodyAssembler& bodies,
+        const PosesD& poses,
+        Constraints& constraint_set) const;
+
     bool has_active_collisions_narrow_phase(
         const RigidBodyAssembler& bodies,
         const PosesD& poses_t0,
         const PosesD& poses_t1,
         const Candidates& candidates) const;
 
+    /// @brief Query the time of impact of candidate i (indexed as [ev, ee,
+    /// fv]) up to max_toi, saving the queries that result in a zero one.
+    bool candidate_ccd(
+        const RigidBodyAssembler& bodies,
+        const PosesD& poses_t0,
+        const PosesD& poses_t1,
+        const Candidates& candidates,
+        size_t i,
+        double max_toi,
+        double& toi) const;
+
+    /// @brief Earliest time of impact with the narrow phase of each body
+    /// pair run as soon as the BVH finds its candidates.
+    double compute_earliest_toi_streamed(
+        const RigidBodyAssembler& bodies,
+        const PosesD& poses_t0,
+        const PosesD& poses_t1) const;
+
+    /// @param bounds Known bounds on the time of impact of the candidates
+    /// (skipping the queries of the settled ones), updated with the results
+    /// of the queries.
     double compute_earliest_toi_narrow_phase(
         const RigidBodyAssembler& bodies,
         const PosesD& poses_t0,
         const PosesD& poses_t1,
-        const Candidates& candidates) const;
+        const Candidates& candidates,
+        std::vector<TOIBound>* bounds = nullptr) const;
 
     /// @brief Max distance, d̂, at which the barrier forces are activate.
     double m_barrier_activation_distance;
+
+    /// @brief BVH candidates of body pairs reused between constraint sets.
+    mutable BodyPairCandidateCache m_candidate_cache;
+
+    /// @brief Superset of the candidates, so the broad phase only runs when
+    /// a body moved farther than the slack.
+    mutable VerletCandidateList m_verlet_candidates;
+
+    /// @brief Separations of body pairs reused by the CCD broad phase, kept
+    /// across time steps (the cached poses bound the error).
+    mutable BodyPairSeparationCache m_separation_cache;
+
+    /// @brief Candidates and time-of-impact bounds of the last CCD call,
+    /// reused by the line search along the same trajectory.
+    mutable TOIBoundCache m_toi_bound_cache;
+
+    /// @brief Candidates of the next CCD call detected ahead of time (see
+    /// prefetch_ccd_candidates()).
+    mutable SpeculativeCCDCandidates m_speculative_candidates;
+
+    /// @brief Constraint set caches of the threads building constraint sets
+    /// of this constraint (never shared between simulations).
+    mutable tbb::enumerable_thread_specific<ConstraintSetCache>
+        m_constraint_set_caches;
+
+    /// @brief Hash grids whose storage and dimensions are reused by the broad
+    /// phase across steps.
+    mutable TransientPool<RigidBodyHashGrid> m_hash_grids;
+
+    /// @brief Manifold representatives of freeze_contact_manifolds().
+    ContactManifoldSelection m_frozen_manifolds;
+    bool m_are_manifolds_frozen = false;
 };
 
 } // namespace ipc::rigid
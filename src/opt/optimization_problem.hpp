@@ -1,5 +1,6 @@
 #pragma once
 
+#include <limits>
 #include <vector>
 
 #include <Eigen/Core>
@@ -43,6 +44,37 @@ public:
             /*compute_grad=*/true, /*compute_hess=*/false);
     }
 
+    /// Compute f(x) for each x (e.g., speculative line-search steps)
+    virtual void compute_objectives(
+        const std::vector<Eigen::VectorXd>& xs, std::vector<double>& fxs)
+    {
+        fxs.resize(xs.size());
+        for (size_t i = 0; i < xs.size(); i++) {
+            fxs[i] = compute_objective(xs[i]);
+        }
+    }
+
+    /// @brief Compute f(x), its gradient, and its hessian restricted to the
+    /// free DoF (rows and columns in the order of free_dof).
+    /// @param full_to_free_dof Index of each DoF in free_dof (or -1).
+    /// @returns False if the problem only assembles the full hessian (then
+    /// nothing is computed).
+    virtual bool compute_free_objective(
+        const Eigen::VectorXd& x,
+        const Eigen::VectorXi& free_dof,
+        const std::vector<int>& full_to_free_dof,
+        double& fx,
+        Eigen::VectorXd& grad,
+        Eigen::SparseMatrix<double>& hess_free)
+    {
+        return false;
+    }
+
+    /// @brief Hold the terms that must not change within a Newton iteration
+    /// (e.g., during its line search) at their values at the iterate x.
+    /// @returns True if the objective changed.
+    virtual bool begin_iteration(const Eigen::VectorXd& x) { return false; }
+
     virtual void update_augmented_lagrangian(const Eigen::VectorXd& x) {}
     virtual bool
     are_equality_constraints_satisfied(const Eigen::VectorXd& x) const
@@ -53,6 +85,9 @@ public:
     /// @returns the number of variables
     virtual int num_vars() const = 0;
 
+    /// @returns The number of consecutive DoF that belong to one body.
+    virtual int num_vars_per_block() const { return 1; }
+
     /// @returns A vector of booleans indicating if a DoF is fixed.
     virtual const VectorXb& is_dof_fixed() const = 0;
 
@@ -76,8 +111,28 @@ public:
     virtual double compute_earliest_toi(
         const Eigen::VectorXd& xi, const Eigen::VectorXd& xj) = 0;
 
+    /// @brief Prepare the broad phase of the next compute_earliest_toi() from
+    /// xi for the steps that move no vertex further than max_displacement.
+    /// It may run concurrently with the linear solve (but not with CCD).
+    virtual void prefetch_earliest_toi(
+        const Eigen::VectorXd& xi, double max_displacement) const
+    {
+    }
+
+    /// @brief Bound on the distance a vertex moves from xi to xj (infinite
+    /// if unknown).
+    virtual double max_vertex_displacement(
+        const Eigen::VectorXd& xi, const Eigen::VectorXd& xj) const
+    {
+        return std::numeric_limits<double>::infinity();
+    }
+
     virtual bool is_ccd_aligned_with_newton_update() = 0;
 
+    /// @brief Whether the results must not depend on the thread scheduling
+    /// (so the solver does not speculate ahead of them).
+    virtual bool is_deterministic() const { return false; }
+
     /// Compute the minimum distance among geometry
     virtual double compute_min_distance(const Eigen::VectorXd& x) const = 0;
 
@@ -96,6 +151,11 @@ public:
     /// Get the time-step
     virtual double timestep() const = 0;
 
+    /// @returns True if the hessian from compute_objective() is symmetric
+    /// but only its lower triangle is meaningful (entries above the diagonal
+    /// may be missing and must be ignored).
+    virtual bool is_hessian_lower_triangular() const { return false; }
+
     virtual bool is_barrier_problem() const { return false; }
     virtual bool is_constrained_problem() const { return false; }
 };
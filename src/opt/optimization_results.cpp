@@ -8,6 +8,8 @@ OptimizationResults::OptimizationResults()
     , success(false)
     , finished(false)
     , num_iterations(0)
+    , num_line_search_failures(0)
+    , earliest_toi(1)
 {
 }
 
@@ -22,6 +24,8 @@ OptimizationResults::OptimizationResults(
     , success(success)
     , finished(finished)
     , num_iterations(num_iterations)
+    , num_line_search_failures(0)
+    , earliest_toi(1)
 {
 }
 
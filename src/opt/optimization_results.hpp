@@ -11,6 +11,10 @@ struct OptimizationResults {
                         ///< successfully.
     bool finished;      ///< @brief Whether or not the optimizer converged.
     int num_iterations; ///< @brief number of iterations performed
+    /// @brief Number of failed Newton line searches.
+    int num_line_search_failures;
+    /// @brief Smallest time of impact that limited a step (1 if none).
+    double earliest_toi;
 
     OptimizationResults();
     OptimizationResults(
@@ -0,0 +1,175 @@
+#include "perf_counters.hpp"
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <sstream>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include <tbb/task_scheduler_observer.h>
+
+#include <logger.hpp>
+
+namespace ipc::rigid {
+namespace profiler {
+
+    namespace {
+        struct EventType {
+            uint32_t type;
+            uint64_t config;
+        };
+
+        std::atomic<bool> is_counting(false);
+        std::vector<std::string> names;
+        std::vector<EventType> types;
+
+#ifdef __linux__
+        /// @brief Counters of one thread (kept open after the thread exits so
+        /// its counts stay readable).
+        struct ThreadCounters {
+            ThreadCounters()
+            {
+                for (const EventType& event : types) {
+                    perf_event_attr attr = {};
+                    attr.size = sizeof(attr);
+                    attr.type = event.type;
+                    attr.config = event.config;
+                    attr.exclude_kernel = 1;
+                    attr.exclude_hv = 1;
+                    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED
+                        | PERF_FORMAT_TOTAL_TIME_RUNNING;
+                    // Count the calling thread on any CPU
+                    fds.push_back(int(syscall(
+                        __NR_perf_event_open, &attr, 0, -1, -1, 0)));
+                }
+            }
+            ~ThreadCounters()
+            {
+                for (int fd : fds) {
+                    if (fd >= 0) {
+                        close(fd);
+                    }
+                }
+            }
+
+            std::vector<double> read() const
+            {
+                std::vector<double> counts(fds.size(), 0);
+                for (size_t i = 0; i < fds.size(); i++) {
+                    uint64_t data[3]; // value, time enabled, time running
+                    if (fds[i] >= 0
+                        && ::read(fds[i], data, sizeof(data)) == sizeof(data)
+                        && data[2] > 0) {
+                        counts[i] = data[0] * (double(data[1]) / data[2]);
+                    }
+                }
+                return counts;
+            }
+
+            std::vector<int> fds;
+        };
+
+        std::mutex counters_mutex;
+        std::vector<std::shared_ptr<ThreadCounters>> counters;
+
+        void open_local_counters()
+        {
+            thread_local std::shared_ptr<ThreadCounters> local = [] {
+                auto thread_counters = std::make_shared<ThreadCounters>();
+                std::lock_guard<std::mutex> lock(counters_mutex);
+                counters.push_back(thread_counters);
+                return thread_counters;
+            }();
+        }
+
+        /// @brief Opens the counters of the TBB workers.
+        class WorkerObserver : public tbb::task_scheduler_observer {
+        public:
+            void on_scheduler_entry(bool /*is_worker*/) override
+            {
+                open_local_counters();
+            }
+        };
+#endif
+    } // namespace
+
+    bool PerfCounters::enable(const std::string& raw_events)
+    {
+#ifdef __linux__
+        if (is_enabled()) {
+            return true;
+        }
+        names = { "cycles",       "instructions",        "cache_references",
+                  "cache_misses", "branch_instructions", "branch_misses" };
+        types = { { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+                  { PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+                  { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_REFERENCES },
+                  { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES },
+                  { PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_INSTRUCTIONS },
+                  { PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES } };
+        std::stringstream stream(raw_events);
+        std::string raw_event;
+        while (std::getline(stream, raw_event, ',')) {
+            const size_t split = raw_event.find('=');
+            try {
+                if (split == std::string::npos || split == 0) {
+                    throw std::invalid_argument(raw_event);
+                }
+                const uint64_t config =
+                    std::stoull(raw_event.substr(split + 1), nullptr, 0);
+                names.push_back(raw_event.substr(0, split));
+                types.push_back({ PERF_TYPE_RAW, config });
+            } catch (const std::exception&) {
+                spdlog::warn("invalid raw perf event={}", raw_event);
+            }
+        }
+
+        // Check that the counters can be opened before counting anything
+        if (ThreadCounters().fds[0] < 0) {
+            spdlog::warn(
+                "hardware performance counters are unavailable (check "
+                "/proc/sys/kernel/perf_event_paranoid)");
+            return false;
+        }
+        open_local_counters();
+        static WorkerObserver observer;
+        observer.observe(true);
+        is_counting = true;
+        RIGID_IPC_LOG_DEBUG(
+            "perf_counters action=enable num_events={:d}", names.size());
+        return true;
+#else
+        spdlog::warn("hardware performance counters require Linux");
+        return false;
+#endif
+    }
+
+    bool PerfCounters::is_enabled() { return is_counting; }
+
+    const std::vector<std::string>& PerfCounters::event_names()
+    {
+        return names;
+    }
+
+    std::vector<std::vector<double>> PerfCounters::read()
+    {
+        std::vector<std::vector<double>> counts;
+#ifdef __linux__
+        if (is_enabled()) {
+            std::lock_guard<std::mutex> lock(counters_mutex);
+            counts.reserve(counters.size());
+            for (const auto& thread_counters : counters) {
+                counts.push_back(thread_counters->read());
+            }
+        }
+#endif
+        return counts;
+    }
+
+} // namespace profiler
+} // namespace ipc::rigid
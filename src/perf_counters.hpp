@@ -0,0 +1,38 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+namespace ipc::rigid {
+namespace profiler {
+
+    /// @brief Hardware performance counters (Linux perf_event) of every
+    /// thread of the process.
+    ///
+    /// Counters are opened for the enabling thread and for every TBB worker
+    /// when it joins the scheduler, so the counts of a window are available
+    /// per thread. Counters that the kernel multiplexes are scaled by their
+    /// running fraction.
+    class PerfCounters {
+    public:
+        /// @brief Start counting cycles, instructions, cache references and
+        /// misses, and branch instructions and misses.
+        ///
+        /// @param raw_events  Extra CPU-specific events as comma separated
+        ///                    "name=config" pairs (e.g., vector instructions
+        ///                    "avx_double=0x10c7" on Intel).
+        /// @returns False if the counters are not available (e.g., not Linux
+        ///          or a restrictive perf_event_paranoid).
+        static bool enable(const std::string& raw_events = "");
+        static bool is_enabled();
+
+        /// @brief Names of the counted events in the order of their counts.
+        static const std::vector<std::string>& event_names();
+
+        /// @brief Current counts of every thread with counters (indexed by
+        /// the order the threads started counting).
+        static std::vector<std::vector<double>> read();
+    };
+
+} // namespace profiler
+} // namespace ipc::rigid
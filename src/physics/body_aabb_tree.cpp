@@ -0,0 +1,292 @@
+#include "body_aabb_tree.hpp"
+
+#include <algorithm>
+
+#include <tbb/enumerable_thread_specific.h>
+#include <tbb/parallel_for.h>
+#include <tbb/parallel_sort.h>
+
+namespace ipc::rigid {
+
+namespace {
+    inline bool
+    boxes_overlap(const BodyAABBTree::AABB3& a, const BodyAABBTree::AABB3& b)
+    {
+        return (a[0].array() <= b[1].array()).all()
+            && (b[0].array() <= a[1].array()).all();
+    }
+
+    inline double diagonal(const BodyAABBTree::AABB3& box)
+    {
+        return (box[1] - box[0]).norm();
+    }
+
+    inline BodyAABBTree::AABB3
+    merge(const BodyAABBTree::AABB3& a, const BodyAABBTree::AABB3& b)
+    {
+        return { { a[0].cwiseMin(b[0]), a[1].cwiseMax(b[1]) } };
+    }
+} // namespace
+
+BodyAABBTree::BodyAABBTree(const BodyAABBTree& other)
+    : m_nodes(other.m_nodes)
+    , m_leaf_nodes(other.m_leaf_nodes)
+    , m_num_leaves(other.m_num_leaves)
+    , m_num_rebuilds(other.m_num_rebuilds)
+    , m_num_free_nodes(other.m_num_free_nodes)
+    , m_built_cost(other.m_built_cost)
+{
+}
+
+BodyAABBTree& BodyAABBTree::operator=(const BodyAABBTree& other)
+{
+    m_nodes = other.m_nodes;
+    m_leaf_nodes = other.m_leaf_nodes;
+    m_num_leaves = other.m_num_leaves;
+    m_num_rebuilds = other.m_num_rebuilds;
+    m_num_free_nodes = other.m_num_free_nodes;
+    m_built_cost = other.m_built_cost;
+    return *this;
+}
+
+void BodyAABBTree::build(const std::vector<AABB3>& boxes)
+{
+    m_nodes.clear();
+    m_num_free_nodes = 0;
+    m_num_leaves = boxes.size();
+    m_leaf_nodes.assign(boxes.size(), -1);
+    if (boxes.empty()) {
+        m_built_cost = 0;
+        return;
+    }
+
+    m_nodes.reserve(2 * boxes.size() - 1);
+    std::vector<int> body_ids(boxes.size());
+    for (int i = 0; i < body_ids.size(); i++) {
+        body_ids[i] = i;
+    }
+    build_node(boxes, body_ids, 0, boxes.size());
+
+    m_built_cost = cost();
+    m_num_rebuilds++;
+}
+
+int BodyAABBTree::build_node(
+    const std::vector<AABB3>& boxes,
+    std::vector<int>& body_ids,
+    int begin,
+    int end)
+{
+    const int node_id = m_nodes.size();
+    m_nodes.emplace_back();
+
+    if (end - begin == 1) {
+        m_nodes[node_id].box = boxes[body_ids[begin]];
+        m_nodes[node_id].body_id = body_ids[begin];
+        m_leaf_nodes[body_ids[begin]] = node_id;
+        return node_id;
+    }
+
+    // Split at the median center along the longest axis of the centers
+    Eigen::Vector3d min = Eigen::Vector3d::Constant(
+        std::numeric_limits<double>::infinity());
+    Eigen::Vector3d max = -min;
+    for (int i = begin; i < end; i++) {
+        const AABB3& box = boxes[body_ids[i]];
+        Eigen::Vector3d center = (box[0] + box[1]) / 2;
+        min = min.cwiseMin(center);
+        max = max.cwiseMax(center);
+    }
+    int axis;
+    (max - min).maxCoeff(&axis);
+
+    const int mid = (begin + end) / 2;
+    std::nth_element(
+        body_ids.begin() + begin, body_ids.begin() + mid,
+        body_ids.begin() + end, [&](int a, int b) {
+            return boxes[a][0][axis] + boxes[a][1][axis]
+                < boxes[b][0][axis] + boxes[b][1][axis];
+        });
+
+    const int left = build_node(boxes, body_ids, begin, mid);
+    const int right = build_node(boxes, body_ids, mid, end);
+    m_nodes[left].parent = m_nodes[right].parent = node_id;
+
+    Node& node = m_nodes[node_id];
+    node.left = left;
+    node.right = right;
+    node.box[0] = m_nodes[left].box[0].cwiseMin(m_nodes[right].box[0]);
+    node.box[1] = m_nodes[left].box[1].cwiseMax(m_nodes[right].box[1]);
+    return node_id;
+}
+
+void BodyAABBTree::refit(const std::vector<AABB3>& boxes)
+{
+    assert(boxes.size() == m_num_leaves);
+    // Children come after their parents, so a reverse sweep is bottom-up.
+    for (int i = int(m_nodes.size()) - 1; i >= 0; i--) {
+        Node& node = m_nodes[i];
+        if (node.body_id >= 0) {
+            node.box = boxes[node.body_id];
+        } else if (node.body_id != FREE_NODE) {
+            node.box[0] =
+                m_nodes[node.left].box[0].cwiseMin(m_nodes[node.right].box[0]);
+            node.box[1] =
+                m_nodes[node.left].box[1].cwiseMax(m_nodes[node.right].box[1]);
+        }
+    }
+}
+
+void BodyAABBTree::insert(const AABB3& box)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    const int body_id = int(m_num_leaves++);
+    if (m_nodes.empty()) {
+        m_nodes.emplace_back();
+        m_nodes[0].box = box;
+        m_nodes[0].body_id = body_id;
+        m_leaf_nodes.push_back(0);
+        return;
+    }
+
+    // Descend to the leaf whose box grows the least, growing the boxes on
+    // the way down
+    int node_id = 0;
+    while (m_nodes[node_id].body_id < 0) {
+        Node& node = m_nodes[node_id];
+        node.box = merge(node.box, box);
+        const double left_growth = diagonal(merge(m_nodes[node.left].box, box))
+            - diagonal(m_nodes[node.left].box);
+        const double right_growth =
+            diagonal(merge(m_nodes[node.right].box, box))
+            - diagonal(m_nodes[node.right].box);
+        node_id = left_growth <= right_growth ? node.left : node.right;
+    }
+
+    // The leaf moves to the end, so its slot can become the parent of the
+    // two leaves while children stay after their parents.
+    const int sibling_id = m_nodes.size(), leaf_id = sibling_id + 1;
+    m_nodes.push_back(m_nodes[node_id]);
+    m_nodes[sibling_id].parent = node_id;
+    m_leaf_nodes[m_nodes[sibling_id].body_id] = sibling_id;
+
+    m_nodes.emplace_back();
+    m_nodes[leaf_id].box = box;
+    m_nodes[leaf_id].body_id = body_id;
+    m_nodes[leaf_id].parent = node_id;
+    m_leaf_nodes.push_back(leaf_id);
+
+    Node& parent = m_nodes[node_id];
+    parent.box = merge(m_nodes[sibling_id].box, box);
+    parent.left = sibling_id;
+    parent.right = leaf_id;
+    parent.body_id = -1;
+}
+
+void BodyAABBTree::remove(int body_id)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    assert(body_id >= 0 && body_id < m_num_leaves);
+    const int leaf_id = m_leaf_nodes[body_id];
+    m_leaf_nodes.erase(m_leaf_nodes.begin() + body_id);
+    m_num_leaves--;
+    for (int i = body_id; i < m_leaf_nodes.size(); i++) {
+        m_nodes[m_leaf_nodes[i]].body_id--;
+    }
+    if (m_num_leaves == 0) {
+        m_nodes.clear();
+        m_num_free_nodes = 0;
+        return;
+    }
+
+    // The sibling takes the parent's slot, which comes before the sibling's
+    // children as well.
+    const int parent_id = m_nodes[leaf_id].parent;
+    const int sibling_id = m_nodes[parent_id].left == leaf_id
+        ? m_nodes[parent_id].right
+        : m_nodes[parent_id].left;
+    const int grandparent_id = m_nodes[parent_id].parent;
+    m_nodes[parent_id] = m_nodes[sibling_id];
+    m_nodes[parent_id].parent = grandparent_id;
+    Node& node = m_nodes[parent_id];
+    if (node.body_id >= 0) {
+        m_leaf_nodes[node.body_id] = parent_id;
+    } else {
+        m_nodes[node.left].parent = m_nodes[node.right].parent = parent_id;
+    }
+    m_nodes[leaf_id].body_id = m_nodes[sibling_id].body_id = FREE_NODE;
+    m_num_free_nodes += 2;
+
+    // Shrink the boxes of the ancestors
+    for (int i = grandparent_id; i >= 0; i = m_nodes[i].parent) {
+        m_nodes[i].box =
+            merge(m_nodes[m_nodes[i].left].box, m_nodes[m_nodes[i].right].box);
+    }
+}
+
+double BodyAABBTree::cost() const
+{
+    double c = 0;
+    for (const Node& node : m_nodes) {
+        if (node.body_id == -1) {
+            c += (node.box[1] - node.box[0]).norm();
+        }
+    }
+    return c;
+}
+
+std::vector<std::pair<int, int>> BodyAABBTree::find_overlapping_pairs(
+    const std::function<bool(int, int)>& can_collide) const
+{
+    tbb::enumerable_thread_specific<std::vector<std::pair<int, int>>>
+        storages;
+
+    tbb::parallel_for(size_t(0), m_num_leaves, [&](size_t i) {
+        auto& local_pairs = storages.local();
+        const AABB3& box = m_nodes[m_leaf_nodes[i]].box;
+
+        std::vector<int> stack = { 0 };
+        while (!stack.empty()) {
+            const Node& node = m_nodes[stack.back()];
+            stack.pop_back();
+            if (!boxes_overlap(box, node.box)) {
+                continue;
+            }
+            if (node.body_id < 0) {
+                stack.push_back(node.left);
+                stack.push_back(node.right);
+            } else if (i < node.body_id && can_collide(i, node.body_id)) {
+                local_pairs.emplace_back(i, node.body_id);
+            }
+        }
+    });
+
+    std::vector<std::pair<int, int>> pairs;
+    for (const auto& local_pairs : storages) {
+        pairs.insert(pairs.end(), local_pairs.begin(), local_pairs.end());
+    }
+    // Keep the order independent of the thread scheduling
+    tbb::parallel_sort(pairs.begin(), pairs.end());
+    return pairs;
+}
+
+std::vector<std::pair<int, int>>
+BodyAABBTree::update_and_find_overlapping_pairs(
+    const std::vector<AABB3>& boxes,
+    const std::function<bool(int, int)>& can_collide)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (boxes.size() != m_num_leaves) {
+        build(boxes);
+    } else {
+        refit(boxes);
+        // Also compact the nodes freed by remove()
+        if (cost() > REBUILD_COST_RATIO * m_built_cost
+            || m_num_free_nodes > m_nodes.size() / 2) {
+            build(boxes);
+        }
+    }
+    return find_overlapping_pairs(can_collide);
+}
+
+} // namespace ipc::rigid
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <array>
+#include <functional>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include <Eigen/Core>
+
+namespace ipc::rigid {
+
+/// @brief Persistent AABB tree over whole bodies.
+///
+/// Unlike rebuilding a BVH every query, the tree topology is kept between
+/// queries and only refit bottom-up when the boxes move. It is rebuilt when
+/// the number of bodies changes or the refit tree becomes too loose, unless
+/// the bodies were inserted or removed one at a time.
+class BodyAABBTree {
+public:
+    typedef std::array<Eigen::Vector3d, 2> AABB3;
+
+    BodyAABBTree() {}
+    /// @brief Copy the tree, but not its mutex.
+    BodyAABBTree(const BodyAABBTree& other);
+    BodyAABBTree& operator=(const BodyAABBTree& other);
+
+    /// @brief Build a new tree over the boxes.
+    void build(const std::vector<AABB3>& boxes);
+
+    /// @brief Update the boxes keeping the current topology.
+    void refit(const std::vector<AABB3>& boxes);
+
+    /// @brief Add a leaf for a new last body next to the leaf whose box
+    /// grows the least.
+    void insert(const AABB3& box);
+
+    /// @brief Remove the leaf of a body, shifting the ids of the bodies
+    /// after it down by one.
+    void remove(int body_id);
+
+    /// @brief Find all pairs (i < j) of overlapping boxes.
+    std::vector<std::pair<int, int>> find_overlapping_pairs(
+        const std::function<bool(int, int)>& can_collide) const;
+
+    /// @brief Refit (or rebuild) the tree and find all overlapping pairs.
+    /// This is thread safe.
+    std::vector<std::pair<int, int>> update_and_find_overlapping_pairs(
+        const std::vector<AABB3>& boxes,
+        const std::function<bool(int, int)>& can_collide);
+
+    size_t num_leaves() const { return m_num_leaves; }
+    size_t num_rebuilds() const { return m_num_rebuilds; }
+
+    /// @brief Rebuild when the refit cost is this many times the built cost.
+    static constexpr double REBUILD_COST_RATIO = 2.0;
+
+protected:
+    struct Node {
+        AABB3 box;
+        int left = -1;    ///< @brief Index of the left child
+        int right = -1;   ///< @brief Index of the right child
+        int body_id = -1; ///< @brief Body of a leaf node (-1 if internal)
+        int parent = -1;  ///< @brief Index of the parent (-1 if the root)
+    };
+
+    /// @brief Body id of the nodes freed by remove() until the next build.
+    static const int FREE_NODE = -2;
+
+    int build_node(
+        const std::vector<AABB3>& boxes, std::vector<int>& body_ids,
+        int begin, int end);
+
+    /// @brief Sum of the internal nodes' box diagonals.
+    double cost() const;
+
+    /// @brief Nodes ordered so children always have larger indices than
+    /// their parents.
+    std::vector<Node> m_nodes;
+    /// @brief Node of each body's leaf.
+    std::vector<int> m_leaf_nodes;
+    size_t m_num_leaves = 0;
+    size_t m_num_rebuilds = 0;
+    size_t m_num_free_nodes = 0;
+    double m_built_cost = 0;
+
+    std::mutex m_mutex;
+};
+
+} // namespace ipc::rigid
@@ -0,0 +1,89 @@
+#include "domain_decomposition.hpp"
+
+#include <algorithm>
+#include <cassert>
+
+#include <utils/morton_order.hpp>
+
+namespace ipc::rigid {
+
+void DomainDecomposition::partition(
+    const RigidBodyAssembler& bodies,
+    const PosesD& poses,
+    int num_ranks,
+    double ghost_distance)
+{
+    assert(num_ranks > 0 && poses.size() == bodies.num_bodies());
+    const int num_bodies = bodies.num_bodies();
+    m_body_ranks.assign(num_bodies, 0);
+    m_owned_bodies.assign(num_ranks, std::vector<int>());
+    m_ghost_bodies.assign(num_ranks, std::vector<int>());
+    if (num_bodies == 0) {
+        return;
+    }
+
+    Eigen::MatrixXd positions(num_bodies, bodies.dim());
+    for (int i = 0; i < num_bodies; i++) {
+        positions.row(i) = poses[i].position;
+    }
+    const std::vector<int> order = morton_order(positions);
+
+    // Cut the curve where the running vertex count passes each quantile
+    const double num_vertices = bodies.num_vertices();
+    long running_num_vertices = 0;
+    for (int id : order) {
+        const int rank = std::min(
+            int(num_ranks * (running_num_vertices / num_vertices)),
+            num_ranks - 1);
+        m_body_ranks[id] = rank;
+        running_num_vertices += bodies[id].num_vertices();
+    }
+    for (int i = 0; i < num_bodies; i++) {
+        m_owned_bodies[m_body_ranks[i]].push_back(i);
+    }
+
+    // Close pairs across ranks make each body a ghost of the other's rank
+    const std::vector<std::pair<int, int>> close_pairs =
+        bodies.close_bodies(poses, poses, ghost_distance / 2);
+    for (const auto& [i, j] : close_pairs) {
+        if (m_body_ranks[i] != m_body_ranks[j]) {
+            m_ghost_bodies[m_body_ranks[j]].push_back(i);
+            m_ghost_bodies[m_body_ranks[i]].push_back(j);
+        }
+    }
+    for (std::vector<int>& ghosts : m_ghost_bodies) {
+        std::sort(ghosts.begin(), ghosts.end());
+        ghosts.erase(std::unique(ghosts.begin(), ghosts.end()), ghosts.end());
+    }
+}
+
+nlohmann::json
+DomainDecomposition::statistics(const RigidBodyAssembler& bodies) const
+{
+    nlohmann::json stats;
+    stats["num_ranks"] = num_ranks();
+    std::vector<nlohmann::json> ranks;
+    long max_num_vertices = 0, num_ghosts = 0;
+    for (int rank = 0; rank < num_ranks(); rank++) {
+        long num_vertices = 0;
+        for (int id : m_owned_bodies[rank]) {
+            num_vertices += bodies[id].num_vertices();
+        }
+        max_num_vertices = std::max(max_num_vertices, num_vertices);
+        num_ghosts += m_ghost_bodies[rank].size();
+        ranks.push_back({ { "num_owned_bodies", m_owned_bodies[rank].size() },
+                          { "num_ghost_bodies", m_ghost_bodies[rank].size() },
+                          { "num_vertices", num_vertices } });
+    }
+    stats["ranks"] = ranks;
+    const double mean_num_vertices =
+        double(bodies.num_vertices()) / std::max(num_ranks(), 1);
+    stats["vertex_imbalance"] =
+        mean_num_vertices > 0 ? max_num_vertices / mean_num_vertices : 1.0;
+    stats["ghost_fraction"] = bodies.num_bodies() > 0
+        ? double(num_ghosts) / bodies.num_bodies()
+        : 0.0;
+    return stats;
+}
+
+} // namespace ipc::rigid
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <vector>
+
+#include <nlohmann/json.hpp>
+
+#include <physics/pose.hpp>
+#include <physics/rigid_body_assembler.hpp>
+
+namespace ipc::rigid {
+
+/// @brief Spatial decomposition of the bodies into regions of separate
+/// ranks.
+///
+/// Each rank owns a contiguous range of a Morton curve of the body positions,
+/// balanced by the number of vertices. Bodies of other ranks that can come
+/// within the ghost distance of an owned body are the rank's ghosts, so a rank
+/// can run its broad and narrow phases on its owned and ghost bodies alone.
+class DomainDecomposition {
+public:
+    /// @brief Partition the bodies among the ranks.
+    /// @param ghost_distance Distance below which bodies of different ranks
+    ///                       interact (e.g., d̂ plus the motion of a step).
+    void partition(
+        const RigidBodyAssembler& bodies,
+        const PosesD& poses,
+        int num_ranks,
+        double ghost_distance);
+
+    int num_ranks() const { return m_owned_bodies.size(); }
+
+    /// @brief Rank owning each body.
+    const std::vector<int>& body_ranks() const { return m_body_ranks; }
+
+    /// @brief Bodies owned by the rank (sorted).
+    const std::vector<int>& owned_bodies(int rank) const
+    {
+        return m_owned_bodies[rank];
+    }
+
+    /// @brief Bodies of other ranks close to the rank's bodies (sorted).
+    const std::vector<int>& ghost_bodies(int rank) const
+    {
+        return m_ghost_bodies[rank];
+    }
+
+    /// @brief Owned and ghost counts per rank, the vertex imbalance (max over
+    /// mean), and the fraction of bodies that are ghosts.
+    nlohmann::json statistics(const RigidBodyAssembler& bodies) const;
+
+protected:
+    std::vector<int> m_body_ranks;
+    std::vector<std::vector<int>> m_owned_bodies;
+    std::vector<std::vector<int>> m_ghost_bodies;
+};
+
+} // namespace ipc::rigid
@@ -0,0 +1,182 @@
+#include "kinematic_source.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include <constants.hpp>
+#include <io/serialize_json.hpp>
+#include <logger.hpp>
+
+namespace ipc::rigid {
+
+std::shared_ptr<KinematicSource>
+KinematicSource::from_json(const nlohmann::json& json, int dim)
+{
+    const std::string type = json.value("type", "");
+    if (type == "binary") {
+        const std::string filename = json.value("path", "");
+        const double period = json.value("period", -1.0);
+        if (period <= 0) {
+            spdlog::error(
+                "kinematic_source type=binary failure=\"period={:g} is not "
+                "positive\"",
+                period);
+            return nullptr;
+        }
+        auto source =
+            std::make_shared<BinaryKinematicSource>(filename, dim, period);
+        if (!source->is_open()) {
+            spdlog::error(
+                "kinematic_source type=binary failure=\"unable to read "
+                "{}\"",
+                filename);
+            return nullptr;
+        }
+        return source;
+    } else if (type == "spline") {
+        const std::vector<double> times =
+            json.value("times", std::vector<double>());
+        PosesD poses;
+        for (const nlohmann::json& jpose : json.value("poses", json.array())) {
+            PoseD pose = PoseD::Zero(dim);
+            if (jpose.contains("position")) {
+                ipc::rigid::from_json(jpose["position"], pose.position);
+            }
+            if (jpose.contains("rotation")) {
+                ipc::rigid::from_json(jpose["rotation"], pose.rotation);
+            }
+            poses.push_back(pose);
+        }
+        if (times.empty() || times.size() != poses.size()
+            || !std::is_sorted(
+                times.begin(), times.end(), std::less_equal<double>())) {
+            spdlog::error(
+                "kinematic_source type=spline failure=\"expected as many "
+                "strictly increasing times ({:d}) as poses ({:d})\"",
+                times.size(), poses.size());
+            return nullptr;
+        }
+        return std::make_shared<SplineKinematicSource>(times, poses);
+    }
+    spdlog::error("kinematic_source failure=\"unknown type {}\"", type);
+    return nullptr;
+}
+
+// ----------------------------------------------------------------------------
+
+BinaryKinematicSource::BinaryKinematicSource(
+    const std::string& filename, int dim, double period)
+    : m_dim(dim)
+    , m_period(period)
+{
+    const size_t sample_bytes = PoseD::dim_to_ndof(dim) * sizeof(double);
+    if (m_mapping.open(filename)) {
+        m_num_samples = m_mapping.size() / sample_bytes;
+        return;
+    }
+    m_stream.open(filename, std::ios::binary | std::ios::ate);
+    if (m_stream) {
+        m_num_samples = size_t(m_stream.tellg()) / sample_bytes;
+    }
+}
+
+PoseD BinaryKinematicSource::sample(size_t i) const
+{
+    const int ndof = PoseD::dim_to_ndof(m_dim);
+    VectorMax6d dof(ndof);
+    const size_t sample_bytes = ndof * sizeof(double);
+    if (m_mapping.is_open()) {
+        std::memcpy(
+            dof.data(), m_mapping.data() + i * sample_bytes, sample_bytes);
+    } else {
+        m_stream.seekg(i * sample_bytes);
+        m_stream.read(reinterpret_cast<char*>(dof.data()), sample_bytes);
+    }
+    return PoseD(dof);
+}
+
+bool BinaryKinematicSource::pose(double t, PoseD& pose) const
+{
+    // Sample i is at time (i + 1) * period
+    const double u = t / m_period - 1;
+    if (m_num_samples == 0
+        || u > m_num_samples - 1 + Constants::KINEMATIC_SOURCE_TIME_TOLERANCE
+            / m_period) {
+        return false;
+    }
+    if (u <= 0) {
+        pose = sample(0);
+        return true;
+    }
+    const size_t i = std::min(size_t(u), m_num_samples - 1);
+    if (i + 1 == m_num_samples) {
+        pose = sample(i);
+    } else {
+        pose = PoseD::interpolate(sample(i), sample(i + 1), u - i);
+    }
+    return true;
+}
+
+bool BinaryKinematicSource::write(
+    const std::string& filename, const PosesD& poses)
+{
+    std::ofstream file(filename, std::ios::binary);
+    for (const PoseD& pose : poses) {
+        const VectorMax6d dof = pose.dof();
+        file.write(
+            reinterpret_cast<const char*>(dof.data()),
+            dof.size() * sizeof(double));
+    }
+    return bool(file);
+}
+
+// ----------------------------------------------------------------------------
+
+SplineKinematicSource::SplineKinematicSource(
+    const std::vector<double>& times, const PosesD& poses)
+    : m_times(times)
+    , m_dim(poses.empty() ? 0 : poses[0].dim())
+{
+    assert(times.size() == poses.size() && !times.empty());
+    const size_t n = times.size();
+    m_dofs.resize(n);
+    for (size_t i = 0; i < n; i++) {
+        m_dofs[i] = poses[i].dof();
+    }
+    m_tangents.resize(n);
+    for (size_t i = 0; i < n; i++) {
+        const size_t i0 = i > 0 ? i - 1 : i, i1 = i + 1 < n ? i + 1 : i;
+        if (i0 == i1) {
+            m_tangents[i] = VectorMax6d::Zero(m_dofs[i].size());
+        } else {
+            m_tangents[i] =
+                (m_dofs[i1] - m_dofs[i0]) / (m_times[i1] - m_times[i0]);
+        }
+    }
+}
+
+bool SplineKinematicSource::pose(double t, PoseD& pose) const
+{
+    if (t > m_times.back() + Constants::KINEMATIC_SOURCE_TIME_TOLERANCE) {
+        return false;
+    }
+    const size_t i1 =
+        std::upper_bound(m_times.begin(), m_times.end(), t) - m_times.begin();
+    if (i1 == 0 || i1 == m_times.size()) {
+        // Before the first or at (up to the tolerance) the last key
+        pose = PoseD(m_dofs[i1 == 0 ? 0 : i1 - 1]);
+        return true;
+    }
+    const size_t i0 = i1 - 1;
+    // Cubic Hermite basis
+    const double h = m_times[i1] - m_times[i0];
+    const double s = (t - m_times[i0]) / h, s2 = s * s, s3 = s2 * s;
+    pose = PoseD(VectorMax6d(
+        (2 * s3 - 3 * s2 + 1) * m_dofs[i0] + (s3 - 2 * s2 + s) * h
+            * m_tangents[i0]
+        + (-2 * s3 + 3 * s2) * m_dofs[i1] + (s3 - s2) * h * m_tangents[i1]));
+    return true;
+}
+
+} // namespace ipc::rigid
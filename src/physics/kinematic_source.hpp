@@ -0,0 +1,106 @@
+#pragma once
+
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <nlohmann/json.hpp>
+
+#include <io/mapped_file.hpp>
+#include <physics/pose.hpp>
+
+namespace ipc::rigid {
+
+/// @brief Scripted motion of a kinematic body evaluated on demand.
+///
+/// Unlike the queued kinematic poses, a source is queried by the time of
+/// the scripted motion, so a long trajectory never has to be in memory and
+/// the time-step can change between queries. Sources are immutable and
+/// shared by the copies of a body.
+class KinematicSource {
+public:
+    virtual ~KinematicSource() = default;
+
+    /// @brief Pose at time t of the scripted motion.
+    /// @returns False once the motion is over.
+    virtual bool pose(double t, PoseD& pose) const = 0;
+
+    /// @brief Create a source from its settings ("binary" or "spline").
+    /// @returns nullptr if the settings are invalid.
+    static std::shared_ptr<KinematicSource>
+    from_json(const nlohmann::json& json, int dim);
+};
+
+/// @brief Poses computed by a user function (e.g., from Python).
+class CallbackKinematicSource : public KinematicSource {
+public:
+    typedef std::function<bool(double, PoseD&)> Callback;
+
+    CallbackKinematicSource(const Callback& callback)
+        : m_callback(callback)
+    {
+    }
+
+    bool pose(double t, PoseD& pose) const override
+    {
+        return m_callback(t, pose);
+    }
+
+protected:
+    Callback m_callback;
+};
+
+/// @brief Poses sampled at a fixed period streamed from a binary file.
+///
+/// The file holds raw native doubles, the position then the rotation of
+/// each sample, where sample i is the pose at time (i + 1) * period. Poses
+/// between samples are interpolated linearly. The file is memory mapped (or
+/// read sample by sample), so only the queried pages are loaded.
+class BinaryKinematicSource : public KinematicSource {
+public:
+    /// @brief Open the file (check is_open()).
+    BinaryKinematicSource(const std::string& filename, int dim, double period);
+
+    bool is_open() const { return num_samples() > 0; }
+    size_t num_samples() const { return m_num_samples; }
+    double period() const { return m_period; }
+
+    bool pose(double t, PoseD& pose) const override;
+
+    /// @brief Write poses sampled at a fixed period in the source's format.
+    static bool write(const std::string& filename, const PosesD& poses);
+
+protected:
+    /// @brief Read the i-th sample.
+    PoseD sample(size_t i) const;
+
+    MappedFile m_mapping;
+    mutable std::ifstream m_stream; ///< @brief Used if mapping fails
+    int m_dim;
+    double m_period;
+    size_t m_num_samples = 0;
+};
+
+/// @brief Poses interpolated by a C¹ cubic spline through key poses.
+///
+/// The tangents are the (one-sided at the ends) finite differences of the
+/// neighbouring keys, so the motion has no velocity jump at the keys. The
+/// pose before the first key is the first key.
+class SplineKinematicSource : public KinematicSource {
+public:
+    /// @param times Strictly increasing times of the keys.
+    /// @param poses Key poses (rotation vectors are interpolated linearly).
+    SplineKinematicSource(
+        const std::vector<double>& times, const PosesD& poses);
+
+    bool pose(double t, PoseD& pose) const override;
+
+protected:
+    std::vector<double> m_times;
+    std::vector<VectorMax6d> m_dofs, m_tangents;
+    int m_dim;
+};
+
+} // namespace ipc::rigid
@@ -29,11 +29,17 @@ public:
     static Pose<T> Zero(int dim);
 
     static Poses<T> dofs_to_poses(const VectorX<T>& dofs, int dim);
+    /// @brief Overwrite poses with the dofs, reusing the vector's storage.
+    static void
+    dofs_to_poses(const VectorX<T>& dofs, int dim, Poses<T>& poses);
     static VectorX<T> poses_to_dofs(const Poses<T>& poses);
 
-    static int dim_to_ndof(const int dim) { return dim == 2 ? 3 : 6; }
-    static int dim_to_pos_ndof(const int dim) { return dim; }
-    static int dim_to_rot_ndof(const int dim)
+    static constexpr int dim_to_ndof(const int dim)
+    {
+        return dim == 2 ? 3 : 6;
+    }
+    static constexpr int dim_to_pos_ndof(const int dim) { return dim; }
+    static constexpr int dim_to_rot_ndof(const int dim)
     {
         return dim_to_ndof(dim) - dim_to_pos_ndof(dim);
     }
@@ -100,11 +106,58 @@ public:
 typedef Pose<double> PoseD;
 typedef Poses<double> PosesD;
 
+/// @brief Read-only view of the poses stored in a DoF vector.
+///
+/// Nothing is copied when the view is made: position(i) and rotation(i) are
+/// segments of the DoF vector, which must outlive the view, and operator[]
+/// builds a single pose on the stack.
+template <typename T> class PosesView {
+public:
+    PosesView(const VectorX<T>& dofs, int dim)
+        : m_dofs(dofs)
+        , m_dim(dim)
+    {
+        assert(dofs.size() % ndof() == 0);
+    }
+
+    size_t size() const { return m_dofs.size() / ndof(); }
+    int dim() const { return m_dim; }
+    int ndof() const { return Pose<T>::dim_to_ndof(m_dim); }
+
+    /// Position dof of the i-th pose
+    auto position(size_t i) const
+    {
+        return m_dofs.segment(i * ndof(), Pose<T>::dim_to_pos_ndof(m_dim));
+    }
+    /// Rotation dof of the i-th pose
+    auto rotation(size_t i) const
+    {
+        return m_dofs.segment(
+            i * ndof() + Pose<T>::dim_to_pos_ndof(m_dim),
+            Pose<T>::dim_to_rot_ndof(m_dim));
+    }
+
+    Pose<T> operator[](size_t i) const
+    {
+        return Pose<T>(position(i), rotation(i));
+    }
+
+protected:
+    const VectorX<T>& m_dofs;
+    int m_dim;
+};
+
+typedef PosesView<double> PosesViewD;
+
 template <typename T>
 Poses<T> interpolate(const Poses<T>& pose0, const Poses<T>& pose1, T t);
 template <typename T> Poses<T> operator*(const Poses<T>& poses, const T& x);
 /// @brief Cast poses element-wise.
 template <typename T, typename U> Poses<T> cast(const Poses<U>& poses);
+/// @brief Rotation matrices of all poses in one parallel pass, so they can
+/// be shared instead of recomputed for every body pair.
+template <typename T>
+std::vector<MatrixMax3<T>> construct_rotation_matrices(const Poses<T>& poses);
 
 template <typename T>
 MatrixMax3<T> construct_rotation_matrix(const VectorMax3<T>& r);
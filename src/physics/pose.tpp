@@ -1,5 +1,6 @@
 #include "pose.hpp"
 
+#include <type_traits>
 #include <typeinfo> // operator typeid
 
 #include <Eigen/Geometry>
@@ -83,6 +84,20 @@ Poses<T> Pose<T>::dofs_to_poses(const VectorX<T>& dofs, int dim)
     return poses;
 }
 
+template <typename T>
+void Pose<T>::dofs_to_poses(const VectorX<T>& dofs, int dim, Poses<T>& poses)
+{
+    int ndof = dim_to_ndof(dim);
+    int num_poses = dofs.size() / ndof;
+    assert(dofs.size() % ndof == 0);
+    poses.resize(num_poses);
+    for (int i = 0; i < num_poses; i++) {
+        poses[i].position = dofs.segment(i * ndof, dim_to_pos_ndof(dim));
+        poses[i].rotation =
+            dofs.segment(i * ndof + dim_to_pos_ndof(dim), dim_to_rot_ndof(dim));
+    }
+}
+
 template <typename T> VectorX<T> Pose<T>::poses_to_dofs(const Poses<T>& poses)
 {
     const int ndof = poses.size() ? poses[0].ndof() : 0;
@@ -199,6 +214,16 @@ template <typename T, typename U> Poses<T> cast(const Poses<U>& poses)
     return poses_T;
 }
 
+template <typename T>
+std::vector<MatrixMax3<T>> construct_rotation_matrices(const Poses<T>& poses)
+{
+    std::vector<MatrixMax3<T>> rotations(poses.size());
+    tbb::parallel_for(size_t(0), poses.size(), [&](size_t i) {
+        rotations[i] = poses[i].construct_rotation_matrix();
+    });
+    return rotations;
+}
+
 template <typename T>
 MatrixMax3<T> construct_rotation_matrix(const VectorMax3<T>& r)
 {
@@ -213,6 +238,13 @@ MatrixMax3<T> construct_rotation_matrix(const VectorMax3<T>& r)
         Matrix3<T> R =
             sinc_angle * K + 0.5 * sinc_half_angle * sinc_half_angle * K2;
         R.diagonal().array() += T(1.0);
+        if constexpr (std::is_same<T, Interval>::value) {
+            // The entries of a rotation are in [-1, 1], but the natural
+            // extension over wide boxes can overshoot this.
+            R = R.unaryExpr([](const Interval& r_ij) {
+                return boost::numeric::intersect(r_ij, Interval(-1, 1));
+            });
+        }
         return R;
     }
 }
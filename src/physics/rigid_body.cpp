@@ -1,12 +1,11 @@
 ﻿#include "rigid_body.hpp"
 
-#include <Eigen/Eigenvalues>
 #include <Eigen/Geometry>
 
 #include <autodiff/autodiff_types.hpp>
 #include <finitediff.hpp>
 #include <logger.hpp>
-#include <physics/mass.hpp>
+#include <physics/rotation_diff.hpp>
 #include <profiler.hpp>
 #include <utils/eigen_ext.hpp>
 #include <utils/flatten.hpp>
@@ -14,37 +13,44 @@
 
 namespace ipc::rigid {
 
-void center_vertices(
-    Eigen::MatrixXd& vertices,
+RigidBody::RigidBody(
+    const Eigen::MatrixXd& vertices,
     const Eigen::MatrixXi& edges,
     const Eigen::MatrixXi& faces,
-    PoseD& pose)
+    const PoseD& pose,
+    const PoseD& velocity,
+    const PoseD& force,
+    const double density,
+    const VectorMax6b& is_dof_fixed,
+    const bool oriented,
+    const int group_id,
+    const RigidBodyType type,
+    const double kinematic_max_time,
+    const std::deque<PoseD>& kinematic_poses)
+    // Bodies with the same mesh share the geometry and mass properties
+    : RigidBody(
+          RigidBodyGeometry::get(
+              vertices,
+              edges,
+              faces,
+              num_rot_dof_fixed(vertices.cols(), is_dof_fixed)),
+          pose,
+          velocity,
+          force,
+          density,
+          is_dof_fixed,
+          oriented,
+          group_id,
+          type,
+          kinematic_max_time,
+          kinematic_poses)
 {
-    int dim = vertices.cols();
-
-    vertices.rowwise() += pose.position.transpose();
-
-    // compute the center of mass several times to get more accurate
-    pose.position.setZero(dim);
-    for (int i = 0; i < 10; i++) {
-        double mass;
-        VectorMax3d com;
-        MatrixMax3d inertia;
-        compute_mass_properties(
-            vertices, dim == 2 || faces.size() == 0 ? edges : faces, mass, com,
-            inertia);
-        vertices.rowwise() -= com.transpose();
-        pose.position += com;
-        if (com.squaredNorm() < 1e-8) {
-            break;
-        }
-    }
+    assert(edges.size() == 0 || edges.cols() == 2);
+    assert(faces.size() == 0 || faces.cols() == 3);
 }
 
 RigidBody::RigidBody(
-    const Eigen::MatrixXd& vertices,
-    const Eigen::MatrixXi& edges,
-    const Eigen::MatrixXi& faces,
+    const std::shared_ptr<const RigidBodyGeometry>& geometry,
     const PoseD& pose,
     const PoseD& velocity,
     const PoseD& force,
@@ -55,25 +61,21 @@ RigidBody::RigidBody(
     const RigidBodyType type,
     const double kinematic_max_time,
     const std::deque<PoseD>& kinematic_poses)
-    : group_id(group_id)
+    : pose(pose)
+    , velocity(velocity)
+    , force(force)
     , type(type)
-    , vertices(vertices)
-    , edges(edges)
-    , faces(faces)
     , is_dof_fixed(is_dof_fixed)
+    , group_id(group_id)
     , is_oriented(oriented)
-    , mesh_selector(vertices.rows(), edges, faces)
-    , pose(pose)
-    , velocity(velocity)
-    , force(force)
+    , geometry(geometry)
     , kinematic_max_time(kinematic_max_time)
     , kinematic_poses(kinematic_poses)
 {
-    assert(dim() == pose.dim());
-    assert(dim() == velocity.dim());
-    assert(dim() == force.dim());
-    assert(edges.size() == 0 || edges.cols() == 2);
-    assert(faces.size() == 0 || faces.cols() == 3);
+    assert(geometry != nullptr);
+    assert(geometry->dim() == pose.dim());
+    assert(geometry->dim() == velocity.dim());
+    assert(geometry->dim() == force.dim());
 
     if (type == RigidBodyType::STATIC) {
         this->is_dof_fixed.setOnes(this->is_dof_fixed.size());
@@ -81,51 +83,25 @@ RigidBody::RigidBody(
         this->type = RigidBodyType::STATIC;
     }
 
-    center_vertices(this->vertices, edges, faces, this->pose);
-    VectorMax3d center_of_mass;
-    MatrixMax3d I;
-    compute_mass_properties(
-        this->vertices,
-        dim() == 2 || faces.size() == 0 ? edges : faces, //
-        mass, center_of_mass, I);
-    // assert(center_of_mass.squaredNorm() < 1e-8);
+    const int num_rot_dof_fixed = geometry->num_rot_dof_fixed;
+    assert(
+        num_rot_dof_fixed
+        == RigidBody::num_rot_dof_fixed(geometry->dim(), is_dof_fixed));
+    this->vertices = geometry->vertices;
+    this->edges = geometry->edges;
+    this->faces = geometry->faces;
+    this->pose.position += geometry->center_of_mass;
 
     // Mass above is actually volume in m³ and density is Kg/m³
-    mass *= density;
+    mass = density * geometry->volume;
+    moment_of_inertia = density * geometry->moment_of_inertia;
+    R0 = geometry->R0;
+    r_max = geometry->r_max;
+    average_edge_length = geometry->average_edge_length;
+    is_convex = geometry->is_convex;
+
     if (dim() == 3) {
-        // Got this from Chrono: https://bit.ly/2RpbTl1
-        Eigen::SelfAdjointEigenSolver<Eigen::Matrix3d> es;
-        double threshold = I.lpNorm<Eigen::Infinity>() * 1e-16;
-        I = (threshold < I.array().abs()).select(I, 0.0);
-        es.compute(I);
-        if (es.info() != Eigen::Success) {
-            spdlog::error("Eigen decompostion of the inertia tensor failed!");
-        }
-        moment_of_inertia = density * es.eigenvalues();
-        if ((moment_of_inertia.array() < 0).any()) {
-            spdlog::warn(
-                "Negative moment of inertia ({}), inverting.",
-                fmt_eigen(moment_of_inertia));
-            // Avoid negative epsilon inertias
-            moment_of_inertia =
-                (moment_of_inertia.array() < 0)
-                    .select(-moment_of_inertia, moment_of_inertia);
-        }
-        R0 = es.eigenvectors();
-        // Ensure that we have an orientation preserving transform
-        if (R0.determinant() < 0.0) {
-            R0.col(0) *= -1.0;
-        }
-        assert(R0.isUnitary(1e-9));
-        assert(fabs(R0.determinant() - 1.0) <= 1.0e-9);
-        int num_rot_dof_fixed =
-            is_dof_fixed.tail(PoseD::dim_to_rot_ndof(dim())).count();
-        if (num_rot_dof_fixed == 2) {
-            // Convert moment of inertia to world coordinates
-            // https://physics.stackexchange.com/a/268812
-            moment_of_inertia = -I.diagonal().array() + I.diagonal().sum();
-            R0.setIdentity();
-        } else if (num_rot_dof_fixed == 1) {
+        if (num_rot_dof_fixed == 1) {
             spdlog::warn("Rigid body dynamics with two rotational DoF has "
                          "not been tested thoroughly.");
         }
@@ -133,8 +109,6 @@ RigidBody::RigidBody(
         Eigen::AngleAxisd r = Eigen::AngleAxisd(
             Eigen::Matrix3d(this->pose.construct_rotation_matrix() * R0));
         this->pose.rotation = r.angle() * r.axis();
-        // v = Rv₀ + p = RᵢR₀v₀ + p = RᵢR₀R₀ᵀv₀ + p
-        this->vertices = this->vertices * R0; // R₀ᵀ * V₀ᵀ = V₀ * R₀
         // ω = R₀ᵀω₀ (ω₀ expressed in body coordinates)
         this->velocity.rotation = R0.transpose() * this->velocity.rotation;
         Eigen::Matrix3d Q_t0 = this->pose.construct_rotation_matrix();
@@ -142,9 +116,6 @@ RigidBody::RigidBody(
         // τ = R₀ᵀτ₀ (τ₀ expressed in body coordinates)
         // NOTE: this transformation will be done later
         // this->force.rotation = R0.transpose() * this->force.rotation;
-    } else {
-        moment_of_inertia = density * I.diagonal();
-        R0 = Eigen::Matrix<double, 1, 1>::Identity();
     }
 
     // Zero out the velocity and forces of fixed dof
@@ -163,69 +134,14 @@ RigidBody::RigidBody(
     mass_matrix.resize(ndof());
     mass_matrix.diagonal().head(pos_ndof()).setConstant(mass);
     mass_matrix.diagonal().tail(rot_ndof()) = moment_of_inertia;
-
-    r_max = this->vertices.rowwise().norm().maxCoeff();
-
-    average_edge_length = 0;
-    for (long i = 0; i < edges.rows(); i++) {
-        average_edge_length +=
-            (this->vertices.row(edges(i, 0)) - this->vertices.row(edges(i, 1)))
-                .norm();
-    }
-    if (edges.rows() > 0) {
-        average_edge_length /= edges.rows();
-    }
-    assert(std::isfinite(average_edge_length));
-
-    init_bvh();
 }
 
-void RigidBody::init_bvh()
+int RigidBody::num_rot_dof_fixed(int dim, const VectorMax6b& is_dof_fixed)
 {
-    PROFILE_POINT("RigidBody::init_bvh");
-    PROFILE_START();
-
-    // heterogenous bounding boxes
-    std::vector<std::array<Eigen::Vector3d, 2>> aabbs(
-        num_codim_vertices() + num_codim_edges() + num_faces());
-
-    for (size_t i = 0; i < num_codim_vertices(); i++) {
-        size_t vi = mesh_selector.codim_vertices_to_vertices(i);
-        if (dim() == 2) {
-            aabbs[i][0][2] = 0;
-            aabbs[i][1][2] = 0;
-        }
-        aabbs[i][0].head(dim()) = vertices.row(i);
-        aabbs[i][1].head(dim()) = vertices.row(i);
-    }
-
-    size_t start_i = num_codim_vertices();
-    for (size_t i = 0; i < num_codim_edges(); i++) {
-        size_t ei = mesh_selector.codim_edges_to_edges(i);
-        const auto& e0 = vertices.row(edges(ei, 0));
-        const auto& e1 = vertices.row(edges(ei, 1));
-
-        if (dim() == 2) {
-            aabbs[start_i + i][0][2] = 0;
-            aabbs[start_i + i][1][2] = 0;
-        }
-        aabbs[start_i + i][0].head(dim()) = e0.cwiseMin(e1);
-        aabbs[start_i + i][1].head(dim()) = e0.cwiseMax(e1);
-    }
-
-    start_i += num_codim_edges();
-    for (size_t i = 0; i < num_faces(); i++) {
-        assert(dim() == 3);
-        const auto& f0 = vertices.row(faces(i, 0));
-        const auto& f1 = vertices.row(faces(i, 1));
-        const auto& f2 = vertices.row(faces(i, 2));
-        aabbs[start_i + i][0] = f0.cwiseMin(f1).cwiseMin(f2);
-        aabbs[start_i + i][1] = f0.cwiseMax(f1).cwiseMax(f2);
+    if (dim != 3) {
+        return 0;
     }
-
-    bvh.init(aabbs);
-
-    PROFILE_END();
+    return is_dof_fixed.tail(PoseD::dim_to_rot_ndof(3)).count();
 }
 
 Eigen::MatrixXd RigidBody::world_velocities() const
@@ -242,6 +158,62 @@ Eigen::MatrixXd RigidBody::world_velocities() const
         + velocity.position.transpose();
 }
 
+Eigen::MatrixXd RigidBody::world_vertices_diff(
+    const PoseD& pose,
+    long rb_v0_i,
+    Eigen::MatrixXd& V,
+    Eigen::MatrixXd& jac,
+    Eigen::MatrixXd& hess,
+    bool compute_hess) const
+{
+    assert(rb_v0_i >= 0 && rb_v0_i <= V.rows() - vertices.rows());
+    assert(V.cols() == dim());
+    assert(rb_v0_i <= jac.rows() - vertices.size());
+    assert(jac.cols() == ndof());
+    assert(
+        !compute_hess || rb_v0_i <= (hess.size() / ndof()) - vertices.size());
+
+    // Only the rotation matrix depends nonlinearly on the dof.
+    RotationGradient grad_R;
+    RotationHessian hess_R;
+    MatrixMax3d R = construct_rotation_matrix_diff(
+        pose.rotation, grad_R, compute_hess ? &hess_R : nullptr);
+
+    V.middleRows(rb_v0_i, num_vertices()) =
+        world_vertices(R, pose.position);
+
+    for (int i = 0; i < num_vertices(); i++) {
+        for (int j = 0; j < dim(); j++) {
+            // Fill in gradient of V(i, j) (∈ R⁶ for 3D)
+            int vij_flat = (rb_v0_i + i) * V.cols() + j;
+            jac.row(vij_flat).head(pos_ndof()).setZero();
+            jac(vij_flat, j) = 1; // ∇p V = I
+            for (int k = 0; k < rot_ndof(); k++) {
+                jac(vij_flat, pos_ndof() + k) =
+                    grad_R[k].row(j).dot(vertices.row(i));
+            }
+
+            if (compute_hess) {
+                // Fill in hessian of V(i, j) (∈ R⁶ˣ⁶ for 3D)
+                // Hessian of position is zero
+                // ∇²_p V = ∇_p∇_r V = ∇_r∇_p V = 0
+                assert(hess.cols() == ndof());
+                hess.middleRows(ndof() * vij_flat, ndof()).setZero();
+                for (int k = 0; k < rot_ndof(); k++) {
+                    for (int l = 0; l < rot_ndof(); l++) {
+                        hess(ndof() * vij_flat + pos_ndof() + k,
+                             pos_ndof() + l) =
+                            hess_R[k * rot_ndof() + l].row(j).dot(
+                                vertices.row(i));
+                    }
+                }
+            }
+        }
+    }
+
+    return V;
+}
+
 void RigidBody::compute_bounding_box(
     const PoseD& pose_t0,
     const PoseD& pose_t1,
@@ -270,4 +242,18 @@ void RigidBody::compute_bounding_box(
     PROFILE_END();
 }
 
+SupportFunction RigidBody::support_function(const PoseD& pose) const
+{
+    const MatrixMax3d R = pose.construct_rotation_matrix();
+    const VectorMax3d p = pose.position;
+    return [this, R, p](const Eigen::Vector3d& direction) {
+        const int dim = p.size();
+        Eigen::Index i;
+        (vertices * (R.transpose() * direction.head(dim))).maxCoeff(&i);
+        Eigen::Vector3d support = Eigen::Vector3d::Zero();
+        support.head(dim) = R * vertices.row(i).transpose() + p;
+        return support;
+    };
+}
+
 } // namespace ipc::rigid
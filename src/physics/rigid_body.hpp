@@ -1,16 +1,18 @@
 #pragma once
 
 #include <deque>
+#include <memory>
 
 #include <Eigen/Core>
 #include <nlohmann/json.hpp>
 
+#include <geometry/convex.hpp>
+#include <geometry/sparse_distance_field.hpp>
+#include <physics/kinematic_source.hpp>
 #include <physics/pose.hpp>
+#include <physics/rigid_body_geometry.hpp>
 #include <utils/eigen_ext.hpp>
 
-#include <BVH.hpp>
-#include <utils/mesh_selector.hpp>
-
 namespace ipc::rigid {
 
 enum RigidBodyType { STATIC, KINEMATIC, DYNAMIC };
@@ -46,6 +48,25 @@ public:
             std::numeric_limits<double>::infinity(),
         const std::deque<PoseD>& kinematic_poses = std::deque<PoseD>());
 
+    /// @brief Create a rigid body from an existing (shared) geometry.
+    RigidBody(
+        const std::shared_ptr<const RigidBodyGeometry>& geometry,
+        const PoseD& pose,
+        const PoseD& velocity,
+        const PoseD& force,
+        const double density,
+        const VectorMax6b& is_dof_fixed,
+        const bool oriented,
+        const int group_id,
+        const RigidBodyType type = RigidBodyType::DYNAMIC,
+        const double kinematic_max_time =
+            std::numeric_limits<double>::infinity(),
+        const std::deque<PoseD>& kinematic_poses = std::deque<PoseD>());
+
+    /// @brief Number of fixed rotational dof that determine the principal
+    /// frame of the geometry.
+    static int num_rot_dof_fixed(int dim, const VectorMax6b& is_dof_fixed);
+
     // Faceless version for convienence (useful for 2D)
     RigidBody(
         const Eigen::MatrixXd& vertices,
@@ -138,15 +159,17 @@ public:
         return world_vertex<T>(Pose<T>(dof), vertex_idx);
     }
 
+    /// @brief Fill in the vertices and their derivatives starting at row
+    /// rb_v0_i of the global matrices.
     /// @warning Will not resize jac or hess, so make sure it is large
     /// enough.
-    template <typename DScalar>
     Eigen::MatrixXd world_vertices_diff(
         const PoseD& pose,
         long rb_v0_i,
         Eigen::MatrixXd& V,
         Eigen::MatrixXd& jac,
-        Eigen::MatrixXd& hess) const;
+        Eigen::MatrixXd& hess,
+        bool compute_hess) const;
 
     double edge_length(int edge_id) const
     {
@@ -160,9 +183,9 @@ public:
     long num_faces() const { return faces.rows(); }
     long num_codim_vertices() const
     {
-        return mesh_selector.num_codim_vertices();
+        return mesh_selector().num_codim_vertices();
     }
-    long num_codim_edges() const { return mesh_selector.num_codim_edges(); }
+    long num_codim_edges() const { return mesh_selector().num_codim_edges(); }
     int dim() const { return vertices.cols(); }
     int ndof() const { return pose.ndof(); }
     int pos_ndof() const { return pose.pos_ndof(); }
@@ -183,6 +206,10 @@ public:
         return compute_bounding_box(pose, pose, box_min, box_max);
     }
 
+    /// @brief Support function of the convex hull of the world vertices at a
+    /// pose. The body must outlive the function.
+    SupportFunction support_function(const PoseD& pose) const;
+
     void convert_to_static()
     {
         type = RigidBodyType::STATIC;
@@ -192,76 +219,191 @@ public:
         force.zero_dof(is_dof_fixed, R0);
     }
 
+    /// @brief Fix a resting dynamic body like a static one until woken up.
+    void sleep()
+    {
+        assert(type == RigidBodyType::DYNAMIC);
+        awake_is_dof_fixed = is_dof_fixed;
+        type = RigidBodyType::STATIC;
+        is_dof_fixed.setOnes();
+        velocity.zero_dof(is_dof_fixed, R0);
+        is_sleeping = true;
+    }
+
+    /// @brief Restore the dynamics of a sleeping body.
+    void wake_up()
+    {
+        assert(is_sleeping);
+        type = RigidBodyType::DYNAMIC;
+        is_dof_fixed = awake_is_dof_fixed;
+        is_sleeping = false;
+        num_resting_steps = 0;
+    }
+
+    /// @brief Hold the body fixed like a static one for one stage of a
+    /// multi-rate step (see thaw()).
+    void freeze()
+    {
+        assert(!is_frozen);
+        frozen_type = type;
+        frozen_is_dof_fixed = is_dof_fixed;
+        frozen_velocity = velocity;
+        type = RigidBodyType::STATIC;
+        is_dof_fixed.setOnes();
+        velocity.zero_dof(is_dof_fixed, R0);
+        is_frozen = true;
+    }
+
+    /// @brief Restore the type, fixed DoF, and velocity of a frozen body.
+    void thaw()
+    {
+        assert(is_frozen);
+        type = frozen_type;
+        is_dof_fixed = frozen_is_dof_fixed;
+        velocity = frozen_velocity;
+        is_frozen = false;
+    }
+
+    /// @brief Bound on the distance a vertex travels in a step of the given
+    /// length at the current velocity.
+    double step_displacement(double timestep) const
+    {
+        return timestep
+            * (velocity.position.norm() + velocity.rotation.norm() * r_max);
+    }
+
+    /// @brief Scripted pose at the end of a step of the given length (the
+    /// queued poses come before the source).
+    /// @returns False if the body has no scripted pose for the step.
+    bool next_kinematic_pose(double timestep, PoseD& pose) const
+    {
+        if (kinematic_poses.size()) {
+            pose = kinematic_poses.front();
+            return true;
+        }
+        return kinematic_source != nullptr
+            && kinematic_source->pose(kinematic_time + timestep, pose);
+    }
+
+    /// @brief Consume the scripted pose of a step.
+    void pop_kinematic_pose(double timestep)
+    {
+        if (kinematic_poses.size()) {
+            kinematic_poses.pop_front();
+        }
+        kinematic_time += timestep;
+    }
+
     // --------------------------------------------------------------------
-    // Properties
+    // Hot state
     // --------------------------------------------------------------------
+    // Read or written by every time step, energy evaluation, and pose
+    // gather, so it is kept together at the front of the body and the cold
+    // data below stays out of those loops' cache lines.
 
-    std::string name = "RigidBody";
+    /// @brief current timestep position and rotation of the center of mass
+    PoseD pose;
+    /// @brief previous timestep position and rotation of the center of mass
+    PoseD pose_prev;
 
-    /// @brief Group id of this body
-    int group_id;
+    /// @brief current timestep velocity of the center of mass
+    PoseD velocity;
+    /// @brief previous timestep velocity of the center of mass
+    PoseD velocity_prev;
+
+    /// @brief external force acting on the body
+    PoseD force;
+
+    PoseD acceleration;
+    Eigen::Matrix3d Qdot;
+    Eigen::Matrix3d Qddot;
 
     /// @brief Dyanmic type of rigid body
     RigidBodyType type;
 
-    // --------------------------------------------------------------------
-    // Geometry
-    // --------------------------------------------------------------------
-    Eigen::MatrixXd vertices; ///< Vertices positions in body space
-    Eigen::MatrixXi edges;    ///< Vertices connectivity
-    Eigen::MatrixXi faces;    ///< Vertices connectivity
-
-    double average_edge_length; ///< Average edge length
+    /// @brief Flag to indicate if dof is fixed (doesnt' change)
+    VectorMax6b is_dof_fixed;
 
     /// @brief total mass (M) of the rigid body
     double mass;
     /// @brief moment of inertia measured with respect to the principal axes
     VectorMax3d moment_of_inertia;
-    /// @brief rotation from the principal axes to the input orientation
-    MatrixMax3d R0;
-    /// @brief maximum distance from CM to a vertex
-    double r_max;
     /// @brief the mass matrix of the rigid body
     DiagonalMatrixMax6d mass_matrix;
+    /// @brief maximum distance from CM to a vertex
+    double r_max;
 
-    /// @brief Flag to indicate if dof is fixed (doesnt' change)
-    VectorMax6b is_dof_fixed;
+    // --------------------------------------------------------------------
+    // Properties
+    // --------------------------------------------------------------------
+
+    std::string name = "RigidBody";
+
+    /// @brief Group id of this body
+    int group_id;
+
+    /// @brief rotation from the principal axes to the input orientation
+    MatrixMax3d R0;
 
     /// @brief Use edge orientation for normal in 2D restitution
     bool is_oriented;
 
-    /// @brief Local space BVH initalized at construction
-    BVH::BVH bvh;
-    MeshSelector mesh_selector;
+    /// @brief Is the body convex? Distances between convex bodies are bounded
+    /// with GJK before their primitives are checked.
+    bool is_convex;
 
     // --------------------------------------------------------------------
-    // State
+    // Geometry
     // --------------------------------------------------------------------
-    /// @brief current timestep position and rotation of the center of mass
-    PoseD pose;
-    /// @brief previous timestep position and rotation of the center of mass
-    PoseD pose_prev;
+    Eigen::MatrixXd vertices; ///< Vertices positions in body space
+    Eigen::MatrixXi edges;    ///< Vertices connectivity
+    Eigen::MatrixXi faces;    ///< Vertices connectivity
 
-    /// @brief current timestep velocity of the center of mass
-    PoseD velocity;
-    /// @brief previous timestep velocity of the center of mass
-    PoseD velocity_prev;
-    Eigen::Matrix3d Qdot;
+    double average_edge_length; ///< Average edge length
 
-    PoseD acceleration;
-    Eigen::Matrix3d Qddot;
+    /// @brief Optional body space distance field used to cull candidates
+    /// against other bodies' primitives (null if not built).
+    std::shared_ptr<const SparseDistanceField> distance_field;
 
-    /// @brief external force acting on the body
-    PoseD force;
+    /// @brief Geometry shared with all bodies using the same mesh
+    std::shared_ptr<const RigidBodyGeometry> geometry;
+    /// @brief Local space BVH initalized at construction
+    const BVH::BVH& bvh() const { return geometry->bvh; }
+    /// @brief Local space BVH topology for dual traversals
+    const PrimitiveBVH& primitive_bvh() const
+    {
+        return geometry->primitive_bvh;
+    }
+    const MeshSelector& mesh_selector() const
+    {
+        return geometry->mesh_selector;
+    }
+
+    // --------------------------------------------------------------------
+    // Sleeping and multi-rate state
+    // --------------------------------------------------------------------
+    /// @brief Is the body asleep (temporarily static)?
+    bool is_sleeping = false;
+    /// @brief Consecutive steps the body has been at rest
+    int num_resting_steps = 0;
+    /// @brief Fixed DoF to restore when the body wakes up
+    VectorMax6b awake_is_dof_fixed;
+    /// @brief Is the body held fixed for a stage of a multi-rate step?
+    bool is_frozen = false;
+    /// @brief Type, fixed DoF, and velocity to restore when thawed
+    RigidBodyType frozen_type;
+    VectorMax6b frozen_is_dof_fixed;
+    PoseD frozen_velocity;
 
     // --------------------------------------------------------------------
     // Scripted kinematic motion
     // --------------------------------------------------------------------
     double kinematic_max_time;
     std::deque<PoseD> kinematic_poses;
-
-protected:
-    void init_bvh();
+    /// @brief Streamed scripted motion used once the queued poses run out.
+    std::shared_ptr<const KinematicSource> kinematic_source;
+    /// @brief Time of the scripted motion at the start of the current step.
+    double kinematic_time = 0;
 };
 
 } // namespace ipc::rigid
@@ -1,21 +1,45 @@
 #include "rigid_body_assembler.hpp"
 
+#include <algorithm>
+#include <chrono>
+#include <unordered_set>
+
 #include <Eigen/Geometry>
 #include <finitediff.hpp>
 #include <igl/PI.h>
 #include <ipc/broad_phase/hash_grid.hpp>
 #include <ipc/distance/edge_edge.hpp>
+#include <tbb/parallel_for.h>
 #include <tbb/parallel_sort.h>
 
+#include <ccd/ccd.hpp>
+#include <constants.hpp>
 #include <logger.hpp>
 #include <physics/mass.hpp>
 #include <profiler.hpp>
 #include <utils/eigen_ext.hpp>
 #include <utils/flatten.hpp>
+#include <utils/memory_usage.hpp>
 #include <utils/not_implemented_error.hpp>
+#include <utils/numa.hpp>
+#include <utils/step_metrics.hpp>
 
 namespace ipc::rigid {
 
+namespace {
+    /// @brief Remove count rows starting at first, shifting the rest up.
+    template <typename Derived>
+    void erase_rows(
+        Eigen::PlainObjectBase<Derived>& matrix, long first, long count)
+    {
+        const long num_rows = matrix.rows() - count;
+        for (long i = first; i < num_rows; i++) {
+            matrix.row(i) = matrix.row(i + count);
+        }
+        matrix.conservativeResize(num_rows, matrix.cols());
+    }
+} // namespace
+
 void RigidBodyAssembler::init(const std::vector<RigidBody>& rigid_bodies)
 {
     m_rbs = rigid_bodies;
@@ -34,72 +58,101 @@ void RigidBodyAssembler::init(const std::vector<RigidBody>& rigid_bodies)
         m_body_edge_id[i + 1] = m_body_edge_id[i] + rb.edges.rows();
     }
 
-    // global edges and faces
+    // Offsets of each body's codimensional edges
+    std::vector<size_t> body_codim_edge_id(num_bodies + 1, 0);
+    for (size_t i = 0; i < num_bodies; ++i) {
+        body_codim_edge_id[i + 1] = body_codim_edge_id[i]
+            + rigid_bodies[i].mesh_selector().codim_edges_to_edges().size();
+    }
+
+    int rb_ndof = num_bodies ? rigid_bodies[0].ndof() : 0;
     m_edges.resize(m_body_edge_id.back(), 2);
     m_faces.resize(m_body_face_id.back(), 3);
     m_faces_to_edges.resize(m_body_face_id.back(), 3);
-    m_codim_edges_to_edges.clear();
-    for (size_t i = 0; i < num_bodies; ++i) {
-        auto& rb = rigid_bodies[i];
-        if (rb.edges.size() != 0) {
-            m_edges.block(m_body_edge_id[i], 0, rb.edges.rows(), 2) =
-                rb.edges.array() + m_body_vertex_id[i];
-        }
-        if (rb.faces.size() != 0) {
-            m_faces.block(m_body_face_id[i], 0, rb.faces.rows(), 3) =
-                rb.faces.array() + m_body_vertex_id[i];
-            m_faces_to_edges.block(m_body_face_id[i], 0, rb.faces.rows(), 3) =
-                rb.mesh_selector.face_to_edges().array() + m_body_edge_id[i];
-        }
-        for (const auto& ei : rb.mesh_selector.codim_edges_to_edges()) {
-            m_codim_edges_to_edges.push_back(ei + m_body_edge_id[i]);
-        }
-    }
-    // vertex to body map
+    m_codim_edges_to_edges.resize(body_codim_edge_id.back());
     m_vertex_to_body_map.resize(num_vertices());
-    for (size_t i = 0; i < num_bodies; ++i) {
-        auto& rb = rigid_bodies[i];
-        m_vertex_to_body_map.segment(m_body_vertex_id[i], rb.num_vertices())
-            .setConstant(int(i));
-    }
-    // vertex to group id map
     m_vertex_group_ids.resize(num_vertices());
-    for (size_t i = 0; i < num_bodies; ++i) {
-        auto& rb = rigid_bodies[i];
-        m_vertex_group_ids.segment(m_body_vertex_id[i], rb.num_vertices())
-            .setConstant(rb.group_id);
-    }
-
-    // rigid body mass-matrix
-    int rb_ndof = num_bodies ? rigid_bodies[0].ndof() : 0;
+    m_body_group_ids.resize(num_bodies);
     m_rb_mass_matrix.resize(num_bodies * rb_ndof);
-    for (int i = 0; i < int(num_bodies); ++i) {
-        m_rb_mass_matrix.diagonal().segment(i * rb_ndof, rb_ndof) =
-            rigid_bodies[i].mass_matrix.diagonal();
-    }
-
-    // rigid_body dof_fixed flag
     is_rb_dof_fixed.resize(num_bodies * rb_ndof);
-    for (int i = 0; i < int(num_bodies); ++i) {
-        auto& rb = rigid_bodies[size_t(i)];
-        is_rb_dof_fixed.segment(rb_ndof * i, rb_ndof) = rb.is_dof_fixed;
-    }
-
-    // rigid_body vertex dof_fixed flag
     is_dof_fixed.resize(num_vertices(), rb_ndof);
-    for (size_t i = 0; i < num_bodies; ++i) {
-        auto& rb = rigid_bodies[i];
-        is_dof_fixed.block(m_body_vertex_id[i], 0, rb.num_vertices(), rb_ndof) =
-            rb.is_dof_fixed.transpose().replicate(rb.num_vertices(), 1);
+
+    // Each body writes to its own disjoint blocks of the global arrays (which
+    // also first touches their pages in parallel).
+    tbb::parallel_for(size_t(0), num_bodies, [&](size_t i) {
+        assemble_body(i, body_codim_edge_id[i]);
+    });
+    update_dof_fixed();
+    m_static_world.init(
+        m_rbs, m_body_vertex_id, m_body_edge_id, m_body_face_id);
+    record_memory_usage();
+
+    update_body_statistics();
+}
+
+void RigidBodyAssembler::assemble_body(size_t i, size_t codim_edge_id)
+{
+    const RigidBody& rb = m_rbs[i];
+    const int rb_ndof = rb.ndof();
+
+    // global edges and faces
+    if (rb.edges.size() != 0) {
+        m_edges.block(m_body_edge_id[i], 0, rb.edges.rows(), 2) =
+            rb.edges.array() + m_body_vertex_id[i];
     }
+    if (rb.faces.size() != 0) {
+        m_faces.block(m_body_face_id[i], 0, rb.faces.rows(), 3) =
+            rb.faces.array() + m_body_vertex_id[i];
+        m_faces_to_edges.block(m_body_face_id[i], 0, rb.faces.rows(), 3) =
+            rb.mesh_selector().face_to_edges().array() + m_body_edge_id[i];
+    }
+    const auto& codim_edges = rb.mesh_selector().codim_edges_to_edges();
+    for (size_t j = 0; j < codim_edges.size(); j++) {
+        m_codim_edges_to_edges[codim_edge_id + j] =
+            codim_edges[j] + m_body_edge_id[i];
+    }
+
+    // vertex to body and group id maps
+    m_vertex_to_body_map.segment(m_body_vertex_id[i], rb.num_vertices())
+        .setConstant(int(i));
+    m_vertex_group_ids.segment(m_body_vertex_id[i], rb.num_vertices())
+        .setConstant(rb.group_id);
+    m_body_group_ids[i] = rb.group_id;
+
+    // rigid body mass-matrix
+    m_rb_mass_matrix.diagonal().segment(i * rb_ndof, rb_ndof) =
+        rb.mass_matrix.diagonal();
+}
+
+void RigidBodyAssembler::update_body_statistics()
+{
+    const size_t num_bodies = m_rbs.size();
 
     average_edge_length = 0;
-    for (const auto& body : rigid_bodies) {
+    for (const auto& body : m_rbs) {
         average_edge_length += body.edges.rows() * body.average_edge_length;
     }
     average_edge_length /= m_edges.rows();
     assert(std::isfinite(average_edge_length));
 
+    // Local feature size of each body relative to the coarsest body
+    double max_edge_length = 0;
+    for (const auto& body : m_rbs) {
+        if (body.edges.rows() && std::isfinite(body.average_edge_length)) {
+            max_edge_length =
+                std::max(max_edge_length, body.average_edge_length);
+        }
+    }
+    m_activation_distance_scales.assign(num_bodies, 1.0);
+    for (size_t i = 0; i < num_bodies && max_edge_length > 0; i++) {
+        const double edge_length = m_rbs[i].average_edge_length;
+        if (m_rbs[i].edges.rows() && std::isfinite(edge_length)) {
+            m_activation_distance_scales[i] = std::max(
+                edge_length / max_edge_length,
+                Constants::MIN_ACTIVATION_DISTANCE_SCALE);
+        }
+    }
+
     average_mass = 0;
     int num_free_dof = 0;
     for (int i = 0; i < is_rb_dof_fixed.size(); i++) {
@@ -113,6 +166,204 @@ void RigidBodyAssembler::init(const std::vector<RigidBody>& rigid_bodies)
     }
 }
 
+void RigidBodyAssembler::add_body(const RigidBody& rb)
+{
+    assert(num_bodies() == 0 || rb.dim() == dim());
+    const size_t i = num_bodies();
+    const int rb_ndof = rb.ndof();
+    m_rbs.push_back(rb);
+
+    m_body_vertex_id.push_back(m_body_vertex_id.back() + rb.num_vertices());
+    m_body_edge_id.push_back(m_body_edge_id.back() + rb.edges.rows());
+    m_body_face_id.push_back(m_body_face_id.back() + rb.faces.rows());
+
+    // The new body's blocks go at the end of the global arrays, so the
+    // existing entries only move if the arrays are reallocated.
+    const size_t codim_edge_id = m_codim_edges_to_edges.size();
+    m_edges.conservativeResize(num_edges(), 2);
+    m_faces.conservativeResize(num_faces(), 3);
+    m_faces_to_edges.conservativeResize(num_faces(), 3);
+    m_codim_edges_to_edges.resize(
+        codim_edge_id + rb.mesh_selector().codim_edges_to_edges().size());
+    m_vertex_to_body_map.conservativeResize(num_vertices());
+    m_vertex_group_ids.conservativeResize(num_vertices());
+    m_body_group_ids.push_back(rb.group_id);
+    m_rb_mass_matrix.diagonal().conservativeResize((i + 1) * rb_ndof);
+    is_rb_dof_fixed.conservativeResize((i + 1) * rb_ndof);
+    is_dof_fixed.conservativeResize(num_vertices(), rb_ndof);
+    m_body_collision_masks.push_back(0);
+    assemble_body(i, codim_edge_id);
+    update_body_dof_fixed(i);
+
+    if (rb.type == RigidBodyType::STATIC && !rb.is_sleeping) {
+        // The merged mesh changes (or the body count reached the minimum)
+        m_static_world.init(
+            m_rbs, m_body_vertex_id, m_body_edge_id, m_body_face_id);
+    } else {
+        m_static_world.add_body();
+    }
+
+    // Only insert into a tree that is in use (else it is built on demand)
+    if (m_body_tree.num_leaves() == i && i > 0) {
+        VectorMax3d min, max;
+        rb.compute_bounding_box(rb.pose_prev, rb.pose, min, max);
+        Eigen::Vector3d min3D = Eigen::Vector3d::Zero(),
+                        max3D = Eigen::Vector3d::Zero();
+        min3D.head(dim()) = min;
+        max3D.head(dim()) = max;
+        m_body_tree.insert({ { min3D, max3D } });
+    }
+
+    update_body_statistics();
+    record_memory_usage();
+}
+
+void RigidBodyAssembler::remove_body(size_t i)
+{
+    assert(i < num_bodies());
+    const RigidBody& rb = m_rbs[i];
+    const int rb_ndof = rb.ndof();
+    const long vertex_id = m_body_vertex_id[i], edge_id = m_body_edge_id[i],
+               face_id = m_body_face_id[i];
+    const long nv = rb.num_vertices(), ne = rb.edges.rows(),
+               nf = rb.faces.rows();
+
+    // Remove the body's blocks and re-index the primitives of the bodies
+    // after it (no mesh is re-assembled).
+    erase_rows(m_edges, edge_id, ne);
+    m_edges.bottomRows(m_edges.rows() - edge_id).array() -= int(nv);
+    erase_rows(m_faces, face_id, nf);
+    m_faces.bottomRows(m_faces.rows() - face_id).array() -= int(nv);
+    erase_rows(m_faces_to_edges, face_id, nf);
+    m_faces_to_edges.bottomRows(m_faces_to_edges.rows() - face_id).array() -=
+        int(ne);
+
+    // The codimensional edges are grouped by body
+    const auto codim_begin = std::partition_point(
+        m_codim_edges_to_edges.begin(), m_codim_edges_to_edges.end(),
+        [&](size_t ei) { return long(ei) < edge_id; });
+    const auto codim_end = std::partition_point(
+        codim_begin, m_codim_edges_to_edges.end(),
+        [&](size_t ei) { return long(ei) < edge_id + ne; });
+    for (auto it = m_codim_edges_to_edges.erase(codim_begin, codim_end);
+         it != m_codim_edges_to_edges.end(); ++it) {
+        *it -= ne;
+    }
+
+    erase_rows(m_vertex_to_body_map, vertex_id, nv);
+    m_vertex_to_body_map.tail(m_vertex_to_body_map.size() - vertex_id)
+        .array() -= 1;
+    erase_rows(m_vertex_group_ids, vertex_id, nv);
+    erase_rows(is_dof_fixed, vertex_id, nv);
+    erase_rows(m_rb_mass_matrix.diagonal(), i * rb_ndof, rb_ndof);
+    erase_rows(is_rb_dof_fixed, i * rb_ndof, rb_ndof);
+    m_body_group_ids.erase(m_body_group_ids.begin() + i);
+    m_body_collision_masks.erase(m_body_collision_masks.begin() + i);
+
+    for (size_t j = i + 1; j < m_body_vertex_id.size(); j++) {
+        m_body_vertex_id[j - 1] = m_body_vertex_id[j] - nv;
+        m_body_edge_id[j - 1] = m_body_edge_id[j] - ne;
+        m_body_face_id[j - 1] = m_body_face_id[j] - nf;
+    }
+    m_body_vertex_id.pop_back();
+    m_body_edge_id.pop_back();
+    m_body_face_id.pop_back();
+
+    const bool is_merged = m_static_world.contains(i);
+    if (!is_merged) {
+        m_static_world.remove_body(i, rb, vertex_id, edge_id, face_id);
+    }
+    if (m_body_tree.num_leaves() == num_bodies()) {
+        m_body_tree.remove(int(i));
+    }
+    m_rbs.erase(m_rbs.begin() + i);
+    if (is_merged) {
+        m_static_world.init(
+            m_rbs, m_body_vertex_id, m_body_edge_id, m_body_face_id);
+    }
+
+    update_body_statistics();
+    record_memory_usage();
+}
+
+void RigidBodyAssembler::record_memory_usage() const
+{
+    typedef MemoryUsage MU;
+    size_t mesh_bytes = MU::bytes_of(m_edges) + MU::bytes_of(m_faces)
+        + MU::bytes_of(m_faces_to_edges) + MU::bytes_of(m_codim_edges_to_edges)
+        + MU::bytes_of(m_vertex_to_body_map) + MU::bytes_of(m_vertex_group_ids)
+        + MU::bytes_of(is_dof_fixed);
+    size_t bvh_bytes = 0;
+    // Geometries and distance fields are shared by bodies of the same mesh
+    std::unordered_set<const void*> counted;
+    for (const RigidBody& body : m_rbs) {
+        mesh_bytes += MU::bytes_of(body.vertices) + MU::bytes_of(body.edges)
+            + MU::bytes_of(body.faces);
+        if (body.geometry != nullptr
+            && counted.insert(body.geometry.get()).second) {
+            const RigidBodyGeometry& geometry = *body.geometry;
+            mesh_bytes += MU::bytes_of(geometry.input_vertices)
+                + MU::bytes_of(geometry.vertices) + MU::bytes_of(geometry.edges)
+                + MU::bytes_of(geometry.faces);
+            // The complete tree stores about four boxes per leaf
+            bvh_bytes += 4 * body.bvh_size()
+                * (sizeof(std::array<Eigen::Vector3d, 2>) + sizeof(int));
+        }
+        if (body.distance_field != nullptr
+            && counted.insert(body.distance_field.get()).second) {
+            // Nodes of an unordered map (key, value, and next pointer)
+            mesh_bytes += body.distance_field->num_nodes()
+                * (sizeof(int64_t) + sizeof(double) + 2 * sizeof(void*));
+        }
+    }
+    if (!m_static_world.empty()) {
+        const RigidBodyGeometry& world = *m_static_world.geometry;
+        mesh_bytes += MU::bytes_of(world.input_vertices)
+            + MU::bytes_of(world.vertices) + MU::bytes_of(world.edges)
+            + MU::bytes_of(world.faces)
+            + sizeof(long)
+                * (m_static_world.vertex_ids.size()
+                   + m_static_world.edge_ids.size()
+                   + m_static_world.face_ids.size());
+        bvh_bytes += 4 * world.primitive_bvh.num_primitives()
+            * (sizeof(std::array<Eigen::Vector3d, 2>) + sizeof(int));
+    }
+    MU::set_bytes(MU::MESHES, mesh_bytes);
+    MU::set_bytes(MU::BVHS, bvh_bytes);
+}
+
+void RigidBodyAssembler::update_dof_fixed()
+{
+    m_body_collision_masks.resize(num_bodies());
+    tbb::parallel_for(size_t(0), num_bodies(), [&](size_t i) {
+        update_body_dof_fixed(i);
+    });
+}
+
+void RigidBodyAssembler::update_body_dof_fixed(size_t i)
+{
+    const auto& rb = m_rbs[i];
+    const int rb_ndof = rb.ndof();
+
+    // Body pairs sharing a bit are skipped by can_bodies_collide()
+    uint8_t mask = 0;
+    if (rb.type == RigidBodyType::STATIC) {
+        mask |= STATIC_BODY_BIT;
+    }
+    if (rb.type == RigidBodyType::KINEMATIC
+        || (rb.type == RigidBodyType::STATIC && !rb.is_sleeping)) {
+        mask |= SCRIPTED_BODY_BIT;
+    }
+    m_body_collision_masks[i] = mask;
+
+    // rigid_body dof_fixed flag
+    is_rb_dof_fixed.segment(rb_ndof * i, rb_ndof) = rb.is_dof_fixed;
+
+    // rigid_body vertex dof_fixed flag
+    is_dof_fixed.block(m_body_vertex_id[i], 0, rb.num_vertices(), rb_ndof) =
+        rb.is_dof_fixed.transpose().replicate(rb.num_vertices(), 1);
+}
+
 size_t RigidBodyAssembler::count_kinematic_bodies() const
 {
     size_t n = 0;
@@ -203,6 +454,29 @@ Eigen::MatrixXd RigidBodyAssembler::world_vertices_diff(
     Eigen::MatrixXd& hess,
     bool compute_jac,
     bool compute_hess) const
+{
+    return poses_world_vertices_diff(
+        poses, jac, hess, compute_jac, compute_hess);
+}
+
+Eigen::MatrixXd RigidBodyAssembler::world_vertices_diff(
+    const Eigen::VectorXd& dof,
+    Eigen::MatrixXd& jac,
+    Eigen::MatrixXd& hess,
+    bool compute_jac,
+    bool compute_hess) const
+{
+    return poses_world_vertices_diff(
+        PosesViewD(dof, dim()), jac, hess, compute_jac, compute_hess);
+}
+
+template <typename PosesT>
+Eigen::MatrixXd RigidBodyAssembler::poses_world_vertices_diff(
+    const PosesT& poses,
+    Eigen::MatrixXd& jac,
+    Eigen::MatrixXd& hess,
+    bool compute_jac,
+    bool compute_hess) const
 {
     assert(num_bodies() == poses.size());
 
@@ -210,10 +484,6 @@ Eigen::MatrixXd RigidBodyAssembler::world_vertices_diff(
         return world_vertices(poses);
     }
 
-    // We will only use auto diff to compute the derivatives of the rotation
-    // matrix.
-    typedef AutodiffType<Eigen::Dynamic, /*maxN=*/3> Diff;
-
     PROFILE_POINT("RigidBodyAssembler::world_vertices_diff");
     PROFILE_START();
 
@@ -224,34 +494,30 @@ Eigen::MatrixXd RigidBodyAssembler::world_vertices_diff(
     NAMED_PROFILE_POINT(
         "RigidBodyAssembler::world_vertices_diff:allocation", ALLOCATION);
     PROFILE_START(ALLOCATION);
-    if (compute_jac) {
+    // New buffers are first touched in parallel to spread their pages
+    if (compute_jac && (jac.rows() != n || jac.cols() != m)) {
         // ∇ V(x): Rᵐ ↦ Rⁿˣᵐ
         jac.resize(n, m);
+        parallel_first_touch(jac.data(), jac.size());
     }
-    if (compute_hess) {
+    if (compute_hess && (hess.rows() != n * m || hess.cols() != m)) {
         // ∇²V(x): Rᵐ ↦ Rⁿˣᵐˣᵐ
         hess.resize(n * m, m); // Store as (n * m) × m matrix
+        parallel_first_touch(hess.data(), hess.size());
     }
     Eigen::MatrixXd V(num_vertices(), dim());
     PROFILE_END(ALLOCATION);
 
-    tbb::parallel_for(
-        tbb::blocked_range<size_t>(size_t(0), num_bodies()),
-        [&](const tbb::blocked_range<size_t>& range) {
+    m_world_vertices_diff_loop.parallel_for(
+        num_bodies(), [&](const tbb::blocked_range<size_t>& range) {
             for (size_t rb_i = range.begin(); rb_i != range.end(); ++rb_i) {
                 const RigidBody& rb = m_rbs[rb_i];
 
                 // Index of rigid bodies first vertex in the global vertices
                 long rb_v0_i = m_body_vertex_id[rb_i];
 
-                if (compute_hess) {
-                    rb.world_vertices_diff<Diff::DDouble2>(
-                        poses[rb_i], rb_v0_i, V, jac, hess);
-                } else {
-                    assert(compute_jac);
-                    rb.world_vertices_diff<Diff::DDouble1>(
-                        poses[rb_i], rb_v0_i, V, jac, hess);
-                }
+                rb.world_vertices_diff(
+                    poses[rb_i], rb_v0_i, V, jac, hess, compute_hess);
             }
         });
 
@@ -262,29 +528,176 @@ Eigen::MatrixXd RigidBodyAssembler::world_vertices_diff(
 }
 
 std::vector<std::pair<int, int>> RigidBodyAssembler::close_bodies(
+    const PosesD& poses_t0,
+    const PosesD& poses_t1,
+    const double inflation_radius,
+    const bool include_static_world) const
+{
+    // Brute force is faster for a few bodies, but where the tree becomes
+    // faster depends on how the bodies are spread, so both are timed.
+    std::vector<std::pair<int, int>> body_pairs;
+    if (num_bodies() > Constants::CLOSE_BODIES_MAX_BRUTE_FORCE_BODIES) {
+        body_pairs = close_bodies_aabb_tree(
+            poses_t0, poses_t1, inflation_radius, include_static_world);
+    } else {
+        const int method = m_close_bodies_selector.select();
+        const auto start = std::chrono::steady_clock::now();
+        body_pairs = method == CLOSE_BODIES_BRUTE_FORCE
+            ? close_bodies_brute_force(
+                poses_t0, poses_t1, inflation_radius, include_static_world)
+            : close_bodies_aabb_tree(
+                poses_t0, poses_t1, inflation_radius, include_static_world);
+        m_close_bodies_selector.record(
+            method,
+            std::chrono::duration<double>(
+                std::chrono::steady_clock::now() - start)
+                .count());
+    }
+    remove_separated_sphere_pairs(
+        poses_t0, poses_t1, inflation_radius, body_pairs);
+    remove_separated_convex_pairs(
+        poses_t0, poses_t1, inflation_radius, body_pairs);
+    return body_pairs;
+}
+
+void RigidBodyAssembler::remove_separated_sphere_pairs(
+    const PosesD& poses_t0,
+    const PosesD& poses_t1,
+    const double inflation_radius,
+    std::vector<std::pair<int, int>>& body_pairs) const
+{
+    // Relative position d(t) = d₀ + t Δd of the centers of every pair (one
+    // pair per row, so the distances are computed column-wise)
+    const long n = body_pairs.size();
+    Eigen::ArrayX3d d0 = Eigen::ArrayX3d::Zero(n, 3);
+    Eigen::ArrayX3d delta = Eigen::ArrayX3d::Zero(n, 3);
+    Eigen::ArrayXd radii(n);
+    for (long i = 0; i < n; i++) {
+        const auto& [a, b] = body_pairs[i];
+        const VectorMax3d d_t0 = poses_t0[a].position - poses_t0[b].position;
+        const VectorMax3d d_t1 = poses_t1[a].position - poses_t1[b].position;
+        d0.row(i).head(dim()) = d_t0.transpose().array();
+        delta.row(i).head(dim()) = (d_t1 - d_t0).transpose().array();
+        radii(i) = m_rbs[a].r_max + m_rbs[b].r_max + 2 * inflation_radius;
+    }
+
+    // Closest approach over t ∈ [0, 1]
+    const Eigen::ArrayXd delta_sqnorm = delta.square().rowwise().sum();
+    const Eigen::ArrayXd t = (delta_sqnorm > 0)
+                                 .select(
+                                     -(d0 * delta).rowwise().sum()
+                                         / delta_sqnorm.max(1e-300),
+                                     0.0)
+                                 .max(0.0)
+                                 .min(1.0);
+    const Eigen::ArrayXd min_sqdistance =
+        (d0 + delta.colwise() * t).square().rowwise().sum();
+
+    long num_pairs = 0;
+    for (long i = 0; i < n; i++) {
+        if (min_sqdistance(i) <= radii(i) * radii(i)) {
+            body_pairs[num_pairs++] = body_pairs[i];
+        }
+    }
+    StepMetrics::add_count(
+        StepMetrics::BOUNDING_SPHERE_REJECTIONS, n - num_pairs);
+    body_pairs.resize(num_pairs);
+}
+
+void RigidBodyAssembler::remove_separated_convex_pairs(
+    const PosesD& poses_t0,
+    const PosesD& poses_t1,
+    const double inflation_radius,
+    std::vector<std::pair<int, int>>& body_pairs) const
+{
+    std::vector<char> is_separated(body_pairs.size(), false);
+    const auto check_pair = [&](size_t i) {
+        const RigidBody& bodyA = m_rbs[body_pairs[i].first];
+        const RigidBody& bodyB = m_rbs[body_pairs[i].second];
+        if (!bodyA.is_convex || !bodyB.is_convex) {
+            return;
+        }
+        const PoseD& poseA_t0 = poses_t0[body_pairs[i].first];
+        const PoseD& poseA_t1 = poses_t1[body_pairs[i].first];
+        const PoseD& poseB_t0 = poses_t0[body_pairs[i].second];
+        const PoseD& poseB_t1 = poses_t1[body_pairs[i].second];
+
+        const double tolerance = 1e-6 * (bodyA.r_max + bodyB.r_max);
+        const double distance_t0 = convex_distance_lower_bound(
+            bodyA.support_function(poseA_t0),
+            bodyB.support_function(poseB_t0), tolerance);
+        if (distance_t0 <= 2 * inflation_radius) {
+            return;
+        }
+        const double distance_t1 =
+            &poses_t0 == &poses_t1 ? distance_t0
+                                   : convex_distance_lower_bound(
+                                       bodyA.support_function(poseA_t1),
+                                       bodyB.support_function(poseB_t1),
+                                       tolerance);
+
+        // At time t the bodies moved at most x = t D from the t0 poses and
+        // D - x from the t1 poses, so the distance is at least
+        // max(d₀ - x, d₁ - D + x) which is smallest where the two meet.
+        const double D =
+            max_trajectory_displacement(poseA_t0, poseA_t1, bodyA.r_max)
+            + max_trajectory_displacement(poseB_t0, poseB_t1, bodyB.r_max);
+        const double x =
+            std::clamp((distance_t0 - distance_t1 + D) / 2, 0.0, D);
+        is_separated[i] = std::max(distance_t0 - x, distance_t1 - D + x)
+            > 2 * inflation_radius;
+    };
+    // The pairs of non-convex bodies are skipped, so the cost per pair
+    // depends on the scene
+    m_convex_pairs_loop.parallel_for(
+        body_pairs.size(), [&](const tbb::blocked_range<size_t>& range) {
+            for (size_t i = range.begin(); i != range.end(); ++i) {
+                check_pair(i);
+            }
+        });
+
+    size_t num_pairs = 0;
+    for (size_t i = 0; i < body_pairs.size(); i++) {
+        if (!is_separated[i]) {
+            body_pairs[num_pairs++] = body_pairs[i];
+        }
+    }
+    body_pairs.resize(num_pairs);
+}
+
+std::vector<std::array<Eigen::Vector3d, 2>>
+RigidBodyAssembler::body_swept_bounding_boxes(
     const PosesD& poses_t0,
     const PosesD& poses_t1,
     const double inflation_radius) const
 {
-    // if (num_bodies() < 10) {
-    //     return close_bodies_brute_force(
-    //         poses_t0, poses_t1, inflation_radius);
-    // }
-    //
-    // return close_bodies_hash_grid(poses_t0, poses_t1, inflation_radius);
-    return close_bodies_bvh(poses_t0, poses_t1, inflation_radius);
+    std::vector<std::array<Eigen::Vector3d, 2>> body_bounding_boxes;
+    body_bounding_boxes.reserve(num_bodies());
+    for (int i = 0; i < num_bodies(); i++) {
+        VectorMax3d min, max;
+        m_rbs[i].compute_bounding_box(poses_t0[i], poses_t1[i], min, max);
+        min.array() -= inflation_radius;
+        max.array() += inflation_radius;
+        Eigen::Vector3d min3D = Eigen::Vector3d::Zero(),
+                        max3D = Eigen::Vector3d::Zero();
+        min3D.head(dim()) = min;
+        max3D.head(dim()) = max;
+        body_bounding_boxes.push_back({ { min3D, max3D } });
+    }
+    return body_bounding_boxes;
 }
 
 std::vector<std::pair<int, int>> RigidBodyAssembler::close_bodies_brute_force(
     const PosesD& poses_t0,
     const PosesD& poses_t1,
-    const double inflation_radius) const
+    const double inflation_radius,
+    const bool include_static_world) const
 {
     std::vector<std::pair<int, int>> close_body_pairs;
     for (int i = 0; i < num_bodies(); i++) {
         double ri = m_rbs[i].r_max;
         for (int j = i + 1; j < num_bodies(); j++) {
-            if (m_rbs[i].group_id == m_rbs[j].group_id) {
+            if (!are_bodies_paired(i, j, include_static_world)) {
                 continue;
             }
 
@@ -292,7 +705,8 @@ std::vector<std::pair<int, int>> RigidBodyAssembler::close_bodies_brute_force(
             double distance = sqrt(edge_edge_distance(
                 poses_t0[i].position, poses_t1[i].position,
                 poses_t0[j].position, poses_t1[j].position));
-            if (distance <= ri + rj + inflation_radius) {
+            // Like the body boxes, each body is inflated by the radius
+            if (distance <= ri + rj + 2 * inflation_radius) {
                 close_body_pairs.emplace_back(i, j);
             }
         }
@@ -305,23 +719,11 @@ std::vector<std::pair<int, int>> RigidBodyAssembler::close_bodies_bvh(
     const PosesD& poses_t1,
     const double inflation_radius) const
 {
-    std::vector<std::array<Eigen::Vector3d, 2>> body_bounding_boxes;
-    body_bounding_boxes.reserve(num_bodies());
-
     NAMED_PROFILE_POINT("RigidBodyAssembler::close_bodies_bvh:build", BUILD);
     PROFILE_START(BUILD);
 
-    for (int i = 0; i < num_bodies(); i++) {
-        VectorMax3d min, max;
-        m_rbs[i].compute_bounding_box(poses_t0[i], poses_t1[i], min, max);
-        min.array() -= inflation_radius;
-        max.array() += inflation_radius;
-        Eigen::Vector3d min3D = Eigen::Vector3d::Zero(),
-                        max3D = Eigen::Vector3d::Zero();
-        min3D.head(dim()) = min;
-        max3D.head(dim()) = max;
-        body_bounding_boxes.push_back({ { min3D, max3D } });
-    }
+    std::vector<std::array<Eigen::Vector3d, 2>> body_bounding_boxes =
+        body_swept_bounding_boxes(poses_t0, poses_t1, inflation_radius);
 
     BVH::BVH bvh;
     bvh.init(body_bounding_boxes);
@@ -338,7 +740,7 @@ std::vector<std::pair<int, int>> RigidBodyAssembler::close_bodies_bvh(
             body_bounding_boxes[i][0], body_bounding_boxes[i][1],
             intersecting_body_ids);
         for (const auto& j : intersecting_body_ids) {
-            if (i < j && m_rbs[i].group_id != m_rbs[j].group_id) {
+            if (i < j && can_bodies_collide(i, j)) {
                 close_body_pairs.emplace_back(i, j);
             }
         }
@@ -351,6 +753,29 @@ std::vector<std::pair<int, int>> RigidBodyAssembler::close_bodies_bvh(
     return close_body_pairs;
 }
 
+std::vector<std::pair<int, int>> RigidBodyAssembler::close_bodies_aabb_tree(
+    const PosesD& poses_t0,
+    const PosesD& poses_t1,
+    const double inflation_radius,
+    const bool include_static_world) const
+{
+    NAMED_PROFILE_POINT("RigidBodyAssembler::close_bodies_aabb_tree", QUERY);
+    PROFILE_START(QUERY);
+
+    std::vector<std::pair<int, int>> close_body_pairs =
+        m_body_tree.update_and_find_overlapping_pairs(
+            body_swept_bounding_boxes(poses_t0, poses_t1, inflation_radius),
+            [&](int i, int j) {
+                return are_bodies_paired(i, j, include_static_world);
+            });
+
+    PROFILE_END(QUERY);
+    PROFILE_MESSAGE(
+        QUERY, "num_pairs", fmt::format("{:d}", close_body_pairs.size()));
+
+    return close_body_pairs;
+}
+
 std::vector<std::pair<int, int>> RigidBodyAssembler::close_bodies_hash_grid(
     const PosesD& poses_t0,
     const PosesD& poses_t1,
@@ -391,8 +816,11 @@ std::vector<std::pair<int, int>> RigidBodyAssembler::close_bodies_hash_grid(
     std::vector<std::pair<int, int>> close_body_pairs;
     close_body_pairs.reserve(body_candidates.size());
     for (const auto& body_candidate : body_candidates) {
-        close_body_pairs.emplace_back(
-            body_candidate.edge0_index, body_candidate.edge1_index);
+        if (can_bodies_collide(
+                body_candidate.edge0_index, body_candidate.edge1_index)) {
+            close_body_pairs.emplace_back(
+                body_candidate.edge0_index, body_candidate.edge1_index);
+        }
     }
 
     return close_body_pairs;
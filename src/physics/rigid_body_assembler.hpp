@@ -1,13 +1,19 @@
 #pragma once
 
+#include <algorithm>
+#include <cstdint>
 #include <vector>
 
 #include <Eigen/Core>
 #include <Eigen/Sparse>
 
 #include <autodiff/autodiff_types.hpp>
+#include <physics/body_aabb_tree.hpp>
 #include <physics/rigid_body.hpp>
+#include <physics/static_world.hpp>
+#include <utils/cost_based_selector.hpp>
 #include <utils/eigen_ext.hpp>
+#include <utils/parallel_loop_tuner.hpp>
 
 namespace ipc::rigid {
 
@@ -19,6 +25,17 @@ public:
     /// @brief inits assembler to use this set of rigid-bodies
     void init(const std::vector<RigidBody>& rbs);
 
+    /// @brief Append a body without re-assembling the other bodies.
+    ///
+    /// Its vertices, edges, and faces get the last global ids.
+    void add_body(const RigidBody& rb);
+
+    /// @brief Remove the ith body without re-assembling the other bodies.
+    ///
+    /// The ids of the bodies after it (and of their vertices, edges, and
+    /// faces) shift down.
+    void remove_body(size_t i);
+
     // World Vertices Functions
     // --------------------------------------------------------------------
 
@@ -27,11 +44,20 @@ public:
         const std::vector<MatrixMax3<T>>& rotations,
         const std::vector<VectorMax3<T>>& positions) const;
     template <typename T>
-    MatrixX<T> world_vertices(const Poses<T>& poses) const;
+    MatrixX<T> world_vertices(const Poses<T>& poses) const
+    {
+        return poses_world_vertices<T>(poses);
+    }
+    template <typename T>
+    MatrixX<T> world_vertices(const PosesView<T>& poses) const
+    {
+        return poses_world_vertices<T>(poses);
+    }
+    /// @brief World vertices read from the poses in the dofs (no copy).
     template <typename T>
     MatrixX<T> world_vertices(const VectorX<T>& dofs) const
     {
-        return world_vertices(Pose<T>::dofs_to_poses(dofs, dim()));
+        return world_vertices(PosesView<T>(dofs, dim()));
     }
 
     Eigen::MatrixXd
@@ -79,12 +105,7 @@ public:
         Eigen::MatrixXd& jac,
         Eigen::MatrixXd& hess,
         bool compute_jac,
-        bool compute_hess) const
-    {
-        return world_vertices_diff(
-            PoseD::dofs_to_poses(dof, dim()), jac, hess, compute_jac,
-            compute_hess);
-    }
+        bool compute_hess) const;
 
     void global_to_local_vertex(
         const long global_vertex_id,
@@ -145,16 +166,40 @@ public:
 
     const Eigen::VectorXi& group_ids() const { return m_vertex_group_ids; }
 
+    /// @brief Update the fixed DoF flags and collision masks after bodies
+    /// changed type (e.g., fell asleep or woke up).
+    void update_dof_fixed();
+
+    /// @brief Report the bytes of the meshes and BVHs to MemoryUsage.
+    void record_memory_usage() const;
+
+    /// @brief Can the two bodies collide (different groups, not both static,
+    /// and not both scripted)?
+    ///
+    /// Scripted bodies are kinematic or static but not sleeping, so their
+    /// motion never responds to a contact between them.
+    bool can_bodies_collide(int i, int j) const
+    {
+        return m_body_group_ids[i] != m_body_group_ids[j]
+            && (m_body_collision_masks[i] & m_body_collision_masks[j]) == 0;
+    }
+
     /// Get a vector of body ids where each body is close to at least one
-    /// other body.
+    /// other body (found by brute force or with the body tree, whichever was
+    /// measured cheaper).
+    ///
+    /// If include_static_world is false, pairs with a body merged in the
+    /// static world are skipped (they are found by querying m_static_world).
     std::vector<std::pair<int, int>> close_bodies(
         const PosesD& poses_t0,
         const PosesD& poses_t1,
-        const double inflation_radius) const;
+        const double inflation_radius,
+        const bool include_static_world = true) const;
     std::vector<std::pair<int, int>> close_bodies_brute_force(
         const PosesD& poses_t0,
         const PosesD& poses_t1,
-        const double inflation_radius) const;
+        const double inflation_radius,
+        const bool include_static_world = true) const;
     std::vector<std::pair<int, int>> close_bodies_bvh(
         const PosesD& poses_t0,
         const PosesD& poses_t1,
@@ -163,6 +208,35 @@ public:
         const PosesD& poses_t0,
         const PosesD& poses_t1,
         const double inflation_radius) const;
+    /// Remove the pairs of bodies whose bounding spheres (of radius r_max
+    /// around the linearly moving centers) stay farther apart than twice the
+    /// inflation radius.
+    void remove_separated_sphere_pairs(
+        const PosesD& poses_t0,
+        const PosesD& poses_t1,
+        const double inflation_radius,
+        std::vector<std::pair<int, int>>& body_pairs) const;
+    /// Remove the pairs of convex bodies whose distance (bounded with GJK at
+    /// both poses) stays larger than twice the inflation radius.
+    void remove_separated_convex_pairs(
+        const PosesD& poses_t0,
+        const PosesD& poses_t1,
+        const double inflation_radius,
+        std::vector<std::pair<int, int>>& body_pairs) const;
+    /// Find close bodies using a persistent body tree that is refit (rather
+    /// than rebuilt) between calls.
+    std::vector<std::pair<int, int>> close_bodies_aabb_tree(
+        const PosesD& poses_t0,
+        const PosesD& poses_t1,
+        const double inflation_radius,
+        const bool include_static_world = true) const;
+
+    /// Inflated bounding boxes (padded to 3D) of each body swept between
+    /// two poses.
+    std::vector<std::array<Eigen::Vector3d, 2>> body_swept_bounding_boxes(
+        const PosesD& poses_t0,
+        const PosesD& poses_t1,
+        const double inflation_radius) const;
 
     /// Get the ith rigid body
     const RigidBody& operator[](size_t i) const { return m_rbs[i]; }
@@ -183,6 +257,24 @@ public:
     /// @brief average value of mass matrix diagonal (including inertia)
     double average_mass;
 
+    /// @brief Scale of d̂ of each body pair, the smaller local feature size
+    /// (average edge length) of the two bodies relative to the coarsest body.
+    double activation_distance_scale(long body0, long body1) const
+    {
+        return std::min(
+            m_activation_distance_scales[body0],
+            m_activation_distance_scales[body1]);
+    }
+    /// @brief Smallest scale of d̂ of any body.
+    double min_activation_distance_scale() const
+    {
+        return m_activation_distance_scales.empty()
+            ? 1.0
+            : *std::min_element(
+                m_activation_distance_scales.begin(),
+                m_activation_distance_scales.end());
+    }
+
     /// @brief indexes for vertices
     Eigen::VectorXi m_vertex_to_body_map;
 
@@ -207,9 +299,77 @@ public:
     /// @brief flag for vertices degrees of freedom (used for visualization)
     MatrixXb is_dof_fixed;
 
+    /// @brief Static bodies merged into one world space mesh (empty if there
+    /// are too few of them)
+    StaticWorld m_static_world;
+
 protected:
+    /// @brief Write the ith body's blocks of the global arrays.
+    /// @param codim_edge_id  Index of its first codimensional edge.
+    void assemble_body(size_t i, size_t codim_edge_id);
+
+    /// @brief Update the ith body's collision mask and fixed DoF flags.
+    void update_body_dof_fixed(size_t i);
+
+    /// @brief Update the average edge length and mass and the activation
+    /// distance scales (from the per-body values only).
+    void update_body_statistics();
+
+    /// @brief Are the bodies paired by close_bodies()?
+    bool are_bodies_paired(int i, int j, bool include_static_world) const
+    {
+        return can_bodies_collide(i, j)
+            && (include_static_world
+                || !(m_static_world.contains(i) || m_static_world.contains(j)));
+    }
+
+    /// @brief World vertices of the poses in a Poses<T> or a PosesView<T>.
+    template <typename T, typename PosesT>
+    MatrixX<T> poses_world_vertices(const PosesT& poses) const;
+    /// @brief World vertices and their derivatives of the poses in a PosesD
+    /// or a PosesViewD.
+    template <typename PosesT>
+    Eigen::MatrixXd poses_world_vertices_diff(
+        const PosesT& poses,
+        Eigen::MatrixXd& jac,
+        Eigen::MatrixXd& hess,
+        bool compute_jac,
+        bool compute_hess) const;
+
     /// @brief Group ids per vertex
     Eigen::VectorXi m_vertex_group_ids;
+
+    /// @brief Local feature size of each body relative to the coarsest body
+    /// in [Constants::MIN_ACTIVATION_DISTANCE_SCALE, 1].
+    std::vector<double> m_activation_distance_scales;
+
+    /// @brief Bits of a body's collision mask (bodies sharing a bit never
+    /// collide).
+    enum BodyCollisionBits : uint8_t {
+        STATIC_BODY_BIT = 1 << 0,
+        SCRIPTED_BODY_BIT = 1 << 1,
+    };
+    /// @brief Collision mask per body
+    std::vector<uint8_t> m_body_collision_masks;
+    /// @brief Group ids per body
+    std::vector<int> m_body_group_ids;
+
+    /// @brief Body-level tree reused across close_bodies queries
+    mutable BodyAABBTree m_body_tree;
+
+    enum CloseBodiesMethod {
+        CLOSE_BODIES_BRUTE_FORCE,
+        CLOSE_BODIES_AABB_TREE,
+        NUM_CLOSE_BODIES_METHODS
+    };
+    /// @brief Costs of the close_bodies methods
+    mutable CostBasedSelector m_close_bodies_selector {
+        NUM_CLOSE_BODIES_METHODS
+    };
+
+    /// @brief Tuners of the loops over the bodies and the body pairs
+    mutable ParallelLoopTuner m_world_vertices_diff_loop;
+    mutable ParallelLoopTuner m_convex_pairs_loop;
 };
 
 } // namespace ipc::rigid
@@ -3,8 +3,8 @@
 
 namespace ipc::rigid {
 
-template <typename T>
-MatrixX<T> RigidBodyAssembler::world_vertices(const Poses<T>& poses) const
+template <typename T, typename PosesT>
+MatrixX<T> RigidBodyAssembler::poses_world_vertices(const PosesT& poses) const
 {
     assert(poses.size() == num_bodies());
     MatrixX<T> V(num_vertices(), dim());
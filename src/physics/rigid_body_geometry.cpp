@@ -0,0 +1,296 @@
+#include "rigid_body_geometry.hpp"
+
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include <Eigen/Eigenvalues>
+
+#include <geometry/convex.hpp>
+#include <logger.hpp>
+#include <physics/mass.hpp>
+#include <profiler.hpp>
+
+namespace ipc::rigid {
+
+namespace {
+    /// @brief Hash the contents of a matrix (64-bit FNV-1a).
+    template <typename Derived>
+    void hash_matrix(const Eigen::PlainObjectBase<Derived>& M, uint64_t& hash)
+    {
+        const auto* bytes = reinterpret_cast<const unsigned char*>(M.data());
+        const size_t num_bytes = M.size() * sizeof(typename Derived::Scalar);
+        for (size_t i = 0; i < num_bytes; i++) {
+            hash ^= bytes[i];
+            hash *= 0x100000001b3ULL;
+        }
+        hash ^= M.cols();
+        hash *= 0x100000001b3ULL;
+    }
+
+    std::mutex geometries_mutex;
+    /// @brief Geometries of the live bodies bucketed by the hash of the mesh.
+    std::unordered_map<
+        uint64_t,
+        std::vector<std::weak_ptr<const RigidBodyGeometry>>>
+        geometries;
+} // namespace
+
+std::shared_ptr<const RigidBodyGeometry> RigidBodyGeometry::get(
+    const Eigen::MatrixXd& vertices,
+    const Eigen::MatrixXi& edges,
+    const Eigen::MatrixXi& faces,
+    int num_rot_dof_fixed)
+{
+    uint64_t hash = 0xcbf29ce484222325ULL ^ uint64_t(num_rot_dof_fixed);
+    hash_matrix(vertices, hash);
+    hash_matrix(edges, hash);
+    hash_matrix(faces, hash);
+
+    const auto find = [&]() -> std::shared_ptr<const RigidBodyGeometry> {
+        auto& bucket = geometries[hash];
+        for (auto it = bucket.begin(); it != bucket.end();) {
+            std::shared_ptr<const RigidBodyGeometry> geometry = it->lock();
+            if (geometry == nullptr) {
+                it = bucket.erase(it); // No body uses it anymore
+                continue;
+            }
+            if (geometry->num_rot_dof_fixed == num_rot_dof_fixed
+                && geometry->input_vertices == vertices
+                && geometry->edges == edges && geometry->faces == faces) {
+                return geometry;
+            }
+            ++it;
+        }
+        return nullptr;
+    };
+
+    {
+        std::lock_guard<std::mutex> lock(geometries_mutex);
+        if (auto geometry = find()) {
+            return geometry;
+        }
+    }
+
+    // Build outside of the lock so bodies can be constructed in parallel.
+    auto geometry = std::make_shared<const RigidBodyGeometry>(
+        vertices, edges, faces, num_rot_dof_fixed);
+
+    std::lock_guard<std::mutex> lock(geometries_mutex);
+    if (auto other = find()) {
+        return other; // Another thread built the same geometry first
+    }
+    geometries[hash].push_back(geometry);
+    return geometry;
+}
+
+RigidBodyGeometry::RigidBodyGeometry(
+    const Eigen::MatrixXd& vertices,
+    const Eigen::MatrixXi& edges,
+    const Eigen::MatrixXi& faces,
+    int num_rot_dof_fixed)
+    : input_vertices(vertices)
+    , num_rot_dof_fixed(num_rot_dof_fixed)
+    , vertices(vertices)
+    , edges(edges)
+    , faces(faces)
+    , mesh_selector(vertices.rows(), edges, faces)
+{
+    PROFILE_POINT("RigidBodyGeometry::RigidBodyGeometry");
+    PROFILE_START();
+
+    const Eigen::MatrixXi& elements =
+        dim() == 2 || faces.size() == 0 ? edges : faces;
+
+    // compute the center of mass several times to get more accurate
+    center_of_mass.setZero(dim());
+    for (int i = 0; i < 10; i++) {
+        double mass;
+        VectorMax3d com;
+        MatrixMax3d inertia;
+        compute_mass_properties(this->vertices, elements, mass, com, inertia);
+        this->vertices.rowwise() -= com.transpose();
+        center_of_mass += com;
+        if (com.squaredNorm() < 1e-8) {
+            break;
+        }
+    }
+
+    VectorMax3d com;
+    MatrixMax3d I;
+    compute_mass_properties(this->vertices, elements, volume, com, I);
+    // assert(com.squaredNorm() < 1e-8);
+
+    if (dim() == 3) {
+        // Got this from Chrono: https://bit.ly/2RpbTl1
+        Eigen::SelfAdjointEigenSolver<Eigen::Matrix3d> es;
+        double threshold = I.lpNorm<Eigen::Infinity>() * 1e-16;
+        I = (threshold < I.array().abs()).select(I, 0.0);
+        es.compute(I);
+        if (es.info() != Eigen::Success) {
+            spdlog::error("Eigen decompostion of the inertia tensor failed!");
+        }
+        moment_of_inertia = es.eigenvalues();
+        if ((moment_of_inertia.array() < 0).any()) {
+            RIGID_IPC_LOG_WARN(
+                "Negative moment of inertia ({}), inverting.",
+                fmt_eigen(moment_of_inertia));
+            // Avoid negative epsilon inertias
+            moment_of_inertia =
+                (moment_of_inertia.array() < 0)
+                    .select(-moment_of_inertia, moment_of_inertia);
+        }
+        R0 = es.eigenvectors();
+        // Ensure that we have an orientation preserving transform
+        if (R0.determinant() < 0.0) {
+            R0.col(0) *= -1.0;
+        }
+        assert(R0.isUnitary(1e-9));
+        assert(fabs(R0.determinant() - 1.0) <= 1.0e-9);
+        if (num_rot_dof_fixed == 2) {
+            // Convert moment of inertia to world coordinates
+            // https://physics.stackexchange.com/a/268812
+            moment_of_inertia = -I.diagonal().array() + I.diagonal().sum();
+            R0.setIdentity();
+        }
+        // v = Rv₀ + p = RᵢR₀v₀ + p = RᵢR₀R₀ᵀv₀ + p
+        this->vertices = this->vertices * R0; // R₀ᵀ * V₀ᵀ = V₀ * R₀
+    } else {
+        moment_of_inertia = I.diagonal();
+        R0 = Eigen::Matrix<double, 1, 1>::Identity();
+    }
+
+    init_derived();
+
+    PROFILE_END();
+}
+
+RigidBodyGeometry::RigidBodyGeometry(
+    const Eigen::MatrixXd& input_vertices,
+    const Eigen::MatrixXd& vertices,
+    const Eigen::MatrixXi& edges,
+    const Eigen::MatrixXi& faces,
+    int num_rot_dof_fixed,
+    const VectorMax3d& center_of_mass,
+    double volume,
+    const VectorMax3d& moment_of_inertia,
+    const MatrixMax3d& R0)
+    : input_vertices(input_vertices)
+    , num_rot_dof_fixed(num_rot_dof_fixed)
+    , vertices(vertices)
+    , edges(edges)
+    , faces(faces)
+    , center_of_mass(center_of_mass)
+    , volume(volume)
+    , moment_of_inertia(moment_of_inertia)
+    , R0(R0)
+    , mesh_selector(vertices.rows(), edges, faces)
+{
+    assert(input_vertices.rows() == vertices.rows());
+    assert(input_vertices.cols() == vertices.cols());
+    init_derived();
+}
+
+void RigidBodyGeometry::init_derived()
+{
+    r_max = vertices.rowwise().norm().maxCoeff();
+
+    average_edge_length = 0;
+    for (long i = 0; i < edges.rows(); i++) {
+        average_edge_length +=
+            (vertices.row(edges(i, 0)) - vertices.row(edges(i, 1))).norm();
+    }
+    if (edges.rows() > 0) {
+        average_edge_length /= edges.rows();
+    }
+    assert(std::isfinite(average_edge_length));
+
+    is_convex = is_convex_mesh(vertices, edges, faces);
+
+    init_bvh();
+}
+
+void RigidBodyGeometry::init_bvh()
+{
+    PROFILE_POINT("RigidBodyGeometry::init_bvh");
+    PROFILE_START();
+
+    const size_t num_codim_vertices = mesh_selector.num_codim_vertices();
+    const size_t num_codim_edges = mesh_selector.num_codim_edges();
+
+    // heterogenous bounding boxes
+    std::vector<std::array<Eigen::Vector3d, 2>> aabbs(
+        num_codim_vertices + num_codim_edges + faces.rows());
+
+    for (size_t i = 0; i < num_codim_vertices; i++) {
+        size_t vi = mesh_selector.codim_vertices_to_vertices(i);
+        if (dim() == 2) {
+            aabbs[i][0][2] = 0;
+            aabbs[i][1][2] = 0;
+        }
+        aabbs[i][0].head(dim()) = vertices.row(i);
+        aabbs[i][1].head(dim()) = vertices.row(i);
+    }
+
+    size_t start_i = num_codim_vertices;
+    for (size_t i = 0; i < num_codim_edges; i++) {
+        size_t ei = mesh_selector.codim_edges_to_edges(i);
+        const auto& e0 = vertices.row(edges(ei, 0));
+        const auto& e1 = vertices.row(edges(ei, 1));
+
+        if (dim() == 2) {
+            aabbs[start_i + i][0][2] = 0;
+            aabbs[start_i + i][1][2] = 0;
+        }
+        aabbs[start_i + i][0].head(dim()) = e0.cwiseMin(e1);
+        aabbs[start_i + i][1].head(dim()) = e0.cwiseMax(e1);
+    }
+
+    start_i += num_codim_edges;
+    for (size_t i = 0; i < faces.rows(); i++) {
+        assert(dim() == 3);
+        const auto& f0 = vertices.row(faces(i, 0));
+        const auto& f1 = vertices.row(faces(i, 1));
+        const auto& f2 = vertices.row(faces(i, 2));
+        aabbs[start_i + i][0] = f0.cwiseMin(f1).cwiseMin(f2);
+        aabbs[start_i + i][1] = f0.cwiseMax(f1).cwiseMax(f2);
+    }
+
+    bvh.init(aabbs);
+    primitive_bvh.init(aabbs);
+
+    // Boxes of the primitives queried by the body pair broad phase
+    vertex_aabbs.resize(vertices.rows());
+    for (size_t i = 0; i < vertices.rows(); i++) {
+        const ArrayMax3d v = vertices.row(i).transpose().array();
+        vertex_aabbs[i] = BroadPhaseAABB(v, v);
+    }
+    edge_aabbs.resize(edges.rows());
+    for (size_t i = 0; i < edges.rows(); i++) {
+        edge_aabbs[i] = BroadPhaseAABB(
+            vertex_aabbs[edges(i, 0)], vertex_aabbs[edges(i, 1)]);
+    }
+    face_aabbs.resize(faces.rows());
+    for (size_t i = 0; i < faces.rows(); i++) {
+        face_aabbs[i] = BroadPhaseAABB(
+            vertex_aabbs[faces(i, 0)], vertex_aabbs[faces(i, 1)],
+            vertex_aabbs[faces(i, 2)]);
+    }
+    primitive_bvh.refit(
+        [&](size_t id) {
+            if (id < num_codim_vertices) {
+                const size_t vi = mesh_selector.codim_vertices_to_vertices(id);
+                return vertex_aabbs[vi];
+            }
+            id -= num_codim_vertices;
+            if (id < num_codim_edges) {
+                return edge_aabbs[mesh_selector.codim_edges_to_edges(id)];
+            }
+            return face_aabbs[id - num_codim_edges];
+        },
+        bvh_node_aabbs);
+
+    PROFILE_END();
+}
+
+} // namespace ipc::rigid
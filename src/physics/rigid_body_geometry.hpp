@@ -0,0 +1,102 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include <Eigen/Core>
+
+#include <utils/eigen_ext.hpp>
+
+#include <BVH.hpp>
+#include <ccd/rigid/float_aabb.hpp>
+#include <geometry/primitive_bvh.hpp>
+#include <utils/mesh_selector.hpp>
+
+namespace ipc::rigid {
+
+/// @brief Immutable body space geometry and unit density mass properties.
+///
+/// Bodies built from the same mesh share one instance, so the mass
+/// properties, BVH, and mesh selector are computed and stored once per
+/// unique mesh.
+class RigidBodyGeometry {
+public:
+    /**
+     * @brief Get the shared geometry of a mesh, computing it if no live body
+     *        uses the same mesh.
+     *
+     * @param vertices           Vertices of the body in the input frame.
+     * @param edges              Edges as pairs of vertex indices.
+     * @param faces              Faces as triplets of vertex indices.
+     * @param num_rot_dof_fixed  Number of fixed rotational dof (changes the
+     *                           principal frame).
+     */
+    static std::shared_ptr<const RigidBodyGeometry> get(
+        const Eigen::MatrixXd& vertices,
+        const Eigen::MatrixXi& edges,
+        const Eigen::MatrixXi& faces,
+        int num_rot_dof_fixed);
+
+    RigidBodyGeometry(
+        const Eigen::MatrixXd& vertices,
+        const Eigen::MatrixXi& edges,
+        const Eigen::MatrixXi& faces,
+        int num_rot_dof_fixed);
+
+    /// @brief Restore a geometry from precomputed (e.g., saved) mass
+    /// properties, so only the BVH and mesh selector are rebuilt.
+    ///
+    /// @param input_vertices  Vertices of the body in the input frame.
+    /// @param vertices        Centered vertices in the principal frame.
+    RigidBodyGeometry(
+        const Eigen::MatrixXd& input_vertices,
+        const Eigen::MatrixXd& vertices,
+        const Eigen::MatrixXi& edges,
+        const Eigen::MatrixXi& faces,
+        int num_rot_dof_fixed,
+        const VectorMax3d& center_of_mass,
+        double volume,
+        const VectorMax3d& moment_of_inertia,
+        const MatrixMax3d& R0);
+
+    int dim() const { return vertices.cols(); }
+
+    /// @brief Vertices in the input frame (used to identify the mesh).
+    Eigen::MatrixXd input_vertices;
+    int num_rot_dof_fixed;
+
+    Eigen::MatrixXd vertices; ///< Vertices positions in body space
+    Eigen::MatrixXi edges;    ///< Vertices connectivity
+    Eigen::MatrixXi faces;    ///< Vertices connectivity
+
+    /// @brief Center of mass in the input frame
+    VectorMax3d center_of_mass;
+    /// @brief Volume (mass of a unit density body)
+    double volume;
+    /// @brief Principal moments of inertia of a unit density body
+    VectorMax3d moment_of_inertia;
+    /// @brief Rotation from the principal axes to the input orientation
+    MatrixMax3d R0;
+    /// @brief Maximum distance from CM to a vertex
+    double r_max;
+    double average_edge_length; ///< Average edge length
+    /// @brief Is the mesh the boundary of a convex shape?
+    bool is_convex;
+
+    /// @brief Local space BVH
+    BVH::BVH bvh;
+    /// @brief Topology of a BVH over the same primitives for dual traversals
+    PrimitiveBVH primitive_bvh;
+    /// @brief Body space boxes of the vertices, edges, and faces
+    std::vector<BroadPhaseAABB> vertex_aabbs, edge_aabbs, face_aabbs;
+    /// @brief Body space boxes of the nodes of primitive_bvh
+    std::vector<BroadPhaseAABB> bvh_node_aabbs;
+    MeshSelector mesh_selector;
+
+protected:
+    /// @brief Compute the quantities derived from the body space vertices.
+    void init_derived();
+    void init_bvh();
+};
+
+} // namespace ipc::rigid
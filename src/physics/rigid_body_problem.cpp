@@ -1,22 +1,24 @@
 #include "rigid_body_problem.hpp"
 
+#include <algorithm>
+#include <atomic>
 #include <iostream>
+#include <numeric>
 
-#include <tbb/parallel_for_each.h>
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
 
 #include <finitediff.hpp>
 #include <igl/PI.h>
-#include <igl/predicates/segment_segment_intersect.h>
-
-#include <ipc/utils/intersection.hpp>
 
 #include <ccd/rigid/broad_phase.hpp>
-#include <ccd/rigid/rigid_body_hash_grid.hpp>
+#include <geometry/intersection.hpp>
 #include <io/read_rb_scene.hpp>
 #include <io/serialize_json.hpp>
 #include <logger.hpp>
 #include <profiler.hpp>
 #include <utils/eigen_ext.hpp>
+#include <utils/morton_order.hpp>
 
 namespace ipc::rigid {
 
@@ -24,8 +26,15 @@ RigidBodyProblem::RigidBodyProblem()
     : coefficient_restitution(0)
     , coefficient_friction(0)
     , collision_eps(2)
+    , sleep_energy_threshold(0)
+    , sleep_steps(10)
+    , intersection_check_interval(1)
+    , do_body_reordering(false)
+    , body_reordering_interval(0)
+    , m_num_unreordered_steps(0)
     , m_timestep(0.01)
     , do_intersection_check(false)
+    , m_num_unchecked_steps(0)
 {
     gravity.setZero(3);
 }
@@ -46,12 +55,40 @@ bool RigidBodyProblem::settings(const nlohmann::json& params)
     }
 
     std::vector<RigidBody> rbs;
-    bool success = read_rb_scene(params, rbs);
-    if (!success) {
+    if (m_has_scene_bodies) {
+        rbs = std::move(m_scene_bodies);
+        m_scene_bodies.clear();
+        m_has_scene_bodies = false;
+    } else if (!read_rb_scene(params, rbs)) {
         spdlog::error("Unable to read rigid body scene!");
         return false;
     }
 
+    // Selected by the scene index, so read before sorting the bodies
+    if (!m_state_output.settings(params["state_output"], rbs)) {
+        return false;
+    }
+
+    do_body_reordering = params["do_body_reordering"];
+    body_reordering_interval = params["body_reordering_interval"];
+    m_num_unreordered_steps = 0;
+    m_body_external_ids.resize(rbs.size());
+    std::iota(m_body_external_ids.begin(), m_body_external_ids.end(), 0);
+    if (do_body_reordering) {
+        Eigen::MatrixXd positions(
+            rbs.size(), rbs.empty() ? 0 : rbs[0].dim());
+        for (size_t i = 0; i < rbs.size(); i++) {
+            positions.row(i) = rbs[i].pose.position;
+        }
+        m_body_external_ids = morton_order(positions);
+        std::vector<RigidBody> sorted_rbs;
+        sorted_rbs.reserve(rbs.size());
+        for (int id : m_body_external_ids) {
+            sorted_rbs.push_back(rbs[id]);
+        }
+        rbs = std::move(sorted_rbs);
+    }
+
     init(rbs);
 
     from_json(params["gravity"], gravity);
@@ -59,6 +96,12 @@ bool RigidBodyProblem::settings(const nlohmann::json& params)
     gravity.conservativeResize(dim());
 
     do_intersection_check = params["do_intersection_check"];
+    intersection_check_interval =
+        std::max(params["intersection_check_interval"].get<int>(), 1);
+    m_num_unchecked_steps = 0;
+    sleep_energy_threshold = params["sleep_energy_threshold"];
+    sleep_steps = params["sleep_steps"];
+    m_body_contacts.clear();
     return true;
 }
 
@@ -71,18 +114,30 @@ nlohmann::json RigidBodyProblem::settings() const
     json["coefficient_friction"] = coefficient_friction;
     json["gravity"] = to_json(gravity);
     json["do_intersection_check"] = do_intersection_check;
+    json["intersection_check_interval"] = intersection_check_interval;
+    json["sleep_energy_threshold"] = sleep_energy_threshold;
+    json["sleep_steps"] = sleep_steps;
+    json["do_body_reordering"] = do_body_reordering;
+    json["body_reordering_interval"] = body_reordering_interval;
+    json["state_output"] = m_state_output.settings();
     return json;
 }
 
 void RigidBodyProblem::init(const std::vector<RigidBody>& rbs)
 {
+    if (m_body_external_ids.size() != rbs.size()) {
+        m_body_external_ids.resize(rbs.size());
+        std::iota(m_body_external_ids.begin(), m_body_external_ids.end(), 0);
+    }
     m_assembler.init(rbs);
+    m_vertices_t1_dof.resize(0); // The meshes may have changed
 
+    constraint().invalidate_body_caches();
     update_constraints();
 
     for (size_t i = 0; i < num_bodies(); ++i) {
         auto& rb = m_assembler[i];
-        spdlog::info(
+        RIGID_IPC_LOG_INFO(
             "rb={:d} group_id={:d} mass={:g} inertia={}", i, rb.group_id,
             rb.mass, fmt_eigen(rb.moment_of_inertia));
     }
@@ -104,44 +159,243 @@ void RigidBodyProblem::init(const std::vector<RigidBody>& rbs)
     }
 }
 
+void RigidBodyProblem::add_body(const RigidBody& rb)
+{
+    m_body_external_ids.push_back(int(num_bodies()));
+    if (!m_body_contacts.empty()) {
+        m_body_contacts.emplace_back();
+    }
+    m_assembler.add_body(rb);
+    m_vertices_t1_dof.resize(0);
+    constraint().invalidate_body_caches();
+    update_dof();
+}
+
+void RigidBodyProblem::remove_body(size_t i)
+{
+    assert(i < num_bodies());
+    const int external_id = m_body_external_ids[i];
+    m_body_external_ids.erase(m_body_external_ids.begin() + i);
+    for (int& id : m_body_external_ids) {
+        if (id > external_id) {
+            id--;
+        }
+    }
+
+    if (!m_body_contacts.empty()) {
+        m_body_contacts.erase(m_body_contacts.begin() + i);
+        for (std::vector<int>& contacts : m_body_contacts) {
+            contacts.erase(
+                std::remove(contacts.begin(), contacts.end(), int(i)),
+                contacts.end());
+            for (int& j : contacts) {
+                if (j > int(i)) {
+                    j--;
+                }
+            }
+        }
+    }
+
+    m_assembler.remove_body(i);
+    m_vertices_t1_dof.resize(0);
+    constraint().invalidate_body_caches();
+    update_dof();
+}
+
 nlohmann::json RigidBodyProblem::state() const
 {
-    nlohmann::json json;
-    std::vector<nlohmann::json> rbs;
-    Eigen::VectorXd p =
-        Eigen::VectorXd::Zero(PoseD::dim_to_pos_ndof(dim())); // Linear momentum
-    Eigen::VectorXd L = Eigen::VectorXd::Zero(
-        PoseD::dim_to_rot_ndof(dim())); // Angular momentum
-    double T = 0.0;                     // Kinetic energy
-    double G = 0.0;                     // Potential energy
-
-    for (auto& rb : m_assembler.m_rbs) {
-        nlohmann::json jrb;
-        jrb["position"] = to_json(Eigen::VectorXd(rb.pose.position));
-        jrb["rotation"] = to_json(Eigen::VectorXd(rb.pose.rotation));
-        jrb["linear_velocity"] = to_json(Eigen::VectorXd(rb.velocity.position));
-        jrb["angular_velocity"] =
-            to_json(Eigen::VectorXd(rb.velocity.rotation));
+    std::vector<double> buffer;
+    write_state(buffer, /*is_filtered=*/false);
+    return state_to_json(buffer);
+}
+
+std::vector<size_t> RigidBodyProblem::body_internal_ids() const
+{
+    std::vector<size_t> internal_ids(m_body_external_ids.size());
+    for (size_t i = 0; i < m_body_external_ids.size(); i++) {
+        internal_ids[m_body_external_ids[i]] = i;
+    }
+    return internal_ids;
+}
+
+void RigidBodyProblem::state_into(std::vector<double>& buffer) const
+{
+    write_state(buffer, /*is_filtered=*/true);
+}
+
+size_t RigidBodyProblem::body_state_size(int fields) const
+{
+    typedef StateOutputFilter F;
+    const size_t pos_ndof = PoseD::dim_to_pos_ndof(dim());
+    const size_t rot_ndof = PoseD::dim_to_rot_ndof(dim());
+    auto count = [&](int a, int b) {
+        return size_t(bool(fields & a)) + size_t(bool(fields & b));
+    };
+    return 1 + pos_ndof * count(F::POSITION, F::LINEAR_VELOCITY)
+        + rot_ndof * count(F::ROTATION, F::ANGULAR_VELOCITY)
+        + (dim() == 3 ? 9 * count(F::QDOT, F::QDDOT) : 0);
+}
+
+size_t RigidBodyProblem::rigid_body_state_size(
+    const std::vector<double>& buffer) const
+{
+    assert(buffer.size() >= 2);
+    return 2 + size_t(buffer[1]) * body_state_size(int(buffer[0]));
+}
+
+void RigidBodyProblem::write_state(
+    std::vector<double>& buffer, bool is_filtered) const
+{
+    typedef StateOutputFilter F;
+    is_filtered = is_filtered && m_state_output.is_enabled();
+    const int fields = is_filtered ? m_state_output.fields() : F::ALL_FIELDS;
+
+    // Field mask and number of bodies followed by the scene index and the
+    // fields of each recorded body
+    buffer.resize(2 + num_bodies() * body_state_size(fields));
+    buffer[0] = fields;
+    double* values = buffer.data() + 2;
+    auto write = [&](int field, const auto& x) {
+        if (fields & field) {
+            values = std::copy_n(x.data(), x.size(), values);
+        }
+    };
+    size_t num_recorded = 0;
+    for (size_t i = 0; i < num_bodies(); i++) {
+        const RigidBody& rb = m_assembler[i];
+        const size_t id = m_body_external_ids[i];
+        if (is_filtered && !m_state_output.is_recorded(id, rb.pose.position)) {
+            continue;
+        }
+        *values++ = id;
+        write(F::POSITION, rb.pose.position);
+        write(F::ROTATION, rb.pose.rotation);
+        write(F::LINEAR_VELOCITY, rb.velocity.position);
+        write(F::ANGULAR_VELOCITY, rb.velocity.rotation);
         if (dim() == 3) {
-            jrb["Qdot"] = to_json(rb.Qdot);
-            jrb["Qddot"] = to_json(rb.Qddot);
+            write(F::QDOT, rb.Qdot);
+            write(F::QDDOT, rb.Qddot);
         }
-        rbs.push_back(jrb);
+        num_recorded++;
+    }
+    buffer[1] = num_recorded;
+    buffer.resize(values - buffer.data());
+}
+
+void RigidBodyProblem::state_from(const std::vector<double>& buffer)
+{
+    typedef StateOutputFilter F;
+    const int fields = int(buffer[0]);
+    const size_t num_recorded = size_t(buffer[1]);
+    assert(buffer.size() >= rigid_body_state_size(buffer));
+
+    const std::vector<size_t> internal_ids = body_internal_ids();
+
+    // Bodies and fields that are not recorded are left unchanged
+    const double* values = buffer.data() + 2;
+    auto read = [&](int field, auto& x) {
+        if (fields & field) {
+            std::copy_n(values, x.size(), x.data());
+            values += x.size();
+        }
+    };
+    for (size_t k = 0; k < num_recorded; k++) {
+        RigidBody& rb = m_assembler[internal_ids[size_t(*values++)]];
+        read(F::POSITION, rb.pose.position);
+        read(F::ROTATION, rb.pose.rotation);
+        read(F::LINEAR_VELOCITY, rb.velocity.position);
+        read(F::ANGULAR_VELOCITY, rb.velocity.rotation);
+        if (dim() == 3) {
+            read(F::QDOT, rb.Qdot);
+            read(F::QDDOT, rb.Qddot);
+        }
+    }
+}
 
-        // momentum
-        p += rb.mass * rb.velocity.position;
-        L += rb.moment_of_inertia.asDiagonal() * rb.velocity.rotation;
+nlohmann::json
+RigidBodyProblem::state_to_json(const std::vector<double>& buffer) const
+{
+    typedef StateOutputFilter F;
+    const int fields = int(buffer[0]);
+    const size_t num_recorded = size_t(buffer[1]);
+    assert(buffer.size() >= rigid_body_state_size(buffer));
 
-        T += 0.5 * rb.mass * rb.velocity.position.squaredNorm();
-        T += 0.5 * rb.velocity.rotation.transpose()
-            * rb.moment_of_inertia.asDiagonal() * rb.velocity.rotation;
+    const std::vector<size_t> internal_ids = body_internal_ids();
 
-        if (!rb.is_dof_fixed[0] && !rb.is_dof_fixed[1]) {
-            G -= rb.mass * gravity.dot(rb.pose.position);
+    nlohmann::json json;
+    const int pos_ndof = PoseD::dim_to_pos_ndof(dim());
+    const int rot_ndof = PoseD::dim_to_rot_ndof(dim());
+    Eigen::VectorXd p = Eigen::VectorXd::Zero(pos_ndof); // Linear momentum
+    Eigen::VectorXd L = Eigen::VectorXd::Zero(rot_ndof); // Angular momentum
+    double T = 0.0;                                      // Kinetic energy
+    double G = 0.0;                                      // Potential energy
+
+    // Output the bodies in the scene's order. Filtered states only hold the
+    // recorded bodies and their scene index.
+    const bool is_complete = num_recorded == num_bodies();
+    std::vector<std::pair<size_t, nlohmann::json>> rbs(num_recorded);
+    const double* values = buffer.data() + 2;
+    auto read = [&](int field, int size) {
+        const bool has_field = fields & field;
+        const Eigen::Map<const Eigen::VectorXd> x(values, has_field ? size : 0);
+        values += x.size();
+        return x;
+    };
+    for (size_t k = 0; k < num_recorded; k++) {
+        const size_t id = size_t(*values++);
+        const RigidBody& rb = m_assembler[internal_ids[id]];
+        const auto position = read(F::POSITION, pos_ndof);
+        const auto rotation = read(F::ROTATION, rot_ndof);
+        const auto linear_velocity = read(F::LINEAR_VELOCITY, pos_ndof);
+        const auto angular_velocity = read(F::ANGULAR_VELOCITY, rot_ndof);
+
+        rbs[k].first = id;
+        nlohmann::json& jrb = rbs[k].second;
+        if (!is_complete) {
+            jrb["id"] = id;
+        }
+        auto write = [&](const char* name, const auto& x) {
+            if (x.size()) {
+                jrb[name] = to_json(x);
+            }
+        };
+        write("position", position);
+        write("rotation", rotation);
+        write("linear_velocity", linear_velocity);
+        write("angular_velocity", angular_velocity);
+        if (dim() == 3) {
+            typedef Eigen::Map<const Eigen::Matrix3d> Matrix3Map;
+            for (const auto& [field, name] :
+                 { std::make_pair(F::QDOT, "Qdot"),
+                   std::make_pair(F::QDDOT, "Qddot") }) {
+                if (fields & field) {
+                    jrb[name] = to_json(Matrix3Map(read(field, 9).data()));
+                }
+            }
+        }
+
+        // momentum of the recorded bodies
+        if (linear_velocity.size()) {
+            p += rb.mass * linear_velocity;
+            T += 0.5 * rb.mass * linear_velocity.squaredNorm();
+        }
+        if (angular_velocity.size()) {
+            L += rb.moment_of_inertia.asDiagonal() * angular_velocity;
+            T += 0.5 * angular_velocity.transpose()
+                * rb.moment_of_inertia.asDiagonal() * angular_velocity;
+        }
+        if (position.size() && !rb.is_dof_fixed[0] && !rb.is_dof_fixed[1]) {
+            G -= rb.mass * gravity.dot(position);
         }
     }
+    std::sort(rbs.begin(), rbs.end(), [](const auto& a, const auto& b) {
+        return a.first < b.first;
+    });
 
-    json["rigid_bodies"] = rbs;
+    json["rigid_bodies"] = nlohmann::json::array();
+    for (auto& [id, jrb] : rbs) {
+        json["rigid_bodies"].push_back(std::move(jrb));
+    }
     json["linear_momentum"] = to_json(p);
     json["angular_momentum"] = to_json(L);
     json["kinetic_energy"] = T;
@@ -151,33 +405,197 @@ nlohmann::json RigidBodyProblem::state() const
 
 void RigidBodyProblem::state(const nlohmann::json& args)
 {
-    nlohmann::json json;
-    auto& rbs = args["rigid_bodies"];
-    assert(rbs.size() == num_bodies());
-    size_t i = 0;
-    for (auto& jrb : args["rigid_bodies"]) {
-        from_json(jrb["position"], m_assembler[i].pose.position);
-        from_json(jrb["rotation"], m_assembler[i].pose.rotation);
-        from_json(jrb["linear_velocity"], m_assembler[i].velocity.position);
-        from_json(jrb["angular_velocity"], m_assembler[i].velocity.rotation);
+    const std::vector<size_t> internal_ids = body_internal_ids();
+
+    // Filtered states only hold some of the bodies (with their scene index)
+    // and fields, the others are left unchanged.
+    const auto& rbs = args["rigid_bodies"];
+    assert(rbs.size() <= num_bodies());
+    for (size_t k = 0; k < rbs.size(); k++) {
+        const auto& jrb = rbs[k];
+        const bool is_filtered = jrb.contains("id");
+        const size_t id = is_filtered ? jrb["id"].get<size_t>() : k;
+        assert(id < num_bodies());
+        RigidBody& rb = m_assembler[internal_ids[id]];
+        for (const auto& [name, x] :
+             { std::make_pair("position", &rb.pose.position),
+               std::make_pair("rotation", &rb.pose.rotation),
+               std::make_pair("linear_velocity", &rb.velocity.position),
+               std::make_pair("angular_velocity", &rb.velocity.rotation) }) {
+            if (jrb.contains(name)) {
+                from_json(jrb[name], *x);
+            }
+        }
         if (dim() == 3) {
             if (jrb.contains("Qdot")) {
-                from_json(jrb["Qdot"], m_assembler[i].Qdot);
-            } else {
+                from_json(jrb["Qdot"], rb.Qdot);
+            } else if (!is_filtered) {
                 spdlog::warn("Missing field \"Qdot\" in rigid body state!");
-                m_assembler[i].Qdot.setZero();
+                rb.Qdot.setZero();
             }
             if (jrb.contains("Qddot")) {
-                from_json(jrb["Qddot"], m_assembler[i].Qddot);
-            } else {
+                from_json(jrb["Qddot"], rb.Qddot);
+            } else if (!is_filtered) {
                 spdlog::warn("Missing field \"Qddot\" in rigid body state!");
-                m_assembler[i].Qddot.setZero();
+                rb.Qddot.setZero();
             }
         }
-        i++;
     }
 }
 
+nlohmann::json RigidBodyProblem::restart_state() const
+{
+    nlohmann::json json = state();
+    // Scripted motion is consumed as the simulation advances
+    for (size_t i = 0; i < num_bodies(); i++) {
+        auto& jrb = json["rigid_bodies"][m_body_external_ids[i]];
+        jrb["type"] = m_assembler[i].type;
+        jrb["kinematic_max_time"] = m_assembler[i].kinematic_max_time;
+        jrb["num_kinematic_poses"] = m_assembler[i].kinematic_poses.size();
+        jrb["kinematic_time"] = m_assembler[i].kinematic_time;
+        jrb["is_sleeping"] = m_assembler[i].is_sleeping;
+        jrb["num_resting_steps"] = m_assembler[i].num_resting_steps;
+    }
+    return json;
+}
+
+void RigidBodyProblem::restart_state(const nlohmann::json& args)
+{
+    state(args);
+    for (size_t i = 0; i < num_bodies(); i++) {
+        const auto& jrb = args["rigid_bodies"][m_body_external_ids[i]];
+        RigidBody& rb = m_assembler[i];
+        // Sleeping bodies are saved as static, but can still wake up
+        if (jrb.value("is_sleeping", false)) {
+            rb.sleep();
+        } else if (
+            jrb["type"].get<RigidBodyType>() == RigidBodyType::STATIC
+            && rb.type != RigidBodyType::STATIC) {
+            rb.convert_to_static();
+        }
+        rb.num_resting_steps = jrb.value("num_resting_steps", 0);
+        rb.kinematic_max_time = jrb["kinematic_max_time"].get<double>();
+        const size_t num_kinematic_poses = jrb["num_kinematic_poses"];
+        while (rb.kinematic_poses.size() > num_kinematic_poses) {
+            rb.kinematic_poses.pop_front();
+        }
+        rb.kinematic_time = jrb.value("kinematic_time", 0.0);
+    }
+    m_assembler.update_dof_fixed();
+    // Contacts are not saved, so resting restarts from the next step
+    m_body_contacts.clear();
+}
+
+PosesD RigidBodyProblem::external_poses(const PosesD& poses) const
+{
+    assert(poses.size() == num_bodies());
+    PosesD permuted_poses(poses.size());
+    for (size_t i = 0; i < poses.size(); i++) {
+        permuted_poses[m_body_external_ids[i]] = poses[i];
+    }
+    return permuted_poses;
+}
+
+PosesD RigidBodyProblem::internal_poses(const PosesD& poses) const
+{
+    assert(poses.size() == num_bodies());
+    PosesD permuted_poses(poses.size());
+    for (size_t i = 0; i < poses.size(); i++) {
+        permuted_poses[i] = poses[m_body_external_ids[i]];
+    }
+    return permuted_poses;
+}
+
+Eigen::VectorXd RigidBodyProblem::external_dofs(const Eigen::VectorXd& x) const
+{
+    if (num_bodies() == 0 || x.size() == 0) {
+        return x;
+    }
+    const int ndof = x.size() / num_bodies();
+    Eigen::VectorXd permuted_x(x.size());
+    for (size_t i = 0; i < num_bodies(); i++) {
+        permuted_x.segment(ndof * m_body_external_ids[i], ndof) =
+            x.segment(ndof * i, ndof);
+    }
+    return permuted_x;
+}
+
+Eigen::VectorXd RigidBodyProblem::internal_dofs(const Eigen::VectorXd& x) const
+{
+    if (num_bodies() == 0 || x.size() == 0) {
+        return x;
+    }
+    const int ndof = x.size() / num_bodies();
+    Eigen::VectorXd permuted_x(x.size());
+    for (size_t i = 0; i < num_bodies(); i++) {
+        permuted_x.segment(ndof * i, ndof) =
+            x.segment(ndof * m_body_external_ids[i], ndof);
+    }
+    return permuted_x;
+}
+
+bool RigidBodyProblem::reorder_bodies()
+{
+    Eigen::MatrixXd positions(num_bodies(), dim());
+    for (size_t i = 0; i < num_bodies(); i++) {
+        positions.row(i) = m_assembler[i].pose.position;
+    }
+    const std::vector<int> order = morton_order(positions);
+    if (std::is_sorted(order.begin(), order.end())) {
+        return false; // Already in order
+    }
+
+    std::vector<RigidBody> rbs;
+    rbs.reserve(num_bodies());
+    std::vector<int> external_ids(num_bodies()), new_ids(num_bodies());
+    for (size_t i = 0; i < num_bodies(); i++) {
+        rbs.push_back(m_assembler[order[i]]);
+        external_ids[i] = m_body_external_ids[order[i]];
+        new_ids[order[i]] = int(i);
+    }
+
+    if (!m_body_contacts.empty()) {
+        std::vector<std::vector<int>> body_contacts(num_bodies());
+        for (size_t i = 0; i < num_bodies(); i++) {
+            for (int j : m_body_contacts[order[i]]) {
+                body_contacts[i].push_back(new_ids[j]);
+            }
+            std::sort(body_contacts[i].begin(), body_contacts[i].end());
+        }
+        m_body_contacts = std::move(body_contacts);
+    }
+
+    m_body_external_ids = std::move(external_ids);
+    m_assembler.init(rbs);
+    constraint().invalidate_body_caches();
+    update_dof();
+    return true;
+}
+
+void RigidBodyProblem::update_body_order()
+{
+    if (!do_body_reordering || body_reordering_interval <= 0
+        || ++m_num_unreordered_steps < body_reordering_interval) {
+        return;
+    }
+    m_num_unreordered_steps = 0;
+    const bool is_reordered = reorder_bodies();
+    RIGID_IPC_LOG_DEBUG("is_reordered={}", is_reordered);
+}
+
+Eigen::MatrixXd RigidBodyProblem::vertices() const
+{
+    // Compare the DoF instead of counting pose updates, because the poses
+    // are also set directly (e.g., by the viewer and the Python bindings).
+    const Eigen::VectorXd dof = this->poses_to_dofs(m_assembler.rb_poses_t1());
+    if (m_vertices_t1.rows() != num_vertices()
+        || m_vertices_t1_dof.size() != dof.size() || m_vertices_t1_dof != dof) {
+        m_vertices_t1 = m_assembler.world_vertices(dof);
+        m_vertices_t1_dof = dof;
+    }
+    return m_vertices_t1;
+}
+
 void RigidBodyProblem::update_dof()
 {
     poses_t0 = m_assembler.rb_poses_t0();
@@ -263,11 +681,104 @@ bool RigidBodyProblem::take_step(const Eigen::VectorXd& dof)
         // step. We only guarentee a piecewise collision-free trajectory.
         // return detect_collisions(poses_t0, poses_q1,
         // CollisionCheck::EXACT);
-        return detect_intersections(poses_q1);
+        return detect_step_intersections(poses_q1);
     }
     return false;
 }
 
+bool RigidBodyProblem::is_body_resting(const RigidBody& body) const
+{
+    const VectorMax6d v = body.velocity.dof();
+    const double kinetic_energy =
+        0.5 * v.dot(body.mass_matrix.diagonal().cwiseProduct(v));
+    return kinetic_energy <= sleep_energy_threshold * body.mass;
+}
+
+bool RigidBodyProblem::wake_sleeping_bodies(
+    const std::vector<std::pair<int, int>>& body_pairs)
+{
+    if (!is_sleeping_enabled()) {
+        return false;
+    }
+
+    // Resting bodies can touch sleeping ones without waking them, so piles
+    // can fall asleep one body at a time.
+    const auto is_waking = [&](const RigidBody& body) {
+        return body.type == RigidBodyType::KINEMATIC
+            || (body.type == RigidBodyType::DYNAMIC && !is_body_resting(body));
+    };
+
+    std::vector<int> woken_bodies;
+    for (const auto& [i, j] : body_pairs) {
+        if (m_assembler[i].is_sleeping && is_waking(m_assembler[j])) {
+            woken_bodies.push_back(i);
+        } else if (m_assembler[j].is_sleeping && is_waking(m_assembler[i])) {
+            woken_bodies.push_back(j);
+        }
+    }
+    // Wake after checking all pairs, so bodies only wake their neighbors
+    for (int i : woken_bodies) {
+        if (m_assembler[i].is_sleeping) {
+            m_assembler[i].wake_up();
+        }
+    }
+
+    if (woken_bodies.empty()) {
+        return false;
+    }
+    m_assembler.update_dof_fixed();
+    RIGID_IPC_LOG_DEBUG("num_woken_bodies={:d}", woken_bodies.size());
+    return true;
+}
+
+void RigidBodyProblem::update_sleeping_bodies(
+    const std::vector<std::pair<int, int>>& contact_pairs)
+{
+    if (!is_sleeping_enabled()) {
+        return;
+    }
+
+    wake_sleeping_bodies(contact_pairs);
+
+    std::vector<std::vector<int>> body_contacts(num_bodies());
+    for (const auto& [i, j] : contact_pairs) {
+        body_contacts[i].push_back(j);
+        body_contacts[j].push_back(i);
+    }
+    for (std::vector<int>& contacts : body_contacts) {
+        std::sort(contacts.begin(), contacts.end());
+        contacts.erase(
+            std::unique(contacts.begin(), contacts.end()), contacts.end());
+    }
+
+    // A body rests while it is slow and its contacts do not change
+    bool has_new_sleeping_bodies = false;
+    size_t num_sleeping_bodies = 0;
+    for (size_t i = 0; i < num_bodies(); i++) {
+        RigidBody& body = m_assembler[i];
+        if (body.type == RigidBodyType::DYNAMIC) {
+            const bool are_contacts_stable = i < m_body_contacts.size()
+                && m_body_contacts[i] == body_contacts[i];
+            if (is_body_resting(body) && are_contacts_stable) {
+                body.num_resting_steps++;
+            } else {
+                body.num_resting_steps = 0;
+            }
+            if (body.num_resting_steps >= sleep_steps) {
+                body.sleep();
+                has_new_sleeping_bodies = true;
+            }
+        }
+        num_sleeping_bodies += body.is_sleeping;
+    }
+    m_body_contacts = std::move(body_contacts);
+
+    if (has_new_sleeping_bodies) {
+        m_assembler.update_dof_fixed();
+    }
+    spdlog::info("num_sleeping_bodies={:d}", num_sleeping_bodies);
+}
+
 bool RigidBodyProblem::detect_collisions(
     const PosesD& poses_q0,
     const PosesD& poses_q1,
@@ -299,41 +810,41 @@ bool RigidBodyProblem::detect_intersections(const PosesD& poses) const
     const Eigen::MatrixXi& edges = this->edges();
     const Eigen::MatrixXi& faces = this->faces();
 
-    bool is_intersecting = false;
+    // Run the (filtered) exact predicates in parallel until one intersects
+    std::atomic<bool> is_intersecting(false);
+    const auto any_of = [&](size_t num_candidates, const auto& intersects) {
+        tbb::parallel_for(
+            tbb::blocked_range<size_t>(size_t(0), num_candidates),
+            [&](const tbb::blocked_range<size_t>& range) {
+                for (size_t i = range.begin();
+                     i != range.end() && !is_intersecting; i++) {
+                    if (intersects(i)) {
+                        is_intersecting = true;
+                    }
+                }
+            });
+    };
+
     if (dim() == 2) { // Need to check segment-segment intersections in 2D
         assert(vertices.cols() == 2);
 
-        double inflation_radius = 1e-8; // Conservative broad phase
-        std::vector<std::pair<int, int>> close_bodies =
-            m_assembler.close_bodies(poses, poses, inflation_radius);
-        if (close_bodies.size() == 0) {
-            PROFILE_END();
-            return false;
-        }
-
-        RigidBodyHashGrid hashgrid;
-        hashgrid.resize(m_assembler, poses, close_bodies, inflation_radius);
-        hashgrid.addBodies(m_assembler, poses, close_bodies, inflation_radius);
-
-        const Eigen::VectorXi& vertex_group_ids = group_ids();
-        auto can_vertices_collide = [&vertex_group_ids](size_t vi, size_t vj) {
-            return vertex_group_ids[vi] != vertex_group_ids[vj];
-        };
-
-        std::vector<EdgeEdgeCandidate> ee_candidates;
-        hashgrid.getEdgeEdgePairs(edges, ee_candidates, can_vertices_collide);
-
-        for (const EdgeEdgeCandidate& ee_candidate : ee_candidates) {
-            if (igl::predicates::segment_segment_intersect(
-                    vertices.row(edges(ee_candidate.edge0_index, 0)).head<2>(),
-                    vertices.row(edges(ee_candidate.edge0_index, 1)).head<2>(),
-                    vertices.row(edges(ee_candidate.edge1_index, 0)).head<2>(),
-                    vertices.row(edges(ee_candidate.edge1_index, 1))
-                        .head<2>())) {
-                is_intersecting = true;
-                break;
-            }
-        }
+        // The body BVHs and the persistent body tree are shared with the
+        // collision broad phase.
+        Candidates candidates;
+        detect_collision_candidates_rigid(
+            m_assembler, poses, CollisionType::EDGE_EDGE, candidates,
+            DetectionMethod::BVH, /*inflation_radius=*/1e-8);
+
+        const auto& ee_candidates = candidates.ee_candidates;
+        any_of(ee_candidates.size(), [&](size_t i) {
+            const long ea = ee_candidates[i].edge0_index;
+            const long eb = ee_candidates[i].edge1_index;
+            return are_segments_intersecting(
+                vertices.row(edges(ea, 0)).head<2>(),
+                vertices.row(edges(ea, 1)).head<2>(),
+                vertices.row(edges(eb, 0)).head<2>(),
+                vertices.row(edges(eb, 1)).head<2>());
+        });
     } else { // Need to check segment-triangle intersections in 3D
         assert(dim() == 3);
 
@@ -341,17 +852,14 @@ bool RigidBodyProblem::detect_intersections(const PosesD& poses) const
         detect_intersection_candidates_rigid_bvh(
             m_assembler, poses, ef_candidates);
 
-        for (const EdgeFaceCandidate& ef_candidate : ef_candidates) {
-            if (is_edge_intersecting_triangle(
-                    vertices.row(edges(ef_candidate.edge_index, 0)),
-                    vertices.row(edges(ef_candidate.edge_index, 1)),
-                    vertices.row(faces(ef_candidate.face_index, 0)),
-                    vertices.row(faces(ef_candidate.face_index, 1)),
-                    vertices.row(faces(ef_candidate.face_index, 2)))) {
-                is_intersecting = true;
-                break;
-            }
-        }
+        any_of(ef_candidates.size(), [&](size_t i) {
+            const long ei = ef_candidates[i].edge_index;
+            const long fi = ef_candidates[i].face_index;
+            return is_segment_intersecting_triangle(
+                vertices.row(edges(ei, 0)), vertices.row(edges(ei, 1)),
+                vertices.row(faces(fi, 0)), vertices.row(faces(fi, 1)),
+                vertices.row(faces(fi, 2)));
+        });
     }
 
     PROFILE_END();
@@ -359,4 +867,13 @@ bool RigidBodyProblem::detect_intersections(const PosesD& poses) const
     return is_intersecting;
 }
 
+bool RigidBodyProblem::detect_step_intersections(const PosesD& poses)
+{
+    if (++m_num_unchecked_steps < intersection_check_interval) {
+        return false;
+    }
+    m_num_unchecked_steps = 0;
+    return detect_intersections(poses);
+}
+
 } // namespace ipc::rigid
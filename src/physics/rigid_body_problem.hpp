@@ -4,6 +4,7 @@
 
 #include <physics/rigid_body_assembler.hpp>
 #include <physics/simulation_problem.hpp>
+#include <physics/state_output_filter.hpp>
 #include <time_stepper/time_stepper.hpp>
 
 namespace ipc::rigid {
@@ -14,6 +15,13 @@ public:
 
     virtual void init(const std::vector<RigidBody>& rbs);
 
+    /// @brief Spawn a body between steps without re-assembling the scene.
+    /// It gets the last internal and scene index.
+    virtual void add_body(const RigidBody& rb);
+    /// @brief Remove the ith (internal) body between steps without
+    /// re-assembling the scene. The indices after it shift down.
+    virtual void remove_body(size_t i);
+
     virtual ~RigidBodyProblem() = default;
 
     static std::string problem_name() { return "rigid_body_problem"; }
@@ -29,9 +37,26 @@ public:
     virtual bool settings(const nlohmann::json& params) override;
     nlohmann::json settings() const override;
 
-    virtual nlohmann::json state() const override;
+    /// @brief Use bodies built in code (in the scene's order) instead of
+    /// reading params["rigid_bodies"] in the next call to settings().
+    void scene_bodies(std::vector<RigidBody>&& rbs)
+    {
+        m_scene_bodies = std::move(rbs);
+        m_has_scene_bodies = true;
+    }
+
+    nlohmann::json state() const override;
     void state(const nlohmann::json& s) override;
 
+    /// @brief Write the bodies and fields selected by state_output.
+    void state_into(std::vector<double>& buffer) const override;
+    void state_from(const std::vector<double>& buffer) override;
+    nlohmann::json
+    state_to_json(const std::vector<double>& buffer) const override;
+
+    nlohmann::json restart_state() const override;
+    void restart_state(const nlohmann::json& s) override;
+
     virtual double timestep() const override { return m_timestep; }
     virtual void timestep(double timestep) override { m_timestep = timestep; }
 
@@ -45,10 +70,7 @@ public:
     virtual OptimizationResults step_solve();
 
     /// World vertices at the END of step (current).
-    Eigen::MatrixXd vertices() const override
-    {
-        return m_assembler.world_vertices_t1();
-    }
+    Eigen::MatrixXd vertices() const override;
 
     const Eigen::MatrixXi& edges() const override
     {
@@ -78,7 +100,7 @@ public:
     virtual const std::vector<size_t>&
     codim_edges_to_edges(size_t i) const override
     {
-        return m_assembler[i].mesh_selector.codim_edges_to_edges();
+        return m_assembler[i].mesh_selector().codim_edges_to_edges();
     }
 
     const Eigen::MatrixXi& faces(size_t i) const override
@@ -121,6 +143,27 @@ public:
 
     virtual bool is_rb_problem() const override { return true; };
 
+    /// @brief Scene index of each body (bodies are stored in Morton order if
+    /// do_body_reordering is set).
+    const std::vector<int>& body_external_ids() const
+    {
+        return m_body_external_ids;
+    }
+    /// @brief Internal index of each body in the scene's order.
+    std::vector<size_t> body_internal_ids() const;
+
+    /// @brief Permute per-body poses from the internal to the scene order.
+    PosesD external_poses(const PosesD& poses) const;
+    /// @brief Permute per-body poses from the scene to the internal order.
+    PosesD internal_poses(const PosesD& poses) const;
+    /// @brief Permute per-body dof from the internal to the scene order.
+    Eigen::VectorXd external_dofs(const Eigen::VectorXd& x) const;
+    /// @brief Permute per-body dof from the scene to the internal order.
+    Eigen::VectorXd internal_dofs(const Eigen::VectorXd& x) const;
+
+    /// Detect intersections between rigid bodies with given poses.
+    bool detect_intersections(const PosesD& poses) const;
+
     // --------------------------------------------------------------------
     // Settings
     // --------------------------------------------------------------------
@@ -129,9 +172,44 @@ public:
     VectorMax3d gravity;            ///< Acceleration due to gravity
     double collision_eps;           ///< Scale trajectory for early collision
 
+    /// @brief Kinetic energy per unit mass below which a body is at rest
+    /// (non-positive values disable sleeping).
+    double sleep_energy_threshold;
+    /// @brief Steps a body must stay at rest, with the same contacts, to
+    /// fall asleep.
+    int sleep_steps;
+    /// @brief Check the end of every Nth step for intersections (if
+    /// do_intersection_check is set).
+    int intersection_check_interval;
+    /// @brief Sort the bodies along a Morton curve of their positions, so
+    /// nearby bodies have nearby vertices, dof, and Hessian blocks.
+    bool do_body_reordering;
+    /// @brief Re-sort the bodies every Nth step (if do_body_reordering is
+    /// set; non-positive values only sort them when loading the scene).
+    /// The viewer's meshes keep the load-time order, so only headless runs
+    /// should re-sort.
+    int body_reordering_interval;
+    /// @brief Bodies and fields of the saved states.
+    StateOutputFilter m_state_output;
+
     RigidBodyAssembler m_assembler;
 
 protected:
+    /// @brief Write a binary state of all bodies or of the bodies and fields
+    /// selected by state_output.
+    ///
+    /// The buffer starts with the field mask and the number of recorded
+    /// bodies, followed by the scene index and the fields of each one.
+    virtual void
+    write_state(std::vector<double>& buffer, bool is_filtered) const;
+
+    /// @brief Number of values of each body in a binary state (scene index
+    /// and the given fields).
+    size_t body_state_size(int fields) const;
+
+    /// @brief Number of values of the bodies at the start of a binary state.
+    size_t rigid_body_state_size(const std::vector<double>& buffer) const;
+
     /// Moves status to given configuration vector.
     virtual bool take_step(const Eigen::VectorXd& x);
 
@@ -141,11 +219,57 @@ protected:
         const PosesD& poses_t1,
         const CollisionCheck check_type) const;
 
-    /// Detect intersections between rigid bodies with given poses.
-    bool detect_intersections(const PosesD& poses) const;
+    /// @brief Detect intersections at the end of a step, skipping all but
+    /// every intersection_check_interval-th step.
+    bool detect_step_intersections(const PosesD& poses);
 
     virtual void update_dof();
 
+    /// @brief Current world vertices and the DoF they were transformed at,
+    /// so viewers and writers reuse them while the poses are unchanged.
+    mutable Eigen::VectorXd m_vertices_t1_dof;
+    mutable Eigen::MatrixXd m_vertices_t1;
+
+    /// @brief Is sleeping of resting bodies enabled?
+    bool is_sleeping_enabled() const { return sleep_energy_threshold > 0; }
+
+    /// @brief Is the body's kinetic energy (per unit mass) below the sleep
+    /// threshold?
+    bool is_body_resting(const RigidBody& body) const;
+
+    /// @brief Wake the sleeping bodies that a kinematic or moving body
+    /// touches.
+    /// @param body_pairs Pairs of bodies in (or about to be in) contact.
+    /// @returns True if any body woke up.
+    bool wake_sleeping_bodies(
+        const std::vector<std::pair<int, int>>& body_pairs);
+
+    /// @brief Advance the rest counters and put bodies that rested long
+    /// enough to sleep.
+    /// @param contact_pairs Pairs of bodies in contact at the end of the
+    ///                      step.
+    void update_sleeping_bodies(
+        const std::vector<std::pair<int, int>>& contact_pairs);
+
+    /// @brief Bodies in contact with each body at the end of the last step.
+    std::vector<std::vector<int>> m_body_contacts;
+
+    /// @brief Re-sort the bodies along a Morton curve of their positions.
+    /// @returns True if the order changed.
+    virtual bool reorder_bodies();
+
+    /// @brief Re-sort the bodies every body_reordering_interval-th call.
+    void update_body_order();
+
+    /// @brief Bodies given to scene_bodies() for the next settings().
+    std::vector<RigidBody> m_scene_bodies;
+    bool m_has_scene_bodies = false;
+
+    /// @brief Scene index of each body.
+    std::vector<int> m_body_external_ids;
+    /// @brief Steps since the bodies were last sorted.
+    int m_num_unreordered_steps;
+
     /// @returns \f$x_0\f$: the starting point for the optimization.
     const Eigen::VectorXd& starting_point() const { return x0; }
 
@@ -161,6 +285,8 @@ protected:
     double init_bbox_diagonal;
 
     bool do_intersection_check;
+    /// @brief Steps since the last intersection check.
+    int m_num_unchecked_steps;
 };
 
 } // namespace ipc::rigid
@@ -0,0 +1,86 @@
+#include "rotation_diff.hpp"
+
+#include <utils/sinc.hpp>
+
+namespace ipc::rigid {
+
+namespace {
+    MatrixMax3d construct_rotation_matrix_diff_2D(
+        double theta, RotationGradient& grad, RotationHessian* hess)
+    {
+        const double c = cos(theta), s = sin(theta);
+        Eigen::Matrix2d R;
+        R << c, -s, s, c;
+        // ∂R/∂θ = R Hat(1) and ∂²R/∂θ² = -R
+        grad[0] = Eigen::Matrix2d();
+        grad[0] << -s, -c, c, -s;
+        if (hess != nullptr) {
+            (*hess)[0] = -R;
+        }
+        return R;
+    }
+
+    MatrixMax3d construct_rotation_matrix_diff_3D(
+        const Eigen::Vector3d& r, RotationGradient& grad, RotationHessian* hess)
+    {
+        // R = I + a K + b K², where K = Hat(r), a = sinc(‖r‖), and
+        // b = ½ sinc²(‖r‖ / 2) = ½ s².
+        const Eigen::Vector3d half_r = r / 2;
+        const double a = sinc(r.norm());
+        const double s = sinc(half_r.norm());
+        const double b = 0.5 * s * s;
+        const Eigen::Vector3d grad_a = sinc_normx_grad(r);
+        // ∇s = ½ ∇sinc(‖r/2‖)
+        const Eigen::Vector3d grad_s = 0.5 * sinc_normx_grad(half_r);
+        const Eigen::Vector3d grad_b = s * grad_s;
+
+        const Eigen::Matrix3d K = Hat(r);
+        const Eigen::Matrix3d K2 = K * K;
+
+        // Eₖ = ∂K/∂rₖ (constant)
+        std::array<Eigen::Matrix3d, 3> E;
+        // ∂(K²)/∂rₖ = EₖK + KEₖ
+        std::array<Eigen::Matrix3d, 3> dK2;
+        for (int k = 0; k < 3; k++) {
+            E[k] = Hat(Eigen::Vector3d(Eigen::Vector3d::Unit(k)));
+            dK2[k] = E[k] * K + K * E[k];
+            grad[k] = grad_a(k) * K + a * E[k] + grad_b(k) * K2 + b * dK2[k];
+        }
+
+        if (hess != nullptr) {
+            const Eigen::Matrix3d hess_a = sinc_normx_hess(r);
+            // ∇²s = ¼ ∇²sinc(‖r/2‖)
+            const Eigen::Matrix3d hess_s = 0.25 * sinc_normx_hess(half_r);
+            const Eigen::Matrix3d hess_b =
+                grad_s * grad_s.transpose() + s * hess_s;
+
+            for (int k = 0; k < 3; k++) {
+                for (int l = k; l < 3; l++) {
+                    const Eigen::Matrix3d d2R = hess_a(k, l) * K
+                        + grad_a(k) * E[l] + grad_a(l) * E[k]
+                        + hess_b(k, l) * K2 + grad_b(k) * dK2[l]
+                        + grad_b(l) * dK2[k]
+                        + b * (E[k] * E[l] + E[l] * E[k]);
+                    (*hess)[3 * k + l] = d2R;
+                    (*hess)[3 * l + k] = d2R;
+                }
+            }
+        }
+
+        Eigen::Matrix3d R = a * K + b * K2;
+        R.diagonal().array() += 1.0;
+        return R;
+    }
+} // namespace
+
+MatrixMax3d construct_rotation_matrix_diff(
+    const VectorMax3d& r, RotationGradient& grad, RotationHessian* hess)
+{
+    if (r.size() == 1) {
+        return construct_rotation_matrix_diff_2D(r(0), grad, hess);
+    }
+    assert(r.size() == 3);
+    return construct_rotation_matrix_diff_3D(r, grad, hess);
+}
+
+} // namespace ipc::rigid
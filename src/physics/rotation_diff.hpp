@@ -0,0 +1,31 @@
+#pragma once
+
+#include <array>
+
+#include <utils/eigen_ext.hpp>
+
+namespace ipc::rigid {
+
+/// @brief ∂R/∂rᵢ for each rotation dof rᵢ (only the first 1 or 3 are used).
+typedef std::array<MatrixMax3d, 3> RotationGradient;
+/// @brief ∂²R/∂rᵢ∂rⱼ stored at i * r.size() + j.
+typedef std::array<MatrixMax3d, 9> RotationHessian;
+
+/**
+ * @brief Closed-form derivatives of the rotation matrix of a rotation vector.
+ *
+ * Equivalent to differentiating construct_rotation_matrix(r) with autodiff,
+ * but without any heap-allocated scalars. Small angles are handled by the
+ * Taylor expansions of sinc_normx_grad and sinc_normx_hess.
+ *
+ * @param[in]  r     Rotation vector (an angle in 2D).
+ * @param[out] grad  First derivatives of R.
+ * @param[out] hess  Second derivatives of R (skipped if nullptr).
+ * @returns The rotation matrix R(r).
+ */
+MatrixMax3d construct_rotation_matrix_diff(
+    const VectorMax3d& r,
+    RotationGradient& grad,
+    RotationHessian* hess = nullptr);
+
+} // namespace ipc::rigid
@@ -0,0 +1,533 @@
+#include "scene_queries.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#include <tbb/parallel_for.h>
+
+#include <profiler.hpp>
+
+namespace ipc::rigid {
+
+namespace {
+    /// @brief A body or the merged static world at its pose.
+    struct QueryTarget {
+        const RigidBodyGeometry* geometry;
+        /// @brief Rotation from the body's frame to world space
+        MatrixMax3d R;
+        VectorMax3d position;
+        /// @brief Radius of the bounding sphere (infinity for the world)
+        double r_max;
+        /// @brief Id of the body (-1 for the static world)
+        int body_id;
+
+        VectorMax3d to_local(const VectorMax3d& x) const
+        {
+            return R.transpose() * (x - position);
+        }
+        VectorMax3d to_world(const VectorMax3d& x) const
+        {
+            return R * x + position;
+        }
+    };
+
+    std::vector<QueryTarget>
+    query_targets(const RigidBodyAssembler& bodies, const PosesD& poses)
+    {
+        assert(poses.size() == bodies.num_bodies());
+        const int dim = bodies.dim();
+        const StaticWorld& world = bodies.m_static_world;
+        std::vector<QueryTarget> targets;
+        if (!world.empty()) {
+            targets.push_back(
+                { world.geometry.get(), MatrixMax3d::Identity(dim, dim),
+                  VectorMax3d::Zero(dim),
+                  std::numeric_limits<double>::infinity(), -1 });
+        }
+        for (size_t i = 0; i < bodies.num_bodies(); i++) {
+            if (!world.contains(i)) {
+                targets.push_back(
+                    { bodies[i].geometry.get(),
+                      poses[i].construct_rotation_matrix(), poses[i].position,
+                      bodies[i].r_max, int(i) });
+            }
+        }
+        return targets;
+    }
+
+    /// @brief Global ids of a target's vertices, edges, and faces.
+    long global_vertex_id(
+        const RigidBodyAssembler& bodies, const QueryTarget& target, long vi)
+    {
+        return target.body_id < 0
+            ? bodies.m_static_world.vertex_ids[vi]
+            : bodies.m_body_vertex_id[target.body_id] + vi;
+    }
+    long global_edge_id(
+        const RigidBodyAssembler& bodies, const QueryTarget& target, long ei)
+    {
+        return target.body_id < 0 ? bodies.m_static_world.edge_ids[ei]
+                                  : bodies.m_body_edge_id[target.body_id] + ei;
+    }
+    long global_face_id(
+        const RigidBodyAssembler& bodies, const QueryTarget& target, long fi)
+    {
+        return target.body_id < 0 ? bodies.m_static_world.face_ids[fi]
+                                  : bodies.m_body_face_id[target.body_id] + fi;
+    }
+
+    /// @brief Visit the codim vertex, codim edge, or face of a BVH id.
+    template <typename VisitVertex, typename VisitEdge, typename VisitFace>
+    void visit_primitive(
+        const RigidBodyGeometry& geometry,
+        long id,
+        const VisitVertex& visit_vertex,
+        const VisitEdge& visit_edge,
+        const VisitFace& visit_face)
+    {
+        const MeshSelector& selector = geometry.mesh_selector;
+        const long num_codim_vertices = selector.num_codim_vertices();
+        const long num_codim_edges = selector.num_codim_edges();
+        if (id < num_codim_vertices) {
+            visit_vertex(selector.codim_vertices_to_vertices(id));
+        } else if (id < num_codim_vertices + num_codim_edges) {
+            visit_edge(selector.codim_edges_to_edges(id - num_codim_vertices));
+        } else {
+            visit_face(id - num_codim_vertices - num_codim_edges);
+        }
+    }
+
+    /// @brief Does the ray o + t d hit the box for some t ∈ [0, t_max]?
+    template <typename Box>
+    bool ray_hits_box(
+        const VectorMax3d& o,
+        const VectorMax3d& inv_d,
+        const Box& box,
+        double t_max)
+    {
+        const ArrayMax3d min = box.getMin(), max = box.getMax();
+        double t0 = 0, t1 = t_max;
+        for (int i = 0; i < o.size(); i++) {
+            double ta = (min(i) - o(i)) * inv_d(i);
+            double tb = (max(i) - o(i)) * inv_d(i);
+            if (ta > tb) {
+                std::swap(ta, tb);
+            }
+            // NaN (a flat slab containing o) leaves the bounds unchanged
+            t0 = std::max(t0, ta);
+            t1 = std::min(t1, tb);
+            if (t0 > t1) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /// @brief Distance along the ray o + t d to the triangle (infinity if
+    /// the ray misses it).
+    double ray_triangle_distance(
+        const Eigen::Vector3d& o,
+        const Eigen::Vector3d& d,
+        const Eigen::Vector3d& v0,
+        const Eigen::Vector3d& v1,
+        const Eigen::Vector3d& v2)
+    {
+        const Eigen::Vector3d e1 = v1 - v0, e2 = v2 - v0;
+        const Eigen::Vector3d p = d.cross(e2);
+        const double det = e1.dot(p);
+        if (det == 0) {
+            return std::numeric_limits<double>::infinity();
+        }
+        const Eigen::Vector3d s = o - v0;
+        const double u = s.dot(p) / det;
+        if (u < 0 || u > 1) {
+            return std::numeric_limits<double>::infinity();
+        }
+        const Eigen::Vector3d q = s.cross(e1);
+        const double v = d.dot(q) / det;
+        if (v < 0 || u + v > 1) {
+            return std::numeric_limits<double>::infinity();
+        }
+        const double t = e2.dot(q) / det;
+        return t >= 0 ? t : std::numeric_limits<double>::infinity();
+    }
+
+    /// @brief Distance along the 2D ray o + t d to the segment (infinity if
+    /// the ray misses it).
+    double ray_segment_distance(
+        const Eigen::Vector2d& o,
+        const Eigen::Vector2d& d,
+        const Eigen::Vector2d& a,
+        const Eigen::Vector2d& b)
+    {
+        const auto cross = [](const Eigen::Vector2d& u,
+                              const Eigen::Vector2d& v) {
+            return u.x() * v.y() - u.y() * v.x();
+        };
+        const Eigen::Vector2d e = b - a, w = a - o;
+        const double denom = cross(d, e);
+        if (denom == 0) {
+            return std::numeric_limits<double>::infinity();
+        }
+        const double t = cross(w, e) / denom;
+        const double s = cross(w, d) / denom;
+        return t >= 0 && s >= 0 && s <= 1
+            ? t
+            : std::numeric_limits<double>::infinity();
+    }
+
+    VectorMax3d closest_point_on_segment(
+        const VectorMax3d& p, const VectorMax3d& a, const VectorMax3d& b)
+    {
+        const VectorMax3d e = b - a;
+        const double e_sqnorm = e.squaredNorm();
+        if (e_sqnorm == 0) {
+            return a;
+        }
+        return a + std::clamp((p - a).dot(e) / e_sqnorm, 0.0, 1.0) * e;
+    }
+
+    /// @brief Closest point on a triangle (Ericson, Real-Time Collision
+    /// Detection, Section 5.1.5).
+    Eigen::Vector3d closest_point_on_triangle(
+        const Eigen::Vector3d& p,
+        const Eigen::Vector3d& a,
+        const Eigen::Vector3d& b,
+        const Eigen::Vector3d& c)
+    {
+        const Eigen::Vector3d ab = b - a, ac = c - a, ap = p - a;
+        const double d1 = ab.dot(ap), d2 = ac.dot(ap);
+        if (d1 <= 0 && d2 <= 0) {
+            return a;
+        }
+        const Eigen::Vector3d bp = p - b;
+        const double d3 = ab.dot(bp), d4 = ac.dot(bp);
+        if (d3 >= 0 && d4 <= d3) {
+            return b;
+        }
+        const double vc = d1 * d4 - d3 * d2;
+        if (vc <= 0 && d1 >= 0 && d3 <= 0) {
+            return a + d1 / (d1 - d3) * ab;
+        }
+        const Eigen::Vector3d cp = p - c;
+        const double d5 = ab.dot(cp), d6 = ac.dot(cp);
+        if (d6 >= 0 && d5 <= d6) {
+            return c;
+        }
+        const double vb = d5 * d2 - d1 * d6;
+        if (vb <= 0 && d2 >= 0 && d6 <= 0) {
+            return a + d2 / (d2 - d6) * ac;
+        }
+        const double va = d3 * d6 - d5 * d4;
+        if (va <= 0 && d4 - d3 >= 0 && d5 - d6 >= 0) {
+            return b + (d4 - d3) / ((d4 - d3) + (d5 - d6)) * (c - b);
+        }
+        const double denom = va + vb + vc;
+        return a + vb / denom * ab + vc / denom * ac;
+    }
+
+    /// @brief Squared distance from a point to a box.
+    template <typename Box>
+    double point_box_squared_distance(const VectorMax3d& p, const Box& box)
+    {
+        const ArrayMax3d min = box.getMin(), max = box.getMax();
+        return (min - p.array())
+            .max(p.array() - max)
+            .max(0.0)
+            .matrix()
+            .squaredNorm();
+    }
+} // namespace
+
+RayHits raycast(
+    const RigidBodyAssembler& bodies,
+    const PosesD& poses,
+    const Eigen::MatrixXd& origins,
+    const Eigen::MatrixXd& directions,
+    double max_distance)
+{
+    PROFILE_POINT("raycast");
+    PROFILE_START();
+
+    assert(origins.rows() == directions.rows());
+    assert(origins.cols() == bodies.dim() && directions.cols() == bodies.dim());
+    const int dim = bodies.dim();
+    const long num_rays = origins.rows();
+    const std::vector<QueryTarget> targets = query_targets(bodies, poses);
+
+    RayHits hits;
+    hits.distances.setConstant(
+        num_rays, std::numeric_limits<double>::infinity());
+    hits.body_ids.setConstant(num_rays, -1);
+    hits.primitive_ids.setConstant(num_rays, -1);
+    hits.normals.setZero(num_rays, dim);
+
+    tbb::parallel_for(long(0), num_rays, [&](long ri) {
+        const VectorMax3d origin = origins.row(ri).transpose();
+        const double direction_norm = directions.row(ri).norm();
+        if (direction_norm == 0) {
+            return;
+        }
+        const VectorMax3d direction =
+            directions.row(ri).transpose() / direction_norm;
+
+        double& t_max = hits.distances(ri);
+        t_max = max_distance;
+        bool is_hit = false;
+        for (const QueryTarget& target : targets) {
+            // Cull the bodies whose bounding sphere the ray misses
+            const VectorMax3d center_offset = target.position - origin;
+            const double t_center = std::max(center_offset.dot(direction), 0.0);
+            if (t_center - target.r_max > t_max
+                || (center_offset - t_center * direction).squaredNorm()
+                    > target.r_max * target.r_max) {
+                continue;
+            }
+
+            const RigidBodyGeometry& geometry = *target.geometry;
+            const VectorMax3d o = target.to_local(origin);
+            const VectorMax3d d = target.R.transpose() * direction;
+            const VectorMax3d inv_d = d.cwiseInverse();
+            const auto hit = [&](double t, long primitive_id,
+                                 const VectorMax3d& normal) {
+                if (t <= t_max) {
+                    t_max = t;
+                    is_hit = true;
+                    hits.body_ids(ri) = target.body_id;
+                    hits.primitive_ids(ri) = primitive_id;
+                    VectorMax3d n = target.R * normal.normalized();
+                    if (n.dot(direction) > 0) {
+                        n = -n;
+                    }
+                    hits.normals.row(ri) = n.transpose();
+                }
+            };
+
+            geometry.primitive_bvh.query(
+                geometry.bvh_node_aabbs,
+                [&](const BroadPhaseAABB& box) {
+                    return ray_hits_box(o, inv_d, box, t_max);
+                },
+                [&](long id) {
+                    visit_primitive(
+                        geometry, id,
+                        [](long) {}, // Vertices have no area
+                        [&](long ei) {
+                            if (dim != 2) {
+                                return; // Codimensional edges have no area
+                            }
+                            const Eigen::Vector2d a =
+                                geometry.vertices.row(geometry.edges(ei, 0));
+                            const Eigen::Vector2d b =
+                                geometry.vertices.row(geometry.edges(ei, 1));
+                            hit(ray_segment_distance(o, d, a, b),
+                                global_edge_id(bodies, target, ei),
+                                Eigen::Vector2d(a.y() - b.y(), b.x() - a.x()));
+                        },
+                        [&](long fi) {
+                            const Eigen::Vector3d v0 =
+                                geometry.vertices.row(geometry.faces(fi, 0));
+                            const Eigen::Vector3d v1 =
+                                geometry.vertices.row(geometry.faces(fi, 1));
+                            const Eigen::Vector3d v2 =
+                                geometry.vertices.row(geometry.faces(fi, 2));
+                            hit(ray_triangle_distance(o, d, v0, v1, v2),
+                                global_face_id(bodies, target, fi),
+                                (v1 - v0).cross(v2 - v0));
+                        });
+                });
+        }
+
+        if (!is_hit) {
+            t_max = std::numeric_limits<double>::infinity();
+        } else if (hits.body_ids(ri) < 0) {
+            // Hits of the static world belong to one of its bodies
+            hits.body_ids(ri) =
+                dim == 2 ? bodies.edge_id_to_body_id(hits.primitive_ids(ri))
+                         : bodies.face_id_to_body_id(hits.primitive_ids(ri));
+        }
+    });
+
+    PROFILE_END();
+    return hits;
+}
+
+ClosestPoints closest_points(
+    const RigidBodyAssembler& bodies,
+    const PosesD& poses,
+    const Eigen::MatrixXd& points,
+    double max_distance)
+{
+    PROFILE_POINT("closest_points");
+    PROFILE_START();
+
+    assert(points.cols() == bodies.dim());
+    const int dim = bodies.dim();
+    const long num_points = points.rows();
+    const std::vector<QueryTarget> targets = query_targets(bodies, poses);
+
+    ClosestPoints closest;
+    closest.distances.setConstant(
+        num_points, std::numeric_limits<double>::infinity());
+    closest.body_ids.setConstant(num_points, -1);
+    closest.points.setZero(num_points, dim);
+
+    tbb::parallel_for(long(0), num_points, [&](long pi) {
+        const VectorMax3d point = points.row(pi).transpose();
+
+        double best = max_distance;
+        double best_sqdistance = max_distance * max_distance;
+        bool is_found = false;
+        for (const QueryTarget& target : targets) {
+            // Cull the bodies whose bounding sphere is too far
+            if ((target.position - point).norm() - target.r_max > best) {
+                continue;
+            }
+
+            const RigidBodyGeometry& geometry = *target.geometry;
+            const Eigen::MatrixXd& V = geometry.vertices;
+            const VectorMax3d p = target.to_local(point);
+            const auto candidate = [&](const VectorMax3d& q, long vi) {
+                const double sqdistance = (q - p).squaredNorm();
+                if (sqdistance <= best_sqdistance) {
+                    best_sqdistance = sqdistance;
+                    best = std::sqrt(sqdistance);
+                    is_found = true;
+                    closest.points.row(pi) = target.to_world(q).transpose();
+                    // Any vertex of the primitive identifies its body
+                    closest.body_ids(pi) = target.body_id >= 0
+                        ? target.body_id
+                        : bodies.vertex_id_to_body_id(
+                            global_vertex_id(bodies, target, vi));
+                }
+            };
+
+            geometry.primitive_bvh.query(
+                geometry.bvh_node_aabbs,
+                [&](const BroadPhaseAABB& box) {
+                    return point_box_squared_distance(p, box)
+                        <= best_sqdistance;
+                },
+                [&](long id) {
+                    visit_primitive(
+                        geometry, id,
+                        [&](long vi) { candidate(V.row(vi).transpose(), vi); },
+                        [&](long ei) {
+                            const long vi = geometry.edges(ei, 0);
+                            candidate(
+                                closest_point_on_segment(
+                                    p, V.row(vi).transpose(),
+                                    V.row(geometry.edges(ei, 1)).transpose()),
+                                vi);
+                        },
+                        [&](long fi) {
+                            const long vi = geometry.faces(fi, 0);
+                            candidate(
+                                closest_point_on_triangle(
+                                    p, V.row(vi).transpose(),
+                                    V.row(geometry.faces(fi, 1)).transpose(),
+                                    V.row(geometry.faces(fi, 2)).transpose()),
+                                vi);
+                        });
+                });
+        }
+
+        if (is_found) {
+            closest.distances(pi) = best;
+        }
+    });
+
+    PROFILE_END();
+    return closest;
+}
+
+std::vector<std::vector<int>> overlapping_bodies(
+    const RigidBodyAssembler& bodies,
+    const PosesD& poses,
+    const Eigen::MatrixXd& box_min,
+    const Eigen::MatrixXd& box_max)
+{
+    PROFILE_POINT("overlapping_bodies");
+    PROFILE_START();
+
+    assert(box_min.rows() == box_max.rows());
+    assert(box_min.cols() == bodies.dim() && box_max.cols() == bodies.dim());
+    const long num_boxes = box_min.rows();
+    const std::vector<QueryTarget> targets = query_targets(bodies, poses);
+
+    std::vector<std::vector<int>> overlaps(num_boxes);
+    tbb::parallel_for(long(0), num_boxes, [&](long bi) {
+        const VectorMax3d center =
+            (box_min.row(bi) + box_max.row(bi)).transpose() / 2;
+        const VectorMax3d half_extents =
+            (box_max.row(bi) - box_min.row(bi)).transpose() / 2;
+
+        std::vector<int>& body_ids = overlaps[bi];
+        for (const QueryTarget& target : targets) {
+            // Cull the bodies whose bounding sphere is outside the box
+            if (point_box_squared_distance(
+                    target.position,
+                    BroadPhaseAABB(
+                        (center - half_extents).array(),
+                        (center + half_extents).array()))
+                > target.r_max * target.r_max) {
+                continue;
+            }
+
+            // Bound the box in the body's frame
+            const VectorMax3d local_center = target.to_local(center);
+            const VectorMax3d local_half_extents =
+                target.R.transpose().cwiseAbs() * half_extents;
+            const BroadPhaseAABB local_box(
+                (local_center - local_half_extents).array(),
+                (local_center + local_half_extents).array());
+
+            const RigidBodyGeometry& geometry = *target.geometry;
+            // A body is found once, so stop searching it
+            bool is_body_found = false;
+            const auto overlap = [&](const BroadPhaseAABB& box, long vi) {
+                if (!BroadPhaseAABB::are_overlapping(box, local_box)) {
+                    return;
+                }
+                if (target.body_id >= 0) {
+                    is_body_found = true;
+                    body_ids.push_back(target.body_id);
+                } else {
+                    body_ids.push_back(bodies.vertex_id_to_body_id(
+                        global_vertex_id(bodies, target, vi)));
+                }
+            };
+
+            geometry.primitive_bvh.query(
+                geometry.bvh_node_aabbs,
+                [&](const BroadPhaseAABB& box) {
+                    return !is_body_found
+                        && BroadPhaseAABB::are_overlapping(box, local_box);
+                },
+                [&](long id) {
+                    visit_primitive(
+                        geometry, id,
+                        [&](long vi) {
+                            overlap(geometry.vertex_aabbs[vi], vi);
+                        },
+                        [&](long ei) {
+                            overlap(
+                                geometry.edge_aabbs[ei], geometry.edges(ei, 0));
+                        },
+                        [&](long fi) {
+                            overlap(
+                                geometry.face_aabbs[fi], geometry.faces(fi, 0));
+                        });
+                });
+        }
+
+        std::sort(body_ids.begin(), body_ids.end());
+        body_ids.erase(
+            std::unique(body_ids.begin(), body_ids.end()), body_ids.end());
+    });
+
+    PROFILE_END();
+    return overlaps;
+}
+
+} // namespace ipc::rigid
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <limits>
+#include <vector>
+
+#include <Eigen/Core>
+
+#include <physics/rigid_body_assembler.hpp>
+
+namespace ipc::rigid {
+
+/// @brief First hits of a batch of rays (one per row).
+struct RayHits {
+    /// @brief Distance to the hit (infinity if the ray missed)
+    Eigen::VectorXd distances;
+    /// @brief Body hit (-1 if the ray missed)
+    Eigen::VectorXi body_ids;
+    /// @brief Global face (3D) or edge (2D) hit (-1 if the ray missed)
+    Eigen::VectorXi primitive_ids;
+    /// @brief Unit normals of the primitives hit facing the rays (zero if
+    /// the ray missed)
+    Eigen::MatrixXd normals;
+};
+
+/// @brief Closest points on the bodies of a batch of points (one per row).
+struct ClosestPoints {
+    /// @brief Distance to the closest point (infinity if none is closer than
+    /// the maximum distance)
+    Eigen::VectorXd distances;
+    /// @brief Body of the closest point (-1 if there is none)
+    Eigen::VectorXi body_ids;
+    /// @brief Closest points in world space
+    Eigen::MatrixXd points;
+};
+
+// All queries test each body's primitive BVH in its local frame (culling
+// the bodies by their bounding spheres) and the merged static world of the
+// broad phase once. The static bodies are queried at their initial poses.
+// The queries are answered in parallel.
+
+/// @brief Cast a batch of rays against the bodies at the given poses.
+///
+/// @param origins       Origins of the rays (n × dim).
+/// @param directions    Directions of the rays (n × dim, not necessarily
+///                      unit length).
+/// @param max_distance  Largest distance of a hit.
+RayHits raycast(
+    const RigidBodyAssembler& bodies,
+    const PosesD& poses,
+    const Eigen::MatrixXd& origins,
+    const Eigen::MatrixXd& directions,
+    double max_distance = std::numeric_limits<double>::infinity());
+
+/// @brief Find the closest points on the bodies at the given poses.
+///
+/// @param points        Query points (n × dim).
+/// @param max_distance  Largest distance of a closest point.
+ClosestPoints closest_points(
+    const RigidBodyAssembler& bodies,
+    const PosesD& poses,
+    const Eigen::MatrixXd& points,
+    double max_distance = std::numeric_limits<double>::infinity());
+
+/// @brief Find the bodies overlapping a batch of world space boxes.
+///
+/// A body overlaps a box if the box of one of its primitives does, where each
+/// query box is conservatively bounded in the body's frame.
+///
+/// @param box_min  Minimum corners of the boxes (n × dim).
+/// @param box_max  Maximum corners of the boxes (n × dim).
+/// @returns The sorted ids of the bodies overlapping each box.
+std::vector<std::vector<int>> overlapping_bodies(
+    const RigidBodyAssembler& bodies,
+    const PosesD& poses,
+    const Eigen::MatrixXd& box_min,
+    const Eigen::MatrixXd& box_max);
+
+} // namespace ipc::rigid
@@ -37,6 +37,20 @@ public:
     /// Set the state of the simulation
     virtual void state(const nlohmann::json& s) = 0;
 
+    /// @brief Write the state of the simulation to a flat binary buffer
+    /// (reusing its capacity).
+    virtual void state_into(std::vector<double>& buffer) const = 0;
+    /// @brief Set the state of the simulation from a buffer of state_into()
+    virtual void state_from(const std::vector<double>& buffer) = 0;
+    /// @brief JSON of a state written by state_into() (e.g., to save it)
+    virtual nlohmann::json
+    state_to_json(const std::vector<double>& buffer) const = 0;
+
+    /// Get the state needed to restart the simulation without replaying it
+    virtual nlohmann::json restart_state() const { return state(); }
+    /// Restore a state saved by restart_state()
+    virtual void restart_state(const nlohmann::json& s) { state(s); }
+
     virtual double timestep() const = 0;        ///< Get the timestep size
     virtual void timestep(double timestep) = 0; ///< Set the timestep size
 
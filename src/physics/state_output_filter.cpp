@@ -0,0 +1,87 @@
+#include "state_output_filter.hpp"
+
+#include <algorithm>
+
+#include <io/serialize_json.hpp>
+#include <logger.hpp>
+
+namespace ipc::rigid {
+
+const char* StateOutputFilter::FIELD_NAMES[6] = {
+    "position", "rotation", "linear_velocity",
+    "angular_velocity", "Qdot", "Qddot",
+};
+
+bool StateOutputFilter::settings(
+    const nlohmann::json& json, const std::vector<RigidBody>& rbs)
+{
+    m_names = json["bodies"].get<std::vector<std::string>>();
+    m_group_ids = json["group_ids"].get<std::vector<int>>();
+    m_is_selected.clear();
+    if (!m_names.empty() || !m_group_ids.empty()) {
+        m_is_selected.resize(rbs.size(), false);
+        for (size_t i = 0; i < rbs.size(); i++) {
+            m_is_selected[i] =
+                std::find(m_names.begin(), m_names.end(), rbs[i].name)
+                    != m_names.end()
+                || std::find(
+                       m_group_ids.begin(), m_group_ids.end(),
+                       rbs[i].group_id)
+                    != m_group_ids.end();
+        }
+        if (std::none_of(
+                m_is_selected.begin(), m_is_selected.end(),
+                [](bool is_selected) { return is_selected; })) {
+            spdlog::warn("state_output selects none of the bodies");
+        }
+    }
+
+    m_has_region = json["region"].is_object();
+    if (m_has_region) {
+        from_json(json["region"]["min"], m_region_min);
+        from_json(json["region"]["max"], m_region_max);
+        if (m_region_min.size() != m_region_max.size()
+            || (!rbs.empty() && m_region_min.size() != rbs[0].dim())) {
+            spdlog::error("invalid state_output region");
+            return false;
+        }
+    }
+
+    m_fields = 0;
+    for (const auto& jfield : json["fields"]) {
+        const std::string field = jfield.get<std::string>();
+        const auto it = std::find(
+            std::begin(FIELD_NAMES), std::end(FIELD_NAMES), field);
+        if (it == std::end(FIELD_NAMES)) {
+            spdlog::error("unknown state_output field={}", field);
+            return false;
+        }
+        m_fields |= 1 << (it - std::begin(FIELD_NAMES));
+    }
+    if (m_fields == 0) {
+        m_fields = ALL_FIELDS;
+    }
+    return true;
+}
+
+nlohmann::json StateOutputFilter::settings() const
+{
+    nlohmann::json json;
+    json["bodies"] = m_names;
+    json["group_ids"] = m_group_ids;
+    if (m_has_region) {
+        json["region"]["min"] = to_json(m_region_min);
+        json["region"]["max"] = to_json(m_region_max);
+    } else {
+        json["region"] = nullptr;
+    }
+    json["fields"] = nlohmann::json::array();
+    for (int i = 0; i < 6; i++) {
+        if (m_fields & (1 << i)) {
+            json["fields"].push_back(FIELD_NAMES[i]);
+        }
+    }
+    return json;
+}
+
+} // namespace ipc::rigid
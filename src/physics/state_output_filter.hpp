@@ -0,0 +1,70 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <nlohmann/json.hpp>
+
+#include <physics/rigid_body.hpp>
+
+namespace ipc::rigid {
+
+/// @brief Bodies and fields recorded in the saved states of a simulation.
+///
+/// Bodies are selected by name or group id and by their position being in a
+/// region at the time of the capture. Without any selection every body is
+/// recorded. Unrecorded bodies and fields are never copied.
+class StateOutputFilter {
+public:
+    /// @brief Fields of a body state.
+    enum Field {
+        POSITION = 1 << 0,
+        ROTATION = 1 << 1,
+        LINEAR_VELOCITY = 1 << 2,
+        ANGULAR_VELOCITY = 1 << 3,
+        QDOT = 1 << 4,  ///< @brief 3D only
+        QDDOT = 1 << 5, ///< @brief 3D only
+        ALL_FIELDS = (1 << 6) - 1
+    };
+    /// @brief Field names in the order of their bits.
+    static const char* FIELD_NAMES[6];
+
+    /// @brief Read the filter of the bodies of a scene.
+    /// @param rbs Bodies in the scene's order.
+    bool
+    settings(const nlohmann::json& json, const std::vector<RigidBody>& rbs);
+    nlohmann::json settings() const;
+
+    /// @brief Does the filter drop any body or field?
+    bool is_enabled() const
+    {
+        return !m_is_selected.empty() || m_has_region
+            || m_fields != ALL_FIELDS;
+    }
+    int fields() const { return m_fields; }
+    bool has_field(Field field) const { return m_fields & field; }
+
+    /// @brief Is the body with the given scene index recorded at a position?
+    bool is_recorded(size_t external_id, const VectorMax3d& position) const
+    {
+        if (!m_is_selected.empty() && !m_is_selected[external_id]) {
+            return false;
+        }
+        return !m_has_region
+            || ((position.array() >= m_region_min.array()).all()
+                && (position.array() <= m_region_max.array()).all());
+    }
+
+protected:
+    std::vector<std::string> m_names;
+    std::vector<int> m_group_ids;
+    /// @brief Selection of the bodies in the scene's order (empty for all).
+    std::vector<bool> m_is_selected;
+
+    bool m_has_region = false;
+    VectorMax3d m_region_min, m_region_max;
+
+    int m_fields = ALL_FIELDS;
+};
+
+} // namespace ipc::rigid
@@ -0,0 +1,109 @@
+#include "static_world.hpp"
+
+#include <constants.hpp>
+#include <logger.hpp>
+
+namespace ipc::rigid {
+
+void StaticWorld::init(
+    const std::vector<RigidBody>& bodies,
+    const std::vector<long>& body_vertex_id,
+    const std::vector<long>& body_edge_id,
+    const std::vector<long>& body_face_id)
+{
+    geometry = nullptr;
+    vertex_ids.clear();
+    edge_ids.clear();
+    face_ids.clear();
+    m_is_merged.assign(bodies.size(), false);
+    m_num_bodies = 0;
+
+    long num_vertices = 0, num_edges = 0, num_faces = 0;
+    for (size_t i = 0; i < bodies.size(); i++) {
+        const RigidBody& body = bodies[i];
+        if (body.type == RigidBodyType::STATIC && !body.is_sleeping) {
+            m_is_merged[i] = true;
+            m_num_bodies++;
+            num_vertices += body.num_vertices();
+            num_edges += body.num_edges();
+            num_faces += body.num_faces();
+        }
+    }
+    if (m_num_bodies < Constants::STATIC_WORLD_MIN_BODIES) {
+        m_is_merged.assign(bodies.size(), false);
+        m_num_bodies = 0;
+        return;
+    }
+
+    const int dim = bodies[0].dim();
+    Eigen::MatrixXd V(num_vertices, dim);
+    Eigen::MatrixXi E(num_edges, 2), F(num_faces, 3);
+    vertex_ids.reserve(num_vertices);
+    edge_ids.reserve(num_edges);
+    face_ids.reserve(num_faces);
+    for (size_t i = 0; i < bodies.size(); i++) {
+        if (!m_is_merged[i]) {
+            continue;
+        }
+        const RigidBody& body = bodies[i];
+        const long v0 = vertex_ids.size();
+        V.middleRows(v0, body.num_vertices()) = body.world_vertices();
+        if (body.num_edges()) {
+            E.middleRows(edge_ids.size(), body.num_edges()) =
+                body.edges.array() + v0;
+        }
+        if (body.num_faces()) {
+            F.middleRows(face_ids.size(), body.num_faces()) =
+                body.faces.array() + v0;
+        }
+        for (long j = 0; j < body.num_vertices(); j++) {
+            vertex_ids.push_back(body_vertex_id[i] + j);
+        }
+        for (long j = 0; j < body.num_edges(); j++) {
+            edge_ids.push_back(body_edge_id[i] + j);
+        }
+        for (long j = 0; j < body.num_faces(); j++) {
+            face_ids.push_back(body_face_id[i] + j);
+        }
+    }
+
+    // The mesh is already in world space, so the body frame is the identity
+    const int rot_ndof = PoseD::dim_to_rot_ndof(dim);
+    geometry = std::make_shared<const RigidBodyGeometry>(
+        V, V, E, F, /*num_rot_dof_fixed=*/rot_ndof,
+        /*center_of_mass=*/VectorMax3d::Zero(dim), /*volume=*/0,
+        /*moment_of_inertia=*/VectorMax3d::Zero(rot_ndof),
+        /*R0=*/MatrixMax3d::Identity(dim, dim));
+
+    RIGID_IPC_LOG_DEBUG(
+        "static_world num_bodies={:d} num_vertices={:d} num_edges={:d} "
+        "num_faces={:d}",
+        m_num_bodies, num_vertices, num_edges, num_faces);
+}
+
+void StaticWorld::remove_body(
+    size_t body_id,
+    const RigidBody& body,
+    long vertex_id,
+    long edge_id,
+    long face_id)
+{
+    assert(!contains(body_id));
+    if (body_id < m_is_merged.size()) {
+        m_is_merged.erase(m_is_merged.begin() + body_id);
+    }
+
+    // Primitives after the removed body's shift down by its counts
+    const auto shift_ids = [](std::vector<long>& ids, long first, long n) {
+        for (long& id : ids) {
+            if (id >= first) {
+                id -= n;
+            }
+        }
+    };
+    shift_ids(vertex_ids, vertex_id, body.num_vertices());
+    shift_ids(edge_ids, edge_id, body.num_edges());
+    shift_ids(face_ids, face_id, body.num_faces());
+}
+
+} // namespace ipc::rigid
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include <physics/rigid_body.hpp>
+#include <physics/rigid_body_geometry.hpp>
+
+namespace ipc::rigid {
+
+/// @brief The static bodies merged into one world space mesh.
+///
+/// Static bodies never move, so their primitives can share one hierarchy in
+/// world space. Each dynamic body is then queried against it once instead of
+/// being paired with every static body it overlaps.
+class StaticWorld {
+public:
+    /// @brief Merge the static (not sleeping) bodies if there are at least
+    /// Constants::STATIC_WORLD_MIN_BODIES of them.
+    ///
+    /// @param body_vertex_id  Index of each body's first global vertex.
+    /// @param body_edge_id    Index of each body's first global edge.
+    /// @param body_face_id    Index of each body's first global face.
+    void init(
+        const std::vector<RigidBody>& bodies,
+        const std::vector<long>& body_vertex_id,
+        const std::vector<long>& body_edge_id,
+        const std::vector<long>& body_face_id);
+
+    /// @brief Keep the merged ids valid after an unmerged body was appended.
+    void add_body() { m_is_merged.push_back(false); }
+
+    /// @brief Keep the merged ids valid after an unmerged body was removed
+    /// from the global arrays.
+    ///
+    /// @param body_id    Index of the removed body.
+    /// @param body       The removed body.
+    /// @param vertex_id  Index of the body's first global vertex.
+    /// @param edge_id    Index of the body's first global edge.
+    /// @param face_id    Index of the body's first global face.
+    void remove_body(
+        size_t body_id,
+        const RigidBody& body,
+        long vertex_id,
+        long edge_id,
+        long face_id);
+
+    bool empty() const { return geometry == nullptr; }
+    size_t num_bodies() const { return m_num_bodies; }
+
+    /// @brief Is the body part of the merged mesh?
+    bool contains(size_t body_id) const
+    {
+        return !empty() && m_is_merged[body_id];
+    }
+
+    /// @brief Merged mesh with its hierarchy and boxes in world space
+    std::shared_ptr<const RigidBodyGeometry> geometry;
+
+    /// @brief Global ids of the merged vertices, edges, and faces
+    std::vector<long> vertex_ids, edge_ids, face_ids;
+
+protected:
+    std::vector<bool> m_is_merged;
+    size_t m_num_bodies = 0;
+};
+
+} // namespace ipc::rigid
@@ -0,0 +1,51 @@
+#include "world_vertices_diff.hpp"
+
+#include <profiler.hpp>
+
+namespace ipc::rigid {
+
+void WorldVerticesDiff::compute(
+    const RigidBodyAssembler& bodies, const PosesD& poses, bool compute_hess)
+{
+    assert(bodies.num_bodies() == poses.size());
+    PROFILE_POINT("WorldVerticesDiff::compute");
+    PROFILE_START();
+
+    m_bodies = &bodies;
+    m_has_hessian = compute_hess;
+    m_rotations.resize(bodies.num_bodies());
+
+    m_rotations_loop.parallel_for(
+        bodies.num_bodies(), [&](const tbb::blocked_range<size_t>& range) {
+            for (size_t i = range.begin(); i != range.end(); ++i) {
+                RotationDiff& rotation = m_rotations[i];
+                construct_rotation_matrix_diff(
+                    poses[i].rotation, rotation.gradient,
+                    compute_hess ? &rotation.hessian : nullptr);
+            }
+        });
+
+    PROFILE_END();
+}
+
+WorldVerticesDiff::VertexJacobian
+WorldVerticesDiff::vertex_jacobian(long vertex_id) const
+{
+    assert(m_bodies != nullptr);
+    if (m_bodies->dim() == 2) {
+        return vertex_jacobian<2>(vertex_id);
+    }
+    return vertex_jacobian<3>(vertex_id);
+}
+
+MatrixMax6d
+WorldVerticesDiff::vertex_hessian(long vertex_id, const VectorMax3d& w) const
+{
+    assert(m_bodies != nullptr);
+    if (m_bodies->dim() == 2) {
+        return vertex_hessian<2>(vertex_id, w);
+    }
+    return vertex_hessian<3>(vertex_id, w);
+}
+
+} // namespace ipc::rigid
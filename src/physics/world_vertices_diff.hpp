@@ -0,0 +1,89 @@
+#pragma once
+
+#include <vector>
+
+#include <Eigen/Core>
+
+#include <physics/pose.hpp>
+#include <physics/rigid_body_assembler.hpp>
+#include <physics/rotation_diff.hpp>
+#include <utils/eigen_ext.hpp>
+#include <utils/parallel_loop_tuner.hpp>
+
+namespace ipc::rigid {
+
+/// @brief Lazy derivatives of the world vertices w.r.t. the rigid body dof.
+///
+/// Only the rotation matrix of each body and its derivatives are stored.
+/// The Jacobian and Hessian of a vertex are built on demand, so the cost is
+/// proportional to the number of bodies plus the vertices actually queried
+/// (e.g., those of active constraints) instead of all vertices in the scene.
+class WorldVerticesDiff {
+public:
+    /// @brief Jacobian of a vertex (dim × ndof)
+    typedef Eigen::Matrix<
+        double,
+        Eigen::Dynamic,
+        Eigen::Dynamic,
+        Eigen::ColMajor,
+        /*MaxRows=*/3,
+        /*MaxCols=*/6>
+        VertexJacobian;
+
+    /// @brief Fixed-size Jacobian of a vertex of a dim-dimensional body.
+    template <int dim>
+    using FixedVertexJacobian =
+        Eigen::Matrix<double, dim, PoseD::dim_to_ndof(dim)>;
+    /// @brief Fixed-size Hessian of a vertex of a dim-dimensional body.
+    template <int dim>
+    using FixedVertexHessian = Eigen::Matrix<
+        double,
+        PoseD::dim_to_ndof(dim),
+        PoseD::dim_to_ndof(dim)>;
+
+    /// @brief Compute the rotation derivatives of every body.
+    /// @param bodies Bodies of the vertices (must outlive this object).
+    void compute(
+        const RigidBodyAssembler& bodies,
+        const PosesD& poses,
+        bool compute_hess);
+
+    bool has_hessian() const { return m_has_hessian; }
+
+    /// @brief Bytes of the stored rotation derivatives.
+    size_t memory_bytes() const
+    {
+        return m_rotations.capacity() * sizeof(RotationDiff);
+    }
+
+    /// @brief ∇V of a global vertex.
+    VertexJacobian vertex_jacobian(long vertex_id) const;
+
+    /// @brief ∇²(wᵀV) of a global vertex for the given weights w ∈ Rᵈⁱᵐ.
+    MatrixMax6d vertex_hessian(long vertex_id, const VectorMax3d& w) const;
+
+    /// @brief Fixed-size version of vertex_jacobian() for hot kernels.
+    template <int dim>
+    FixedVertexJacobian<dim> vertex_jacobian(long vertex_id) const;
+
+    /// @brief Fixed-size version of vertex_hessian() for hot kernels.
+    template <int dim, typename DerivedW>
+    FixedVertexHessian<dim> vertex_hessian(
+        long vertex_id, const Eigen::MatrixBase<DerivedW>& w) const;
+
+protected:
+    struct RotationDiff {
+        RotationGradient gradient;
+        RotationHessian hessian;
+    };
+
+    const RigidBodyAssembler* m_bodies = nullptr;
+    std::vector<RotationDiff> m_rotations;
+    bool m_has_hessian = false;
+    /// @brief Tuner of the loop over the bodies' rotations.
+    ParallelLoopTuner m_rotations_loop;
+};
+
+} // namespace ipc::rigid
+
+#include "world_vertices_diff.tpp"
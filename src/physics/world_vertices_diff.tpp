@@ -0,0 +1,61 @@
+#pragma once
+#include "world_vertices_diff.hpp"
+
+namespace ipc::rigid {
+
+template <int dim>
+WorldVerticesDiff::FixedVertexJacobian<dim>
+WorldVerticesDiff::vertex_jacobian(long vertex_id) const
+{
+    constexpr int pos_ndof = PoseD::dim_to_pos_ndof(dim);
+    constexpr int rot_ndof = PoseD::dim_to_rot_ndof(dim);
+    assert(m_bodies != nullptr && m_bodies->dim() == dim);
+
+    const long body_id = m_bodies->vertex_id_to_body_id(vertex_id);
+    const RotationDiff& rotation = m_rotations[body_id];
+    const Eigen::Matrix<double, dim, 1> r =
+        (*m_bodies)[body_id]
+            .vertices.row(vertex_id - m_bodies->m_body_vertex_id[body_id])
+            .transpose();
+
+    // ∇V = [I ∂R/∂θ₀r ⋯ ∂R/∂θₖr]
+    FixedVertexJacobian<dim> jac;
+    jac.template leftCols<pos_ndof>().setIdentity();
+    for (int k = 0; k < rot_ndof; k++) {
+        jac.col(pos_ndof + k) =
+            Eigen::Matrix<double, dim, dim>(rotation.gradient[k]) * r;
+    }
+    return jac;
+}
+
+template <int dim, typename DerivedW>
+WorldVerticesDiff::FixedVertexHessian<dim> WorldVerticesDiff::vertex_hessian(
+    long vertex_id, const Eigen::MatrixBase<DerivedW>& w) const
+{
+    constexpr int pos_ndof = PoseD::dim_to_pos_ndof(dim);
+    constexpr int rot_ndof = PoseD::dim_to_rot_ndof(dim);
+    assert(m_bodies != nullptr && m_bodies->dim() == dim && m_has_hessian);
+    assert(w.size() == dim);
+
+    const long body_id = m_bodies->vertex_id_to_body_id(vertex_id);
+    const RotationDiff& rotation = m_rotations[body_id];
+    const Eigen::Matrix<double, dim, 1> r =
+        (*m_bodies)[body_id]
+            .vertices.row(vertex_id - m_bodies->m_body_vertex_id[body_id])
+            .transpose();
+    const Eigen::Matrix<double, dim, 1> w_fixed = w;
+
+    // The position is linear, so only the rotational block is nonzero.
+    FixedVertexHessian<dim> hess = FixedVertexHessian<dim>::Zero();
+    for (int k = 0; k < rot_ndof; k++) {
+        for (int l = 0; l < rot_ndof; l++) {
+            hess(pos_ndof + k, pos_ndof + l) = w_fixed.dot(
+                Eigen::Matrix<double, dim, dim>(
+                    rotation.hessian[k * rot_ndof + l])
+                * r);
+        }
+    }
+    return hess;
+}
+
+} // namespace ipc::rigid
@@ -128,6 +128,15 @@ public:
             /*compute_grad=*/true, /*compute_hess=*/false);
     }
 
+    /// @brief Number of active barriers at x.
+    /// Override to avoid evaluating the barrier term.
+    virtual int num_active_barriers(const Eigen::VectorXd& x)
+    {
+        int num_constraints;
+        compute_barrier_term(x, num_constraints);
+        return num_constraints;
+    }
+
     virtual bool is_barrier_problem() const override { return true; }
 
     /// Compute the value of the barrier hessian at a value x
@@ -135,6 +144,11 @@ public:
 
     virtual double barrier_activation_distance() const = 0;
     virtual void barrier_activation_distance(const double dhat) = 0;
+    /// @brief Smallest d̂ of any contact (e.g., with per body d̂).
+    virtual double min_barrier_activation_distance() const
+    {
+        return barrier_activation_distance();
+    }
 
     virtual double barrier_stiffness() const = 0;
     virtual void barrier_stiffness(const double kappa) = 0;
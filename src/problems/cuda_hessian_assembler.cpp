@@ -0,0 +1,355 @@
+#include "cuda_hessian_assembler.hpp"
+
+#include <algorithm>
+#include <numeric>
+
+#include <cublas_v2.h>
+#include <cuda_runtime.h>
+#include <cusolverDn.h>
+#include <cusparse.h>
+#include <spdlog/spdlog.h>
+
+namespace ipc::rigid {
+
+namespace {
+    bool check(cudaError_t status, const char* call)
+    {
+        if (status != cudaSuccess) {
+            spdlog::error(
+                "failure=\"{}\" cuda_error=\"{}\"", call,
+                cudaGetErrorString(status));
+        }
+        return status == cudaSuccess;
+    }
+
+    bool check(cublasStatus_t status, const char* call)
+    {
+        if (status != CUBLAS_STATUS_SUCCESS) {
+            spdlog::error(
+                "failure=\"{}\" cublas_error={:d}", call, int(status));
+        }
+        return status == CUBLAS_STATUS_SUCCESS;
+    }
+
+    bool check(cusolverStatus_t status, const char* call)
+    {
+        if (status != CUSOLVER_STATUS_SUCCESS) {
+            spdlog::error(
+                "failure=\"{}\" cusolver_error={:d}", call, int(status));
+        }
+        return status == CUSOLVER_STATUS_SUCCESS;
+    }
+
+    bool check(cusparseStatus_t status, const char* call)
+    {
+        if (status != CUSPARSE_STATUS_SUCCESS) {
+            spdlog::error(
+                "failure=\"{}\" cusparse_error=\"{}\"", call,
+                cusparseGetErrorString(status));
+        }
+        return status == CUSPARSE_STATUS_SUCCESS;
+    }
+} // namespace
+
+#define CUDA_HESSIAN_CHECK(call)                                               \
+    if (!check(call, #call)) {                                                 \
+        return false;                                                          \
+    }
+
+/// @brief Device array that only grows.
+template <typename T> struct DeviceBuffer {
+    T* data = nullptr;
+    size_t capacity = 0;
+
+    ~DeviceBuffer() { cudaFree(data); }
+
+    bool reserve(size_t count)
+    {
+        if (count <= capacity) {
+            return true;
+        }
+        cudaFree(data);
+        data = nullptr;
+        capacity = 0;
+        CUDA_HESSIAN_CHECK(cudaMalloc(&data, count * sizeof(T)));
+        capacity = count;
+        return true;
+    }
+
+    bool upload(const T* values, size_t count, size_t offset = 0)
+    {
+        assert(offset + count <= capacity);
+        CUDA_HESSIAN_CHECK(cudaMemcpy(
+            data + offset, values, count * sizeof(T),
+            cudaMemcpyHostToDevice));
+        return true;
+    }
+
+    bool download(T* values, size_t count) const
+    {
+        CUDA_HESSIAN_CHECK(cudaMemcpy(
+            values, data, count * sizeof(T), cudaMemcpyDeviceToHost));
+        return true;
+    }
+};
+
+struct CudaHessianAssembler::DeviceData {
+    cublasHandle_t cublas = nullptr;
+    cusolverDnHandle_t cusolver = nullptr;
+    cusparseHandle_t cusparse = nullptr;
+    syevjInfo_t syevj_params = nullptr;
+
+    /// @brief Local inputs, products, and projections (n² per constraint).
+    DeviceBuffer<double> hessians, jacobians, products, locals, scaled,
+        projected;
+    DeviceBuffer<double> eigenvalues, work;
+    DeviceBuffer<int> info;
+    /// @brief Assembly matrix (one weighted entry per local entry).
+    DeviceBuffer<int> outer, inner;
+    DeviceBuffer<double> weights;
+    /// @brief Number of outer indices already filled with 0, 1, 2, ...
+    size_t num_outer = 0;
+    DeviceBuffer<double> values;
+    DeviceBuffer<char> spmv_buffer;
+
+    ~DeviceData()
+    {
+        if (syevj_params) {
+            cusolverDnDestroySyevjInfo(syevj_params);
+        }
+        if (cusparse) {
+            cusparseDestroy(cusparse);
+        }
+        if (cusolver) {
+            cusolverDnDestroy(cusolver);
+        }
+        if (cublas) {
+            cublasDestroy(cublas);
+        }
+    }
+
+    bool initialize()
+    {
+        if (cublas && cusolver && cusparse && syevj_params) {
+            return true;
+        }
+        CUDA_HESSIAN_CHECK(cublasCreate(&cublas));
+        CUDA_HESSIAN_CHECK(cusolverDnCreate(&cusolver));
+        CUDA_HESSIAN_CHECK(cusparseCreate(&cusparse));
+        CUDA_HESSIAN_CHECK(cusolverDnCreateSyevjInfo(&syevj_params));
+        return true;
+    }
+
+    bool reserve(size_t num_constraints, int n, size_t num_values)
+    {
+        const size_t count = num_constraints * n * n;
+        for (DeviceBuffer<double>* buffer :
+             { &hessians, &jacobians, &products, &locals, &scaled, &projected,
+               &weights }) {
+            if (!buffer->reserve(count)) {
+                return false;
+            }
+        }
+        if (!eigenvalues.reserve(num_constraints * n)
+            || !info.reserve(num_constraints) || !inner.reserve(count)
+            || !values.reserve(std::max(num_values, size_t(1)))) {
+            return false;
+        }
+        if (num_outer < count + 1) {
+            std::vector<int> iota(count + 1);
+            std::iota(iota.begin(), iota.end(), 0);
+            num_outer = 0; // The buffer may move
+            if (!outer.reserve(count + 1)
+                || !outer.upload(iota.data(), iota.size())) {
+                return false;
+            }
+            num_outer = count + 1;
+        }
+        return true;
+    }
+};
+
+CudaHessianAssembler::CudaHessianAssembler()
+    : m_device(std::make_unique<DeviceData>())
+{
+}
+
+CudaHessianAssembler::~CudaHessianAssembler() = default;
+
+bool CudaHessianAssembler::assemble(
+    const std::vector<const LocalHessianBatch*>& batches,
+    double scale,
+    bool lower_triangular,
+    BlockSparseSkeleton& hessian)
+{
+    size_t num_constraints = 0;
+    int n = 0;
+    for (const LocalHessianBatch* batch : batches) {
+        num_constraints += batch->size();
+        if (batch->size() > 0) {
+            assert(n == 0 || n == batch->n);
+            n = batch->n;
+        }
+    }
+    if (num_constraints == 0) {
+        return true;
+    }
+    assert(n == 2 * hessian.block_size());
+    const int ndof = hessian.block_size();
+    const size_t n2 = n * n, count = num_constraints * n2;
+    const size_t num_values = hessian.matrix().nonZeros();
+
+    DeviceData& device = *m_device;
+    if (!device.initialize()
+        || !device.reserve(num_constraints, n, num_values)) {
+        return false;
+    }
+
+    size_t offset = 0;
+    for (const LocalHessianBatch* batch : batches) {
+        const size_t size = batch->hessians.size();
+        if (size == 0) {
+            continue;
+        }
+        if (!device.hessians.upload(batch->hessians.data(), size, offset)
+            || !device.jacobians.upload(batch->jacobians.data(), size, offset)
+            || !device.locals.upload(batch->offsets.data(), size, offset)) {
+            return false;
+        }
+        offset += size;
+    }
+
+    // Local hessians Jᵀ H J + offset
+    const double one = 1, zero = 0;
+    CUDA_HESSIAN_CHECK(cublasDgemmStridedBatched(
+        device.cublas, CUBLAS_OP_N, CUBLAS_OP_N, n, n, n, &one,
+        device.hessians.data, n, n2, device.jacobians.data, n, n2, &zero,
+        device.products.data, n, n2, num_constraints));
+    CUDA_HESSIAN_CHECK(cublasDgemmStridedBatched(
+        device.cublas, CUBLAS_OP_T, CUBLAS_OP_N, n, n, n, &one,
+        device.jacobians.data, n, n2, device.products.data, n, n2, &one,
+        device.locals.data, n, n2, num_constraints));
+
+    // Projection to the PSD cone: V max(Λ, 0) Vᵀ where V overwrites the
+    // local hessians
+    int lwork = 0;
+    CUDA_HESSIAN_CHECK(cusolverDnDsyevjBatched_bufferSize(
+        device.cusolver, CUSOLVER_EIG_MODE_VECTOR, CUBLAS_FILL_MODE_LOWER, n,
+        device.locals.data, n, device.eigenvalues.data, &lwork,
+        device.syevj_params, num_constraints));
+    if (!device.work.reserve(std::max(lwork, 1))) {
+        return false;
+    }
+    CUDA_HESSIAN_CHECK(cusolverDnDsyevjBatched(
+        device.cusolver, CUSOLVER_EIG_MODE_VECTOR, CUBLAS_FILL_MODE_LOWER, n,
+        device.locals.data, n, device.eigenvalues.data, device.work.data,
+        lwork, device.info.data, device.syevj_params, num_constraints));
+
+    m_info.resize(num_constraints);
+    m_eigenvalues.resize(num_constraints * n);
+    if (!device.info.download(m_info.data(), m_info.size())
+        || !device.eigenvalues.download(
+            m_eigenvalues.data(), m_eigenvalues.size())) {
+        return false;
+    }
+    if (std::any_of(m_info.begin(), m_info.end(), [](int i) {
+            return i != 0;
+        })) {
+        spdlog::warn(
+            "failure=\"batched eigendecomposition of the contact hessians "
+            "did not converge\" failsafe=\"host assembly\"");
+        return false;
+    }
+    for (double& eigenvalue : m_eigenvalues) {
+        eigenvalue = std::max(eigenvalue, 0.0);
+    }
+    if (!device.eigenvalues.upload(
+            m_eigenvalues.data(), m_eigenvalues.size())) {
+        return false;
+    }
+    // The eigenvectors of all constraints side by side are an n × nN matrix
+    CUDA_HESSIAN_CHECK(cublasDdgmm(
+        device.cublas, CUBLAS_SIDE_RIGHT, n, n * num_constraints,
+        device.locals.data, n, device.eigenvalues.data, 1,
+        device.scaled.data, n));
+    CUDA_HESSIAN_CHECK(cublasDgemmStridedBatched(
+        device.cublas, CUBLAS_OP_N, CUBLAS_OP_T, n, n, n, &one,
+        device.scaled.data, n, n2, device.locals.data, n, n2, &zero,
+        device.projected.data, n, n2, num_constraints));
+
+    // Value of each local entry (blocks above the diagonal get no weight)
+    m_destinations.resize(count);
+    m_weights.resize(count);
+    size_t k = 0;
+    for (const LocalHessianBatch* batch : batches) {
+        for (const std::array<long, 2>& body_ids : batch->body_ids) {
+            long block_ids[2][2];
+            for (int b_i = 0; b_i < 2; b_i++) {
+                for (int b_j = 0; b_j < 2; b_j++) {
+                    block_ids[b_i][b_j] =
+                        lower_triangular && body_ids[b_i] < body_ids[b_j]
+                        ? -1
+                        : hessian.find_block(body_ids[b_i], body_ids[b_j]);
+                }
+            }
+            for (int c = 0; c < n; c++) {
+                for (int r = 0; r < n; r++, k++) {
+                    const long block_id = block_ids[r / ndof][c / ndof];
+                    m_destinations[k] = block_id < 0
+                        ? 0
+                        : hessian.value_index(block_id, r % ndof, c % ndof);
+                    m_weights[k] = block_id < 0 ? 0 : 1;
+                }
+            }
+        }
+    }
+    assert(k == count);
+    if (!device.inner.upload(m_destinations.data(), count)
+        || !device.weights.upload(m_weights.data(), count)
+        || !device.values.upload(hessian.values(), num_values)) {
+        return false;
+    }
+
+    // values += scale Sᵀ projected, where row k of S holds the weight of
+    // local entry k in the column of its value
+    cusparseSpMatDescr_t S = nullptr;
+    cusparseDnVecDescr_t x = nullptr, y = nullptr;
+    CUDA_HESSIAN_CHECK(cusparseCreateCsr(
+        &S, count, num_values, count, device.outer.data, device.inner.data,
+        device.weights.data, CUSPARSE_INDEX_32I, CUSPARSE_INDEX_32I,
+        CUSPARSE_INDEX_BASE_ZERO, CUDA_R_64F));
+    bool success =
+        check(
+            cusparseCreateDnVec(&x, count, device.projected.data, CUDA_R_64F),
+            "cusparseCreateDnVec")
+        && check(
+            cusparseCreateDnVec(&y, num_values, device.values.data, CUDA_R_64F),
+            "cusparseCreateDnVec");
+    size_t buffer_size = 0;
+    success = success
+        && check(
+                  cusparseSpMV_bufferSize(
+                      device.cusparse, CUSPARSE_OPERATION_TRANSPOSE, &scale, S,
+                      x, &one, y, CUDA_R_64F, CUSPARSE_SPMV_ALG_DEFAULT,
+                      &buffer_size),
+                  "cusparseSpMV_bufferSize")
+        && device.spmv_buffer.reserve(std::max(buffer_size, size_t(1)))
+        && check(
+                  cusparseSpMV(
+                      device.cusparse, CUSPARSE_OPERATION_TRANSPOSE, &scale, S,
+                      x, &one, y, CUDA_R_64F, CUSPARSE_SPMV_ALG_DEFAULT,
+                      device.spmv_buffer.data),
+                  "cusparseSpMV");
+    for (cusparseDnVecDescr_t descr : { x, y }) {
+        if (descr) {
+            cusparseDestroyDnVec(descr);
+        }
+    }
+    cusparseDestroySpMat(S);
+
+    return success && device.values.download(hessian.values(), num_values);
+}
+
+#undef CUDA_HESSIAN_CHECK
+
+} // namespace ipc::rigid
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <array>
+#include <memory>
+#include <vector>
+
+#include <Eigen/Core>
+
+#include <utils/block_sparse_skeleton.hpp>
+
+namespace ipc::rigid {
+
+/// @brief Chain rule inputs of the contact hessians of one thread, stored
+/// so the products and PSD projections can be computed in a batch.
+///
+/// Every local matrix is padded to n × n with n = 2·rb_ndof, which is also
+/// the most vertex DoF of a constraint (6 in 2D and 12 in 3D). Matrices are
+/// stored one after the other in column-major order.
+struct LocalHessianBatch {
+    /// @brief Remove all entries while keeping the allocated capacity.
+    void clear()
+    {
+        hessians.clear();
+        jacobians.clear();
+        offsets.clear();
+        body_ids.clear();
+    }
+
+    size_t size() const { return body_ids.size(); }
+
+    /// @brief Store the local hessian Jᵀ H J + offset of one constraint.
+    /// @param hess_f  Hessian wrt. the constraint's vertex DoF.
+    /// @param jac     Jacobian of the vertex DoF wrt. the DoF of both bodies.
+    /// @param offset  Second order terms of the rigid motions.
+    template <typename DerivedH, typename DerivedJ, typename DerivedO>
+    void add(
+        const Eigen::MatrixBase<DerivedH>& hess_f,
+        const Eigen::MatrixBase<DerivedJ>& jac,
+        const Eigen::MatrixBase<DerivedO>& offset,
+        const std::array<long, 2>& constraint_body_ids)
+    {
+        assert(size() == 0 || n == jac.cols());
+        assert(hess_f.rows() == jac.rows() && jac.rows() <= jac.cols());
+        n = jac.cols();
+        const size_t begin = hessians.size();
+        hessians.resize(begin + n * n, 0.0);
+        jacobians.resize(begin + n * n, 0.0);
+        offsets.resize(begin + n * n);
+        Matrix(hessians.data() + begin, n, n)
+            .topLeftCorner(hess_f.rows(), hess_f.cols()) = hess_f;
+        Matrix(jacobians.data() + begin, n, n).topRows(jac.rows()) = jac;
+        Matrix(offsets.data() + begin, n, n) = offset;
+        body_ids.push_back(constraint_body_ids);
+    }
+
+    /// @brief Local hessian of the i-th constraint (not projected).
+    Eigen::MatrixXd local_hessian(size_t i) const
+    {
+        const ConstMatrix H(hessians.data() + i * n * n, n, n);
+        const ConstMatrix J(jacobians.data() + i * n * n, n, n);
+        return J.transpose() * H * J
+            + ConstMatrix(offsets.data() + i * n * n, n, n);
+    }
+
+    int n = 0;
+    std::vector<double> hessians, jacobians, offsets;
+    std::vector<std::array<long, 2>> body_ids;
+
+protected:
+    typedef Eigen::Map<Eigen::MatrixXd> Matrix;
+    typedef Eigen::Map<const Eigen::MatrixXd> ConstMatrix;
+};
+
+/// @brief Contact hessian assembly on the GPU (cuBLAS, cuSOLVER, and
+/// cuSPARSE).
+///
+/// The chain rule products of all constraints are batched matrix products,
+/// the PSD projections are a batched Jacobi eigendecomposition, and the
+/// scatter to the hessian blocks is a sparse product with the 0/1 matrix
+/// mapping local entries to values. Only the local inputs are uploaded and
+/// only the values of the hessian are downloaded. The device buffers only
+/// grow, so repeated assemblies do not allocate.
+///
+/// Only available when built with RIGID_IPC_WITH_CUDA.
+class CudaHessianAssembler {
+public:
+    CudaHessianAssembler();
+    ~CudaHessianAssembler();
+    CudaHessianAssembler(const CudaHessianAssembler&) = delete;
+    CudaHessianAssembler& operator=(const CudaHessianAssembler&) = delete;
+
+    /// @brief Add scale times the PSD projected local hessians of the
+    /// batches to their blocks of the hessian.
+    /// @param lower_triangular  Skip the blocks above the block diagonal.
+    /// @returns False if the device could not be used (the hessian is then
+    /// unchanged).
+    bool assemble(
+        const std::vector<const LocalHessianBatch*>& batches,
+        double scale,
+        bool lower_triangular,
+        BlockSparseSkeleton& hessian);
+
+protected:
+    /// @brief Device buffers and library handles (defined with CUDA only).
+    struct DeviceData;
+    std::unique_ptr<DeviceData> m_device;
+
+    /// @brief Hessian value of each local entry and its 0/1 weight.
+    std::vector<int> m_destinations;
+    std::vector<double> m_weights;
+    std::vector<double> m_eigenvalues;
+    std::vector<int> m_info;
+};
+
+} // namespace ipc::rigid
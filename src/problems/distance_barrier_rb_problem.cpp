@@ -1,8 +1,15 @@
 #include "distance_barrier_rb_problem.hpp"
 
+#include <algorithm>
+#include <cmath>
+
 #include <tbb/enumerable_thread_specific.h>
 #include <tbb/parallel_for.h>
+#include <tbb/task_arena.h>
+
+#include <Eigen/Cholesky>
 
+#include <ipc/barrier/barrier.hpp>
 #include <ipc/distance/edge_edge.hpp>
 #include <ipc/distance/edge_edge_mollifier.hpp>
 #include <ipc/distance/point_triangle.hpp>
@@ -14,11 +21,20 @@
 
 #include <constants.hpp>
 #include <geometry/distance.hpp>
+#include <io/serialize_json.hpp>
+#include <physics/rotation_diff.hpp>
 #include <solvers/solver_factory.hpp>
+#include <utils/block_sparse_skeleton.hpp>
+#include <utils/determinism.hpp>
+#include <utils/dispatch_dim.hpp>
+#include <utils/memory_usage.hpp>
 #include <utils/not_implemented_error.hpp>
+#include <utils/numa.hpp>
+#include <utils/step_metrics.hpp>
 
 #include <logger.hpp>
 #include <profiler.hpp>
+#include <tracer.hpp>
 
 namespace ipc::rigid {
 
@@ -28,6 +44,18 @@ DistanceBarrierRBProblem::DistanceBarrierRBProblem()
     , m_had_collisions(false)
     , static_friction_speed_bound(1e-3)
     , friction_iterations(1)
+    , friction_relinearization_tolerance(0)
+    , friction_normal_force_threshold(0)
+    , dropped_friction_normal_force(0)
+    , record_contact_forces(false)
+    , warm_start_order(0)
+    , lazy_psd_projection(false)
+    , lower_triangular_hessian(false)
+    , gpu_hessian_assembly(false)
+    , colored_hessian_assembly(false)
+    , prescribe_kinematic_bodies(false)
+    , multirate_displacement_threshold(0)
+    , multirate_max_substeps(8)
     , body_energy_integration_method(DEFAULT_BODY_ENERGY_INTEGRATION_METHOD)
 {
 }
@@ -35,6 +63,7 @@ DistanceBarrierRBProblem::DistanceBarrierRBProblem()
 bool DistanceBarrierRBProblem::settings(const nlohmann::json& params)
 {
     m_constraint.settings(params["distance_barrier_constraint"]);
+    m_constraint.deterministic = params["deterministic"];
     // Select the optimization solver
     std::string solver_name = params["solver"].get<std::string>();
     m_opt_solver = SolverFactory::factory().get_barrier_solver(solver_name);
@@ -49,6 +78,37 @@ bool DistanceBarrierRBProblem::settings(const nlohmann::json& params)
     static_friction_speed_bound =
         params["friction_constraints"]["static_friction_speed_bound"];
     friction_iterations = params["friction_constraints"]["iterations"];
+    friction_relinearization_tolerance =
+        params["friction_constraints"]["relinearization_tolerance"];
+    friction_normal_force_threshold =
+        params["friction_constraints"]["normal_force_threshold"];
+    linearized_friction.clear();
+
+    warm_start_order = params["rigid_body_problem"]["warm_start_order"];
+    lazy_psd_projection =
+        params["rigid_body_problem"]["lazy_psd_projection"];
+    lower_triangular_hessian =
+        params["rigid_body_problem"]["lower_triangular_hessian"];
+    gpu_hessian_assembly = params["rigid_body_problem"]["gpu_hessian_assembly"];
+#ifndef RIGID_IPC_WITH_CUDA
+    if (gpu_hessian_assembly) {
+        spdlog::warn(
+            "gpu_hessian_assembly requires RIGID_IPC_WITH_CUDA; assembling "
+            "the hessian on the host");
+    }
+#endif
+    colored_hessian_assembly =
+        params["rigid_body_problem"]["colored_hessian_assembly"];
+    prescribe_kinematic_bodies =
+        params["rigid_body_problem"]["prescribe_kinematic_bodies"];
+    multirate_displacement_threshold =
+        params["rigid_body_problem"]["multirate_displacement_threshold"];
+    multirate_max_substeps =
+        params["rigid_body_problem"]["multirate_max_substeps"];
+    record_contact_forces =
+        params["rigid_body_problem"]["record_contact_forces"];
+    prev_correction.resize(0);
+    prev_prev_correction.resize(0);
 
     body_energy_integration_method =
         params["rigid_body_problem"]["time_stepper"]
@@ -84,21 +144,110 @@ nlohmann::json DistanceBarrierRBProblem::settings() const
     nlohmann::json json = RigidBodyProblem::settings();
     json["friction_iterations"] = friction_iterations;
     json["static_friction_speed_bound"] = static_friction_speed_bound;
+    json["friction_relinearization_tolerance"] =
+        friction_relinearization_tolerance;
+    json["friction_normal_force_threshold"] = friction_normal_force_threshold;
     json["time_stepper"] = body_energy_integration_method;
+    json["warm_start_order"] = warm_start_order;
+    json["lazy_psd_projection"] = lazy_psd_projection;
+    json["lower_triangular_hessian"] = lower_triangular_hessian;
+    json["gpu_hessian_assembly"] = gpu_hessian_assembly;
+    json["colored_hessian_assembly"] = colored_hessian_assembly;
+    json["prescribe_kinematic_bodies"] = prescribe_kinematic_bodies;
+    json["multirate_displacement_threshold"] =
+        multirate_displacement_threshold;
+    json["multirate_max_substeps"] = multirate_max_substeps;
+    json["record_contact_forces"] = record_contact_forces;
     return json;
 }
 
-nlohmann::json DistanceBarrierRBProblem::state() const
+void DistanceBarrierRBProblem::write_state(
+    std::vector<double>& buffer, bool is_filtered) const
 {
-    nlohmann::json json = RigidBodyProblem::state();
-    if (min_distance < 0) {
+    RigidBodyProblem::write_state(buffer, is_filtered);
+    buffer.push_back(min_distance);
+    if (!record_contact_forces) {
+        return;
+    }
+
+    // Number of contacts followed by the bodies, point, normal, normal force
+    // and friction force of each contact
+    const ContactForces& contacts = m_contact_forces;
+    buffer.push_back(contacts.size());
+    const auto append_row = [&](const Eigen::MatrixXd& values, size_t ci) {
+        for (int j = 0; j < values.cols(); j++) {
+            buffer.push_back(values(ci, j));
+        }
+    };
+    for (size_t ci = 0; ci < contacts.size(); ci++) {
+        buffer.push_back(m_body_external_ids[contacts.body_ids(ci, 0)]);
+        buffer.push_back(m_body_external_ids[contacts.body_ids(ci, 1)]);
+        append_row(contacts.points, ci);
+        append_row(contacts.normals, ci);
+        buffer.push_back(contacts.normal_forces[ci]);
+        append_row(contacts.friction_forces, ci);
+    }
+}
+
+nlohmann::json DistanceBarrierRBProblem::state_to_json(
+    const std::vector<double>& buffer) const
+{
+    nlohmann::json json = RigidBodyProblem::state_to_json(buffer);
+    // The minimum distance follows the bodies
+    const size_t i = rigid_body_state_size(buffer);
+    if (buffer.size() <= i || buffer[i] < 0) {
         json["min_distance"] = nullptr;
     } else {
-        json["min_distance"] = min_distance;
+        json["min_distance"] = buffer[i];
+    }
+
+    // The contacts (if recorded) follow the minimum distance
+    if (buffer.size() <= i + 1) {
+        return json;
     }
+    const size_t num_contacts = size_t(buffer[i + 1]);
+    const double* values = buffer.data() + i + 2;
+    const auto read = [&](int size) {
+        const Eigen::Map<const Eigen::VectorXd> x(values, size);
+        values += size;
+        return to_json(x);
+    };
+    json["contacts"] = nlohmann::json::array();
+    for (size_t ci = 0; ci < num_contacts; ci++) {
+        nlohmann::json jcontact;
+        jcontact["body_ids"] = { int(values[0]), int(values[1]) };
+        values += 2;
+        jcontact["point"] = read(dim());
+        jcontact["normal"] = read(dim());
+        jcontact["normal_force"] = *values++;
+        jcontact["friction_force"] = read(dim());
+        json["contacts"].push_back(jcontact);
+    }
+    return json;
+}
+
+nlohmann::json DistanceBarrierRBProblem::restart_state() const
+{
+    // Friction and augmented Lagrangian multipliers are recomputed from the
+    // start of each time-step, so only the warm start history is needed.
+    nlohmann::json json = RigidBodyProblem::restart_state();
+    json["prev_correction"] = to_json(external_dofs(prev_correction));
+    json["prev_prev_correction"] =
+        to_json(external_dofs(prev_prev_correction));
     return json;
 }
 
+void DistanceBarrierRBProblem::restart_state(const nlohmann::json& s)
+{
+    RigidBodyProblem::restart_state(s);
+    if (s.contains("prev_correction")) {
+        from_json(s["prev_correction"], prev_correction);
+        from_json(s["prev_prev_correction"], prev_prev_correction);
+        prev_correction = internal_dofs(prev_correction);
+        prev_prev_correction = internal_dofs(prev_prev_correction);
+    }
+}
+
 Eigen::VectorXi DistanceBarrierRBProblem::free_dof() const
 {
     const VectorXb& is_dof_fixed = this->is_dof_fixed();
@@ -117,6 +266,36 @@ Eigen::VectorXi DistanceBarrierRBProblem::free_dof() const
 
 void DistanceBarrierRBProblem::simulation_step(
     bool& had_collisions, bool& _has_intersections, bool solve_collisions)
+{
+    update_body_order();
+
+    if (is_sleeping_enabled()) {
+        wake_sleeping_bodies(m_assembler.close_bodies(
+            m_assembler.rb_poses_t1(), predicted_poses(),
+            barrier_activation_distance()));
+    }
+
+    int num_substeps = 1;
+    std::vector<size_t> fast_ids;
+    if (is_multirate_enabled()) {
+        fast_ids = fast_bodies(num_substeps);
+    }
+    if (num_substeps > 1) {
+        multirate_step(
+            fast_ids, num_substeps, had_collisions, _has_intersections,
+            solve_collisions);
+    } else {
+        solve_step(had_collisions, _has_intersections, solve_collisions);
+    }
+    record_memory_usage();
+
+    if (is_sleeping_enabled()) {
+        update_sleeping_bodies(contact_body_pairs(opt_result.x));
+    }
+}
+
+void DistanceBarrierRBProblem::solve_step(
+    bool& had_collisions, bool& _has_intersections, bool solve_collisions)
 {
     // Advance the poses, but leave the current pose unchanged for now.
     for (size_t i = 0; i < num_bodies(); i++) {
@@ -142,6 +321,227 @@ void DistanceBarrierRBProblem::simulation_step(
     had_collisions = m_had_collisions;
 }
 
+std::vector<size_t>
+DistanceBarrierRBProblem::fast_bodies(int& num_substeps) const
+{
+    std::vector<size_t> fast_ids;
+    double max_displacement = 0;
+    for (size_t i = 0; i < num_bodies(); i++) {
+        const RigidBody& body = m_assembler[i];
+        if (body.type != RigidBodyType::DYNAMIC) {
+            continue;
+        }
+        const double displacement = body.step_displacement(timestep());
+        if (displacement > multirate_displacement_threshold) {
+            fast_ids.push_back(i);
+            max_displacement = std::max(max_displacement, displacement);
+        }
+    }
+    num_substeps = std::min(
+        multirate_max_substeps,
+        int(std::ceil(max_displacement / multirate_displacement_threshold)));
+    num_substeps = std::max(num_substeps, 1);
+    return fast_ids;
+}
+
+void DistanceBarrierRBProblem::multirate_step(
+    const std::vector<size_t>& fast_ids,
+    int num_substeps,
+    bool& had_collisions,
+    bool& _has_intersections,
+    bool solve_collisions)
+{
+    const double h = timestep();
+    std::vector<bool> is_fast(num_bodies(), false);
+    for (size_t i : fast_ids) {
+        is_fast[i] = true;
+    }
+    std::vector<bool> is_slow(num_bodies(), false);
+    bool has_moving_slow_bodies = false;
+    for (size_t i = 0; i < num_bodies(); i++) {
+        is_slow[i] = !is_fast[i];
+        has_moving_slow_bodies |=
+            is_slow[i] && m_assembler[i].type != RigidBodyType::STATIC;
+    }
+    RIGID_IPC_LOG_DEBUG(
+        "multirate_step num_fast_bodies={:d} num_substeps={:d}",
+        fast_ids.size(), num_substeps);
+
+    // The lagged friction and warm start history assume a fixed step length
+    linearized_friction.clear();
+    prev_correction.resize(0);
+    prev_prev_correction.resize(0);
+
+    int num_iterations = 0, num_line_search_failures = 0;
+    bool success = true;
+    had_collisions = _has_intersections = false;
+    const auto solve_stage = [&]() {
+        bool stage_had_collisions, stage_has_intersections;
+        solve_step(
+            stage_had_collisions, stage_has_intersections, solve_collisions);
+        had_collisions |= stage_had_collisions;
+        _has_intersections |= stage_has_intersections;
+        num_iterations += opt_result.num_iterations;
+        num_line_search_failures += opt_result.num_line_search_failures;
+        success &= opt_result.success;
+    };
+
+    // Substep the fast bodies while the other bodies (including the
+    // kinematic ones) stay at the start of the step
+    freeze_bodies(is_slow);
+    timestep(h / num_substeps);
+    for (int i = 0; i < num_substeps; i++) {
+        solve_stage();
+    }
+    thaw_bodies();
+    timestep(h);
+
+    if (has_moving_slow_bodies) {
+        // The fast bodies keep the history of their last substep
+        PosesD fast_poses_prev(num_bodies()),
+            fast_velocities_prev(num_bodies());
+        for (size_t i : fast_ids) {
+            fast_poses_prev[i] = m_assembler[i].pose_prev;
+            fast_velocities_prev[i] = m_assembler[i].velocity_prev;
+        }
+
+        // Step the other bodies against the fast bodies at the end of the
+        // step
+        linearized_friction.clear();
+        freeze_bodies(is_fast);
+        solve_stage();
+        thaw_bodies();
+
+        for (size_t i : fast_ids) {
+            m_assembler[i].pose_prev = fast_poses_prev[i];
+            m_assembler[i].velocity_prev = fast_velocities_prev[i];
+        }
+    }
+    linearized_friction.clear();
+    prev_correction.resize(0);
+    prev_prev_correction.resize(0);
+
+    opt_result.num_iterations = num_iterations;
+    opt_result.num_line_search_failures = num_line_search_failures;
+    opt_result.success = success;
+}
+
+void DistanceBarrierRBProblem::freeze_bodies(
+    const std::vector<bool>& is_selected)
+{
+    for (size_t i = 0; i < num_bodies(); i++) {
+        if (is_selected[i] && m_assembler[i].type != RigidBodyType::STATIC) {
+            m_assembler[i].freeze();
+        }
+    }
+    m_assembler.update_dof_fixed(); // Update the collision masks
+}
+
+void DistanceBarrierRBProblem::thaw_bodies()
+{
+    for (size_t i = 0; i < num_bodies(); i++) {
+        if (m_assembler[i].is_frozen) {
+            m_assembler[i].thaw();
+        }
+    }
+    m_assembler.update_dof_fixed(); // Update the collision masks
+}
+
+void DistanceBarrierRBProblem::record_memory_usage() const
+{
+    size_t kinematics_bytes = MemoryUsage::bytes_of(m_vertices_t0);
+    size_t constraints_bytes =
+        MemoryUsage::constraints_bytes(friction_constraints)
+        + MemoryUsage::bytes_of(friction_constraint_indices);
+    for (const KinematicsCache& cache : m_kinematics_caches) {
+        kinematics_bytes += MemoryUsage::bytes_of(cache.V)
+            + cache.V_diff.memory_bytes() + MemoryUsage::bytes_of(cache.poses);
+        constraints_bytes += MemoryUsage::constraints_bytes(cache.constraints)
+            + MemoryUsage::bytes_of(cache.barrier_weights)
+            + MemoryUsage::bytes_of(cache.constraint_indices);
+    }
+    MemoryUsage::set_bytes(MemoryUsage::WORLD_VERTICES_DIFF, kinematics_bytes);
+    MemoryUsage::set_bytes(MemoryUsage::CONSTRAINTS, constraints_bytes);
+}
+
+PosesD DistanceBarrierRBProblem::predicted_poses() const
+{
+    PosesD poses = m_assembler.rb_poses_t1();
+    for (int i = 0; i < num_bodies(); i++) {
+        const RigidBody& body = m_assembler[i];
+        PoseD kinematic_pose;
+        if (body.type == RigidBodyType::KINEMATIC
+            && body.next_kinematic_pose(timestep(), kinematic_pose)) {
+            poses[i] = kinematic_pose;
+        } else if (body.type != RigidBodyType::STATIC) {
+            poses[i].position += timestep() * body.velocity.position;
+            poses[i].rotation += timestep() * body.velocity.rotation;
+        }
+    }
+    return poses;
+}
+
+std::vector<std::pair<int, int>>
+DistanceBarrierRBProblem::contact_body_pairs(const Eigen::VectorXd& x) const
+{
+    if (!m_use_barriers) {
+        return {};
+    }
+
+    std::vector<std::pair<int, int>> pairs;
+    const Constraints& constraints = cached_constraint_set(x);
+    for (size_t ci = 0; ci < constraints.size(); ci++) {
+        const std::array<long, 2> ids = body_ids(m_assembler, constraints, ci);
+        pairs.emplace_back(
+            std::min(ids[0], ids[1]), std::max(ids[0], ids[1]));
+    }
+    std::sort(pairs.begin(), pairs.end());
+    pairs.erase(std::unique(pairs.begin(), pairs.end()), pairs.end());
+    return pairs;
+}
+
+void DistanceBarrierRBProblem::update_dof()
+{
+    RigidBodyProblem::update_dof();
+    // The start of the time-step changed
+    clear_kinematics_cache();
+}
+
+bool DistanceBarrierRBProblem::reorder_bodies()
+{
+    const Eigen::VectorXd external_prev_correction =
+        external_dofs(prev_correction);
+    const Eigen::VectorXd external_prev_prev_correction =
+        external_dofs(prev_prev_correction);
+    if (!RigidBodyProblem::reorder_bodies()) {
+        return false;
+    }
+    prev_correction = internal_dofs(external_prev_correction);
+    prev_prev_correction = internal_dofs(external_prev_prev_correction);
+    // The reused friction contacts refer to the old vertex ids
+    linearized_friction.clear();
+    return true;
+}
+
+void DistanceBarrierRBProblem::add_body(const RigidBody& rb)
+{
+    RigidBodyProblem::add_body(rb);
+    prev_correction.resize(0);
+    prev_prev_correction.resize(0);
+    // The reused friction contacts refer to the old vertex ids
+    linearized_friction.clear();
+}
+
+void DistanceBarrierRBProblem::remove_body(size_t i)
+{
+    RigidBodyProblem::remove_body(i);
+    prev_correction.resize(0);
+    prev_prev_correction.resize(0);
+    linearized_friction.clear();
+    // The recorded contacts refer to the old body ids
+    m_contact_forces.clear(dim());
+}
+
 void DistanceBarrierRBProblem::update_constraints()
 {
     PROFILE_POINT("DistanceBarrierRBProblem::update_constraints");
@@ -150,23 +550,176 @@ void DistanceBarrierRBProblem::update_constraints()
     RigidBodyProblem::update_constraints();
 
     Constraints collision_constraints;
+    std::vector<double> barrier_weights;
     m_constraint.construct_constraint_set(
-        m_assembler, poses_t0, collision_constraints);
+        m_assembler, poses_t0, collision_constraints, &barrier_weights);
 
     Eigen::SparseMatrix<double> hess;
     compute_barrier_term(
-        x0, collision_constraints, grad_barrier_t0, hess,
+        x0, collision_constraints, barrier_weights, grad_barrier_t0, hess,
         /*compute_grad=*/true, /*compute_hess=*/false);
 
-    update_friction_constraints(collision_constraints, poses_t0);
+    update_friction_constraints(
+        collision_constraints, barrier_weights, vertices_t0());
 
     init_augmented_lagrangian();
 
     PROFILE_END();
 }
 
+void LinearizedFrictionContacts::clear()
+{
+    vv_contacts.clear();
+    ev_contacts.clear();
+    ee_contacts.clear();
+    fv_contacts.clear();
+    dhat = barrier_stiffness = coefficient_friction = -1;
+}
+
+void ContactForces::clear(int dim)
+{
+    body_ids.resize(0, 2);
+    points.resize(0, dim);
+    normals.resize(0, dim);
+    normal_forces.resize(0);
+    friction_forces.resize(0, dim);
+}
+
+// Stack the positions of the given vertices
+Eigen::VectorXd
+gather_vertices(const Eigen::MatrixXd& V, const std::vector<long>& vertex_ids)
+{
+    Eigen::VectorXd vertices(V.cols() * vertex_ids.size());
+    for (int i = 0; i < vertex_ids.size(); i++) {
+        vertices.segment(V.cols() * i, V.cols()) =
+            V.row(vertex_ids[i]).transpose();
+    }
+    return vertices;
+}
+
+// Reuse the linearized friction of the contacts that did not move more than
+// the given distance, and collect the others (and their barrier weights if
+// any) for relinearization.
+template <typename Key, typename Contacts, typename FrictionConstraint>
+void reuse_linearized_friction(
+    const Contacts& contacts,
+    const double* barrier_weights,
+    const Eigen::MatrixXd& V,
+    const Eigen::MatrixXi& E,
+    const Eigen::MatrixXi& F,
+    const double max_displacement,
+    const Key& key,
+    LinearizedFrictionContacts::ContactMap<FrictionConstraint>& linearized,
+    Contacts& relinearized_contacts,
+    std::vector<double>& relinearized_weights,
+    std::vector<FrictionConstraint>& friction_constraints)
+{
+    LinearizedFrictionContacts::ContactMap<FrictionConstraint> reused;
+    for (size_t i = 0; i < contacts.size(); i++) {
+        const auto& contact = contacts[i];
+        auto it = linearized.find(key(contact));
+        if (it != linearized.end()
+            && (gather_vertices(V, contact.vertex_indices(E, F))
+                - it->second.vertices)
+                    .template lpNorm<Eigen::Infinity>()
+                <= max_displacement) {
+            friction_constraints.push_back(it->second.constraint);
+            // Keep the original vertices, so small motions do not accumulate
+            reused.insert(linearized.extract(it));
+        } else {
+            relinearized_contacts.push_back(contact);
+            if (barrier_weights != nullptr) {
+                relinearized_weights.push_back(barrier_weights[i]);
+            }
+        }
+    }
+    // Drop the contacts that are no longer active
+    linearized = std::move(reused);
+}
+
+// Scale the normal forces of the friction constraints by the barrier weights
+// of their collision constraints (in the same [vv, ev, ee, fv] order).
+void scale_normal_forces(
+    const std::vector<double>& barrier_weights,
+    FrictionConstraints& friction_constraints)
+{
+    if (barrier_weights.empty()) {
+        return;
+    }
+    assert(barrier_weights.size() == friction_constraints.size());
+    size_t ci = 0;
+    const auto scale = [&](auto& constraints) {
+        for (auto& constraint : constraints) {
+            constraint.normal_force_magnitude *= barrier_weights[ci++];
+        }
+    };
+    scale(friction_constraints.vv_constraints);
+    scale(friction_constraints.ev_constraints);
+    scale(friction_constraints.ee_constraints);
+    scale(friction_constraints.fv_constraints);
+}
+
+// Store newly linearized friction contacts
+template <typename Key, typename FrictionConstraint>
+void store_linearized_friction(
+    const std::vector<FrictionConstraint>& friction_constraints,
+    const Eigen::MatrixXd& V,
+    const Eigen::MatrixXi& E,
+    const Eigen::MatrixXi& F,
+    const Key& key,
+    LinearizedFrictionContacts::ContactMap<FrictionConstraint>& linearized)
+{
+    for (const auto& constraint : friction_constraints) {
+        linearized[key(constraint)] = {
+            constraint, gather_vertices(V, constraint.vertex_indices(E, F))
+        };
+    }
+}
+
+std::vector<double> DistanceBarrierRBProblem::normal_force_weights(
+    const Constraints& collision_constraints,
+    const std::vector<double>& barrier_weights,
+    const Eigen::MatrixXd& V0) const
+{
+    if (!m_constraint.per_body_activation_distance) {
+        return barrier_weights;
+    }
+
+    const double dhat = barrier_activation_distance();
+    const double dmin = m_constraint.minimum_separation_distance;
+    std::vector<double> weights(collision_constraints.size(), 1.0);
+    size_t ci = 0;
+    const auto scale = [&](const auto& constraints) {
+        for (const auto& constraint : constraints) {
+            const auto [body0, body1] =
+                body_ids(m_assembler, collision_constraints, ci);
+            const double pair_dhat = m_constraint.pair_activation_distance(
+                m_assembler, body0, body1);
+            // Same barrier arguments as the constraint potentials
+            const double x = constraint.compute_distance(V0, edges(), faces())
+                - dmin * dmin;
+            const double grad =
+                ipc::barrier_gradient(x, 2 * dmin * dhat + dhat * dhat);
+            const double pair_grad = ipc::barrier_gradient(
+                x, 2 * dmin * pair_dhat + pair_dhat * pair_dhat);
+            if (!barrier_weights.empty()) {
+                weights[ci] = barrier_weights[ci];
+            }
+            weights[ci] *= grad == 0 ? 0 : pair_grad / grad;
+            ci++;
+        }
+    };
+    scale(collision_constraints.vv_constraints);
+    scale(collision_constraints.ev_constraints);
+    scale(collision_constraints.ee_constraints);
+    scale(collision_constraints.fv_constraints);
+    return weights;
+}
+
 void DistanceBarrierRBProblem::update_friction_constraints(
-    const Constraints& collision_constraints, const PosesD& poses)
+    const Constraints& collision_constraints,
+    const std::vector<double>& barrier_weights,
+    const Eigen::MatrixXd& V0)
 {
     if (coefficient_friction <= 0) {
         return;
@@ -178,15 +731,334 @@ void DistanceBarrierRBProblem::update_friction_constraints(
     // The fricition constraints are constant through out the entire
     // lagging iteration.
     friction_constraints.clear();
-    Eigen::MatrixXd V0 = m_assembler.world_vertices(poses);
+
+    if (friction_relinearization_tolerance <= 0) {
+        construct_friction_constraint_set(
+            V0, edges(), faces(), collision_constraints,
+            barrier_activation_distance(), barrier_stiffness(),
+            coefficient_friction, friction_constraints);
+        scale_normal_forces(
+            normal_force_weights(collision_constraints, barrier_weights, V0),
+            friction_constraints);
+        drop_negligible_friction_contacts();
+        build_constraint_indices(
+            m_assembler, friction_constraints, friction_constraint_indices);
+        PROFILE_END();
+        return;
+    }
+
+    LinearizedFrictionContacts& linearized = linearized_friction;
+    if (linearized.dhat != barrier_activation_distance()
+        || linearized.barrier_stiffness != barrier_stiffness()
+        || linearized.coefficient_friction != coefficient_friction) {
+        linearized.clear();
+        linearized.dhat = barrier_activation_distance();
+        linearized.barrier_stiffness = barrier_stiffness();
+        linearized.coefficient_friction = coefficient_friction;
+    }
+
+    const auto vv_key = [](const auto& c) -> std::array<long, 2> {
+        return { { c.vertex0_index, c.vertex1_index } };
+    };
+    const auto ev_key = [](const auto& c) -> std::array<long, 2> {
+        return { { c.edge_index, c.vertex_index } };
+    };
+    const auto ee_key = [](const auto& c) -> std::array<long, 2> {
+        return { { c.edge0_index, c.edge1_index } };
+    };
+    const auto fv_key = [](const auto& c) -> std::array<long, 2> {
+        return { { c.face_index, c.vertex_index } };
+    };
+
+    const double max_displacement =
+        friction_relinearization_tolerance * barrier_activation_distance();
+    // The weights of the reused contacts are the ones they were linearized
+    // with, like their normal forces.
+    const auto type_weights = [&](size_t offset) -> const double* {
+        return barrier_weights.empty() ? nullptr
+                                       : barrier_weights.data() + offset;
+    };
+    const size_t ev_offset = collision_constraints.vv_constraints.size();
+    const size_t ee_offset =
+        ev_offset + collision_constraints.ev_constraints.size();
+    const size_t fv_offset =
+        ee_offset + collision_constraints.ee_constraints.size();
+    Constraints relinearized_constraints;
+    std::vector<double> relinearized_weights;
+    reuse_linearized_friction(
+        collision_constraints.vv_constraints, type_weights(0), V0, edges(),
+        faces(), max_displacement, vv_key, linearized.vv_contacts,
+        relinearized_constraints.vv_constraints, relinearized_weights,
+        friction_constraints.vv_constraints);
+    reuse_linearized_friction(
+        collision_constraints.ev_constraints, type_weights(ev_offset), V0,
+        edges(), faces(), max_displacement, ev_key, linearized.ev_contacts,
+        relinearized_constraints.ev_constraints, relinearized_weights,
+        friction_constraints.ev_constraints);
+    reuse_linearized_friction(
+        collision_constraints.ee_constraints, type_weights(ee_offset), V0,
+        edges(), faces(), max_displacement, ee_key, linearized.ee_contacts,
+        relinearized_constraints.ee_constraints, relinearized_weights,
+        friction_constraints.ee_constraints);
+    reuse_linearized_friction(
+        collision_constraints.fv_constraints, type_weights(fv_offset), V0,
+        edges(), faces(), max_displacement, fv_key, linearized.fv_contacts,
+        relinearized_constraints.fv_constraints, relinearized_weights,
+        friction_constraints.fv_constraints);
+
+    FrictionConstraints relinearized;
     construct_friction_constraint_set(
-        V0, edges(), faces(), collision_constraints,
+        V0, edges(), faces(), relinearized_constraints,
         barrier_activation_distance(), barrier_stiffness(),
-        coefficient_friction, friction_constraints);
+        coefficient_friction, relinearized);
+    scale_normal_forces(
+        normal_force_weights(
+            relinearized_constraints, relinearized_weights, V0),
+        relinearized);
+
+    store_linearized_friction(
+        relinearized.vv_constraints, V0, edges(), faces(), vv_key,
+        linearized.vv_contacts);
+    store_linearized_friction(
+        relinearized.ev_constraints, V0, edges(), faces(), ev_key,
+        linearized.ev_contacts);
+    store_linearized_friction(
+        relinearized.ee_constraints, V0, edges(), faces(), ee_key,
+        linearized.ee_contacts);
+    store_linearized_friction(
+        relinearized.fv_constraints, V0, edges(), faces(), fv_key,
+        linearized.fv_contacts);
+
+    const auto append = [](auto& constraints, const auto& new_constraints) {
+        constraints.insert(
+            constraints.end(), new_constraints.begin(), new_constraints.end());
+    };
+    append(friction_constraints.vv_constraints, relinearized.vv_constraints);
+    append(friction_constraints.ev_constraints, relinearized.ev_constraints);
+    append(friction_constraints.ee_constraints, relinearized.ee_constraints);
+    append(friction_constraints.fv_constraints, relinearized.fv_constraints);
+
+    RIGID_IPC_LOG_DEBUG(
+        "friction_relinearization num_relinearized={:d} num_reused={:d}",
+        relinearized.size(), friction_constraints.size() - relinearized.size());
+
+    drop_negligible_friction_contacts();
+    build_constraint_indices(
+        m_assembler, friction_constraints, friction_constraint_indices);
+
+    PROFILE_END();
+}
+
+void DistanceBarrierRBProblem::drop_negligible_friction_contacts()
+{
+    dropped_friction_normal_force = 0;
+    if (friction_normal_force_threshold <= 0) {
+        return;
+    }
+
+    double max_normal_force = 0;
+    const auto find_max = [&](const auto& constraints) {
+        for (const auto& constraint : constraints) {
+            max_normal_force =
+                std::max(max_normal_force, constraint.normal_force_magnitude);
+        }
+    };
+    find_max(friction_constraints.vv_constraints);
+    find_max(friction_constraints.ev_constraints);
+    find_max(friction_constraints.ee_constraints);
+    find_max(friction_constraints.fv_constraints);
+
+    const double min_normal_force =
+        friction_normal_force_threshold * max_normal_force;
+    size_t num_dropped = 0;
+    const auto drop = [&](auto& constraints) {
+        const auto end = std::remove_if(
+            constraints.begin(), constraints.end(), [&](const auto& c) {
+                if (c.normal_force_magnitude >= min_normal_force) {
+                    return false;
+                }
+                dropped_friction_normal_force += c.normal_force_magnitude;
+                return true;
+            });
+        num_dropped += constraints.end() - end;
+        constraints.erase(end, constraints.end());
+    };
+    drop(friction_constraints.vv_constraints);
+    drop(friction_constraints.ev_constraints);
+    drop(friction_constraints.ee_constraints);
+    drop(friction_constraints.fv_constraints);
+
+    StepMetrics::add_count(StepMetrics::DROPPED_FRICTION_CONTACTS, num_dropped);
+    RIGID_IPC_LOG_DEBUG(
+        "friction_drop num_dropped={:d} num_kept={:d} "
+        "dropped_normal_force={:g} max_normal_force={:g}",
+        num_dropped, friction_constraints.size(),
+        dropped_friction_normal_force, max_normal_force);
+}
+
+double DistanceBarrierRBProblem::dropped_friction_energy_bound(
+    const Eigen::MatrixXd& V1) const
+{
+    if (dropped_friction_normal_force <= 0) {
+        return 0;
+    }
+    // The relative displacement of a contact is at most twice the largest
+    // vertex displacement, and f₀(y) ≤ y + ε_v h / 3.
+    const Eigen::MatrixXd U = V1 - vertices_t0();
+    const double max_displacement = U.rowwise().norm().maxCoeff();
+    const double epsv_times_h = static_friction_speed_bound * timestep();
+    return coefficient_friction * dropped_friction_normal_force
+        * (2 * max_displacement + epsv_times_h / 3);
+}
+
+void DistanceBarrierRBProblem::update_contact_forces(
+    const Constraints& collision_constraints,
+    const std::vector<double>& barrier_weights,
+    const Eigen::MatrixXd& V1)
+{
+    PROFILE_POINT("DistanceBarrierRBProblem::update_contact_forces");
+    PROFILE_START();
+
+    const int dim = this->dim();
+    const size_t num_contacts = collision_constraints.size();
+    ContactForces& contacts = m_contact_forces;
+    contacts.body_ids.resize(num_contacts, 2);
+    contacts.points.resize(num_contacts, dim);
+    contacts.normals.resize(num_contacts, dim);
+    contacts.normal_forces.resize(num_contacts);
+    contacts.friction_forces.setZero(num_contacts, dim);
+
+    std::vector<ConstraintIndices> indices;
+    build_constraint_indices(m_assembler, collision_constraints, indices);
+
+    // The objective's gradients are the forces times -h²
+    const double h2 = timestep() * timestep();
+    const auto body0_force = [&](const VectorMax12d& grad,
+                                 const ConstraintIndices& constraint_indices) {
+        VectorMax3d force = VectorMax3d::Zero(dim);
+        for (int i = 0; i < constraint_indices.num_vertices; i++) {
+            if (constraint_indices.local_body_ids[i] == 0) {
+                force -= grad.segment(dim * i, dim);
+            }
+        }
+        return VectorMax3d(force / h2);
+    };
+
+    // Contacts by their vertices to find their friction
+    std::map<std::array<long, 4>, size_t> contact_ids;
+    size_t ci = 0;
+    const auto record = [&](const auto& constraints) {
+        for (const auto& constraint : constraints) {
+            const ConstraintIndices& constraint_indices = indices[ci];
+            const auto [body0, body1] = constraint_indices.body_ids;
+            double dhat = barrier_activation_distance();
+            if (m_constraint.per_body_activation_distance) {
+                dhat = m_constraint.pair_activation_distance(
+                    m_assembler, body0, body1);
+            }
+            const double weight = barrier_stiffness()
+                * (barrier_weights.empty() ? 1 : barrier_weights[ci]);
+            const VectorMax12d grad = weight
+                * constraint.compute_potential_gradient(
+                    V1, edges(), faces(), dhat);
+            const VectorMax3d force = body0_force(grad, constraint_indices);
+
+            // Average the vertices by the magnitude of their forces
+            VectorMax3d point = VectorMax3d::Zero(dim);
+            double total_weight = 0;
+            for (int i = 0; i < constraint_indices.num_vertices; i++) {
+                const double w = grad.segment(dim * i, dim).norm();
+                const long vi = constraint_indices.vertex_ids[i];
+                point += w * V1.row(vi).transpose();
+                total_weight += w;
+            }
+            if (total_weight <= 0) {
+                point.setZero();
+                for (int i = 0; i < constraint_indices.num_vertices; i++) {
+                    const long vi = constraint_indices.vertex_ids[i];
+                    point += V1.row(vi).transpose();
+                }
+                total_weight = constraint_indices.num_vertices;
+            }
+
+            contacts.body_ids.row(ci) << int(body0), int(body1);
+            contacts.points.row(ci) = point.transpose() / total_weight;
+            contacts.normal_forces[ci] = force.norm();
+            if (contacts.normal_forces[ci] > 0) {
+                contacts.normals.row(ci) =
+                    force.transpose() / contacts.normal_forces[ci];
+            } else {
+                contacts.normals.row(ci).setZero();
+            }
+            contact_ids.emplace(constraint_indices.vertex_ids, ci);
+            ci++;
+        }
+    };
+    record(collision_constraints.vv_constraints);
+    record(collision_constraints.ev_constraints);
+    record(collision_constraints.ee_constraints);
+    record(collision_constraints.fv_constraints);
+
+    if (coefficient_friction <= 0 || friction_constraints.size() == 0) {
+        PROFILE_END();
+        return;
+    }
+
+    // Same displacements as compute_friction_term()
+    const Eigen::MatrixXd U = V1 - vertices_t0();
+    const double epsv_times_h = static_friction_speed_bound * timestep();
+    assert(friction_constraint_indices.size() == friction_constraints.size());
+    size_t fi = 0;
+    const auto record_friction = [&](const auto& constraints) {
+        for (const auto& constraint : constraints) {
+            const ConstraintIndices& constraint_indices =
+                friction_constraint_indices[fi++];
+            const auto it = contact_ids.find(constraint_indices.vertex_ids);
+            if (it == contact_ids.end()) {
+                continue; // The lagged contact is no longer active
+            }
+            const VectorMax3d force = body0_force(
+                constraint.compute_potential_gradient(
+                    U, edges(), faces(), epsv_times_h),
+                constraint_indices);
+            contacts.friction_forces.row(it->second) = force.transpose();
+        }
+    };
+    record_friction(friction_constraints.vv_constraints);
+    record_friction(friction_constraints.ev_constraints);
+    record_friction(friction_constraints.ee_constraints);
+    record_friction(friction_constraints.fv_constraints);
 
     PROFILE_END();
 }
 
+inline DiagonalMatrix3d compute_J(const VectorMax3d& I)
+{
+    return DiagonalMatrix3d(
+        0.5 * (-I.x() + I.y() + I.z()), //
+        0.5 * (I.x() - I.y() + I.z()),  //
+        0.5 * (I.x() + I.y() - I.z()));
+}
+
+inline DiagonalMatrix3d compute_Jinv(const VectorMax3d& I)
+{
+    return DiagonalMatrix3d(
+        2 / (-I.x() + I.y() + I.z()), //
+        2 / (I.x() - I.y() + I.z()),  //
+        2 / (I.x() + I.y() - I.z()));
+}
+
+inline DiagonalMatrix3d compute_Jsqrt(const VectorMax3d& I)
+{
+    assert(0.5 * (-I.x() + I.y() + I.z()) >= 0);
+    assert(0.5 * (I.x() - I.y() + I.z()) >= 0);
+    assert(0.5 * (I.x() + I.y() - I.z()) >= 0);
+    return DiagonalMatrix3d(
+        sqrt(std::max(0.5 * (-I.x() + I.y() + I.z()), 0.0)),
+        sqrt(std::max(0.5 * (I.x() - I.y() + I.z()), 0.0)),
+        sqrt(std::max(0.5 * (I.x() + I.y() - I.z()), 0.0)));
+}
+
 void DistanceBarrierRBProblem::init_augmented_lagrangian()
 {
     int ndof = PoseD::dim_to_ndof(dim());
@@ -201,17 +1073,43 @@ void DistanceBarrierRBProblem::init_augmented_lagrangian()
     angular_augmented_lagrangian_multiplier.setZero(
         rot_ndof * num_kinematic_bodies, rot_ndof);
 
+    bool has_converted_bodies = false;
     for (int i = 0; i < num_bodies(); i++) {
         if (m_assembler[i].type == RigidBodyType::KINEMATIC
             && m_assembler[i].kinematic_max_time < 0) {
             m_assembler[i].convert_to_static();
+            has_converted_bodies = true;
+        }
+    }
+    if (has_converted_bodies) {
+        m_assembler.update_dof_fixed();
+    }
+
+    kinematic_targets.clear();
+    for (int i = 0; i < num_bodies(); i++) {
+        const RigidBody& body = m_assembler[i];
+        if (body.type != RigidBodyType::KINEMATIC) {
+            continue;
         }
+        KinematicTarget target;
+        target.body_id = i;
+        target.mass = body.mass;
+        target.sqrt_mass = sqrt(body.mass);
+        if (dim() == 2) {
+            target.moment_of_inertia = body.moment_of_inertia(0);
+            target.sqrt_moment_of_inertia = sqrt(target.moment_of_inertia);
+        } else {
+            target.J = compute_J(body.moment_of_inertia);
+            target.Jsqrt = compute_Jsqrt(body.moment_of_inertia);
+        }
+        kinematic_targets.push_back(target);
     }
+    assert(kinematic_targets.size() == num_kinematic_bodies);
 
     x_pred = x0;
     for (int i = 0; i < num_bodies(); i++) {
-        if (m_assembler[i].kinematic_poses.size()) {
-            const PoseD& pose = m_assembler[i].kinematic_poses.front();
+        PoseD pose;
+        if (m_assembler[i].next_kinematic_pose(timestep(), pose)) {
             // Kinematic position
             x_pred.segment(ndof * i, pos_ndof) = pose.position;
             // Kinematic rotation
@@ -232,68 +1130,81 @@ void DistanceBarrierRBProblem::init_augmented_lagrangian()
             is_dof_satisfied.segment(ndof * i, ndof).setOnes();
         }
     }
+
+    x_start = x0;
+    if (prescribe_kinematic_bodies && num_kinematic_bodies) {
+        prescribe_kinematic_targets();
+    }
+}
+
+bool DistanceBarrierRBProblem::prescribe_kinematic_targets()
+{
+    int ndof = PoseD::dim_to_ndof(dim());
+
+    Eigen::VectorXd x_kinematic = x0;
+    for (const KinematicTarget& target : kinematic_targets) {
+        const long i = target.body_id;
+        x_kinematic.segment(ndof * i, ndof) = x_pred.segment(ndof * i, ndof);
+    }
+    x_kinematic = is_dof_fixed().select(x0, x_kinematic);
+
+    // Only the kinematic bodies move, so any impact means a target is blocked
+    if (m_use_barriers) {
+        double toi = m_constraint.compute_earliest_toi(
+            m_assembler, poses_t0, this->dofs_to_poses(x_kinematic));
+        if (toi <= 1) {
+            spdlog::info(
+                "problem={} msg=\"kinematic targets are blocked; using the "
+                "augmented Lagrangian\" toi={:g}",
+                name(), toi);
+            return false;
+        }
+    }
+
+    // The targets are met exactly, so the AL terms vanish and are never
+    // updated (see are_equality_constraints_satisfied()).
+    x_start = x_kinematic;
+    for (const KinematicTarget& target : kinematic_targets) {
+        is_dof_satisfied.segment(ndof * target.body_id, ndof).setOnes();
+    }
+    return true;
 }
 
 void DistanceBarrierRBProblem::step_kinematic_bodies()
 {
+    bool has_converted_bodies = false;
     for (int i = 0; i < num_bodies(); i++) {
         if (m_assembler[i].type == RigidBodyType::KINEMATIC) {
             if (m_assembler[i].kinematic_max_time < 0) {
                 m_assembler[i].convert_to_static();
+                has_converted_bodies = true;
             } else {
                 m_assembler[i].kinematic_max_time -= timestep();
-                if (m_assembler[i].kinematic_poses.size()) {
-                    m_assembler[i].kinematic_poses.pop_front();
-                }
+                m_assembler[i].pop_kinematic_pose(timestep());
             }
         }
     }
+    if (has_converted_bodies) {
+        m_assembler.update_dof_fixed(); // Update the collision masks
+    }
 }
 
-inline DiagonalMatrix3d compute_J(const VectorMax3d& I)
+double DistanceBarrierRBProblem::compute_linear_augment_lagrangian_progress(
+    const Eigen::VectorXd& x) const
 {
-    return DiagonalMatrix3d(
-        0.5 * (-I.x() + I.y() + I.z()), //
-        0.5 * (I.x() - I.y() + I.z()),  //
-        0.5 * (I.x() + I.y() - I.z()));
-}
-
-inline DiagonalMatrix3d compute_Jinv(const VectorMax3d& I)
-{
-    return DiagonalMatrix3d(
-        2 / (-I.x() + I.y() + I.z()), //
-        2 / (I.x() - I.y() + I.z()),  //
-        2 / (I.x() + I.y() - I.z()));
-}
-
-inline DiagonalMatrix3d compute_Jsqrt(const VectorMax3d& I)
-{
-    assert(0.5 * (-I.x() + I.y() + I.z()) >= 0);
-    assert(0.5 * (I.x() - I.y() + I.z()) >= 0);
-    assert(0.5 * (I.x() + I.y() - I.z()) >= 0);
-    return DiagonalMatrix3d(
-        sqrt(std::max(0.5 * (-I.x() + I.y() + I.z()), 0.0)),
-        sqrt(std::max(0.5 * (I.x() - I.y() + I.z()), 0.0)),
-        sqrt(std::max(0.5 * (I.x() + I.y() - I.z()), 0.0)));
-}
-
-double DistanceBarrierRBProblem::compute_linear_augment_lagrangian_progress(
-    const Eigen::VectorXd& x) const
-{
-    int ndof = PoseD::dim_to_ndof(dim());
-    int pos_ndof = PoseD::dim_to_pos_ndof(dim());
+    int ndof = PoseD::dim_to_ndof(dim());
+    int pos_ndof = PoseD::dim_to_pos_ndof(dim());
 
     double a = 0, b = 0;
 
-    for (size_t i = 0; i < num_bodies(); i++) {
-        if (m_assembler[i].type == RigidBodyType::KINEMATIC) {
-            a += (x_pred.segment(ndof * i, pos_ndof)
-                  - x.segment(ndof * i, pos_ndof))
-                     .squaredNorm();
-            b += (x_pred.segment(ndof * i, pos_ndof)
-                  - x0.segment(ndof * i, pos_ndof))
-                     .squaredNorm();
-        }
+    for (const KinematicTarget& target : kinematic_targets) {
+        const long i = target.body_id;
+        a += (x_pred.segment(ndof * i, pos_ndof)
+              - x.segment(ndof * i, pos_ndof))
+                 .squaredNorm();
+        b += (x_pred.segment(ndof * i, pos_ndof)
+              - x0.segment(ndof * i, pos_ndof))
+                 .squaredNorm();
     }
 
     if (a == 0 && b == 0) {
@@ -310,24 +1221,22 @@ double DistanceBarrierRBProblem::compute_angular_augment_lagrangian_progress(
     int pos_ndof = PoseD::dim_to_pos_ndof(dim());
 
     double a = 0, b = 0;
-    for (size_t i = 0; i < num_bodies(); i++) {
-        if (m_assembler[i].type == RigidBodyType::KINEMATIC) {
-            size_t ri = ndof * i + pos_ndof;
-            if (dim() == 2) {
-                a += (x_pred.segment(ri, rot_ndof) - x.segment(ri, rot_ndof))
-                         .squaredNorm();
-                b += (x_pred.segment(ri, rot_ndof) - x0.segment(ri, rot_ndof))
-                         .squaredNorm();
-            } else {
-                auto Q_pred = construct_rotation_matrix(
-                    VectorMax3d(x_pred.segment(ri, rot_ndof)));
-                auto Q = construct_rotation_matrix(
-                    VectorMax3d(x.segment(ri, rot_ndof)));
-                auto Q0 = construct_rotation_matrix(
-                    VectorMax3d(x0.segment(ri, rot_ndof)));
-                a += (Q - Q_pred).squaredNorm();
-                b += (Q0 - Q_pred).squaredNorm();
-            }
+    for (const KinematicTarget& target : kinematic_targets) {
+        size_t ri = ndof * target.body_id + pos_ndof;
+        if (dim() == 2) {
+            a += (x_pred.segment(ri, rot_ndof) - x.segment(ri, rot_ndof))
+                     .squaredNorm();
+            b += (x_pred.segment(ri, rot_ndof) - x0.segment(ri, rot_ndof))
+                     .squaredNorm();
+        } else {
+            auto Q_pred = construct_rotation_matrix(
+                VectorMax3d(x_pred.segment(ri, rot_ndof)));
+            auto Q =
+                construct_rotation_matrix(VectorMax3d(x.segment(ri, rot_ndof)));
+            auto Q0 = construct_rotation_matrix(
+                VectorMax3d(x0.segment(ri, rot_ndof)));
+            a += (Q - Q_pred).squaredNorm();
+            b += (Q0 - Q_pred).squaredNorm();
         }
     }
     if (a == 0 && b == 0) {
@@ -336,6 +1245,18 @@ double DistanceBarrierRBProblem::compute_angular_augment_lagrangian_progress(
     return 1 - sqrt(a / (b == 0 ? 1 : b));
 }
 
+bool DistanceBarrierRBProblem::begin_iteration(const Eigen::VectorXd& x)
+{
+    if (!m_use_barriers
+        || !m_constraint.freeze_contact_manifolds(
+            m_assembler, cached_poses(x))) {
+        return false;
+    }
+    // The cached constraint sets were reduced with other representatives
+    clear_cached_constraint_sets();
+    return true;
+}
+
 void DistanceBarrierRBProblem::update_augmented_lagrangian(
     const Eigen::VectorXd& x)
 {
@@ -348,63 +1269,55 @@ void DistanceBarrierRBProblem::update_augmented_lagrangian(
 
     if (eta_q >= 0.999) {
         // Fix the kinematic DoF that have converged
-        for (size_t i = 0; i < num_bodies(); i++) {
-            if (m_assembler[i].type == RigidBodyType::KINEMATIC) {
-                is_dof_satisfied.segment(ndof * i, pos_ndof).setOnes();
-            }
+        for (const KinematicTarget& target : kinematic_targets) {
+            is_dof_satisfied.segment(ndof * target.body_id, pos_ndof)
+                .setOnes();
         }
     } else if (eta_q < 0.99 && linear_augmented_lagrangian_penalty < 1e8) {
         // Increase the κ_q
         linear_augmented_lagrangian_penalty *= 2;
     } else {
         // Increase the λ
-        for (size_t i = 0, ki = 0; i < num_bodies(); i++) {
-            if (m_assembler[i].type == RigidBodyType::KINEMATIC) {
-                linear_augmented_lagrangian_multiplier.segment(
-                    ki * pos_ndof, pos_ndof) -=
-                    linear_augmented_lagrangian_penalty
-                    * sqrt(m_assembler[i].mass)
-                    * (x.segment(ndof * i, pos_ndof)
-                       - x_pred.segment(ndof * i, pos_ndof));
-                ki++;
-            }
+        for (size_t ki = 0; ki < kinematic_targets.size(); ki++) {
+            const KinematicTarget& target = kinematic_targets[ki];
+            const long i = target.body_id;
+            linear_augmented_lagrangian_multiplier.segment(
+                ki * pos_ndof, pos_ndof) -= linear_augmented_lagrangian_penalty
+                * target.sqrt_mass
+                * (x.segment(ndof * i, pos_ndof)
+                   - x_pred.segment(ndof * i, pos_ndof));
         }
     }
 
     if (eta_Q >= 0.999) {
         // Fix the kinematic DoF that have converged
-        for (size_t i = 0; i < num_bodies(); i++) {
-            if (m_assembler[i].type == RigidBodyType::KINEMATIC) {
-                is_dof_satisfied.segment(ndof * i + pos_ndof, rot_ndof)
-                    .setOnes();
-            }
+        for (const KinematicTarget& target : kinematic_targets) {
+            is_dof_satisfied.segment(ndof * target.body_id + pos_ndof, rot_ndof)
+                .setOnes();
         }
     } else if (eta_Q < 0.99 && angular_augmented_lagrangian_penalty < 1e8) {
         // Increase the κ_Q
         angular_augmented_lagrangian_penalty *= 2;
     } else {
         // Increase the Λ
-        for (size_t i = 0, ki = 0; i < num_bodies(); i++) {
-            if (m_assembler[i].type == RigidBodyType::KINEMATIC) {
-                size_t ri = ndof * i + pos_ndof;
-                if (dim() == 2) {
-                    angular_augmented_lagrangian_multiplier.middleRows(
-                        ki * rot_ndof, rot_ndof) -=
-                        angular_augmented_lagrangian_penalty
-                        * sqrt(m_assembler[i].moment_of_inertia[0])
-                        * (x.segment(ri, rot_ndof)
-                           - x_pred.segment(ri, rot_ndof));
-                } else {
-                    auto Q_pred = construct_rotation_matrix(
-                        VectorMax3d(x_pred.segment(ri, rot_ndof)));
-                    auto Q = construct_rotation_matrix(
-                        VectorMax3d(x.segment(ri, rot_ndof)));
-                    angular_augmented_lagrangian_multiplier.middleRows(
-                        rot_ndof * ki, rot_ndof) -=
-                        angular_augmented_lagrangian_penalty * (Q - Q_pred)
-                        * compute_Jsqrt(m_assembler[i].moment_of_inertia);
-                }
-                ki++;
+        for (size_t ki = 0; ki < kinematic_targets.size(); ki++) {
+            const KinematicTarget& target = kinematic_targets[ki];
+            size_t ri = ndof * target.body_id + pos_ndof;
+            if (dim() == 2) {
+                angular_augmented_lagrangian_multiplier.middleRows(
+                    ki * rot_ndof, rot_ndof) -=
+                    angular_augmented_lagrangian_penalty
+                    * target.sqrt_moment_of_inertia
+                    * (x.segment(ri, rot_ndof) - x_pred.segment(ri, rot_ndof));
+            } else {
+                auto Q_pred = construct_rotation_matrix(
+                    VectorMax3d(x_pred.segment(ri, rot_ndof)));
+                auto Q = construct_rotation_matrix(
+                    VectorMax3d(x.segment(ri, rot_ndof)));
+                angular_augmented_lagrangian_multiplier.middleRows(
+                    rot_ndof * ki, rot_ndof) -=
+                    angular_augmented_lagrangian_penalty * (Q - Q_pred)
+                    * target.Jsqrt;
             }
         }
     }
@@ -431,30 +1344,95 @@ bool DistanceBarrierRBProblem::are_equality_constraints_satisfied(
     return true;
 }
 
+Eigen::VectorXd DistanceBarrierRBProblem::warm_start_point() const
+{
+    if (warm_start_order <= 0 || prev_correction.size() != x0.size()) {
+        return x_start;
+    }
+
+    int ndof = PoseD::dim_to_ndof(dim());
+
+    // Extrapolate the correction linearly when two solutions are available
+    Eigen::VectorXd correction = prev_correction;
+    if (warm_start_order >= 2 && prev_prev_correction.size() == x0.size()) {
+        correction = 2 * prev_correction - prev_prev_correction;
+    }
+
+    // Only free DoF of dynamic bodies are warm started
+    Eigen::VectorXd x_guess = x_pred + correction;
+    for (int i = 0; i < num_bodies(); i++) {
+        if (m_assembler[i].type != RigidBodyType::DYNAMIC) {
+            x_guess.segment(ndof * i, ndof) = x_start.segment(ndof * i, ndof);
+        }
+    }
+    x_guess = is_dof_fixed().select(x_start, x_guess);
+
+    // Keep the guess intersection free (prescribed kinematic bodies are
+    // already at their targets in x_start)
+    double toi = 1;
+    if (m_use_barriers) {
+        toi = m_constraint.compute_earliest_toi(
+            m_assembler, this->dofs_to_poses(x_start),
+            this->dofs_to_poses(x_guess));
+        if (toi <= 1) {
+            x_guess = x_start
+                + Constants::WARM_START_TOI_SCALE * toi * (x_guess - x_start);
+        }
+    }
+
+    spdlog::info(
+        "warm_start order={:d} toi={:g} ||x_guess-x0||={:g}",
+        warm_start_order, toi, (x_guess - x0).norm());
+
+    return x_guess;
+}
+
 OptimizationResults DistanceBarrierRBProblem::solve_constraints()
 {
     OptimizationResults opt_result;
-    opt_result.x = starting_point();
+    opt_result.x = warm_start_point();
+    m_contact_forces.clear(dim());
     double momentum_balance, eps_d = 1e-2 * world_bbox_diagonal();
     int i = 0;
     int total_newton_iterations = 0;
     do {
         opt_result = solver().solve(opt_result.x);
         total_newton_iterations += opt_result.num_iterations;
+        // The manifolds are reduced where they are evaluated again
+        if (m_constraint.unfreeze_contact_manifolds()) {
+            clear_cached_constraint_sets();
+        }
         if (!opt_result.success) {
             break;
         }
 
-        PosesD poses = this->dofs_to_poses(opt_result.x);
+        // The solver's last evaluation already transformed the vertices
+        const KinematicsCache& kinematics = cached_world_vertices_diff(
+            opt_result.x, /*compute_jac=*/false, /*compute_hess=*/false);
+        if (dropped_friction_normal_force > 0) {
+            RIGID_IPC_LOG_DEBUG(
+                "friction_drop lagging_iteration={:d} "
+                "dropped_energy_bound={:g}",
+                i, dropped_friction_energy_bound(kinematics.V));
+        }
 
         Constraints collision_constraints;
+        std::vector<double> barrier_weights;
         m_constraint.construct_constraint_set(
-            m_assembler, poses, collision_constraints);
-        update_friction_constraints(collision_constraints, poses);
+            m_assembler, kinematics.poses, collision_constraints,
+            &barrier_weights);
+        if (record_contact_forces) {
+            // The friction forces are of the constraints lagged in this solve
+            update_contact_forces(
+                collision_constraints, barrier_weights, kinematics.V);
+        }
+        update_friction_constraints(
+            collision_constraints, barrier_weights, kinematics.V);
 
         Eigen::VectorXd grad_Ex, grad_Bx, grad_Dx;
         compute_energy_term(opt_result.x, grad_Ex);
-        compute_barrier_term(opt_result.x, collision_constraints, grad_Bx);
+        compute_barrier_term(
+            opt_result.x, collision_constraints, barrier_weights, grad_Bx);
         compute_friction_term(opt_result.x, grad_Dx);
 
         Eigen::VectorXd tmp = grad_Ex + barrier_stiffness() * grad_Bx + grad_Dx;
@@ -481,6 +1459,17 @@ OptimizationResults DistanceBarrierRBProblem::solve_constraints()
             "Ending friction solve early because newton solve {:d} failed!", i);
     }
 
+    if (warm_start_order > 0) {
+        if (opt_result.success) {
+            prev_prev_correction = prev_correction;
+            prev_correction = opt_result.x - x_pred;
+        } else {
+            // Do not extrapolate from a failed solve
+            prev_correction.resize(0);
+            prev_prev_correction.resize(0);
+        }
+    }
+
     opt_result.num_iterations = total_newton_iterations;
     return opt_result;
 }
@@ -620,7 +1609,7 @@ bool DistanceBarrierRBProblem::take_step(const Eigen::VectorXd& x)
         // step. We only guarentee a piecewise collision-free trajectory.
         // return detect_collisions(poses_t0, poses_q1,
         // CollisionCheck::EXACT);
-        return detect_intersections(poses_q1);
+        return detect_step_intersections(poses_q1);
     }
     return false;
 }
@@ -628,6 +1617,33 @@ bool DistanceBarrierRBProblem::take_step(const Eigen::VectorXd& x)
 ////////////////////////////////////////////////////////////
 // Barrier Problem
 
+void DistanceBarrierRBProblem::compute_objectives(
+    const std::vector<Eigen::VectorXd>& xs, std::vector<double>& fxs)
+{
+#if defined(RIGID_IPC_PROFILE_FUNCTIONS)                                       \
+    || defined(RIGID_IPC_WITH_DERIVATIVE_CHECK)
+    // The profiler and derivative checks are not thread safe
+    BarrierProblem::compute_objectives(xs, fxs);
+#else
+    fxs.resize(xs.size());
+
+    // Initialize the shared state before evaluating concurrently
+    vertices_t0();
+    m_constraint.use_candidate_cache = false;
+    m_is_evaluating_objectives = true;
+
+    tbb::parallel_for(size_t(0), xs.size(), [&](size_t i) {
+        // Isolate each evaluation, so a thread waiting on a nested parallel
+        // loop cannot start another evaluation that would reuse its caches.
+        tbb::this_task_arena::isolate(
+            [&] { fxs[i] = BarrierProblem::compute_objective(xs[i]); });
+    });
+
+    m_is_evaluating_objectives = false;
+    m_constraint.use_candidate_cache = true;
+#endif
+}
+
 // Compute the objective function:
 // f(x) = E(x) + κ ∑_{k ∈ C} b(d(x_k)) + ∑_{k ∈ C} D(x_k)
 double DistanceBarrierRBProblem::compute_objective(
@@ -637,6 +1653,13 @@ double DistanceBarrierRBProblem::compute_objective(
     bool compute_grad,
     bool compute_hess)
 {
+#ifndef RIGID_IPC_WITH_DERIVATIVE_CHECK
+    // The derivative checks are per term, so they use the path below.
+    if (compute_hess) {
+        return compute_objective_in_place(x, grad, hess);
+    }
+#endif
+
     // Compute rigid body energy term
     double Ex = compute_energy_term(x, grad, hess, compute_grad, compute_hess);
     Ex /= average_mass();
@@ -668,10 +1691,11 @@ double DistanceBarrierRBProblem::compute_objective(
     // Compute a common constraint set to use for contacts and friction
     // Start by updating the constraint set
     Constraints constraints;
+    std::vector<double> barrier_weights;
     m_constraint.construct_constraint_set(
-        m_assembler, this->dofs_to_poses(x), constraints);
+        m_assembler, cached_poses(x), constraints, &barrier_weights);
 
-    spdlog::debug(
+    RIGID_IPC_LOG_DEBUG(
         "problem={} num_vertex_vertex_constraint={:d} "
         "num_edge_vertex_constraints={:d} num_edge_edge_constraints={:d} "
         "num_face_vertex_constraints={:d}",
@@ -682,7 +1706,8 @@ double DistanceBarrierRBProblem::compute_objective(
     Eigen::VectorXd grad_Bx;
     Eigen::SparseMatrix<double> hess_Bx;
     double Bx = compute_barrier_term(
-        x, constraints, grad_Bx, hess_Bx, compute_grad, compute_hess);
+        x, constraints, barrier_weights, grad_Bx, hess_Bx, compute_grad,
+        compute_hess);
 
     // D(x) is the friction potential (Equation 15 in the IPC paper)
     Eigen::VectorXd grad_Dx;
@@ -713,105 +1738,22 @@ double DistanceBarrierRBProblem::compute_energy_term(
     PROFILE_POINT("DistanceBarrierRBProblem::compute_energy_term");
     PROFILE_START();
 
-    typedef AutodiffType<Eigen::Dynamic, /*maxN=*/6> Diff;
-
-    int ndof = PoseD::dim_to_ndof(dim());
-    int pos_ndof = PoseD::dim_to_pos_ndof(dim());
-    int rot_ndof = PoseD::dim_to_rot_ndof(dim());
-
-    Eigen::VectorXd energies = Eigen::VectorXd::Zero(num_bodies());
     if (compute_grad) {
         grad.setZero(x.size());
     }
-    tbb::concurrent_vector<Eigen::Triplet<double>> hess_triplets;
+    // Hessian is a block diagonal with (ndof x ndof) blocks
+    BlockSparseSkeleton hess_skeleton;
     if (compute_hess) {
-        // Hessian is a block diagonal with (ndof x ndof) blocks
-        hess_triplets.reserve(num_bodies() * ndof * ndof);
+        hess_skeleton.reserve_blocks(
+            num_bodies(), PoseD::dim_to_ndof(dim()), /*blocks=*/{});
     }
 
-    const std::vector<PoseD> poses = this->dofs_to_poses(x);
-    assert(poses.size() == num_bodies());
-
-    // tbb::parallel_for(size_t(0), poses.size(), [&](size_t i) {
-    tbb::parallel_for(
-        tbb::blocked_range<size_t>(size_t(0), poses.size()),
-        [&](const tbb::blocked_range<size_t>& range) {
-            // Activate autodiff with the correct number of variables
-            Diff::activate(ndof);
-
-            for (long i = range.begin(); i != range.end(); ++i) {
-                const PoseD& pose = poses[i];
-                const RigidBody& body = m_assembler[i];
-
-                // Do not compute the body energy for static and kinematic
-                // bodies
-                if (body.type != RigidBodyType::DYNAMIC) {
-                    continue;
-                }
-
-                VectorMax6d gradi;
-
-                if (compute_hess) {
-                    // Initialize autodiff variables
-                    Pose<Diff::DDouble2> pose_diff(Diff::d2vars(0, pose.dof()));
-
-                    Diff::DDouble2 dExi = compute_body_energy<Diff::DDouble2>(
-                        body, pose_diff,
-                        grad_barrier_t0.segment(i * ndof, ndof));
-
-                    energies[i] = dExi.getValue();
-                    gradi = dExi.getGradient();
-                    MatrixMax6d hessi = dExi.getHessian();
-
-                    // Project dense block to make assembled matrix PSD
-                    hessi.topLeftCorner(pos_ndof, pos_ndof) = project_to_psd(
-                        MatrixMax3d(hessi.topLeftCorner(pos_ndof, pos_ndof)));
-                    // NOTE: This is handled with Tikhonov regularization
-                    // instead hessi.bottomRightCorner(rot_ndof, rot_ndof) =
-                    //     Eigen::project_to_pd(
-                    //         hessi.bottomRightCorner(rot_ndof, rot_ndof));
-
-                    // Add the local hessian as triplets in the global
-                    // hessian
-                    for (int r = 0; r < hessi.rows(); r++) {
-                        for (int c = 0; c < hessi.cols(); c++) {
-                            hess_triplets.emplace_back(
-                                i * ndof + r, i * ndof + c, hessi(r, c));
-                        }
-                    }
-                } else if (compute_grad) {
-                    // Initialize autodiff variables
-                    Pose<Diff::DDouble1> pose_diff(Diff::d1vars(0, pose.dof()));
-
-                    Diff::DDouble1 dExi = compute_body_energy<Diff::DDouble1>(
-                        body, pose_diff,
-                        grad_barrier_t0.segment(i * ndof, ndof));
-
-                    energies[i] = dExi.getValue();
-                    gradi = dExi.getGradient();
-                } else {
-                    energies[i] = compute_body_energy<double>(
-                        body, pose, grad_barrier_t0.segment(i * ndof, ndof));
-                }
-
-                if (compute_grad) {
-                    grad.segment(i * ndof, ndof) = gradi;
-                }
-            }
-        });
+    double Ex = accumulate_energy_term(
+        x, /*scale=*/1, compute_grad ? &grad : nullptr,
+        compute_hess ? &hess_skeleton : nullptr);
 
     if (compute_hess) {
-        NAMED_PROFILE_POINT(
-            "DistanceBarrierRBProblem::compute_energy_term:"
-            "assemble_hessian",
-            ASSEMBLE_ENERGY_HESS);
-        PROFILE_START(ASSEMBLE_ENERGY_HESS);
-
-        // ∇²E: Rⁿ ↦ Rⁿˣⁿ
-        hess.resize(x.size(), x.size());
-        hess.setFromTriplets(hess_triplets.begin(), hess_triplets.end());
-
-        PROFILE_END(ASSEMBLE_ENERGY_HESS);
+        hess = hess_skeleton.matrix();
     }
 
     PROFILE_END();
@@ -840,24 +1782,73 @@ double DistanceBarrierRBProblem::compute_energy_term(
     }
 #endif
 
+    return Ex;
+}
+
+double DistanceBarrierRBProblem::accumulate_energy_term(
+    const Eigen::VectorXd& x,
+    double scale,
+    Eigen::VectorXd* grad,
+    BlockSparseSkeleton* hess)
+{
+    int ndof = PoseD::dim_to_ndof(dim());
+
+    Eigen::VectorXd energies = Eigen::VectorXd::Zero(num_bodies());
+
+    const std::vector<PoseD>& poses = cached_poses(x);
+    assert(poses.size() == num_bodies());
+
+    tbb::parallel_for(size_t(0), poses.size(), [&](size_t i) {
+        const RigidBody& body = m_assembler[i];
+
+        // Do not compute the body energy for static and kinematic bodies
+        if (body.type != RigidBodyType::DYNAMIC) {
+            return;
+        }
+
+        VectorMax6d gradi;
+        MatrixMax6d hessi;
+        energies[i] = compute_body_energy(
+            body, poses[i], grad || hess ? &gradi : nullptr,
+            hess ? &hessi : nullptr);
+
+        if (grad != nullptr) {
+            grad->segment(i * ndof, ndof) += scale * gradi;
+        }
+        if (hess != nullptr) {
+            // The linear block (mI) is already PD and the rotational block
+            // is handled with Tikhonov regularization. Bodies write to
+            // distinct diagonal blocks, so this is thread safe.
+            hess->add_block(hess->find_block(i, i), hessi, scale);
+        }
+    });
+
     return energies.sum();
 }
 
 // Compute the energy term for a single rigid body
-template <typename T>
-T DistanceBarrierRBProblem::compute_body_energy(
+double DistanceBarrierRBProblem::compute_body_energy(
     const RigidBody& body,
-    const Pose<T>& pose,
-    const VectorMax6d& grad_barrier_t0)
+    const PoseD& pose,
+    VectorMax6d* grad,
+    MatrixMax6d* hess)
 {
     // NOTE: t0 suffix indicates the current value not the inital value
     double h = timestep();
+    const int pos_ndof = pose.pos_ndof(), rot_ndof = pose.rot_ndof();
 
-    T energy(0.0);
+    assert(hess == nullptr || grad != nullptr);
+    double energy = 0;
+    if (grad != nullptr) {
+        grad->setZero(pose.ndof());
+    }
+    if (hess != nullptr) {
+        hess->setZero(pose.ndof(), pose.ndof());
+    }
 
     // Linear energy
-    if (!body.is_dof_fixed.head(pose.pos_ndof()).all()) {
-        VectorMax3<T> q = pose.position;
+    if (!body.is_dof_fixed.head(pos_ndof).all()) {
+        const VectorMax3d& q = pose.position;
         const VectorMax3d& q_t0 = body.pose.position;
         const VectorMax3d& qdot_t0 = body.velocity.position;
         VectorMax3d qddot_t0 = gravity + body.force.position / body.mass;
@@ -872,14 +1863,19 @@ T DistanceBarrierRBProblem::compute_body_energy(
         }
 
         // ½mqᵀq - mqᵀ(qᵗ + h(q̇ᵗ + h(g + f/m + ½∇B(qᵗ)/m)))
-        energy += 0.5 * body.mass * q.dot(q)
-            - body.mass * q.dot(q_t0 + h * (qdot_t0 + h * qddot_t0));
+        const VectorMax3d q_hat = q_t0 + h * (qdot_t0 + h * qddot_t0);
+        energy += 0.5 * body.mass * q.dot(q) - body.mass * q.dot(q_hat);
+        if (grad != nullptr) {
+            grad->head(pos_ndof) = body.mass * (q - q_hat);
+        }
+        if (hess != nullptr) {
+            hess->diagonal().head(pos_ndof).setConstant(body.mass);
+        }
     }
 
     // Rotational energy
-    if (!body.is_dof_fixed.tail(pose.rot_ndof()).all()) {
+    if (!body.is_dof_fixed.tail(rot_ndof).all()) {
         if (dim() == 3) {
-            Matrix3<T> Q = pose.construct_rotation_matrix();
             Eigen::Matrix3d Q_t0 = body.pose.construct_rotation_matrix();
             // Eigen::Matrix3d Qdot_t0 =
             //     Q_t0 * Hat(body.velocity.rotation);
@@ -887,37 +1883,49 @@ T DistanceBarrierRBProblem::compute_body_energy(
 
             DiagonalMatrix3d J = compute_J(body.moment_of_inertia);
 
-            // Transform the world space torque into body space
             Eigen::Matrix3d Qddot_t0;
+            // Transform the world space torque into body space
+            Eigen::Matrix3d Tau = Q_t0.transpose() * Hat(body.force.rotation);
             switch (body_energy_integration_method) {
             case IMPLICIT_EULER:
                 Qddot_t0.setZero();
+                Tau *= -h * h;
                 break;
             case IMPLICIT_NEWMARK:
             case STABILIZED_NEWMARK:
                 Qddot_t0 = 0.25 * body.Qddot;
+                Tau *= -0.25 * h * h;
                 break;
             }
 
             // ½tr(QJQᵀ) - tr(Q(J(Qᵗ + hQ̇ᵗ + h²Aᵗ)ᵀ + h²[τ]))
-            energy += 0.5 * (Q * J * Q.transpose()).trace();
-            energy -=
-                (Q * J * (Q_t0 + h * (Qdot_t0 + h * Qddot_t0)).transpose())
-                    .trace();
-            // Transform the world space torque into body space
-            Eigen::Matrix3d Tau = Q_t0.transpose() * Hat(body.force.rotation);
-            switch (body_energy_integration_method) {
-            case IMPLICIT_EULER:
-                energy += h * h * (Q * Tau).trace();
-                break;
-            case IMPLICIT_NEWMARK:
-            case STABILIZED_NEWMARK:
-                energy += 0.25 * h * h * (Q * Tau).trace();
-                break;
+            // The first term is ½tr(J) for every rotation, so only the
+            // second term (linear in Q) has nonzero derivatives.
+            const Eigen::Matrix3d A =
+                J * (Q_t0 + h * (Qdot_t0 + h * Qddot_t0)).transpose() + Tau;
+
+            Eigen::Matrix3d Q;
+            if (grad == nullptr) {
+                Q = pose.construct_rotation_matrix();
+            } else {
+                RotationGradient dQ;
+                RotationHessian d2Q;
+                Q = construct_rotation_matrix_diff(
+                    pose.rotation, dQ, hess != nullptr ? &d2Q : nullptr);
+                // tr(XA) = ∑ X ⊙ Aᵀ
+                const Eigen::Matrix3d At = A.transpose();
+                for (int k = 0; k < 3; k++) {
+                    (*grad)(pos_ndof + k) = -dQ[k].cwiseProduct(At).sum();
+                    for (int l = 0; hess != nullptr && l < 3; l++) {
+                        (*hess)(pos_ndof + k, pos_ndof + l) =
+                            -d2Q[3 * k + l].cwiseProduct(At).sum();
+                    }
+                }
             }
+            energy += 0.5 * (Q * J * Q.transpose()).trace() - (Q * A).trace();
         } else {
-            assert(pose.rot_ndof() == 1);
-            T theta = pose.rotation[0];
+            assert(rot_ndof == 1);
+            double theta = pose.rotation[0];
             double theta_t0 = body.pose.rotation[0];
             double theta_dot_t0 = body.velocity.rotation[0];
             // θ̈ = α + τ/I
@@ -937,6 +1945,12 @@ T DistanceBarrierRBProblem::compute_body_energy(
             double theta_hat =
                 theta_t0 + h * (theta_dot_t0 + h * theta_ddot_t0);
             energy += 0.5 * I * theta * theta - I * theta * theta_hat;
+            if (grad != nullptr) {
+                (*grad)(pos_ndof) = I * (theta - theta_hat);
+            }
+            if (hess != nullptr) {
+                (*hess)(pos_ndof, pos_ndof) = I;
+            }
         }
     }
 
@@ -953,7 +1967,6 @@ double DistanceBarrierRBProblem::compute_augmented_lagrangian(
     int ndof = PoseD::dim_to_ndof(dim());
     int pos_ndof = PoseD::dim_to_pos_ndof(dim());
     int rot_ndof = PoseD::dim_to_rot_ndof(dim());
-    size_t num_kinematic_bodies = m_assembler.count_kinematic_bodies();
 
     double potential = 0;
     if (compute_grad) {
@@ -962,13 +1975,12 @@ double DistanceBarrierRBProblem::compute_augmented_lagrangian(
     std::vector<Eigen::Triplet<double>> hess_triplets;
     if (compute_hess) {
         hess.resize(x.size(), x.size());
-        hess_triplets.reserve(num_kinematic_bodies * ndof);
+        hess_triplets.reserve(kinematic_targets.size() * ndof * rot_ndof);
     }
 
     bool all_kinematic_dof_satisfied = true;
-    for (size_t i = 0; i < num_bodies(); i++) {
-        if (m_assembler[i].type == RigidBodyType::KINEMATIC
-            && !is_dof_satisfied.segment(ndof * i, ndof).all()) {
+    for (const KinematicTarget& target : kinematic_targets) {
+        if (!is_dof_satisfied.segment(ndof * target.body_id, ndof).all()) {
             all_kinematic_dof_satisfied = false;
             break;
         }
@@ -983,12 +1995,11 @@ double DistanceBarrierRBProblem::compute_augmented_lagrangian(
 
     // Compute the linear AL potential
     const double& kappa_q = linear_augmented_lagrangian_penalty;
-    for (size_t i = 0, ki = 0; i < num_bodies(); i++) {
-        if (m_assembler[i].type != RigidBodyType::KINEMATIC) {
-            continue;
-        }
+    for (size_t ki = 0; ki < kinematic_targets.size(); ki++) {
+        const KinematicTarget& target = kinematic_targets[ki];
+        const long i = target.body_id;
 
-        double m = m_assembler[i].mass;
+        double m = target.mass;
         const auto& lambda = linear_augmented_lagrangian_multiplier.segment(
             ki * pos_ndof, pos_ndof);
 
@@ -996,10 +2007,10 @@ double DistanceBarrierRBProblem::compute_augmented_lagrangian(
         const auto& q_pred = x_pred.segment(i * ndof, pos_ndof);
 
         potential += kappa_q / 2 * m * (q - q_pred).squaredNorm()
-            - sqrt(m) * lambda.dot(q - q_pred);
+            - target.sqrt_mass * lambda.dot(q - q_pred);
         if (compute_grad) {
             grad.segment(i * ndof, pos_ndof) =
-                kappa_q * m * (q - q_pred) - sqrt(m) * lambda;
+                kappa_q * m * (q - q_pred) - target.sqrt_mass * lambda;
         }
         if (compute_hess) {
             for (int j = 0; j < pos_ndof; j++) {
@@ -1007,8 +2018,6 @@ double DistanceBarrierRBProblem::compute_augmented_lagrangian(
                     ndof * i + j, ndof * i + j, kappa_q * m);
             }
         }
-
-        ki++;
     }
 
     typedef AutodiffType<Eigen::Dynamic, /*maxN=*/3> Diff;
@@ -1016,12 +2025,10 @@ double DistanceBarrierRBProblem::compute_augmented_lagrangian(
 
     // Compute the angular AL potential
     const double& kappa_Q = angular_augmented_lagrangian_penalty;
-    for (size_t i = 0, ki = 0; i < num_bodies(); i++) {
-        if (m_assembler[i].type != RigidBodyType::KINEMATIC) {
-            continue;
-        }
+    for (size_t ki = 0; ki < kinematic_targets.size(); ki++) {
+        const KinematicTarget& target = kinematic_targets[ki];
+        const long i = target.body_id;
 
-        const VectorMax3d& moment_of_inertia = m_assembler[i].moment_of_inertia;
         MatrixMax3d lambda = angular_augmented_lagrangian_multiplier.middleRows(
             rot_ndof * ki, rot_ndof);
 
@@ -1029,8 +2036,8 @@ double DistanceBarrierRBProblem::compute_augmented_lagrangian(
         VectorMax3d theta_pred = x_pred.segment(i * ndof + pos_ndof, rot_ndof);
 
         if (dim() == 2) {
-            double I = moment_of_inertia(0);
-            double Isqrt = sqrt(I);
+            double I = target.moment_of_inertia;
+            double Isqrt = target.sqrt_moment_of_inertia;
 
             potential += kappa_Q / 2 * I * (theta - theta_pred).squaredNorm()
                 - (Isqrt * lambda.transpose() * (theta - theta_pred)).trace();
@@ -1046,11 +2053,22 @@ double DistanceBarrierRBProblem::compute_augmented_lagrangian(
                         kappa_Q * I);
                 }
             }
+        } else if (!compute_grad && !compute_hess) {
+            // Value only, so skip the autodiff types
+            const DiagonalMatrix3d& J = target.J;
+            const DiagonalMatrix3d& Jsqrt = target.Jsqrt;
+
+            const auto& Q = construct_rotation_matrix(theta);
+            const auto& Q_pred = construct_rotation_matrix(theta_pred);
+
+            potential += kappa_Q / 2
+                    * ((Q - Q_pred) * J * (Q - Q_pred).transpose()).trace()
+                - (lambda.transpose() * (Q - Q_pred) * Jsqrt).trace();
         } else {
             VectorMax3<Diff::DDouble2> theta_diff = Diff::d2vars(0, theta);
 
-            DiagonalMatrix3d J = compute_J(moment_of_inertia);
-            DiagonalMatrix3d Jsqrt = compute_Jsqrt(moment_of_inertia);
+            const DiagonalMatrix3d& J = target.J;
+            const DiagonalMatrix3d& Jsqrt = target.Jsqrt;
 
             const auto& Q = construct_rotation_matrix(theta_diff);
             const auto& Q_pred = construct_rotation_matrix(theta_pred);
@@ -1074,8 +2092,6 @@ double DistanceBarrierRBProblem::compute_augmented_lagrangian(
                 }
             }
         }
-
-        ki++;
     }
 
     if (compute_hess) {
@@ -1117,15 +2133,14 @@ double DistanceBarrierRBProblem::compute_barrier_term(
     bool compute_grad,
     bool compute_hess)
 {
-    // Start by updating the constraint set
-    PosesD poses = this->dofs_to_poses(x);
-    Constraints constraints;
-    m_constraint.construct_constraint_set(m_assembler, poses, constraints);
+    // Start by updating the constraint set (also used by
+    // compute_min_distance(x))
+    const Constraints& constraints = cached_constraint_set(x);
     num_constraints = constraints.num_constraints();
 
     m_num_contacts = std::max(m_num_contacts, num_constraints);
 
-    spdlog::debug(
+    RIGID_IPC_LOG_DEBUG(
         "problem={} num_vertex_vertex_constraint={:d} "
         "num_edge_vertex_constraints={:d} num_edge_edge_constraints={:d} "
         "num_face_vertex_constraints={:d}",
@@ -1134,62 +2149,83 @@ double DistanceBarrierRBProblem::compute_barrier_term(
         constraints.fv_constraints.size());
 
     double Bx = compute_barrier_term(
-        x, constraints, grad, hess, compute_grad, compute_hess);
+        x, constraints, m_kinematics_caches.local().barrier_weights, grad, hess,
+        compute_grad, compute_hess);
 
     return Bx;
 }
 
-// Convert from a local hessian to the triplets in the global hessian
+// Append the body segments of a local gradient to the storage
 template <typename DerivedLocalGradient>
 void local_gradient_to_global(
     const Eigen::MatrixBase<DerivedLocalGradient>& local_gradient,
     const std::array<long, 2>& body_ids,
     int ndof,
-    Eigen::VectorXd& grad)
+    PotentialStorage& storage)
 {
     assert(local_gradient.size() == 2 * ndof);
     for (int b_i = 0; b_i < body_ids.size(); b_i++) {
-        grad.segment(ndof * body_ids[b_i], ndof) +=
-            local_gradient.segment(ndof * b_i, ndof);
+        storage.gradient.emplace_back(
+            body_ids[b_i], local_gradient.segment(ndof * b_i, ndof));
     }
 }
 
+// Append the body blocks of a local hessian to the storage (only the ones on
+// or below the block diagonal if lower_triangular)
 template <typename DerivedLocalHessian>
-void local_hessian_to_global_triplets(
+void local_hessian_to_global_blocks(
     const Eigen::MatrixBase<DerivedLocalHessian>& local_hessian,
     const std::array<long, 2>& body_ids,
     int ndof,
-    std::vector<Eigen::Triplet<double>>& triplets)
+    bool lower_triangular,
+    PotentialStorage& storage)
 {
     assert(local_hessian.rows() == 2 * ndof);
     assert(local_hessian.cols() == 2 * ndof);
     for (int b_i = 0; b_i < body_ids.size(); b_i++) {
         for (int b_j = 0; b_j < body_ids.size(); b_j++) {
-            for (int dof_i = 0; dof_i < ndof; dof_i++) {
-                for (int dof_j = 0; dof_j < ndof; dof_j++) {
-                    double v =
-                        local_hessian(ndof * b_i + dof_i, ndof * b_j + dof_j);
-                    int r = ndof * body_ids[b_i] + dof_i;
-                    int c = ndof * body_ids[b_j] + dof_j;
-                    triplets.emplace_back(r, c, v);
-                }
+            if (lower_triangular && body_ids[b_i] < body_ids[b_j]) {
+                continue;
             }
+            storage.hessian_blocks.emplace_back(
+                body_ids[b_i], body_ids[b_j],
+                local_hessian.block(ndof * b_i, ndof * b_j, ndof, ndof));
+        }
+    }
+}
+
+// Project a local hessian to the PSD cone. If requested, the
+// eigendecomposition is skipped when an LDLᵀ factorization shows the hessian
+// is already positive semi-definite.
+template <typename LocalHessian>
+void project_local_hessian_to_psd(LocalHessian& hess, bool is_lazy)
+{
+    if (is_lazy) {
+        const Eigen::LDLT<LocalHessian> ldlt(hess);
+        if (ldlt.info() == Eigen::Success && ldlt.isPositive()) {
+            StepMetrics::add_count(StepMetrics::SKIPPED_PSD_PROJECTIONS);
+            return;
         }
     }
+    hess = project_to_psd(hess);
+    StepMetrics::add_count(StepMetrics::PSD_PROJECTIONS);
 }
 
 // Apply the chain rule of f(V(x)) given ∇ᵥf(V) and ∇ₓV(x)
+//
+// Templated on the dimension and the number of vertices of the constraint,
+// so the local derivatives are fixed-size (e.g., 12×12 with a 12×12
+// Jacobian for an edge-edge constraint in 3D).
+template <int dim, int num_vertices>
 void apply_chain_rule(
     const VectorMax12d& grad_f,
-    const Eigen::MatrixXd& jac_V,
     const MatrixMax12d& hess_f,
-    const Eigen::MatrixXd& hess_V,
-    const std::vector<long>& vertex_ids,
-    const std::vector<uint8_t>& local_body_ids,
-    const std::array<long, 2>& body_ids,
-    const int dim,
-    Eigen::VectorXd& grad,
-    std::vector<Eigen::Triplet<double>>& hess_triplets,
+    const WorldVerticesDiff& V_diff,
+    const ConstraintIndices& indices,
+    PotentialStorage& storage,
+    bool lazy_psd_projection,
+    bool lower_triangular,
+    bool defer_hessian,
     bool compute_grad,
     bool compute_hess)
 {
@@ -1200,105 +2236,589 @@ void apply_chain_rule(
     // PROFILE_POINT("apply_chain_rule");
     // PROFILE_START();
 
-    const int rb_ndof = PoseD::dim_to_ndof(dim);
+    constexpr int rb_ndof = PoseD::dim_to_ndof(dim);
+    constexpr int n = num_vertices * dim;
+    typedef Eigen::Matrix<double, 2 * rb_ndof, 1> LocalGradient;
+    typedef Eigen::Matrix<double, 2 * rb_ndof, 2 * rb_ndof> LocalHessian;
+    typedef Eigen::Matrix<double, n, 2 * rb_ndof> LocalJacobian;
+    const auto& vertex_ids = indices.vertex_ids;
+    const auto& local_body_ids = indices.local_body_ids;
+    const auto& body_ids = indices.body_ids;
+    assert(indices.num_vertices == num_vertices);
+    assert(grad_f.size() == n);
+    const Eigen::Map<const Eigen::Matrix<double, n, 1>> grad_V(grad_f.data());
+
+    // jac_Vi ∈ R^{4n × 2m} (only the vertices of this constraint)
+    LocalJacobian jac_Vi = LocalJacobian::Zero();
+    for (int i = 0; i < num_vertices; i++) {
+        jac_Vi.template block<dim, rb_ndof>(
+            i * dim, local_body_ids[i] * rb_ndof) =
+            V_diff.vertex_jacobian<dim>(vertex_ids[i]);
+    }
 
     if (compute_grad) {
-        // jac_Vi ∈ R^{4n × 2m}
-        VectorMax12d local_grad = VectorMax12d::Zero(2 * rb_ndof);
-        for (int i = 0; i < vertex_ids.size(); i++) {
-            local_grad.segment(rb_ndof * local_body_ids[i], rb_ndof) +=
-                jac_V.middleRows(vertex_ids[i] * dim, dim).transpose()
-                * grad_f.segment(i * dim, dim);
-        }
-
-        local_gradient_to_global(local_grad, body_ids, rb_ndof, grad);
+        LocalGradient local_grad = jac_Vi.transpose() * grad_V;
+        local_gradient_to_global(local_grad, body_ids, rb_ndof, storage);
     }
 
     if (compute_hess) {
-        // jac_Vi ∈ R^{4n × 2m}
-        MatrixMax12d jac_Vi =
-            MatrixMax12d::Zero(vertex_ids.size() * dim, 2 * rb_ndof);
-        for (int i = 0; i < vertex_ids.size(); i++) {
-            jac_Vi.block(i * dim, local_body_ids[i] * rb_ndof, dim, rb_ndof) =
-                jac_V.middleRows(vertex_ids[i] * dim, dim);
-        }
+        assert(hess_f.rows() == n && hess_f.cols() == n);
+        const Eigen::Map<const Eigen::Matrix<double, n, n>> hess_V(
+            hess_f.data());
 
         // hess ∈ R^{2m × 2m}
-        MatrixMax12d hess = jac_Vi.transpose() * hess_f * jac_Vi;
-        for (int i = 0; i < vertex_ids.size(); i++) {
-            for (int j = 0; j < dim; j++) {
-                // Off diagaonal blocks are all zero because the derivative
-                // of a vertex of body A with body B is zero.
-                hess.block(
-                    local_body_ids[i] * rb_ndof, local_body_ids[i] * rb_ndof,
-                    rb_ndof, rb_ndof) +=
-                    hess_V.middleRows(
-                        rb_ndof * (vertex_ids[i] * dim + j), rb_ndof)
-                    * grad_f[i * dim + j];
-            }
+        LocalHessian hess;
+        if (defer_hessian) {
+            hess.setZero(); // Only the second order terms of the bodies
+        } else {
+            hess = jac_Vi.transpose() * hess_V * jac_Vi;
+        }
+        for (int i = 0; i < num_vertices; i++) {
+            // Off diagaonal blocks are all zero because the derivative
+            // of a vertex of body A with body B is zero.
+            hess.template block<rb_ndof, rb_ndof>(
+                local_body_ids[i] * rb_ndof, local_body_ids[i] * rb_ndof) +=
+                V_diff.vertex_hessian<dim>(
+                    vertex_ids[i], grad_V.template segment<dim>(i * dim));
+        }
+
+        if (defer_hessian) {
+            storage.local_hessians.add(hess_V, jac_Vi, hess, body_ids);
+            return;
         }
 
-        hess = project_to_psd(hess);
+        project_local_hessian_to_psd(hess, lazy_psd_projection);
 
-        local_hessian_to_global_triplets(
-            hess, body_ids, rb_ndof, hess_triplets);
+        local_hessian_to_global_blocks(
+            hess, body_ids, rb_ndof, lower_triangular, storage);
     }
 
     // PROFILE_END();
 }
 
-struct PotentialStorage {
-    PotentialStorage() {}
-    PotentialStorage(size_t nvars) { gradient.setZero(nvars); }
+void PotentialStorage::clear()
+{
+    potential = 0;
+    gradient.clear();
+    hessian_blocks.clear();
+    local_hessians.clear();
+    segments.clear();
+}
+
+void PotentialStorage::add_range(
+    size_t begin, double range_potential, bool deterministic)
+{
+    potential += range_potential;
+    if (deterministic) {
+        segments.push_back(
+            { begin, range_potential, gradient.size(),
+              hessian_blocks.size() });
+    }
+}
+
+ThreadSpecificPotentials& DistanceBarrierRBProblem::potential_storage(
+    ThreadSpecificPotentials& value_storage,
+    bool compute_grad,
+    bool compute_hess) const
+{
+    ThreadSpecificPotentials& storage =
+        compute_grad || compute_hess ? m_potential_storage : value_storage;
+    for (PotentialStorage& p : storage) {
+        p.clear();
+    }
+    return storage;
+}
+
+// Append the (block row, block column) of every stored hessian block and
+// of the blocks of the local hessians (only the ones on or below the block
+// diagonal if lower_triangular)
+void append_hessian_block_ids(
+    const ThreadSpecificPotentials& potentials,
+    bool lower_triangular,
+    std::vector<std::array<long, 2>>& block_ids)
+{
+    for (const auto& p : potentials) {
+        for (const auto& [bi, bj, hess_ij] : p.hessian_blocks) {
+            block_ids.push_back({ { bi, bj } });
+        }
+        for (const auto& [b0, b1] : p.local_hessians.body_ids) {
+            if (b0 == b1) {
+                continue; // The diagonal blocks are always in the pattern
+            }
+            if (!lower_triangular || b0 < b1) {
+                block_ids.push_back({ { b0, b1 } });
+            }
+            if (!lower_triangular || b1 < b0) {
+                block_ids.push_back({ { b1, b0 } });
+            }
+        }
+    }
+}
+
+// Add the scaled PSD projections of the stored local hessians to their
+// blocks on the host.
+void accumulate_local_hessians(
+    const ThreadSpecificPotentials& potentials,
+    double scale,
+    bool lazy_psd_projection,
+    bool lower_triangular,
+    BlockSparseSkeleton& hess)
+{
+    const int ndof = hess.block_size();
+    for (const auto& p : potentials) {
+        for (size_t i = 0; i < p.local_hessians.size(); i++) {
+            Eigen::MatrixXd local_hessian = p.local_hessians.local_hessian(i);
+            project_local_hessian_to_psd(local_hessian, lazy_psd_projection);
+            const std::array<long, 2>& body_ids = p.local_hessians.body_ids[i];
+            for (int b_i = 0; b_i < 2; b_i++) {
+                for (int b_j = 0; b_j < 2; b_j++) {
+                    if (lower_triangular && body_ids[b_i] < body_ids[b_j]) {
+                        continue;
+                    }
+                    hess.add_block(
+                        hess.find_block(body_ids[b_i], body_ids[b_j]),
+                        local_hessian.block(ndof * b_i, ndof * b_j, ndof, ndof),
+                        scale);
+                }
+            }
+        }
+    }
+}
+
+// Add the scaled stored derivatives to the gradient and the hessian blocks
+// (each skipped if nullptr) in place.
+// @returns The sum of the (unscaled) potentials.
+double accumulate_derivative_storage(
+    const ThreadSpecificPotentials& potentials,
+    int rb_ndof,
+    double scale,
+    Eigen::VectorXd* grad,
+    BlockSparseSkeleton* hess)
+{
+    PROFILE_POINT("accumulate_derivative_storage");
+    PROFILE_START();
+
+    const auto scatter = [&](const PotentialStorage& p, size_t grad_begin,
+                             size_t grad_end, size_t hess_begin,
+                             size_t hess_end) {
+        if (grad != nullptr) {
+            for (size_t i = grad_begin; i < grad_end; i++) {
+                const auto& [bi, grad_i] = p.gradient[i];
+                grad->segment(rb_ndof * bi, rb_ndof) += scale * grad_i;
+            }
+        }
+        if (hess != nullptr) {
+            for (size_t i = hess_begin; i < hess_end; i++) {
+                const auto& [bi, bj, hess_ij] = p.hessian_blocks[i];
+                hess->add_block(hess->find_block(bi, bj), hess_ij, scale);
+            }
+        }
+    };
+
+    // Scatter only the stored entries (O(#constraints) instead of O(#bodies)
+    // per thread)
     double potential = 0;
-    Eigen::VectorXd gradient;
-    std::vector<Eigen::Triplet<double>> hessian_triplets;
-};
-typedef tbb::enumerable_thread_specific<PotentialStorage>
-    ThreadSpecificPotentials;
+    bool has_segments = false;
+    for (const auto& p : potentials) {
+        has_segments |= !p.segments.empty();
+    }
+    if (!has_segments) {
+        for (const auto& p : potentials) {
+            potential += p.potential;
+            scatter(p, 0, p.gradient.size(), 0, p.hessian_blocks.size());
+        }
+    } else {
+        // Deterministic mode: merge the fixed subranges in constraint order
+        // regardless of which thread computed them.
+        struct OrderedSegment {
+            const PotentialStorage* storage;
+            const PotentialStorage::Segment* segment;
+            size_t gradient_begin, hessian_begin;
+        };
+        std::vector<OrderedSegment> ordered;
+        for (const auto& p : potentials) {
+            size_t gradient_begin = 0, hessian_begin = 0;
+            for (const auto& segment : p.segments) {
+                ordered.push_back(
+                    { &p, &segment, gradient_begin, hessian_begin });
+                gradient_begin = segment.gradient_end;
+                hessian_begin = segment.hessian_end;
+            }
+        }
+        std::sort(
+            ordered.begin(), ordered.end(),
+            [](const OrderedSegment& a, const OrderedSegment& b) {
+                return a.segment->begin < b.segment->begin;
+            });
+        for (const OrderedSegment& o : ordered) {
+            potential += o.segment->potential;
+            scatter(
+                *o.storage, o.gradient_begin, o.segment->gradient_end,
+                o.hessian_begin, o.segment->hessian_end);
+        }
+    }
+
+    PROFILE_END();
+
+    return potential;
+}
 
 double merge_derivative_storage(
     const ThreadSpecificPotentials& potentials,
     size_t nvars,
+    int rb_ndof,
+    bool is_lower_triangular,
     Eigen::VectorXd& grad,
     Eigen::SparseMatrix<double>& hess,
     bool compute_grad,
     bool compute_hess)
 {
-    PROFILE_POINT("merge_derivative_storage");
-    PROFILE_START();
-
     if (compute_grad) {
-        grad.setZero(nvars);
+        grad.resize(nvars);
+        parallel_first_touch(grad.data(), nvars);
     }
+    BlockSparseSkeleton hess_skeleton;
     if (compute_hess) {
-        hess.resize(nvars, nvars);
+        std::vector<std::array<long, 2>> block_ids;
+        append_hessian_block_ids(potentials, is_lower_triangular, block_ids);
+        hess_skeleton.reserve_blocks(nvars / rb_ndof, rb_ndof, block_ids);
     }
 
-    double potential = 0;
-    for (const auto& p : potentials) {
-        potential += p.potential;
+    double potential = accumulate_derivative_storage(
+        potentials, rb_ndof, /*scale=*/1, compute_grad ? &grad : nullptr,
+        compute_hess ? &hess_skeleton : nullptr);
 
-        if (compute_grad) {
-            grad += p.gradient;
+    if (compute_hess) {
+        // Convert to compressed column storage once for all threads (the
+        // terms are always returned whole)
+        if (is_lower_triangular) {
+            hess = hess_skeleton.matrix().selfadjointView<Eigen::Lower>();
+        } else {
+            hess = hess_skeleton.matrix();
         }
 
-        if (compute_hess) {
-            Eigen::SparseMatrix<double> p_hess(nvars, nvars);
-            p_hess.setFromTriplets(
-                p.hessian_triplets.begin(), p.hessian_triplets.end());
-            hess += p_hess;
+        size_t hess_bytes = MemoryUsage::bytes_of(hess);
+        for (const auto& p : potentials) {
+            hess_bytes += MemoryUsage::bytes_of(p.hessian_blocks);
         }
+        MemoryUsage::set_bytes(MemoryUsage::HESSIAN_TRIPLETS, hess_bytes);
+    }
+
+    return potential;
+}
+
+double DistanceBarrierRBProblem::compute_objective_in_place(
+    const Eigen::VectorXd& x,
+    Eigen::VectorXd& grad,
+    Eigen::SparseMatrix<double>& hess)
+{
+    const double fx = assemble_objective_in_place(x, grad);
+    // Same size and number of nonzeros, so this only copies the arrays (only
+    // the lower triangle if lower_triangular_hessian)
+    hess = m_hessian_skeleton.matrix();
+    return fx;
+}
+
+bool DistanceBarrierRBProblem::compute_free_objective(
+    const Eigen::VectorXd& x,
+    const Eigen::VectorXi& free_dof,
+    const std::vector<int>& full_to_free_dof,
+    double& fx,
+    Eigen::VectorXd& grad,
+    Eigen::SparseMatrix<double>& hess_free)
+{
+#ifdef RIGID_IPC_WITH_DERIVATIVE_CHECK
+    // The derivative checks are of the full hessian
+    return false;
+#else
+    fx = assemble_objective_in_place(x, grad);
+    m_hessian_skeleton.free_matrix(free_dof, full_to_free_dof, hess_free);
+    return true;
+#endif
+}
+
+double DistanceBarrierRBProblem::assemble_objective_in_place(
+    const Eigen::VectorXd& x, Eigen::VectorXd& grad)
+{
+    PROFILE_POINT("DistanceBarrierRBProblem::assemble_objective_in_place");
+    PROFILE_START();
+
+    const int rb_ndof = PoseD::dim_to_ndof(dim());
+    const double inv_avg_mass = 1 / average_mass();
+    const double kappa_over_avg_mass = barrier_stiffness() * inv_avg_mass;
+
+    // The contact potentials come first, so the hessian pattern is known
+    // before any value is written.
+    for (PotentialStorage& p : m_potential_storage) {
+        p.clear();
+    }
+    for (PotentialStorage& p : m_friction_potential_storage) {
+        p.clear();
+    }
+    Constraints constraints;
+    std::vector<double> barrier_weights;
+    if (m_use_barriers) {
+        m_constraint.construct_constraint_set(
+            m_assembler, cached_poses(x), constraints, &barrier_weights);
+    }
+    m_hessian_block_ids.clear();
+    if (colored_hessian_assembly) {
+        // The derivatives are computed once the pattern is reserved
+        color_contacts(constraints);
+    } else if (m_use_barriers) {
+        // The batched sums do not follow the constraint order
+#ifdef RIGID_IPC_WITH_CUDA
+        m_is_deferring_local_hessians =
+            gpu_hessian_assembly && !m_constraint.deterministic;
+#endif
+        compute_barrier_potentials(
+            x, constraints, barrier_weights, m_potential_storage,
+            /*compute_grad=*/true, /*compute_hess=*/true);
+        compute_friction_potentials(
+            x, m_friction_potential_storage, /*compute_grad=*/true,
+            /*compute_hess=*/true);
+        m_is_deferring_local_hessians = false;
+    }
+
+    append_hessian_block_ids(
+        m_potential_storage, lower_triangular_hessian, m_hessian_block_ids);
+    append_hessian_block_ids(
+        m_friction_potential_storage, lower_triangular_hessian,
+        m_hessian_block_ids);
+    if (!m_hessian_skeleton.reserve_blocks(
+            num_bodies(), rb_ndof, m_hessian_block_ids)) {
+        m_hessian_skeleton.setZero();
+    }
+
+    grad.resize(x.size());
+    parallel_first_touch(grad.data(), size_t(x.size()));
+    double fx = inv_avg_mass
+        * accumulate_energy_term(x, inv_avg_mass, &grad, &m_hessian_skeleton);
+
+    // The augmented Lagrangian only touches the diagonal blocks of the
+    // kinematic bodies (and is usually empty).
+    Eigen::VectorXd grad_AL;
+    Eigen::SparseMatrix<double> hess_AL;
+    fx += inv_avg_mass
+        * compute_augmented_lagrangian(
+              x, grad_AL, hess_AL, /*compute_grad=*/true,
+              /*compute_hess=*/true);
+    grad += inv_avg_mass * grad_AL;
+    if (hess_AL.nonZeros() != 0) {
+        m_hessian_skeleton.add(hess_AL, inv_avg_mass);
+    }
+
+    if (colored_hessian_assembly) {
+        fx += scatter_colored_contacts(x, constraints, barrier_weights, grad);
+    } else {
+        fx += kappa_over_avg_mass
+            * accumulate_derivative_storage(
+                  m_potential_storage, rb_ndof, kappa_over_avg_mass, &grad,
+                  &m_hessian_skeleton);
+        assemble_local_hessians(m_potential_storage, kappa_over_avg_mass);
+        fx += inv_avg_mass
+            * accumulate_derivative_storage(
+                  m_friction_potential_storage, rb_ndof, inv_avg_mass, &grad,
+                  &m_hessian_skeleton);
+        assemble_local_hessians(m_friction_potential_storage, inv_avg_mass);
     }
 
     PROFILE_END();
 
-    return potential;
+    return fx;
+}
+
+void DistanceBarrierRBProblem::assemble_local_hessians(
+    const ThreadSpecificPotentials& potentials, double scale)
+{
+    std::vector<const LocalHessianBatch*> batches;
+    size_t num_local_hessians = 0;
+    for (const PotentialStorage& p : potentials) {
+        batches.push_back(&p.local_hessians);
+        num_local_hessians += p.local_hessians.size();
+    }
+    if (num_local_hessians == 0) {
+        return;
+    }
+
+    PROFILE_POINT("DistanceBarrierRBProblem::assemble_local_hessians");
+    PROFILE_START();
+#ifdef RIGID_IPC_WITH_CUDA
+    if (m_cuda_hessian_assembler.assemble(
+            batches, scale, lower_triangular_hessian, m_hessian_skeleton)) {
+        StepMetrics::add_count(
+            StepMetrics::PSD_PROJECTIONS, num_local_hessians);
+        PROFILE_END();
+        return;
+    }
+#endif
+    accumulate_local_hessians(
+        potentials, scale, lazy_psd_projection, lower_triangular_hessian,
+        m_hessian_skeleton);
+    PROFILE_END();
+}
+
+// WARNING: PROFILE_POINTs are not thread safe
+// NAMED_PROFILE_POINT(
+//     "DistanceBarrierRBProblem::compute_barrier_potential:value",
+//     COMPUTE_BARRIER_VAL);
+// NAMED_PROFILE_POINT(
+//     "DistanceBarrierRBProblem::compute_barrier_potential:gradient",
+//     COMPUTE_BARRIER_GRAD);
+// NAMED_PROFILE_POINT(
+//     "DistanceBarrierRBProblem::compute_barrier_potential:hessian",
+//     COMPUTE_BARRIER_HESS);
+template <int DIM, typename ContactConstraint>
+double DistanceBarrierRBProblem::compute_barrier_potential(
+    const Eigen::MatrixXd& V,
+    const WorldVerticesDiff& V_diff,
+    const ContactConstraint& constraint,
+    const ConstraintIndices& indices,
+    double weight,
+    double dhat,
+    PotentialStorage& storage,
+    bool compute_grad,
+    bool compute_hess)
+{
+    if (m_constraint.per_body_activation_distance) {
+        const auto [body0, body1] = indices.body_ids;
+        dhat = m_constraint.pair_activation_distance(m_assembler, body0, body1);
+    }
+
+    // PROFILE_START(COMPUTE_BARRIER_VAL);
+    double Bx =
+        weight * constraint.compute_potential(V, edges(), faces(), dhat);
+    // PROFILE_END(COMPUTE_BARRIER_VAL);
+
+    if (!compute_grad && !compute_hess) {
+        return Bx;
+    }
+
+    // PROFILE_START(COMPUTE_BARRIER_GRAD);
+    VectorMax12d grad_B = weight
+        * constraint.compute_potential_gradient(V, edges(), faces(), dhat);
+    // PROFILE_END(COMPUTE_BARRIER_GRAD);
+
+    MatrixMax12d hess_B;
+    if (compute_hess) {
+        // PROFILE_START(COMPUTE_BARRIER_HESS);
+        hess_B = weight
+            * constraint.compute_potential_hessian(
+                V, edges(), faces(), dhat, /*project_hessian_to_psd=*/false);
+        // PROFILE_END(COMPUTE_BARRIER_HESS);
+    }
+
+    apply_chain_rule<DIM, ConstraintNumVertices<ContactConstraint>::value>(
+        grad_B, hess_B, V_diff, indices, storage, lazy_psd_projection,
+        lower_triangular_hessian, m_is_deferring_local_hessians, compute_grad,
+        compute_hess);
+
+    return Bx;
+}
+
+template <int DIM>
+double DistanceBarrierRBProblem::compute_indexed_barrier_potential(
+    const Eigen::MatrixXd& V,
+    const WorldVerticesDiff& V_diff,
+    const Constraints& constraints,
+    size_t ci,
+    const ConstraintIndices& indices,
+    double weight,
+    double dhat,
+    PotentialStorage& storage,
+    bool compute_grad,
+    bool compute_hess)
+{
+    const auto& vv = constraints.vv_constraints;
+    if (ci < vv.size()) {
+        return compute_barrier_potential<DIM>(
+            V, V_diff, vv[ci], indices, weight, dhat, storage, compute_grad,
+            compute_hess);
+    }
+    ci -= vv.size();
+    const auto& ev = constraints.ev_constraints;
+    if (ci < ev.size()) {
+        return compute_barrier_potential<DIM>(
+            V, V_diff, ev[ci], indices, weight, dhat, storage, compute_grad,
+            compute_hess);
+    }
+    ci -= ev.size();
+    const auto& ee = constraints.ee_constraints;
+    if (ci < ee.size()) {
+        return compute_barrier_potential<DIM>(
+            V, V_diff, ee[ci], indices, weight, dhat, storage, compute_grad,
+            compute_hess);
+    }
+    ci -= ee.size();
+    const auto& fv = constraints.fv_constraints;
+    assert(ci < fv.size());
+    return compute_barrier_potential<DIM>(
+        V, V_diff, fv[ci], indices, weight, dhat, storage, compute_grad,
+        compute_hess);
+}
+
+void DistanceBarrierRBProblem::compute_barrier_potentials(
+    const Eigen::VectorXd& x,
+    const Constraints& constraints,
+    const std::vector<double>& barrier_weights,
+    ThreadSpecificPotentials& thread_storage,
+    bool compute_grad,
+    bool compute_hess)
+{
+    if (constraints.size() == 0) {
+        return;
+    }
+    TRACE_SCOPE("barrier_assembly");
+
+    // Compute V(x)
+    const KinematicsCache& kinematics = cached_world_vertices_diff(
+        x, compute_grad || compute_hess, compute_hess);
+    const Eigen::MatrixXd& V = kinematics.V;
+    const WorldVerticesDiff& V_diff = kinematics.V_diff;
+
+    // The cached constraint set keeps its indices, any other set gathers
+    // them once here instead of once per constraint and evaluation.
+    const bool has_cached_indices = &constraints == &kinematics.constraints
+        && kinematics.has_constraints
+        && kinematics.constraint_indices.size() == constraints.size();
+    std::vector<ConstraintIndices> local_indices;
+    if (!has_cached_indices) {
+        build_constraint_indices(m_assembler, constraints, local_indices);
+    }
+    const std::vector<ConstraintIndices>& indices =
+        has_cached_indices ? kinematics.constraint_indices : local_indices;
+
+    double dhat = barrier_activation_distance();
+
+    dispatch_dim(dim(), [&](auto dim_constant) {
+        constexpr int DIM = decltype(dim_constant)::value;
+        deterministic_parallel_for(
+            m_constraint.deterministic, constraints.size(),
+            [&](const tbb::blocked_range<size_t>& range) {
+                TRACE_SCOPE("barrier_assembly::constraints");
+                // Get references to the local derivative storage
+                auto& local_storage = thread_storage.local();
+                double potential = 0;
+
+                for (size_t ci = range.begin(); ci != range.end(); ++ci) {
+                    const double weight =
+                        barrier_weights.empty() ? 1.0 : barrier_weights[ci];
+                    potential += compute_indexed_barrier_potential<DIM>(
+                        V, V_diff, constraints, ci, indices[ci], weight, dhat,
+                        local_storage, compute_grad, compute_hess);
+                }
+                local_storage.add_range(
+                    range.begin(), potential, m_constraint.deterministic);
+            },
+            m_barrier_loops[derivative_order(compute_grad, compute_hess)]);
+    });
+
 }
 
 double DistanceBarrierRBProblem::compute_barrier_term(
     const Eigen::VectorXd& x,
     const Constraints& constraints,
+    const std::vector<double>& barrier_weights,
     Eigen::VectorXd& grad,
     Eigen::SparseMatrix<double>& hess,
     bool compute_grad,
@@ -1311,74 +2831,18 @@ double DistanceBarrierRBProblem::compute_barrier_term(
     }
 
     PROFILE_POINT("DistanceBarrierRBProblem::compute_barrier_term");
-    // WARNING: PROFILE_POINTs are not thread safe
-    // NAMED_PROFILE_POINT(
-    //     "DistanceBarrierRBProblem::compute_barrier_term:value",
-    //     COMPUTE_BARRIER_VAL);
-    // NAMED_PROFILE_POINT(
-    //     "DistanceBarrierRBProblem::compute_barrier_term:gradient",
-    //     COMPUTE_BARRIER_GRAD);
-    // NAMED_PROFILE_POINT(
-    //     "DistanceBarrierRBProblem::compute_barrier_term:hessian",
-    //     COMPUTE_BARRIER_HESS);
-
     PROFILE_START();
 
-    int rb_ndof = PoseD::dim_to_ndof(dim());
-
-    // Compute V(x)
-    Eigen::MatrixXd jac_V, hess_V;
-    Eigen::MatrixXd V = m_assembler.world_vertices_diff(
-        x, jac_V, hess_V, compute_grad || compute_hess, compute_hess);
-
-    double dhat = barrier_activation_distance();
-
-    ThreadSpecificPotentials thread_storage(x.size());
-    tbb::parallel_for(
-        tbb::blocked_range<size_t>(size_t(0), constraints.size()),
-        [&](const tbb::blocked_range<size_t>& range) {
-            // Get references to the local derivative storage
-            auto& local_storage = thread_storage.local();
-            auto& potential = local_storage.potential;
-            auto& local_grad = local_storage.gradient;
-            auto& hess_triplets = local_storage.hessian_triplets;
-
-            for (size_t ci = range.begin(); ci != range.end(); ++ci) {
-                const auto& constraint = constraints[ci];
-
-                // PROFILE_START(COMPUTE_BARRIER_VAL);
-                potential +=
-                    constraint.compute_potential(V, edges(), faces(), dhat);
-                // PROFILE_START(COMPUTE_BARRIER_VAL);
-
-                VectorMax12d grad_B;
-                if (compute_grad || compute_hess) {
-                    // PROFILE_START(COMPUTE_BARRIER_GRAD);
-                    grad_B = constraint.compute_potential_gradient(
-                        V, edges(), faces(), dhat);
-                    // PROFILE_END(COMPUTE_BARRIER_GRAD);
-                }
-
-                MatrixMax12d hess_B;
-                if (compute_hess) {
-                    // PROFILE_START(COMPUTE_BARRIER_HESS);
-                    hess_B = constraint.compute_potential_hessian(
-                        V, edges(), faces(), dhat,
-                        /*project_hessian_to_psd=*/false);
-                    // PROFILE_END(COMPUTE_BARRIER_HESS);
-                }
-
-                apply_chain_rule(
-                    grad_B, jac_V, hess_B, hess_V,
-                    constraint.vertex_indices(edges(), faces()),
-                    vertex_local_body_ids(constraints, ci),
-                    body_ids(m_assembler, constraints, ci), dim(), local_grad,
-                    hess_triplets, compute_grad, compute_hess);
-            }
-        });
+    ThreadSpecificPotentials value_storage;
+    ThreadSpecificPotentials& thread_storage =
+        potential_storage(value_storage, compute_grad, compute_hess);
+    compute_barrier_potentials(
+        x, constraints, barrier_weights, thread_storage, compute_grad,
+        compute_hess);
 
     double potential = merge_derivative_storage(
-        thread_storage, x.size(), grad, hess, compute_grad, compute_hess);
+        thread_storage, x.size(), PoseD::dim_to_ndof(dim()),
+        lower_triangular_hessian, grad, hess, compute_grad, compute_hess);
 
     PROFILE_END();
 
@@ -1386,10 +2850,10 @@ double DistanceBarrierRBProblem::compute_barrier_term(
     if (!is_checking_derivative) {
         is_checking_derivative = true;
         if (compute_grad) {
-            check_barrier_gradient(x, constraints, grad);
+            check_barrier_gradient(x, constraints, barrier_weights, grad);
         }
         if (compute_hess) {
-            check_barrier_hessian(x, constraints, hess);
+            check_barrier_hessian(x, constraints, barrier_weights, hess);
         }
         is_checking_derivative = false;
     }
@@ -1407,14 +2871,13 @@ double DistanceBarrierRBProblem::compute_barrier_term(
 // NAMED_PROFILE_POINT(
 //     "DistanceBarrierRBProblem::compute_friction_potential:hessian",
 //     COMPUTE_FRICTION_HESS);
-template <typename RigidBodyConstraint, typename FrictionConstraint>
+template <int DIM, typename FrictionConstraint>
 double DistanceBarrierRBProblem::compute_friction_potential(
     const Eigen::MatrixXd& U,
-    const Eigen::MatrixXd& jac_V,
-    const Eigen::MatrixXd& hess_V,
+    const WorldVerticesDiff& V_diff,
     const FrictionConstraint& constraint,
-    Eigen::VectorXd& grad,
-    std::vector<Eigen::Triplet<double>>& hess_triplets,
+    const ConstraintIndices& indices,
+    PotentialStorage& storage,
     bool compute_grad,
     bool compute_hess)
 {
@@ -1431,8 +2894,6 @@ double DistanceBarrierRBProblem::compute_friction_potential(
     //     local_to_global(∇ₓD(V(x)))
     //     local_to_global(project_to_psd(∇ₓ²D(V(x))))
 
-    int rb_ndof = PoseD::dim_to_ndof(dim());
-
     double epsv_times_h = static_friction_speed_bound * timestep();
 
     // PROFILE_START(COMPUTE_FRICTION_VAL);
@@ -1456,102 +2917,266 @@ double DistanceBarrierRBProblem::compute_friction_potential(
         // PROFILE_END(COMPUTE_FRICTION_HESS);
     }
 
-    RigidBodyConstraint rbc(m_assembler, constraint);
-    apply_chain_rule(
-        grad_D, jac_V, hess_D, hess_V,
-        constraint.vertex_indices(edges(), faces()),
-        rbc.vertex_local_body_ids(), rbc.body_ids(), dim(), //
-        grad, hess_triplets, compute_grad, compute_hess);
+    apply_chain_rule<DIM, ConstraintNumVertices<FrictionConstraint>::value>(
+        grad_D, hess_D, V_diff, indices, storage, lazy_psd_projection,
+        lower_triangular_hessian, m_is_deferring_local_hessians, compute_grad,
+        compute_hess);
 
     return Dx;
 }
 
-double DistanceBarrierRBProblem::compute_friction_term(
+template <int DIM>
+double DistanceBarrierRBProblem::compute_indexed_friction_potential(
+    const Eigen::MatrixXd& U,
+    const WorldVerticesDiff& V_diff,
+    const FrictionConstraints& constraints,
+    size_t ci,
+    const ConstraintIndices& indices,
+    PotentialStorage& storage,
+    bool compute_grad,
+    bool compute_hess)
+{
+    const auto& vv = constraints.vv_constraints;
+    if (ci < vv.size()) {
+        return compute_friction_potential<DIM>(
+            U, V_diff, vv[ci], indices, storage, compute_grad, compute_hess);
+    }
+    ci -= vv.size();
+    const auto& ev = constraints.ev_constraints;
+    if (ci < ev.size()) {
+        return compute_friction_potential<DIM>(
+            U, V_diff, ev[ci], indices, storage, compute_grad, compute_hess);
+    }
+    ci -= ev.size();
+    const auto& ee = constraints.ee_constraints;
+    if (ci < ee.size()) {
+        return compute_friction_potential<DIM>(
+            U, V_diff, ee[ci], indices, storage, compute_grad, compute_hess);
+    }
+    ci -= ee.size();
+    const auto& fv = constraints.fv_constraints;
+    assert(ci < fv.size());
+    return compute_friction_potential<DIM>(
+        U, V_diff, fv[ci], indices, storage, compute_grad, compute_hess);
+}
+
+void DistanceBarrierRBProblem::compute_friction_potentials(
     const Eigen::VectorXd& x,
-    Eigen::VectorXd& grad,
-    Eigen::SparseMatrix<double>& hess,
+    ThreadSpecificPotentials& thread_storage,
     bool compute_grad,
     bool compute_hess)
 {
     if (coefficient_friction <= 0 || friction_constraints.size() == 0) {
-        grad.setZero(x.size());
-        hess.resize(x.size(), x.size());
-        return 0;
+        return;
     }
-
-    PROFILE_POINT("DistanceBarrierRBProblem::compute_friction_term");
-    PROFILE_START();
-
-    int rb_ndof = PoseD::dim_to_ndof(dim());
+    TRACE_SCOPE("friction_assembly");
 
     // Compute V(x)
-    Eigen::MatrixXd jac_V, hess_V;
-    Eigen::MatrixXd V1 = m_assembler.world_vertices_diff(
-        x, jac_V, hess_V, compute_grad || compute_hess, compute_hess);
+    const KinematicsCache& kinematics = cached_world_vertices_diff(
+        x, compute_grad || compute_hess, compute_hess);
+    const Eigen::MatrixXd& V1 = kinematics.V;
+    const WorldVerticesDiff& V_diff = kinematics.V_diff;
 
     NAMED_PROFILE_POINT(
         "DistanceBarrierRBProblem::compute_friction_term:displacement",
         DISPLACEMENT);
     PROFILE_START(DISPLACEMENT);
     // absolute linear dislacement of each point
-    Eigen::MatrixXd U = V1 - m_assembler.world_vertices(poses_t0);
+    Eigen::MatrixXd U = V1 - vertices_t0();
     PROFILE_END(DISPLACEMENT);
 
-    ThreadSpecificPotentials thread_storage(x.size());
-    tbb::parallel_for(
-        tbb::blocked_range<size_t>(size_t(0), friction_constraints.size()),
-        [&](const tbb::blocked_range<size_t>& range) {
-            // Get references to the local derivative storage
-            auto& local_storage = thread_storage.local();
-            auto& potential = local_storage.potential;
-            auto& local_grad = local_storage.gradient;
-            auto& hess_triplets = local_storage.hessian_triplets;
-
-            for (size_t ci = range.begin(); ci != range.end(); ++ci) {
-                size_t local_ci = ci;
-
-                if (local_ci < friction_constraints.vv_constraints.size()) {
-                    potential += compute_friction_potential<
-                        RigidBodyVertexVertexConstraint>(
-                        U, jac_V, hess_V,
-                        friction_constraints.vv_constraints[local_ci],
-                        local_grad, hess_triplets, compute_grad, compute_hess);
-                    continue;
-                }
+    const std::vector<ConstraintIndices>& indices =
+        friction_constraint_indices;
+    assert(indices.size() == friction_constraints.size());
+
+    dispatch_dim(dim(), [&](auto dim_constant) {
+        constexpr int DIM = decltype(dim_constant)::value;
+        deterministic_parallel_for(
+            m_constraint.deterministic, friction_constraints.size(),
+            [&](const tbb::blocked_range<size_t>& range) {
+                TRACE_SCOPE("friction_assembly::constraints");
+                // Get references to the local derivative storage
+                auto& local_storage = thread_storage.local();
+                double potential = 0;
+
+                // Each type's constraints are evaluated by their own kernel
+                for_each_typed_range(
+                    friction_constraints, range.begin(), range.end(),
+                    [&](const auto& constraints, size_t offset, size_t begin,
+                        size_t end) {
+                        for (size_t i = begin; i < end; i++) {
+                            potential += compute_friction_potential<DIM>(
+                                U, V_diff, constraints[i],
+                                indices[offset + i], local_storage,
+                                compute_grad, compute_hess);
+                        }
+                    });
+                local_storage.add_range(
+                    range.begin(), potential, m_constraint.deterministic);
+            },
+            m_friction_loops[derivative_order(compute_grad, compute_hess)]);
+    });
 
-                local_ci -= friction_constraints.vv_constraints.size();
-                if (local_ci < friction_constraints.ev_constraints.size()) {
-                    potential += compute_friction_potential<
-                        RigidBodyEdgeVertexConstraint>(
-                        U, jac_V, hess_V,
-                        friction_constraints.ev_constraints[local_ci],
-                        local_grad, hess_triplets, compute_grad, compute_hess);
-                    continue;
-                }
+}
 
-                local_ci -= friction_constraints.ev_constraints.size();
-                if (local_ci < friction_constraints.ee_constraints.size()) {
-                    potential +=
-                        compute_friction_potential<RigidBodyEdgeEdgeConstraint>(
-                            U, jac_V, hess_V,
-                            friction_constraints.ee_constraints[local_ci],
-                            local_grad, hess_triplets, compute_grad,
-                            compute_hess);
-                    continue;
-                }
+void DistanceBarrierRBProblem::color_contacts(const Constraints& constraints)
+{
+    PROFILE_POINT("DistanceBarrierRBProblem::color_contacts");
+    PROFILE_START();
+
+    ColoredContacts& colored = m_colored_contacts;
+    build_constraint_indices(m_assembler, constraints, colored.indices);
+    colored.num_contacts = colored.indices.size();
+    if (m_use_barriers && coefficient_friction > 0) {
+        assert(
+            friction_constraint_indices.size() == friction_constraints.size());
+        colored.indices.insert(
+            colored.indices.end(), friction_constraint_indices.begin(),
+            friction_constraint_indices.end());
+    }
+
+    colored.body_pairs.clear();
+    for (const ConstraintIndices& indices : colored.indices) {
+        const auto [b0, b1] = indices.body_ids;
+        colored.body_pairs.push_back(indices.body_ids);
+        if (b0 == b1) {
+            continue; // The diagonal blocks are always in the pattern
+        }
+        // Same blocks as local_hessian_to_global_blocks()
+        if (!lower_triangular_hessian || b0 > b1) {
+            m_hessian_block_ids.push_back({ { b0, b1 } });
+        }
+        if (!lower_triangular_hessian || b1 > b0) {
+            m_hessian_block_ids.push_back({ { b1, b0 } });
+        }
+    }
 
-                local_ci -= friction_constraints.ee_constraints.size();
-                assert(local_ci < friction_constraints.fv_constraints.size());
-                potential +=
-                    compute_friction_potential<RigidBodyFaceVertexConstraint>(
-                        U, jac_V, hess_V,
-                        friction_constraints.fv_constraints[local_ci],
-                        local_grad, hess_triplets, compute_grad, compute_hess);
+    color_node_pairs(
+        colored.body_pairs, num_bodies(),
+        Constants::HESSIAN_ASSEMBLY_MAX_COLORS, colored.coloring);
+    RIGID_IPC_LOG_DEBUG(
+        "problem={} num_colored_constraints={:d} num_colors={:d} "
+        "num_uncolored_constraints={:d}",
+        name(), colored.indices.size(), colored.coloring.num_colors(),
+        colored.coloring.num_uncolored());
+
+    PROFILE_END();
+}
+
+double DistanceBarrierRBProblem::scatter_colored_contacts(
+    const Eigen::VectorXd& x,
+    const Constraints& constraints,
+    const std::vector<double>& barrier_weights,
+    Eigen::VectorXd& grad)
+{
+    ColoredContacts& colored = m_colored_contacts;
+    if (colored.indices.empty()) {
+        return 0;
+    }
+    TRACE_SCOPE("colored_assembly");
+
+    const int rb_ndof = PoseD::dim_to_ndof(dim());
+    const double inv_avg_mass = 1 / average_mass();
+    const double kappa_over_avg_mass = barrier_stiffness() * inv_avg_mass;
+    const double dhat = barrier_activation_distance();
+
+    const KinematicsCache& kinematics = cached_world_vertices_diff(
+        x, /*compute_jac=*/true, /*compute_hess=*/true);
+    const Eigen::MatrixXd& V = kinematics.V;
+    const WorldVerticesDiff& V_diff = kinematics.V_diff;
+    Eigen::MatrixXd U;
+    if (colored.indices.size() > colored.num_contacts) {
+        U = V - vertices_t0();
+    }
+
+    colored.potentials.resize(colored.indices.size());
+    dispatch_dim(dim(), [&](auto dim_constant) {
+        constexpr int DIM = decltype(dim_constant)::value;
+        // The storage only holds the derivatives of one constraint at a time
+        const auto scatter = [&](size_t ci) {
+            PotentialStorage& storage = m_potential_storage.local();
+            storage.clear();
+            double scale;
+            if (ci < colored.num_contacts) {
+                scale = kappa_over_avg_mass;
+                const double weight =
+                    barrier_weights.empty() ? 1.0 : barrier_weights[ci];
+                colored.potentials[ci] = scale
+                    * compute_indexed_barrier_potential<DIM>(
+                        V, V_diff, constraints, ci, colored.indices[ci], weight,
+                        dhat, storage, /*compute_grad=*/true,
+                        /*compute_hess=*/true);
+            } else {
+                scale = inv_avg_mass;
+                colored.potentials[ci] = scale
+                    * compute_indexed_friction_potential<DIM>(
+                        U, V_diff, friction_constraints,
+                        ci - colored.num_contacts, colored.indices[ci],
+                        storage, /*compute_grad=*/true,
+                        /*compute_hess=*/true);
             }
-        });
+            for (const auto& [bi, grad_i] : storage.gradient) {
+                grad.segment(rb_ndof * bi, rb_ndof) += scale * grad_i;
+            }
+            for (const auto& [bi, bj, hess_ij] : storage.hessian_blocks) {
+                m_hessian_skeleton.add_block(
+                    m_hessian_skeleton.find_block(bi, bj), hess_ij, scale);
+            }
+        };
+
+        // The constraints of a color touch distinct bodies, so they write
+        // distinct gradient segments and hessian blocks.
+        const NodePairColoring& coloring = colored.coloring;
+        for (size_t c = 0; c < coloring.num_colors(); c++) {
+            tbb::parallel_for(
+                tbb::blocked_range<size_t>(
+                    coloring.color_starts[c], coloring.color_starts[c + 1]),
+                [&](const tbb::blocked_range<size_t>& range) {
+                    for (size_t i = range.begin(); i != range.end(); ++i) {
+                        scatter(coloring.items[i]);
+                    }
+                });
+        }
+        // Constraints of the bodies with too many contacts to color
+        for (size_t i = coloring.color_starts.back();
+             i < coloring.items.size(); i++) {
+            scatter(coloring.items[i]);
+        }
+    });
+
+    // Summed in constraint order, so the result does not depend on the
+    // threads
+    double potential = 0;
+    for (const double p : colored.potentials) {
+        potential += p;
+    }
+    return potential;
+}
+
+double DistanceBarrierRBProblem::compute_friction_term(
+    const Eigen::VectorXd& x,
+    Eigen::VectorXd& grad,
+    Eigen::SparseMatrix<double>& hess,
+    bool compute_grad,
+    bool compute_hess)
+{
+    if (coefficient_friction <= 0 || friction_constraints.size() == 0) {
+        grad.setZero(x.size());
+        hess.resize(x.size(), x.size());
+        return 0;
+    }
+
+    PROFILE_POINT("DistanceBarrierRBProblem::compute_friction_term");
+    PROFILE_START();
+
+    ThreadSpecificPotentials value_storage;
+    ThreadSpecificPotentials& thread_storage =
+        potential_storage(value_storage, compute_grad, compute_hess);
+    compute_friction_potentials(x, thread_storage, compute_grad, compute_hess);
 
     double potential = merge_derivative_storage(
-        thread_storage, x.size(), grad, hess, compute_grad, compute_hess);
+        thread_storage, x.size(), PoseD::dim_to_ndof(dim()),
+        lower_triangular_hessian, grad, hess, compute_grad, compute_hess);
 
     PROFILE_END();
 
@@ -1573,20 +3198,139 @@ double DistanceBarrierRBProblem::compute_friction_term(
 
 ///////////////////////////////////////////////////////////////////////////
 
+const PosesD&
+DistanceBarrierRBProblem::cached_poses(const Eigen::VectorXd& x) const
+{
+    KinematicsCache& cache = m_kinematics_caches.local();
+    if (cache.x.size() != x.size() || cache.x != x) {
+        cache.x = x;
+        PoseD::dofs_to_poses(x, dim(), cache.poses);
+        cache.has_V = cache.has_jac_V = cache.has_hess_V = false;
+        cache.has_constraints = cache.has_min_distance = false;
+    }
+    return cache.poses;
+}
+
+const Constraints&
+DistanceBarrierRBProblem::cached_constraint_set(const Eigen::VectorXd& x) const
+{
+    const PosesD& poses = cached_poses(x);
+    KinematicsCache& cache = m_kinematics_caches.local();
+    if (!cache.has_constraints && !adopt_constraint_set(cache)) {
+        cache.constraints = Constraints();
+        m_constraint.construct_constraint_set(
+            m_assembler, poses, cache.constraints, &cache.barrier_weights);
+        build_constraint_indices(
+            m_assembler, cache.constraints, cache.constraint_indices);
+        cache.has_constraints = true;
+    }
+    return cache.constraints;
+}
+
+bool DistanceBarrierRBProblem::adopt_constraint_set(
+    KinematicsCache& cache) const
+{
+    if (m_is_evaluating_objectives) {
+        return false;
+    }
+    for (const KinematicsCache& other : m_kinematics_caches) {
+        if (&other != &cache && other.has_constraints
+            && other.x.size() == cache.x.size() && other.x == cache.x) {
+            cache.constraints = other.constraints;
+            cache.barrier_weights = other.barrier_weights;
+            cache.constraint_indices = other.constraint_indices;
+            cache.min_distance = other.min_distance;
+            cache.has_min_distance = other.has_min_distance;
+            cache.has_constraints = true;
+            RIGID_IPC_LOG_TRACE(
+                "problem={} action=adopt_constraint_set num_constraints={:d}",
+                name(), cache.constraints.size());
+            return true;
+        }
+    }
+    return false;
+}
+
+const DistanceBarrierRBProblem::KinematicsCache&
+DistanceBarrierRBProblem::cached_world_vertices_diff(
+    const Eigen::VectorXd& x, bool compute_jac, bool compute_hess) const
+{
+    const PosesD& poses = cached_poses(x);
+    KinematicsCache& cache = m_kinematics_caches.local();
+    compute_jac |= compute_hess;
+    if (!cache.has_V) {
+        cache.V = m_assembler.world_vertices(poses);
+        cache.has_V = true;
+    }
+    if ((compute_hess && !cache.has_hess_V)
+        || (compute_jac && !cache.has_jac_V)) {
+        // Only the rotations are differentiated here. The derivatives of the
+        // vertices are built on demand for the active constraints.
+        cache.V_diff.compute(m_assembler, poses, compute_hess);
+        cache.has_jac_V = true;
+        cache.has_hess_V = compute_hess;
+    }
+    return cache;
+}
+
+Eigen::MatrixXd
+DistanceBarrierRBProblem::world_vertices(const Eigen::VectorXd& x) const
+{
+    // Look up x without evicting the cache of another x (e.g., the line
+    // search's current point while the solver checks x + direction)
+    const KinematicsCache& cache = m_kinematics_caches.local();
+    if (cache.x.size() == x.size() && cache.x == x) {
+        return cached_world_vertices_diff(
+                   x, /*compute_jac=*/false, /*compute_hess=*/false)
+            .V;
+    }
+    return m_assembler.world_vertices(x);
+}
+
+const Eigen::MatrixXd& DistanceBarrierRBProblem::vertices_t0() const
+{
+    if (m_vertices_t0.rows() != num_vertices()) {
+        m_vertices_t0 = m_assembler.world_vertices(poses_t0);
+    }
+    return m_vertices_t0;
+}
+
+void DistanceBarrierRBProblem::clear_kinematics_cache() const
+{
+    m_kinematics_caches.clear();
+    m_vertices_t0.resize(0, 0);
+}
+
+void DistanceBarrierRBProblem::clear_cached_constraint_sets() const
+{
+    for (KinematicsCache& cache : m_kinematics_caches) {
+        cache.has_constraints = cache.has_min_distance = false;
+    }
+}
+
 double DistanceBarrierRBProblem::compute_min_distance() const
 {
-    double min_distance = m_constraint.compute_minimum_distance(
-        m_assembler, m_assembler.rb_poses());
-    return std::isfinite(min_distance) ? min_distance : -1;
+    return compute_min_distance(this->poses_to_dofs(m_assembler.rb_poses()));
 }
 
 double
 DistanceBarrierRBProblem::compute_min_distance(const Eigen::VectorXd& x) const
 {
-    PosesD poses = this->dofs_to_poses(x);
-    double min_distance =
-        m_constraint.compute_minimum_distance(m_assembler, poses);
-    return std::isfinite(min_distance) ? min_distance : -1;
+    // Reuse the constraint set and world vertices of the barrier term at x,
+    // so only the distances of the active constraints are computed (once).
+    const Constraints& constraints = cached_constraint_set(x);
+    cached_world_vertices_diff(
+        x, /*compute_jac=*/false, /*compute_hess=*/false);
+    KinematicsCache& cache = m_kinematics_caches.local();
+    if (!cache.has_min_distance) {
+        PROFILE_POINT("DistanceBarrierRBProblem::compute_min_distance");
+        PROFILE_START();
+        cache.min_distance = sqrt(ipc::compute_minimum_distance(
+            cache.V, edges(), faces(), constraints));
+        cache.has_min_distance = true;
+        PROFILE_END();
+    }
+    return std::isfinite(cache.min_distance) ? cache.min_distance : -1;
 }
 
 bool DistanceBarrierRBProblem::has_collisions(
@@ -1620,6 +3364,22 @@ double DistanceBarrierRBProblem::compute_earliest_toi(
     return earliest_toi;
 }
 
+void DistanceBarrierRBProblem::prefetch_earliest_toi(
+    const Eigen::VectorXd& x_i, double max_displacement) const
+{
+    if (m_use_barriers) {
+        m_constraint.prefetch_ccd_candidates(
+            m_assembler, this->dofs_to_poses(x_i), max_displacement);
+    }
+}
+
+double DistanceBarrierRBProblem::max_vertex_displacement(
+    const Eigen::VectorXd& x_i, const Eigen::VectorXd& x_j) const
+{
+    return SpeculativeCCDCandidates::max_vertex_displacement(
+        m_assembler, this->dofs_to_poses(x_i), this->dofs_to_poses(x_j));
+}
+
 #ifdef RIGID_IPC_WITH_DERIVATIVE_CHECK
 // The following functions are used exclusivly to check that the
 // gradient and hessian match a finite difference version.
@@ -1627,6 +3387,7 @@ double DistanceBarrierRBProblem::compute_earliest_toi(
 void DistanceBarrierRBProblem::check_barrier_gradient(
     const Eigen::VectorXd& x,
     const Constraints& constraints,
+    const std::vector<double>& barrier_weights,
     const Eigen::VectorXd& grad)
 {
     ///////////////////////////////////////////////////////////////////////
@@ -1643,7 +3404,7 @@ void DistanceBarrierRBProblem::check_barrier_gradient(
         Eigen::VectorXd grad_b;
         Eigen::SparseMatrix<double> hess_b;
         return compute_barrier_term(
-            x, constraints, grad_b, hess_b,
+            x, constraints, barrier_weights, grad_b, hess_b,
             /*compute_grad=*/false, /*compute_hess=*/false);
     };
     Eigen::VectorXd grad_approx;
@@ -1656,6 +3417,7 @@ void DistanceBarrierRBProblem::check_barrier_gradient(
 void DistanceBarrierRBProblem::check_barrier_hessian(
     const Eigen::VectorXd& x,
     const Constraints& constraints,
+    const std::vector<double>& barrier_weights,
     const Eigen::SparseMatrix<double>& hess)
 {
     ///////////////////////////////////////////////////////////////////////
@@ -1679,7 +3441,7 @@ void DistanceBarrierRBProblem::check_barrier_hessian(
         Eigen::VectorXd grad_b;
         Eigen::SparseMatrix<double> hess_b;
         compute_barrier_term(
-            x, constraints, grad_b, hess_b,
+            x, constraints, barrier_weights, grad_b, hess_b,
             /*compute_grad=*/true, /*compute_hess=*/false);
         return grad_b;
     };
@@ -1747,7 +3509,7 @@ void DistanceBarrierRBProblem::check_friction_hessian(
     // Finite difference check
     // Finite differences breaks when the displacements are zero.
     Eigen::MatrixXd V0 = m_assembler.world_vertices(poses_t0);
-    Eigen::MatrixXd V1 = m_assembler.world_vertices(this->dofs_to_poses(x));
+    Eigen::MatrixXd V1 = m_assembler.world_vertices(x);
     if ((V1 - V0).lpNorm<Eigen::Infinity>() == 0) {
         return;
     }
@@ -1,6 +1,13 @@
 #pragma once
 
+#include <array>
+#include <map>
+#include <tuple>
+#include <utility>
+#include <vector>
+
 #include <tbb/concurrent_vector.h>
+#include <tbb/enumerable_thread_specific.h>
 
 #include <ipc/collision_constraint.hpp>
 #include <ipc/friction/friction_constraint.hpp>
@@ -9,9 +16,14 @@
 #include <opt/distance_barrier_constraint.hpp>
 #include <opt/optimization_problem.hpp>
 #include <physics/rigid_body_problem.hpp>
+#include <physics/world_vertices_diff.hpp>
+#include <problems/cuda_hessian_assembler.hpp>
 #include <problems/rigid_body_collision_constraint.hpp>
 #include <solvers/homotopy_solver.hpp>
+#include <utils/block_sparse_skeleton.hpp>
+#include <utils/graph_coloring.hpp>
 #include <utils/multiprecision.hpp>
+#include <utils/parallel_loop_tuner.hpp>
 
 namespace ipc::rigid {
 
@@ -32,6 +44,87 @@ NLOHMANN_JSON_SERIALIZE_ENUM(
       { STABILIZED_NEWMARK, "stabilized_newmark" },
       { DEFAULT_BODY_ENERGY_INTEGRATION_METHOD, "default" } });
 
+/// @brief Sparse accumulation of a potential and its derivatives by one
+/// thread.
+///
+/// Only the body segments and blocks touched by the thread's constraints are
+/// stored, so the memory and merge cost scale with the number of constraints
+/// instead of the number of bodies.
+struct PotentialStorage {
+    /// @brief Remove all entries while keeping the allocated capacity.
+    void clear();
+
+    double potential = 0;
+    /// @brief Gradient segment of each touched body.
+    std::vector<std::pair<long, VectorMax6d>> gradient;
+    /// @brief Hessian blocks (block row, block column, block).
+    std::vector<std::tuple<long, long, MatrixMax6d>> hessian_blocks;
+    /// @brief Local hessians left to assemble in a batch (on the GPU)
+    /// instead of hessian blocks.
+    LocalHessianBatch local_hessians;
+
+    /// @brief Entries of one constraint subrange, recorded in deterministic
+    /// mode so the subranges can be merged in constraint order.
+    struct Segment {
+        size_t begin;
+        double potential;
+        size_t gradient_end, hessian_end;
+    };
+    std::vector<Segment> segments;
+
+    /// @brief Add the potential of the subrange starting at constraint begin
+    /// whose derivatives were just stored (recording its segment if
+    /// deterministic).
+    void add_range(size_t begin, double range_potential, bool deterministic);
+};
+typedef tbb::enumerable_thread_specific<PotentialStorage>
+    ThreadSpecificPotentials;
+
+/// @brief Friction contacts of the last lagging iteration keyed by primitive
+/// pair, so contacts that barely moved can keep their linearization.
+struct LinearizedFrictionContacts {
+    /// @brief Friction contact and the positions of its vertices when it was
+    /// linearized.
+    template <typename FrictionConstraint> struct Contact {
+        FrictionConstraint constraint;
+        Eigen::VectorXd vertices;
+    };
+    template <typename FrictionConstraint>
+    using ContactMap =
+        std::map<std::array<long, 2>, Contact<FrictionConstraint>>;
+
+    void clear();
+
+    ContactMap<VertexVertexFrictionConstraint> vv_contacts;
+    ContactMap<EdgeVertexFrictionConstraint> ev_contacts;
+    ContactMap<EdgeEdgeFrictionConstraint> ee_contacts;
+    ContactMap<FaceVertexFrictionConstraint> fv_contacts;
+
+    /// @brief Parameters of the linearization (changing any of them
+    /// invalidates all contacts).
+    double dhat = -1, barrier_stiffness = -1, coefficient_friction = -1;
+};
+
+/// @brief Forces of the contacts at the accepted solution of a time-step.
+///
+/// Each row is a contact constraint between two bodies, with the forces
+/// acting on the first one (the opposite forces act on the second).
+struct ContactForces {
+    /// @brief Remove all contacts of a dim-dimensional scene.
+    void clear(int dim);
+    size_t size() const { return size_t(normal_forces.size()); }
+
+    /// @brief Internal ids of the two bodies.
+    Eigen::Matrix<int, Eigen::Dynamic, 2> body_ids;
+    /// @brief Vertices of the contact weighted by their force.
+    Eigen::MatrixXd points;
+    /// @brief Unit direction of the normal force.
+    Eigen::MatrixXd normals;
+    Eigen::VectorXd normal_forces;
+    /// @brief Lagged friction force (zero without friction).
+    Eigen::MatrixXd friction_forces;
+};
+
 /// This class is both a simulation and optimization problem.
 class DistanceBarrierRBProblem : public RigidBodyProblem,
                                  public virtual BarrierProblem {
@@ -42,7 +135,20 @@ public:
     bool settings(const nlohmann::json& params) override;
     nlohmann::json settings() const override;
 
-    nlohmann::json state() const override;
+    nlohmann::json
+    state_to_json(const std::vector<double>& buffer) const override;
+
+    nlohmann::json restart_state() const override;
+    void restart_state(const nlohmann::json& s) override;
+
+    /// @brief Spawn a body, dropping the warm start history.
+    void add_body(const RigidBody& rb) override;
+    /// @brief Remove a body, dropping the warm start history.
+    void remove_body(size_t i) override;
+
+    /// @brief Contact forces of the last step (empty unless
+    /// record_contact_forces is set).
+    const ContactForces& contact_forces() const { return m_contact_forces; }
 
     static std::string problem_name() { return "distance_barrier_rb_problem"; }
 
@@ -64,12 +170,23 @@ public:
     /// Use the solver to solve this problem.
     OptimizationResults solve_constraints() override;
 
+    /// @brief Initial guess for the solver this time-step.
+    /// Extrapolates the corrections to x_pred of the previous solutions if
+    /// warm starting is enabled, otherwise returns the starting point.
+    Eigen::VectorXd warm_start_point() const;
+
     ////////////////////////////////////////////////////////////
     // Optimization Problem
 
     /// @returns the number of variables
     int num_vars() const override { return num_vars_; }
 
+    /// @returns The number of DoF of each rigid body.
+    int num_vars_per_block() const override
+    {
+        return PoseD::dim_to_ndof(dim());
+    }
+
     /// @returns A vector of booleans indicating if a DoF is fixed.
     const VectorXb& is_dof_fixed() const override
     {
@@ -86,17 +203,27 @@ public:
     double compute_earliest_toi(
         const Eigen::VectorXd& x_i, const Eigen::VectorXd& x_j) override;
 
+    void prefetch_earliest_toi(
+        const Eigen::VectorXd& x_i, double max_displacement) const override;
+
+    double max_vertex_displacement(
+        const Eigen::VectorXd& x_i,
+        const Eigen::VectorXd& x_j) const override;
+
     bool is_ccd_aligned_with_newton_update() override
     {
         return m_constraint.trajectory_type != TrajectoryType::LINEAR;
     }
 
-    /// Get the world coordinates of the vertices
-    Eigen::MatrixXd world_vertices(const Eigen::VectorXd& x) const override
+    bool is_deterministic() const override
     {
-        return m_assembler.world_vertices(this->dofs_to_poses(x));
+        return m_constraint.deterministic;
     }
 
+    /// Get the world coordinates of the vertices (reusing the thread's
+    /// cached kinematics if they are of x)
+    Eigen::MatrixXd world_vertices(const Eigen::VectorXd& x) const override;
+
     /// Get the length of the diagonal of the worlds bounding box
     double world_bbox_diagonal() const override
     {
@@ -116,6 +243,15 @@ public:
     /// Get the time-step
     double timestep() const override { return RigidBodyProblem::timestep(); }
 
+    bool is_hessian_lower_triangular() const override
+    {
+#ifdef RIGID_IPC_WITH_DERIVATIVE_CHECK
+        return false; // The checked terms are summed whole
+#else
+        return lower_triangular_hessian;
+#endif
+    }
+
     ////////////////////////////////////////////////////////////
     // Barrier Problem
 
@@ -127,6 +263,21 @@ public:
         bool compute_grad = true,
         bool compute_hess = true) override;
 
+    /// Compute f(x) with the hessian gathered straight from the hessian
+    /// skeleton into the free DoF.
+    bool compute_free_objective(
+        const Eigen::VectorXd& x,
+        const Eigen::VectorXi& free_dof,
+        const std::vector<int>& full_to_free_dof,
+        double& fx,
+        Eigen::VectorXd& grad,
+        Eigen::SparseMatrix<double>& hess_free) override;
+
+    /// Compute the values of f(x) for a batch of x concurrently.
+    void compute_objectives(
+        const std::vector<Eigen::VectorXd>& xs,
+        std::vector<double>& fxs) override;
+
     /// Compute E(x) in f(x) = E(x) + κ ∑_{k ∈ C} b(d(x_k))
     double compute_energy_term(
         const Eigen::VectorXd& x,
@@ -173,6 +324,12 @@ public:
     using BarrierProblem::compute_barrier_term;
     using BarrierProblem::compute_energy_term;
 
+    /// Number of active barriers at x (from the cached constraint set)
+    int num_active_barriers(const Eigen::VectorXd& x) override
+    {
+        return cached_constraint_set(x).num_constraints();
+    }
+
     /// Compute the minimum distance among geometry
     double compute_min_distance() const override;
     double compute_min_distance(const Eigen::VectorXd& x) const override;
@@ -190,6 +347,12 @@ public:
     void barrier_activation_distance(double dhat) override
     {
         m_constraint.barrier_activation_distance(dhat);
+        // The cached active constraints depend on d̂
+        clear_cached_constraint_sets();
+    }
+    double min_barrier_activation_distance() const override
+    {
+        return m_constraint.min_pair_activation_distance(m_assembler);
     }
 
     double barrier_stiffness() const override { return m_barrier_stiffness; }
@@ -212,9 +375,61 @@ public:
 
     /// Initialize the augmented Lagrangian variables.
     void init_augmented_lagrangian();
+    /// @brief Move the kinematic bodies to their targets in the starting
+    /// point and remove their DoF from the solve if nothing blocks them.
+    /// @returns True if the kinematic bodies were prescribed.
+    bool prescribe_kinematic_targets();
     /// Update the target poses of kinematic bodies
     void step_kinematic_bodies();
 
+    ////////////////////////////////////////////////////////////
+    // Sleeping bodies
+
+    /// @brief Poses at the end of the next step from the current velocities
+    /// (or scripted poses) used to wake bodies before they are hit.
+    PosesD predicted_poses() const;
+
+    /// @brief Pairs of bodies with an active constraint at x.
+    std::vector<std::pair<int, int>>
+    contact_body_pairs(const Eigen::VectorXd& x) const;
+
+    ////////////////////////////////////////////////////////////
+    // Multi-rate steps
+
+    /// @brief Are the fast bodies substepped (see multirate_step())?
+    bool is_multirate_enabled() const
+    {
+        return multirate_displacement_threshold > 0;
+    }
+
+    /// @brief Dynamic bodies that would travel further than the threshold
+    /// this step and the number of substeps they need.
+    std::vector<size_t> fast_bodies(int& num_substeps) const;
+
+    /// @brief Update the constraints, solve, and take a step of the current
+    /// time-step length for the bodies that are not fixed.
+    void solve_step(
+        bool& had_collisions, bool& has_intersections, bool solve_collisions);
+
+    /// @brief Substep the fast bodies against the other bodies frozen at
+    /// the start of the step, then step the other bodies against the fast
+    /// bodies frozen at the end of the step.
+    void multirate_step(
+        const std::vector<size_t>& fast_ids,
+        int num_substeps,
+        bool& had_collisions,
+        bool& has_intersections,
+        bool solve_collisions);
+
+    /// @brief Freeze (or thaw) the non-static bodies selected by the mask.
+    void freeze_bodies(const std::vector<bool>& is_selected);
+    void thaw_bodies();
+
+    /// @brief Freeze the representatives of the contact manifolds at x for
+    /// the Newton iteration (see
+    /// DistanceBarrierConstraint::freeze_contact_manifolds()).
+    bool begin_iteration(const Eigen::VectorXd& x) override;
+
     /// Update the augmented Lagrangian for kinematic bodies.
     void update_augmented_lagrangian(const Eigen::VectorXd& x) override;
 
@@ -238,59 +453,185 @@ public:
         bool compute_hess);
 
 protected:
+    /// @brief Write the bodies followed by the minimum distance.
+    void write_state(
+        std::vector<double>& buffer, bool is_filtered) const override;
+
+    /// Update the stored poses and the initial value for the solver.
+    virtual void update_dof() override;
+
+    /// @brief Re-sort the bodies, keeping the warm start history of each.
+    virtual bool reorder_bodies() override;
+
     /// Update problem using current status of bodies.
     virtual void update_constraints() override;
 
     /// Update problem using current status of bodies.
+    /// @param barrier_weights  Weights of the collision constraints (empty
+    ///                         for unit weights) scaling their normal forces.
+    /// @param V0               World vertices the constraints were built at.
     void update_friction_constraints(
-        const Constraints& collision_constraints, const PosesD& poses);
+        const Constraints& collision_constraints,
+        const std::vector<double>& barrier_weights,
+        const Eigen::MatrixXd& V0);
+
+    /// @brief Weights of the normal forces linearized with the global d̂: the
+    /// barrier weights times the ratio of the barrier gradients with the d̂
+    /// of each body pair and the global one (empty for unit weights).
+    std::vector<double> normal_force_weights(
+        const Constraints& collision_constraints,
+        const std::vector<double>& barrier_weights,
+        const Eigen::MatrixXd& V0) const;
+
+    /// @brief Drop the friction contacts with negligible normal forces (see
+    /// friction_normal_force_threshold).
+    void drop_negligible_friction_contacts();
+
+    /// @brief Bound on the friction energy of the dropped contacts at the
+    /// world vertices V1.
+    double dropped_friction_energy_bound(const Eigen::MatrixXd& V1) const;
+
+    /// @brief Record the contact forces from the barrier and friction
+    /// gradients of the constraints at the world vertices V1.
+    void update_contact_forces(
+        const Constraints& collision_constraints,
+        const std::vector<double>& barrier_weights,
+        const Eigen::MatrixXd& V1);
+
+    /// @brief Objective with its gradient and hessian written in place into
+    /// the persistent hessian skeleton.
+    double compute_objective_in_place(
+        const Eigen::VectorXd& x,
+        Eigen::VectorXd& grad,
+        Eigen::SparseMatrix<double>& hess);
+
+    /// @brief Objective with its gradient, leaving its hessian in the
+    /// persistent hessian skeleton.
+    double assemble_objective_in_place(
+        const Eigen::VectorXd& x, Eigen::VectorXd& grad);
 
-    template <typename T>
-    T compute_body_energy(
+    /// @brief E(x) adding its derivatives times scale to grad and the
+    /// diagonal blocks of hess (each skipped if nullptr).
+    /// @returns The (unscaled) energy.
+    double accumulate_energy_term(
+        const Eigen::VectorXd& x,
+        double scale,
+        Eigen::VectorXd* grad,
+        BlockSparseSkeleton* hess);
+
+    /// @brief Inertial energy of a single body with its closed-form
+    /// gradient and Hessian (each skipped if nullptr; the Hessian needs the
+    /// gradient).
+    double compute_body_energy(
         const RigidBody& body,
-        const Pose<T>& pose,
-        const VectorMax6d& grad_barrier_t0);
+        const PoseD& pose,
+        VectorMax6d* grad = nullptr,
+        MatrixMax6d* hess = nullptr);
+
+    /// @brief Barrier potential of a single constraint, adding its
+    /// derivatives to the storage.
+    /// @param dhat Global d̂ (replaced by the d̂ of the constraint's body pair
+    ///             if DistanceBarrierConstraint::per_body_activation_distance).
+    template <int DIM, typename ContactConstraint>
+    double compute_barrier_potential(
+        const Eigen::MatrixXd& V,
+        const WorldVerticesDiff& V_diff,
+        const ContactConstraint& constraint,
+        const ConstraintIndices& indices,
+        double weight,
+        double dhat,
+        PotentialStorage& storage,
+        bool compute_grad,
+        bool compute_hess);
 
-    template <typename RigidBodyConstraint, typename FrictionConstraint>
+    template <int DIM, typename FrictionConstraint>
     double compute_friction_potential(
         const Eigen::MatrixXd& U,
-        const Eigen::MatrixXd& jac_V,
-        const Eigen::MatrixXd& hess_V,
+        const WorldVerticesDiff& V_diff,
         const FrictionConstraint& constraint,
-        Eigen::VectorXd& grad,
-        std::vector<Eigen::Triplet<double>>& hess_triplets,
+        const ConstraintIndices& indices,
+        PotentialStorage& storage,
+        bool compute_grad,
+        bool compute_hess);
+
+    /// @brief Barrier potential of the ci-th constraint of a set.
+    template <int DIM>
+    double compute_indexed_barrier_potential(
+        const Eigen::MatrixXd& V,
+        const WorldVerticesDiff& V_diff,
+        const Constraints& constraints,
+        size_t ci,
+        const ConstraintIndices& indices,
+        double weight,
+        double dhat,
+        PotentialStorage& storage,
+        bool compute_grad,
+        bool compute_hess);
+
+    /// @brief Friction potential of the ci-th friction constraint of a set.
+    template <int DIM>
+    double compute_indexed_friction_potential(
+        const Eigen::MatrixXd& U,
+        const WorldVerticesDiff& V_diff,
+        const FrictionConstraints& constraints,
+        size_t ci,
+        const ConstraintIndices& indices,
+        PotentialStorage& storage,
+        bool compute_grad,
+        bool compute_hess);
+
+    /// @brief Barrier potentials of the constraints (scaled by their weights
+    /// unless empty) and their derivatives in the (cleared) per-thread
+    /// storage.
+    void compute_barrier_potentials(
+        const Eigen::VectorXd& x,
+        const Constraints& constraints,
+        const std::vector<double>& barrier_weights,
+        ThreadSpecificPotentials& thread_storage,
+        bool compute_grad,
+        bool compute_hess);
+
+    /// @brief Friction potentials of the friction constraints and their
+    /// derivatives in the (cleared) per-thread storage.
+    void compute_friction_potentials(
+        const Eigen::VectorXd& x,
+        ThreadSpecificPotentials& thread_storage,
         bool compute_grad,
         bool compute_hess);
 
     /// Computes the barrier term value, gradient, and hessian from
-    /// distance constraints.
+    /// distance constraints (weighted unless barrier_weights is empty).
     double compute_barrier_term(
         const Eigen::VectorXd& x,
         const Constraints& distance_constraints,
+        const std::vector<double>& barrier_weights,
         Eigen::VectorXd& grad,
         Eigen::SparseMatrix<double>& hess,
         bool compute_grad,
         bool compute_hess);
 
     virtual double compute_barrier_term(
-        const Eigen::VectorXd& x, const Constraints& distance_constraints) final
+        const Eigen::VectorXd& x,
+        const Constraints& distance_constraints,
+        const std::vector<double>& barrier_weights) final
     {
         Eigen::VectorXd grad;
         Eigen::SparseMatrix<double> hess;
         return compute_barrier_term(
-            x, distance_constraints, grad, hess, /*compute_grad=*/false,
-            /*compute_hess=*/false);
+            x, distance_constraints, barrier_weights, grad, hess,
+            /*compute_grad=*/false, /*compute_hess=*/false);
     }
 
     virtual double compute_barrier_term(
         const Eigen::VectorXd& x,
         const Constraints& distance_constraints,
+        const std::vector<double>& barrier_weights,
         Eigen::VectorXd& grad) final
     {
         Eigen::SparseMatrix<double> hess;
         return compute_barrier_term(
-            x, distance_constraints, grad, hess, /*compute_grad=*/true,
-            /*compute_hess=*/false);
+            x, distance_constraints, barrier_weights, grad, hess,
+            /*compute_grad=*/true, /*compute_hess=*/false);
     }
 
 #ifdef RIGID_IPC_WITH_DERIVATIVE_CHECK
@@ -307,10 +648,12 @@ protected:
     void check_barrier_gradient(
         const Eigen::VectorXd& x,
         const Constraints& constraints,
+        const std::vector<double>& barrier_weights,
         const Eigen::VectorXd& grad);
     void check_barrier_hessian(
         const Eigen::VectorXd& x,
         const Constraints& constraints,
+        const std::vector<double>& barrier_weights,
         const Eigen::SparseMatrix<double>& hess);
 
     void check_friction_gradient(
@@ -326,6 +669,129 @@ protected:
     bool is_checking_derivative = false;
 #endif
 
+    /// @brief Kinematics of the bodies at a given x shared by all terms of
+    /// the objective.
+    struct KinematicsCache {
+        Eigen::VectorXd x;
+        PosesD poses;
+        /// @brief World vertices and their derivatives w.r.t. the body DoF.
+        Eigen::MatrixXd V;
+        WorldVerticesDiff V_diff;
+        bool has_V = false, has_jac_V = false, has_hess_V = false;
+        /// @brief Active constraints of the barrier term and their minimum
+        /// distance (computed on demand).
+        Constraints constraints;
+        /// @brief Weights of the constraints' barriers (empty if all one).
+        std::vector<double> barrier_weights;
+        /// @brief Vertices and bodies of the constraints.
+        std::vector<ConstraintIndices> constraint_indices;
+        double min_distance;
+        bool has_constraints = false, has_min_distance = false;
+    };
+
+    /// @brief Get the poses of x, computing them only if x changed.
+    const PosesD& cached_poses(const Eigen::VectorXd& x) const;
+
+    /// @brief Get the world vertices of x and their derivatives, computing
+    /// only what is missing from the cache.
+    const KinematicsCache& cached_world_vertices_diff(
+        const Eigen::VectorXd& x, bool compute_jac, bool compute_hess) const;
+
+    /// @brief Get the active constraints at x, building them only if x
+    /// changed and no other thread's cache has them.
+    const Constraints& cached_constraint_set(const Eigen::VectorXd& x) const;
+
+    /// @brief Copy the constraints and minimum distance of the cache's x
+    /// from the cache of another thread (e.g., the accepted point of a
+    /// concurrent line search), so they are not rebuilt.
+    /// @returns False if no other cache has them or caches are in use.
+    bool adopt_constraint_set(KinematicsCache& cache) const;
+
+    /// @brief World vertices at the start of the time-step.
+    const Eigen::MatrixXd& vertices_t0() const;
+
+    /// @brief Drop all cached kinematics (e.g., when the bodies change).
+    void clear_kinematics_cache() const;
+    /// @brief Drop the cached constraint sets (e.g., when d̂ changes).
+    void clear_cached_constraint_sets() const;
+
+    /// @brief Report the bytes of the cached kinematics and constraints to
+    /// MemoryUsage (not thread safe).
+    void record_memory_usage() const;
+
+    /// @brief One cache per thread so objectives can be evaluated
+    /// concurrently (see compute_objectives()).
+    mutable tbb::enumerable_thread_specific<KinematicsCache>
+        m_kinematics_caches;
+    /// @brief Whether other threads may be using their caches.
+    bool m_is_evaluating_objectives = false;
+    mutable Eigen::MatrixXd m_vertices_t0;
+
+    /// @brief Get the per-thread storage of a potential evaluation with all
+    /// entries cleared.
+    ///
+    /// Derivative evaluations reuse m_potential_storage, so its capacity
+    /// persists across Newton iterations. Value-only evaluations can run
+    /// concurrently (see compute_objectives()), so they use the given
+    /// storage instead.
+    ThreadSpecificPotentials& potential_storage(
+        ThreadSpecificPotentials& value_storage,
+        bool compute_grad,
+        bool compute_hess) const;
+
+    mutable ThreadSpecificPotentials m_potential_storage;
+    /// @brief Friction derivatives of assemble_objective_in_place(), kept
+    /// next to the barrier ones until the hessian pattern is known.
+    ThreadSpecificPotentials m_friction_potential_storage;
+
+    /// @brief Tuners of the barrier and friction loops by derivative order,
+    /// as the derivatives cost far more per constraint than the values.
+    std::array<ParallelLoopTuner, 3> m_barrier_loops, m_friction_loops;
+    static int derivative_order(bool compute_grad, bool compute_hess)
+    {
+        return compute_hess ? 2 : int(compute_grad);
+    }
+
+    /// @brief Hessian of the objective whose pattern persists across Newton
+    /// iterations (see assemble_objective_in_place()).
+    BlockSparseSkeleton m_hessian_skeleton;
+    std::vector<std::array<long, 2>> m_hessian_block_ids;
+
+    /// @brief Contact and friction constraints of assemble_objective_in_place()
+    /// grouped by color (see colored_hessian_assembly).
+    struct ColoredContacts {
+        /// @brief Indices of the contact constraints then of the friction
+        /// constraints.
+        std::vector<ConstraintIndices> indices;
+        size_t num_contacts = 0;
+        std::vector<std::array<long, 2>> body_pairs;
+        NodePairColoring coloring;
+        /// @brief Scaled potential of each constraint.
+        std::vector<double> potentials;
+    };
+    ColoredContacts m_colored_contacts;
+    /// @brief Color the constraints by body pair and append the hessian
+    /// blocks they touch to m_hessian_block_ids.
+    void color_contacts(const Constraints& constraints);
+    /// @brief Add the scaled contact and friction derivatives of the colored
+    /// constraints to the gradient and m_hessian_skeleton.
+    /// @returns The sum of the scaled potentials.
+    double scatter_colored_contacts(
+        const Eigen::VectorXd& x,
+        const Constraints& constraints,
+        const std::vector<double>& barrier_weights,
+        Eigen::VectorXd& grad);
+
+    /// @brief Are the contact hessians being stored as local hessians?
+    bool m_is_deferring_local_hessians = false;
+    /// @brief Add the scaled local hessians of the potentials to
+    /// m_hessian_skeleton (on the GPU if possible).
+    void assemble_local_hessians(
+        const ThreadSpecificPotentials& potentials, double scale);
+#ifdef RIGID_IPC_WITH_CUDA
+    CudaHessianAssembler m_cuda_hessian_assembler;
+#endif
+
     /// @brief Constraint helper for active set and collision detection.
     DistanceBarrierConstraint m_constraint;
 
@@ -352,14 +818,73 @@ protected:
     double static_friction_speed_bound;
     int friction_iterations;
     FrictionConstraints friction_constraints;
+    /// @brief Vertices and bodies of the friction constraints.
+    std::vector<ConstraintIndices> friction_constraint_indices;
+    /// @brief Keep the linearization of a friction contact while none of its
+    /// vertices moved more than this fraction of d̂ (0 relinearizes all).
+    double friction_relinearization_tolerance;
+    LinearizedFrictionContacts linearized_friction;
+    /// @brief Drop the friction contacts whose lagged normal force is below
+    /// this fraction of the largest one (0 keeps all).
+    double friction_normal_force_threshold;
+    /// @brief Total lagged normal force of the dropped friction contacts.
+    double dropped_friction_normal_force;
+
+    /// @brief Record the contact forces at the solution of every step.
+    bool record_contact_forces;
+    ContactForces m_contact_forces;
 
     // Augmented Lagrangian
+    /// @brief Kinematic body enforced by the augmented Lagrangian with its
+    /// constant mass factors.
+    struct KinematicTarget {
+        long body_id;
+        double mass, sqrt_mass;
+        /// @brief Moment of inertia and its square root (2D only).
+        double moment_of_inertia, sqrt_moment_of_inertia;
+        /// @brief J and √J of the moment of inertia (3D only).
+        DiagonalMatrix3d J, Jsqrt;
+    };
+    /// @brief Kinematic bodies in body order, so target k owns the k-th
+    /// multipliers (rebuilt every time-step).
+    std::vector<KinematicTarget> kinematic_targets;
     double linear_augmented_lagrangian_penalty;
     double angular_augmented_lagrangian_penalty;
     Eigen::VectorXd linear_augmented_lagrangian_multiplier;
     Eigen::MatrixXd angular_augmented_lagrangian_multiplier;
     Eigen::VectorXd x_pred; ///< Predicted DoF using unconstrained timestep
     VectorXb is_dof_satisfied;
+    /// @brief Prescribe the kinematic bodies whose sweep to their targets is
+    /// collision free instead of enforcing their targets with the AL.
+    bool prescribe_kinematic_bodies;
+    /// @brief x0 with the prescribed kinematic bodies at their targets.
+    Eigen::VectorXd x_start;
+
+    // Warm start
+    /// @brief Number of previous solutions to extrapolate from (0 disables).
+    int warm_start_order;
+    /// @brief Solution minus x_pred of the last and second to last steps.
+    Eigen::VectorXd prev_correction, prev_prev_correction;
+
+    /// @brief Only project the local contact hessians that are not already
+    /// positive semi-definite (checked with an LDLᵀ factorization).
+    bool lazy_psd_projection;
+    /// @brief Assemble only the lower triangle of the objective's hessian.
+    bool lower_triangular_hessian;
+    /// @brief Compute the chain rule and PSD projection of the contact
+    /// hessians on the GPU (requires RIGID_IPC_WITH_CUDA).
+    bool gpu_hessian_assembly;
+    /// @brief Scatter the contact derivatives straight into the hessian, in
+    /// parallel over groups of constraints with disjoint bodies, instead of
+    /// storing and merging them per thread (takes precedence over
+    /// gpu_hessian_assembly).
+    bool colored_hessian_assembly;
+
+    /// @brief Substep the bodies that would travel further than this during
+    /// a step (non-positive values disable multi-rate steps).
+    double multirate_displacement_threshold;
+    /// @brief Most substeps of a multi-rate step.
+    int multirate_max_substeps;
 
 private:
     /// Method for integrating the body energy.
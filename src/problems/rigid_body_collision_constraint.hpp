@@ -1,6 +1,10 @@
 #pragma once
 
+#include <algorithm>
 #include <array>
+#include <cassert>
+#include <cstdint>
+#include <vector>
 
 #include <ipc/collision_constraint.hpp>
 #include <ipc/friction/friction_constraint.hpp>
@@ -48,7 +52,11 @@ struct RigidBodyVertexVertexConstraint {
         return { { vertex0_body_id, vertex1_body_id } };
     }
 
-    static std::vector<uint8_t> vertex_local_body_ids() { return { { 0, 1 } }; }
+    static const std::vector<uint8_t>& vertex_local_body_ids()
+    {
+        static const std::vector<uint8_t> ids = { { 0, 1 } };
+        return ids;
+    }
 };
 
 struct RigidBodyEdgeVertexConstraint {
@@ -91,9 +99,10 @@ struct RigidBodyEdgeVertexConstraint {
         return { { vertex_body_id, edge_body_id } };
     }
 
-    static std::vector<uint8_t> vertex_local_body_ids()
+    static const std::vector<uint8_t>& vertex_local_body_ids()
     {
-        return { { 0, 1, 1 } };
+        static const std::vector<uint8_t> ids = { { 0, 1, 1 } };
+        return ids;
     }
 };
 
@@ -137,9 +146,10 @@ struct RigidBodyEdgeEdgeConstraint {
         return { { edge0_body_id, edge1_body_id } };
     }
 
-    static std::vector<uint8_t> vertex_local_body_ids()
+    static const std::vector<uint8_t>& vertex_local_body_ids()
     {
-        return { { 0, 0, 1, 1 } };
+        static const std::vector<uint8_t> ids = { { 0, 0, 1, 1 } };
+        return ids;
     }
 };
 
@@ -177,14 +187,15 @@ struct RigidBodyFaceVertexConstraint {
         return { { vertex_body_id, face_body_id } };
     }
 
-    static std::vector<uint8_t> vertex_local_body_ids()
+    static const std::vector<uint8_t>& vertex_local_body_ids()
     {
-        return { { 0, 1, 1, 1 } };
+        static const std::vector<uint8_t> ids = { { 0, 1, 1, 1 } };
+        return ids;
     }
 };
 
 template <typename Constraints>
-std::vector<uint8_t>
+const std::vector<uint8_t>&
 vertex_local_body_ids(const Constraints& constraints, size_t ci)
 {
     if (ci < constraints.vv_constraints.size()) {
@@ -239,4 +250,116 @@ std::array<long, 2> body_ids(
     throw "Invalid constraint index!";
 }
 
+/// @brief Vertices and bodies of a constraint, gathered once per constraint
+/// set so the assembly loops neither allocate nor look up vertex bodies.
+struct ConstraintIndices {
+    /// @brief Global ids of the constraint's vertices (num_vertices used).
+    std::array<long, 4> vertex_ids;
+    /// @brief Which of the two bodies (0 or 1) each vertex belongs to.
+    std::array<uint8_t, 4> local_body_ids;
+    std::array<long, 2> body_ids;
+    uint8_t num_vertices;
+};
+
+/// @brief Number of vertices of a contact or friction constraint type.
+template <typename Constraint> struct ConstraintNumVertices;
+template <> struct ConstraintNumVertices<VertexVertexConstraint> {
+    static constexpr int value = 2;
+};
+template <> struct ConstraintNumVertices<EdgeVertexConstraint> {
+    static constexpr int value = 3;
+};
+template <> struct ConstraintNumVertices<EdgeEdgeConstraint> {
+    static constexpr int value = 4;
+};
+template <> struct ConstraintNumVertices<FaceVertexConstraint> {
+    static constexpr int value = 4;
+};
+template <> struct ConstraintNumVertices<VertexVertexFrictionConstraint> {
+    static constexpr int value = 2;
+};
+template <> struct ConstraintNumVertices<EdgeVertexFrictionConstraint> {
+    static constexpr int value = 3;
+};
+template <> struct ConstraintNumVertices<EdgeEdgeFrictionConstraint> {
+    static constexpr int value = 4;
+};
+template <> struct ConstraintNumVertices<FaceVertexFrictionConstraint> {
+    static constexpr int value = 4;
+};
+
+template <typename RigidBodyConstraint, typename Constraint>
+ConstraintIndices constraint_indices(
+    const RigidBodyAssembler& bodies, const Constraint& constraint)
+{
+    ConstraintIndices indices;
+    const std::vector<long> vertex_ids =
+        constraint.vertex_indices(bodies.m_edges, bodies.m_faces);
+    const std::vector<uint8_t>& local_body_ids =
+        RigidBodyConstraint::vertex_local_body_ids();
+    assert(vertex_ids.size() <= indices.vertex_ids.size());
+    assert(vertex_ids.size() == local_body_ids.size());
+    indices.vertex_ids.fill(-1);
+    indices.local_body_ids.fill(0);
+    std::copy(vertex_ids.begin(), vertex_ids.end(), indices.vertex_ids.begin());
+    std::copy(
+        local_body_ids.begin(), local_body_ids.end(),
+        indices.local_body_ids.begin());
+    indices.body_ids = RigidBodyConstraint(bodies, constraint).body_ids();
+    indices.num_vertices = uint8_t(vertex_ids.size());
+    return indices;
+}
+
+/// @brief Indices of every constraint in the vv, ev, ee, fv order.
+template <typename Constraints>
+void build_constraint_indices(
+    const RigidBodyAssembler& bodies,
+    const Constraints& constraints,
+    std::vector<ConstraintIndices>& indices)
+{
+    indices.clear();
+    indices.reserve(constraints.size());
+    for (const auto& c : constraints.vv_constraints) {
+        indices.push_back(
+            constraint_indices<RigidBodyVertexVertexConstraint>(bodies, c));
+    }
+    for (const auto& c : constraints.ev_constraints) {
+        indices.push_back(
+            constraint_indices<RigidBodyEdgeVertexConstraint>(bodies, c));
+    }
+    for (const auto& c : constraints.ee_constraints) {
+        indices.push_back(
+            constraint_indices<RigidBodyEdgeEdgeConstraint>(bodies, c));
+    }
+    for (const auto& c : constraints.fv_constraints) {
+        indices.push_back(
+            constraint_indices<RigidBodyFaceVertexConstraint>(bodies, c));
+    }
+}
+
+/// @brief Call func(typed_constraints, offset, begin, end) with the part of
+/// the range [begin, end) of constraints (in the vv, ev, ee, fv order) in
+/// each type, where offset is the index of the type's first constraint.
+template <typename Constraints, typename Func>
+void for_each_typed_range(
+    const Constraints& constraints, size_t begin, size_t end, const Func& func)
+{
+    size_t offset = 0;
+    const auto visit = [&](const auto& typed_constraints) {
+        const size_t typed_begin = std::max(begin, offset);
+        const size_t typed_end =
+            std::min(end, offset + typed_constraints.size());
+        if (typed_begin < typed_end) {
+            func(
+                typed_constraints, offset, typed_begin - offset,
+                typed_end - offset);
+        }
+        offset += typed_constraints.size();
+    };
+    visit(constraints.vv_constraints);
+    visit(constraints.ev_constraints);
+    visit(constraints.ee_constraints);
+    visit(constraints.fv_constraints);
+}
+
 } // namespace ipc::rigid
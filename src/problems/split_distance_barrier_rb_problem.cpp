@@ -1,5 +1,6 @@
 #include "split_distance_barrier_rb_problem.hpp"
 
+#include <tbb/parallel_for.h>
 #include <tbb/parallel_sort.h>
 
 #include <finitediff.hpp>
@@ -40,6 +41,8 @@ nlohmann::json SplitDistanceBarrierRBProblem::settings() const
 void SplitDistanceBarrierRBProblem::simulation_step(
     bool& had_collision, bool& _has_intersections, bool solve_collision)
 {
+    update_body_order();
+
     // Take an unconstrained time-step
     m_time_stepper->step(m_assembler, gravity, timestep());
 
@@ -65,7 +68,7 @@ void SplitDistanceBarrierRBProblem::simulation_step(
         OptimizationResults result = solve_constraints();
         _has_intersections = take_step(result.x);
     } else {
-        _has_intersections = detect_intersections(this->poses_t1);
+        _has_intersections = detect_step_intersections(this->poses_t1);
     }
 }
 
@@ -82,9 +85,8 @@ void SplitDistanceBarrierRBProblem::update_constraints()
     // Compute the collisions
     original_impacts.clear();
 
-    // TODO: original_impacts is only used in the 2D restitution code
-    // if this changes remove this if
-    if (dim() == 2) {
+    // original_impacts is only used by the restitution
+    if (coefficient_restitution >= 0) {
         constraint().construct_collision_set(
             m_assembler, poses_t0, poses_t1, original_impacts);
 
@@ -121,208 +123,308 @@ bool SplitDistanceBarrierRBProblem::take_step(const Eigen::VectorXd& dof)
     // Check for intersections instead of collision along the entire
     // step. We only guarentee a piecewise collision-free trajectory.
     // return detect_collisions(poses_t0, poses_q1, CollisionCheck::EXACT);
-    return detect_intersections(poses_q1);
+    return detect_step_intersections(poses_q1);
+}
+
+int schedule_impact_levels(
+    const std::vector<std::pair<size_t, size_t>>& body_pairs,
+    const std::vector<bool>& is_body_movable,
+    std::vector<int>& levels)
+{
+    // Level after the last impact of each body
+    std::vector<int> body_levels(is_body_movable.size(), 0);
+    levels.resize(body_pairs.size());
+    int num_levels = 0;
+    for (size_t i = 0; i < body_pairs.size(); i++) {
+        const auto& [body_A, body_B] = body_pairs[i];
+        // Impacts cannot change immovable bodies, so they can share them
+        int level = std::max(
+            is_body_movable[body_A] ? body_levels[body_A] : 0,
+            is_body_movable[body_B] ? body_levels[body_B] : 0);
+        levels[i] = level;
+        body_levels[body_A] = body_levels[body_B] = level + 1;
+        num_levels = std::max(num_levels, level + 1);
+    }
+    return num_levels;
 }
 
 void SplitDistanceBarrierRBProblem::solve_velocities()
 {
-    if (dim() != 2) {
-        throw NotImplementedError(
-            "RigidBodyProblem::solve_velocities() not implmented for 3D!");
+    // Precompute the normals (since velocities will change them)
+    std::vector<RestitutionContact> contacts;
+    restitution_contacts(contacts);
+
+    // Impacts are resolved in order of time, but impacts on disjoint bodies
+    // are independent.
+    std::vector<std::pair<size_t, size_t>> body_pairs(contacts.size());
+    for (size_t i = 0; i < contacts.size(); i++) {
+        body_pairs[i] = { contacts[i].body_A, contacts[i].body_B };
+    }
+    std::vector<bool> is_body_movable(num_bodies());
+    for (size_t i = 0; i < num_bodies(); i++) {
+        is_body_movable[i] = !m_assembler[i].is_dof_fixed.all();
+    }
+    std::vector<int> levels;
+    int num_levels =
+        schedule_impact_levels(body_pairs, is_body_movable, levels);
+
+    std::vector<std::vector<size_t>> level_contacts(num_levels);
+    for (size_t i = 0; i < contacts.size(); i++) {
+        level_contacts[levels[i]].push_back(i);
+    }
+    for (const std::vector<size_t>& level : level_contacts) {
+        tbb::parallel_for(size_t(0), level.size(), [&](size_t i) {
+            apply_restitution_impulse(contacts[level[i]]);
+        });
+    }
+
+    RIGID_IPC_LOG_DEBUG(
+        "problem={} num_restitution_contacts={:d} num_levels={:d}", name(),
+        contacts.size(), num_levels);
+}
+
+VectorMax3d SplitDistanceBarrierRBProblem::world_vertex_toi(
+    long vertex_id, double toi) const
+{
+    switch (constraint().trajectory_type) {
+    case TrajectoryType::LINEAR: {
+        // Use linearized trajectories
+        VectorMax3d v_t0 = m_assembler.world_vertex(poses_t0, vertex_id);
+        VectorMax3d v_t1 = m_assembler.world_vertex(poses_t1, vertex_id);
+        return (v_t1 - v_t0) * toi + v_t0;
     }
+    case TrajectoryType::PIECEWISE_LINEAR:
+    case TrajectoryType::RIGID:
+    case TrajectoryType::REDON:
+    case TrajectoryType::CONSERVATIVE_ADVANCEMENT:
+    default: {
+        // Use nonlinear trajectory
+        long body_id = m_assembler.vertex_id_to_body_id(vertex_id);
+        PoseD pose_toi =
+            PoseD::interpolate(poses_t0[body_id], poses_t1[body_id], toi);
+        return m_assembler.world_vertex(pose_toi, vertex_id);
+    }
+    }
+}
 
-    // precompute normal directions (since velocities will change i
-    // can't do it after
-    Eigen::MatrixXd normals(original_impacts.ev_impacts.size(), 2);
-
-    for (long i = 0; i < normals.rows(); ++i) {
-        const EdgeVertexImpact& ev_impact =
-            original_impacts.ev_impacts[size_t(i)];
-
-        double toi = ev_impact.time;
-
-        const long edge_id = ev_impact.edge_index;
-        const long a_id = ev_impact.vertex_index;
-        const int b0_id = m_assembler.m_edges.coeff(edge_id, 0);
-        const int b1_id = m_assembler.m_edges.coeff(edge_id, 1);
-
-        const size_t body_B_id =
-            size_t(m_assembler.m_vertex_to_body_map(b0_id));
-        bool is_oriented = m_assembler[body_B_id].is_oriented;
-
-        Eigen::Vector2d n_toi;
-        VectorMax3d e_toi; // edge vector at toi
-        switch (constraint().trajectory_type) {
-        case TrajectoryType::LINEAR: {
-            // Use linearized trajectories
-            VectorMax3d e_v0_t0 = m_assembler.world_vertex(poses_t0, b0_id);
-            VectorMax3d e_v0_t1 = m_assembler.world_vertex(poses_t1, b0_id);
-            VectorMax3d e_v0_toi = (e_v0_t1 - e_v0_t0) * toi + e_v0_t0;
-
-            VectorMax3d e_v1_t0 = m_assembler.world_vertex(poses_t0, b1_id);
-            VectorMax3d e_v1_t1 = m_assembler.world_vertex(poses_t1, b1_id);
-            VectorMax3d e_v1_toi = (e_v1_t1 - e_v1_t0) * toi + e_v1_t0;
-
-            e_toi = e_v1_toi - e_v0_toi;
-        } break;
-
-        case TrajectoryType::PIECEWISE_LINEAR:
-        case TrajectoryType::RIGID:
-        case TrajectoryType::REDON: {
-            // Use nonlinear trajectory
-            long edge_body_id = m_assembler.edge_id_to_body_id(edge_id);
-
-            PoseD pose_toi = PoseD::interpolate(
-                poses_t0[edge_body_id], poses_t1[edge_body_id], toi);
-
-            e_toi = m_assembler.world_vertex(pose_toi, b1_id)
-                - m_assembler.world_vertex(pose_toi, b0_id);
-        } break;
+void SplitDistanceBarrierRBProblem::restitution_contacts(
+    std::vector<RestitutionContact>& contacts) const
+{
+    const std::vector<EdgeVertexImpact>& ev_impacts =
+        original_impacts.ev_impacts;
+    const std::vector<EdgeEdgeImpact>& ee_impacts =
+        original_impacts.ee_impacts;
+    const std::vector<FaceVertexImpact>& fv_impacts =
+        original_impacts.fv_impacts;
+    contacts.resize(ev_impacts.size() + ee_impacts.size() + fv_impacts.size());
+
+    // Body id and body space position of a global vertex
+    const auto body_vertex = [&](long vertex_id, size_t& body_id) {
+        body_id = size_t(m_assembler.m_vertex_to_body_map(vertex_id));
+        return VectorMax3d(m_assembler[body_id].vertices.row(
+            vertex_id - m_assembler.m_body_vertex_id[body_id]));
+    };
+    // Orient the normal from B to A using the start of the step
+    const auto orient_normal = [](VectorMax3d& n, const VectorMax3d& a_t0,
+                                  const VectorMax3d& b_t0) {
+        if ((a_t0 - b_t0).dot(n) <= 0.0) {
+            n *= -1;
         }
+    };
+
+    tbb::parallel_for(size_t(0), ev_impacts.size(), [&](size_t i) {
+        const EdgeVertexImpact& impact = ev_impacts[i];
+        const long a_id = impact.vertex_index;
+        const int b0_id = m_assembler.m_edges.coeff(impact.edge_index, 0);
+        const int b1_id = m_assembler.m_edges.coeff(impact.edge_index, 1);
+
+        RestitutionContact& contact = contacts[i];
+        contact.time = impact.time;
+        contact.r0_A = body_vertex(a_id, contact.body_A);
+        const VectorMax3d r0_B0 = body_vertex(b0_id, contact.body_B);
+        const VectorMax3d r0_B1 = body_vertex(b1_id, contact.body_B);
+        contact.r0_B = r0_B0 + impact.alpha * (r0_B1 - r0_B0);
+
+        // edge vector at toi
+        VectorMax3d e_toi = world_vertex_toi(b1_id, impact.time)
+            - world_vertex_toi(b0_id, impact.time);
+        VectorMax3d n_toi(2);
         n_toi << -e_toi(1), e_toi(0); // 90deg ccw rotation
         n_toi.normalize();
 
-        if (is_oriented) {
+        if (m_assembler[contact.body_B].is_oriented) {
             n_toi = -n_toi;
         } else {
             // check normal points towards A
-            Eigen::Vector2d va = m_assembler.world_vertex(poses_t0, a_id);
-            Eigen::Vector2d vb = m_assembler.world_vertex(poses_t0, b0_id);
-            if ((va - vb).transpose() * n_toi <= 0.0) {
-                n_toi *= -1;
-            }
+            orient_normal(
+                n_toi, m_assembler.world_vertex(poses_t0, a_id),
+                m_assembler.world_vertex(poses_t0, b0_id));
         }
-        normals.row(i) = n_toi.transpose();
-    }
-
-#ifndef NDEBUG
-    double prev_toi = -1;
-#endif
-    for (long i = 0; i < normals.rows(); ++i) {
-        const EdgeVertexImpact& ev_impact =
-            original_impacts.ev_impacts[size_t(i)];
-
-        double toi = ev_impact.time;
-#ifndef NDEBUG
-        assert(prev_toi <= toi);
-        prev_toi = toi;
-#endif
-        double alpha = ev_impact.alpha;
-
-        // global ids of the vertices
-        const long edge_id = ev_impact.edge_index;
-        const long a_id = ev_impact.vertex_index;
-        const int b0_id = m_assembler.m_edges.coeff(edge_id, 0);
-        const int b1_id = m_assembler.m_edges.coeff(edge_id, 1);
-
-        const size_t body_A_id = size_t(m_assembler.m_vertex_to_body_map(a_id));
-        const size_t body_B_id =
-            size_t(m_assembler.m_vertex_to_body_map(b0_id));
-
-        // local (rigid body) ids of the vertices
-        const long r_A_id = a_id - m_assembler.m_body_vertex_id[body_A_id];
-        const long r_B0_id = b0_id - m_assembler.m_body_vertex_id[body_B_id];
-        const long r_B1_id = b1_id - m_assembler.m_body_vertex_id[body_B_id];
-
-        auto& body_A = m_assembler[body_A_id];
-        auto& body_B = m_assembler[body_B_id];
-
-        // The velocities of the center of mass at the time of
-        // collision!!
-        PoseD vel_A_prev =
-            PoseD::interpolate(body_A.velocity_prev, body_A.velocity, toi);
-        PoseD vel_B_prev =
-            PoseD::interpolate(body_B.velocity_prev, body_B.velocity, toi);
-
-        // The masss
-        const double inv_m_A =
-            body_A.is_dof_fixed.head(dim()).any() ? 0.0 : 1.0 / body_A.mass;
-        const double inv_m_B =
-            body_B.is_dof_fixed.head(dim()).any() ? 0.0 : 1.0 / body_B.mass;
-
-        if (dim() != 2) {
-            throw NotImplementedError("Resitution not implemented in 3D yet!");
+        contact.normal = n_toi;
+    });
+
+    tbb::parallel_for(size_t(0), ee_impacts.size(), [&](size_t i) {
+        const EdgeEdgeImpact& impact = ee_impacts[i];
+        const long ea0_id =
+            m_assembler.m_edges.coeff(impact.impacting_edge_index, 0);
+        const long ea1_id =
+            m_assembler.m_edges.coeff(impact.impacting_edge_index, 1);
+        const long eb0_id =
+            m_assembler.m_edges.coeff(impact.impacted_edge_index, 0);
+        const long eb1_id =
+            m_assembler.m_edges.coeff(impact.impacted_edge_index, 1);
+        const double alpha = impact.impacting_alpha;
+        const double beta = impact.impacted_alpha;
+
+        RestitutionContact& contact = contacts[ev_impacts.size() + i];
+        contact.time = impact.time;
+        const VectorMax3d r0_A0 = body_vertex(ea0_id, contact.body_A);
+        const VectorMax3d r0_A1 = body_vertex(ea1_id, contact.body_A);
+        contact.r0_A = r0_A0 + alpha * (r0_A1 - r0_A0);
+        const VectorMax3d r0_B0 = body_vertex(eb0_id, contact.body_B);
+        const VectorMax3d r0_B1 = body_vertex(eb1_id, contact.body_B);
+        contact.r0_B = r0_B0 + beta * (r0_B1 - r0_B0);
+
+        const Eigen::Vector3d ea_toi = world_vertex_toi(ea1_id, impact.time)
+            - world_vertex_toi(ea0_id, impact.time);
+        const Eigen::Vector3d eb_toi = world_vertex_toi(eb1_id, impact.time)
+            - world_vertex_toi(eb0_id, impact.time);
+
+        const auto point_t0 = [&](long v0_id, long v1_id, double t) {
+            VectorMax3d v0 = m_assembler.world_vertex(poses_t0, v0_id);
+            VectorMax3d v1 = m_assembler.world_vertex(poses_t0, v1_id);
+            return VectorMax3d(v0 + t * (v1 - v0));
+        };
+        const VectorMax3d a_t0 = point_t0(ea0_id, ea1_id, alpha);
+        const VectorMax3d b_t0 = point_t0(eb0_id, eb1_id, beta);
+
+        VectorMax3d n_toi = ea_toi.cross(eb_toi);
+        if (n_toi.norm() <= 1e-12 * ea_toi.norm() * eb_toi.norm()) {
+            n_toi = a_t0 - b_t0; // Parallel edges
         }
+        n_toi.normalize();
+        orient_normal(n_toi, a_t0, b_t0);
+        contact.normal = n_toi;
+    });
+
+    tbb::parallel_for(size_t(0), fv_impacts.size(), [&](size_t i) {
+        const FaceVertexImpact& impact = fv_impacts[i];
+        const long a_id = impact.vertex_index;
+        const long f0_id = m_assembler.m_faces.coeff(impact.face_index, 0);
+        const long f1_id = m_assembler.m_faces.coeff(impact.face_index, 1);
+        const long f2_id = m_assembler.m_faces.coeff(impact.face_index, 2);
+
+        RestitutionContact& contact =
+            contacts[ev_impacts.size() + ee_impacts.size() + i];
+        contact.time = impact.time;
+        contact.r0_A = body_vertex(a_id, contact.body_A);
+        const VectorMax3d r0_B0 = body_vertex(f0_id, contact.body_B);
+        const VectorMax3d r0_B1 = body_vertex(f1_id, contact.body_B);
+        const VectorMax3d r0_B2 = body_vertex(f2_id, contact.body_B);
+        contact.r0_B =
+            r0_B0 + impact.u * (r0_B1 - r0_B0) + impact.v * (r0_B2 - r0_B0);
+
+        const Eigen::Vector3d f0_toi = world_vertex_toi(f0_id, impact.time);
+        const Eigen::Vector3d f1_toi = world_vertex_toi(f1_id, impact.time);
+        const Eigen::Vector3d f2_toi = world_vertex_toi(f2_id, impact.time);
+        VectorMax3d n_toi = (f1_toi - f0_toi).cross(f2_toi - f0_toi);
+        n_toi.normalize();
+        orient_normal(
+            n_toi, m_assembler.world_vertex(poses_t0, a_id),
+            m_assembler.world_vertex(poses_t0, f0_id));
+        contact.normal = n_toi;
+    });
+
+    // Merge the impacts of each type in order of time
+    std::stable_sort(
+        contacts.begin(), contacts.end(),
+        [](const RestitutionContact& c0, const RestitutionContact& c1) {
+            return c0.time < c1.time;
+        });
+}
 
-        // The moment of inertia
-        int rot_ndof = PoseD::dim_to_rot_ndof(dim());
-        const Eigen::MatrixXd inv_I_A = body_A.is_dof_fixed.tail(rot_ndof).any()
-            ? Eigen::MatrixXd::Zero(rot_ndof, rot_ndof)
-            : Eigen::MatrixXd(
-                  body_A.moment_of_inertia.cwiseInverse().asDiagonal());
-        const Eigen::MatrixXd inv_I_B = body_B.is_dof_fixed.tail(rot_ndof).any()
-            ? Eigen::MatrixXd::Zero(rot_ndof, rot_ndof)
-            : Eigen::MatrixXd(
-                  body_B.moment_of_inertia.cwiseInverse().asDiagonal());
-
-        // Vectors from the center of mass to the collision point
-        // (90deg rotation counter clockwise)
-        //
-        // (1) first get vertices position wrt rigid bodies
-        const Eigen::Vector2d r0_A = body_A.vertices.row(r_A_id);
-        const Eigen::Vector2d r0_B0 =
-            body_B.vertices.row(r_B0_id); // edge vertex 0
-        const Eigen::Vector2d r0_B1 =
-            body_B.vertices.row(r_B1_id); // edge vertex 1
-        const Eigen::Vector2d r0_B = r0_B0 + alpha * (r0_B1 - r0_B0);
-
-        // (2) and the angular displacement at time of collision
-        const PoseD pose_Atoi =
-            PoseD::interpolate(body_A.pose_prev, body_A.pose, toi);
-        const PoseD pose_Btoi =
-            PoseD::interpolate(body_B.pose_prev, body_B.pose, toi);
-        // (3) then the vectors are given by r = R(\theta_{t})*r_0
-        Eigen::Matrix2d one_hat = Hat(1.0);
-        const Eigen::VectorXd r_Aperp_toi =
-            pose_Atoi.construct_rotation_matrix() * one_hat * r0_A;
-        const Eigen::VectorXd r_Bperp_toi =
-            pose_Btoi.construct_rotation_matrix() * one_hat * r0_B;
-
-        // The collision point velocities BEFORE collision
-        const Eigen::VectorXd v_Aprev =
-            vel_A_prev.position + vel_A_prev.rotation(0) * r_Aperp_toi;
-        const Eigen::VectorXd v_Bprev =
-            vel_B_prev.position + vel_B_prev.rotation(0) * r_Bperp_toi;
-
-        // The relative veolicity magnitud BEFORE collision
-        const Eigen::VectorXd& n_toi = normals.row(i);
-
-        const double vrel_prev_toi = (v_Aprev - v_Bprev).transpose() * n_toi;
-        if (vrel_prev_toi >= 0.0) {
-            continue;
-        }
-        // solve for the impulses
-        const double nr_A_toi = n_toi.transpose() * r_Aperp_toi;
-        const double nr_B_toi = n_toi.transpose() * r_Bperp_toi;
-        const double K =
-            (inv_m_A + inv_m_B //
-             + inv_I_A(0) * nr_A_toi * nr_A_toi
-             + inv_I_B(0) * nr_B_toi * nr_B_toi);
-
-        const double j =
-            -1.0 / K * (1.0 + coefficient_restitution) * vrel_prev_toi;
-
-        // update
-        Eigen::Vector2d V_A_delta = inv_m_A * j * n_toi;
-        Eigen::Vector2d V_B_delta = -inv_m_B * j * n_toi;
-        double w_A_delta = inv_I_A(0) * j * nr_A_toi;
-        double w_B_delta = -inv_I_B(0) * j * nr_B_toi;
-
-        if (!(body_A.is_dof_fixed[0] || body_A.is_dof_fixed[1])) {
-            body_A.velocity.position = vel_A_prev.position + V_A_delta;
-        }
+void SplitDistanceBarrierRBProblem::apply_restitution_impulse(
+    const RestitutionContact& contact)
+{
+    const double toi = contact.time;
+    const VectorMax3d& n_toi = contact.normal;
+    const int rot_ndof = PoseD::dim_to_rot_ndof(dim());
+
+    RigidBody& body_A = m_assembler[contact.body_A];
+    RigidBody& body_B = m_assembler[contact.body_B];
+
+    // The velocities of the center of mass at the time of collision!!
+    PoseD vel_A_prev =
+        PoseD::interpolate(body_A.velocity_prev, body_A.velocity, toi);
+    PoseD vel_B_prev =
+        PoseD::interpolate(body_B.velocity_prev, body_B.velocity, toi);
+
+    const bool is_A_position_fixed = body_A.is_dof_fixed.head(dim()).any();
+    const bool is_B_position_fixed = body_B.is_dof_fixed.head(dim()).any();
+    const bool is_A_rotation_fixed = body_A.is_dof_fixed.tail(rot_ndof).any();
+    const bool is_B_rotation_fixed = body_B.is_dof_fixed.tail(rot_ndof).any();
+
+    // The masss and the moment of inertia
+    const double inv_m_A = is_A_position_fixed ? 0.0 : 1.0 / body_A.mass;
+    const double inv_m_B = is_B_position_fixed ? 0.0 : 1.0 / body_B.mass;
+    const VectorMax3d inv_I_A = is_A_rotation_fixed
+        ? VectorMax3d::Zero(rot_ndof)
+        : VectorMax3d(body_A.moment_of_inertia.cwiseInverse());
+    const VectorMax3d inv_I_B = is_B_rotation_fixed
+        ? VectorMax3d::Zero(rot_ndof)
+        : VectorMax3d(body_B.moment_of_inertia.cwiseInverse());
+
+    // Jacobian of the contact point velocity w.r.t. the angular velocity
+    // (in body space) at the time of collision:
+    //  2D: R(θ) * [0 -1; 1 0] * r₀    3D: R(θ) * (ω × r₀) = -R(θ) * [r₀]ₓ ω
+    const auto rotation_jacobian = [&](const RigidBody& body,
+                                       const VectorMax3d& r0) {
+        const PoseD pose_toi =
+            PoseD::interpolate(body.pose_prev, body.pose, toi);
+        const MatrixMax3d R = pose_toi.construct_rotation_matrix();
+        return MatrixMax3d(
+            dim() == 2 ? MatrixMax3d(R * Hat(1.0) * r0)
+                       : MatrixMax3d(-R * Hat(r0)));
+    };
+    const MatrixMax3d J_A = rotation_jacobian(body_A, contact.r0_A);
+    const MatrixMax3d J_B = rotation_jacobian(body_B, contact.r0_B);
+
+    // The collision point velocities BEFORE collision
+    const VectorMax3d v_Aprev = vel_A_prev.position + J_A * vel_A_prev.rotation;
+    const VectorMax3d v_Bprev = vel_B_prev.position + J_B * vel_B_prev.rotation;
+
+    // The relative veolicity magnitud BEFORE collision
+    const double vrel_prev_toi = (v_Aprev - v_Bprev).dot(n_toi);
+    if (vrel_prev_toi >= 0.0) {
+        return;
+    }
 
-        if (!(body_B.is_dof_fixed[0] || body_B.is_dof_fixed[1])) {
-            body_B.velocity.position = vel_B_prev.position + V_B_delta;
-        }
+    // solve for the impulses
+    const VectorMax3d nr_A_toi = J_A.transpose() * n_toi;
+    const VectorMax3d nr_B_toi = J_B.transpose() * n_toi;
+    const double K = inv_m_A + inv_m_B
+        + nr_A_toi.dot(inv_I_A.cwiseProduct(nr_A_toi))
+        + nr_B_toi.dot(inv_I_B.cwiseProduct(nr_B_toi));
+    if (K <= 0) {
+        return; // Neither body can move
+    }
 
-        if (!body_A.is_dof_fixed[2]) {
-            body_A.velocity.rotation(0) = vel_A_prev.rotation(0) + w_A_delta;
-        }
+    const double j = -1.0 / K * (1.0 + coefficient_restitution) * vrel_prev_toi;
 
-        if (!body_B.is_dof_fixed[2]) {
-            body_B.velocity.rotation(0) = vel_B_prev.rotation(0) + w_B_delta;
-        }
+    // update
+    if (!is_A_position_fixed) {
+        body_A.velocity.position = vel_A_prev.position + inv_m_A * j * n_toi;
+    }
+    if (!is_B_position_fixed) {
+        body_B.velocity.position = vel_B_prev.position - inv_m_B * j * n_toi;
+    }
+    if (!is_A_rotation_fixed) {
+        body_A.velocity.rotation =
+            vel_A_prev.rotation + j * inv_I_A.cwiseProduct(nr_A_toi);
+    }
+    if (!is_B_rotation_fixed) {
+        body_B.velocity.rotation =
+            vel_B_prev.rotation - j * inv_I_B.cwiseProduct(nr_B_toi);
     }
 }
 
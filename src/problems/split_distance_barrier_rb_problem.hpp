@@ -4,6 +4,22 @@
 
 namespace ipc::rigid {
 
+/// @brief Schedule impacts into levels of disjoint impacts.
+///
+/// No two impacts of a level share a movable body, so a level can be
+/// resolved in parallel. Every body sees its impacts in the given order,
+/// so resolving the levels in order matches resolving the impacts in
+/// order.
+///
+/// @param[in]  body_pairs        Bodies of each impact (in order).
+/// @param[in]  is_body_movable   If the impacts can change a body.
+/// @param[out] levels            Level of each impact.
+/// @returns The number of levels.
+int schedule_impact_levels(
+    const std::vector<std::pair<size_t, size_t>>& body_pairs,
+    const std::vector<bool>& is_body_movable,
+    std::vector<int>& levels);
+
 /// @brief A diststance barrier rigid body problem using a split time
 /// stepping method.
 class SplitDistanceBarrierRBProblem : public DistanceBarrierRBProblem {
@@ -70,6 +86,26 @@ protected:
     /// Apply restitution to solve for the current velocities.
     void solve_velocities();
 
+    /// @brief An impact reduced to what its restitution impulse needs.
+    struct RestitutionContact {
+        double time;           ///< @brief Time of impact
+        size_t body_A, body_B; ///< @brief Impacting and impacted bodies
+        /// @brief Contact point in the body space of A and B.
+        VectorMax3d r0_A, r0_B;
+        /// @brief Unit normal at the time of impact pointing towards A.
+        VectorMax3d normal;
+    };
+
+    /// @brief Precompute the contacts of all original impacts in parallel.
+    /// The normals are computed before any velocity changes.
+    void restitution_contacts(std::vector<RestitutionContact>& contacts) const;
+
+    /// @brief Solve for and apply the impulse of a single contact.
+    void apply_restitution_impulse(const RestitutionContact& contact);
+
+    /// @brief World position of a vertex at a time of impact.
+    VectorMax3d world_vertex_toi(long vertex_id, double toi) const;
+
     /// Unconstrained time-stepping method
     std::shared_ptr<TimeStepper> m_time_stepper;
 
@@ -1,6 +1,9 @@
+#include <cstdlib>
+
 #include <ghc/fs_std.hpp> // filesystem
 #include <logger.hpp>
 #include <map>
+#include <perf_counters.hpp>
 #include <profiler.hpp>
 #include <utils/get_rss.hpp>
 
@@ -26,6 +29,7 @@ namespace profiler {
         }
         timer.start();
         beginning_peak_rss = getPeakRSS();
+        beginning_perf_counts = PerfCounters::read();
         is_active = true;
     }
 
@@ -37,6 +41,21 @@ namespace profiler {
             m_num_evaluations++;
             m_max_peak_rss_change = std::max(
                 m_max_peak_rss_change, getPeakRSS() - beginning_peak_rss);
+
+            // Threads that started counting during the evaluation began at 0
+            const std::vector<std::vector<double>> perf_counts =
+                PerfCounters::read();
+            m_thread_perf_counts.resize(perf_counts.size());
+            for (size_t i = 0; i < perf_counts.size(); i++) {
+                std::vector<double>& counts = m_thread_perf_counts[i];
+                counts.resize(perf_counts[i].size(), 0);
+                for (size_t j = 0; j < counts.size(); j++) {
+                    counts[j] += perf_counts[i][j];
+                    if (i < beginning_perf_counts.size()) {
+                        counts[j] -= beginning_perf_counts[i][j];
+                    }
+                }
+            }
             is_active = false;
         }
     }
@@ -58,6 +77,7 @@ namespace profiler {
         m_max_peak_rss_change = 0;
         m_message_header = "";
         m_messages.clear();
+        m_thread_perf_counts.clear();
         is_active = false;
     }
 
@@ -71,6 +91,14 @@ namespace profiler {
         return profiler;
     }
 
+    Profiler::Profiler()
+    {
+#ifdef RIGID_IPC_PROFILE_PERF_COUNTERS
+        const char* raw_events = std::getenv("RIGID_IPC_PERF_RAW_EVENTS");
+        PerfCounters::enable(raw_events != nullptr ? raw_events : "");
+#endif
+    }
+
     void Profiler::clear()
     {
         if (main != nullptr) {
@@ -101,6 +129,9 @@ namespace profiler {
         fs::create_directories(outpath);
 
         write_summary(outpath.string(), fin);
+        if (PerfCounters::is_enabled()) {
+            write_perf_counts(outpath.string(), fin);
+        }
         for (auto& p : points) {
             write_point_details(outpath.string(), *p);
         }
@@ -137,6 +168,59 @@ namespace profiler {
         myfile.close();
     }
 
+    void
+    Profiler::write_perf_counts(const std::string& dout, const std::string& fin)
+    {
+        std::string filename = fmt::format("{}/perf_counters.csv", dout);
+
+        std::ofstream myfile;
+        myfile.open(filename);
+        // Same layout as the summary (the second line is the header)
+        myfile << fin << "\n";
+        myfile << "section,thread,IPC";
+        for (const std::string& name : PerfCounters::event_names()) {
+            myfile << "," << name;
+        }
+        myfile << "\n";
+
+        const size_t num_events = PerfCounters::event_names().size();
+        const auto write_row = [&](const std::string& section,
+                                   const std::string& thread,
+                                   const std::vector<double>& counts) {
+            // Events 0 and 1 are the cycles and instructions
+            myfile << fmt::format(
+                "{},{},{:g}", section, thread,
+                counts[0] > 0 ? counts[1] / counts[0] : 0.0);
+            for (const double count : counts) {
+                myfile << fmt::format(",{:.0f}", count);
+            }
+            myfile << "\n";
+        };
+
+        std::vector<std::shared_ptr<ProfilerPoint>> all_points = { main };
+        all_points.insert(all_points.end(), points.begin(), points.end());
+        for (const auto& p : all_points) {
+            if (p == nullptr) {
+                continue;
+            }
+            std::vector<double> total(num_events, 0);
+            const auto& thread_counts = p->thread_perf_counts();
+            for (size_t i = 0; i < thread_counts.size(); i++) {
+                if (thread_counts[i].size() != num_events
+                    || thread_counts[i][0] <= 0) {
+                    continue; // The thread did not run during the point
+                }
+                write_row(p->name(), std::to_string(i), thread_counts[i]);
+                for (size_t j = 0; j < num_events; j++) {
+                    total[j] += thread_counts[i][j];
+                }
+            }
+            write_row(p->name(), "all", total);
+        }
+
+        myfile.close();
+    }
+
     void Profiler::write_point_details(
         const std::string& dout, const ProfilerPoint& point)
     {
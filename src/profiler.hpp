@@ -33,6 +33,13 @@ namespace profiler {
             return m_max_peak_rss_change;
         }
 
+        /// @brief Hardware counts of every thread (see PerfCounters) summed
+        /// over the evaluations.
+        const std::vector<std::vector<double>>& thread_perf_counts() const
+        {
+            return m_thread_perf_counts;
+        }
+
         void message_header(const std::string& header);
         const std::string& message_header() const { return m_message_header; }
         void message(const std::string& m);
@@ -45,10 +52,12 @@ namespace profiler {
         size_t m_max_peak_rss_change;
         std::string m_message_header;
         std::vector<std::string> m_messages;
+        std::vector<std::vector<double>> m_thread_perf_counts;
 
         igl::Timer timer;
         bool is_active;
         size_t beginning_peak_rss;
+        std::vector<std::vector<double>> beginning_perf_counts;
     };
 
     class Profiler {
@@ -62,10 +71,24 @@ namespace profiler {
 
         void log(const std::string& fin = "");
 
+        /// @brief Point of the whole run (null if not created).
+        const std::shared_ptr<ProfilerPoint>& main_point() const
+        {
+            return main;
+        }
+        const std::vector<std::shared_ptr<ProfilerPoint>>&
+        profile_points() const
+        {
+            return points;
+        }
+
     protected:
         std::string dout = "logs";
-        Profiler() {}
+        Profiler();
         void write_summary(const std::string& dout, const std::string& fin);
+        /// @brief Write the hardware counts of every point and thread.
+        void
+        write_perf_counts(const std::string& dout, const std::string& fin);
         void write_point_details(
             const std::string& dout, const ProfilerPoint& point);
 
@@ -0,0 +1,123 @@
+#include "block_jacobi_pcg.hpp"
+
+#include <cmath>
+
+#include <Eigen/Cholesky>
+
+namespace ipc::rigid {
+
+void BlockJacobiPCG::compute(
+    const Eigen::SparseMatrix<double>& A,
+    const Eigen::VectorXi& block_ids,
+    bool is_lower_triangular)
+{
+    assert(A.rows() == A.cols());
+    assert(block_ids.size() == 0 || block_ids.size() == A.rows());
+    this->A = &A;
+    this->is_lower_triangular = is_lower_triangular;
+
+    // Group consecutive rows with the same block id
+    block_starts.clear();
+    for (int i = 0; i < A.rows(); i++) {
+        if (i == 0 || block_ids.size() == 0
+            || block_ids(i) != block_ids(i - 1)) {
+            block_starts.push_back(i);
+        }
+    }
+    block_starts.push_back(A.rows());
+
+    const int num_blocks = block_starts.size() - 1;
+    inverse_blocks.resize(num_blocks);
+    for (int bi = 0; bi < num_blocks; bi++) {
+        const int start = block_starts[bi];
+        const int size = block_starts[bi + 1] - start;
+        Eigen::MatrixXd block = A.block(start, start, size, size);
+        if (is_lower_triangular) {
+            const Eigen::MatrixXd lower = block;
+            block = lower.selfadjointView<Eigen::Lower>();
+        }
+
+        Eigen::LDLT<Eigen::MatrixXd> ldlt(block);
+        if (ldlt.info() == Eigen::Success && ldlt.isPositive()
+            && (ldlt.vectorD().array() > 0).all()) {
+            inverse_blocks[bi] =
+                ldlt.solve(Eigen::MatrixXd::Identity(size, size));
+        } else {
+            // Fall back to the (absolute) diagonal for indefinite blocks
+            Eigen::ArrayXd d = block.diagonal().array().abs();
+            Eigen::VectorXd d_inv = (d > 0).select(d.inverse(), 1.0);
+            inverse_blocks[bi] = d_inv.asDiagonal();
+        }
+    }
+}
+
+Eigen::VectorXd
+BlockJacobiPCG::apply_preconditioner(const Eigen::VectorXd& r) const
+{
+    Eigen::VectorXd z(r.size());
+    for (int bi = 0; bi < inverse_blocks.size(); bi++) {
+        const int start = block_starts[bi];
+        const int size = block_starts[bi + 1] - start;
+        z.segment(start, size) = inverse_blocks[bi] * r.segment(start, size);
+    }
+    return z;
+}
+
+Eigen::VectorXd BlockJacobiPCG::product(const Eigen::VectorXd& x) const
+{
+    if (is_lower_triangular) {
+        return A->selfadjointView<Eigen::Lower>() * x;
+    }
+    return (*A) * x;
+}
+
+bool BlockJacobiPCG::solve(const Eigen::VectorXd& b, Eigen::VectorXd& x)
+{
+    assert(A != nullptr && A->rows() == b.size());
+    num_iterations = 0;
+    residual = 0;
+
+    if (x.size() != b.size()) {
+        x.setZero(b.size());
+    }
+
+    const double b_norm = b.norm();
+    if (b_norm == 0) {
+        x.setZero();
+        return true;
+    }
+
+    Eigen::VectorXd r = b - product(x);
+    Eigen::VectorXd z = apply_preconditioner(r);
+    Eigen::VectorXd p = z;
+    double rz = r.dot(z);
+
+    residual = r.norm() / b_norm;
+    while (residual > tolerance && num_iterations < max_iterations) {
+        const Eigen::VectorXd Ap = product(p);
+        const double pAp = p.dot(Ap);
+        if (!(pAp > 0)) {
+            // A is not positive definite along p
+            return false;
+        }
+
+        const double alpha = rz / pAp;
+        x += alpha * p;
+        r -= alpha * Ap;
+        num_iterations++;
+
+        residual = r.norm() / b_norm;
+        if (residual <= tolerance) {
+            break;
+        }
+
+        z = apply_preconditioner(r);
+        const double rz_next = r.dot(z);
+        p = z + (rz_next / rz) * p;
+        rz = rz_next;
+    }
+
+    return residual <= tolerance && std::isfinite(residual);
+}
+
+} // namespace ipc::rigid
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <Eigen/Core>
+#include <Eigen/SparseCore>
+
+namespace ipc::rigid {
+
+/// @brief Conjugate gradient with a block-Jacobi preconditioner.
+///
+/// The matrix is only used for products, so no factorization (or fill-in)
+/// is ever stored. Each preconditioner block is the dense diagonal block of
+/// the rows sharing a block id (e.g., the free DoF of one rigid body).
+class BlockJacobiPCG {
+public:
+    /// @brief Name used to select this solver in the linear_solver settings.
+    static std::string solver_name() { return "BlockJacobiPCG"; }
+
+    /// @brief Build the preconditioner of A (A must outlive the solves).
+    /// @param A          Symmetric matrix to solve with.
+    /// @param block_ids  Sorted block id of each row of A. If empty, every
+    ///                   row is its own block (i.e., Jacobi).
+    /// @param is_lower_triangular  A only stores its lower triangle, so the
+    ///                   products use its self-adjoint view.
+    void compute(
+        const Eigen::SparseMatrix<double>& A,
+        const Eigen::VectorXi& block_ids = Eigen::VectorXi(),
+        bool is_lower_triangular = false);
+
+    /// @brief Solve Ax = b starting from the given x.
+    /// @returns True if the relative residual reached the tolerance.
+    bool solve(const Eigen::VectorXd& b, Eigen::VectorXd& x);
+
+    /// @brief Apply the inverse of the preconditioner.
+    Eigen::VectorXd apply_preconditioner(const Eigen::VectorXd& r) const;
+
+    /// @brief Product of the (whole) symmetric matrix with x.
+    Eigen::VectorXd product(const Eigen::VectorXd& x) const;
+
+    int max_iterations = 1000; ///< @brief Maximum number of CG iterations
+    double tolerance = 1e-10;  ///< @brief Relative residual tolerance
+
+    int num_iterations = 0; ///< @brief Iterations of the last solve
+    double residual = 0;    ///< @brief Relative residual of the last solve
+
+protected:
+    const Eigen::SparseMatrix<double>* A = nullptr;
+    bool is_lower_triangular = false;
+
+    /// @brief First row of each block (with a trailing end offset).
+    std::vector<int> block_starts;
+    /// @brief Inverse of each diagonal block of A.
+    std::vector<Eigen::MatrixXd> inverse_blocks;
+};
+
+} // namespace ipc::rigid
@@ -0,0 +1,373 @@
+#include "body_ordered_ldlt.hpp"
+
+#include <algorithm>
+#include <queue>
+
+#include <constants.hpp>
+
+namespace ipc::rigid {
+
+std::vector<std::vector<int>> BodyOrderedLDLT::block_graph(
+    const Eigen::SparseMatrix<double>& A,
+    const Eigen::VectorXi& row_blocks,
+    int num_blocks)
+{
+    std::vector<std::vector<int>> graph(num_blocks);
+    for (int k = 0; k < A.outerSize(); k++) {
+        for (Eigen::SparseMatrix<double>::InnerIterator it(A, k); it; ++it) {
+            const int bi = row_blocks(it.row()), bj = row_blocks(it.col());
+            // A may only store one triangle
+            if (bi != bj) {
+                graph[bi].push_back(bj);
+                graph[bj].push_back(bi);
+            }
+        }
+    }
+    for (std::vector<int>& neighbors : graph) {
+        std::sort(neighbors.begin(), neighbors.end());
+        neighbors.erase(
+            std::unique(neighbors.begin(), neighbors.end()), neighbors.end());
+    }
+    return graph;
+}
+
+void BodyOrderedLDLT::order_blocks(const std::vector<std::vector<int>>& graph)
+{
+    const int num_blocks = graph.size();
+    std::vector<std::vector<int>> neighbors = graph;
+    std::vector<bool> is_eliminated(num_blocks, false);
+
+    // Lazy priority queue of (degree, block), skipping outdated entries
+    typedef std::pair<size_t, int> Entry;
+    std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> queue;
+    for (int i = 0; i < num_blocks; i++) {
+        queue.emplace(neighbors[i].size(), i);
+    }
+
+    m_block_order.clear();
+    m_filled_edges.clear();
+    m_block_parents.assign(num_blocks, -1);
+    m_is_block_tree = true;
+    while (!queue.empty()) {
+        const auto [degree, i] = queue.top();
+        queue.pop();
+        if (is_eliminated[i] || degree != neighbors[i].size()) {
+            continue;
+        }
+        is_eliminated[i] = true;
+        m_block_order.push_back(i);
+
+        // Eliminating a block couples all of its remaining neighbors
+        const std::vector<int> clique = std::move(neighbors[i]);
+        neighbors[i].clear();
+        // Only forests (e.g., chains) never couple two remaining blocks
+        if (clique.size() == 1) {
+            m_block_parents[i] = clique[0];
+        }
+        m_is_block_tree &= clique.size() <= 1;
+        for (const int j : clique) {
+            m_filled_edges.push_back(edge_key(i, j));
+            std::vector<int>& j_neighbors = neighbors[j];
+            std::vector<int> merged;
+            merged.reserve(j_neighbors.size() + clique.size());
+            std::set_union(
+                j_neighbors.begin(), j_neighbors.end(), clique.begin(),
+                clique.end(), std::back_inserter(merged));
+            merged.erase(
+                std::remove_if(
+                    merged.begin(), merged.end(),
+                    [&](int k) { return k == i || k == j; }),
+                merged.end());
+            j_neighbors = std::move(merged);
+            queue.emplace(j_neighbors.size(), j);
+        }
+    }
+    std::sort(m_filled_edges.begin(), m_filled_edges.end());
+
+    m_num_ordered_edges = 0;
+    for (const std::vector<int>& block_neighbors : graph) {
+        m_num_ordered_edges += block_neighbors.size();
+    }
+    m_num_orderings++;
+}
+
+bool BodyOrderedLDLT::is_ordering_valid(
+    const std::vector<std::vector<int>>& graph) const
+{
+    if (m_block_order.size() != graph.size()) {
+        return false;
+    }
+    size_t num_edges = 0;
+    for (int i = 0; i < graph.size(); i++) {
+        for (const int j : graph[i]) {
+            if (!std::binary_search(
+                    m_filled_edges.begin(), m_filled_edges.end(),
+                    edge_key(i, j))) {
+                return false;
+            }
+        }
+        num_edges += graph[i].size();
+    }
+    // Reorder once most of the couplings it was computed for are gone
+    return 2 * num_edges >= m_num_ordered_edges;
+}
+
+void BodyOrderedLDLT::analyze_pattern(
+    const Eigen::SparseMatrix<double>& A, const Eigen::VectorXi& block_ids)
+{
+    assert(A.rows() == A.cols());
+    assert(block_ids.size() == 0 || block_ids.size() == A.rows());
+
+    // Consecutive rows with the same block id form a block
+    m_row_blocks.resize(A.rows());
+    m_block_starts.clear();
+    for (int i = 0; i < A.rows(); i++) {
+        if (i == 0 || block_ids.size() == 0
+            || block_ids(i) != block_ids(i - 1)) {
+            m_block_starts.push_back(i);
+        }
+        m_row_blocks(i) = m_block_starts.size() - 1;
+    }
+    m_block_starts.push_back(A.rows());
+    const int num_blocks = m_block_starts.size() - 1;
+
+    const std::vector<std::vector<int>> graph =
+        block_graph(A, m_row_blocks, num_blocks);
+    if (!is_ordering_valid(graph)) {
+        order_blocks(graph);
+    }
+
+    // The rows of every block stay together in the order of the blocks
+    m_permutation.resize(A.rows());
+    int row = 0;
+    for (const int bi : m_block_order) {
+        for (int i = m_block_starts[bi]; i < m_block_starts[bi + 1]; i++) {
+            m_permutation.indices()(i) = row++;
+        }
+    }
+
+    if (m_is_block_tree) {
+        // Dense block elimination along the tree, no sparse analysis needed
+        m_is_single_precision = false;
+        m_tree_ldlts.resize(num_blocks);
+        m_tree_couplings.resize(num_blocks);
+        return;
+    }
+
+    m_is_single_precision = use_mixed_precision;
+    m_is_double_analyzed = !m_is_single_precision;
+    m_is_double_factorized = false;
+    permute(A);
+    if (m_is_single_precision) {
+        m_float_A = m_permuted_A.cast<float>();
+        m_float_ldlt.analyzePattern(m_float_A);
+    } else {
+        m_ldlt.analyzePattern(m_permuted_A);
+    }
+}
+
+void BodyOrderedLDLT::permute(const Eigen::SparseMatrix<double>& A)
+{
+    assert(A.rows() == m_permutation.size());
+    // The twisted lower part has unsorted columns, which sparse products
+    // with the self-adjoint view (used by the refinement) do not support,
+    // so it is sorted by transposing it back and forth.
+    Eigen::SparseMatrix<double> upper(A.rows(), A.cols());
+    upper.selfadjointView<Eigen::Upper>() =
+        A.selfadjointView<Eigen::Lower>().twistedBy(m_permutation);
+    m_permuted_A = upper.transpose();
+}
+
+bool BodyOrderedLDLT::factorize(const Eigen::SparseMatrix<double>& A)
+{
+    if (m_is_block_tree) {
+        return factorize_tree(A);
+    }
+    permute(A);
+    m_is_double_factorized = false;
+    if (m_is_single_precision) {
+        m_float_A = m_permuted_A.cast<float>();
+        m_float_ldlt.factorize(m_float_A);
+        if (m_float_ldlt.info() == Eigen::Success) {
+            return true;
+        }
+        // Out of the range of floats or too badly conditioned
+        m_is_single_precision = false;
+        m_num_fallbacks++;
+    }
+    return factorize_double();
+}
+
+bool BodyOrderedLDLT::factorize_double()
+{
+    if (!m_is_double_analyzed) {
+        m_ldlt.analyzePattern(m_permuted_A);
+        m_is_double_analyzed = true;
+    }
+    m_ldlt.factorize(m_permuted_A);
+    m_is_double_factorized = m_ldlt.info() == Eigen::Success;
+    return m_is_double_factorized;
+}
+
+bool BodyOrderedLDLT::solve(const Eigen::VectorXd& b, Eigen::VectorXd& x)
+{
+    assert(b.size() == m_permutation.size());
+    if (m_is_block_tree) {
+        return solve_tree(b, x);
+    }
+    const Eigen::VectorXd Pb = m_permutation * b;
+    Eigen::VectorXd y;
+    if (m_is_single_precision) {
+        if (solve_refined(Pb, y)) {
+            x = m_permutation.inverse() * y;
+            return true;
+        }
+        // Factorize in double for the rest of this pattern
+        m_is_single_precision = false;
+        m_num_fallbacks++;
+    }
+    if (!m_is_double_factorized && !factorize_double()) {
+        return false;
+    }
+    y = m_ldlt.solve(Pb);
+    x = m_permutation.inverse() * y;
+    return m_ldlt.info() == Eigen::Success && x.allFinite();
+}
+
+bool BodyOrderedLDLT::solve_refined(
+    const Eigen::VectorXd& Pb, Eigen::VectorXd& y)
+{
+    const double tol = Constants::MIXED_PRECISION_REFINEMENT_TOL * Pb.norm();
+    y = Eigen::VectorXd::Zero(Pb.size());
+    Eigen::VectorXd r = Pb;
+    double residual = r.norm();
+    for (int i = 0; i < Constants::MIXED_PRECISION_MAX_REFINEMENTS; i++) {
+        if (residual <= tol) {
+            return true;
+        }
+        // Only the correction is single precision, the residual is not
+        const Eigen::VectorXf dy = m_float_ldlt.solve(r.cast<float>());
+        if (m_float_ldlt.info() != Eigen::Success || !dy.allFinite()) {
+            return false;
+        }
+        y += dy.cast<double>();
+        r = Pb - m_permuted_A.selfadjointView<Eigen::Lower>() * y;
+        m_num_refinements++;
+
+        const double prev_residual = residual;
+        residual = r.norm();
+        if (!(residual
+              <= Constants::MIXED_PRECISION_STALL_RATIO * prev_residual)) {
+            break;
+        }
+    }
+    return residual <= tol;
+}
+
+bool BodyOrderedLDLT::factorize_tree(const Eigen::SparseMatrix<double>& A)
+{
+    assert(A.rows() == m_row_blocks.size());
+    const int num_blocks = m_block_starts.size() - 1;
+    auto block_size = [&](int bi) {
+        return m_block_starts[bi + 1] - m_block_starts[bi];
+    };
+
+    // Diagonal blocks and couplings to the parents (rows of the parent)
+    std::vector<Eigen::MatrixXd> diagonal_blocks(num_blocks);
+    for (int bi = 0; bi < num_blocks; bi++) {
+        diagonal_blocks[bi].setZero(block_size(bi), block_size(bi));
+        const int parent = m_block_parents[bi];
+        if (parent >= 0) {
+            m_tree_couplings[bi].setZero(block_size(parent), block_size(bi));
+        } else {
+            m_tree_couplings[bi].resize(0, 0);
+        }
+    }
+    for (int k = 0; k < A.outerSize(); k++) {
+        for (Eigen::SparseMatrix<double>::InnerIterator it(A, k); it; ++it) {
+            if (it.row() < it.col()) {
+                continue; // Only the lower part is used
+            }
+            const int bi = m_row_blocks(it.row()), bj = m_row_blocks(it.col());
+            const int r = it.row() - m_block_starts[bi];
+            const int c = it.col() - m_block_starts[bj];
+            if (bi == bj) {
+                diagonal_blocks[bi](r, c) = it.value();
+                diagonal_blocks[bi](c, r) = it.value();
+            } else if (m_block_parents[bj] == bi) {
+                m_tree_couplings[bj](r, c) = it.value();
+            } else {
+                assert(m_block_parents[bi] == bj);
+                m_tree_couplings[bi](c, r) = it.value();
+            }
+        }
+    }
+
+    // Eliminate the children before their parents: S_p -= A_pi S_i⁻¹ A_ip
+    for (const int bi : m_block_order) {
+        Eigen::LDLT<Eigen::MatrixXd>& ldlt = m_tree_ldlts[bi];
+        ldlt.compute(diagonal_blocks[bi]);
+        if (ldlt.info() != Eigen::Success
+            || !(ldlt.vectorD().array().abs() > 0).all()) {
+            return false;
+        }
+        const int parent = m_block_parents[bi];
+        if (parent >= 0) {
+            const Eigen::MatrixXd& C = m_tree_couplings[bi];
+            diagonal_blocks[parent].noalias() -=
+                C * ldlt.solve(C.transpose());
+        }
+    }
+    return true;
+}
+
+bool BodyOrderedLDLT::solve_tree(
+    const Eigen::VectorXd& b, Eigen::VectorXd& x) const
+{
+    auto segment = [&](Eigen::VectorXd& v, int bi) {
+        return v.segment(
+            m_block_starts[bi], m_block_starts[bi + 1] - m_block_starts[bi]);
+    };
+
+    // Forward elimination into the parents' right-hand sides
+    Eigen::VectorXd rhs = b;
+    for (const int bi : m_block_order) {
+        const int parent = m_block_parents[bi];
+        if (parent >= 0) {
+            segment(rhs, parent) -=
+                m_tree_couplings[bi] * m_tree_ldlts[bi].solve(segment(rhs, bi));
+        }
+    }
+
+    // Back substitution from the roots
+    x.resize(b.size());
+    for (auto it = m_block_order.rbegin(); it != m_block_order.rend(); ++it) {
+        const int bi = *it, parent = m_block_parents[bi];
+        if (parent >= 0) {
+            segment(x, bi) = m_tree_ldlts[bi].solve(
+                segment(rhs, bi)
+                - m_tree_couplings[bi].transpose() * segment(x, parent));
+        } else {
+            segment(x, bi) = m_tree_ldlts[bi].solve(segment(rhs, bi));
+        }
+    }
+    return x.allFinite();
+}
+
+void BodyOrderedLDLT::clear()
+{
+    m_block_order.clear();
+    m_block_parents.clear();
+    m_is_block_tree = false;
+    m_filled_edges.clear();
+    m_num_ordered_edges = 0;
+    m_num_orderings = 0;
+    m_num_refinements = 0;
+    m_num_fallbacks = 0;
+    m_permutation.resize(0);
+    m_is_single_precision = false;
+    m_is_double_analyzed = false;
+    m_is_double_factorized = false;
+}
+
+} // namespace ipc::rigid
@@ -0,0 +1,156 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <Eigen/Cholesky>
+#include <Eigen/Core>
+#include <Eigen/SparseCholesky>
+#include <Eigen/SparseCore>
+
+namespace ipc::rigid {
+
+/// @brief Sparse LDLᵀ solver with a fill-reducing ordering of the blocks
+/// (e.g., rigid bodies) of the matrix kept across sparsity patterns.
+///
+/// The ordering is a minimum degree ordering of the graph of the blocks,
+/// which is (block size)² times smaller than the graph of the entries. It is
+/// kept while the coupled blocks stay inside the filled graph of its
+/// elimination, and only recomputed when a new coupling falls outside of it
+/// or most couplings are gone. Contacts that come and go between time-steps
+/// then only redo the symbolic analysis with the same ordering.
+///
+/// When the blocks form a forest (e.g., chains of links), the minimum
+/// degree ordering eliminates leaves without any fill-in, and the matrix is
+/// factorized by dense block elimination along the tree in O(n) blocks.
+///
+/// With mixed precision, the factorization is done in single precision and
+/// the solution is iteratively refined against the double matrix. The
+/// double factorization is only computed when the refinement stalls.
+class BodyOrderedLDLT {
+public:
+    /// @brief Name used to select this solver in the linear_solver settings.
+    static std::string solver_name() { return "BodyOrderedLDLT"; }
+
+    /// @brief Analyze the pattern of A, updating the ordering if needed.
+    /// @param A          Symmetric matrix whose pattern is used (only its
+    ///                   lower part is read).
+    /// @param block_ids  Sorted block id of each row of A. If empty, every
+    ///                   row is its own block.
+    void analyze_pattern(
+        const Eigen::SparseMatrix<double>& A,
+        const Eigen::VectorXi& block_ids = Eigen::VectorXi());
+
+    /// @brief Factorize A (with the analyzed pattern).
+    /// @returns True if the factorization succeeded.
+    bool factorize(const Eigen::SparseMatrix<double>& A);
+
+    /// @brief Solve Ax = b with the last factorization.
+    /// @returns True if the solve succeeded.
+    bool solve(const Eigen::VectorXd& b, Eigen::VectorXd& x);
+
+    /// @brief Factorize in single precision with iterative refinement.
+    /// Takes effect at the next analyze_pattern().
+    bool use_mixed_precision = false;
+
+    /// @brief Forget the ordering and the analyzed pattern.
+    void clear();
+
+    /// @brief Elimination order of the blocks.
+    const std::vector<int>& block_order() const { return m_block_order; }
+
+    /// @brief Is the matrix factorized by block elimination along a tree?
+    bool is_block_tree() const { return m_is_block_tree; }
+
+    /// @brief Number of orderings computed since the last clear().
+    size_t num_orderings() const { return m_num_orderings; }
+    /// @brief Number of refinement steps since the last clear().
+    size_t num_refinements() const { return m_num_refinements; }
+    /// @brief Number of double factorizations after a stalled refinement.
+    size_t num_precision_fallbacks() const { return m_num_fallbacks; }
+
+protected:
+    /// @brief Sorted neighbors of every block in the pattern of A.
+    static std::vector<std::vector<int>> block_graph(
+        const Eigen::SparseMatrix<double>& A,
+        const Eigen::VectorXi& row_blocks,
+        int num_blocks);
+
+    /// @brief Compute a minimum degree ordering and its filled graph.
+    void order_blocks(const std::vector<std::vector<int>>& graph);
+
+    /// @brief Can the current ordering be used for the graph?
+    bool is_ordering_valid(const std::vector<std::vector<int>>& graph) const;
+
+    /// @brief Update m_permuted_A with the values of A.
+    void permute(const Eigen::SparseMatrix<double>& A);
+
+    /// @brief Factorize m_permuted_A in double precision.
+    bool factorize_double();
+
+    /// @brief Solve the permuted system with the single precision
+    /// factorization and iterative refinement.
+    /// @returns False if the refinement stalled.
+    bool solve_refined(const Eigen::VectorXd& Pb, Eigen::VectorXd& y);
+
+    /// @brief Factorize the blocks of A along the elimination tree.
+    bool factorize_tree(const Eigen::SparseMatrix<double>& A);
+
+    /// @brief Solve with the block tree factorization.
+    bool solve_tree(const Eigen::VectorXd& b, Eigen::VectorXd& x) const;
+
+    static uint64_t edge_key(int i, int j)
+    {
+        return (uint64_t(std::min(i, j)) << 32) | uint32_t(std::max(i, j));
+    }
+
+    std::vector<int> m_block_order;
+    /// @brief First row of each block (with the number of rows at the end).
+    std::vector<int> m_block_starts;
+    /// @brief Block of each row.
+    Eigen::VectorXi m_row_blocks;
+    /// @brief Only neighbor of each block when it is eliminated (or -1) if
+    /// the ordering is a block tree.
+    std::vector<int> m_block_parents;
+    /// @brief Does no elimination couple two remaining blocks?
+    bool m_is_block_tree = false;
+    /// @brief Sorted keys of the edges of the filled graph.
+    std::vector<uint64_t> m_filled_edges;
+    /// @brief Number of edges of the graph the ordering was computed for.
+    size_t m_num_ordered_edges = 0;
+    size_t m_num_orderings = 0;
+    size_t m_num_refinements = 0;
+    size_t m_num_fallbacks = 0;
+
+    Eigen::PermutationMatrix<Eigen::Dynamic, Eigen::Dynamic, int>
+        m_permutation;
+    /// @brief Lower part of the permuted matrix.
+    Eigen::SparseMatrix<double> m_permuted_A;
+    Eigen::SimplicialLDLT<
+        Eigen::SparseMatrix<double>,
+        Eigen::Lower,
+        Eigen::NaturalOrdering<int>>
+        m_ldlt;
+
+    /// @brief Factorization of the Schur complement of each tree block.
+    std::vector<Eigen::LDLT<Eigen::MatrixXd>> m_tree_ldlts;
+    /// @brief Coupling of each tree block to its parent (A_pi).
+    std::vector<Eigen::MatrixXd> m_tree_couplings;
+
+    /// @brief Is the last factorization in single precision?
+    bool m_is_single_precision = false;
+    /// @brief Has m_ldlt analyzed the current pattern?
+    bool m_is_double_analyzed = false;
+    /// @brief Does m_ldlt hold the factorization of the current values?
+    bool m_is_double_factorized = false;
+    /// @brief Single precision copy of m_permuted_A.
+    Eigen::SparseMatrix<float> m_float_A;
+    Eigen::SimplicialLDLT<
+        Eigen::SparseMatrix<float>,
+        Eigen::Lower,
+        Eigen::NaturalOrdering<int>>
+        m_float_ldlt;
+};
+
+} // namespace ipc::rigid
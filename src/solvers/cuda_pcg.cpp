@@ -0,0 +1,367 @@
+#include "cuda_pcg.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+#include <cublas_v2.h>
+#include <cuda_runtime.h>
+#include <cusparse.h>
+#include <spdlog/spdlog.h>
+
+namespace ipc::rigid {
+
+namespace {
+    bool check(cudaError_t status, const char* call)
+    {
+        if (status != cudaSuccess) {
+            spdlog::error(
+                "failure=\"{}\" cuda_error=\"{}\"", call,
+                cudaGetErrorString(status));
+        }
+        return status == cudaSuccess;
+    }
+
+    bool check(cusparseStatus_t status, const char* call)
+    {
+        if (status != CUSPARSE_STATUS_SUCCESS) {
+            spdlog::error(
+                "failure=\"{}\" cusparse_error=\"{}\"", call,
+                cusparseGetErrorString(status));
+        }
+        return status == CUSPARSE_STATUS_SUCCESS;
+    }
+
+    bool check(cublasStatus_t status, const char* call)
+    {
+        if (status != CUBLAS_STATUS_SUCCESS) {
+            spdlog::error(
+                "failure=\"{}\" cublas_error={:d}", call, int(status));
+        }
+        return status == CUBLAS_STATUS_SUCCESS;
+    }
+} // namespace
+
+#define CUDA_PCG_CHECK(call)                                                   \
+    if (!check(call, #call)) {                                                 \
+        return false;                                                          \
+    }
+
+/// @brief Device storage of a square CSR matrix (the transpose of the
+/// compressed column storage of a symmetric matrix) that keeps its buffers
+/// while the pattern is unchanged.
+struct DeviceCSR {
+    int rows = 0;
+    int nnz = 0;
+    int* outer = nullptr;
+    int* inner = nullptr;
+    double* values = nullptr;
+    cusparseSpMatDescr_t descr = nullptr;
+
+    void free()
+    {
+        if (descr) {
+            cusparseDestroySpMat(descr);
+        }
+        cudaFree(outer);
+        cudaFree(inner);
+        cudaFree(values);
+        *this = DeviceCSR();
+    }
+
+    bool upload_pattern(
+        int n, const std::vector<int>& outer_h, const std::vector<int>& inner_h)
+    {
+        free();
+        rows = n;
+        nnz = inner_h.size();
+        CUDA_PCG_CHECK(cudaMalloc(&outer, (n + 1) * sizeof(int)));
+        CUDA_PCG_CHECK(cudaMalloc(&inner, std::max(nnz, 1) * sizeof(int)));
+        CUDA_PCG_CHECK(cudaMalloc(&values, std::max(nnz, 1) * sizeof(double)));
+        CUDA_PCG_CHECK(cudaMemcpy(
+            outer, outer_h.data(), (n + 1) * sizeof(int),
+            cudaMemcpyHostToDevice));
+        CUDA_PCG_CHECK(cudaMemcpy(
+            inner, inner_h.data(), nnz * sizeof(int), cudaMemcpyHostToDevice));
+        CUDA_PCG_CHECK(cusparseCreateCsr(
+            &descr, n, n, nnz, outer, inner, values, CUSPARSE_INDEX_32I,
+            CUSPARSE_INDEX_32I, CUSPARSE_INDEX_BASE_ZERO, CUDA_R_64F));
+        return true;
+    }
+
+    bool upload_values(const double* values_h)
+    {
+        CUDA_PCG_CHECK(cudaMemcpy(
+            values, values_h, nnz * sizeof(double), cudaMemcpyHostToDevice));
+        return true;
+    }
+};
+
+struct CudaPCG::DeviceData {
+    cusparseHandle_t cusparse = nullptr;
+    cublasHandle_t cublas = nullptr;
+
+    DeviceCSR A, M;
+
+    int n = 0;
+    double *x = nullptr, *r = nullptr, *z = nullptr, *p = nullptr,
+           *Ap = nullptr;
+    cusparseDnVecDescr_t x_descr = nullptr, r_descr = nullptr,
+                         z_descr = nullptr, p_descr = nullptr,
+                         Ap_descr = nullptr;
+    void* spmv_buffer = nullptr;
+    size_t spmv_buffer_size = 0;
+
+    ~DeviceData()
+    {
+        A.free();
+        M.free();
+        free_vectors();
+        cudaFree(spmv_buffer);
+        if (cublas) {
+            cublasDestroy(cublas);
+        }
+        if (cusparse) {
+            cusparseDestroy(cusparse);
+        }
+    }
+
+    bool initialize()
+    {
+        if (cusparse && cublas) {
+            return true;
+        }
+        CUDA_PCG_CHECK(cusparseCreate(&cusparse));
+        CUDA_PCG_CHECK(cublasCreate(&cublas));
+        return true;
+    }
+
+    void free_vectors()
+    {
+        for (cusparseDnVecDescr_t descr :
+             { x_descr, r_descr, z_descr, p_descr, Ap_descr }) {
+            if (descr) {
+                cusparseDestroyDnVec(descr);
+            }
+        }
+        for (double* v : { x, r, z, p, Ap }) {
+            cudaFree(v);
+        }
+        x = r = z = p = Ap = nullptr;
+        x_descr = r_descr = z_descr = p_descr = Ap_descr = nullptr;
+        n = 0;
+    }
+
+    bool resize_vectors(int size)
+    {
+        if (size == n) {
+            return true;
+        }
+        free_vectors();
+        n = size;
+        for (auto [v, descr] :
+             { std::make_pair(&x, &x_descr), std::make_pair(&r, &r_descr),
+               std::make_pair(&z, &z_descr), std::make_pair(&p, &p_descr),
+               std::make_pair(&Ap, &Ap_descr) }) {
+            CUDA_PCG_CHECK(cudaMalloc(v, std::max(n, 1) * sizeof(double)));
+            CUDA_PCG_CHECK(cusparseCreateDnVec(descr, n, *v, CUDA_R_64F));
+        }
+        return true;
+    }
+
+    /// @brief Make sure the SpMV work buffer fits products with the matrix.
+    bool reserve_spmv_buffer(const DeviceCSR& mat)
+    {
+        const double one = 1, zero = 0;
+        size_t size = 0;
+        CUDA_PCG_CHECK(cusparseSpMV_bufferSize(
+            cusparse, CUSPARSE_OPERATION_NON_TRANSPOSE, &one, mat.descr,
+            p_descr, &zero, Ap_descr, CUDA_R_64F, CUSPARSE_SPMV_ALG_DEFAULT,
+            &size));
+        if (size > spmv_buffer_size) {
+            cudaFree(spmv_buffer);
+            spmv_buffer = nullptr;
+            CUDA_PCG_CHECK(cudaMalloc(&spmv_buffer, size));
+            spmv_buffer_size = size;
+        }
+        return true;
+    }
+
+    /// @brief y = alpha * mat * x + beta * y
+    bool spmv(
+        const DeviceCSR& mat,
+        double alpha,
+        cusparseDnVecDescr_t x,
+        double beta,
+        cusparseDnVecDescr_t y)
+    {
+        CUDA_PCG_CHECK(cusparseSpMV(
+            cusparse, CUSPARSE_OPERATION_NON_TRANSPOSE, &alpha, mat.descr, x,
+            &beta, y, CUDA_R_64F, CUSPARSE_SPMV_ALG_DEFAULT, spmv_buffer));
+        return true;
+    }
+};
+
+CudaPCG::CudaPCG() : m_device(std::make_unique<DeviceData>()) { }
+
+CudaPCG::~CudaPCG() = default;
+
+bool CudaPCG::update_preconditioner_matrix()
+{
+    const int n = block_starts.back();
+    std::vector<int> outer(n + 1, 0);
+    for (int bi = 0; bi < inverse_blocks.size(); bi++) {
+        const int start = block_starts[bi];
+        const int size = block_starts[bi + 1] - start;
+        for (int c = start; c < start + size; c++) {
+            outer[c + 1] = outer[c] + size;
+        }
+    }
+    const bool is_pattern_changed = outer != m_M_outer_indices;
+    if (is_pattern_changed) {
+        m_M_outer_indices = std::move(outer);
+        m_M_inner_indices.resize(m_M_outer_indices.back());
+    }
+    m_M_values.resize(m_M_outer_indices.back());
+
+    for (int bi = 0; bi < inverse_blocks.size(); bi++) {
+        const int start = block_starts[bi];
+        const int size = block_starts[bi + 1] - start;
+        for (int c = 0; c < size; c++) {
+            const int offset = m_M_outer_indices[start + c];
+            for (int r = 0; r < size; r++) {
+                m_M_inner_indices[offset + r] = start + r;
+                m_M_values[offset + r] = inverse_blocks[bi](r, c);
+            }
+        }
+    }
+    return is_pattern_changed;
+}
+
+bool CudaPCG::compute(
+    const Eigen::SparseMatrix<double>& A, const Eigen::VectorXi& block_ids)
+{
+    assert(A.isCompressed());
+    BlockJacobiPCG::compute(A, block_ids);
+
+    DeviceData& device = *m_device;
+    if (!device.initialize() || !device.resize_vectors(A.rows())) {
+        return false;
+    }
+
+    // Only upload the pattern when it changes
+    const int* outer = A.outerIndexPtr();
+    const int* inner = A.innerIndexPtr();
+    if (device.A.rows != A.rows()
+        || m_outer_indices.size() != A.outerSize() + 1
+        || m_inner_indices.size() != A.nonZeros()
+        || !std::equal(m_outer_indices.begin(), m_outer_indices.end(), outer)
+        || !std::equal(m_inner_indices.begin(), m_inner_indices.end(), inner)) {
+        m_outer_indices.assign(outer, outer + A.outerSize() + 1);
+        m_inner_indices.assign(inner, inner + A.nonZeros());
+        if (!device.A.upload_pattern(
+                A.rows(), m_outer_indices, m_inner_indices)
+            || !device.reserve_spmv_buffer(device.A)) {
+            m_outer_indices.clear(); // Upload it again next time
+            return false;
+        }
+        m_num_pattern_uploads++;
+    }
+    if (!device.A.upload_values(A.valuePtr())) {
+        return false;
+    }
+
+    if (update_preconditioner_matrix() || device.M.rows != A.rows()) {
+        if (!device.M.upload_pattern(
+                A.rows(), m_M_outer_indices, m_M_inner_indices)
+            || !device.reserve_spmv_buffer(device.M)) {
+            m_M_outer_indices.clear();
+            return false;
+        }
+    }
+    return device.M.upload_values(m_M_values.data());
+}
+
+bool CudaPCG::solve(const Eigen::VectorXd& b, Eigen::VectorXd& x)
+{
+    DeviceData& device = *m_device;
+    assert(A != nullptr && A->rows() == b.size() && device.n == b.size());
+    num_iterations = 0;
+    residual = 0;
+
+    if (x.size() != b.size()) {
+        x.setZero(b.size());
+    }
+
+    const double b_norm = b.norm();
+    if (b_norm == 0) {
+        x.setZero();
+        return true;
+    }
+
+    const int n = b.size();
+    cublasHandle_t cublas = device.cublas;
+    CUDA_PCG_CHECK(cudaMemcpy(
+        device.x, x.data(), n * sizeof(double), cudaMemcpyHostToDevice));
+    CUDA_PCG_CHECK(cudaMemcpy(
+        device.r, b.data(), n * sizeof(double), cudaMemcpyHostToDevice));
+
+    // r = b - A x, z = M⁻¹ r, p = z
+    if (!device.spmv(device.A, -1, device.x_descr, 1, device.r_descr)
+        || !device.spmv(device.M, 1, device.r_descr, 0, device.z_descr)) {
+        return false;
+    }
+    CUDA_PCG_CHECK(cublasDcopy(cublas, n, device.z, 1, device.p, 1));
+    double rz, r_norm;
+    CUDA_PCG_CHECK(cublasDdot(cublas, n, device.r, 1, device.z, 1, &rz));
+    CUDA_PCG_CHECK(cublasDnrm2(cublas, n, device.r, 1, &r_norm));
+
+    bool success = true;
+    residual = r_norm / b_norm;
+    while (residual > tolerance && num_iterations < max_iterations) {
+        if (!device.spmv(device.A, 1, device.p_descr, 0, device.Ap_descr)) {
+            return false;
+        }
+        double pAp;
+        CUDA_PCG_CHECK(
+            cublasDdot(cublas, n, device.p, 1, device.Ap, 1, &pAp));
+        if (!(pAp > 0)) {
+            // A is not positive definite along p
+            success = false;
+            break;
+        }
+
+        const double alpha = rz / pAp, minus_alpha = -alpha;
+        CUDA_PCG_CHECK(
+            cublasDaxpy(cublas, n, &alpha, device.p, 1, device.x, 1));
+        CUDA_PCG_CHECK(
+            cublasDaxpy(cublas, n, &minus_alpha, device.Ap, 1, device.r, 1));
+        num_iterations++;
+
+        CUDA_PCG_CHECK(cublasDnrm2(cublas, n, device.r, 1, &r_norm));
+        residual = r_norm / b_norm;
+        if (residual <= tolerance) {
+            break;
+        }
+
+        if (!device.spmv(device.M, 1, device.r_descr, 0, device.z_descr)) {
+            return false;
+        }
+        double rz_next;
+        CUDA_PCG_CHECK(
+            cublasDdot(cublas, n, device.r, 1, device.z, 1, &rz_next));
+        // p = z + (rz_next / rz) p
+        const double beta = rz_next / rz, one = 1;
+        CUDA_PCG_CHECK(cublasDscal(cublas, n, &beta, device.p, 1));
+        CUDA_PCG_CHECK(cublasDaxpy(cublas, n, &one, device.z, 1, device.p, 1));
+        rz = rz_next;
+    }
+
+    CUDA_PCG_CHECK(cudaMemcpy(
+        x.data(), device.x, n * sizeof(double), cudaMemcpyDeviceToHost));
+    return success && residual <= tolerance && std::isfinite(residual);
+}
+
+#undef CUDA_PCG_CHECK
+
+} // namespace ipc::rigid
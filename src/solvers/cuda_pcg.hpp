@@ -0,0 +1,67 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <Eigen/Core>
+#include <Eigen/SparseCore>
+
+#include <solvers/block_jacobi_pcg.hpp>
+
+namespace ipc::rigid {
+
+/// @brief Block-Jacobi preconditioned CG on the GPU (cuSPARSE and cuBLAS).
+///
+/// The matrix and the preconditioner stay on the device between solves.
+/// While the sparsity pattern is unchanged only their values are uploaded,
+/// so the Newton iterations of a step only move values and vectors. The
+/// preconditioner blocks are inverted on the host (see BlockJacobiPCG) and
+/// applied as a block-diagonal sparse matrix.
+///
+/// Only available when built with RIGID_IPC_WITH_CUDA.
+class CudaPCG : public BlockJacobiPCG {
+public:
+    CudaPCG();
+    ~CudaPCG();
+    CudaPCG(const CudaPCG&) = delete;
+    CudaPCG& operator=(const CudaPCG&) = delete;
+
+    /// @brief Name used to select this solver in the linear_solver settings.
+    static std::string solver_name() { return "CudaPCG"; }
+
+    /// @brief Build the preconditioner of A and upload both to the device.
+    /// @param A          Symmetric matrix to solve with.
+    /// @param block_ids  Sorted block id of each row of A. If empty, every
+    ///                   row is its own block (i.e., Jacobi).
+    /// @returns False if the device could not be used.
+    bool compute(
+        const Eigen::SparseMatrix<double>& A,
+        const Eigen::VectorXi& block_ids = Eigen::VectorXi());
+
+    /// @brief Solve Ax = b on the device starting from the given x.
+    /// @returns True if the relative residual reached the tolerance.
+    bool solve(const Eigen::VectorXd& b, Eigen::VectorXd& x);
+
+    /// @brief Number of pattern uploads since construction.
+    size_t num_pattern_uploads() const { return m_num_pattern_uploads; }
+
+protected:
+    /// @brief Update the host copy of the block-diagonal preconditioner.
+    /// @returns True if its pattern changed.
+    bool update_preconditioner_matrix();
+
+    /// @brief Device buffers and library handles (defined with CUDA only).
+    struct DeviceData;
+    std::unique_ptr<DeviceData> m_device;
+
+    /// @brief Pattern of the matrix on the device.
+    std::vector<int> m_outer_indices, m_inner_indices;
+    /// @brief Compressed column storage of the preconditioner.
+    std::vector<int> m_M_outer_indices, m_M_inner_indices;
+    std::vector<double> m_M_values;
+
+    size_t m_num_pattern_uploads = 0;
+};
+
+} // namespace ipc::rigid
@@ -63,19 +63,12 @@ void HomotopySolver::init_solve(const Eigen::VectorXd& x0)
     // Reset the number of outer iterations
     num_outer_iterations = 0;
 
-    // Find a good initial value for `t`
-    Eigen::VectorXd grad_B;
-    int num_active_barriers;
-    problem_ptr->compute_barrier_term(x0_i, grad_B, num_active_barriers);
-    if (false /*num_active_barriers > 0*/) {
-        Eigen::VectorXd grad_E;
-        problem_ptr->compute_energy_term(x0_i, grad_E);
-        t = tinit = 1 / (-grad_B.dot(grad_E) / grad_B.squaredNorm());
-    } else {
-        t = tinit;
-    }
-
-    spdlog::debug(
+    // NOTE: Choosing t from the barrier and energy gradients
+    // (t = 1 / (-∇B⋅∇E / ||∇B||²)) is disabled, so the barrier term is not
+    // evaluated here.
+    t = tinit;
+
+    RIGID_IPC_LOG_DEBUG(
         "solver={} d̂={} m={} t={} e_b={} c={} t_inc={}", name(),
         problem_ptr->barrier_activation_distance(), m, t, e_b, c, t_inc);
     problem_ptr->barrier_stiffness(1 / t);
@@ -86,7 +79,7 @@ OptimizationResults HomotopySolver::step_solve()
     assert(problem_ptr != nullptr);
     assert(inner_solver_ptr != nullptr);
 
-    spdlog::debug(
+    RIGID_IPC_LOG_DEBUG(
         "solver={} it={} d̂={} m={} t={} e_b={} c={}", name(),
         num_outer_iterations, problem_ptr->barrier_activation_distance(), m, t,
         e_b, c);
@@ -101,6 +94,9 @@ OptimizationResults HomotopySolver::step_solve()
     OptimizationResults results = inner_solver_ptr->solve(x0_i);
 
     results.minf = problem_ptr->compute_energy_term(results.x);
+    // The constraints of the last inner iteration are cached
+    max_num_constraints = std::max(
+        max_num_constraints, problem_ptr->num_active_barriers(results.x));
     // Start next iteration from the ending optimal position
     x0_i = results.x;
     t *= t_inc;
@@ -118,15 +114,12 @@ OptimizationResults HomotopySolver::solve(const Eigen::VectorXd& x0)
         results = step_solve();
     } while (m / t > e_b);
 
-    int num_constraints;
-    problem_ptr->compute_barrier_term(x0_i, num_constraints);
-    max_num_constraints = std::max(max_num_constraints, num_constraints);
-
     // make one last iteration with exactly eb
     t = m / e_b;
     const double t_used = t;
     results = step_solve();
 
+    // Reuses the constraint set cached by the last inner iteration
     double min_dist = problem_ptr->compute_min_distance(results.x);
     spdlog::info(
         "solver={} t={:g} min_dist={:g} max_num_constraints={:d} {}", name(),
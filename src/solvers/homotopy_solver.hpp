@@ -2,6 +2,7 @@
 
 #include <memory>
 
+#include <logger.hpp>
 #include <problems/barrier_problem.hpp>
 #include <solvers/newton_solver.hpp>
 #include <solvers/optimization_solver.hpp>
@@ -84,9 +85,18 @@ protected:
         InnerNewtonSolver()
             : NewtonSolver()
         {
+            // Continuation stages start where the last one ended
+            warm_start_hessian_reuse = true;
         }
         virtual ~InnerNewtonSolver() = default;
 
+        /// Start a new continuation (e.g., a new time-step) from scratch
+        void init_solve(const Eigen::VectorXd& x0) override
+        {
+            NewtonSolver::init_solve(x0);
+            reset_hessian_reuse();
+        }
+
         virtual void c(const double value) { c_ = value; }
         virtual void e_b(const double value) { e_b_ = value; }
         virtual void t(const double value) { t_ = value; }
@@ -103,7 +113,7 @@ protected:
         {
             switch (convergence_criteria) {
             case ConvergenceCriteria::ENERGY:
-                spdlog::debug(
+                RIGID_IPC_LOG_DEBUG(
                     "solve={} iter={:d} step_energy={:g} tol={:g}", //
                     name(), iteration_number,
                     abs(gradient_free.dot(direction_free)),
@@ -4,6 +4,7 @@
 
 #include <autodiff/autodiff_types.hpp>
 #include <barrier/barrier.hpp>
+#include <logger.hpp>
 
 namespace ipc::rigid {
 
@@ -20,7 +21,11 @@ void IPCSolver::settings(const nlohmann::json& json)
     dhat_epsilon = json["dhat_epsilon"].get<double>();
     min_barrier_stiffness_scale =
         json["min_barrier_stiffness_scale"].get<double>();
+    barrier_stiffness_warm_start_tolerance =
+        json["barrier_stiffness_warm_start_tolerance"].get<double>();
     num_kappa_updates = 0;
+    num_kappa_warm_starts = 0;
+    has_prev_solve = false;
 }
 
 // Export the state of the solver using the settings saved in JSON
@@ -29,6 +34,8 @@ nlohmann::json IPCSolver::settings() const
     nlohmann::json json = NewtonSolver::settings();
     json["dhat_epsilon"] = dhat_epsilon;
     json["min_barrier_stiffness_scale"] = min_barrier_stiffness_scale;
+    json["barrier_stiffness_warm_start_tolerance"] =
+        barrier_stiffness_warm_start_tolerance;
     return json;
 }
 
@@ -39,15 +46,30 @@ void IPCSolver::init_solve(const Eigen::VectorXd& x0)
 
     NewtonSolver::init_solve(x0);
 
+    // Keep κ of the previous step in similar contact, which avoids the
+    // energy and barrier gradients of the initial κ and its readaptation.
+    // The active set is built at x0 anyway for the minimum distance.
+    int num_active_barriers = barrier_problem_ptr()->num_active_barriers(x0);
+    if (can_warm_start_barrier_stiffness(x0, num_active_barriers)) {
+        num_kappa_warm_starts++;
+        spdlog::info(
+            "solver={} initial_num_active_barriers={:d} κ₀={:g} κ_max={:g} "
+            "warm_start=true",
+            name(), num_active_barriers,
+            barrier_problem_ptr()->barrier_stiffness(), max_barrier_stiffness);
+        prev_min_distance = problem_ptr->compute_min_distance(x0);
+        return;
+    }
+
     double bbox_diagonal = problem_ptr->world_bbox_diagonal();
-    double dhat = barrier_problem_ptr()->barrier_activation_distance();
+    // The thinnest barrier needs the stiffest κ
+    double dhat = barrier_problem_ptr()->min_barrier_activation_distance();
     double average_mass = problem_ptr->average_mass();
 
     Eigen::VectorXd grad_E;
     barrier_problem_ptr()->compute_energy_term(x0, grad_E);
 
     Eigen::VectorXd grad_B;
-    int num_active_barriers;
     barrier_problem_ptr()->compute_barrier_term(
         x0, grad_B, num_active_barriers);
 
@@ -64,13 +86,28 @@ void IPCSolver::init_solve(const Eigen::VectorXd& x0)
     prev_min_distance = problem_ptr->compute_min_distance(x0);
 }
 
+bool IPCSolver::can_warm_start_barrier_stiffness(
+    const Eigen::VectorXd& x0, int num_active_barriers)
+{
+    // A different activation distance or problem changes the scale of κ
+    if (!has_prev_solve || barrier_stiffness_warm_start_tolerance < 0
+        || prev_num_vars != x0.size()
+        || prev_dhat != barrier_problem_ptr()->barrier_activation_distance()) {
+        return false;
+    }
+    // Contact appears or disappears when the active set changes a lot
+    return std::abs(num_active_barriers - prev_num_active_barriers)
+        <= barrier_stiffness_warm_start_tolerance
+        * std::max(prev_num_active_barriers, 1);
+}
+
 void IPCSolver::post_step_update()
 {
     NewtonSolver::post_step_update();
 
     // Adaptive κ
     double min_distance = problem_ptr->compute_min_distance(x);
-    spdlog::debug(
+    RIGID_IPC_LOG_DEBUG(
         "solver={} iter={:d} min_distance={:g}", name(), iteration_number,
         min_distance);
     double kappa = barrier_problem_ptr()->barrier_stiffness();
@@ -83,6 +120,9 @@ void IPCSolver::post_step_update()
             iteration_number, kappa);
         barrier_problem_ptr()->barrier_stiffness(kappa);
         num_kappa_updates++;
+        // κ scales the barrier term of the objective
+        clear_objective_cache();
+        reset_hessian_reuse();
     }
     prev_min_distance = min_distance;
 }
@@ -92,6 +132,13 @@ OptimizationResults IPCSolver::solve(const Eigen::VectorXd& x0)
 {
     init_solve(x0);
     OptimizationResults results = NewtonSolver::solve(x0);
+
+    has_prev_solve = true;
+    prev_num_active_barriers =
+        barrier_problem_ptr()->num_active_barriers(results.x);
+    prev_num_vars = results.x.size();
+    prev_dhat = barrier_problem_ptr()->barrier_activation_distance();
+
     spdlog::info(
         "solver={} min_dist={:g} {}", name(),
         problem_ptr->compute_min_distance(results.x), stats_string());
@@ -101,7 +148,8 @@ OptimizationResults IPCSolver::solve(const Eigen::VectorXd& x0)
 std::string IPCSolver::stats_string() const
 {
     return fmt::format(
-        "num_kappa_updates={:d} {}", num_kappa_updates,
+        "num_kappa_updates={:d} num_kappa_warm_starts={:d} {}",
+        num_kappa_updates, num_kappa_warm_starts,
         NewtonSolver::stats_string());
 }
 
@@ -109,6 +157,7 @@ nlohmann::json IPCSolver::stats() const
 {
     nlohmann::json stats_json = NewtonSolver::stats();
     stats_json["num_kappa_updates"] = num_kappa_updates;
+    stats_json["num_kappa_warm_starts"] = num_kappa_warm_starts;
     return stats_json;
 }
 
@@ -54,6 +54,11 @@ protected:
     /// @brief Activation distance of adaptive barrier stiffness.
     double dhat_epsilon;
 
+    /// @brief Keep κ of the previous solve while the number of active
+    /// barriers changes by at most this fraction (negative to always
+    /// recompute the initial κ).
+    double barrier_stiffness_warm_start_tolerance;
+
     ///////////////////////////////////////////////////////////////////////
     // Computed values
 
@@ -64,7 +69,18 @@ protected:
     double prev_min_distance;
 
 private:
+    /// @brief Can the next solve start from the κ of the previous solve?
+    bool can_warm_start_barrier_stiffness(
+        const Eigen::VectorXd& x0, int num_active_barriers);
+
     int num_kappa_updates = 0;
+    int num_kappa_warm_starts = 0;
+
+    /// @brief State at the end of the previous solve (for warm starts).
+    bool has_prev_solve = false;
+    int prev_num_active_barriers;
+    int prev_num_vars;
+    double prev_dhat;
 };
 
 } // namespace ipc::rigid
@@ -0,0 +1,200 @@
+#include "island_linear_solver.hpp"
+
+#include <algorithm>
+#include <numeric>
+
+#include <tbb/parallel_for.h>
+
+#include <logger.hpp>
+#include <tracer.hpp>
+
+namespace ipc::rigid {
+
+int sparse_connected_components(
+    const Eigen::SparseMatrix<double>& A, Eigen::VectorXi& components)
+{
+    assert(A.rows() == A.cols());
+
+    // Union-find over the nonzeros
+    std::vector<int> parents(A.rows());
+    std::iota(parents.begin(), parents.end(), 0);
+    const auto find = [&](int i) {
+        while (parents[i] != i) {
+            i = parents[i] = parents[parents[i]]; // Path halving
+        }
+        return i;
+    };
+    for (int col = 0; col < A.outerSize(); col++) {
+        for (Eigen::SparseMatrix<double>::InnerIterator it(A, col); it;
+             ++it) {
+            int root_row = find(it.row()), root_col = find(col);
+            if (root_row != root_col) {
+                parents[std::max(root_row, root_col)] =
+                    std::min(root_row, root_col);
+            }
+        }
+    }
+
+    // The smallest row is the root, so roots are labeled before their rows
+    components.resize(A.rows());
+    int num_components = 0;
+    for (int i = 0; i < A.rows(); i++) {
+        int root = find(i);
+        components(i) = root == i ? num_components++ : components(root);
+    }
+    return num_components;
+}
+
+void IslandLinearSolver::analyze_pattern(
+    const Eigen::SparseMatrix<double>& A,
+    const nlohmann::json& settings,
+    int max_groups)
+{
+    clear();
+
+    Eigen::VectorXi components;
+    m_num_islands = sparse_connected_components(A, components);
+    const int num_groups = std::min(m_num_islands, max_groups);
+    if (num_groups <= 1) {
+        return; // Nothing to solve in parallel
+    }
+
+    // The number of nonzeros approximates the cost of an island
+    std::vector<size_t> costs(m_num_islands, 0);
+    for (int col = 0; col < A.outerSize(); col++) {
+        for (Eigen::SparseMatrix<double>::InnerIterator it(A, col); it;
+             ++it) {
+            costs[components(col)]++;
+        }
+    }
+    std::vector<int> islands(m_num_islands);
+    std::iota(islands.begin(), islands.end(), 0);
+    std::stable_sort(islands.begin(), islands.end(), [&](int i, int j) {
+        return costs[i] > costs[j];
+    });
+
+    // Greedily give the most expensive remaining island to the cheapest group
+    std::vector<size_t> group_costs(num_groups, 0);
+    std::vector<int> island_groups(m_num_islands);
+    for (int island : islands) {
+        int group = std::min_element(group_costs.begin(), group_costs.end())
+            - group_costs.begin();
+        island_groups[island] = group;
+        group_costs[group] += costs[island];
+    }
+
+    m_groups.resize(num_groups);
+    m_local_rows.resize(A.rows());
+    for (int i = 0; i < A.rows(); i++) {
+        std::vector<int>& rows = m_groups[island_groups[components(i)]].rows;
+        m_local_rows(i) = rows.size();
+        rows.push_back(i);
+    }
+
+    // Solvers are created serially, but analyzed in parallel
+    for (Group& group : m_groups) {
+        group.solver = polysolve::LinearSolver::create(settings["name"], "");
+        group.solver->setParameters(settings);
+    }
+    tbb::parallel_for(size_t(0), m_groups.size(), [&](size_t i) {
+        Group& group = m_groups[i];
+        extract(A, group);
+        group.solver->analyzePattern(group.A, group.A.rows());
+    });
+
+    RIGID_IPC_LOG_DEBUG(
+        "linear_solver={} num_islands={:d} num_groups={:d}",
+        settings["name"].get<std::string>(), m_num_islands, num_groups);
+}
+
+bool IslandLinearSolver::solve(
+    const Eigen::SparseMatrix<double>& A,
+    const Eigen::VectorXd& b,
+    Eigen::VectorXd& x)
+{
+    return factorize(A) && solve_factorized(b, x);
+}
+
+namespace {
+    bool is_success(polysolve::LinearSolver& solver)
+    {
+        nlohmann::json info;
+        solver.getInfo(info);
+        // TODO: This check only works for direct Eigen solvers
+        return !info.contains("solver_info")
+            || info["solver_info"] == "Success";
+    }
+} // namespace
+
+bool IslandLinearSolver::factorize(const Eigen::SparseMatrix<double>& A)
+{
+    assert(m_local_rows.size() == A.rows());
+
+    std::vector<char> is_factorized(m_groups.size(), false);
+    tbb::parallel_for(size_t(0), m_groups.size(), [&](size_t i) {
+        TRACE_SCOPE("linear_solve::island");
+        Group& group = m_groups[i];
+        extract(A, group);
+        group.solver->factorize(group.A);
+        is_factorized[i] = is_success(*group.solver);
+    });
+
+    return std::all_of(
+        is_factorized.begin(), is_factorized.end(), [](char s) { return s; });
+}
+
+bool IslandLinearSolver::solve_factorized(
+    const Eigen::VectorXd& b, Eigen::VectorXd& x)
+{
+    assert(m_local_rows.size() == b.size());
+    x.setZero(b.size());
+
+    std::vector<char> is_solved(m_groups.size(), false);
+    tbb::parallel_for(size_t(0), m_groups.size(), [&](size_t i) {
+        TRACE_SCOPE("linear_solve::island");
+        Group& group = m_groups[i];
+
+        Eigen::VectorXd group_b(group.rows.size());
+        for (int j = 0; j < group.rows.size(); j++) {
+            group_b(j) = b(group.rows[j]);
+        }
+        Eigen::VectorXd group_x = Eigen::VectorXd::Zero(group_b.size());
+        group.solver->solve(group_b, group_x);
+        if (!is_success(*group.solver)) {
+            return;
+        }
+
+        // Groups own disjoint rows, so they can be scattered concurrently
+        for (int j = 0; j < group.rows.size(); j++) {
+            x(group.rows[j]) = group_x(j);
+        }
+        is_solved[i] = true;
+    });
+
+    return std::all_of(
+        is_solved.begin(), is_solved.end(), [](char s) { return s; });
+}
+
+void IslandLinearSolver::clear()
+{
+    m_groups.clear();
+    m_local_rows.resize(0);
+    m_num_islands = 0;
+}
+
+void IslandLinearSolver::extract(
+    const Eigen::SparseMatrix<double>& A, Group& group) const
+{
+    std::vector<Eigen::Triplet<double>> triplets;
+    for (int j = 0; j < group.rows.size(); j++) {
+        // Every entry of an island's column is in the same island
+        for (Eigen::SparseMatrix<double>::InnerIterator it(A, group.rows[j]);
+             it; ++it) {
+            triplets.emplace_back(m_local_rows(it.row()), j, it.value());
+        }
+    }
+    group.A.resize(group.rows.size(), group.rows.size());
+    group.A.setFromTriplets(triplets.begin(), triplets.end());
+}
+
+} // namespace ipc::rigid
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include <Eigen/Core>
+#include <Eigen/SparseCore>
+#include <nlohmann/json.hpp>
+#include <polysolve/LinearSolver.hpp>
+
+namespace ipc::rigid {
+
+/// @brief Label the connected components of the sparsity graph of A.
+/// @param[in] A            Symmetric matrix.
+/// @param[out] components  Component id of each row of A (in order of
+///                         their first row).
+/// @returns The number of components.
+int sparse_connected_components(
+    const Eigen::SparseMatrix<double>& A, Eigen::VectorXi& components);
+
+/// @brief Direct solver of systems that split into independent islands.
+///
+/// Rigid bodies are only coupled through contacts, so the Hessian is block
+/// diagonal (up to a permutation) with one block per contact island. The
+/// islands are packed into balanced groups and every group is analyzed,
+/// factorized, and solved in parallel with its own linear solver.
+class IslandLinearSolver {
+public:
+    /// @brief Find the islands of A and analyze the pattern of each group.
+    /// No groups are made if the islands cannot be split across groups.
+    /// @param A           Symmetric matrix whose pattern is used.
+    /// @param settings    Linear solver settings (polysolve).
+    /// @param max_groups  Maximum number of groups (e.g., threads).
+    void analyze_pattern(
+        const Eigen::SparseMatrix<double>& A,
+        const nlohmann::json& settings,
+        int max_groups);
+
+    /// @brief Factorize the groups of A and solve Ax = b.
+    /// A must have the pattern given to analyze_pattern.
+    /// @returns True if every group was factorized and solved.
+    bool solve(
+        const Eigen::SparseMatrix<double>& A,
+        const Eigen::VectorXd& b,
+        Eigen::VectorXd& x);
+
+    /// @brief Factorize the groups of A (with the analyzed pattern).
+    /// @returns True if every group was factorized.
+    bool factorize(const Eigen::SparseMatrix<double>& A);
+
+    /// @brief Solve with the last factorization.
+    /// @returns True if every group was solved.
+    bool solve_factorized(const Eigen::VectorXd& b, Eigen::VectorXd& x);
+
+    /// @brief Forget the analyzed pattern.
+    void clear();
+
+    int num_islands() const { return m_num_islands; }
+    int num_groups() const { return m_groups.size(); }
+
+protected:
+    struct Group {
+        std::vector<int> rows; ///< @brief Sorted rows of A in the group
+        Eigen::SparseMatrix<double> A;
+        std::unique_ptr<polysolve::LinearSolver> solver;
+    };
+
+    /// @brief Copy the entries of the group's rows and columns of A.
+    void extract(const Eigen::SparseMatrix<double>& A, Group& group) const;
+
+    std::vector<Group> m_groups;
+    /// @brief Row of each row of A in its group.
+    Eigen::VectorXi m_local_rows;
+    int m_num_islands = 0;
+};
+
+} // namespace ipc::rigid
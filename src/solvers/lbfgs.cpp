@@ -0,0 +1,53 @@
+#include "lbfgs.hpp"
+
+#include <cmath>
+#include <limits>
+#include <vector>
+
+namespace ipc::rigid {
+
+bool LBFGS::update(const Eigen::VectorXd& s, const Eigen::VectorXd& y)
+{
+    assert(s.size() == y.size());
+    if (!m_pairs.empty() && m_pairs.back().s.size() != s.size()) {
+        clear(); // The variables changed
+    }
+
+    // The update is only positive definite with positive curvature
+    const double sy = s.dot(y);
+    if (!(sy > std::numeric_limits<double>::epsilon() * s.norm() * y.norm())
+        || history_size == 0) {
+        return false;
+    }
+
+    if (m_pairs.size() >= history_size) {
+        m_pairs.pop_front();
+    }
+    m_pairs.push_back({ s, y, 1 / sy });
+    return true;
+}
+
+Eigen::VectorXd LBFGS::apply_inverse_hessian(
+    const Eigen::VectorXd& g, const Eigen::VectorXd& initial_hessian) const
+{
+    assert(g.size() == initial_hessian.size());
+    if (!m_pairs.empty() && m_pairs.back().s.size() != g.size()) {
+        return g.cwiseQuotient(initial_hessian);
+    }
+
+    // Two-loop recursion
+    Eigen::VectorXd q = g;
+    std::vector<double> alphas(m_pairs.size());
+    for (int i = int(m_pairs.size()) - 1; i >= 0; i--) {
+        alphas[i] = m_pairs[i].rho * m_pairs[i].s.dot(q);
+        q -= alphas[i] * m_pairs[i].y;
+    }
+    Eigen::VectorXd r = q.cwiseQuotient(initial_hessian);
+    for (int i = 0; i < m_pairs.size(); i++) {
+        const double beta = m_pairs[i].rho * m_pairs[i].y.dot(r);
+        r += (alphas[i] - beta) * m_pairs[i].s;
+    }
+    return r;
+}
+
+} // namespace ipc::rigid
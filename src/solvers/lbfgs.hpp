@@ -0,0 +1,44 @@
+#pragma once
+
+#include <deque>
+
+#include <Eigen/Core>
+
+namespace ipc::rigid {
+
+/// @brief Limited-memory BFGS approximation of the inverse Hessian.
+///
+/// The initial Hessian is a given diagonal (e.g., the mass matrix), which
+/// is exact for the inertial term of the objective.
+class LBFGS {
+public:
+    /// @brief Add the change in x (s) and gradient (y) of a step.
+    /// Pairs without positive curvature are skipped.
+    /// @returns True if the pair was added.
+    bool update(const Eigen::VectorXd& s, const Eigen::VectorXd& y);
+
+    /// @brief Apply the inverse Hessian approximation to g.
+    /// @param g                Vector (e.g., the gradient).
+    /// @param initial_hessian  Diagonal of the initial Hessian.
+    Eigen::VectorXd apply_inverse_hessian(
+        const Eigen::VectorXd& g,
+        const Eigen::VectorXd& initial_hessian) const;
+
+    /// @brief Forget all pairs (e.g., when the objective changes).
+    void clear() { m_pairs.clear(); }
+
+    size_t size() const { return m_pairs.size(); }
+
+    /// @brief Maximum number of (s, y) pairs kept.
+    size_t history_size = 10;
+
+protected:
+    struct Pair {
+        Eigen::VectorXd s, y;
+        double rho; ///< @brief 1 / (sᵀy)
+    };
+    /// @brief Pairs with the newest last.
+    std::deque<Pair> m_pairs;
+};
+
+} // namespace ipc::rigid
@@ -1,13 +1,21 @@
 // Functions for optimizing functions.
 #include "newton_solver.hpp"
 
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
 #include <igl/slice.h>
 #include <igl/slice_into.h>
 #include <igl/writeOBJ.h>
+#include <tbb/task_arena.h>
+#include <tbb/task_group.h>
 
 #include <constants.hpp>
 #include <logger.hpp>
 #include <profiler.hpp>
+#include <tracer.hpp>
+#include <utils/step_metrics.hpp>
 
 // #define USE_GRADIENT_DESCENT
 
@@ -15,6 +23,7 @@ namespace ipc::rigid {
 
 NewtonSolver::NewtonSolver()
     : max_iterations(1000)
+    , problem_ptr(nullptr)
     , iteration_number(0)
     , convergence_criteria(ConvergenceCriteria::ENERGY)
     , m_line_search_lower_bound(Constants::DEFAULT_LINE_SEARCH_LOWER_BOUND)
@@ -34,8 +43,55 @@ void NewtonSolver::settings(const nlohmann::json& json)
     velocity_conv_tol = json["velocity_conv_tol"];
     is_velocity_conv_tol_abs = json["is_velocity_conv_tol_abs"];
     m_line_search_lower_bound = json["line_search_lower_bound"];
+    line_search_batch_size = json["line_search_batch_size"];
+    max_line_search_iterations = json["max_line_search_iterations"];
+    line_search_interpolation = json["line_search_interpolation"];
+    time_budget = json["time_budget"];
+    hessian_approximation = json["hessian_approximation"];
+    max_lagged_iterations = json["max_lagged_iterations"];
+    lbfgs.history_size = json["lbfgs_history_size"];
+    speculative_broad_phase_inflation =
+        json["speculative_broad_phase_inflation"];
+    speculative_step_bound = -1;
+    inexact_newton = json["inexact_newton"];
 
     linear_solver_settings = json["linear_solver"];
+    min_forcing_term = linear_solver_settings.value("tolerance", 1e-10);
+    forcing_term = 0;
+    use_block_jacobi_pcg =
+        linear_solver_settings["name"] == BlockJacobiPCG::solver_name();
+#ifdef RIGID_IPC_WITH_CUDA
+    use_cuda_pcg = linear_solver_settings["name"] == CudaPCG::solver_name();
+    use_block_jacobi_pcg |= use_cuda_pcg;
+#endif
+    use_body_ordered_ldlt = false;
+    if (use_block_jacobi_pcg) {
+        pcg_solver.max_iterations =
+            linear_solver_settings.value("max_iter", 1000);
+        pcg_solver.tolerance = linear_solver_settings.value("tolerance", 1e-10);
+#ifdef RIGID_IPC_WITH_CUDA
+        cuda_pcg_solver.max_iterations = pcg_solver.max_iterations;
+        cuda_pcg_solver.tolerance = pcg_solver.tolerance;
+#endif
+        // Keep a direct solver around in case the settings are changed back
+        linear_solver = polysolve::LinearSolver::create("", "");
+        reset_stats();
+        return;
+    }
+    use_body_ordered_ldlt =
+        linear_solver_settings["name"] == BodyOrderedLDLT::solver_name();
+    if (use_body_ordered_ldlt) {
+        body_ldlt_solver.use_mixed_precision =
+            linear_solver_settings.value("mixed_precision", false);
+        linear_solver = polysolve::LinearSolver::create("", "");
+        use_island_solve = false;
+        analyzed_outer_indices.clear();
+        analyzed_inner_indices.clear();
+        island_solver.clear();
+        body_ldlt_solver.clear();
+        reset_stats();
+        return;
+    }
     try {
         linear_solver =
             polysolve::LinearSolver::create(linear_solver_settings["name"], "");
@@ -46,6 +102,11 @@ void NewtonSolver::settings(const nlohmann::json& json)
             polysolve::LinearSolver::create(linear_solver_settings["name"], "");
     }
     linear_solver->setParameters(linear_solver_settings);
+    use_island_solve = linear_solver_settings.value("solve_islands", false);
+    // A new solver has not analyzed any pattern
+    analyzed_outer_indices.clear();
+    analyzed_inner_indices.clear();
+    island_solver.clear();
 
     reset_stats();
 }
@@ -59,6 +120,16 @@ nlohmann::json NewtonSolver::settings() const
     settings["energy_conv_tol"] = energy_conv_tol;
     settings["velocity_conv_tol"] = velocity_conv_tol;
     settings["is_velocity_conv_tol_abs"] = is_velocity_conv_tol_abs;
+    settings["line_search_batch_size"] = line_search_batch_size;
+    settings["max_line_search_iterations"] = max_line_search_iterations;
+    settings["line_search_interpolation"] = line_search_interpolation;
+    settings["time_budget"] = time_budget;
+    settings["hessian_approximation"] = hessian_approximation;
+    settings["max_lagged_iterations"] = max_lagged_iterations;
+    settings["lbfgs_history_size"] = lbfgs.history_size;
+    settings["speculative_broad_phase_inflation"] =
+        speculative_broad_phase_inflation;
+    settings["inexact_newton"] = inexact_newton;
     return settings;
 }
 
@@ -78,7 +149,18 @@ nlohmann::json NewtonSolver::stats() const
              { "count_grad", num_grad_fx },
              { "count_hess", num_hessian_fx },
              { "count_ccd", num_collision_check },
-             { "total_regularizations", regularization_iterations } };
+             { "total_regularizations", regularization_iterations },
+             { "count_symbolic_factorizations", num_symbolic_factorizations },
+             { "total_pcg_iterations", pcg_iterations },
+             { "count_fx_cache_hits", num_fx_cache_hits },
+             { "count_lagged_directions", num_lagged_directions },
+             { "total_linear_solver_iterations", linear_solver_iterations },
+             { "count_inexact_directions", num_inexact_directions },
+             { "count_inexact_convergence_checks",
+               num_inexact_convergence_checks },
+             { "max_linear_solve_residual", max_linear_solve_residual },
+             { "count_time_budget_exits", num_time_budget_exits },
+             { "max_time_budget_usage", max_time_budget_usage } };
 }
 
 std::string NewtonSolver::stats_string() const
@@ -87,10 +169,21 @@ std::string NewtonSolver::stats_string() const
         "total_newton_steps={:d} total_ls_steps={:d} "
         "num_newton_ls_fails={:d} num_grad_ls_fails={:d} count_fx={:d} "
         "count_grad={:d} count_hess={:d} count_ccd={:d} "
-        "total_regularizations={:d}",
+        "total_regularizations={:d} count_symbolic_factorizations={:d} "
+        "total_pcg_iterations={:d} count_fx_cache_hits={:d} "
+        "count_lagged_directions={:d} total_linear_solver_iterations={:d} "
+        "count_inexact_directions={:d} "
+        "count_inexact_convergence_checks={:d} "
+        "max_linear_solve_residual={:g} count_time_budget_exits={:d} "
+        "max_time_budget_usage={:g}",
         newton_iterations, ls_iterations, num_newton_ls_fails,
         num_grad_ls_fails, num_fx, num_grad_fx, num_hessian_fx,
-        num_collision_check, regularization_iterations);
+        num_collision_check, regularization_iterations,
+        num_symbolic_factorizations, pcg_iterations, num_fx_cache_hits,
+        num_lagged_directions, linear_solver_iterations,
+        num_inexact_directions, num_inexact_convergence_checks,
+        max_linear_solve_residual, num_time_budget_exits,
+        max_time_budget_usage);
 }
 
 void NewtonSolver::reset_stats()
@@ -104,6 +197,16 @@ void NewtonSolver::reset_stats()
     num_newton_ls_fails = 0;
     num_grad_ls_fails = 0;
     regularization_iterations = 0;
+    num_symbolic_factorizations = 0;
+    pcg_iterations = 0;
+    num_fx_cache_hits = 0;
+    num_lagged_directions = 0;
+    linear_solver_iterations = 0;
+    num_inexact_directions = 0;
+    num_inexact_convergence_checks = 0;
+    max_linear_solve_residual = 0;
+    num_time_budget_exits = 0;
+    max_time_budget_usage = 0;
 }
 
 bool NewtonSolver::converged()
@@ -184,7 +287,7 @@ OptimizationResults NewtonSolver::solve(const Eigen::VectorXd& x0)
     double step_length = 1.0;
     double regulariztion_coeff = 0;
 
-    spdlog::debug("solver={} action=BEGIN", name());
+    RIGID_IPC_LOG_DEBUG("solver={} action=BEGIN", name());
 
     std::string exit_reason = "exceeded the maximum allowable iterations";
 
@@ -194,30 +297,81 @@ OptimizationResults NewtonSolver::solve(const Eigen::VectorXd& x0)
     is_energy_converged = false;
     bool success = false;
 
+    update_free_dof();
+    // The objective may have changed since the last solve
+    clear_objective_cache();
+    solve_line_search_failures = 0;
+    solve_earliest_toi = 1;
+    solve_start_time = std::chrono::steady_clock::now();
+    forcing_term = 0;
+    prev_forcing_gradient_norm = -1;
+    is_confirming_convergence = false;
+    if (!warm_start_hessian_reuse) {
+        reset_hessian_reuse();
+    }
+
     for (iteration_number = 0; iteration_number < max_iterations;
          iteration_number++) {
-        double fx = problem_ptr->compute_objective(x, gradient, hessian);
+        // Every iterate is intersection free, so the current one is returned
+        if (is_time_budget_exceeded()) {
+            exit_reason = "exceeded the time budget";
+            num_time_budget_exits++;
+            break;
+        }
 
-        num_fx++;
-        num_grad_fx++;
-        num_hessian_fx++;
+        if (problem_ptr->begin_iteration(x)) {
+            // The cached objectives of the last line search are outdated
+            clear_objective_cache();
+        }
 
-        // Remove rows and cols of fixed DoF
-        Eigen::VectorXi free_dof = problem_ptr->free_dof();
-        igl::slice(gradient, free_dof, gradient_free);
-        igl::slice(hessian, free_dof, free_dof, hessian_free);
+        // Lagged factorizations and L-BFGS only need the gradient
+        bool is_hessian_needed =
+            hessian_approximation == HessianApproximation::EXACT
+            || (hessian_approximation == HessianApproximation::LAGGED
+                && lagged_iterations < 0);
+        double fx = compute_free_objective(is_hessian_needed);
+
+        bool is_approximate_direction =
+            !is_hessian_needed && compute_approximate_direction();
+        if (!is_hessian_needed && !is_approximate_direction) {
+            fx = compute_free_objective(/*compute_hessian=*/true);
+        }
+        // An approximate direction that fails is retried with a refreshed
+        // Hessian (or the initial L-BFGS Hessian)
+        const bool can_refresh = is_approximate_direction
+            && (hessian_approximation == HessianApproximation::LAGGED
+                || lbfgs.size() > 0);
 
+        if (!is_approximate_direction) {
 #ifdef USE_GRADIENT_DESCENT
-        direction_free = -gradient_free;
+            direction_free = -gradient_free;
 #else
-        bool solve_success = compute_regularized_direction(
-            fx, gradient_free, hessian_free, direction_free,
-            regulariztion_coeff);
-        if (!solve_success) {
-            exit_reason = "regularization failed";
-            break;
-        }
+            // Detect the CCD candidates of the line search while the linear
+            // solver runs (often on fewer cores than available)
+            tbb::task_group speculation;
+            if (is_speculating_broad_phase()) {
+                speculation.run([&]() {
+                    problem_ptr->prefetch_earliest_toi(
+                        x,
+                        speculative_broad_phase_inflation
+                            * speculative_step_bound);
+                });
+            }
+            update_forcing_term();
+            bool solve_success = compute_regularized_direction(
+                fx, gradient_free, hessian_free, direction_free,
+                regulariztion_coeff);
+            speculation.wait();
+            if (!solve_success) {
+                exit_reason = "regularization failed";
+                break;
+            }
 #endif
+            if (hessian_approximation == HessianApproximation::LAGGED
+                && !use_block_jacobi_pcg) {
+                lagged_iterations = 0; // The Hessian is freshly factorized
+            }
+        }
 
         ///////////////////////////////////////////////////////////////////
         // Line search over newton direction
@@ -227,6 +381,18 @@ OptimizationResults NewtonSolver::solve(const Eigen::VectorXd& x0)
 
         // check for newton termination
         if (iteration_number > 0 && converged()) {
+            if (can_refresh) {
+                // Confirm the convergence without the approximation
+                reset_hessian_reuse();
+                continue;
+            }
+            if (forcing_term > min_forcing_term) {
+                // A truncated iterative solve shortens the direction, which
+                // can pass the convergence check early
+                is_confirming_convergence = true;
+                num_inexact_convergence_checks++;
+                continue;
+            }
             exit_reason = "found a local optimum with newton dir";
             success = true;
             break;
@@ -235,14 +401,25 @@ OptimizationResults NewtonSolver::solve(const Eigen::VectorXd& x0)
         step_length = 1;
         bool found_newton_step =
             line_search(x, direction, fx, grad_direction, step_length);
+        if (speculative_broad_phase_inflation > 0) {
+            // The next direction is assumed to be of a similar length
+            speculative_step_bound =
+                problem_ptr->max_vertex_displacement(x, x + direction);
+        }
         ///////////////////////////////////////////////////////////////////
 
+        if (!found_newton_step && can_refresh) {
+            reset_hessian_reuse();
+            continue;
+        }
+
         ///////////////////////////////////////////////////////////////////
         // When newton direction fails, revert to gradient descent
         if (!found_newton_step) {
             // If I forced it to take a step when it should have converged
             if (iteration_number > 0) {
                 num_newton_ls_fails++;
+                solve_line_search_failures++;
                 spdlog::warn(
                     "solver={} iter={:d} failure=\"newton line-search\" "
                     "failsafe=\"gradient descent\"",
@@ -281,6 +458,7 @@ OptimizationResults NewtonSolver::solve(const Eigen::VectorXd& x0)
                     break;
                 }
                 num_grad_ls_fails++;
+                solve_line_search_failures++;
                 spdlog::error(
                     "solver={} iter={:d} failure=\"gradient line-search\" "
                     "failsafe=\"none\"",
@@ -291,7 +469,7 @@ OptimizationResults NewtonSolver::solve(const Eigen::VectorXd& x0)
         }
         ///////////////////////////////////////////////////////////////////
 
-        spdlog::debug(
+        RIGID_IPC_LOG_DEBUG(
             "solver={} iter={:d} step_length={:g}", name(), iteration_number,
             step_length);
 
@@ -300,15 +478,334 @@ OptimizationResults NewtonSolver::solve(const Eigen::VectorXd& x0)
         assert(!problem_ptr->has_collisions(x_prev, x));
         newton_iterations++; // Only count complete steps
 
+        if (lagged_iterations >= 0) {
+            // Refresh the factorization once it stops decreasing f enough
+            double sufficient_fx = fx
+                + Constants::LAGGED_HESSIAN_SUFFICIENT_DECREASE * step_length
+                    * grad_direction.dot(direction);
+            if (!found_newton_step
+                || ++lagged_iterations >= max_lagged_iterations
+                || cached_objective(x) > sufficient_fx) {
+                lagged_iterations = -1;
+            }
+        }
+
         post_step_update();
+        // The augmented Lagrangian update can change the free DoF
+        update_free_dof();
     } // end for loop
 
     spdlog::info(
         "solver={} action=END total_iter={:d} exit_reason=\"{}\"", name(),
         iteration_number, exit_reason);
 
-    return OptimizationResults(
-        x, problem_ptr->compute_objective(x), success, true, iteration_number);
+    if (time_budget > 0) {
+        std::chrono::duration<double> elapsed =
+            std::chrono::steady_clock::now() - solve_start_time;
+        max_time_budget_usage =
+            std::max(max_time_budget_usage, elapsed.count() / time_budget);
+    }
+
+    OptimizationResults results(
+        x, cached_objective(x), success, true, iteration_number);
+    results.num_line_search_failures = solve_line_search_failures;
+    results.earliest_toi = solve_earliest_toi;
+    return results;
+}
+
+bool NewtonSolver::is_speculating_broad_phase() const
+{
+    // The superset of the candidates could reorder the narrow phase
+    return speculative_broad_phase_inflation > 0
+        && std::isfinite(speculative_step_bound) && speculative_step_bound > 0
+        && problem_ptr->is_ccd_aligned_with_newton_update()
+        && !problem_ptr->is_deterministic();
+}
+
+bool NewtonSolver::is_time_budget_exceeded() const
+{
+    if (time_budget <= 0) {
+        return false;
+    }
+    std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - solve_start_time;
+    return elapsed.count() >= time_budget;
+}
+
+double NewtonSolver::cached_objective(const Eigen::VectorXd& x)
+{
+    for (auto it = objective_cache.begin(); it != objective_cache.end(); ++it) {
+        if (it->first.size() == x.size() && it->first == x) {
+            // Move to the front as the most recently used
+            objective_cache.splice(
+                objective_cache.begin(), objective_cache, it);
+            num_fx_cache_hits++;
+            return objective_cache.front().second;
+        }
+    }
+
+    double fx = problem_ptr->compute_objective(x);
+    num_fx++; // Count the number of objective computations
+
+    objective_cache.emplace_front(x, fx);
+    if (objective_cache.size() > Constants::LINE_SEARCH_OBJECTIVE_CACHE_SIZE) {
+        objective_cache.pop_back();
+    }
+    return fx;
+}
+
+void NewtonSolver::cached_objectives(
+    const std::vector<Eigen::VectorXd>& xs, std::vector<double>& fxs)
+{
+    fxs.resize(xs.size());
+
+    // Only evaluate the points missing from the cache
+    std::vector<Eigen::VectorXd> uncached_xs;
+    std::vector<size_t> uncached_ids;
+    for (size_t i = 0; i < xs.size(); i++) {
+        auto it = std::find_if(
+            objective_cache.begin(), objective_cache.end(),
+            [&](const auto& entry) {
+                return entry.first.size() == xs[i].size()
+                    && entry.first == xs[i];
+            });
+        if (it != objective_cache.end()) {
+            fxs[i] = it->second;
+            num_fx_cache_hits++;
+        } else {
+            uncached_xs.push_back(xs[i]);
+            uncached_ids.push_back(i);
+        }
+    }
+
+    std::vector<double> uncached_fxs;
+    problem_ptr->compute_objectives(uncached_xs, uncached_fxs);
+    num_fx += uncached_xs.size(); // Count the number of objective computations
+
+    for (size_t i = 0; i < uncached_xs.size(); i++) {
+        fxs[uncached_ids[i]] = uncached_fxs[i];
+        objective_cache.emplace_front(uncached_xs[i], uncached_fxs[i]);
+    }
+    while (objective_cache.size()
+           > Constants::LINE_SEARCH_OBJECTIVE_CACHE_SIZE) {
+        objective_cache.pop_back();
+    }
+}
+
+bool NewtonSolver::reads_lower_triangle() const
+{
+#ifdef RIGID_IPC_WITH_CUDA
+    if (use_cuda_pcg) {
+        return false;
+    }
+#endif
+    if (use_block_jacobi_pcg || use_body_ordered_ldlt) {
+        return true;
+    }
+    // Eigen's simplicial factorizations only read the lower triangle
+    const std::string name = linear_solver_settings.value("name", "");
+    return !use_island_solve
+        && (name == "Eigen::SimplicialLDLT" || name == "Eigen::SimplicialLLT");
+}
+
+Eigen::VectorXd NewtonSolver::hessian_product(
+    const Eigen::SparseMatrix<double>& hessian, const Eigen::VectorXd& x) const
+{
+    if (is_hessian_free_lower) {
+        return hessian.selfadjointView<Eigen::Lower>() * x;
+    }
+    return hessian * x;
+}
+
+double NewtonSolver::compute_free_objective(bool compute_hessian)
+{
+    double fx;
+    // Problems that can assemble the free DoF hessian skip the slice below
+    bool is_hessian_free_assembled = false;
+    if (compute_hessian) {
+        is_hessian_free_assembled = free_dof.size() != problem_ptr->num_vars()
+            && problem_ptr->compute_free_objective(
+                x, free_dof, full_to_free_dof, fx, gradient, hessian_free);
+        if (!is_hessian_free_assembled) {
+            fx = problem_ptr->compute_objective(x, gradient, hessian);
+        }
+        num_hessian_fx++;
+    } else {
+        fx = problem_ptr->compute_objective(x, gradient);
+    }
+    num_fx++;
+    num_grad_fx++;
+
+    // Remove rows and cols of fixed DoF
+    if (free_dof.size() == gradient.size()) {
+        // Nothing to remove, so avoid copying the Hessian
+        gradient_free.swap(gradient);
+        if (compute_hessian) {
+            hessian_free.swap(hessian);
+        }
+    } else {
+        gradient_free.resize(free_dof.size());
+        for (int i = 0; i < free_dof.size(); i++) {
+            gradient_free(i) = gradient(free_dof(i));
+        }
+        if (compute_hessian && !is_hessian_free_assembled) {
+            hessian.makeCompressed();
+            slice_free_dof(hessian, free_dof, full_to_free_dof, hessian_free);
+        }
+    }
+    if (compute_hessian) {
+        is_hessian_free_lower = problem_ptr->is_hessian_lower_triangular();
+        if (is_hessian_free_lower && !reads_lower_triangle()) {
+            Eigen::SparseMatrix<double> full =
+                hessian_free.selfadjointView<Eigen::Lower>();
+            hessian_free.swap(full);
+            is_hessian_free_lower = false;
+        }
+    }
+    if (use_block_jacobi_pcg || use_body_ordered_ldlt) {
+        free_dof_block_ids =
+            free_dof.array() / problem_ptr->num_vars_per_block();
+    }
+    return fx;
+}
+
+bool NewtonSolver::compute_approximate_direction()
+{
+    switch (hessian_approximation) {
+    case HessianApproximation::LAGGED: {
+        if (lagged_iterations < 0) {
+            return false;
+        }
+        // Back-substitute with the last factorization
+        bool solve_success;
+        if (use_body_ordered_ldlt) {
+            solve_success =
+                body_ldlt_solver.solve(-gradient_free, direction_free);
+        } else if (island_solver.num_groups() > 1) {
+            solve_success =
+                island_solver.solve_factorized(-gradient_free, direction_free);
+        } else {
+            direction_free = Eigen::VectorXd::Zero(gradient_free.size());
+            linear_solver->solve(-gradient_free, direction_free);
+            nlohmann::json info;
+            linear_solver->getInfo(info);
+            solve_success = !info.contains("solver_info")
+                || info["solver_info"] == "Success";
+        }
+        if (!solve_success || !direction_free.allFinite()
+            || gradient_free.dot(direction_free) >= 0) {
+            RIGID_IPC_LOG_DEBUG(
+                "solver={} iter={:d} msg=\"lagged direction failed; "
+                "refreshing the hessian\"",
+                name(), iteration_number);
+            lagged_iterations = -1;
+            return false;
+        }
+        num_lagged_directions++;
+        return true;
+    }
+    case HessianApproximation::LBFGS: {
+        Eigen::VectorXd x_free(free_dof.size());
+        for (int i = 0; i < free_dof.size(); i++) {
+            x_free(i) = x(free_dof(i));
+        }
+        if (lbfgs_x_free.size() == x_free.size()) {
+            lbfgs.update(
+                x_free - lbfgs_x_free, gradient_free - lbfgs_gradient_free);
+        }
+        lbfgs_x_free = x_free;
+        lbfgs_gradient_free = gradient_free;
+
+        // The mass matrix is the Hessian of the (scaled) inertial term
+        const Eigen::VectorXd mass = problem_ptr->mass_matrix().diagonal();
+        Eigen::VectorXd initial_hessian(free_dof.size());
+        for (int i = 0; i < free_dof.size(); i++) {
+            initial_hessian(i) = mass(free_dof(i)) > 0
+                ? mass(free_dof(i)) / problem_ptr->average_mass()
+                : 1.0;
+        }
+
+        direction_free =
+            -lbfgs.apply_inverse_hessian(gradient_free, initial_hessian);
+        if (!direction_free.allFinite()
+            || gradient_free.dot(direction_free) >= 0) {
+            lbfgs.clear();
+            direction_free = -gradient_free.cwiseQuotient(initial_hessian);
+        }
+        num_lagged_directions++;
+        return true;
+    }
+    default:
+        return false;
+    }
+}
+
+void NewtonSolver::reset_hessian_reuse()
+{
+    lagged_iterations = -1;
+    lbfgs.clear();
+    lbfgs_x_free.resize(0);
+    lbfgs_gradient_free.resize(0);
+}
+
+void NewtonSolver::update_free_dof()
+{
+    Eigen::VectorXi new_free_dof = problem_ptr->free_dof();
+    if (new_free_dof.size() == free_dof.size()
+        && full_to_free_dof.size() == problem_ptr->num_vars()
+        && new_free_dof == free_dof) {
+        return;
+    }
+    free_dof = new_free_dof;
+    reset_hessian_reuse(); // The factorization is of the old free DoF
+    full_to_free_dof.assign(problem_ptr->num_vars(), -1);
+    for (int i = 0; i < free_dof.size(); i++) {
+        full_to_free_dof[free_dof(i)] = i;
+    }
+}
+
+void slice_free_dof(
+    const Eigen::SparseMatrix<double>& A,
+    const Eigen::VectorXi& free_dof,
+    const std::vector<int>& full_to_free_dof,
+    Eigen::SparseMatrix<double>& A_free)
+{
+    assert(A.isCompressed());
+    assert(full_to_free_dof.size() == A.rows());
+    const int n = free_dof.size();
+
+    // Count the entries to keep so the storage is sized once
+    int nnz = 0;
+    for (int k = 0; k < n; k++) {
+        for (int p = A.outerIndexPtr()[free_dof(k)];
+             p < A.outerIndexPtr()[free_dof(k) + 1]; p++) {
+            nnz += full_to_free_dof[A.innerIndexPtr()[p]] >= 0;
+        }
+    }
+
+    // Resizing keeps the allocated storage of A_free
+    A_free.resize(n, n);
+    A_free.resizeNonZeros(nnz);
+    int* outer = A_free.outerIndexPtr();
+    int* inner = A_free.innerIndexPtr();
+    double* values = A_free.valuePtr();
+
+    // The remap is increasing, so inner indices stay sorted
+    int i = 0;
+    for (int k = 0; k < n; k++) {
+        outer[k] = i;
+        for (int p = A.outerIndexPtr()[free_dof(k)];
+             p < A.outerIndexPtr()[free_dof(k) + 1]; p++) {
+            int r = full_to_free_dof[A.innerIndexPtr()[p]];
+            if (r >= 0) {
+                inner[i] = r;
+                values[i] = A.valuePtr()[p];
+                i++;
+            }
+        }
+    }
+    outer[n] = i;
+    assert(i == nnz);
 }
 
 bool NewtonSolver::line_search(
@@ -320,6 +817,7 @@ bool NewtonSolver::line_search(
 {
     NAMED_PROFILE_POINT("NewtonSolver::line_search", LINE_SEARCH);
     PROFILE_START(LINE_SEARCH);
+    TRACE_SCOPE("line_search");
 
     bool success = false;
     int num_it = 0;
@@ -340,6 +838,13 @@ bool NewtonSolver::line_search(
         max_step_size =
             std::min(problem_ptr->compute_earliest_toi(x, x + dir), 1.0);
         step_length = std::min(step_length, max_step_size);
+        // Stop short of the impact where the barrier blows up
+        if (line_search_interpolation && max_step_size < 1) {
+            step_length = std::min(
+                step_length,
+                Constants::LINE_SEARCH_TOI_SAFETY_FACTOR * max_step_size);
+        }
+        solve_earliest_toi = std::min(solve_earliest_toi, max_step_size);
     }
     // #ifndef NDEBUG
     // while (problem_ptr->has_collisions(x, x + step_length * dir)) {
@@ -356,10 +861,62 @@ bool NewtonSolver::line_search(
             name(), iteration_number, step_length, lower_bound);
     }
 
+    // Stop early when the trials or the time budget run out
+    const auto can_continue = [&]() {
+        return (max_line_search_iterations < 0
+                || num_it < max_line_search_iterations)
+            && !is_time_budget_exceeded();
+    };
+
     double fxi = std::numeric_limits<double>::infinity();
-    while (std::isfinite(lower_bound) && step_length >= lower_bound) {
+    while (line_search_batch_size > 1 && std::isfinite(lower_bound)
+           && step_length >= lower_bound && can_continue()) {
+        // Speculatively evaluate α, α/2, α/4, ... concurrently
+        std::vector<double> step_lengths;
+        std::vector<Eigen::VectorXd> xs;
+        for (double alpha = step_length;
+             int(step_lengths.size()) < line_search_batch_size
+             && alpha >= lower_bound
+             && (max_line_search_iterations < 0
+                 || num_it + int(step_lengths.size())
+                     < max_line_search_iterations);
+             alpha /= 2.0) {
+            step_lengths.push_back(alpha);
+            xs.push_back(x + alpha * dir);
+        }
+        std::vector<double> fxs;
+        cached_objectives(xs, fxs);
+
+        // Take the largest step length that decreases the objective
+        for (size_t i = 0; i < step_lengths.size(); i++) {
+            num_it++;        // Count the number of iterations
+            ls_iterations++; // Count the gloabal number of iterations
+            StepMetrics::add_count(StepMetrics::LINE_SEARCH_TRIALS);
+            step_length = step_lengths[i];
+            if (fxs[i] < fx
+                && (is_ccd_aligned_with_newton_update
+                    || !problem_ptr->has_collisions(x, xs[i]))) {
+                fxi = fxs[i];
+                success = true;
+                break;
+            }
+        }
+        if (success) {
+            break; // while loop
+        }
+
+        // Try again with a smaller step_length
+        fxi = fxs.back();
+        step_length /= 2.0;
+    }
+    // Previous trial of the interpolating backtracking (none yet)
+    const double grad_dot_dir = grad_fx.dot(dir);
+    double prev_step_length = -1, prev_fxi = fx;
+    while (line_search_batch_size <= 1 && std::isfinite(lower_bound)
+           && step_length >= lower_bound && can_continue()) {
         num_it++;        // Count the number of iterations
         ls_iterations++; // Count the gloabal number of iterations
+        StepMetrics::add_count(StepMetrics::LINE_SEARCH_TRIALS);
 
         // Compute the next variable
         Eigen::VectorXd xi = x + step_length * dir;
@@ -367,10 +924,11 @@ bool NewtonSolver::line_search(
         // NOTE: We do not need to check for collisions because we filtered
         // the step length.
         // Check for collisions between newton updates
+        bool is_evaluated = false;
         if (is_ccd_aligned_with_newton_update
             || !problem_ptr->has_collisions(x, xi)) {
-            fxi = problem_ptr->compute_objective(xi);
-            num_fx++; // Count the number of objective computations
+            fxi = cached_objective(xi);
+            is_evaluated = true;
             if (fxi < fx) {
                 success = true;
                 break; // while loop
@@ -378,7 +936,16 @@ bool NewtonSolver::line_search(
         }
 
         // Try again with a smaller step_length
-        step_length /= 2.0;
+        if (line_search_interpolation && is_evaluated) {
+            const double next_step_length = interpolate_step_length(
+                fx, grad_dot_dir, step_length, fxi, prev_step_length,
+                prev_fxi);
+            prev_step_length = step_length;
+            prev_fxi = fxi;
+            step_length = next_step_length;
+        } else {
+            step_length /= 2.0;
+        }
     }
 
     PROFILE_MESSAGE(
@@ -402,7 +969,6 @@ bool NewtonSolver::line_search(
                 x, dir,
                 [&](const Eigen::VectorXd& x, Eigen::VectorXd& grad) {
                     double fx = problem_ptr->compute_objective(x, grad);
-                    Eigen::VectorXi free_dof = problem_ptr->free_dof();
                     Eigen::VectorXd grad_free;
                     igl::slice(grad, free_dof, grad_free);
                     grad.setZero();
@@ -435,6 +1001,40 @@ double norm_Linf(const Eigen::SparseMatrix<double>& M)
     return norm;
 }
 
+bool NewtonSolver::is_linear_solver_iterative() const
+{
+    if (use_block_jacobi_pcg) {
+        return true;
+    }
+    if (use_body_ordered_ldlt) {
+        return false;
+    }
+    const std::string name = linear_solver_settings.value("name", "");
+    return name.find("AMGCL") != std::string::npos
+        || name.find("Hypre") != std::string::npos;
+}
+
+void NewtonSolver::update_forcing_term()
+{
+    if (!inexact_newton || !is_linear_solver_iterative()
+        || is_confirming_convergence) {
+        forcing_term = 0;
+        is_confirming_convergence = false;
+        return;
+    }
+    const double gradient_norm = gradient_free.norm();
+    forcing_term = eisenstat_walker_forcing_term(
+        gradient_norm, prev_forcing_gradient_norm, forcing_term,
+        min_forcing_term);
+    prev_forcing_gradient_norm = gradient_norm;
+    if (forcing_term > min_forcing_term) {
+        num_inexact_directions++;
+    }
+    RIGID_IPC_LOG_DEBUG(
+        "solver={} iter={:d} forcing_term={:g} gradient_norm={:g}", name(),
+        iteration_number, forcing_term, gradient_norm);
+}
+
 bool NewtonSolver::compute_regularized_direction(
     double& fx,
     Eigen::VectorXd& gradient,
@@ -442,25 +1042,26 @@ bool NewtonSolver::compute_regularized_direction(
     Eigen::VectorXd& direction,
     double& coeff)
 {
+    // The regularization shifts the diagonal in place, so retries keep the
+    // sparsity pattern (and its symbolic analysis) and only refactorize.
+    Eigen::SparseMatrix<double> regularized_hessian;
+    double applied_coeff = 0; // Shift added to regularized_hessian
+
     bool success = false;
     while (!success) {
-        double regularized_fx = fx;
-        Eigen::VectorXd regularized_gradient = gradient;
-        Eigen::SparseMatrix<double> regularized_hessian = hessian;
-
+        const Eigen::SparseMatrix<double>* H = &hessian;
         if (coeff > 0) {
-            // regularized_fx += coeff / 2 * (x - x_prev).squaredNorm();
-            // regularized_gradient += coeff * (x - x_prev);
-            Eigen::SparseMatrix<double> I(hessian.rows(), hessian.cols());
-            I.setIdentity();
-            regularized_hessian += coeff * I;
+            if (applied_coeff == 0) {
+                regularized_hessian = hessian;
+            }
+            add_to_diagonal(regularized_hessian, coeff - applied_coeff);
+            applied_coeff = coeff;
+            H = &regularized_hessian;
             regularization_iterations++;
         }
 
-        success = compute_direction(
-            regularized_gradient, regularized_hessian, direction,
-            /*make_psd=*/false);
-        success = success && regularized_gradient.dot(direction) <= 0;
+        success = compute_direction(gradient, *H, direction, false);
+        success = success && gradient.dot(direction) <= 0;
 
         // Update coefficient adaptivly when the solve fails
         if (success) {
@@ -468,11 +1069,17 @@ bool NewtonSolver::compute_regularized_direction(
             if (coeff < 1e-8) {
                 coeff = 0;
             }
-            fx = regularized_fx;
-            gradient = regularized_gradient;
-            hessian = regularized_hessian;
+            if (applied_coeff > 0) {
+                hessian.swap(regularized_hessian);
+            }
         } else {
-            coeff = std::max(2 * coeff, 1e-8);
+            // The Gershgorin bound makes the Hessian diagonally dominant,
+            // which is usually enough on the first retry.
+            coeff = coeff > 0
+                ? 2 * coeff
+                : std::max(
+                    gershgorin_diagonal_shift(hessian, is_hessian_free_lower),
+                    1e-8);
             if (!std::isfinite(coeff)) {
                 spdlog::error(
                     "solver={} iter={:d} failure=\"regularization failed "
@@ -483,7 +1090,7 @@ bool NewtonSolver::compute_regularized_direction(
             spdlog::warn(
                 "solver={} iter={:d} failure=\"solve failed (∇f⋅Δx={:g}, "
                 "||H||_∞={:g}); increasing regularization coeff={:g}\"",
-                name(), iteration_number, gradient_free.dot(direction_free),
+                name(), iteration_number, gradient.dot(direction),
                 norm_Linf(hessian), coeff);
         }
     }
@@ -498,6 +1105,9 @@ bool NewtonSolver::compute_direction(
 {
     PROFILE_POINT("NewtonSolver::compute_direction:linear_solve");
     PROFILE_START();
+    TRACE_SCOPE("linear_solve");
+    StepMetrics::add_count(StepMetrics::LINEAR_SOLVES);
+    auto linear_solve_start = std::chrono::steady_clock::now();
 
     // Check if the hessian is positive semi-definite.
     // Eigen::LLT<Eigen::MatrixXd> LLT_H((Eigen::MatrixXd(hessian)));
@@ -512,49 +1122,149 @@ bool NewtonSolver::compute_direction(
     // Return true if the solve was successful.
     bool solve_success = false;
 
-    // if (hessian.rows() <= 1200) { // <= 200 bodies
-    //     Eigen::MatrixXd dense_hessian(hessian);
-    //     direction = dense_hessian.ldlt().solve(-gradient);
-    //     solve_success = true;
-    // } else {
-    linear_solver->analyzePattern(hessian, hessian.rows());
-    linear_solver->factorize(hessian);
-    nlohmann::json info;
-    linear_solver->getInfo(info);
-    // TODO: This check only works for direct Eigen solvers
-    if (!info.contains("solver_info") || info["solver_info"] == "Success") {
-        // TODO: Do we have a better initial guess for iterative
-        // solvers?
+    if (use_block_jacobi_pcg) {
+        // Only products with the Hessian are needed, so nothing is factorized
+        const Eigen::VectorXi block_ids =
+            free_dof_block_ids.size() == hessian.rows() ? free_dof_block_ids
+                                                        : Eigen::VectorXi();
+        const BlockJacobiPCG* pcg = &pcg_solver;
         direction = Eigen::VectorXd::Zero(gradient.size());
-        linear_solver->solve(-gradient, direction);
-        linear_solver->getInfo(info);
-        if (!info.contains("solver_info") || info["solver_info"] == "Success") {
-            solve_success = true;
-        } else {
+        pcg_solver.tolerance = linear_solve_tolerance();
+#ifdef RIGID_IPC_WITH_CUDA
+        if (use_cuda_pcg) {
+            // The Hessian stays on the device while its pattern is unchanged
+            pcg = &cuda_pcg_solver;
+            cuda_pcg_solver.tolerance = pcg_solver.tolerance;
+            solve_success = cuda_pcg_solver.compute(hessian, block_ids)
+                && cuda_pcg_solver.solve(-gradient, direction);
+        } else
+#endif
+        {
+            pcg_solver.compute(hessian, block_ids, is_hessian_free_lower);
+            solve_success = pcg_solver.solve(-gradient, direction);
+        }
+        pcg_iterations += pcg->num_iterations;
+        linear_solver_iterations += pcg->num_iterations;
+        if (!solve_success) {
             spdlog::warn(
-                "solver={} iter={:d} failure=\"sparse solve for newton "
-                "direction\" failsafe=\"gradient descent\"",
+                "solver={} iter={:d} failure=\"PCG solve for newton "
+                "direction (iterations={:d} residual={:g})\" "
+                "failsafe=\"gradient descent\"",
+                name(), iteration_number, pcg->num_iterations, pcg->residual);
+        }
+    } else if (use_body_ordered_ldlt) {
+        // The ordering of the bodies is kept across patterns, so new
+        // contacts only redo the symbolic analysis
+        if (has_sparsity_pattern_changed(hessian)) {
+            body_ldlt_solver.analyze_pattern(
+                hessian,
+                free_dof_block_ids.size() == hessian.rows()
+                    ? free_dof_block_ids
+                    : Eigen::VectorXi());
+            num_symbolic_factorizations++;
+        }
+        solve_success = body_ldlt_solver.factorize(hessian)
+            && body_ldlt_solver.solve(-gradient, direction);
+        if (!solve_success) {
+            spdlog::warn(
+                "solver={} iter={:d} failure=\"body ordered LDLT solve for "
+                "newton direction\" failsafe=\"gradient descent\"",
                 name(), iteration_number);
         }
     } else {
-        spdlog::warn(
-            "solver={} iter={:d} failure=\"sparse decomposition of the "
-            "hessian\" failsafe=\"gradient descent\"",
-            name(), iteration_number);
+        // if (hessian.rows() <= 1200) { // <= 200 bodies
+        //     Eigen::MatrixXd dense_hessian(hessian);
+        //     direction = dense_hessian.ldlt().solve(-gradient);
+        //     solve_success = true;
+        // } else {
+        // The symbolic analysis only depends on the sparsity pattern, which
+        // only changes with the constraint set.
+        if (has_sparsity_pattern_changed(hessian)) {
+            if (use_island_solve) {
+                island_solver.analyze_pattern(
+                    hessian, linear_solver_settings,
+                    tbb::this_task_arena::max_concurrency());
+            }
+            // A single island is solved as a whole
+            if (island_solver.num_groups() <= 1) {
+                linear_solver->analyzePattern(hessian, hessian.rows());
+            }
+            num_symbolic_factorizations++;
+        }
+        if (island_solver.num_groups() > 1) {
+            // Independent islands are factorized and solved in parallel
+            solve_success = island_solver.solve(hessian, -gradient, direction);
+            if (!solve_success) {
+                spdlog::warn(
+                    "solver={} iter={:d} failure=\"sparse solve of the "
+                    "hessian islands\" failsafe=\"gradient descent\"",
+                    name(), iteration_number);
+            }
+        } else {
+            linear_solver->factorize(hessian);
+            nlohmann::json info;
+            linear_solver->getInfo(info);
+            // TODO: This check only works for direct Eigen solvers
+            if (!info.contains("solver_info")
+                || info["solver_info"] == "Success") {
+                // TODO: Do we have a better initial guess for iterative
+                // solvers?
+                direction = Eigen::VectorXd::Zero(gradient.size());
+                if (inexact_newton && is_linear_solver_iterative()) {
+                    // Keys of the Hypre and AMGCL wrappers
+                    const double tol = linear_solve_tolerance();
+                    linear_solver->setParameters(
+                        { { "conv_tol", tol }, { "tolerance", tol } });
+                }
+                linear_solver->solve(-gradient, direction);
+                linear_solver->getInfo(info);
+                if (info.contains("num_iterations")) {
+                    linear_solver_iterations +=
+                        info["num_iterations"].get<size_t>();
+                }
+                if (!info.contains("solver_info")
+                    || info["solver_info"] == "Success") {
+                    solve_success = true;
+                } else {
+                    spdlog::warn(
+                        "solver={} iter={:d} failure=\"sparse solve for "
+                        "newton direction\" failsafe=\"gradient descent\"",
+                        name(), iteration_number);
+                }
+            } else {
+                spdlog::warn(
+                    "solver={} iter={:d} failure=\"sparse decomposition of "
+                    "the hessian\" failsafe=\"gradient descent\"",
+                    name(), iteration_number);
+            }
+        }
+        // }
     }
-    // }
 
+    StepMetrics::add_time(
+        StepMetrics::LINEAR_SOLVE,
+        std::chrono::steady_clock::now() - linear_solve_start);
     PROFILE_END();
 
     // Check solve residual
     if (solve_success) {
-        double solve_residual = (hessian * direction + gradient).norm();
-        if (solve_residual > 1e-8) {
+        double solve_residual =
+            (hessian_product(hessian, direction) + gradient).norm();
+        const double gradient_norm = gradient.norm();
+        if (gradient_norm > 0) {
+            max_linear_solve_residual = std::max(
+                max_linear_solve_residual, solve_residual / gradient_norm);
+        }
+        // Inexact directions are only as accurate as their forcing term
+        // (with some slack for the residuals updated by recurrence)
+        const double max_residual =
+            std::max(1e-8, 2 * forcing_term * gradient_norm);
+        if (solve_residual > max_residual) {
             spdlog::warn(
                 "solver={} iter={:d} "
-                "failure=\"linear solve residual ({:g}) > 1e-8; "
+                "failure=\"linear solve residual ({:g}) > {:g}; "
                 "||g||_{{L^∞}}={:g} ||H||_{{L^∞}}={:g}\"",
-                name(), iteration_number, solve_residual,
+                name(), iteration_number, solve_residual, max_residual,
                 gradient.lpNorm<Eigen::Infinity>(), norm_Linf(hessian));
         }
         solve_success = std::isfinite(solve_residual);
@@ -570,7 +1280,8 @@ bool NewtonSolver::compute_direction(
         // diagonal (positive definite). We do this by adding μI to the
         // hessian. This can result in doing a step of gradient descent.
         Eigen::SparseMatrix<double> psd_hessian = hessian;
-        double mu = make_matrix_positive_definite(psd_hessian);
+        double mu =
+            make_matrix_positive_definite(psd_hessian, is_hessian_free_lower);
         spdlog::warn(
             "solver={} iter={:d} failure=\"newton direction not descent "
             "direction\" failsafe=\"H += μI\" μ={:g}",
@@ -591,13 +1302,32 @@ bool NewtonSolver::compute_direction(
     return solve_success;
 }
 
-// Make the matrix positive definite (x^T A x > 0).
-double make_matrix_positive_definite(Eigen::SparseMatrix<double>& A)
+bool NewtonSolver::has_sparsity_pattern_changed(
+    const Eigen::SparseMatrix<double>& A)
+{
+    if (!A.isCompressed()) {
+        analyzed_outer_indices.clear();
+        analyzed_inner_indices.clear();
+        return true;
+    }
+    const int* outer = A.outerIndexPtr();
+    const int* inner = A.innerIndexPtr();
+    if (analyzed_outer_indices.size() == A.outerSize() + 1
+        && analyzed_inner_indices.size() == A.nonZeros()
+        && std::equal(outer, outer + A.outerSize() + 1,
+                      analyzed_outer_indices.begin())
+        && std::equal(inner, inner + A.nonZeros(),
+                      analyzed_inner_indices.begin())) {
+        return false;
+    }
+    analyzed_outer_indices.assign(outer, outer + A.outerSize() + 1);
+    analyzed_inner_indices.assign(inner, inner + A.nonZeros());
+    return true;
+}
+
+double gershgorin_diagonal_shift(
+    const Eigen::SparseMatrix<double>& A, bool is_lower_triangular)
 {
-    // Conservative way of making A PSD by making it diagonally dominant
-    // with all positive diagonal entries
-    Eigen::SparseMatrix<double> I(A.rows(), A.rows());
-    I.setIdentity();
     // Entries along the diagonal of A
     Eigen::VectorXd diag = Eigen::VectorXd::Zero(A.rows());
     // Sum of columns per row not including the diagonal entry
@@ -609,14 +1339,36 @@ double make_matrix_positive_definite(Eigen::SparseMatrix<double>& A)
         for (Eigen::SparseMatrix<double>::InnerIterator it(A, k); it; ++it) {
             if (it.row() == it.col()) { // Diagonal element
                 diag(it.row()) = it.value();
-            } else { // Non-diagonal element
+            } else if (!is_lower_triangular) { // Non-diagonal element
                 sum_row(it.row()) += abs(it.value());
+            } else if (it.row() > it.col()) { // Mirrored in the upper part
+                sum_row(it.row()) += abs(it.value());
+                sum_row(it.col()) += abs(it.value());
             }
         }
     }
     // Take max to ensure all diagonal elements are dominant
-    double mu = std::max((sum_row - diag).maxCoeff(), 0.0);
-    A += mu * I;
+    return A.rows() > 0 ? std::max((sum_row - diag).maxCoeff(), 0.0) : 0.0;
+}
+
+void add_to_diagonal(Eigen::SparseMatrix<double>& A, double mu)
+{
+    for (int i = 0; i < std::min(A.rows(), A.cols()); i++) {
+        A.coeffRef(i, i) += mu; // Only inserts structurally zero entries
+    }
+    if (!A.isCompressed()) {
+        A.makeCompressed();
+    }
+}
+
+// Make the matrix positive definite (x^T A x > 0).
+double make_matrix_positive_definite(
+    Eigen::SparseMatrix<double>& A, bool is_lower_triangular)
+{
+    // Conservative way of making A PSD by making it diagonally dominant
+    // with all positive diagonal entries
+    double mu = gershgorin_diagonal_shift(A, is_lower_triangular);
+    add_to_diagonal(A, mu);
     return mu;
 }
 
@@ -625,7 +1377,76 @@ void NewtonSolver::post_step_update()
     if (is_energy_converged
         && !problem_ptr->are_equality_constraints_satisfied(x)) {
         problem_ptr->update_augmented_lagrangian(x);
+        // The augmented Lagrangian changed the objective
+        clear_objective_cache();
+        reset_hessian_reuse();
+    }
+}
+
+double eisenstat_walker_forcing_term(
+    double gradient_norm,
+    double prev_gradient_norm,
+    double prev_forcing_term,
+    double min_forcing_term,
+    double max_forcing_term)
+{
+    if (prev_gradient_norm <= 0) {
+        return std::max(max_forcing_term, min_forcing_term);
+    }
+    const double gamma = Constants::INEXACT_NEWTON_FORCING_SCALE;
+    const double alpha = Constants::INEXACT_NEWTON_FORCING_EXPONENT;
+    double eta = gamma * std::pow(gradient_norm / prev_gradient_norm, alpha);
+    // Safeguard against a forcing term that drops too fast because of one
+    // lucky iteration
+    const double safeguard = gamma * std::pow(prev_forcing_term, alpha);
+    if (safeguard > 0.1) {
+        eta = std::max(eta, safeguard);
+    }
+    return std::max(std::min(eta, max_forcing_term), min_forcing_term);
+}
+
+// Safeguarded quadratic or cubic interpolation of the next step length.
+double interpolate_step_length(
+    double fx,
+    double grad_dot_dir,
+    double step_length,
+    double fxi,
+    double prev_step_length,
+    double prev_fxi)
+{
+    const double min_step_length =
+        Constants::LINE_SEARCH_INTERPOLATION_MIN_SCALE * step_length;
+    const double max_step_length =
+        Constants::LINE_SEARCH_INTERPOLATION_MAX_SCALE * step_length;
+    if (!std::isfinite(fxi) || !(grad_dot_dir < 0)) {
+        return step_length / 2.0;
+    }
+
+    double next_step_length;
+    const double r1 = fxi - fx - grad_dot_dir * step_length;
+    if (prev_step_length <= step_length || !std::isfinite(prev_fxi)) {
+        // Minimizer of the quadratic through f(0), f'(0), and f(α)
+        next_step_length =
+            -grad_dot_dir * step_length * step_length / (2 * r1);
+    } else {
+        // Minimizer of the cubic through f(0), f'(0), f(α), and f(α_prev)
+        const double a0 = prev_step_length, a1 = step_length;
+        const double r0 = prev_fxi - fx - grad_dot_dir * a0;
+        const double d = a0 * a0 * a1 * a1 * (a1 - a0);
+        const double a = (a0 * a0 * r1 - a1 * a1 * r0) / d;
+        const double b = (-a0 * a0 * a0 * r1 + a1 * a1 * a1 * r0) / d;
+        if (a == 0) {
+            next_step_length = -grad_dot_dir / (2 * b);
+        } else {
+            next_step_length =
+                (-b + sqrt(b * b - 3 * a * grad_dot_dir)) / (3 * a);
+        }
+    }
+
+    if (!std::isfinite(next_step_length)) {
+        return step_length / 2.0;
     }
+    return std::clamp(next_step_length, min_step_length, max_step_length);
 }
 
 // Log samples along the search direction.
@@ -1,9 +1,22 @@
 #pragma once
 
+#include <algorithm>
+#include <chrono>
+#include <list>
+#include <utility>
+#include <vector>
+
 #include <Eigen/Core>
 #include <polysolve/LinearSolver.hpp>
 
 #include <constants.hpp>
+#include <solvers/block_jacobi_pcg.hpp>
+#include <solvers/body_ordered_ldlt.hpp>
+#ifdef RIGID_IPC_WITH_CUDA
+#include <solvers/cuda_pcg.hpp>
+#endif
+#include <solvers/island_linear_solver.hpp>
+#include <solvers/lbfgs.hpp>
 #include <solvers/optimization_solver.hpp>
 #include <utils/not_implemented_error.hpp>
 
@@ -17,6 +30,19 @@ enum ConvergenceCriteria {
 NLOHMANN_JSON_SERIALIZE_ENUM(
     ConvergenceCriteria, { { VELOCITY, "velocity" }, { ENERGY, "energy" } });
 
+/// @brief How the Hessian of each Newton iteration is obtained.
+enum class HessianApproximation {
+    EXACT,  ///< Assemble and factorize the Hessian every iteration
+    LAGGED, ///< Reuse the last factorization for a few iterations
+    LBFGS   ///< L-BFGS starting from the mass matrix (no Hessian)
+};
+
+NLOHMANN_JSON_SERIALIZE_ENUM(
+    HessianApproximation,
+    { { HessianApproximation::EXACT, "exact" },
+      { HessianApproximation::LAGGED, "lagged" },
+      { HessianApproximation::LBFGS, "lbfgs" } });
+
 class NewtonSolver : public virtual OptimizationSolver {
 public:
     NewtonSolver();
@@ -105,6 +131,16 @@ protected:
         const Eigen::VectorXd& grad_fx,
         double& step_length);
 
+    /// @brief Compute f(x) reusing a recently cached value at the same x.
+    double cached_objective(const Eigen::VectorXd& x);
+
+    /// @brief Compute f(x) of each x concurrently reusing cached values.
+    void cached_objectives(
+        const std::vector<Eigen::VectorXd>& xs, std::vector<double>& fxs);
+
+    /// @brief Drop the cached objective values (e.g., when f changes).
+    void clear_objective_cache() { objective_cache.clear(); }
+
     virtual double line_search_lower_bound() const
     {
         return m_line_search_lower_bound;
@@ -117,23 +153,152 @@ protected:
     ConvergenceCriteria convergence_criteria;
 
     double m_line_search_lower_bound; ///< @brief Line search lower bound
+    /// @brief Number of step lengths evaluated concurrently in the line
+    /// search (1 halves the step sequentially).
+    int line_search_batch_size = 1;
+    /// @brief Maximum step lengths tried per line search (negative for no
+    /// limit).
+    int max_line_search_iterations = -1;
+    /// @brief Start the line search just before the earliest time of impact
+    /// and backtrack by quadratic/cubic interpolation instead of halving.
+    bool line_search_interpolation = false;
+    /// @brief Wall-clock budget of a solve in seconds (non-positive for no
+    /// limit). When it runs out, the current iterate, which is always
+    /// intersection free, is returned.
+    double time_budget = 0;
+
+    /// @brief Inflation of the last direction's longest vertex displacement
+    /// that bounds the next step, whose CCD candidates are detected
+    /// concurrently with the linear solve (non-positive disables it).
+    double speculative_broad_phase_inflation = 0;
+    /// @brief Longest vertex displacement of the last Newton direction (-1
+    /// if unknown).
+    double speculative_step_bound = -1;
+
+    /// @brief Solve the Newton systems of iterative linear solvers only to
+    /// the relative residual of Eisenstat–Walker forcing terms.
+    bool inexact_newton = false;
+    /// @brief Relative residual tolerance of the linear solver settings
+    /// (the smallest forcing term).
+    double min_forcing_term = 1e-10;
+    /// @brief Forcing term of the current direction (0 if exact).
+    double forcing_term = 0;
+    /// @brief Gradient norm of the last inexact direction (negative if
+    /// there is none in the current solve).
+    double prev_forcing_gradient_norm = -1;
+    /// @brief Solve the next direction to min_forcing_term (e.g., to confirm
+    /// a convergence found with an inexact direction).
+    bool is_confirming_convergence = false;
+
+    /// @brief Is the Newton system solved iteratively?
+    bool is_linear_solver_iterative() const;
+
+    /// @brief Pick the forcing term of the next direction from the current
+    /// gradient.
+    void update_forcing_term();
+
+    /// @brief Relative residual tolerance of the next linear solve.
+    double linear_solve_tolerance() const
+    {
+        return std::max(forcing_term, min_forcing_term);
+    }
+
+    /// @brief Check if the time budget of the current solve ran out.
+    bool is_time_budget_exceeded() const;
+
+    /// @brief Should the CCD candidates be detected during the linear solve?
+    bool is_speculating_broad_phase() const;
 
     double energy_conv_tol;        ///< @brief Energy convergence tolerance
     double velocity_conv_tol;      ///< @brief Velocity convergence tolerance
     bool is_velocity_conv_tol_abs; ///< @brief Absolute velocity tol
     bool is_energy_converged;
 
+    /// @brief Update the cached free DoF (and their remap) from the problem.
+    void update_free_dof();
+
+    /// @brief Evaluate f(x) and the free DoF gradient (and Hessian).
+    double compute_free_objective(bool compute_hessian);
+
+    /// @brief Can the linear solver use a lower triangular Hessian as is?
+    bool reads_lower_triangle() const;
+
+    /// @brief Product of a Hessian stored like hessian_free with x.
+    Eigen::VectorXd hessian_product(
+        const Eigen::SparseMatrix<double>& hessian,
+        const Eigen::VectorXd& x) const;
+
+    /// @brief Solve for a direction without a new Hessian (lagged
+    /// factorization or L-BFGS).
+    /// @returns False if no approximate direction is available.
+    bool compute_approximate_direction();
+
+    /// @brief Forget the lagged factorization and L-BFGS history (e.g.,
+    /// when the objective or free DoF change).
+    void reset_hessian_reuse();
+
     // State variables
+    Eigen::VectorXi free_dof; ///< @brief Cached free DoF of the problem
+    /// @brief Index of each DoF in the free DoF (-1 if the DoF is fixed).
+    std::vector<int> full_to_free_dof;
     Eigen::VectorXd x, x_prev;
     Eigen::VectorXd gradient, gradient_free;
     Eigen::VectorXd direction, direction_free;
     Eigen::VectorXd grad_direction; ///< Gradient with fixed DoF set to zero
     Eigen::SparseMatrix<double> hessian, hessian_free;
+    /// @brief Only the lower triangle of hessian_free is meaningful.
+    bool is_hessian_free_lower = false;
 
     // Linear solver pointer
     std::unique_ptr<polysolve::LinearSolver> linear_solver;
     nlohmann::json linear_solver_settings;
 
+    /// @brief Use CG with a per-body block-Jacobi preconditioner instead of
+    /// factorizing the Hessian (linear_solver name "BlockJacobiPCG").
+    bool use_block_jacobi_pcg = false;
+    BlockJacobiPCG pcg_solver;
+#ifdef RIGID_IPC_WITH_CUDA
+    /// @brief Run the PCG on the GPU (linear_solver name "CudaPCG").
+    bool use_cuda_pcg = false;
+    CudaPCG cuda_pcg_solver;
+#endif
+    /// @brief Body (block) of each free DoF used by the preconditioner.
+    Eigen::VectorXi free_dof_block_ids;
+
+    /// @brief Factorize the Hessian with an ordering of the bodies kept
+    /// across time-steps (linear_solver name "BodyOrderedLDLT"), in single
+    /// precision with iterative refinement if "mixed_precision" is set.
+    bool use_body_ordered_ldlt = false;
+    BodyOrderedLDLT body_ldlt_solver;
+
+    /// @brief Factorize the independent islands of the Hessian in parallel
+    /// (linear_solver setting "solve_islands").
+    bool use_island_solve = false;
+    IslandLinearSolver island_solver;
+
+    HessianApproximation hessian_approximation = HessianApproximation::EXACT;
+    /// @brief Maximum iterations a lagged factorization is reused for.
+    int max_lagged_iterations = 3;
+    /// @brief Iterations since the Hessian was last factorized (-1 if the
+    /// factorization cannot be reused).
+    int lagged_iterations = -1;
+    /// @brief Keep the lagged factorization and L-BFGS history between
+    /// solves (e.g., stages of a continuation).
+    bool warm_start_hessian_reuse = false;
+
+    LBFGS lbfgs;
+    /// @brief Free DoF values and gradient of the last L-BFGS iteration.
+    Eigen::VectorXd lbfgs_x_free, lbfgs_gradient_free;
+
+    /// @brief Recent (x, f(x)) pairs with the most recently used first.
+    std::list<std::pair<Eigen::VectorXd, double>> objective_cache;
+
+    /// @brief Sparsity pattern of the last matrix passed to analyzePattern.
+    std::vector<int> analyzed_outer_indices, analyzed_inner_indices;
+
+    /// @brief Check if the pattern has changed since the last analyzePattern.
+    bool has_sparsity_pattern_changed(const Eigen::SparseMatrix<double>& A);
+
 private:
     void reset_stats();
 
@@ -146,16 +311,129 @@ private:
     size_t num_newton_ls_fails = 0;
     size_t num_grad_ls_fails = 0;
     size_t regularization_iterations = 0;
+    size_t num_symbolic_factorizations = 0;
+    size_t pcg_iterations = 0;
+    size_t num_fx_cache_hits = 0;
+    size_t num_lagged_directions = 0;
+    /// @brief Iterations of all the iterative linear solves.
+    size_t linear_solver_iterations = 0;
+    /// @brief Directions solved to a forcing term above min_forcing_term.
+    size_t num_inexact_directions = 0;
+    /// @brief Convergences of inexact directions confirmed with a full solve.
+    size_t num_inexact_convergence_checks = 0;
+    /// @brief Largest relative residual ‖HΔx + ∇f‖ / ‖∇f‖ of a direction.
+    double max_linear_solve_residual = 0;
+
+    /// @brief Line-search failures and earliest TOI of the current solve.
+    int solve_line_search_failures = 0;
+    double solve_earliest_toi = 1;
+
+    std::chrono::steady_clock::time_point solve_start_time;
+    size_t num_time_budget_exits = 0;
+    /// @brief Largest fraction of the time budget used by a solve.
+    double max_time_budget_usage = 0;
 };
 
 /**
  * @brief Make the matrix positive definite (\f$x^T A x > 0\$).
  *
  * @param A The matrix to make positive definite.
+ * @param is_lower_triangular Only the lower triangle of A is meaningful.
  *
  * @return The scale of the update to the diagonal.
  */
-double make_matrix_positive_definite(Eigen::SparseMatrix<double>& A);
+double make_matrix_positive_definite(
+    Eigen::SparseMatrix<double>& A, bool is_lower_triangular = false);
+
+/**
+ * @brief Gershgorin bound on the diagonal shift that makes A diagonally
+ * dominant (\f$\max_i \sum_{j \neq i} |a_{ij}| - a_{ii}\f$, or zero).
+ *
+ * @param A The matrix to bound.
+ * @param is_lower_triangular A is symmetric and only its lower triangle is
+ * meaningful.
+ *
+ * @return The scale of the diagonal shift.
+ */
+double gershgorin_diagonal_shift(
+    const Eigen::SparseMatrix<double>& A, bool is_lower_triangular = false);
+
+/**
+ * @brief Add mu to the diagonal of A in place.
+ *
+ * The sparsity pattern is kept if the diagonal is stored.
+ *
+ * @param A  The matrix to shift.
+ * @param mu The diagonal shift.
+ */
+void add_to_diagonal(Eigen::SparseMatrix<double>& A, double mu);
+
+/**
+ * @brief Remove the rows and columns of fixed DoF from a sparse matrix.
+ *
+ * @param[in]  A                  The full (compressed) matrix.
+ * @param[in]  free_dof           Sorted indices of the free DoF.
+ * @param[in]  full_to_free_dof   Index of each DoF in free_dof (or -1).
+ * @param[out] A_free             The free DoF block of A. Its storage is
+ *                                reused between calls.
+ */
+void slice_free_dof(
+    const Eigen::SparseMatrix<double>& A,
+    const Eigen::VectorXi& free_dof,
+    const std::vector<int>& full_to_free_dof,
+    Eigen::SparseMatrix<double>& A_free);
+
+/**
+ * @brief Next trial step length of a backtracking line search.
+ *
+ * Minimizes the quadratic through \f$f(0)\f$, \f$f'(0)\f$, and the current
+ * trial, or the cubic that also passes through the previous trial. The
+ * result is kept in a fixed fraction of the current step length and falls
+ * back to halving it if the model has no minimizer.
+ *
+ * @param fx               Objective at the start of the line search.
+ * @param grad_dot_dir     Directional derivative at the start.
+ * @param step_length      Current trial step length.
+ * @param fxi              Objective at the current trial.
+ * @param prev_step_length Previous (larger) trial step length, or a
+ *                         negative value if there is none.
+ * @param prev_fxi         Objective at the previous trial.
+ *
+ * @return The step length to try next.
+ */
+double interpolate_step_length(
+    double fx,
+    double grad_dot_dir,
+    double step_length,
+    double fxi,
+    double prev_step_length,
+    double prev_fxi);
+
+/**
+ * @brief Eisenstat–Walker (choice 2) forcing term of an inexact Newton
+ * direction.
+ *
+ * The direction only needs to satisfy \f$\|H\Delta x + \nabla f\| \leq
+ * \eta \|\nabla f\|\f$. \f$\eta\f$ shrinks as fast as the gradient
+ * converges, is kept from dropping much faster than the previous forcing term
+ * did, and is clamped to [min_forcing_term, max_forcing_term].
+ *
+ * @param gradient_norm      Norm of the current gradient.
+ * @param prev_gradient_norm Norm of the gradient of the previous direction,
+ *                           or a non-positive value if there is none.
+ * @param prev_forcing_term  Forcing term of the previous direction.
+ * @param min_forcing_term   Smallest forcing term (e.g., the linear solver
+ *                           tolerance).
+ * @param max_forcing_term   Largest forcing term (also the first one).
+ *
+ * @return The forcing term of the current direction.
+ */
+double eisenstat_walker_forcing_term(
+    double gradient_norm,
+    double prev_gradient_norm,
+    double prev_forcing_term,
+    double min_forcing_term,
+    double max_forcing_term = Constants::INEXACT_NEWTON_MAX_FORCING_TERM);
 
 /**
  * @brief Log values along a search direction.
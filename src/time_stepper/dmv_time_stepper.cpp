@@ -167,7 +167,7 @@ void DMVTimeStepper::step3D(
     int k = round((axis.dot(r0) - angle) / (2 * igl::PI));
     if (k != 0) {
         const Eigen::Vector3d r1_star = (angle + 2 * igl::PI * k) * axis;
-        spdlog::warn(
+        RIGID_IPC_LOG_WARN(
             "r0={} r1={} k={} r1'={}", fmt_eigen(r0),
             fmt_eigen(angle * axis), k, fmt_eigen(r1_star));
     }
@@ -2,15 +2,24 @@
 
 #include <igl/PI.h>
 
+#include <logger.hpp>
+
 namespace ipc::rigid {
 
-static void project_orientation(Eigen::Matrix3d& R)
+Eigen::Matrix3d projected_euler_rotation(
+    const Eigen::Matrix3d& R0, const Eigen::Vector3d& omega, double h)
 {
-    Eigen::JacobiSVD<Eigen::Matrix3d> svd;
-    svd.compute(R, Eigen::ComputeFullU | Eigen::ComputeFullV);
-    R = svd.matrixU() * svd.matrixV().transpose();
-    assert(R.isUnitary(1e-9));
-    assert(fabs(R.determinant() - 1.0) < 1.0e-6);
+    // (I + hω̂)ᵀ(I + hω̂) = I - h²ω̂² only scales the plane orthogonal to ω,
+    // so the polar factor of I + hω̂ is the rotation about ω by atan(h‖ω‖).
+    const double theta = h * omega.norm();
+    if (theta == 0) {
+        return R0;
+    }
+    Eigen::Matrix3d R1 =
+        R0 * Eigen::AngleAxisd(atan(theta), omega.normalized()).matrix();
+    assert(R1.isUnitary(1e-9));
+    assert(fabs(R1.determinant() - 1.0) < 1.0e-6);
+    return R1;
 }
 
 void ExponentialEulerTimeStepper::step3D(
@@ -32,10 +41,10 @@ void ExponentialEulerTimeStepper::step3D(
     body.pose.position += time_step * body.velocity.position;
 
     // Update the orientaiton
-    // R₁ = R₀ + h * R₀ω̂
-    Eigen::Matrix3d R1 = body.pose_prev.construct_rotation_matrix();
-    R1 += time_step * R1 * Hat(body.velocity.rotation);
-    project_orientation(R1);
+    // R₁ = R₀ + h * R₀ω̂ projected onto SO(3)
+    Eigen::Matrix3d R1 = projected_euler_rotation(
+        body.pose_prev.construct_rotation_matrix(), body.velocity.rotation,
+        time_step);
     Eigen::AngleAxisd r1 = Eigen::AngleAxisd(R1);
     double angle = r1.angle();
     Eigen::Vector3d axis = r1.axis();
@@ -44,7 +53,7 @@ void ExponentialEulerTimeStepper::step3D(
     int k = round((axis.dot(r0) - angle) / (2 * igl::PI));
     if (k != 0) {
         const Eigen::Vector3d r1_star = (angle + 2 * igl::PI * k) * axis;
-        spdlog::warn(
+        RIGID_IPC_LOG_WARN(
             "r0={} r1={} k={} r1'={}", fmt_eigen(r0), fmt_eigen(angle * axis),
             k, fmt_eigen(r1_star));
     }
@@ -4,6 +4,11 @@
 
 namespace ipc::rigid {
 
+/// @brief Project the explicit Euler update R₀(I + hω̂) onto SO(3).
+/// Equivalent to the SVD polar decomposition, but in closed form.
+Eigen::Matrix3d projected_euler_rotation(
+    const Eigen::Matrix3d& R0, const Eigen::Vector3d& omega, double h);
+
 class ExponentialEulerTimeStepper : public TimeStepper {
 public:
     virtual ~ExponentialEulerTimeStepper() = default;
@@ -2,8 +2,10 @@
 
 #include <Eigen/Core>
 
-#include <tbb/parallel_for_each.h>
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
 
+#include <constants.hpp>
 #include <logger.hpp>
 #include <physics/pose.hpp>
 #include <physics/rigid_body_assembler.hpp>
@@ -63,6 +65,22 @@ public:
     virtual std::string name() const = 0;
 
 protected:
+    /// @brief Step the bodies in parallel chunks.
+    /// A body update is only a few pose operations, so bodies are grouped
+    /// into contiguous chunks instead of spawning a task per body.
+    template <typename StepFunc>
+    static void step_bodies(RigidBodyAssembler& bodies, StepFunc step_body)
+    {
+        tbb::parallel_for(
+            tbb::blocked_range<size_t>(
+                0, bodies.num_bodies(), Constants::TIME_STEPPER_GRAIN_SIZE),
+            [&](const tbb::blocked_range<size_t>& range) {
+                for (size_t i = range.begin(); i != range.end(); ++i) {
+                    step_body(bodies.m_rbs[i]);
+                }
+            });
+    }
+
     /**
      * @brief Take a single time step.
      *
@@ -92,7 +110,7 @@ protected:
         const double& time_step) const
     {
         assert(bodies.dim() == 2);
-        tbb::parallel_for_each(bodies.m_rbs, [&](RigidBody& body) {
+        step_bodies(bodies, [&](RigidBody& body) {
             step2D(body, gravity, time_step);
         });
     }
@@ -126,7 +144,7 @@ protected:
         const double& time_step) const
     {
         assert(bodies.dim() == 3);
-        tbb::parallel_for_each(bodies.m_rbs, [&](RigidBody& body) {
+        step_bodies(bodies, [&](RigidBody& body) {
             step3D(body, gravity, time_step);
         });
     }
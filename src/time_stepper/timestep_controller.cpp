@@ -0,0 +1,45 @@
+#include "timestep_controller.hpp"
+
+#include <algorithm>
+
+namespace ipc::rigid {
+
+void TimestepController::settings(const nlohmann::json& json)
+{
+    is_enabled = json["enabled"];
+    min_timestep = json["min_timestep"];
+    grow_factor = json["grow_factor"];
+    shrink_factor = json["shrink_factor"];
+    max_iterations_to_grow = json["max_iterations_to_grow"];
+    min_toi_to_grow = json["min_toi_to_grow"];
+    max_toi_to_shrink = json["max_toi_to_shrink"];
+}
+
+nlohmann::json TimestepController::settings() const
+{
+    nlohmann::json json;
+    json["enabled"] = is_enabled;
+    json["min_timestep"] = min_timestep;
+    json["grow_factor"] = grow_factor;
+    json["shrink_factor"] = shrink_factor;
+    json["max_iterations_to_grow"] = max_iterations_to_grow;
+    json["min_toi_to_grow"] = min_toi_to_grow;
+    json["max_toi_to_shrink"] = max_toi_to_shrink;
+    return json;
+}
+
+double TimestepController::next_timestep(
+    double dt, const OptimizationResults& results, double max_dt) const
+{
+    if (!results.success || results.num_line_search_failures > 0
+        || results.earliest_toi < max_toi_to_shrink) {
+        dt *= shrink_factor;
+    } else if (
+        results.num_iterations <= max_iterations_to_grow
+        && results.earliest_toi >= min_toi_to_grow) {
+        dt *= grow_factor;
+    }
+    return std::clamp(dt, std::min(min_timestep, max_dt), max_dt);
+}
+
+} // namespace ipc::rigid
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <nlohmann/json.hpp>
+
+#include <opt/optimization_results.hpp>
+
+namespace ipc::rigid {
+
+/// @brief Adapt the time-step size to the effort of the last step.
+///
+/// The step grows after solves that converged quickly without any step
+/// limited by an early time of impact, and shrinks after line-search
+/// failures or impacts early in the Newton step.
+class TimestepController {
+public:
+    void settings(const nlohmann::json& json);
+    nlohmann::json settings() const;
+
+    /// @brief Size of the next step after a step of size dt.
+    /// @param dt       Size of the last step.
+    /// @param results  Results of the last step's solve.
+    /// @param max_dt   Maximum step size (e.g., the output frame period).
+    double next_timestep(
+        double dt, const OptimizationResults& results, double max_dt) const;
+
+    bool is_enabled = false;
+    double min_timestep = 1e-5;
+    double grow_factor = 2;
+    double shrink_factor = 0.5;
+    /// @brief Grow only if the solve took at most this many iterations.
+    int max_iterations_to_grow = 5;
+    /// @brief Grow only if no step was limited below this time of impact.
+    double min_toi_to_grow = 1;
+    /// @brief Shrink if a step was limited below this time of impact.
+    double max_toi_to_shrink = 0.1;
+};
+
+} // namespace ipc::rigid
@@ -0,0 +1,131 @@
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <utility>
+
+#include <CLI/CLI.hpp>
+#include <ghc/fs_std.hpp> // filesystem
+#include <igl/edges.h>
+#include <igl/read_triangle_mesh.h>
+#include <igl/vertex_components.h>
+#include <nlohmann/json.hpp>
+
+#include <ipc/ipc.hpp>
+
+#include <SimState.hpp>
+#include <logger.hpp>
+
+using namespace ipc::rigid;
+
+/// @brief Indices of the OBJ frames (in file name order) in which distinct
+/// connected components intersect.
+bool intersecting_obj_frames(
+    const fs::path& dir_path,
+    size_t& num_frames,
+    std::vector<size_t>& intersecting_frames)
+{
+    std::vector<fs::path> filenames;
+    for (const auto& entry : fs::directory_iterator(dir_path)) {
+        if (entry.path().extension() == ".obj") {
+            filenames.push_back(entry.path());
+        }
+    }
+    // Numbered names may not be zero padded
+    std::sort(
+        filenames.begin(), filenames.end(),
+        [](const fs::path& a, const fs::path& b) {
+            const std::string sa = a.stem().string(), sb = b.stem().string();
+            return std::make_pair(sa.size(), sa)
+                < std::make_pair(sb.size(), sb);
+        });
+
+    num_frames = filenames.size();
+    for (size_t i = 0; i < filenames.size(); i++) {
+        Eigen::MatrixXd V;
+        Eigen::MatrixXi F;
+        if (!igl::read_triangle_mesh(filenames[i].string(), V, F)) {
+            spdlog::error("unable to read frame={}", filenames[i].string());
+            return false;
+        }
+        Eigen::MatrixXi E;
+        igl::edges(F, E);
+        // The bodies of the merged mesh are its connected components
+        Eigen::VectorXi components;
+        igl::vertex_components(F, components);
+        components.conservativeResize(V.rows());
+        const auto can_collide = [&components](size_t vi, size_t vj) {
+            return components[vi] != components[vj];
+        };
+        if (ipc::has_intersections(V, E, F, can_collide)) {
+            intersecting_frames.push_back(i);
+        }
+    }
+    return true;
+}
+
+int main(int argc, char* argv[])
+{
+    CLI::App app {
+        "check each frame of simulation results or of an OBJ sequence for "
+        "intersections and write a JSON report"
+    };
+
+    std::string input_path = "";
+    app.add_option(
+           "input,-i,--input", input_path,
+           "JSON file with simulation results or directory of OBJ frames")
+        ->required();
+
+    std::string output_path = "";
+    app.add_option(
+        "output,-o,--output", output_path,
+        "JSON file for the report (standard output if empty)");
+
+    double fps = -1;
+    app.add_option(
+        "--fps", fps,
+        "frames per second to check in simulation results (every state if "
+        "not positive)");
+
+    spdlog::level::level_enum loglevel = spdlog::level::warn;
+    app.add_option("--log,--loglevel", loglevel, "log level")
+        ->default_val(loglevel)
+        ->transform(CLI::CheckedTransformer(
+            SPDLOG_LEVEL_NAMES_TO_LEVELS, CLI::ignore_case));
+
+    try {
+        app.parse(argc, argv);
+    } catch (const CLI::ParseError& e) {
+        return app.exit(e);
+    }
+
+    set_logger_level(loglevel);
+
+    size_t num_frames = 0;
+    std::vector<size_t> intersecting_frames;
+    if (fs::is_directory(fs::path(input_path))) {
+        if (!intersecting_obj_frames(
+                input_path, num_frames, intersecting_frames)) {
+            return 1;
+        }
+    } else {
+        SimState sim;
+        if (!sim.load_scene(input_path)) {
+            return app.exit(CLI::Error(
+                "load_sim_failed", "Unable to load simulation result!"));
+        }
+        num_frames = sim.intersecting_frames(intersecting_frames, fps);
+    }
+
+    nlohmann::json report;
+    report["input"] = input_path;
+    report["num_frames"] = num_frames;
+    report["intersecting_frames"] = intersecting_frames;
+    report["is_intersection_free"] = intersecting_frames.empty();
+    if (output_path.empty()) {
+        std::cout << report.dump(4) << std::endl;
+    } else {
+        std::ofstream(output_path) << report.dump(4) << std::endl;
+    }
+    return 0;
+}
@@ -1,30 +1,124 @@
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <limits>
+
 #include <CLI/CLI.hpp>
 
 #include <ccd/ccd.hpp>
+#include <io/query_batch.hpp>
 #include <io/read_rb_scene.hpp>
 #include <io/serialize_json.hpp>
 
 #include <logger.hpp>
 
+using namespace ipc::rigid;
+
+/// @brief Earliest time of impact of the impacts (infinity if none).
+double earliest_toi(const Impacts& impacts)
+{
+    double toi = std::numeric_limits<double>::infinity();
+    for (const auto& impact : impacts.ev_impacts) {
+        toi = std::min(toi, impact.time);
+    }
+    for (const auto& impact : impacts.ee_impacts) {
+        toi = std::min(toi, impact.time);
+    }
+    for (const auto& impact : impacts.fv_impacts) {
+        toi = std::min(toi, impact.time);
+    }
+    return toi;
+}
+
+/// @brief Detect the collisions of a batch query.
+///
+/// The query is {"scene": sim.json, "poses_t0": [...], "poses_t1": [...]}
+/// with the poses as in a saved state, or {"scene": sim.json, "step": i} for
+/// the motion from the (i-1)-th to the i-th saved state.
+nlohmann::json
+evaluate_ccd_query(QuerySceneCache& scenes, const nlohmann::json& query)
+{
+    auto scene = scenes.get(query.at("scene").get<std::string>());
+    const RigidBodyAssembler& bodies = scene->bodies;
+
+    PosesD poses_t0, poses_t1;
+    if (query.contains("step")) {
+        const size_t step = query["step"].get<size_t>();
+        if (step == 0) {
+            throw std::out_of_range("step 0 has no motion");
+        }
+        poses_t0 = scene->state_poses(step - 1);
+        poses_t1 = scene->state_poses(step);
+    } else {
+        poses_t0 = scene->poses(query.at("poses_t0"));
+        poses_t1 = scene->poses(query.at("poses_t1"));
+    }
+
+    int collision_types = bodies.dim() == 2
+        ? CollisionType::EDGE_VERTEX
+        : (CollisionType::EDGE_EDGE | CollisionType::FACE_VERTEX);
+    Impacts impacts;
+    detect_collisions(
+        bodies, poses_t0, poses_t1, collision_types, impacts,
+        DetectionMethod::HASH_GRID, TrajectoryType::RIGID);
+
+    nlohmann::json result;
+    result["has_collision"] = impacts.size() != 0;
+    result["num_impacts"] = impacts.size();
+    if (impacts.size() != 0) {
+        result["earliest_toi"] = earliest_toi(impacts);
+    }
+    return result;
+}
+
 int main(int argc, char* argv[])
 {
-    using namespace ipc::rigid;
     set_logger_level(spdlog::level::info);
 
     CLI::App app { "check for collisions over simulation results" };
 
     std::string input_filename = "";
+    auto input_option = app.add_option(
+        "input_filename,-i,--input", input_filename,
+        "JSON file with input simulation.");
+
+    std::string batch_filename = "";
     app.add_option(
-           "input_filename,-i,--input", input_filename,
-           "JSON file with input simulation.")
-        ->required();
+           "--batch", batch_filename,
+           "JSON lines file of queries ('-' for standard input) to answer "
+           "with one JSON line each on standard output")
+        ->excludes(input_option);
 
     try {
         app.parse(argc, argv);
+        if (input_filename.empty() && batch_filename.empty()) {
+            throw CLI::RequiredError("--input or --batch");
+        }
     } catch (const CLI::ParseError& e) {
         return app.exit(e);
     }
 
+    if (!batch_filename.empty()) {
+        // Keep standard output for the results
+        set_logger_level(spdlog::level::warn);
+        QuerySceneCache scenes;
+        const auto evaluate = [&scenes](const nlohmann::json& query) {
+            return evaluate_ccd_query(scenes, query);
+        };
+        size_t num_failed;
+        if (batch_filename == "-") {
+            num_failed = run_query_batch(std::cin, std::cout, evaluate);
+        } else {
+            std::ifstream batch(batch_filename);
+            if (!batch) {
+                spdlog::error("unable to open batch={}", batch_filename);
+                return 1;
+            }
+            num_failed = run_query_batch(batch, std::cout, evaluate);
+        }
+        return num_failed == 0 ? 0 : 1;
+    }
+
     using nlohmann::json;
     std::ifstream input(input_filename);
     json scene = json::parse(input, nullptr, false);
@@ -1,18 +1,60 @@
+#include <fstream>
+#include <iostream>
+
 #include <CLI/CLI.hpp>
 #include <nlohmann/json.hpp>
 
 #include <ipc/ipc.hpp>
 
+#include <io/query_batch.hpp>
 #include <io/read_rb_scene.hpp>
 #include <io/serialize_json.hpp>
 #include <physics/rigid_body_assembler.hpp>
 
 #include <logger.hpp>
 
+using namespace ipc;
+using namespace ipc::rigid;
+
+/// @brief Minimum distance between the bodies at the given poses.
+double min_distance(const RigidBodyAssembler& bodies, const PosesD& poses)
+{
+    Eigen::MatrixXd V = bodies.world_vertices(poses);
+
+    const Eigen::VectorXi& group_ids = bodies.group_ids();
+    auto can_collide = [&group_ids](size_t vi, size_t vj) {
+        return group_ids[vi] != group_ids[vj];
+    };
+
+    Constraints constraint_set;
+    construct_constraint_set(
+        /*V_rest=*/V, V, bodies.m_edges, bodies.m_faces,
+        /*dhat=*/1, constraint_set, bodies.m_faces_to_edges, /*dmin=*/0,
+        BroadPhaseMethod::HASH_GRID,
+        /*ignore_internal_vertices=*/false, can_collide);
+    return sqrt(compute_minimum_distance(
+        V, bodies.m_edges, bodies.m_faces, constraint_set));
+}
+
+/// @brief Minimum distance of a batch query.
+///
+/// The query is {"scene": sim.json, "poses": [...]} with the poses as in a
+/// saved state, or {"scene": sim.json, "step": i} for the i-th saved state.
+nlohmann::json evaluate_min_distance_query(
+    QuerySceneCache& scenes, const nlohmann::json& query)
+{
+    auto scene = scenes.get(query.at("scene").get<std::string>());
+    const PosesD poses = query.contains("step")
+        ? scene->state_poses(query["step"].get<size_t>())
+        : scene->poses(query.at("poses"));
+
+    nlohmann::json result;
+    result["min_distance"] = min_distance(scene->bodies, poses);
+    return result;
+}
+
 int main(int argc, char* argv[])
 {
-    using namespace ipc;
-    using namespace ipc::rigid;
     set_logger_level(spdlog::level::info);
 
     CLI::App app {
@@ -20,25 +62,56 @@ int main(int argc, char* argv[])
     };
 
     std::string input_json = "";
-    app.add_option(
-           "input_json,-i,--input", input_json,
-           "JSON file with input simulation.")
-        ->required();
+    auto input_option = app.add_option(
+        "input_json,-i,--input", input_json,
+        "JSON file with input simulation.");
 
     std::string output_csv = "";
-    app.add_option(
-           "output_csv,-o,--outputh", output_csv, "CSV file for output.")
-        ->required();
+    auto output_option = app.add_option(
+        "output_csv,-o,--outputh", output_csv, "CSV file for output.");
 
     std::string header = "min_distance";
     app.add_option("--header", header, "use as name for header.");
 
+    std::string batch_filename = "";
+    app.add_option(
+           "--batch", batch_filename,
+           "JSON lines file of queries ('-' for standard input) to answer "
+           "with one JSON line each on standard output")
+        ->excludes(input_option)
+        ->excludes(output_option);
+
     try {
         app.parse(argc, argv);
+        if (batch_filename.empty()
+            && (input_json.empty() || output_csv.empty())) {
+            throw CLI::RequiredError("--input and --output or --batch");
+        }
     } catch (const CLI::ParseError& e) {
         return app.exit(e);
     }
 
+    if (!batch_filename.empty()) {
+        // Keep standard output for the results
+        set_logger_level(spdlog::level::warn);
+        QuerySceneCache scenes;
+        const auto evaluate = [&scenes](const nlohmann::json& query) {
+            return evaluate_min_distance_query(scenes, query);
+        };
+        size_t num_failed;
+        if (batch_filename == "-") {
+            num_failed = run_query_batch(std::cin, std::cout, evaluate);
+        } else {
+            std::ifstream batch(batch_filename);
+            if (!batch) {
+                spdlog::error("unable to open batch={}", batch_filename);
+                return 1;
+            }
+            num_failed = run_query_batch(batch, std::cout, evaluate);
+        }
+        return num_failed == 0 ? 0 : 1;
+    }
+
     using nlohmann::json;
     std::ifstream input(input_json);
     json scene = json::parse(input, nullptr, false);
@@ -69,23 +142,7 @@ int main(int argc, char* argv[])
             from_json(jrb["rotation"], poses[j].rotation);
         }
 
-        Eigen::MatrixXd V = bodies.world_vertices(poses);
-
-        const Eigen::VectorXi& group_ids = bodies.group_ids();
-        auto can_collide = [&group_ids](size_t vi, size_t vj) {
-            return group_ids[vi] != group_ids[vj];
-        };
-
-        Constraints constraint_set;
-        construct_constraint_set(
-            /*V_rest=*/V, V, bodies.m_edges, bodies.m_faces,
-            /*dhat=*/1, constraint_set, bodies.m_faces_to_edges, /*dmin=*/0,
-            BroadPhaseMethod::HASH_GRID,
-            /*ignore_internal_vertices=*/false, can_collide);
-        double min_distance = sqrt(compute_minimum_distance(
-            V, bodies.m_edges, bodies.m_faces, constraint_set));
-
-        csv << fmt::format("{},{:.18e}\n", i, min_distance);
+        csv << fmt::format("{},{:.18e}\n", i, min_distance(bodies, poses));
     }
     std::ofstream myfile;
     myfile.open(output_csv);
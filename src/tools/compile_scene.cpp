@@ -0,0 +1,77 @@
+#include <fstream>
+
+#include <CLI/CLI.hpp>
+#include <tbb/parallel_for.h>
+
+#include <io/read_rb_scene.hpp>
+#include <io/scene_bundle.hpp>
+#include <physics/rigid_body.hpp>
+
+#include <logger.hpp>
+
+int main(int argc, char* argv[])
+{
+    using namespace ipc::rigid;
+    set_logger_level(spdlog::level::info);
+
+    CLI::App app("Compile a JSON scene into a binary bundle with precomputed "
+                 "geometry (load it as a .rbscene file).");
+
+    std::string input_filename = "";
+    app.add_option(
+           "input_filename,-i,--input", input_filename, "JSON scene file")
+        ->required();
+
+    std::string output_filename = "";
+    app.add_option(
+           "output_filename,-o,--output", output_filename,
+           "output bundle (.rbscene)")
+        ->required();
+
+    std::string patch = "";
+    app.add_option("-p,--patch", patch, "JSON patch to update the scene");
+
+    try {
+        app.parse(argc, argv);
+    } catch (const CLI::ParseError& e) {
+        return app.exit(e);
+    }
+
+    std::ifstream input(input_filename);
+    nlohmann::json scene = nlohmann::json::parse(input, nullptr, false);
+    if (scene.is_discarded()) {
+        spdlog::error("invalid JSON scene filename={}", input_filename);
+        return 1;
+    }
+    if (patch.size()) {
+        scene.merge_patch(nlohmann::json::parse(patch));
+    }
+    // Saved simulations store their scene in args
+    nlohmann::json args = scene.contains("args") ? scene["args"] : scene;
+
+    std::vector<RigidBodySpec> specs;
+    if (!read_rb_scene_specs(args["rigid_body_problem"], specs)) {
+        spdlog::error("unable to read rigid body scene!");
+        return 1;
+    }
+
+    // Bodies with the same mesh share their geometry
+    tbb::parallel_for(size_t(0), specs.size(), [&](size_t i) {
+        RigidBodySpec& spec = specs[i];
+        spec.geometry = RigidBodyGeometry::get(
+            spec.vertices, spec.edges, spec.faces,
+            RigidBody::num_rot_dof_fixed(
+                spec.vertices.cols(), spec.is_dof_fixed));
+    });
+
+    // The bodies are read from the bundle itself
+    args["rigid_body_problem"]["rigid_bodies"] = nlohmann::json::array();
+    args["rigid_body_problem"].erase("scene_bundle");
+    if (!write_scene_bundle(output_filename, args, specs)) {
+        return 1;
+    }
+    spdlog::info(
+        "compiled scene filename={} num_bodies={}", output_filename,
+        specs.size());
+    return 0;
+}
@@ -22,6 +22,10 @@ int main(int argc, char* argv[])
            "directory for OBJ sequence")
         ->required();
 
+    double fps = -1;
+    app.add_option(
+        "--fps", fps, "output frames per second (every state if not positive)");
+
     spdlog::level::level_enum loglevel = spdlog::level::warn;
     app.add_option("--log,--loglevel", loglevel, "log level")
         ->default_val(loglevel)
@@ -45,5 +49,5 @@ int main(int argc, char* argv[])
         return app.exit(
             CLI::Error("load_sim_failed", "Unable to load simulation result!"));
     }
-    sim.save_obj_sequence(output_dir);
+    sim.save_obj_sequence(output_dir, fps);
 }
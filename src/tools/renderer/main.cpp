@@ -1,3 +1,8 @@
+#include <cmath>
+#include <csignal>
+#include <cstdio>
+#include <memory>
+#include <mutex>
 #include <string>
 
 #include <CLI/CLI.hpp>
@@ -6,10 +11,15 @@
 #include <nlohmann/json.hpp>
 #include <tbb/parallel_for.h>
 #include <tbb/parallel_sort.h>
+#include <tbb/pipeline.h>
+#include <tbb/task_scheduler_init.h>
 
 #include <io/read_obj.hpp>
 #include <io/read_rb_scene.hpp>
+#include <io/read_json.hpp>
 #include <io/serialize_json.hpp>
+#include <io/keyframe_file.hpp>
+#include <io/trajectory_file.hpp>
 #include <logger.hpp>
 #include <physics/pose.hpp>
 #include <physics/rigid_body_assembler.hpp>
@@ -18,11 +28,22 @@
 
 using namespace swr;
 
+#if defined(_WIN32)
+#define popen _popen
+#define pclose _pclose
+static const char* POPEN_WRITE_MODE = "wb";
+#else
+static const char* POPEN_WRITE_MODE = "w";
+#endif
+
 struct SimRenderArgs {
     fs::path sim_path;
     fs::path output_path = fs::path("sim.mp4");
     spdlog::level::level_enum loglevel = spdlog::level::level_enum::info;
     int fps = -1;
+    bool png_frames = false;
+    /// @brief Keyframe file of the simulation (see sim_to_gltf).
+    fs::path keyframes_path;
 };
 
 SimRenderArgs parse_args(int argc, char* argv[])
@@ -41,6 +62,13 @@ SimRenderArgs parse_args(int argc, char* argv[])
         "set log level 0=trace, 1=debug, 2=info, 3=warn, 4=error, 5=critical, "
         "6=off");
     app.add_option("--fps", args.fps, "output video frames per second");
+    app.add_flag(
+        "--png-frames", args.png_frames,
+        "write every frame to a PNG file before encoding the video");
+    app.add_option(
+           "--keyframes", args.keyframes_path,
+           "keyframe file to read the poses from instead of the states")
+        ->check(CLI::ExistingFile);
 
     try {
         app.parse(argc, argv);
@@ -72,9 +100,7 @@ SimRenderArgs parse_args(int argc, char* argv[])
 
 bool read_json(const std::string& filename, nlohmann::json& json)
 {
-    std::ifstream input(filename);
-    json = nlohmann::json::parse(input, nullptr, false);
-    return !json.is_discarded();
+    return ipc::rigid::read_json_file(filename, json);
 }
 
 class MeshGenerator {
@@ -86,6 +112,21 @@ public:
     virtual Eigen::MatrixXi faces(size_t i) = 0;
     virtual Eigen::VectorXi colors(size_t i) = 0;
     virtual int fps() = 0;
+
+    /// Mesh of the ith frame without the objects outside of the view.
+    virtual void frame(
+        size_t i,
+        const ViewFrustum& frustum,
+        Eigen::MatrixXd& V,
+        Eigen::MatrixXi& E,
+        Eigen::MatrixXi& F,
+        Eigen::VectorXi& C)
+    {
+        V = vertices(i);
+        E = edges(i);
+        F = faces(i);
+        C = colors(i);
+    }
 };
 
 class OBJSequence : public MeshGenerator {
@@ -157,18 +198,29 @@ protected:
 
 class RigidBodySequence : public MeshGenerator {
 public:
-    RigidBodySequence(const fs::path& input)
+    RigidBodySequence(
+        const fs::path& input, const fs::path& keyframes_path = fs::path())
     {
-        // Read the simulation json file
+        // Read the simulation json file (only kept while loading). Only the
+        // poses of each state are kept as the states are parsed.
         nlohmann::json sim;
-        if (!read_json(input.string(), sim)) {
+        auto add_poses = [&](nlohmann::json&& state) {
+            const auto& jrbs = state["rigid_bodies"];
+            ipc::rigid::PosesD poses(jrbs.size());
+            for (size_t j = 0; j < jrbs.size(); j++) {
+                ipc::rigid::from_json(jrbs[j]["position"], poses[j].position);
+                ipc::rigid::from_json(jrbs[j]["rotation"], poses[j].rotation);
+            }
+            pose_sequence.push_back(poses);
+        };
+        if (!ipc::rigid::read_json_file(
+                input.string(), sim, "/animation/state_sequence",
+                keyframes_path.empty() ? add_poses
+                                       : ipc::rigid::JsonElementCallback())) {
             spdlog::error("Invalid simulation JSON file");
             exit(1);
         }
 
-        state_sequence = sim["animation"]["state_sequence"]
-                             .get<std::vector<nlohmann::json>>();
-
         std::vector<ipc::rigid::RigidBody> rbs;
         ipc::rigid::read_rb_scene(sim["args"]["rigid_body_problem"], rbs);
         bodies.init(rbs);
@@ -183,23 +235,57 @@ public:
         }
 
         m_fps = int(1 / sim["args"]["timestep"].get<double>());
+
+        if (!keyframes_path.empty()) {
+            // Frames are decoded from the keyframes as they are rendered
+            if (!keyframes.read(keyframes_path.string())
+                || keyframes.num_bodies() != bodies.num_bodies()) {
+                spdlog::error(
+                    "Invalid keyframe file ({})", keyframes_path.string());
+                exit(1);
+            }
+            m_fps = int(std::round(1 / keyframes.timestep()));
+            is_keyframed = true;
+            return;
+        }
+
+        const auto& animation = sim["animation"];
+        if (animation.contains("trajectory_file")) {
+            // Frames are read from the binary trajectory as they are rendered
+            fs::path trajectory_path =
+                animation["trajectory_file"].get<std::string>();
+            if (!fs::exists(trajectory_path)) {
+                trajectory_path =
+                    input.parent_path() / trajectory_path.filename();
+            }
+            if (!trajectory.open(trajectory_path.string())
+                || trajectory.header().num_bodies != bodies.num_bodies()) {
+                spdlog::error(
+                    "Invalid trajectory file ({})", trajectory_path.string());
+                exit(1);
+            }
+            is_streaming = true;
+            return;
+        }
+
+        assert(
+            pose_sequence.empty()
+            || pose_sequence.back().size() == bodies.num_bodies());
     }
 
     virtual ~RigidBodySequence() override {};
 
-    size_t num_meshes() override { return state_sequence.size(); }
+    size_t num_meshes() override
+    {
+        if (is_keyframed) {
+            return keyframes.num_frames();
+        }
+        return is_streaming ? trajectory.num_frames() : pose_sequence.size();
+    }
 
     Eigen::MatrixXd vertices(size_t i) override
     {
-        assert(i < num_meshes());
-        ipc::rigid::PosesD poses(bodies.num_bodies());
-        assert(state_sequence[i]["rigid_bodies"].size() == bodies.num_bodies());
-        for (int j = 0; j < bodies.num_bodies(); j++) {
-            const auto& jrb = state_sequence[i]["rigid_bodies"][j];
-            ipc::rigid::from_json(jrb["position"], poses[j].position);
-            ipc::rigid::from_json(jrb["rotation"], poses[j].rotation);
-        }
-        return bodies.world_vertices(poses);
+        return bodies.world_vertices(poses(i));
     }
 
     Eigen::MatrixXi edges(size_t i) override { return bodies.m_edges; }
@@ -210,29 +296,235 @@ public:
 
     int fps() override { return m_fps; }
 
+    /// Only the bodies whose world bounding box is in view are transformed
+    /// and rendered.
+    void frame(
+        size_t i,
+        const ViewFrustum& frustum,
+        Eigen::MatrixXd& V,
+        Eigen::MatrixXi& E,
+        Eigen::MatrixXi& F,
+        Eigen::VectorXi& C) override
+    {
+        const ipc::rigid::PosesD frame_poses = poses(i);
+
+        std::vector<size_t> visible_bodies;
+        long num_vertices = 0, num_edges = 0, num_faces = 0;
+        for (size_t j = 0; j < bodies.num_bodies(); j++) {
+            const ipc::rigid::RigidBody& body = bodies[j];
+            ipc::VectorMax3d box_min, box_max;
+            body.compute_bounding_box(frame_poses[j], box_min, box_max);
+            Vector3F min = Vector3F::Zero(), max = Vector3F::Zero();
+            min.head(box_min.size()) = box_min.cast<Float>();
+            max.head(box_max.size()) = box_max.cast<Float>();
+            if (frustum.is_box_visible(min, max)) {
+                visible_bodies.push_back(j);
+                num_vertices += body.num_vertices();
+                num_edges += body.num_edges();
+                num_faces += body.num_faces();
+            }
+        }
+
+        V.resize(num_vertices, bodies.dim());
+        E.resize(num_edges, 2);
+        F.resize(num_faces, 3);
+        C.resize(num_vertices);
+        long vi = 0, ei = 0, fi = 0;
+        for (const size_t j : visible_bodies) {
+            const ipc::rigid::RigidBody& body = bodies[j];
+            V.middleRows(vi, body.num_vertices()) =
+                body.world_vertices(frame_poses[j]);
+            if (body.num_edges()) {
+                E.middleRows(ei, body.num_edges()) = body.edges.array() + vi;
+            }
+            if (body.num_faces()) {
+                F.middleRows(fi, body.num_faces()) = body.faces.array() + vi;
+            }
+            C.segment(vi, body.num_vertices()).setConstant(int(body.type));
+            vi += body.num_vertices();
+            ei += body.num_edges();
+            fi += body.num_faces();
+        }
+    }
+
 protected:
-    std::vector<nlohmann::json> state_sequence;
+    ipc::rigid::PosesD poses(size_t i)
+    {
+        assert(i < num_meshes());
+        if (is_keyframed) {
+            ipc::rigid::PosesD poses;
+            keyframes.frame(i, poses);
+            return poses;
+        }
+        if (!is_streaming) {
+            return pose_sequence[i];
+        }
+
+        ipc::rigid::PosesD poses, velocities;
+        {
+            // The reader falls back to a shared stream if it is not mapped
+            std::lock_guard<std::mutex> lock(trajectory_mutex);
+            if (!trajectory.read_frame(i, poses, velocities)) {
+                spdlog::error("Unable to read trajectory frame {:d}", i);
+                poses = bodies.rb_poses();
+            }
+        }
+        return poses;
+    }
+
     ipc::rigid::RigidBodyAssembler bodies;
     Eigen::VectorXi vertex_colors;
     int m_fps;
+
+    /// @brief Poses of every state (if the states are stored in the JSON).
+    std::vector<ipc::rigid::PosesD> pose_sequence;
+
+    /// @brief Binary trajectory the frames are streamed from.
+    ipc::rigid::TrajectoryReader trajectory;
+    std::mutex trajectory_mutex;
+    bool is_streaming = false;
+
+    /// @brief Keyframes the frames are decoded from.
+    ipc::rigid::KeyframeSequence keyframes;
+    bool is_keyframed = false;
 };
 
+/// Render every frame to a PNG file and combine them with ffmpeg
+bool render_png_frames(
+    MeshGenerator& mesh_generator,
+    const Scene& scene,
+    const ViewFrustum& frustum,
+    const fs::path& output_path,
+    int fps)
+{
+    fs::path frames_dir = output_path.parent_path()
+        / fmt::format("frames-{}", ipc::rigid::current_time_string());
+    fs::create_directories(frames_dir);
+
+    tbb::parallel_for(size_t(0), mesh_generator.num_meshes(), [&](size_t i) {
+        std::string frame_name =
+            (frames_dir / fmt::format("frame{:06d}.png", i)).string();
+
+        igl::Timer render_timer;
+        render_timer.start();
+        Eigen::MatrixXd V;
+        Eigen::MatrixXi E, F;
+        Eigen::VectorXi C;
+        mesh_generator.frame(i, frustum, V, E, F, C);
+        bool wrote_frame = render_mesh(scene, V, E, F, C, frame_name);
+        render_timer.stop();
+
+        if (wrote_frame) {
+            spdlog::info(
+                "Rendered frame {:d} to '{}' in {:g} seconds", //
+                i, frame_name, render_timer.getElapsedTime());
+        } else {
+            spdlog::error("Unable to render frame {:d} to '{}'", i, frame_name);
+        }
+    });
+
+    std::string ffmpeg_cmd = fmt::format(
+        "ffmpeg -hide_banner -loglevel warning -y -r {:d} -i {}/frame%06d.png "
+        "-vcodec libx264 -crf 0 {}",
+        fps, frames_dir.string(), output_path.string());
+    spdlog::info("Combining frames using '{}'", ffmpeg_cmd);
+    return std::system(ffmpeg_cmd.c_str()) == 0;
+}
+
+/// Render the frames in parallel and pipe them in order to ffmpeg's stdin
+/// as raw RGBA, so rendering and encoding overlap and no frames are written
+/// to disk.
+bool render_video(
+    MeshGenerator& mesh_generator,
+    const Scene& scene,
+    const ViewFrustum& frustum,
+    const fs::path& output_path,
+    int fps)
+{
+    const Eigen::Vector2i& resolution = scene.camera.resolution;
+    std::string ffmpeg_cmd = fmt::format(
+        "ffmpeg -hide_banner -loglevel warning -y -f rawvideo -pix_fmt rgba "
+        "-s {:d}x{:d} -r {:d} -i - -vcodec libx264 -crf 0 {}",
+        resolution.x(), resolution.y(), fps, output_path.string());
+    spdlog::info("Encoding frames using '{}'", ffmpeg_cmd);
+#if !defined(_WIN32)
+    // Report a failed write instead of being killed if ffmpeg exits early
+    std::signal(SIGPIPE, SIG_IGN);
+#endif
+    FILE* ffmpeg = popen(ffmpeg_cmd.c_str(), POPEN_WRITE_MODE);
+    if (ffmpeg == nullptr) {
+        spdlog::error("Unable to run '{}'", ffmpeg_cmd);
+        return false;
+    }
+
+    struct Frame {
+        size_t index;
+        std::vector<uint8_t> image;
+    };
+
+    // The number of frames in flight bounds the memory used
+    const size_t max_frames_in_flight =
+        2 * tbb::task_scheduler_init::default_num_threads();
+    const size_t num_frames = mesh_generator.num_meshes();
+    size_t next_frame = 0;
+    bool is_pipe_open = true;
+    tbb::parallel_pipeline(
+        max_frames_in_flight,
+        tbb::make_filter<void, size_t>(
+            tbb::filter::serial_in_order,
+            [&](tbb::flow_control& control) -> size_t {
+                if (next_frame >= num_frames || !is_pipe_open) {
+                    control.stop();
+                    return 0;
+                }
+                return next_frame++;
+            })
+            & tbb::make_filter<size_t, std::shared_ptr<Frame>>(
+                tbb::filter::parallel,
+                [&](size_t i) {
+                    igl::Timer render_timer;
+                    render_timer.start();
+                    Eigen::MatrixXd V;
+                    Eigen::MatrixXi E, F;
+                    Eigen::VectorXi C;
+                    mesh_generator.frame(i, frustum, V, E, F, C);
+                    auto frame = std::make_shared<Frame>();
+                    frame->index = i;
+                    render_mesh(scene, V, E, F, C, frame->image);
+                    render_timer.stop();
+                    spdlog::info(
+                        "Rendered frame {:d} in {:g} seconds", i,
+                        render_timer.getElapsedTime());
+                    return frame;
+                })
+            & tbb::make_filter<std::shared_ptr<Frame>, void>(
+                tbb::filter::serial_in_order,
+                [&](const std::shared_ptr<Frame>& frame) {
+                    if (is_pipe_open
+                        && fwrite(
+                               frame->image.data(), 1, frame->image.size(),
+                               ffmpeg)
+                            != frame->image.size()) {
+                        spdlog::error(
+                            "Unable to pipe frame {:d} to ffmpeg",
+                            frame->index);
+                        is_pipe_open = false;
+                    }
+                }));
+
+    return pclose(ffmpeg) == 0 && is_pipe_open;
+}
+
 int main(int argc, char* argv[])
 {
     SimRenderArgs args = parse_args(argc, argv);
 
     ipc::rigid::set_logger_level(args.loglevel);
 
-    ///////////////////////////////////////////////////////////////////////////
-    // Create folder for PNG frames
     // Create the output directory if it does not exist
     if (args.output_path.has_parent_path()) {
         fs::create_directories(args.output_path.parent_path());
     }
-    fs::path frames_dir = args.output_path.parent_path()
-        / fmt::format("frames-{}", ipc::rigid::current_time_string());
-    fs::create_directories(frames_dir);
-    ///////////////////////////////////////////////////////////////////////////
 
     ///////////////////////////////////////////////////////////////////////////
     // Determine if the input is a simulation json or sequence of OBJs
@@ -240,7 +532,8 @@ int main(int argc, char* argv[])
     if (fs::is_directory(args.sim_path)) {
         mesh_generator = std::make_unique<OBJSequence>(args.sim_path);
     } else {
-        mesh_generator = std::make_unique<RigidBodySequence>(args.sim_path);
+        mesh_generator = std::make_unique<RigidBodySequence>(
+            args.sim_path, args.keyframes_path);
     }
     if (mesh_generator->num_meshes() == 0) {
         return 0;
@@ -261,39 +554,17 @@ int main(int argc, char* argv[])
     Scene scene(render_args);
     scene.camera.align_camera_center(
         mesh_generator->vertices(0), mesh_generator->faces(0));
+    const ViewFrustum frustum(scene);
     ///////////////////////////////////////////////////////////////////////////
 
-    tbb::parallel_for(size_t(0), mesh_generator->num_meshes(), [&](size_t i) {
-        std::string frame_name =
-            (frames_dir / fmt::format("frame{:06d}.png", i)).string();
-
-        igl::Timer render_timer;
-        render_timer.start();
-        bool wrote_frame = render_mesh(
-            scene, mesh_generator->vertices(i), mesh_generator->edges(i),
-            mesh_generator->faces(i), mesh_generator->colors(i), frame_name);
-        render_timer.stop();
-
-        if (wrote_frame) {
-            spdlog::info(
-                "Rendered frame {:d} to '{}' in {:g} seconds", //
-                i, frame_name, render_timer.getElapsedTime());
-        } else {
-            spdlog::error("Unable to render frame {:d} to '{}'", i, frame_name);
-        }
-    });
-
-    ///////////////////////////////////////////////////////////////////////////
-    // Combine PNG frames to video
     int fps = args.fps > 0 ? args.fps : render_args["fps"].get<int>();
     if (fps <= 0) {
         fps = mesh_generator->fps();
     }
-    std::string ffmpeg_cmd = fmt::format(
-        "ffmpeg -hide_banner -loglevel warning -y -r {:d} -i {}/frame%06d.png "
-        "-vcodec libx264 -crf 0 {}",
-        fps, frames_dir.string(), args.output_path.string());
-    spdlog::info("Combining frames using '{}'", ffmpeg_cmd);
-    std::system(ffmpeg_cmd.c_str());
-    ///////////////////////////////////////////////////////////////////////////
+
+    const bool success = args.png_frames
+        ? render_png_frames(
+            *mesh_generator, scene, frustum, args.output_path, fps)
+        : render_video(*mesh_generator, scene, frustum, args.output_path, fps);
+    return success ? 0 : 1;
 }
@@ -1,6 +1,8 @@
 #include "raster.hpp"
 
+#include <algorithm>
 #include <iostream>
+#include <limits>
 
 #include <Eigen/LU> // Needed for .inverse()
 
@@ -74,6 +76,99 @@ void rasterize_triangle(
         });
 }
 
+namespace {
+    /// Side length in pixels of the tiles the framebuffer is split into.
+    const int TILE_SIZE = 32;
+
+    /// Inclusive pixel bounds of a primitive.
+    struct PixelBox {
+        int lx, ly, ux, uy;
+    };
+
+    /// Clamp a primitive's pixel bounds to the framebuffer.
+    /// @returns False if the bounds are entirely outside of the framebuffer.
+    bool clamp_pixel_box(
+        Float min_x,
+        Float min_y,
+        Float max_x,
+        Float max_y,
+        const FrameBuffer& frameBuffer,
+        PixelBox& box)
+    {
+        if (!(max_x >= 0 && max_y >= 0 && min_x <= frameBuffer.rows()
+              && min_y <= frameBuffer.cols())) {
+            return false; // Also rejects NaN bounds
+        }
+        box.lx = std::max(int(std::floor(min_x)), 0);
+        box.ly = std::max(int(std::floor(min_y)), 0);
+        box.ux = std::min(int(std::ceil(max_x)), int(frameBuffer.rows() - 1));
+        box.uy = std::min(int(std::ceil(max_y)), int(frameBuffer.cols() - 1));
+        return box.lx <= box.ux && box.ly <= box.uy;
+    }
+
+    /// Tiles of the framebuffer and the primitives overlapping each of them,
+    /// in the order they were added.
+    class TileBins {
+    public:
+        TileBins(const FrameBuffer& frameBuffer)
+            : num_tiles_x((frameBuffer.rows() + TILE_SIZE - 1) / TILE_SIZE)
+            , num_tiles_y((frameBuffer.cols() + TILE_SIZE - 1) / TILE_SIZE)
+            , bins(num_tiles_x * num_tiles_y)
+        {
+        }
+
+        void add(size_t primitive, const PixelBox& box)
+        {
+            for (int ty = box.ly / TILE_SIZE; ty <= box.uy / TILE_SIZE; ty++) {
+                for (int tx = box.lx / TILE_SIZE; tx <= box.ux / TILE_SIZE;
+                     tx++) {
+                    bins[ty * num_tiles_x + tx].push_back(primitive);
+                }
+            }
+        }
+
+        /// Pixels of the tile clipped to the primitive's bounds.
+        PixelBox clip(size_t tile, const PixelBox& box) const
+        {
+            const int tx = (tile % num_tiles_x) * TILE_SIZE;
+            const int ty = (tile / num_tiles_x) * TILE_SIZE;
+            return { std::max(box.lx, tx), std::max(box.ly, ty),
+                     std::min(box.ux, tx + TILE_SIZE - 1),
+                     std::min(box.uy, ty + TILE_SIZE - 1) };
+        }
+
+        size_t num_tiles() const { return bins.size(); }
+
+        std::vector<size_t>& operator[](size_t tile) { return bins[tile]; }
+
+    protected:
+        int num_tiles_x, num_tiles_y;
+        std::vector<std::vector<size_t>> bins;
+    };
+
+    /// Precomputed state of a triangle in pixel coordinates.
+    struct TriangleSetup {
+        /// Maps homogeneous pixel coordinates to barycentric coordinates
+        /// (i.e., the triangle's edge functions).
+        Matrix3F Ai;
+        /// Depths (-z) of the vertices.
+        Vector3F depths;
+        PixelBox box;
+    };
+
+    /// Farthest depth of the tile's pixels.
+    Float tile_max_depth(const FrameBuffer& frameBuffer, const PixelBox& tile)
+    {
+        Float max_depth = -std::numeric_limits<Float>::infinity();
+        for (int j = tile.ly; j <= tile.uy; j++) {
+            for (int i = tile.lx; i <= tile.ux; i++) {
+                max_depth = std::max(max_depth, frameBuffer(i, j).depth);
+            }
+        }
+        return max_depth;
+    }
+} // namespace
+
 void rasterize_triangles(
     const Shaders& shaders,
     const UniformAttributes& uniform,
@@ -86,12 +181,118 @@ void rasterize_triangles(
         v[i] = shaders.vertex_shader(vertices[i], uniform);
     });
 
-    // Call the rasterization function on every triangle
+    // Set up every triangle once (parallel)
     assert(vertices.size() % 3 == 0);
-    tbb::parallel_for(size_t(0), vertices.size() / 3, [&](size_t i) {
-        rasterize_triangle(
-            shaders, uniform, v[i * 3 + 0], v[i * 3 + 1], v[i * 3 + 2],
-            frameBuffer);
+    const size_t num_triangles = vertices.size() / 3;
+    std::vector<TriangleSetup> triangles(num_triangles);
+    std::vector<bool> is_visible(num_triangles);
+    tbb::parallel_for(size_t(0), num_triangles, [&](size_t t) {
+        // Convert to canonical representation and rescale to pixel size
+        Eigen::Matrix<Float, 3, 4> p;
+        for (int k = 0; k < 3; k++) {
+            p.row(k) = v[3 * t + k].position.array()
+                / v[3 * t + k].position.w();
+        }
+        p.col(0) = ((p.col(0).array() + 1.0) / 2.0) * frameBuffer.rows();
+        p.col(1) = ((p.col(1).array() + 1.0) / 2.0) * frameBuffer.cols();
+
+        TriangleSetup& triangle = triangles[t];
+        triangle.depths = -p.col(2);
+        // Frustum culling: outside of the framebuffer or the depth range
+        is_visible[t] = p.col(2).maxCoeff() >= -1 && p.col(2).minCoeff() <= 1
+            && clamp_pixel_box(
+                            p.col(0).minCoeff(), p.col(1).minCoeff(),
+                            p.col(0).maxCoeff(), p.col(1).maxCoeff(),
+                            frameBuffer, triangle.box);
+        if (!is_visible[t]) {
+            return;
+        }
+
+        // Build the implicit triangle representation
+        Matrix3F A;
+        A.col(0) = p.row(0).head<3>();
+        A.col(1) = p.row(1).head<3>();
+        A.col(2) = p.row(2).head<3>();
+        A.row(2) << 1.0, 1.0, 1.0;
+        triangle.Ai = A.inverse();
+    });
+
+    // Bin the triangles by the tiles they overlap
+    TileBins bins(frameBuffer);
+    for (size_t t = 0; t < num_triangles; t++) {
+        if (is_visible[t]) {
+            bins.add(t, triangles[t].box);
+        }
+    }
+
+    // Every tile is rasterized by a single thread, so the pixels need no
+    // locking.
+    tbb::parallel_for(size_t(0), bins.num_tiles(), [&](size_t tile) {
+        std::vector<size_t>& bin = bins[tile];
+        if (bin.empty()) {
+            return;
+        }
+        const PixelBox tile_box = bins.clip(
+            tile,
+            { 0, 0, int(frameBuffer.rows() - 1), int(frameBuffer.cols() - 1) });
+        const int num_tile_pixels = (tile_box.ux - tile_box.lx + 1)
+            * (tile_box.uy - tile_box.ly + 1);
+
+        // Front to back, so the depth tests reject most hidden fragments
+        // before they are shaded.
+        if (shaders.depth_test) {
+            std::stable_sort(bin.begin(), bin.end(), [&](size_t a, size_t b) {
+                return triangles[a].depths.minCoeff()
+                    < triangles[b].depths.minCoeff();
+            });
+        }
+        // Hierarchical depth: the farthest depth written to the tile,
+        // updated after as many writes as the tile has pixels.
+        Float max_depth = std::numeric_limits<Float>::infinity();
+        int num_writes = num_tile_pixels;
+
+        for (const size_t t : bin) {
+            const TriangleSetup& triangle = triangles[t];
+            if (shaders.depth_test) {
+                if (num_writes >= num_tile_pixels) {
+                    max_depth = tile_max_depth(frameBuffer, tile_box);
+                    num_writes = 0;
+                }
+                if (triangle.depths.minCoeff() >= max_depth) {
+                    continue; // Occluded in the whole tile
+                }
+            }
+
+            const PixelBox box = bins.clip(tile, triangle.box);
+            const VertexAttributes& v1 = v[3 * t + 0];
+            const VertexAttributes& v2 = v[3 * t + 1];
+            const VertexAttributes& v3 = v[3 * t + 2];
+            for (int j = box.ly; j <= box.uy; j++) {
+                // The pixel center is offset by 0.5, 0.5, and the edge
+                // functions are linear along the row.
+                Vector3F b = triangle.Ai * Vector3F(box.lx + 0.5, j + 0.5, 1);
+                for (int i = box.lx; i <= box.ux;
+                     i++, b += triangle.Ai.col(0)) {
+                    if (!(b.minCoeff() >= 0)) {
+                        continue; // Outside (or a degenerate triangle)
+                    }
+                    FrameBufferAttributes& pixel = frameBuffer(i, j);
+                    if (shaders.depth_test
+                        && !shaders.depth_test(triangle.depths.dot(b), pixel)) {
+                        continue;
+                    }
+                    VertexAttributes va = VertexAttributes::interpolate(
+                        v1, v2, v3, b[0], b[1], b[2]);
+                    // Only render fragments within the bi-unit cube
+                    if (va.position.z() >= -1 && va.position.z() <= 1) {
+                        FragmentAttributes frag =
+                            shaders.fragment_shader(va, uniform);
+                        shaders.blending_shader(frag, pixel);
+                        num_writes++;
+                    }
+                }
+            }
+        }
     });
 }
 
@@ -185,12 +386,74 @@ void rasterize_lines(
         v[i] = shaders.vertex_shader(vertices[i], uniform);
     });
 
-    // Call the rasterization function on every line
+    // Project the endpoints of every line to pixels (parallel)
     assert(vertices.size() % 2 == 0);
-    tbb::parallel_for(size_t(0), vertices.size() / 2, [&](size_t i) {
-        rasterize_line(
-            shaders, uniform, v[i * 2 + 0], v[i * 2 + 1], line_thickness,
-            frameBuffer);
+    const size_t num_lines = vertices.size() / 2;
+    std::vector<Vector2F> endpoints(vertices.size());
+    std::vector<PixelBox> boxes(num_lines);
+    std::vector<bool> is_visible(num_lines);
+    tbb::parallel_for(size_t(0), num_lines, [&](size_t l) {
+        for (int k = 0; k < 2; k++) {
+            const Vector4F& position = v[2 * l + k].position;
+            endpoints[2 * l + k] << //
+                (position.x() / position.w() + 1.0) / 2.0 * frameBuffer.rows(),
+                (position.y() / position.w() + 1.0) / 2.0 * frameBuffer.cols();
+        }
+        const Vector2F& l1 = endpoints[2 * l];
+        const Vector2F& l2 = endpoints[2 * l + 1];
+        is_visible[l] = clamp_pixel_box(
+            std::min(l1.x(), l2.x()) - line_thickness,
+            std::min(l1.y(), l2.y()) - line_thickness,
+            std::max(l1.x(), l2.x()) + line_thickness,
+            std::max(l1.y(), l2.y()) + line_thickness, frameBuffer, boxes[l]);
+    });
+
+    // Bin the lines by the tiles they overlap
+    TileBins bins(frameBuffer);
+    for (size_t l = 0; l < num_lines; l++) {
+        if (is_visible[l]) {
+            bins.add(l, boxes[l]);
+        }
+    }
+
+    // Every tile is rasterized by a single thread, so the pixels need no
+    // locking.
+    tbb::parallel_for(size_t(0), bins.num_tiles(), [&](size_t tile) {
+        for (const size_t l : bins[tile]) {
+            // Parametrize the line as l1 + t (l2-l1)
+            const Vector2F& l1 = endpoints[2 * l];
+            const Vector2F& l2 = endpoints[2 * l + 1];
+            const Float ll = (l1 - l2).squaredNorm();
+
+            const PixelBox box = bins.clip(tile, boxes[l]);
+            for (int j = box.ly; j <= box.uy; j++) {
+                for (int i = box.lx; i <= box.ux; i++) {
+                    // The pixel center is offset by 0.5, 0.5
+                    Vector2F pixel(i + 0.5, j + 0.5);
+
+                    Float t = 0; // Zero if the segment has zero length
+                    if (ll != 0.0) {
+                        // Project p on the line and clamp between 0 and 1
+                        t = (pixel - l1).dot(l2 - l1) / ll;
+                        t = std::fmax(0, std::fmin(1, t));
+                    }
+
+                    Vector2F pixel_p = l1 + t * (l2 - l1);
+                    if ((pixel - pixel_p).squaredNorm()
+                        >= (line_thickness * line_thickness)) {
+                        continue;
+                    }
+                    VertexAttributes va = VertexAttributes::interpolate(
+                        v[2 * l], v[2 * l + 1], v[2 * l], 1 - t, t, 0);
+                    // Only render fragments within the bi-unit cube
+                    if (va.position[2] >= -1 && va.position[2] <= 1) {
+                        FragmentAttributes frag =
+                            shaders.fragment_shader(va, uniform);
+                        shaders.blending_shader(frag, frameBuffer(i, j));
+                    }
+                }
+            }
+        }
     });
 }
 
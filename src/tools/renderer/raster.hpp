@@ -1,6 +1,7 @@
 #pragma once
 
 #include <Eigen/Core>
+#include <functional>
 #include <string>
 #include <vector>
 
@@ -22,6 +23,10 @@ public:
     // Blending Shader
     std::function<void(const FragmentAttributes&, FrameBufferAttributes&)>
         blending_shader;
+    // Optional early depth test of a fragment's depth (-z) against a pixel.
+    // If set, fragments failing it are not shaded and triangles are drawn
+    // front to back, skipping the ones behind everything in a tile.
+    std::function<bool(Float, const FrameBufferAttributes&)> depth_test;
 };
 
 // Rasterizes a single triangle v1,v2,v3 using the provided shaders and
@@ -37,7 +42,8 @@ void rasterize_triangle(
 
 // Rasterizes a collection of triangles, assembling one triangle for each 3
 // consecutive vertices. Note: the vertices will be processed by the vertex
-// shader
+// shader. The triangles are binned into tiles of the framebuffer that are
+// rasterized in parallel.
 void rasterize_triangles(
     const Shaders& shaders,
     const UniformAttributes& uniform,
@@ -56,7 +62,8 @@ void rasterize_line(
     FrameBuffer& frameBuffer);
 
 // Rasterizes a collection of lines, assembling one line for each 2 consecutive
-// vertices. Note: the vertices will be processed by the vertex shader
+// vertices. Note: the vertices will be processed by the vertex shader. The
+// lines are binned into tiles of the framebuffer like the triangles.
 void rasterize_lines(
     const Shaders& shaders,
     const UniformAttributes& uniform,
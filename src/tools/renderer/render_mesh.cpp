@@ -45,6 +45,32 @@ UniformAttributes build_uniform(const Scene& scene)
     return uniform;
 }
 
+ViewFrustum::ViewFrustum(const Scene& scene)
+    : M(build_uniform(scene).M)
+{
+}
+
+bool ViewFrustum::is_box_visible(
+    const Vector3F& box_min, const Vector3F& box_max) const
+{
+    // Canonical coordinates of the corners of the box
+    Eigen::Matrix<Float, 3, 8> corners;
+    for (int i = 0; i < 8; i++) {
+        Vector4F corner;
+        for (int k = 0; k < 3; k++) {
+            corner(k) = (i >> k) & 1 ? box_max(k) : box_min(k);
+        }
+        corner(3) = 1;
+        corner = M * corner;
+        if (corner.w() <= 0) {
+            return true; // Behind the eye, so the projection is not bounded
+        }
+        corners.col(i) = corner.head<3>() / corner.w();
+    }
+    return (corners.rowwise().maxCoeff().array() >= -1).all()
+        && (corners.rowwise().minCoeff().array() <= 1).all();
+}
+
 Shaders create_face_shaders()
 {
     Shaders shaders;
@@ -118,6 +144,10 @@ Shaders create_face_shaders()
         }
     };
 
+    shaders.depth_test = [](Float depth, const FrameBufferAttributes& pixel) {
+        return depth < pixel.depth;
+    };
+
     return shaders;
 }
 
@@ -153,7 +183,73 @@ Shaders create_edge_shaders()
     return shaders;
 }
 
-// Render a mesh with vertices V, edges E, faces F, and vertex colors C
+namespace {
+    // Render a mesh with vertices V, edges E, faces F, and vertex colors C
+    void rasterize_mesh(
+        const Scene& scene,
+        const Eigen::MatrixXd& V,
+        const Eigen::MatrixXi& E,
+        const Eigen::MatrixXi& F,
+        const Eigen::VectorXi& C,
+        FrameBuffer& frame_buffer)
+    {
+        UniformAttributes uniform = build_uniform(scene);
+
+        std::vector<VertexAttributes> face_vertex_attributes;
+        for (int i = 0; i < F.rows(); i++) {
+            Vector3F l1 = (V.row(F(i, 1)) - V.row(F(i, 0))).cast<Float>();
+            Vector3F l2 = (V.row(F(i, 2)) - V.row(F(i, 0))).cast<Float>();
+            Vector3F normal = (l1).cross(l2).normalized();
+            for (int j = 0; j < 3; j++) {
+                VertexAttributes va(V.row(F(i, j)).cast<Float>());
+                va.material = scene.materials[C[F(i, j)]];
+                va.normal = normal;
+                face_vertex_attributes.push_back(va);
+            }
+        }
+        rasterize_triangles(
+            create_face_shaders(), uniform, face_vertex_attributes,
+            frame_buffer);
+
+        if (scene.line_thickness > 0) {
+            // draw wireframe on top
+            std::vector<VertexAttributes> edge_vertex_attributes;
+            for (int i = 0; i < E.rows(); i++) {
+                for (int j = 0; j < E.cols(); j++) {
+                    VertexAttributes va(V.row(E(i, j)).cast<Float>());
+                    va.material = scene.materials[C[E(i, j)]];
+                    va.normal.setZero();
+                    edge_vertex_attributes.push_back(va);
+                }
+            }
+            rasterize_lines(
+                create_edge_shaders(), uniform, edge_vertex_attributes,
+                scene.line_thickness, frame_buffer);
+        }
+    }
+
+    FrameBuffer create_scene_frame_buffer(const Scene& scene)
+    {
+        return create_frame_buffer(
+            scene.camera.resolution,
+            round(scene.background_color.array().max(0).min(1) * 255)
+                .cast<uint8_t>());
+    }
+} // namespace
+
+void render_mesh(
+    const Scene& scene,
+    const Eigen::MatrixXd& V,
+    const Eigen::MatrixXi& E,
+    const Eigen::MatrixXi& F,
+    const Eigen::VectorXi& C,
+    std::vector<uint8_t>& image)
+{
+    FrameBuffer frame_buffer = create_scene_frame_buffer(scene);
+    rasterize_mesh(scene, V, E, F, C, frame_buffer);
+    framebuffer_to_uint8(frame_buffer, image);
+}
+
 bool render_mesh(
     const Scene& scene,
     const Eigen::MatrixXd& V,
@@ -162,43 +258,8 @@ bool render_mesh(
     const Eigen::VectorXi& C,
     const std::string& filename)
 {
-    UniformAttributes uniform = build_uniform(scene);
-
-    FrameBuffer frame_buffer = create_frame_buffer(
-        scene.camera.resolution,
-        round(scene.background_color.array().max(0).min(1) * 255)
-            .cast<uint8_t>());
-
-    std::vector<VertexAttributes> face_vertex_attributes;
-    for (int i = 0; i < F.rows(); i++) {
-        Vector3F l1 = (V.row(F(i, 1)) - V.row(F(i, 0))).cast<Float>();
-        Vector3F l2 = (V.row(F(i, 2)) - V.row(F(i, 0))).cast<Float>();
-        Vector3F normal = (l1).cross(l2).normalized();
-        for (int j = 0; j < 3; j++) {
-            VertexAttributes va(V.row(F(i, j)).cast<Float>());
-            va.material = scene.materials[C[F(i, j)]];
-            va.normal = normal;
-            face_vertex_attributes.push_back(va);
-        }
-    }
-    rasterize_triangles(
-        create_face_shaders(), uniform, face_vertex_attributes, frame_buffer);
-
-    if (scene.line_thickness > 0) {
-        // draw wireframe on top
-        std::vector<VertexAttributes> edge_vertex_attributes;
-        for (int i = 0; i < E.rows(); i++) {
-            for (int j = 0; j < E.cols(); j++) {
-                VertexAttributes va(V.row(E(i, j)).cast<Float>());
-                va.material = scene.materials[C[E(i, j)]];
-                va.normal.setZero();
-                edge_vertex_attributes.push_back(va);
-            }
-        }
-        rasterize_lines(
-            create_edge_shaders(), uniform, edge_vertex_attributes,
-            scene.line_thickness, frame_buffer);
-    }
+    FrameBuffer frame_buffer = create_scene_frame_buffer(scene);
+    rasterize_mesh(scene, V, E, F, C, frame_buffer);
 
     // Convert Framebuffer to RGBA matrices
     Eigen::Matrix<uint8_t, Eigen::Dynamic, Eigen::Dynamic> R, G, B, A;
@@ -22,8 +22,32 @@ struct Scene {
     Scene(const nlohmann::json&);
 };
 
+/// View volume of a scene's camera, used to cull whole objects
+class ViewFrustum {
+public:
+    ViewFrustum(const Scene& scene);
+
+    /// Can any part of the world-space box be inside the view volume?
+    /// (Conservative: only boxes entirely outside one of its planes are
+    /// rejected.)
+    bool is_box_visible(const Vector3F& box_min, const Vector3F& box_max) const;
+
+protected:
+    Matrix4F M; ///< World to canonical view volume
+};
+
+/// Render a mesh with vertices V, edges E, faces F, and vertex material
+/// indicies C to an RGBA image (top row first)
+void render_mesh(
+    const Scene& scene,
+    const Eigen::MatrixXd& V,
+    const Eigen::MatrixXi& E,
+    const Eigen::MatrixXi& F,
+    const Eigen::VectorXi& C,
+    std::vector<uint8_t>& image);
+
 /// Render a mesh with vertices V, edges E, faces F, and vertex material
-/// indicies C
+/// indicies C to a PNG file
 bool render_mesh(
     const Scene& scene,
     const Eigen::MatrixXd& V,
@@ -0,0 +1,231 @@
+// Replay a binary log of narrow-phase CCD queries (see --ccd-query-log of
+// rigid_ipc_sim) and report the latency and thread scaling of every
+// trajectory type.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+#include <CLI/CLI.hpp>
+#include <tbb/parallel_for.h>
+#include <tbb/task_arena.h>
+#include <tbb/task_scheduler_init.h>
+
+#include <ccd/ccd.hpp>
+#include <ccd/ccd_query_log.hpp>
+#include <logger.hpp>
+
+using namespace ipc;
+using namespace ipc::rigid;
+
+struct ReplayQuery {
+    CCDQueryType type;
+    RigidBodyAssembler bodies;
+    PosesD poses_t0, poses_t1;
+    double earliest_toi;
+    double minimum_separation_distance;
+};
+
+/// @brief Body with only the primitive of the query in the logged frame.
+RigidBody create_body(const CCDQueryRecord& record, int body)
+{
+    const int num_vertices = record.num_vertices(body);
+    Eigen::MatrixXd vertices(num_vertices, record.dim);
+    for (int i = 0; i < num_vertices; i++) {
+        for (int j = 0; j < record.dim; j++) {
+            vertices(i, j) = record.vertices[body][i][j];
+        }
+    }
+    Eigen::MatrixXi edges, faces;
+    if (num_vertices == 2) {
+        edges.resize(1, 2);
+        edges.row(0) << 0, 1;
+    } else if (num_vertices == 3) {
+        faces.resize(1, 3);
+        faces.row(0) << 0, 1, 2;
+        edges.resize(3, 2);
+        edges.row(0) << 0, 1;
+        edges.row(1) << 1, 2;
+        edges.row(2) << 2, 0;
+    }
+
+    PoseD pose = PoseD::Zero(record.dim);
+    RigidBody rb(
+        vertices, edges, faces, pose,
+        /*velocity=*/PoseD::Zero(pose.dim()),
+        /*force=*/PoseD::Zero(pose.dim()),
+        /*density=*/1.0,
+        /*is_dof_fixed=*/VectorMax6b::Zero(pose.ndof()),
+        /*oriented=*/false,
+        /*group_id=*/body);
+    // Cancel out the inertial frame and keep the bounds of the logged body
+    rb.vertices = vertices;
+    rb.pose.position.setZero();
+    rb.pose.rotation.setZero();
+    rb.r_max = record.r_max[body];
+    return rb;
+}
+
+ReplayQuery create_query(const CCDQueryRecord& record)
+{
+    ReplayQuery query;
+    query.type = record.type;
+    query.bodies.init({ create_body(record, 0), create_body(record, 1) });
+    query.poses_t0 = { record.pose(0, 0), record.pose(1, 0) };
+    query.poses_t1 = { record.pose(0, 1), record.pose(1, 1) };
+    query.earliest_toi = record.earliest_toi;
+    query.minimum_separation_distance = record.minimum_separation_distance;
+    return query;
+}
+
+bool run_query(const ReplayQuery& query, TrajectoryType trajectory)
+{
+    double toi;
+    switch (query.type) {
+    case CCDQueryType::EDGE_VERTEX:
+        return edge_vertex_ccd(
+            query.bodies, query.poses_t0, query.poses_t1,
+            /*bodyA_id=*/0, /*vertex_id=*/0, /*bodyB_id=*/1, /*edge_id=*/0,
+            toi, trajectory, query.earliest_toi,
+            query.minimum_separation_distance);
+    case CCDQueryType::EDGE_EDGE:
+        return edge_edge_ccd(
+            query.bodies, query.poses_t0, query.poses_t1,
+            /*bodyA_id=*/0, /*edgeA_id=*/0, /*bodyB_id=*/1, /*edgeB_id=*/0,
+            toi, trajectory, query.earliest_toi,
+            query.minimum_separation_distance);
+    case CCDQueryType::FACE_VERTEX:
+        return face_vertex_ccd(
+            query.bodies, query.poses_t0, query.poses_t1,
+            /*bodyA_id=*/0, /*vertex_id=*/0, /*bodyB_id=*/1, /*face_id=*/0,
+            toi, trajectory, query.earliest_toi,
+            query.minimum_separation_distance);
+    }
+    return false;
+}
+
+/// @brief Nearest-rank percentile of sorted values.
+double percentile(const std::vector<double>& sorted_values, double p)
+{
+    if (sorted_values.empty()) {
+        return 0;
+    }
+    const size_t n = sorted_values.size();
+    const size_t rank = std::max(size_t(std::ceil(p * n)), size_t(1));
+    return sorted_values[std::min(rank, n) - 1];
+}
+
+double seconds_since(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double>(
+               std::chrono::steady_clock::now() - start)
+        .count();
+}
+
+int main(int argc, char* argv[])
+{
+    CLI::App app("replay logged narrow-phase CCD queries");
+
+    std::string log_path;
+    app.add_option("log_path,-i,--input", log_path, "CCD query log")
+        ->required();
+
+    int repeat = 10;
+    app.add_option("--repeat", repeat, "timed runs of every query")
+        ->default_val(repeat);
+
+    int max_threads = tbb::task_scheduler_init::default_num_threads();
+    app.add_option(
+           "--max-threads", max_threads,
+           "largest number of threads of the scaling runs")
+        ->default_val(max_threads);
+
+    CLI11_PARSE(app, argc, argv);
+
+    set_logger_level(spdlog::level::warn);
+    repeat = std::max(repeat, 1);
+
+    std::vector<CCDQueryRecord> records;
+    if (!read_ccd_query_log(log_path, records)) {
+        return 1;
+    }
+    std::vector<ReplayQuery> queries;
+    queries.reserve(records.size());
+    for (const CCDQueryRecord& record : records) {
+        queries.push_back(create_query(record));
+    }
+    fmt::print("num_queries={:d}\n", queries.size());
+
+    const std::array<TrajectoryType, 5> trajectories = { {
+        TrajectoryType::LINEAR,
+        TrajectoryType::PIECEWISE_LINEAR,
+        TrajectoryType::RIGID,
+        TrajectoryType::REDON,
+        TrajectoryType::CONSERVATIVE_ADVANCEMENT,
+    } };
+    const std::array<CCDQueryType, 3> types = { {
+        CCDQueryType::EDGE_VERTEX,
+        CCDQueryType::EDGE_EDGE,
+        CCDQueryType::FACE_VERTEX,
+    } };
+    const std::array<const char*, 3> type_names = { { "ev", "ee", "fv" } };
+
+    // Single-threaded latency of every query
+    for (TrajectoryType trajectory : trajectories) {
+        const std::string trajectory_name = nlohmann::json(trajectory);
+        for (int t = 0; t < types.size(); t++) {
+            std::vector<double> latencies;
+            size_t num_impacts = 0;
+            for (const ReplayQuery& query : queries) {
+                if (query.type != types[t]) {
+                    continue;
+                }
+                bool is_impacting = false;
+                const auto start = std::chrono::steady_clock::now();
+                for (int i = 0; i < repeat; i++) {
+                    is_impacting = run_query(query, trajectory);
+                }
+                latencies.push_back(seconds_since(start) / repeat);
+                num_impacts += is_impacting;
+            }
+            if (latencies.empty()) {
+                continue;
+            }
+            std::sort(latencies.begin(), latencies.end());
+            fmt::print(
+                "trajectory={} query={} count={:d} impacts={:d} "
+                "p50={:g}s p99={:g}s max={:g}s\n",
+                trajectory_name, type_names[t], latencies.size(), num_impacts,
+                percentile(latencies, 0.5), percentile(latencies, 0.99),
+                latencies.back());
+        }
+    }
+
+    // Throughput of all queries with an increasing number of threads
+    for (TrajectoryType trajectory : trajectories) {
+        const std::string trajectory_name = nlohmann::json(trajectory);
+        double serial_time = 0;
+        for (int num_threads = 1; num_threads <= max_threads;
+             num_threads *= 2) {
+            tbb::task_arena arena(num_threads);
+            const auto start = std::chrono::steady_clock::now();
+            arena.execute([&] {
+                tbb::parallel_for(size_t(0), queries.size(), [&](size_t i) {
+                    for (int j = 0; j < repeat; j++) {
+                        run_query(queries[i], trajectory);
+                    }
+                });
+            });
+            const double time = seconds_since(start);
+            if (num_threads == 1) {
+                serial_time = time;
+            }
+            fmt::print(
+                "trajectory={} threads={:d} time={:g}s queries_per_sec={:g} "
+                "speedup={:g}\n",
+                trajectory_name, num_threads, time,
+                time > 0 ? repeat * queries.size() / time : 0,
+                time > 0 ? serial_time / time : 0);
+        }
+    }
+}
@@ -8,7 +8,8 @@ int main(int argc, char* argv[])
 {
     using namespace ipc::rigid;
 
-    CLI::App app("Generate GLTF/GLB animation from simulation results.");
+    CLI::App app("Generate GLTF/GLB animation (or compressed keyframes with "
+                 "a .kf output) from simulation results.");
 
     std::string sim_path = "";
     app.add_option(
@@ -19,6 +20,26 @@ int main(int argc, char* argv[])
     std::string output = "";
     app.add_option("output,-o,--output", output, "output filename")->required();
 
+    KeyframeSettings keyframe_settings;
+    app.add_option(
+        "--fps", keyframe_settings.frame_rate,
+        "output frames per second (every state if not positive)");
+    app.add_option(
+        "--position-tol", keyframe_settings.position_tolerance,
+        "keyframe position error relative to the scene's bounding box");
+    app.add_option(
+        "--rotation-tol", keyframe_settings.rotation_tolerance,
+        "keyframe rotation error in radians");
+
+    GltfSettings gltf_settings;
+    bool no_instancing = false;
+    app.add_flag(
+        "--no-instancing", no_instancing,
+        "write one glTF mesh per body even if bodies share their geometry");
+    app.add_flag(
+        "--quantize", gltf_settings.quantize_vertices,
+        "store glTF vertices as 16-bit integers (KHR_mesh_quantization)");
+
     spdlog::level::level_enum loglevel = spdlog::level::warn;
     app.add_option("--log,--loglevel", loglevel, "log level")
         ->default_val(loglevel)
@@ -32,6 +53,8 @@ int main(int argc, char* argv[])
     }
 
     set_logger_level(loglevel);
+    gltf_settings.instance_shared_geometry = !no_instancing;
+    gltf_settings.deduplicate_identical_geometry = !no_instancing;
 
     // Create the output directory if it does not exist
     fs::path output_path(output);
@@ -45,5 +68,10 @@ int main(int argc, char* argv[])
         return app.exit(
             CLI::Error("load_sim_failed", "Unable to load simulation result!"));
     }
-    sim.save_gltf(output);
+    if (output_path.extension() == ".kf") {
+        return sim.save_keyframes(output, keyframe_settings) ? 0 : 1;
+    }
+    const bool success =
+        sim.save_gltf(output, keyframe_settings.frame_rate, gltf_settings);
+    return success ? 0 : 1;
 }
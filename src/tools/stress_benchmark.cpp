@@ -0,0 +1,207 @@
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <map>
+
+#include <CLI/CLI.hpp>
+#include <nlohmann/json.hpp>
+
+#include <SimState.hpp>
+#include <logger.hpp>
+#include <tracer.hpp>
+#include <utils/stress_scenes.hpp>
+
+using namespace ipc::rigid;
+
+namespace {
+/// @brief Least-squares slope of log(y) against log(x) over the positive
+/// samples (NaN if fewer than two).
+double scaling_exponent(const std::vector<std::pair<double, double>>& xy)
+{
+    double n = 0, sx = 0, sy = 0, sxx = 0, sxy = 0;
+    for (const auto& [x, y] : xy) {
+        if (x > 0 && y > 0) {
+            const double lx = std::log(x), ly = std::log(y);
+            n++;
+            sx += lx;
+            sy += ly;
+            sxx += lx * lx;
+            sxy += lx * ly;
+        }
+    }
+    const double denominator = n * sxx - sx * sx;
+    if (n < 2 || denominator <= 0) {
+        return std::nan("");
+    }
+    return (n * sxy - sx * sy) / denominator;
+}
+
+double seconds_since(const std::chrono::steady_clock::time_point& start)
+{
+    return std::chrono::duration<double>(
+               std::chrono::steady_clock::now() - start)
+        .count();
+}
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    CLI::App app(
+        "Sweep the body and thread counts of a procedural scene and report "
+        "the scaling of every phase.");
+
+    std::string scene = "pile";
+    app.add_option("--scene", scene, "procedural scene")
+        ->check(CLI::IsMember(stress_scenes::scene_names()));
+
+    std::vector<size_t> body_counts = { 10, 100, 1000 };
+    app.add_option("--bodies", body_counts, "numbers of bodies");
+
+    std::vector<int> thread_counts = { 1 };
+    app.add_option("--threads", thread_counts, "numbers of threads");
+
+    int num_steps = 5;
+    app.add_option("--steps", num_steps, "time-steps per run");
+
+    unsigned seed = 0;
+    app.add_option("--seed", seed, "seed of the random scenes");
+
+    double timestep = 0.01;
+    app.add_option("--timestep", timestep, "timestep");
+
+    std::string output_path = "";
+    app.add_option("-o,--output", output_path, "JSON report");
+
+    spdlog::level::level_enum loglevel = spdlog::level::info;
+    app.add_option("--log,--loglevel", loglevel, "log level")
+        ->default_val(loglevel)
+        ->transform(CLI::CheckedTransformer(
+            SPDLOG_LEVEL_NAMES_TO_LEVELS, CLI::ignore_case));
+
+    try {
+        app.parse(argc, argv);
+    } catch (const CLI::ParseError& e) {
+        return app.exit(e);
+    }
+
+    set_logger_level(loglevel);
+    if (body_counts.empty() || thread_counts.empty()) {
+        return app.exit(CLI::Error(
+            "empty_sweep", "At least one body and thread count is required!"));
+    }
+
+    nlohmann::json report;
+    report["scene"] = scene;
+    report["num_steps"] = num_steps;
+    report["seed"] = seed;
+    report["runs"] = nlohmann::json::array();
+
+    // Seconds per step of every phase by thread count and number of bodies
+    typedef std::vector<std::pair<double, double>> Samples;
+    std::map<int, std::map<std::string, Samples>> phase_times;
+    std::map<int, std::map<size_t, double>> step_times;
+
+    for (const size_t num_bodies : body_counts) {
+        for (const int num_threads : thread_counts) {
+            auto start = std::chrono::steady_clock::now();
+            std::vector<RigidBody> rbs =
+                stress_scenes::stress_scene(scene, num_bodies, seed);
+            const double generate_time = seconds_since(start);
+
+            SimSettings settings;
+            settings.timestep = timestep;
+            settings.num_threads = num_threads;
+            settings.gravity = Eigen::Vector3d(0, -9.81, 0);
+
+            start = std::chrono::steady_clock::now();
+            SimState sim;
+            if (!sim.init(settings, std::move(rbs))) {
+                spdlog::error(
+                    "stress_benchmark action=init num_bodies={} failed",
+                    num_bodies);
+                return 1;
+            }
+            const double init_time = seconds_since(start);
+
+            tracer::Tracer::enable();
+            start = std::chrono::steady_clock::now();
+            for (int i = 0; i < num_steps; i++) {
+                sim.simulation_step();
+            }
+            const double step_time =
+                seconds_since(start) / std::max(num_steps, 1);
+            tracer::Tracer::disable();
+            const nlohmann::json scaling = tracer::Tracer::scaling_report();
+
+            nlohmann::json run;
+            run["num_bodies"] = num_bodies;
+            run["num_threads"] = num_threads;
+            run["generate_time"] = generate_time;
+            run["init_time"] = init_time;
+            run["step_time"] = step_time;
+            run["phases"] = nlohmann::json::object();
+            for (const auto& el : scaling["phases"].items()) {
+                const double phase_time = el.value()["wall_time"].get<double>()
+                    / std::max(num_steps, 1);
+                run["phases"][el.key()] = el.value();
+                run["phases"][el.key()]["time_per_step"] = phase_time;
+                phase_times[num_threads][el.key()].emplace_back(
+                    num_bodies, phase_time);
+            }
+            step_times[num_threads][num_bodies] = step_time;
+            phase_times[num_threads]["step"].emplace_back(
+                num_bodies, step_time);
+            report["runs"].push_back(run);
+
+            spdlog::info(
+                "stress_benchmark scene={} num_bodies={} num_threads={} "
+                "generate_time={:g}s init_time={:g}s step_time={:g}s",
+                scene, num_bodies, num_threads, generate_time, init_time,
+                step_time);
+        }
+    }
+
+    // Time per step grows as num_bodies^exponent
+    for (const auto& [num_threads, phases] : phase_times) {
+        for (const auto& [name, times] : phases) {
+            const double exponent = scaling_exponent(times);
+            report["scaling_exponents"][std::to_string(num_threads)][name] =
+                std::isfinite(exponent) ? nlohmann::json(exponent)
+                                        : nlohmann::json();
+            spdlog::info(
+                "stress_benchmark phase={} num_threads={} "
+                "scaling_exponent={:.3f}",
+                name, num_threads, exponent);
+        }
+    }
+
+    // Speedup of every thread count over the first one
+    const int base_threads = thread_counts.front();
+    for (const auto& [num_threads, times] : step_times) {
+        for (const auto& [num_bodies, step_time] : times) {
+            const double speedup =
+                step_times[base_threads][num_bodies] / step_time;
+            const double efficiency = base_threads > 0 && num_threads > 0
+                ? speedup * base_threads / num_threads
+                : std::nan("");
+            nlohmann::json& entry = report["speedups"]
+                                          [std::to_string(num_threads)]
+                                          [std::to_string(num_bodies)];
+            entry["speedup"] = speedup;
+            entry["efficiency"] = std::isfinite(efficiency)
+                ? nlohmann::json(efficiency)
+                : nlohmann::json();
+        }
+    }
+
+    if (!output_path.empty()) {
+        std::ofstream file(output_path);
+        if (!(file << report.dump(4) << std::endl)) {
+            spdlog::error(
+                "unable to write stress benchmark report filename={}",
+                output_path);
+            return 1;
+        }
+        spdlog::info("Stress benchmark report saved to {}", output_path);
+    }
+}
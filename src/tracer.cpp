@@ -0,0 +1,358 @@
+#include "tracer.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include <constants.hpp>
+#include <logger.hpp>
+
+namespace ipc::rigid {
+namespace tracer {
+
+    std::atomic<bool> Tracer::s_is_enabled(false);
+
+    namespace {
+        struct TraceEvent {
+            const char* name;
+            uint64_t start;
+            uint64_t end;
+        };
+
+        /// @brief Ring buffer written only by its owning thread.
+        struct ThreadBuffer {
+            explicit ThreadBuffer(size_t thread_id)
+                : events(Constants::TRACE_BUFFER_CAPACITY)
+                , thread_id(thread_id)
+            {
+            }
+
+            std::vector<TraceEvent> events;
+            /// @brief Number of events recorded since the last clear.
+            std::atomic<size_t> num_events { 0 };
+            const size_t thread_id;
+        };
+
+        std::mutex buffers_mutex;
+        /// @brief Buffers of every thread that ever recorded (kept alive after
+        /// the threads exit).
+        std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+
+        /// @brief Timestamp and time when the tracer was enabled.
+        uint64_t start_timestamp = 0;
+        std::chrono::steady_clock::time_point start_time;
+
+        ThreadBuffer& local_buffer()
+        {
+            thread_local std::shared_ptr<ThreadBuffer> buffer = [] {
+                std::lock_guard<std::mutex> lock(buffers_mutex);
+                buffers.push_back(
+                    std::make_shared<ThreadBuffer>(buffers.size()));
+                return buffers.back();
+            }();
+            return *buffer;
+        }
+
+        /// @brief Calibrate the timestamps against the steady clock.
+        double seconds_per_tick()
+        {
+#ifdef RIGID_IPC_TRACER_USE_TSC
+            const uint64_t ticks = timestamp() - start_timestamp;
+            const double seconds = std::chrono::duration<double>(
+                                       std::chrono::steady_clock::now()
+                                       - start_time)
+                                       .count();
+            return ticks > 0 ? seconds / ticks : 0;
+#else
+            return 1e-9;
+#endif
+        }
+
+        /// @brief Events still held by a buffer in recording order.
+        template <typename Visitor>
+        void for_each_event(const ThreadBuffer& buffer, Visitor visitor)
+        {
+            const size_t capacity = buffer.events.size();
+            const size_t n =
+                buffer.num_events.load(std::memory_order_acquire);
+            for (size_t i = n > capacity ? n - capacity : 0; i < n; i++) {
+                visitor(buffer.events[i % capacity]);
+            }
+        }
+
+        typedef std::pair<uint64_t, uint64_t> Interval;
+
+        /// @brief Disjoint sorted intervals with prefix sums of their lengths
+        /// for measuring how much of a window they cover.
+        class IntervalUnion {
+        public:
+            explicit IntervalUnion(std::vector<Interval> intervals)
+            {
+                std::sort(intervals.begin(), intervals.end());
+                for (const Interval& interval : intervals) {
+                    if (!m_intervals.empty()
+                        && interval.first <= m_intervals.back().second) {
+                        m_intervals.back().second = std::max(
+                            m_intervals.back().second, interval.second);
+                    } else {
+                        m_intervals.push_back(interval);
+                    }
+                }
+                m_prefix_lengths.resize(m_intervals.size() + 1, 0);
+                for (size_t i = 0; i < m_intervals.size(); i++) {
+                    m_prefix_lengths[i + 1] = m_prefix_lengths[i]
+                        + m_intervals[i].second - m_intervals[i].first;
+                }
+            }
+
+            /// @brief Covered length of [start, end].
+            uint64_t covered(uint64_t start, uint64_t end) const
+            {
+                return covered_before(end) - covered_before(start);
+            }
+
+        protected:
+            uint64_t covered_before(uint64_t t) const
+            {
+                // First interval ending after t
+                const size_t i = std::upper_bound(
+                                     m_intervals.begin(), m_intervals.end(), t,
+                                     [](uint64_t x, const Interval& interval) {
+                                         return x < interval.second;
+                                     })
+                    - m_intervals.begin();
+                uint64_t length = m_prefix_lengths[i];
+                if (i < m_intervals.size() && m_intervals[i].first < t) {
+                    length += t - m_intervals[i].first;
+                }
+                return length;
+            }
+
+            std::vector<Interval> m_intervals;
+            std::vector<uint64_t> m_prefix_lengths;
+        };
+    } // namespace
+
+    void Tracer::enable()
+    {
+        std::lock_guard<std::mutex> lock(buffers_mutex);
+        for (auto& buffer : buffers) {
+            buffer->num_events.store(0, std::memory_order_relaxed);
+        }
+        start_timestamp = timestamp();
+        start_time = std::chrono::steady_clock::now();
+        s_is_enabled.store(true, std::memory_order_release);
+    }
+
+    void Tracer::disable()
+    {
+        s_is_enabled.store(false, std::memory_order_release);
+    }
+
+    void Tracer::record(const char* name, uint64_t start, uint64_t end)
+    {
+        ThreadBuffer& buffer = local_buffer();
+        const size_t i = buffer.num_events.load(std::memory_order_relaxed);
+        buffer.events[i % buffer.events.size()] = { name, start, end };
+        buffer.num_events.store(i + 1, std::memory_order_release);
+    }
+
+    nlohmann::json Tracer::summary()
+    {
+        struct Stats {
+            size_t calls = 0;
+            uint64_t total = 0, max = 0;
+        };
+        // Static names are only compared by address
+        std::unordered_map<const char*, Stats> stats;
+
+        std::lock_guard<std::mutex> lock(buffers_mutex);
+        for (const auto& buffer : buffers) {
+            for_each_event(*buffer, [&](const TraceEvent& event) {
+                Stats& s = stats[event.name];
+                const uint64_t duration = event.end - event.start;
+                s.calls++;
+                s.total += duration;
+                s.max = std::max(s.max, duration);
+            });
+        }
+
+        // Identical names at different addresses are merged here
+        std::unordered_map<std::string, Stats> merged_stats;
+        for (const auto& [name, s] : stats) {
+            Stats& merged = merged_stats[name];
+            merged.calls += s.calls;
+            merged.total += s.total;
+            merged.max = std::max(merged.max, s.max);
+        }
+
+        const double scale = seconds_per_tick();
+        nlohmann::json summary = nlohmann::json::object();
+        for (const auto& [name, s] : merged_stats) {
+            summary[name] = { { "calls", s.calls },
+                              { "total_time", s.total * scale },
+                              { "max_time", s.max * scale } };
+        }
+        return summary;
+    }
+
+    nlohmann::json Tracer::scaling_report()
+    {
+        static const std::array<int, 4> thread_counts = { { 16, 32, 64, 128 } };
+
+        struct Phase {
+            size_t calls = 0;
+            uint64_t wall = 0, parallel = 0, work = 0, max_busy = 0;
+        };
+        std::unordered_map<std::string, Phase> phases;
+        size_t num_skipped = 0;
+
+        std::unique_lock<std::mutex> lock(buffers_mutex);
+        // Tasks end before their thread records anything else, so after the
+        // oldest event kept by a wrapped buffer no task is missing.
+        uint64_t complete_since = start_timestamp;
+        std::vector<std::pair<const char*, Interval>> phase_events;
+        std::vector<Interval> all_tasks;
+        std::vector<IntervalUnion> thread_tasks;
+        for (const auto& buffer : buffers) {
+            const size_t n = buffer->num_events.load(std::memory_order_acquire);
+            const size_t capacity = buffer->events.size();
+            if (n > capacity) {
+                complete_since =
+                    std::max(complete_since, buffer->events[n % capacity].end);
+            }
+            std::vector<Interval> tasks;
+            for_each_event(*buffer, [&](const TraceEvent& event) {
+                const Interval interval(event.start, event.end);
+                if (std::strstr(event.name, "::") != nullptr) {
+                    tasks.push_back(interval);
+                } else {
+                    phase_events.emplace_back(event.name, interval);
+                }
+            });
+            if (!tasks.empty()) {
+                all_tasks.insert(all_tasks.end(), tasks.begin(), tasks.end());
+                thread_tasks.emplace_back(std::move(tasks));
+            }
+        }
+        const double scale = seconds_per_tick();
+        lock.unlock();
+
+        const size_t num_task_threads = thread_tasks.size();
+        const IntervalUnion parallel_regions(std::move(all_tasks));
+        for (const auto& [name, interval] : phase_events) {
+            if (interval.first < complete_since) {
+                num_skipped++;
+                continue;
+            }
+            Phase& phase = phases[name];
+            phase.calls++;
+            phase.wall += interval.second - interval.first;
+            phase.parallel +=
+                parallel_regions.covered(interval.first, interval.second);
+            uint64_t max_busy = 0;
+            for (const IntervalUnion& tasks : thread_tasks) {
+                const uint64_t busy =
+                    tasks.covered(interval.first, interval.second);
+                phase.work += busy;
+                max_busy = std::max(max_busy, busy);
+            }
+            phase.max_busy += max_busy;
+        }
+
+        nlohmann::json report;
+        report["num_threads"] = num_task_threads;
+        report["num_skipped_calls"] = num_skipped;
+        report["phases"] = nlohmann::json::object();
+        for (const auto& [name, phase] : phases) {
+            // Amdahl's law with the single thread time estimated as the serial
+            // time plus the total work of the tasks
+            const uint64_t serial = phase.wall - phase.parallel;
+            const double serial_time = serial * scale;
+            const double work_time = phase.work * scale;
+            const double single_thread_time = serial_time + work_time;
+            const double f = single_thread_time > 0
+                ? serial_time / single_thread_time
+                : 1;
+            const auto amdahl_speedup = [&](int p) {
+                return 1 / (f + (1 - f) / p);
+            };
+
+            nlohmann::json& r = report["phases"][name];
+            r["calls"] = phase.calls;
+            r["wall_time"] = phase.wall * scale;
+            r["serial_time"] = serial_time;
+            r["parallel_time"] = phase.parallel * scale;
+            r["work_time"] = work_time;
+            r["serial_fraction"] = f;
+            r["parallelism"] = phase.parallel > 0
+                ? double(phase.work) / phase.parallel
+                : 1.0;
+            r["efficiency"] = phase.parallel > 0 && num_task_threads > 0
+                ? double(phase.work) / (phase.parallel * num_task_threads)
+                : 1.0;
+            // Busiest thread against the average thread
+            r["load_imbalance"] = phase.work > 0
+                ? double(phase.max_busy) * num_task_threads / phase.work - 1
+                : 0.0;
+            r["observed_speedup"] =
+                phase.wall > 0 ? single_thread_time / (phase.wall * scale) : 1;
+            if (f > 0) {
+                r["max_speedup"] = 1 / f;
+            } else {
+                r["max_speedup"] = nullptr; // Unbounded
+            }
+            for (int p : thread_counts) {
+                r["amdahl_speedup"][std::to_string(p)] = amdahl_speedup(p);
+            }
+            r["scales_beyond_16"] = amdahl_speedup(32)
+                >= Constants::SCALING_MIN_SPEEDUP_GAIN * amdahl_speedup(16);
+        }
+        return report;
+    }
+
+    bool Tracer::write_chrome_trace(const std::string& filename)
+    {
+        std::ofstream file(filename);
+        if (!file) {
+            spdlog::error("unable to open trace filename={}", filename);
+            return false;
+        }
+
+        std::lock_guard<std::mutex> lock(buffers_mutex);
+        const double us_per_tick = seconds_per_tick() * 1e6;
+
+        // Stream the events so large traces are never held in memory twice
+        file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+        bool is_first = true;
+        for (const auto& buffer : buffers) {
+            file << (is_first ? "" : ",")
+                 << fmt::format(
+                        "{{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,"
+                        "\"tid\":{0},\"args\":{{\"name\":\"thread {0}\"}}}}",
+                        buffer->thread_id);
+            is_first = false;
+
+            for_each_event(*buffer, [&](const TraceEvent& event) {
+                if (event.start < start_timestamp) {
+                    return; // Recorded before the tracer was enabled
+                }
+                file << fmt::format(
+                    ",{{\"name\":{},\"ph\":\"X\",\"pid\":0,\"tid\":{},"
+                    "\"ts\":{:.3f},\"dur\":{:.3f}}}",
+                    nlohmann::json(event.name).dump(), buffer->thread_id,
+                    (event.start - start_timestamp) * us_per_tick,
+                    (event.end - event.start) * us_per_tick);
+            });
+        }
+        file << "]}\n";
+        return bool(file);
+    }
+
+} // namespace tracer
+} // namespace ipc::rigid
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+#include <nlohmann/json.hpp>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define RIGID_IPC_TRACER_USE_TSC
+#elif defined(_M_X64) || defined(_M_IX86)
+#include <intrin.h>
+#define RIGID_IPC_TRACER_USE_TSC
+#endif
+
+namespace ipc::rigid {
+namespace tracer {
+
+    /// @brief Cheap monotonic timestamp (TSC ticks where available).
+    inline uint64_t timestamp()
+    {
+#ifdef RIGID_IPC_TRACER_USE_TSC
+        return __rdtsc();
+#else
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                   std::chrono::steady_clock::now().time_since_epoch())
+            .count();
+#endif
+    }
+
+    /// @brief Always compiled-in tracer of named scopes.
+    ///
+    /// Every thread records into its own fixed-size ring buffer, so recording
+    /// never locks and can be done inside TBB kernels. The buffers are merged
+    /// when reporting, which should not overlap with traced code. While
+    /// disabled a scope costs a single relaxed load.
+    class Tracer {
+    public:
+        static bool is_enabled()
+        {
+            return s_is_enabled.load(std::memory_order_relaxed);
+        }
+
+        /// @brief Clear all buffers and start recording.
+        static void enable();
+        static void disable();
+
+        /// @brief Record a scope of the calling thread.
+        /// @param name Static string naming the scope.
+        static void record(const char* name, uint64_t start, uint64_t end);
+
+        /// @brief Calls, total, and maximum time (sec) of each scope name.
+        static nlohmann::json summary();
+
+        /// @brief Write the recorded events in the Chrome trace format (also
+        /// read by Perfetto).
+        static bool write_chrome_trace(const std::string& filename);
+
+        /// @brief Amdahl analysis of the top-level scopes (phases).
+        ///
+        /// Scopes named "phase::task" are parallel tasks. For every phase the
+        /// time covered by at least one task is parallel and the rest is
+        /// serial. The serial fraction predicts the speedup at more threads
+        /// and the busy time of each thread measures the load imbalance.
+        /// Assumes a single traced computation at a time.
+        static nlohmann::json scaling_report();
+
+    protected:
+        static std::atomic<bool> s_is_enabled;
+    };
+
+    /// @brief Record the lifetime of the scope if the tracer is enabled.
+    class TraceScope {
+    public:
+        explicit TraceScope(const char* name)
+            : m_name(name)
+            , m_is_recording(Tracer::is_enabled())
+            , m_start(m_is_recording ? timestamp() : 0)
+        {
+        }
+        TraceScope(const TraceScope&) = delete;
+        TraceScope& operator=(const TraceScope&) = delete;
+        ~TraceScope()
+        {
+            if (m_is_recording) {
+                Tracer::record(m_name, m_start, timestamp());
+            }
+        }
+
+    protected:
+        const char* m_name;
+        bool m_is_recording;
+        uint64_t m_start;
+    };
+
+} // namespace tracer
+} // namespace ipc::rigid
+
+#define _TRACE_CONCAT_IMPL(A, B) A##B
+#define _TRACE_CONCAT(A, B) _TRACE_CONCAT_IMPL(A, B)
+#define TRACE_SCOPE(Name)                                                      \
+    ::ipc::rigid::tracer::TraceScope _TRACE_CONCAT(_TRACE_SCOPE_, __LINE__)(   \
+        Name)
@@ -0,0 +1,71 @@
+#include "async_task_queue.hpp"
+
+#include <algorithm>
+
+#include <logger.hpp>
+#include <tracer.hpp>
+
+namespace ipc::rigid {
+
+AsyncTaskQueue::AsyncTaskQueue(size_t capacity)
+    : m_capacity(std::max(capacity, size_t(1)))
+{
+    m_worker = std::thread(&AsyncTaskQueue::run, this);
+}
+
+AsyncTaskQueue::~AsyncTaskQueue()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_is_stopping = true;
+    }
+    m_task_added.notify_one();
+    m_worker.join();
+}
+
+void AsyncTaskQueue::push(std::function<void()> task)
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_task_done.wait(lock, [&] { return m_tasks.size() < m_capacity; });
+    m_tasks.push_back(std::move(task));
+    lock.unlock();
+    m_task_added.notify_one();
+}
+
+void AsyncTaskQueue::wait()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_task_done.wait(lock, [&] { return m_tasks.empty() && !m_is_busy; });
+}
+
+void AsyncTaskQueue::run()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (true) {
+        m_task_added.wait(
+            lock, [&] { return !m_tasks.empty() || m_is_stopping; });
+        if (m_tasks.empty()) {
+            break; // Stopping and all tasks are done
+        }
+
+        std::function<void()> task = std::move(m_tasks.front());
+        m_tasks.pop_front();
+        m_is_busy = true;
+        lock.unlock();
+        m_task_done.notify_all();
+
+        try {
+            TRACE_SCOPE("io_queue");
+            task();
+        } catch (const std::exception& e) {
+            spdlog::error(
+                "async_task_queue status=task_failed what={}", e.what());
+        }
+
+        lock.lock();
+        m_is_busy = false;
+        m_task_done.notify_all();
+    }
+}
+
+} // namespace ipc::rigid
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+namespace ipc::rigid {
+
+/// @brief Run tasks in order on a dedicated background thread.
+///
+/// The queue is bounded, so push() only blocks the caller when the worker
+/// falls behind by more than the capacity.
+class AsyncTaskQueue {
+public:
+    explicit AsyncTaskQueue(size_t capacity);
+    AsyncTaskQueue(const AsyncTaskQueue&) = delete;
+    AsyncTaskQueue& operator=(const AsyncTaskQueue&) = delete;
+    /// @brief Finish all queued tasks and join the worker.
+    ~AsyncTaskQueue();
+
+    /// @brief Queue a task, waiting for room if the queue is full.
+    void push(std::function<void()> task);
+
+    /// @brief Block until all queued tasks have finished.
+    void wait();
+
+    size_t capacity() const { return m_capacity; }
+
+protected:
+    void run();
+
+    const size_t m_capacity;
+    std::deque<std::function<void()>> m_tasks;
+    /// @brief Whether the worker is running a task.
+    bool m_is_busy = false;
+    bool m_is_stopping = false;
+
+    std::mutex m_mutex;
+    /// @brief Signaled when a task is added or the queue is stopping.
+    std::condition_variable m_task_added;
+    /// @brief Signaled when a task is removed or finished.
+    std::condition_variable m_task_done;
+
+    std::thread m_worker;
+};
+
+} // namespace ipc::rigid
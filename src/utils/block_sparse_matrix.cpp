@@ -0,0 +1,81 @@
+#include "block_sparse_matrix.hpp"
+
+namespace ipc::rigid {
+
+void BlockSparseMatrix::resize(size_t num_block_rows, int block_size)
+{
+    assert(block_size > 0 && block_size <= 6);
+    m_block_size = block_size;
+    m_block_columns.clear();
+    m_block_columns.resize(num_block_rows);
+}
+
+void BlockSparseMatrix::setZero()
+{
+    for (auto& block_column : m_block_columns) {
+        block_column.clear();
+    }
+}
+
+size_t BlockSparseMatrix::num_blocks() const
+{
+    size_t n = 0;
+    for (const auto& block_column : m_block_columns) {
+        n += block_column.size();
+    }
+    return n;
+}
+
+size_t BlockSparseMatrix::memory_bytes() const
+{
+    // Red-black tree nodes hold the pair, three pointers, and a color
+    typedef std::map<long, MatrixMax6d>::value_type Node;
+    return m_block_columns.capacity() * sizeof(std::map<long, MatrixMax6d>)
+        + num_blocks() * (sizeof(Node) + 4 * sizeof(void*));
+}
+
+BlockSparseMatrix& BlockSparseMatrix::operator+=(const BlockSparseMatrix& other)
+{
+    assert(other.m_block_size == m_block_size);
+    assert(other.m_block_columns.size() == m_block_columns.size());
+    for (long bj = 0; bj < other.m_block_columns.size(); bj++) {
+        for (const auto& [bi, block] : other.m_block_columns[bj]) {
+            add_block(bi, bj, block);
+        }
+    }
+    return *this;
+}
+
+void BlockSparseMatrix::to_sparse(Eigen::SparseMatrix<double>& A) const
+{
+    const int bs = m_block_size;
+    const long n = rows();
+    const size_t nnz = num_blocks() * bs * bs;
+
+    std::vector<int> outer_indices;
+    std::vector<int> inner_indices;
+    std::vector<double> values;
+    outer_indices.reserve(n + 1);
+    inner_indices.reserve(nnz);
+    values.reserve(nnz);
+
+    // Blocks within a column are ordered by block row, so the inner indices
+    // come out sorted and the matrix is already compressed.
+    for (const auto& block_column : m_block_columns) {
+        for (int c = 0; c < bs; c++) {
+            outer_indices.push_back(inner_indices.size());
+            for (const auto& [bi, block] : block_column) {
+                for (int r = 0; r < bs; r++) {
+                    inner_indices.push_back(bi * bs + r);
+                    values.push_back(block(r, c));
+                }
+            }
+        }
+    }
+    outer_indices.push_back(inner_indices.size());
+
+    A = Eigen::Map<const Eigen::SparseMatrix<double>>(
+        n, n, nnz, outer_indices.data(), inner_indices.data(), values.data());
+}
+
+} // namespace ipc::rigid
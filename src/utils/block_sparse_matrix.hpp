@@ -0,0 +1,71 @@
+#pragma once
+
+#include <map>
+#include <vector>
+
+#include <Eigen/Core>
+#include <Eigen/SparseCore>
+
+#include <utils/eigen_ext.hpp>
+
+namespace ipc::rigid {
+
+/// @brief Square block-sparse matrix of dense (at most 6×6) blocks.
+///
+/// Blocks are accumulated per (block row, block column) so assembling the
+/// Hessian of rigid bodies never has to sort or sum scalar triplets. The
+/// compressed column storage is built once in to_sparse().
+class BlockSparseMatrix {
+public:
+    BlockSparseMatrix() {}
+    BlockSparseMatrix(size_t num_block_rows, int block_size)
+    {
+        resize(num_block_rows, block_size);
+    }
+
+    /// @brief Resize the matrix and remove all blocks.
+    void resize(size_t num_block_rows, int block_size);
+
+    /// @brief Remove all blocks while keeping the dimensions.
+    void setZero();
+
+    long rows() const { return m_block_columns.size() * m_block_size; }
+    long cols() const { return rows(); }
+    int block_size() const { return m_block_size; }
+
+    /// @brief Number of stored (structurally nonzero) blocks.
+    size_t num_blocks() const;
+
+    /// @brief Approximate bytes allocated by the blocks (map nodes included).
+    size_t memory_bytes() const;
+
+    /// @brief Add a dense block to the block at (bi, bj).
+    template <typename Derived>
+    void add_block(long bi, long bj, const Eigen::MatrixBase<Derived>& block)
+    {
+        assert(bi >= 0 && bi < m_block_columns.size());
+        assert(bj >= 0 && bj < m_block_columns.size());
+        assert(block.rows() == m_block_size && block.cols() == m_block_size);
+
+        auto it = m_block_columns[bj].find(bi);
+        if (it == m_block_columns[bj].end()) {
+            m_block_columns[bj].emplace(bi, block);
+        } else {
+            it->second += block;
+        }
+    }
+
+    /// @brief Add all blocks of another matrix of the same dimensions.
+    BlockSparseMatrix& operator+=(const BlockSparseMatrix& other);
+
+    /// @brief Convert to a compressed column sparse matrix.
+    void to_sparse(Eigen::SparseMatrix<double>& A) const;
+
+protected:
+    int m_block_size = 0;
+
+    /// @brief Blocks of each block column ordered by block row.
+    std::vector<std::map<long, MatrixMax6d>> m_block_columns;
+};
+
+} // namespace ipc::rigid
@@ -0,0 +1,184 @@
+#include "block_sparse_skeleton.hpp"
+
+#include <algorithm>
+
+#include <utils/numa.hpp>
+
+namespace ipc::rigid {
+
+bool BlockSparseSkeleton::reserve_blocks(
+    size_t num_block_rows,
+    int block_size,
+    const std::vector<std::array<long, 2>>& blocks)
+{
+    if (block_size != m_block_size
+        || m_column_starts.size() != num_block_rows + 1) {
+        rebuild(num_block_rows, block_size, blocks);
+        return true;
+    }
+
+    m_is_used.assign(m_blocks.size(), false);
+    size_t num_used_off_diagonal = 0;
+    for (const auto& [bi, bj] : blocks) {
+        const long block_id = find_block(bi, bj);
+        if (block_id < 0) {
+            rebuild(num_block_rows, block_size, blocks);
+            return true;
+        }
+        if (bi != bj && !m_is_used[block_id]) {
+            m_is_used[block_id] = true;
+            num_used_off_diagonal++;
+        }
+    }
+
+    // Drop the blocks of constraints that are gone once they are the
+    // majority, so the factorization does not carry them forever.
+    if (2 * num_used_off_diagonal < m_blocks.size() - num_block_rows) {
+        rebuild(num_block_rows, block_size, blocks);
+        return true;
+    }
+    return false;
+}
+
+void BlockSparseSkeleton::rebuild(
+    size_t num_block_rows,
+    int block_size,
+    const std::vector<std::array<long, 2>>& blocks)
+{
+    assert(block_size > 0 && block_size <= 6);
+    m_block_size = block_size;
+
+    m_blocks.clear();
+    m_blocks.reserve(num_block_rows + blocks.size());
+    for (long i = 0; i < num_block_rows; i++) {
+        m_blocks.push_back({ { i, i } });
+    }
+    m_blocks.insert(m_blocks.end(), blocks.begin(), blocks.end());
+    std::sort(
+        m_blocks.begin(), m_blocks.end(),
+        [](const std::array<long, 2>& a, const std::array<long, 2>& b) {
+            return a[1] != b[1] ? a[1] < b[1] : a[0] < b[0];
+        });
+    m_blocks.erase(
+        std::unique(m_blocks.begin(), m_blocks.end()), m_blocks.end());
+
+    m_column_starts.assign(num_block_rows + 1, 0);
+    for (const auto& block : m_blocks) {
+        assert(block[0] >= 0 && block[0] < num_block_rows);
+        assert(block[1] >= 0 && block[1] < num_block_rows);
+        m_column_starts[block[1] + 1]++;
+    }
+    for (size_t bj = 0; bj < num_block_rows; bj++) {
+        m_column_starts[bj + 1] += m_column_starts[bj];
+    }
+
+    const long n = num_block_rows * block_size;
+    m_matrix.resize(n, n);
+    m_matrix.resizeNonZeros(m_blocks.size() * block_size * block_size);
+    int* outer_indices = m_matrix.outerIndexPtr();
+    int* inner_indices = m_matrix.innerIndexPtr();
+    for (long bj = 0; bj < num_block_rows; bj++) {
+        // Every block column holds at least its diagonal block
+        const long start = m_column_starts[bj];
+        for (int c = 0; c < block_size; c++) {
+            outer_indices[bj * block_size + c] = value_offset(start, c);
+            for (long id = start; id < m_column_starts[bj + 1]; id++) {
+                const long offset = value_offset(id, c);
+                for (int r = 0; r < block_size; r++) {
+                    inner_indices[offset + r] =
+                        m_blocks[id][0] * block_size + r;
+                }
+            }
+        }
+    }
+    outer_indices[n] = m_matrix.data().size();
+    m_free_outer_indices.clear();
+    // The values were just allocated
+    parallel_first_touch(m_matrix.valuePtr(), size_t(m_matrix.nonZeros()));
+}
+
+void BlockSparseSkeleton::setZero()
+{
+    std::fill_n(m_matrix.valuePtr(), m_matrix.nonZeros(), 0.0);
+}
+
+void BlockSparseSkeleton::free_matrix(
+    const Eigen::VectorXi& free_dof,
+    const std::vector<int>& full_to_free_dof,
+    Eigen::SparseMatrix<double>& A_free)
+{
+    assert(full_to_free_dof.size() == rows());
+    const int n = free_dof.size();
+
+    if (m_free_outer_indices.empty() || m_free_dof.size() != n
+        || m_free_dof != free_dof) {
+        m_free_dof = free_dof;
+        m_free_outer_indices.resize(n + 1);
+        m_free_inner_indices.clear();
+        m_free_value_ids.clear();
+        const int* outer_indices = m_matrix.outerIndexPtr();
+        const int* inner_indices = m_matrix.innerIndexPtr();
+        // The remap is increasing, so inner indices stay sorted
+        for (int k = 0; k < n; k++) {
+            m_free_outer_indices[k] = m_free_inner_indices.size();
+            for (int p = outer_indices[free_dof(k)];
+                 p < outer_indices[free_dof(k) + 1]; p++) {
+                const int r = full_to_free_dof[inner_indices[p]];
+                if (r >= 0) {
+                    m_free_inner_indices.push_back(r);
+                    m_free_value_ids.push_back(p);
+                }
+            }
+        }
+        m_free_outer_indices[n] = m_free_inner_indices.size();
+    }
+
+    // Resizing keeps the allocated storage of A_free
+    const size_t nnz = m_free_value_ids.size();
+    A_free.resize(n, n);
+    A_free.resizeNonZeros(nnz);
+    std::copy(
+        m_free_outer_indices.begin(), m_free_outer_indices.end(),
+        A_free.outerIndexPtr());
+    std::copy(
+        m_free_inner_indices.begin(), m_free_inner_indices.end(),
+        A_free.innerIndexPtr());
+    const double* values = m_matrix.valuePtr();
+    double* free_values = A_free.valuePtr();
+    for (size_t i = 0; i < nnz; i++) {
+        free_values[i] = values[m_free_value_ids[i]];
+    }
+}
+
+long BlockSparseSkeleton::find_block(long bi, long bj) const
+{
+    if (bj < 0 || bj + 1 >= m_column_starts.size()) {
+        return -1;
+    }
+    const auto begin = m_blocks.begin() + m_column_starts[bj];
+    const auto end = m_blocks.begin() + m_column_starts[bj + 1];
+    const auto it = std::lower_bound(
+        begin, end, bi,
+        [](const std::array<long, 2>& block, long row) {
+            return block[0] < row;
+        });
+    return it != end && (*it)[0] == bi ? it - m_blocks.begin() : -1;
+}
+
+void BlockSparseSkeleton::add(
+    const Eigen::SparseMatrix<double>& A, double scale)
+{
+    assert(A.rows() == rows() && A.cols() == cols());
+    double* values = m_matrix.valuePtr();
+    for (int k = 0; k < A.outerSize(); k++) {
+        for (Eigen::SparseMatrix<double>::InnerIterator it(A, k); it; ++it) {
+            const long block_id =
+                find_block(it.row() / m_block_size, it.col() / m_block_size);
+            assert(block_id >= 0);
+            values[value_offset(block_id, it.col() % m_block_size)
+                   + it.row() % m_block_size] += scale * it.value();
+        }
+    }
+}
+
+} // namespace ipc::rigid
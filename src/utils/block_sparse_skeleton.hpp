@@ -0,0 +1,119 @@
+#pragma once
+
+#include <array>
+#include <vector>
+
+#include <Eigen/Core>
+#include <Eigen/SparseCore>
+
+namespace ipc::rigid {
+
+/// @brief Persistent compressed column storage of a square block-sparse
+/// matrix whose values are updated in place.
+///
+/// The pattern always holds the diagonal blocks. It is only rebuilt when a
+/// block outside of it is needed or when most of its off-diagonal blocks go
+/// unused, so evaluating Hessians of the same structure never sorts,
+/// allocates, or adds sparse matrices.
+class BlockSparseSkeleton {
+public:
+    /// @brief Make sure the pattern holds the given blocks (duplicates are
+    /// allowed) and the diagonal ones.
+    /// @returns True if the pattern was rebuilt (the values are then zero).
+    bool reserve_blocks(
+        size_t num_block_rows,
+        int block_size,
+        const std::vector<std::array<long, 2>>& blocks);
+
+    /// @brief Zero the values while keeping the pattern.
+    void setZero();
+
+    long rows() const { return m_matrix.rows(); }
+    long cols() const { return m_matrix.cols(); }
+    int block_size() const { return m_block_size; }
+    /// @brief Number of blocks in the pattern.
+    size_t num_blocks() const { return m_blocks.size(); }
+
+    /// @brief Index of the block at (bi, bj) or -1 if not in the pattern.
+    long find_block(long bi, long bj) const;
+
+    /// @brief Add a scaled dense block to the block of the given index.
+    template <typename Derived>
+    void add_block(
+        long block_id, const Eigen::MatrixBase<Derived>& block, double scale)
+    {
+        assert(block_id >= 0 && block_id < m_blocks.size());
+        assert(block.rows() == m_block_size && block.cols() == m_block_size);
+        double* values = m_matrix.valuePtr();
+        for (int c = 0; c < m_block_size; c++) {
+            const long offset = value_offset(block_id, c);
+            for (int r = 0; r < m_block_size; r++) {
+                values[offset + r] += scale * block(r, c);
+            }
+        }
+    }
+
+    /// @brief Add a scaled sparse matrix whose entries are all inside the
+    /// pattern.
+    void add(const Eigen::SparseMatrix<double>& A, double scale);
+
+    /// @brief The matrix with the current values.
+    const Eigen::SparseMatrix<double>& matrix() const { return m_matrix; }
+
+    /// @brief The rows and columns of the free DoF of the matrix, gathered
+    /// into A_free (whose storage is reused).
+    ///
+    /// The gather map is cached until the pattern or the free DoF change, so
+    /// this usually only copies the kept values.
+    /// @param free_dof         Sorted indices of the free DoF.
+    /// @param full_to_free_dof Index of each DoF in free_dof (or -1).
+    void free_matrix(
+        const Eigen::VectorXi& free_dof,
+        const std::vector<int>& full_to_free_dof,
+        Eigen::SparseMatrix<double>& A_free);
+
+    /// @brief Values of the matrix, updated in place.
+    double* values() { return m_matrix.valuePtr(); }
+
+    /// @brief Index in the values of entry (r, c) of the given block.
+    long value_index(long block_id, int r, int c) const
+    {
+        return value_offset(block_id, c) + r;
+    }
+
+protected:
+    /// @brief Offset in the values of column c of a block (its rows are
+    /// contiguous).
+    long value_offset(long block_id, int c) const
+    {
+        const long bj = m_blocks[block_id][1];
+        const long start = m_column_starts[bj];
+        const long count = m_column_starts[bj + 1] - start;
+        return m_block_size
+            * (m_block_size * start + c * count + (block_id - start));
+    }
+
+    void rebuild(
+        size_t num_block_rows,
+        int block_size,
+        const std::vector<std::array<long, 2>>& blocks);
+
+    int m_block_size = 0;
+    /// @brief Blocks (block row, block column) sorted by column then row.
+    std::vector<std::array<long, 2>> m_blocks;
+    /// @brief Index of the first block of each block column (with the
+    /// number of blocks at the end).
+    std::vector<long> m_column_starts;
+    /// @brief Marks of the blocks requested by reserve_blocks().
+    std::vector<bool> m_is_used;
+    Eigen::SparseMatrix<double> m_matrix;
+
+    /// @brief Free DoF of the gather map of free_matrix().
+    Eigen::VectorXi m_free_dof;
+    /// @brief Pattern of free_matrix() (empty if the map is out of date).
+    std::vector<int> m_free_outer_indices, m_free_inner_indices;
+    /// @brief Index in the values of each entry of free_matrix().
+    std::vector<long> m_free_value_ids;
+};
+
+} // namespace ipc::rigid
@@ -0,0 +1,89 @@
+#include "cost_based_selector.hpp"
+
+#include <cassert>
+#include <cmath>
+
+namespace ipc::rigid {
+
+CostBasedSelector::CostBasedSelector(int num_strategies, int probe_period)
+    : m_costs(num_strategies, INFINITY)
+    , m_measured_at(num_strategies, 0)
+    , m_is_probed(num_strategies, false)
+    , m_probe_period(probe_period)
+{
+    assert(num_strategies > 0 && probe_period > 0);
+}
+
+CostBasedSelector::CostBasedSelector(const CostBasedSelector& other)
+    : CostBasedSelector(other.num_strategies(), other.m_probe_period)
+{
+}
+
+CostBasedSelector& CostBasedSelector::operator=(const CostBasedSelector& other)
+{
+    if (this != &other) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_costs.assign(other.num_strategies(), INFINITY);
+        m_measured_at.assign(other.num_strategies(), 0);
+        m_is_probed.assign(other.num_strategies(), false);
+        m_num_selections = 0;
+        m_probe_period = other.m_probe_period;
+    }
+    return *this;
+}
+
+int CostBasedSelector::select()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_num_selections++;
+
+    int cheapest = 0, oldest = 0;
+    for (int i = 0; i < num_strategies(); i++) {
+        if (std::isinf(m_costs[i])) {
+            return i;
+        }
+        if (m_costs[i] < m_costs[cheapest]) {
+            cheapest = i;
+        }
+        if (m_measured_at[i] < m_measured_at[oldest]) {
+            oldest = i;
+        }
+    }
+    if (m_num_selections % m_probe_period == 0) {
+        m_is_probed[oldest] = true;
+        return oldest;
+    }
+    return cheapest;
+}
+
+void CostBasedSelector::record(int strategy, double cost)
+{
+    assert(strategy >= 0 && strategy < num_strategies() && cost >= 0);
+    std::lock_guard<std::mutex> lock(m_mutex);
+    // A stale average says nothing about the current scene
+    if (std::isinf(m_costs[strategy]) || m_is_probed[strategy]) {
+        m_costs[strategy] = cost;
+        m_is_probed[strategy] = false;
+    } else {
+        m_costs[strategy] += Constants::STRATEGY_COST_SMOOTHING
+            * (cost - m_costs[strategy]);
+    }
+    m_measured_at[strategy] = m_num_selections;
+}
+
+void CostBasedSelector::reset()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_costs.assign(m_costs.size(), INFINITY);
+    m_measured_at.assign(m_measured_at.size(), 0);
+    m_is_probed.assign(m_is_probed.size(), false);
+    m_num_selections = 0;
+}
+
+double CostBasedSelector::cost(int strategy) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_costs[strategy];
+}
+
+} // namespace ipc::rigid
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <mutex>
+#include <vector>
+
+#include <constants.hpp>
+
+namespace ipc::rigid {
+
+/// @brief Choice among interchangeable strategies by their measured cost.
+///
+/// A running average of the cost of every strategy is kept. The strategies
+/// never measured are tried first, then the cheapest one is used and, once
+/// every probe period, the one measured least recently is probed again, so
+/// the choice follows a scene that changes (e.g., bodies that pile up). This
+/// is thread safe, and copies start over.
+class CostBasedSelector {
+public:
+    explicit CostBasedSelector(
+        int num_strategies,
+        int probe_period = Constants::STRATEGY_PROBE_PERIOD);
+    CostBasedSelector(const CostBasedSelector& other);
+    CostBasedSelector& operator=(const CostBasedSelector& other);
+
+    /// @brief Strategy to use next.
+    int select();
+
+    /// @brief Add a measured cost of a strategy to its average.
+    void record(int strategy, double cost);
+
+    /// @brief Forget all the measured costs.
+    void reset();
+
+    int num_strategies() const { return int(m_costs.size()); }
+
+    /// @brief Average cost of a strategy (infinite if never measured).
+    double cost(int strategy) const;
+
+protected:
+    std::vector<double> m_costs;
+    /// @brief Number of selections when each strategy was last measured.
+    std::vector<long> m_measured_at;
+    /// @brief Is a strategy selected for a probe (its next cost replaces the
+    /// stale average)?
+    std::vector<bool> m_is_probed;
+    long m_num_selections = 0;
+    int m_probe_period;
+
+    mutable std::mutex m_mutex;
+};
+
+} // namespace ipc::rigid
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+#include <tbb/partitioner.h>
+
+#include <constants.hpp>
+#include <utils/parallel_loop_tuner.hpp>
+
+namespace ipc::rigid {
+
+/// @brief Run body on subranges of [0, size) in parallel.
+///
+/// If deterministic is true, the subranges only depend on the size, so
+/// reductions merged in the order of their subranges produce
+/// bitwise-identical results whatever the thread scheduling and count. The
+/// switch is a setting of each simulation (see
+/// CollisionConstraint::deterministic), so concurrent simulations can differ.
+template <typename Body>
+void deterministic_parallel_for(bool deterministic, size_t size, Body body)
+{
+    if (deterministic) {
+        tbb::parallel_for(
+            tbb::blocked_range<size_t>(
+                size_t(0), size, Constants::DETERMINISTIC_GRAIN_SIZE),
+            body, tbb::simple_partitioner());
+    } else {
+        tbb::parallel_for(tbb::blocked_range<size_t>(size_t(0), size), body);
+    }
+}
+
+/// @brief Run body on subranges of [0, size) in parallel, tuned by the tuner
+/// unless deterministic is true.
+template <typename Body>
+void deterministic_parallel_for(
+    bool deterministic, size_t size, Body body, ParallelLoopTuner& tuner)
+{
+    if (deterministic) {
+        deterministic_parallel_for(deterministic, size, body);
+    } else {
+        tuner.parallel_for(size, body);
+    }
+}
+
+} // namespace ipc::rigid
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cassert>
+#include <type_traits>
+
+namespace ipc::rigid {
+
+/// @brief Compile-time dimension passed to the functor of dispatch_dim().
+template <int dim> using DimConstant = std::integral_constant<int, dim>;
+
+/// @brief Call f with the runtime dimension (2 or 3) as a DimConstant, so
+/// kernels can use fixed-size Eigen types.
+///
+/// Use `constexpr int DIM = decltype(dim_constant)::value;` inside f.
+template <typename Function> decltype(auto) dispatch_dim(int dim, Function f)
+{
+    assert(dim == 2 || dim == 3);
+    if (dim == 2) {
+        return f(DimConstant<2>());
+    }
+    return f(DimConstant<3>());
+}
+
+} // namespace ipc::rigid
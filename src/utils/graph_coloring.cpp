@@ -0,0 +1,61 @@
+#include "graph_coloring.hpp"
+
+#include <cassert>
+#include <cstdint>
+
+namespace ipc::rigid {
+
+void color_node_pairs(
+    const std::vector<std::array<long, 2>>& node_pairs,
+    size_t num_nodes,
+    int max_colors,
+    NodePairColoring& coloring)
+{
+    assert(max_colors > 0 && max_colors <= 64);
+    const uint64_t all_colors =
+        max_colors == 64 ? ~uint64_t(0) : (uint64_t(1) << max_colors) - 1;
+
+    // Bit c of a node's mask is set if an item of color c touches it
+    std::vector<uint64_t> used_colors(num_nodes, 0);
+    std::vector<int> colors(node_pairs.size());
+    // Counts of each color in [1, max_colors] and the uncolored at the end
+    std::vector<size_t> counts(max_colors + 2, 0);
+    for (size_t i = 0; i < node_pairs.size(); i++) {
+        const auto [n0, n1] = node_pairs[i];
+        assert(n0 >= 0 && n0 < num_nodes && n1 >= 0 && n1 < num_nodes);
+        const uint64_t free_colors =
+            ~(used_colors[n0] | used_colors[n1]) & all_colors;
+        if (free_colors == 0) {
+            colors[i] = max_colors;
+        } else {
+            int color = 0;
+            while (!(free_colors & (uint64_t(1) << color))) {
+                color++;
+            }
+            colors[i] = color;
+            used_colors[n0] |= uint64_t(1) << color;
+            used_colors[n1] |= uint64_t(1) << color;
+        }
+        counts[colors[i] + 1]++;
+    }
+
+    int num_colors = 0;
+    for (int c = 0; c < max_colors; c++) {
+        if (counts[c + 1] != 0) {
+            num_colors = c + 1;
+        }
+    }
+
+    // Counting sort keeps the items of a group in increasing order
+    for (int c = 0; c <= max_colors; c++) {
+        counts[c + 1] += counts[c];
+    }
+    coloring.color_starts.assign(counts.begin(), counts.begin() + num_colors);
+    coloring.color_starts.push_back(counts[max_colors]);
+    coloring.items.resize(node_pairs.size());
+    for (size_t i = 0; i < node_pairs.size(); i++) {
+        coloring.items[counts[colors[i]]++] = i;
+    }
+}
+
+} // namespace ipc::rigid
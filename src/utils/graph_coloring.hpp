@@ -0,0 +1,42 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <vector>
+
+namespace ipc::rigid {
+
+/// @brief Items (e.g., constraints) grouped so that no two items of a color
+/// touch the same node (e.g., body).
+struct NodePairColoring {
+    /// @brief Items of each color followed by the uncolored ones (each group
+    /// in increasing order).
+    std::vector<size_t> items;
+    /// @brief Index in items of the first item of each color (with the
+    /// index of the first uncolored item at the end).
+    std::vector<size_t> color_starts;
+
+    size_t num_colors() const
+    {
+        return color_starts.empty() ? 0 : color_starts.size() - 1;
+    }
+    size_t num_uncolored() const
+    {
+        return items.size() - (color_starts.empty() ? 0 : color_starts.back());
+    }
+};
+
+/// @brief Greedy (first fit) coloring of items touching two nodes each.
+///
+/// Items that would need more than max_colors colors (e.g., many contacts
+/// of one body) are left uncolored.
+///
+/// @param node_pairs  Nodes touched by each item (in [0, num_nodes)).
+/// @param max_colors  Largest number of colors (at most 64).
+void color_node_pairs(
+    const std::vector<std::array<long, 2>>& node_pairs,
+    size_t num_nodes,
+    int max_colors,
+    NodePairColoring& coloring);
+
+} // namespace ipc::rigid
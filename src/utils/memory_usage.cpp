@@ -0,0 +1,96 @@
+#include "memory_usage.hpp"
+
+#include <algorithm>
+
+namespace ipc::rigid {
+
+std::array<std::atomic<int64_t>, MemoryUsage::NUM_SUBSYSTEMS>
+    MemoryUsage::s_bytes = {};
+std::array<std::atomic<int64_t>, MemoryUsage::NUM_SUBSYSTEMS>
+    MemoryUsage::s_peak_bytes = {};
+
+namespace {
+    const char* const SUBSYSTEM_NAMES[MemoryUsage::NUM_SUBSYSTEMS] = {
+        "meshes",
+        "bvhs",
+        "hash_grid",
+        "candidates",
+        "constraints",
+        "hessian_triplets",
+        "world_vertices_diff",
+        "state_history",
+    };
+} // namespace
+
+void MemoryUsage::set_bytes(Subsystem subsystem, size_t bytes)
+{
+    s_bytes[subsystem].store(bytes, std::memory_order_relaxed);
+    update_peak(subsystem, bytes);
+}
+
+void MemoryUsage::add_bytes(Subsystem subsystem, int64_t bytes)
+{
+    const int64_t current =
+        s_bytes[subsystem].fetch_add(bytes, std::memory_order_relaxed)
+        + bytes;
+    update_peak(subsystem, std::max(current, int64_t(0)));
+}
+
+void MemoryUsage::update_peak(Subsystem subsystem, size_t bytes)
+{
+    std::atomic<int64_t>& peak = s_peak_bytes[subsystem];
+    int64_t old_peak = peak.load(std::memory_order_relaxed);
+    while (old_peak < int64_t(bytes)
+           && !peak.compare_exchange_weak(
+               old_peak, bytes, std::memory_order_relaxed)) { }
+}
+
+size_t MemoryUsage::bytes(Subsystem subsystem)
+{
+    return std::max(
+        s_bytes[subsystem].load(std::memory_order_relaxed), int64_t(0));
+}
+
+size_t MemoryUsage::peak_bytes(Subsystem subsystem)
+{
+    return s_peak_bytes[subsystem].load(std::memory_order_relaxed);
+}
+
+void MemoryUsage::reset()
+{
+    for (int i = 0; i < NUM_SUBSYSTEMS; i++) {
+        s_bytes[i].store(0, std::memory_order_relaxed);
+        s_peak_bytes[i].store(0, std::memory_order_relaxed);
+    }
+}
+
+nlohmann::json MemoryUsage::to_json()
+{
+    nlohmann::json usage;
+    for (int i = 0; i < NUM_SUBSYSTEMS; i++) {
+        usage[SUBSYSTEM_NAMES[i]] = {
+            { "bytes", bytes(Subsystem(i)) },
+            { "peak_bytes", peak_bytes(Subsystem(i)) },
+        };
+    }
+    return usage;
+}
+
+size_t MemoryUsage::json_bytes(const nlohmann::json& json)
+{
+    size_t bytes = sizeof(nlohmann::json);
+    if (json.is_string()) {
+        bytes += json.get_ref<const std::string&>().capacity();
+    } else if (json.is_object()) {
+        for (const auto& el : json.items()) {
+            bytes += el.key().capacity() + json_bytes(el.value());
+        }
+    } else if (json.is_array()) {
+        for (const auto& value : json) {
+            bytes += json_bytes(value);
+        }
+    }
+    return bytes;
+}
+
+} // namespace ipc::rigid
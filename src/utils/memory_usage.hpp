@@ -0,0 +1,91 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+#include <Eigen/Core>
+#include <Eigen/SparseCore>
+#include <nlohmann/json.hpp>
+
+namespace ipc::rigid {
+
+/// @brief Always-on estimates of the memory held by each subsystem.
+///
+/// Every subsystem is a gauge set to the bytes allocated by its data
+/// structures (counting the reserved capacity) when they are built, and the
+/// peak of each gauge is kept. Like StepMetrics, the gauges are process-wide,
+/// so concurrent simulations overwrite each other.
+class MemoryUsage {
+public:
+    enum Subsystem {
+        /// @brief Body and global meshes, and the distance fields
+        MESHES,
+        /// @brief Body space BVHs
+        BVHS,
+        HASH_GRID,
+        CANDIDATES,
+        /// @brief Collision and friction constraints
+        CONSTRAINTS,
+        /// @brief Hessian blocks of the potentials and the assembled Hessian
+        HESSIAN_TRIPLETS,
+        /// @brief World vertices and their derivatives of each thread
+        WORLD_VERTICES_DIFF,
+        /// @brief States of the previous time-steps
+        STATE_HISTORY,
+        NUM_SUBSYSTEMS
+    };
+
+    /// @brief Set the bytes currently held by a subsystem.
+    static void set_bytes(Subsystem subsystem, size_t bytes);
+    /// @brief Change the bytes currently held by a subsystem.
+    static void add_bytes(Subsystem subsystem, int64_t bytes);
+
+    static size_t bytes(Subsystem subsystem);
+    static size_t peak_bytes(Subsystem subsystem);
+
+    /// @brief Zero all gauges and peaks.
+    static void reset();
+
+    /// @brief Current and peak bytes keyed by subsystem name.
+    static nlohmann::json to_json();
+
+    template <typename T> static size_t bytes_of(const std::vector<T>& v)
+    {
+        return v.capacity() * sizeof(T);
+    }
+
+    template <typename Derived>
+    static size_t bytes_of(const Eigen::PlainObjectBase<Derived>& m)
+    {
+        return m.size() * sizeof(typename Derived::Scalar);
+    }
+
+    static size_t bytes_of(const Eigen::SparseMatrix<double>& m)
+    {
+        return m.nonZeros() * (sizeof(double) + sizeof(int))
+            + (m.outerSize() + 1) * sizeof(int);
+    }
+
+    /// @brief Bytes of the lists of collision or friction constraints.
+    template <typename Constraints>
+    static size_t constraints_bytes(const Constraints& constraints)
+    {
+        return bytes_of(constraints.vv_constraints)
+            + bytes_of(constraints.ev_constraints)
+            + bytes_of(constraints.ee_constraints)
+            + bytes_of(constraints.fv_constraints);
+    }
+
+    /// @brief Approximate bytes of a JSON value (nodes and strings).
+    static size_t json_bytes(const nlohmann::json& json);
+
+protected:
+    static void update_peak(Subsystem subsystem, size_t bytes);
+
+    static std::array<std::atomic<int64_t>, NUM_SUBSYSTEMS> s_bytes;
+    static std::array<std::atomic<int64_t>, NUM_SUBSYSTEMS> s_peak_bytes;
+};
+
+} // namespace ipc::rigid
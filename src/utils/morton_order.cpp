@@ -0,0 +1,66 @@
+#include "morton_order.hpp"
+
+#include <cassert>
+#include <cmath>
+
+#include <utils/radix_sort.hpp>
+
+namespace ipc::rigid {
+
+namespace {
+    /// @brief Spread the low bits of x so there are (stride - 1) zeros
+    /// between consecutive bits.
+    uint64_t spread_bits(uint64_t x, int num_bits, int stride)
+    {
+        uint64_t spread = 0;
+        for (int i = 0; i < num_bits; i++) {
+            spread |= ((x >> i) & 1) << (stride * i);
+        }
+        return spread;
+    }
+} // namespace
+
+uint64_t morton_code(
+    const Eigen::VectorXd& point,
+    const Eigen::VectorXd& min,
+    const Eigen::VectorXd& max)
+{
+    const int dim = point.size();
+    assert(dim == 2 || dim == 3);
+    assert(min.size() == dim && max.size() == dim);
+    const int num_bits = dim == 2 ? 32 : 21;
+    const double max_cell = double((uint64_t(1) << num_bits) - 1);
+
+    uint64_t code = 0;
+    for (int i = 0; i < dim; i++) {
+        const double extent = max(i) - min(i);
+        const double t = extent > 0 ? (point(i) - min(i)) / extent : 0;
+        const uint64_t cell =
+            uint64_t(std::round(std::min(std::max(t, 0.0), 1.0) * max_cell));
+        code |= spread_bits(cell, num_bits, dim) << i;
+    }
+    return code;
+}
+
+std::vector<int> morton_order(const Eigen::MatrixXd& points)
+{
+    std::vector<std::pair<uint64_t, int>> codes(points.rows());
+    if (points.rows() > 0) {
+        const Eigen::VectorXd min = points.colwise().minCoeff();
+        const Eigen::VectorXd max = points.colwise().maxCoeff();
+        for (int i = 0; i < points.rows(); i++) {
+            codes[i] = { morton_code(points.row(i), min, max), i };
+        }
+    }
+    parallel_radix_sort(codes, [](const std::pair<uint64_t, int>& code) {
+        return code.first;
+    });
+
+    std::vector<int> order(codes.size());
+    for (size_t i = 0; i < codes.size(); i++) {
+        order[i] = codes[i].second;
+    }
+    return order;
+}
+
+} // namespace ipc::rigid
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <Eigen/Core>
+
+namespace ipc::rigid {
+
+/// @brief Morton code of a point in the box [min, max] (2D or 3D).
+///
+/// The coordinates are quantized to 32 (2D) or 21 (3D) bits and their bits
+/// interleaved, so nearby points have close codes.
+uint64_t morton_code(
+    const Eigen::VectorXd& point,
+    const Eigen::VectorXd& min,
+    const Eigen::VectorXd& max);
+
+/// @brief Order of the points (rows) along a Morton curve of their box.
+/// @returns The index of the ith point along the curve (ties keep their
+///          order).
+std::vector<int> morton_order(const Eigen::MatrixXd& points);
+
+} // namespace ipc::rigid
@@ -1,6 +1,7 @@
 #pragma once
 
-#if 1
+#ifndef RIGID_IPC_WITH_GMP
+// Plain double stand-in so builds without GMP need no multiprecision library
 namespace ipc::rigid {
 
 class Multiprecision {
@@ -0,0 +1,88 @@
+#include "numa.hpp"
+
+#include <cstdint>
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#endif
+
+#include <logger.hpp>
+
+namespace ipc::rigid {
+
+void NumaPlacement::advise_huge_pages(void* data, size_t bytes)
+{
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+    if (!use_huge_pages() || bytes < Constants::HUGE_PAGE_BYTES) {
+        return;
+    }
+    // Only the huge pages fully inside the buffer can be advised
+    const uintptr_t page = Constants::HUGE_PAGE_BYTES;
+    const uintptr_t begin =
+        (reinterpret_cast<uintptr_t>(data) + page - 1) / page * page;
+    const uintptr_t end = (reinterpret_cast<uintptr_t>(data) + bytes) / page
+        * page;
+    if (begin < end
+        && madvise(reinterpret_cast<void*>(begin), end - begin, MADV_HUGEPAGE)
+            != 0) {
+        RIGID_IPC_LOG_DEBUG(
+            "numa_placement action=advise_huge_pages status=failed bytes={:d}",
+            end - begin);
+    }
+#endif
+}
+
+ThreadPinningObserver::ThreadPinningObserver()
+{
+#if defined(__linux__)
+    cpu_set_t cpu_set;
+    CPU_ZERO(&cpu_set);
+    if (sched_getaffinity(0, sizeof(cpu_set), &cpu_set) == 0) {
+        for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+            if (CPU_ISSET(cpu, &cpu_set)) {
+                m_cpus.push_back(cpu);
+            }
+        }
+    }
+#endif
+    if (m_cpus.empty()) {
+        spdlog::warn("thread pinning is not supported on this platform");
+        return;
+    }
+    spdlog::info("thread_pinning action=start num_cpus={:d}", m_cpus.size());
+    observe(true);
+}
+
+ThreadPinningObserver::~ThreadPinningObserver()
+{
+    if (!m_cpus.empty()) {
+        observe(false);
+    }
+}
+
+void ThreadPinningObserver::on_scheduler_entry(bool is_worker)
+{
+#if defined(__linux__)
+    // A thread re-entering an arena keeps the CPU it was pinned to
+    thread_local bool is_pinned = false;
+    if (is_pinned) {
+        return;
+    }
+    is_pinned = true;
+
+    const int cpu = m_cpus[m_next_cpu++ % m_cpus.size()];
+    cpu_set_t cpu_set;
+    CPU_ZERO(&cpu_set);
+    CPU_SET(cpu, &cpu_set);
+    if (pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set)
+        != 0) {
+        RIGID_IPC_LOG_DEBUG(
+            "thread_pinning action=pin status=failed cpu={:d} is_worker={}",
+            cpu, is_worker);
+    }
+#endif
+}
+
+} // namespace ipc::rigid
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <vector>
+
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+#include <tbb/partitioner.h>
+#include <tbb/task_scheduler_observer.h>
+
+#include <constants.hpp>
+
+namespace ipc::rigid {
+
+/// @brief Placement of the large shared buffers on NUMA machines.
+///
+/// Linux places a page on the node of the thread that first writes it, so
+/// the large buffers are first touched in parallel with the same static
+/// partition as the loops that fill them. The switches are process-wide.
+class NumaPlacement {
+public:
+    /// @brief Back newly allocated large buffers with transparent huge pages.
+    static bool use_huge_pages() { return s_use_huge_pages; }
+    static void set_use_huge_pages(bool use_huge_pages)
+    {
+        s_use_huge_pages = use_huge_pages;
+    }
+
+    /// @brief Advise the kernel to back the whole pages of a buffer with huge
+    /// pages (no-op if disabled, the buffer is small, or unsupported).
+    static void advise_huge_pages(void* data, size_t bytes);
+
+private:
+    inline static std::atomic<bool> s_use_huge_pages = false;
+};
+
+/// @brief Fill an untouched buffer in parallel so its pages are spread over
+/// the NUMA nodes of the threads (serially if the buffer is small).
+template <typename Scalar>
+void parallel_first_touch(Scalar* data, size_t size, Scalar value = Scalar(0))
+{
+    const size_t bytes = size * sizeof(Scalar);
+    NumaPlacement::advise_huge_pages(data, bytes);
+    if (bytes < Constants::FIRST_TOUCH_MIN_BYTES) {
+        std::fill_n(data, size, value);
+        return;
+    }
+    // Whole pages per subrange, so no page is shared by two threads
+    const size_t grain =
+        std::max<size_t>(1, Constants::FIRST_TOUCH_PAGE_BYTES / sizeof(Scalar));
+    tbb::parallel_for(
+        tbb::blocked_range<size_t>(size_t(0), size, grain),
+        [&](const tbb::blocked_range<size_t>& range) {
+            std::fill(data + range.begin(), data + range.end(), value);
+        },
+        tbb::static_partitioner());
+}
+
+/// @brief Pin each thread entering the TBB scheduler to its own CPU of the
+/// process affinity mask, round robin, so the pages first touched by a
+/// thread stay on its node.
+class ThreadPinningObserver : public tbb::task_scheduler_observer {
+public:
+    /// @brief Start pinning the threads (no-op if unsupported).
+    ThreadPinningObserver();
+    ~ThreadPinningObserver();
+
+    void on_scheduler_entry(bool is_worker) override;
+
+    /// @brief Number of CPUs the threads are pinned to.
+    size_t num_cpus() const { return m_cpus.size(); }
+
+protected:
+    std::vector<int> m_cpus;
+    std::atomic<size_t> m_next_cpu = 0;
+};
+
+} // namespace ipc::rigid
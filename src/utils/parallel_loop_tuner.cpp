@@ -0,0 +1,74 @@
+#include "parallel_loop_tuner.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#include <tbb/task_arena.h>
+
+namespace ipc::rigid {
+
+ParallelLoopTuner::ParallelLoopTuner(const ParallelLoopTuner& other)
+    : m_selector(other.m_selector)
+{
+}
+
+ParallelLoopTuner& ParallelLoopTuner::operator=(const ParallelLoopTuner& other)
+{
+    if (this != &other) {
+        m_selector = other.m_selector;
+        m_item_seconds = -1;
+    }
+    return *this;
+}
+
+ParallelLoopTuner::Partitioner ParallelLoopTuner::best_partitioner() const
+{
+    int best = AUTO;
+    for (int i = 1; i < NUM_PARTITIONERS; i++) {
+        if (m_selector.cost(i) < m_selector.cost(best)) {
+            best = i;
+        }
+    }
+    return Partitioner(best);
+}
+
+size_t ParallelLoopTuner::grain_size(size_t size) const
+{
+    const double item_seconds = m_item_seconds;
+    if (item_seconds <= 0) {
+        return 1;
+    }
+    // Enough chunks to balance the threads, each long enough to amortize its
+    // scheduling
+    const size_t max_grain_size = std::max(
+        size
+            / (Constants::PARALLEL_LOOP_MIN_CHUNKS_PER_THREAD
+               * size_t(tbb::this_task_arena::max_concurrency())),
+        size_t(1));
+    const double grain_size = std::ceil(
+        Constants::PARALLEL_LOOP_TARGET_CHUNK_SECONDS / item_seconds);
+    // The ceiling of a positive time is at least one
+    return grain_size >= max_grain_size ? max_grain_size : size_t(grain_size);
+}
+
+void ParallelLoopTuner::reset()
+{
+    m_selector.reset();
+    m_item_seconds = -1;
+}
+
+void ParallelLoopTuner::record(
+    Partitioner partitioner, size_t size, double seconds)
+{
+    m_selector.record(partitioner, seconds / size);
+
+    // Assume the threads were all busy
+    const double item_seconds =
+        seconds * tbb::this_task_arena::max_concurrency() / size;
+    const double previous = m_item_seconds;
+    m_item_seconds = previous < 0 ? item_seconds
+                                  : previous
+            + Constants::STRATEGY_COST_SMOOTHING * (item_seconds - previous);
+}
+
+} // namespace ipc::rigid
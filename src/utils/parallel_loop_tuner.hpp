@@ -0,0 +1,99 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+#include <tbb/partitioner.h>
+
+#include <utils/cost_based_selector.hpp>
+
+namespace ipc::rigid {
+
+/// @brief Partitioner and grain size of a parallel loop chosen by its
+/// measured cost per item.
+///
+/// The partitioners are timed and chosen by a CostBasedSelector. The grain
+/// size of the simple partitioner makes a chunk take about
+/// Constants::PARALLEL_LOOP_TARGET_CHUNK_SECONDS, and the affinity
+/// partitioner is kept by the tuner, so a loop run once per Newton iteration
+/// replays the chunks on the threads whose caches hold them. A loop already
+/// running (e.g., from a concurrent objective evaluation) runs the next call
+/// with the default partitioner. Copies start over.
+///
+/// Tuning is opt-in and shared by concurrent simulations.
+/// While disabled a loop is a plain tbb::parallel_for.
+class ParallelLoopTuner {
+public:
+    enum Partitioner { AUTO, SIMPLE, AFFINITY, NUM_PARTITIONERS };
+
+    ParallelLoopTuner() = default;
+    ParallelLoopTuner(const ParallelLoopTuner& other);
+    ParallelLoopTuner& operator=(const ParallelLoopTuner& other);
+
+    static bool is_enabled() { return s_is_enabled; }
+    static void set_enabled(bool is_enabled) { s_is_enabled = is_enabled; }
+
+    /// @brief Run body on subranges of [0, size) in parallel.
+    template <typename Body> void parallel_for(size_t size, const Body& body);
+
+    /// @brief Partitioner with the least measured cost per item.
+    Partitioner best_partitioner() const;
+
+    /// @brief Grain size of the simple partitioner for a loop of size items.
+    size_t grain_size(size_t size) const;
+
+    /// @brief Forget the measured costs.
+    void reset();
+
+protected:
+    void record(Partitioner partitioner, size_t size, double seconds);
+
+    CostBasedSelector m_selector { NUM_PARTITIONERS };
+    tbb::affinity_partitioner m_affinity_partitioner;
+    /// @brief Average time of an item on a single thread (negative if never
+    /// measured).
+    std::atomic<double> m_item_seconds = -1;
+    /// @brief Is a call being tuned (the affinities are not thread safe)?
+    std::atomic<bool> m_is_running = false;
+
+    inline static std::atomic<bool> s_is_enabled = false;
+};
+
+template <typename Body>
+void ParallelLoopTuner::parallel_for(size_t size, const Body& body)
+{
+    const tbb::blocked_range<size_t> range(size_t(0), size);
+    if (!is_enabled() || size < 2 || m_is_running.exchange(true)) {
+        tbb::parallel_for(range, body);
+        return;
+    }
+    // Released even if the body throws
+    struct Release {
+        std::atomic<bool>& is_running;
+        ~Release() { is_running = false; }
+    } release { m_is_running };
+
+    const Partitioner partitioner = Partitioner(m_selector.select());
+    const auto start = std::chrono::steady_clock::now();
+    switch (partitioner) {
+    case SIMPLE:
+        tbb::parallel_for(
+            tbb::blocked_range<size_t>(size_t(0), size, grain_size(size)),
+            body, tbb::simple_partitioner());
+        break;
+    case AFFINITY:
+        tbb::parallel_for(range, body, m_affinity_partitioner);
+        break;
+    default:
+        tbb::parallel_for(range, body, tbb::auto_partitioner());
+        break;
+    }
+    record(
+        partitioner, size,
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - start)
+            .count());
+}
+
+} // namespace ipc::rigid
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+#include <tbb/parallel_reduce.h>
+
+namespace ipc::rigid {
+
+/// @brief Sort by an unsigned integer key with a parallel LSD radix sort.
+///
+/// The sort is stable and only runs as many 8-bit passes as the largest key
+/// needs, so small keys (e.g., cell and element ids) sort in a few linear
+/// passes. Small inputs fall back to std::stable_sort.
+/// @param key Function from an item to its uint64_t key.
+template <typename T, typename KeyFunction>
+void parallel_radix_sort(
+    std::vector<T>& items,
+    const KeyFunction& key,
+    size_t min_parallel_size = 1 << 14)
+{
+    const size_t n = items.size();
+    if (n < min_parallel_size) {
+        std::stable_sort(
+            items.begin(), items.end(),
+            [&](const T& a, const T& b) { return key(a) < key(b); });
+        return;
+    }
+
+    const uint64_t max_key = tbb::parallel_reduce(
+        tbb::blocked_range<size_t>(0, n), uint64_t(0),
+        [&](const tbb::blocked_range<size_t>& r, uint64_t max_key) {
+            for (size_t i = r.begin(); i != r.end(); i++) {
+                max_key = std::max(max_key, uint64_t(key(items[i])));
+            }
+            return max_key;
+        },
+        [](uint64_t a, uint64_t b) { return std::max(a, b); });
+
+    // Fixed blocks so the histograms and the scatter see the same ranges
+    constexpr int RADIX = 256;
+    const size_t block_size = std::max(min_parallel_size / 4, size_t(1));
+    const size_t num_blocks = (n + block_size - 1) / block_size;
+    std::vector<std::array<size_t, RADIX>> offsets(num_blocks);
+
+    std::vector<T> sorted(items);
+    for (int shift = 0; shift < 64 && (max_key >> shift) != 0; shift += 8) {
+        const auto digit = [&](const T& item) {
+            return (uint64_t(key(item)) >> shift) & (RADIX - 1);
+        };
+
+        tbb::parallel_for(size_t(0), num_blocks, [&](size_t b) {
+            offsets[b].fill(0);
+            const size_t end = std::min(n, (b + 1) * block_size);
+            for (size_t i = b * block_size; i < end; i++) {
+                offsets[b][digit(items[i])]++;
+            }
+        });
+
+        // Exclusive scan in (digit, block) order keeps the sort stable
+        size_t offset = 0;
+        for (int d = 0; d < RADIX; d++) {
+            for (size_t b = 0; b < num_blocks; b++) {
+                const size_t count = offsets[b][d];
+                offsets[b][d] = offset;
+                offset += count;
+            }
+        }
+
+        tbb::parallel_for(size_t(0), num_blocks, [&](size_t b) {
+            const size_t end = std::min(n, (b + 1) * block_size);
+            for (size_t i = b * block_size; i < end; i++) {
+                sorted[offsets[b][digit(items[i])]++] = items[i];
+            }
+        });
+        items.swap(sorted);
+    }
+}
+
+} // namespace ipc::rigid
@@ -1,5 +1,7 @@
 #include "sinc.hpp"
 
+#include <algorithm>
+
 namespace ipc::rigid {
 
 // We use these bounds because for example 1 + x^2 = 1 for x < sqrt(ϵ).
@@ -46,6 +48,54 @@ Interval _sinc_interval_taylor(double x_double)
     return 1.0 + x2 / 6.0 * (x2 / 20.0 - 1.0);
 }
 
+// Extrema of sinc after its first minimum (the roots of tan(x) = x) and the
+// values of sinc at them. sinc is monotonic between consecutive extrema.
+static const double sinc_extrema[] = {
+    4.493409457909063,  7.725251836937707,  10.904121659428899,
+    14.066193912831473, 17.220755271930766, 20.37130295928756,
+    23.519452498689006,
+};
+static const double sinc_extremum_values[] = {
+    -0.21723362821122166, 0.12837455352589913,  -0.09132520282305767,
+    0.07091345945046215,  -0.057971802346153886, 0.049029624014074166,
+    -0.04247961697761265,
+};
+// Conservative error of the tabulated extrema and values
+static const double sinc_extremum_tol = 1e-12;
+
+// Enclosure of sinc over x ⊆ [4.4934, ∞) from the values at the bounds of x
+// and at the extrema inside of it. This is tighter than sin(x) / x and only
+// evaluates the trigonometric functions at the bounds.
+Interval _sinc_interval_between_extrema(const Interval& x)
+{
+    const int num_extrema = sizeof(sinc_extrema) / sizeof(double);
+    const double last_extremum = sinc_extrema[num_extrema - 1];
+
+    Interval y = Interval::empty();
+    if (x.upper() > last_extremum) {
+        // |sinc(x)| ≤ 1/x, so the natural extension is tight enough here
+        const Interval x_tail(std::max(x.lower(), last_extremum), x.upper());
+        y = sin(x_tail) / x_tail;
+        if (x.lower() >= last_extremum) {
+            return y;
+        }
+    }
+
+    const double a = x.lower(), b = std::min(x.upper(), last_extremum);
+    y = hull(y, hull(_sinc_interval_taylor(a), _sinc_interval_taylor(b)));
+    for (int i = 0; i < num_extrema; i++) {
+        if (sinc_extrema[i] + sinc_extremum_tol >= a
+            && sinc_extrema[i] - sinc_extremum_tol <= b) {
+            y = hull(
+                y,
+                Interval(
+                    sinc_extremum_values[i] - sinc_extremum_tol,
+                    sinc_extremum_values[i] + sinc_extremum_tol));
+        }
+    }
+    return y;
+}
+
 Interval sinc(const Interval& x)
 {
     // Define two regions and use even symmetry of sinc.
@@ -90,11 +140,9 @@ Interval sinc(const Interval& x)
                     _sinc_interval_taylor(x_monotonic.lower()).upper(), 1.0)));
     }
 
-    // Case 2 (Not necessarily monotonic):
+    // Case 2 (Monotonic between the extrema):
     if (!empty(x_gt_monotonic)) {
-        // x_gt_monotonic is larger than one, so the division should be well
-        // behaved.
-        y = hull(y, sin(x_gt_monotonic) / x_gt_monotonic);
+        y = hull(y, _sinc_interval_between_extrema(x_gt_monotonic));
     }
 
     return y;
@@ -0,0 +1,72 @@
+#include "step_metrics.hpp"
+
+namespace ipc::rigid {
+
+std::array<std::atomic<int64_t>, StepMetrics::NUM_TIMERS>
+    StepMetrics::s_nanoseconds = {};
+std::array<std::atomic<uint64_t>, StepMetrics::NUM_COUNTERS>
+    StepMetrics::s_counts = {};
+
+namespace {
+    const char* const TIMER_NAMES[StepMetrics::NUM_TIMERS] = {
+        "broad_phase_time",
+        "narrow_phase_time",
+        "linear_solve_time",
+    };
+
+    const char* const COUNTER_NAMES[StepMetrics::NUM_COUNTERS] = {
+        "narrow_phase_queries", "linear_solves",
+        "line_search_trials",   "ev_candidates",
+        "ee_candidates",        "fv_candidates",
+        "psd_projections",      "skipped_psd_projections",
+        "ccd_prefilter_rejections",
+        "separation_cache_rejections",
+        "distance_field_rejections",
+        "toi_bound_cache_rejections",
+        "bounding_sphere_rejections",
+        "dropped_friction_contacts",
+        "root_finder_boxes",
+        "root_finder_budget_exceeded",
+    };
+} // namespace
+
+double StepMetrics::time(Timer timer)
+{
+    return s_nanoseconds[timer].load(std::memory_order_relaxed) * 1e-9;
+}
+
+uint64_t StepMetrics::count(Counter counter)
+{
+    return s_counts[counter].load(std::memory_order_relaxed);
+}
+
+const char* StepMetrics::name(Timer timer) { return TIMER_NAMES[timer]; }
+
+const char* StepMetrics::name(Counter counter)
+{
+    return COUNTER_NAMES[counter];
+}
+
+void StepMetrics::reset()
+{
+    for (auto& nanoseconds : s_nanoseconds) {
+        nanoseconds.store(0, std::memory_order_relaxed);
+    }
+    for (auto& count : s_counts) {
+        count.store(0, std::memory_order_relaxed);
+    }
+}
+
+nlohmann::json StepMetrics::to_json()
+{
+    nlohmann::json metrics;
+    for (int i = 0; i < NUM_TIMERS; i++) {
+        metrics[TIMER_NAMES[i]] = time(Timer(i));
+    }
+    for (int i = 0; i < NUM_COUNTERS; i++) {
+        metrics[COUNTER_NAMES[i]] = count(Counter(i));
+    }
+    return metrics;
+}
+
+} // namespace ipc::rigid
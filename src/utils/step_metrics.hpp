@@ -0,0 +1,98 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+#include <nlohmann/json.hpp>
+
+namespace ipc::rigid {
+
+/// @brief Always-on counters and timers of the current time-step.
+///
+/// The values are process-wide atomics, so they can be updated from inside
+/// the TBB kernels. Times of concurrent calls are summed.
+class StepMetrics {
+public:
+    enum Timer { BROAD_PHASE, NARROW_PHASE, LINEAR_SOLVE, NUM_TIMERS };
+
+    enum Counter {
+        NARROW_PHASE_QUERIES,
+        LINEAR_SOLVES,
+        LINE_SEARCH_TRIALS,
+        EV_CANDIDATES,
+        EE_CANDIDATES,
+        FV_CANDIDATES,
+        PSD_PROJECTIONS,
+        SKIPPED_PSD_PROJECTIONS,
+        /// @brief Narrow-phase queries rejected by the displacement bound
+        CCD_PREFILTER_REJECTIONS,
+        /// @brief Body pairs skipped by their cached separation
+        SEPARATION_CACHE_REJECTIONS,
+        /// @brief Candidates culled by a body's distance field
+        DISTANCE_FIELD_REJECTIONS,
+        /// @brief Narrow-phase queries settled by cached time-of-impact bounds
+        TOI_BOUND_CACHE_REJECTIONS,
+        /// @brief Body pairs whose swept bounding spheres never meet
+        BOUNDING_SPHERE_REJECTIONS,
+        /// @brief Friction contacts dropped for their negligible normal force
+        DROPPED_FRICTION_CONTACTS,
+        /// @brief Boxes examined by the CCD interval root finders
+        ROOT_FINDER_BOXES,
+        /// @brief CCD queries that ran out of root finder iterations and
+        /// returned a conservative time of impact
+        ROOT_FINDER_BUDGET_EXCEEDED,
+        NUM_COUNTERS
+    };
+
+    /// @brief Time a scope and add it to a timer.
+    class ScopedTimer {
+    public:
+        explicit ScopedTimer(Timer timer)
+            : m_timer(timer)
+            , m_start(std::chrono::steady_clock::now())
+        {
+        }
+        ScopedTimer(const ScopedTimer&) = delete;
+        ScopedTimer& operator=(const ScopedTimer&) = delete;
+        ~ScopedTimer()
+        {
+            add_time(m_timer, std::chrono::steady_clock::now() - m_start);
+        }
+
+    protected:
+        Timer m_timer;
+        std::chrono::steady_clock::time_point m_start;
+    };
+
+    static void add_time(Timer timer, std::chrono::nanoseconds duration)
+    {
+        s_nanoseconds[timer].fetch_add(
+            duration.count(), std::memory_order_relaxed);
+    }
+    static void add_count(Counter counter, uint64_t n = 1)
+    {
+        s_counts[counter].fetch_add(n, std::memory_order_relaxed);
+    }
+
+    /// @brief Accumulated time in seconds.
+    static double time(Timer timer);
+    static uint64_t count(Counter counter);
+
+    /// @brief Names of the metrics (as in to_json()).
+    static const char* name(Timer timer);
+    static const char* name(Counter counter);
+
+    /// @brief Zero all timers and counters.
+    static void reset();
+
+    /// @brief Current values keyed by metric name (times in seconds).
+    static nlohmann::json to_json();
+
+protected:
+    static std::array<std::atomic<int64_t>, NUM_TIMERS> s_nanoseconds;
+    static std::array<std::atomic<uint64_t>, NUM_COUNTERS> s_counts;
+};
+
+} // namespace ipc::rigid
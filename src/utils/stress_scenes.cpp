@@ -0,0 +1,323 @@
+#include "stress_scenes.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <optional>
+#include <random>
+
+#include <Eigen/Geometry>
+#include <igl/PI.h>
+#include <igl/edges.h>
+#include <tbb/parallel_for.h>
+
+#include <logger.hpp>
+#include <physics/rigid_body_geometry.hpp>
+
+namespace ipc::rigid {
+namespace stress_scenes {
+
+    namespace {
+        struct BodySpec {
+            std::shared_ptr<const RigidBodyGeometry> geometry;
+            PoseD pose;
+            RigidBodyType type;
+        };
+
+        std::shared_ptr<const RigidBodyGeometry> shared_geometry(
+            const Eigen::MatrixXd& V,
+            const Eigen::MatrixXi& E,
+            const Eigen::MatrixXi& F,
+            bool is_static)
+        {
+            return RigidBodyGeometry::get(
+                V, E, F,
+                RigidBody::num_rot_dof_fixed(
+                    3, VectorMax6b::Constant(6, is_static)));
+        }
+
+        /// @brief Static box whose top face is the plane y = 0 under a
+        /// square footprint.
+        BodySpec ground(double half_width)
+        {
+            Eigen::MatrixXd V;
+            Eigen::MatrixXi E, F;
+            box_mesh(Eigen::Vector3d(half_width, 0.5, half_width), V, E, F);
+            const PoseD pose(
+                Eigen::Vector3d(0, -0.5, 0), Eigen::Vector3d::Zero());
+            return { shared_geometry(V, E, F, /*is_static=*/true), pose,
+                     RigidBodyType::STATIC };
+        }
+
+        /// @brief Rotation vector of a uniformly random rotation.
+        Eigen::Vector3d random_rotation(std::mt19937& gen)
+        {
+            std::uniform_real_distribution<double> unit(0, 1);
+            const double w = unit(gen), x = unit(gen), y = unit(gen);
+            const Eigen::Quaterniond q(
+                std::sqrt(1 - w) * std::sin(2 * igl::PI * x),
+                std::sqrt(1 - w) * std::cos(2 * igl::PI * x),
+                std::sqrt(w) * std::sin(2 * igl::PI * y),
+                std::sqrt(w) * std::cos(2 * igl::PI * y));
+            const Eigen::AngleAxisd aa(q);
+            return aa.angle() * aa.axis();
+        }
+
+        /// @brief Jittered centers of a lattice filled in xz-layers from y =
+        /// y0 up, with cubic footprint.
+        std::vector<Eigen::Vector3d> lattice(
+            size_t n, double cell, double jitter, double y0, std::mt19937& gen)
+        {
+            const size_t side =
+                std::max<size_t>(1, std::ceil(std::cbrt(double(n))));
+            std::uniform_real_distribution<double> offset(-jitter, jitter);
+            std::vector<Eigen::Vector3d> centers(n);
+            for (size_t i = 0; i < n; i++) {
+                const size_t x = i % side, z = (i / side) % side;
+                const size_t y = i / (side * side);
+                centers[i] = Eigen::Vector3d(
+                    (x - 0.5 * (side - 1)) * cell,
+                    y0 + (y + 0.5) * cell, (z - 0.5 * (side - 1)) * cell);
+                for (int j = 0; j < 3; j++) {
+                    centers[i][j] += offset(gen);
+                }
+            }
+            return centers;
+        }
+
+        /// @brief Half-width of the footprint of lattice().
+        double lattice_half_width(size_t n, double cell)
+        {
+            return 0.5 * std::ceil(std::cbrt(double(std::max<size_t>(n, 1))))
+                * cell
+                + cell;
+        }
+
+        std::vector<RigidBody> build_bodies(const std::vector<BodySpec>& specs)
+        {
+            // Bodies of shared geometries only compute their world state
+            std::vector<std::optional<RigidBody>> new_rbs(specs.size());
+            tbb::parallel_for(size_t(0), specs.size(), [&](size_t i) {
+                const BodySpec& spec = specs[i];
+                const bool is_static = spec.type == RigidBodyType::STATIC;
+                new_rbs[i].emplace(
+                    spec.geometry, spec.pose, /*velocity=*/PoseD::Zero(3),
+                    /*force=*/PoseD::Zero(3), /*density=*/1000.0,
+                    /*is_dof_fixed=*/VectorMax6b::Constant(6, is_static),
+                    /*oriented=*/false, /*group_id=*/int(i), spec.type);
+            });
+
+            std::vector<RigidBody> rbs;
+            rbs.reserve(new_rbs.size());
+            for (auto& rb : new_rbs) {
+                rbs.push_back(std::move(*rb));
+            }
+            return rbs;
+        }
+    } // namespace
+
+    void box_mesh(
+        const Eigen::Vector3d& half_extents,
+        Eigen::MatrixXd& vertices,
+        Eigen::MatrixXi& edges,
+        Eigen::MatrixXi& faces)
+    {
+        vertices.resize(8, 3);
+        for (int i = 0; i < 8; i++) {
+            vertices.row(i) << (i & 1 ? 1 : -1) * half_extents.x(),
+                (i & 2 ? 1 : -1) * half_extents.y(),
+                (i & 4 ? 1 : -1) * half_extents.z();
+        }
+        // Outward oriented triangles
+        faces.resize(12, 3);
+        faces << 0, 2, 1, 1, 2, 3, // z-
+            4, 5, 6, 5, 7, 6,      // z+
+            0, 1, 4, 1, 5, 4,      // y-
+            2, 6, 3, 3, 6, 7,      // y+
+            0, 4, 2, 2, 4, 6,      // x-
+            1, 3, 5, 3, 7, 5;      // x+
+        igl::edges(faces, edges);
+    }
+
+    void torus_mesh(
+        double major_radius,
+        double minor_radius,
+        int major_resolution,
+        int minor_resolution,
+        Eigen::MatrixXd& vertices,
+        Eigen::MatrixXi& edges,
+        Eigen::MatrixXi& faces)
+    {
+        const int n = major_resolution, m = minor_resolution;
+        vertices.resize(n * m, 3);
+        faces.resize(2 * n * m, 3);
+        for (int i = 0; i < n; i++) {
+            const double theta = 2 * igl::PI * i / n;
+            for (int j = 0; j < m; j++) {
+                const double phi = 2 * igl::PI * j / m;
+                const double r = major_radius + minor_radius * std::cos(phi);
+                vertices.row(i * m + j) << r * std::cos(theta),
+                    r * std::sin(theta), minor_radius * std::sin(phi);
+
+                const int v00 = i * m + j, v01 = i * m + (j + 1) % m;
+                const int v10 = ((i + 1) % n) * m + j;
+                const int v11 = ((i + 1) % n) * m + (j + 1) % m;
+                faces.row(2 * v00) << v00, v10, v11;
+                faces.row(2 * v00 + 1) << v00, v11, v01;
+            }
+        }
+        igl::edges(faces, edges);
+    }
+
+    void rod_mesh(
+        double length,
+        int num_segments,
+        Eigen::MatrixXd& vertices,
+        Eigen::MatrixXi& edges)
+    {
+        vertices.setZero(num_segments + 1, 3);
+        vertices.col(0).setLinSpaced(-length / 2, length / 2);
+        edges.resize(num_segments, 2);
+        for (int i = 0; i < num_segments; i++) {
+            edges.row(i) << i, i + 1;
+        }
+    }
+
+    std::vector<RigidBody> random_pile(size_t num_bodies, unsigned seed)
+    {
+        if (num_bodies == 0) {
+            return {};
+        }
+        const std::vector<Eigen::Vector3d> half_extents = {
+            Eigen::Vector3d(0.5, 0.5, 0.5),
+            Eigen::Vector3d(0.8, 0.3, 0.4),
+            Eigen::Vector3d(0.25, 0.6, 0.25),
+        };
+        std::vector<std::shared_ptr<const RigidBodyGeometry>> geometries;
+        double max_radius = 0;
+        for (const Eigen::Vector3d& h : half_extents) {
+            Eigen::MatrixXd V;
+            Eigen::MatrixXi E, F;
+            box_mesh(h, V, E, F);
+            geometries.push_back(shared_geometry(V, E, F, false));
+            max_radius = std::max(max_radius, h.norm());
+        }
+
+        // Cells fit any rotated box with a gap of at least 0.2
+        const double jitter = 0.1, cell = 2 * max_radius + 0.2 + 2 * jitter;
+        const size_t num_boxes = num_bodies - 1;
+        std::mt19937 gen(seed);
+        const std::vector<Eigen::Vector3d> centers =
+            lattice(num_boxes, cell, jitter, /*y0=*/0, gen);
+        std::uniform_int_distribution<size_t> prototype(
+            0, geometries.size() - 1);
+
+        std::vector<BodySpec> specs;
+        specs.reserve(num_bodies);
+        specs.push_back(ground(lattice_half_width(num_boxes, cell)));
+        for (size_t i = 0; i < num_boxes; i++) {
+            specs.push_back({ geometries[prototype(gen)],
+                              PoseD(centers[i], random_rotation(gen)),
+                              RigidBodyType::DYNAMIC });
+        }
+        RIGID_IPC_LOG_DEBUG(
+            "stress_scene scene=pile num_bodies={} cell={:g}", num_bodies,
+            cell);
+        return build_bodies(specs);
+    }
+
+    std::vector<RigidBody> chain_grid(size_t num_bodies, size_t chain_length)
+    {
+        if (num_bodies == 0) {
+            return {};
+        }
+        chain_length = std::max<size_t>(chain_length, 1);
+        // Links of an inner radius of 0.85 interlock with a gap of 0.3
+        Eigen::MatrixXd V;
+        Eigen::MatrixXi E, F;
+        torus_mesh(1.0, 0.15, 24, 8, V, E, F);
+        const auto dynamic_link = shared_geometry(V, E, F, false);
+        const auto static_link = shared_geometry(V, E, F, true);
+        const double link_spacing = 1.4, chain_spacing = 3.0;
+
+        const size_t num_chains =
+            (num_bodies + chain_length - 1) / chain_length;
+        const size_t side =
+            std::max<size_t>(1, std::ceil(std::sqrt(double(num_chains))));
+        const double top = (chain_length - 1) * link_spacing + 2;
+
+        std::vector<BodySpec> specs;
+        specs.reserve(num_bodies);
+        for (size_t i = 0; i < num_bodies; i++) {
+            const size_t chain = i / chain_length, link = i % chain_length;
+            const Eigen::Vector3d position(
+                (chain % side - 0.5 * (side - 1)) * chain_spacing,
+                top - link * link_spacing,
+                (chain / side - 0.5 * (side - 1)) * chain_spacing);
+            // Alternate links lie in the xy- and yz-planes
+            const Eigen::Vector3d rotation =
+                link % 2 ? Eigen::Vector3d(0, igl::PI / 2, 0)
+                         : Eigen::Vector3d::Zero();
+            specs.push_back(
+                { link == 0 ? static_link : dynamic_link,
+                  PoseD(position, rotation),
+                  link == 0 ? RigidBodyType::STATIC : RigidBodyType::DYNAMIC });
+        }
+        RIGID_IPC_LOG_DEBUG(
+            "stress_scene scene=chains num_bodies={} num_chains={}",
+            num_bodies, num_chains);
+        return build_bodies(specs);
+    }
+
+    std::vector<RigidBody> codim_rods(size_t num_bodies, unsigned seed)
+    {
+        if (num_bodies == 0) {
+            return {};
+        }
+        const double length = 2.0;
+        Eigen::MatrixXd V;
+        Eigen::MatrixXi E;
+        rod_mesh(length, 8, V, E);
+        const auto rod = shared_geometry(V, E, Eigen::MatrixXi(), false);
+
+        const double jitter = 0.1, cell = length + 0.2 + 2 * jitter;
+        const size_t num_rods = num_bodies - 1;
+        std::mt19937 gen(seed);
+        const std::vector<Eigen::Vector3d> centers =
+            lattice(num_rods, cell, jitter, /*y0=*/0, gen);
+
+        std::vector<BodySpec> specs;
+        specs.reserve(num_bodies);
+        specs.push_back(ground(lattice_half_width(num_rods, cell)));
+        for (size_t i = 0; i < num_rods; i++) {
+            specs.push_back({ rod, PoseD(centers[i], random_rotation(gen)),
+                              RigidBodyType::DYNAMIC });
+        }
+        RIGID_IPC_LOG_DEBUG(
+            "stress_scene scene=rods num_bodies={} cell={:g}", num_bodies,
+            cell);
+        return build_bodies(specs);
+    }
+
+    const std::vector<std::string>& scene_names()
+    {
+        static const std::vector<std::string> names = { "pile", "chains",
+                                                        "rods" };
+        return names;
+    }
+
+    std::vector<RigidBody> stress_scene(
+        const std::string& name, size_t num_bodies, unsigned seed)
+    {
+        if (name == "pile") {
+            return random_pile(num_bodies, seed);
+        } else if (name == "chains") {
+            return chain_grid(num_bodies);
+        } else if (name == "rods") {
+            return codim_rods(num_bodies, seed);
+        }
+        spdlog::error("unknown stress scene name={}", name);
+        return {};
+    }
+
+} // namespace stress_scenes
+} // namespace ipc::rigid
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <Eigen/Core>
+
+#include <physics/rigid_body.hpp>
+
+namespace ipc::rigid {
+
+/// @brief Procedural 3D scenes of any number of bodies for scalability
+/// studies, built directly as bodies (e.g., for RigidBodyAssembler::init()
+/// or SimState::init()) instead of JSON.
+///
+/// Bodies of the same shape share one geometry. The dynamic bodies start
+/// separated and the y-axis points up.
+namespace stress_scenes {
+
+    /// @brief Box mesh centered at the origin.
+    void box_mesh(
+        const Eigen::Vector3d& half_extents,
+        Eigen::MatrixXd& vertices,
+        Eigen::MatrixXi& edges,
+        Eigen::MatrixXi& faces);
+
+    /// @brief Torus mesh around the z-axis.
+    /// @param major_radius  Radius of the center line of the tube.
+    /// @param minor_radius  Radius of the tube.
+    void torus_mesh(
+        double major_radius,
+        double minor_radius,
+        int major_resolution,
+        int minor_resolution,
+        Eigen::MatrixXd& vertices,
+        Eigen::MatrixXi& edges,
+        Eigen::MatrixXi& faces);
+
+    /// @brief Straight polyline along the x-axis centered at the origin
+    /// (edges only, so it is entirely a codimensional path).
+    void rod_mesh(
+        double length,
+        int num_segments,
+        Eigen::MatrixXd& vertices,
+        Eigen::MatrixXi& edges);
+
+    /// @brief Randomly oriented boxes of a few sizes on a jittered lattice
+    /// above a static ground box (body 0).
+    std::vector<RigidBody> random_pile(size_t num_bodies, unsigned seed = 0);
+
+    /// @brief Hanging chains of interlocked tori on a grid, each chain's top
+    /// link being static.
+    std::vector<RigidBody>
+    chain_grid(size_t num_bodies, size_t chain_length = 10);
+
+    /// @brief Randomly oriented codimensional rods on a jittered lattice
+    /// above a static ground box (body 0).
+    std::vector<RigidBody> codim_rods(size_t num_bodies, unsigned seed = 0);
+
+    /// @brief Names of the scenes of stress_scene().
+    const std::vector<std::string>& scene_names();
+
+    /// @brief Scene by name ("pile", "chains", or "rods").
+    /// @returns An empty scene if the name is unknown.
+    std::vector<RigidBody> stress_scene(
+        const std::string& name, size_t num_bodies, unsigned seed = 0);
+
+} // namespace stress_scenes
+} // namespace ipc::rigid
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace ipc::rigid {
+
+/// @brief Pool of transient buffers that keep their capacity across calls.
+///
+/// Hot paths that would build a buffer on every call (e.g., the per-thread
+/// candidates of the broad phase) acquire one from a pool instead, so once
+/// the buffers have grown to the size of the scene no more allocations are
+/// done. Concurrent callers get different buffers. The buffer is returned to
+/// the pool when its handle is destroyed and must be cleared by the caller.
+/// Copies of a pool start empty, so owners of a pool stay copyable.
+template <typename T> class TransientPool {
+    struct Releaser {
+        TransientPool* pool;
+        void operator()(T* buffer) const { pool->release(buffer); }
+    };
+
+public:
+    typedef std::unique_ptr<T, Releaser> Handle;
+
+    TransientPool() = default;
+    TransientPool(const TransientPool&) { }
+    TransientPool& operator=(const TransientPool&) { return *this; }
+
+    Handle acquire()
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        if (m_buffers.empty()) {
+            lock.unlock();
+            return Handle(new T(), Releaser { this });
+        }
+        T* buffer = m_buffers.back().release();
+        m_buffers.pop_back();
+        return Handle(buffer, Releaser { this });
+    }
+
+protected:
+    void release(T* buffer)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_buffers.emplace_back(buffer);
+    }
+
+    std::mutex m_mutex;
+    std::vector<std::unique_ptr<T>> m_buffers;
+};
+
+} // namespace ipc::rigid
@@ -124,7 +124,7 @@ void UISimState::draw_io()
             std::string fname = igl::file_dialog_save();
             save_screenshot(fname);
         }
-        if (m_is_gif_recording) {
+        if (m_recorder.is_recording()) {
             if (ImGui::Button("End recording", ImVec2(-1, 0))) {
                 end_recording();
             }
@@ -143,48 +143,74 @@ void UISimState::draw_simulation_player()
     ImGui::RadioButton("pause##SimPlayer", &player_state, PlayerState::Paused);
     if (m_player_state == PlayerState::Playing
         && player_state == PlayerState::Paused && !replaying) {
+        stop_simulation_thread();
         log_simulation_time();
     }
-    if (m_state.m_num_simulation_steps >= m_state.m_max_simulation_steps
-        && m_player_state == PlayerState::Paused
-        && player_state == PlayerState::Playing) {
+    if (m_player_state == PlayerState::Paused
+        && player_state == PlayerState::Playing
+        && m_state.m_num_simulation_steps >= m_state.m_max_simulation_steps) {
         m_state.m_max_simulation_steps = -1; // Turn off breaking
     }
     m_player_state = static_cast<PlayerState>(player_state);
 
     if (ImGui::Button("Step##SimPlayer", ImVec2(-1, 0))) {
+        stop_simulation_thread();
         m_player_state = PlayerState::Playing;
-        pre_draw_loop();
+        if (replaying) {
+            pre_draw_loop();
+        } else {
+            simulation_step(); // A single step is taken synchronously
+            m_scene_changed = true;
+        }
         m_player_state = PlayerState::Paused;
     }
     // --------------------------------------------------------------------
-    ImGui::Checkbox("pause if intersecting", &m_bkp_has_intersections);
+    // The simulation thread reads these settings, so it is stopped (and
+    // restarted on the next frame if playing) before any of them changes.
+    const auto setting_checkbox = [&](const char* label, bool& setting) {
+        bool value = setting;
+        if (ImGui::Checkbox(label, &value)) {
+            stop_simulation_thread();
+            setting = value;
+        }
+    };
+
+    setting_checkbox("pause if intersecting", m_bkp_has_intersections);
     ImGui::SameLine();
     ImGui::HelpMarker("yes - stop playing if step has intersections.");
 
-    ImGui::Checkbox("solve collisions", &m_state.m_solve_collisions);
+    setting_checkbox("solve collisions", m_state.m_solve_collisions);
     ImGui::SameLine();
     ImGui::HelpMarker("yes - solve collisions automatically on each step.");
 
-    ImGui::Checkbox("pause if optimization failed", &m_bkp_optimization_failed);
+    setting_checkbox(
+        "pause if optimization failed", m_bkp_optimization_failed);
     ImGui::SameLine();
     ImGui::HelpMarker("yes - stop playing if step optimization failed.");
 
-    ImGui::Checkbox("pause on collisions", &m_bkp_had_collision);
+    setting_checkbox("pause on collisions", m_bkp_had_collision);
     ImGui::SameLine();
     ImGui::HelpMarker("yes - stop playing if step had a collision.");
 
     // --------------------------------------------------------------------
-    if (ImGui::SliderInt(
-            "step##Replay", &m_state.m_num_simulation_steps, 0,
-            m_state.state_sequence.size() - 1)) {
+    const bool is_simulating = m_simulation_thread.joinable();
+    int step = is_simulating ? m_front_snapshot.num_simulation_steps
+                             : m_state.m_num_simulation_steps;
+    const int num_states = is_simulating ? m_front_snapshot.num_states
+                                         : m_state.state_sequence.size();
+    if (ImGui::SliderInt("step##Replay", &step, 0, num_states - 1)) {
+        stop_simulation_thread();
+        m_state.m_num_simulation_steps = step;
         replaying = true;
     }
 }
 
 void UISimState::draw_settings()
 {
-    auto config = m_state.get_active_config();
+    if (!m_simulation_thread.joinable()) {
+        m_active_config = m_state.get_active_config();
+    }
+    const nlohmann::json& config = m_active_config;
     ImGui::BeginChild(
         "##config", ImVec2(ImGui::GetWindowContentRegionWidth(), 300), false,
         ImGuiWindowFlags_HorizontalScrollbar);
@@ -207,6 +233,11 @@ void UISimState::draw_legends()
         if (!ptr->is_com()) {
             if (ImGui::Checkbox(("##UI-" + label).c_str(), &tmp)) {
                 ptr->visibility(tmp);
+                // The velocity field is only updated while visible
+                if (tmp && ptr->is_vector_field() && m_has_scene
+                    && !m_simulation_thread.joinable()) {
+                    update_velocity_field();
+                }
             }
             /// Color
             ImGui::SameLine();
@@ -239,6 +270,15 @@ void UISimState::draw_legends()
             }
             ImGui::PopItemWidth();
 
+            if (m_has_scene && m_state.problem_ptr->is_rb_problem()) {
+                ImGui::SameLine();
+                if (ImGui::Checkbox(
+                        ("LOD##UI-" + label).c_str(), &m_use_mesh_lods)) {
+                    stop_simulation_thread();
+                    load_mesh_data();
+                }
+            }
+
         } else if (ptr->is_scalar_field()) {
             ImGui::SameLine();
             if (ImGui::Checkbox(
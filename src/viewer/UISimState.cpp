@@ -2,12 +2,59 @@
 #include <logger.hpp>
 
 #include <spdlog/sinks/stdout_color_sinks.h>
+#include <tbb/parallel_for.h>
 
+#include <constants.hpp>
+#include <io/mesh_cache.hpp>
 #include <physics/rigid_body_problem.hpp>
 #include <utils/eigen_ext.hpp>
 
 namespace ipc::rigid {
 
+namespace {
+    /// @brief Type of every body (which changes when a body falls asleep).
+    std::vector<int> body_types(const RigidBodyAssembler& bodies)
+    {
+        std::vector<int> types;
+        types.reserve(bodies.num_bodies());
+        for (const auto& body : bodies.m_rbs) {
+            types.push_back(int(body.type));
+        }
+        return types;
+    }
+
+    /// @brief Type of the body of every vertex.
+    Eigen::VectorXi vertex_types(const RigidBodyAssembler& bodies)
+    {
+        Eigen::VectorXi vertex_type(bodies.num_vertices());
+        int start_i = 0;
+        for (const auto& body : bodies.m_rbs) {
+            vertex_type.segment(start_i, body.vertices.rows())
+                .setConstant(int(body.type));
+            start_i += body.vertices.rows();
+        }
+        return vertex_type;
+    }
+
+    /// @brief Levels of detail of every body, from its full mesh to its
+    /// coarsest proxy.
+    std::vector<std::vector<MeshLOD>>
+    body_lods(const RigidBodyAssembler& bodies)
+    {
+        std::vector<std::vector<MeshLOD>> lods(bodies.num_bodies());
+        tbb::parallel_for(size_t(0), lods.size(), [&](size_t i) {
+            const RigidBody& body = bodies.m_rbs[i];
+            lods[i].push_back({ body.vertices, body.edges, body.faces });
+            std::vector<MeshLOD> proxies = build_mesh_lods_cached(
+                body.vertices, body.edges, body.faces,
+                Constants::VIEWER_LOD_MIN_PRIMITIVES);
+            std::move(
+                proxies.begin(), proxies.end(), std::back_inserter(lods[i]));
+        });
+        return lods;
+    }
+} // namespace
+
 UISimState::UISimState()
     : m_player_state(PlayerState::Paused)
     , m_has_scene(false)
@@ -17,11 +64,19 @@ UISimState::UISimState()
     , m_interval_time(0.0)
     , m_show_vertex_data(false)
     , m_reloading_scene(false)
+    , m_use_mesh_lods(false)
     , m_scene_changed(false)
     , m_simulation_time(0)
+    , m_is_simulating(false)
+    , m_stop_simulation(false)
+    , m_hit_breakpoint(false)
+    , m_snapshot_velocities(false)
+    , m_has_new_snapshot(false)
 {
 }
 
+UISimState::~UISimState() { stop_simulation_thread(); }
+
 void UISimState::launch(const std::string& inital_scene)
 {
     m_viewer.plugins.push_back(this);
@@ -76,27 +131,38 @@ void UISimState::init(igl::opengl::glfw::Viewer* _viewer)
     load(this->inital_scene);
 }
 
-void UISimState::load_scene()
+void UISimState::load_mesh_data()
 {
-    Eigen::MatrixXd q = m_state.problem_ptr->vertices();
-    Eigen::MatrixXd v =
-        m_state.problem_ptr->velocities() * m_state.problem_ptr->timestep();
+    if (m_state.problem_ptr->is_rb_problem()) {
+        const auto& bodies =
+            std::dynamic_pointer_cast<RigidBodyProblem>(m_state.problem_ptr)
+                ->m_assembler;
+        m_body_types = body_types(bodies);
+        if (m_use_mesh_lods) {
+            mesh_data->set_body_lods(
+                body_lods(bodies), bodies.rb_poses(), m_body_types);
+            return;
+        }
+    }
 
     // mesh_data->data().show_vertid = false;
     mesh_data->set_mesh(
-        q, m_state.problem_ptr->edges(), m_state.problem_ptr->faces());
+        m_state.problem_ptr->vertices(), m_state.problem_ptr->edges(),
+        m_state.problem_ptr->faces());
     Eigen::VectorXi vertex_type;
     if (m_state.problem_ptr->is_rb_problem()) {
         const auto& bodies =
             std::dynamic_pointer_cast<RigidBodyProblem>(m_state.problem_ptr)
                 ->m_assembler;
-        vertex_type.resize(bodies.num_vertices());
-        int start_i = 0;
+        vertex_type = vertex_types(bodies);
+
+        // Later frames only move the bodies' local vertices
+        std::vector<Eigen::MatrixXd> body_vertices;
+        body_vertices.reserve(bodies.num_bodies());
         for (const auto& body : bodies.m_rbs) {
-            vertex_type.segment(start_i, body.vertices.rows())
-                .setConstant(int(body.type));
-            start_i += body.vertices.rows();
+            body_vertices.push_back(body.vertices);
         }
+        mesh_data->set_body_vertices(body_vertices, bodies.rb_poses());
     } else {
         vertex_type =
             m_state.problem_ptr->vertex_dof_fixed().rowwise().all().cast<int>();
@@ -104,6 +170,24 @@ void UISimState::load_scene()
     }
     mesh_data->set_vertex_data(
         m_state.problem_ptr->vertex_dof_fixed(), vertex_type);
+}
+
+void UISimState::load_scene()
+{
+    Eigen::MatrixXd q = m_state.problem_ptr->vertices();
+    Eigen::MatrixXd v =
+        m_state.problem_ptr->velocities() * m_state.problem_ptr->timestep();
+
+    // Huge scenes are drawn with levels of detail unless turned off
+    if (!m_reloading_scene) {
+        const auto& problem = m_state.problem_ptr;
+        const long num_primitives = problem->faces().rows()
+            ? problem->faces().rows()
+            : problem->edges().rows();
+        m_use_mesh_lods = problem->is_rb_problem()
+            && num_primitives > Constants::VIEWER_LOD_SCENE_PRIMITIVES;
+    }
+    load_mesh_data();
     mesh_data->data().point_size = 0 * pixel_ratio();
 
     velocity_data->set_vector_field(q, v);
@@ -134,8 +218,10 @@ void UISimState::load_scene()
     m_viewer.core().orthographic = dim == 2;
     m_viewer.core().lighting_factor = 0.0; // dim == 2 ? 0.0 : 1.0;
     // mesh_data->data().set_face_based(true);
+    // The levels of detail have their own vertices
     m_viewer.core().align_camera_center(
-        q, dim == 2.0 ? mesh_data->mE : mesh_data->mF);
+        mesh_data->has_lods() ? mesh_data->mV : q,
+        dim == 2.0 ? mesh_data->mE : mesh_data->mF);
 
     // Default colors
     // background_color << 0.3f, 0.3f, 0.5f, 1.0f;
@@ -145,38 +231,157 @@ void UISimState::load_scene()
     m_viewer.core().camera_translation << 0, 0, 0;
 }
 
+void UISimState::take_snapshot(SimSnapshot& snapshot) const
+{
+    const auto& problem = m_state.problem_ptr;
+    if (problem->is_rb_problem()) {
+        const auto& bodies =
+            std::dynamic_pointer_cast<RigidBodyProblem>(problem)->m_assembler;
+        snapshot.poses = bodies.rb_poses();
+        snapshot.body_types = body_types(bodies);
+        snapshot.vertex_types = vertex_types(bodies);
+        snapshot.vertex_dof_fixed = problem->vertex_dof_fixed();
+    }
+    const bool has_velocities = m_snapshot_velocities;
+    if (!problem->is_rb_problem() || has_velocities) {
+        snapshot.vertices = problem->vertices();
+    }
+    if (has_velocities) {
+        snapshot.velocities = problem->velocities() * problem->timestep();
+    } else {
+        snapshot.velocities.resize(0, 0);
+    }
+    snapshot.num_simulation_steps = m_state.m_num_simulation_steps;
+    snapshot.num_states = m_state.state_sequence.size();
+}
+
 void UISimState::redraw_scene()
 {
-    Eigen::MatrixXd q1 = m_state.problem_ptr->vertices();
-    Eigen::MatrixXd v1 =
-        m_state.problem_ptr->velocities() * m_state.problem_ptr->timestep();
+    m_snapshot_velocities = velocity_data->visibility();
+    take_snapshot(m_front_snapshot);
+    redraw_scene(m_front_snapshot);
+}
 
-    mesh_data->update_vertices(q1);
-    velocity_data->update_vector_field(q1, v1);
+void UISimState::redraw_scene(const SimSnapshot& snapshot)
+{
     if (m_state.problem_ptr->is_rb_problem()) {
-        const auto& bodies =
-            std::dynamic_pointer_cast<RigidBodyProblem>(m_state.problem_ptr)
-                ->m_assembler;
-        Eigen::VectorXi vertex_type(bodies.num_vertices());
-        int start_i = 0;
-        for (const auto& body : bodies.m_rbs) {
-            vertex_type.segment(start_i, body.vertices.rows())
-                .setConstant(int(body.type));
-            start_i += body.vertices.rows();
+        mesh_data->update_body_poses(snapshot.poses);
+
+        // Only recolor when a body changes type (e.g., falls asleep)
+        if (snapshot.body_types != m_body_types) {
+            m_body_types = snapshot.body_types;
+            if (mesh_data->has_lods()) {
+                mesh_data->set_body_types(m_body_types);
+            } else {
+                mesh_data->set_vertex_data(
+                    snapshot.vertex_dof_fixed, snapshot.vertex_types);
+            }
         }
-        mesh_data->set_vertex_data(
-            m_state.problem_ptr->vertex_dof_fixed(), vertex_type);
+
+        com_data->set_coms(snapshot.poses);
+    } else {
+        mesh_data->update_vertices(snapshot.vertices);
     }
 
-    if (m_state.problem_ptr->is_rb_problem()) {
-        com_data->set_coms(
-            std::dynamic_pointer_cast<RigidBodyProblem>(m_state.problem_ptr)
-                ->m_assembler.rb_poses());
+    if (velocity_data->visibility() && snapshot.velocities.size()) {
+        velocity_data->update_vector_field(
+            snapshot.vertices, snapshot.velocities);
+    }
+}
+
+void UISimState::update_velocity_field()
+{
+    velocity_data->update_vector_field(
+        m_state.problem_ptr->vertices(),
+        m_state.problem_ptr->velocities() * m_state.problem_ptr->timestep());
+}
+
+bool UISimState::is_at_breakpoint() const
+{
+    return (m_bkp_had_collision && m_state.m_step_had_collision)
+        || (m_bkp_has_intersections && m_state.m_step_has_intersections)
+        || (m_bkp_optimization_failed
+            && !m_state.problem_ptr->opt_result.success)
+        || (m_state.m_max_simulation_steps >= 0
+            && m_state.m_num_simulation_steps
+                >= m_state.m_max_simulation_steps);
+}
+
+void UISimState::start_simulation_thread()
+{
+    assert(!m_simulation_thread.joinable());
+    m_active_config = m_state.get_active_config();
+    m_snapshot_velocities = velocity_data->visibility();
+    m_stop_simulation = false;
+    m_hit_breakpoint = false;
+    m_is_simulating = true;
+    m_simulation_thread = std::thread([this]() {
+        while (!m_stop_simulation) {
+            step_simulation();
+
+            // Publish the step through the shared buffer, dropping any
+            // snapshot the renderer has not drawn yet.
+            take_snapshot(m_back_snapshot);
+            {
+                std::lock_guard<std::mutex> lock(m_snapshot_mutex);
+                std::swap(m_back_snapshot, m_shared_snapshot);
+                m_has_new_snapshot = true;
+            }
+
+            if (is_at_breakpoint()) {
+                m_hit_breakpoint = true;
+                break;
+            }
+        }
+        m_is_simulating = false;
+    });
+}
+
+void UISimState::stop_simulation_thread()
+{
+    if (!m_simulation_thread.joinable()) {
+        return;
     }
+    m_stop_simulation = true;
+    m_simulation_thread.join();
+    draw_latest_snapshot();
+}
+
+bool UISimState::draw_latest_snapshot()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_snapshot_mutex);
+        if (!m_has_new_snapshot) {
+            return false;
+        }
+        std::swap(m_shared_snapshot, m_front_snapshot);
+        m_has_new_snapshot = false;
+    }
+    redraw_scene(m_front_snapshot);
+    return true;
 }
 
 bool UISimState::pre_draw_loop()
 {
+    // Use the camera of the previous frame (the current one is not set yet)
+    if (mesh_data->has_lods()) {
+        m_scene_changed |= mesh_data->update_lods(m_viewer.core());
+    }
+
+    if (m_simulation_thread.joinable()) {
+        m_snapshot_velocities = velocity_data->visibility();
+        m_scene_changed |= draw_latest_snapshot();
+        if (m_is_simulating) {
+            return false;
+        }
+        // The simulation stopped itself at a breakpoint
+        stop_simulation_thread();
+        if (m_hit_breakpoint) {
+            m_player_state = PlayerState::Paused;
+            log_simulation_time();
+        }
+    }
+
     size_t last_save_state = m_state.state_sequence.size() - 1;
     if (m_state.m_num_simulation_steps > last_save_state) {
         m_state.m_num_simulation_steps = last_save_state;
@@ -184,7 +389,7 @@ bool UISimState::pre_draw_loop()
         replaying = false;
     }
     if (replaying) {
-        m_state.problem_ptr->state(
+        m_state.problem_ptr->state_from(
             m_state.state_sequence[m_state.m_num_simulation_steps]);
         redraw_scene();
         m_scene_changed = true;
@@ -196,20 +401,7 @@ bool UISimState::pre_draw_loop()
             replaying = false;
         }
     } else if (m_player_state == PlayerState::Playing) {
-        simulation_step();
-
-        bool breakpoint = (m_bkp_had_collision && m_state.m_step_had_collision)
-            || (m_bkp_has_intersections && m_state.m_step_has_intersections)
-            || (m_bkp_optimization_failed
-                && !m_state.problem_ptr->opt_result.success)
-            || (m_state.m_max_simulation_steps >= 0
-                && m_state.m_num_simulation_steps
-                    >= m_state.m_max_simulation_steps);
-        if (breakpoint) {
-            m_player_state = PlayerState::Paused;
-            log_simulation_time();
-        }
-        m_scene_changed = true;
+        start_simulation_thread();
     }
     return false;
 }
@@ -258,50 +450,36 @@ void UISimState::start_recording(const std::string& filename)
 
     int width, height;
     get_window_dimensions(width, height);
-    width = static_cast<int>(m_gif_scale * width);
-    height = static_cast<int>(m_gif_scale * height);
-    GifBegin(&m_gif_writer, filename.c_str(), width, height, m_gif_delay);
-    m_scene_changed = true;
-    // post_draw_loop();
-    m_is_gif_recording = true;
+    if (m_recorder.begin(filename, width, height, m_gif_scale, m_gif_delay)) {
+        m_scene_changed = true;
+    }
 }
 
-bool UISimState::post_draw_loop()
+bool UISimState::post_draw()
 {
-    if (m_scene_changed && m_is_gif_recording) {
-        int width, height;
-        get_window_dimensions(width, height);
-        width = static_cast<int>(m_gif_scale * width);
-        height = static_cast<int>(m_gif_scale * height);
-
-        using MatrixXuc = MatrixX<unsigned char>;
-        // Allocate temporary buffers for image
-        MatrixXuc R(width, height), G(width, height), B(width, height),
-            A(width, height);
-
-        // Draw the scene in the buffers
-        m_viewer.core().draw_buffer(mesh_data->data(), false, R, G, B, A);
-
-        std::vector<uint8_t> img(width * height * 4);
-        for (int rowI = 0; rowI < width; rowI++) {
-            for (int colI = 0; colI < height; colI++) {
-                int indStart = (rowI + (height - 1 - colI) * width) * 4;
-                img[indStart] = R(rowI, colI);
-                img[indStart + 1] = G(rowI, colI);
-                img[indStart + 2] = B(rowI, colI);
-                img[indStart + 3] = A(rowI, colI);
-            }
-        }
-        GifWriteFrame(&m_gif_writer, img.data(), width, height, m_gif_delay);
+    // The scene is drawn, but not the menu over it
+    if (m_scene_changed && m_recorder.is_recording()) {
+        const Eigen::Vector4f& viewport = m_viewer.core().viewport;
+        m_recorder.capture(
+            int(viewport(0)), int(viewport(1)), int(viewport(2)),
+            int(viewport(3)));
     }
+    return Super::post_draw();
+}
+
+bool UISimState::post_draw_loop()
+{
     m_scene_changed = false;
     return false;
 }
 
-void UISimState::end_recording()
+void UISimState::end_recording() { m_recorder.end(); }
+
+void UISimState::shutdown()
 {
-    GifEnd(&m_gif_writer);
-    m_is_gif_recording = false;
+    // Read the pending frames back while the GL context exists
+    end_recording();
+    Super::shutdown();
 }
 
 bool UISimState::custom_key_pressed(unsigned int unicode_key, int modifiers)
@@ -328,6 +506,7 @@ bool UISimState::custom_key_pressed(unsigned int unicode_key, int modifiers)
         return true;
     }
     case ' ': {
+        stop_simulation_thread();
         m_player_state = m_player_state == PlayerState::Playing
             ? PlayerState::Paused
             : PlayerState::Playing;
@@ -1,6 +1,9 @@
 #pragma once
 
+#include <atomic>
 #include <memory> // shared_ptr
+#include <mutex>
+#include <thread>
 
 #include <spdlog/spdlog.h>
 
@@ -10,14 +13,9 @@
 #include <igl/png/render_to_png.h>
 #include <igl/png/writePNG.h>
 
+#include <viewer/frame_recorder.hpp>
 #include <viewer/igl_viewer_ext.hpp>
 
-// WARNING: Use an anonymous namespace when including gif.h to avoid duplicate
-//          symbols.
-namespace {
-#include <gif.h>
-}
-
 #include "SimState.hpp"
 #include <profiler.hpp>
 
@@ -28,12 +26,15 @@ class UISimState : public igl::opengl::glfw::imgui::ImGuiMenu {
 
 public:
     UISimState();
-    ~UISimState() override {}
+    ~UISimState() override;
 
     enum PlayerState { Playing = 0, Paused, TotalPlayerStatus };
 
     virtual void init(igl::opengl::glfw::Viewer* _viewer) override;
     virtual void draw_menu() override;
+    /// @brief Capture the frame being recorded before the menu is drawn.
+    virtual bool post_draw() override;
+    virtual void shutdown() override;
     // virtual bool mouse_down(int button, int modifier) override;
     // virtual bool key_pressed(unsigned int key, int modifiers) override;
 
@@ -42,7 +43,14 @@ public:
 
     void launch(const std::string& inital_scene);
     void load_scene();
+    /// @brief Set the mesh from the current state, with levels of detail if
+    /// enabled.
+    void load_mesh_data();
     void redraw_scene();
+    /// @brief Update the (hidden by default) velocity field.
+    void update_velocity_field();
+    /// @brief Stop the simulation thread after its current step.
+    void stop_simulation_thread();
     bool pre_draw_loop();
     bool post_draw_loop();
 
@@ -50,6 +58,7 @@ public:
 
     bool load(std::string scene_filename) override
     {
+        stop_simulation_thread();
         if (scene_filename != "" && m_state.load_scene(scene_filename)) {
             load_scene();
             return true;
@@ -58,19 +67,22 @@ public:
     }
     bool save(std::string scene_filename) override
     {
+        stop_simulation_thread();
         return m_state.save_simulation(scene_filename);
     }
 
     bool save_obj_sequence(const std::string& dir_name)
     {
+        stop_simulation_thread();
         bool success = m_state.save_obj_sequence(dir_name);
-        m_state.problem_ptr->state(
+        m_state.problem_ptr->state_from(
             m_state.state_sequence[m_state.m_num_simulation_steps]);
         return success;
     }
 
     bool save_gltf(const std::string& filename)
     {
+        stop_simulation_thread();
         return m_state.save_gltf(filename);
     }
 
@@ -86,6 +98,7 @@ public:
 
     void reload()
     {
+        stop_simulation_thread();
         m_reloading_scene = true;
         m_state.reload_scene();
         load_scene();
@@ -94,12 +107,7 @@ public:
 
     void simulation_step()
     {
-        igl::Timer timer;
-        timer.start();
-        m_state.simulation_step();
-        timer.stop();
-        m_simulation_time += timer.getElapsedTime();
-        m_state.save_simulation_step();
+        step_simulation();
         redraw_scene();
     }
 
@@ -121,6 +129,45 @@ public:
     bool m_show_vertex_data;
 
 protected:
+    /// @brief What the renderer needs to draw one simulation step.
+    struct SimSnapshot {
+        PosesD poses;
+        std::vector<int> body_types;
+        Eigen::VectorXi vertex_types;
+        MatrixXb vertex_dof_fixed;
+        /// @brief World vertices (only for non-rigid problems or the
+        /// velocity field).
+        Eigen::MatrixXd vertices;
+        /// @brief Vertex displacements (only if the velocity field is shown).
+        Eigen::MatrixXd velocities;
+        int num_simulation_steps = 0;
+        size_t num_states = 0;
+    };
+
+    void step_simulation()
+    {
+        igl::Timer timer;
+        timer.start();
+        m_state.simulation_step();
+        timer.stop();
+        m_simulation_time += timer.getElapsedTime();
+        m_state.save_simulation_step();
+    }
+
+    bool is_at_breakpoint() const;
+    void take_snapshot(SimSnapshot& snapshot) const;
+    void redraw_scene(const SimSnapshot& snapshot);
+
+    /// @brief Step the simulation on a worker thread until paused or at a
+    /// breakpoint, publishing a snapshot after every step.
+    ///
+    /// While the thread runs it owns m_state and the renderer only reads
+    /// the snapshots.
+    void start_simulation_thread();
+    /// @brief Redraw the newest published snapshot (if any).
+    /// @returns If there was a new snapshot.
+    bool draw_latest_snapshot();
+
     void draw_io();
     void draw_simulation_player();
     void draw_settings();
@@ -136,15 +183,33 @@ private:
         datas_;
 
     bool m_reloading_scene;
+    /// @brief Draw the bodies with levels of detail and cull them.
+    bool m_use_mesh_lods;
+    /// @brief Body types the mesh colors were last set with.
+    std::vector<int> m_body_types;
 
-    GifWriter m_gif_writer;
+    FrameRecorder m_recorder;
     uint32_t m_gif_delay = 1; //*10ms
     double m_gif_scale = 0.5;
-    bool m_is_gif_recording = false;
     bool m_scene_changed;
 
     double m_simulation_time;
 
+    std::thread m_simulation_thread;
+    std::atomic<bool> m_is_simulating;
+    std::atomic<bool> m_stop_simulation;
+    std::atomic<bool> m_hit_breakpoint;
+    std::atomic<bool> m_snapshot_velocities;
+    /// @brief Configuration of the running simulation (for the settings).
+    nlohmann::json m_active_config;
+
+    /// @brief Triple buffer of snapshots: the worker fills the back buffer
+    /// and swaps it with the shared one, which the renderer swaps with the
+    /// front buffer it draws.
+    SimSnapshot m_back_snapshot, m_shared_snapshot, m_front_snapshot;
+    std::mutex m_snapshot_mutex;
+    bool m_has_new_snapshot;
+
     std::string inital_scene;
 };
 
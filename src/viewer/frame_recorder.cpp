@@ -0,0 +1,232 @@
+#include "frame_recorder.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+#include <constants.hpp>
+#include <logger.hpp>
+
+// WARNING: Use an anonymous namespace when including gif.h to avoid duplicate
+//          symbols.
+namespace {
+#include <gif.h>
+}
+
+namespace ipc::rigid {
+
+struct FrameRecorder::Encoder {
+    GifWriter writer;
+    /// @brief Scaled frame from the top row down.
+    std::vector<uint8_t> image;
+};
+
+namespace {
+    /// @brief Box filter a bottom-up RGBA image into a top-down one.
+    void scale_and_flip(
+        const uint8_t* src,
+        int src_width,
+        int src_height,
+        uint8_t* dst,
+        int dst_width,
+        int dst_height)
+    {
+        for (int y = 0; y < dst_height; y++) {
+            const int y0 = y * src_height / dst_height;
+            const int y1 = std::max((y + 1) * src_height / dst_height, y0 + 1);
+            for (int x = 0; x < dst_width; x++) {
+                const int x0 = x * src_width / dst_width;
+                const int x1 =
+                    std::max((x + 1) * src_width / dst_width, x0 + 1);
+                uint32_t sum[4] = { 0, 0, 0, 0 };
+                for (int sy = y0; sy < y1; sy++) {
+                    const uint8_t* row = src + 4 * size_t(sy) * src_width;
+                    for (int sx = x0; sx < x1; sx++) {
+                        for (int c = 0; c < 4; c++) {
+                            sum[c] += row[4 * sx + c];
+                        }
+                    }
+                }
+                const uint32_t n = uint32_t((y1 - y0) * (x1 - x0));
+                uint8_t* pixel =
+                    dst + 4 * (size_t(dst_height - 1 - y) * dst_width + x);
+                for (int c = 0; c < 4; c++) {
+                    pixel[c] = uint8_t(sum[c] / n);
+                }
+            }
+        }
+    }
+} // namespace
+
+FrameRecorder::~FrameRecorder()
+{
+    // Without a GL context the pending readbacks are lost, but the frames
+    // already read are still written.
+    finish_encoding();
+}
+
+bool FrameRecorder::begin(
+    const std::string& filename,
+    int width,
+    int height,
+    double scale,
+    uint32_t delay)
+{
+    if (is_recording()) {
+        end();
+    }
+
+    m_gif_width = std::max(int(scale * width), 1);
+    m_gif_height = std::max(int(scale * height), 1);
+    m_delay = delay;
+    m_gif = std::make_unique<Encoder>();
+    if (!GifBegin(
+            &m_gif->writer, filename.c_str(), m_gif_width, m_gif_height,
+            m_delay)) {
+        spdlog::error("unable to open recording={}", filename);
+        m_gif.reset();
+        return false;
+    }
+    m_gif->image.resize(4 * size_t(m_gif_width) * m_gif_height);
+
+    if (m_pixel_buffers[0] == 0) {
+        glGenBuffers(GLsizei(NUM_PIXEL_BUFFERS), m_pixel_buffers.data());
+    }
+    m_first_pending = m_num_pending = 0;
+    m_is_closing = false;
+    m_num_frames = m_num_dropped_frames = 0;
+    m_encoder = std::thread(&FrameRecorder::encode_frames, this);
+    spdlog::info(
+        "recording={} width={:d} height={:d}", filename, m_gif_width,
+        m_gif_height);
+    return true;
+}
+
+void FrameRecorder::capture(int x, int y, int width, int height)
+{
+    if (!is_recording() || width <= 0 || height <= 0) {
+        return;
+    }
+
+    collect(m_num_pending == NUM_PIXEL_BUFFERS ? 1 : 0);
+
+    const size_t i = (m_first_pending + m_num_pending) % NUM_PIXEL_BUFFERS;
+    const size_t size = 4 * size_t(width) * height;
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, m_pixel_buffers[i]);
+    if (m_capacities[i] < size) {
+        glBufferData(GL_PIXEL_PACK_BUFFER, size, nullptr, GL_STREAM_READ);
+        m_capacities[i] = size;
+    }
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    // Returns immediately, the copy finishes on the GPU
+    glReadPixels(x, y, width, height, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    m_fences[i] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    m_widths[i] = width;
+    m_heights[i] = height;
+    m_num_pending++;
+}
+
+void FrameRecorder::collect(size_t min_frames)
+{
+    while (m_num_pending > 0) {
+        const size_t i = m_first_pending;
+        const bool wait = min_frames > 0;
+        const GLenum status = glClientWaitSync(
+            m_fences[i], wait ? GL_SYNC_FLUSH_COMMANDS_BIT : 0,
+            wait ? GLuint64(1e9) : 0);
+        if (status == GL_TIMEOUT_EXPIRED && !wait) {
+            break;
+        }
+        glDeleteSync(m_fences[i]);
+        m_fences[i] = nullptr;
+
+        Frame frame;
+        frame.width = m_widths[i];
+        frame.height = m_heights[i];
+        frame.pixels.resize(4 * size_t(frame.width) * frame.height);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, m_pixel_buffers[i]);
+        const void* pixels = glMapBufferRange(
+            GL_PIXEL_PACK_BUFFER, 0, frame.pixels.size(), GL_MAP_READ_BIT);
+        if (pixels != nullptr) {
+            std::memcpy(frame.pixels.data(), pixels, frame.pixels.size());
+            glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+        }
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+        m_first_pending = (m_first_pending + 1) % NUM_PIXEL_BUFFERS;
+        m_num_pending--;
+        min_frames -= wait;
+        if (pixels == nullptr) {
+            continue;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            // Drop the frame rather than grow without bound (or block the
+            // render loop) when the encoder falls behind
+            if (m_frames.size() >= Constants::RECORDING_MAX_QUEUED_FRAMES) {
+                m_num_dropped_frames++;
+                continue;
+            }
+            m_frames.push_back(std::move(frame));
+        }
+        m_frames_changed.notify_one();
+    }
+}
+
+void FrameRecorder::end()
+{
+    if (!is_recording()) {
+        return;
+    }
+    collect(m_num_pending);
+    glDeleteBuffers(GLsizei(NUM_PIXEL_BUFFERS), m_pixel_buffers.data());
+    m_pixel_buffers = {};
+    m_capacities = {};
+    finish_encoding();
+}
+
+void FrameRecorder::encode_frames()
+{
+    while (true) {
+        Frame frame;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_frames_changed.wait(
+                lock, [this] { return m_is_closing || !m_frames.empty(); });
+            if (m_frames.empty()) {
+                return; // Closing with every frame encoded
+            }
+            frame = std::move(m_frames.front());
+            m_frames.pop_front();
+        }
+        scale_and_flip(
+            frame.pixels.data(), frame.width, frame.height,
+            m_gif->image.data(), m_gif_width, m_gif_height);
+        GifWriteFrame(
+            &m_gif->writer, m_gif->image.data(), m_gif_width, m_gif_height,
+            m_delay);
+        m_num_frames++;
+    }
+}
+
+void FrameRecorder::finish_encoding()
+{
+    if (!m_encoder.joinable()) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_is_closing = true;
+    }
+    m_frames_changed.notify_one();
+    m_encoder.join();
+    GifEnd(&m_gif->writer);
+    m_gif.reset();
+    m_num_pending = 0;
+    spdlog::info(
+        "recorded_frames={:d} dropped_frames={:d}", m_num_frames,
+        m_num_dropped_frames);
+}
+
+} // namespace ipc::rigid
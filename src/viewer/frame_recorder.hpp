@@ -0,0 +1,81 @@
+#pragma once
+
+#include <array>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <igl/opengl/gl.h>
+
+namespace ipc::rigid {
+
+/// @brief Record the viewer's framebuffer to a GIF without stalling the
+/// render loop.
+///
+/// Frames are read back asynchronously into pixel buffer objects and handed,
+/// once the GPU is done with them, to a thread that scales and encodes them.
+/// All methods except the destructor must be called on the render thread.
+class FrameRecorder {
+public:
+    ~FrameRecorder();
+
+    /// @brief Open the GIF file.
+    /// @param width, height  Size of the recorded framebuffer.
+    /// @param scale  Scale of the GIF frames relative to the framebuffer.
+    /// @param delay  Delay between frames (in hundredths of a second).
+    bool begin(
+        const std::string& filename,
+        int width,
+        int height,
+        double scale,
+        uint32_t delay);
+
+    /// @brief Queue a readback of a region of the current framebuffer.
+    void capture(int x, int y, int width, int height);
+
+    /// @brief Encode the captured frames and close the file.
+    void end();
+
+    bool is_recording() const { return m_encoder.joinable(); }
+
+protected:
+    struct Frame {
+        int width, height;
+        /// @brief RGBA pixels from the bottom row up.
+        std::vector<uint8_t> pixels;
+    };
+
+    /// @brief Hand the finished readbacks to the encoder, waiting for at
+    /// least the oldest min_frames of them.
+    void collect(size_t min_frames);
+    void encode_frames();
+    /// @brief Stop the encoder after the queued frames and close the file.
+    void finish_encoding();
+
+    static const size_t NUM_PIXEL_BUFFERS = 3;
+    std::array<GLuint, NUM_PIXEL_BUFFERS> m_pixel_buffers = {};
+    std::array<GLsync, NUM_PIXEL_BUFFERS> m_fences = {};
+    std::array<int, NUM_PIXEL_BUFFERS> m_widths = {}, m_heights = {};
+    std::array<size_t, NUM_PIXEL_BUFFERS> m_capacities = {};
+    /// @brief Oldest pending readback and the number pending.
+    size_t m_first_pending = 0, m_num_pending = 0;
+
+    struct Encoder;
+    std::unique_ptr<Encoder> m_gif;
+    int m_gif_width = 0, m_gif_height = 0;
+    uint32_t m_delay = 1;
+
+    std::thread m_encoder;
+    std::mutex m_mutex;
+    std::condition_variable m_frames_changed;
+    std::deque<Frame> m_frames;
+    bool m_is_closing = false;
+    size_t m_num_frames = 0, m_num_dropped_frames = 0;
+};
+
+} // namespace ipc::rigid
@@ -5,6 +5,8 @@
 #include <igl/slice.h>
 #include <igl/slice_mask.h>
 
+#include <constants.hpp>
+
 using namespace ipc;
 
 namespace igl {
@@ -121,6 +123,239 @@ namespace opengl {
         data().labels_positions = mV;
     }
 
+    void MeshData::set_body_vertices(
+        const std::vector<Eigen::MatrixXd>& body_vertices,
+        const ipc::rigid::PosesD& poses)
+    {
+        assert(body_vertices.size() == poses.size());
+        m_body_lods.clear();
+        m_body_levels.clear();
+        m_body_vertices = body_vertices;
+        m_body_vertex_starts.resize(body_vertices.size() + 1);
+        m_body_vertex_starts[0] = 0;
+        for (size_t i = 0; i < body_vertices.size(); i++) {
+            m_body_vertex_starts[i + 1] =
+                m_body_vertex_starts[i] + body_vertices[i].rows();
+        }
+        assert(m_body_vertex_starts.back() == mV.rows());
+        m_body_poses = poses;
+    }
+
+    void MeshData::update_body_poses(const ipc::rigid::PosesD& poses)
+    {
+        assert(poses.size() == m_body_vertices.size());
+
+        // Static and sleeping bodies keep their pose, so their vertices are
+        // not touched.
+        bool is_moved = false;
+        for (size_t i = 0; i < poses.size(); i++) {
+            if (poses[i] == m_body_poses[i]) {
+                continue;
+            }
+            const Eigen::MatrixXd& V = m_body_vertices[i];
+            const MatrixMax3d R = poses[i].construct_rotation_matrix();
+            mV.block(m_body_vertex_starts[i], 0, V.rows(), V.cols()) =
+                (V * R.transpose()).rowwise() + poses[i].position.transpose();
+            m_body_poses[i] = poses[i];
+            is_moved = true;
+        }
+
+        if (is_moved) {
+            update_positions();
+        }
+    }
+
+    void MeshData::update_positions()
+    {
+        data().set_vertices(mV);
+        if (mF.size()) {
+            data().compute_normals();
+        }
+
+        // The overlays were built from mV, mE in order (see recolor)
+        if (data().points.rows() == mV.rows()) {
+            data().points.leftCols(3) = mV;
+        }
+        if (data().lines.rows() == mE.rows()) {
+            for (int i = 0; i < mE.rows(); i++) {
+                data().lines.block<1, 3>(i, 0) = mV.row(mE(i, 0));
+                data().lines.block<1, 3>(i, 3) = mV.row(mE(i, 1));
+            }
+        }
+        data().dirty |=
+            MeshGL::DIRTY_OVERLAY_POINTS | MeshGL::DIRTY_OVERLAY_LINES;
+        // The vertex labels are of the full mesh
+        if (!has_lods()) {
+            data().labels_positions = mV;
+        }
+    }
+
+    void MeshData::set_body_lods(
+        std::vector<std::vector<ipc::rigid::MeshLOD>> body_lods,
+        const ipc::rigid::PosesD& poses,
+        const std::vector<int>& body_types)
+    {
+        assert(body_lods.size() == poses.size());
+        assert(body_types.size() == poses.size());
+        m_body_lods = std::move(body_lods);
+        m_body_poses = poses;
+        m_body_types = body_types;
+
+        m_body_box_corners.resize(m_body_lods.size());
+        for (size_t i = 0; i < m_body_lods.size(); i++) {
+            const Eigen::MatrixXd& V = m_body_lods[i][0].vertices;
+            const Eigen::RowVectorXd min = V.colwise().minCoeff();
+            const Eigen::RowVectorXd max = V.colwise().maxCoeff();
+            Eigen::MatrixXd& corners = m_body_box_corners[i];
+            corners.resize(1 << V.cols(), V.cols());
+            for (int c = 0; c < corners.rows(); c++) {
+                for (int j = 0; j < V.cols(); j++) {
+                    corners(c, j) = (c >> j) & 1 ? max(j) : min(j);
+                }
+            }
+        }
+
+        // Start coarse so the first frame of a huge scene is quick to build
+        m_body_levels.resize(m_body_lods.size());
+        for (size_t i = 0; i < m_body_lods.size(); i++) {
+            m_body_levels[i] = int(m_body_lods[i].size()) - 1;
+        }
+        vertex_data_labels.clear();
+        build_lod_mesh();
+    }
+
+    void MeshData::build_lod_mesh()
+    {
+        const size_t num_bodies = m_body_lods.size();
+        const int dim = num_bodies ? m_body_lods[0][0].vertices.cols() : 3;
+        long num_vertices = 0, num_edges = 0, num_faces = 0;
+        for (size_t i = 0; i < num_bodies; i++) {
+            if (m_body_levels[i] >= 0) {
+                const ipc::rigid::MeshLOD& lod =
+                    m_body_lods[i][m_body_levels[i]];
+                num_vertices += lod.vertices.rows();
+                num_edges += lod.edges.rows();
+                num_faces += lod.faces.rows();
+            }
+        }
+
+        Eigen::MatrixXd V(num_vertices, dim);
+        Eigen::MatrixXi E(num_edges, 2), F(num_faces, 3);
+        m_vertex_type.resize(num_vertices);
+        m_body_vertices.resize(num_bodies);
+        m_body_vertex_starts.resize(num_bodies + 1);
+        long v = 0, e = 0, f = 0;
+        for (size_t i = 0; i < num_bodies; i++) {
+            m_body_vertex_starts[i] = v;
+            if (m_body_levels[i] < 0) {
+                m_body_vertices[i].resize(0, dim);
+                continue;
+            }
+            const ipc::rigid::MeshLOD& lod = m_body_lods[i][m_body_levels[i]];
+            const long n = lod.vertices.rows();
+            const MatrixMax3d R = m_body_poses[i].construct_rotation_matrix();
+            V.middleRows(v, n) = (lod.vertices * R.transpose()).rowwise()
+                + m_body_poses[i].position.transpose();
+            // Empty meshes may have no columns
+            if (lod.edges.rows()) {
+                E.middleRows(e, lod.edges.rows()) = lod.edges.array() + int(v);
+            }
+            if (lod.faces.rows()) {
+                F.middleRows(f, lod.faces.rows()) = lod.faces.array() + int(v);
+            }
+            m_vertex_type.segment(v, n).setConstant(m_body_types[i]);
+            m_body_vertices[i] = lod.vertices;
+            v += n;
+            e += lod.edges.rows();
+            f += lod.faces.rows();
+        }
+        m_body_vertex_starts[num_bodies] = v;
+
+        set_mesh(V, E, F);
+        data().labels_positions.resize(0, 0);
+        recolor();
+    }
+
+    bool MeshData::update_lods(const igl::opengl::ViewerCore& core)
+    {
+        using namespace ipc::rigid;
+        const Eigen::Matrix4d view_projection =
+            (core.proj * core.view).cast<double>();
+        const double width = core.viewport(2), height = core.viewport(3);
+
+        std::vector<int> levels(m_body_lods.size());
+        for (size_t i = 0; i < m_body_lods.size(); i++) {
+            const Eigen::MatrixXd& corners = m_body_box_corners[i];
+            const MatrixMax3d R = m_body_poses[i].construct_rotation_matrix();
+            Eigen::Matrix4Xd X = Eigen::Matrix4Xd::Zero(4, corners.rows());
+            X.topRows(corners.cols()) =
+                ((corners * R.transpose()).rowwise()
+                 + m_body_poses[i].position.transpose())
+                    .transpose();
+            X.row(3).setOnes();
+            const Eigen::Matrix4Xd clip = view_projection * X;
+
+            // Culled if all corners are outside the same clipping plane
+            bool is_culled = false;
+            for (int j = 0; j < 3 && !is_culled; j++) {
+                is_culled =
+                    (clip.row(j).array() > clip.row(3).array()).all()
+                    || (clip.row(j).array() < -clip.row(3).array()).all();
+            }
+            if (is_culled) {
+                levels[i] = -1;
+                continue;
+            }
+            // Bodies reaching behind the camera have no size on screen
+            if ((clip.row(3).array() <= 0).any()) {
+                levels[i] = 0;
+                continue;
+            }
+
+            const Eigen::Array2Xd ndc =
+                clip.topRows(2).array().rowwise() / clip.row(3).array();
+            const double pixels_x =
+                (ndc.row(0).maxCoeff() - ndc.row(0).minCoeff()) * width / 2;
+            const double pixels_y =
+                (ndc.row(1).maxCoeff() - ndc.row(1).minCoeff()) * height / 2;
+            const double pixels = Constants::VIEWER_LOD_PIXELS_PER_PRIMITIVE;
+            const double needed_primitives =
+                m_body_lods[i][0].faces.rows() > 0
+                ? pixels_x * pixels_y / pixels
+                : (pixels_x + pixels_y) / std::sqrt(pixels);
+
+            // Coarsest level with enough primitives for its size on screen
+            int level = int(m_body_lods[i].size()) - 1;
+            while (level > 0
+                   && m_body_lods[i][level].num_primitives()
+                       < needed_primitives) {
+                level--;
+            }
+            levels[i] = level;
+        }
+
+        if (levels == m_body_levels) {
+            return false;
+        }
+        m_body_levels = levels;
+        build_lod_mesh();
+        return true;
+    }
+
+    void MeshData::set_body_types(const std::vector<int>& body_types)
+    {
+        assert(body_types.size() == m_body_lods.size());
+        m_body_types = body_types;
+        for (size_t i = 0; i < body_types.size(); i++) {
+            m_vertex_type
+                .segment(
+                    m_body_vertex_starts[i],
+                    m_body_vertex_starts[i + 1] - m_body_vertex_starts[i])
+                .setConstant(body_types[i]);
+        }
+        recolor();
+    }
+
     void MeshData::recolor()
     {
         assert(mV.rows() == m_vertex_type.rows());
@@ -182,7 +417,7 @@ namespace opengl {
 
     void MeshData::update_vertex_data()
     {
-        if (show_vertex_data) {
+        if (show_vertex_data && !has_lods()) {
             data().labels_positions = mV;
             data().labels_strings = vertex_data_labels;
         } else {
@@ -4,6 +4,7 @@
 #include <igl/opengl/ViewerData.h>
 #include <igl/opengl/glfw/Viewer.h>
 
+#include <geometry/mesh_lod.hpp>
 #include <physics/pose.hpp>
 #include <utils/eigen_ext.hpp>
 
@@ -83,6 +84,39 @@ namespace opengl {
         void update_vertex_data() override;
         void update_vertices(const Eigen::MatrixXd& V);
 
+        /// @brief Keep each body's local vertices so later frames only need
+        /// the body poses.
+        /// @param body_vertices Local vertices of each body, in the order of
+        ///                      the bodies' vertices in the mesh.
+        /// @param poses Poses of the bodies in the current mesh.
+        void set_body_vertices(
+            const std::vector<Eigen::MatrixXd>& body_vertices,
+            const ipc::rigid::PosesD& poses);
+        /// @brief Move the vertices of the bodies whose pose changed,
+        /// updating only the position buffers (colors and topology are kept).
+        void update_body_poses(const ipc::rigid::PosesD& poses);
+
+        /// @brief Draw every body with one of its levels of detail, or not
+        /// at all when outside the view (see update_lods).
+        ///
+        /// Replaces the mesh (and its vertex data). The body poses are
+        /// updated with update_body_poses as for the full mesh.
+        /// @param body_lods  Levels of each body in body space, from its full
+        ///                   mesh to its coarsest proxy.
+        /// @param poses Poses of the bodies.
+        /// @param body_types Type of every body (for the colors).
+        void set_body_lods(
+            std::vector<std::vector<ipc::rigid::MeshLOD>> body_lods,
+            const ipc::rigid::PosesD& poses,
+            const std::vector<int>& body_types);
+        bool has_lods() const { return !m_body_lods.empty(); }
+        /// @brief Cull the bodies whose bounding box is outside the view and
+        /// pick the level of the others from their size on screen.
+        /// @returns If the drawn mesh changed.
+        bool update_lods(const igl::opengl::ViewerCore& core);
+        /// @brief Recolor the levels of detail with new body types.
+        void set_body_types(const std::vector<int>& body_types);
+
         virtual bool visibility() override { return data().show_overlay; }
         virtual void visibility(const bool show) override
         {
@@ -98,11 +132,29 @@ namespace opengl {
 
         Eigen::VectorXi m_vertex_type;
 
+        std::vector<Eigen::MatrixXd> m_body_vertices;
+        std::vector<long> m_body_vertex_starts;
+        ipc::rigid::PosesD m_body_poses;
+
+        std::vector<std::vector<ipc::rigid::MeshLOD>> m_body_lods;
+        /// @brief Corners of the bounding box of each body in body space.
+        std::vector<Eigen::MatrixXd> m_body_box_corners;
+        /// @brief Level drawn for each body (-1 if culled).
+        std::vector<int> m_body_levels;
+        std::vector<int> m_body_types;
+
         Eigen::RowVector3d m_edge_color;
         Eigen::RowVector3d m_static_color;
         Eigen::RowVector3d m_kinematic_color;
 
         std::vector<std::string> vertex_data_labels;
+
+    protected:
+        /// @brief Upload the positions in mV to the vertex, point, and
+        /// line buffers.
+        void update_positions();
+        /// @brief Set the mesh to the levels in m_body_levels.
+        void build_lod_mesh();
     };
 
     class VectorFieldData : public ViewerDataExt {
@@ -0,0 +1,204 @@
+// Test the C API of rigid IPC simulations.
+
+#include <catch2/catch.hpp>
+
+#include <fstream>
+#include <string>
+
+#include <ghc/fs_std.hpp> // filesystem
+
+#include <rigid_ipc.h>
+
+namespace {
+/// @brief Write a 2D scene of a square above a static floor.
+std::string write_square_scene()
+{
+    const fs::path filename = fs::temp_directory_path() / "test_c_api.json";
+    std::ofstream(filename.string()) << R"({
+    "scene_type": "distance_barrier_rb_problem",
+    "timestep": 0.01,
+    "rigid_body_problem": {
+        "gravity": [0.0, -9.8],
+        "rigid_bodies": [{
+            "vertices": [[-0.5, -0.5], [0.5, -0.5], [0.5, 0.5], [-0.5, 0.5]],
+            "edges": [[0, 1], [1, 2], [2, 3], [3, 0]],
+            "position": [0, 1]
+        }, {
+            "vertices": [[-5, -0.1], [5, -0.1], [5, 0], [-5, 0]],
+            "edges": [[0, 1], [1, 2], [2, 3], [3, 0]],
+            "type": "static"
+        }]
+    }
+})";
+    return filename.string();
+}
+} // namespace
+
+TEST_CASE("C API simulation", "[capi]")
+{
+    CHECK(ripc_api_version() == RIGID_IPC_C_API_VERSION);
+
+    const std::string filename = write_square_scene();
+    ripc_simulation* sim = ripc_create();
+    REQUIRE(sim != nullptr);
+    CHECK(ripc_dim(sim) == 0);
+    CHECK(ripc_num_bodies(sim) == 0);
+
+    REQUIRE(
+        ripc_load_scene(sim, filename.c_str(), R"({"timestep": 0.02})")
+        == RIPC_OK);
+    CHECK(ripc_dim(sim) == 2);
+    CHECK(ripc_num_bodies(sim) == 2);
+    CHECK(ripc_pose_size(sim) == 3);
+
+    double timestep = 0;
+    CHECK(ripc_get_timestep(sim, &timestep) == RIPC_OK);
+    CHECK(timestep == 0.02);
+    CHECK(ripc_set_timestep(sim, 0.01) == RIPC_OK);
+    CHECK(ripc_get_timestep(sim, &timestep) == RIPC_OK);
+    CHECK(timestep == 0.01);
+
+    SECTION("Pose and velocity round trips")
+    {
+        const double position[2] = { 0.5, 2 }, rotation[1] = { 0.1 };
+        CHECK(ripc_set_body_pose(sim, 0, position, rotation) == RIPC_OK);
+        double actual_position[2], actual_rotation[1];
+        CHECK(
+            ripc_get_body_pose(sim, 0, actual_position, actual_rotation)
+            == RIPC_OK);
+        CHECK(actual_position[0] == position[0]);
+        CHECK(actual_position[1] == position[1]);
+        CHECK(actual_rotation[0] == rotation[0]);
+
+        // Keep the position when only the rotation is given
+        const double new_rotation[1] = { -0.2 };
+        CHECK(ripc_set_body_pose(sim, 0, nullptr, new_rotation) == RIPC_OK);
+        CHECK(
+            ripc_get_body_pose(sim, 0, actual_position, nullptr) == RIPC_OK);
+        CHECK(actual_position[1] == position[1]);
+
+        double poses[6];
+        CHECK(ripc_get_poses(sim, poses, 6) == RIPC_OK);
+        CHECK(poses[0] == position[0]);
+        CHECK(poses[1] == position[1]);
+        CHECK(poses[2] == new_rotation[0]);
+
+        const double linear[2] = { 1, -2 }, angular[1] = { 0.5 };
+        CHECK(ripc_set_body_velocity(sim, 0, linear, angular) == RIPC_OK);
+        double actual_linear[2], actual_angular[1];
+        CHECK(
+            ripc_get_body_velocity(sim, 0, actual_linear, actual_angular)
+            == RIPC_OK);
+        CHECK(actual_linear[0] == linear[0]);
+        CHECK(actual_linear[1] == linear[1]);
+        CHECK(actual_angular[0] == angular[0]);
+
+        double velocities[6];
+        CHECK(ripc_get_velocities(sim, velocities, 6) == RIPC_OK);
+        CHECK(velocities[0] == linear[0]);
+        CHECK(velocities[2] == angular[0]);
+    }
+
+    SECTION("Step")
+    {
+        double poses_t0[6], poses_t1[6];
+        REQUIRE(ripc_get_poses(sim, poses_t0, 6) == RIPC_OK);
+        REQUIRE(ripc_step(sim, 5) == RIPC_OK);
+        REQUIRE(ripc_get_poses(sim, poses_t1, 6) == RIPC_OK);
+
+        // The square falls under gravity and the floor stays put
+        CHECK(poses_t1[1] < poses_t0[1]);
+        for (int i = 3; i < 6; i++) {
+            CHECK(poses_t1[i] == poses_t0[i]);
+        }
+
+        ripc_step_stats stats;
+        REQUIRE(ripc_get_step_stats(sim, &stats) == RIPC_OK);
+        CHECK(stats.num_steps == 5);
+        CHECK(stats.num_substeps >= 1);
+        CHECK(!stats.has_intersections);
+        CHECK(stats.step_time >= 0);
+    }
+
+    ripc_destroy(sim);
+    fs::remove(filename);
+}
+
+TEST_CASE("C API errors", "[capi]")
+{
+    double values[6] = { 0 };
+
+    SECTION("Null handle")
+    {
+        CHECK(
+            ripc_load_scene(nullptr, "scene.json", nullptr)
+            == RIPC_ERROR_INVALID_HANDLE);
+        CHECK(std::string(ripc_last_error()) == "null simulation handle");
+        CHECK(ripc_step(nullptr, 1) == RIPC_ERROR_INVALID_HANDLE);
+        CHECK(
+            ripc_get_poses(nullptr, values, 6) == RIPC_ERROR_INVALID_HANDLE);
+        CHECK(
+            ripc_set_body_pose(nullptr, 0, values, values)
+            == RIPC_ERROR_INVALID_HANDLE);
+        CHECK(ripc_set_num_threads(nullptr, 1) == RIPC_ERROR_INVALID_HANDLE);
+        CHECK(ripc_dim(nullptr) == 0);
+        CHECK(ripc_num_bodies(nullptr) == 0);
+        ripc_destroy(nullptr);
+    }
+
+    ripc_simulation* sim = ripc_create();
+    REQUIRE(sim != nullptr);
+
+    SECTION("No scene loaded")
+    {
+        CHECK(ripc_step(sim, 1) == RIPC_ERROR_NOT_LOADED);
+        CHECK(std::string(ripc_last_error()) == "no scene is loaded");
+        CHECK(ripc_get_poses(sim, values, 6) == RIPC_ERROR_NOT_LOADED);
+        CHECK(
+            ripc_get_body_pose(sim, 0, values, values)
+            == RIPC_ERROR_NOT_LOADED);
+        double timestep;
+        CHECK(ripc_get_timestep(sim, &timestep) == RIPC_ERROR_NOT_LOADED);
+        ripc_step_stats stats;
+        CHECK(ripc_get_step_stats(sim, &stats) == RIPC_ERROR_NOT_LOADED);
+
+        // A failed load leaves nothing loaded
+        CHECK(
+            ripc_load_scene(sim, "missing-scene.json", nullptr)
+            == RIPC_ERROR_LOAD_FAILED);
+        CHECK(ripc_num_bodies(sim) == 0);
+    }
+
+    SECTION("Loaded scene")
+    {
+        const std::string filename = write_square_scene();
+        REQUIRE(ripc_load_scene(sim, filename.c_str(), nullptr) == RIPC_OK);
+        fs::remove(filename);
+
+        // Out-of-range bodies
+        for (int body : { -1, 2 }) {
+            CHECK(
+                ripc_get_body_pose(sim, body, values, values)
+                == RIPC_ERROR_INVALID_ARGUMENT);
+            CHECK(
+                ripc_set_body_velocity(sim, body, values, values)
+                == RIPC_ERROR_INVALID_ARGUMENT);
+        }
+        CHECK(
+            std::string(ripc_last_error()) == "body index 2 is out of range");
+
+        // Buffers too small for every body
+        CHECK(ripc_get_poses(sim, values, 5) == RIPC_ERROR_INVALID_ARGUMENT);
+        CHECK(
+            ripc_get_velocities(sim, values, 0)
+            == RIPC_ERROR_INVALID_ARGUMENT);
+        CHECK(
+            ripc_get_poses(sim, nullptr, 6) == RIPC_ERROR_INVALID_ARGUMENT);
+
+        CHECK(ripc_set_timestep(sim, -1) == RIPC_ERROR_INVALID_ARGUMENT);
+        CHECK(
+            ripc_get_step_stats(sim, nullptr) == RIPC_ERROR_INVALID_ARGUMENT);
+    }
+
+    ripc_destroy(sim);
+}
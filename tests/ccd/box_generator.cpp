@@ -0,0 +1,35 @@
+#include "box_generator.hpp"
+
+namespace ipc::rigid {
+namespace unittests {
+
+    std::vector<std::array<Eigen::Vector3d, 2>>
+    random_boxes(int num_boxes, double spread, double max_extent, int dim)
+    {
+        std::vector<std::array<Eigen::Vector3d, 2>> boxes(num_boxes);
+        for (auto& box : boxes) {
+            Eigen::Vector3d center = spread * Eigen::Vector3d::Random();
+            Eigen::Vector3d extent =
+                max_extent * Eigen::Vector3d::Random().cwiseAbs();
+            if (dim == 2) {
+                center.z() = extent.z() = 0;
+            }
+            box = { { center - extent, center + extent } };
+        }
+        return boxes;
+    }
+
+    std::vector<std::pair<int, int>> brute_force_overlaps(
+        const std::vector<std::array<Eigen::Vector3d, 2>>& boxes)
+    {
+        return brute_force_overlaps(
+            boxes,
+            [](const std::array<Eigen::Vector3d, 2>& a,
+               const std::array<Eigen::Vector3d, 2>& b) {
+                return (a[0].array() <= b[1].array()).all()
+                    && (b[0].array() <= a[1].array()).all();
+            });
+    }
+
+} // namespace unittests
+} // namespace ipc::rigid
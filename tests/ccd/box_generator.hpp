@@ -0,0 +1,43 @@
+#pragma once
+
+#include <array>
+#include <utility>
+#include <vector>
+
+#include <Eigen/Core>
+
+namespace ipc::rigid {
+namespace unittests {
+
+    /// @brief Random axis-aligned boxes as (min, max) corners.
+    /// @param spread     Box centers are uniform in [-spread, spread] per axis.
+    /// @param max_extent Half extents are uniform in [0, max_extent] per axis.
+    /// @param dim        In 2D the z coordinates are zero.
+    std::vector<std::array<Eigen::Vector3d, 2>> random_boxes(
+        int num_boxes,
+        double spread = 5,
+        double max_extent = 1,
+        int dim = 3);
+
+    /// @brief Every overlapping pair (i, j) with i < j, in lexicographic order.
+    template <typename Box, typename OverlapFunction>
+    std::vector<std::pair<int, int>> brute_force_overlaps(
+        const std::vector<Box>& boxes, OverlapFunction are_overlapping)
+    {
+        std::vector<std::pair<int, int>> pairs;
+        for (int i = 0; i < boxes.size(); i++) {
+            for (int j = i + 1; j < boxes.size(); j++) {
+                if (are_overlapping(boxes[i], boxes[j])) {
+                    pairs.emplace_back(i, j);
+                }
+            }
+        }
+        return pairs;
+    }
+
+    /// @brief Every overlapping pair of (min, max) corner boxes.
+    std::vector<std::pair<int, int>> brute_force_overlaps(
+        const std::vector<std::array<Eigen::Vector3d, 2>>& boxes);
+
+} // namespace unittests
+} // namespace ipc::rigid
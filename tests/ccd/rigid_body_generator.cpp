@@ -0,0 +1,83 @@
+#include "rigid_body_generator.hpp"
+
+#include <igl/edges.h>
+
+#include <utils/stress_scenes.hpp>
+
+namespace ipc::rigid {
+namespace unittests {
+
+    void tetrahedron_mesh(Eigen::MatrixXd& V, Eigen::MatrixXi& F)
+    {
+        V.resize(4, 3);
+        V.row(0) << 0, 0, 0;
+        V.row(1) << 1, 0, 0;
+        V.row(2) << 0, 1, 0;
+        V.row(3) << 0, 0, 1;
+        F.resize(4, 3);
+        F.row(0) << 0, 2, 1;
+        F.row(1) << 0, 1, 3;
+        F.row(2) << 0, 3, 2;
+        F.row(3) << 1, 2, 3;
+    }
+
+    void unit_cube_mesh(
+        Eigen::MatrixXd& V, Eigen::MatrixXi& E, Eigen::MatrixXi& F)
+    {
+        V.resize(8, 3);
+        for (int i = 0; i < 8; i++) {
+            V.row(i) << (i & 1), (i >> 1) & 1, (i >> 2) & 1;
+        }
+        F.resize(12, 3);
+        F << 0, 2, 1, 1, 2, 3, 4, 5, 6, 5, 7, 6, 0, 1, 4, 1, 5, 4, 2, 6, 3,
+            3, 6, 7, 0, 4, 2, 2, 4, 6, 1, 3, 5, 3, 7, 5;
+        igl::edges(F, E);
+    }
+
+    RigidBody create_tetrahedron(int group_id)
+    {
+        Eigen::MatrixXd V;
+        Eigen::MatrixXi F;
+        tetrahedron_mesh(V, F);
+        Eigen::MatrixXi E;
+        igl::edges(F, E);
+
+        PoseD pose = PoseD::Zero(3);
+        return RigidBody(
+            V, E, F, pose, /*velocity=*/PoseD::Zero(3),
+            /*force=*/PoseD::Zero(3), /*density=*/1.0,
+            /*is_dof_fixed=*/VectorMax6b::Zero(6), /*oriented=*/false,
+            group_id);
+    }
+
+    RigidBody create_box(
+        const Eigen::Vector3d& position, int group_id, RigidBodyType type)
+    {
+        Eigen::MatrixXd V;
+        Eigen::MatrixXi E, F;
+        stress_scenes::box_mesh(Eigen::Vector3d::Constant(0.5), V, E, F);
+        return RigidBody(
+            V, E, F, PoseD(position, Eigen::Vector3d::Zero()),
+            /*velocity=*/PoseD::Zero(3), /*force=*/PoseD::Zero(3),
+            /*density=*/1000,
+            VectorMax6b::Constant(6, type == RigidBodyType::STATIC),
+            /*oriented=*/false, group_id, type);
+    }
+
+    std::vector<RigidBody>
+    create_shelf(int num_static_bodies, double dynamic_box_height)
+    {
+        std::vector<RigidBody> bodies;
+        for (int i = 0; i < num_static_bodies; i++) {
+            bodies.push_back(create_box(
+                Eigen::Vector3d(2 * i, 0, 0), /*group_id=*/i,
+                RigidBodyType::STATIC));
+        }
+        bodies.push_back(create_box(
+            Eigen::Vector3d(0.1, dynamic_box_height, 0.1),
+            /*group_id=*/num_static_bodies, RigidBodyType::DYNAMIC));
+        return bodies;
+    }
+
+} // namespace unittests
+} // namespace ipc::rigid
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <Eigen/Core>
+
+#include <physics/rigid_body.hpp>
+
+namespace ipc::rigid {
+namespace unittests {
+
+    /// @brief Mesh of the unit tetrahedron with a vertex at the origin.
+    void tetrahedron_mesh(Eigen::MatrixXd& V, Eigen::MatrixXi& F);
+
+    /// @brief Mesh of the unit cube with a corner at the origin.
+    void unit_cube_mesh(
+        Eigen::MatrixXd& V, Eigen::MatrixXi& E, Eigen::MatrixXi& F);
+
+    /// @brief Unit tetrahedron body at the identity pose.
+    RigidBody create_tetrahedron(int group_id);
+
+    /// @brief Unit box body centered at the given position.
+    RigidBody create_box(
+        const Eigen::Vector3d& position, int group_id, RigidBodyType type);
+
+    /// @brief A row of unit static boxes along x, two units apart, with a
+    /// dynamic box above static box 0 at the given height.
+    std::vector<RigidBody>
+    create_shelf(int num_static_bodies, double dynamic_box_height);
+
+} // namespace unittests
+} // namespace ipc::rigid
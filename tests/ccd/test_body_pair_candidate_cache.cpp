@@ -0,0 +1,69 @@
+#include <catch2/catch.hpp>
+
+#include <ccd/rigid/body_pair_candidate_cache.hpp>
+#include <ccd/rigid/broad_phase.hpp>
+
+#include "rigid_body_generator.hpp"
+
+using namespace ipc;
+using namespace ipc::rigid;
+using namespace ipc::rigid::unittests;
+
+TEST_CASE("Body pair candidate cache", "[ccd][broad_phase][bvh][cache]")
+{
+    RigidBodyAssembler bodies;
+    bodies.init({ { create_tetrahedron(0), create_tetrahedron(1) } });
+
+    PosesD poses = bodies.rb_poses_t1();
+    poses[1].position.x() += 1.05;
+
+    const double inflation_radius = 0.1;
+    const int collision_types = CollisionType::EDGE_EDGE
+        | CollisionType::FACE_VERTEX;
+    BodyPairCandidateCache cache;
+
+    Candidates expected_candidates, candidates;
+    detect_collision_candidates_rigid_bvh(
+        bodies, poses, collision_types, expected_candidates,
+        inflation_radius);
+    detect_collision_candidates_rigid_bvh(
+        bodies, poses, collision_types, candidates, cache, inflation_radius);
+    CHECK(cache.size() == 1);
+    // The cached boxes are larger so the candidates are a superset
+    CHECK(candidates.size() >= expected_candidates.size());
+
+    SECTION("Small motion reuses the cached candidates")
+    {
+        Candidates cached_candidates = candidates;
+        poses[1].position.x() += 1e-3 * inflation_radius;
+
+        expected_candidates.clear();
+        detect_collision_candidates_rigid_bvh(
+            bodies, poses, collision_types, expected_candidates,
+            inflation_radius);
+        candidates.clear();
+        detect_collision_candidates_rigid_bvh(
+            bodies, poses, collision_types, candidates, cache,
+            inflation_radius);
+
+        CHECK(candidates.size() == cached_candidates.size());
+        CHECK(candidates.size() >= expected_candidates.size());
+    }
+
+    SECTION("Large motion recomputes the candidates")
+    {
+        poses[1].position.x() -= 0.5;
+
+        expected_candidates.clear();
+        detect_collision_candidates_rigid_bvh(
+            bodies, poses, collision_types, expected_candidates,
+            inflation_radius);
+        candidates.clear();
+        detect_collision_candidates_rigid_bvh(
+            bodies, poses, collision_types, candidates, cache,
+            inflation_radius);
+
+        CHECK(cache.size() == 1);
+        CHECK(candidates.size() >= expected_candidates.size());
+    }
+}
@@ -0,0 +1,145 @@
+#include <catch2/catch.hpp>
+
+#include <igl/edges.h>
+
+#include <SimState.hpp>
+#include <ccd/rigid/body_pair_separation_cache.hpp>
+#include <ccd/rigid/broad_phase.hpp>
+#include <opt/distance_barrier_constraint.hpp>
+#include <physics/rigid_body_problem.hpp>
+
+#include "rigid_body_generator.hpp"
+
+using namespace ipc;
+using namespace ipc::rigid;
+using namespace ipc::rigid::unittests;
+
+/// @brief Two unit tetrahedra at the given offsets in one body.
+static RigidBody create_tetrahedron_pair(
+    const Eigen::Vector3d& offset0,
+    const Eigen::Vector3d& offset1,
+    int group_id,
+    const PoseD& velocity = PoseD::Zero(3))
+{
+    Eigen::MatrixXd tetrahedron_V;
+    Eigen::MatrixXi tetrahedron_F;
+    tetrahedron_mesh(tetrahedron_V, tetrahedron_F);
+    const long n = tetrahedron_V.rows();
+    Eigen::MatrixXd V(2 * n, 3);
+    V << tetrahedron_V.rowwise() + offset0.transpose(),
+        tetrahedron_V.rowwise() + offset1.transpose();
+    Eigen::MatrixXi F(2 * tetrahedron_F.rows(), 3);
+    F << tetrahedron_F, tetrahedron_F.array() + int(n);
+    Eigen::MatrixXi E;
+    igl::edges(F, E);
+
+    RigidBody rb(
+        V, E, F, PoseD::Zero(3), velocity, /*force=*/PoseD::Zero(3),
+        /*density=*/1.0, /*is_dof_fixed=*/VectorMax6b::Zero(6),
+        /*oriented=*/false, group_id);
+    rb.is_convex = false; // The pair is not culled by GJK
+    return rb;
+}
+
+/// @brief Two bodies whose bounding boxes and spheres overlap, but whose
+/// tetrahedra are 0.5 apart.
+static std::vector<RigidBody>
+interleaved_bodies(const PoseD& velocity1 = PoseD::Zero(3))
+{
+    return { create_tetrahedron_pair(
+                 Eigen::Vector3d::Zero(), Eigen::Vector3d(3, 0, 0), 0),
+             create_tetrahedron_pair(
+                 Eigen::Vector3d(1.5, 0, 0), Eigen::Vector3d(1.5, 3, 0), 1,
+                 velocity1) };
+}
+
+TEST_CASE("Body pair separation cache", "[ccd][broad_phase][bvh][cache]")
+{
+    RigidBodyAssembler bodies;
+    bodies.init(interleaved_bodies());
+
+    PosesD poses_t0 = bodies.rb_poses_t1();
+    PosesD poses_t1 = poses_t0;
+    poses_t1[1].position.x() -= 0.1;
+
+    const double inflation_radius = 0.01;
+    const int collision_types = CollisionType::EDGE_EDGE
+        | CollisionType::FACE_VERTEX;
+    BodyPairSeparationCache cache;
+
+    Candidates candidates;
+    detect_collision_candidates_rigid_bvh(
+        bodies, poses_t0, poses_t1, collision_types, candidates, cache,
+        inflation_radius);
+    CHECK(candidates.size() == 0);
+    CHECK(cache.size() == 1);
+
+    SECTION("A shorter trajectory is skipped")
+    {
+        poses_t1[1].position.x() += 0.05;
+        CHECK(cache.is_separated(
+            bodies, poses_t0, poses_t1, 0, 1, collision_types,
+            inflation_radius));
+    }
+
+    SECTION("The next step is skipped if it moves as much")
+    {
+        PosesD poses_t2 = poses_t1;
+        poses_t2[1].position.x() -= 0.01;
+        CHECK(cache.is_separated(
+            bodies, poses_t1, poses_t2, 0, 1, collision_types,
+            inflation_radius));
+    }
+
+    SECTION("An approaching trajectory is traversed")
+    {
+        // The first tetrahedron of the second body reaches the second one of
+        // the first body
+        poses_t1[1].position.x() += 1.6;
+        CHECK(!cache.is_separated(
+            bodies, poses_t0, poses_t1, 0, 1, collision_types,
+            inflation_radius));
+
+        Candidates expected_candidates;
+        detect_collision_candidates_rigid_bvh(
+            bodies, poses_t0, poses_t1, collision_types, expected_candidates,
+            inflation_radius);
+        REQUIRE(expected_candidates.size() > 0);
+
+        candidates.clear();
+        detect_collision_candidates_rigid_bvh(
+            bodies, poses_t0, poses_t1, collision_types, candidates, cache,
+            inflation_radius);
+        CHECK(candidates.size() == expected_candidates.size());
+    }
+}
+
+TEST_CASE(
+    "Body pair separations persist across time steps",
+    "[ccd][broad_phase][bvh][cache]")
+{
+    PoseD velocity = PoseD::Zero(3);
+    velocity.position.x() = -1;
+
+    SimSettings settings; // BVH broad phase by default
+    SimState sim;
+    REQUIRE(sim.init(settings, interleaved_bodies(velocity)));
+    auto& problem = dynamic_cast<RigidBodyProblem&>(*sim.problem_ptr);
+    const auto& constraint =
+        dynamic_cast<const DistanceBarrierConstraint&>(problem.constraint());
+
+    sim.simulation_step();
+    REQUIRE(constraint.separation_cache().size() == 1);
+
+    // The next step starts with the separations of the last one
+    problem.update_constraints();
+    CHECK(constraint.separation_cache().size() == 1);
+    sim.simulation_step();
+    CHECK(constraint.separation_cache().size() == 1);
+
+    // A new body changes the keys of the pairs
+    RigidBody rb = create_tetrahedron(2);
+    rb.pose.position.z() += 10;
+    problem.add_body(rb);
+    CHECK(constraint.separation_cache().size() == 0);
+}
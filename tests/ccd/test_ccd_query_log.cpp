@@ -0,0 +1,78 @@
+#include <catch2/catch.hpp>
+
+#include <cstdio>
+
+#include <ccd/ccd_query_log.hpp>
+
+#include "rigid_body_generator.hpp"
+
+using namespace ipc;
+using namespace ipc::rigid;
+using namespace ipc::rigid::unittests;
+
+TEST_CASE("CCD query log round trip", "[ccd][query_log]")
+{
+    RigidBodyAssembler bodies;
+    bodies.init({ create_tetrahedron(0), create_tetrahedron(1) });
+
+    PosesD poses_t0(2, PoseD::Zero(3)), poses_t1(2, PoseD::Zero(3));
+    poses_t0[1].position << 2, 0, 0;
+    poses_t1[0].rotation << 0.1, 0.2, 0.3;
+    poses_t1[1].position << -1, 0.5, 0;
+
+    const int sample_stride = GENERATE(1, 2);
+    const int num_queries = 5;
+    const std::string filename = "ccd_query_log_test.bin";
+    REQUIRE(CCDQueryLog::enable(filename, sample_stride));
+    CHECK(CCDQueryLog::is_enabled());
+    for (int i = 0; i < num_queries; i++) {
+        CCDQueryLog::record_face_vertex(
+            bodies, poses_t0, poses_t1, /*bodyA_id=*/0, /*vertex_id=*/i % 4,
+            /*bodyB_id=*/1, /*face_id=*/3, /*earliest_toi=*/0.5,
+            /*minimum_separation_distance=*/1e-3);
+    }
+    CCDQueryLog::record_edge_edge(
+        bodies, poses_t0, poses_t1, /*bodyA_id=*/1, /*edgeA_id=*/0,
+        /*bodyB_id=*/0, /*edgeB_id=*/2, /*earliest_toi=*/1,
+        /*minimum_separation_distance=*/0);
+    CCDQueryLog::disable();
+    CHECK(!CCDQueryLog::is_enabled());
+
+    std::vector<CCDQueryRecord> records;
+    REQUIRE(read_ccd_query_log(filename, records));
+    std::remove(filename.c_str());
+    REQUIRE(records.size() == (num_queries + sample_stride) / sample_stride);
+
+    for (int i = 0; i < records.size(); i++) {
+        const CCDQueryRecord& record = records[i];
+        CHECK(record.dim == 3);
+        if (sample_stride * i >= num_queries) {
+            CHECK(record.type == CCDQueryType::EDGE_EDGE);
+            continue;
+        }
+        CHECK(record.type == CCDQueryType::FACE_VERTEX);
+        CHECK(record.earliest_toi == 0.5);
+        CHECK(record.minimum_separation_distance == 1e-3);
+        CHECK(record.r_max[0] == bodies[0].r_max);
+
+        const RigidBody& vertex_body = bodies[0];
+        const long vertex_id = (sample_stride * i) % 4;
+        for (int j = 0; j < 3; j++) {
+            CHECK(
+                record.vertices[0][0][j]
+                == vertex_body.vertices(vertex_id, j));
+        }
+        const RigidBody& face_body = bodies[1];
+        for (int k = 0; k < 3; k++) {
+            for (int j = 0; j < 3; j++) {
+                CHECK(
+                    record.vertices[1][k][j]
+                    == face_body.vertices(face_body.faces(3, k), j));
+            }
+        }
+
+        CHECK(record.pose(0, 1).rotation == poses_t1[0].rotation);
+        CHECK(record.pose(1, 0).position == poses_t0[1].position);
+        CHECK(record.pose(1, 1).position == poses_t1[1].position);
+    }
+}
@@ -0,0 +1,79 @@
+#include <catch2/catch.hpp>
+
+#include <tbb/parallel_for.h>
+
+#include <ccd/ccd_query_stats.hpp>
+
+using namespace ipc::rigid;
+
+TEST_CASE("CCD query stats buckets", "[ccd][query_stats]")
+{
+    CHECK(CCDQueryStats::bucket(0) == 0);
+    CHECK(CCDQueryStats::bucket(1) == 1);
+    CHECK(CCDQueryStats::bucket(2) == 2);
+    CHECK(CCDQueryStats::bucket(3) == 2);
+    CHECK(CCDQueryStats::bucket(1024) == 11);
+    CHECK(
+        CCDQueryStats::bucket(uint64_t(1) << 40)
+        == CCDQueryStats::NUM_BUCKETS - 1);
+}
+
+TEST_CASE("CCD query stats merge the threads", "[ccd][query_stats]")
+{
+    CCDQueryStats::set_enabled(true);
+    CCDQueryStats::reset();
+
+    const int num_queries = 1000;
+    tbb::parallel_for(0, num_queries, [](int i) {
+        CCDQueryStats::record_query(
+            CCDQueryType::EDGE_EDGE, std::chrono::nanoseconds(1000),
+            /*is_hit=*/i % 4 == 0, /*is_toi_zero=*/i % 100 == 0);
+        CCDQueryStats::record_root_finder(CCDQueryType::FACE_VERTEX, 5);
+    });
+
+    const CCDQueryStats::Summary summary = CCDQueryStats::collect();
+    const CCDQueryStats::QueryTypeStats& ee =
+        summary.query_types[int(CCDQueryType::EDGE_EDGE)];
+    CHECK(ee.num_queries == num_queries);
+    CHECK(ee.num_hits == num_queries / 4);
+    CHECK(ee.num_toi_zero == num_queries / 100);
+    CHECK(ee.nanoseconds == num_queries * 1000);
+    CHECK(ee.time_histogram[CCDQueryStats::bucket(1000)] == num_queries);
+    CHECK(ee.num_root_finder_calls == 0);
+
+    const CCDQueryStats::QueryTypeStats& fv =
+        summary.query_types[int(CCDQueryType::FACE_VERTEX)];
+    CHECK(fv.num_queries == 0);
+    CHECK(fv.num_root_finder_calls == num_queries);
+    CHECK(fv.num_root_finder_boxes == 5 * num_queries);
+    CHECK(fv.box_histogram[CCDQueryStats::bucket(5)] == num_queries);
+
+    const nlohmann::json json = summary.to_json();
+    CHECK(json["edge_edge"]["misses"] == num_queries - num_queries / 4);
+    // Trailing empty buckets are dropped
+    CHECK(
+        json["edge_edge"]["time_histogram"].size()
+        == CCDQueryStats::bucket(1000) + 1);
+    CHECK(json["edge_vertex"]["time_histogram"].empty());
+
+    CCDQueryStats::Summary total = summary;
+    total += summary;
+    CHECK(total.query_types[int(CCDQueryType::EDGE_EDGE)].num_hits
+          == num_queries / 2);
+
+    CCDQueryStats::reset();
+    CHECK(
+        CCDQueryStats::collect()
+            .query_types[int(CCDQueryType::EDGE_EDGE)]
+            .num_queries
+        == 0);
+
+    // Nothing is recorded while disabled
+    CCDQueryStats::set_enabled(false);
+    CCDQueryStats::record_root_finder(CCDQueryType::FACE_VERTEX, 5);
+    CHECK(
+        CCDQueryStats::collect()
+            .query_types[int(CCDQueryType::FACE_VERTEX)]
+            .num_root_finder_calls
+        == 0);
+}
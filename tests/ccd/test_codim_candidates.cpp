@@ -0,0 +1,62 @@
+#include <set>
+
+#include <catch2/catch.hpp>
+
+#include <ccd/rigid/broad_phase.hpp>
+
+using namespace ipc;
+using namespace ipc::rigid;
+
+/// @brief A 2D polyline with a loose particle (a codimensional vertex) at
+/// the end of the vertices.
+static RigidBody rod_with_particle(
+    const Eigen::MatrixXd& polyline,
+    const Eigen::Vector2d& particle,
+    int group_id)
+{
+    Eigen::MatrixXd V(polyline.rows() + 1, 2);
+    V << polyline, particle.transpose();
+    Eigen::MatrixXi E(polyline.rows() - 1, 2);
+    for (int i = 0; i < E.rows(); i++) {
+        E.row(i) << i, i + 1;
+    }
+    const PoseD zero = PoseD::Zero(2);
+    return RigidBody(
+        V, E, zero, zero, zero, /*density=*/1.0,
+        /*is_dof_fixed=*/VectorMax6b::Zero(3), /*oriented=*/false, group_id);
+}
+
+TEST_CASE(
+    "Candidates between rods with loose particles",
+    "[ccd][broad_phase][bvh][codim]")
+{
+    // A horizontal rod (vertices 0-4, edges 0-3) with a far particle
+    // (vertex 5), and a vertical rod starting just above its edge 2
+    // (vertices 6-8, edges 4-5) with a particle just above its edge 0
+    // (vertex 9).
+    Eigen::MatrixXd horizontal(5, 2), vertical(3, 2);
+    horizontal << -2, 0, -1, 0, 0, 0, 1, 0, 2, 0;
+    vertical << 0.5, 0.05, 0.5, 1.05, 0.5, 2.05;
+    RigidBodyAssembler bodies;
+    bodies.init(
+        { rod_with_particle(horizontal, Eigen::Vector2d(0, 5), 0),
+          rod_with_particle(vertical, Eigen::Vector2d(-1.5, 0.03), 1) });
+    REQUIRE(bodies[1].num_codim_vertices() == 1);
+
+    Candidates candidates;
+    const PosesD poses = bodies.rb_poses_t1();
+    detect_collision_candidates_rigid(
+        bodies, poses, CollisionType::EDGE_VERTEX, candidates,
+        DetectionMethod::BVH, /*inflation_radius=*/0.1);
+
+    // Only the end of the vertical rod and the particle are close to the
+    // horizontal rod (the rods' other endpoints are outside the boxes of
+    // the segments they are paired with).
+    std::set<std::pair<long, long>> ev_candidates;
+    for (const auto& c : candidates.ev_candidates) {
+        ev_candidates.emplace(c.edge_index, c.vertex_index);
+    }
+    CHECK(
+        ev_candidates
+        == std::set<std::pair<long, long>> { { 2, 6 }, { 0, 9 } });
+}
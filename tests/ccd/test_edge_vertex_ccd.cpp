@@ -112,3 +112,57 @@ TEST_CASE("Test Continous Collision Detection", "[ccd]")
         CHECK(alpha == Approx(alpha_expected));
     }
 }
+
+TEST_CASE("Batched edge-vertex CCD matches scalar", "[ccd][batch]")
+{
+    const int n = 1000;
+    Eigen::ArrayX2d Vi = Eigen::ArrayX2d::Random(n, 2);
+    Eigen::ArrayX2d Vj = Eigen::ArrayX2d::Random(n, 2);
+    Eigen::ArrayX2d Vk = Eigen::ArrayX2d::Random(n, 2);
+    Eigen::ArrayX2d Ui = Eigen::ArrayX2d::Random(n, 2);
+    Eigen::ArrayX2d Uj = Eigen::ArrayX2d::Random(n, 2);
+    Eigen::ArrayX2d Uk = Eigen::ArrayX2d::Random(n, 2);
+
+    // Point on the edge's line, point and edge moving parallel, and a point
+    // coincident with the edge
+    Vi.row(0) << 0, 1;
+    Vj.row(0) << 0, 2;
+    Vk.row(0) << 0, 0;
+    Ui.row(0) << 0, 0;
+    Uj.row(0) << 0, 0;
+    Uk.row(0) << 0, 2;
+    Vi.row(1) << 1, 0;
+    Vj.row(1) << 1, 2;
+    Vk.row(1) << 0, 1;
+    Ui.row(1) = Uj.row(1) = Uk.row(1) = Eigen::Array2d(0, 1).transpose();
+    Vi.row(2) << -1, 0;
+    Vj.row(2) << 1, 0;
+    Vk.row(2) << 0, 0;
+    Ui.row(2) = Uj.row(2) = Uk.row(2) = Eigen::Array2d(1, 0).transpose();
+
+    Eigen::ArrayXd toi, alpha;
+    ArrayXb is_impacting;
+    compute_edge_vertex_time_of_impacts(
+        Vi, Vj, Vk, Ui, Uj, Uk, toi, alpha, is_impacting);
+    REQUIRE(toi.size() == n);
+
+    const auto row = [](const Eigen::ArrayX2d& X, int i) {
+        return Eigen::Vector2d(X.row(i).transpose().matrix());
+    };
+    int num_impacts = 0;
+    for (int i = 0; i < n; i++) {
+        double expected_toi, expected_alpha;
+        bool is_impact_expected = compute_edge_vertex_time_of_impact(
+            row(Vi, i), row(Vj, i), row(Vk, i), row(Ui, i), row(Uj, i),
+            row(Uk, i), expected_toi, expected_alpha);
+        REQUIRE(is_impacting(i) == is_impact_expected);
+        if (is_impact_expected) {
+            CHECK(toi(i) == Approx(expected_toi));
+            CHECK(alpha(i) == Approx(expected_alpha));
+            num_impacts++;
+        }
+    }
+    CHECK(is_impacting(0));
+    CHECK(!is_impacting(1));
+    CHECK(num_impacts > 3);
+}
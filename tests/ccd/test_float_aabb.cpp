@@ -0,0 +1,30 @@
+#include <catch2/catch.hpp>
+
+#include <ccd/rigid/float_aabb.hpp>
+
+using namespace ipc;
+using namespace ipc::rigid;
+
+TEST_CASE("Float AABB rounds outward", "[ccd][broad_phase][float_aabb]")
+{
+    for (int i = 0; i < 1000; i++) {
+        const Eigen::Array3d min = Eigen::Array3d::Random() * 1e3;
+        const Eigen::Array3d max = min + Eigen::Array3d::Random().abs();
+        const FloatAABB box(min, max);
+        REQUIRE((box.getMin() <= min).all());
+        REQUIRE((box.getMax() >= max).all());
+    }
+
+    // Boxes that touch in double precision still overlap
+    const double x = 0.1;
+    const FloatAABB a(Eigen::Array2d(0, 0), Eigen::Array2d(x, 1));
+    const FloatAABB b(Eigen::Array2d(x, 0), Eigen::Array2d(1, 1));
+    CHECK(FloatAABB::are_overlapping(a, b));
+    CHECK(a.getMin().size() == 2);
+
+    const FloatAABB c(Eigen::Array2d(0.5, 2), Eigen::Array2d(1, 3));
+    CHECK(!FloatAABB::are_overlapping(a, c));
+    const FloatAABB ac(a, c);
+    CHECK(FloatAABB::are_overlapping(ac, b));
+    CHECK(ac.getMax()(1) == 3);
+}
@@ -1,9 +1,12 @@
 #include <catch2/catch.hpp>
 
 #include <ghc/fs_std.hpp> // filesystem
+#include <igl/PI.h>
 #include <igl/Timer.h>
+#include <igl/edges.h>
 #include <nlohmann/json.hpp>
 
+#include <ccd/rigid/rigid_body_hash_grid.hpp>
 #include <io/serialize_json.hpp>
 #include <logger.hpp>
 #include <physics/pose.hpp>
@@ -21,6 +24,125 @@ TEST_CASE("3D rigid body hash grid", "[hashgrid][rigid_body][3D]")
     // TODO
 }
 
+TEST_CASE(
+    "Adaptive subdivision of rigid body hash grid",
+    "[hashgrid][rigid_body][3D]")
+{
+    Eigen::MatrixXd V(4, 3);
+    V.row(0) << 0, 0, 0;
+    V.row(1) << 1, 0, 0;
+    V.row(2) << 0, 1, 0;
+    V.row(3) << 0, 0, 1;
+    Eigen::MatrixXi F(4, 3);
+    F.row(0) << 0, 2, 1;
+    F.row(1) << 0, 1, 3;
+    F.row(2) << 0, 3, 2;
+    F.row(3) << 1, 2, 3;
+    Eigen::MatrixXi E;
+    igl::edges(F, E);
+
+    std::vector<RigidBody> rbs;
+    for (int i = 0; i < 2; i++) {
+        rbs.emplace_back(
+            V, E, F, PoseD::Zero(3), /*velocity=*/PoseD::Zero(3),
+            /*force=*/PoseD::Zero(3), /*density=*/1.0,
+            /*is_dof_fixed=*/VectorMax6b::Zero(6), /*oriented=*/false,
+            /*group_id=*/i);
+    }
+    RigidBodyAssembler bodies;
+    bodies.init(rbs);
+
+    PosesD poses_t0 = bodies.rb_poses_t1();
+    poses_t0[1].position.x() += 2;
+    PosesD poses_t1 = poses_t0;
+    // Body 0 spins half a turn while body 1 only translates
+    poses_t1[0].rotation.z() += igl::PI;
+    poses_t1[1].position.y() += 1;
+
+    std::vector<std::pair<int, int>> body_pairs = { { 0, 1 } };
+    RigidBodyHashGrid hashgrid;
+    hashgrid.resize(bodies, poses_t0, poses_t1, body_pairs);
+    hashgrid.addBodies(bodies, poses_t0, poses_t1, body_pairs);
+
+    const std::vector<int>& depths = hashgrid.body_subdivision_depths();
+    REQUIRE(depths.size() == 2);
+    CHECK(depths[0] > 0);
+    CHECK(depths[1] == 0);
+}
+
+TEST_CASE("Levels of rigid body hash grid", "[hashgrid][rigid_body][3D]")
+{
+    Eigen::MatrixXd V(4, 3);
+    V.row(0) << 0, 0, 0;
+    V.row(1) << 1, 0, 0;
+    V.row(2) << 0, 1, 0;
+    V.row(3) << 0, 0, 1;
+    Eigen::MatrixXi F(4, 3);
+    F.row(0) << 0, 2, 1;
+    F.row(1) << 0, 1, 3;
+    F.row(2) << 0, 3, 2;
+    F.row(3) << 1, 2, 3;
+    Eigen::MatrixXi E;
+    igl::edges(F, E);
+
+    // A large wall with two small bodies touching it far from each other
+    std::vector<RigidBody> rbs;
+    for (int i = 0; i < 3; i++) {
+        PoseD pose = PoseD::Zero(3);
+        if (i > 0) {
+            pose.position << 10 + 40 * (i - 1), 10 + 40 * (i - 1), -1;
+        }
+        rbs.emplace_back(
+            i == 0 ? Eigen::MatrixXd(64 * V) : V, E, F, pose,
+            /*velocity=*/PoseD::Zero(3), /*force=*/PoseD::Zero(3),
+            /*density=*/1.0, /*is_dof_fixed=*/VectorMax6b::Zero(6),
+            /*oriented=*/false, /*group_id=*/i);
+    }
+    RigidBodyAssembler bodies;
+    bodies.init(rbs);
+    const PosesD poses = bodies.rb_poses_t1();
+
+    std::vector<std::pair<int, int>> body_pairs = { { 0, 1 }, { 0, 2 } };
+    RigidBodyHashGrid hashgrid;
+    hashgrid.resize(bodies, poses, body_pairs);
+    hashgrid.addBodies(bodies, poses, body_pairs);
+
+    // The wall's face is hashed into a coarser level than the small faces
+    const Eigen::MatrixXd V_world = bodies.world_vertices(poses);
+    const auto face_aabb = [&](long fi) {
+        Eigen::Array3d min = V_world.row(bodies.m_faces(fi, 0)).transpose();
+        Eigen::Array3d max = min;
+        for (int i = 1; i < 3; i++) {
+            const Eigen::Array3d v =
+                V_world.row(bodies.m_faces(fi, i)).transpose();
+            min = min.min(v);
+            max = max.max(v);
+        }
+        return AABB(min, max);
+    };
+    CHECK(hashgrid.level(face_aabb(0)) > 0);
+    CHECK(hashgrid.level(face_aabb(bodies.m_body_face_id[1])) == 0);
+
+    std::vector<FaceVertexCandidate> fv_candidates;
+    hashgrid.getFaceVertexPairs(
+        bodies.m_faces, fv_candidates, [&](size_t vi, size_t vj) {
+            return bodies.group_ids()[vi] != bodies.group_ids()[vj];
+        });
+
+    bool has_wall_candidate = false;
+    for (const FaceVertexCandidate& candidate : fv_candidates) {
+        const int face_body =
+            bodies.group_ids()[bodies.m_faces(candidate.face_index, 0)];
+        const int vertex_body = bodies.group_ids()[candidate.vertex_index];
+        // The small bodies only meet as ghosts in the coarse levels
+        CHECK((face_body == 0 || vertex_body == 0));
+        // The vertex on the wall is paired with the wall's face
+        has_wall_candidate |= candidate.face_index == 0
+            && candidate.vertex_index == bodies.m_body_vertex_id[1] + 3;
+    }
+    CHECK(has_wall_candidate);
+}
+
 void compute_scene_conservative_bbox(
     const std::vector<nlohmann::json>& bodies,
     Eigen::Vector3d& scene_min,
@@ -7,7 +7,10 @@
 #include <ipc/distance/edge_edge.hpp>
 
 // #include <ccd.hpp>
+#include <ccd/ccd.hpp>
+#include <ccd/conservative_advancement/time_of_impact.hpp>
 #include <ccd/piecewise_linear/time_of_impact.hpp>
+#include <ccd/rigid/rigid_trajectory_aabb.hpp>
 #include <ccd/rigid/time_of_impact.hpp>
 #include <constants.hpp>
 #include <io/serialize_json.hpp>
@@ -163,6 +166,84 @@ TEST_CASE("Rigid edge-vertex time of impact", "[ccd][rigid_toi][edge_vertex]")
         // clang-format on
         CHECK(toi <= expected_toi);
     }
+
+    // Trajectories shared by the queries of a body pair give the same result
+    TrajectoryPoseCache posesA(
+        bodyA, bodyA_pose_t0.cast<Interval>(), bodyA_pose_t1.cast<Interval>());
+    TrajectoryPoseCache posesB(
+        bodyB, bodyB_pose_t0.cast<Interval>(), bodyB_pose_t1.cast<Interval>());
+    for (int query = 0; query < 2; query++) {
+        double shared_toi;
+        bool is_shared_impacting = compute_edge_vertex_time_of_impact(
+            bodyA, bodyA_pose_t0, bodyA_pose_t1, /*vertex_id=*/0, //
+            bodyB, bodyB_pose_t0, bodyB_pose_t1, /*edge_id=*/0,   //
+            shared_toi, /*earliest_toi=*/1, TESTING_TOI_TOLERANCE, &posesA,
+            &posesB);
+        CHECK(is_shared_impacting == is_impacting);
+        if (is_impacting) {
+            CHECK(shared_toi == toi);
+        }
+    }
+}
+
+TEST_CASE(
+    "Rigid edge-vertex time of impact of moving bodies",
+    "[ccd][rigid_toi][edge_vertex]")
+{
+    Eigen::MatrixXd bodyA_vertices(2, 2);
+    bodyA_vertices << 0.3, -0.2, 1, 0;
+    Eigen::MatrixXd bodyB_vertices(2, 2);
+    bodyB_vertices << -1, 0, 1, 0;
+    Eigen::MatrixXi edges(1, 2);
+    edges << 0, 1;
+    RigidBody bodyA = create_body(bodyA_vertices, edges);
+    RigidBody bodyB = create_body(bodyB_vertices, edges);
+
+    // Both bodies translate and rotate
+    double thetaA = GENERATE(-3.0, 0.5, 2.0);
+    double thetaB = GENERATE(-1.0, 0.0, 1.5);
+    Pose<double> bodyA_pose_t0(
+        Eigen::Vector2d(0.1, 1.0), Eigen::VectorXd::Constant(1, 0.2));
+    Pose<double> bodyA_pose_t1(
+        Eigen::Vector2d(-0.2, -0.6), Eigen::VectorXd::Constant(1, thetaA));
+    Pose<double> bodyB_pose_t0 = Pose<double>::Zero(2);
+    Pose<double> bodyB_pose_t1(
+        Eigen::Vector2d(0.1, 0.2), Eigen::VectorXd::Constant(1, thetaB));
+
+    // Earliest crossing of the vertex through the edge by dense sampling
+    const int n = 100000;
+    double expected_toi = std::numeric_limits<double>::infinity();
+    double prev_orientation = 0;
+    for (int i = 0; i <= n && std::isinf(expected_toi); i++) {
+        const double t = double(i) / n;
+        const Pose<double> poseA =
+            Pose<double>::interpolate(bodyA_pose_t0, bodyA_pose_t1, t);
+        const Pose<double> poseB =
+            Pose<double>::interpolate(bodyB_pose_t0, bodyB_pose_t1, t);
+        const Eigen::Vector2d p = bodyA.world_vertex(poseA, 0);
+        const Eigen::Vector2d e0 = bodyB.world_vertex(poseB, 0);
+        const Eigen::Vector2d e1 = bodyB.world_vertex(poseB, 1);
+        const Eigen::Vector2d d = e1 - e0, q = p - e0;
+        const double orientation = d.x() * q.y() - d.y() * q.x();
+        const double alpha = q.dot(d) / d.squaredNorm();
+        if (i > 0 && (orientation > 0) != (prev_orientation > 0)
+            && alpha >= 0 && alpha <= 1) {
+            expected_toi = t;
+        }
+        prev_orientation = orientation;
+    }
+
+    double toi;
+    bool is_impacting = compute_edge_vertex_time_of_impact(
+        bodyA, bodyA_pose_t0, bodyA_pose_t1, /*vertex_id=*/0, //
+        bodyB, bodyB_pose_t0, bodyB_pose_t1, /*edge_id=*/0,   //
+        toi, /*earliest_toi=*/1, /*toi_tolerance=*/TESTING_TOI_TOLERANCE);
+    CAPTURE(thetaA, thetaB, toi, expected_toi);
+    CHECK(is_impacting == std::isfinite(expected_toi));
+    if (is_impacting) {
+        CHECK(toi <= expected_toi);
+        CHECK(toi >= expected_toi - 1.0 / n - TESTING_TOI_TOLERANCE);
+    }
 }
 
 TEST_CASE("Rigid edge-edge time of impact", "[ccd][rigid_toi][edge_edge]")
@@ -226,6 +307,82 @@ TEST_CASE("Rigid edge-edge time of impact", "[ccd][rigid_toi][edge_edge]")
         // clang-format on
         CHECK(toi <= expected_toi);
     }
+
+    // Conservative advancement of the same trajectory
+    double ca_toi;
+    bool is_ca_impacting =
+        compute_conservative_advancement_edge_edge_time_of_impact(
+            bodyA, bodyA_pose_t0, bodyA_pose_t1, /*edgeA_id=*/0, //
+            bodyB, bodyB_pose_t0, bodyB_pose_t1, /*edgeA_id=*/0, //
+            ca_toi, /*earliest_toi=*/1, /*minimum_separation_distance=*/0,
+            /*toi_tolerance=*/TESTING_TOI_TOLERANCE);
+    CAPTURE(ca_toi);
+    CHECK(is_ca_impacting == is_impact_expected);
+    if (is_ca_impacting) {
+        // clang-format off
+        CHECK(ca_toi == Approx(expected_toi).margin(
+            Constants::RIGID_CCD_LENGTH_TOL));
+        // clang-format on
+        CHECK(ca_toi <= expected_toi);
+    }
+}
+
+TEST_CASE(
+    "Conservative advancement with a minimum separation",
+    "[ccd][rigid_toi][edge_edge][conservative_advancement]")
+{
+    const int dim = 3;
+    const double ms = 1e-2;
+
+    Eigen::MatrixXd bodyA_vertices(2, dim);
+    bodyA_vertices.row(0) << -1, 0, 0;
+    bodyA_vertices.row(1) << 1, 0, 0;
+    Eigen::MatrixXd bodyB_vertices(2, dim);
+    bodyB_vertices.row(0) << 0, 0, -1;
+    bodyB_vertices.row(1) << 0, 0, 1;
+    Eigen::MatrixXi edges(1, 2);
+    edges.row(0) << 0, 1;
+
+    RigidBody bodyA = create_body(bodyA_vertices, edges);
+    RigidBody bodyB = create_body(bodyB_vertices, edges);
+
+    // Closer to the separation than the advancement resolves in one step
+    const double y_t0 = ms + 1e-4;
+    Pose<double> bodyA_pose_t0 = Pose<double>::Zero(dim);
+    bodyA_pose_t0.position.y() = y_t0;
+    Pose<double> bodyA_pose_t1 = bodyA_pose_t0;
+    const Pose<double> bodyB_pose = Pose<double>::Zero(dim);
+
+    double expected_toi = std::numeric_limits<double>::infinity();
+    SECTION("Sliding")
+    {
+        bodyA_pose_t1.position.x() = 0.5;
+    }
+    SECTION("Separating")
+    {
+        bodyA_pose_t1.position.y() = 1;
+    }
+    SECTION("Approaching")
+    {
+        bodyA_pose_t1.position.y() = -1;
+        expected_toi = (y_t0 - ms) / (y_t0 + 1);
+    }
+
+    double toi;
+    bool is_impacting =
+        compute_conservative_advancement_edge_edge_time_of_impact(
+            bodyA, bodyA_pose_t0, bodyA_pose_t1, /*edgeA_id=*/0, //
+            bodyB, bodyB_pose, bodyB_pose, /*edgeB_id=*/0,       //
+            toi, /*earliest_toi=*/1, /*minimum_separation_distance=*/ms,
+            /*toi_tolerance=*/TESTING_TOI_TOLERANCE);
+    CAPTURE(toi, expected_toi);
+    CHECK(is_impacting == std::isfinite(expected_toi));
+    if (is_impacting) {
+        CHECK(toi == Approx(expected_toi).margin(TESTING_TOI_TOLERANCE));
+        CHECK(toi <= expected_toi);
+        // Never an impact before the gap closes
+        CHECK(toi > 0);
+    }
 }
 
 TEST_CASE("Rigid face-vertex time of impact", "[ccd][rigid_toi][face_vertex]")
@@ -849,3 +1006,27 @@ TEST_CASE("toi=0", "[ccd][rigid_toi][thisone]")
         CHECK(toi > 0);
     }
 }
+
+TEST_CASE("Bound the rigid trajectory displacement", "[ccd][rigid_toi]")
+{
+    for (int i = 0; i < 100; i++) {
+        PoseD pose_t0(
+            Eigen::Vector3d::Random().eval(),
+            (5 * Eigen::Vector3d::Random()).eval());
+        PoseD pose_t1(
+            Eigen::Vector3d::Random().eval(),
+            (5 * Eigen::Vector3d::Random()).eval());
+        Eigen::Vector3d v = Eigen::Vector3d::Random();
+
+        const double bound =
+            max_trajectory_displacement(pose_t0, pose_t1, v.norm());
+        const Eigen::Vector3d x_t0 =
+            pose_t0.construct_rotation_matrix() * v + pose_t0.position;
+        for (double t = 0; t <= 1; t += 0.05) {
+            PoseD pose_t = PoseD::interpolate(pose_t0, pose_t1, t);
+            Eigen::Vector3d x_t =
+                pose_t.construct_rotation_matrix() * v + pose_t.position;
+            CHECK((x_t - x_t0).norm() <= bound + 1e-12);
+        }
+    }
+}
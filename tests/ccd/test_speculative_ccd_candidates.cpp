@@ -0,0 +1,76 @@
+#include <catch2/catch.hpp>
+
+#include <ccd/ccd.hpp>
+#include <ccd/rigid/broad_phase.hpp>
+#include <ccd/rigid/speculative_ccd_candidates.hpp>
+
+#include "rigid_body_generator.hpp"
+
+using namespace ipc;
+using namespace ipc::rigid;
+using namespace ipc::rigid::unittests;
+
+TEST_CASE("Speculative CCD candidates", "[ccd][broad_phase][cache]")
+{
+    RigidBodyAssembler bodies;
+    bodies.init({ { create_tetrahedron(0), create_tetrahedron(1) } });
+
+    PosesD poses_t0 = bodies.rb_poses_t1();
+    poses_t0[1].position.x() += 1.2;
+
+    const double inflation_radius = 0.01, max_displacement = 0.3;
+    const int collision_types = CollisionType::EDGE_EDGE
+        | CollisionType::FACE_VERTEX;
+    SpeculativeCCDCandidates speculative;
+    speculative.detect(
+        bodies, poses_t0, collision_types, inflation_radius, max_displacement,
+        [&](double radius, Candidates& candidates) {
+            detect_collision_candidates_rigid(
+                bodies, poses_t0, collision_types, candidates,
+                DetectionMethod::BVH, radius);
+        });
+
+    PosesD poses_t1 = poses_t0;
+    SECTION("Short trajectories are covered")
+    {
+        // The bodies overlap at the end
+        poses_t1[1].position.x() -= 0.25;
+        poses_t1[1].rotation.z() += 0.01;
+        CHECK(
+            SpeculativeCCDCandidates::max_vertex_displacement(
+                bodies, poses_t0, poses_t1)
+            <= max_displacement);
+        REQUIRE(speculative.covers(
+            bodies, poses_t0, poses_t1, collision_types, inflation_radius));
+
+        Candidates candidates;
+        detect_collision_candidates(
+            bodies, poses_t0, poses_t1, collision_types, candidates,
+            DetectionMethod::BVH, TrajectoryType::RIGID, inflation_radius);
+        CHECK(candidates.size() > 0);
+        CHECK(speculative.candidates().size() >= candidates.size());
+    }
+
+    SECTION("Long trajectories are not covered")
+    {
+        poses_t1[1].position.x() -= 0.5;
+        CHECK(!speculative.covers(
+            bodies, poses_t0, poses_t1, collision_types, inflation_radius));
+    }
+
+    SECTION("Trajectories from other poses are not covered")
+    {
+        PosesD other_poses_t0 = poses_t0;
+        other_poses_t0[0].position.y() += 1e-3;
+        CHECK(!speculative.covers(
+            bodies, other_poses_t0, poses_t1, collision_types,
+            inflation_radius));
+    }
+
+    SECTION("Clearing covers nothing")
+    {
+        speculative.clear();
+        CHECK(!speculative.covers(
+            bodies, poses_t0, poses_t1, collision_types, inflation_radius));
+    }
+}
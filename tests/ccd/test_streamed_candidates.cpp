@@ -0,0 +1,80 @@
+#include <atomic>
+
+#include <catch2/catch.hpp>
+
+#include <ccd/rigid/broad_phase.hpp>
+#include <opt/distance_barrier_constraint.hpp>
+
+#include "rigid_body_generator.hpp"
+
+using namespace ipc;
+using namespace ipc::rigid;
+using namespace ipc::rigid::unittests;
+
+TEST_CASE("Streamed CCD candidates", "[ccd][broad_phase][bvh]")
+{
+    RigidBodyAssembler bodies;
+    bodies.init({ { create_tetrahedron(0), create_tetrahedron(1) } });
+
+    // Body 1 passes through body 0 while rotating
+    PosesD poses_t0 = bodies.rb_poses_t1();
+    poses_t0[1].position.x() += 3;
+    PosesD poses_t1 = poses_t0;
+    poses_t1[1].position.x() = poses_t0[0].position.x() + 0.25;
+    poses_t1[1].rotation.z() += 0.5;
+
+    const double inflation_radius = 0.0;
+    const int collision_types = CollisionType::EDGE_EDGE
+        | CollisionType::FACE_VERTEX;
+
+    Candidates expected_candidates;
+    detect_collision_candidates_rigid_bvh(
+        bodies, poses_t0, poses_t1, collision_types, expected_candidates,
+        inflation_radius);
+    REQUIRE(expected_candidates.size() > 0);
+
+    SECTION("All candidates are streamed without a bound")
+    {
+        std::atomic<size_t> num_candidates(0);
+        stream_collision_candidates_rigid_bvh(
+            bodies, poses_t0, poses_t1, collision_types, [] { return 1.0; },
+            [&](const Candidates& c) { num_candidates += c.size(); },
+            inflation_radius);
+        CHECK(num_candidates == expected_candidates.size());
+    }
+
+    SECTION("Nothing is traversed with a zero bound")
+    {
+        bool is_consumed = false;
+        stream_collision_candidates_rigid_bvh(
+            bodies, poses_t0, poses_t1, collision_types, [] { return 0.0; },
+            [&](const Candidates&) { is_consumed = true; }, inflation_radius);
+        CHECK(!is_consumed);
+    }
+
+    SECTION("A bound traverses fewer candidates")
+    {
+        std::atomic<size_t> num_candidates(0);
+        stream_collision_candidates_rigid_bvh(
+            bodies, poses_t0, poses_t1, collision_types, [] { return 0.5; },
+            [&](const Candidates& c) { num_candidates += c.size(); },
+            inflation_radius);
+        CHECK(num_candidates <= expected_candidates.size());
+    }
+
+    SECTION("The streamed time of impact matches")
+    {
+        DistanceBarrierConstraint constraint;
+        constraint.detection_method = DetectionMethod::BVH;
+        constraint.trajectory_type = TrajectoryType::RIGID;
+        constraint.use_candidate_cache = false;
+        const double toi =
+            constraint.compute_earliest_toi(bodies, poses_t0, poses_t1);
+        REQUIRE(toi < 1);
+
+        constraint.stream_ccd_candidates = true;
+        CHECK(
+            constraint.compute_earliest_toi(bodies, poses_t0, poses_t1)
+            == Approx(toi).margin(1e-8));
+    }
+}
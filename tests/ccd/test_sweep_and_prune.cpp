@@ -0,0 +1,84 @@
+#include <catch2/catch.hpp>
+
+#include <ccd/linear/broad_phase.hpp>
+#include <ccd/rigid/broad_phase.hpp>
+#include <ccd/sweep_and_prune.hpp>
+
+#include "box_generator.hpp"
+#include "rigid_body_generator.hpp"
+
+using namespace ipc;
+using namespace ipc::rigid;
+using namespace ipc::rigid::unittests;
+
+static std::vector<AABB>
+to_aabbs(const std::vector<std::array<Eigen::Vector3d, 2>>& boxes)
+{
+    std::vector<AABB> aabbs;
+    for (const auto& box : boxes) {
+        aabbs.emplace_back(box[0].array(), box[1].array());
+    }
+    return aabbs;
+}
+
+TEST_CASE("Sweep and prune overlaps", "[ccd][broad_phase][sap]")
+{
+    int num_boxes = GENERATE(1, 10, 100);
+    std::vector<AABB> boxes = to_aabbs(random_boxes(num_boxes));
+
+    auto can_collide = [](int, int) { return true; };
+    SweepAndPrune sap;
+    std::vector<std::pair<int, int>> pairs;
+    sap.update(boxes);
+    sap.find_overlapping_pairs(can_collide, pairs);
+    CHECK(pairs == brute_force_overlaps(boxes, AABB::are_overlapping));
+
+    // Small coherent motion only needs a few swaps
+    for (AABB& box : boxes) {
+        Eigen::Array3d displacement = 1e-3 * Eigen::Array3d::Random();
+        box = AABB(box.getMin() + displacement, box.getMax() + displacement);
+    }
+    sap.update(boxes);
+    sap.find_overlapping_pairs(can_collide, pairs);
+    CHECK(pairs == brute_force_overlaps(boxes, AABB::are_overlapping));
+    CHECK(sap.num_swaps() <= SweepAndPrune::MAX_SWAPS_PER_BOX * num_boxes);
+}
+
+TEST_CASE("Sweep and prune candidates", "[ccd][broad_phase][sap]")
+{
+    RigidBodyAssembler bodies;
+    bodies.init({ { create_tetrahedron(0), create_tetrahedron(1) } });
+
+    PosesD poses_t0 = bodies.rb_poses_t1();
+    poses_t0[1].position.x() += 1.05;
+    PosesD poses_t1 = poses_t0;
+
+    const int collision_types = CollisionType::EDGE_EDGE
+        | CollisionType::FACE_VERTEX;
+
+    Candidates brute_force_candidates;
+    detect_collision_candidates_brute_force(
+        bodies.world_vertices(poses_t0), bodies.m_edges, bodies.m_faces,
+        bodies.group_ids(), collision_types, brute_force_candidates);
+
+    SECTION("Far apart")
+    {
+        poses_t1[1].position.x() = poses_t0[1].position.x() += 10;
+        Candidates candidates;
+        detect_collision_candidates_rigid(
+            bodies, poses_t0, poses_t1, collision_types, candidates,
+            DetectionMethod::SWEEP_AND_PRUNE);
+        CHECK(candidates.size() == 0);
+    }
+
+    SECTION("Moving into contact")
+    {
+        poses_t1[1].position.x() -= 0.5;
+        Candidates candidates;
+        detect_collision_candidates_rigid(
+            bodies, poses_t0, poses_t1, collision_types, candidates,
+            DetectionMethod::SWEEP_AND_PRUNE, /*inflation_radius=*/0.1);
+        CHECK(candidates.size() > 0);
+        CHECK(candidates.size() <= brute_force_candidates.size());
+    }
+}
@@ -0,0 +1,87 @@
+#include <catch2/catch.hpp>
+
+#include <ccd/ccd.hpp>
+#include <ccd/rigid/toi_bound_cache.hpp>
+
+using namespace ipc;
+using namespace ipc::rigid;
+
+TEST_CASE("TOI bounds of sub-intervals", "[ccd][toi_bound_cache]")
+{
+    PosesD poses_t0 = { PoseD::Zero(3), PoseD::Zero(3) };
+    poses_t0[1].position << 2, 0, 0;
+    PosesD poses_t1 = poses_t0;
+    poses_t1[0].position << 1, 0.5, 0;
+    poses_t1[0].rotation << 0, 0, 1;
+
+    Candidates candidates;
+    candidates.ev_candidates.emplace_back(0, 1);
+    candidates.ev_candidates.emplace_back(1, 2);
+    candidates.ev_candidates.emplace_back(2, 3);
+    candidates.ev_candidates.emplace_back(3, 0);
+
+    const int collision_types = CollisionType::EDGE_VERTEX;
+    TOIBoundCache cache;
+    CHECK(!cache.map_to_subinterval(poses_t0, poses_t1, collision_types, 0));
+
+    cache.reset(poses_t0, poses_t1, collision_types, 0, candidates);
+    REQUIRE(cache.bounds().size() == 4);
+    CHECK(!cache.bounds()[0].is_settled());
+    cache.bounds()[0] = TOIBound { 0.5, true };
+    cache.bounds()[1] = TOIBound { 0.8, false };
+    cache.bounds()[2] = TOIBound { 1.0, false };
+    cache.bounds()[3] = TOIBound { 0.2, false };
+
+    const auto pose_at = [&](double t) {
+        return interpolate(poses_t0, poses_t1, t);
+    };
+
+    SECTION("Different settings")
+    {
+        CHECK(!cache.map_to_subinterval(
+            poses_t0, poses_t1, collision_types, 1e-3));
+        CHECK(!cache.map_to_subinterval(
+            poses_t0, poses_t1, CollisionType::EDGE_EDGE, 0));
+    }
+
+    SECTION("Outside of the cached trajectory")
+    {
+        CHECK(!cache.map_to_subinterval(
+            pose_at(0.5), pose_at(1.5), collision_types, 0));
+        PosesD poses = pose_at(0.75);
+        poses[1].position.y() += 1e-6;
+        CHECK(!cache.map_to_subinterval(
+            pose_at(0.25), poses, collision_types, 0));
+    }
+
+    SECTION("Sub-interval")
+    {
+        REQUIRE(cache.map_to_subinterval(
+            pose_at(0.25), pose_at(0.75), collision_types, 0));
+        const std::vector<TOIBound>& bounds = cache.bounds();
+        CHECK(bounds[0].is_impact);
+        CHECK(bounds[0].toi == Approx(0.5));
+        // No impact before the end of the sub-interval
+        CHECK(!bounds[1].is_impact);
+        CHECK(bounds[1].is_settled());
+        CHECK(bounds[2].is_settled());
+        // Unknown after the start of the sub-interval
+        CHECK(!bounds[3].is_settled());
+        CHECK(bounds[3].toi == 0);
+
+        // The impact is past the end of the next sub-interval
+        REQUIRE(cache.map_to_subinterval(
+            pose_at(0.25), pose_at(0.45), collision_types, 0));
+        CHECK(!cache.bounds()[0].is_impact);
+        CHECK(cache.bounds()[0].is_settled());
+        CHECK(cache.candidates().size() == candidates.size());
+    }
+
+    SECTION("Clear")
+    {
+        cache.clear();
+        CHECK(!cache.map_to_subinterval(
+            poses_t0, poses_t1, collision_types, 0));
+        CHECK(cache.bounds().empty());
+    }
+}
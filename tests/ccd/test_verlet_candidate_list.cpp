@@ -0,0 +1,73 @@
+#include <catch2/catch.hpp>
+
+#include <ccd/rigid/broad_phase.hpp>
+#include <ccd/rigid/verlet_candidate_list.hpp>
+
+#include "rigid_body_generator.hpp"
+
+using namespace ipc;
+using namespace ipc::rigid;
+using namespace ipc::rigid::unittests;
+
+TEST_CASE("Verlet candidate list", "[ccd][broad_phase][cache]")
+{
+    RigidBodyAssembler bodies;
+    bodies.init({ { create_tetrahedron(0), create_tetrahedron(1) } });
+
+    PosesD poses = bodies.rb_poses_t1();
+    poses[1].position.x() += 1.05;
+
+    const double inflation_radius = 0.1;
+    const int collision_types = CollisionType::EDGE_EDGE
+        | CollisionType::FACE_VERTEX;
+    VerletCandidateList list;
+
+    const auto detect_candidates = [&](double radius, Candidates& candidates) {
+        detect_collision_candidates_rigid(
+            bodies, poses, collision_types, candidates, DetectionMethod::BVH,
+            radius);
+    };
+
+    list.update(
+        bodies, poses, collision_types, inflation_radius, detect_candidates);
+    CHECK(list.num_rebuilds() == 1);
+
+    Candidates expected_candidates;
+    detect_candidates(inflation_radius, expected_candidates);
+    // The list is built with a slack so the candidates are a superset
+    CHECK(list.candidates().size() >= expected_candidates.size());
+
+    SECTION("Small motion reuses the candidates")
+    {
+        poses[1].position.x() -= 0.1 * inflation_radius;
+        poses[1].rotation.z() += 0.01 * inflation_radius;
+        CHECK(!list.needs_rebuild(
+            bodies, poses, collision_types, inflation_radius));
+
+        list.update(
+            bodies, poses, collision_types, inflation_radius,
+            detect_candidates);
+        CHECK(list.num_rebuilds() == 1);
+
+        expected_candidates.clear();
+        detect_candidates(inflation_radius, expected_candidates);
+        CHECK(list.candidates().size() >= expected_candidates.size());
+    }
+
+    SECTION("Large motion rebuilds the candidates")
+    {
+        poses[1].position.x() -= 0.5;
+        list.update(
+            bodies, poses, collision_types, inflation_radius,
+            detect_candidates);
+        CHECK(list.num_rebuilds() == 2);
+    }
+
+    SECTION("Changing the radius rebuilds the candidates")
+    {
+        list.update(
+            bodies, poses, collision_types, 2 * inflation_radius,
+            detect_candidates);
+        CHECK(list.num_rebuilds() == 2);
+    }
+}
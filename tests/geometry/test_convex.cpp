@@ -0,0 +1,100 @@
+#include <catch2/catch.hpp>
+
+#include <Eigen/Geometry>
+
+#include <geometry/convex.hpp>
+
+#include "../ccd/rigid_body_generator.hpp"
+
+using namespace ipc::rigid;
+using namespace ipc::rigid::unittests;
+
+static SupportFunction support_function(
+    const Eigen::MatrixXd& V,
+    const Eigen::Matrix3d& R,
+    const Eigen::Vector3d& p)
+{
+    return [=](const Eigen::Vector3d& d) -> Eigen::Vector3d {
+        Eigen::Index i;
+        (V * (R.transpose() * d)).maxCoeff(&i);
+        return R * V.row(i).transpose() + p;
+    };
+}
+
+TEST_CASE("Convex mesh detection", "[geometry][convex]")
+{
+    Eigen::MatrixXd V;
+    Eigen::MatrixXi E, F;
+    unit_cube_mesh(V, E, F);
+    CHECK(is_convex_mesh(V, E, F));
+
+    // Dent a corner
+    V.row(7) << 0.5, 0.5, 0.5;
+    CHECK(!is_convex_mesh(V, E, F));
+
+    // Open meshes are not convex
+    unit_cube_mesh(V, E, F);
+    CHECK(!is_convex_mesh(V, E, F.topRows(F.rows() - 1)));
+
+    Eigen::MatrixXd square(4, 2);
+    square << 0, 0, 1, 0, 1, 1, 0, 1;
+    Eigen::MatrixXi square_edges(4, 2);
+    square_edges << 0, 1, 1, 2, 2, 3, 3, 0;
+    CHECK(is_convex_mesh(square, square_edges, Eigen::MatrixXi()));
+    square.row(2) << 0.2, 0.2;
+    CHECK(!is_convex_mesh(square, square_edges, Eigen::MatrixXi()));
+}
+
+TEST_CASE("Convex distance lower bound", "[geometry][convex][gjk]")
+{
+    Eigen::MatrixXd V;
+    Eigen::MatrixXi E, F;
+    unit_cube_mesh(V, E, F);
+    const Eigen::Matrix3d I = Eigen::Matrix3d::Identity();
+    const SupportFunction cube =
+        support_function(V, I, Eigen::Vector3d::Zero());
+
+    CHECK(
+        convex_distance_lower_bound(
+            cube, support_function(V, I, Eigen::Vector3d(3, 0, 0)))
+        == Approx(2));
+    CHECK(
+        convex_distance_lower_bound(
+            cube, support_function(V, I, Eigen::Vector3d(2, 2, 0)))
+        == Approx(sqrt(2)));
+    CHECK(
+        convex_distance_lower_bound(
+            cube, support_function(V, I, Eigen::Vector3d(0.5, 0.2, 0.1)))
+        == 0);
+
+    // Never more than the distance between any two points of the cubes
+    for (int i = 0; i < 100; i++) {
+        const Eigen::Matrix3d R =
+            Eigen::Quaterniond::UnitRandom().toRotationMatrix();
+        const Eigen::Vector3d p = 3 * Eigen::Vector3d::Random();
+        const double distance =
+            convex_distance_lower_bound(cube, support_function(V, R, p));
+        for (int j = 0; j < 100; j++) {
+            const Eigen::Vector3d a = (Eigen::Array3d::Random() + 1) / 2;
+            const Eigen::Vector3d b =
+                R * ((Eigen::Array3d::Random() + 1) / 2).matrix() + p;
+            REQUIRE(distance <= (a - b).norm());
+        }
+    }
+
+    // Planar sets
+    Eigen::MatrixXd square(4, 3);
+    square << 0, 0, 0, 1, 0, 0, 1, 1, 0, 0, 1, 0;
+    const SupportFunction square_support =
+        support_function(square, I, Eigen::Vector3d::Zero());
+    CHECK(
+        convex_distance_lower_bound(
+            square_support,
+            support_function(square, I, Eigen::Vector3d(1.5, 1.5, 0)))
+        == Approx(sqrt(0.5)));
+    CHECK(
+        convex_distance_lower_bound(
+            square_support,
+            support_function(square, I, Eigen::Vector3d(0.5, 0.5, 0)))
+        == 0);
+}
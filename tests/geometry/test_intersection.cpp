@@ -41,3 +41,53 @@ TEST_CASE("Point-triangle intersection", "[intersection]")
 {
     // TODO
 }
+
+TEST_CASE("Filtered orientation predicates", "[intersection][predicates]")
+{
+    const Eigen::Vector2d a(0, 0), b(1, 0);
+    CHECK(filtered_orient2d(a, b, Eigen::Vector2d(0.5, 1)) == 1);
+    CHECK(filtered_orient2d(a, b, Eigen::Vector2d(0.5, -1)) == -1);
+    // Collinear points cannot be certified
+    CHECK(filtered_orient2d(a, b, Eigen::Vector2d(2, 0)) == 0);
+    // Tiny determinants without rounding errors are still certified
+    CHECK(filtered_orient2d(a, b, Eigen::Vector2d(0.5, 1e-300)) == 1);
+    // Nearly collinear points
+    CHECK(
+        filtered_orient2d(
+            Eigen::Vector2d(0.1, 0.1), Eigen::Vector2d(0.3, 0.3),
+            Eigen::Vector2d(0.7, 0.7))
+        == 0);
+
+    const Eigen::Vector3d t0(0, 0, 0), t1(1, 0, 0), t2(0, 1, 0);
+    const int below = filtered_orient3d(t0, t1, t2, Eigen::Vector3d(0, 0, -1));
+    const int above = filtered_orient3d(t0, t1, t2, Eigen::Vector3d(0, 0, 1));
+    CHECK(below != 0);
+    CHECK(above == -below);
+    CHECK(filtered_orient3d(t0, t1, t2, Eigen::Vector3d(3, 4, 0)) == 0);
+}
+
+TEST_CASE("Filtered segment intersections", "[intersection][predicates]")
+{
+    SECTION("2D")
+    {
+        const Eigen::Vector2d a0(-1, 0), a1(1, 0);
+        double y = GENERATE(-1.0, -1e-300, 0.0, 1e-300, 1.0);
+        double x = GENERATE(-2.0, -1.0, 0.0, 1.0, 2.0);
+        const Eigen::Vector2d b0(x, y), b1(x, 1);
+        CAPTURE(x, y);
+        CHECK(
+            are_segments_intersecting(a0, a1, b0, b1)
+            == (y <= 0 && std::abs(x) <= 1));
+    }
+    SECTION("3D")
+    {
+        const Eigen::Vector3d t0(0, 0, 0), t1(1, 0, 0), t2(0, 1, 0);
+        double z = GENERATE(-1.0, -1e-300, 0.0, 1e-300, 1.0);
+        double x = GENERATE(-1.0, 0.0, 0.25, 1.0, 2.0);
+        const Eigen::Vector3d e0(x, 0.25, z), e1(x, 0.25, 1);
+        CAPTURE(x, z);
+        CHECK(
+            is_segment_intersecting_triangle(e0, e1, t0, t1, t2)
+            == (z <= 0 && x >= 0 && x <= 0.75));
+    }
+}
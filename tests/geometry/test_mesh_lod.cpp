@@ -0,0 +1,118 @@
+#include <catch2/catch.hpp>
+
+#include <cmath>
+
+#include <geometry/mesh_lod.hpp>
+
+using namespace ipc::rigid;
+
+static void uv_sphere(
+    int num_rings, int num_segments, Eigen::MatrixXd& V, Eigen::MatrixXi& F)
+{
+    V.resize((num_rings + 1) * num_segments, 3);
+    for (int i = 0; i <= num_rings; i++) {
+        const double theta = M_PI * i / num_rings;
+        for (int j = 0; j < num_segments; j++) {
+            const double phi = 2 * M_PI * j / num_segments;
+            V.row(i * num_segments + j) << std::sin(theta) * std::cos(phi),
+                std::sin(theta) * std::sin(phi), std::cos(theta);
+        }
+    }
+    F.resize(2 * num_rings * num_segments, 3);
+    for (int i = 0; i < num_rings; i++) {
+        for (int j = 0; j < num_segments; j++) {
+            const int a = i * num_segments + j;
+            const int b = i * num_segments + (j + 1) % num_segments;
+            const int c = a + num_segments, d = b + num_segments;
+            F.row(2 * (i * num_segments + j)) << a, c, b;
+            F.row(2 * (i * num_segments + j) + 1) << b, c, d;
+        }
+    }
+}
+
+static bool is_valid_lod(const MeshLOD& lod)
+{
+    for (const Eigen::MatrixXi* simplices : { &lod.edges, &lod.faces }) {
+        if (simplices->size()
+            && (simplices->minCoeff() < 0
+                || simplices->maxCoeff() >= lod.vertices.rows())) {
+            return false;
+        }
+    }
+    return true;
+}
+
+TEST_CASE("Simplify a mesh by vertex clustering", "[geometry][lod]")
+{
+    Eigen::MatrixXd V;
+    Eigen::MatrixXi E, F;
+    uv_sphere(16, 32, V, F);
+
+    // A grid finer than the mesh at most merges the (nearly) coincident
+    // vertices of the poles and their degenerate faces
+    MeshLOD fine = simplify_mesh(V, E, F, 1 << 20);
+    CHECK(fine.vertices.rows() >= V.rows() - 2 * (32 - 1));
+    CHECK(fine.faces.rows() >= F.rows() - 2 * 32);
+    CHECK(is_valid_lod(fine));
+
+    MeshLOD coarse = simplify_mesh(V, E, F, 4);
+    CHECK(coarse.faces.rows() < F.rows() / 4);
+    CHECK(coarse.vertices.rows() <= 4 * 4 * 4);
+    CHECK(is_valid_lod(coarse));
+    // Merged vertices stay within the mesh's bounding box
+    CHECK(coarse.vertices.cwiseAbs().maxCoeff() <= 1 + 1e-12);
+
+    // Everything collapses into a single cell
+    CHECK(simplify_mesh(V, E, F, 1).faces.rows() == 0);
+}
+
+TEST_CASE("Build the levels of detail of a mesh", "[geometry][lod]")
+{
+    Eigen::MatrixXd V;
+    Eigen::MatrixXi E, F;
+    const long min_primitives = 64;
+
+    SECTION("Surface")
+    {
+        uv_sphere(64, 128, V, F);
+        const std::vector<MeshLOD> lods =
+            build_mesh_lods(V, E, F, min_primitives);
+        REQUIRE(lods.size() >= 2);
+        long num_primitives = F.rows();
+        for (const MeshLOD& lod : lods) {
+            CHECK(lod.faces.rows() > 0);
+            CHECK(2 * lod.num_primitives() <= num_primitives);
+            CHECK(is_valid_lod(lod));
+            num_primitives = lod.num_primitives();
+        }
+        for (size_t i = 0; i + 1 < lods.size(); i++) {
+            CHECK(lods[i].num_primitives() >= min_primitives);
+        }
+    }
+
+    SECTION("Curve")
+    {
+        const int n = 1024;
+        V.resize(n, 2);
+        E.resize(n, 2);
+        for (int i = 0; i < n; i++) {
+            V.row(i) << std::cos(2 * M_PI * i / n), std::sin(2 * M_PI * i / n);
+            E.row(i) << i, (i + 1) % n;
+        }
+        const std::vector<MeshLOD> lods =
+            build_mesh_lods(V, E, F, min_primitives);
+        REQUIRE(lods.size() >= 2);
+        long num_primitives = E.rows();
+        for (const MeshLOD& lod : lods) {
+            CHECK(2 * lod.num_primitives() <= num_primitives);
+            CHECK(is_valid_lod(lod));
+            num_primitives = lod.num_primitives();
+        }
+    }
+
+    SECTION("Small meshes are not simplified")
+    {
+        uv_sphere(2, 4, V, F);
+        CHECK(build_mesh_lods(V, E, F, min_primitives).empty());
+    }
+}
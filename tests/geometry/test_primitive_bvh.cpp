@@ -0,0 +1,110 @@
+#include <catch2/catch.hpp>
+
+#include <algorithm>
+#include <set>
+#include <utility>
+
+#include <geometry/primitive_bvh.hpp>
+
+#include "../ccd/box_generator.hpp"
+
+using namespace ipc;
+using namespace ipc::rigid;
+using namespace ipc::rigid::unittests;
+
+namespace {
+struct TestBox {
+    TestBox() = default;
+    explicit TestBox(const std::array<Eigen::Vector3d, 2>& box)
+        : min(box[0])
+        , max(box[1])
+    {
+    }
+    TestBox(const TestBox& a, const TestBox& b)
+        : min(a.min.cwiseMin(b.min))
+        , max(a.max.cwiseMax(b.max))
+    {
+    }
+
+    static bool are_overlapping(const TestBox& a, const TestBox& b)
+    {
+        return (a.min.array() <= b.max.array()).all()
+            && (b.min.array() <= a.max.array()).all();
+    }
+
+    Eigen::Vector3d min, max;
+};
+} // namespace
+
+TEST_CASE("Dual BVH traversal", "[geometry][bvh]")
+{
+    const int dim = GENERATE(2, 3);
+    const int na = GENERATE(1, 2, 7, 100);
+    const int nb = GENERATE(1, 5, 300);
+
+    const auto boxes_a =
+        random_boxes(na, /*spread=*/1, /*max_extent=*/0.1, dim);
+    const auto boxes_b =
+        random_boxes(nb, /*spread=*/1, /*max_extent=*/0.05, dim);
+
+    PrimitiveBVH bvh_a, bvh_b;
+    bvh_a.init(boxes_a);
+    bvh_b.init(boxes_b);
+    CHECK(bvh_a.num_primitives() == na);
+    CHECK(bvh_a.num_nodes() == 2 * na - 1);
+
+    // Refit both in a shifted frame
+    const Eigen::Vector3d shift(0.05, -0.02, 0);
+    std::vector<TestBox> node_boxes_a, node_boxes_b;
+    bvh_a.refit(
+        [&](int i) {
+            TestBox box(boxes_a[i]);
+            box.min += shift;
+            box.max += shift;
+            return box;
+        },
+        node_boxes_a);
+    bvh_b.refit([&](int i) { return TestBox(boxes_b[i]); }, node_boxes_b);
+
+    std::set<std::pair<int, int>> expected;
+    for (int i = 0; i < na; i++) {
+        TestBox box_a(boxes_a[i]);
+        box_a.min += shift;
+        box_a.max += shift;
+        for (int j = 0; j < nb; j++) {
+            if (TestBox::are_overlapping(box_a, TestBox(boxes_b[j]))) {
+                expected.emplace(i, j);
+            }
+        }
+    }
+
+    std::vector<std::pair<int, int>> visited;
+    PrimitiveBVH::traverse(
+        bvh_a, node_boxes_a, bvh_b, node_boxes_b,
+        [&](int i, int j) { visited.emplace_back(i, j); });
+
+    // Every overlapping pair is visited exactly once
+    CHECK(visited.size() == expected.size());
+    CHECK(
+        std::set<std::pair<int, int>>(visited.begin(), visited.end())
+        == expected);
+}
+
+TEST_CASE("BVH of coincident primitives", "[geometry][bvh]")
+{
+    const int n = GENERATE(2, 3, 64);
+    std::vector<std::array<Eigen::Vector3d, 2>> boxes(
+        n, { { Eigen::Vector3d::Zero(), Eigen::Vector3d::Ones() } });
+
+    PrimitiveBVH bvh;
+    bvh.init(boxes);
+    CHECK(bvh.num_nodes() == 2 * n - 1);
+
+    std::vector<TestBox> node_boxes;
+    bvh.refit([&](int i) { return TestBox(boxes[i]); }, node_boxes);
+
+    int num_pairs = 0;
+    PrimitiveBVH::traverse(
+        bvh, node_boxes, bvh, node_boxes, [&](int, int) { num_pairs++; });
+    CHECK(num_pairs == n * n);
+}
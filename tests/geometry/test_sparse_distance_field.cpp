@@ -0,0 +1,106 @@
+#include <catch2/catch.hpp>
+
+#include <sstream>
+
+#include <ipc/distance/point_triangle.hpp>
+
+#include <geometry/sparse_distance_field.hpp>
+
+#include "../ccd/rigid_body_generator.hpp"
+
+using namespace ipc;
+using namespace ipc::rigid;
+using namespace ipc::rigid::unittests;
+
+static double cube_distance(
+    const Eigen::MatrixXd& V, const Eigen::MatrixXi& F, const VectorMax3d& x)
+{
+    double distance = std::numeric_limits<double>::infinity();
+    for (int i = 0; i < F.rows(); i++) {
+        distance = std::min(
+            distance,
+            sqrt(point_triangle_distance(
+                Eigen::Vector3d(x), Eigen::Vector3d(V.row(F(i, 0))),
+                Eigen::Vector3d(V.row(F(i, 1))),
+                Eigen::Vector3d(V.row(F(i, 2))))));
+    }
+    return distance;
+}
+
+TEST_CASE("Sparse distance field bounds", "[geometry][distance_field]")
+{
+    Eigen::MatrixXd V;
+    Eigen::MatrixXi E, F;
+    unit_cube_mesh(V, E, F);
+    const double h = 0.1, band_width = 0.4;
+    const SparseDistanceField field(V, E, F, h, band_width);
+    CHECK(field.dim() == 3);
+    CHECK(field.num_nodes() > 0);
+
+    for (int i = 0; i < 1000; i++) {
+        const VectorMax3d x = 1.5 * Eigen::Vector3d::Random().array() + 0.5;
+        const double distance = cube_distance(V, F, x);
+        const double lower_bound = field.distance_lower_bound(x);
+        REQUIRE(lower_bound <= distance + 1e-12);
+        // Tight inside the band
+        if (distance < band_width - h) {
+            REQUIRE(lower_bound >= distance - 2 * sqrt(3) * h);
+        }
+    }
+
+    // Gradient points away from the closest face
+    VectorMax3d gradient;
+    const double distance =
+        field.distance(Eigen::Vector3d(0.5, 0.5, 1.15), gradient);
+    CHECK(distance == Approx(0.15).margin(1e-12));
+    CHECK(gradient(0) == Approx(0).margin(1e-12));
+    CHECK(gradient(1) == Approx(0).margin(1e-12));
+    CHECK(gradient(2) == Approx(1));
+
+    // Far away points are bounded by the band
+    const Eigen::Vector3d far_point(10.03, 10.05, 10.07);
+    CHECK(
+        field.distance_lower_bound(far_point) >= band_width - sqrt(3) * h);
+    CHECK(field.distance(far_point, gradient) == Approx(band_width));
+    CHECK(gradient.norm() == Approx(0).margin(1e-12));
+}
+
+TEST_CASE("Sparse distance field of a polygon", "[geometry][distance_field]")
+{
+    Eigen::MatrixXd V(4, 2);
+    V << 0, 0, 1, 0, 1, 1, 0, 1;
+    Eigen::MatrixXi E(4, 2);
+    E << 0, 1, 1, 2, 2, 3, 3, 0;
+    const SparseDistanceField field(V, E, Eigen::MatrixXi(), 0.05, 0.2);
+    CHECK(field.dim() == 2);
+
+    for (int i = 0; i < 1000; i++) {
+        const VectorMax3d x = Eigen::Vector2d::Random().array() + 0.5;
+        // Distance to the square's boundary
+        const Eigen::Array2d d = (x.array() - 0.5).abs() - 0.5;
+        const double distance = d.maxCoeff() > 0
+            ? d.max(0.0).matrix().norm()
+            : -d.maxCoeff();
+        REQUIRE(field.distance_lower_bound(x) <= distance + 1e-12);
+    }
+}
+
+TEST_CASE("Sparse distance field io", "[geometry][distance_field]")
+{
+    Eigen::MatrixXd V;
+    Eigen::MatrixXi E, F;
+    unit_cube_mesh(V, E, F);
+    const SparseDistanceField field(V, E, F, 0.1, 0.3);
+
+    std::stringstream stream;
+    REQUIRE(field.write(stream));
+    SparseDistanceField read_field;
+    REQUIRE(read_field.read(stream));
+    CHECK(read_field.dim() == field.dim());
+    CHECK(read_field.cell_size() == field.cell_size());
+    CHECK(read_field.band_width() == field.band_width());
+    CHECK(read_field.num_nodes() == field.num_nodes());
+
+    const Eigen::Vector3d x(0.3, 1.07, 0.2);
+    CHECK(read_field.distance_lower_bound(x) == field.distance_lower_bound(x));
+}
@@ -1,3 +1,5 @@
+#include <cfenv>
+
 #include <catch2/catch.hpp>
 
 #include <igl/PI.h>
@@ -37,6 +39,55 @@ TEST_CASE("Simple interval arithmetic", "[interval]")
     CHECK(result.upper() == Approx(i.upper() + 10).margin(1e-12));
 }
 
+#ifdef USE_FILIB_INTERVALS
+TEST_CASE("Fixed rounding mode intervals", "[interval][rounding]")
+{
+    typedef IntervalWith<interval_options::FILibFixedRoundingPolicy>
+        FixedInterval;
+    typedef IntervalWith<interval_options::FILibRoundingPolicy> FILibInterval;
+
+    const int rounding_mode = std::fegetround();
+
+    FixedInterval i(0.1, 0.2), j(3, 4);
+    FixedInterval r = cos(i * j + sqrt(j)) / j - FixedInterval(1.0f / 3.0f);
+    CHECK(std::fegetround() == rounding_mode);
+
+    FILibInterval expected = cos(FILibInterval(0.1, 0.2) * FILibInterval(3, 4)
+                                 + sqrt(FILibInterval(3, 4)))
+            / FILibInterval(3, 4)
+        - FILibInterval(1.0f / 3.0f);
+    CHECK(r.lower() == expected.lower());
+    CHECK(r.upper() == expected.upper());
+}
+#endif
+
+TEMPLATE_TEST_CASE(
+    "Interval backends enclose the same values",
+    "[interval][rounding]",
+#ifdef USE_FILIB_INTERVALS
+    interval_options::FILibRoundingPolicy,
+    interval_options::FILibFixedRoundingPolicy,
+#endif
+    interval_options::BoostRoundingPolicy)
+{
+    typedef IntervalWith<TestType> BackendInterval;
+
+    const int rounding_mode = std::fegetround();
+    double x = GENERATE(-7.5, -0.3, 0.0, 0.1, 2.0, 40.0);
+    BackendInterval i(x, x + 1e-3), j(3, 4);
+    BackendInterval r = cos(i * j) + sin(i) / j - sqrt(j);
+    // No backend leaks a changed rounding mode to the rest of the program
+    REQUIRE(std::fegetround() == rounding_mode);
+    for (double t = 0; t <= 1; t += 0.125) {
+        const double xi = x + t * 1e-3;
+        for (double yj = 3; yj <= 4; yj += 0.25) {
+            const double expected = cos(xi * yj) + sin(xi) / yj - sqrt(yj);
+            CHECK(r.lower() <= expected);
+            CHECK(expected <= r.upper());
+        }
+    }
+}
+
 TEST_CASE("Cosine interval arithmetic", "[interval]")
 {
     ipc::rigid::Interval r;
@@ -1,6 +1,7 @@
 #include <catch2/catch.hpp>
 
 #include <igl/PI.h>
+#include <tbb/task_arena.h>
 
 #include <interval/interval_root_finder.hpp>
 #include <constants.hpp>
@@ -75,3 +76,273 @@ TEST_CASE("Root of simple function with constraints", "[ccd][interval]")
                    .margin(ipc::rigid::Constants::INTERVAL_ROOT_FINDER_TOL));
     }
 }
+
+TEST_CASE("Batched root finder matches the serial one", "[ccd][interval]")
+{
+    using namespace ipc::rigid;
+
+    double yshift = GENERATE(-1.1, -1.0, -0.5, -1e-4, 0.5);
+    double a = 4, b = -4, c = 1 + yshift;
+    auto f = [&](const VectorMax3I& x) {
+        VectorMax3I y(2);
+        y(0) = a * x(0) * x(0) + b * x(0) + c;
+        y(1) = x(1) - Interval(0.3);
+        return y;
+    };
+    auto f_batch = [&](const std::vector<VectorMax3I>& xs,
+                       std::vector<VectorMax3I>& ys) {
+        ys.resize(xs.size());
+        for (size_t i = 0; i < xs.size(); i++) {
+            ys[i] = f(xs[i]);
+        }
+    };
+
+    VectorMax3I x0 = Vector2I(Interval(0, 1), Interval(0, 1));
+    VectorMax3d tol = VectorMax3d::Constant(2, 1e-6);
+
+    VectorMax3I sol, batched_sol;
+    bool found_root = interval_root_finder(f, x0, tol, sol);
+    bool found_batched_root =
+        interval_root_finder_batched(f_batch, x0, tol, batched_sol);
+
+    CHECK(found_root == found_batched_root);
+    if (found_root && found_batched_root) {
+        double actual_sol = (-b - sqrt(b * b - 4 * a * c)) / (2 * a);
+        CHECK(batched_sol(0).lower() <= actual_sol);
+        CHECK(batched_sol(0).lower() == Approx(sol(0).lower()).margin(1e-6));
+    }
+}
+
+TEST_CASE("Root finder budget is conservative", "[ccd][interval]")
+{
+    using namespace ipc::rigid;
+
+    double a = 4, b = -4, c = 0.5;
+    auto f = [&](const VectorMax3I& x) {
+        return VectorMax3I::Constant(1, a * x(0) * x(0) + b * x(0) + c);
+    };
+    double actual_sol = (-b - sqrt(b * b - 4 * a * c)) / (2 * a);
+
+    VectorMax3I x0 = VectorMax3I::Constant(1, Interval(0, 1));
+    VectorMax3d tol = VectorMax3d::Constant(1, 1e-8);
+
+    int max_iterations = GENERATE(1, 5, 10);
+    int num_iterations = -1;
+    bool is_budget_exceeded = false;
+    VectorMax3I sol;
+    bool found_root = interval_root_finder(
+        f, x0, tol, sol, max_iterations, &num_iterations,
+        /*find_any_root=*/false, /*search_in_parallel=*/false,
+        /*relative_toi_tol=*/0, &is_budget_exceeded);
+
+    CHECK(found_root);
+    CHECK(is_budget_exceeded);
+    CHECK(num_iterations == max_iterations);
+    CHECK(sol(0).lower() <= actual_sol);
+}
+
+TEST_CASE(
+    "Root finder finishing with its budget is not out of budget",
+    "[ccd][interval]")
+{
+    using namespace ipc::rigid;
+
+    double a = 4, b = -4, c = 0.5;
+    auto f = [&](const VectorMax3I& x) {
+        return VectorMax3I::Constant(1, a * x(0) * x(0) + b * x(0) + c);
+    };
+    auto f_batch = [&](const std::vector<VectorMax3I>& xs,
+                       std::vector<VectorMax3I>& ys) {
+        ys.resize(xs.size());
+        for (size_t i = 0; i < xs.size(); i++) {
+            ys[i] = f(xs[i]);
+        }
+    };
+
+    VectorMax3I x0 = VectorMax3I::Constant(1, Interval(0, 1));
+    VectorMax3d tol = VectorMax3d::Constant(1, 1e-8);
+
+    VectorMax3I sol, exact_budget_sol;
+    int num_iterations = -1, exact_budget_num_iterations = -1;
+    bool is_budget_exceeded = true;
+
+    SECTION("Depth-first")
+    {
+        REQUIRE(interval_root_finder(f, x0, tol, sol, 1000, &num_iterations));
+        CHECK(interval_root_finder(
+            f, x0, tol, exact_budget_sol, num_iterations,
+            &exact_budget_num_iterations, /*find_any_root=*/false,
+            /*search_in_parallel=*/false, /*relative_toi_tol=*/0,
+            &is_budget_exceeded));
+    }
+    SECTION("Batched")
+    {
+        REQUIRE(interval_root_finder_batched(
+            f_batch, x0, tol, sol, 1000, &num_iterations));
+        CHECK(interval_root_finder_batched(
+            f_batch, x0, tol, exact_budget_sol, num_iterations,
+            &exact_budget_num_iterations, /*find_any_root=*/false,
+            /*relative_toi_tol=*/0, &is_budget_exceeded));
+    }
+
+    CHECK(!is_budget_exceeded);
+    CHECK(exact_budget_num_iterations == num_iterations);
+    CHECK(exact_budget_sol(0).lower() == sol(0).lower());
+}
+
+TEST_CASE("Batched root finder stays within its budget", "[ccd][interval]")
+{
+    using namespace ipc::rigid;
+
+    // Every box contains a root, so the frontier doubles with each level
+    auto f_batch = [&](const std::vector<VectorMax3I>& xs,
+                       std::vector<VectorMax3I>& ys) {
+        ys.assign(xs.size(), VectorMax3I::Constant(3, Interval(-1, 1)));
+    };
+
+    VectorMax3I x0 =
+        Vector3I(Interval(0, 1), Interval(0, 1), Interval(0, 1));
+    VectorMax3d tol = VectorMax3d::Constant(3, 1e-8);
+
+    int max_iterations = GENERATE(1, 3, 1000, 1001);
+    int num_iterations = -1;
+    bool is_budget_exceeded = false;
+    VectorMax3I sol;
+    bool found_root = interval_root_finder_batched(
+        f_batch, x0, tol, sol, max_iterations, &num_iterations,
+        /*find_any_root=*/false, /*relative_toi_tol=*/0, &is_budget_exceeded);
+
+    CHECK(found_root);
+    CHECK(is_budget_exceeded);
+    CHECK(num_iterations == max_iterations);
+    CHECK(sol(0).lower() == 0);
+}
+
+TEST_CASE("Any root answers like the earliest root", "[ccd][interval]")
+{
+    using namespace ipc::rigid;
+
+    double yshift = GENERATE(-1.1, -1.0, -0.5, -1e-4, 0.5);
+    double a = 4, b = -4, c = 1 + yshift;
+    auto f = [&](const VectorMax3I& x) {
+        VectorMax3I y(2);
+        y(0) = a * x(0) * x(0) + b * x(0) + c;
+        y(1) = x(1) - Interval(0.3);
+        return y;
+    };
+    auto f_batch = [&](const std::vector<VectorMax3I>& xs,
+                       std::vector<VectorMax3I>& ys) {
+        ys.resize(xs.size());
+        for (size_t i = 0; i < xs.size(); i++) {
+            ys[i] = f(xs[i]);
+        }
+    };
+
+    VectorMax3I x0 = Vector2I(Interval(0, 1), Interval(0, 1));
+    VectorMax3d tol = VectorMax3d::Constant(2, 1e-6);
+    const int max_iterations = Constants::INTERVAL_ROOT_FINDER_MAX_ITERATIONS;
+
+    VectorMax3I sol, any_sol, batched_any_sol;
+    int num_iterations = 0, any_num_iterations = 0;
+    bool found_root =
+        interval_root_finder(f, x0, tol, sol, max_iterations, &num_iterations);
+    bool found_any_root = interval_root_finder(
+        f, x0, tol, any_sol, max_iterations, &any_num_iterations,
+        /*find_any_root=*/true);
+    bool found_batched_any_root = interval_root_finder_batched(
+        f_batch, x0, tol, batched_any_sol, max_iterations, nullptr,
+        /*find_any_root=*/true);
+
+    CHECK(found_root == found_any_root);
+    CHECK(found_root == found_batched_any_root);
+    CHECK(any_num_iterations <= num_iterations);
+    if (found_any_root) {
+        // The root is one of the two roots of the quadratic
+        const double d = sqrt(b * b - 4 * a * c);
+        const double root0 = (-b - d) / (2 * a), root1 = (-b + d) / (2 * a);
+        CHECK(any_sol(0).lower() <= root1);
+        CHECK(any_sol(0).upper() >= root0);
+    }
+}
+
+TEST_CASE("Parallel search answers like the sequential one", "[ccd][interval]")
+{
+    using namespace ipc::rigid;
+
+    // A sphere of radius √r2 centered at (t, α, β) = (0.7, 0.3, 0.6)
+    double r2 = GENERATE(1e-2, 1e-4, 0.0, -1e-7);
+    auto f = [&](const VectorMax3I& x) {
+        const Interval t = x(0) - 0.7, a = x(1) - 0.3, b = x(2) - 0.6;
+        return VectorMax3I::Constant(1, t * t + a * a + b * b - r2);
+    };
+
+    VectorMax3I x0 =
+        Vector3I(Interval(0, 1), Interval(0, 1), Interval(0, 1));
+    VectorMax3d tol = VectorMax3d::Constant(3, 1e-6);
+    int max_iterations = GENERATE(
+        Constants::INTERVAL_ROOT_FINDER_PARALLEL_ITERATIONS / 2,
+        Constants::INTERVAL_ROOT_FINDER_MAX_ITERATIONS, 1000000);
+    bool find_any_root = GENERATE(false, true);
+    double radius = std::sqrt(std::max(r2, 0.0));
+
+    VectorMax3I sol, parallel_sol;
+    int num_iterations = -1, parallel_num_iterations = -1;
+    bool found_root = interval_root_finder(
+        f, x0, tol, sol, max_iterations, &num_iterations, find_any_root);
+    bool found_parallel_root;
+    tbb::task_arena arena(4);
+    arena.execute([&] {
+        found_parallel_root = interval_root_finder(
+            f, x0, tol, parallel_sol, max_iterations,
+            &parallel_num_iterations, find_any_root,
+            /*search_in_parallel=*/true);
+    });
+
+    CAPTURE(r2, max_iterations, find_any_root);
+    CHECK(found_parallel_root == found_root);
+    CHECK(parallel_num_iterations <= max_iterations);
+    if (found_parallel_root) {
+        // Any root is in the sphere and the earliest is before its front
+        CHECK(parallel_sol(0).lower() <= 0.7 + radius);
+        if (!find_any_root) {
+            CHECK(parallel_sol(0).lower() <= 0.7 - radius);
+        }
+    }
+    if (num_iterations < max_iterations && !find_any_root) {
+        CHECK(
+            parallel_sol(0).lower()
+            == Approx(sol(0).lower()).margin(tol(0)));
+    }
+}
+
+TEST_CASE("Relative time tolerance", "[ccd][interval]")
+{
+    using namespace ipc::rigid;
+
+    double root = GENERATE(1e-3, 0.1, 0.7);
+    auto f = [&](const VectorMax3I& x) {
+        VectorMax3I y(2);
+        y(0) = x(0) * x(0) - root * root;
+        y(1) = x(1) - 0.3;
+        return y;
+    };
+
+    VectorMax3I x0 = Vector2I(Interval(0, 1), Interval(0, 1));
+    VectorMax3d tol = VectorMax3d::Constant(2, 1e-8);
+    const int max_iterations = Constants::INTERVAL_ROOT_FINDER_MAX_ITERATIONS;
+    double relative_tol = 1e-2;
+
+    VectorMax3I sol, relative_sol;
+    int num_iterations = 0, relative_num_iterations = 0;
+    REQUIRE(
+        interval_root_finder(f, x0, tol, sol, max_iterations, &num_iterations));
+    REQUIRE(interval_root_finder(
+        f, x0, tol, relative_sol, max_iterations, &relative_num_iterations,
+        /*find_any_root=*/false, /*search_in_parallel=*/false, relative_tol));
+
+    CAPTURE(root);
+    // Still conservative, but only resolved to a fraction of the root
+    CHECK(relative_sol(0).lower() <= root);
+    CHECK(relative_sol(0).lower() >= (1 - relative_tol) * root - tol(0));
+    CHECK(relative_num_iterations < num_iterations);
+}
@@ -0,0 +1,114 @@
+#include <catch2/catch.hpp>
+
+#include <cmath>
+
+#include <ghc/fs_std.hpp> // filesystem
+
+#include <io/keyframe_file.hpp>
+
+using namespace ipc::rigid;
+
+TEST_CASE("Smallest three rotation quantization", "[io][keyframe]")
+{
+    for (int i = 0; i < 100; i++) {
+        const Eigen::Quaterniond q = Eigen::Quaterniond::UnitRandom();
+        const Eigen::Quaterniond actual =
+            dequantize_rotation(quantize_rotation(q));
+        CHECK(actual.angularDistance(q) < 1e-5);
+    }
+    const Eigen::Quaterniond identity = Eigen::Quaterniond::Identity();
+    CHECK(
+        dequantize_rotation(quantize_rotation(identity))
+            .angularDistance(identity)
+        < 1e-5);
+}
+
+TEST_CASE("Keyframe compression of pose sequences", "[io][keyframe]")
+{
+    const int dim = GENERATE(2, 3);
+    const size_t num_frames = 301;
+    const double timestep = 0.01;
+
+    // Body 0 rests, body 1 moves linearly, and body 2 spins and falls
+    auto pose_at = [&](size_t body, size_t i) {
+        const double t = i * timestep;
+        PoseD pose = PoseD::Zero(dim);
+        if (body == 1) {
+            pose.position.setConstant(1 + 2 * t);
+        } else if (body == 2) {
+            pose.position(1) = 10 - 4.9 * t * t;
+            pose.rotation.setConstant(dim == 2 ? 3 * t : 1.5 * t);
+        }
+        return pose;
+    };
+    auto read_frame = [&](size_t i, PosesD& poses) {
+        poses.resize(3);
+        for (size_t j = 0; j < 3; j++) {
+            poses[j] = pose_at(j, i);
+        }
+        return i < num_frames;
+    };
+
+    KeyframeSettings settings;
+    settings.frame_rate = GENERATE(-1.0, 20.0);
+    settings.position_tolerance = 1e-3;
+    settings.max_keyframe_interval = num_frames;
+    KeyframeSequence sequence;
+    REQUIRE(sequence.compress(
+        dim, 3, num_frames, timestep, read_frame, settings));
+
+    const size_t stride = settings.frame_rate > 0 ? 5 : 1;
+    CHECK(sequence.num_frames() == (num_frames - 1) / stride + 1);
+    CHECK(sequence.timestep() == Approx(stride * timestep));
+
+    // Only the ends of predictable bodies are kept
+    CHECK(sequence.keyframes(0).size() == 2);
+    CHECK(sequence.keyframes(1).size() == 2);
+    CHECK(sequence.keyframes(2).size() > 2);
+    CHECK(sequence.keyframes(2).size() < sequence.num_frames() / 2);
+
+    // Long gaps are split
+    settings.max_keyframe_interval = 20;
+    KeyframeSequence split;
+    REQUIRE(split.compress(dim, 3, num_frames, timestep, read_frame, settings));
+    CHECK(split.keyframes(0).size() == (sequence.num_frames() + 18) / 20 + 1);
+
+    auto quaternion = [&](const PoseD& pose) -> Eigen::Quaterniond {
+        if (dim == 2) {
+            return Eigen::Quaterniond(
+                Eigen::AngleAxisd(pose.rotation(0), Eigen::Vector3d::UnitZ()));
+        }
+        return pose.construct_quaternion();
+    };
+
+    const double diagonal = 50; // Larger than the bounding box diagonal
+    PosesD poses;
+    for (size_t i = 0; i < sequence.num_frames(); i++) {
+        sequence.frame(i, poses);
+        for (size_t j = 0; j < 3; j++) {
+            const PoseD expected = pose_at(j, i * stride);
+            CHECK(
+                (poses[j].position - expected.position).norm()
+                <= 2 * settings.position_tolerance * diagonal);
+            CHECK(
+                quaternion(poses[j]).angularDistance(quaternion(expected))
+                <= 2 * settings.rotation_tolerance);
+        }
+    }
+
+    // Round trip through a file
+    const fs::path filename =
+        fs::temp_directory_path() / "test_keyframe_file.kf";
+    REQUIRE(sequence.write(filename.string()));
+    KeyframeSequence read;
+    REQUIRE(read.read(filename.string()));
+    CHECK(read.num_frames() == sequence.num_frames());
+    CHECK(read.num_keyframes() == sequence.num_keyframes());
+    PosesD read_poses;
+    read.frame(sequence.num_frames() / 3, read_poses);
+    sequence.frame(sequence.num_frames() / 3, poses);
+    for (size_t j = 0; j < 3; j++) {
+        CHECK(read_poses[j] == poses[j]);
+    }
+    fs::remove(filename);
+}
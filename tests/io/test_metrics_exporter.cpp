@@ -0,0 +1,81 @@
+#include <catch2/catch.hpp>
+
+#include <algorithm>
+#include <string>
+
+#ifndef _WIN32
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+#include <io/metrics_exporter.hpp>
+
+using namespace ipc::rigid;
+
+TEST_CASE("Metrics exporter formats", "[io][metrics]")
+{
+    const nlohmann::json record = {
+        { "step", 3 },
+        { "step_time", 0.5 },
+        { "memory_usage", { { "constraints", 1024 } } },
+        { "histogram", { 2, 1 } },
+        { "exit_reason", "converged" },
+        { "has-intersections", false },
+    };
+    const MetricsExporter::Gauges gauges = MetricsExporter::flatten(record);
+    // Non-numeric values are skipped and names are sanitized
+    CHECK(
+        gauges
+        == MetricsExporter::Gauges({ { "has_intersections", 0 },
+                                     { "histogram_0", 2 },
+                                     { "histogram_1", 1 },
+                                     { "memory_usage_constraints", 1024 },
+                                     { "step", 3 },
+                                     { "step_time", 0.5 } }));
+
+    const std::string text =
+        MetricsExporter::prometheus_text("rigid_ipc", gauges);
+    CHECK(text.find("# TYPE rigid_ipc_step gauge\nrigid_ipc_step 3\n")
+          != std::string::npos);
+    CHECK(text.find("rigid_ipc_step_time 0.5\n") != std::string::npos);
+
+    CHECK(
+        MetricsExporter::statsd_text("sim", { { "step", 3 } })
+        == "sim.step:3|g\n");
+}
+
+#ifndef _WIN32
+TEST_CASE("Metrics exporter pushes to StatsD", "[io][metrics]")
+{
+    // Receive on an ephemeral loopback port
+    const int receiver = socket(AF_INET, SOCK_DGRAM, 0);
+    REQUIRE(receiver >= 0);
+    sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    REQUIRE(
+        bind(receiver, reinterpret_cast<sockaddr*>(&address), sizeof(address))
+        == 0);
+    socklen_t length = sizeof(address);
+    getsockname(receiver, reinterpret_cast<sockaddr*>(&address), &length);
+
+    MetricsExporter exporter;
+    REQUIRE(exporter.open({ { "type", "statsd" },
+                            { "host", "127.0.0.1" },
+                            { "port", ntohs(address.sin_port) },
+                            { "prefix", "rigid_ipc" } }));
+    CHECK(exporter.type() == MetricsExporter::Type::STATSD);
+    exporter.publish({ { "step", 7 } });
+
+    char datagram[256];
+    const ssize_t n = recv(receiver, datagram, sizeof(datagram), 0);
+    CHECK(
+        std::string(datagram, std::max<ssize_t>(n, 0))
+        == "rigid_ipc.step:7|g\n");
+
+    exporter.close();
+    CHECK(!exporter.is_open());
+    close(receiver);
+}
+#endif
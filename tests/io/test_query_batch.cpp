@@ -0,0 +1,53 @@
+#include <catch2/catch.hpp>
+
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+#include <io/query_batch.hpp>
+
+using namespace ipc::rigid;
+
+TEST_CASE("Query batches answer in input order", "[io][query_batch]")
+{
+    const int num_queries = 200;
+    std::stringstream input;
+    for (int i = 0; i < num_queries; i++) {
+        input << "{\"value\": " << i << "}\n";
+        if (i % 10 == 0) {
+            input << "\n"; // Empty lines are skipped
+        }
+    }
+    input << "not json\n";
+    input << "{\"value\": -1}\n";
+
+    std::stringstream output;
+    const size_t num_failed = run_query_batch(
+        input, output,
+        [](const nlohmann::json& query) {
+            const int value = query["value"];
+            if (value < 0) {
+                throw std::invalid_argument("negative value");
+            }
+            nlohmann::json result;
+            result["square"] = value * value;
+            return result;
+        },
+        /*max_queries_in_flight=*/8);
+    CHECK(num_failed == 2);
+
+    std::string line;
+    for (int i = 0; i < num_queries; i++) {
+        REQUIRE(std::getline(output, line));
+        const nlohmann::json result = nlohmann::json::parse(line);
+        CHECK(result["index"] == i);
+        CHECK(result["square"] == i * i);
+    }
+    REQUIRE(std::getline(output, line));
+    CHECK(nlohmann::json::parse(line)["error"] == "invalid query");
+    REQUIRE(std::getline(output, line));
+    const nlohmann::json result = nlohmann::json::parse(line);
+    CHECK(result["index"] == num_queries + 1);
+    CHECK(result["error"] == "negative value");
+    CHECK(!std::getline(output, line));
+}
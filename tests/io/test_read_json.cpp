@@ -0,0 +1,103 @@
+#include <catch2/catch.hpp>
+
+#include <string>
+#include <vector>
+
+#include <io/read_json.hpp>
+#include <io/serialize_json.hpp>
+
+using namespace ipc::rigid;
+
+TEST_CASE("Pack and unpack json matrices", "[io][json]")
+{
+    nlohmann::json matrix = { { 0.5, 1 }, { 2, 3.25 }, { 4, 5 } };
+    REQUIRE(pack_json_matrix(matrix));
+    CHECK(is_packed_json_matrix(matrix));
+
+    Eigen::MatrixXd expected(3, 2);
+    expected << 0.5, 1, 2, 3.25, 4, 5;
+    Eigen::MatrixXd actual;
+    from_json(matrix, actual);
+    CHECK(actual == expected);
+
+    Eigen::MatrixXi faces;
+    nlohmann::json jfaces = { { 0, 1, 2 }, { 2, 1, 3 } };
+    REQUIRE(pack_json_matrix(jfaces));
+    from_json(jfaces, faces);
+    CHECK(faces.rows() == 2);
+    CHECK(faces(1, 2) == 3);
+
+    nlohmann::json vector = { 1.0, 2.0, 3.0 };
+    REQUIRE(pack_json_matrix(vector));
+    Eigen::VectorXd values;
+    from_json(vector, values);
+    CHECK(values == Eigen::Vector3d(1, 2, 3));
+
+    // Not numeric matrices
+    nlohmann::json ragged = { { 1, 2 }, { 3 } };
+    CHECK(!pack_json_matrix(ragged));
+    nlohmann::json empty = nlohmann::json::array();
+    CHECK(!pack_json_matrix(empty));
+    nlohmann::json strings = { "a", "b" };
+    CHECK(!pack_json_matrix(strings));
+
+    nlohmann::json document = { { "matrix", matrix }, { "faces", jfaces } };
+    unpack_json_matrices(document);
+    CHECK(document["matrix"].dump() == "[[0.5,1.0],[2.0,3.25],[4.0,5.0]]");
+    CHECK(document["faces"].dump() == "[[0,1,2],[2,1,3]]");
+}
+
+TEST_CASE("Read json with packed meshes and streamed frames", "[io][json]")
+{
+    const std::string text = R"({
+        "animation": {
+            "state_sequence": [
+                {"rigid_bodies": [{"position": [0, 0], "rotation": [0]}]},
+                {"rigid_bodies": [{"position": [1, 0], "rotation": [0]}]},
+                {"rigid_bodies": [{"position": [2, 0], "rotation": [1]}]}
+            ]
+        },
+        "args": {
+            "rigid_body_problem": {
+                "rigid_bodies": [{
+                    "vertices": [[0, 0], [1, 0], [0, 1]],
+                    "edges": [[0, 1], [1, 2], [2, 0]],
+                    "faces": [],
+                    "position": [0, 0]
+                }]
+            },
+            "vertices": [[0, 0]]
+        }
+    })";
+
+    std::vector<nlohmann::json> frames;
+    nlohmann::json json;
+    REQUIRE(read_json_string(
+        text.data(), text.data() + text.size(), json,
+        "/animation/state_sequence",
+        [&](nlohmann::json&& frame) { frames.push_back(std::move(frame)); }));
+
+    CHECK(json["animation"]["state_sequence"].empty());
+    REQUIRE(frames.size() == 3);
+    CHECK(frames[2]["rigid_bodies"][0]["position"][0] == 2);
+
+    const auto& jrb = json["args"]["rigid_body_problem"]["rigid_bodies"][0];
+    CHECK(is_packed_json_matrix(jrb["vertices"]));
+    CHECK(is_packed_json_matrix(jrb["edges"]));
+    CHECK(jrb["faces"].is_array()); // Empty arrays are not packed
+    CHECK(!is_packed_json_matrix(jrb["position"]));
+    // Only the meshes of rigid bodies are packed
+    CHECK(!is_packed_json_matrix(json["args"]["vertices"]));
+
+    Eigen::MatrixXi edges;
+    from_json(jrb["edges"], edges);
+    CHECK(edges.rows() == 3);
+    CHECK(edges(2, 0) == 2);
+
+    // Without a callback the frames stay in the DOM
+    REQUIRE(read_json_string(text.data(), text.data() + text.size(), json));
+    CHECK(json["animation"]["state_sequence"].size() == 3);
+
+    CHECK(!read_json_string(text.data(), text.data() + 10, json));
+    CHECK(json.is_discarded());
+}
@@ -0,0 +1,61 @@
+#include <catch2/catch.hpp>
+
+#include <cstdio>
+#include <fstream>
+
+#include <io/read_obj.hpp>
+
+using namespace ipc::rigid;
+
+namespace {
+void write_file(const std::string& filename, const std::string& contents)
+{
+    std::ofstream(filename) << contents;
+}
+} // namespace
+
+TEST_CASE("Fast obj parser", "[io][obj]")
+{
+    const std::string filename = "test_read_obj.obj";
+    write_file(
+        filename,
+        "# comment\n"
+        "v 0 0 0\n"
+        "v 1.5 0 0\r\n"
+        "vn 0 0 1\n"
+        "vt 0 1\n"
+        "v 0 2e-1 0\n"
+        "f 1/1/1 2/1/1 3/1/1\n"
+        "v 0 0 -1\n"
+        "f -4 -2 -3\n"
+        "l 1 4\n");
+
+    Eigen::MatrixXd V;
+    Eigen::MatrixXi E, F;
+    REQUIRE(read_obj_fast(filename, V, E, F));
+
+    Eigen::MatrixXd expected_V(4, 3);
+    expected_V << 0, 0, 0, 1.5, 0, 0, 0, 0.2, 0, 0, 0, -1;
+    CHECK(V == expected_V);
+    Eigen::MatrixXi expected_F(2, 3);
+    expected_F << 0, 1, 2, 0, 2, 1;
+    CHECK(F == expected_F);
+    REQUIRE(E.rows() > 0);
+    CHECK(E.row(0) == Eigen::RowVector2i(0, 3));
+
+    // Matches the line-by-line parser
+    std::vector<std::vector<double>> vV;
+    std::vector<std::vector<int>> vF, vL;
+    REQUIRE(read_obj(filename, vV, vF, vL));
+    REQUIRE(vV.size() == V.rows());
+    for (int i = 0; i < V.rows(); i++) {
+        CHECK(Eigen::RowVector3d(vV[i][0], vV[i][1], vV[i][2]) == V.row(i));
+    }
+
+    // Faces of mixed degree are left to the line-by-line parser
+    write_file(filename, "v 0 0 0\nv 1 0 0\nv 0 1 0\nv 1 1 0\n"
+                         "f 1 2 3\nf 1 2 4 3\n");
+    CHECK(!read_obj_fast(filename, V, E, F));
+
+    std::remove(filename.c_str());
+}
@@ -0,0 +1,82 @@
+#include <catch2/catch.hpp>
+
+#include <cstdio>
+#include <fstream>
+
+#include <io/read_rb_scene.hpp>
+#include <io/scene_bundle.hpp>
+
+using namespace ipc::rigid;
+
+TEST_CASE("Scene bundle round trip", "[io][scene_bundle]")
+{
+    const nlohmann::json tet = R"({
+        "vertices": [[0, 0, 0], [1, 0, 0], [0, 1, 0], [0, 0, 1]],
+        "edges": [[0, 1], [1, 2], [2, 0], [0, 3], [1, 3], [2, 3]],
+        "faces": [[0, 2, 1], [0, 1, 3], [1, 2, 3], [0, 3, 2]]
+    })"_json;
+    nlohmann::json scene = { { "rigid_bodies", { tet, tet, tet } } };
+    scene["rigid_bodies"][1]["position"] = { 2.0, 0.0, 0.0 };
+    scene["rigid_bodies"][1]["rotation"] = { 0.0, 0.0, 90.0 };
+    scene["rigid_bodies"][1]["density"] = 500.0;
+    scene["rigid_bodies"][2]["type"] = "kinematic";
+    scene["rigid_bodies"][2]["kinematic_max_time"] = 1.5;
+    scene["rigid_bodies"][2]["kinematic_poses"] = {
+        { { "position", { 0.0, 1.0, 0.0 } },
+          { "rotation", { 0.0, 0.0, 45.0 } } }
+    };
+
+    std::vector<RigidBodySpec> specs;
+    REQUIRE(read_rb_scene_specs(scene, specs));
+    for (RigidBodySpec& spec : specs) {
+        spec.geometry = RigidBodyGeometry::get(
+            spec.vertices, spec.edges, spec.faces,
+            RigidBody::num_rot_dof_fixed(3, spec.is_dof_fixed));
+    }
+
+    const std::string filename = "test_scene_bundle.rbscene";
+    const nlohmann::json args = { { "timestep", 0.01 } };
+    REQUIRE(write_scene_bundle(filename, args, specs));
+
+    nlohmann::json bundle_args;
+    REQUIRE(read_scene_bundle_args(filename, bundle_args));
+    CHECK(bundle_args == args);
+
+    std::vector<RigidBody> expected_rbs, rbs;
+    REQUIRE(read_rb_scene(scene, expected_rbs));
+    REQUIRE(read_rb_scene({ { "scene_bundle", filename } }, rbs));
+    REQUIRE(rbs.size() == expected_rbs.size());
+
+    for (size_t i = 0; i < rbs.size(); i++) {
+        const RigidBody& rb = rbs[i];
+        const RigidBody& expected = expected_rbs[i];
+        CHECK(rb.name == expected.name);
+        CHECK(rb.type == expected.type);
+        CHECK(rb.group_id == expected.group_id);
+        CHECK(rb.mass == Approx(expected.mass));
+        CHECK(rb.moment_of_inertia.isApprox(expected.moment_of_inertia));
+        CHECK(rb.pose.dof().isApprox(expected.pose.dof()));
+        CHECK(rb.world_vertices().isApprox(expected.world_vertices()));
+        CHECK(rb.faces == expected.faces);
+        CHECK(rb.kinematic_max_time == expected.kinematic_max_time);
+        CHECK(rb.kinematic_poses.size() == expected.kinematic_poses.size());
+    }
+    // Bodies with the same mesh share the geometry stored once
+    CHECK(rbs[0].geometry == rbs[1].geometry);
+    CHECK(rbs[0].geometry != expected_rbs[0].geometry);
+
+    std::remove(filename.c_str());
+}
+
+TEST_CASE("Invalid scene bundle", "[io][scene_bundle]")
+{
+    const std::string filename = "test_invalid_scene_bundle.rbscene";
+    {
+        std::ofstream file(filename, std::ios::binary);
+        file << "not a scene bundle";
+    }
+    std::vector<RigidBodySpec> specs;
+    CHECK(!read_scene_bundle(filename, specs));
+    CHECK(!read_scene_bundle("missing_scene_bundle.rbscene", specs));
+    std::remove(filename.c_str());
+}
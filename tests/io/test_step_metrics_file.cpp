@@ -0,0 +1,67 @@
+#include <catch2/catch.hpp>
+
+#include <fstream>
+#include <string>
+
+#include <ghc/fs_std.hpp> // filesystem
+
+#include <io/step_metrics_file.hpp>
+#include <utils/step_metrics.hpp>
+
+using namespace ipc::rigid;
+
+namespace {
+std::string read_file(const fs::path& filename)
+{
+    std::ifstream file(filename.string());
+    return std::string(
+        std::istreambuf_iterator<char>(file),
+        std::istreambuf_iterator<char>());
+}
+} // namespace
+
+TEST_CASE("Step metrics accumulate and reset", "[io][metrics]")
+{
+    StepMetrics::reset();
+    StepMetrics::add_count(StepMetrics::EV_CANDIDATES, 3);
+    StepMetrics::add_count(StepMetrics::EV_CANDIDATES);
+    StepMetrics::add_time(
+        StepMetrics::BROAD_PHASE, std::chrono::milliseconds(5));
+    CHECK(StepMetrics::count(StepMetrics::EV_CANDIDATES) == 4);
+    CHECK(StepMetrics::time(StepMetrics::BROAD_PHASE) == Approx(5e-3));
+
+    nlohmann::json metrics = StepMetrics::to_json();
+    CHECK(metrics["ev_candidates"] == 4);
+    CHECK(metrics["ee_candidates"] == 0);
+
+    StepMetrics::reset();
+    CHECK(StepMetrics::count(StepMetrics::EV_CANDIDATES) == 0);
+    CHECK(StepMetrics::time(StepMetrics::BROAD_PHASE) == 0);
+}
+
+TEST_CASE("Step metrics files", "[io][metrics]")
+{
+    const std::string ext = GENERATE(".jsonl", ".csv");
+    fs::path filename = fs::temp_directory_path()
+        / ("rigid-ipc-test-metrics" + ext);
+
+    StepMetricsWriter writer;
+    REQUIRE(writer.open(filename.string()));
+    CHECK(writer.is_csv() == (ext == ".csv"));
+    CHECK(writer.write({ { "step", 1 }, { "time", 0.5 } }));
+    writer.close();
+
+    // Appending keeps the existing records (and CSV columns)
+    REQUIRE(writer.open(filename.string(), /*append=*/true));
+    CHECK(writer.write({ { "time", 0.25 }, { "step", 2 } }));
+    writer.close();
+
+    if (ext == ".csv") {
+        CHECK(read_file(filename) == "step,time\n1,0.5\n2,0.25\n");
+    } else {
+        CHECK(
+            read_file(filename)
+            == "{\"step\":1,\"time\":0.5}\n{\"step\":2,\"time\":0.25}\n");
+    }
+    fs::remove(filename);
+}
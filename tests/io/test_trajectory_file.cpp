@@ -0,0 +1,61 @@
+#include <catch2/catch.hpp>
+
+#include <cstdio>
+
+#include <io/trajectory_file.hpp>
+
+using namespace ipc::rigid;
+
+TEST_CASE("Binary trajectory round trip", "[io][trajectory]")
+{
+    int dim = GENERATE(2, 3);
+    const int ndof = PoseD::dim_to_ndof(dim);
+    const size_t num_bodies = 3, num_frames = 4;
+    const std::string filename = "test_trajectory_file.traj";
+
+    std::vector<PosesD> poses(num_frames), velocities(num_frames);
+    TrajectoryWriter writer;
+    REQUIRE(writer.open(filename, dim, num_bodies, 0.01));
+    for (size_t i = 0; i < num_frames; i++) {
+        for (size_t j = 0; j < num_bodies; j++) {
+            poses[i].emplace_back(VectorMax6d(VectorMax6d::Random(ndof)));
+            velocities[i].emplace_back(VectorMax6d(VectorMax6d::Random(ndof)));
+        }
+        CHECK(writer.write_frame(poses[i], velocities[i]));
+    }
+    CHECK(writer.num_frames() == num_frames);
+    writer.close();
+
+    TrajectoryReader reader;
+    REQUIRE(reader.open(filename));
+    CHECK(reader.header().dim == dim);
+    CHECK(reader.header().num_bodies == num_bodies);
+    CHECK(reader.header().timestep == 0.01);
+    REQUIRE(reader.num_frames() == num_frames);
+
+    PosesD frame_poses, frame_velocities;
+    for (size_t i = num_frames; i-- > 0;) {
+        REQUIRE(reader.read_frame(i, frame_poses, frame_velocities));
+        for (size_t j = 0; j < num_bodies; j++) {
+            CHECK(frame_poses[j].dof() == poses[i][j].dof());
+            CHECK(frame_velocities[j].dof() == velocities[i][j].dof());
+        }
+    }
+    CHECK(!reader.read_frame(num_frames, frame_poses, frame_velocities));
+    reader.close();
+
+    // Resume after the second frame and overwrite the rest
+    REQUIRE(writer.resume(filename, 2));
+    CHECK(writer.write_frame(poses[0], velocities[0]));
+    writer.close();
+    REQUIRE(reader.open(filename));
+    REQUIRE(reader.num_frames() == 3);
+    REQUIRE(reader.read_frame(2, frame_poses, frame_velocities));
+    CHECK(frame_poses[0].dof() == poses[0][0].dof());
+    REQUIRE(reader.read_frame(1, frame_poses, frame_velocities));
+    CHECK(frame_poses[0].dof() == poses[1][0].dof());
+    CHECK(!writer.resume(filename, 4));
+
+    reader.close();
+    std::remove(filename.c_str());
+}
@@ -0,0 +1,81 @@
+#include <catch2/catch.hpp>
+
+#include <fstream>
+
+#include <ghc/fs_std.hpp> // filesystem
+#include <nlohmann/json.hpp>
+
+#include <io/write_gltf.hpp>
+
+using namespace ipc::rigid;
+
+namespace {
+RigidBody tetrahedron(double size)
+{
+    Eigen::MatrixXd V(4, 3);
+    V << 0, 0, 0, size, 0, 0, 0, size, 0, 0, 0, size;
+    Eigen::MatrixXi F(4, 3);
+    F << 0, 2, 1, 0, 1, 3, 0, 3, 2, 1, 2, 3;
+    Eigen::MatrixXi E(6, 2);
+    E << 0, 1, 1, 2, 2, 0, 0, 3, 1, 3, 2, 3;
+    return RigidBody(
+        V, E, F, PoseD::Zero(3), PoseD::Zero(3), PoseD::Zero(3),
+        /*density=*/1000, VectorMax6b::Zero(6), /*oriented=*/false,
+        /*group_id=*/-1);
+}
+} // namespace
+
+TEST_CASE("Instanced glTF meshes", "[io][gltf]")
+{
+    const RigidBody a = tetrahedron(1);
+    // a's copy shares its geometry, c is identical, and d is different
+    std::vector<RigidBody> rbs = { a, a, tetrahedron(1), tetrahedron(2) };
+    RigidBodyAssembler bodies;
+    bodies.init(rbs);
+
+    GltfSettings settings;
+    std::vector<size_t> mesh_ids, mesh_bodies;
+    gltf_mesh_instances(bodies, settings, mesh_ids, mesh_bodies);
+    CHECK(mesh_ids == std::vector<size_t>({ 0, 0, 0, 1 }));
+    CHECK(mesh_bodies == std::vector<size_t>({ 0, 3 }));
+
+    settings.deduplicate_identical_geometry = false;
+    gltf_mesh_instances(bodies, settings, mesh_ids, mesh_bodies);
+    CHECK(mesh_ids == std::vector<size_t>({ 0, 0, 1, 2 }));
+
+    settings.instance_shared_geometry = false;
+    gltf_mesh_instances(bodies, settings, mesh_ids, mesh_bodies);
+    CHECK(mesh_ids == std::vector<size_t>({ 0, 1, 2, 3 }));
+
+    SECTION("Quantized GLB")
+    {
+        settings = GltfSettings();
+        settings.quantize_vertices = true;
+        const fs::path filename =
+            fs::temp_directory_path() / "test_write_gltf.glb";
+        GltfStreamWriter writer;
+        const PosesD poses = bodies.rb_poses_t1();
+        REQUIRE(writer.open(
+            filename.string(), bodies, poses, /*num_frames=*/2,
+            /*timestep=*/0.1, settings));
+        REQUIRE(writer.write_frame(poses));
+        REQUIRE(writer.write_frame(poses));
+        REQUIRE(writer.close());
+
+        // Read the JSON chunk after the 12 byte header
+        std::ifstream file(filename.string(), std::ios::binary);
+        uint32_t header[5];
+        file.read(reinterpret_cast<char*>(header), sizeof(header));
+        std::string json_chunk(header[3], ' ');
+        file.read(json_chunk.data(), json_chunk.size());
+        const nlohmann::json gltf = nlohmann::json::parse(json_chunk);
+        file.close();
+        fs::remove(filename);
+
+        CHECK(gltf["meshes"].size() == 2);
+        // One animated node and one dequantizing child node per body
+        CHECK(gltf["nodes"].size() == 2 * rbs.size());
+        CHECK(gltf["extensionsRequired"][0] == "KHR_mesh_quantization");
+        CHECK(gltf["accessors"][0]["normalized"] == true);
+    }
+}
@@ -0,0 +1,54 @@
+#include <catch2/catch.hpp>
+
+#include <cstdio>
+
+#include <io/read_obj.hpp>
+#include <io/write_obj.hpp>
+
+using namespace ipc::rigid;
+
+TEST_CASE("Write bodies at given poses", "[io][obj]")
+{
+    Eigen::MatrixXd V(4, 3);
+    V << 0, 0, 0, 1, 0, 0, 0, 1, 0, 0, 0, 1;
+    Eigen::MatrixXi F(4, 3);
+    F << 0, 2, 1, 0, 1, 3, 0, 3, 2, 1, 2, 3;
+    Eigen::MatrixXi E(6, 2);
+    E << 0, 1, 1, 2, 2, 0, 0, 3, 1, 3, 2, 3;
+
+    std::vector<RigidBody> rbs;
+    for (int i = 0; i < 2; i++) {
+        rbs.emplace_back(
+            V, E, F, PoseD::Zero(3), /*velocity=*/PoseD::Zero(3),
+            /*force=*/PoseD::Zero(3), /*density=*/1.0,
+            /*is_dof_fixed=*/VectorMax6b::Zero(6), /*oriented=*/false,
+            /*group_id=*/i);
+    }
+    RigidBodyAssembler bodies;
+    bodies.init(rbs);
+
+    PosesD poses = bodies.rb_poses_t1();
+    poses[1].position += Eigen::Vector3d(2.5, -1, 0.1);
+    poses[1].rotation << 0.1, 0.2, 0.3;
+    const Eigen::MatrixXd expected_V0 = bodies[0].world_vertices(poses[0]);
+    const Eigen::MatrixXd expected_V1 = bodies[1].world_vertices(poses[1]);
+
+    const std::string filename = "test_write_obj.obj";
+    REQUIRE(write_obj(filename, bodies, poses));
+
+    // The bodies are not modified
+    CHECK(bodies[1].pose.position != poses[1].position);
+
+    Eigen::MatrixXd actual_V;
+    Eigen::MatrixXi actual_E, actual_F;
+    REQUIRE(read_obj_fast(filename, actual_V, actual_E, actual_F));
+    REQUIRE(actual_V.rows() == 8);
+    REQUIRE(actual_F.rows() == 8);
+    CHECK(actual_V.topRows(4).isApprox(expected_V0));
+    CHECK(actual_V.bottomRows(4).isApprox(expected_V1));
+    CHECK(actual_F.topRows(4) == bodies[0].faces);
+    CHECK(actual_F.bottomRows(4) == (bodies[1].faces.array() + 4).matrix());
+
+    std::remove(filename.c_str());
+    std::remove(("points-" + filename).c_str());
+}
@@ -0,0 +1,195 @@
+#include <catch2/catch.hpp>
+
+#include <cmath>
+#include <numeric>
+
+#include <igl/edges.h>
+#include <ipc/ipc.hpp>
+
+#include <constants.hpp>
+#include <opt/contact_manifold_reduction.hpp>
+#include <opt/distance_barrier_constraint.hpp>
+#include <utils/stress_scenes.hpp>
+
+using namespace ipc;
+using namespace ipc::rigid;
+
+namespace {
+/// @brief Grid of n × n quads in the plane y = height spanning [-1, 1]².
+RigidBody ground_plate(int n, double height = 0)
+{
+    Eigen::MatrixXd V((n + 1) * (n + 1), 3);
+    Eigen::MatrixXi F(2 * n * n, 3);
+    for (int i = 0; i <= n; i++) {
+        for (int j = 0; j <= n; j++) {
+            V.row(i * (n + 1) + j) << 2.0 * i / n - 1, 0, 2.0 * j / n - 1;
+        }
+    }
+    for (int i = 0; i < n; i++) {
+        for (int j = 0; j < n; j++) {
+            const int v = i * (n + 1) + j;
+            F.row(2 * (i * n + j)) << v, v + 1, v + n + 2;
+            F.row(2 * (i * n + j) + 1) << v, v + n + 2, v + n + 1;
+        }
+    }
+    Eigen::MatrixXi E;
+    igl::edges(F, E);
+    return RigidBody(
+        V, E, F,
+        PoseD(Eigen::Vector3d(0, height, 0), Eigen::Vector3d::Zero()),
+        PoseD::Zero(3), PoseD::Zero(3), /*density=*/1000,
+        VectorMax6b::Ones(6), /*oriented=*/false, /*group_id=*/0,
+        RigidBodyType::STATIC);
+}
+
+/// @brief Half unit box with its bottom face at the given height, tilted
+/// about the z-axis so its contacts are at different distances.
+RigidBody tilted_box(double bottom, double angle)
+{
+    Eigen::MatrixXd V;
+    Eigen::MatrixXi E, F;
+    stress_scenes::box_mesh(Eigen::Vector3d::Constant(0.5), V, E, F);
+    // The lowest corner of the bottom face is 0.5 sin|angle| below the
+    // center of the face
+    const double center = bottom + 0.5 * std::cos(angle)
+        + 0.5 * std::sin(std::abs(angle));
+    return RigidBody(
+        V, E, F,
+        PoseD(
+            Eigen::Vector3d(0.05, center, 0.05), Eigen::Vector3d(0, 0, angle)),
+        PoseD::Zero(3), PoseD::Zero(3), /*density=*/1000,
+        VectorMax6b::Zero(6), /*oriented=*/false, /*group_id=*/1);
+}
+} // namespace
+
+TEST_CASE(
+    "Flat contact manifolds are reduced", "[opt][contact_manifold_reduction]")
+{
+    const double dhat = 1e-3;
+    Eigen::MatrixXd V;
+    Eigen::MatrixXi E, F;
+    stress_scenes::box_mesh(Eigen::Vector3d::Constant(0.5), V, E, F);
+    const RigidBody box(
+        V, E, F, PoseD(Eigen::Vector3d(0.05, 0.5 + dhat / 4, 0.05),
+                       Eigen::Vector3d::Zero()),
+        PoseD::Zero(3), PoseD::Zero(3), /*density=*/1000,
+        VectorMax6b::Zero(6), /*oriented=*/false, /*group_id=*/1);
+
+    RigidBodyAssembler bodies;
+    bodies.init({ ground_plate(10), box });
+    const PosesD poses = bodies.rb_poses_t1();
+
+    DistanceBarrierConstraint constraint;
+    constraint.detection_method = DetectionMethod::BRUTE_FORCE;
+    constraint.initialize();
+    constraint.barrier_activation_distance(dhat);
+
+    Constraints full;
+    constraint.construct_constraint_set(bodies, poses, full);
+    REQUIRE(full.size() > Constants::CONTACT_MANIFOLD_MAX_SIZE);
+
+    const Eigen::MatrixXd world_V = bodies.world_vertices(poses);
+    Constraints reduced = full;
+    const std::vector<double> weights =
+        reduce_contact_manifolds(bodies, world_V, dhat, reduced);
+    REQUIRE(weights.size() == reduced.size());
+    CHECK(reduced.size() < full.size());
+
+    // The weights account for all the constraints of the manifolds
+    CHECK(
+        std::accumulate(weights.begin(), weights.end(), 0.0)
+        == Approx(double(full.size())));
+    for (double weight : weights) {
+        CHECK(weight >= 1);
+    }
+
+    // The closest contact is kept
+    const auto min_distance = [&](const Constraints& constraints) {
+        return ipc::compute_minimum_distance(
+            world_V, bodies.m_edges, bodies.m_faces, constraints);
+    };
+    CHECK(min_distance(reduced) == Approx(min_distance(full)));
+
+    SECTION("Only when enabled")
+    {
+        std::vector<double> constraint_weights;
+        Constraints constraints;
+        constraint.construct_constraint_set(
+            bodies, poses, constraints, &constraint_weights);
+        CHECK(constraints.size() == full.size());
+        CHECK(constraint_weights.empty());
+
+        constraint.contact_manifold_reduction = true;
+        constraint.construct_constraint_set(
+            bodies, poses, constraints, &constraint_weights);
+        CHECK(constraints.size() == reduced.size());
+        CHECK(constraint_weights == weights);
+    }
+}
+
+TEST_CASE(
+    "Frozen contact manifolds keep the barrier continuous",
+    "[opt][contact_manifold_reduction]")
+{
+    // The manifolds are binned by their offset along the normal in bins of
+    // 2d̂. The plate is d̂ / 2 below the boundary at y = 0 and the lowest
+    // corner of the box is η above it, so moving the box down by 2η moves
+    // the contacts of its corner to the bin of the plate.
+    const double dhat = 1e-3, eta = 1e-9, angle = 2e-4;
+    RigidBodyAssembler bodies;
+    bodies.init({ ground_plate(10, -dhat / 2), tilted_box(eta, angle) });
+
+    DistanceBarrierConstraint constraint;
+    constraint.detection_method = DetectionMethod::BRUTE_FORCE;
+    constraint.initialize();
+    constraint.barrier_activation_distance(dhat);
+    constraint.contact_manifold_reduction = true;
+
+    const PosesD poses_a = bodies.rb_poses_t1();
+    PosesD poses_b = poses_a;
+    poses_b[1].position.y() -= 2 * eta;
+
+    const auto barrier = [&](const PosesD& poses) {
+        Constraints constraints;
+        std::vector<double> weights;
+        constraint.construct_constraint_set(
+            bodies, poses, constraints, &weights);
+        REQUIRE(weights.size() == constraints.size());
+        const Eigen::MatrixXd V = bodies.world_vertices(poses);
+        double b = 0;
+        size_t ci = 0;
+        const auto add_potentials = [&](const auto& type_constraints) {
+            for (const auto& c : type_constraints) {
+                b += weights[ci++]
+                    * c.compute_potential(
+                        V, bodies.m_edges, bodies.m_faces, dhat);
+            }
+        };
+        add_potentials(constraints.vv_constraints);
+        add_potentials(constraints.ev_constraints);
+        add_potentials(constraints.ee_constraints);
+        add_potentials(constraints.fv_constraints);
+        return b;
+    };
+
+    // Reduced where they are evaluated, the manifolds change across the
+    // bin boundary
+    const auto reduced_weights = [&](const PosesD& poses) {
+        Constraints constraints;
+        constraint.construct_constraint_set(bodies, poses, constraints);
+        return reduce_contact_manifolds(
+            bodies, bodies.world_vertices(poses), dhat, constraints);
+    };
+    REQUIRE(reduced_weights(poses_a) != reduced_weights(poses_b));
+
+    // Frozen at the first poses, only the distances change
+    REQUIRE(constraint.freeze_contact_manifolds(bodies, poses_a));
+    const double barrier_a = barrier(poses_a);
+    CHECK(barrier_a > 0);
+    CHECK(barrier(poses_b) == Approx(barrier_a).epsilon(1e-4));
+    CHECK(constraint.unfreeze_contact_manifolds());
+    CHECK(!constraint.unfreeze_contact_manifolds());
+
+    // Unfrozen, the weights follow the poses again
+    CHECK(barrier(poses_a) == Approx(barrier_a));
+}
@@ -2,6 +2,7 @@
 
 #include <logger.hpp>
 #include <opt/distance_barrier_constraint.hpp>
+#include <utils/stress_scenes.hpp>
 
 using namespace ipc;
 using namespace ipc::rigid;
@@ -102,3 +103,99 @@ using namespace ipc::rigid;
 //         CHECK(actual_barrier[i] == Approx(expected_barrier[i]));
 //     }
 // }
+
+TEST_CASE(
+    "Per body activation distance",
+    "[opt][DistanceBarrier][DistanceBarrierConstraint]")
+{
+    const auto box = [](double half_extent, const Eigen::Vector3d& position,
+                        int group_id) {
+        Eigen::MatrixXd V;
+        Eigen::MatrixXi E, F;
+        stress_scenes::box_mesh(
+            Eigen::Vector3d::Constant(half_extent), V, E, F);
+        return RigidBody(
+            V, E, F, PoseD(position, Eigen::Vector3d::Zero()),
+            PoseD::Zero(3), PoseD::Zero(3), /*density=*/1000,
+            VectorMax6b::Zero(6), /*oriented=*/false, group_id);
+    };
+
+    // A small box 0.05 above a large one
+    RigidBodyAssembler bodies;
+    bodies.init({ { box(1, Eigen::Vector3d::Zero(), 0),
+                    box(0.05, Eigen::Vector3d(0, 1.1, 0), 1) } });
+    CHECK(bodies.activation_distance_scale(0, 0) == Approx(1));
+    CHECK(bodies.activation_distance_scale(0, 1) == Approx(0.05));
+    CHECK(bodies.min_activation_distance_scale() == Approx(0.05));
+
+    DistanceBarrierConstraint constraint;
+    constraint.detection_method = DetectionMethod::BRUTE_FORCE;
+    constraint.use_candidate_cache = false;
+    constraint.initial_barrier_activation_distance = 0.1;
+    constraint.initialize();
+
+    Constraints constraint_set;
+    constraint.construct_constraint_set(
+        bodies, bodies.rb_poses_t1(), constraint_set);
+    CHECK(constraint_set.size() > 0);
+
+    // The d̂ of the pair (0.005) is smaller than the gap
+    constraint.per_body_activation_distance = true;
+    CHECK(
+        constraint.pair_activation_distance(bodies, 0, 1) == Approx(0.005));
+    constraint.construct_constraint_set(
+        bodies, bodies.rb_poses_t1(), constraint_set);
+    CHECK(constraint_set.size() == 0);
+}
+
+TEST_CASE(
+    "Constraint sets are cached per constraint",
+    "[opt][DistanceBarrier][DistanceBarrierConstraint][cache]")
+{
+    const auto box = [](double half_extent, const Eigen::Vector3d& position,
+                        int group_id) {
+        Eigen::MatrixXd V;
+        Eigen::MatrixXi E, F;
+        stress_scenes::box_mesh(
+            Eigen::Vector3d::Constant(half_extent), V, E, F);
+        return RigidBody(
+            V, E, F, PoseD(position, Eigen::Vector3d::Zero()),
+            PoseD::Zero(3), PoseD::Zero(3), /*density=*/1000,
+            VectorMax6b::Zero(6), /*oriented=*/false, group_id);
+    };
+
+    // A small box 0.05 above a large one
+    RigidBodyAssembler bodies;
+    bodies.init({ { box(1, Eigen::Vector3d::Zero(), 0),
+                    box(0.05, Eigen::Vector3d(0, 1.1, 0), 1) } });
+
+    // Two simulations with the same poses and d̂ built on the same thread
+    const auto init_constraint = [](DistanceBarrierConstraint& constraint,
+                                    double dmin) {
+        constraint.detection_method = DetectionMethod::BRUTE_FORCE;
+        constraint.initial_barrier_activation_distance = 0.01;
+        constraint.minimum_separation_distance = dmin;
+        constraint.initialize();
+    };
+    DistanceBarrierConstraint far_constraint, close_constraint;
+    init_constraint(far_constraint, 0);
+    init_constraint(close_constraint, 0.05);
+
+    Constraints constraint_set;
+    far_constraint.construct_constraint_set(
+        bodies, bodies.rb_poses_t1(), constraint_set);
+    CHECK(constraint_set.size() == 0);
+
+    close_constraint.construct_constraint_set(
+        bodies, bodies.rb_poses_t1(), constraint_set);
+    CHECK(constraint_set.size() > 0);
+
+    // New bodies at the same poses drop the cached constraint set
+    RigidBodyAssembler far_bodies;
+    far_bodies.init({ { box(1, Eigen::Vector3d::Zero(), 0),
+                        box(0.01, Eigen::Vector3d(0, 1.1, 0), 1) } });
+    close_constraint.invalidate_body_caches();
+    close_constraint.construct_constraint_set(
+        far_bodies, bodies.rb_poses_t1(), constraint_set);
+    CHECK(constraint_set.size() == 0);
+}
@@ -0,0 +1,102 @@
+// Test the persistent body AABB tree.
+
+#include <catch2/catch.hpp>
+
+#include <physics/body_aabb_tree.hpp>
+
+#include "../ccd/box_generator.hpp"
+
+using namespace ipc;
+using namespace ipc::rigid;
+using namespace ipc::rigid::unittests;
+
+TEST_CASE("Body AABB tree overlaps", "[physics][broad_phase]")
+{
+    int num_boxes = GENERATE(1, 2, 10, 100);
+    auto can_collide = [](int, int) { return true; };
+
+    std::vector<BodyAABBTree::AABB3> boxes = random_boxes(num_boxes);
+    BodyAABBTree tree;
+    CHECK(
+        tree.update_and_find_overlapping_pairs(boxes, can_collide)
+        == brute_force_overlaps(boxes));
+    CHECK(tree.num_rebuilds() == 1);
+
+    // Move the boxes a little and refit
+    for (auto& box : boxes) {
+        Eigen::Vector3d displacement = 0.1 * Eigen::Vector3d::Random();
+        box[0] += displacement;
+        box[1] += displacement;
+    }
+    CHECK(
+        tree.update_and_find_overlapping_pairs(boxes, can_collide)
+        == brute_force_overlaps(boxes));
+
+    // Scramble the boxes so the refit tree has to be rebuilt
+    boxes = random_boxes(num_boxes);
+    CHECK(
+        tree.update_and_find_overlapping_pairs(boxes, can_collide)
+        == brute_force_overlaps(boxes));
+
+    // Filter out the pairs that cannot collide
+    auto even_odd = [](int i, int j) { return (i + j) % 2 == 1; };
+    std::vector<std::pair<int, int>> expected_pairs;
+    for (const auto& pair : brute_force_overlaps(boxes)) {
+        if (even_odd(pair.first, pair.second)) {
+            expected_pairs.push_back(pair);
+        }
+    }
+    CHECK(tree.find_overlapping_pairs(even_odd) == expected_pairs);
+}
+
+TEST_CASE("Body AABB tree insertion and removal", "[physics][broad_phase]")
+{
+    int num_boxes = GENERATE(0, 1, 10, 100);
+    auto can_collide = [](int, int) { return true; };
+
+    std::vector<BodyAABBTree::AABB3> boxes = random_boxes(num_boxes);
+    BodyAABBTree tree;
+    tree.build(boxes);
+
+    // Spawn bodies one at a time
+    for (const auto& box : random_boxes(20)) {
+        boxes.push_back(box);
+        tree.insert(box);
+        REQUIRE(tree.num_leaves() == boxes.size());
+        CHECK(
+            tree.find_overlapping_pairs(can_collide)
+            == brute_force_overlaps(boxes));
+    }
+
+    // Remove bodies from the front, middle, and back
+    for (int i = 0; i < 15; i++) {
+        const int body_id = (i % 3) * (int(boxes.size()) - 1) / 2;
+        boxes.erase(boxes.begin() + body_id);
+        tree.remove(body_id);
+        REQUIRE(tree.num_leaves() == boxes.size());
+        CHECK(
+            tree.find_overlapping_pairs(can_collide)
+            == brute_force_overlaps(boxes));
+    }
+
+    // The edited tree is refit rather than rebuilt
+    const size_t num_rebuilds = tree.num_rebuilds();
+    for (auto& box : boxes) {
+        Eigen::Vector3d displacement = 0.01 * Eigen::Vector3d::Random();
+        box[0] += displacement;
+        box[1] += displacement;
+    }
+    CHECK(
+        tree.update_and_find_overlapping_pairs(boxes, can_collide)
+        == brute_force_overlaps(boxes));
+    CHECK(tree.num_rebuilds() <= num_rebuilds + 1);
+
+    // Remove every body
+    while (!boxes.empty()) {
+        boxes.pop_back();
+        tree.remove(int(boxes.size()));
+    }
+    CHECK(tree.num_leaves() == 0);
+    tree.insert(random_boxes(1)[0]);
+    CHECK(tree.find_overlapping_pairs(can_collide).empty());
+}
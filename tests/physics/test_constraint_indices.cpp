@@ -0,0 +1,109 @@
+#include <type_traits>
+
+#include <catch2/catch.hpp>
+
+#include <ipc/ipc.hpp>
+
+#include <physics/rigid_body_assembler.hpp>
+#include <problems/rigid_body_collision_constraint.hpp>
+#include <utils/stress_scenes.hpp>
+
+using namespace ipc;
+using namespace ipc::rigid;
+
+static RigidBody box(const Eigen::Vector3d& position, int group_id)
+{
+    Eigen::MatrixXd V;
+    Eigen::MatrixXi E, F;
+    stress_scenes::box_mesh(Eigen::Vector3d::Constant(0.5), V, E, F);
+    return RigidBody(
+        V, E, F, PoseD(position, Eigen::Vector3d::Zero()), PoseD::Zero(3),
+        PoseD::Zero(3), /*density=*/1000, VectorMax6b::Zero(6),
+        /*oriented=*/false, group_id);
+}
+
+TEST_CASE(
+    "Constraint indices match the constraints' vertices and bodies",
+    "[physics][constraint_indices]")
+{
+    RigidBodyAssembler bodies;
+    bodies.init({ box(Eigen::Vector3d::Zero(), 0),
+                  box(Eigen::Vector3d(0, 1 + 1e-3, 0), 1) });
+    const long num_vertices0 = bodies[0].vertices.rows();
+    const long num_edges0 = bodies[0].edges.rows();
+    const long num_faces0 = bodies[0].faces.rows();
+
+    // Every constraint is between box 1 (the vertex or the first edge) and
+    // box 0
+    Constraints constraints;
+    constraints.vv_constraints.emplace_back(num_vertices0 + 1, 2);
+    constraints.ev_constraints.emplace_back(3, num_vertices0);
+    constraints.ee_constraints.emplace_back(num_edges0 + 2, 1, /*eps_x=*/1);
+    constraints.fv_constraints.emplace_back(num_faces0 - 1, num_vertices0);
+
+    std::vector<ConstraintIndices> indices;
+    build_constraint_indices(bodies, constraints, indices);
+    REQUIRE(indices.size() == constraints.size());
+
+    const Eigen::MatrixXi& E = bodies.m_edges;
+    const Eigen::MatrixXi& F = bodies.m_faces;
+    const std::vector<std::vector<long>> expected_vertex_ids = {
+        { num_vertices0 + 1, 2 },
+        { num_vertices0, E(3, 0), E(3, 1) },
+        { E(num_edges0 + 2, 0), E(num_edges0 + 2, 1), E(1, 0), E(1, 1) },
+        { num_vertices0, F(num_faces0 - 1, 0), F(num_faces0 - 1, 1),
+          F(num_faces0 - 1, 2) },
+    };
+    for (size_t ci = 0; ci < constraints.size(); ci++) {
+        const std::vector<long>& vertex_ids = expected_vertex_ids[ci];
+        const std::vector<uint8_t>& local_body_ids =
+            vertex_local_body_ids(constraints, ci);
+
+        REQUIRE(indices[ci].num_vertices == vertex_ids.size());
+        for (size_t i = 0; i < vertex_ids.size(); i++) {
+            CHECK(indices[ci].vertex_ids[i] == vertex_ids[i]);
+            CHECK(indices[ci].local_body_ids[i] == local_body_ids[i]);
+            // The local body id selects the body of the vertex
+            CHECK(
+                bodies.m_vertex_to_body_map(vertex_ids[i])
+                == indices[ci].body_ids[local_body_ids[i]]);
+        }
+        CHECK(indices[ci].body_ids == body_ids(bodies, constraints, ci));
+        CHECK(indices[ci].body_ids[0] == 1);
+        CHECK(indices[ci].body_ids[1] == 0);
+    }
+}
+
+TEST_CASE(
+    "Typed ranges cover the constraints in order",
+    "[physics][constraint_indices]")
+{
+    Constraints constraints;
+    constraints.vv_constraints.emplace_back(0, 1);
+    constraints.vv_constraints.emplace_back(0, 2);
+    constraints.ee_constraints.emplace_back(0, 1, /*eps_x=*/1);
+    constraints.fv_constraints.emplace_back(0, 3);
+    constraints.fv_constraints.emplace_back(1, 3);
+
+    for (size_t begin = 0; begin <= constraints.size(); begin++) {
+        for (size_t end = begin; end <= constraints.size(); end++) {
+            size_t next = begin;
+            for_each_typed_range(
+                constraints, begin, end,
+                [&](const auto& typed_constraints, size_t offset,
+                    size_t typed_begin, size_t typed_end) {
+                    typedef typename std::decay_t<
+                        decltype(typed_constraints)>::value_type Constraint;
+                    CHECK(offset + typed_begin == next);
+                    CHECK(typed_begin < typed_end);
+                    CHECK(typed_end <= typed_constraints.size());
+                    // Each type is visited with its own number of vertices
+                    CHECK(
+                        ConstraintNumVertices<Constraint>::value
+                        == vertex_local_body_ids(constraints, next).size());
+                    next = offset + typed_end;
+                });
+            CHECK(next == end);
+        }
+    }
+}
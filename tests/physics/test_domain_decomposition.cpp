@@ -0,0 +1,56 @@
+#include <catch2/catch.hpp>
+
+#include <physics/domain_decomposition.hpp>
+
+using namespace ipc;
+using namespace ipc::rigid;
+
+TEST_CASE("Domain decomposition", "[physics][domain_decomposition]")
+{
+    // A row of unit squares one unit apart
+    Eigen::MatrixXd vertices(4, 2);
+    vertices << -0.5, -0.5, 0.5, -0.5, 0.5, 0.5, -0.5, 0.5;
+    Eigen::MatrixXi edges(4, 2);
+    edges << 0, 1, 1, 2, 2, 3, 3, 0;
+
+    const int num_bodies = 8;
+    std::vector<RigidBody> rbs;
+    for (int i = 0; i < num_bodies; i++) {
+        PoseD pose = PoseD::Zero(2);
+        pose.position.x() = 2 * i;
+        rbs.emplace_back(
+            vertices, edges, pose, /*velocity=*/PoseD::Zero(2),
+            /*force=*/PoseD::Zero(2), /*density=*/1,
+            /*is_dof_fixed=*/VectorXb::Zero(PoseD::dim_to_ndof(2)),
+            /*oriented=*/false, /*group_id=*/i);
+    }
+    RigidBodyAssembler bodies;
+    bodies.init(rbs);
+
+    DomainDecomposition decomposition;
+    decomposition.partition(
+        bodies, bodies.rb_poses(), /*num_ranks=*/2, /*ghost_distance=*/1.5);
+    REQUIRE(decomposition.num_ranks() == 2);
+
+    // Equal halves of the row
+    CHECK(
+        decomposition.owned_bodies(0) == std::vector<int>({ 0, 1, 2, 3 }));
+    CHECK(
+        decomposition.owned_bodies(1) == std::vector<int>({ 4, 5, 6, 7 }));
+
+    // Only the bodies next to the cut are ghosts
+    CHECK(decomposition.ghost_bodies(0) == std::vector<int>({ 4 }));
+    CHECK(decomposition.ghost_bodies(1) == std::vector<int>({ 3 }));
+
+    const nlohmann::json stats = decomposition.statistics(bodies);
+    CHECK(stats["vertex_imbalance"].get<double>() == Approx(1));
+    CHECK(stats["ghost_fraction"].get<double>() == Approx(0.25));
+
+    // Bodies farther apart than the ghost distance are never ghosts
+    decomposition.partition(
+        bodies, bodies.rb_poses(), /*num_ranks=*/4, /*ghost_distance=*/0.5);
+    for (int rank = 0; rank < 4; rank++) {
+        CHECK(decomposition.owned_bodies(rank).size() == 2);
+        CHECK(decomposition.ghost_bodies(rank).empty());
+    }
+}
@@ -0,0 +1,109 @@
+#include <catch2/catch.hpp>
+
+#include <ghc/fs_std.hpp> // filesystem
+
+#include <physics/kinematic_source.hpp>
+#include <physics/rigid_body.hpp>
+
+using namespace ipc;
+using namespace ipc::rigid;
+
+TEST_CASE("Spline kinematic source", "[physics][kinematic_source]")
+{
+    const std::vector<double> times = { 0.5, 1.0, 2.0 };
+    const PosesD poses = { PoseD(0, 0, 0), PoseD(1, 2, 0.5),
+                           PoseD(3, 2, 1) };
+    SplineKinematicSource source(times, poses);
+
+    PoseD pose;
+    // The spline passes through the keys
+    for (size_t i = 0; i < times.size(); i++) {
+        REQUIRE(source.pose(times[i], pose));
+        CHECK((pose.dof() - poses[i].dof()).norm() == Approx(0).margin(1e-12));
+    }
+    // Before the first key the pose is held
+    REQUIRE(source.pose(0.1, pose));
+    CHECK(pose == poses[0]);
+    // The pose is continuous at the keys
+    PoseD before, after;
+    REQUIRE(source.pose(1 - 1e-8, before));
+    REQUIRE(source.pose(1 + 1e-8, after));
+    CHECK((before.dof() - after.dof()).norm() == Approx(0).margin(1e-6));
+    // The motion ends at the last key
+    CHECK(!source.pose(2.1, pose));
+}
+
+TEST_CASE("Binary kinematic source", "[physics][kinematic_source]")
+{
+    const double period = 0.01;
+    PosesD poses;
+    for (int i = 0; i < 100; i++) {
+        poses.emplace_back(i, -i, 0.1 * i);
+    }
+    const fs::path filename =
+        fs::temp_directory_path() / "test_kinematic_source.bin";
+    REQUIRE(BinaryKinematicSource::write(filename.string(), poses));
+
+    {
+        BinaryKinematicSource source(filename.string(), 2, period);
+        REQUIRE(source.is_open());
+        CHECK(source.num_samples() == poses.size());
+
+        // Sample i is the pose at the end of step i
+        PoseD pose;
+        REQUIRE(source.pose(10 * period, pose));
+        CHECK(pose.position.x() == Approx(9));
+        // Linear interpolation between samples
+        REQUIRE(source.pose(10.5 * period, pose));
+        CHECK(pose.position.x() == Approx(9.5));
+        CHECK(pose.rotation.x() == Approx(0.95));
+        // Accumulated time-steps may overshoot the last sample slightly
+        double t = 0;
+        for (int i = 0; i < 100; i++) {
+            t += period;
+        }
+        REQUIRE(source.pose(t, pose));
+        CHECK(pose == poses.back());
+        CHECK(!source.pose(t + period, pose));
+    }
+    fs::remove(filename);
+
+    // Missing files are invalid sources
+    CHECK(
+        KinematicSource::from_json(
+            { { "type", "binary" }, { "path", filename.string() },
+              { "period", period } },
+            2)
+        == nullptr);
+}
+
+TEST_CASE("Kinematic poses of a body", "[physics][kinematic_source]")
+{
+    Eigen::MatrixXd vertices(3, 2);
+    vertices << 0, 0, 1, 0, 0, 1;
+    Eigen::MatrixXi edges(3, 2);
+    edges << 0, 1, 1, 2, 2, 0;
+    RigidBody rb(
+        vertices, edges, PoseD::Zero(2), PoseD::Zero(2), PoseD::Zero(2),
+        /*density=*/1.0, VectorMax6b::Zero(3), /*oriented=*/false,
+        /*group_id=*/0, RigidBodyType::KINEMATIC);
+    rb.kinematic_poses.push_back(PoseD(-1, 0, 0));
+    rb.kinematic_source = std::make_shared<CallbackKinematicSource>(
+        [](double t, PoseD& pose) {
+            pose = PoseD(t, 0, 0);
+            return t < 1;
+        });
+
+    const double h = 0.25;
+    PoseD pose;
+    // The queued poses come first
+    REQUIRE(rb.next_kinematic_pose(h, pose));
+    CHECK(pose.position.x() == -1);
+    rb.pop_kinematic_pose(h);
+    // Then the source is queried at the end of the step
+    REQUIRE(rb.next_kinematic_pose(h, pose));
+    CHECK(pose.position.x() == Approx(2 * h));
+    rb.pop_kinematic_pose(h);
+    rb.pop_kinematic_pose(h);
+    CHECK(!rb.next_kinematic_pose(h, pose));
+}
@@ -7,6 +7,7 @@
 #include <autodiff/autodiff_types.hpp>
 #include <interval/interval.hpp>
 #include <physics/pose.hpp>
+#include <physics/rotation_diff.hpp>
 
 TEST_CASE("Poses to dofs", "[physics][pose]")
 {
@@ -20,6 +21,28 @@ TEST_CASE("Poses to dofs", "[physics][pose]")
     CHECK((dofs - returned_dofs).squaredNorm() == Approx(0));
 }
 
+TEST_CASE("Poses view the dofs", "[physics][pose]")
+{
+    using namespace ipc::rigid;
+    int dim = GENERATE(2, 3);
+    int num_bodies = GENERATE(0, 1, 2, 3, 10, 1000);
+    Eigen::VectorXd dofs =
+        Eigen::VectorXd::Random(num_bodies * Pose<double>::dim_to_ndof(dim));
+    Poses<double> poses = Pose<double>::dofs_to_poses(dofs, dim);
+    PosesView<double> view(dofs, dim);
+    REQUIRE(view.size() == poses.size());
+    for (size_t i = 0; i < poses.size(); i++) {
+        CHECK(view.position(i) == poses[i].position);
+        CHECK(view.rotation(i) == poses[i].rotation);
+        CHECK(view[i] == poses[i]);
+    }
+
+    // Reusing the storage of other poses gives the same poses
+    Poses<double> reused(3, Pose<double>::Zero(5 - dim));
+    Pose<double>::dofs_to_poses(dofs, dim, reused);
+    CHECK(reused == poses);
+}
+
 TEST_CASE("Cast poses", "[physics][pose]")
 {
     using namespace ipc::rigid;
@@ -120,3 +143,66 @@ TEST_CASE("Interval SE(3) ↦ SO(3)", "[!benchmark][physics][pose]")
         Matrix3I R = pI.construct_rotation_matrix();
     };
 }
+
+TEST_CASE("Interval SE(3) ↦ SO(3) enclosure", "[physics][pose][interval]")
+{
+    using namespace ipc::rigid;
+    double radius = GENERATE(1e-3, 0.5, 2.0, 10.0);
+    Eigen::Vector3d center = Eigen::Vector3d::Random();
+
+    VectorMax3<Interval> rI(3);
+    for (int i = 0; i < 3; i++) {
+        rI(i) = Interval(center(i) - radius, center(i) + radius);
+    }
+    MatrixMax3<Interval> RI = construct_rotation_matrix(rI);
+
+    CAPTURE(radius);
+    for (int k = 0; k < 100; k++) {
+        VectorMax3d r = center + radius * Eigen::Vector3d::Random();
+        MatrixMax3d R = construct_rotation_matrix(r);
+        for (int i = 0; i < 3; i++) {
+            for (int j = 0; j < 3; j++) {
+                CHECK(in(R(i, j), RI(i, j)));
+                // Entries of a rotation are bounded by one
+                CHECK(subset(RI(i, j), Interval(-1, 1)));
+            }
+        }
+    }
+}
+
+TEST_CASE("Closed-form ∇²(SE(3) ↦ SO(3))", "[physics][pose]")
+{
+    using namespace ipc::rigid;
+    typedef AutodiffType<Eigen::Dynamic, /*maxN=*/3> Diff;
+
+    int dim = GENERATE(2, 3);
+    double scale = GENERATE(0.0, 1e-8, 1e-2, 1.0, 3.0);
+    const int rot_ndof = Pose<double>::dim_to_rot_ndof(dim);
+    VectorMax3d r = scale * VectorMax3d::Random(rot_ndof);
+
+    Diff::activate(rot_ndof);
+    MatrixMax3<Diff::DDouble2> R_diff =
+        construct_rotation_matrix(VectorMax3<Diff::DDouble2>(
+            Diff::d2vars(0, r)));
+
+    RotationGradient grad_R;
+    RotationHessian hess_R;
+    MatrixMax3d R = construct_rotation_matrix_diff(r, grad_R, &hess_R);
+
+    for (int i = 0; i < dim; i++) {
+        for (int j = 0; j < dim; j++) {
+            CHECK(R(i, j) == Approx(R_diff(i, j).getValue()).margin(1e-12));
+            for (int k = 0; k < rot_ndof; k++) {
+                CHECK(
+                    grad_R[k](i, j)
+                    == Approx(R_diff(i, j).getGradient()(k)).margin(1e-12));
+                for (int l = 0; l < rot_ndof; l++) {
+                    CHECK(
+                        hess_R[k * rot_ndof + l](i, j)
+                        == Approx(R_diff(i, j).getHessian()(k, l))
+                               .margin(1e-12));
+                }
+            }
+        }
+    }
+}
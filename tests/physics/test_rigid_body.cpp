@@ -72,4 +72,79 @@ TEST_CASE("2D Rigid Body Transform", "[RB][RB-transform]")
     CHECK((expected - actual).squaredNorm() < 1E-6);
 }
 
+TEST_CASE("Rigid bodies share identical geometry", "[RB][RB-geometry]")
+{
+    Eigen::MatrixXd vertices(4, 2);
+    vertices << -0.5, -0.5, 0.5, -0.5, 0.5, 0.5, -0.5, 0.5;
+    Eigen::MatrixXi edges(4, 2);
+    edges << 0, 1, 1, 2, 2, 3, 3, 0;
+    Pose<double> velocity = Pose<double>::Zero(vertices.cols());
+
+    auto rb0 = simple(vertices, edges, velocity);
+    auto rb1 = simple(vertices, edges, velocity);
+    CHECK(rb0.geometry == rb1.geometry);
+
+    Eigen::MatrixXd scaled_vertices = 2 * vertices;
+    auto rb2 = simple(scaled_vertices, edges, velocity);
+    CHECK(rb0.geometry != rb2.geometry);
+    CHECK(rb2.mass == Approx(4 * rb0.mass));
+}
+
 // TODO: Add 3D RB test
+
+TEST_CASE("Rigid body sleeps and wakes up", "[RB][RB-sleep]")
+{
+    Eigen::MatrixXd vertices(4, 2);
+    vertices << -0.5, -0.5, 0.5, -0.5, 0.5, 0.5, -0.5, 0.5;
+    Eigen::MatrixXi edges(4, 2);
+    edges << 0, 1, 1, 2, 2, 3, 3, 0;
+    Pose<double> velocity = Pose<double>::Zero(2);
+    velocity.position << 1e-4, 0;
+
+    RigidBody rb = simple(vertices, edges, velocity);
+    rb.is_dof_fixed[2] = true;
+    const VectorMax6b is_dof_fixed = rb.is_dof_fixed;
+
+    rb.sleep();
+    CHECK(rb.is_sleeping);
+    CHECK(rb.type == RigidBodyType::STATIC);
+    CHECK(rb.is_dof_fixed.array().all());
+    CHECK(rb.velocity.position.norm() == 0);
+
+    rb.num_resting_steps = 10;
+    rb.wake_up();
+    CHECK(!rb.is_sleeping);
+    CHECK(rb.type == RigidBodyType::DYNAMIC);
+    CHECK(rb.is_dof_fixed == is_dof_fixed);
+    CHECK(rb.num_resting_steps == 0);
+}
+
+TEST_CASE("Rigid body freezes for a multi-rate stage", "[RB][RB-multirate]")
+{
+    Eigen::MatrixXd vertices(4, 2);
+    vertices << -0.5, -0.5, 0.5, -0.5, 0.5, 0.5, -0.5, 0.5;
+    Eigen::MatrixXi edges(4, 2);
+    edges << 0, 1, 1, 2, 2, 3, 3, 0;
+    Pose<double> velocity = Pose<double>::Zero(2);
+    velocity.position << 3, 0;
+    velocity.rotation << 2;
+
+    RigidBody rb = simple(vertices, edges, velocity);
+    // |v| + |ω| r_max
+    CHECK(rb.step_displacement(0.1) == Approx(0.1 * (3 + 2 * rb.r_max)));
+
+    rb.is_dof_fixed[2] = true;
+    const VectorMax6b is_dof_fixed = rb.is_dof_fixed;
+    rb.freeze();
+    CHECK(rb.is_frozen);
+    CHECK(rb.type == RigidBodyType::STATIC);
+    CHECK(rb.is_dof_fixed.array().all());
+    CHECK(rb.step_displacement(0.1) == 0);
+
+    rb.thaw();
+    CHECK(!rb.is_frozen);
+    CHECK(rb.type == RigidBodyType::DYNAMIC);
+    CHECK(rb.is_dof_fixed == is_dof_fixed);
+    CHECK(rb.velocity.position.x() == 3);
+    CHECK(rb.velocity.rotation.x() == 2);
+}
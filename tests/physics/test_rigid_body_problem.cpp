@@ -6,9 +6,13 @@
 #include <finitediff.hpp>
 #include <igl/PI.h>
 
+#include <SimState.hpp>
+#include <opt/distance_barrier_constraint.hpp>
 #include <physics/mass.hpp>
+#include <problems/distance_barrier_rb_problem.hpp>
 #include <problems/split_distance_barrier_rb_problem.hpp>
 #include <utils/not_implemented_error.hpp>
+#include <utils/stress_scenes.hpp>
 
 using namespace ipc;
 using namespace ipc::rigid;
@@ -203,6 +207,63 @@ TEST_CASE("Rigid Body Problem Hessian", "[RB][RB-Problem][RB-Problem-hessian]")
     CHECK(fd::compare_jacobian(hess_fx.toDense(), hess_fx_approx));
 }
 
+TEST_CASE(
+    "3D Rigid Body Problem energy derivatives",
+    "[RB][RB-Problem][RB-Problem-gradient][RB-Problem-hessian]")
+{
+    // A box with distinct moments of inertia
+    Eigen::MatrixXd V;
+    Eigen::MatrixXi E, F;
+    stress_scenes::box_mesh(Eigen::Vector3d(0.5, 1, 2), V, E, F);
+
+    PoseD pose_t0(Eigen::Vector3d(0.1, 0.2, 0.3), Eigen::Vector3d::Zero());
+    PoseD velocity = PoseD::Zero(3), force = PoseD::Zero(3);
+
+    SECTION("Rotation") { pose_t0.rotation << 0.1, 0.2, -0.3; }
+    SECTION("Angular velocity")
+    {
+        pose_t0.rotation << 0.1, 0.2, -0.3;
+        velocity.rotation << 0.5, -1, 2;
+    }
+    SECTION("Torque")
+    {
+        pose_t0.rotation << 0.1, 0.2, -0.3;
+        force.rotation << -3, 1, 2;
+    }
+    SECTION("Everything")
+    {
+        pose_t0.rotation << 0.1, 0.2, -0.3;
+        velocity.position << 1, -2, 0.5;
+        velocity.rotation << 0.5, -1, 2;
+        force.position << 0, -9.8, 0;
+        force.rotation << -3, 1, 2;
+    }
+
+    std::vector<RigidBody> rbs = { RigidBody(
+        V, E, F, pose_t0, velocity, force, /*density=*/1,
+        /*is_dof_fixed=*/VectorMax6b::Zero(6), /*oriented=*/false,
+        /*group_id=*/0) };
+
+    DistanceBarrierRBProblem rbp;
+    rbp.init(rbs);
+
+    // A pose away from the one at the start of the step
+    PoseD pose = rbs[0].pose;
+    pose.position += Eigen::Vector3d(0.3, -0.1, 0.2);
+    pose.rotation += Eigen::Vector3d(-0.4, 0.3, 0.6);
+    Eigen::VectorXd x = rbp.poses_to_dofs<double>({ pose });
+
+    Eigen::VectorXd grad_fx;
+    Eigen::SparseMatrix<double> hess_fx;
+    rbp.compute_energy_term(x, grad_fx, hess_fx);
+
+    Eigen::VectorXd grad_fx_approx = eval_grad_energy_approx(rbp, x);
+    CHECK(fd::compare_gradient(grad_fx, grad_fx_approx));
+
+    Eigen::MatrixXd hess_fx_approx = eval_hess_energy_approx(rbp, x);
+    CHECK(fd::compare_jacobian(hess_fx.toDense(), hess_fx_approx));
+}
+
 TEST_CASE("dof -> poses -> dof", "[RB][RB-Problem]")
 {
     Eigen::MatrixXd vertices(4, 2);
@@ -252,4 +313,404 @@ TEST_CASE("dof -> poses -> dof", "[RB][RB-Problem]")
     }
 }
 
+TEST_CASE("Binary state round trip", "[RB][RB-Problem][state]")
+{
+    Eigen::MatrixXd vertices(4, 2);
+    Eigen::MatrixXi edges(4, 2);
+    vertices << -0.5, -0.5, 0.5, -0.5, 0.5, 0.5, -0.5, 0.5;
+    edges << 0, 1, 1, 2, 2, 3, 3, 0;
+
+    Pose<double> pose_1 = Pose<double>::Zero(2), pose_2 = Pose<double>::Zero(2);
+    pose_1.position << 0.5, 0.25;
+    pose_2.position << 3.0, 1.0;
+    pose_2.rotation << 0.5 * igl::PI;
+    std::vector<RigidBody> rbs = {
+        { rb_from_displacements(vertices, edges, pose_1),
+          rb_from_displacements(vertices, edges, pose_2) }
+    };
+    rbs[1].velocity.position << -1.0, 2.0;
+
+    SplitDistanceBarrierRBProblem rbp;
+    rbp.init(rbs);
+
+    std::vector<double> buffer;
+    rbp.state_into(buffer);
+    const nlohmann::json expected = rbp.state_to_json(buffer);
+    CHECK(expected == rbp.state());
+    CHECK(expected["rigid_bodies"].size() == 2);
+    CHECK(expected["kinetic_energy"].get<double>() > 0);
+
+    // Setting the state from the buffer restores the bodies
+    const std::vector<double> saved = buffer;
+    rbp.m_assembler[0].pose.position.setZero();
+    rbp.m_assembler[1].velocity.position.setZero();
+    CHECK(rbp.state() != expected);
+    rbp.state_from(saved);
+    CHECK(rbp.state() == expected);
+
+    // The buffer is reused
+    const double* data = buffer.data();
+    rbp.state_into(buffer);
+    CHECK(buffer.data() == data);
+    CHECK(buffer == saved);
+}
+
+TEST_CASE("Filtered binary states", "[RB][RB-Problem][state]")
+{
+    Eigen::MatrixXd vertices(4, 2);
+    Eigen::MatrixXi edges(4, 2);
+    vertices << -0.5, -0.5, 0.5, -0.5, 0.5, 0.5, -0.5, 0.5;
+    edges << 0, 1, 1, 2, 2, 3, 3, 0;
+
+    Pose<double> pose_1 = Pose<double>::Zero(2), pose_2 = Pose<double>::Zero(2);
+    pose_1.position << 0.5, 0.25;
+    pose_2.position << 3.0, 1.0;
+    std::vector<RigidBody> rbs = {
+        { rb_from_displacements(vertices, edges, pose_1),
+          rb_from_displacements(vertices, edges, pose_2) }
+    };
+    rbs[1].group_id = 1;
+
+    SplitDistanceBarrierRBProblem rbp;
+    rbp.init(rbs);
+
+    nlohmann::json settings = R"({
+        "bodies": [],
+        "group_ids": [],
+        "region": null,
+        "fields": ["position"]
+    })"_json;
+    SECTION("Group id")
+    {
+        settings["group_ids"] = { 1 };
+    }
+    SECTION("Region")
+    {
+        settings["region"] = { { "min", { 2.0, 0.0 } },
+                               { "max", { 4.0, 2.0 } } };
+    }
+    REQUIRE(rbp.m_state_output.settings(settings, rbs));
+    CHECK(rbp.m_state_output.is_enabled());
+
+    std::vector<double> buffer;
+    rbp.state_into(buffer);
+    const nlohmann::json json = rbp.state_to_json(buffer);
+    REQUIRE(json["rigid_bodies"].size() == 1);
+    const nlohmann::json& jrb = json["rigid_bodies"][0];
+    CHECK(jrb["id"] == 1);
+    CHECK(jrb.contains("position"));
+    CHECK(!jrb.contains("rotation"));
+    CHECK(!jrb.contains("linear_velocity"));
+
+    // The full state is still available (e.g., for restarts)
+    CHECK(rbp.state()["rigid_bodies"].size() == 2);
+
+    // Only the recorded body and fields are restored
+    rbp.m_assembler[0].pose.position.setZero();
+    rbp.m_assembler[1].pose.position.setZero();
+    rbp.state_from(buffer);
+    CHECK(rbp.m_assembler[0].pose.position.isZero());
+    CHECK(rbp.m_assembler[1].pose.position == pose_2.position);
+
+    // The same partial state is read back from JSON
+    rbp.m_assembler[1].pose.position.setZero();
+    rbp.state(json);
+    CHECK(rbp.m_assembler[1].pose.position == pose_2.position);
+
+    settings["fields"] = { "velocity" };
+    CHECK(!rbp.m_state_output.settings(settings, rbs));
+}
+
+/// @brief Expose the recording of the contact forces.
+class ContactForcesProblem : public SplitDistanceBarrierRBProblem {
+public:
+    using DistanceBarrierRBProblem::record_contact_forces;
+    using DistanceBarrierRBProblem::update_contact_forces;
+};
+
+TEST_CASE("Recorded contact forces", "[RB][RB-Problem][state]")
+{
+    Eigen::MatrixXd vertices(4, 2);
+    Eigen::MatrixXi edges(4, 2);
+    vertices << -0.5, -0.5, 0.5, -0.5, 0.5, 0.5, -0.5, 0.5;
+    edges << 0, 1, 1, 2, 2, 3, 3, 0;
+
+    // The second square rests just above the first one
+    Pose<double> pose_1 = Pose<double>::Zero(2), pose_2 = Pose<double>::Zero(2);
+    pose_2.position << 0.25, 1 + 2e-4;
+    std::vector<RigidBody> rbs = {
+        { rb_from_displacements(vertices, edges, pose_1),
+          rb_from_displacements(vertices, edges, pose_2) }
+    };
+
+    ContactForcesProblem rbp;
+    rbp.init(rbs);
+    rbp.record_contact_forces = true;
+
+    // The bottom left corner of the second square against the top edge of
+    // the first one
+    Constraints constraints;
+    constraints.ev_constraints.emplace_back(2, 4);
+    const Eigen::MatrixXd V =
+        rbp.m_assembler.world_vertices(rbp.m_assembler.rb_poses_t1());
+    rbp.update_contact_forces(constraints, /*barrier_weights=*/{}, V);
+
+    const ContactForces& contacts = rbp.contact_forces();
+    REQUIRE(contacts.size() == 1);
+    CHECK(contacts.body_ids(0, 0) == 1);
+    CHECK(contacts.body_ids(0, 1) == 0);
+    // The barrier pushes the second square up
+    CHECK(contacts.normal_forces[0] > 0);
+    CHECK(contacts.normals(0, 0) == Approx(0).margin(1e-12));
+    CHECK(contacts.normals(0, 1) == Approx(1));
+    CHECK(contacts.points(0, 1) >= 0.5);
+    CHECK(contacts.points(0, 1) <= V(4, 1));
+    CHECK(contacts.friction_forces.isZero());
+
+    // The contacts follow the bodies in the state
+    std::vector<double> buffer;
+    rbp.state_into(buffer);
+    const nlohmann::json json = rbp.state_to_json(buffer);
+    REQUIRE(json["contacts"].size() == 1);
+    const nlohmann::json& jcontact = json["contacts"][0];
+    CHECK(jcontact["body_ids"] == nlohmann::json({ 1, 0 }));
+    CHECK(jcontact["normal_force"] == contacts.normal_forces[0]);
+    CHECK(jcontact["point"][1] == contacts.points(0, 1));
+
+    // States stay the same size without recording
+    rbp.record_contact_forces = false;
+    rbp.state_into(buffer);
+    CHECK(!rbp.state_to_json(buffer).contains("contacts"));
+}
+
+TEST_CASE("Schedule impact levels", "[RB][RB-Problem][restitution]")
+{
+    // Body 3 is static, so its impacts are independent
+    std::vector<std::pair<size_t, size_t>> body_pairs = {
+        { 0, 1 }, { 2, 3 }, { 1, 2 }, { 0, 3 }, { 4, 3 }, { 0, 1 },
+    };
+    std::vector<bool> is_body_movable = { true, true, true, false, true };
+
+    std::vector<int> levels;
+    CHECK(schedule_impact_levels(body_pairs, is_body_movable, levels) == 3);
+    CHECK(levels == std::vector<int>({ 0, 0, 1, 1, 0, 2 }));
+
+    // No level has two impacts on the same movable body
+    for (size_t i = 0; i < body_pairs.size(); i++) {
+        for (size_t j = i + 1; j < body_pairs.size(); j++) {
+            if (levels[i] != levels[j]) {
+                continue;
+            }
+            for (size_t body : { body_pairs[i].first, body_pairs[i].second }) {
+                CHECK(
+                    (!is_body_movable[body]
+                     || (body != body_pairs[j].first
+                         && body != body_pairs[j].second)));
+            }
+        }
+    }
+}
+
+/// @brief Unit square with the given pose and velocity.
+static RigidBody unit_square(
+    const PoseD& pose,
+    const PoseD& velocity,
+    int group_id,
+    RigidBodyType type = RigidBodyType::DYNAMIC)
+{
+    Eigen::MatrixXd vertices(4, 2);
+    Eigen::MatrixXi edges(4, 2);
+    vertices << -0.5, -0.5, 0.5, -0.5, 0.5, 0.5, -0.5, 0.5;
+    edges << 0, 1, 1, 2, 2, 3, 3, 0;
+    return RigidBody(
+        vertices, edges, pose, velocity, /*force=*/PoseD::Zero(2),
+        /*density=*/1, /*is_dof_fixed=*/VectorXb::Zero(3), /*oriented=*/false,
+        group_id, type);
+}
+
+/// @brief Set up the problem with the bodies and the default args patched
+/// with args.
+static bool init_problem(
+    DistanceBarrierRBProblem& problem,
+    const std::vector<RigidBody>& rbs,
+    const nlohmann::json& args)
+{
+    SimState sim; // Fills in the default args
+    if (!sim.init(args, rbs)) {
+        return false;
+    }
+    problem.scene_bodies(std::vector<RigidBody>(rbs));
+    if (!problem.settings(sim.args)) {
+        return false;
+    }
+    problem.timestep(sim.args["timestep"].get<double>());
+    return true;
+}
+
+/// @brief Record the frozen bodies and the poses of every stage of a step.
+class MultirateProblem : public DistanceBarrierRBProblem {
+public:
+    struct Stage {
+        std::vector<bool> is_frozen;
+        PosesD poses;
+    };
+    std::vector<Stage> stages;
+
+    bool take_step(const Eigen::VectorXd& x) override
+    {
+        Stage stage;
+        for (size_t i = 0; i < num_bodies(); i++) {
+            stage.is_frozen.push_back(m_assembler[i].is_frozen);
+        }
+        const bool has_intersections = DistanceBarrierRBProblem::take_step(x);
+        stage.poses = m_assembler.rb_poses_t1();
+        stages.push_back(stage);
+        return has_intersections;
+    }
+};
+
+TEST_CASE("Multirate step", "[RB][RB-Problem][multirate]")
+{
+    // The fast square travels 0.25 this step towards the slow one 0.2 away,
+    // while the slow square moves 0.01 away from it.
+    PoseD fast_pose = PoseD::Zero(2), slow_pose = PoseD::Zero(2);
+    slow_pose.position << 1.2, 0;
+    PoseD fast_velocity = PoseD::Zero(2), slow_velocity = PoseD::Zero(2);
+    fast_velocity.position << 25, 0;
+    slow_velocity.position << 1, 0;
+    std::vector<RigidBody> rbs = {
+        { unit_square(fast_pose, fast_velocity, /*group_id=*/0),
+          unit_square(slow_pose, slow_velocity, /*group_id=*/1) }
+    };
+
+    SimSettings settings;
+    settings.timestep = 0.01;
+    nlohmann::json args = settings.to_json();
+    args["rigid_body_problem"]["multirate_displacement_threshold"] = 0.1;
+    MultirateProblem problem;
+    REQUIRE(init_problem(problem, rbs, args));
+    REQUIRE(problem.is_multirate_enabled());
+
+    // Only the fast square is substepped, in ⌈0.25 / 0.1⌉ substeps
+    int num_substeps;
+    CHECK(problem.fast_bodies(num_substeps) == std::vector<size_t>({ 0 }));
+    CHECK(num_substeps == 3);
+
+    const PoseD slow_pose_t0 = problem.m_assembler[1].pose;
+    double fast_x = problem.m_assembler[0].pose.position.x();
+    bool had_collisions, has_intersections;
+    problem.simulation_step(had_collisions, has_intersections);
+    REQUIRE(problem.stages.size() == size_t(num_substeps + 1));
+
+    // The slow square is frozen at the start of the step while the fast
+    // square advances
+    for (int i = 0; i < num_substeps; i++) {
+        const MultirateProblem::Stage& stage = problem.stages[i];
+        CHECK(!stage.is_frozen[0]);
+        CHECK(stage.is_frozen[1]);
+        CHECK(stage.poses[1].position == slow_pose_t0.position);
+        CHECK(stage.poses[1].rotation == slow_pose_t0.rotation);
+        CHECK(stage.poses[0].position.x() > fast_x);
+        fast_x = stage.poses[0].position.x();
+    }
+
+    // Then the fast square is frozen at the end of the step while the slow
+    // square moves
+    const MultirateProblem::Stage& last_stage = problem.stages.back();
+    CHECK(last_stage.is_frozen[0]);
+    CHECK(!last_stage.is_frozen[1]);
+    CHECK(last_stage.poses[0].position.x() == fast_x);
+    CHECK(last_stage.poses[1].position.x() > slow_pose_t0.position.x());
+
+    // Both squares are thawed after the step
+    for (size_t i = 0; i < problem.num_bodies(); i++) {
+        const RigidBody& body = problem.m_assembler[i];
+        CHECK(!body.is_frozen);
+        CHECK(body.type == RigidBodyType::DYNAMIC);
+        CHECK(!body.is_dof_fixed.any());
+    }
+    CHECK(problem.free_dof().size() == problem.num_vars());
+    CHECK(problem.m_assembler[1].velocity.position.x() > 0);
+
+    // The fast square stops against the slow one without passing through it
+    CHECK(!has_intersections);
+    CHECK(problem.compute_min_distance() > 0);
+    CHECK(fast_x < problem.m_assembler[1].pose.position.x() - 1);
+}
+
+/// @brief Count the augmented Lagrangian updates.
+class KinematicTargetsProblem : public DistanceBarrierRBProblem {
+public:
+    using DistanceBarrierRBProblem::x_pred;
+    int num_augmented_lagrangian_updates = 0;
+
+    void update_augmented_lagrangian(const Eigen::VectorXd& x) override
+    {
+        num_augmented_lagrangian_updates++;
+        DistanceBarrierRBProblem::update_augmented_lagrangian(x);
+    }
+};
+
+TEST_CASE("Prescribed kinematic targets", "[RB][RB-Problem][kinematic]")
+{
+    // A kinematic square moves 0.01 towards a dynamic square at rest
+    PoseD kinematic_pose = PoseD::Zero(2), dynamic_pose = PoseD::Zero(2);
+    PoseD kinematic_velocity = PoseD::Zero(2);
+    kinematic_velocity.position << 1, 0;
+    double gap = 0;
+    SECTION("Unblocked target") { gap = 0.5; }
+    SECTION("Blocked target") { gap = 5e-3; }
+    dynamic_pose.position << 1 + gap, 0;
+    std::vector<RigidBody> rbs = {
+        { unit_square(
+              kinematic_pose, kinematic_velocity, /*group_id=*/0,
+              RigidBodyType::KINEMATIC),
+          unit_square(dynamic_pose, PoseD::Zero(2), /*group_id=*/1) }
+    };
+
+    SimSettings settings;
+    settings.timestep = 0.01;
+    nlohmann::json args = settings.to_json();
+    args["rigid_body_problem"]["prescribe_kinematic_bodies"] = true;
+    KinematicTargetsProblem problem;
+    REQUIRE(init_problem(problem, rbs, args));
+
+    // Sweep only the kinematic square to its target
+    const PosesD poses_t0 = problem.m_assembler.rb_poses_t1();
+    PosesD poses_t1 = poses_t0;
+    poses_t1[0].position += settings.timestep * kinematic_velocity.position;
+    const auto& constraint =
+        dynamic_cast<const DistanceBarrierConstraint&>(problem.constraint());
+    const double toi = constraint.compute_earliest_toi(
+        problem.m_assembler, poses_t0, poses_t1);
+
+    bool had_collisions, has_intersections;
+    problem.simulation_step(had_collisions, has_intersections);
+    const int ndof = PoseD::dim_to_ndof(2);
+    const Eigen::VectorXi free_dof = problem.free_dof();
+    const bool is_kinematic_dof_free = (free_dof.array() < ndof).any();
+
+    if (gap > settings.timestep) {
+        // The target is met exactly without the augmented Lagrangian
+        CHECK(toi > 1);
+        const PoseD& pose = problem.m_assembler[0].pose;
+        CHECK(pose.position == problem.x_pred.head(2));
+        CHECK(pose.rotation == problem.x_pred.segment(2, 1));
+        CHECK(!is_kinematic_dof_free);
+        CHECK(free_dof.size() == ndof);
+        CHECK(problem.num_augmented_lagrangian_updates == 0);
+    } else {
+        // The target is reached through the augmented Lagrangian, pushing
+        // the dynamic square away
+        CHECK(toi <= 1);
+        CHECK(problem.num_augmented_lagrangian_updates > 0);
+        CHECK(
+            problem.m_assembler[1].pose.position.x()
+            > dynamic_pose.position.x());
+    }
+
+    CHECK(!has_intersections);
+    CHECK(problem.compute_min_distance() > 0);
+}
+
 // TODO: Add 3D RB test
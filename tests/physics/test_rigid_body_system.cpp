@@ -7,6 +7,7 @@
 #include <igl/PI.h>
 
 #include <physics/rigid_body_assembler.hpp>
+#include <physics/world_vertices_diff.hpp>
 
 // ---------------------------------------------------
 // Tests
@@ -76,3 +77,130 @@ TEST_CASE("Rigid Body System Transform", "[RB][RB-System][RB-System-transform]")
         assembler.world_vertices(poses) - assembler.world_vertices();
     CHECK((expected - actual).squaredNorm() < 1E-6);
 }
+
+TEST_CASE(
+    "Lazy world vertices derivatives", "[RB][RB-System][RB-System-diff]")
+{
+    int dim = GENERATE(2, 3);
+    Eigen::MatrixXd vertices;
+    Eigen::MatrixXi edges;
+    if (dim == 2) {
+        vertices.resize(4, 2);
+        vertices << -0.5, -0.5, 0.5, -0.5, 0.5, 0.5, -0.5, 0.5;
+        edges.resize(4, 2);
+        edges << 0, 1, 1, 2, 2, 3, 3, 0;
+    } else {
+        vertices.resize(4, 3);
+        vertices << 0, 0, 0, 1, 0, 0, 0, 1, 0, 0, 0, 1;
+        edges.resize(6, 2);
+        edges << 0, 1, 1, 2, 2, 0, 0, 3, 1, 3, 2, 3;
+    }
+    Pose<double> velocity = Pose<double>::Zero(dim);
+
+    std::vector<RigidBody> rbs;
+    rbs.push_back(simple_rigid_body(vertices, edges, velocity));
+    rbs.push_back(simple_rigid_body(vertices, edges, velocity));
+    RigidBodyAssembler assembler;
+    assembler.init(rbs);
+
+    const int ndof = Pose<double>::dim_to_ndof(dim);
+    PosesD poses;
+    for (int i = 0; i < 2; i++) {
+        poses.emplace_back(VectorMax6d(VectorMax6d::Random(ndof)));
+    }
+
+    Eigen::MatrixXd jac, hess;
+    assembler.world_vertices_diff(poses, jac, hess, true, true);
+
+    WorldVerticesDiff V_diff;
+    V_diff.compute(assembler, poses, /*compute_hess=*/true);
+    for (long vi = 0; vi < assembler.num_vertices(); vi++) {
+        CHECK(V_diff.vertex_jacobian(vi).isApprox(
+            jac.middleRows(vi * dim, dim)));
+
+        VectorMax3d w = VectorMax3d::Random(dim);
+        MatrixMax6d expected_hess = MatrixMax6d::Zero(ndof, ndof);
+        for (int j = 0; j < dim; j++) {
+            expected_hess +=
+                w(j) * hess.middleRows((vi * dim + j) * ndof, ndof);
+        }
+        CHECK((V_diff.vertex_hessian(vi, w) - expected_hess).norm() < 1e-12);
+    }
+}
+
+TEST_CASE("Body pair collision masks", "[RB][RB-System][broad_phase]")
+{
+    Eigen::MatrixXd vertices(4, 2);
+    vertices << -0.5, -0.5, 0.5, -0.5, 0.5, 0.5, -0.5, 0.5;
+    Eigen::MatrixXi edges(4, 2);
+    edges << 0, 1, 1, 2, 2, 3, 3, 0;
+    const PoseD zero = PoseD::Zero(2);
+    const auto body = [&](int group_id, RigidBodyType type) {
+        return RigidBody(
+            vertices, edges, zero, zero, zero, /*density=*/1.0,
+            /*is_dof_fixed=*/VectorMax6b::Zero(3), /*oriented=*/false,
+            group_id, type);
+    };
+
+    enum { DYNAMIC0, DYNAMIC1, SAME_GROUP, STATIC0, STATIC1, KINEMATIC0,
+           KINEMATIC1, SLEEPING };
+    std::vector<RigidBody> rbs = {
+        body(0, RigidBodyType::DYNAMIC),   body(1, RigidBodyType::DYNAMIC),
+        body(0, RigidBodyType::DYNAMIC),   body(2, RigidBodyType::STATIC),
+        body(3, RigidBodyType::STATIC),    body(4, RigidBodyType::KINEMATIC),
+        body(5, RigidBodyType::KINEMATIC), body(6, RigidBodyType::DYNAMIC),
+    };
+    rbs[SLEEPING].sleep();
+    RigidBodyAssembler assembler;
+    assembler.init(rbs);
+
+    CHECK(assembler.can_bodies_collide(DYNAMIC0, DYNAMIC1));
+    CHECK(!assembler.can_bodies_collide(DYNAMIC0, SAME_GROUP));
+    CHECK(assembler.can_bodies_collide(DYNAMIC0, STATIC0));
+    CHECK(assembler.can_bodies_collide(DYNAMIC0, KINEMATIC0));
+    CHECK(!assembler.can_bodies_collide(STATIC0, STATIC1));
+    CHECK(!assembler.can_bodies_collide(KINEMATIC0, KINEMATIC1));
+    CHECK(!assembler.can_bodies_collide(KINEMATIC0, STATIC0));
+    // Sleeping bodies are woken by kinematic bodies but rest on static ones
+    CHECK(assembler.can_bodies_collide(SLEEPING, KINEMATIC0));
+    CHECK(!assembler.can_bodies_collide(SLEEPING, STATIC0));
+    CHECK(assembler.can_bodies_collide(SLEEPING, DYNAMIC0));
+
+    // The masks follow the bodies' types
+    assembler[SLEEPING].wake_up();
+    assembler[KINEMATIC0].convert_to_static();
+    assembler.update_dof_fixed();
+    CHECK(assembler.can_bodies_collide(SLEEPING, STATIC0));
+    CHECK(!assembler.can_bodies_collide(KINEMATIC0, KINEMATIC1));
+    CHECK(!assembler.can_bodies_collide(KINEMATIC0, STATIC0));
+}
+
+TEST_CASE("Body pair swept sphere culling", "[RB][RB-System][broad_phase]")
+{
+    Eigen::MatrixXd vertices(4, 2);
+    vertices << -0.5, -0.5, 0.5, -0.5, 0.5, 0.5, -0.5, 0.5;
+    Eigen::MatrixXi edges(4, 2);
+    edges << 0, 1, 1, 2, 2, 3, 3, 0;
+    const PoseD zero = PoseD::Zero(2);
+    std::vector<RigidBody> rbs;
+    for (int i = 0; i < 2; i++) {
+        rbs.emplace_back(
+            vertices, edges, zero, zero, zero, /*density=*/1.0,
+            /*is_dof_fixed=*/VectorMax6b::Zero(3), /*oriented=*/false,
+            /*group_id=*/i);
+    }
+    RigidBodyAssembler assembler;
+    assembler.init(rbs);
+
+    PosesD poses_t0(2, zero), poses_t1(2, zero);
+    poses_t0[0].position << -5, 0;
+
+    // Both bodies move right, so their swept boxes overlap but they never
+    // meet.
+    poses_t1[1].position << 5, 0;
+    CHECK(assembler.close_bodies(poses_t0, poses_t1, 0.1).empty());
+
+    // The bodies cross half way
+    poses_t1[1].position << -5, 0;
+    CHECK(assembler.close_bodies(poses_t0, poses_t1, 0.1).size() == 1);
+}
@@ -0,0 +1,97 @@
+// Test the ray, closest point, and overlap queries of the bodies.
+
+#include <catch2/catch.hpp>
+
+#include <constants.hpp>
+#include <physics/scene_queries.hpp>
+
+#include "../ccd/rigid_body_generator.hpp"
+
+using namespace ipc;
+using namespace ipc::rigid;
+using namespace ipc::rigid::unittests;
+
+// Height of the dynamic box, half a unit above static box 0
+static const double DYNAMIC_BOX_HEIGHT = 1.5;
+
+TEST_CASE("Query the bodies", "[physics][scene_queries]")
+{
+    // With and without the merged static world
+    const int num_static_bodies = GENERATE(
+        Constants::STATIC_WORLD_MIN_BODIES,
+        Constants::STATIC_WORLD_MIN_BODIES - 1);
+    RigidBodyAssembler bodies;
+    bodies.init(create_shelf(num_static_bodies, DYNAMIC_BOX_HEIGHT));
+    CHECK(
+        bodies.m_static_world.empty()
+        == (num_static_bodies < Constants::STATIC_WORLD_MIN_BODIES));
+    const PosesD poses = bodies.rb_poses_t1();
+    const int dynamic_id = num_static_bodies;
+
+    SECTION("Raycast")
+    {
+        Eigen::MatrixXd origins(3, 3), directions(3, 3);
+        origins << 2, 5, 0, // onto static box 1
+            0, 5, 0,        // onto the dynamic box
+            1, 5, 0;        // between the boxes
+        directions.rowwise() = Eigen::RowVector3d(0, -2, 0);
+
+        const RayHits hits = raycast(bodies, poses, origins, directions);
+        CHECK(hits.distances(0) == Approx(4.5));
+        CHECK(hits.body_ids(0) == 1);
+        CHECK(bodies.face_id_to_body_id(hits.primitive_ids(0)) == 1);
+        CHECK(hits.normals.row(0).isApprox(Eigen::RowVector3d::UnitY()));
+
+        CHECK(hits.distances(1) == Approx(3));
+        CHECK(hits.body_ids(1) == dynamic_id);
+        CHECK(hits.normals.row(1).isApprox(Eigen::RowVector3d::UnitY()));
+
+        CHECK(std::isinf(hits.distances(2)));
+        CHECK(hits.body_ids(2) == -1);
+        CHECK(hits.primitive_ids(2) == -1);
+
+        // Hits beyond the maximum distance are missed
+        const RayHits near_hits =
+            raycast(bodies, poses, origins, directions, /*max_distance=*/4);
+        CHECK(near_hits.body_ids(0) == -1);
+        CHECK(near_hits.body_ids(1) == dynamic_id);
+    }
+
+    SECTION("Closest points")
+    {
+        Eigen::MatrixXd points(2, 3);
+        points << 2, 0, 3, // above a face of static box 1
+            1.1, 0, 0;     // between static boxes 0 and 1
+        const ClosestPoints closest = closest_points(bodies, poses, points);
+        CHECK(closest.distances(0) == Approx(2.5));
+        CHECK(closest.body_ids(0) == 1);
+        CHECK(closest.points.row(0).isApprox(Eigen::RowVector3d(2, 0, 0.5)));
+
+        CHECK(closest.distances(1) == Approx(0.4));
+        CHECK(closest.body_ids(1) == 1);
+        CHECK(closest.points(1, 0) == Approx(1.5));
+
+        const ClosestPoints near_closest =
+            closest_points(bodies, poses, points, /*max_distance=*/1);
+        CHECK(std::isinf(near_closest.distances(0)));
+        CHECK(near_closest.body_ids(0) == -1);
+        CHECK(near_closest.body_ids(1) == 1);
+    }
+
+    SECTION("Overlapping bodies")
+    {
+        Eigen::MatrixXd box_min(3, 3), box_max(3, 3);
+        box_min << 1, -1, -1, // static boxes 1 and 2
+            -1, 1.2, -1,      // the dynamic box
+            -1, 5, -1;        // above everything
+        box_max << 4.6, 1, 1, //
+            3, 1.4, 1,        //
+            9, 6, 1;
+        const std::vector<std::vector<int>> overlaps =
+            overlapping_bodies(bodies, poses, box_min, box_max);
+        REQUIRE(overlaps.size() == 3);
+        CHECK(overlaps[0] == std::vector<int>({ 1, 2 }));
+        CHECK(overlaps[1] == std::vector<int>({ dynamic_id }));
+        CHECK(overlaps[2].empty());
+    }
+}
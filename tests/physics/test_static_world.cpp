@@ -0,0 +1,157 @@
+// Test the static bodies merged into one world space mesh.
+
+#include <algorithm>
+
+#include <catch2/catch.hpp>
+
+#include <ccd/rigid/broad_phase.hpp>
+#include <constants.hpp>
+#include <physics/rigid_body_assembler.hpp>
+
+#include "../ccd/rigid_body_generator.hpp"
+
+using namespace ipc;
+using namespace ipc::rigid;
+using namespace ipc::rigid::unittests;
+
+// Height of the dynamic box, resting on static box 0
+static const double DYNAMIC_BOX_HEIGHT = 1 + 1e-3;
+
+TEST_CASE("Static bodies are merged", "[physics][static_world]")
+{
+    const int num_static_bodies = Constants::STATIC_WORLD_MIN_BODIES;
+    RigidBodyAssembler bodies;
+    bodies.init(create_shelf(num_static_bodies, DYNAMIC_BOX_HEIGHT));
+
+    const StaticWorld& world = bodies.m_static_world;
+    REQUIRE(!world.empty());
+    CHECK(world.num_bodies() == num_static_bodies);
+    CHECK(!world.contains(num_static_bodies));
+    CHECK(world.vertex_ids.size() == num_static_bodies * 8);
+    CHECK(world.face_ids.size() == num_static_bodies * 12);
+    for (size_t i = 0; i < world.vertex_ids.size(); i++) {
+        CHECK(
+            world.geometry->vertices.row(i)
+            == bodies.world_vertices().row(world.vertex_ids[i]));
+    }
+
+    // Too few static bodies are paired like any other body
+    RigidBodyAssembler few_bodies;
+    few_bodies.init(create_shelf(num_static_bodies - 1, DYNAMIC_BOX_HEIGHT));
+    CHECK(few_bodies.m_static_world.empty());
+
+    const int collision_types =
+        CollisionType::EDGE_EDGE | CollisionType::FACE_VERTEX;
+    const double inflation_radius = 1e-2;
+    const auto find_candidates = [&](const RigidBodyAssembler& assembler) {
+        const PosesD poses = assembler.rb_poses_t1();
+        Candidates candidates;
+        detect_collision_candidates_rigid(
+            assembler, poses, poses, collision_types, candidates,
+            DetectionMethod::BVH, inflation_radius);
+        return candidates;
+    };
+
+    // Only the static box under the dynamic one has candidates
+    const Candidates candidates = find_candidates(bodies);
+    CHECK(candidates.size() > 0);
+    CHECK(candidates.size() == find_candidates(few_bodies).size());
+    const auto body_ids = [&](long vi0, long vi1) {
+        const long i = bodies.vertex_id_to_body_id(vi0);
+        const long j = bodies.vertex_id_to_body_id(vi1);
+        return std::make_pair(std::min(i, j), std::max(i, j));
+    };
+    const auto expected_body_ids = std::make_pair(0l, long(num_static_bodies));
+    for (const auto& c : candidates.fv_candidates) {
+        CHECK(
+            body_ids(bodies.m_faces(c.face_index, 0), c.vertex_index)
+            == expected_body_ids);
+    }
+    for (const auto& c : candidates.ee_candidates) {
+        CHECK(
+            body_ids(
+                bodies.m_edges(c.edge0_index, 0),
+                bodies.m_edges(c.edge1_index, 0))
+            == expected_body_ids);
+    }
+}
+
+TEST_CASE(
+    "Added and removed bodies match a re-assembly", "[physics][static_world]")
+{
+    const int num_static_bodies = Constants::STATIC_WORLD_MIN_BODIES;
+    std::vector<RigidBody> rbs =
+        create_shelf(num_static_bodies, DYNAMIC_BOX_HEIGHT);
+    RigidBodyAssembler bodies;
+    bodies.init(rbs);
+    const double inflation_radius = 1e-2;
+    // Use the body tree so it is updated in place
+    bodies.close_bodies_aabb_tree(
+        bodies.rb_poses_t0(), bodies.rb_poses_t1(), inflation_radius);
+
+    // Spawn dynamic boxes above the static ones, then remove a static box
+    // (the world is then too small), a dynamic box, and the first box
+    for (int i = 0; i < 3; i++) {
+        rbs.push_back(create_box(
+            Eigen::Vector3d(2 * i + 0.1, 1.1, 0), /*group_id=*/100 + i,
+            RigidBodyType::DYNAMIC));
+        bodies.add_body(rbs.back());
+    }
+    for (size_t i : { size_t(3), rbs.size() - 2, size_t(0) }) {
+        rbs.erase(rbs.begin() + i);
+        bodies.remove_body(i);
+    }
+    // Two more static boxes merge the world again, whose ids then shift
+    // when a dynamic box before them is removed
+    for (int i = 0; i < 2; i++) {
+        rbs.push_back(create_box(
+            Eigen::Vector3d(2 * (num_static_bodies + i), 0, 0),
+            /*group_id=*/200 + i, RigidBodyType::STATIC));
+        bodies.add_body(rbs.back());
+    }
+    REQUIRE(!bodies.m_static_world.empty());
+    const auto is_dynamic = [](const RigidBody& rb) {
+        return rb.type == RigidBodyType::DYNAMIC;
+    };
+    const size_t dynamic_id =
+        std::find_if(rbs.begin(), rbs.end(), is_dynamic) - rbs.begin();
+    rbs.erase(rbs.begin() + dynamic_id);
+    bodies.remove_body(dynamic_id);
+
+    RigidBodyAssembler expected;
+    expected.init(rbs);
+    REQUIRE(bodies.num_bodies() == expected.num_bodies());
+    CHECK(bodies.m_body_vertex_id == expected.m_body_vertex_id);
+    CHECK(bodies.m_body_edge_id == expected.m_body_edge_id);
+    CHECK(bodies.m_body_face_id == expected.m_body_face_id);
+    CHECK(bodies.m_edges == expected.m_edges);
+    CHECK(bodies.m_faces == expected.m_faces);
+    CHECK(bodies.m_faces_to_edges == expected.m_faces_to_edges);
+    CHECK(bodies.m_codim_edges_to_edges == expected.m_codim_edges_to_edges);
+    CHECK(bodies.m_vertex_to_body_map == expected.m_vertex_to_body_map);
+    CHECK(bodies.group_ids() == expected.group_ids());
+    CHECK(
+        bodies.m_rb_mass_matrix.diagonal()
+        == expected.m_rb_mass_matrix.diagonal());
+    CHECK(bodies.is_rb_dof_fixed == expected.is_rb_dof_fixed);
+    CHECK(bodies.is_dof_fixed == expected.is_dof_fixed);
+    CHECK(bodies.average_mass == Approx(expected.average_mass));
+    CHECK(
+        bodies.average_edge_length == Approx(expected.average_edge_length));
+    CHECK(bodies.m_static_world.empty() == expected.m_static_world.empty());
+    CHECK(
+        bodies.m_static_world.vertex_ids
+        == expected.m_static_world.vertex_ids);
+    for (size_t i = 0; i < rbs.size(); i++) {
+        CHECK(
+            bodies.m_static_world.contains(i)
+            == expected.m_static_world.contains(i));
+    }
+
+    const PosesD poses_t0 = bodies.rb_poses_t0(),
+                 poses_t1 = bodies.rb_poses_t1();
+    CHECK(
+        bodies.close_bodies_aabb_tree(poses_t0, poses_t1, inflation_radius)
+        == expected.close_bodies_aabb_tree(
+            poses_t0, poses_t1, inflation_radius));
+}
@@ -0,0 +1,36 @@
+#include <catch2/catch.hpp>
+
+#include <Eigen/Geometry>
+#include <Eigen/SVD>
+
+#include <time_stepper/exponential_euler_time_stepper.hpp>
+#include <utils/eigen_ext.hpp>
+
+using namespace ipc;
+using namespace ipc::rigid;
+
+TEST_CASE(
+    "Closed-form projection of the Euler rotation", "[physics][time_stepper]")
+{
+    double h = GENERATE(1e-3, 1e-2, 1.0);
+    for (int i = 0; i < 10; i++) {
+        Eigen::Matrix3d R0 = Eigen::AngleAxisd(
+                                 3 * Eigen::Vector3d::Random().x(),
+                                 Eigen::Vector3d::Random().normalized())
+                                 .matrix();
+        Eigen::Vector3d omega = 10 * Eigen::Vector3d::Random();
+
+        // The polar factor of R₀ + hR₀ω̂ by SVD
+        Eigen::Matrix3d R1 = R0 + h * R0 * Hat(omega);
+        Eigen::JacobiSVD<Eigen::Matrix3d> svd(
+            R1, Eigen::ComputeFullU | Eigen::ComputeFullV);
+        Eigen::Matrix3d expected_R1 = svd.matrixU() * svd.matrixV().transpose();
+
+        CHECK(projected_euler_rotation(R0, omega, h)
+                  .isApprox(expected_R1, 1e-10));
+    }
+
+    CHECK(projected_euler_rotation(
+              Eigen::Matrix3d::Identity(), Eigen::Vector3d::Zero(), h)
+              .isIdentity());
+}
@@ -0,0 +1,50 @@
+#include <catch2/catch.hpp>
+
+#include <time_stepper/timestep_controller.hpp>
+
+using namespace ipc;
+using namespace ipc::rigid;
+
+TEST_CASE("Adaptive time-step controller", "[timestep]")
+{
+    TimestepController controller;
+    const double max_dt = 1e-2;
+
+    OptimizationResults results;
+    results.success = true;
+    results.num_iterations = 3;
+
+    SECTION("Grows after quick solves")
+    {
+        CHECK(controller.next_timestep(1e-3, results, max_dt) == 2e-3);
+        // but never past the frame
+        CHECK(controller.next_timestep(8e-3, results, max_dt) == max_dt);
+    }
+
+    SECTION("Keeps the size after slow solves")
+    {
+        results.num_iterations = 20;
+        CHECK(controller.next_timestep(1e-3, results, max_dt) == 1e-3);
+    }
+
+    SECTION("Shrinks after line-search failures")
+    {
+        results.num_line_search_failures = 1;
+        CHECK(controller.next_timestep(1e-3, results, max_dt) == 5e-4);
+    }
+
+    SECTION("Shrinks after early impacts")
+    {
+        results.earliest_toi = 0.01;
+        CHECK(controller.next_timestep(1e-3, results, max_dt) == 5e-4);
+        CHECK(
+            controller.next_timestep(1e-5, results, max_dt)
+            == controller.min_timestep);
+    }
+
+    SECTION("Does not grow with impacts")
+    {
+        results.earliest_toi = 0.5;
+        CHECK(controller.next_timestep(1e-3, results, max_dt) == 1e-3);
+    }
+}
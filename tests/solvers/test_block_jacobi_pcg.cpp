@@ -0,0 +1,91 @@
+#include <catch2/catch.hpp>
+
+#include <Eigen/Cholesky>
+
+#include <solvers/block_jacobi_pcg.hpp>
+
+using namespace ipc;
+using namespace ipc::rigid;
+
+TEST_CASE("Block-Jacobi PCG solve", "[opt][pcg]")
+{
+    const int block_size = GENERATE(1, 3, 6);
+    const int num_blocks = 20;
+    const int n = block_size * num_blocks;
+
+    // Random SPD matrix
+    Eigen::MatrixXd M = Eigen::MatrixXd::Random(n, n);
+    Eigen::MatrixXd A_dense =
+        M.transpose() * M + n * Eigen::MatrixXd::Identity(n, n);
+    Eigen::SparseMatrix<double> A = A_dense.sparseView();
+    Eigen::VectorXd b = Eigen::VectorXd::Random(n);
+
+    Eigen::VectorXi block_ids(n);
+    for (int i = 0; i < n; i++) {
+        block_ids(i) = i / block_size;
+    }
+
+    BlockJacobiPCG pcg;
+    pcg.tolerance = 1e-12;
+    pcg.compute(A, block_ids);
+
+    Eigen::VectorXd x;
+    REQUIRE(pcg.solve(b, x));
+    CHECK(pcg.num_iterations <= n);
+
+    Eigen::VectorXd expected_x = A_dense.llt().solve(b);
+    CHECK((x - expected_x).norm() <= 1e-8 * expected_x.norm());
+}
+
+TEST_CASE("Block-Jacobi PCG of a lower triangle", "[opt][pcg]")
+{
+    const int block_size = 6;
+    const int n = 10 * block_size;
+    Eigen::MatrixXd M = Eigen::MatrixXd::Random(n, n);
+    Eigen::MatrixXd A_dense =
+        M.transpose() * M + n * Eigen::MatrixXd::Identity(n, n);
+    // Only the lower triangle is stored
+    Eigen::MatrixXd L_dense = A_dense.triangularView<Eigen::Lower>();
+    Eigen::SparseMatrix<double> L = L_dense.sparseView();
+    Eigen::VectorXd b = Eigen::VectorXd::Random(n);
+
+    Eigen::VectorXi block_ids(n);
+    for (int i = 0; i < n; i++) {
+        block_ids(i) = i / block_size;
+    }
+
+    BlockJacobiPCG pcg;
+    pcg.tolerance = 1e-12;
+    pcg.compute(L, block_ids, /*is_lower_triangular=*/true);
+    CHECK(pcg.product(b).isApprox(A_dense * b));
+
+    Eigen::VectorXd x;
+    REQUIRE(pcg.solve(b, x));
+    Eigen::VectorXd expected_x = A_dense.llt().solve(b);
+    CHECK((x - expected_x).norm() <= 1e-8 * expected_x.norm());
+}
+
+TEST_CASE("Block-Jacobi PCG exact preconditioner", "[opt][pcg]")
+{
+    // A block-diagonal matrix is inverted exactly by its preconditioner
+    const int block_size = 6;
+    const int n = 4 * block_size;
+    Eigen::MatrixXd A_dense = Eigen::MatrixXd::Zero(n, n);
+    Eigen::VectorXi block_ids(n);
+    for (int bi = 0; bi < n / block_size; bi++) {
+        Eigen::MatrixXd M = Eigen::MatrixXd::Random(block_size, block_size);
+        const int start = bi * block_size;
+        A_dense.block(start, start, block_size, block_size) = M.transpose() * M
+            + Eigen::MatrixXd::Identity(block_size, block_size);
+        block_ids.segment(bi * block_size, block_size).setConstant(bi);
+    }
+    Eigen::SparseMatrix<double> A = A_dense.sparseView();
+    Eigen::VectorXd b = Eigen::VectorXd::Random(n);
+
+    BlockJacobiPCG pcg;
+    pcg.compute(A, block_ids);
+    Eigen::VectorXd x;
+    REQUIRE(pcg.solve(b, x));
+    CHECK(pcg.num_iterations == 1);
+    CHECK((A * x - b).norm() <= 1e-8 * b.norm());
+}
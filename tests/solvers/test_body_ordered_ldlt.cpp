@@ -0,0 +1,225 @@
+#include <catch2/catch.hpp>
+
+#include <Eigen/Cholesky>
+
+#include <solvers/body_ordered_ldlt.hpp>
+
+using namespace ipc;
+using namespace ipc::rigid;
+
+namespace {
+/// @brief Random SPD matrix of a chain of blocks with extra couplings.
+Eigen::MatrixXd random_block_matrix(
+    int num_blocks,
+    int block_size,
+    const std::vector<std::pair<int, int>>& couplings)
+{
+    const int n = num_blocks * block_size;
+    Eigen::MatrixXd A = Eigen::MatrixXd::Zero(n, n);
+    for (const auto& [bi, bj] : couplings) {
+        Eigen::MatrixXd M = Eigen::MatrixXd::Random(block_size, block_size);
+        A.block(bi * block_size, bj * block_size, block_size, block_size) += M;
+        A.block(bj * block_size, bi * block_size, block_size, block_size) +=
+            M.transpose();
+    }
+    // Diagonally dominant
+    for (int i = 0; i < n; i++) {
+        A(i, i) = A.row(i).cwiseAbs().sum() + 1;
+    }
+    return A;
+}
+} // namespace
+
+TEST_CASE("Body ordered LDLT solve", "[solvers][ldlt]")
+{
+    const int block_size = GENERATE(1, 3, 6);
+    const int num_blocks = 10;
+    const int n = num_blocks * block_size;
+
+    std::vector<std::pair<int, int>> couplings;
+    for (int i = 0; i + 1 < num_blocks; i++) {
+        couplings.emplace_back(i, i + 1);
+    }
+    couplings.emplace_back(0, 9);
+    couplings.emplace_back(2, 7);
+
+    Eigen::VectorXi block_ids(n);
+    for (int i = 0; i < n; i++) {
+        block_ids(i) = i / block_size;
+    }
+
+    Eigen::MatrixXd A_dense =
+        random_block_matrix(num_blocks, block_size, couplings);
+    Eigen::SparseMatrix<double> A = A_dense.sparseView();
+    Eigen::VectorXd b = Eigen::VectorXd::Random(n);
+
+    BodyOrderedLDLT solver;
+    solver.analyze_pattern(A, block_ids);
+    CHECK(solver.num_orderings() == 1);
+    CHECK(solver.block_order().size() == num_blocks);
+
+    Eigen::VectorXd x;
+    REQUIRE(solver.factorize(A));
+    REQUIRE(solver.solve(b, x));
+    Eigen::VectorXd expected_x = A_dense.llt().solve(b);
+    CHECK((x - expected_x).norm() <= 1e-8 * expected_x.norm());
+
+    // A contact that is gone keeps the ordering
+    couplings.pop_back();
+    A_dense = random_block_matrix(num_blocks, block_size, couplings);
+    A = A_dense.sparseView();
+    solver.analyze_pattern(A, block_ids);
+    CHECK(solver.num_orderings() == 1);
+    REQUIRE(solver.factorize(A));
+    REQUIRE(solver.solve(b, x));
+    expected_x = A_dense.llt().solve(b);
+    CHECK((x - expected_x).norm() <= 1e-8 * expected_x.norm());
+
+    // A contact outside of the filled graph reorders
+    couplings.emplace_back(1, 5);
+    couplings.emplace_back(3, 8);
+    couplings.emplace_back(4, 6);
+    A_dense = random_block_matrix(num_blocks, block_size, couplings);
+    A = A_dense.sparseView();
+    solver.analyze_pattern(A, block_ids);
+    CHECK(solver.num_orderings() == 2);
+    REQUIRE(solver.factorize(A));
+    REQUIRE(solver.solve(b, x));
+    expected_x = A_dense.llt().solve(b);
+    CHECK((x - expected_x).norm() <= 1e-8 * expected_x.norm());
+
+    // Without block ids every row is a block
+    solver.clear();
+    solver.analyze_pattern(A);
+    CHECK(solver.block_order().size() == n);
+    REQUIRE(solver.factorize(A));
+    REQUIRE(solver.solve(b, x));
+    CHECK((x - expected_x).norm() <= 1e-8 * expected_x.norm());
+}
+
+TEST_CASE("Body ordered LDLT keeps fill-in couplings", "[solvers][ldlt]")
+{
+    // Eliminating a leaf of a star couples nothing, eliminating a cycle
+    // block couples its two neighbors
+    const int num_blocks = 4;
+    std::vector<std::pair<int, int>> couplings = {
+        { 0, 1 }, { 1, 2 }, { 2, 3 }, { 3, 0 }
+    };
+    Eigen::SparseMatrix<double> A =
+        random_block_matrix(num_blocks, 1, couplings).sparseView();
+
+    BodyOrderedLDLT solver;
+    solver.analyze_pattern(A);
+    CHECK(solver.num_orderings() == 1);
+
+    // The chord created by the first elimination is in the filled graph
+    const int first = solver.block_order()[0];
+    couplings.emplace_back((first + 1) % 4, (first + 3) % 4);
+    A = random_block_matrix(num_blocks, 1, couplings).sparseView();
+    solver.analyze_pattern(A);
+    CHECK(solver.num_orderings() == 1);
+
+    // Dropping most of the couplings reorders
+    A = random_block_matrix(num_blocks, 1, { { 0, 1 } }).sparseView();
+    solver.analyze_pattern(A);
+    CHECK(solver.num_orderings() == 2);
+}
+
+TEST_CASE("Mixed precision body ordered LDLT", "[solvers][ldlt]")
+{
+    const int block_size = 6;
+    const int num_blocks = 8;
+    const int n = num_blocks * block_size;
+
+    std::vector<std::pair<int, int>> couplings;
+    for (int i = 0; i + 1 < num_blocks; i++) {
+        couplings.emplace_back(i, i + 1);
+    }
+    Eigen::MatrixXd A_dense =
+        random_block_matrix(num_blocks, block_size, couplings);
+    Eigen::VectorXd b = Eigen::VectorXd::Random(n);
+
+    BodyOrderedLDLT solver;
+    solver.use_mixed_precision = true;
+
+    SECTION("Refinement reaches double precision")
+    {
+        Eigen::SparseMatrix<double> A = A_dense.sparseView();
+        solver.analyze_pattern(A);
+        REQUIRE(solver.factorize(A));
+        Eigen::VectorXd x;
+        REQUIRE(solver.solve(b, x));
+        CHECK((A_dense * x - b).norm() <= 1e-10 * b.norm());
+        CHECK(solver.num_refinements() > 1);
+        CHECK(solver.num_precision_fallbacks() == 0);
+    }
+
+    SECTION("Ill-conditioned systems fall back to double")
+    {
+        // Stiff barrier-like block that floats cannot resolve
+        A_dense.block(0, 0, block_size, block_size) +=
+            1e12 * Eigen::MatrixXd::Ones(block_size, block_size);
+        Eigen::SparseMatrix<double> A = A_dense.sparseView();
+        solver.analyze_pattern(A);
+        REQUIRE(solver.factorize(A));
+        Eigen::VectorXd x;
+        REQUIRE(solver.solve(b, x));
+        // Backward stable solve
+        CHECK((A_dense * x - b).norm() <= 1e-12 * A_dense.norm() * x.norm());
+        CHECK(solver.num_precision_fallbacks() == 1);
+    }
+}
+
+TEST_CASE("Body ordered LDLT of block trees", "[solvers][ldlt]")
+{
+    const int block_size = GENERATE(1, 6);
+    const int num_blocks = 12;
+    const int n = num_blocks * block_size;
+
+    // A chain with a branch
+    std::vector<std::pair<int, int>> couplings;
+    for (int i = 0; i + 1 < 8; i++) {
+        couplings.emplace_back(i, i + 1);
+    }
+    for (int i = 8; i < num_blocks; i++) {
+        couplings.emplace_back(i == 8 ? 3 : i - 1, i);
+    }
+
+    Eigen::VectorXi block_ids(n);
+    for (int i = 0; i < n; i++) {
+        block_ids(i) = i / block_size;
+    }
+    Eigen::VectorXd b = Eigen::VectorXd::Random(n);
+
+    BodyOrderedLDLT solver;
+    for (int iteration = 0; iteration < 2; iteration++) {
+        Eigen::MatrixXd A_dense =
+            random_block_matrix(num_blocks, block_size, couplings);
+        Eigen::SparseMatrix<double> A = A_dense.sparseView();
+        solver.analyze_pattern(A, block_ids);
+        CHECK(solver.is_block_tree());
+        CHECK(solver.num_orderings() == 1);
+
+        Eigen::VectorXd x;
+        REQUIRE(solver.factorize(A));
+        REQUIRE(solver.solve(b, x));
+        Eigen::VectorXd expected_x = A_dense.llt().solve(b);
+        CHECK((x - expected_x).norm() <= 1e-8 * expected_x.norm());
+
+        // A missing link keeps the tree
+        couplings.erase(couplings.begin() + 5);
+    }
+
+    // Closing a loop needs the general factorization
+    couplings.emplace_back(0, 5);
+    Eigen::MatrixXd A_dense =
+        random_block_matrix(num_blocks, block_size, couplings);
+    Eigen::SparseMatrix<double> A = A_dense.sparseView();
+    solver.analyze_pattern(A, block_ids);
+    CHECK(!solver.is_block_tree());
+    Eigen::VectorXd x;
+    REQUIRE(solver.factorize(A));
+    REQUIRE(solver.solve(b, x));
+    Eigen::VectorXd expected_x = A_dense.llt().solve(b);
+    CHECK((x - expected_x).norm() <= 1e-8 * expected_x.norm());
+}
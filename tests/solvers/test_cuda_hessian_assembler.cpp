@@ -0,0 +1,78 @@
+#include <catch2/catch.hpp>
+
+#include <Eigen/Eigenvalues>
+
+#include <problems/cuda_hessian_assembler.hpp>
+
+using namespace ipc;
+using namespace ipc::rigid;
+
+TEST_CASE("CUDA hessian assembly matches the host", "[opt][cuda]")
+{
+    const int ndof = GENERATE(3, 6);
+    const bool lower_triangular = GENERATE(false, true);
+    const int n = 2 * ndof, num_bodies = 6;
+
+    std::vector<std::array<long, 2>> body_ids = {
+        { { 0, 1 } }, { { 2, 1 } }, { { 4, 5 } }, { { 0, 1 } }, { { 3, 0 } },
+    };
+    LocalHessianBatch batches[2];
+    std::vector<std::array<long, 2>> block_ids;
+    for (int i = 0; i < body_ids.size(); i++) {
+        // Constraints have at most n vertex DoF
+        const int num_vertex_dof = i % 2 == 0 ? n : n - ndof / 3;
+        const Eigen::MatrixXd M =
+            Eigen::MatrixXd::Random(num_vertex_dof, num_vertex_dof);
+        // Indefinite so the projection matters
+        const Eigen::MatrixXd hess_f = M + M.transpose();
+        const Eigen::MatrixXd jac = Eigen::MatrixXd::Random(num_vertex_dof, n);
+        Eigen::MatrixXd offset = Eigen::MatrixXd::Zero(n, n);
+        offset.topLeftCorner(ndof, ndof).setIdentity();
+        batches[i % 2].add(hess_f, jac, offset, body_ids[i]);
+
+        const auto [b0, b1] = body_ids[i];
+        for (const std::array<long, 2>& block :
+             { std::array<long, 2> { { b0, b1 } },
+               std::array<long, 2> { { b1, b0 } } }) {
+            if (!lower_triangular || block[0] > block[1]) {
+                block_ids.push_back(block);
+            }
+        }
+    }
+
+    BlockSparseSkeleton expected, hessian;
+    expected.reserve_blocks(num_bodies, ndof, block_ids);
+    hessian.reserve_blocks(num_bodies, ndof, block_ids);
+    const double scale = 0.5;
+    for (const LocalHessianBatch& batch : batches) {
+        for (size_t i = 0; i < batch.size(); i++) {
+            Eigen::SelfAdjointEigenSolver<Eigen::MatrixXd> eig(
+                batch.local_hessian(i));
+            const Eigen::MatrixXd local = eig.eigenvectors()
+                * eig.eigenvalues().cwiseMax(0).asDiagonal()
+                * eig.eigenvectors().transpose();
+            for (int b_i = 0; b_i < 2; b_i++) {
+                for (int b_j = 0; b_j < 2; b_j++) {
+                    const long bi = batch.body_ids[i][b_i];
+                    const long bj = batch.body_ids[i][b_j];
+                    if (!lower_triangular || bi >= bj) {
+                        expected.add_block(
+                            expected.find_block(bi, bj),
+                            local.block(ndof * b_i, ndof * b_j, ndof, ndof),
+                            scale);
+                    }
+                }
+            }
+        }
+    }
+
+    CudaHessianAssembler assembler;
+    // Twice to reuse the device buffers
+    for (int iteration = 0; iteration < 2; iteration++) {
+        hessian.setZero();
+        REQUIRE(assembler.assemble(
+            { &batches[0], &batches[1] }, scale, lower_triangular, hessian));
+        CHECK(Eigen::MatrixXd(hessian.matrix())
+                  .isApprox(Eigen::MatrixXd(expected.matrix()), 1e-10));
+    }
+}
@@ -0,0 +1,45 @@
+#include <catch2/catch.hpp>
+
+#include <solvers/cuda_pcg.hpp>
+
+using namespace ipc;
+using namespace ipc::rigid;
+
+TEST_CASE("CUDA PCG matches host PCG", "[opt][pcg][cuda]")
+{
+    const int block_size = GENERATE(1, 6);
+    const int num_blocks = 20;
+    const int n = block_size * num_blocks;
+
+    Eigen::MatrixXd M = Eigen::MatrixXd::Random(n, n);
+    Eigen::MatrixXd A_dense =
+        M.transpose() * M + n * Eigen::MatrixXd::Identity(n, n);
+    Eigen::SparseMatrix<double> A = A_dense.sparseView();
+    Eigen::VectorXd b = Eigen::VectorXd::Random(n);
+
+    Eigen::VectorXi block_ids(n);
+    for (int i = 0; i < n; i++) {
+        block_ids(i) = i / block_size;
+    }
+
+    BlockJacobiPCG host_pcg;
+    host_pcg.tolerance = 1e-12;
+    host_pcg.compute(A, block_ids);
+    Eigen::VectorXd expected_x;
+    REQUIRE(host_pcg.solve(b, expected_x));
+
+    CudaPCG pcg;
+    pcg.tolerance = 1e-12;
+    REQUIRE(pcg.compute(A, block_ids));
+    Eigen::VectorXd x;
+    REQUIRE(pcg.solve(b, x));
+    CHECK((x - expected_x).norm() <= 1e-8 * expected_x.norm());
+    CHECK(pcg.num_pattern_uploads() == 1);
+
+    // New values with the same pattern only upload the values
+    A *= 2;
+    REQUIRE(pcg.compute(A, block_ids));
+    REQUIRE(pcg.solve(b, x));
+    CHECK((x - expected_x / 2).norm() <= 1e-8 * expected_x.norm());
+    CHECK(pcg.num_pattern_uploads() == 1);
+}
@@ -0,0 +1,68 @@
+#include <catch2/catch.hpp>
+
+#include <Eigen/Cholesky>
+
+#include <solvers/island_linear_solver.hpp>
+
+using namespace ipc;
+using namespace ipc::rigid;
+
+TEST_CASE("Sparse connected components", "[opt][islands]")
+{
+    // Rows {0, 3}, {1}, and {2, 4} are coupled
+    std::vector<Eigen::Triplet<double>> triplets;
+    for (int i = 0; i < 5; i++) {
+        triplets.emplace_back(i, i, 1);
+    }
+    triplets.emplace_back(0, 3, 1);
+    triplets.emplace_back(3, 0, 1);
+    triplets.emplace_back(2, 4, 1);
+    triplets.emplace_back(4, 2, 1);
+    Eigen::SparseMatrix<double> A(5, 5);
+    A.setFromTriplets(triplets.begin(), triplets.end());
+
+    Eigen::VectorXi components;
+    CHECK(sparse_connected_components(A, components) == 3);
+    Eigen::VectorXi expected_components(5);
+    expected_components << 0, 1, 2, 0, 2;
+    CHECK(components == expected_components);
+}
+
+TEST_CASE("Island linear solve", "[opt][islands]")
+{
+    const int block_size = GENERATE(1, 3, 6);
+    const int num_blocks = 20;
+    const int max_groups = GENERATE(2, 4, 64);
+    const int n = block_size * num_blocks;
+
+    // Random SPD blocks with pairs of blocks coupled into islands
+    Eigen::MatrixXd A_dense = Eigen::MatrixXd::Zero(n, n);
+    for (int bi = 0; bi < num_blocks; bi += 2) {
+        const int size = std::min(2, num_blocks - bi) * block_size;
+        Eigen::MatrixXd M = Eigen::MatrixXd::Random(size, size);
+        A_dense.block(bi * block_size, bi * block_size, size, size) =
+            M.transpose() * M + size * Eigen::MatrixXd::Identity(size, size);
+    }
+    Eigen::SparseMatrix<double> A = A_dense.sparseView();
+    Eigen::VectorXd b = Eigen::VectorXd::Random(n);
+
+    IslandLinearSolver solver;
+    solver.analyze_pattern(
+        A, { { "name", "Eigen::SimplicialLDLT" } }, max_groups);
+    CHECK(solver.num_islands() == num_blocks / 2);
+    CHECK(solver.num_groups() == std::min(max_groups, num_blocks / 2));
+
+    Eigen::VectorXd x;
+    REQUIRE(solver.solve(A, b, x));
+    Eigen::VectorXd expected_x = A_dense.llt().solve(b);
+    CHECK((x - expected_x).norm() <= 1e-8 * expected_x.norm());
+
+    // The analyzed pattern is reused for new values
+    A *= 2;
+    REQUIRE(solver.solve(A, b, x));
+    CHECK((x - expected_x / 2).norm() <= 1e-8 * expected_x.norm());
+
+    // A single group is left to the whole system solver
+    solver.analyze_pattern(A, { { "name", "Eigen::SimplicialLDLT" } }, 1);
+    CHECK(solver.num_groups() == 0);
+}
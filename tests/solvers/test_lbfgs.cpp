@@ -0,0 +1,66 @@
+#include <catch2/catch.hpp>
+
+#include <Eigen/Cholesky>
+
+#include <solvers/lbfgs.hpp>
+
+using namespace ipc;
+using namespace ipc::rigid;
+
+TEST_CASE("L-BFGS secant condition", "[opt][lbfgs]")
+{
+    const int n = 12;
+
+    // Random SPD quadratic with gradient g(x) = Ax
+    Eigen::MatrixXd M = Eigen::MatrixXd::Random(n, n);
+    Eigen::MatrixXd A = M.transpose() * M + n * Eigen::MatrixXd::Identity(n, n);
+    Eigen::VectorXd initial_hessian = A.diagonal();
+
+    LBFGS lbfgs;
+    lbfgs.history_size = GENERATE(1, 5, 20);
+    for (int i = 0; i < 8; i++) {
+        Eigen::VectorXd s = Eigen::VectorXd::Random(n);
+        Eigen::VectorXd y = A * s;
+        REQUIRE(lbfgs.update(s, y));
+        CHECK(lbfgs.size() == std::min<size_t>(i + 1, lbfgs.history_size));
+
+        // The approximation maps the newest change in gradient to its step
+        Eigen::VectorXd Hy = lbfgs.apply_inverse_hessian(y, initial_hessian);
+        CHECK((Hy - s).norm() <= 1e-8 * s.norm());
+    }
+
+    // Pairs without positive curvature are skipped
+    Eigen::VectorXd s = Eigen::VectorXd::Random(n);
+    CHECK(!lbfgs.update(s, -A * s));
+
+    // Without pairs the initial Hessian is used
+    lbfgs.clear();
+    Eigen::VectorXd g = Eigen::VectorXd::Random(n);
+    CHECK(lbfgs.apply_inverse_hessian(g, initial_hessian)
+              .isApprox(g.cwiseQuotient(initial_hessian)));
+}
+
+TEST_CASE("L-BFGS minimizes a quadratic", "[opt][lbfgs]")
+{
+    const int n = 10;
+
+    Eigen::MatrixXd M = Eigen::MatrixXd::Random(n, n);
+    Eigen::MatrixXd A = M.transpose() * M + Eigen::MatrixXd::Identity(n, n);
+    Eigen::VectorXd b = Eigen::VectorXd::Random(n);
+    Eigen::VectorXd expected_x = A.llt().solve(b);
+
+    // Exact line searches along the L-BFGS directions
+    LBFGS lbfgs;
+    lbfgs.history_size = n;
+    Eigen::VectorXd x = Eigen::VectorXd::Zero(n), g = A * x - b;
+    for (int i = 0; i < 2 * n && g.norm() > 1e-12; i++) {
+        Eigen::VectorXd dir = -lbfgs.apply_inverse_hessian(g, A.diagonal());
+        REQUIRE(g.dot(dir) < 0);
+        double alpha = -g.dot(dir) / dir.dot(A * dir);
+        Eigen::VectorXd x_next = x + alpha * dir, g_next = A * x_next - b;
+        lbfgs.update(x_next - x, g_next - g);
+        x = x_next;
+        g = g_next;
+    }
+    CHECK((x - expected_x).norm() <= 1e-6 * expected_x.norm());
+}
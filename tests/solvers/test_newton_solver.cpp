@@ -126,3 +126,128 @@ TEST_CASE("Test making a matrix SPD", "[opt][make_spd]")
         CHECK(eig_vals(i).real() >= Approx(0.0).margin(1e-12));
     }
 }
+
+TEST_CASE("Shift the diagonal in place", "[opt][make_spd]")
+{
+    // Symmetric with a Gershgorin bound of |-3| + |1| - 1 = 3 from row 1
+    Eigen::MatrixXd A_dense(3, 3);
+    A_dense << 2, -3, 0, //
+        -3, 1, 1,        //
+        0, 1, 4;
+    Eigen::SparseMatrix<double> A = A_dense.sparseView();
+    A.makeCompressed();
+    CHECK(gershgorin_diagonal_shift(A) == Approx(3.0));
+    // The same bound from the lower triangle only
+    Eigen::MatrixXd L_dense = A_dense.triangularView<Eigen::Lower>();
+    CHECK(
+        gershgorin_diagonal_shift(L_dense.sparseView(), true) == Approx(3.0));
+
+    std::vector<int> outer(A.outerIndexPtr(), A.outerIndexPtr() + 4);
+    std::vector<int> inner(
+        A.innerIndexPtr(), A.innerIndexPtr() + A.nonZeros());
+    add_to_diagonal(A, 3);
+    CHECK(Eigen::MatrixXd(A).isApprox(
+        A_dense + 3 * Eigen::MatrixXd::Identity(3, 3)));
+    // The pattern (and its symbolic factorization) is unchanged
+    CHECK(std::equal(outer.begin(), outer.end(), A.outerIndexPtr()));
+    CHECK(std::equal(inner.begin(), inner.end(), A.innerIndexPtr()));
+
+    // Diagonally dominant matrices need no shift
+    CHECK(gershgorin_diagonal_shift(A) == Approx(0.0).margin(1e-12));
+}
+
+TEST_CASE("Test slicing the free DoF", "[opt][newtons_method][free_dof]")
+{
+    int num_vars = 50;
+    Eigen::SparseMatrix<double> A =
+        Eigen::MatrixXd::Random(num_vars, num_vars).sparseView(0.5, 1);
+    A.makeCompressed();
+
+    std::vector<int> full_to_free_dof(num_vars, -1);
+    std::vector<int> free_dofs;
+    for (int i = 0; i < num_vars; i++) {
+        if (i % 3 != 0) {
+            full_to_free_dof[i] = free_dofs.size();
+            free_dofs.push_back(i);
+        }
+    }
+    Eigen::VectorXi free_dof =
+        Eigen::Map<Eigen::VectorXi>(free_dofs.data(), free_dofs.size());
+
+    Eigen::SparseMatrix<double> A_free;
+    slice_free_dof(A, free_dof, full_to_free_dof, A_free);
+
+    Eigen::MatrixXd A_dense(A);
+    Eigen::MatrixXd expected(free_dof.size(), free_dof.size());
+    for (int i = 0; i < free_dof.size(); i++) {
+        for (int j = 0; j < free_dof.size(); j++) {
+            expected(i, j) = A_dense(free_dof(i), free_dof(j));
+        }
+    }
+    CHECK(Eigen::MatrixXd(A_free) == expected);
+}
+
+TEST_CASE("Interpolate the line search step", "[opt][line_search]")
+{
+    // f(α) = (α - 0.2)² along the direction
+    const auto f = [](double alpha) { return (alpha - 0.2) * (alpha - 0.2); };
+    const double fx = f(0), grad_dot_dir = -0.4;
+
+    // The quadratic model is exact
+    double alpha = interpolate_step_length(fx, grad_dot_dir, 1, f(1), -1, fx);
+    CHECK(alpha == Approx(0.2));
+
+    // The cubic model of a quadratic is exact too
+    alpha = interpolate_step_length(fx, grad_dot_dir, 0.5, f(0.5), 1, f(1));
+    CHECK(alpha == Approx(0.2));
+
+    // The step is kept in a fraction of the current step length
+    alpha = interpolate_step_length(fx, grad_dot_dir, 10, f(10), -1, fx);
+    CHECK(alpha == Approx(Constants::LINE_SEARCH_INTERPOLATION_MIN_SCALE * 10));
+
+    // Fall back to halving without a finite objective
+    alpha = interpolate_step_length(
+        fx, grad_dot_dir, 1, std::numeric_limits<double>::infinity(), -1, fx);
+    CHECK(alpha == Approx(0.5));
+}
+
+TEST_CASE("Eisenstat-Walker forcing terms", "[opt][newtons_method][inexact]")
+{
+    const double min_eta = 1e-10;
+    const double max_eta = Constants::INEXACT_NEWTON_MAX_FORCING_TERM;
+    const double gamma = Constants::INEXACT_NEWTON_FORCING_SCALE;
+    const double alpha = Constants::INEXACT_NEWTON_FORCING_EXPONENT;
+
+    // The first direction is the most inexact
+    CHECK(eisenstat_walker_forcing_term(1, -1, 0, min_eta) == max_eta);
+
+    // A stalled gradient keeps the largest forcing term
+    CHECK(eisenstat_walker_forcing_term(1, 1, max_eta, min_eta) == max_eta);
+
+    // The forcing term follows the convergence of the gradient ...
+    double eta = eisenstat_walker_forcing_term(1e-2, 1, 1e-3, min_eta);
+    CHECK(eta == Approx(gamma * std::pow(1e-2, alpha)));
+
+    // ... but does not drop much faster than the previous one
+    eta = eisenstat_walker_forcing_term(1e-2, 1, max_eta, min_eta);
+    CHECK(eta == Approx(gamma * std::pow(max_eta, alpha)));
+
+    // and is never tighter than the linear solver tolerance
+    eta = eisenstat_walker_forcing_term(1e-12, 1, 1e-6, min_eta);
+    CHECK(eta == min_eta);
+
+    // The sequence decreases as a converging gradient does
+    double gradient_norm = 1, prev_gradient_norm = -1;
+    eta = 0;
+    for (int i = 0; i < 8; i++) {
+        const double next_eta = eisenstat_walker_forcing_term(
+            gradient_norm, prev_gradient_norm, eta, min_eta);
+        if (i > 0) {
+            CHECK(next_eta <= eta);
+        }
+        eta = next_eta;
+        prev_gradient_norm = gradient_norm;
+        gradient_norm *= eta;
+    }
+    CHECK(eta < 1e-3);
+}
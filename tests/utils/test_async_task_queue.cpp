@@ -0,0 +1,36 @@
+#include <catch2/catch.hpp>
+
+#include <atomic>
+#include <vector>
+
+#include <utils/async_task_queue.hpp>
+
+using namespace ipc::rigid;
+
+TEST_CASE("Async task queue runs tasks in order", "[utils][async]")
+{
+    size_t capacity = GENERATE(1, 4);
+    std::vector<int> order;
+    std::atomic<int> num_done(0);
+    {
+        AsyncTaskQueue queue(capacity);
+        CHECK(queue.capacity() == capacity);
+        for (int i = 0; i < 100; i++) {
+            queue.push([&, i] {
+                order.push_back(i);
+                num_done++;
+            });
+        }
+        queue.wait();
+        CHECK(num_done == 100);
+
+        // Tasks pushed after waiting finish before destruction
+        queue.push([&] { num_done++; });
+    }
+    CHECK(num_done == 101);
+
+    REQUIRE(order.size() == 100);
+    for (int i = 0; i < order.size(); i++) {
+        CHECK(order[i] == i);
+    }
+}
@@ -0,0 +1,50 @@
+#include <catch2/catch.hpp>
+
+#include <array>
+#include <vector>
+
+#include <Eigen/SparseCore>
+
+#include <utils/block_sparse_matrix.hpp>
+
+using namespace ipc;
+using namespace ipc::rigid;
+
+TEST_CASE("Block sparse matrix matches triplets", "[utils][block_sparse]")
+{
+    int block_size = GENERATE(3, 6);
+    const int num_blocks = 5;
+    const int n = num_blocks * block_size;
+
+    std::vector<std::array<long, 2>> block_ids = {
+        { { 0, 0 } }, { { 3, 1 } }, { { 1, 3 } }, { { 4, 4 } }, { { 0, 0 } },
+        { { 2, 4 } }, { { 3, 1 } },
+    };
+
+    BlockSparseMatrix bsr(num_blocks, block_size);
+    std::vector<Eigen::Triplet<double>> triplets;
+    for (const auto& [bi, bj] : block_ids) {
+        Eigen::MatrixXd block = Eigen::MatrixXd::Random(block_size, block_size);
+        bsr.add_block(bi, bj, block);
+        for (int r = 0; r < block_size; r++) {
+            for (int c = 0; c < block_size; c++) {
+                triplets.emplace_back(
+                    bi * block_size + r, bj * block_size + c, block(r, c));
+            }
+        }
+    }
+    CHECK(bsr.num_blocks() == 5);
+
+    // Merging an empty matrix should not change anything
+    bsr += BlockSparseMatrix(num_blocks, block_size);
+
+    Eigen::SparseMatrix<double> expected(n, n);
+    expected.setFromTriplets(triplets.begin(), triplets.end());
+
+    Eigen::SparseMatrix<double> actual;
+    bsr.to_sparse(actual);
+
+    CHECK(actual.isCompressed());
+    CHECK(actual.nonZeros() == expected.nonZeros());
+    CHECK(Eigen::MatrixXd(actual).isApprox(Eigen::MatrixXd(expected)));
+}
@@ -0,0 +1,123 @@
+#include <catch2/catch.hpp>
+
+#include <array>
+#include <vector>
+
+#include <Eigen/SparseCore>
+
+#include <utils/block_sparse_skeleton.hpp>
+
+using namespace ipc;
+using namespace ipc::rigid;
+
+TEST_CASE("Block sparse skeleton matches triplets", "[utils][block_sparse]")
+{
+    int block_size = GENERATE(3, 6);
+    const int num_blocks = 5;
+    const int n = num_blocks * block_size;
+
+    std::vector<std::array<long, 2>> block_ids = {
+        { { 0, 0 } }, { { 3, 1 } }, { { 1, 3 } }, { { 4, 4 } }, { { 0, 0 } },
+        { { 2, 4 } }, { { 3, 1 } },
+    };
+
+    BlockSparseSkeleton skeleton;
+    CHECK(skeleton.reserve_blocks(num_blocks, block_size, block_ids));
+    // Every diagonal block plus the three off-diagonal ones
+    CHECK(skeleton.num_blocks() == num_blocks + 3);
+    CHECK(skeleton.find_block(2, 2) >= 0);
+    CHECK(skeleton.find_block(1, 2) == -1);
+
+    for (int iteration = 0; iteration < 2; iteration++) {
+        // The same blocks keep the pattern
+        CHECK(!skeleton.reserve_blocks(num_blocks, block_size, block_ids));
+        skeleton.setZero();
+
+        std::vector<Eigen::Triplet<double>> triplets;
+        for (const auto& [bi, bj] : block_ids) {
+            Eigen::MatrixXd block =
+                Eigen::MatrixXd::Random(block_size, block_size);
+            skeleton.add_block(skeleton.find_block(bi, bj), block, 2.0);
+            for (int r = 0; r < block_size; r++) {
+                for (int c = 0; c < block_size; c++) {
+                    triplets.emplace_back(
+                        bi * block_size + r, bj * block_size + c,
+                        2 * block(r, c));
+                }
+            }
+        }
+        Eigen::SparseMatrix<double> expected(n, n);
+        expected.setFromTriplets(triplets.begin(), triplets.end());
+
+        // Adding a matrix inside the pattern
+        skeleton.add(expected, -0.5);
+        expected *= 0.5;
+
+        const Eigen::SparseMatrix<double>& actual = skeleton.matrix();
+        CHECK(actual.isCompressed());
+        CHECK(Eigen::MatrixXd(actual).isApprox(Eigen::MatrixXd(expected)));
+    }
+}
+
+TEST_CASE("Block sparse skeleton pattern updates", "[utils][block_sparse]")
+{
+    BlockSparseSkeleton skeleton;
+    skeleton.reserve_blocks(4, 2, { { { 0, 1 } }, { { 1, 0 } } });
+    CHECK(skeleton.num_blocks() == 6);
+
+    // A block outside of the pattern rebuilds it
+    CHECK(skeleton.reserve_blocks(4, 2, { { { 2, 3 } } }));
+    CHECK(skeleton.find_block(2, 3) >= 0);
+    CHECK(skeleton.find_block(0, 1) == -1);
+
+    // Half of the off-diagonal blocks unused keeps the pattern
+    skeleton.reserve_blocks(4, 2, { { { 2, 3 } }, { { 3, 2 } } });
+    CHECK(!skeleton.reserve_blocks(4, 2, { { { 2, 3 } } }));
+    CHECK(skeleton.find_block(3, 2) >= 0);
+
+    // Only diagonal blocks drop the unused ones
+    CHECK(skeleton.reserve_blocks(4, 2, {}));
+    CHECK(skeleton.num_blocks() == 4);
+    CHECK(skeleton.matrix().nonZeros() == 16);
+}
+
+TEST_CASE("Block sparse skeleton free DoF", "[utils][block_sparse]")
+{
+    const int num_blocks = 4, block_size = 3, n = num_blocks * block_size;
+    BlockSparseSkeleton skeleton;
+    skeleton.reserve_blocks(
+        num_blocks, block_size, { { { 0, 2 } }, { { 2, 0 } }, { { 3, 1 } } });
+
+    Eigen::SparseMatrix<double> A_free;
+    for (int fixed_block : { 1, 1, 2 }) {
+        // Random values in the pattern (the map is reused for block 1)
+        const long num_pattern_blocks = skeleton.num_blocks();
+        for (long block_id = 0; block_id < num_pattern_blocks; block_id++) {
+            skeleton.add_block(
+                block_id, Eigen::MatrixXd::Random(block_size, block_size), 1);
+        }
+
+        // Fix a whole block and the last DoF of block 0
+        std::vector<int> full_to_free_dof(n, -1), free_dofs;
+        for (int i = 0; i < n; i++) {
+            if (i / block_size != fixed_block && i != block_size - 1) {
+                full_to_free_dof[i] = free_dofs.size();
+                free_dofs.push_back(i);
+            }
+        }
+        Eigen::VectorXi free_dof =
+            Eigen::Map<Eigen::VectorXi>(free_dofs.data(), free_dofs.size());
+
+        skeleton.free_matrix(free_dof, full_to_free_dof, A_free);
+
+        Eigen::MatrixXd A_dense(skeleton.matrix());
+        Eigen::MatrixXd expected(free_dof.size(), free_dof.size());
+        for (int i = 0; i < free_dof.size(); i++) {
+            for (int j = 0; j < free_dof.size(); j++) {
+                expected(i, j) = A_dense(free_dof(i), free_dof(j));
+            }
+        }
+        CHECK(A_free.isCompressed());
+        CHECK(Eigen::MatrixXd(A_free) == expected);
+    }
+}
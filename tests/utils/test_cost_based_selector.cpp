@@ -0,0 +1,43 @@
+#include <catch2/catch.hpp>
+
+#include <cmath>
+
+#include <utils/cost_based_selector.hpp>
+
+using namespace ipc::rigid;
+
+TEST_CASE("Cost based selector", "[utils][selector]")
+{
+    const int probe_period = 4;
+    CostBasedSelector selector(3, probe_period);
+
+    // Every strategy is measured once first
+    for (int i = 0; i < 3; i++) {
+        CHECK(selector.select() == i);
+        selector.record(i, 1.0 + i);
+    }
+    CHECK(selector.cost(2) == Approx(3.0));
+
+    // The cheapest is used between probes of the least recently measured
+    for (int i = 0; i < probe_period; i++) {
+        CHECK(selector.select() == 0);
+        selector.record(0, 1.0);
+    }
+    CHECK(selector.select() == 1); // Probe (8th selection)
+    selector.record(1, 0.5);
+    CHECK(selector.cost(1) == Approx(0.5));
+
+    // The average follows new measurements
+    CHECK(selector.select() == 1);
+    selector.record(1, 1.3);
+    CHECK(selector.cost(1) == Approx(0.7));
+    CHECK(selector.select() == 1);
+    CHECK(selector.select() == 1);
+    CHECK(selector.select() == 2); // Probe (12th selection)
+
+    CostBasedSelector copy = selector;
+    selector.reset();
+    CHECK(selector.select() == 0);
+    CHECK(std::isinf(copy.cost(1)));
+    CHECK(copy.select() == 0);
+}
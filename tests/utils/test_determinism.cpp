@@ -0,0 +1,68 @@
+#include <algorithm>
+#include <vector>
+
+#include <catch2/catch.hpp>
+
+#include <tbb/enumerable_thread_specific.h>
+#include <tbb/task_arena.h>
+
+#include <ccd/rigid/broad_phase.hpp>
+#include <utils/determinism.hpp>
+
+using namespace ipc;
+using namespace ipc::rigid;
+
+TEST_CASE("Deterministic parallel for", "[utils][determinism]")
+{
+    const size_t size = 10 * Constants::DETERMINISTIC_GRAIN_SIZE + 3;
+    const auto sum_subranges = [&]() {
+        // Sum each subrange, then the subranges in order
+        tbb::enumerable_thread_specific<
+            std::vector<std::pair<size_t, double>>>
+            storage;
+        deterministic_parallel_for(
+            /*deterministic=*/true, size,
+            [&](const tbb::blocked_range<size_t>& range) {
+                double sum = 0;
+                for (size_t i = range.begin(); i != range.end(); ++i) {
+                    sum += 1.0 / (i + 1);
+                }
+                storage.local().emplace_back(range.begin(), sum);
+            });
+        std::vector<std::pair<size_t, double>> sums;
+        for (const auto& local_sums : storage) {
+            sums.insert(sums.end(), local_sums.begin(), local_sums.end());
+        }
+        std::sort(sums.begin(), sums.end());
+        return sums;
+    };
+
+    std::vector<std::pair<size_t, double>> serial_sums, parallel_sums;
+    tbb::task_arena(1).execute([&] { serial_sums = sum_subranges(); });
+    tbb::task_arena(4).execute([&] { parallel_sums = sum_subranges(); });
+    // The subranges (and so the bits of their sums) do not depend on the
+    // number of threads
+    CHECK(serial_sums == parallel_sums);
+    CHECK(serial_sums.size() > 1);
+}
+
+TEST_CASE("Sort candidates", "[utils][determinism][broad_phase]")
+{
+    Candidates candidates;
+    candidates.ee_candidates.emplace_back(3, 1);
+    candidates.ee_candidates.emplace_back(0, 4);
+    candidates.ee_candidates.emplace_back(3, 0);
+    candidates.fv_candidates.emplace_back(2, 5);
+    candidates.fv_candidates.emplace_back(1, 7);
+
+    sort_candidates(candidates);
+
+    REQUIRE(candidates.ee_candidates.size() == 3);
+    CHECK(candidates.ee_candidates[0].edge0_index == 0);
+    CHECK(candidates.ee_candidates[1].edge0_index == 3);
+    CHECK(candidates.ee_candidates[1].edge1_index == 0);
+    CHECK(candidates.ee_candidates[2].edge1_index == 1);
+    REQUIRE(candidates.fv_candidates.size() == 2);
+    CHECK(candidates.fv_candidates[0].face_index == 1);
+    CHECK(candidates.fv_candidates[1].face_index == 2);
+}
@@ -0,0 +1,88 @@
+#include <catch2/catch.hpp>
+
+#include <set>
+
+#include <utils/graph_coloring.hpp>
+
+using namespace ipc::rigid;
+
+static void check_coloring(
+    const std::vector<std::array<long, 2>>& node_pairs,
+    const NodePairColoring& coloring)
+{
+    // Every item appears once
+    REQUIRE(coloring.items.size() == node_pairs.size());
+    CHECK(
+        std::set<size_t>(coloring.items.begin(), coloring.items.end()).size()
+        == node_pairs.size());
+
+    for (size_t c = 0; c < coloring.num_colors(); c++) {
+        std::set<long> nodes;
+        const size_t begin = coloring.color_starts[c];
+        const size_t end = coloring.color_starts[c + 1];
+        CHECK(begin < end);
+        for (size_t i = begin; i < end; i++) {
+            if (i > begin) {
+                CHECK(coloring.items[i - 1] < coloring.items[i]);
+            }
+            const auto [n0, n1] = node_pairs[coloring.items[i]];
+            CHECK(nodes.count(n0) == 0);
+            nodes.insert(n0);
+            if (n1 != n0) {
+                CHECK(nodes.count(n1) == 0);
+                nodes.insert(n1);
+            }
+        }
+    }
+}
+
+TEST_CASE("Coloring of node pairs", "[utils][graph_coloring]")
+{
+    NodePairColoring coloring;
+
+    SECTION("Empty")
+    {
+        color_node_pairs({}, 4, 64, coloring);
+        CHECK(coloring.num_colors() == 0);
+        CHECK(coloring.num_uncolored() == 0);
+    }
+
+    SECTION("Chain")
+    {
+        // 0-1-2-3-4 needs two colors
+        const std::vector<std::array<long, 2>> pairs = {
+            { { 0, 1 } }, { { 1, 2 } }, { { 2, 3 } }, { { 3, 4 } }
+        };
+        color_node_pairs(pairs, 5, 64, coloring);
+        CHECK(coloring.num_colors() == 2);
+        CHECK(coloring.num_uncolored() == 0);
+        check_coloring(pairs, coloring);
+    }
+
+    SECTION("Self pairs and duplicates")
+    {
+        const std::vector<std::array<long, 2>> pairs = {
+            { { 0, 0 } }, { { 1, 2 } }, { { 2, 1 } }, { { 1, 1 } }
+        };
+        color_node_pairs(pairs, 3, 64, coloring);
+        CHECK(coloring.num_colors() == 3);
+        check_coloring(pairs, coloring);
+    }
+
+    SECTION("Hub beyond the largest number of colors")
+    {
+        // Node 0 touches every item, so only max_colors items are colored
+        std::vector<std::array<long, 2>> pairs;
+        for (long i = 1; i <= 10; i++) {
+            pairs.push_back({ { 0, i } });
+        }
+        color_node_pairs(pairs, 11, 4, coloring);
+        CHECK(coloring.num_colors() == 4);
+        CHECK(coloring.num_uncolored() == 6);
+        check_coloring(pairs, coloring);
+
+        color_node_pairs(pairs, 11, 64, coloring);
+        CHECK(coloring.num_colors() == 10);
+        CHECK(coloring.num_uncolored() == 0);
+    }
+}
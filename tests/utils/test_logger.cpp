@@ -0,0 +1,33 @@
+#include <catch2/catch.hpp>
+
+#include <logger.hpp>
+
+using namespace ipc;
+using namespace ipc::rigid;
+
+TEST_CASE("Disabled log arguments are not evaluated", "[utils][logger]")
+{
+    const spdlog::level::level_enum prev_level = spdlog::get_level();
+    int num_evaluations = 0;
+    auto expensive = [&]() {
+        num_evaluations++;
+        return 1;
+    };
+
+    spdlog::set_level(spdlog::level::info);
+    RIGID_IPC_LOG_DEBUG("value={:d}", expensive());
+    RIGID_IPC_LOG_TRACE("value={:d}", expensive());
+    CHECK(num_evaluations == 0);
+
+    spdlog::set_level(spdlog::level::off);
+    RIGID_IPC_LOG_WARN("value={:d}", expensive());
+    CHECK(num_evaluations == 0);
+
+#if RIGID_IPC_LOG_ACTIVE_LEVEL <= SPDLOG_LEVEL_DEBUG
+    spdlog::set_level(spdlog::level::debug);
+    RIGID_IPC_LOG_DEBUG("value={:d}", expensive());
+    CHECK(num_evaluations == 1);
+#endif
+
+    spdlog::set_level(prev_level);
+}
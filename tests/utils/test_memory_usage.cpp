@@ -0,0 +1,45 @@
+#include <catch2/catch.hpp>
+
+#include <utils/memory_usage.hpp>
+
+using namespace ipc::rigid;
+
+TEST_CASE("Memory usage gauges", "[utils][memory_usage]")
+{
+    MemoryUsage::reset();
+    MemoryUsage::set_bytes(MemoryUsage::CANDIDATES, 100);
+    MemoryUsage::set_bytes(MemoryUsage::CANDIDATES, 40);
+    CHECK(MemoryUsage::bytes(MemoryUsage::CANDIDATES) == 40);
+    CHECK(MemoryUsage::peak_bytes(MemoryUsage::CANDIDATES) == 100);
+
+    MemoryUsage::add_bytes(MemoryUsage::STATE_HISTORY, 30);
+    MemoryUsage::add_bytes(MemoryUsage::STATE_HISTORY, 20);
+    MemoryUsage::add_bytes(MemoryUsage::STATE_HISTORY, -10);
+    CHECK(MemoryUsage::bytes(MemoryUsage::STATE_HISTORY) == 40);
+    CHECK(MemoryUsage::peak_bytes(MemoryUsage::STATE_HISTORY) == 50);
+
+    const nlohmann::json usage = MemoryUsage::to_json();
+    CHECK(usage["candidates"]["bytes"] == 40);
+    CHECK(usage["candidates"]["peak_bytes"] == 100);
+    CHECK(usage["meshes"]["bytes"] == 0);
+
+    MemoryUsage::reset();
+    CHECK(MemoryUsage::bytes(MemoryUsage::CANDIDATES) == 0);
+    CHECK(MemoryUsage::peak_bytes(MemoryUsage::CANDIDATES) == 0);
+}
+
+TEST_CASE("Memory usage of containers", "[utils][memory_usage]")
+{
+    std::vector<double> v;
+    v.reserve(10);
+    CHECK(MemoryUsage::bytes_of(v) == 10 * sizeof(double));
+    CHECK(MemoryUsage::bytes_of(Eigen::MatrixXi(3, 2)) == 6 * sizeof(int));
+
+    const nlohmann::json small = { { "a", 1 } };
+    const nlohmann::json large = { { "a", 1 },
+                                   { "b", std::vector<double>(100, 0.0) } };
+    CHECK(MemoryUsage::json_bytes(small) > sizeof(nlohmann::json));
+    CHECK(
+        MemoryUsage::json_bytes(large)
+        >= MemoryUsage::json_bytes(small) + 100 * sizeof(nlohmann::json));
+}
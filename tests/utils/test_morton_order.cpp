@@ -0,0 +1,50 @@
+#include <catch2/catch.hpp>
+
+#include <algorithm>
+
+#include <utils/morton_order.hpp>
+
+using namespace ipc::rigid;
+
+TEST_CASE("Morton code interleaves bits", "[utils][morton_order]")
+{
+    const Eigen::Vector2d min(0, 0), max(1, 1);
+    CHECK(morton_code(Eigen::Vector2d(0, 0), min, max) == 0);
+    // x is the lowest bit and y the next
+    CHECK(morton_code(Eigen::Vector2d(1, 0), min, max) == 0x5555555555555555);
+    CHECK(morton_code(Eigen::Vector2d(0, 1), min, max) == 0xAAAAAAAAAAAAAAAA);
+    CHECK(morton_code(Eigen::Vector2d(1, 1), min, max) == ~uint64_t(0));
+
+    const Eigen::Vector3d min3(0, 0, 0), max3(1, 1, 1);
+    CHECK(
+        morton_code(Eigen::Vector3d(1, 1, 1), min3, max3)
+        == (uint64_t(1) << 63) - 1);
+}
+
+TEST_CASE("Morton order groups nearby points", "[utils][morton_order]")
+{
+    // Two clusters interleaved in the input
+    Eigen::MatrixXd points(6, 3);
+    points << 0, 0, 0, //
+        10, 10, 10,    //
+        0.1, 0, 0,     //
+        10, 10.1, 10,  //
+        0, 0.1, 0,     //
+        10.1, 10, 10;
+    const std::vector<int> order = morton_order(points);
+    REQUIRE(order.size() == 6);
+
+    std::vector<int> sorted_order = order;
+    std::sort(sorted_order.begin(), sorted_order.end());
+    CHECK(sorted_order == std::vector<int>({ 0, 1, 2, 3, 4, 5 }));
+
+    // Each cluster is contiguous along the curve
+    for (int i = 0; i < 3; i++) {
+        CHECK(order[i] % 2 == order[0] % 2);
+        CHECK(order[i + 3] % 2 != order[0] % 2);
+    }
+
+    // Coincident points keep their order
+    const std::vector<int> ties = morton_order(Eigen::MatrixXd::Ones(4, 2));
+    CHECK(ties == std::vector<int>({ 0, 1, 2, 3 }));
+}
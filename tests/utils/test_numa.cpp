@@ -0,0 +1,34 @@
+#include <algorithm>
+#include <vector>
+
+#include <catch2/catch.hpp>
+
+#include <utils/numa.hpp>
+
+using namespace ipc::rigid;
+
+TEST_CASE("Parallel first touch", "[utils][numa]")
+{
+    // Below and above the parallel threshold
+    const size_t size = GENERATE(
+        size_t(10), 3 * Constants::FIRST_TOUCH_MIN_BYTES / sizeof(double) + 7);
+    const bool use_huge_pages = GENERATE(false, true);
+    NumaPlacement::set_use_huge_pages(use_huge_pages);
+
+    std::vector<double> buffer(size, -1.0);
+    parallel_first_touch(buffer.data(), buffer.size(), 2.0);
+    CHECK(std::all_of(
+        buffer.begin(), buffer.end(), [](double v) { return v == 2.0; }));
+
+    NumaPlacement::set_use_huge_pages(false);
+}
+
+TEST_CASE("Thread pinning", "[utils][numa]")
+{
+    ThreadPinningObserver observer;
+    std::vector<int> values(1000, 0);
+    tbb::parallel_for(size_t(0), values.size(), [&](size_t i) {
+        values[i] = int(i);
+    });
+    CHECK(values.back() == 999);
+}
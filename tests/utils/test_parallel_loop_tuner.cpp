@@ -0,0 +1,88 @@
+#include <atomic>
+#include <cmath>
+#include <vector>
+
+#include <catch2/catch.hpp>
+
+#include <tbb/task_arena.h>
+
+#include <utils/determinism.hpp>
+#include <utils/parallel_loop_tuner.hpp>
+
+using namespace ipc::rigid;
+
+namespace {
+class TestParallelLoopTuner : public ParallelLoopTuner {
+public:
+    using ParallelLoopTuner::m_selector;
+    using ParallelLoopTuner::record;
+};
+} // namespace
+
+TEST_CASE("Tuned parallel loops", "[utils][parallel_loop_tuner]")
+{
+    ParallelLoopTuner::set_enabled(true);
+
+    const size_t size = 1000;
+    std::vector<std::atomic<int>> counts(size);
+    TestParallelLoopTuner tuner;
+    for (int call = 0; call < 4 * ParallelLoopTuner::NUM_PARTITIONERS;
+         call++) {
+        tuner.parallel_for(size, [&](const tbb::blocked_range<size_t>& r) {
+            for (size_t i = r.begin(); i != r.end(); ++i) {
+                counts[i]++;
+            }
+        });
+        // Every partitioner visits every index once
+        for (size_t i = 0; i < size; i++) {
+            REQUIRE(counts[i] == call + 1);
+        }
+    }
+    for (int i = 0; i < ParallelLoopTuner::NUM_PARTITIONERS; i++) {
+        CHECK(std::isfinite(tuner.m_selector.cost(i)));
+    }
+
+    // A copy starts over
+    const TestParallelLoopTuner copy = tuner;
+    CHECK(std::isinf(copy.m_selector.cost(ParallelLoopTuner::AUTO)));
+
+    // A deterministic loop is not tuned
+    tuner.reset();
+    deterministic_parallel_for(
+        /*deterministic=*/true, size,
+        [&](const tbb::blocked_range<size_t>& r) {
+            CHECK(r.size() <= Constants::DETERMINISTIC_GRAIN_SIZE);
+        },
+        tuner);
+    CHECK(std::isinf(tuner.m_selector.cost(ParallelLoopTuner::AUTO)));
+
+    ParallelLoopTuner::set_enabled(false);
+}
+
+TEST_CASE("Tuned grain size", "[utils][parallel_loop_tuner]")
+{
+    tbb::task_arena(1).execute([] {
+        TestParallelLoopTuner tuner;
+        CHECK(tuner.grain_size(1000) == 1); // Never measured
+
+        // About a microsecond per item (exactly representable)
+        const double item_seconds = std::ldexp(1.0, -20);
+        tuner.record(ParallelLoopTuner::AUTO, 128, 128 * item_seconds);
+        CHECK(tuner.best_partitioner() == ParallelLoopTuner::AUTO);
+
+        const size_t target_grain_size = size_t(std::ceil(
+            Constants::PARALLEL_LOOP_TARGET_CHUNK_SECONDS / item_seconds));
+        const size_t large_size = 1000 * target_grain_size;
+        CHECK(tuner.grain_size(large_size) == target_grain_size);
+        // Small loops keep enough chunks to balance the threads
+        const size_t small_size = target_grain_size;
+        CHECK(
+            tuner.grain_size(small_size)
+            == small_size / Constants::PARALLEL_LOOP_MIN_CHUNKS_PER_THREAD);
+        CHECK(tuner.grain_size(2) == 1);
+
+        // A cheaper partitioner becomes the best one
+        tuner.record(ParallelLoopTuner::SIMPLE, 128, 64 * item_seconds);
+        CHECK(tuner.best_partitioner() == ParallelLoopTuner::SIMPLE);
+    });
+}
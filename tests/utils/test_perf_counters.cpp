@@ -0,0 +1,35 @@
+#include <catch2/catch.hpp>
+
+#include <tbb/parallel_for.h>
+
+#include <perf_counters.hpp>
+
+using namespace ipc::rigid::profiler;
+
+TEST_CASE("Hardware counters of every thread", "[utils][perf_counters]")
+{
+    if (!PerfCounters::enable("bad_event")) {
+        // Containers and CI machines often forbid perf_event_open
+        CHECK(PerfCounters::read().empty());
+        return;
+    }
+    // The invalid raw event is skipped
+    const size_t num_events = PerfCounters::event_names().size();
+    CHECK(num_events == 6);
+
+    const std::vector<std::vector<double>> start = PerfCounters::read();
+    volatile double sum = 0;
+    for (int i = 0; i < 1000000; i++) {
+        sum = sum + i;
+    }
+    tbb::parallel_for(0, 1000, [](int) { });
+    const std::vector<std::vector<double>> end = PerfCounters::read();
+
+    REQUIRE(!start.empty());
+    REQUIRE(end.size() >= start.size());
+    for (const auto& counts : end) {
+        CHECK(counts.size() == num_events);
+    }
+    // The enabling thread executed at least the loop's instructions
+    CHECK(end[0][1] - start[0][1] >= 1000000);
+}
@@ -0,0 +1,29 @@
+#include <catch2/catch.hpp>
+
+#include <random>
+
+#include <utils/radix_sort.hpp>
+
+using namespace ipc::rigid;
+
+TEST_CASE("Parallel radix sort", "[utils][radix_sort]")
+{
+    const size_t n = GENERATE(0, 10, 100000);
+    const uint64_t max_key = GENERATE(uint64_t(1), 1000, uint64_t(1) << 40);
+
+    std::mt19937_64 gen(n + max_key);
+    std::uniform_int_distribution<uint64_t> distribution(0, max_key);
+    std::vector<std::pair<uint64_t, size_t>> items(n);
+    for (size_t i = 0; i < n; i++) {
+        items[i] = { distribution(gen), i };
+    }
+
+    // Sorting by key only must keep equal keys in their original order
+    std::vector<std::pair<uint64_t, size_t>> expected = items;
+    std::sort(expected.begin(), expected.end());
+    parallel_radix_sort(
+        items, [](const std::pair<uint64_t, size_t>& item) {
+            return item.first;
+        });
+    CHECK(items == expected);
+}
@@ -89,6 +89,32 @@ TEST_CASE("interval sinc with looser bounds", "[sinc][interval]")
     }
 }
 
+TEST_CASE("interval sinc between extrema", "[sinc][interval]")
+{
+    double a = GENERATE(4.0, 4.4934, 5.0, 7.7, 11.0, 20.0, 23.5, 30.0);
+    double width = GENERATE(1e-6, 0.1, 1.0, 3.0, 10.0);
+    Interval x(a, a + width);
+
+    // Dense samples of sinc over x
+    double min_y = INFINITY, max_y = -INFINITY;
+    const int n = 10000;
+    for (int i = 0; i <= n; i++) {
+        double yi = sinc(a + width * i / n);
+        min_y = std::min(min_y, yi);
+        max_y = std::max(max_y, yi);
+    }
+
+    Interval y = sinc(x);
+    CAPTURE(a, width, y.lower(), y.upper(), min_y, max_y);
+    CHECK(y.lower() <= min_y);
+    CHECK(y.upper() >= max_y);
+    // Only the tail past the tabulated extrema uses the natural extension
+    if (x.upper() <= 23.5) {
+        CHECK(y.lower() == Approx(min_y).margin(1e-6));
+        CHECK(y.upper() == Approx(max_y).margin(1e-6));
+    }
+}
+
 TEST_CASE("interval sinc_normx", "[sinc][interval]")
 {
     VectorMax3<Interval> x = VectorMax3<Interval>::Zero(3);
@@ -0,0 +1,77 @@
+#include <catch2/catch.hpp>
+
+#include <utils/stress_scenes.hpp>
+
+using namespace ipc::rigid;
+
+TEST_CASE("Stress scenes have the requested bodies", "[utils][stress_scenes]")
+{
+    const size_t num_bodies = GENERATE(1, 10, 57);
+    for (const std::string& name : stress_scenes::scene_names()) {
+        const std::vector<RigidBody> rbs =
+            stress_scenes::stress_scene(name, num_bodies);
+        REQUIRE(rbs.size() == num_bodies);
+        for (const RigidBody& rb : rbs) {
+            CHECK(rb.dim() == 3);
+        }
+    }
+    CHECK(stress_scenes::stress_scene("unknown", num_bodies).empty());
+}
+
+TEST_CASE("Stress scene bodies are separated", "[utils][stress_scenes]")
+{
+    const std::string name = GENERATE(as<std::string>(), "pile", "rods");
+    const std::vector<RigidBody> rbs =
+        stress_scenes::stress_scene(name, 30, /*seed=*/7);
+    CHECK(rbs[0].type == RigidBodyType::STATIC);
+
+    // Bounding spheres of the dynamic bodies are disjoint and above ground
+    std::vector<Eigen::Vector3d> centers(rbs.size());
+    std::vector<double> radii(rbs.size());
+    for (size_t i = 1; i < rbs.size(); i++) {
+        const Eigen::MatrixXd V = rbs[i].world_vertices();
+        centers[i] = V.colwise().mean();
+        radii[i] = (V.rowwise() - centers[i].transpose())
+                       .rowwise()
+                       .norm()
+                       .maxCoeff();
+        CHECK(V.col(1).minCoeff() > 0);
+    }
+    for (size_t i = 1; i < rbs.size(); i++) {
+        for (size_t j = i + 1; j < rbs.size(); j++) {
+            CHECK((centers[i] - centers[j]).norm() > radii[i] + radii[j]);
+        }
+    }
+}
+
+TEST_CASE("Stress scene shapes", "[utils][stress_scenes]")
+{
+    SECTION("Rods are codimensional")
+    {
+        const std::vector<RigidBody> rbs = stress_scenes::codim_rods(5);
+        for (size_t i = 1; i < rbs.size(); i++) {
+            CHECK(rbs[i].faces.size() == 0);
+            CHECK(rbs[i].edges.rows() == 8);
+        }
+    }
+
+    SECTION("Chains hang from static links")
+    {
+        const size_t chain_length = 4;
+        const std::vector<RigidBody> rbs =
+            stress_scenes::chain_grid(10, chain_length);
+        for (size_t i = 0; i < rbs.size(); i++) {
+            CHECK(
+                (rbs[i].type == RigidBodyType::STATIC)
+                == (i % chain_length == 0));
+        }
+        // Links of a chain alternate orientation
+        CHECK(!rbs[0].pose.rotation.isApprox(rbs[1].pose.rotation));
+    }
+
+    SECTION("Bodies of the same shape share their geometry")
+    {
+        const std::vector<RigidBody> rbs = stress_scenes::codim_rods(5);
+        CHECK(rbs[1].geometry == rbs[2].geometry);
+    }
+}
@@ -0,0 +1,96 @@
+#include <catch2/catch.hpp>
+
+#include <fstream>
+#include <string>
+
+#include <ghc/fs_std.hpp> // filesystem
+#include <tbb/parallel_for.h>
+
+#include <tracer.hpp>
+
+using namespace ipc::rigid::tracer;
+
+TEST_CASE("Tracer aggregates scopes across threads", "[utils][tracer]")
+{
+    Tracer::disable();
+    {
+        TRACE_SCOPE("ignored");
+    }
+
+    Tracer::enable();
+    tbb::parallel_for(0, 100, [](int) { TRACE_SCOPE("kernel"); });
+    {
+        TRACE_SCOPE("outer");
+        TRACE_SCOPE("inner");
+    }
+    Tracer::disable();
+
+    nlohmann::json summary = Tracer::summary();
+    CHECK(!summary.contains("ignored"));
+    REQUIRE(summary.contains("kernel"));
+    CHECK(summary["kernel"]["calls"] == 100);
+    CHECK(summary["outer"]["calls"] == 1);
+    CHECK(summary["inner"]["calls"] == 1);
+    CHECK(
+        summary["outer"]["total_time"].get<double>()
+        >= summary["inner"]["total_time"].get<double>());
+
+    fs::path filename = fs::temp_directory_path() / "rigid-ipc-test-trace.json";
+    REQUIRE(Tracer::write_chrome_trace(filename.string()));
+    std::ifstream file(filename.string());
+    nlohmann::json trace = nlohmann::json::parse(file);
+    int num_kernels = 0;
+    for (const auto& event : trace["traceEvents"]) {
+        num_kernels += event["name"] == "kernel";
+    }
+    CHECK(num_kernels == 100);
+    file.close();
+    fs::remove(filename);
+}
+
+TEST_CASE("Tracer scaling report", "[utils][tracer]")
+{
+    Tracer::enable();
+    {
+        TRACE_SCOPE("parallel_phase");
+        tbb::parallel_for(0, 1000, [](int i) {
+            TRACE_SCOPE("parallel_phase::task");
+            volatile double x = 0;
+            for (int j = 0; j < 1000; j++) {
+                x += j * i;
+            }
+        });
+    }
+    {
+        TRACE_SCOPE("serial_phase");
+        volatile double x = 0;
+        for (int j = 0; j < 100000; j++) {
+            x += j;
+        }
+    }
+    Tracer::disable();
+
+    const nlohmann::json report = Tracer::scaling_report();
+    CHECK(report["num_threads"] >= 1);
+    CHECK(!report["phases"].contains("parallel_phase::task"));
+    REQUIRE(report["phases"].contains("parallel_phase"));
+    REQUIRE(report["phases"].contains("serial_phase"));
+
+    const nlohmann::json& parallel = report["phases"]["parallel_phase"];
+    CHECK(parallel["calls"] == 1);
+    CHECK(
+        parallel["parallel_time"].get<double>()
+        <= parallel["wall_time"].get<double>());
+    CHECK(
+        parallel["work_time"].get<double>()
+        >= parallel["parallel_time"].get<double>());
+    CHECK(parallel["serial_fraction"].get<double>() >= 0);
+    CHECK(parallel["serial_fraction"].get<double>() < 1);
+    CHECK(parallel["load_imbalance"].get<double>() >= 0);
+
+    const nlohmann::json& serial = report["phases"]["serial_phase"];
+    CHECK(serial["parallel_time"] == 0.0);
+    CHECK(serial["serial_fraction"] == 1.0);
+    CHECK(serial["amdahl_speedup"]["128"].get<double>() == Approx(1));
+    CHECK(!serial["scales_beyond_16"].get<bool>());
+}
@@ -0,0 +1,41 @@
+#include <catch2/catch.hpp>
+
+#include <vector>
+
+#include <utils/transient_pool.hpp>
+
+using namespace ipc::rigid;
+
+TEST_CASE("Transient pool reuses buffers", "[utils][transient_pool]")
+{
+    TransientPool<std::vector<int>> pool;
+
+    const std::vector<int>* first_buffer;
+    {
+        auto buffer = pool.acquire();
+        CHECK(buffer->empty());
+        buffer->resize(100);
+        first_buffer = buffer.get();
+    }
+
+    {
+        // Released buffers are handed out again (with their capacity)
+        auto buffer = pool.acquire();
+        CHECK(buffer.get() == first_buffer);
+        CHECK(buffer->capacity() >= 100);
+
+        // Buffers in use are never shared
+        auto other_buffer = pool.acquire();
+        CHECK(other_buffer.get() != buffer.get());
+    }
+}
+
+TEST_CASE("Transient pool copies start empty", "[utils][transient_pool]")
+{
+    TransientPool<std::vector<int>> pool;
+    const std::vector<int>* buffer = pool.acquire().get();
+
+    TransientPool<std::vector<int>> copy(pool);
+    CHECK(copy.acquire().get() != buffer);
+    CHECK(pool.acquire().get() == buffer);
+}
@@ -23,6 +23,10 @@ def create_parser():
     parser.add_argument(
         "--absolute-time", action="store_true", default=False,
         help="save absolute times (seconds) instead of percentages")
+    parser.add_argument(
+        "--perf-counter", metavar="name", dest="perf_counter", default=None,
+        help="combine a hardware counter of all threads (e.g., IPC or "
+        "cache_misses) instead of the times")
     return parser
 
 
@@ -45,7 +49,8 @@ def append_stem(p, stem_suffix):
     return p.parent / (p.stem + stem_suffix + p.suffix)
 
 
-def combine_profiles(fixtures, absolute_time=False, base_output=None):
+def combine_profiles(fixtures, absolute_time=False, base_output=None,
+                     perf_counter=None):
     fixtures_dir = pathlib.Path(__file__).resolve().parents[1] / "fixtures"
     combined_profile = pandas.DataFrame()
     for fixture in fixtures:
@@ -57,6 +62,20 @@ def combine_profiles(fixtures, absolute_time=False, base_output=None):
         log_dirs = list(filter(lambda p: p.is_dir(), sim_output.glob("log*")))
         if log_dirs:
             profiler_dir = max(log_dirs, key=os.path.getmtime)
+            if perf_counter is not None:
+                counters_csv = profiler_dir / "perf_counters.csv"
+                if not counters_csv.is_file():
+                    continue
+                counters_df = pandas.read_csv(
+                    counters_csv, header=1, skipinitialspace=True)
+                counters_df = counters_df[
+                    counters_df["thread"].astype(str) == "all"]
+                profile_col = pandas.DataFrame(
+                    {fixture_name: counters_df[perf_counter].values},
+                    index=counters_df["section"].values)
+                combined_profile = pandas.concat(
+                    [combined_profile, profile_col], axis=1)
+                continue
             profiler_df = pandas.read_csv(
                 profiler_dir / "summary.csv", header=1, index_col=0,
                 skipinitialspace=True)
@@ -77,7 +96,8 @@ def combine_profiles(fixtures, absolute_time=False, base_output=None):
 
 def main():
     args = parse_arguments()
-    combined_profile_df = combine_profiles(args.input, args.absolute_time)
+    combined_profile_df = combine_profiles(
+        args.input, args.absolute_time, perf_counter=args.perf_counter)
     combined_profile_df.to_csv(args.output)
     print(f"Combined profile written to {args.output}")
 
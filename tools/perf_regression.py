@@ -0,0 +1,241 @@
+"""Performance regression gate over a pinned corpus of fixture scenes.
+
+Every scene of the corpus is simulated for a fixed number of steps a few
+times. The timings of the steps, the per-phase timings (from the profiler in
+profiling builds and the tracer otherwise), and the peak RSS are recorded and
+compared against a stored baseline. A metric regresses when its median grows
+by more than the relative threshold and by more than z times the combined
+noise (scaled median absolute deviation) of the two sets of samples.
+
+    # Record a baseline
+    python tools/perf_regression.py --save-baseline baseline.json
+    # Compare against it (exits with 1 if any metric regressed)
+    python tools/perf_regression.py --baseline baseline.json -o report.json
+"""
+import sys
+import os
+import json
+import pathlib
+import argparse
+import subprocess
+import tempfile
+
+import numpy
+
+from benchmark import (
+    fixture_dir, find_sim_exe, sim_exe_name, get_git_hash, get_machine_info)
+
+REPORT_VERSION = 1
+
+
+def create_parser():
+    parser = argparse.ArgumentParser(
+        description="Run the performance corpus and compare to a baseline.")
+    parser.add_argument(
+        "--sim-exe", metavar=f"path/to/{sim_exe_name()}", type=pathlib.Path,
+        default=None, help="path to simulation executable")
+    parser.add_argument(
+        "--corpus", metavar="path/to/corpus.json", type=pathlib.Path,
+        default=pathlib.Path(__file__).parent / "benchmarks"
+        / "perf_corpus.json", help="scenes to run")
+    parser.add_argument(
+        "--repeats", type=int, default=5, help="runs of every scene")
+    parser.add_argument(
+        "--nthreads", type=int, default=8, help="threads of every run")
+    parser.add_argument(
+        "--baseline", metavar="path/to/baseline.json", type=pathlib.Path,
+        default=None, help="results to compare against")
+    parser.add_argument(
+        "--save-baseline", metavar="path/to/baseline.json",
+        type=pathlib.Path, default=None, help="save the results as a baseline")
+    parser.add_argument(
+        "-o", "--output", metavar="path/to/report.json", type=pathlib.Path,
+        default=None, help="regression report (printed if not given)")
+    parser.add_argument(
+        "--threshold", type=float, default=0.05,
+        help="relative growth of a median considered a regression")
+    parser.add_argument(
+        "--z", type=float, default=3.0,
+        help="growth in units of the combined noise considered significant")
+    parser.add_argument(
+        "--min-phase-time", type=float, default=0.05,
+        help="ignore phases taking less seconds than this in the baseline")
+    parser.add_argument(
+        "--sim-args", default="", help=f"arguments to {sim_exe_name()}")
+    return parser
+
+
+def profiler_phase_times(output_dir):
+    """Total time of every profiled section (profiling builds only)."""
+    log_dirs = [p for p in output_dir.glob("log*") if p.is_dir()]
+    if not log_dirs:
+        return None
+    summary = max(log_dirs, key=os.path.getmtime) / "summary.csv"
+    times = {}
+    with open(summary) as f:
+        lines = f.read().splitlines()[2:]  # Skip the scene and header
+    for line in lines:
+        fields = line.rsplit(",", 5)
+        if len(fields) == 6:
+            times[fields[0]] = float(fields[1])
+    return times
+
+
+def trace_phase_times(trace_file):
+    """Total duration of every traced scope summed over the threads."""
+    with open(trace_file) as f:
+        events = json.load(f)["traceEvents"]
+    times = {}
+    for event in events:
+        if event.get("ph") == "X":
+            times[event["name"]] = (
+                times.get(event["name"], 0) + event["dur"] * 1e-6)
+    return times
+
+
+def run_scene(args, scene, num_steps, output_dir):
+    trace_file = output_dir / "trace.json"
+    subprocess.run(
+        [str(args.sim_exe), "--ngui", str(scene), str(output_dir),
+         "--loglevel", "warning", "--nthreads", str(args.nthreads),
+         "--num-steps", str(num_steps), "--trace", str(trace_file)]
+        + args.sim_args.split(), check=True, stdout=subprocess.DEVNULL)
+
+    with open(output_dir / "sim.json") as f:
+        stats = json.load(f)["stats"]
+    phases = profiler_phase_times(output_dir)
+    if phases is None:
+        phases = trace_phase_times(trace_file)
+
+    metrics = {
+        "total_step_time": float(numpy.sum(stats["step_timings"])),
+        "max_step_time": float(numpy.max(stats["step_timings"])),
+        "peak_rss": float(stats["memory"]),
+    }
+    metrics.update({f"phase:{name}": t for name, t in phases.items()})
+    return metrics, int(numpy.sum(stats["solver_iterations"]))
+
+
+def run_corpus(args):
+    with open(args.corpus) as f:
+        corpus = json.load(f)
+
+    results = {}
+    for entry in corpus["scenes"]:
+        scene = fixture_dir() / entry["scene"]
+        if not scene.is_file():
+            raise Exception(f"{scene} does not exist!")
+        samples = {}
+        solver_iterations = set()
+        for i in range(args.repeats):
+            print(f"Running {entry['scene']} ({i + 1}/{args.repeats})",
+                  file=sys.stderr)
+            with tempfile.TemporaryDirectory() as output_dir:
+                metrics, iterations = run_scene(
+                    args, scene, entry["num_steps"], pathlib.Path(output_dir))
+            for name, value in metrics.items():
+                samples.setdefault(name, []).append(value)
+            solver_iterations.add(iterations)
+        results[entry["scene"]] = {
+            "num_steps": entry["num_steps"],
+            # Different iterations mean the timings measure different work
+            "solver_iterations": sorted(solver_iterations),
+            "samples": samples,
+        }
+    return results
+
+
+def robust_stats(samples):
+    samples = numpy.asarray(samples)
+    median = numpy.median(samples)
+    # Scaled to the standard deviation of normally distributed samples
+    noise = 1.4826 * numpy.median(numpy.abs(samples - median))
+    return float(median), float(noise)
+
+
+def compare(args, baseline, results):
+    comparisons = []
+    for scene, result in results.items():
+        if scene not in baseline:
+            continue
+        base = baseline[scene]
+        for name, samples in result["samples"].items():
+            if name not in base["samples"]:
+                continue
+            base_median, base_noise = robust_stats(base["samples"][name])
+            median, noise = robust_stats(samples)
+            if name.startswith("phase:") and base_median < args.min_phase_time:
+                continue
+            delta = median - base_median
+            relative_change = delta / base_median if base_median > 0 else 0
+            is_regression = bool(
+                relative_change > args.threshold
+                and delta > args.z * numpy.hypot(base_noise, noise))
+            comparisons.append({
+                "scene": scene,
+                "metric": name,
+                "baseline_median": base_median,
+                "median": median,
+                "relative_change": relative_change,
+                "regression": is_regression,
+            })
+        if base["solver_iterations"] != result["solver_iterations"]:
+            comparisons.append({
+                "scene": scene,
+                "metric": "solver_iterations",
+                "baseline_median": float(numpy.median(
+                    base["solver_iterations"])),
+                "median": float(numpy.median(result["solver_iterations"])),
+                "relative_change": None,
+                "regression": False,  # Reported, but not a slowdown
+            })
+    return comparisons
+
+
+def main():
+    parser = create_parser()
+    args = parser.parse_args()
+    if args.sim_exe is None:
+        args.sim_exe = find_sim_exe()
+        if args.sim_exe is None:
+            parser.exit(1, f"Unable to find {sim_exe_name()}\n")
+
+    results = run_corpus(args)
+    report = {
+        "version": REPORT_VERSION,
+        "git_hash": get_git_hash(),
+        "machine": get_machine_info(),
+        "nthreads": args.nthreads,
+        "repeats": args.repeats,
+        "results": results,
+    }
+
+    if args.save_baseline is not None:
+        with open(args.save_baseline, "w") as f:
+            json.dump(report, f, indent=2)
+        print(f"Baseline written to {args.save_baseline}", file=sys.stderr)
+
+    num_regressions = 0
+    if args.baseline is not None:
+        with open(args.baseline) as f:
+            baseline = json.load(f)
+        if baseline.get("machine") != report["machine"]:
+            print("Warning: the baseline was recorded on another machine",
+                  file=sys.stderr)
+        report["baseline_git_hash"] = baseline.get("git_hash")
+        report["comparisons"] = compare(args, baseline["results"], results)
+        num_regressions = sum(c["regression"] for c in report["comparisons"])
+        report["num_regressions"] = num_regressions
+        del report["results"]  # The baseline file has the samples
+
+    if args.output is not None:
+        with open(args.output, "w") as f:
+            json.dump(report, f, indent=2)
+    else:
+        json.dump(report, sys.stdout, indent=2)
+        print()
+    sys.exit(1 if num_regressions else 0)
+
+
+if __name__ == "__main__":
+    main()